@@ -52,7 +52,8 @@ from kudu.schema import (int8, int16, int32, int64, string_ as string,  # noqa
                          ENCODING_PREFIX,
                          ENCODING_BIT_SHUFFLE,
                          ENCODING_RLE,
-                         ENCODING_DICT)
+                         ENCODING_DICT,
+                         ENCODING_DELTA_BIT_PACKED)
 
 
 def connect(host, port=7051, admin_timeout_ms=None, rpc_timeout_ms=None):
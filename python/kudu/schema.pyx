@@ -78,6 +78,7 @@ ENCODING_PREFIX = EncodingType_PREFIX
 ENCODING_BIT_SHUFFLE = EncodingType_BIT_SHUFFLE
 ENCODING_RLE = EncodingType_RLE
 ENCODING_DICT = EncodingType_DICT
+ENCODING_DELTA_BIT_PACKED = EncodingType_DELTA_BIT_PACKED
 
 cdef dict _encoding_types = {
     'auto': ENCODING_AUTO,
@@ -86,6 +87,7 @@ cdef dict _encoding_types = {
     'bitshuffle': ENCODING_BIT_SHUFFLE,
     'rle': ENCODING_RLE,
     'dict': ENCODING_DICT,
+    'delta_bit_packed': ENCODING_DELTA_BIT_PACKED,
 }
 
 cdef dict _encoding_type_to_name = _reverse_dict(_encoding_types)
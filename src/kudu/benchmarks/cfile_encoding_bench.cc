@@ -0,0 +1,573 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Micro-benchmark of the CFile encodings: for every combination of data type,
+// encoding, value distribution and scan batch size, writes a CFile and reports
+// the encode throughput, the compression ratio, and the decode throughput both
+// without a predicate (CopyNextValues()) and with a range predicate selecting
+// about half of the values (CopyNextAndEval(), for the decoders supporting
+// predicate evaluation, or evaluation after materialization otherwise).
+//
+// Example:
+//   cfile-encoding-bench --bench_types=int32,string --bench_encodings=bitshuffle,dict \
+//     --json_output=/tmp/cfile-bench.json
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/cfile_writer.h"
+#include "kudu/cfile/type_encodings.h"
+#include "kudu/common/column_materialization_context.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/fs/block_manager.h"
+#include "kudu/fs/data_dirs.h"
+#include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/stringprintf.h"
+#include "kudu/util/env.h"
+#include "kudu/util/flags.h"
+#include "kudu/util/jsonwriter.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/path_util.h"
+#include "kudu/util/random.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+DEFINE_int32(bench_num_rows, 1000000,
+             "Number of values written to every benchmarked CFile");
+DEFINE_string(bench_types, "int32,int64,double,string,bool",
+              "Comma-separated list of the data types to benchmark");
+DEFINE_string(bench_encodings, "plain,bitshuffle,rle,prefix,dict",
+              "Comma-separated list of the encodings to benchmark. Encodings "
+              "not supported by a data type are skipped for that type");
+DEFINE_string(bench_distributions, "sequential,random,low_cardinality,runs",
+              "Comma-separated list of the value distributions to benchmark: "
+              "'sequential' (increasing values), 'random' (uniformly random "
+              "values), 'low_cardinality' (random values out of 16 distinct "
+              "values) or 'runs' (increasing values, each repeated 64 times)");
+DEFINE_string(bench_batch_sizes, "100,1024,8192",
+              "Comma-separated list of the number of rows decoded per batch");
+DEFINE_int32(bench_iterations, 3,
+             "Number of times every measurement is repeated. The fastest "
+             "iteration is reported");
+DEFINE_string(bench_fs_root, "",
+              "Directory the benchmarked CFiles are written to. If empty, a "
+              "directory is created in the test directory and removed on exit");
+DEFINE_string(json_output, "",
+              "If set, the results are also written to this file as JSON");
+
+using kudu::cfile::CFileIterator;
+using kudu::cfile::CFileReader;
+using kudu::cfile::CFileWriter;
+using kudu::cfile::ReaderOptions;
+using kudu::cfile::TypeEncodingInfo;
+using kudu::cfile::WriterOptions;
+using kudu::fs::ReadableBlock;
+using kudu::fs::WritableBlock;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+namespace {
+
+// The blocks of the benchmarked CFiles are placed like those of a tablet.
+const char* const kTabletId = "cfile-encoding-bench";
+
+// The result of benchmarking an encoding on a set of values.
+struct BenchResult {
+  string type;
+  string encoding;
+  string distribution;
+  int64_t num_rows = 0;
+  int64_t raw_bytes = 0;
+  int64_t encoded_bytes = 0;
+  double encode_rows_per_sec = 0;
+
+  struct Decode {
+    int batch_size;
+    double rows_per_sec;
+    double eval_rows_per_sec;
+    bool decoder_eval;
+  };
+  vector<Decode> decodes;
+};
+
+Status ParseList(const string& flag_name, const string& value, vector<string>* out) {
+  *out = strings::Split(value, ",", strings::SkipEmpty());
+  if (out->empty()) {
+    return Status::InvalidArgument(Substitute("--$0 must not be empty", flag_name));
+  }
+  return Status::OK();
+}
+
+Status ParseEncoding(const string& name, EncodingType* encoding) {
+  static const std::pair<const char*, EncodingType> kEncodings[] = {
+    { "plain", PLAIN_ENCODING },
+    { "bitshuffle", BIT_SHUFFLE },
+    { "rle", RLE },
+    { "prefix", PREFIX_ENCODING },
+    { "dict", DICT_ENCODING },
+  };
+  for (const auto& e : kEncodings) {
+    if (name == e.first) {
+      *encoding = e.second;
+      return Status::OK();
+    }
+  }
+  return Status::InvalidArgument("unknown encoding", name);
+}
+
+Status ParseType(const string& name, DataType* type) {
+  static const std::pair<const char*, DataType> kTypes[] = {
+    { "int32", INT32 },
+    { "int64", INT64 },
+    { "double", DOUBLE },
+    { "string", STRING },
+    { "bool", BOOL },
+  };
+  for (const auto& t : kTypes) {
+    if (name == t.first) {
+      *type = t.second;
+      return Status::OK();
+    }
+  }
+  return Status::InvalidArgument("unknown data type", name);
+}
+
+Status DeleteBlock(FsManager* fs_manager, const BlockId& block_id) {
+  auto transaction = fs_manager->block_manager()->NewDeletionTransaction();
+  transaction->AddDeletedBlock(block_id);
+  vector<BlockId> deleted;
+  return transaction->CommitDeletedBlocks(&deleted);
+}
+
+// Returns the ordinal of the 'idx'-th value of 'distribution'. Ordinals are
+// then converted to values of the benchmarked type.
+uint64_t NextOrdinal(const string& distribution, int64_t idx, Random* rng) {
+  if (distribution == "sequential") {
+    return idx;
+  }
+  if (distribution == "random") {
+    return rng->Next64();
+  }
+  if (distribution == "low_cardinality") {
+    return rng->Uniform(16);
+  }
+  DCHECK_EQ("runs", distribution);
+  return idx / 64;
+}
+
+// Generates the values of a CFile of type 'Type'. Strings are backed by
+// 'string_storage'.
+template<DataType Type>
+struct ValueGenerator {
+  typedef typename TypeTraits<Type>::cpp_type cpp_type;
+  static cpp_type Convert(uint64_t ordinal, vector<string>* /* string_storage */) {
+    return static_cast<cpp_type>(ordinal);
+  }
+};
+
+template<>
+struct ValueGenerator<DOUBLE> {
+  static double Convert(uint64_t ordinal, vector<string>* /* string_storage */) {
+    return static_cast<double>(ordinal) / 7;
+  }
+};
+
+template<>
+struct ValueGenerator<BOOL> {
+  static bool Convert(uint64_t ordinal, vector<string>* /* string_storage */) {
+    return ordinal & 1;
+  }
+};
+
+template<>
+struct ValueGenerator<STRING> {
+  static Slice Convert(uint64_t ordinal, vector<string>* string_storage) {
+    // Fixed-width keys with a shared prefix, like the keys of many tables.
+    string_storage->emplace_back(StringPrintf("key-%016llx",
+                                              static_cast<unsigned long long>(ordinal)));
+    return Slice(string_storage->back());
+  }
+};
+
+template<DataType Type>
+class EncodingBenchmark {
+ public:
+  // Booleans are stored one per byte, as expected by the CFile writer.
+  typedef typename std::conditional<Type == BOOL, uint8_t,
+                                    typename TypeTraits<Type>::cpp_type>::type cpp_type;
+
+  EncodingBenchmark(FsManager* fs_manager, EncodingType encoding, string distribution)
+      : fs_manager_(fs_manager),
+        encoding_(encoding),
+        distribution_(std::move(distribution)) {
+  }
+
+  Status Run(const vector<int>& batch_sizes, BenchResult* result) {
+    GenerateValues();
+    result->num_rows = values_.size();
+    result->raw_bytes = RawBytes();
+
+    for (int i = 0; i < FLAGS_bench_iterations; i++) {
+      MonoDelta elapsed;
+      RETURN_NOT_OK(Write(&elapsed));
+      result->encode_rows_per_sec = std::max(result->encode_rows_per_sec,
+                                             values_.size() / elapsed.ToSeconds());
+    }
+
+    unique_ptr<ReadableBlock> rblock;
+    RETURN_NOT_OK(fs_manager_->OpenBlock(block_id_, &rblock));
+    unique_ptr<CFileReader> reader;
+    RETURN_NOT_OK(CFileReader::Open(std::move(rblock), ReaderOptions(), &reader));
+    result->encoded_bytes = reader->file_size();
+
+    const ColumnPredicate pred = MakePredicate();
+    for (int batch_size : batch_sizes) {
+      BenchResult::Decode decode = { batch_size, 0, 0, false };
+      for (int i = 0; i < FLAGS_bench_iterations; i++) {
+        MonoDelta elapsed;
+        RETURN_NOT_OK(Read(reader.get(), batch_size, nullptr, &elapsed, nullptr));
+        decode.rows_per_sec = std::max(decode.rows_per_sec,
+                                       values_.size() / elapsed.ToSeconds());
+        RETURN_NOT_OK(Read(reader.get(), batch_size, &pred, &elapsed, &decode.decoder_eval));
+        decode.eval_rows_per_sec = std::max(decode.eval_rows_per_sec,
+                                            values_.size() / elapsed.ToSeconds());
+      }
+      result->decodes.emplace_back(decode);
+    }
+    return DeleteBlock(fs_manager_, block_id_);
+  }
+
+ private:
+  void GenerateValues() {
+    // A fixed seed makes the results of runs comparable.
+    Random rng(0);
+    values_.reserve(FLAGS_bench_num_rows);
+    string_storage_.reserve(Type == STRING ? FLAGS_bench_num_rows : 0);
+    for (int64_t i = 0; i < FLAGS_bench_num_rows; i++) {
+      values_.emplace_back(ValueGenerator<Type>::Convert(
+          NextOrdinal(distribution_, i, &rng), &string_storage_));
+    }
+  }
+
+  int64_t RawBytes() const {
+    if (Type != STRING) {
+      return values_.size() * sizeof(cpp_type);
+    }
+    int64_t bytes = 0;
+    for (const auto& s : string_storage_) {
+      bytes += s.size();
+    }
+    return bytes;
+  }
+
+  // Returns a predicate which selects the values between the first and the
+  // third quartile.
+  ColumnPredicate MakePredicate() const {
+    vector<cpp_type> sorted(values_);
+    const TypeInfo* type_info = GetTypeInfo(Type);
+    std::sort(sorted.begin(), sorted.end(), [&](const cpp_type& a, const cpp_type& b) {
+      return type_info->Compare(&a, &b) < 0;
+    });
+    const cpp_type lower = sorted[sorted.size() / 4];
+    const cpp_type upper = sorted[sorted.size() * 3 / 4];
+    ColumnSchema col("c", Type);
+    return ColumnPredicate::Range(col, &lower, &upper);
+  }
+
+  // Writes the values to a new CFile, appending them in batches of the size
+  // of the compaction output blocks.
+  Status Write(MonoDelta* elapsed) {
+    if (!block_id_.IsNull()) {
+      RETURN_NOT_OK(DeleteBlock(fs_manager_, block_id_));
+    }
+    unique_ptr<WritableBlock> wblock;
+    RETURN_NOT_OK(fs_manager_->CreateNewBlock(fs::CreateBlockOptions({ kTabletId }), &wblock));
+    block_id_ = wblock->id();
+
+    WriterOptions opts;
+    opts.write_posidx = true;
+    opts.storage_attributes.encoding = encoding_;
+    opts.storage_attributes.compression = NO_COMPRESSION;
+    CFileWriter writer(opts, GetTypeInfo(Type), /*is_nullable=*/false, std::move(wblock));
+
+    const size_t kBatchSize = 100;
+    const MonoTime start = MonoTime::Now();
+    RETURN_NOT_OK(writer.Start());
+    for (size_t i = 0; i < values_.size(); i += kBatchSize) {
+      RETURN_NOT_OK(writer.AppendEntries(&values_[i], std::min(kBatchSize, values_.size() - i)));
+    }
+    RETURN_NOT_OK(writer.Finish());
+    *elapsed = MonoTime::Now() - start;
+    return Status::OK();
+  }
+
+  // Scans the CFile in batches of 'batch_size' rows. If 'pred' is set, it is
+  // evaluated, by the decoder if it supports it: 'decoder_eval' is set
+  // accordingly.
+  Status Read(CFileReader* reader, int batch_size, const ColumnPredicate* pred,
+              MonoDelta* elapsed, bool* decoder_eval) {
+    ScopedColumnBlock<Type> cb(batch_size, /*allow_nulls=*/false);
+    SelectionVector sel(batch_size);
+    size_t num_selected = 0;
+    bool evaluated_by_decoder = false;
+
+    const MonoTime start = MonoTime::Now();
+    unique_ptr<CFileIterator> iter;
+    RETURN_NOT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK, nullptr));
+    RETURN_NOT_OK(iter->SeekToOrdinal(0));
+    while (iter->HasNext()) {
+      size_t n = batch_size;
+      RETURN_NOT_OK(iter->PrepareBatch(&n));
+      sel.Resize(n);
+      sel.SetAllTrue();
+      ColumnBlock block(cb.type_info(), nullptr, cb.data(), n, cb.arena());
+      // Like the materializing iterator, use a new context for every batch.
+      ColumnMaterializationContext ctx(0, pred, &block, &sel);
+      RETURN_NOT_OK(iter->Scan(&ctx));
+      if (pred && ctx.DecoderEvalNotSupported()) {
+        pred->Evaluate(block, &sel);
+      }
+      evaluated_by_decoder = !ctx.DecoderEvalNotSupported();
+      num_selected += pred ? sel.CountSelected() : n;
+      RETURN_NOT_OK(iter->FinishBatch());
+      cb.arena()->Reset();
+    }
+    *elapsed = MonoTime::Now() - start;
+    if (decoder_eval) {
+      *decoder_eval = evaluated_by_decoder;
+    }
+    VLOG(1) << Substitute("read $0 rows, $1 selected", values_.size(), num_selected);
+    return Status::OK();
+  }
+
+  FsManager* const fs_manager_;
+  const EncodingType encoding_;
+  const string distribution_;
+
+  vector<cpp_type> values_;
+  vector<string> string_storage_;
+  BlockId block_id_;
+};
+
+Status RunBenchmark(FsManager* fs_manager, DataType type, EncodingType encoding,
+                    const string& distribution, const vector<int>& batch_sizes,
+                    BenchResult* result) {
+  switch (type) {
+    case INT32:
+      return EncodingBenchmark<INT32>(fs_manager, encoding, distribution).Run(
+          batch_sizes, result);
+    case INT64:
+      return EncodingBenchmark<INT64>(fs_manager, encoding, distribution).Run(
+          batch_sizes, result);
+    case DOUBLE:
+      return EncodingBenchmark<DOUBLE>(fs_manager, encoding, distribution).Run(
+          batch_sizes, result);
+    case STRING:
+      return EncodingBenchmark<STRING>(fs_manager, encoding, distribution).Run(
+          batch_sizes, result);
+    case BOOL:
+      return EncodingBenchmark<BOOL>(fs_manager, encoding, distribution).Run(
+          batch_sizes, result);
+    default:
+      LOG(FATAL) << "unexpected type " << DataType_Name(type);
+  }
+  return Status::OK();
+}
+
+void PrintResult(const BenchResult& r) {
+  for (const auto& d : r.decodes) {
+    std::cout << StringPrintf(
+        "%-7s %-11s %-16s %6d %8.2fx %10.2f %10.2f %10.2f %s",
+        r.type.c_str(), r.encoding.c_str(), r.distribution.c_str(), d.batch_size,
+        static_cast<double>(r.raw_bytes) / r.encoded_bytes,
+        r.encode_rows_per_sec / 1e6, d.rows_per_sec / 1e6, d.eval_rows_per_sec / 1e6,
+        d.decoder_eval ? "decoder" : "block")
+              << std::endl;
+  }
+}
+
+void ResultsToJson(const vector<BenchResult>& results, std::ostringstream* out) {
+  JsonWriter jw(out, JsonWriter::PRETTY);
+  jw.StartObject();
+  jw.String("num_rows");
+  jw.Int64(FLAGS_bench_num_rows);
+  jw.String("results");
+  jw.StartArray();
+  for (const auto& r : results) {
+    jw.StartObject();
+    jw.String("type");
+    jw.String(r.type);
+    jw.String("encoding");
+    jw.String(r.encoding);
+    jw.String("distribution");
+    jw.String(r.distribution);
+    jw.String("raw_bytes");
+    jw.Int64(r.raw_bytes);
+    jw.String("encoded_bytes");
+    jw.Int64(r.encoded_bytes);
+    jw.String("compression_ratio");
+    jw.Double(static_cast<double>(r.raw_bytes) / r.encoded_bytes);
+    jw.String("encode_rows_per_sec");
+    jw.Double(r.encode_rows_per_sec);
+    jw.String("decode");
+    jw.StartArray();
+    for (const auto& d : r.decodes) {
+      jw.StartObject();
+      jw.String("batch_size");
+      jw.Int(d.batch_size);
+      jw.String("rows_per_sec");
+      jw.Double(d.rows_per_sec);
+      jw.String("eval_rows_per_sec");
+      jw.Double(d.eval_rows_per_sec);
+      jw.String("decoder_eval");
+      jw.Bool(d.decoder_eval);
+      jw.EndObject();
+    }
+    jw.EndArray();
+    jw.EndObject();
+  }
+  jw.EndArray();
+  jw.EndObject();
+}
+
+Status RunBenchmarks() {
+  vector<string> type_names;
+  vector<string> encoding_names;
+  vector<string> distributions;
+  vector<string> batch_size_names;
+  RETURN_NOT_OK(ParseList("bench_types", FLAGS_bench_types, &type_names));
+  RETURN_NOT_OK(ParseList("bench_encodings", FLAGS_bench_encodings, &encoding_names));
+  RETURN_NOT_OK(ParseList("bench_distributions", FLAGS_bench_distributions, &distributions));
+  RETURN_NOT_OK(ParseList("bench_batch_sizes", FLAGS_bench_batch_sizes, &batch_size_names));
+  for (const auto& d : distributions) {
+    if (d != "sequential" && d != "random" && d != "low_cardinality" && d != "runs") {
+      return Status::InvalidArgument("unknown distribution", d);
+    }
+  }
+  vector<int> batch_sizes;
+  for (const auto& b : batch_size_names) {
+    int32_t batch_size;
+    if (!safe_strto32(b, &batch_size) || batch_size <= 0) {
+      return Status::InvalidArgument("invalid batch size", b);
+    }
+    batch_sizes.push_back(batch_size);
+  }
+  if (FLAGS_bench_num_rows <= 0 || FLAGS_bench_iterations <= 0) {
+    return Status::InvalidArgument("--bench_num_rows and --bench_iterations must be positive");
+  }
+
+  Env* env = Env::Default();
+  string fs_root = FLAGS_bench_fs_root;
+  bool delete_fs_root = false;
+  if (fs_root.empty()) {
+    string test_dir;
+    RETURN_NOT_OK(env->GetTestDirectory(&test_dir));
+    fs_root = JoinPathSegments(test_dir, Substitute("cfile-encoding-bench.$0", getpid()));
+    delete_fs_root = true;
+  }
+  FsManager fs_manager(env, fs_root);
+  RETURN_NOT_OK(fs_manager.CreateInitialFileSystemLayout());
+  RETURN_NOT_OK(fs_manager.Open());
+  RETURN_NOT_OK(fs_manager.dd_manager()->CreateDataDirGroup(kTabletId));
+
+  std::cout << StringPrintf("%-7s %-11s %-16s %6s %9s %10s %10s %10s %s",
+                            "type", "encoding", "distribution", "batch", "ratio",
+                            "enc Mr/s", "dec Mr/s", "eval Mr/s", "eval by")
+            << std::endl;
+  vector<BenchResult> results;
+  for (const auto& type_name : type_names) {
+    DataType type;
+    RETURN_NOT_OK(ParseType(type_name, &type));
+    for (const auto& encoding_name : encoding_names) {
+      EncodingType encoding;
+      RETURN_NOT_OK(ParseEncoding(encoding_name, &encoding));
+      const TypeEncodingInfo* info;
+      if (!TypeEncodingInfo::Get(GetTypeInfo(type), encoding, &info).ok()) {
+        continue;
+      }
+      for (const auto& distribution : distributions) {
+        BenchResult result;
+        result.type = type_name;
+        result.encoding = encoding_name;
+        result.distribution = distribution;
+        RETURN_NOT_OK_PREPEND(
+            RunBenchmark(&fs_manager, type, encoding, distribution, batch_sizes, &result),
+            Substitute("$0/$1/$2", type_name, encoding_name, distribution));
+        PrintResult(result);
+        results.emplace_back(std::move(result));
+      }
+    }
+  }
+
+  if (!FLAGS_json_output.empty()) {
+    std::ostringstream json;
+    ResultsToJson(results, &json);
+    std::ofstream out(FLAGS_json_output);
+    out << json.str() << std::endl;
+    if (!out.good()) {
+      return Status::IOError("unable to write results", FLAGS_json_output);
+    }
+  }
+  if (delete_fs_root) {
+    WARN_NOT_OK(env->DeleteRecursively(fs_root), "unable to delete " + fs_root);
+  }
+  return Status::OK();
+}
+
+} // anonymous namespace
+} // namespace kudu
+
+int main(int argc, char** argv) {
+  kudu::ParseCommandLineFlags(&argc, &argv, true);
+  kudu::InitGoogleLoggingSafe(argv[0]);
+
+  kudu::Status s = kudu::RunBenchmarks();
+  if (!s.ok()) {
+    LOG(ERROR) << s.ToString();
+    return 1;
+  }
+  return 0;
+}
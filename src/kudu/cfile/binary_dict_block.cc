@@ -278,10 +278,15 @@ Status BinaryDictBlockDecoder::CopyNextAndEval(size_t* n,
     return data_decoder_->CopyNextAndEval(n, ctx, sel, dst);
   }
 
-  // Predicates that have no matching words should return no data.
-  SelectionVector* codewords_matching_pred = parent_cfile_iter_->GetCodeWordsMatchingPredicate();
+  // The predicate has already been evaluated once against each dictionary
+  // entry, so rows are filtered by looking up their codewords.
+  const SelectionVector* codewords_matching_pred =
+      parent_cfile_iter_->GetCodeWordsMatchingPredicate();
   CHECK(codewords_matching_pred != nullptr);
-  if (!codewords_matching_pred->AnySelected()) {
+  const size_t num_matching_codewords = parent_cfile_iter_->NumCodeWordsMatchingPredicate();
+
+  // Predicates that have no matching words should return no data.
+  if (num_matching_codewords == 0) {
     // If nothing is selected, move the data_decoder_ pointer forward and clear
     // the corresponding bits in the selection vector.
     int skip = static_cast<int>(*n);
@@ -291,27 +296,29 @@ Status BinaryDictBlockDecoder::CopyNextAndEval(size_t* n,
     return Status::OK();
   }
 
-  // IsNotNull predicates should return all data.
-  if (ctx->pred()->predicate_type() == PredicateType::IsNotNull) {
-    return CopyNextDecodeStrings(n, dst);
-  }
-
   // Load the rows' codeword values into a buffer for scanning.
   BShufBlockDecoder<UINT32>* d_bptr = down_cast<BShufBlockDecoder<UINT32>*>(data_decoder_.get());
   codeword_buf_.resize(*n * sizeof(uint32_t));
-  d_bptr->CopyNextValuesToArray(n, codeword_buf_.data());
+  RETURN_NOT_OK(d_bptr->CopyNextValuesToArray(n, codeword_buf_.data()));
+  const uint32_t* codewords = reinterpret_cast<const uint32_t*>(codeword_buf_.data());
+
+  // If every codeword matches (e.g. for IsNotNull predicates), no rows need
+  // to be looked up, and only the rows that are still selected are copied.
+  const bool all_match = num_matching_codewords == codewords_matching_pred->nrows();
+  const uint8_t* matching_bitmap = codewords_matching_pred->bitmap();
   Slice* out = reinterpret_cast<Slice*>(dst->data());
   Arena* out_arena = dst->arena();
-  for (size_t i = 0; i < *n; i++, out++) {
+  for (size_t i = 0; i < *n; i++) {
     // Check with the SelectionVectorView to see whether the data has already
     // been cleared, in which case we can skip evaluation.
     if (!sel->TestBit(i)) {
       continue;
     }
-    uint32_t codeword = *reinterpret_cast<uint32_t*>(&codeword_buf_[i*sizeof(uint32_t)]);
-    if (BitmapTest(codewords_matching_pred->bitmap(), codeword)) {
-      // Row is included in predicate, copy data to block.
-      CHECK(out_arena->RelocateSlice(dict_decoder_->string_at_index(codeword), out));
+    uint32_t codeword = codewords[i];
+    if (all_match || BitmapTest(matching_bitmap, codeword)) {
+      // Row is included in predicate, copy data to block. Rows which don't
+      // match never have their strings materialized.
+      CHECK(out_arena->RelocateSlice(dict_decoder_->string_at_index(codeword), &out[i]));
     } else {
       // Mark that the row will not be returned.
       sel->ClearBit(i);
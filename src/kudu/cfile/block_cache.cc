@@ -19,23 +19,28 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <ostream>
 #include <string>
+#include <vector>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "kudu/cfile/secondary_block_cache.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/block_cache_metrics.h"
 #include "kudu/util/cache.h"
 #include "kudu/util/cache_metrics.h"
+#include "kudu/util/env.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/flag_validators.h"
 #include "kudu/util/process_memory.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/status.h"
 #include "kudu/util/string_case.h"
 
 DEFINE_int64(block_cache_capacity_mb, 512, "block cache capacity in MB");
@@ -57,6 +62,39 @@ DEFINE_string(block_cache_type, "DRAM",
               "in a memory-mapped file using the NVML library.");
 TAG_FLAG(block_cache_type, experimental);
 
+DEFINE_string(block_cache_eviction_policy, "LRU",
+              "Which eviction policy the block cache uses. Valid choices are "
+              "'LRU' or 'SLRU'. 'LRU', the default, evicts the least recently "
+              "used blocks. 'SLRU' (segmented LRU) evicts blocks which have "
+              "been used only once before those which have been used again, "
+              "so that large scans do not evict frequently used blocks such "
+              "as index and bloom filter blocks. 'SLRU' is only supported by "
+              "the DRAM block cache type.");
+TAG_FLAG(block_cache_eviction_policy, experimental);
+
+DEFINE_bool(block_cache_admission_filter, false,
+            "Whether the block cache admits a block read from disk only if it's "
+            "estimated to be used more often than the block it would evict, "
+            "based on how often the blocks were recently looked up (a.k.a. "
+            "TinyLFU). This keeps blocks which are read only once, e.g. by "
+            "compactions or checksum scans, from evicting frequently used ones. "
+            "Only supported by the DRAM block cache type.");
+TAG_FLAG(block_cache_admission_filter, experimental);
+
+DEFINE_string(block_cache_secondary_path, "",
+              "Path of a file, ideally on a local SSD, in which to keep a "
+              "secondary tier of the block cache. Blocks which miss the block "
+              "cache in memory are looked up there before being read from "
+              "their data directory, and blocks read from their data directory "
+              "are written there still compressed. The file is truncated on "
+              "startup. If empty, there is no secondary tier.");
+TAG_FLAG(block_cache_secondary_path, experimental);
+
+DEFINE_int64(block_cache_secondary_capacity_mb, 10240,
+             "Capacity in MB of the secondary tier of the block cache. Only "
+             "used if --block_cache_secondary_path is set.");
+TAG_FLAG(block_cache_secondary_capacity_mb, experimental);
+
 using strings::Substitute;
 
 template <class T> class scoped_refptr;
@@ -71,11 +109,19 @@ namespace {
 
 Cache* CreateCache(int64_t capacity) {
   const auto mem_type = BlockCache::GetConfiguredCacheMemoryTypeOrDie();
+  const auto eviction_policy = BlockCache::GetConfiguredCacheEvictionPolicyOrDie();
   switch (mem_type) {
     case Cache::MemoryType::DRAM:
+      if (eviction_policy == Cache::EvictionPolicy::SLRU) {
+        return NewCache<Cache::EvictionPolicy::SLRU, Cache::MemoryType::DRAM>(
+            capacity, "block_cache");
+      }
       return NewCache<Cache::EvictionPolicy::LRU, Cache::MemoryType::DRAM>(
           capacity, "block_cache");
     case Cache::MemoryType::NVM:
+      if (eviction_policy != Cache::EvictionPolicy::LRU) {
+        LOG(FATAL) << "cache of NVM memory type only supports the LRU eviction policy";
+      }
 #if defined(HAVE_LIB_VMEM)
       return NewCache<Cache::EvictionPolicy::LRU, Cache::MemoryType::NVM>(
           capacity, "block_cache");
@@ -90,6 +136,16 @@ Cache* CreateCache(int64_t capacity) {
 
 // Validates the block cache capacity won't permit the cache to grow large enough
 // to cause pernicious flushing behavior. See KUDU-2318.
+std::unique_ptr<SecondaryBlockCache> CreateSecondaryCacheOrDie() {
+  std::unique_ptr<SecondaryBlockCache> secondary_cache;
+  if (!FLAGS_block_cache_secondary_path.empty()) {
+    CHECK_OK(SecondaryBlockCache::Create(Env::Default(), FLAGS_block_cache_secondary_path,
+                                         FLAGS_block_cache_secondary_capacity_mb * 1024 * 1024,
+                                         &secondary_cache));
+  }
+  return secondary_cache;
+}
+
 bool ValidateBlockCacheCapacity() {
   if (FLAGS_force_block_cache_capacity) {
     return true;
@@ -134,12 +190,38 @@ Cache::MemoryType BlockCache::GetConfiguredCacheMemoryTypeOrDie() {
   __builtin_unreachable();
 }
 
+Cache::EvictionPolicy BlockCache::GetConfiguredCacheEvictionPolicyOrDie() {
+  ToUpperCase(FLAGS_block_cache_eviction_policy, &FLAGS_block_cache_eviction_policy);
+  if (FLAGS_block_cache_eviction_policy == "LRU") {
+    return Cache::EvictionPolicy::LRU;
+  }
+  if (FLAGS_block_cache_eviction_policy == "SLRU") {
+    return Cache::EvictionPolicy::SLRU;
+  }
+
+  LOG(FATAL) << "Unknown block cache eviction policy: '"
+             << FLAGS_block_cache_eviction_policy << "' (expected 'LRU' or 'SLRU')";
+  __builtin_unreachable();
+}
+
 BlockCache::BlockCache()
-  : BlockCache(FLAGS_block_cache_capacity_mb * 1024 * 1024) {
+  : BlockCache(FLAGS_block_cache_capacity_mb * 1024 * 1024, CreateSecondaryCacheOrDie()) {
 }
 
 BlockCache::BlockCache(size_t capacity)
-  : cache_(CreateCache(capacity)) {
+  : BlockCache(capacity, nullptr) {
+}
+
+BlockCache::BlockCache(size_t capacity,
+                       std::unique_ptr<SecondaryBlockCache> secondary_cache)
+  : cache_(CreateCache(capacity)),
+    secondary_cache_(std::move(secondary_cache)) {
+  if (FLAGS_block_cache_admission_filter) {
+    cache_->EnableAdmissionFilter();
+  }
+}
+
+BlockCache::~BlockCache() {
 }
 
 BlockCache::PendingEntry BlockCache::Allocate(const CacheKey& key, size_t block_size) {
@@ -157,15 +239,42 @@ bool BlockCache::Lookup(const CacheKey& key, Cache::CacheBehavior behavior,
   return h != nullptr;
 }
 
-void BlockCache::Insert(BlockCache::PendingEntry* entry, BlockCacheHandle* inserted) {
-  Cache::Handle *h = cache_->Insert(entry->handle_, /* eviction_callback= */ nullptr);
+void BlockCache::Insert(BlockCache::PendingEntry* entry, BlockCacheHandle* inserted,
+                        Cache::Priority priority) {
+  Cache::Handle *h = cache_->Insert(entry->handle_, /* eviction_callback= */ nullptr,
+                                    priority);
   entry->handle_ = nullptr;
   inserted->SetHandle(cache_.get(), h);
 }
 
+void BlockCache::GetHotKeys(size_t max_keys, std::vector<CacheKey>* keys) {
+  std::vector<std::string> key_strs;
+  cache_->GetHotKeys(max_keys, &key_strs);
+  for (const auto& key_str : key_strs) {
+    DCHECK_EQ(sizeof(CacheKey), key_str.size());
+    CacheKey key(FileId(), 0);
+    memcpy(&key, key_str.data(), sizeof(key));
+    keys->emplace_back(key);
+  }
+}
+
+bool BlockCache::LookupSecondary(const CacheKey& key, Slice result) {
+  DCHECK(secondary_cache_);
+  return secondary_cache_->Lookup(Slice(reinterpret_cast<const uint8_t*>(&key), sizeof(key)),
+                                  result);
+}
+
+void BlockCache::InsertSecondary(const CacheKey& key, const Slice& data) {
+  DCHECK(secondary_cache_);
+  secondary_cache_->Insert(Slice(reinterpret_cast<const uint8_t*>(&key), sizeof(key)), data);
+}
+
 void BlockCache::StartInstrumentation(const scoped_refptr<MetricEntity>& metric_entity) {
   std::unique_ptr<BlockCacheMetrics> metrics(new BlockCacheMetrics(metric_entity));
   cache_->SetMetrics(std::move(metrics));
+  if (secondary_cache_) {
+    secondary_cache_->StartInstrumentation(metric_entity);
+  }
 }
 
 } // namespace cfile
@@ -19,7 +19,9 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <utility>
+#include <vector>
 
 #include <gflags/gflags_declare.h>
 #include <glog/logging.h>
@@ -43,6 +45,7 @@ class MetricEntity;
 namespace cfile {
 
 class BlockCacheHandle;
+class SecondaryBlockCache;
 
 // Wrapper around kudu::Cache specifically for caching blocks of CFiles.
 // Provides a singleton and LRU cache for CFile blocks.
@@ -52,6 +55,10 @@ class BlockCache {
   // invalid.
   static Cache::MemoryType GetConfiguredCacheMemoryTypeOrDie();
 
+  // Parse the gflag which configures the block cache eviction policy. FATALs
+  // if the flag is invalid.
+  static Cache::EvictionPolicy GetConfiguredCacheEvictionPolicyOrDie();
+
   // BlockId refers to the unique identifier for a Kudu block, that is, for an
   // entire CFile. This is different than the block cache's notion of a block,
   // which is just a portion of a CFile.
@@ -123,6 +130,11 @@ class BlockCache {
 
   explicit BlockCache(size_t capacity);
 
+  // Creates a block cache with the given secondary tier, which may be null.
+  BlockCache(size_t capacity, std::unique_ptr<SecondaryBlockCache> secondary_cache);
+
+  ~BlockCache();
+
   // Lookup the given block in the cache.
   //
   // If the entry is found, then sets *handle to refer to the entry.
@@ -160,9 +172,35 @@ class BlockCache {
   // Allocate a new entry to be inserted into the cache.
   PendingEntry Allocate(const CacheKey& key, size_t block_size);
 
-  // Insert the given block into the cache. 'inserted' is set to refer to the
-  // entry in the cache.
-  void Insert(PendingEntry* entry, BlockCacheHandle* inserted);
+  // Insert the given block into the cache with the given priority. 'inserted'
+  // is set to refer to the entry in the cache.
+  void Insert(PendingEntry* entry, BlockCacheHandle* inserted,
+              Cache::Priority priority = Cache::Priority::NORMAL);
+
+  // Append to 'keys' the keys of up to 'max_keys' of the cached blocks most
+  // likely to be used again. See Cache::GetHotKeys().
+  void GetHotKeys(size_t max_keys, std::vector<CacheKey>* keys);
+
+  // Secondary tier
+  // --------------------
+  // If --block_cache_secondary_path is set, blocks are also cached in their
+  // on-disk form, i.e. before decompression, in a file on a local SSD. See
+  // SecondaryBlockCache for details. Blocks should be looked up there after
+  // missing the cache above, and inserted there when read from their file.
+
+  // Whether the block cache has a secondary tier.
+  bool has_secondary() const {
+    return secondary_cache_ != nullptr;
+  }
+
+  // Lookup the given block in the secondary tier, reading it into 'result'
+  // on a hit. The size of 'result' must match the size of the block on disk.
+  //
+  // Returns true to indicate that the block was found, false otherwise.
+  bool LookupSecondary(const CacheKey& key, Slice result);
+
+  // Insert the on-disk form of the given block into the secondary tier.
+  void InsertSecondary(const CacheKey& key, const Slice& data);
 
  private:
   friend class Singleton<BlockCache>;
@@ -171,6 +209,7 @@ class BlockCache {
   DISALLOW_COPY_AND_ASSIGN(BlockCache);
 
   gscoped_ptr<Cache> cache_;
+  std::unique_ptr<SecondaryBlockCache> secondary_cache_;
 };
 
 // Scoped reference to a block from the block cache.
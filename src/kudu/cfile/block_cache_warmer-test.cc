@@ -0,0 +1,111 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/cfile/block_cache_warmer.h"
+
+#include <memory>
+#include <utility>
+
+#include <gflags/gflags.h>
+#include <gflags/gflags_declare.h>
+#include <gtest/gtest.h>
+
+#include "kudu/cfile/block_cache.h"
+#include "kudu/cfile/block_pointer.h"
+#include "kudu/cfile/cfile-test-base.h"
+#include "kudu/cfile/cfile.pb.h"
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/cfile/index_btree.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/fs/block_id.h"
+#include "kudu/fs/block_manager.h"
+#include "kudu/fs/fs_manager.h"
+#include "kudu/util/cache.h"
+#include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/pb_util.h"
+#include "kudu/util/test_macros.h"
+
+DECLARE_int32(block_cache_warmup_rate_mb_per_sec);
+
+using std::unique_ptr;
+
+namespace kudu {
+namespace cfile {
+
+using fs::ReadableBlock;
+
+class BlockCacheWarmerTest : public CFileTestBase {};
+
+// Verify that the blocks whose keys were saved are read into the block
+// cache, and that the keys of missing files are skipped.
+TEST_F(BlockCacheWarmerTest, TestLoadAndSaveKeys) {
+  FLAGS_block_cache_warmup_rate_mb_per_sec = 0;
+  BlockId block_id;
+  UInt32DataGenerator<false> generator;
+  WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, 10000, SMALL_BLOCKSIZE, &block_id);
+
+  // Find the last data block of the file, which wasn't read yet.
+  unique_ptr<ReadableBlock> block;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+  unique_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+  unique_ptr<IndexTreeIterator> iter(
+      IndexTreeIterator::Create(nullptr, reader.get(), reader->posidx_root()));
+  ASSERT_OK(iter->SeekToFirst());
+  while (iter->HasNext()) {
+    ASSERT_OK(iter->Next());
+  }
+  const BlockPointer ptr = iter->GetCurrentBlockPointer();
+  BlockCache* cache = BlockCache::GetSingleton();
+  const BlockCache::CacheKey key(block_id, ptr.offset());
+  BlockCacheHandle handle;
+  ASSERT_FALSE(cache->Lookup(key, Cache::EXPECT_IN_CACHE, &handle));
+
+  BlockCacheKeysPB pb;
+  BlockCacheKeysPB::KeyPB* key_pb = pb.add_keys();
+  key_pb->set_block_id(block_id.id());
+  key_pb->set_offset(ptr.offset());
+  key_pb = pb.add_keys();
+  key_pb->set_block_id(block_id.id() + 1000);
+  key_pb->set_offset(0);
+  ASSERT_OK(pb_util::WritePBContainerToPath(env_, fs_manager_->GetBlockCacheKeysPath(), pb,
+                                            pb_util::OVERWRITE, pb_util::NO_SYNC));
+
+  BlockCacheWarmer warmer(fs_manager_.get(), cache);
+  ASSERT_OK(warmer.LoadBlocks());
+  ASSERT_TRUE(cache->Lookup(key, Cache::EXPECT_IN_CACHE, &handle));
+
+  // The cached block is among the saved keys.
+  ASSERT_OK(warmer.SaveKeys());
+  pb.Clear();
+  ASSERT_OK(pb_util::ReadPBContainerFromPath(env_, fs_manager_->GetBlockCacheKeysPath(), &pb));
+  bool found = false;
+  for (const auto& k : pb.keys()) {
+    found |= k.block_id() == block_id.id() && k.offset() == ptr.offset();
+  }
+  ASSERT_TRUE(found);
+}
+
+// Verify that a missing keys file isn't an error.
+TEST_F(BlockCacheWarmerTest, TestNoKeys) {
+  BlockCacheWarmer warmer(fs_manager_.get(), BlockCache::GetSingleton());
+  ASSERT_OK(warmer.LoadBlocks());
+}
+
+} // namespace cfile
+} // namespace kudu
@@ -0,0 +1,243 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/cfile/block_cache_warmer.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/cfile/block_cache.h"
+#include "kudu/cfile/block_handle.h"
+#include "kudu/cfile/block_pointer.h"
+#include "kudu/cfile/cfile.pb.h"
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/cfile/index_btree.h"
+#include "kudu/fs/block_id.h"
+#include "kudu/fs/block_manager.h"
+#include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/pb_util.h"
+#include "kudu/util/thread.h"
+
+DEFINE_bool(block_cache_warmup, false,
+            "Whether to save the keys of the blocks in the block cache "
+            "periodically and on shutdown, and to read these blocks back into "
+            "the block cache once the tablets are bootstrapped on startup.");
+TAG_FLAG(block_cache_warmup, experimental);
+
+DEFINE_int32(block_cache_keys_save_interval_secs, 600,
+             "How often to save the keys of the blocks in the block cache, "
+             "if --block_cache_warmup is enabled.");
+TAG_FLAG(block_cache_keys_save_interval_secs, experimental);
+
+DEFINE_int32(block_cache_keys_max_count, 65536,
+             "The maximum number of block keys to save for warming up the "
+             "block cache, if --block_cache_warmup is enabled.");
+TAG_FLAG(block_cache_keys_max_count, experimental);
+
+DEFINE_int32(block_cache_warmup_rate_mb_per_sec, 20,
+             "The maximum rate at which blocks are read into the block cache "
+             "when warming it up, in MB/s. 0 means unlimited.");
+TAG_FLAG(block_cache_warmup_rate_mb_per_sec, experimental);
+
+using kudu::fs::ReadableBlock;
+using std::map;
+using std::set;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace cfile {
+
+namespace {
+
+// Collects the offsets of the blocks of 'reader' found in 'offsets', along
+// with their pointers. The blocks of the index trees are read along the way.
+Status FindBlocks(const CFileReader* reader, const set<uint64_t>& offsets,
+                  vector<std::pair<BlockPointer, bool>>* found) {
+  auto add = [&](const BlockPointer& ptr, bool high_priority) {
+    if (ContainsKey(offsets, ptr.offset())) {
+      found->emplace_back(ptr, high_priority);
+    }
+  };
+  const CFileFooterPB& footer = reader->footer();
+  if (footer.has_dict_block_ptr()) {
+    add(BlockPointer(footer.dict_block_ptr()), true);
+  }
+  if (footer.has_zone_map_block_ptr()) {
+    add(BlockPointer(footer.zone_map_block_ptr()), true);
+  }
+  // The data blocks are found through the positional index, or through the
+  // value index of files without one.
+  BlockPointer root;
+  if (reader->has_posidx()) {
+    root = reader->posidx_root();
+  } else if (reader->has_validx()) {
+    root = reader->validx_root();
+  } else {
+    return Status::OK();
+  }
+  unique_ptr<IndexTreeIterator> iter(IndexTreeIterator::Create(nullptr, reader, root));
+  RETURN_NOT_OK(iter->SeekToFirst());
+  while (true) {
+    add(iter->GetCurrentBlockPointer(), false);
+    if (!iter->HasNext()) break;
+    RETURN_NOT_OK(iter->Next());
+  }
+  return Status::OK();
+}
+
+} // anonymous namespace
+
+BlockCacheWarmer::BlockCacheWarmer(FsManager* fs_manager, BlockCache* cache)
+    : fs_manager_(fs_manager),
+      cache_(cache),
+      shutdown_latch_(1),
+      warmed_up_(false) {
+}
+
+BlockCacheWarmer::~BlockCacheWarmer() {
+  Shutdown();
+}
+
+Status BlockCacheWarmer::Start(std::function<bool()> ready) {
+  ready_ = std::move(ready);
+  return Thread::Create("cfile", "block-cache-warmer", &BlockCacheWarmer::RunThread,
+                        this, &thread_);
+}
+
+void BlockCacheWarmer::Shutdown() {
+  if (!thread_) {
+    return;
+  }
+  shutdown_latch_.CountDown();
+  thread_->Join();
+  thread_.reset();
+  if (warmed_up_) {
+    WARN_NOT_OK(SaveKeys(), "could not save the keys of the block cache");
+  }
+}
+
+void BlockCacheWarmer::RunThread() {
+  const MonoDelta kPollInterval = MonoDelta::FromMilliseconds(100);
+  while (!ready_()) {
+    if (shutdown_latch_.WaitFor(kPollInterval)) {
+      return;
+    }
+  }
+  WARN_NOT_OK(LoadBlocks(), "could not warm up the block cache");
+  if (shutdown_latch_.count() == 0) {
+    // The warm-up was cut short.
+    return;
+  }
+  warmed_up_ = true;
+
+  while (!shutdown_latch_.WaitFor(
+      MonoDelta::FromSeconds(FLAGS_block_cache_keys_save_interval_secs))) {
+    WARN_NOT_OK(SaveKeys(), "could not save the keys of the block cache");
+  }
+}
+
+Status BlockCacheWarmer::SaveKeys() {
+  vector<BlockCache::CacheKey> keys;
+  cache_->GetHotKeys(FLAGS_block_cache_keys_max_count, &keys);
+  BlockCacheKeysPB pb;
+  for (const auto& key : keys) {
+    BlockCacheKeysPB::KeyPB* key_pb = pb.add_keys();
+    key_pb->set_block_id(key.file_id_);
+    key_pb->set_offset(key.offset_);
+  }
+  const string path = fs_manager_->GetBlockCacheKeysPath();
+  RETURN_NOT_OK_PREPEND(pb_util::WritePBContainerToPath(fs_manager_->env(), path, pb,
+                                                        pb_util::OVERWRITE, pb_util::NO_SYNC),
+                        Substitute("could not write $0", path));
+  VLOG(1) << Substitute("saved the keys of $0 blocks of the block cache", keys.size());
+  return Status::OK();
+}
+
+Status BlockCacheWarmer::LoadBlocks() {
+  const string path = fs_manager_->GetBlockCacheKeysPath();
+  BlockCacheKeysPB pb;
+  Status s = pb_util::ReadPBContainerFromPath(fs_manager_->env(), path, &pb);
+  if (s.IsNotFound()) {
+    return Status::OK();
+  }
+  RETURN_NOT_OK_PREPEND(s, Substitute("could not read $0", path));
+
+  // Read the blocks file by file, in offset order.
+  map<uint64_t, set<uint64_t>> offsets_by_id;
+  for (const auto& key_pb : pb.keys()) {
+    offsets_by_id[key_pb.block_id()].insert(key_pb.offset());
+  }
+
+  const int64_t rate = FLAGS_block_cache_warmup_rate_mb_per_sec * 1024 * 1024;
+  const MonoTime start = MonoTime::Now();
+  int64_t bytes_read = 0;
+  int num_blocks = 0;
+  for (const auto& e : offsets_by_id) {
+    const BlockId block_id(e.first);
+    unique_ptr<ReadableBlock> block;
+    s = fs_manager_->OpenBlock(block_id, &block);
+    if (s.IsNotFound()) {
+      // The block was deleted since the keys were saved.
+      continue;
+    }
+    RETURN_NOT_OK(s);
+    unique_ptr<CFileReader> reader;
+    RETURN_NOT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+
+    vector<std::pair<BlockPointer, bool>> ptrs;
+    RETURN_NOT_OK(FindBlocks(reader.get(), e.second, &ptrs));
+    for (const auto& ptr : ptrs) {
+      BlockHandle handle;
+      RETURN_NOT_OK(reader->ReadBlock(nullptr, ptr.first,
+                                      ptr.second ? CFileReader::CACHE_BLOCK_HIGH_PRIORITY
+                                                 : CFileReader::CACHE_BLOCK,
+                                      &handle));
+      bytes_read += ptr.first.size();
+      num_blocks++;
+      if (rate > 0) {
+        // Wait until the blocks read so far fit within the allowed rate.
+        const MonoTime deadline =
+            start + MonoDelta::FromSeconds(static_cast<double>(bytes_read) / rate);
+        if (shutdown_latch_.WaitUntil(deadline)) {
+          return Status::OK();
+        }
+      }
+    }
+  }
+  LOG(INFO) << Substitute("warmed up the block cache with $0 blocks ($1 bytes) in $2",
+                          num_blocks, bytes_read, (MonoTime::Now() - start).ToString());
+  return Status::OK();
+}
+
+} // namespace cfile
+} // namespace kudu
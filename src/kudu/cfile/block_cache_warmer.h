@@ -0,0 +1,84 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <functional>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class FsManager;
+class Thread;
+
+namespace cfile {
+
+class BlockCache;
+
+// Keeps the block cache warm across restarts of a server.
+//
+// The keys of the blocks in the block cache most likely to be used again are
+// periodically saved to a file in the metadata directory. When the server
+// starts, once its tablets are bootstrapped, the blocks are read back into
+// the block cache at a limited rate, so as not to compete with the
+// foreground workload for disk bandwidth.
+class BlockCacheWarmer {
+ public:
+  BlockCacheWarmer(FsManager* fs_manager, BlockCache* cache);
+  ~BlockCacheWarmer();
+
+  // Starts the background thread, which waits for 'ready' to return true
+  // before reading the saved blocks.
+  Status Start(std::function<bool()> ready);
+
+  // Stops the background thread, saving the keys of the cached blocks one
+  // last time if the warm-up had completed.
+  void Shutdown();
+
+  // Saves the keys of the hottest blocks of the block cache.
+  Status SaveKeys();
+
+  // Reads the blocks whose keys were saved into the block cache. Blocks
+  // which no longer exist are skipped.
+  Status LoadBlocks();
+
+ private:
+  void RunThread();
+
+  FsManager* fs_manager_;
+  BlockCache* cache_;
+
+  // Returns true once the saved blocks may be read.
+  std::function<bool()> ready_;
+
+  // Counted down when shutting down.
+  CountDownLatch shutdown_latch_;
+
+  // Whether the saved blocks were read. Until then, saving the keys would
+  // overwrite those of the previous run with those of a cold cache.
+  bool warmed_up_;
+
+  scoped_refptr<Thread> thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(BlockCacheWarmer);
+};
+
+} // namespace cfile
+} // namespace kudu
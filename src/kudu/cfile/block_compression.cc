@@ -27,6 +27,7 @@
 #include "kudu/util/coding.h"
 #include "kudu/util/coding-inl.h"
 #include "kudu/util/compression/compression_codec.h"
+#include "kudu/util/crc.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 
@@ -178,7 +179,7 @@ Status CompressedBlockDecoder::UncompressIntoBuffer(uint8_t* dst) {
 
   Slice compressed = data_;
   compressed.remove_prefix(header_length());
-  if (uncompressed_size_ == compressed.size() && cfile_version_ > 1) {
+  if (is_stored_uncompressed()) {
     // TODO(perf): we could potentially avoid this memcpy and instead
     // just use the data in place. However, it's a bit tricky, since the
     // block cache expects that the stored pointer for the block is at
@@ -193,5 +194,18 @@ Status CompressedBlockDecoder::UncompressIntoBuffer(uint8_t* dst) {
   return Status::OK();
 }
 
+bool CompressedBlockDecoder::is_stored_uncompressed() const {
+  DCHECK_GE(uncompressed_size_, 0) << "must Init()";
+  return cfile_version_ > 1 &&
+      uncompressed_size_ == static_cast<int>(data_.size() - header_length());
+}
+
+void CompressedBlockDecoder::CopyIntoBufferWithChecksum(uint8_t* dst, uint32_t* checksum) {
+  DCHECK(is_stored_uncompressed());
+  *checksum = crc::Crc32c(data_.data(), header_length(), *checksum);
+  *checksum = crc::Crc32cCopy(dst, data_.data() + header_length(), uncompressed_size_,
+                              *checksum);
+}
+
 } // namespace cfile
 } // namespace kudu
@@ -114,6 +114,21 @@ class CompressedBlockDecoder {
   // REQUIRES: Init() has been called and returned successfully.
   // REQUIRES: !block_skipped()
   Status UncompressIntoBuffer(uint8_t* dst);
+
+  // Returns true if the block holds its data as-is because compression was
+  // not effective when it was written, in which case UncompressIntoBuffer()
+  // amounts to a copy.
+  //
+  // REQUIRES: Init() has been called and returned successfully.
+  bool is_stored_uncompressed() const;
+
+  // Like UncompressIntoBuffer(), but also extends '*checksum' with the CRC32C
+  // of the whole block (header included), computed while the data is copied
+  // rather than in a separate pass.
+  //
+  // REQUIRES: is_stored_uncompressed()
+  void CopyIntoBufferWithChecksum(uint8_t* dst, uint32_t* checksum);
+
  private:
   DISALLOW_COPY_AND_ASSIGN(CompressedBlockDecoder);
 
@@ -38,9 +38,19 @@ class BlockHandle {
     return BlockHandle(handle);
   }
 
+  // The data isn't freed by the handle, e.g. because it's in a memory mapping
+  // of the file which outlives the handle.
+  static BlockHandle WithBorrowedData(const Slice& data) {
+    BlockHandle handle;
+    handle.data_ = data;
+    handle.is_data_borrowed_ = true;
+    return handle;
+  }
+
   // Constructor to use to Pass to.
   BlockHandle()
-    : is_data_owner_(false) { }
+    : is_data_owner_(false),
+      is_data_borrowed_(false) { }
 
   // Move constructor and assignment
   BlockHandle(BlockHandle&& other) noexcept {
@@ -56,7 +66,7 @@ class BlockHandle {
   }
 
   Slice data() const {
-    if (is_data_owner_) {
+    if (is_data_owner_ || is_data_borrowed_) {
       return data_;
     } else {
       return dblk_data_.data();
@@ -67,14 +77,17 @@ class BlockHandle {
   BlockCacheHandle dblk_data_;
   Slice data_;
   bool is_data_owner_;
+  bool is_data_borrowed_;
 
   explicit BlockHandle(Slice data)
       : data_(data),
-        is_data_owner_(true) {
+        is_data_owner_(true),
+        is_data_borrowed_(false) {
   }
 
   explicit BlockHandle(BlockCacheHandle *dblk_data)
-    : is_data_owner_(false) {
+    : is_data_owner_(false),
+      is_data_borrowed_(false) {
     dblk_data_.swap(dblk_data);
   }
 
@@ -82,9 +95,11 @@ class BlockHandle {
     Reset();
 
     is_data_owner_ = other->is_data_owner_;
-    if (is_data_owner_) {
+    is_data_borrowed_ = other->is_data_borrowed_;
+    if (is_data_owner_ || is_data_borrowed_) {
       data_ = other->data_;
       other->is_data_owner_ = false;
+      other->is_data_borrowed_ = false;
     } else {
       dblk_data_.swap(&other->dblk_data_);
     }
@@ -95,6 +110,7 @@ class BlockHandle {
       delete [] data_.data();
       is_data_owner_ = false;
     }
+    is_data_borrowed_ = false;
     data_ = "";
   }
 
@@ -34,6 +34,8 @@
 DEFINE_int32(bloom_size_bytes, 4*1024, "Size of each bloom filter");
 DEFINE_int32(n_keys, 10*1000, "Number of keys to insert into the file");
 DEFINE_double(fp_rate, 0.01f, "False positive rate to aim for");
+DEFINE_string(bloom_type, "classic",
+              "The type of filters to write: 'classic', 'split_block' or 'xor'");
 
 DEFINE_int64(benchmark_queries, 1000000, "Number of probes to benchmark");
 DEFINE_bool(benchmark_should_hit, false, "Set to true for the benchmark to query rows which match");
@@ -67,6 +69,17 @@ class BloomFileTestBase : public KuduTest {
     }
   }
 
+  static BloomFilterType FilterType() {
+    if (FLAGS_bloom_type == "split_block") {
+      return BloomFilterType::SPLIT_BLOCK;
+    }
+    if (FLAGS_bloom_type == "xor") {
+      return BloomFilterType::XOR;
+    }
+    CHECK_EQ("classic", FLAGS_bloom_type);
+    return BloomFilterType::CLASSIC;
+  }
+
   void WriteTestBloomFile() {
     std::unique_ptr<fs::WritableBlock> sink;
     ASSERT_OK(fs_manager_->CreateNewBlock({}, &sink));
@@ -74,7 +87,8 @@ class BloomFileTestBase : public KuduTest {
 
     // Set sizing based on flags
     BloomFilterSizing sizing = BloomFilterSizing::BySizeAndFPRate(
-      FLAGS_bloom_size_bytes, FLAGS_fp_rate);
+      FLAGS_bloom_size_bytes, FLAGS_fp_rate,
+      FilterType());
     ASSERT_NEAR(sizing.n_bytes(), FLAGS_bloom_size_bytes, FLAGS_bloom_size_bytes * 0.05);
     ASSERT_GT(FLAGS_n_keys, sizing.expected_count())
       << "Invalid parameters: --n_keys isn't set large enough to fill even "
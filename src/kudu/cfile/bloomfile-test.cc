@@ -20,6 +20,7 @@
 #include <memory>
 #include <ostream>
 #include <utility>
+#include <vector>
 
 #include <glog/logging.h>
 #include <gtest/gtest.h>
@@ -37,6 +38,7 @@
 #include "kudu/util/test_macros.h"
 
 using std::shared_ptr;
+using std::vector;
 
 namespace kudu {
 namespace cfile {
@@ -86,6 +88,49 @@ TEST_F(BloomFileTest, TestWriteAndRead) {
   VerifyBloomFile();
 }
 
+TEST_F(BloomFileTest, TestWriteAndReadSplitBlock) {
+  FLAGS_bloom_type = "split_block";
+  ASSERT_NO_FATAL_FAILURE(WriteTestBloomFile());
+  ASSERT_OK(OpenBloomFile());
+  VerifyBloomFile();
+}
+
+TEST_F(BloomFileTest, TestWriteAndReadXor) {
+  FLAGS_bloom_type = "xor";
+  ASSERT_NO_FATAL_FAILURE(WriteTestBloomFile());
+  ASSERT_OK(OpenBloomFile());
+  VerifyBloomFile();
+}
+
+// Verify that batched probes give the same results as probing each key,
+// for keys spanning all the bloom blocks, present or not.
+TEST_F(BloomFileTest, TestBatchedProbes) {
+  ASSERT_NO_FATAL_FAILURE(WriteTestBloomFile());
+  ASSERT_OK(OpenBloomFile());
+
+  const uint64_t kNumProbes = (FLAGS_n_keys << kKeyShift) / 3;
+  vector<uint64_t> keys(kNumProbes);
+  vector<BloomKeyProbe> probes(kNumProbes);
+  vector<const BloomKeyProbe*> probe_ptrs(kNumProbes);
+  for (uint64_t i = 0; i < kNumProbes; i++) {
+    keys[i] = BigEndian::FromHost64(i * 3);
+    probes[i] = BloomKeyProbe(Slice(reinterpret_cast<uint8_t*>(&keys[i]), sizeof(keys[i])));
+    probe_ptrs[i] = &probes[i];
+  }
+  vector<bool> maybe_present;
+  ASSERT_OK(bfr_->CheckKeysPresent(probe_ptrs, nullptr, &maybe_present));
+  ASSERT_EQ(kNumProbes, maybe_present.size());
+
+  for (uint64_t i = 0; i < kNumProbes; i++) {
+    bool present;
+    ASSERT_OK_FAST(bfr_->CheckKeyPresent(probes[i], nullptr, &present));
+    ASSERT_EQ(present, maybe_present[i]) << "probe " << i;
+    if ((i * 3) % (1 << kKeyShift) == 0) {
+      ASSERT_TRUE(present) << "probe " << i;
+    }
+  }
+}
+
 #ifdef NDEBUG
 TEST_F(BloomFileTest, Benchmark) {
   ASSERT_NO_FATAL_FAILURE(WriteTestBloomFile());
@@ -16,6 +16,7 @@
 // under the License.
 #include "kudu/cfile/bloomfile.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <ostream>
 #include <string>
@@ -64,8 +65,6 @@ using fs::WritableBlock;
 // Generator for BloomFileReader::instance_nonce_.
 static Atomic64 g_next_nonce = 0;
 
-namespace {
-
 // Frequently, a thread processing a batch of operations will consult the same BloomFile
 // many times in a row. So, we keep a thread-local cache of the state for recently-accessed
 // BloomFileReaders so that we can avoid doing repetitive work.
@@ -88,6 +87,8 @@ class BloomCacheItem {
  private:
   DISALLOW_COPY_AND_ASSIGN(BloomCacheItem);
 };
+
+namespace {
 using BloomCacheTLC = ThreadLocalCache<uint64_t, BloomCacheItem>;
 } // anonymous namespace
 
@@ -97,7 +98,13 @@ using BloomCacheTLC = ThreadLocalCache<uint64_t, BloomCacheItem>;
 
 BloomFileWriter::BloomFileWriter(unique_ptr<WritableBlock> block,
                                  const BloomFilterSizing &sizing)
-  : bloom_builder_(sizing) {
+  : expected_count_(sizing.expected_count()) {
+  if (sizing.type() == BloomFilterType::XOR) {
+    xor_builder_.reset(new XorFilterBuilder(
+        XorFilter::FingerprintBitsForSize(sizing.n_bytes(), sizing.expected_count())));
+  } else {
+    bloom_builder_.reset(new BloomFilterBuilder(sizing));
+  }
   cfile::WriterOptions opts;
   opts.write_posidx = false;
   opts.write_validx = true;
@@ -105,6 +112,11 @@ BloomFileWriter::BloomFileWriter(unique_ptr<WritableBlock> block,
   // bloom filters are high-entropy data structures by their nature.
   opts.storage_attributes.encoding  = PLAIN_ENCODING;
   opts.storage_attributes.compression = NO_COMPRESSION;
+  if (sizing.type() == BloomFilterType::SPLIT_BLOCK) {
+    opts.incompatible_features |= IncompatibleFeatures::SPLIT_BLOCK_BLOOM;
+  } else if (sizing.type() == BloomFilterType::XOR) {
+    opts.incompatible_features |= IncompatibleFeatures::XOR_FILTER;
+  }
   writer_.reset(new cfile::CFileWriter(std::move(opts),
                                        GetTypeInfo(BINARY),
                                        false,
@@ -123,7 +135,7 @@ Status BloomFileWriter::Finish() {
 }
 
 Status BloomFileWriter::FinishAndReleaseBlock(BlockCreationTransaction* transaction) {
-  if (bloom_builder_.count() > 0) {
+  if (count() > 0) {
     RETURN_NOT_OK(FinishCurrentBloomBlock());
   }
   return writer_->FinishAndReleaseBlock(transaction);
@@ -137,16 +149,27 @@ Status BloomFileWriter::AppendKeys(
   const Slice *keys, size_t n_keys) {
 
   // If this is the call on a new bloom, copy the first key.
-  if (bloom_builder_.count() == 0 && n_keys > 0) {
+  if (count() == 0 && n_keys > 0) {
     first_key_.assign_copy(keys[0].data(), keys[0].size());
   }
 
+  // The keys are hashed a batch at a time, ahead of being added.
+  constexpr size_t kBatchSize = 64;
+  BloomKeyProbe probes[kBatchSize];
   for (size_t i = 0; i < n_keys; i++) {
-
-    bloom_builder_.AddKey(BloomKeyProbe(keys[i]));
+    if (i % kBatchSize == 0) {
+      BloomKeyProbe::ComputeProbes(keys + i, std::min(kBatchSize, n_keys - i),
+                                   CITY_HASH, probes);
+    }
+    const BloomKeyProbe& probe = probes[i % kBatchSize];
+    if (bloom_builder_) {
+      bloom_builder_->AddKey(probe);
+    } else {
+      xor_builder_->AddKey(probe.hash64());
+    }
 
     // Bloom has reached optimal occupancy: flush it to the file
-    if (PREDICT_FALSE(bloom_builder_.count() >= bloom_builder_.expected_count())) {
+    if (PREDICT_FALSE(count() >= expected_count_)) {
       RETURN_NOT_OK(FinishCurrentBloomBlock());
 
       // Update the last key and set the next key as the first key of the next block.
@@ -168,7 +191,20 @@ Status BloomFileWriter::FinishCurrentBloomBlock() {
 
   // Encode the header.
   BloomBlockHeaderPB hdr;
-  hdr.set_num_hash_functions(bloom_builder_.n_hashes());
+  Slice filter;
+  if (bloom_builder_) {
+    hdr.set_num_hash_functions(bloom_builder_->n_hashes());
+    if (bloom_builder_->type() == BloomFilterType::SPLIT_BLOCK) {
+      hdr.set_type(BloomBlockHeaderPB::SPLIT_BLOCK);
+    }
+    filter = bloom_builder_->slice();
+  } else {
+    // The keys of the block are all known by now, so the filter is built.
+    RETURN_NOT_OK(xor_builder_->Build(&xor_data_));
+    hdr.set_num_hash_functions(0);
+    hdr.set_type(BloomBlockHeaderPB::XOR);
+    filter = Slice(xor_data_);
+  }
   faststring hdr_str;
   PutFixed32(&hdr_str, hdr.ByteSize());
   pb_util::AppendToString(hdr, &hdr_str);
@@ -176,14 +212,18 @@ Status BloomFileWriter::FinishCurrentBloomBlock() {
   // The data is the concatenation of the header and the bloom itself.
   vector<Slice> slices;
   slices.emplace_back(hdr_str);
-  slices.push_back(bloom_builder_.slice());
+  slices.push_back(filter);
 
   // Append to the file.
   Slice start_key(first_key_);
   Slice last_key(last_key_);
   RETURN_NOT_OK(writer_->AppendRawBlock(slices, 0, &start_key, last_key, "bloom block"));
 
-  bloom_builder_.Clear();
+  if (bloom_builder_) {
+    bloom_builder_->Clear();
+  } else {
+    xor_builder_->Clear();
+  }
 
   #ifndef NDEBUG
   first_key_.assign_copy("POST_RESET");
@@ -281,15 +321,16 @@ Status BloomFileReader::ParseBlockHeader(const Slice& block,
   }
 
   data.remove_prefix(header_len);
+  if (PREDICT_FALSE(hdr->type() == BloomBlockHeaderPB::SPLIT_BLOCK &&
+                    (data.empty() || data.size() % SplitBloomBlock::kBytes != 0))) {
+    return Status::Corruption(
+      StringPrintf("Invalid split-block bloom filter size %ld", data.size()));
+  }
   *bloom_data = data;
   return Status::OK();
 }
 
-Status BloomFileReader::CheckKeyPresent(const BloomKeyProbe &probe,
-                                        const IOContext* io_context,
-                                        bool *maybe_present) {
-  DCHECK(init_once_.init_succeeded());
-
+BloomCacheItem* BloomFileReader::GetCacheItem(const IOContext* io_context) {
   // Since we frequently will access the same BloomFile many times in a row
   // when processing a batch of operations, we put our state in a small thread-local
   // cache, keyed by the BloomFileReader's nonce. We use this nonce rather than
@@ -304,12 +345,18 @@ Status BloomFileReader::CheckKeyPresent(const BloomKeyProbe &probe,
   }
   DCHECK_EQ(reader_.get(), bci->index_iter.cfile_reader())
       << "Cached index reader does not match expected instance";
+  return bci;
+}
 
+Status BloomFileReader::SeekToBloomBlock(BloomCacheItem* bci,
+                                         const IOContext* io_context,
+                                         const Slice& key,
+                                         bool* found) {
   IndexTreeIterator* index_iter = &bci->index_iter;
-  Status s = index_iter->SeekAtOrBefore(probe.key());
+  Status s = index_iter->SeekAtOrBefore(key);
   if (PREDICT_FALSE(s.IsNotFound())) {
     // Seek to before the first entry in the file.
-    *maybe_present = false;
+    *found = false;
     return Status::OK();
   }
   RETURN_NOT_OK(s);
@@ -323,7 +370,8 @@ Status BloomFileReader::CheckKeyPresent(const BloomKeyProbe &probe,
   if (!bci->cur_block_pointer.Equals(bblk_ptr)) {
     BlockHandle dblk_data;
     RETURN_NOT_OK(reader_->ReadBlock(io_context, bblk_ptr,
-                                     CFileReader::CACHE_BLOCK, &dblk_data));
+                                     CFileReader::CACHE_BLOCK_HIGH_PRIORITY,
+                                     &dblk_data));
 
     // Parse the header in the block.
     BloomBlockHeaderPB hdr;
@@ -331,13 +379,77 @@ Status BloomFileReader::CheckKeyPresent(const BloomKeyProbe &probe,
     RETURN_NOT_OK(ParseBlockHeader(dblk_data.data(), &hdr, &bloom_data));
 
     // Save the data back into our threadlocal cache.
-    bci->cur_bloom = BloomFilter(bloom_data, hdr.num_hash_functions());
+    if (hdr.type() == BloomBlockHeaderPB::XOR) {
+      XorFilter xor_filter;
+      RETURN_NOT_OK_PREPEND(XorFilter::Parse(bloom_data, &xor_filter),
+                            "Invalid bloom block");
+      bci->cur_bloom = BloomFilter(xor_filter);
+    } else {
+      bci->cur_bloom = BloomFilter(bloom_data, hdr.num_hash_functions(),
+                                   hdr.type() == BloomBlockHeaderPB::SPLIT_BLOCK ?
+                                   BloomFilterType::SPLIT_BLOCK : BloomFilterType::CLASSIC);
+    }
     bci->cur_block_pointer = bblk_ptr;
     bci->cur_block_handle = std::move(dblk_data);
   }
+  *found = true;
+  return Status::OK();
+}
+
+Status BloomFileReader::CheckKeyPresent(const BloomKeyProbe &probe,
+                                        const IOContext* io_context,
+                                        bool *maybe_present) {
+  DCHECK(init_once_.init_succeeded());
+  BloomCacheItem* bci = GetCacheItem(io_context);
+  bool found;
+  RETURN_NOT_OK(SeekToBloomBlock(bci, io_context, probe.key(), &found));
 
   // Actually check the bloom filter.
-  *maybe_present = bci->cur_bloom.MayContainKey(probe);
+  *maybe_present = found && bci->cur_bloom.MayContainKey(probe);
+  return Status::OK();
+}
+
+Status BloomFileReader::CheckKeysPresent(const vector<const BloomKeyProbe*>& probes,
+                                         const IOContext* io_context,
+                                         vector<bool>* maybe_present) {
+  DCHECK(init_once_.init_succeeded());
+  BloomCacheItem* bci = GetCacheItem(io_context);
+  maybe_present->assign(probes.size(), false);
+
+  faststring next_block_key;
+  size_t i = 0;
+  while (i < probes.size()) {
+    bool found;
+    RETURN_NOT_OK(SeekToBloomBlock(bci, io_context, probes[i]->key(), &found));
+    if (!found) {
+      i++;
+      continue;
+    }
+
+    // The keys up to the first key of the next block fall into this block.
+    size_t end = probes.size();
+    IndexTreeIterator* index_iter = &bci->index_iter;
+    if (index_iter->HasNext()) {
+      RETURN_NOT_OK(index_iter->Next());
+      next_block_key.assign_copy(index_iter->GetCurrentKey().data(),
+                                 index_iter->GetCurrentKey().size());
+      for (end = i + 1; end < probes.size(); end++) {
+        if (probes[end]->key().compare(Slice(next_block_key)) >= 0) {
+          break;
+        }
+      }
+    }
+
+    // Prefetch the filter for all the keys of the block before checking any
+    // of them, so that their cache misses overlap.
+    const BloomFilter& bloom = bci->cur_bloom;
+    for (size_t j = i; j < end; j++) {
+      bloom.Prefetch(*probes[j]);
+    }
+    for (; i < end; i++) {
+      (*maybe_present)[i] = bloom.MayContainKey(*probes[i]);
+    }
+  }
   return Status::OK();
 }
 
@@ -20,6 +20,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 #include "kudu/cfile/cfile_reader.h"
 #include "kudu/cfile/cfile_writer.h"
@@ -30,6 +31,7 @@
 #include "kudu/util/once.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
+#include "kudu/util/xor_filter.h"
 
 namespace kudu {
 
@@ -43,6 +45,7 @@ class WritableBlock;
 namespace cfile {
 
 class BloomBlockHeaderPB;
+class BloomCacheItem;
 struct ReaderOptions;
 
 class BloomFileWriter {
@@ -68,9 +71,23 @@ class BloomFileWriter {
 
   Status FinishCurrentBloomBlock();
 
+  // Return the number of keys added to the current block.
+  size_t count() const {
+    return bloom_builder_ ? bloom_builder_->count() : xor_builder_->count();
+  }
+
   std::unique_ptr<cfile::CFileWriter> writer_;
 
-  BloomFilterBuilder bloom_builder_;
+  // The builder of the current block, depending on the type of filter.
+  // Exactly one of them is set.
+  std::unique_ptr<BloomFilterBuilder> bloom_builder_;
+  std::unique_ptr<XorFilterBuilder> xor_builder_;
+
+  // The number of keys per block.
+  const size_t expected_count_;
+
+  // The current block, if it's a xor filter.
+  faststring xor_data_;
 
   // first key inserted in the current block.
   faststring first_key_;
@@ -117,6 +134,15 @@ class BloomFileReader {
                          const fs::IOContext* io_context,
                          bool* maybe_present);
 
+  // Check if each of the given keys may be present in the file, like
+  // CheckKeyPresent(), setting (*maybe_present)[i] for probes[i].
+  //
+  // The probes of the keys falling into the same bloom block are issued
+  // together, so the keys should be sorted in increasing order.
+  Status CheckKeysPresent(const std::vector<const BloomKeyProbe*>& probes,
+                          const fs::IOContext* io_context,
+                          std::vector<bool>* maybe_present);
+
   // Can be called before Init().
   uint64_t FileSize() const {
     return reader_->file_size();
@@ -136,6 +162,17 @@ class BloomFileReader {
                           BloomBlockHeaderPB* hdr,
                           Slice* bloom_data) const;
 
+  // Returns the state of this reader cached by the calling thread.
+  BloomCacheItem* GetCacheItem(const fs::IOContext* io_context);
+
+  // Seeks the index of the cached state 'bci' to the bloom block which may
+  // contain 'key', and reads that block unless it was the last one read.
+  // Sets *found to false if the key sorts before the first block.
+  Status SeekToBloomBlock(BloomCacheItem* bci,
+                          const fs::IOContext* io_context,
+                          const Slice& key,
+                          bool* found);
+
   // Callback used in 'init_once_' to initialize this bloom file.
   Status InitOnce(const fs::IOContext* io_context);
 
@@ -90,6 +90,7 @@ Slice BShufBlockBuilder<UINT32>::Finish(rowid_t ordinal_pos) {
 // Template specialization for UINT32.
 template<>
 Status BShufBlockDecoder<UINT32>::SeekAtOrAfterValue(const void* value_void, bool* exact) {
+  RETURN_NOT_OK(Expand());
   uint32_t target = *reinterpret_cast<const uint32_t*>(value_void);
   int32_t left = 0;
   int32_t right = num_elems_;
@@ -142,6 +143,8 @@ Status BShufBlockDecoder<UINT32>::CopyNextValuesToArray(size_t* n, uint8_t* arra
     return Status::OK();
   }
 
+  RETURN_NOT_OK(Expand());
+
   // First, copy it to the destination array without any "expansion".
   size_t max_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
   memcpy(array, &decoded_[cur_idx_ * size_of_elem_], max_fetch * size_of_elem_);
@@ -235,7 +235,8 @@ class BShufBlockDecoder final : public BlockDecoder {
         num_elems_(0),
         compressed_size_(0),
         num_elems_after_padding_(0),
-        cur_idx_(0) {
+        cur_idx_(0),
+        expanded_(false) {
   }
 
   Status ParseHeader() OVERRIDE {
@@ -279,8 +280,6 @@ class BShufBlockDecoder final : public BlockDecoder {
                                                     size_of_elem_, size_of_type));
     }
 
-    RETURN_NOT_OK(Expand());
-
     parsed_ = true;
     return Status::OK();
   }
@@ -297,6 +296,7 @@ class BShufBlockDecoder final : public BlockDecoder {
   }
 
   Status SeekAtOrAfterValue(const void* value_void, bool* exact) OVERRIDE {
+    RETURN_NOT_OK(Expand());
     CppType target = UnalignedLoad<CppType>(value_void);
     int32_t left = 0;
     int32_t right = num_elems_;
@@ -325,6 +325,17 @@ class BShufBlockDecoder final : public BlockDecoder {
 
   Status CopyNextValues(size_t* n, ColumnDataView* dst) OVERRIDE {
     DCHECK_EQ(dst->stride(), sizeof(CppType));
+    // If the whole block is requested and the destination has room for the
+    // padding elements, un-shuffle straight into the destination rather than
+    // through 'decoded_'. The padding lands in rows past the copied ones,
+    // which the caller hasn't filled yet.
+    if (!expanded_ && cur_idx_ == 0 && num_elems_ > 0 && *n >= num_elems_ &&
+        size_of_elem_ == size_of_type && dst->nrows() >= num_elems_after_padding_) {
+      RETURN_NOT_OK(Decompress(dst->data()));
+      *n = num_elems_;
+      cur_idx_ = num_elems_;
+      return Status::OK();
+    }
     return CopyNextValuesToArray(n, dst->data());
   }
 
@@ -340,6 +351,7 @@ class BShufBlockDecoder final : public BlockDecoder {
       return Status::OK();
     }
 
+    RETURN_NOT_OK(Expand());
     size_t max_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
     memcpy(array, &decoded_[cur_idx_ * size_of_type], max_fetch * size_of_type);
 
@@ -374,18 +386,31 @@ class BShufBlockDecoder final : public BlockDecoder {
     return result;
   }
 
+  // Un-shuffles the block into 'decoded_', unless already done. This is
+  // deferred until the values are first needed, so that blocks which are
+  // un-shuffled straight into a destination never allocate 'decoded_'.
   Status Expand() {
+    if (expanded_) {
+      return Status::OK();
+    }
     if (num_elems_ > 0) {
-      int64_t bytes;
       decoded_.resize(num_elems_after_padding_ * size_of_elem_);
-      uint8_t* in = const_cast<uint8_t*>(&data_[kHeaderSize]);
-      bytes = bitshuffle::decompress_lz4(in, decoded_.data(), num_elems_after_padding_,
-                                         size_of_elem_, 0);
-      if (PREDICT_FALSE(bytes < 0)) {
-        // Ideally, this should not happen.
-        AbortWithBitShuffleError(bytes);
-        return Status::RuntimeError("Unshuffle Process failed");
-      }
+      RETURN_NOT_OK(Decompress(decoded_.data()));
+    }
+    expanded_ = true;
+    return Status::OK();
+  }
+
+  // Un-shuffles all 'num_elems_after_padding_' elements of the block into
+  // 'dst', which must have room for them.
+  Status Decompress(uint8_t* dst) {
+    uint8_t* in = const_cast<uint8_t*>(&data_[kHeaderSize]);
+    int64_t bytes = bitshuffle::decompress_lz4(in, dst, num_elems_after_padding_,
+                                               size_of_elem_, 0);
+    if (PREDICT_FALSE(bytes < 0)) {
+      // Ideally, this should not happen.
+      AbortWithBitShuffleError(bytes);
+      return Status::RuntimeError("Unshuffle Process failed");
     }
     return Status::OK();
   }
@@ -411,6 +436,9 @@ class BShufBlockDecoder final : public BlockDecoder {
   int size_of_elem_;
 
   size_t cur_idx_;
+
+  // Whether 'decoded_' holds the un-shuffled block.
+  bool expanded_;
   faststring decoded_;
 };
 
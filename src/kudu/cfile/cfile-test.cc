@@ -40,8 +40,11 @@
 #include "kudu/cfile/cfile_util.h"
 #include "kudu/cfile/cfile_writer.h"
 #include "kudu/cfile/index_btree.h"
+#include "kudu/cfile/ordinal_index.h"
 #include "kudu/cfile/type_encodings.h"
+#include "kudu/cfile/zone_map.h"
 #include "kudu/common/column_materialization_context.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/encoded_key.h"
@@ -77,6 +80,10 @@
 #include "kudu/util/test_util.h"
 
 DECLARE_bool(cfile_write_checksums);
+DECLARE_bool(cfile_write_ordinal_index);
+DECLARE_int32(cfile_compression_dictionary_size);
+DECLARE_int64(cfile_compression_dictionary_training_size);
+DECLARE_bool(cfile_mmap_reads);
 DECLARE_bool(cfile_verify_checksums);
 
 #if defined(__linux__)
@@ -84,10 +91,13 @@ DECLARE_string(nvm_cache_path);
 DECLARE_bool(nvm_cache_simulate_allocation_failure);
 #endif
 
+METRIC_DECLARE_counter(block_cache_hits);
 METRIC_DECLARE_counter(block_cache_hits_caching);
+METRIC_DECLARE_counter(block_cache_inserts);
 
 METRIC_DECLARE_entity(server);
 
+using std::pair;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
@@ -312,6 +322,110 @@ class TestCFile : public CFileTestBase {
     ASSERT_EQ(num_entries, count);
   }
 
+  // Writes a file of values whose blocks are copied from another file,
+  // between values appended one by one, and checks its contents.
+  template <class DataGeneratorType>
+  void TestAppendDataBlocks(DataGeneratorType* generator, EncodingType encoding,
+                            CompressionType compression) {
+    SCOPED_TRACE(Substitute("$0, $1", EncodingType_Name(encoding),
+                            CompressionType_Name(compression)));
+    const int kNumPrefixRows = 150;
+    const int kNumCopiedRows = 10000;
+    const int kNumSuffixRows = 120;
+    const int kNumRows = kNumPrefixRows + kNumCopiedRows + kNumSuffixRows;
+
+    // The values of the copied file are those of the ordinals they're
+    // copied at.
+    generator->Reset();
+    generator->Build(kNumPrefixRows);
+    BlockId src_id;
+    NO_FATALS(WriteTestFile(generator, encoding, compression, kNumCopiedRows,
+                            SMALL_BLOCKSIZE | WRITE_ZONE_MAP, &src_id));
+    unique_ptr<ReadableBlock> block;
+    ASSERT_OK(fs_manager_->OpenBlock(src_id, &block));
+    unique_ptr<CFileReader> src;
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &src));
+
+    unique_ptr<WritableBlock> sink;
+    ASSERT_OK(fs_manager_->CreateNewBlock({}, &sink));
+    const BlockId dst_id = sink->id();
+    WriterOptions opts;
+    opts.write_posidx = true;
+    opts.write_zone_map = true;
+    opts.storage_attributes.cfile_block_size = 1024;
+    opts.storage_attributes.encoding = encoding;
+    opts.storage_attributes.compression = compression;
+    CFileWriter w(opts, GetTypeInfo(DataGeneratorType::kDataType),
+                  DataGeneratorType::has_nulls(), std::move(sink));
+    ASSERT_OK(w.Start());
+    ASSERT_TRUE(w.CanAppendDataBlocks(*src));
+    const auto append = [&](size_t offset, size_t n) {
+      generator->Build(offset, n);
+      if (DataGeneratorType::has_nulls()) {
+        return w.AppendNullableEntries(generator->null_bitmap(), generator->values(), n);
+      }
+      return w.AppendEntries(generator->values(), n);
+    };
+    ASSERT_OK(append(0, kNumPrefixRows));
+    ASSERT_OK(w.AppendDataBlocks(src.get(), nullptr));
+    ASSERT_OK(append(kNumPrefixRows + kNumCopiedRows, kNumSuffixRows));
+    ASSERT_EQ(kNumRows, w.written_value_count());
+    ASSERT_OK(w.Finish());
+
+    ASSERT_OK(fs_manager_->OpenBlock(dst_id, &block));
+    unique_ptr<CFileReader> reader;
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+    rowid_t count;
+    ASSERT_OK(reader->CountRows(&count));
+    ASSERT_EQ(kNumRows, count);
+
+    // Read all the values, in batches which straddle the copied blocks.
+    unique_ptr<CFileIterator> iter;
+    ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK, nullptr));
+    ASSERT_OK(iter->SeekToOrdinal(0));
+    ScopedColumnBlock<DataGeneratorType::kDataType> cb(77);
+    SelectionVector sel(cb.nrows());
+    ColumnMaterializationContext ctx = CreateNonDecoderEvalContext(&cb, &sel);
+    size_t offset = 0;
+    while (iter->HasNext()) {
+      size_t n = cb.nrows();
+      ASSERT_OK_FAST(iter->CopyNextValues(&n, &ctx));
+      generator->Build(offset, n);
+      for (size_t j = 0; j < n; j++) {
+        const bool expected_null = generator->TestValueShouldBeNull(offset + j);
+        ASSERT_EQ(expected_null, cb.is_null(j)) << offset + j;
+        if (!expected_null) {
+          ASSERT_EQ((*generator)[j], cb[j]) << offset + j;
+        }
+      }
+      cb.arena()->Reset();
+      offset += n;
+    }
+    ASSERT_EQ(kNumRows, offset);
+
+    // Seeking into the copied blocks works too.
+    const rowid_t kSeekOrdinal = kNumPrefixRows + kNumCopiedRows / 2;
+    ASSERT_OK(iter->SeekToOrdinal(kSeekOrdinal));
+    ASSERT_EQ(kSeekOrdinal, iter->GetCurrentOrdinal());
+    size_t n = 1;
+    ASSERT_OK(iter->CopyNextValues(&n, &ctx));
+    ASSERT_EQ(1, n);
+    generator->Build(kSeekOrdinal, 1);
+    ASSERT_EQ(generator->TestValueShouldBeNull(kSeekOrdinal), cb.is_null(0));
+    if (!cb.is_null(0)) {
+      ASSERT_EQ((*generator)[0], cb[0]);
+    }
+
+    // The zone map entries of the copied blocks were kept.
+    const ZoneMap* zone_map;
+    ASSERT_OK(reader->GetZoneMap(nullptr, &zone_map));
+    ASSERT_NE(nullptr, zone_map);
+    const ColumnPredicate is_null = ColumnPredicate::IsNull(
+        ColumnSchema("c", DataGeneratorType::kDataType, true));
+    ASSERT_EQ(DataGeneratorType::has_nulls(),
+              zone_map->MayMatch(is_null, kNumPrefixRows, kNumPrefixRows + kNumCopiedRows - 1));
+  }
+
   void TestReadWriteStrings(EncodingType encoding) {
     TestReadWriteStrings(encoding, [](size_t val) {
         return StringPrintf("hello %04zd", val);
@@ -849,6 +963,158 @@ TEST_P(TestCFileBothCacheMemoryTypes, TestAppendRaw) {
   TestReadWriteRawBlocks(SNAPPY, 1000);
   TestReadWriteRawBlocks(LZ4, 1000);
   TestReadWriteRawBlocks(ZLIB, 1000);
+  TestReadWriteRawBlocks(ZSTD, 1000);
+}
+
+TEST_P(TestCFileBothCacheMemoryTypes, TestCompressionDictionary) {
+  FLAGS_cfile_compression_dictionary_training_size = 64 * 1024;
+  // Small blocks of similar strings, which compress better with a dictionary.
+  const auto formatter = [](size_t val) {
+    return Substitute(R"({"host":"web-$0.example.com","path":"/api/v1/items/$1"})",
+                      val % 13, val);
+  };
+  const int kNumRows = 20000;
+  vector<uint64_t> file_sizes;
+  for (int dict_size : { 0, 4096 }) {
+    SCOPED_TRACE(dict_size);
+    FLAGS_cfile_compression_dictionary_size = dict_size;
+    StringDataGenerator<false> generator(formatter);
+    BlockId block_id;
+    NO_FATALS(WriteTestFile(&generator, PLAIN_ENCODING, ZSTD, kNumRows,
+                            SMALL_BLOCKSIZE | WRITE_VALIDX, &block_id));
+
+    unique_ptr<ReadableBlock> block;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+    uint64_t file_size;
+    ASSERT_OK(block->Size(&file_size));
+    file_sizes.push_back(file_size);
+    unique_ptr<CFileReader> reader;
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+    ASSERT_EQ(dict_size != 0, (reader->footer().incompatible_features() &
+                               IncompatibleFeatures::COMPRESSION_DICTIONARY) != 0);
+
+    unique_ptr<CFileIterator> iter;
+    ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK, nullptr));
+    Arena arena(1024);
+    Slice s;
+    for (int ordinal : { 0, 5000, kNumRows - 1 }) {
+      ASSERT_OK(iter->SeekToOrdinal(ordinal));
+      CopyOne<STRING>(iter.get(), &s, &arena);
+      ASSERT_EQ(formatter(ordinal), s.ToString());
+    }
+    size_t n;
+    TimeReadFile(fs_manager_.get(), block_id, &n);
+    ASSERT_EQ(kNumRows, n);
+  }
+  ASSERT_LT(file_sizes[1], file_sizes[0]);
+}
+
+TEST_P(TestCFileBothCacheMemoryTypes, TestAppendDataBlocks) {
+  UInt32DataGenerator<false> ints;
+  UInt32DataGenerator<true> nullable_ints;
+  Int64DataGenerator<false> int64s;
+  StringDataGenerator<true> nullable_strings("hello %zu");
+  for (auto compression : { NO_COMPRESSION, LZ4 }) {
+    NO_FATALS(TestAppendDataBlocks(&ints, PLAIN_ENCODING, compression));
+    NO_FATALS(TestAppendDataBlocks(&ints, BIT_SHUFFLE, compression));
+    NO_FATALS(TestAppendDataBlocks(&nullable_ints, BIT_SHUFFLE, compression));
+    NO_FATALS(TestAppendDataBlocks(&nullable_ints, RLE, compression));
+    NO_FATALS(TestAppendDataBlocks(&int64s, DELTA_BIT_PACKED, compression));
+    NO_FATALS(TestAppendDataBlocks(&nullable_strings, PLAIN_ENCODING, compression));
+  }
+}
+
+// The blocks of files of other encodings or types than those of the writer
+// can't be copied, nor can dictionary or prefix encoded blocks.
+TEST_P(TestCFileBothCacheMemoryTypes, TestCantAppendDataBlocks) {
+  const auto open_file = [&](EncodingType encoding, unique_ptr<CFileReader>* reader) {
+    StringDataGenerator<false> generator("hello %zu");
+    BlockId block_id;
+    NO_FATALS(WriteTestFile(&generator, encoding, NO_COMPRESSION, 100, NO_FLAGS, &block_id));
+    unique_ptr<ReadableBlock> block;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), reader));
+  };
+  const auto new_writer = [&](EncodingType encoding, DataType type, bool write_validx) {
+    unique_ptr<WritableBlock> sink;
+    CHECK_OK(fs_manager_->CreateNewBlock({}, &sink));
+    WriterOptions opts;
+    opts.write_posidx = true;
+    opts.write_validx = write_validx;
+    opts.storage_attributes.encoding = encoding;
+    return unique_ptr<CFileWriter>(new CFileWriter(opts, GetTypeInfo(type), false,
+                                                   std::move(sink)));
+  };
+  unique_ptr<CFileReader> plain;
+  NO_FATALS(open_file(PLAIN_ENCODING, &plain));
+  ASSERT_TRUE(new_writer(PLAIN_ENCODING, STRING, false)->CanAppendDataBlocks(*plain));
+  ASSERT_FALSE(new_writer(PREFIX_ENCODING, STRING, false)->CanAppendDataBlocks(*plain));
+  ASSERT_FALSE(new_writer(PLAIN_ENCODING, STRING, true)->CanAppendDataBlocks(*plain));
+  ASSERT_FALSE(new_writer(PLAIN_ENCODING, BINARY, false)->CanAppendDataBlocks(*plain));
+
+  for (auto encoding : { PREFIX_ENCODING, DICT_ENCODING }) {
+    unique_ptr<CFileReader> reader;
+    NO_FATALS(open_file(encoding, &reader));
+    ASSERT_FALSE(new_writer(encoding, STRING, false)->CanAppendDataBlocks(*reader));
+  }
+}
+
+// Test copying a range of the data blocks of a file.
+TEST_P(TestCFileBothCacheMemoryTypes, TestAppendDataBlockRange) {
+  const int kNumRows = 10000;
+  UInt32DataGenerator<false> generator;
+  BlockId src_id;
+  NO_FATALS(WriteTestFile(&generator, BIT_SHUFFLE, NO_COMPRESSION, kNumRows,
+                          SMALL_BLOCKSIZE, &src_id));
+  unique_ptr<ReadableBlock> block;
+  ASSERT_OK(fs_manager_->OpenBlock(src_id, &block));
+  unique_ptr<CFileReader> src;
+  ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &src));
+  vector<pair<rowid_t, BlockPointer>> blocks;
+  ASSERT_OK(src->ReadDataBlockPointers(nullptr, &blocks));
+  ASSERT_GT(blocks.size(), 4);
+  ASSERT_EQ(0, blocks[0].first);
+
+  unique_ptr<WritableBlock> sink;
+  ASSERT_OK(fs_manager_->CreateNewBlock({}, &sink));
+  const BlockId dst_id = sink->id();
+  WriterOptions opts;
+  opts.write_posidx = true;
+  opts.storage_attributes.encoding = BIT_SHUFFLE;
+  CFileWriter w(opts, GetTypeInfo(UINT32), false, std::move(sink));
+  ASSERT_OK(w.Start());
+
+  // The range must start and end at block boundaries.
+  const rowid_t first = blocks[1].first;
+  const rowid_t last = blocks[3].first;
+  Status s = w.AppendDataBlocks(src.get(), first + 1, last, nullptr);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  s = w.AppendDataBlocks(src.get(), first, last - 1, nullptr);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_OK(w.AppendDataBlocks(src.get(), first, last, nullptr));
+  ASSERT_OK(w.AppendDataBlocks(src.get(), blocks.back().first, kNumRows, nullptr));
+  const rowid_t num_copied = last - first + kNumRows - blocks.back().first;
+  ASSERT_EQ(num_copied, w.written_value_count());
+  ASSERT_OK(w.Finish());
+
+  ASSERT_OK(fs_manager_->OpenBlock(dst_id, &block));
+  unique_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+  unique_ptr<CFileIterator> iter;
+  ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK, nullptr));
+  ASSERT_OK(iter->SeekToOrdinal(0));
+  ScopedColumnBlock<UINT32> cb(num_copied);
+  SelectionVector sel(cb.nrows());
+  ColumnMaterializationContext ctx = CreateNonDecoderEvalContext(&cb, &sel);
+  size_t n = cb.nrows();
+  ASSERT_OK(iter->CopyNextValues(&n, &ctx));
+  ASSERT_EQ(num_copied, n);
+  for (rowid_t i = 0; i < n; i++) {
+    const rowid_t src_ordinal = i < last - first ? first + i :
+        blocks.back().first + i - (last - first);
+    generator.Build(src_ordinal, 1);
+    ASSERT_EQ(generator[0], cb[i]) << i;
+  }
 }
 
 TEST_P(TestCFileBothCacheMemoryTypes, TestChecksumFlags) {
@@ -866,35 +1132,47 @@ TEST_P(TestCFileBothCacheMemoryTypes, TestDataCorruption) {
   FLAGS_cfile_write_checksums = true;
   FLAGS_cfile_verify_checksums = true;
 
-  // Write some data
-  unique_ptr<WritableBlock> sink;
-  ASSERT_OK(fs_manager_->CreateNewBlock({}, &sink));
-  BlockId id = sink->id();
-  WriterOptions opts;
-  opts.write_posidx = true;
-  opts.write_validx = false;
-  opts.storage_attributes.cfile_block_size = FLAGS_cfile_test_block_size;
-  opts.storage_attributes.encoding = PLAIN_ENCODING;
-  CFileWriter w(opts, GetTypeInfo(STRING), false, std::move(sink));
-  w.AddMetadataPair("header_key", "header_value");
-  ASSERT_OK(w.Start());
-  vector<Slice> slices;
-  slices.emplace_back("HelloWorld");
-  ASSERT_OK(w.AppendRawBlock(slices, 1, nullptr, Slice(), "raw-data"));
-  ASSERT_OK(w.Finish());
-
-  // Get the final size of the data
-  unique_ptr<ReadableBlock> source;
-  ASSERT_OK(fs_manager_->OpenBlock(id, &source));
-  uint64_t file_size;
-  ASSERT_OK(source->Size(&file_size));
-
-  // Corrupt each bit and verify a corruption status is returned
-  for (size_t i = 0; i < file_size; i++) {
-    for (uint8_t flip = 0; flip < 8; flip++) {
-      Status s = CorruptAndReadBlock(id, i, flip);
-      ASSERT_TRUE(s.IsCorruption());
-      ASSERT_STR_MATCHES(s.ToString(), "block [0-9]+");
+  // With LZ4 the tiny block doesn't compress and is stored as-is, so the
+  // reader verifies its checksum while copying it out. With mmap reads, the
+  // uncompressed block is verified in the mapping.
+  for (bool mmap_reads : { false, true }) {
+    for (CompressionType compression : { NO_COMPRESSION, LZ4 }) {
+      SCOPED_TRACE(CompressionType_Name(compression));
+      SCOPED_TRACE(mmap_reads);
+      FLAGS_cfile_mmap_reads = mmap_reads;
+
+      // Write some data
+      unique_ptr<WritableBlock> sink;
+      ASSERT_OK(fs_manager_->CreateNewBlock({}, &sink));
+      BlockId id = sink->id();
+      WriterOptions opts;
+      opts.write_posidx = true;
+      opts.write_validx = false;
+      opts.storage_attributes.cfile_block_size = FLAGS_cfile_test_block_size;
+      opts.storage_attributes.encoding = PLAIN_ENCODING;
+      opts.storage_attributes.compression = compression;
+      CFileWriter w(opts, GetTypeInfo(STRING), false, std::move(sink));
+      w.AddMetadataPair("header_key", "header_value");
+      ASSERT_OK(w.Start());
+      vector<Slice> slices;
+      slices.emplace_back("HelloWorld");
+      ASSERT_OK(w.AppendRawBlock(slices, 1, nullptr, Slice(), "raw-data"));
+      ASSERT_OK(w.Finish());
+
+      // Get the final size of the data
+      unique_ptr<ReadableBlock> source;
+      ASSERT_OK(fs_manager_->OpenBlock(id, &source));
+      uint64_t file_size;
+      ASSERT_OK(source->Size(&file_size));
+
+      // Corrupt each bit and verify a corruption status is returned
+      for (size_t i = 0; i < file_size; i++) {
+        for (uint8_t flip = 0; flip < 8; flip++) {
+          Status s = CorruptAndReadBlock(id, i, flip);
+          ASSERT_TRUE(s.IsCorruption());
+          ASSERT_STR_MATCHES(s.ToString(), "block [0-9]+");
+        }
+      }
     }
   }
 }
@@ -934,6 +1212,155 @@ TEST_P(TestCFileBothCacheMemoryTypes, TestNullDictStrings) {
   TestNullTypes(&generator, DICT_ENCODING, LZ4);
 }
 
+TEST_P(TestCFileBothCacheMemoryTypes, TestZoneMaps) {
+  // Each value is ten times its ordinal.
+  const int kNumRows = 10000;
+  BlockId block_id;
+  UInt32DataGenerator<false> generator;
+  WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, kNumRows,
+                SMALL_BLOCKSIZE | WRITE_ZONE_MAP, &block_id);
+
+  unique_ptr<ReadableBlock> block;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+  unique_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+  ASSERT_TRUE(reader->has_zone_map());
+  ASSERT_TRUE(reader->footer().compatible_features() & CompatibleFeatures::ZONE_MAPS);
+  const ZoneMap* zone_map;
+  ASSERT_OK(reader->GetZoneMap(nullptr, &zone_map));
+  ASSERT_NE(nullptr, zone_map);
+
+  // Only the values of ordinals [5000, 5010) are in [50000, 50100).
+  ColumnSchema col("c", UINT32);
+  uint32_t lower = 50000;
+  uint32_t upper = 50100;
+  ColumnPredicate range = ColumnPredicate::Range(col, &lower, &upper);
+  ASSERT_FALSE(zone_map->MayMatch(range, 0, 3999));
+  ASSERT_FALSE(zone_map->MayMatch(range, 6000, kNumRows - 1));
+  ASSERT_TRUE(zone_map->MayMatch(range, 5005, 5005));
+  ASSERT_TRUE(zone_map->MayMatch(range, 0, kNumRows - 1));
+  // Ranges past the end of the file aren't covered by the zone map.
+  ASSERT_TRUE(zone_map->MayMatch(range, kNumRows, kNumRows + 100));
+
+  ColumnPredicate is_null = ColumnPredicate::IsNull(ColumnSchema("c", UINT32, true));
+  ASSERT_FALSE(zone_map->MayMatch(is_null, 0, kNumRows - 1));
+
+  // Check the same through an iterator.
+  unique_ptr<CFileIterator> iter;
+  ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK, nullptr));
+  bool may_match;
+  ASSERT_OK(iter->MayMatchPredicate(range, 0, 1000, &may_match));
+  ASSERT_FALSE(may_match);
+  ASSERT_OK(iter->MayMatchPredicate(range, 4990, 20, &may_match));
+  ASSERT_TRUE(may_match);
+
+  // A file written without a zone map may always match.
+  WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, kNumRows,
+                SMALL_BLOCKSIZE, &block_id);
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+  ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+  ASSERT_FALSE(reader->has_zone_map());
+  ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK, nullptr));
+  ASSERT_OK(iter->MayMatchPredicate(range, 0, 1000, &may_match));
+  ASSERT_TRUE(may_match);
+}
+
+// Test the bounds kept on binary values, and on NULLs.
+TEST_P(TestCFileBothCacheMemoryTypes, TestZoneMapBuilder) {
+  ZoneMapBuilder builder(GetTypeInfo(STRING));
+  string long_value(kZoneMapMaxBinaryValueLength + 10, 'z');
+  vector<Slice> values = { "b", "a", long_value };
+  builder.AddValues(values.data(), values.size());
+  builder.AddNulls(2);
+  builder.FinishBlock(0);
+  builder.AddNulls(5);
+  builder.FinishBlock(5);
+
+  const ZoneMapPB& pb = builder.zone_map();
+  ASSERT_EQ(2, pb.entries_size());
+  ASSERT_EQ(5, pb.entries(0).num_values());
+  ASSERT_EQ(2, pb.entries(0).null_count());
+  ASSERT_EQ("a", pb.entries(0).min_value());
+  // The maximum is too long to be stored.
+  ASSERT_FALSE(pb.entries(0).has_max_value());
+  ASSERT_EQ(5, pb.entries(1).first_ordinal());
+  ASSERT_EQ(5, pb.entries(1).null_count());
+  ASSERT_FALSE(pb.entries(1).has_min_value());
+
+  unique_ptr<ZoneMap> zone_map;
+  ASSERT_OK(ZoneMap::Parse(GetTypeInfo(STRING), pb.SerializeAsString(), &zone_map));
+  ColumnSchema col("c", STRING, true);
+  Slice zzz("zzz");
+  ColumnPredicate eq = ColumnPredicate::Equality(col, &zzz);
+  ASSERT_TRUE(zone_map->MayMatch(eq, 0, 4));
+  ASSERT_FALSE(zone_map->MayMatch(eq, 5, 9));
+  ColumnPredicate is_null = ColumnPredicate::IsNull(col);
+  ASSERT_TRUE(zone_map->MayMatch(is_null, 5, 9));
+
+  ASSERT_TRUE(ZoneMap::Parse(GetTypeInfo(STRING), "garbage", &zone_map).IsCorruption());
+}
+
+// Test that seeks to ordinals find the right data blocks with the ordinal
+// index, and without it in files written before it.
+TEST_P(TestCFileBothCacheMemoryTypes, TestOrdinalIndex) {
+  const int kNumRows = 10000;
+  for (bool write_ordinal_index : { true, false }) {
+    SCOPED_TRACE(write_ordinal_index);
+    FLAGS_cfile_write_ordinal_index = write_ordinal_index;
+    BlockId block_id;
+    UInt32DataGenerator<true> generator;
+    WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, kNumRows,
+                  SMALL_BLOCKSIZE, &block_id);
+
+    unique_ptr<ReadableBlock> block;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+    unique_ptr<CFileReader> reader;
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+    ASSERT_EQ(write_ordinal_index, reader->has_ordinal_index());
+    ASSERT_EQ(write_ordinal_index, static_cast<bool>(
+        reader->footer().compatible_features() & CompatibleFeatures::ORDINAL_INDEX));
+    const OrdinalIndex* ordinal_index;
+    ASSERT_OK(reader->GetOrdinalIndex(nullptr, &ordinal_index));
+    ASSERT_EQ(write_ordinal_index, ordinal_index != nullptr);
+    if (ordinal_index != nullptr) {
+      ASSERT_GT(ordinal_index->num_blocks(), 1);
+      ASSERT_EQ(0, ordinal_index->FindBlock(0));
+      ASSERT_EQ(ordinal_index->num_blocks() - 1, ordinal_index->FindBlock(kNumRows - 1));
+    }
+    NO_FATALS(TimeSeekAndReadFileWithNulls(&generator, block_id, kNumRows));
+  }
+}
+
+// Test the mapping of ordinals to blocks with the same and with different
+// numbers of values.
+TEST_P(TestCFileBothCacheMemoryTypes, TestOrdinalIndexBuilder) {
+  for (const auto& first_ordinals : vector<vector<rowid_t>>{ { 0, 10, 20, 30 },
+                                                            { 0, 10, 15, 30 } }) {
+    OrdinalIndexBuilder builder;
+    for (size_t i = 0; i < first_ordinals.size(); i++) {
+      builder.AddBlock(first_ordinals[i], BlockPointer(i * 100, 50));
+    }
+    const OrdinalIndexPB& pb = builder.ordinal_index();
+    ASSERT_EQ(first_ordinals[2] == 20, pb.has_values_per_block());
+
+    unique_ptr<OrdinalIndex> ordinal_index;
+    ASSERT_OK(OrdinalIndex::Parse(pb.SerializeAsString(), 35, &ordinal_index));
+    ASSERT_EQ(4, ordinal_index->num_blocks());
+    for (size_t i = 0; i < first_ordinals.size(); i++) {
+      ASSERT_EQ(i, ordinal_index->FindBlock(first_ordinals[i]));
+      ASSERT_EQ(i * 100, ordinal_index->block_ptr(i).offset());
+    }
+    ASSERT_EQ(1, ordinal_index->FindBlock(14));
+    ASSERT_EQ(3, ordinal_index->FindBlock(34));
+    ASSERT_EQ(3, ordinal_index->FindBlock(100));
+
+    // The last block must start before the end of the file.
+    ASSERT_TRUE(OrdinalIndex::Parse(pb.SerializeAsString(), 30, &ordinal_index).IsCorruption());
+  }
+  unique_ptr<OrdinalIndex> ordinal_index;
+  ASSERT_TRUE(OrdinalIndex::Parse("garbage", 10, &ordinal_index).IsCorruption());
+}
+
 TEST_P(TestCFileBothCacheMemoryTypes, TestReleaseBlock) {
   unique_ptr<WritableBlock> sink;
   ASSERT_OK(fs_manager_->CreateNewBlock({}, &sink));
@@ -1038,6 +1465,86 @@ TEST_P(TestCFileBothCacheMemoryTypes, TestCacheKeysAreStable) {
   }
 }
 
+// Tests that data blocks read with a read-once IO context aren't inserted into
+// the block cache, while those already in it are still used.
+TEST_P(TestCFileBothCacheMemoryTypes, TestReadOnceIOContext) {
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity(METRIC_ENTITY_server.Instantiate(&registry, "test_entity"));
+  BlockCache::GetSingleton()->StartInstrumentation(entity);
+  auto counter_value = [&](const CounterPrototype& prototype) {
+    return down_cast<Counter*>(entity->FindOrNull(prototype).get())->value();
+  };
+
+  BlockId block_id;
+  {
+    const int nrows = 1000;
+    StringDataGenerator<false> generator("hello %04d");
+    WriteTestFile(&generator, PREFIX_ENCODING, NO_COMPRESSION, nrows,
+                  SMALL_BLOCKSIZE | WRITE_VALIDX, &block_id);
+  }
+  unique_ptr<ReadableBlock> source;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &source));
+  unique_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(source), ReaderOptions(), &reader));
+  gscoped_ptr<IndexTreeIterator> iter;
+  iter.reset(IndexTreeIterator::Create(nullptr, reader.get(), reader->posidx_root()));
+  ASSERT_OK(iter->SeekToFirst());
+
+  const fs::IOContext read_once_context({ "tablet", fs::IOContext::CACHE_READ_ONCE });
+  const int64_t inserts = counter_value(METRIC_block_cache_inserts);
+  for (int i = 0; i < 2; i++) {
+    BlockHandle bh;
+    ASSERT_OK(reader->ReadBlock(&read_once_context, iter->GetCurrentBlockPointer(),
+                                CFileReader::CACHE_BLOCK, &bh));
+  }
+  ASSERT_EQ(inserts, counter_value(METRIC_block_cache_inserts));
+  ASSERT_EQ(0, counter_value(METRIC_block_cache_hits_caching));
+
+  // Once the block is cached by another reader, read-once reads use it.
+  {
+    BlockHandle bh;
+    ASSERT_OK(reader->ReadBlock(nullptr, iter->GetCurrentBlockPointer(),
+                                CFileReader::CACHE_BLOCK, &bh));
+  }
+  ASSERT_EQ(inserts + 1, counter_value(METRIC_block_cache_inserts));
+  BlockHandle bh;
+  ASSERT_OK(reader->ReadBlock(&read_once_context, iter->GetCurrentBlockPointer(),
+                              CFileReader::CACHE_BLOCK, &bh));
+  ASSERT_EQ(inserts + 1, counter_value(METRIC_block_cache_inserts));
+  ASSERT_EQ(1, counter_value(METRIC_block_cache_hits));
+}
+
+// Tests that the blocks of uncompressed files are read from their mapping
+// with --cfile_mmap_reads, without going through the block cache.
+TEST_P(TestCFileBothCacheMemoryTypes, TestMmapReads) {
+  FLAGS_cfile_mmap_reads = true;
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity(METRIC_ENTITY_server.Instantiate(&registry, "test_entity"));
+  BlockCache::GetSingleton()->StartInstrumentation(entity);
+  auto counter_value = [&](const CounterPrototype& prototype) {
+    return down_cast<Counter*>(entity->FindOrNull(prototype).get())->value();
+  };
+
+  const int nrows = 10000;
+  for (CompressionType compression : { NO_COMPRESSION, LZ4 }) {
+    SCOPED_TRACE(CompressionType_Name(compression));
+    BlockId block_id;
+    StringDataGenerator<false> generator("hello %04d");
+    WriteTestFile(&generator, PREFIX_ENCODING, compression, nrows,
+                  SMALL_BLOCKSIZE | WRITE_VALIDX, &block_id);
+
+    const int64_t inserts = counter_value(METRIC_block_cache_inserts);
+    size_t count = 0;
+    TimeReadFile(fs_manager_.get(), block_id, &count);
+    ASSERT_EQ(nrows, count);
+    if (compression == NO_COMPRESSION) {
+      ASSERT_EQ(inserts, counter_value(METRIC_block_cache_inserts));
+    } else {
+      ASSERT_LT(inserts, counter_value(METRIC_block_cache_inserts));
+    }
+  }
+}
+
 #if defined(HAVE_LIB_VMEM)
 // Inject failures in nvm allocation and ensure that we can still read a file.
 TEST_P(TestCFileBothCacheMemoryTypes, TestNvmAllocationFailure) {
@@ -1052,7 +1559,7 @@ class TestCFileDifferentCodecs : public TestCFile,
 };
 
 INSTANTIATE_TEST_CASE_P(Codecs, TestCFileDifferentCodecs,
-                        ::testing::Values(NO_COMPRESSION, SNAPPY, LZ4, ZLIB));
+                        ::testing::Values(NO_COMPRESSION, SNAPPY, LZ4, ZLIB, ZSTD));
 
 // Read/write a file with uncompressible data (random int32s)
 TEST_P(TestCFileDifferentCodecs, TestUncompressible) {
@@ -35,7 +35,9 @@
 #include "kudu/cfile/cfile_util.h"
 #include "kudu/cfile/cfile_writer.h" // for kMagicString
 #include "kudu/cfile/index_btree.h"
+#include "kudu/cfile/ordinal_index.h"
 #include "kudu/cfile/type_encodings.h"
+#include "kudu/cfile/zone_map.h"
 #include "kudu/common/column_materialization_context.h"
 #include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
@@ -46,6 +48,7 @@
 #include "kudu/common/types.h"
 #include "kudu/fs/error_manager.h"
 #include "kudu/fs/io_context.h"
+#include "kudu/fs/io_metrics.h"
 #include "kudu/gutil/basictypes.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/stringprintf.h"
@@ -57,12 +60,14 @@
 #include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/crc.h"
 #include "kudu/util/debug/trace_event.h"
+#include "kudu/util/env.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/malloc.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/memory/overwrite.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/object_pool.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/rle-encoding.h"
@@ -78,16 +83,33 @@ DEFINE_bool(cfile_verify_checksums, true,
             "Verify the checksum for each block on read if one exists");
 TAG_FLAG(cfile_verify_checksums, evolving);
 
+DEFINE_bool(cfile_mmap_reads, false,
+            "Whether to read the blocks of uncompressed CFiles directly from memory "
+            "mappings of their files, bypassing the block cache. This saves the CPU "
+            "cost of copying the blocks out of the OS page cache, which dominates "
+            "on fast devices such as NVMe SSDs, but the blocks are then only "
+            "cached by the OS page cache, and their checksums are verified on "
+            "each read. Only applies to the CFiles opened after it's set.");
+TAG_FLAG(cfile_mmap_reads, experimental);
+
 DEFINE_double(cfile_inject_corruption, 0,
               "Fraction of the time that read operations on CFiles will fail "
               "with a corruption status");
 TAG_FLAG(cfile_inject_corruption, hidden);
 
+DEFINE_uint64(cfile_readahead_bytes, 1024 * 1024,
+              "When a CFile is being scanned sequentially, the number of bytes "
+              "past the data block being read that are hinted to the OS to "
+              "read in the background. 0 disables read-ahead.");
+TAG_FLAG(cfile_readahead_bytes, advanced);
+TAG_FLAG(cfile_readahead_bytes, runtime);
+
 using kudu::fault_injection::MaybeTrue;
 using kudu::fs::ErrorHandlerType;
 using kudu::fs::IOContext;
 using kudu::fs::ReadableBlock;
 using kudu::pb_util::SecureDebugString;
+using std::pair;
 using std::string;
 using std::unique_ptr;
 using std::vector;
@@ -141,6 +163,9 @@ CFileReader::CFileReader(ReaderOptions options,
                    memory_footprint()) {
 }
 
+CFileReader::~CFileReader() {
+}
+
 Status CFileReader::Open(unique_ptr<ReadableBlock> block,
                          ReaderOptions options,
                          unique_ptr<CFileReader>* reader) {
@@ -198,6 +223,18 @@ Status CFileReader::InitOnce(const IOContext* io_context) {
           << " Footer: " << SecureDebugString(*footer_)
           << " Type: " << type_info_->name();
 
+  if (FLAGS_cfile_mmap_reads && codec_ == nullptr) {
+    // Compressed blocks are decompressed into memory anyway, so they're read
+    // as usual. If the file can't be mapped, e.g. because the address space
+    // is exhausted, it's read as usual too.
+    Status s = block_->MapForRead(&mapping_);
+    if (PREDICT_FALSE(!s.ok())) {
+      KLOG_EVERY_N_SECS(WARNING, 60) << "Unable to map CFile " << block_->id().ToString()
+                                     << ": " << s.ToString();
+      mapping_.reset();
+    }
+  }
+
   // The header/footer have been allocated; memory consumption has changed.
   mem_consumption_.Reset(memory_footprint());
 
@@ -317,6 +354,16 @@ Status CFileReader::ReadAndParseFooter() {
   if (footer_->compression() != NO_COMPRESSION) {
     RETURN_NOT_OK_PREPEND(GetCompressionCodec(footer_->compression(), &codec_),
                           "failed to load CFile compression codec");
+    if (footer_->has_compression_dictionary()) {
+      CompressionCodecOptions codec_opts;
+      codec_opts.dictionary = footer_->compression_dictionary();
+      RETURN_NOT_OK_PREPEND(NewCompressionCodec(footer_->compression(), codec_opts,
+                                                &owned_codec_),
+                            "failed to load CFile compression dictionary");
+      codec_ = owned_codec_.get();
+      // The codec digested the dictionary, which needn't be kept in memory.
+      footer_->clear_compression_dictionary();
+    }
   }
 
   VLOG(2) << "Read footer: " << SecureDebugString(*footer_);
@@ -329,11 +376,15 @@ bool CFileReader::has_checksums() const {
 }
 
 Status CFileReader::VerifyChecksum(ArrayView<const Slice> data, const Slice& checksum) const {
-  uint32_t expected_checksum = DecodeFixed32(checksum.data());
   uint32_t checksum_value = 0;
   for (auto& d : data) {
     checksum_value = crc::Crc32c(d.data(), d.size(), checksum_value);
   }
+  return CompareChecksum(checksum_value, checksum);
+}
+
+Status CFileReader::CompareChecksum(uint32_t checksum_value, const Slice& checksum) const {
+  uint32_t expected_checksum = DecodeFixed32(checksum.data());
   if (PREDICT_FALSE(checksum_value != expected_checksum ||
                     MaybeTrue(FLAGS_cfile_inject_corruption))) {
     return Status::Corruption(
@@ -433,12 +484,20 @@ class ScratchMemory {
 Status CFileReader::ReadBlock(const IOContext* io_context, const BlockPointer &ptr,
                               CacheControl cache_control, BlockHandle *ret) const {
   DCHECK(init_once_.init_succeeded());
+  if (cache_control == CACHE_BLOCK && io_context &&
+      io_context->cache_hint == IOContext::CACHE_READ_ONCE) {
+    cache_control = DONT_CACHE_BLOCK;
+  }
   CHECK(ptr.offset() > 0 &&
         ptr.offset() + ptr.size() < file_size_) <<
     "bad offset " << ptr.ToString() << " in file of size "
                   << file_size_;
+  if (mapping_) {
+    return ReadMappedBlock(io_context, ptr, ret);
+  }
   BlockCacheHandle bc_handle;
-  Cache::CacheBehavior cache_behavior = cache_control == CACHE_BLOCK ?
+  const bool cache_block = cache_control != DONT_CACHE_BLOCK;
+  Cache::CacheBehavior cache_behavior = cache_block ?
       Cache::EXPECT_IN_CACHE : Cache::NO_EXPECT_IN_CACHE;
   BlockCache* cache = BlockCache::GetSingleton();
   BlockCache::CacheKey key(block_->id(), ptr.offset());
@@ -472,7 +531,7 @@ Status CFileReader::ReadBlock(const IOContext* io_context, const BlockPointer &p
   // If we are reading uncompressed data and plan to cache the result,
   // then we should allocate our scratch memory directly from the cache.
   // This avoids an extra memory copy in the case of an NVM cache.
-  if (codec_ == nullptr && cache_control == CACHE_BLOCK) {
+  if (codec_ == nullptr && cache_block) {
     scratch.TryAllocateFromCache(cache, key, data_size);
   } else {
     scratch.AllocateFromHeap(data_size);
@@ -482,46 +541,95 @@ Status CFileReader::ReadBlock(const IOContext* io_context, const BlockPointer &p
   uint8_t checksum_scratch[kChecksumSize];
   Slice checksum(checksum_scratch, kChecksumSize);
 
-  // Read the data and checksum if needed.
-  Slice results_backing[] = { block, checksum };
-  bool read_checksum = has_checksums() && FLAGS_cfile_verify_checksums;
-  ArrayView<Slice> results(results_backing, read_checksum ? 2 : 1);
-  RETURN_NOT_OK_PREPEND(block_->ReadV(ptr.offset(), results),
-                        Substitute("failed to read CFile block $0 at $1",
-                                   block_id().ToString(), ptr.ToString()));
+  // The secondary tier of the block cache holds blocks as read from disk,
+  // which were verified against their checksum when first read.
+  bool use_secondary_cache = cache_block && cache->has_secondary();
+  // Set if the block is compressed but was stored as-is, and its checksum
+  // still needs to be verified. The verification is then fused with the copy
+  // out of 'scratch' below instead of making a separate pass over the data.
+  bool verify_while_copying = false;
+  unique_ptr<CompressedBlockDecoder> uncompressor;
+  if (!use_secondary_cache || !cache->LookupSecondary(key, block)) {
+    // Read the data and checksum if needed.
+    Slice results_backing[] = { block, checksum };
+    bool read_checksum = has_checksums() && FLAGS_cfile_verify_checksums;
+    ArrayView<Slice> results(results_backing, read_checksum ? 2 : 1);
+    MonoTime start = MonoTime::Now();
+    RETURN_NOT_OK_PREPEND(block_->ReadV(ptr.offset(), results),
+                          Substitute("failed to read CFile block $0 at $1",
+                                     block_id().ToString(), ptr.ToString()));
+    if (io_context && io_context->metrics) {
+      io_context->metrics->RecordRead(io_context->source,
+                                      read_checksum ? ptr.size() : data_size,
+                                      MonoTime::Now() - start);
+    }
 
-  if (has_checksums() && FLAGS_cfile_verify_checksums) {
-    Status s = VerifyChecksum(ArrayView<const Slice>(&block, 1), checksum);
-    if (!s.ok()) {
-      RETURN_NOT_OK_HANDLE_CORRUPTION(
-          s.CloneAndPrepend(Substitute("checksum error on CFile block $0 at $1",
-                                       block_id().ToString(), ptr.ToString())),
-          HandleCorruption(io_context));
+    if (read_checksum) {
+      if (codec_ != nullptr) {
+        // If the header doesn't parse, fall back to verifying the checksum
+        // up front so that corruption is reported as such.
+        uncompressor.reset(new CompressedBlockDecoder(codec_, cfile_version_, block));
+        if (uncompressor->Init().ok()) {
+          verify_while_copying = uncompressor->is_stored_uncompressed();
+        } else {
+          uncompressor.reset();
+        }
+      }
+      if (!verify_while_copying) {
+        Status s = VerifyChecksum(ArrayView<const Slice>(&block, 1), checksum);
+        if (!s.ok()) {
+          RETURN_NOT_OK_HANDLE_CORRUPTION(
+              s.CloneAndPrepend(Substitute("checksum error on CFile block $0 at $1",
+                                           block_id().ToString(), ptr.ToString())),
+              HandleCorruption(io_context));
+        }
+      }
+    }
+    if (use_secondary_cache && !verify_while_copying) {
+      cache->InsertSecondary(key, block);
     }
   }
 
   // Decompress the block
   if (codec_ != nullptr) {
     // Init the decompressor and get the size required for the uncompressed buffer.
-    CompressedBlockDecoder uncompressor(codec_, cfile_version_, block);
-    Status s = uncompressor.Init();
+    Status s;
+    if (!uncompressor) {
+      uncompressor.reset(new CompressedBlockDecoder(codec_, cfile_version_, block));
+      s = uncompressor->Init();
+    }
     if (!s.ok()) {
       LOG(WARNING) << "Unable to validate compressed block " << block_id().ToString()
                    << " at " << ptr.offset() << " of size " << block.size() << ": "
                    << s.ToString();
       return s;
     }
-    int uncompressed_size = uncompressor.uncompressed_size();
+    int uncompressed_size = uncompressor->uncompressed_size();
 
     // If we plan to put the uncompressed block in the cache, we should
     // decompress directly into the cache's memory (to avoid a memcpy for NVM).
     ScratchMemory decompressed_scratch;
-    if (cache_control == CACHE_BLOCK) {
+    if (cache_block) {
       decompressed_scratch.TryAllocateFromCache(cache, key, uncompressed_size);
     } else {
       decompressed_scratch.AllocateFromHeap(uncompressed_size);
     }
-    s = uncompressor.UncompressIntoBuffer(decompressed_scratch.get());
+    if (verify_while_copying) {
+      uint32_t checksum_value = 0;
+      uncompressor->CopyIntoBufferWithChecksum(decompressed_scratch.get(), &checksum_value);
+      s = CompareChecksum(checksum_value, checksum);
+      if (!s.ok()) {
+        RETURN_NOT_OK_HANDLE_CORRUPTION(
+            s.CloneAndPrepend(Substitute("checksum error on CFile block $0 at $1",
+                                         block_id().ToString(), ptr.ToString())),
+            HandleCorruption(io_context));
+      }
+      if (use_secondary_cache) {
+        cache->InsertSecondary(key, block);
+      }
+    } else {
+      s = uncompressor->UncompressIntoBuffer(decompressed_scratch.get());
+    }
     if (!s.ok()) {
       LOG(WARNING) << "Unable to uncompress block " << block_id().ToString()
                    << " at " << ptr.offset()
@@ -548,8 +656,10 @@ Status CFileReader::ReadBlock(const IOContext* io_context, const BlockPointer &p
   // failed, in which case we don't insert it into the cache regardless
   // of what the user requested. The scratch memory includes both the
   // generated key and the data read from disk.
-  if (cache_control == CACHE_BLOCK && scratch.IsFromCache()) {
-    cache->Insert(scratch.mutable_pending_entry(), &bc_handle);
+  if (cache_block && scratch.IsFromCache()) {
+    cache->Insert(scratch.mutable_pending_entry(), &bc_handle,
+                  cache_control == CACHE_BLOCK_HIGH_PRIORITY ?
+                      Cache::Priority::HIGH : Cache::Priority::NORMAL);
     *ret = BlockHandle::WithDataFromCache(&bc_handle);
   } else {
     // We get here by either not intending to cache the block or
@@ -568,11 +678,79 @@ Status CFileReader::ReadBlock(const IOContext* io_context, const BlockPointer &p
   return Status::OK();
 }
 
+Status CFileReader::ReadMappedBlock(const IOContext* io_context, const BlockPointer& ptr,
+                                    BlockHandle* ret) const {
+  TRACE_COUNTER_INCREMENT("cfile_mmap_read", 1);
+  uint32_t data_size = ptr.size();
+  if (has_checksums()) {
+    if (PREDICT_FALSE(kChecksumSize > data_size)) {
+      return Status::Corruption("invalid data size for block pointer",
+                                ptr.ToString());
+    }
+    data_size -= kChecksumSize;
+  }
+  // Start reading the pages of the block which aren't in the page cache, so
+  // that they're not faulted in one by one by the checksum or the decoders.
+  // It's only a hint.
+  ignore_result(mapping_->Prefetch(ptr.offset(), ptr.size()));
+
+  Slice block(mapping_->data().data() + ptr.offset(), data_size);
+  if (has_checksums() && FLAGS_cfile_verify_checksums) {
+    Slice checksum(block.data() + data_size, kChecksumSize);
+    Status s = VerifyChecksum(ArrayView<const Slice>(&block, 1), checksum);
+    if (!s.ok()) {
+      RETURN_NOT_OK_HANDLE_CORRUPTION(
+          s.CloneAndPrepend(Substitute("checksum error on CFile block $0 at $1",
+                                       block_id().ToString(), ptr.ToString())),
+          HandleCorruption(io_context));
+    }
+  }
+  // The mapping lives as long as the reader, which outlives its blocks.
+  *ret = BlockHandle::WithBorrowedData(block);
+  return Status::OK();
+}
+
+Status CFileReader::Readahead(uint64_t offset, size_t length) const {
+  TRACE_EVENT1("io", "CFileReader::Readahead", "cfile", ToString());
+  return block_->Readahead(offset, length);
+}
+
 Status CFileReader::CountRows(rowid_t *count) const {
   *count = footer().num_values();
   return Status::OK();
 }
 
+Status CFileReader::ReadDataBlockPointers(const IOContext* io_context,
+                                          vector<pair<rowid_t, BlockPointer>>* blocks) {
+  DCHECK(has_posidx());
+  blocks->clear();
+  rowid_t num_rows;
+  RETURN_NOT_OK(CountRows(&num_rows));
+  if (num_rows == 0) {
+    return Status::OK();
+  }
+  const KeyEncoder<faststring>& ordinal_encoder = GetKeyEncoder<faststring>(GetTypeInfo(UINT32));
+  unique_ptr<IndexTreeIterator> iter(IndexTreeIterator::Create(io_context, this, posidx_root()));
+  RETURN_NOT_OK(iter->SeekToFirst());
+  while (true) {
+    Slice key = iter->GetCurrentKey();
+    uint32_t ordinal;
+    RETURN_NOT_OK(ordinal_encoder.Decode(&key, true, nullptr,
+                                         reinterpret_cast<uint8_t*>(&ordinal)));
+    if (PREDICT_FALSE(ordinal >= num_rows ||
+                      (blocks->empty() ? ordinal != 0 : ordinal <= blocks->back().first))) {
+      return Status::Corruption(Substitute("$0: unexpected data block ordinal $1",
+                                           ToString(), ordinal));
+    }
+    blocks->emplace_back(ordinal, iter->GetCurrentBlockPointer());
+    if (!iter->HasNext()) {
+      break;
+    }
+    RETURN_NOT_OK(iter->Next());
+  }
+  return Status::OK();
+}
+
 bool CFileReader::GetMetadataEntry(const string &key, string *val) const {
   for (const FileMetadataPairPB &pair : header().metadata()) {
     if (pair.key() == key) {
@@ -589,6 +767,59 @@ bool CFileReader::GetMetadataEntry(const string &key, string *val) const {
   return false;
 }
 
+Status CFileReader::GetZoneMap(const IOContext* io_context, const ZoneMap** zone_map) {
+  if (!has_zone_map()) {
+    *zone_map = nullptr;
+    return Status::OK();
+  }
+  RETURN_NOT_OK(zone_map_once_.Init([this, io_context] { return ReadZoneMapOnce(io_context); }));
+  *zone_map = zone_map_.get();
+  return Status::OK();
+}
+
+Status CFileReader::GetOrdinalIndex(const IOContext* io_context,
+                                    const OrdinalIndex** ordinal_index) {
+  if (!has_ordinal_index()) {
+    *ordinal_index = nullptr;
+    return Status::OK();
+  }
+  RETURN_NOT_OK(ordinal_index_once_.Init([this, io_context] {
+    return ReadOrdinalIndexOnce(io_context);
+  }));
+  *ordinal_index = ordinal_index_.get();
+  return Status::OK();
+}
+
+Status CFileReader::ReadOrdinalIndexOnce(const IOContext* io_context) {
+  TRACE_EVENT1("io", "CFileReader::ReadOrdinalIndexOnce",
+               "cfile", ToString());
+  BlockHandle handle;
+  RETURN_NOT_OK(ReadBlock(io_context, BlockPointer(footer().ordinal_index_block_ptr()),
+                          DONT_CACHE_BLOCK, &handle));
+  RETURN_NOT_OK_HANDLE_CORRUPTION(
+      OrdinalIndex::Parse(handle.data(), footer().num_values(), &ordinal_index_),
+      HandleCorruption(io_context));
+
+  mem_consumption_.Reset(memory_footprint());
+  return Status::OK();
+}
+
+Status CFileReader::ReadZoneMapOnce(const IOContext* io_context) {
+  TRACE_EVENT1("io", "CFileReader::ReadZoneMapOnce",
+               "cfile", ToString());
+  // The parsed zone map is kept by the reader, so there's no need to also
+  // keep the raw block in the cache.
+  BlockHandle handle;
+  RETURN_NOT_OK(ReadBlock(io_context, BlockPointer(footer().zone_map_block_ptr()),
+                          DONT_CACHE_BLOCK, &handle));
+  RETURN_NOT_OK_HANDLE_CORRUPTION(ZoneMap::Parse(type_info_, handle.data(), &zone_map_),
+                                  HandleCorruption(io_context));
+
+  // The zone map has been allocated; memory consumption has changed.
+  mem_consumption_.Reset(memory_footprint());
+  return Status::OK();
+}
+
 void CFileReader::HandleCorruption(const fs::IOContext* io_context) const {
   DCHECK(io_context);
   LOG(ERROR) << "Encountered corrupted CFile in filesystem block: " << block_->id().ToString();
@@ -617,6 +848,14 @@ size_t CFileReader::memory_footprint() const {
   if (footer_) {
     size += footer_->SpaceUsed();
   }
+  size += zone_map_once_.memory_footprint_excluding_this();
+  if (zone_map_) {
+    size += zone_map_->memory_footprint();
+  }
+  size += ordinal_index_once_.memory_footprint_excluding_this();
+  if (ordinal_index_) {
+    size += ordinal_index_->memory_footprint();
+  }
   return size;
 }
 
@@ -678,6 +917,15 @@ Status DefaultColumnValueIterator::FinishBatch() {
   return Status::OK();
 }
 
+Status DefaultColumnValueIterator::MayMatchPredicate(const ColumnPredicate& pred,
+                                                     rowid_t /* ord_idx */,
+                                                     size_t /* n */,
+                                                     bool* may_match) {
+  // Every value is the default value.
+  *may_match = pred.MayMatchRange(value_ == nullptr, value_ != nullptr, value_, value_);
+  return Status::OK();
+}
+
 ////////////////////////////////////////////////////////////
 // Iterator
 ////////////////////////////////////////////////////////////
@@ -685,11 +933,16 @@ CFileIterator::CFileIterator(CFileReader* reader,
                              CFileReader::CacheControl cache_control,
                              const IOContext* io_context)
   : reader_(reader),
+    num_codewords_matching_pred_(0),
     seeked_(nullptr),
+    seeked_ordinal_index_(nullptr),
+    ordinal_index_block_(0),
     prepared_(false),
     cache_control_(cache_control),
     last_prepare_idx_(-1),
     last_prepare_count_(-1),
+    last_block_end_(0),
+    readahead_end_(0),
     io_context_(io_context) {
 }
 
@@ -720,13 +973,22 @@ Status CFileIterator::SeekToOrdinal(rowid_t ord_idx) {
       return Status::NotSupported("no positional index in file");
     }
 
-    tmp_buf_.clear();
-    KeyEncoderTraits<UINT32, faststring>::Encode(ord_idx, &tmp_buf_);
-    RETURN_NOT_OK(posidx_iter_->SeekAtOrBefore(Slice(tmp_buf_)));
-
+    const OrdinalIndex* ordinal_index;
+    RETURN_NOT_OK(reader_->GetOrdinalIndex(io_context_, &ordinal_index));
     pblock_pool_scoped_ptr b = prepared_block_pool_.make_scoped_ptr(
       prepared_block_pool_.Construct());
-    RETURN_NOT_OK(ReadCurrentDataBlock(*posidx_iter_, b.get()));
+    if (ordinal_index != nullptr) {
+      // Look the block up in the ordinal index rather than walking the
+      // positional index down from its root.
+      ordinal_index_block_ = ordinal_index->FindBlock(ord_idx);
+      RETURN_NOT_OK(ReadDataBlock(ordinal_index->block_ptr(ordinal_index_block_), b.get()));
+      seeked_ordinal_index_ = ordinal_index;
+    } else {
+      tmp_buf_.clear();
+      KeyEncoderTraits<UINT32, faststring>::Encode(ord_idx, &tmp_buf_);
+      RETURN_NOT_OK(posidx_iter_->SeekAtOrBefore(Slice(tmp_buf_)));
+      RETURN_NOT_OK(ReadCurrentDataBlock(*posidx_iter_, b.get()));
+    }
 
     // If the data block doesn't actually contain the data
     // we're looking for, then we're probably in the last
@@ -832,14 +1094,7 @@ Status CFileIterator::SeekAtOrAfter(const EncodedKey &key,
     prepared_block_pool_.Construct());
   RETURN_NOT_OK(ReadCurrentDataBlock(*validx_iter_, b.get()));
 
-  Status dblk_seek_status;
-  if (key.num_key_columns() > 1) {
-    Slice slice = key.encoded_key();
-    dblk_seek_status = b->dblk_->SeekAtOrAfterValue(&slice, exact_match);
-  } else {
-    dblk_seek_status = b->dblk_->SeekAtOrAfterValue(key.raw_keys()[0],
-                                                    exact_match);
-  }
+  Status dblk_seek_status = SeekDataBlockAtOrAfter(key, b.get(), exact_match);
 
   // If seeking within the data block results in NotFound, then that indicates that the
   // value we're looking for fell after all the data in that block.
@@ -871,6 +1126,41 @@ Status CFileIterator::SeekAtOrAfter(const EncodedKey &key,
   return Status::OK();
 }
 
+Status CFileIterator::FindInDataBlock(const EncodedKey& key,
+                                      const BlockPointer& dblk_ptr,
+                                      bool* exact_match,
+                                      rowid_t* ordinal) {
+  RETURN_NOT_OK(PrepareForNewSeek());
+  DCHECK_EQ(reader_->is_nullable(), false);
+
+  pblock_pool_scoped_ptr b = prepared_block_pool_.make_scoped_ptr(
+    prepared_block_pool_.Construct());
+  RETURN_NOT_OK(ReadDataBlock(dblk_ptr, b.get()));
+
+  // The index key of the next block is after 'key', so if 'key' falls after
+  // all the data in this block, it isn't in the file.
+  Status s = SeekDataBlockAtOrAfter(key, b.get(), exact_match);
+  if (s.IsNotFound()) {
+    *exact_match = false;
+    return Status::OK();
+  }
+  RETURN_NOT_OK(s);
+  if (*exact_match) {
+    *ordinal = b->first_row_idx() + b->dblk_->GetCurrentIndex();
+  }
+  return Status::OK();
+}
+
+Status CFileIterator::SeekDataBlockAtOrAfter(const EncodedKey& key,
+                                             PreparedBlock* prep_block,
+                                             bool* exact_match) {
+  if (key.num_key_columns() > 1) {
+    Slice slice = key.encoded_key();
+    return prep_block->dblk_->SeekAtOrAfterValue(&slice, exact_match);
+  }
+  return prep_block->dblk_->SeekAtOrAfterValue(key.raw_keys()[0], exact_match);
+}
+
 Status CFileIterator::PrepareForNewSeek() {
   // Fully open the CFileReader if it was lazily opened earlier.
   //
@@ -894,7 +1184,8 @@ Status CFileIterator::PrepareForNewSeek() {
 
     // Cache the dictionary for performance
     RETURN_NOT_OK_PREPEND(
-        reader_->ReadBlock(io_context_, bp, CFileReader::CACHE_BLOCK, &dict_block_handle_),
+        reader_->ReadBlock(io_context_, bp, CFileReader::CACHE_BLOCK_HIGH_PRIORITY,
+                           &dict_block_handle_),
         "couldn't read dictionary block");
 
     dict_decoder_.reset(new BinaryPlainBlockDecoder(dict_block_handle_.data()));
@@ -905,6 +1196,7 @@ Status CFileIterator::PrepareForNewSeek() {
   }
 
   seeked_ = nullptr;
+  seeked_ordinal_index_ = nullptr;
   for (PreparedBlock *pb : prepared_blocks_) {
     prepared_block_pool_.Destroy(pb);
   }
@@ -941,9 +1233,49 @@ Status DecodeNullInfo(Slice *data_block, uint32_t *num_rows_in_block, Slice *nul
   return Status::OK();
 }
 
+void CFileIterator::MaybeReadahead(const BlockPointer& ptr) {
+  const uint64_t window = FLAGS_cfile_readahead_bytes;
+  if (window == 0) {
+    return;
+  }
+  const uint64_t block_end = ptr.offset() + ptr.size();
+
+  // Data blocks are written in order, interleaved only with index blocks, so
+  // a block starting shortly after the previous one ended means the file is
+  // being scanned sequentially. Point lookups and seeks don't read ahead.
+  const bool sequential = last_block_end_ != 0 &&
+      ptr.offset() >= last_block_end_ &&
+      ptr.offset() - last_block_end_ <= window;
+  last_block_end_ = block_end;
+  if (!sequential) {
+    readahead_end_ = block_end;
+    return;
+  }
+
+  // Extend the window once half of it has been consumed, so that the hint is
+  // issued once per 'window / 2' bytes rather than once per block.
+  if (block_end + window / 2 < readahead_end_) {
+    return;
+  }
+  const uint64_t start = std::max(block_end, readahead_end_);
+  const uint64_t end = std::min(block_end + window, reader_->file_size());
+  if (start >= end) {
+    return;
+  }
+  WARN_NOT_OK(reader_->Readahead(start, end - start),
+              Substitute("failed to read ahead CFile block $0 at $1",
+                         reader_->block_id().ToString(), start));
+  readahead_end_ = end;
+}
+
 Status CFileIterator::ReadCurrentDataBlock(const IndexTreeIterator &idx_iter,
                                            PreparedBlock *prep_block) {
-  prep_block->dblk_ptr_ = idx_iter.GetCurrentBlockPointer();
+  return ReadDataBlock(idx_iter.GetCurrentBlockPointer(), prep_block);
+}
+
+Status CFileIterator::ReadDataBlock(const BlockPointer& dblk_ptr, PreparedBlock* prep_block) {
+  prep_block->dblk_ptr_ = dblk_ptr;
+  MaybeReadahead(prep_block->dblk_ptr_);
   RETURN_NOT_OK(reader_->ReadBlock(io_context_, prep_block->dblk_ptr_,
                                    cache_control_, &prep_block->dblk_data_));
 
@@ -991,11 +1323,34 @@ Status CFileIterator::QueueCurrentDataBlock(const IndexTreeIterator &idx_iter) {
   return Status::OK();
 }
 
+Status CFileIterator::QueueNextDataBlock() {
+  if (seeked_ordinal_index_ == nullptr) {
+    RETURN_NOT_OK(seeked_->Next());
+    return QueueCurrentDataBlock(*seeked_);
+  }
+  if (ordinal_index_block_ + 1 == seeked_ordinal_index_->num_blocks()) {
+    return Status::NotFound("no more data blocks");
+  }
+  pblock_pool_scoped_ptr b = prepared_block_pool_.make_scoped_ptr(
+    prepared_block_pool_.Construct());
+  RETURN_NOT_OK(ReadDataBlock(seeked_ordinal_index_->block_ptr(ordinal_index_block_ + 1),
+                              b.get()));
+  ordinal_index_block_++;
+  prepared_blocks_.push_back(b.release());
+  return Status::OK();
+}
+
 bool CFileIterator::HasNext() const {
   CHECK(seeked_) << "not seeked";
   CHECK(!prepared_) << "Cannot call HasNext() mid-batch";
 
-  return !prepared_blocks_.empty() || seeked_->HasNext();
+  if (!prepared_blocks_.empty()) {
+    return true;
+  }
+  if (seeked_ordinal_index_ != nullptr) {
+    return ordinal_index_block_ + 1 < seeked_ordinal_index_->num_blocks();
+  }
+  return seeked_->HasNext();
 }
 
 Status CFileIterator::PrepareBatch(size_t *n) {
@@ -1010,14 +1365,13 @@ Status CFileIterator::PrepareBatch(size_t *n) {
   // Read blocks until all blocks covering the requested range are in the
   // prepared_blocks_ queue.
   while (prepared_blocks_.back()->last_row_idx() < end_idx) {
-    Status s = seeked_->Next();
+    Status s = QueueNextDataBlock();
     if (PREDICT_FALSE(s.IsNotFound())) {
       VLOG(1) << "Reached EOF";
       break;
     } else if (!s.ok()) {
       return s;
     }
-    RETURN_NOT_OK(QueueCurrentDataBlock(*seeked_));
   }
 
   // Seek the first block in the queue such that the first value to be read
@@ -1091,6 +1445,20 @@ Status CFileIterator::FinishBatch() {
   return Status::OK();
 }
 
+Status CFileIterator::MayMatchPredicate(const ColumnPredicate& pred, rowid_t ord_idx,
+                                        size_t n, bool* may_match) {
+  // The reader may have been opened lazily and not have been seeked yet.
+  RETURN_NOT_OK(reader_->Init(io_context_));
+  const ZoneMap* zone_map;
+  RETURN_NOT_OK(reader_->GetZoneMap(io_context_, &zone_map));
+  *may_match = zone_map == nullptr || n == 0 ||
+      zone_map->MayMatch(pred, ord_idx, ord_idx + n - 1);
+  if (!*may_match) {
+    TRACE_COUNTER_INCREMENT("cfile_zone_map_skipped_rows", n);
+  }
+  return Status::OK();
+}
+
 Status CFileIterator::Scan(ColumnMaterializationContext* ctx) {
   CHECK(seeked_) << "not seeked";
 
@@ -1113,6 +1481,7 @@ Status CFileIterator::Scan(ColumnMaterializationContext* ctx) {
           BitmapSet(codewords_matching_pred_->mutable_bitmap(), i);
         }
       }
+      num_codewords_matching_pred_ = codewords_matching_pred_->CountSelected();
     }
   }
   for (PreparedBlock *pb : prepared_blocks_) {
@@ -23,6 +23,7 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <glog/logging.h>
@@ -50,8 +51,10 @@
 namespace kudu {
 
 class ColumnMaterializationContext;
+class ColumnPredicate;
 class CompressionCodec;
 class EncodedKey;
+class MappedRegion;
 class SelectionVector;
 class TypeInfo;
 
@@ -67,6 +70,8 @@ class BinaryPlainBlockDecoder;
 class CFileIterator;
 class IndexTreeIterator;
 class TypeEncodingInfo;
+class OrdinalIndex;
+class ZoneMap;
 struct ReaderOptions;
 
 class CFileReader {
@@ -88,15 +93,27 @@ class CFileReader {
                            ReaderOptions options,
                            std::unique_ptr<CFileReader>* reader);
 
+  ~CFileReader();
+
   // Fully opens a previously lazily opened cfile, parsing and validating
   // its contents.
   //
   // May be called multiple times; subsequent calls will no-op.
   Status Init(const fs::IOContext* io_context);
 
+  // Returns whether Init() was called and succeeded.
+  bool initialized() const {
+    return init_once_.init_succeeded();
+  }
+
   enum CacheControl {
     CACHE_BLOCK,
-    DONT_CACHE_BLOCK
+    DONT_CACHE_BLOCK,
+    // Like CACHE_BLOCK, but the block is cached with high priority so that
+    // it's kept in preference to data blocks. Used for the blocks needed to
+    // locate data blocks or to skip them, e.g. index, bloom filter and
+    // dictionary blocks.
+    CACHE_BLOCK_HIGH_PRIORITY
   };
 
   // Can be called before Init().
@@ -106,15 +123,28 @@ class CFileReader {
 
   // Reads the data block pointed to by `ptr`. Will pull the data block from
   // the block cache if it exists, and reads from the filesystem block
-  // otherwise.
+  // otherwise. CACHE_BLOCK is treated as DONT_CACHE_BLOCK if the IO context
+  // hints that blocks are read once.
   Status ReadBlock(const fs::IOContext* io_context, const BlockPointer& ptr,
                    CacheControl cache_control, BlockHandle* ret) const;
 
+  // Hints that the 'length' bytes of the file starting at 'offset' will be
+  // read soon. See fs::ReadableBlock::Readahead().
+  Status Readahead(uint64_t offset, size_t length) const;
+
   // Return the number of rows in this cfile.
   // This is assumed to be reasonably fast (i.e does not scan
   // the data)
   Status CountRows(rowid_t *count) const;
 
+  // Sets 'blocks' to the ordinal of the first value and the pointer of each
+  // data block of the file, in ordinal order, as read from the positional
+  // index.
+  //
+  // REQUIRES: has_posidx()
+  Status ReadDataBlockPointers(const fs::IOContext* io_context,
+                               std::vector<std::pair<rowid_t, BlockPointer>>* blocks);
+
   // Retrieve the given metadata entry into 'val'.
   // Returns true if the entry was found, otherwise returns false.
   //
@@ -181,6 +211,23 @@ class CFileReader {
   // Returns true if the file has checksums on the header, footer, and data blocks.
   bool has_checksums() const;
 
+  // Return true if there are per-data-block statistics in this file.
+  bool has_zone_map() const { return footer().has_zone_map_block_ptr(); }
+
+  // Sets '*zone_map' to the zone map of this file, or to nullptr if the file
+  // has none. The zone map is read and parsed on first use and remains valid
+  // for the lifetime of this reader.
+  Status GetZoneMap(const fs::IOContext* io_context, const ZoneMap** zone_map);
+
+  // Return true if the pointers of the data blocks of this file are listed
+  // in an ordinal index.
+  bool has_ordinal_index() const { return footer().has_ordinal_index_block_ptr(); }
+
+  // Sets '*ordinal_index' to the ordinal index of this file, or to nullptr
+  // if the file has none. Like the zone map, the ordinal index is read and
+  // parsed on first use and remains valid for the lifetime of this reader.
+  Status GetOrdinalIndex(const fs::IOContext* io_context, const OrdinalIndex** ordinal_index);
+
   // Can be called before Init().
   std::string ToString() const { return block_->id().ToString(); }
 
@@ -198,10 +245,26 @@ class CFileReader {
   // Callback used in 'init_once_' to initialize this cfile.
   Status InitOnce(const fs::IOContext* io_context);
 
+  // Reads the block pointed to by 'ptr' from 'mapping_', verifying its
+  // checksum if needed.
+  Status ReadMappedBlock(const fs::IOContext* io_context, const BlockPointer& ptr,
+                         BlockHandle* ret) const;
+
   Status ReadAndParseHeader();
   Status ReadAndParseFooter();
+
+  // Callback used in 'zone_map_once_' to read the zone map of this cfile.
+  Status ReadZoneMapOnce(const fs::IOContext* io_context);
+
+  // Callback used in 'ordinal_index_once_' to read the ordinal index of this
+  // cfile.
+  Status ReadOrdinalIndexOnce(const fs::IOContext* io_context);
   Status VerifyChecksum(ArrayView<const Slice> data, const Slice& checksum) const;
 
+  // Compares an already-computed 'checksum_value' against the encoded
+  // 'checksum', returning Corruption if they differ.
+  Status CompareChecksum(uint32_t checksum_value, const Slice& checksum) const;
+
   // Returns the memory usage of the object including the object itself.
   size_t memory_footprint() const;
 
@@ -211,16 +274,30 @@ class CFileReader {
   const std::unique_ptr<fs::ReadableBlock> block_;
   const uint64_t file_size_;
 
+  // The memory mapping of the file the blocks are read from, if it's
+  // uncompressed and --cfile_mmap_reads is set. Declared after 'block_' so
+  // that it's unmapped first.
+  std::unique_ptr<MappedRegion> mapping_;
+
   uint8_t cfile_version_;
 
   gscoped_ptr<CFileHeaderPB> header_;
   gscoped_ptr<CFileFooterPB> footer_;
   const CompressionCodec* codec_;
+  // The codec of the file if it has a compression dictionary, in which case it
+  // isn't a singleton.
+  std::unique_ptr<CompressionCodec> owned_codec_;
   const TypeInfo *type_info_;
   const TypeEncodingInfo *type_encoding_info_;
 
   KuduOnceLambda init_once_;
 
+  std::unique_ptr<ZoneMap> zone_map_;
+  KuduOnceLambda zone_map_once_;
+
+  std::unique_ptr<OrdinalIndex> ordinal_index_;
+  KuduOnceLambda ordinal_index_once_;
+
   ScopedTrackedConsumption mem_consumption_;
 };
 
@@ -277,6 +354,17 @@ class ColumnIterator {
   // batch left off.
   virtual Status FinishBatch() = 0;
 
+  // Sets '*may_match' to false if none of the 'n' values starting at ordinal
+  // 'ord_idx' can match 'pred', in which case they need not be read at all.
+  // This doesn't change the position of the iterator.
+  //
+  // The default implementation conservatively sets '*may_match' to true.
+  virtual Status MayMatchPredicate(const ColumnPredicate& pred, rowid_t ord_idx,
+                                   size_t n, bool* may_match) {
+    *may_match = true;
+    return Status::OK();
+  }
+
   virtual const IteratorStats& io_statistics() const = 0;
 };
 
@@ -303,6 +391,9 @@ class DefaultColumnValueIterator : public ColumnIterator {
   Status Scan(ColumnMaterializationContext* ctx) override;
   Status FinishBatch() OVERRIDE;
 
+  Status MayMatchPredicate(const ColumnPredicate& pred, rowid_t ord_idx,
+                           size_t n, bool* may_match) override;
+
   const IteratorStats& io_statistics() const OVERRIDE { return io_stats_; }
 
  private:
@@ -345,6 +436,18 @@ class CFileIterator : public ColumnIterator {
   Status SeekAtOrAfter(const EncodedKey &encoded_key,
                        bool *exact_match);
 
+  // Looks up 'encoded_key' in the data block at 'dblk_ptr', bypassing the
+  // value index. The block must be the one the value index maps the key to,
+  // i.e. the last block whose index key is at or before it, or the first block
+  // if there's none.
+  //
+  // Sets *exact_match to indicate whether the block holds the key and, if it
+  // does, *ordinal to its ordinal index. The iterator is left unseeked.
+  Status FindInDataBlock(const EncodedKey& encoded_key,
+                         const BlockPointer& dblk_ptr,
+                         bool* exact_match,
+                         rowid_t* ordinal);
+
   // Return true if this reader is currently seeked.
   // If the iterator is not seeked, it is an error to call any functions except
   // for seek (including GetCurrentOrdinal).
@@ -381,6 +484,10 @@ class CFileIterator : public ColumnIterator {
   // batch left off.
   Status FinishBatch() OVERRIDE;
 
+  // Consults the zone map of the file, if any.
+  Status MayMatchPredicate(const ColumnPredicate& pred, rowid_t ord_idx,
+                           size_t n, bool* may_match) override;
+
   // Return true if the next call to PrepareBatch will return at least one row.
   bool HasNext() const;
 
@@ -403,6 +510,10 @@ class CFileIterator : public ColumnIterator {
   // single set of predicate-satisfying codewords.
   SelectionVector* GetCodeWordsMatchingPredicate() { return codewords_matching_pred_.get(); }
 
+  // Returns the number of codewords in GetCodeWordsMatchingPredicate() which
+  // pass the predicate.
+  size_t NumCodeWordsMatchingPredicate() const { return num_codewords_matching_pred_; }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(CFileIterator);
 
@@ -456,10 +567,29 @@ class CFileIterator : public ColumnIterator {
   Status ReadCurrentDataBlock(const IndexTreeIterator &idx_iter,
                               PreparedBlock *prep_block);
 
+  // Read the data block at 'dblk_ptr' into the given PreparedBlock structure.
+  Status ReadDataBlock(const BlockPointer& dblk_ptr, PreparedBlock* prep_block);
+
+  // Seek the data block of 'prep_block' to the first value at or after
+  // 'encoded_key'. Returns NotFound if all its values are before the key.
+  static Status SeekDataBlockAtOrAfter(const EncodedKey& encoded_key,
+                                       PreparedBlock* prep_block,
+                                       bool* exact_match);
+
+  // If the data block at 'ptr' continues a sequential scan, hints to the OS
+  // to read the next --cfile_readahead_bytes of the file in the background.
+  void MaybeReadahead(const BlockPointer& ptr);
+
   // Read the data block currently pointed to by idx_iter_, and enqueue
   // it onto the end of the prepared_blocks_ deque.
   Status QueueCurrentDataBlock(const IndexTreeIterator &idx_iter);
 
+  // Read the data block following the last one queued, in the ordinal index
+  // if the iterator was seeked with it or in seeked_ otherwise, and enqueue
+  // it onto the end of the prepared_blocks_ deque. Returns NotFound if the
+  // last queued block is the last one of the file.
+  Status QueueNextDataBlock();
+
   // Fully initialize the underlying cfile reader if needed, and clear any
   // seek-related state.
   Status PrepareForNewSeek();
@@ -475,11 +605,20 @@ class CFileIterator : public ColumnIterator {
 
   // Set containing the codewords that match the predicate in a dictionary.
   std::unique_ptr<SelectionVector> codewords_matching_pred_;
+  size_t num_codewords_matching_pred_;
 
   // The currently in-use index iterator. This is equal to either
   // posidx_iter_.get(), validx_iter_.get(), or NULL if not seeked.
   IndexTreeIterator *seeked_;
 
+  // The ordinal index of the file if the iterator was seeked with it rather
+  // than with posidx_iter_, in which case seeked_ is still set but isn't
+  // positioned, or NULL otherwise.
+  const OrdinalIndex* seeked_ordinal_index_;
+
+  // If seeked_ordinal_index_ is set, the index in it of the last queued block.
+  size_t ordinal_index_block_;
+
   // Data blocks that contain data relevant to the currently Prepared
   // batch of rows.
   // These pointers are allocated from the prepared_block_pool_ below.
@@ -502,6 +641,12 @@ class CFileIterator : public ColumnIterator {
   // Otherwise, 0.
   uint32_t last_prepare_count_;
 
+  // The end offset of the last data block read, or 0 if none has been read.
+  uint64_t last_block_end_;
+
+  // The end offset of the range of the file already hinted for read-ahead.
+  uint64_t readahead_end_;
+
   IteratorStats io_stats_;
 
   const fs::IOContext* io_context_;
@@ -29,7 +29,7 @@
 #include "kudu/common/columnblock.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/common/types.h"
-#include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/fastmem.h"
 #include "kudu/util/bitmap.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/memory/arena.h"
@@ -46,8 +46,10 @@ WriterOptions::WriterOptions()
     block_restart_interval(16),
     write_posidx(false),
     write_validx(false),
+    write_zone_map(false),
     optimize_index_keys(true),
-    validx_key_encoder(boost::none) {
+    validx_key_encoder(boost::none),
+    incompatible_features(0) {
 }
 
 Status DumpIterator(const CFileReader& reader,
@@ -107,38 +109,8 @@ ReaderOptions::ReaderOptions()
 }
 
 size_t CommonPrefixLength(const Slice& slice_a, const Slice& slice_b) {
-  // This implementation is modeled after strings::fastmemcmp_inlined().
-  int len = std::min(slice_a.size(), slice_b.size());
-  const uint8_t* a = slice_a.data();
-  const uint8_t* b = slice_b.data();
-  const uint8_t* a_limit = a + len;
-
-  const size_t sizeof_uint64 = sizeof(uint64_t);
-  // Move forward 8 bytes at a time until finding an unequal portion.
-  while (a + sizeof_uint64 <= a_limit &&
-         UNALIGNED_LOAD64(a) == UNALIGNED_LOAD64(b)) {
-    a += sizeof_uint64;
-    b += sizeof_uint64;
-  }
-
-  // Same, 4 bytes at a time.
-  const size_t sizeof_uint32 = sizeof(uint32_t);
-  while (a + sizeof_uint32 <= a_limit &&
-         UNALIGNED_LOAD32(a) == UNALIGNED_LOAD32(b)) {
-    a += sizeof_uint32;
-    b += sizeof_uint32;
-  }
-
-  // Now one byte at a time. We could do a 2-bytes-at-a-time loop,
-  // but we're following the example of fastmemcmp_inlined(). The benefit of
-  // 2-at-a-time likely doesn't outweigh the cost of added code size.
-  while (a < a_limit &&
-         *a == *b) {
-    a++;
-    b++;
-  }
-
-  return a - slice_a.data();
+  return strings::common_prefix_length(slice_a.data(), slice_b.data(),
+                                       std::min(slice_a.size(), slice_b.size()));
 }
 
 void GetSeparatingKey(const Slice& left, Slice* right) {
@@ -49,7 +49,24 @@ enum IncompatibleFeatures {
   // Write a crc32 checksum at the end of each cfile block
   CHECKSUM = 1 << 0,
 
-  SUPPORTED = NONE | CHECKSUM
+  // The bloom filters of a bloom file use the split-block layout.
+  SPLIT_BLOCK_BLOOM = 1 << 1,
+
+  // The filters of a bloom file are xor filters.
+  XOR_FILTER = 1 << 2,
+
+  // The blocks are compressed with the dictionary stored in the footer.
+  COMPRESSION_DICTIONARY = 1 << 3,
+
+  SUPPORTED = NONE | CHECKSUM | SPLIT_BLOCK_BLOOM | XOR_FILTER | COMPRESSION_DICTIONARY
+};
+
+// Used to set the CFileFooterPB bitset tracking compatible features
+enum CompatibleFeatures {
+  // Write per-data-block min/max statistics into a zone map block
+  ZONE_MAPS = 1 << 0,
+  // Write the pointers of the data blocks into an ordinal index block
+  ORDINAL_INDEX = 1 << 1
 };
 
 typedef std::function<void(const void*, faststring*)> ValidxKeyEncoder;
@@ -75,6 +92,11 @@ struct WriterOptions {
   // Whether the file needs a value index
   bool write_validx;
 
+  // Whether to write a zone map with per-data-block value statistics,
+  // allowing readers to skip blocks based on predicates. Only applies to
+  // data blocks written with AppendEntries() or AppendNullableEntries().
+  bool write_zone_map;
+
   // Whether to optimize index keys by storing shortest separating prefixes
   // instead of entire keys.
   bool optimize_index_keys;
@@ -89,6 +111,12 @@ struct WriterOptions {
   // encodes the entire value.
   boost::optional<ValidxKeyEncoder> validx_key_encoder;
 
+  // Incompatible features of the data, set in the footer along with those of
+  // the file format, so that readers not supporting them refuse the file.
+  //
+  // Default: 0
+  uint32_t incompatible_features;
+
   WriterOptions();
 };
 
@@ -17,6 +17,7 @@
 
 #include "kudu/cfile/cfile_writer.h"
 
+#include <algorithm>
 #include <functional>
 #include <numeric>
 #include <ostream>
@@ -28,16 +29,21 @@
 
 #include "kudu/cfile/block_compression.h"
 #include "kudu/cfile/block_encodings.h"
+#include "kudu/cfile/block_handle.h"
 #include "kudu/cfile/block_pointer.h"
 #include "kudu/cfile/cfile.pb.h"
+#include "kudu/cfile/cfile_reader.h"
 #include "kudu/cfile/cfile_util.h"
 #include "kudu/cfile/index_btree.h"
+#include "kudu/cfile/ordinal_index.h"
 #include "kudu/cfile/type_encodings.h"
+#include "kudu/cfile/zone_map.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/key_encoder.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/array_view.h" // IWYU pragma: keep
 #include "kudu/util/coding-inl.h"
 #include "kudu/util/coding.h"
@@ -60,15 +66,40 @@ DEFINE_bool(cfile_write_checksums, true,
             "Write CRC32 checksums for each block");
 TAG_FLAG(cfile_write_checksums, evolving);
 
+DEFINE_bool(cfile_write_zone_maps, true,
+            "Write per-block min/max statistics for cfiles which request them, "
+            "allowing scans to skip blocks which can't match their predicates");
+TAG_FLAG(cfile_write_zone_maps, evolving);
+
+DEFINE_bool(cfile_write_ordinal_index, true,
+            "Write the pointers of all the data blocks of cfiles which have a "
+            "positional index into an ordinal index block, which lets readers "
+            "find the block of an ordinal without walking the positional index");
+TAG_FLAG(cfile_write_ordinal_index, evolving);
+
+DEFINE_int32(cfile_compression_dictionary_size, 0,
+             "The maximum size of the dictionary trained for each ZSTD-compressed "
+             "cfile on its first data blocks. Dictionaries improve the compression "
+             "of small blocks of similar values. If 0, cfiles are compressed without "
+             "dictionaries.");
+TAG_FLAG(cfile_compression_dictionary_size, experimental);
+
+DEFINE_int64(cfile_compression_dictionary_training_size, 1024 * 1024,
+             "The amount of data block data buffered to train the compression "
+             "dictionary of a cfile. See --cfile_compression_dictionary_size.");
+TAG_FLAG(cfile_compression_dictionary_training_size, experimental);
+
 using google::protobuf::RepeatedPtrField;
 using kudu::fs::BlockCreationTransaction;
 using kudu::fs::BlockManager;
+using kudu::fs::IOContext;
 using kudu::fs::WritableBlock;
 using std::accumulate;
 using std::pair;
 using std::string;
 using std::unique_ptr;
 using std::vector;
+using strings::Substitute;
 
 namespace kudu {
 namespace cfile {
@@ -80,6 +111,12 @@ const size_t kChecksumSize = sizeof(uint32_t);
 
 static const size_t kMinBlockSize = 512;
 
+// The size of the pieces the buffered blocks are split into to train a
+// compression dictionary, and the minimum ratio of their total size to the
+// dictionary size: with less data, a dictionary doesn't pay for itself.
+static const size_t kDictionarySampleSize = 4096;
+static const int kMinDictionaryTrainingRatio = 10;
+
 static CompressionType GetDefaultCompressionCodec() {
   return GetCompressionCodecType(FLAGS_cfile_default_compression_codec);
 }
@@ -98,7 +135,10 @@ CFileWriter::CFileWriter(WriterOptions options,
     value_count_(0),
     options_(std::move(options)),
     is_nullable_(is_nullable),
+    compression_level_(0),
     typeinfo_(typeinfo),
+    training_dictionary_(false),
+    buffered_size_(0),
     state_(kWriterInitialized) {
   EncodingType encoding = options_.storage_attributes.encoding;
   Status s = TypeEncodingInfo::Get(typeinfo_, encoding, &type_encoding_info_);
@@ -141,6 +181,14 @@ CFileWriter::CFileWriter(WriterOptions options,
 
     validx_builder_.reset(new IndexTreeBuilder(&options_, this));
   }
+
+  if (options_.write_zone_map && FLAGS_cfile_write_zone_maps) {
+    zone_map_builder_.reset(new ZoneMapBuilder(typeinfo_));
+  }
+
+  if (options_.write_posidx && FLAGS_cfile_write_ordinal_index) {
+    ordinal_index_builder_.reset(new OrdinalIndexBuilder());
+  }
 }
 
 CFileWriter::~CFileWriter() {
@@ -154,7 +202,18 @@ Status CFileWriter::Start() {
   if (compression_ != NO_COMPRESSION) {
     const CompressionCodec* codec;
     RETURN_NOT_OK(GetCompressionCodec(compression_, &codec));
+    if (options_.storage_attributes.compression_level != 0) {
+      CompressionCodecOptions codec_opts;
+      codec_opts.level = options_.storage_attributes.compression_level;
+      Status s = NewCompressionCodec(compression_, codec_opts, &owned_codec_);
+      WARN_NOT_OK(s, "Falling back to the default compression level");
+      if (s.ok()) {
+        codec = owned_codec_.get();
+        compression_level_ = codec_opts.level;
+      }
+    }
     block_compressor_ .reset(new CompressedBlockBuilder(codec));
+    training_dictionary_ = compression_ == ZSTD && FLAGS_cfile_compression_dictionary_size > 0;
   }
 
   CFileHeaderPB header;
@@ -212,13 +271,19 @@ Status CFileWriter::FinishAndReleaseBlock(BlockCreationTransaction* transaction)
 
   // Write out any pending values as the last data block.
   RETURN_NOT_OK(FinishCurDataBlock());
+  if (training_dictionary_) {
+    RETURN_NOT_OK(TrainDictionaryAndWriteBufferedBlocks());
+  }
 
   state_ = kWriterFinished;
 
-  uint32_t incompatible_features = 0;
+  uint32_t incompatible_features = options_.incompatible_features;
   if (FLAGS_cfile_write_checksums) {
     incompatible_features |= IncompatibleFeatures::CHECKSUM;
   }
+  if (!compression_dictionary_.empty()) {
+    incompatible_features |= IncompatibleFeatures::COMPRESSION_DICTIONARY;
+  }
 
   // Start preparing the footer.
   CFileFooterPB footer;
@@ -227,6 +292,9 @@ Status CFileWriter::FinishAndReleaseBlock(BlockCreationTransaction* transaction)
   footer.set_encoding(type_encoding_info_->encoding_type());
   footer.set_num_values(value_count_);
   footer.set_compression(compression_);
+  if (!compression_dictionary_.empty()) {
+    footer.set_compression_dictionary(compression_dictionary_);
+  }
   footer.set_incompatible_features(incompatible_features);
 
   // Write out any pending positional index blocks.
@@ -243,6 +311,31 @@ Status CFileWriter::FinishAndReleaseBlock(BlockCreationTransaction* transaction)
     footer.mutable_validx_info()->CopyFrom(validx_info);
   }
 
+  if (zone_map_builder_ != nullptr) {
+    faststring zone_map_str;
+    pb_util::SerializeToString(zone_map_builder_->zone_map(), &zone_map_str);
+    vector<Slice> zone_map_slices = { Slice(zone_map_str) };
+    BlockPointer zone_map_ptr;
+    RETURN_NOT_OK_PREPEND(AddBlock(zone_map_slices, &zone_map_ptr, "zone map block"),
+                          "Couldn't write zone map");
+    zone_map_ptr.CopyToPB(footer.mutable_zone_map_block_ptr());
+    footer.set_compatible_features(footer.compatible_features() |
+                                   CompatibleFeatures::ZONE_MAPS);
+  }
+
+  if (ordinal_index_builder_ != nullptr && ordinal_index_builder_->num_blocks() > 0) {
+    faststring ordinal_index_str;
+    pb_util::SerializeToString(ordinal_index_builder_->ordinal_index(), &ordinal_index_str);
+    vector<Slice> ordinal_index_slices = { Slice(ordinal_index_str) };
+    BlockPointer ordinal_index_ptr;
+    RETURN_NOT_OK_PREPEND(AddBlock(ordinal_index_slices, &ordinal_index_ptr,
+                                   "ordinal index block"),
+                          "Couldn't write ordinal index");
+    ordinal_index_ptr.CopyToPB(footer.mutable_ordinal_index_block_ptr());
+    footer.set_compatible_features(footer.compatible_features() |
+                                   CompatibleFeatures::ORDINAL_INDEX);
+  }
+
   // Optionally append extra information to the end of cfile.
   // Example: dictionary block for dictionary encoding
   RETURN_NOT_OK(data_block_->AppendExtraInfo(this, &footer));
@@ -310,6 +403,9 @@ Status CFileWriter::AppendEntries(const void *entries, size_t count) {
   while (rem > 0) {
     int n = data_block_->Add(ptr, rem);
     DCHECK_GE(n, 0);
+    if (zone_map_builder_ != nullptr) {
+      zone_map_builder_->AddValues(ptr, n);
+    }
 
     ptr += typeinfo_->size() * n;
     rem -= n;
@@ -342,6 +438,9 @@ Status CFileWriter::AppendNullableEntries(const uint8_t *bitmap,
         DCHECK_GE(n, 0);
 
         null_bitmap_builder_->AddRun(true, n);
+        if (zone_map_builder_ != nullptr) {
+          zone_map_builder_->AddValues(ptr, n);
+        }
         ptr += n * typeinfo_->size();
         value_count_ += n;
         rem -= n;
@@ -353,6 +452,9 @@ Status CFileWriter::AppendNullableEntries(const uint8_t *bitmap,
       } while (rem > 0);
     } else {
       null_bitmap_builder_->AddRun(false, nblock);
+      if (zone_map_builder_ != nullptr) {
+        zone_map_builder_->AddNulls(nblock);
+      }
       ptr += nblock * typeinfo_->size();
       value_count_ += nblock;
     }
@@ -408,6 +510,10 @@ Status CFileWriter::FinishCurDataBlock() {
     null_bitmap_builder_->Reset();
   }
 
+  if (zone_map_builder_ != nullptr) {
+    zone_map_builder_->FinishBlock(first_elem_ord);
+  }
+
   if (validx_builder_ != nullptr) {
     RETURN_NOT_OK(data_block_->GetLastKey(key_tmp_space));
     (*options_.validx_key_encoder)(key_tmp_space, &last_key_);
@@ -424,6 +530,40 @@ Status CFileWriter::AppendRawBlock(const vector<Slice>& data_slices,
                                    const char *name_for_log) {
   CHECK_EQ(state_, kWriterWriting);
 
+  Slice idx_key;
+  if (validx_builder_ != nullptr) {
+    CHECK(validx_curr != nullptr) <<
+      "must pass a key for raw block if validx is configured";
+
+    (*options_.validx_key_encoder)(validx_curr, &tmp_buf_);
+    idx_key = Slice(tmp_buf_);
+    if (options_.optimize_index_keys) {
+      GetSeparatingKey(validx_prev, &idx_key);
+    }
+  }
+
+  if (training_dictionary_) {
+    BufferedBlock block;
+    for (const Slice& data : data_slices) {
+      block.data.append(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+    block.ordinal_pos = ordinal_pos;
+    block.validx_key = idx_key.ToString();
+    block.name_for_log = name_for_log;
+    buffered_size_ += block.data.size();
+    buffered_blocks_.emplace_back(std::move(block));
+    if (buffered_size_ >= FLAGS_cfile_compression_dictionary_training_size) {
+      return TrainDictionaryAndWriteBufferedBlocks();
+    }
+    return Status::OK();
+  }
+  return WriteRawBlock(data_slices, ordinal_pos, idx_key, name_for_log);
+}
+
+Status CFileWriter::WriteRawBlock(const vector<Slice>& data_slices,
+                                  size_t ordinal_pos,
+                                  const Slice& validx_key,
+                                  const char* name_for_log) {
   BlockPointer ptr;
   Status s = AddBlock(data_slices, &ptr, name_for_log);
   if (!s.ok()) {
@@ -433,23 +573,19 @@ Status CFileWriter::AppendRawBlock(const vector<Slice>& data_slices,
 
   // Now add to the index blocks
   if (posidx_builder_ != nullptr) {
-    tmp_buf_.clear();
-    KeyEncoderTraits<UINT32, faststring>::Encode(ordinal_pos, &tmp_buf_);
-    RETURN_NOT_OK(posidx_builder_->Append(Slice(tmp_buf_), ptr));
+    // 'validx_key' may point into 'tmp_buf_'.
+    faststring posidx_key;
+    KeyEncoderTraits<UINT32, faststring>::Encode(ordinal_pos, &posidx_key);
+    RETURN_NOT_OK(posidx_builder_->Append(Slice(posidx_key), ptr));
+  }
+  if (ordinal_index_builder_ != nullptr) {
+    ordinal_index_builder_->AddBlock(ordinal_pos, ptr);
   }
 
   if (validx_builder_ != nullptr) {
-    CHECK(validx_curr != nullptr) <<
-      "must pass a key for raw block if validx is configured";
-
-    (*options_.validx_key_encoder)(validx_curr, &tmp_buf_);
-    Slice idx_key = Slice(tmp_buf_);
-    if (options_.optimize_index_keys) {
-      GetSeparatingKey(validx_prev, &idx_key);
-    }
     VLOG(1) << "Appending validx entry\n" <<
-            kudu::HexDump(idx_key);
-    s = validx_builder_->Append(idx_key, ptr);
+            kudu::HexDump(validx_key);
+    s = validx_builder_->Append(validx_key, ptr);
     if (!s.ok()) {
       LOG(WARNING) << "Unable to append to value index: " << s.ToString();
       return s;
@@ -459,6 +595,184 @@ Status CFileWriter::AppendRawBlock(const vector<Slice>& data_slices,
   return s;
 }
 
+Status CFileWriter::TrainDictionaryAndWriteBufferedBlocks() {
+  DCHECK(training_dictionary_);
+  training_dictionary_ = false;
+
+  const size_t max_dictionary_size = FLAGS_cfile_compression_dictionary_size;
+  if (buffered_size_ >= kMinDictionaryTrainingRatio * max_dictionary_size) {
+    vector<Slice> samples;
+    for (const BufferedBlock& block : buffered_blocks_) {
+      for (size_t off = 0; off < block.data.size(); off += kDictionarySampleSize) {
+        samples.emplace_back(block.data.data() + off,
+                             std::min(kDictionarySampleSize, block.data.size() - off));
+      }
+    }
+    string dictionary;
+    Status s = TrainCompressionDictionary(samples, max_dictionary_size, &dictionary);
+    if (s.ok()) {
+      CompressionCodecOptions codec_opts;
+      codec_opts.level = compression_level_;
+      codec_opts.dictionary = dictionary;
+      unique_ptr<CompressionCodec> codec;
+      RETURN_NOT_OK(NewCompressionCodec(compression_, codec_opts, &codec));
+      block_compressor_.reset(new CompressedBlockBuilder(codec.get()));
+      owned_codec_ = std::move(codec);
+      compression_dictionary_ = std::move(dictionary);
+      VLOG(1) << Substitute("Trained a compression dictionary of $0 bytes on $1 bytes",
+                            compression_dictionary_.size(), buffered_size_);
+    } else {
+      VLOG(1) << "Compressing without a dictionary: " << s.ToString();
+    }
+  }
+
+  for (const BufferedBlock& block : buffered_blocks_) {
+    RETURN_NOT_OK(WriteRawBlock({ Slice(block.data) }, block.ordinal_pos,
+                                Slice(block.validx_key), block.name_for_log));
+  }
+  vector<BufferedBlock>().swap(buffered_blocks_);
+  buffered_size_ = 0;
+  return Status::OK();
+}
+
+// Return the offset, in a data block of the given encoding, of the ordinal of
+// the first value of the block, or -1 if the blocks of the encoding can't be
+// relocated to other ordinals by rewriting it. The header of prefix encoded
+// blocks is variable-length, and dictionary encoded blocks refer to the
+// dictionary of their own file.
+static int DataBlockOrdinalOffset(DataType physical_type, EncodingType encoding) {
+  switch (encoding) {
+    case BIT_SHUFFLE:
+      return 0;
+    case PLAIN_ENCODING:
+      return physical_type == BINARY ? 0 : 4;
+    case RLE:
+    case DELTA_BIT_PACKED:
+      return 4;
+    default:
+      return -1;
+  }
+}
+
+bool CFileWriter::CanAppendDataBlocks(const CFileReader& reader) const {
+  return reader.type_info() == typeinfo_ &&
+      reader.type_encoding_info()->encoding_type() == type_encoding_info_->encoding_type() &&
+      reader.is_nullable() == is_nullable_ &&
+      reader.has_posidx() &&
+      validx_builder_ == nullptr &&
+      DataBlockOrdinalOffset(typeinfo_->physical_type(),
+                             type_encoding_info_->encoding_type()) >= 0;
+}
+
+Status CFileWriter::AppendDataBlocks(CFileReader* reader, const IOContext* io_context) {
+  rowid_t num_rows;
+  RETURN_NOT_OK(reader->CountRows(&num_rows));
+  return AppendDataBlocks(reader, 0, num_rows, io_context);
+}
+
+Status CFileWriter::AppendDataBlocks(CFileReader* reader,
+                                     rowid_t first_ordinal,
+                                     rowid_t last_ordinal,
+                                     const IOContext* io_context) {
+  CHECK_EQ(state_, kWriterWriting);
+  DCHECK(CanAppendDataBlocks(*reader));
+  const int ordinal_offset = DataBlockOrdinalOffset(typeinfo_->physical_type(),
+                                                    type_encoding_info_->encoding_type());
+  rowid_t num_rows;
+  RETURN_NOT_OK(reader->CountRows(&num_rows));
+  if (PREDICT_FALSE(first_ordinal > last_ordinal || last_ordinal > num_rows)) {
+    return Status::InvalidArgument(Substitute("$0: invalid range of values [$1, $2)",
+                                              reader->ToString(), first_ordinal, last_ordinal));
+  }
+  if (first_ordinal == last_ordinal) {
+    return Status::OK();
+  }
+
+  // The number of values of each block is only known from the index entry of
+  // the next one.
+  vector<pair<rowid_t, BlockPointer>> blocks;
+  RETURN_NOT_OK(reader->ReadDataBlockPointers(io_context, &blocks));
+  const auto block_starting_at = [&](rowid_t ordinal) {
+    return std::lower_bound(blocks.begin(), blocks.end(), ordinal,
+                            [](const pair<rowid_t, BlockPointer>& b, rowid_t o) {
+                              return b.first < o;
+                            }) - blocks.begin();
+  };
+  const int first_block = block_starting_at(first_ordinal);
+  const int end_block = block_starting_at(last_ordinal);
+  if (PREDICT_FALSE(first_block == blocks.size() ||
+                    blocks[first_block].first != first_ordinal ||
+                    (end_block < blocks.size() && blocks[end_block].first != last_ordinal))) {
+    return Status::InvalidArgument(
+        Substitute("$0: values [$1, $2) don't start and end at data block boundaries",
+                   reader->ToString(), first_ordinal, last_ordinal));
+  }
+
+  // The copied blocks start after the values appended so far.
+  RETURN_NOT_OK(FinishCurDataBlock());
+  const rowid_t dst_first_ordinal = value_count_;
+
+  const ZoneMap* zone_map = nullptr;
+  if (zone_map_builder_ != nullptr && reader->has_zone_map()) {
+    RETURN_NOT_OK(reader->GetZoneMap(io_context, &zone_map));
+  }
+
+  faststring buf;
+  for (int i = first_block; i < end_block; i++) {
+    const rowid_t src_ordinal = blocks[i].first;
+    const rowid_t num_values =
+        (i + 1 < blocks.size() ? blocks[i + 1].first : num_rows) - src_ordinal;
+    const rowid_t dst_ordinal = dst_first_ordinal + (src_ordinal - first_ordinal);
+
+    BlockHandle dblk;
+    RETURN_NOT_OK(reader->ReadBlock(io_context, blocks[i].second,
+                                    CFileReader::DONT_CACHE_BLOCK, &dblk));
+    buf.assign_copy(dblk.data().data(), dblk.data().size());
+
+    // Skip the null header, if any, and rewrite the ordinal of the block.
+    Slice data(buf);
+    if (is_nullable_) {
+      uint32_t num_elems;
+      uint32_t null_bitmap_size;
+      if (PREDICT_FALSE(!GetVarint32(&data, &num_elems) ||
+                        !GetVarint32(&data, &null_bitmap_size) ||
+                        num_elems != num_values ||
+                        data.size() < null_bitmap_size)) {
+        return Status::Corruption(Substitute("$0: bad null header in block $1",
+                                             reader->ToString(),
+                                             blocks[i].second.ToString()));
+      }
+      data.remove_prefix(null_bitmap_size);
+    }
+    if (PREDICT_FALSE(data.size() < ordinal_offset + sizeof(uint32_t) ||
+                      DecodeFixed32(data.data() + ordinal_offset) != src_ordinal)) {
+      return Status::Corruption(Substitute("$0: bad header in block $1",
+                                           reader->ToString(),
+                                           blocks[i].second.ToString()));
+    }
+    InlineEncodeFixed32(buf.data() + (data.data() - buf.data()) + ordinal_offset,
+                        dst_ordinal);
+
+    RETURN_NOT_OK(AppendRawBlock({ Slice(buf) }, dst_ordinal, nullptr, Slice(),
+                                 "copied data block"));
+    value_count_ += num_values;
+
+    if (zone_map_builder_ != nullptr) {
+      const ZoneMapEntryPB* entry =
+          zone_map != nullptr ? zone_map->FindBlockEntry(src_ordinal) : nullptr;
+      // Blocks without an entry may match any predicate.
+      if (entry != nullptr && entry->num_values() == num_values) {
+        zone_map_builder_->AddBlockEntry(*entry, dst_ordinal);
+      }
+    }
+  }
+  DCHECK_EQ(dst_first_ordinal + (last_ordinal - first_ordinal), value_count_);
+  VLOG(1) << Substitute("Copied $0 data blocks of values $1-$2 from $3",
+                        end_block - first_block, dst_first_ordinal, value_count_,
+                        reader->ToString());
+  return Status::OK();
+}
+
 Status CFileWriter::AddBlock(const vector<Slice> &data_slices,
                              BlockPointer *block_ptr,
                              const char *name_for_log) {
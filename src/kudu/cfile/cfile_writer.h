@@ -47,18 +47,26 @@ class RepeatedPtrField; // IWYU pragma: keep
 
 namespace kudu {
 
+class CompressionCodec;
 class TypeInfo;
 template <typename Buffer>
 class KeyEncoder;
 
+namespace fs {
+struct IOContext;
+} // namespace fs
+
 namespace cfile {
 
 class BlockBuilder;
 class BlockPointer;
+class CFileReader;
 class CompressedBlockBuilder;
 class FileMetadataPairPB;
 class IndexTreeBuilder;
+class OrdinalIndexBuilder;
 class TypeEncodingInfo;
+class ZoneMapBuilder;
 
 // Magic used in header/footer
 extern const char kMagicStringV1[];
@@ -158,6 +166,30 @@ class CFileWriter {
                         const Slice &validx_prev,
                         const char *name_for_log);
 
+  // Return true if the data blocks of 'reader' may be appended to this file
+  // by AppendDataBlocks(): the files must have the same type, encoding and
+  // nullability, this file must not have a value index, and the blocks of
+  // the encoding must be relocatable to other ordinals.
+  bool CanAppendDataBlocks(const CFileReader& reader) const;
+
+  // Append all the values of 'reader' after those appended so far, copying
+  // its data blocks rather than decoding and re-encoding their values. Only
+  // the ordinals in the block headers are rewritten, and the blocks are
+  // decompressed and compressed again if the files are compressed. The index
+  // entries of the blocks are rebuilt, and their zone map entries, if any,
+  // are copied.
+  //
+  // REQUIRES: CanAppendDataBlocks(*reader)
+  Status AppendDataBlocks(CFileReader* reader, const fs::IOContext* io_context);
+
+  // Like the above, but only appends the values of 'reader' of ordinals in
+  // [first_ordinal, last_ordinal). 'first_ordinal' must be the first ordinal
+  // of a data block, and 'last_ordinal' the first ordinal of a data block or
+  // the number of values of 'reader'.
+  Status AppendDataBlocks(CFileReader* reader,
+                          rowid_t first_ordinal,
+                          rowid_t last_ordinal,
+                          const fs::IOContext* io_context);
 
   // Return the amount of data written so far to this CFile.
   // More data may be written by Finish(), but this is an approximation.
@@ -165,7 +197,7 @@ class CFileWriter {
     // This is a low estimate, but that's OK -- this is checked after every block
     // write during flush/compact, so better to give a fast slightly-inaccurate result
     // than spend a lot of effort trying to improve accuracy by a few KB.
-    return off_;
+    return off_ + buffered_size_;
   }
 
   // Return the number of values written to the file.
@@ -200,6 +232,18 @@ class CFileWriter {
 
   Status WriteRawData(const std::vector<Slice>& data);
 
+  // Append the given block into the file, adding it to the various indexes
+  // with the given value index key.
+  Status WriteRawBlock(const std::vector<Slice>& data_slices,
+                       size_t ordinal_pos,
+                       const Slice& validx_key,
+                       const char* name_for_log);
+
+  // Train the compression dictionary on the buffered blocks, falling back to
+  // compressing without a dictionary if there isn't enough data, then write
+  // the buffered blocks.
+  Status TrainDictionaryAndWriteBufferedBlocks();
+
   Status FinishCurDataBlock();
 
   // Flush the current unflushed_metadata_ entries into the given protobuf
@@ -220,6 +264,8 @@ class CFileWriter {
   // Type of data being written
   bool is_nullable_;
   CompressionType compression_;
+  // The compression level, or 0 for the codec's default.
+  int compression_level_;
   const TypeInfo* typeinfo_;
   const TypeEncodingInfo* type_encoding_info_;
 
@@ -238,6 +284,30 @@ class CFileWriter {
   gscoped_ptr<IndexTreeBuilder> validx_builder_;
   gscoped_ptr<NullBitmapBuilder> null_bitmap_builder_;
   gscoped_ptr<CompressedBlockBuilder> block_compressor_;
+  std::unique_ptr<ZoneMapBuilder> zone_map_builder_;
+  std::unique_ptr<OrdinalIndexBuilder> ordinal_index_builder_;
+
+  // The codec of 'block_compressor_' if it has a level or a dictionary, in
+  // which case it isn't a singleton.
+  std::unique_ptr<CompressionCodec> owned_codec_;
+
+  // A block appended while the compression dictionary is being trained.
+  struct BufferedBlock {
+    std::string data;
+    size_t ordinal_pos;
+    std::string validx_key;
+    const char* name_for_log;
+  };
+
+  // Whether the first blocks of a ZSTD-compressed file are buffered to
+  // train its compression dictionary, which must be known before any block
+  // is written.
+  bool training_dictionary_;
+  std::vector<BufferedBlock> buffered_blocks_;
+  size_t buffered_size_;
+
+  // The dictionary the blocks are compressed with, if any.
+  std::string compression_dictionary_;
 
   enum State {
     kWriterInitialized,
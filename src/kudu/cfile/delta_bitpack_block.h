@@ -0,0 +1,508 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Delta + frame-of-reference bit-packing encoding for integer types, meant
+// for sorted or nearly sorted columns such as time series keys.
+//
+// The values of a block are split into miniblocks of kDeltaMiniBlockSize
+// values. Each miniblock stores its first value, and the differences between
+// consecutive values relative to the smallest difference in the miniblock,
+// bit-packed at the width of the largest such relative difference. A
+// monotonically increasing column of ids or timestamps with a regular step
+// thus packs to a few bits per value, or none at all.
+//
+// Block layout:
+//
+//   num_elems           fixed32
+//   ordinal_pos_base    fixed32
+//   miniblock directory one entry per miniblock:
+//     first_value       sizeof(CppType) bytes
+//     min_delta         sizeof(CppType) bytes
+//     bit_width         1 byte
+//     data_offset       fixed32, offset of the packed deltas in the block
+//   packed deltas       per miniblock, (count - 1) deltas of bit_width bits,
+//                       least significant bit first, padded to a byte
+//   padding             kDeltaBlockPaddingBytes zero bytes
+//
+// Since every miniblock is addressable from the directory, seeking to an
+// ordinal only decodes the miniblock containing it, and seeking to a value
+// binary searches the miniblocks' first values before decoding one.
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "kudu/cfile/block_encodings.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/rowid.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/coding-inl.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+namespace cfile {
+
+// The number of values in each miniblock.
+static const size_t kDeltaMiniBlockSize = 128;
+
+static const size_t kDeltaBlockHeaderSize = sizeof(uint32_t) * 2;
+
+// Padding at the end of the block, so that unpacking may always load two
+// 64-bit words starting at the byte of a value.
+static const size_t kDeltaBlockPaddingBytes = 16;
+
+namespace internal {
+
+// Returns the number of bits needed to represent 'v'.
+inline int BitWidth(uint64_t v) {
+  return v == 0 ? 0 : 64 - __builtin_clzll(v);
+}
+
+// Packs each of the 'n' values of 'vals', which must fit in 'width' bits,
+// into 'width' bits of 'out', least significant bit first.
+inline void PackBits(const uint64_t* vals, size_t n, int width, faststring* out) {
+  if (width == 0) return;
+  uint64_t acc = 0;
+  int nbits = 0;
+  for (size_t i = 0; i < n; i++) {
+    const uint64_t v = vals[i];
+    acc |= v << nbits;
+    const int total = nbits + width;
+    if (total >= 64) {
+      uint8_t buf[8];
+      InlineEncodeFixed64(buf, acc);
+      out->append(buf, 8);
+      acc = nbits == 0 ? 0 : v >> (64 - nbits);
+      nbits = total - 64;
+    } else {
+      nbits = total;
+    }
+  }
+  if (nbits > 0) {
+    uint8_t buf[8];
+    InlineEncodeFixed64(buf, acc);
+    out->append(buf, (nbits + 7) / 8);
+  }
+}
+
+// Unpacks 'n' values of 'width' bits from 'data' into 'out'. The loop has no
+// dependencies between iterations, so it vectorizes.
+//
+// REQUIRES: kDeltaBlockPaddingBytes bytes are readable after the packed
+// values.
+template <typename U>
+inline void UnpackBits(const uint8_t* data, size_t n, int width, U* out) {
+  if (width == 0) {
+    std::fill_n(out, n, 0);
+    return;
+  }
+  const uint64_t mask = width == 64 ? ~0ULL : (1ULL << width) - 1;
+  if (width <= 56) {
+    // Every value lies within the 64-bit word starting at its first byte.
+    for (size_t i = 0; i < n; i++) {
+      const size_t bit_pos = i * width;
+      const uint64_t word = UnalignedLoad<uint64_t>(data + bit_pos / 8);
+      out[i] = static_cast<U>((word >> (bit_pos % 8)) & mask);
+    }
+  } else {
+    for (size_t i = 0; i < n; i++) {
+      const size_t bit_pos = i * width;
+      const int shift = bit_pos % 8;
+      const uint8_t* p = data + bit_pos / 8;
+      uint64_t v = UnalignedLoad<uint64_t>(p) >> shift;
+      if (shift > 0) {
+        v |= UnalignedLoad<uint64_t>(p + 8) << (64 - shift);
+      }
+      out[i] = static_cast<U>(v & mask);
+    }
+  }
+}
+
+} // namespace internal
+
+//
+// Builder for the delta bit-packing encoding.
+//
+template<DataType Type>
+class DeltaBitPackBlockBuilder final : public BlockBuilder {
+ public:
+  explicit DeltaBitPackBlockBuilder(const WriterOptions* options)
+      : options_(options) {
+    Reset();
+  }
+
+  int Add(const uint8_t* vals_void, size_t count) override {
+    const CppType* vals = reinterpret_cast<const CppType*>(vals_void);
+    for (size_t i = 0; i < count; i++) {
+      values_.push_back(vals[i]);
+      if (values_.size() % kDeltaMiniBlockSize == 0) {
+        estimated_size_ += EncodedMiniBlockSize(values_.size() - kDeltaMiniBlockSize,
+                                                kDeltaMiniBlockSize);
+      }
+    }
+    return count;
+  }
+
+  bool IsBlockFull() const override {
+    // Values of the miniblock in progress are counted as plain values.
+    return estimated_size_ + (values_.size() % kDeltaMiniBlockSize) * sizeof(CppType) >
+        options_->storage_attributes.cfile_block_size;
+  }
+
+  Slice Finish(rowid_t ordinal_pos) override {
+    const size_t num_elems = values_.size();
+    const size_t num_miniblocks = (num_elems + kDeltaMiniBlockSize - 1) / kDeltaMiniBlockSize;
+    buffer_.clear();
+    buffer_.resize(kDeltaBlockHeaderSize + num_miniblocks * kDirEntrySize);
+    InlineEncodeFixed32(&buffer_[0], num_elems);
+    InlineEncodeFixed32(&buffer_[4], ordinal_pos);
+
+    for (size_t mb = 0; mb < num_miniblocks; mb++) {
+      const size_t start = mb * kDeltaMiniBlockSize;
+      const size_t count = std::min(kDeltaMiniBlockSize, num_elems - start);
+
+      // Compute the deltas, and the smallest one as a signed value so that
+      // nearly sorted data packs as well as sorted data.
+      UnsignedType min_delta = 0;
+      for (size_t i = 1; i < count; i++) {
+        const UnsignedType delta = Delta(start + i);
+        if (i == 1 || static_cast<SignedType>(delta) < static_cast<SignedType>(min_delta)) {
+          min_delta = delta;
+        }
+      }
+      uint64_t max_rel = 0;
+      for (size_t i = 1; i < count; i++) {
+        rel_deltas_[i - 1] = static_cast<UnsignedType>(Delta(start + i) - min_delta);
+        max_rel = std::max(max_rel, rel_deltas_[i - 1]);
+      }
+      const int bit_width = internal::BitWidth(max_rel);
+
+      uint8_t* entry = &buffer_[kDeltaBlockHeaderSize + mb * kDirEntrySize];
+      UnalignedStore(entry, values_[start]);
+      UnalignedStore(entry + sizeof(CppType), min_delta);
+      entry[2 * sizeof(CppType)] = static_cast<uint8_t>(bit_width);
+      InlineEncodeFixed32(entry + 2 * sizeof(CppType) + 1, buffer_.size());
+
+      if (count > 1) {
+        internal::PackBits(rel_deltas_, count - 1, bit_width, &buffer_);
+      }
+    }
+    const uint8_t padding[kDeltaBlockPaddingBytes] = {0};
+    buffer_.append(padding, sizeof(padding));
+    return Slice(buffer_);
+  }
+
+  void Reset() override {
+    values_.clear();
+    values_.reserve(options_->storage_attributes.cfile_block_size / sizeof(CppType));
+    buffer_.clear();
+    estimated_size_ = kDeltaBlockHeaderSize + kDeltaBlockPaddingBytes;
+  }
+
+  size_t Count() const override {
+    return values_.size();
+  }
+
+  Status GetFirstKey(void* key) const override {
+    if (values_.empty()) {
+      return Status::NotFound("no keys in data block");
+    }
+    UnalignedStore(key, values_.front());
+    return Status::OK();
+  }
+
+  Status GetLastKey(void* key) const override {
+    if (values_.empty()) {
+      return Status::NotFound("no keys in data block");
+    }
+    UnalignedStore(key, values_.back());
+    return Status::OK();
+  }
+
+ private:
+  typedef typename TypeTraits<Type>::cpp_type CppType;
+  typedef typename std::make_unsigned<CppType>::type UnsignedType;
+  typedef typename std::make_signed<CppType>::type SignedType;
+
+  static const size_t kDirEntrySize = 2 * sizeof(CppType) + 1 + sizeof(uint32_t);
+
+  // Returns the difference between the values at 'idx' and 'idx - 1',
+  // modulo the range of the type.
+  UnsignedType Delta(size_t idx) const {
+    return static_cast<UnsignedType>(static_cast<UnsignedType>(values_[idx]) -
+                                     static_cast<UnsignedType>(values_[idx - 1]));
+  }
+
+  // Returns the encoded size of the miniblock of the 'count' values starting
+  // at 'start', including its directory entry.
+  size_t EncodedMiniBlockSize(size_t start, size_t count) const {
+    SignedType min_delta = std::numeric_limits<SignedType>::max();
+    SignedType max_delta = std::numeric_limits<SignedType>::min();
+    for (size_t i = start + 1; i < start + count; i++) {
+      SignedType delta = static_cast<SignedType>(Delta(i));
+      min_delta = std::min(min_delta, delta);
+      max_delta = std::max(max_delta, delta);
+    }
+    uint64_t max_rel = count > 1 ?
+        static_cast<UnsignedType>(static_cast<UnsignedType>(max_delta) -
+                                  static_cast<UnsignedType>(min_delta)) : 0;
+    return kDirEntrySize + ((count - 1) * internal::BitWidth(max_rel) + 7) / 8;
+  }
+
+  const WriterOptions* options_;
+  std::vector<CppType> values_;
+  faststring buffer_;
+  size_t estimated_size_;
+
+  // Scratch space for the relative deltas of a miniblock.
+  uint64_t rel_deltas_[kDeltaMiniBlockSize];
+};
+
+//
+// Decoder for the delta bit-packing encoding.
+//
+template<DataType Type>
+class DeltaBitPackBlockDecoder final : public BlockDecoder {
+ public:
+  explicit DeltaBitPackBlockDecoder(Slice slice)
+      : data_(slice),
+        parsed_(false),
+        num_elems_(0),
+        num_miniblocks_(0),
+        ordinal_pos_base_(0),
+        cur_idx_(0),
+        decoded_miniblock_(-1) {
+  }
+
+  Status ParseHeader() override {
+    CHECK(!parsed_);
+
+    if (data_.size() < kDeltaBlockHeaderSize + kDeltaBlockPaddingBytes) {
+      return Status::Corruption(
+          "not enough bytes for header in DeltaBitPackBlockDecoder");
+    }
+    num_elems_ = DecodeFixed32(&data_[0]);
+    ordinal_pos_base_ = DecodeFixed32(&data_[4]);
+    num_miniblocks_ = (num_elems_ + kDeltaMiniBlockSize - 1) / kDeltaMiniBlockSize;
+
+    // Validate the directory, so that decoding never reads past the block.
+    const size_t data_end = data_.size() - kDeltaBlockPaddingBytes;
+    size_t expected_offset = kDeltaBlockHeaderSize + num_miniblocks_ * kDirEntrySize;
+    if (expected_offset > data_end) {
+      return Status::Corruption(strings::Substitute(
+          "not enough bytes for $0 miniblocks in DeltaBitPackBlockDecoder", num_miniblocks_));
+    }
+    for (size_t mb = 0; mb < num_miniblocks_; mb++) {
+      const int bit_width = BitWidthOf(mb);
+      if (bit_width > kCppTypeSize * 8 || DataOffsetOf(mb) != expected_offset) {
+        return Status::Corruption(strings::Substitute(
+            "bad directory entry for miniblock $0 in DeltaBitPackBlockDecoder", mb));
+      }
+      expected_offset += ((MiniBlockCount(mb) - 1) * bit_width + 7) / 8;
+    }
+    if (expected_offset != data_end) {
+      return Status::Corruption(strings::Substitute(
+          "unexpected data size in DeltaBitPackBlockDecoder: expected $0 bytes, got $1",
+          expected_offset + kDeltaBlockPaddingBytes, data_.size()));
+    }
+
+    parsed_ = true;
+    SeekToPositionInBlock(0);
+    return Status::OK();
+  }
+
+  void SeekToPositionInBlock(uint pos) override {
+    CHECK(parsed_) << "Must call ParseHeader()";
+    DCHECK_LE(pos, num_elems_);
+    cur_idx_ = pos;
+  }
+
+  Status SeekAtOrAfterValue(const void* value, bool* exact_match) override {
+    DCHECK(value != nullptr);
+    const CppType target = UnalignedLoad<CppType>(value);
+
+    // Find the last miniblock whose first value isn't greater than the
+    // target: if the target is in the block, it's in that miniblock.
+    size_t left = 0;
+    size_t right = num_miniblocks_;
+    while (left != right) {
+      size_t mid = (left + right) / 2;
+      if (FirstValueOf(mid) <= target) {
+        left = mid + 1;
+      } else {
+        right = mid;
+      }
+    }
+    if (left == 0) {
+      // The target is before the first value in the block, or the block is
+      // empty.
+      cur_idx_ = 0;
+      *exact_match = false;
+      if (num_elems_ == 0) {
+        return Status::NotFound("after last key in block");
+      }
+      return Status::OK();
+    }
+
+    const size_t mb = left - 1;
+    const CppType* values = DecodeMiniBlock(mb);
+    const CppType* end = values + MiniBlockCount(mb);
+    const CppType* it = std::lower_bound(values, end, target);
+    if (it != end) {
+      cur_idx_ = mb * kDeltaMiniBlockSize + (it - values);
+      *exact_match = *it == target;
+      return Status::OK();
+    }
+    // The target is after the last value of the miniblock, so the next
+    // miniblock, if any, starts with the first greater value.
+    cur_idx_ = (mb + 1) * kDeltaMiniBlockSize;
+    *exact_match = false;
+    if (cur_idx_ >= num_elems_) {
+      cur_idx_ = num_elems_;
+      return Status::NotFound("after last key in block");
+    }
+    return Status::OK();
+  }
+
+  Status CopyNextValues(size_t* n, ColumnDataView* dst) override {
+    DCHECK(parsed_);
+    DCHECK_LE(*n, dst->nrows());
+    DCHECK_EQ(dst->stride(), sizeof(CppType));
+
+    if (PREDICT_FALSE(*n == 0 || cur_idx_ >= num_elems_)) {
+      *n = 0;
+      return Status::OK();
+    }
+
+    const size_t to_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
+    CppType* out = reinterpret_cast<CppType*>(dst->data());
+    size_t fetched = 0;
+    while (fetched < to_fetch) {
+      const size_t mb = cur_idx_ / kDeltaMiniBlockSize;
+      const size_t idx_in_mb = cur_idx_ % kDeltaMiniBlockSize;
+      const size_t mb_count = MiniBlockCount(mb);
+      const size_t count = std::min(to_fetch - fetched, mb_count - idx_in_mb);
+      if (idx_in_mb == 0 && count == mb_count) {
+        // Decode whole miniblocks straight into the destination.
+        DecodeMiniBlockTo(mb, out + fetched);
+      } else {
+        memcpy(out + fetched, DecodeMiniBlock(mb) + idx_in_mb, count * sizeof(CppType));
+      }
+      fetched += count;
+      cur_idx_ += count;
+    }
+    *n = to_fetch;
+    return Status::OK();
+  }
+
+  bool HasNext() const override {
+    return cur_idx_ < num_elems_;
+  }
+
+  size_t Count() const override {
+    return num_elems_;
+  }
+
+  size_t GetCurrentIndex() const override {
+    return cur_idx_;
+  }
+
+  rowid_t GetFirstRowId() const override {
+    return ordinal_pos_base_;
+  }
+
+ private:
+  typedef typename TypeTraits<Type>::cpp_type CppType;
+  typedef typename std::make_unsigned<CppType>::type UnsignedType;
+  enum {
+    kCppTypeSize = TypeTraits<Type>::size
+  };
+  static const size_t kDirEntrySize = 2 * sizeof(CppType) + 1 + sizeof(uint32_t);
+
+  const uint8_t* DirEntry(size_t mb) const {
+    return &data_[kDeltaBlockHeaderSize + mb * kDirEntrySize];
+  }
+  CppType FirstValueOf(size_t mb) const {
+    return UnalignedLoad<CppType>(DirEntry(mb));
+  }
+  UnsignedType MinDeltaOf(size_t mb) const {
+    return UnalignedLoad<UnsignedType>(DirEntry(mb) + sizeof(CppType));
+  }
+  int BitWidthOf(size_t mb) const {
+    return DirEntry(mb)[2 * sizeof(CppType)];
+  }
+  uint32_t DataOffsetOf(size_t mb) const {
+    return DecodeFixed32(DirEntry(mb) + 2 * sizeof(CppType) + 1);
+  }
+  size_t MiniBlockCount(size_t mb) const {
+    return std::min(kDeltaMiniBlockSize, num_elems_ - mb * kDeltaMiniBlockSize);
+  }
+
+  // Decodes miniblock 'mb' into 'out', which must have room for its values.
+  void DecodeMiniBlockTo(size_t mb, CppType* out) const {
+    const size_t count = MiniBlockCount(mb);
+    const UnsignedType min_delta = MinDeltaOf(mb);
+    UnsignedType* u_out = reinterpret_cast<UnsignedType*>(out);
+    // Unpack the relative deltas after the first value, then turn them into
+    // values with a running sum.
+    internal::UnpackBits(&data_[DataOffsetOf(mb)], count - 1, BitWidthOf(mb), u_out + 1);
+    UnsignedType v = static_cast<UnsignedType>(FirstValueOf(mb));
+    u_out[0] = v;
+    for (size_t i = 1; i < count; i++) {
+      v = static_cast<UnsignedType>(v + min_delta + u_out[i]);
+      u_out[i] = v;
+    }
+  }
+
+  // Returns the values of miniblock 'mb', decoding them if needed.
+  const CppType* DecodeMiniBlock(size_t mb) {
+    if (decoded_miniblock_ != static_cast<int64_t>(mb)) {
+      DecodeMiniBlockTo(mb, decoded_);
+      decoded_miniblock_ = mb;
+    }
+    return decoded_;
+  }
+
+  Slice data_;
+  bool parsed_;
+  size_t num_elems_;
+  size_t num_miniblocks_;
+  rowid_t ordinal_pos_base_;
+  size_t cur_idx_;
+
+  // The most recently decoded miniblock, used when decoding part of one.
+  int64_t decoded_miniblock_;
+  CppType decoded_[kDeltaMiniBlockSize];
+};
+
+} // namespace cfile
+} // namespace kudu
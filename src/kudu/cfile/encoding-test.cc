@@ -37,17 +37,22 @@
 #include "kudu/cfile/block_encodings.h"
 #include "kudu/cfile/bshuf_block.h"
 #include "kudu/cfile/cfile_util.h"
+#include "kudu/cfile/delta_bitpack_block.h"
 #include "kudu/cfile/plain_bitmap_block.h"
 #include "kudu/cfile/plain_block.h"
 #include "kudu/cfile/rle_block.h"
+#include "kudu/common/column_materialization_context.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/alignment.h"
 #include "kudu/util/group_varint-inl.h"
 #include "kudu/util/hexdump.h"
 #include "kudu/util/int128.h"
@@ -676,6 +681,61 @@ class TestEncoding : public KuduTest {
     }
   }
 
+  // Test that evaluating a predicate while decoding a block of runs selects
+  // the same rows as evaluating it on each decoded value.
+  template <class BuilderType, class DecoderType, DataType Type>
+  void TestCopyNextAndEvalRuns(const ColumnPredicate& pred) {
+    typedef typename TypeTraits<Type>::cpp_type CppType;
+    Random rand(SeedRandom());
+
+    // Long runs of a handful of values, with some short literal runs. Arrays
+    // are used rather than vectors, which are bit-packed for bools.
+    const size_t kNumValues = 10000;
+    unique_ptr<CppType[]> to_insert(new CppType[kNumValues]);
+    for (size_t i = 0; i < kNumValues;) {
+      int run_size = rand.OneIn(4) ? 1 : rand.Uniform(200) + 1;
+      CppType val = static_cast<CppType>(rand.Uniform(5));
+      for (int j = 0; j < run_size && i < kNumValues; j++, i++) {
+        to_insert[i] = val;
+      }
+    }
+
+    unique_ptr<WriterOptions> opts(NewWriterOptions());
+    BuilderType bb(opts.get());
+    bb.Add(reinterpret_cast<const uint8_t*>(to_insert.get()), kNumValues);
+    Slice s = bb.Finish(0);
+
+    DecoderType bd(s);
+    ASSERT_OK(bd.ParseHeader());
+
+    unique_ptr<CppType[]> decoded(new CppType[kNumValues]);
+    ColumnBlock dst_block(GetTypeInfo(Type), nullptr, decoded.get(), kNumValues, &arena_);
+    SelectionVector sel(kNumValues);
+    sel.SetAllTrue();
+    SelectionVectorView sel_view(&sel);
+    ColumnMaterializationContext ctx(0, &pred, &dst_block, &sel);
+
+    size_t dec_count = 0;
+    while (bd.HasNext()) {
+      size_t n = std::min(kNumValues - dec_count,
+                          static_cast<size_t>(rand.Uniform(300) + 1));
+      ColumnDataView dst_data(&dst_block, dec_count);
+      ASSERT_OK_FAST(bd.CopyNextAndEval(&n, &ctx, &sel_view, &dst_data));
+      ASSERT_FALSE(ctx.DecoderEvalNotSupported());
+      sel_view.Advance(n);
+      dec_count += n;
+    }
+    ASSERT_EQ(kNumValues, dec_count);
+
+    for (size_t i = 0; i < kNumValues; i++) {
+      bool expected = pred.EvaluateCell<Type>(&to_insert[i]);
+      ASSERT_EQ(expected, sel.IsRowSelected(i)) << "row " << i;
+      if (expected) {
+        ASSERT_EQ(to_insert[i], decoded[i]) << "row " << i;
+      }
+    }
+  }
+
   Arena arena_;
 };
 
@@ -752,6 +812,43 @@ TEST_F(TestEncoding, TestBShufDoubleBlockEncoder) {
                                     BShufBlockDecoder<DOUBLE> >(doubles.get(), kSize);
 }
 
+// Test copying a whole bitshuffle block in one call, which un-shuffles
+// straight into the destination when it has room for the padding.
+TEST_F(TestEncoding, TestBShufCopyWholeBlock) {
+  // Not a multiple of 8, so that the block is padded.
+  const size_t kSize = 1003;
+  vector<int64_t> ints(kSize);
+  for (int i = 0; i < kSize; i++) {
+    ints[i] = i * 3;
+  }
+  unique_ptr<WriterOptions> opts(NewWriterOptions());
+  BShufBlockBuilder<INT64> bb(opts.get());
+  bb.Add(reinterpret_cast<const uint8_t*>(ints.data()), kSize);
+  Slice s = bb.Finish(0);
+
+  for (size_t capacity : { kSize, KUDU_ALIGN_UP(kSize, 8) }) {
+    SCOPED_TRACE(capacity);
+    BShufBlockDecoder<INT64> bd(s);
+    ASSERT_OK(bd.ParseHeader());
+    vector<int64_t> decoded(capacity);
+    ColumnBlock cb(GetTypeInfo(INT64), nullptr, decoded.data(), capacity, &arena_);
+    ColumnDataView cdv(&cb);
+    size_t n = capacity;
+    ASSERT_OK(bd.CopyNextValues(&n, &cdv));
+    ASSERT_EQ(kSize, n);
+    ASSERT_FALSE(bd.HasNext());
+    decoded.resize(kSize);
+    ASSERT_EQ(ints, decoded);
+
+    // Seeking afterwards still works.
+    bool exact;
+    ASSERT_OK(bd.SeekAtOrAfterValue(&ints[500], &exact));
+    int64_t val;
+    CopyOne<INT64>(&bd, &val);
+    ASSERT_EQ(ints[500], val);
+  }
+}
+
 TEST_F(TestEncoding, TestRleIntBlockEncoder) {
   unique_ptr<WriterOptions> opts(NewWriterOptions());
   RleIntBlockBuilder<UINT32> ibb(opts.get());
@@ -774,6 +871,79 @@ TEST_F(TestEncoding, TestRleIntBlockEncoder) {
   ASSERT_EQ(14UL, s.size());
 }
 
+TEST_F(TestEncoding, TestDeltaBitPackBlockEncoder) {
+  unique_ptr<WriterOptions> opts(NewWriterOptions());
+  DeltaBitPackBlockBuilder<INT64> ibb(opts.get());
+
+  // Sorted timestamp-like values with small gaps between neighbours should
+  // only need a few bits per value.
+  const int kNumInts = 10000;
+  gscoped_ptr<int64_t[]> ints(new int64_t[kNumInts]);
+  int64_t val = 1500000000000000L;
+  for (int i = 0; i < kNumInts; i++) {
+    val += 1 + random() % 1000;
+    ints[i] = val;
+  }
+  ibb.Add(reinterpret_cast<const uint8_t *>(ints.get()), kNumInts);
+  Slice s = ibb.Finish(12345);
+  LOG(INFO) << "Delta bit-packed size for 10k sorted int64s: " << s.size();
+  ASSERT_LT(s.size(), kNumInts * 2);
+
+  DeltaBitPackBlockDecoder<INT64> ibd(s);
+  ASSERT_OK(ibd.ParseHeader());
+  ASSERT_EQ(kNumInts, ibd.Count());
+  ASSERT_EQ(12345, ibd.GetFirstRowId());
+
+  // Seek into the middle of a miniblock and read across the next boundary.
+  bool exact = false;
+  ASSERT_OK(ibd.SeekAtOrAfterValue(&ints[5000], &exact));
+  ASSERT_TRUE(exact);
+  ASSERT_EQ(5000, ibd.GetCurrentIndex());
+  int64_t decoded[200];
+  ColumnBlock cb(GetTypeInfo(INT64), nullptr, decoded, arraysize(decoded), &arena_);
+  ColumnDataView cdv(&cb);
+  size_t n = arraysize(decoded);
+  ASSERT_OK(ibd.CopyNextValues(&n, &cdv));
+  ASSERT_EQ(arraysize(decoded), n);
+  for (int i = 0; i < n; i++) {
+    ASSERT_EQ(ints[5000 + i], decoded[i]);
+  }
+
+  // An all-equal block packs its deltas in zero bits.
+  ibb.Reset();
+  for (int i = 0; i < kNumInts; i++) {
+    ints[i] = 0;
+  }
+  ibb.Add(reinterpret_cast<const uint8_t *>(ints.get()), kNumInts);
+  s = ibb.Finish(0);
+  ASSERT_LT(s.size(), kNumInts / 4);
+
+  // Truncated blocks must be rejected rather than read past their end.
+  for (int i = 0; i < s.size(); i++) {
+    DeltaBitPackBlockDecoder<INT64> truncated(Slice(s.data(), i));
+    ASSERT_TRUE(truncated.ParseHeader().IsCorruption()) << i;
+  }
+}
+
+TEST_F(TestEncoding, TestRleIntBlockCopyNextAndEval) {
+  ColumnSchema col("c", UINT32);
+  uint32_t one = 1;
+  uint32_t three = 3;
+  NO_FATALS((TestCopyNextAndEvalRuns<RleIntBlockBuilder<UINT32>, RleIntBlockDecoder<UINT32>,
+                                     UINT32>(ColumnPredicate::Range(col, &one, &three))));
+  NO_FATALS((TestCopyNextAndEvalRuns<RleIntBlockBuilder<UINT32>, RleIntBlockDecoder<UINT32>,
+                                     UINT32>(ColumnPredicate::Equality(col, &three))));
+  NO_FATALS((TestCopyNextAndEvalRuns<RleIntBlockBuilder<UINT32>, RleIntBlockDecoder<UINT32>,
+                                     UINT32>(ColumnPredicate::IsNotNull(col))));
+}
+
+TEST_F(TestEncoding, TestRleBitMapCopyNextAndEval) {
+  ColumnSchema col("c", BOOL);
+  bool t = true;
+  NO_FATALS((TestCopyNextAndEvalRuns<RleBitMapBlockBuilder, RleBitMapBlockDecoder, BOOL>(
+      ColumnPredicate::Equality(col, &t))));
+}
+
 TEST_F(TestEncoding, TestPlainBitMapRoundTrip) {
   TestBoolBlockRoundTrip<PlainBitMapBlockBuilder, PlainBitMapBlockDecoder>();
 }
@@ -858,7 +1028,16 @@ struct BitshuffleTestTraits {
     typedef BShufBlockDecoder<type> decoder_type;
   };
 };
-typedef testing::Types<RleTestTraits, BitshuffleTestTraits, PlainTestTraits> MyTestFixtures;
+
+struct DeltaBitPackTestTraits {
+  template<DataType type>
+  struct Classes {
+    typedef DeltaBitPackBlockBuilder<type> encoder_type;
+    typedef DeltaBitPackBlockDecoder<type> decoder_type;
+  };
+};
+typedef testing::Types<RleTestTraits, BitshuffleTestTraits, PlainTestTraits,
+                       DeltaBitPackTestTraits> MyTestFixtures;
 TYPED_TEST_CASE(IntEncodingTest, MyTestFixtures);
 
 template<class TestTraits>
@@ -352,6 +352,24 @@ TEST(TestIndexKeys, TestGetSeparatingKey) {
   right = "fig";
   GetSeparatingKey(left, &right);
   ASSERT_EQ(right, Slice("fi"));
+
+  // Keys longer than the words compared at once.
+  left = "0123456789abcdefghij-cardamom";
+  right = "0123456789abcdefghij-carrot";
+  GetSeparatingKey(left, &right);
+  ASSERT_EQ(right, Slice("0123456789abcdefghij-carr"));
+}
+
+TEST(TestIndexKeys, TestCommonPrefixLength) {
+  ASSERT_EQ(0, CommonPrefixLength("", "abc"));
+  ASSERT_EQ(3, CommonPrefixLength("abc", "abcd"));
+  ASSERT_EQ(0, CommonPrefixLength("abc", "xbc"));
+  const std::string prefix(37, 'k');
+  for (int i = 0; i < 3; i++) {
+    const std::string a = prefix.substr(i) + "apple";
+    const std::string b = prefix.substr(i) + "apricot";
+    ASSERT_EQ(prefix.size() - i + 2, CommonPrefixLength(a, b));
+  }
 }
 
 } // namespace cfile
@@ -286,7 +286,8 @@ Status IndexTreeIterator::LoadBlock(const BlockPointer &block,
   }
 
   RETURN_NOT_OK(reader_->ReadBlock(io_context_, block,
-                                   CFileReader::CACHE_BLOCK, &seeked->data));
+                                   CFileReader::CACHE_BLOCK_HIGH_PRIORITY,
+                                   &seeked->data));
   seeked->block_ptr = block;
 
   // Parse the new block.
@@ -0,0 +1,123 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/cfile/ordinal_index.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/malloc.h"
+
+using std::unique_ptr;
+using strings::Substitute;
+
+namespace kudu {
+namespace cfile {
+
+////////////////////////////////////////////////////////////
+// OrdinalIndexBuilder
+////////////////////////////////////////////////////////////
+
+void OrdinalIndexBuilder::AddBlock(rowid_t first_ordinal, const BlockPointer& ptr) {
+  ordinal_index_.add_offsets(ptr.offset());
+  ordinal_index_.add_sizes(ptr.size());
+  if (ordinal_index_.first_ordinals_size() > 0) {
+    ordinal_index_.add_first_ordinals(first_ordinal);
+    return;
+  }
+  first_ordinals_.push_back(first_ordinal);
+  if (first_ordinals_.size() == 2) {
+    ordinal_index_.set_values_per_block(first_ordinal);
+  } else if (first_ordinals_.size() > 2 &&
+             first_ordinal - first_ordinals_[first_ordinals_.size() - 2] !=
+             ordinal_index_.values_per_block()) {
+    // The blocks don't all have the same number of values: switch to listing
+    // the first ordinal of each one.
+    ordinal_index_.clear_values_per_block();
+    for (rowid_t ordinal : first_ordinals_) {
+      ordinal_index_.add_first_ordinals(ordinal);
+    }
+    first_ordinals_.clear();
+  }
+}
+
+////////////////////////////////////////////////////////////
+// OrdinalIndex
+////////////////////////////////////////////////////////////
+
+Status OrdinalIndex::Parse(Slice data, rowid_t num_values,
+                           unique_ptr<OrdinalIndex>* ordinal_index) {
+  OrdinalIndexPB pb;
+  if (!pb.ParseFromArray(data.data(), data.size())) {
+    return Status::Corruption("invalid ordinal index block");
+  }
+  const int num_blocks = pb.offsets_size();
+  if (num_blocks == 0 || pb.sizes_size() != num_blocks) {
+    return Status::Corruption("ordinal index has no or mismatched block pointers");
+  }
+
+  unique_ptr<OrdinalIndex> index(new OrdinalIndex());
+  if (pb.first_ordinals_size() > 0) {
+    if (pb.first_ordinals_size() != num_blocks || pb.first_ordinals(0) != 0) {
+      return Status::Corruption("ordinal index has mismatched block ordinals");
+    }
+    index->first_ordinals_.reserve(num_blocks);
+    for (int i = 0; i < num_blocks; i++) {
+      const rowid_t ordinal = pb.first_ordinals(i);
+      if (ordinal >= num_values || (i > 0 && ordinal <= index->first_ordinals_.back())) {
+        return Status::Corruption(Substitute("unexpected data block ordinal $0", ordinal));
+      }
+      index->first_ordinals_.push_back(ordinal);
+    }
+  } else if (num_blocks > 1) {
+    const uint64_t values_per_block = pb.values_per_block();
+    if (values_per_block == 0 ||
+        values_per_block * (num_blocks - 1) >= num_values) {
+      return Status::Corruption(Substitute("unexpected number of values per data block $0",
+                                           values_per_block));
+    }
+    index->values_per_block_ = values_per_block;
+  }
+
+  index->block_ptrs_.reserve(num_blocks);
+  for (int i = 0; i < num_blocks; i++) {
+    index->block_ptrs_.emplace_back(pb.offsets(i), pb.sizes(i));
+  }
+  *ordinal_index = std::move(index);
+  return Status::OK();
+}
+
+size_t OrdinalIndex::FindBlock(rowid_t ordinal) const {
+  if (values_per_block_ > 0) {
+    return std::min<size_t>(ordinal / values_per_block_, block_ptrs_.size() - 1);
+  }
+  if (first_ordinals_.empty()) {
+    return 0;
+  }
+  // The last block whose first ordinal is at or before 'ordinal'.
+  auto it = std::upper_bound(first_ordinals_.begin(), first_ordinals_.end(), ordinal);
+  return it - first_ordinals_.begin() - 1;
+}
+
+size_t OrdinalIndex::memory_footprint() const {
+  return kudu_malloc_usable_size(this) +
+      first_ordinals_.capacity() * sizeof(rowid_t) +
+      block_ptrs_.capacity() * sizeof(BlockPointer);
+}
+
+} // namespace cfile
+} // namespace kudu
@@ -0,0 +1,99 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "kudu/cfile/block_pointer.h"
+#include "kudu/cfile/cfile.pb.h"
+#include "kudu/common/rowid.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+namespace cfile {
+
+// Accumulates the pointers of the data blocks of a cfile as they are
+// written, building an OrdinalIndexPB.
+class OrdinalIndexBuilder {
+ public:
+  OrdinalIndexBuilder() = default;
+
+  // Adds the data block pointed to by 'ptr', whose first value has ordinal
+  // 'first_ordinal'. Blocks must be added in ordinal order.
+  void AddBlock(rowid_t first_ordinal, const BlockPointer& ptr);
+
+  // Returns the number of blocks added so far.
+  size_t num_blocks() const { return ordinal_index_.offsets_size(); }
+
+  // Returns the ordinal index of the blocks added so far.
+  const OrdinalIndexPB& ordinal_index() const { return ordinal_index_; }
+
+ private:
+  // The ordinals of the first values of the blocks, kept until the blocks
+  // are known to have different numbers of values.
+  std::vector<rowid_t> first_ordinals_;
+
+  OrdinalIndexPB ordinal_index_;
+
+  DISALLOW_COPY_AND_ASSIGN(OrdinalIndexBuilder);
+};
+
+// A parsed ordinal index of a cfile, used to find the data block holding the
+// value of an ordinal with an arithmetic mapping or a binary search, rather
+// than by walking the positional index.
+class OrdinalIndex {
+ public:
+  // Parses the serialized OrdinalIndexPB 'data' of a cfile with 'num_values'
+  // values.
+  //
+  // Returns Corruption if the ordinal index can't be parsed or is malformed.
+  static Status Parse(Slice data, rowid_t num_values,
+                      std::unique_ptr<OrdinalIndex>* ordinal_index);
+
+  // Returns the index of the block holding the value of ordinal 'ordinal',
+  // or of the last block if 'ordinal' is past the end of the file.
+  size_t FindBlock(rowid_t ordinal) const;
+
+  size_t num_blocks() const { return block_ptrs_.size(); }
+
+  const BlockPointer& block_ptr(size_t idx) const {
+    return block_ptrs_[idx];
+  }
+
+  // Returns the memory usage of this object including the object itself.
+  size_t memory_footprint() const;
+
+ private:
+  OrdinalIndex() = default;
+
+  // The number of values of each block, or 0 if they vary, in which case
+  // 'first_ordinals_' is set.
+  uint32_t values_per_block_ = 0;
+  std::vector<rowid_t> first_ordinals_;
+
+  std::vector<BlockPointer> block_ptrs_;
+
+  DISALLOW_COPY_AND_ASSIGN(OrdinalIndex);
+};
+
+} // namespace cfile
+} // namespace kudu
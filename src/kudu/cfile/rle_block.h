@@ -24,7 +24,10 @@
 #include "kudu/gutil/port.h"
 #include "kudu/cfile/block_encodings.h"
 #include "kudu/cfile/cfile_util.h"
+#include "kudu/common/column_materialization_context.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/util/coding.h"
 #include "kudu/util/coding-inl.h"
 #include "kudu/util/hexdump.h"
@@ -42,6 +45,35 @@ enum {
   kRleBitmapBlockHeaderSize = 8
 };
 
+namespace internal {
+
+// Decodes the next 'n' values from 'decoder' into 'out' a run at a time,
+// filling each run of repeated values at once.
+//
+// If 'ctx' is not null, its predicate is evaluated once per run as well: the
+// rows of runs that don't match are cleared in 'sel' rather than copied.
+template <DataType Type, typename T>
+Status CopyRuns(RleDecoder<T>* decoder, size_t n, ColumnMaterializationContext* ctx,
+                SelectionVectorView* sel, T* out) {
+  size_t i = 0;
+  while (i < n) {
+    T val;
+    size_t run_length = decoder->GetNextRun(&val, n - i);
+    if (PREDICT_FALSE(run_length == 0)) {
+      return Status::Corruption("unexpected end of RLE-encoded data");
+    }
+    if (ctx == nullptr || ctx->pred()->EvaluateCell<Type>(&val)) {
+      std::fill_n(out + i, run_length, val);
+    } else {
+      sel->ClearBits(i, run_length);
+    }
+    i += run_length;
+  }
+  return Status::OK();
+}
+
+} // namespace internal
+
 //
 // RLE encoder for the BOOL datatype: uses an RLE-encoded bitmap to
 // represent a bool column.
@@ -176,16 +208,33 @@ class RleBitMapBlockDecoder final : public BlockDecoder {
     }
 
     size_t bits_to_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
-    size_t remaining = bits_to_fetch;
-    uint8_t* data_ptr = dst->data();
-    // TODO : do this a word/byte at a time as opposed bit at a time
-    while (remaining > 0) {
-      bool result = rle_decoder_.Get(reinterpret_cast<bool*>(data_ptr));
-      DCHECK(result);
-      remaining--;
-      data_ptr++;
+    RETURN_NOT_OK(internal::CopyRuns<BOOL>(&rle_decoder_, bits_to_fetch, nullptr, nullptr,
+                                           reinterpret_cast<bool*>(dst->data())));
+
+    cur_idx_ += bits_to_fetch;
+    *n = bits_to_fetch;
+
+    return Status::OK();
+  }
+
+  Status CopyNextAndEval(size_t* n,
+                         ColumnMaterializationContext* ctx,
+                         SelectionVectorView* sel,
+                         ColumnDataView* dst) override {
+    DCHECK(parsed_);
+    DCHECK_LE(*n, dst->nrows());
+    DCHECK_EQ(dst->stride(), sizeof(bool));
+
+    ctx->SetDecoderEvalSupported();
+    if (PREDICT_FALSE(*n == 0 || cur_idx_ >= num_elems_)) {
+      *n = 0;
+      return Status::OK();
     }
 
+    size_t bits_to_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
+    RETURN_NOT_OK(internal::CopyRuns<BOOL>(&rle_decoder_, bits_to_fetch, ctx, sel,
+                                           reinterpret_cast<bool*>(dst->data())));
+
     cur_idx_ += bits_to_fetch;
     *n = bits_to_fetch;
 
@@ -409,15 +458,32 @@ class RleIntBlockDecoder final : public BlockDecoder {
     }
 
     size_t to_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
-    size_t remaining = to_fetch;
-    uint8_t* data_ptr = dst->data();
-    while (remaining > 0) {
-      bool result = rle_decoder_.Get(reinterpret_cast<CppType*>(data_ptr));
-      DCHECK(result);
-      remaining--;
-      data_ptr += kCppTypeSize;
+    RETURN_NOT_OK(internal::CopyRuns<IntType>(&rle_decoder_, to_fetch, nullptr, nullptr,
+                                              reinterpret_cast<CppType*>(dst->data())));
+
+    cur_idx_ += to_fetch;
+    *n = to_fetch;
+    return Status::OK();
+  }
+
+  Status CopyNextAndEval(size_t* n,
+                         ColumnMaterializationContext* ctx,
+                         SelectionVectorView* sel,
+                         ColumnDataView* dst) override {
+    DCHECK(parsed_);
+    DCHECK_LE(*n, dst->nrows());
+    DCHECK_EQ(dst->stride(), sizeof(CppType));
+
+    ctx->SetDecoderEvalSupported();
+    if (PREDICT_FALSE(*n == 0 || cur_idx_ >= num_elems_)) {
+      *n = 0;
+      return Status::OK();
     }
 
+    size_t to_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
+    RETURN_NOT_OK(internal::CopyRuns<IntType>(&rle_decoder_, to_fetch, ctx, sel,
+                                              reinterpret_cast<CppType*>(dst->data())));
+
     cur_idx_ += to_fetch;
     *n = to_fetch;
     return Status::OK();
@@ -0,0 +1,121 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/cfile/secondary_block_cache.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+using std::string;
+using std::unique_ptr;
+using strings::Substitute;
+
+namespace kudu {
+namespace cfile {
+
+class SecondaryBlockCacheTest : public KuduTest {
+ protected:
+  static constexpr int kBlockSize = 1024;
+
+  void CreateCache(uint64_t capacity) {
+    ASSERT_OK(SecondaryBlockCache::Create(env_, GetTestPath("secondary-cache"), capacity,
+                                          &cache_));
+  }
+
+  static string Key(int i) {
+    faststring key;
+    PutFixed64(&key, i);
+    return key.ToString();
+  }
+
+  // Returns a block whose contents depend on 'i'.
+  static string Block(int i) {
+    return string(kBlockSize, static_cast<char>('a' + i % 26));
+  }
+
+  void Insert(int i) {
+    string block = Block(i);
+    cache_->Insert(Key(i), block);
+  }
+
+  bool Lookup(int i) {
+    string block(kBlockSize, '\0');
+    if (!cache_->Lookup(Key(i), Slice(&block[0], block.size()))) {
+      return false;
+    }
+    EXPECT_EQ(Block(i), block);
+    return true;
+  }
+
+  unique_ptr<SecondaryBlockCache> cache_;
+};
+
+TEST_F(SecondaryBlockCacheTest, TestBasics) {
+  NO_FATALS(CreateCache(16 * kBlockSize));
+  ASSERT_FALSE(Lookup(1));
+  Insert(1);
+  ASSERT_TRUE(Lookup(1));
+  ASSERT_FALSE(Lookup(2));
+
+  // A lookup expecting a block of another size misses.
+  string small(kBlockSize / 2, '\0');
+  ASSERT_FALSE(cache_->Lookup(Key(1), Slice(&small[0], small.size())));
+
+  // Blocks larger than the capacity aren't cached.
+  string large(32 * kBlockSize, 'x');
+  cache_->Insert(Key(3), large);
+  ASSERT_FALSE(cache_->Lookup(Key(3), Slice(&large[0], large.size())));
+}
+
+// Verify that the oldest blocks are overwritten once the file wraps around,
+// and that the others are still found.
+TEST_F(SecondaryBlockCacheTest, TestWrapAround) {
+  static constexpr int kNumBlocks = 16;
+  // Leave room for half a block at the end of the file, which is skipped
+  // when wrapping around.
+  NO_FATALS(CreateCache(kNumBlocks * kBlockSize + kBlockSize / 2));
+  for (int i = 0; i < kNumBlocks; i++) {
+    Insert(i);
+  }
+  for (int i = 0; i < kNumBlocks; i++) {
+    SCOPED_TRACE(Substitute("block $0", i));
+    ASSERT_TRUE(Lookup(i));
+  }
+
+  // Each of these overwrites the oldest block.
+  static constexpr int kNumNewBlocks = 4;
+  for (int i = 0; i < kNumNewBlocks; i++) {
+    Insert(kNumBlocks + i);
+  }
+  for (int i = 0; i < kNumBlocks + kNumNewBlocks; i++) {
+    SCOPED_TRACE(Substitute("block $0", i));
+    ASSERT_EQ(i >= kNumNewBlocks, Lookup(i));
+  }
+}
+
+} // namespace cfile
+} // namespace kudu
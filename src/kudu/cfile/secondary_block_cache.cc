@@ -0,0 +1,164 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/cfile/secondary_block_cache.h"
+
+#include <mutex>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/crc.h"
+#include "kudu/util/env.h"
+
+METRIC_DEFINE_counter(server, block_cache_secondary_hits,
+                      "Secondary Block Cache Hits", kudu::MetricUnit::kBlocks,
+                      "Number of lookups that missed the block cache in memory "
+                      "and found the block in the secondary block cache");
+METRIC_DEFINE_counter(server, block_cache_secondary_misses,
+                      "Secondary Block Cache Misses", kudu::MetricUnit::kBlocks,
+                      "Number of lookups that missed both the block cache in "
+                      "memory and the secondary block cache");
+METRIC_DEFINE_counter(server, block_cache_secondary_inserts,
+                      "Secondary Block Cache Inserts", kudu::MetricUnit::kBlocks,
+                      "Number of blocks inserted in the secondary block cache");
+
+using std::string;
+using std::unique_ptr;
+using strings::Substitute;
+
+namespace kudu {
+namespace cfile {
+
+Status SecondaryBlockCache::Create(Env* env, const string& path, uint64_t capacity,
+                                   unique_ptr<SecondaryBlockCache>* cache) {
+  unique_ptr<RWFile> file;
+  RETURN_NOT_OK_PREPEND(env->NewRWFile(path, &file),
+                        Substitute("could not create secondary block cache file $0", path));
+  cache->reset(new SecondaryBlockCache(path, capacity, std::move(file)));
+  return Status::OK();
+}
+
+SecondaryBlockCache::SecondaryBlockCache(string path, uint64_t capacity,
+                                         unique_ptr<RWFile> file)
+    : path_(std::move(path)),
+      capacity_(capacity),
+      file_(std::move(file)),
+      write_offset_(0) {
+}
+
+SecondaryBlockCache::~SecondaryBlockCache() {
+  WARN_NOT_OK(file_->Close(), Substitute("could not close secondary block cache file $0",
+                                         path_));
+}
+
+bool SecondaryBlockCache::Lookup(const Slice& key, Slice result) {
+  Entry e;
+  bool found;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    const auto it = entries_.find(key.ToString());
+    found = it != entries_.end();
+    if (found) {
+      e = it->second;
+    }
+  }
+  if (found && e.length == result.size()) {
+    Status s = file_->Read(e.offset, result);
+    if (s.ok()) {
+      if (crc::Crc32c(result.data(), result.size()) == e.crc32c) {
+        if (hits_) hits_->Increment();
+        return true;
+      }
+      // The block was overwritten since it was looked up.
+      VLOG(2) << Substitute("block at $0 of secondary block cache file $1 was overwritten",
+                            e.offset, path_);
+    } else {
+      LOG(WARNING) << Substitute("could not read secondary block cache file $0: $1",
+                                 path_, s.ToString());
+    }
+  }
+  if (misses_) misses_->Increment();
+  return false;
+}
+
+uint64_t SecondaryBlockCache::ReserveLocked(uint32_t length) {
+  DCHECK(lock_.is_locked());
+  if (write_offset_ + length > capacity_) {
+    // The blocks at the end of the file are the oldest ones.
+    while (!queue_.empty() && FindOrDie(entries_, queue_.front()).offset >= write_offset_) {
+      entries_.erase(queue_.front());
+      queue_.pop_front();
+    }
+    write_offset_ = 0;
+  }
+  // Since the blocks are written in order, the oldest blocks are the ones
+  // following the write position. Blocks preceding it were written after
+  // wrapping around, and so are newer.
+  while (!queue_.empty()) {
+    const Entry& oldest = FindOrDie(entries_, queue_.front());
+    if (oldest.offset < write_offset_ || oldest.offset >= write_offset_ + length) {
+      break;
+    }
+    entries_.erase(queue_.front());
+    queue_.pop_front();
+  }
+  uint64_t offset = write_offset_;
+  write_offset_ += length;
+  return offset;
+}
+
+void SecondaryBlockCache::Insert(const Slice& key, const Slice& data) {
+  if (data.size() > capacity_) {
+    return;
+  }
+  Entry e;
+  e.length = data.size();
+  e.crc32c = crc::Crc32c(data.data(), data.size());
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    string key_str = key.ToString();
+    if (ContainsKey(entries_, key_str)) {
+      return;
+    }
+    e.offset = ReserveLocked(e.length);
+    entries_.emplace(key_str, e);
+    queue_.emplace_back(std::move(key_str));
+  }
+  // Lookups of the block until the write completes fail the checksum
+  // verification, as do all lookups if the write fails.
+  Status s = file_->Write(e.offset, data);
+  if (PREDICT_FALSE(!s.ok())) {
+    LOG(WARNING) << Substitute("could not write secondary block cache file $0: $1",
+                               path_, s.ToString());
+    return;
+  }
+  if (inserts_) inserts_->Increment();
+}
+
+void SecondaryBlockCache::StartInstrumentation(
+    const scoped_refptr<MetricEntity>& metric_entity) {
+  hits_ = METRIC_block_cache_secondary_hits.Instantiate(metric_entity);
+  misses_ = METRIC_block_cache_secondary_misses.Instantiate(metric_entity);
+  inserts_ = METRIC_block_cache_secondary_inserts.Instantiate(metric_entity);
+}
+
+} // namespace cfile
+} // namespace kudu
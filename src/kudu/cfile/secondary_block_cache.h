@@ -0,0 +1,117 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class Env;
+class RWFile;
+
+namespace cfile {
+
+// A second block cache tier backed by a file, meant to be placed on a local
+// SSD in front of slower data directories. It holds CFile blocks in their
+// on-disk form, i.e. still compressed, so that a lookup which misses the
+// block cache in memory costs a single read from the SSD rather than a seek
+// on the data directory's device.
+//
+// The file is used as a circular log: blocks are appended at the write
+// position, which wraps around to the start of the file once the capacity is
+// reached, overwriting the oldest blocks. The index of the blocks is kept in
+// memory only, so the contents of the file don't survive a restart.
+//
+// Failures to read from or write to the file are not returned to callers:
+// they're logged, and the affected blocks are treated as not cached.
+//
+// This class is thread-safe.
+class SecondaryBlockCache {
+ public:
+  // Creates a cache of 'capacity' bytes backed by the file at 'path', which
+  // is created or truncated.
+  static Status Create(Env* env, const std::string& path, uint64_t capacity,
+                       std::unique_ptr<SecondaryBlockCache>* cache);
+
+  ~SecondaryBlockCache();
+
+  // Looks up the block with the given key, which is the memcpyed
+  // representation of a BlockCache::CacheKey. On a hit, the block is read
+  // into 'result', whose size must match the block's, and true is returned.
+  bool Lookup(const Slice& key, Slice result);
+
+  // Inserts the block 'data' with the given key, unless a block with the key
+  // is already cached. Blocks larger than the capacity aren't cached.
+  void Insert(const Slice& key, const Slice& data);
+
+  // Starts recording metrics in the given entity.
+  void StartInstrumentation(const scoped_refptr<MetricEntity>& metric_entity);
+
+ private:
+  // The location of a cached block in the file.
+  struct Entry {
+    uint64_t offset;
+    uint32_t length;
+    uint32_t crc32c;
+  };
+
+  SecondaryBlockCache(std::string path, uint64_t capacity, std::unique_ptr<RWFile> file);
+
+  // Removes the blocks which overlap with the 'length' bytes at the write
+  // position from the index, wrapping the write position around if needed,
+  // and returns the offset at which to write the bytes.
+  uint64_t ReserveLocked(uint32_t length);
+
+  const std::string path_;
+  const uint64_t capacity_;
+  const std::unique_ptr<RWFile> file_;
+
+  // Protects the members below. Reads and writes of the file are done
+  // without holding it: the checksum of each block is verified after reading
+  // it, which detects blocks overwritten in the meantime.
+  simple_spinlock lock_;
+
+  // The cached blocks, by key.
+  std::unordered_map<std::string, Entry> entries_;
+
+  // The keys of the cached blocks, from the oldest to the most recently
+  // written one.
+  std::deque<std::string> queue_;
+
+  // The offset at which the next block is written.
+  uint64_t write_offset_;
+
+  scoped_refptr<Counter> hits_;
+  scoped_refptr<Counter> misses_;
+  scoped_refptr<Counter> inserts_;
+
+  DISALLOW_COPY_AND_ASSIGN(SecondaryBlockCache);
+};
+
+} // namespace cfile
+} // namespace kudu
@@ -0,0 +1,253 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/cfile/zone_map.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <glog/logging.h>
+
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/malloc.h"
+
+using std::string;
+using std::unique_ptr;
+using strings::Substitute;
+
+namespace kudu {
+namespace cfile {
+
+const size_t kZoneMapMaxBinaryValueLength = 64;
+
+namespace {
+
+// Large enough and suitably aligned to hold a cell of any fixed-size type.
+struct CellBuffer {
+  alignas(16) uint8_t data[16];
+};
+
+bool IsNaN(DataType type, const uint8_t* cell) {
+  switch (type) {
+    case FLOAT: return std::isnan(*reinterpret_cast<const float*>(cell));
+    case DOUBLE: return std::isnan(*reinterpret_cast<const double*>(cell));
+    default: return false;
+  }
+}
+
+} // anonymous namespace
+
+////////////////////////////////////////////////////////////
+// ZoneMapBuilder
+////////////////////////////////////////////////////////////
+
+ZoneMapBuilder::ZoneMapBuilder(const TypeInfo* type_info)
+    : type_info_(type_info),
+      is_binary_(type_info->physical_type() == BINARY),
+      is_floating_point_(type_info->physical_type() == FLOAT ||
+                         type_info->physical_type() == DOUBLE) {
+  DCHECK_LE(type_info_->size(), sizeof(CellBuffer));
+  Reset();
+}
+
+void ZoneMapBuilder::Reset() {
+  num_values_ = 0;
+  null_count_ = 0;
+  unbounded_ = false;
+  min_.clear();
+  max_.clear();
+}
+
+void ZoneMapBuilder::AddValues(const void* cells, size_t count) {
+  const uint8_t* cell = reinterpret_cast<const uint8_t*>(cells);
+  const size_t cell_size = type_info_->size();
+  for (size_t i = 0; i < count && !unbounded_; i++, cell += cell_size) {
+    if (is_floating_point_ && IsNaN(type_info_->physical_type(), cell)) {
+      // NaNs don't compare consistently with other values, so the values of
+      // this block can't be bounded.
+      unbounded_ = true;
+      break;
+    }
+    const bool first = num_values_ == null_count_ && i == 0;
+    if (is_binary_) {
+      const Slice* s = reinterpret_cast<const Slice*>(cell);
+      if (first || s->compare(Slice(min_)) < 0) {
+        min_.assign_copy(s->data(), s->size());
+      }
+      if (first || s->compare(Slice(max_)) > 0) {
+        max_.assign_copy(s->data(), s->size());
+      }
+    } else {
+      CellBuffer min_cell;
+      CellBuffer max_cell;
+      if (!first) {
+        memcpy(min_cell.data, min_.data(), cell_size);
+        memcpy(max_cell.data, max_.data(), cell_size);
+      }
+      if (first || type_info_->Compare(cell, min_cell.data) < 0) {
+        min_.assign_copy(cell, cell_size);
+      }
+      if (first || type_info_->Compare(cell, max_cell.data) > 0) {
+        max_.assign_copy(cell, cell_size);
+      }
+    }
+  }
+  num_values_ += count;
+}
+
+void ZoneMapBuilder::AddNulls(size_t count) {
+  num_values_ += count;
+  null_count_ += count;
+}
+
+void ZoneMapBuilder::FinishBlock(rowid_t first_ordinal) {
+  ZoneMapEntryPB* entry = zone_map_.add_entries();
+  entry->set_first_ordinal(first_ordinal);
+  entry->set_num_values(num_values_);
+  if (null_count_ > 0) {
+    entry->set_null_count(null_count_);
+  }
+  if (num_values_ > null_count_ && !unbounded_) {
+    if (is_binary_) {
+      entry->set_min_value(min_.data(), std::min(min_.size(), kZoneMapMaxBinaryValueLength));
+      if (max_.size() <= kZoneMapMaxBinaryValueLength) {
+        entry->set_max_value(max_.data(), max_.size());
+      }
+    } else {
+      entry->set_min_value(min_.data(), min_.size());
+      entry->set_max_value(max_.data(), max_.size());
+    }
+  }
+  Reset();
+}
+
+void ZoneMapBuilder::AddBlockEntry(const ZoneMapEntryPB& entry, rowid_t first_ordinal) {
+  DCHECK_EQ(0, num_values_);
+  ZoneMapEntryPB* copy = zone_map_.add_entries();
+  *copy = entry;
+  copy->set_first_ordinal(first_ordinal);
+}
+
+////////////////////////////////////////////////////////////
+// ZoneMap
+////////////////////////////////////////////////////////////
+
+ZoneMap::ZoneMap(const TypeInfo* type_info)
+    : type_info_(type_info),
+      is_binary_(type_info->physical_type() == BINARY) {
+}
+
+Status ZoneMap::Parse(const TypeInfo* type_info, Slice data,
+                      unique_ptr<ZoneMap>* zone_map) {
+  unique_ptr<ZoneMap> zm(new ZoneMap(type_info));
+  if (!zm->pb_.ParseFromArray(data.data(), data.size())) {
+    return Status::Corruption("invalid zone map block");
+  }
+  rowid_t next_ordinal = 0;
+  for (const auto& entry : zm->pb_.entries()) {
+    if (entry.first_ordinal() < next_ordinal) {
+      return Status::Corruption(Substitute("zone map entries out of order at ordinal $0",
+                                           entry.first_ordinal()));
+    }
+    if (!zm->is_binary_ &&
+        ((entry.has_min_value() && entry.min_value().size() != type_info->size()) ||
+         (entry.has_max_value() && entry.max_value().size() != type_info->size()))) {
+      return Status::Corruption(Substitute("invalid zone map value size at ordinal $0",
+                                           entry.first_ordinal()));
+    }
+    next_ordinal = entry.first_ordinal() + entry.num_values();
+  }
+  *zone_map = std::move(zm);
+  return Status::OK();
+}
+
+bool ZoneMap::EntryMayMatch(const ColumnPredicate& pred, const ZoneMapEntryPB& entry) const {
+  const bool has_nulls = entry.null_count() > 0;
+  const bool has_values = entry.num_values() > entry.null_count();
+  if (is_binary_) {
+    Slice min(entry.min_value());
+    Slice max(entry.max_value());
+    return pred.MayMatchRange(has_nulls, has_values,
+                              entry.has_min_value() ? &min : nullptr,
+                              entry.has_max_value() ? &max : nullptr);
+  }
+  CellBuffer min;
+  CellBuffer max;
+  if (entry.has_min_value()) {
+    memcpy(min.data, entry.min_value().data(), type_info_->size());
+  }
+  if (entry.has_max_value()) {
+    memcpy(max.data, entry.max_value().data(), type_info_->size());
+  }
+  return pred.MayMatchRange(has_nulls, has_values,
+                            entry.has_min_value() ? min.data : nullptr,
+                            entry.has_max_value() ? max.data : nullptr);
+}
+
+bool ZoneMap::MayMatch(const ColumnPredicate& pred,
+                       rowid_t first_ordinal, rowid_t last_ordinal) const {
+  DCHECK_LE(first_ordinal, last_ordinal);
+  const auto& entries = pb_.entries();
+  // Find the last entry which starts at or before 'first_ordinal'.
+  auto it = std::upper_bound(entries.begin(), entries.end(), first_ordinal,
+                             [](rowid_t ord, const ZoneMapEntryPB& entry) {
+                               return ord < entry.first_ordinal();
+                             });
+  if (it == entries.begin()) {
+    return true;
+  }
+  --it;
+
+  // Walk the entries covering the range. Any part of the range which isn't
+  // covered by an entry may match.
+  rowid_t next_ordinal = first_ordinal;
+  for (; it != entries.end() && it->first_ordinal() <= last_ordinal; ++it) {
+    if (it->first_ordinal() > next_ordinal) {
+      return true;
+    }
+    if (EntryMayMatch(pred, *it)) {
+      return true;
+    }
+    next_ordinal = std::max(next_ordinal, it->first_ordinal() + it->num_values());
+  }
+  return next_ordinal <= last_ordinal;
+}
+
+const ZoneMapEntryPB* ZoneMap::FindBlockEntry(rowid_t first_ordinal) const {
+  const auto& entries = pb_.entries();
+  auto it = std::lower_bound(entries.begin(), entries.end(), first_ordinal,
+                             [](const ZoneMapEntryPB& entry, rowid_t ord) {
+                               return entry.first_ordinal() < ord;
+                             });
+  if (it == entries.end() || it->first_ordinal() != first_ordinal) {
+    return nullptr;
+  }
+  return &*it;
+}
+
+size_t ZoneMap::memory_footprint() const {
+  return kudu_malloc_usable_size(this) + pb_.SpaceUsed() - sizeof(pb_);
+}
+
+} // namespace cfile
+} // namespace kudu
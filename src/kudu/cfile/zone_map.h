@@ -0,0 +1,127 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "kudu/cfile/cfile.pb.h"
+#include "kudu/common/rowid.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class ColumnPredicate;
+class TypeInfo;
+
+namespace cfile {
+
+// Binary min values longer than this are truncated to a prefix, which is
+// still a valid lower bound. Binary max values longer than this are not
+// stored at all.
+extern const size_t kZoneMapMaxBinaryValueLength;
+
+// Accumulates the statistics of the data blocks of a cfile as they are
+// written, building a ZoneMapPB.
+class ZoneMapBuilder {
+ public:
+  explicit ZoneMapBuilder(const TypeInfo* type_info);
+
+  // Adds 'count' non-NULL cells, laid out contiguously starting at 'cells',
+  // to the statistics of the current block.
+  void AddValues(const void* cells, size_t count);
+
+  // Adds 'count' NULL cells to the statistics of the current block.
+  void AddNulls(size_t count);
+
+  // Finishes the current block, whose first value has ordinal
+  // 'first_ordinal', and starts a new one.
+  void FinishBlock(rowid_t first_ordinal);
+
+  // Adds the statistics of a block copied from another cfile, whose entry in
+  // the zone map of that file is 'entry', as the block whose first value has
+  // ordinal 'first_ordinal'.
+  //
+  // REQUIRES: no values were added since the last block was finished.
+  void AddBlockEntry(const ZoneMapEntryPB& entry, rowid_t first_ordinal);
+
+  // Returns the zone map of the blocks finished so far.
+  const ZoneMapPB& zone_map() const { return zone_map_; }
+
+ private:
+  void Reset();
+
+  const TypeInfo* const type_info_;
+  const bool is_binary_;
+  const bool is_floating_point_;
+
+  // The statistics of the current block.
+  size_t num_values_;
+  size_t null_count_;
+  // Set if the values of the block can't be bounded, e.g. if they include
+  // a floating point NaN.
+  bool unbounded_;
+  // The current min and max values, in cell format for fixed-size types or
+  // as the raw bytes of binary values.
+  faststring min_;
+  faststring max_;
+
+  ZoneMapPB zone_map_;
+
+  DISALLOW_COPY_AND_ASSIGN(ZoneMapBuilder);
+};
+
+// A parsed zone map of a cfile, used to decide whether ranges of rows may
+// contain values matching a predicate.
+class ZoneMap {
+ public:
+  // Parses the serialized ZoneMapPB 'data' of a cfile of type 'type_info'.
+  //
+  // Returns Corruption if the zone map can't be parsed or is malformed.
+  static Status Parse(const TypeInfo* type_info, Slice data,
+                      std::unique_ptr<ZoneMap>* zone_map);
+
+  // Returns false if no value with an ordinal in the inclusive range
+  // ['first_ordinal', 'last_ordinal'] can match 'pred'. Returns true if such
+  // a value may exist, or if the zone map doesn't cover the whole range.
+  bool MayMatch(const ColumnPredicate& pred,
+                rowid_t first_ordinal, rowid_t last_ordinal) const;
+
+  // Returns the entry of the block whose first value has ordinal
+  // 'first_ordinal', or nullptr if there's none.
+  const ZoneMapEntryPB* FindBlockEntry(rowid_t first_ordinal) const;
+
+  // Returns the memory usage of this object including the object itself.
+  size_t memory_footprint() const;
+
+ private:
+  explicit ZoneMap(const TypeInfo* type_info);
+
+  bool EntryMayMatch(const ColumnPredicate& pred, const ZoneMapEntryPB& entry) const;
+
+  const TypeInfo* const type_info_;
+  const bool is_binary_;
+  ZoneMapPB pb_;
+
+  DISALLOW_COPY_AND_ASSIGN(ZoneMap);
+};
+
+} // namespace cfile
+} // namespace kudu
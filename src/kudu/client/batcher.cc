@@ -28,6 +28,7 @@
 #include <utility>
 #include <vector>
 
+#include <boost/bind.hpp> // IWYU pragma: keep
 #include <glog/logging.h>
 
 #include "kudu/client/callbacks.h"
@@ -41,6 +42,7 @@
 #include "kudu/client/write_op-internal.h"
 #include "kudu/client/write_op.h"
 #include "kudu/common/common.pb.h"
+#include "kudu/common/encoded_key.h"
 #include "kudu/common/partition.h"
 #include "kudu/common/row_operations.h"
 #include "kudu/common/wire_protocol.h"
@@ -53,12 +55,15 @@
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/connection.h"
+#include "kudu/rpc/messenger.h"
 #include "kudu/rpc/request_tracker.h"
 #include "kudu/rpc/response_callback.h"
 #include "kudu/rpc/retriable_rpc.h"
 #include "kudu/rpc/rpc.h"
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/rpc/rpc_header.pb.h"
+#include "kudu/rpc/rpc_sidecar.h"
+#include "kudu/rpc/transfer.h"
 #include "kudu/security/token.pb.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/tserver/tserver_service.proxy.h"
@@ -92,6 +97,9 @@ using rpc::RequestTracker;
 using rpc::ResponseCallback;
 using rpc::RetriableRpc;
 using rpc::RetriableRpcStatus;
+using rpc::RpcController;
+using rpc::RpcSidecar;
+using rpc::TransferLimits;
 using security::SignedTokenPB;
 using tserver::WriteRequestPB;
 using tserver::WriteResponsePB;
@@ -197,6 +205,10 @@ struct InFlightOp {
   // order of operations. This is important when multiple operations act on the same row.
   int sequence_number_;
 
+  // With write coalescing, the table ID and encoded primary key of the row,
+  // which key the batcher's 'coalescable_ops_'. Empty otherwise.
+  string row_key;
+
   // Stringifies the InFlightOp.
   //
   // This should be used in log messages instead of KuduWriteOperation::ToString
@@ -208,6 +220,43 @@ struct InFlightOp {
   }
 };
 
+// The minimum size of the encoded row operations of a Write RPC for them to be
+// sent in sidecars rather than in the request.
+const int64_t kMinSidecarRowOperationsBytes = 64 * 1024;
+
+namespace {
+
+// Returns how long a write to 'ts' should be delayed to honor the tablet
+// server's backpressure hints, without being delayed past 'deadline'.
+MonoDelta WriteBackpressureDelay(const RemoteTabletServer* ts, const MonoTime& deadline) {
+  return std::min(ts->write_backpressure_deadline(), deadline) - MonoTime::Now();
+}
+
+// Records the backpressure hint of the tablet server 'ts' in 'resp', if any.
+void RecordWriteBackpressure(const WriteResponsePB& resp, RemoteTabletServer* ts) {
+  if (resp.has_backpressure_delay_ms()) {
+    ts->SetWriteBackpressure(MonoDelta::FromMilliseconds(resp.backpressure_delay_ms()));
+  }
+}
+
+// Whether an op of type 'next' may be merged into the op of type 'prev' on the
+// same row added right before it, i.e. whether applying 'prev' with the cells
+// set by 'next' overwriting its own has the same effect as applying both.
+// That's not the case of e.g. an UPDATE following an INSERT, which may fail
+// because the row is already present.
+bool CanCoalesce(KuduWriteOperation::Type prev, KuduWriteOperation::Type next) {
+  switch (next) {
+    case KuduWriteOperation::UPSERT:
+      return prev == KuduWriteOperation::UPSERT;
+    case KuduWriteOperation::UPDATE:
+      return prev == KuduWriteOperation::UPSERT || prev == KuduWriteOperation::UPDATE;
+    default:
+      return false;
+  }
+}
+
+} // anonymous namespace
+
 // A Write RPC which is in-flight to a tablet. Initially, the RPC is sent
 // to the leader replica, but it may be retried with another replica if the
 // leader fails.
@@ -235,6 +284,26 @@ class WriteRpc : public RetriableRpc<RemoteTabletServer, WriteRequestPB, WriteRe
   const WriteResponsePB& resp() const { return resp_; }
   const string& tablet_id() const { return tablet_id_; }
 
+  // Fills 'req' with the write of 'ops' to the tablet 'tablet_id', and marks
+  // the ops as sent.
+  static void BuildRequest(KuduClient* client,
+                           KuduSession::ExternalConsistencyMode consistency_mode,
+                           const string& tablet_id,
+                           const vector<InFlightOp*>& ops,
+                           uint64_t propagated_timestamp,
+                           WriteRequestPB* req);
+
+  // Sets the authz token of 'req' to the cached token for 'table', if any.
+  // Note that this doesn't get a new token from the master, but rather, it
+  // updates 'req' with one from the cache in case the client has recently
+  // received one.
+  //
+  // If an appropriate authz token is not in the cache, e.g. because the client
+  // has been communicating with an older-versioned master that doesn't support
+  // authz tokens, this is a no-op.
+  static void FetchCachedAuthzToken(KuduClient* client, const KuduTable* table,
+                                    WriteRequestPB* req);
+
  protected:
   void Try(RemoteTabletServer* replica, const ResponseCallback& callback) override;
   RetriableRpcStatus AnalyzeResponse(const Status& rpc_cb_status) override;
@@ -249,15 +318,9 @@ class WriteRpc : public RetriableRpc<RemoteTabletServer, WriteRequestPB, WriteRe
   void GotNewAuthzTokenRetryCb(const Status& status) override;
 
  private:
-  // Fetches the appropriate authz token for this request from the client
-  // cache. Note that this doesn't get a new token from the master, but rather,
-  // it updates 'req_' with one from the cache in case the client has recently
-  // received one.
-  //
-  // If an appropriate authz token is not in the cache, e.g. because the client
-  // has been communicating with an older-versioned master that doesn't support
-  // authz tokens, this is a no-op.
-  void FetchCachedAuthzToken();
+  // Moves the encoded row operations from the sidecar buffers back into the
+  // request, for tablet servers which don't support them in sidecars.
+  void MoveRowOperationsToRequest();
 
   // Pointer back to the batcher. Processes the write response when it
   // completes, regardless of success or failure.
@@ -269,6 +332,15 @@ class WriteRpc : public RetriableRpc<RemoteTabletServer, WriteRequestPB, WriteRe
 
   // The id of the tablet being written to.
   string tablet_id_;
+
+  // The tablet server the last attempt was sent to.
+  RemoteTabletServer* current_ts_;
+
+  // Whether the encoded row operations are sent in sidecars rather than in the
+  // request, in which case they are in 'rows_' and 'indirect_data_'.
+  bool use_sidecars_;
+  string rows_;
+  string indirect_data_;
 };
 
 WriteRpc::WriteRpc(const scoped_refptr<Batcher>& batcher,
@@ -282,41 +354,92 @@ WriteRpc::WriteRpc(const scoped_refptr<Batcher>& batcher,
     : RetriableRpc(replica_picker, request_tracker, deadline, std::move(messenger)),
       batcher_(batcher),
       ops_(std::move(ops)),
-      tablet_id_(tablet_id) {
-  const Schema* schema = table()->schema().schema_;
+      tablet_id_(tablet_id),
+      current_ts_(nullptr),
+      use_sidecars_(false) {
+  BuildRequest(batcher_->client_, batcher_->external_consistency_mode(),
+               tablet_id_, ops_, propagated_timestamp, &req_);
+
+  // The row operations of large batches are sent in sidecars, which the
+  // tablet server decodes from the buffer the call is read into, saving the
+  // copy of the data made when parsing the request.
+  RowOperationsPB* row_operations = req_.mutable_row_operations();
+  int64_t data_size = row_operations->rows().size() + row_operations->indirect_data().size();
+  if (data_size >= kMinSidecarRowOperationsBytes &&
+      data_size < TransferLimits::kMaxTotalSidecarBytes) {
+    use_sidecars_ = true;
+    rows_.swap(*row_operations->mutable_rows());
+    indirect_data_.swap(*row_operations->mutable_indirect_data());
+    row_operations->clear_rows();
+    row_operations->clear_indirect_data();
+  }
+}
 
-  req_.set_tablet_id(tablet_id_);
-  switch (batcher->external_consistency_mode()) {
+void WriteRpc::MoveRowOperationsToRequest() {
+  DCHECK(use_sidecars_);
+  use_sidecars_ = false;
+  RowOperationsPB* row_operations = req_.mutable_row_operations();
+  row_operations->clear_rows_sidecar();
+  row_operations->clear_indirect_data_sidecar();
+  row_operations->mutable_rows()->swap(rows_);
+  row_operations->mutable_indirect_data()->swap(indirect_data_);
+}
+
+void WriteRpc::FetchCachedAuthzToken(KuduClient* client, const KuduTable* table,
+                                     WriteRequestPB* req) {
+  SignedTokenPB signed_token;
+  if (client->data_->FetchCachedAuthzToken(table->id(), &signed_token)) {
+    *req->mutable_authz_token() = std::move(signed_token);
+  } else {
+    // Note: this is the expected path if communicating with an older-versioned
+    // master that does not support authz tokens.
+    VLOG(1) << "no authz token for table " << table->id();
+  }
+}
+
+void WriteRpc::BuildRequest(KuduClient* client,
+                            KuduSession::ExternalConsistencyMode consistency_mode,
+                            const string& tablet_id,
+                            const vector<InFlightOp*>& ops,
+                            uint64_t propagated_timestamp,
+                            WriteRequestPB* req) {
+  // All of the ops for a given tablet obviously correspond to the same table,
+  // so we'll just grab the table from the first.
+  const KuduTable* table = ops[0]->write_op->table();
+  const Schema* schema = table->schema().schema_;
+
+  req->set_tablet_id(tablet_id);
+  switch (consistency_mode) {
     case kudu::client::KuduSession::CLIENT_PROPAGATED:
-      req_.set_external_consistency_mode(kudu::CLIENT_PROPAGATED);
+      req->set_external_consistency_mode(kudu::CLIENT_PROPAGATED);
       break;
     case kudu::client::KuduSession::COMMIT_WAIT:
-      req_.set_external_consistency_mode(kudu::COMMIT_WAIT);
+      req->set_external_consistency_mode(kudu::COMMIT_WAIT);
       break;
     default:
-      LOG(FATAL) << "Unsupported consistency mode: " << batcher->external_consistency_mode();
+      LOG(FATAL) << "Unsupported consistency mode: " << consistency_mode;
 
   }
   // If set, propagate the latest observed timestamp.
   if (PREDICT_TRUE(propagated_timestamp != KuduClient::kNoTimestamp)) {
-    req_.set_propagated_timestamp(propagated_timestamp);
+    req->set_propagated_timestamp(propagated_timestamp);
   }
 
   // Set up schema
-  CHECK_OK(SchemaToPB(*schema, req_.mutable_schema(),
+  CHECK_OK(SchemaToPB(*schema, req->mutable_schema(),
                       SCHEMA_PB_WITHOUT_STORAGE_ATTRIBUTES | SCHEMA_PB_WITHOUT_IDS));
 
   // Pick up the authz token for the table.
-  FetchCachedAuthzToken();
-  RowOperationsPB* requested = req_.mutable_row_operations();
+  FetchCachedAuthzToken(client, table, req);
+  RowOperationsPB* requested = req->mutable_row_operations();
 
   // Add the rows
   int ctr = 0;
   RowOperationsPBEncoder enc(requested);
-  for (InFlightOp* op : ops_) {
+  for (InFlightOp* op : ops) {
 #ifndef NDEBUG
     const Partition& partition = op->tablet->partition();
-    const PartitionSchema& partition_schema = table()->partition_schema();
+    const PartitionSchema& partition_schema = table->partition_schema();
     const KuduPartialRow& row = op->write_op->row();
     bool partition_contains_row;
     CHECK(partition_schema.PartitionContainsRow(partition, row, &partition_contains_row).ok());
@@ -336,7 +459,7 @@ WriteRpc::WriteRpc(const scoped_refptr<Batcher>& batcher,
   }
 
   VLOG(3) << Substitute("Created batch for $0:\n$1",
-                        tablet_id, SecureShortDebugString(req_));
+                        tablet_id, SecureShortDebugString(*req));
 }
 
 WriteRpc::~WriteRpc() {
@@ -350,9 +473,34 @@ string WriteRpc::ToString() const {
 
 void WriteRpc::Try(RemoteTabletServer* replica, const ResponseCallback& callback) {
   VLOG(2) << "Tablet " << tablet_id_ << ": Writing batch to replica " << replica->ToString();
-  replica->proxy()->WriteAsync(req_, &resp_,
-                               mutable_retrier()->mutable_controller(),
-                               callback);
+  RpcController* controller = mutable_retrier()->mutable_controller();
+  if (use_sidecars_) {
+    // The sidecars are moved into the call, and so are added on every attempt.
+    // Their total size was checked against the limit when building the request.
+    RowOperationsPB* row_operations = req_.mutable_row_operations();
+    int idx;
+    CHECK_OK(controller->AddOutboundSidecar(RpcSidecar::FromSlice(Slice(rows_)), &idx));
+    row_operations->set_rows_sidecar(idx);
+    CHECK_OK(controller->AddOutboundSidecar(RpcSidecar::FromSlice(Slice(indirect_data_)), &idx));
+    row_operations->set_indirect_data_sidecar(idx);
+    controller->RequireServerFeature(tserver::TabletServerFeatures::WRITE_ROW_OPERATIONS_SIDECARS);
+  }
+  current_ts_ = replica;
+
+  // If the tablet server asked for writes to slow down, send the write once
+  // the requested delay has passed rather than having it rejected.
+  const MonoDelta delay = WriteBackpressureDelay(replica, retrier().deadline());
+  if (delay.ToNanoseconds() > 0) {
+    VLOG(2) << "Tablet " << tablet_id_ << ": delaying write to " << replica->ToString()
+            << " by " << delay.ToString() << " on backpressure";
+    // If the messenger is shutting down, the write fails right away once sent.
+    batcher_->client_->data_->messenger_->ScheduleOnReactor(
+        [this, replica, controller, callback](const Status& /* s */) {
+          replica->proxy()->WriteAsync(req_, &resp_, controller, callback);
+        }, delay);
+    return;
+  }
+  replica->proxy()->WriteAsync(req_, &resp_, controller, callback);
 }
 
 void WriteRpc::Finish(const Status& status) {
@@ -364,7 +512,7 @@ void WriteRpc::Finish(const Status& status) {
                    ops_.size(), tablet_id_, num_attempts()));
     KLOG_EVERY_N_SECS(WARNING, 1) << final_status.ToString();
   }
-  batcher_->ProcessWriteResponse(*this, final_status);
+  batcher_->ProcessWriteResponse(tablet_id_, ops_, resp_, final_status);
 }
 
 RetriableRpcStatus WriteRpc::AnalyzeResponse(const Status& rpc_cb_status) {
@@ -376,6 +524,9 @@ RetriableRpcStatus WriteRpc::AnalyzeResponse(const Status& rpc_cb_status) {
   if (rpc_cb_status.ok()) {
     result.status = mutable_retrier()->controller().status();
   }
+  if (result.status.ok() && current_ts_) {
+    RecordWriteBackpressure(resp_, current_ts_);
+  }
 
   // Check for specific RPC errors.
   if (result.status.IsRemoteError()) {
@@ -384,11 +535,23 @@ RetriableRpcStatus WriteRpc::AnalyzeResponse(const Status& rpc_cb_status) {
       switch (err->code()) {
         case ErrorStatusPB::ERROR_SERVER_TOO_BUSY:
         case ErrorStatusPB::ERROR_UNAVAILABLE:
+          batcher_->server_busy_.Store(true);
           result.result = RetriableRpcStatus::SERVICE_UNAVAILABLE;
           return result;
         case ErrorStatusPB::ERROR_INVALID_AUTHORIZATION_TOKEN:
           result.result = RetriableRpcStatus::INVALID_AUTHORIZATION_TOKEN;
           return result;
+        case ErrorStatusPB::ERROR_INVALID_REQUEST:
+          if (use_sidecars_ && err->unsupported_feature_flags_size() > 0) {
+            // The tablet server predates row operations in sidecars: send them
+            // in the request itself.
+            VLOG(1) << "Tablet " << tablet_id_ << ": tablet server doesn't support "
+                    << "row operations in sidecars, retrying without them";
+            MoveRowOperationsToRequest();
+            result.result = RetriableRpcStatus::SERVICE_UNAVAILABLE;
+            return result;
+          }
+          break;
         default:
           break;
       }
@@ -396,6 +559,7 @@ RetriableRpcStatus WriteRpc::AnalyzeResponse(const Status& rpc_cb_status) {
   }
 
   if (result.status.IsServiceUnavailable()) {
+    batcher_->server_busy_.Store(true);
     result.result = RetriableRpcStatus::SERVICE_UNAVAILABLE;
     return result;
   }
@@ -490,24 +654,153 @@ bool WriteRpc::GetNewAuthzTokenAndRetry() {
   return true;
 }
 
-void WriteRpc::FetchCachedAuthzToken() {
-  SignedTokenPB signed_token;
-  if (batcher_->client_->data_->FetchCachedAuthzToken(table()->id(), &signed_token)) {
-    *req_.mutable_authz_token() = std::move(signed_token);
-  } else {
-    // Note: this is the expected path if communicating with an older-versioned
-    // master that does not support authz tokens.
-    VLOG(1) << "no authz token for table " << table()->id();
-  }
-}
-
 void WriteRpc::GotNewAuthzTokenRetryCb(const Status& status) {
   if (status.ok()) {
-    FetchCachedAuthzToken();
+    FetchCachedAuthzToken(batcher_->client_, table(), &req_);
   }
   RetriableRpc::GotNewAuthzTokenRetryCb(status);
 }
 
+// A MultiWrite RPC sent to a tablet server, carrying the writes to several
+// tablets whose leader it hosts.
+//
+// The RPC isn't retried: the ops of the tablets whose write fails, or of all
+// the tablets if the RPC itself fails, are sent again in a WriteRpc per
+// tablet, which handles leader failover and retries.
+//
+// Keeps a reference on the owning batcher while alive.
+class MultiWriteRpc {
+ public:
+  // A tablet and the ops written to it.
+  typedef pair<RemoteTablet*, vector<InFlightOp*>> TabletOps;
+
+  MultiWriteRpc(const scoped_refptr<Batcher>& batcher,
+                RemoteTabletServer* ts,
+                vector<TabletOps> tablets_ops,
+                const MonoTime& deadline,
+                shared_ptr<Messenger> messenger,
+                uint64_t propagated_timestamp);
+  ~MultiWriteRpc();
+
+  // Sends the RPC. The instance deletes itself once the RPC completed.
+  void SendRpc();
+
+ private:
+  void InitProxyCb(const Status& s);
+  void Send();
+  void SendRpcCb();
+
+  // Processes the responses to the writes that were applied, and sends the
+  // others in a WriteRpc per tablet. Takes ownership of the ops.
+  void Finish(const Status& s);
+
+  scoped_refptr<Batcher> batcher_;
+  RemoteTabletServer* ts_;
+  const MonoTime deadline_;
+  const shared_ptr<Messenger> messenger_;
+
+  // The ops written to each tablet, in the order of the writes in 'req_'.
+  vector<TabletOps> tablets_ops_;
+
+  tserver::MultiWriteRequestPB req_;
+  tserver::MultiWriteResponsePB resp_;
+  rpc::RpcController controller_;
+
+  DISALLOW_COPY_AND_ASSIGN(MultiWriteRpc);
+};
+
+MultiWriteRpc::MultiWriteRpc(const scoped_refptr<Batcher>& batcher,
+                             RemoteTabletServer* ts,
+                             vector<TabletOps> tablets_ops,
+                             const MonoTime& deadline,
+                             shared_ptr<Messenger> messenger,
+                             uint64_t propagated_timestamp)
+    : batcher_(batcher),
+      ts_(ts),
+      deadline_(deadline),
+      messenger_(std::move(messenger)),
+      tablets_ops_(std::move(tablets_ops)) {
+  for (const TabletOps& tablet_ops : tablets_ops_) {
+    WriteRpc::BuildRequest(batcher_->client_, batcher_->external_consistency_mode(),
+                           tablet_ops.first->tablet_id(), tablet_ops.second,
+                           propagated_timestamp, req_.add_writes());
+  }
+  controller_.set_deadline(deadline);
+  controller_.RequireServerFeature(tserver::TabletServerFeatures::MULTI_TABLET_WRITE);
+}
+
+MultiWriteRpc::~MultiWriteRpc() {
+  for (TabletOps& tablet_ops : tablets_ops_) {
+    STLDeleteElements(&tablet_ops.second);
+  }
+}
+
+void MultiWriteRpc::SendRpc() {
+  ts_->InitProxy(batcher_->client_, Bind(&MultiWriteRpc::InitProxyCb, Unretained(this)));
+}
+
+void MultiWriteRpc::InitProxyCb(const Status& s) {
+  if (!s.ok()) {
+    Finish(s);
+    return;
+  }
+  const MonoDelta delay = WriteBackpressureDelay(ts_, deadline_);
+  if (delay.ToNanoseconds() > 0) {
+    VLOG(2) << Substitute("Delaying write to $0 tablets of tablet server $1 by $2 "
+                          "on backpressure", tablets_ops_.size(), ts_->ToString(),
+                          delay.ToString());
+    messenger_->ScheduleOnReactor([this](const Status& /* s */) { Send(); }, delay);
+    return;
+  }
+  Send();
+}
+
+void MultiWriteRpc::Send() {
+  VLOG(2) << Substitute("Writing batch to $0 tablets of tablet server $1",
+                        tablets_ops_.size(), ts_->ToString());
+  ts_->proxy()->MultiWriteAsync(req_, &resp_, &controller_,
+                                boost::bind(&MultiWriteRpc::SendRpcCb, this));
+}
+
+void MultiWriteRpc::SendRpcCb() {
+  Status s = controller_.status();
+  if (s.ok() && resp_.responses_size() != static_cast<int>(tablets_ops_.size())) {
+    s = Status::Corruption(Substitute("received $0 write responses for $1 tablets",
+                                      resp_.responses_size(), tablets_ops_.size()));
+  }
+  if (s.ok()) {
+    for (const auto& resp : resp_.responses()) {
+      RecordWriteBackpressure(resp, ts_);
+    }
+  }
+  Finish(s);
+}
+
+void MultiWriteRpc::Finish(const Status& s) {
+  unique_ptr<MultiWriteRpc> this_instance(this);
+  if (!s.ok()) {
+    KLOG_EVERY_N_SECS(WARNING, 1) << Substitute(
+        "Failed to write batch to $0 tablets of tablet server $1, writing to each "
+        "tablet separately: $2", tablets_ops_.size(), ts_->ToString(), s.ToString());
+  }
+  for (int i = 0; i < static_cast<int>(tablets_ops_.size()); i++) {
+    RemoteTablet* tablet = tablets_ops_[i].first;
+    vector<InFlightOp*> ops;
+    ops.swap(tablets_ops_[i].second);
+    if (!s.ok() || resp_.responses(i).has_error()) {
+      // The write wasn't applied, e.g. because the tablet server isn't the
+      // leader of the tablet anymore: send it again on its own.
+      VLOG(2) << Substitute("Writing batch to tablet $0 separately: $1", tablet->tablet_id(),
+                            s.ok() ? SecureShortDebugString(resp_.responses(i).error())
+                                   : s.ToString());
+      batcher_->FlushBuffer(tablet, ops);
+      continue;
+    }
+    batcher_->ProcessWriteResponse(tablet->tablet_id(), ops, resp_.responses(i), Status::OK());
+    STLDeleteElements(&ops);
+  }
+}
+
 Batcher::Batcher(KuduClient* client,
                  scoped_refptr<ErrorCollector> error_collector,
                  sp::weak_ptr<KuduSession> session,
@@ -521,6 +814,9 @@ Batcher::Batcher(KuduClient* client,
     flush_callback_(nullptr),
     next_op_sequence_number_(0),
     timeout_(client->default_rpc_timeout()),
+    server_busy_(false),
+    multi_tablet_writes_(false),
+    write_coalescing_(false),
     outstanding_lookups_(0),
     buffer_bytes_used_(0) {
 }
@@ -565,6 +861,16 @@ void Batcher::SetTimeout(const MonoDelta& timeout) {
 }
 
 
+void Batcher::SetMultiTabletWrites(bool enabled) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  multi_tablet_writes_ = enabled;
+}
+
+void Batcher::SetWriteCoalescing(bool enabled) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  write_coalescing_ = enabled;
+}
+
 bool Batcher::HasPendingOperations() const {
   std::lock_guard<simple_spinlock> l(lock_);
   return !ops_.empty();
@@ -619,6 +925,8 @@ void Batcher::FlushAsync(KuduStatusCallback* cb) {
     state_ = kFlushing;
     flush_callback_ = cb;
     deadline_ = ComputeDeadlineUnlocked();
+    flush_start_time_ = MonoTime::Now();
+    coalescable_ops_.clear();
   }
 
   // In the case that we have nothing buffered, just call the callback
@@ -636,6 +944,26 @@ void Batcher::FlushAsync(KuduStatusCallback* cb) {
 }
 
 Status Batcher::Add(KuduWriteOperation* write_op) {
+  string row_key;
+  bool write_coalescing;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    write_coalescing = write_coalescing_;
+  }
+  if (write_coalescing) {
+    gscoped_ptr<EncodedKey> key(write_op->CreateKey());
+    row_key = write_op->table()->id() + key->encoded_key().ToString();
+    bool coalesced;
+    RETURN_NOT_OK(CoalesceOp(row_key, write_op, &coalesced));
+    if (coalesced) {
+      // The op's buffer space is released along with the other ops'
+      // when the flush finishes.
+      buffer_bytes_used_.IncrementBy(write_op->SizeInBuffer());
+      delete write_op;
+      return Status::OK();
+    }
+  }
+
   // As soon as we get the op, start looking up where it belongs,
   // so that when the user calls Flush, we are ready to go.
   gscoped_ptr<InFlightOp> op(new InFlightOp());
@@ -643,6 +971,7 @@ Status Batcher::Add(KuduWriteOperation* write_op) {
   RETURN_NOT_OK(write_op->table_->partition_schema().EncodeKey(write_op->row(), &partition_key));
   op->write_op.reset(write_op);
   op->state = InFlightOp::kLookingUpTablet;
+  op->row_key = std::move(row_key);
 
   AddInFlightOp(op.get());
   VLOG(3) << "Looking up tablet for " << op->ToString();
@@ -666,6 +995,21 @@ Status Batcher::Add(KuduWriteOperation* write_op) {
   return Status::OK();
 }
 
+Status Batcher::CoalesceOp(const string& row_key,
+                           KuduWriteOperation* write_op,
+                           bool* coalesced) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  CHECK_EQ(state_, kGatheringOps);
+  InFlightOp* prev = FindPtrOrNull(coalescable_ops_, row_key);
+  *coalesced = prev != nullptr &&
+      prev->write_op->table() == write_op->table() &&
+      CanCoalesce(prev->write_op->type(), write_op->type());
+  if (*coalesced) {
+    RETURN_NOT_OK(prev->write_op->MergeFrom(*write_op));
+  }
+  return Status::OK();
+}
+
 void Batcher::AddInFlightOp(InFlightOp* op) {
   DCHECK_EQ(op->state, InFlightOp::kLookingUpTablet);
 
@@ -674,6 +1018,16 @@ void Batcher::AddInFlightOp(InFlightOp* op) {
   InsertOrDie(&ops_, op);
   op->sequence_number_ = next_op_sequence_number_++;
 
+  // The ops added on the row from now on may only be merged into this op.
+  if (!op->row_key.empty()) {
+    const KuduWriteOperation::Type type = op->write_op->type();
+    if (type == KuduWriteOperation::UPSERT || type == KuduWriteOperation::UPDATE) {
+      coalescable_ops_[op->row_key] = op;
+    } else {
+      coalescable_ops_.erase(op->row_key);
+    }
+  }
+
   // Set the time of the first operation in the batch, if not set yet.
   if (PREDICT_FALSE(!first_op_time_.Initialized())) {
     first_op_time_ = MonoTime::Now();
@@ -697,6 +1051,12 @@ void Batcher::MarkInFlightOpFailed(InFlightOp* op, const Status& s) {
 void Batcher::MarkInFlightOpFailedUnlocked(InFlightOp* op, const Status& s) {
   CHECK_EQ(1, ops_.erase(op))
     << "Could not remove op " << op->ToString() << " from in-flight list";
+  if (!op->row_key.empty()) {
+    auto it = coalescable_ops_.find(op->row_key);
+    if (it != coalescable_ops_.end() && it->second == op) {
+      coalescable_ops_.erase(it);
+    }
+  }
   error_collector_->AddError(unique_ptr<KuduError>(new KuduError(op->write_op.release(), s)));
   had_errors_ = true;
   delete op;
@@ -773,6 +1133,7 @@ void Batcher::TabletLookupFinished(InFlightOp* op, const Status& s) {
 
 void Batcher::FlushBuffersIfReady() {
   unordered_map<RemoteTablet*, vector<InFlightOp*> > ops_copy;
+  bool multi_tablet_writes;
 
   // We're only ready to flush if:
   // 1. The batcher is in the flushing state (i.e. FlushAsync was called).
@@ -792,6 +1153,36 @@ void Batcher::FlushBuffersIfReady() {
     }
     // Take ownership of the ops while we're under the lock.
     ops_copy.swap(per_tablet_ops_);
+    multi_tablet_writes = multi_tablet_writes_;
+  }
+
+  if (multi_tablet_writes) {
+    // Group the tablets by the tablet server hosting their leader replica, and
+    // send one RPC per server with more than one tablet.
+    unordered_map<RemoteTabletServer*, vector<MultiWriteRpc::TabletOps>> per_ts_ops;
+    OpsMap single_tablet_ops;
+    for (OpsMap::value_type& e : ops_copy) {
+      RemoteTabletServer* leader = e.first->LeaderTServer();
+      if (leader) {
+        per_ts_ops[leader].emplace_back(e.first, std::move(e.second));
+      } else {
+        single_tablet_ops.emplace(e.first, std::move(e.second));
+      }
+    }
+    for (auto& e : per_ts_ops) {
+      if (e.second.size() == 1) {
+        single_tablet_ops.emplace(e.second[0].first, std::move(e.second[0].second));
+        continue;
+      }
+      MultiWriteRpc* rpc = new MultiWriteRpc(this,
+                                             e.first,
+                                             std::move(e.second),
+                                             deadline_,
+                                             client_->data_->messenger_,
+                                             client_->data_->GetLatestObservedTimestamp());
+      rpc->SendRpc();
+    }
+    ops_copy.swap(single_tablet_ops);
   }
 
   // Now flush the ops for each tablet.
@@ -831,7 +1222,9 @@ void Batcher::FlushBuffer(RemoteTablet* tablet, const vector<InFlightOp*>& ops)
   rpc->SendRpc();
 }
 
-void Batcher::ProcessWriteResponse(const WriteRpc& rpc,
+void Batcher::ProcessWriteResponse(const string& tablet_id,
+                                   const vector<InFlightOp*>& ops,
+                                   const WriteResponsePB& resp,
                                    const Status& s) {
   // TODO: there is a potential race here -- if the Batcher gets destructed while
   // RPCs are in-flight, then accessing state_ will crash. We probably need to keep
@@ -840,12 +1233,12 @@ void Batcher::ProcessWriteResponse(const WriteRpc& rpc,
   CHECK_EQ(state_, kFlushing);
 
   if (s.ok()) {
-    if (rpc.resp().has_timestamp()) {
-      client_->data_->UpdateLatestObservedTimestamp(rpc.resp().timestamp());
+    if (resp.has_timestamp()) {
+      client_->data_->UpdateLatestObservedTimestamp(resp.timestamp());
     }
   } else {
     // Mark each of the rows in the write op as failed, since the whole RPC failed.
-    for (InFlightOp* op : rpc.ops()) {
+    for (InFlightOp* op : ops) {
       unique_ptr<KuduError> error(new KuduError(op->write_op.release(), s));
       error_collector_->AddError(std::move(error));
     }
@@ -854,19 +1247,19 @@ void Batcher::ProcessWriteResponse(const WriteRpc& rpc,
   }
 
   // Check individual row errors.
-  for (const WriteResponsePB_PerRowErrorPB& err_pb : rpc.resp().per_row_errors()) {
+  for (const WriteResponsePB_PerRowErrorPB& err_pb : resp.per_row_errors()) {
     // TODO(todd): handle case where we get one of the more specific TS errors
     // like the tablet not being hosted?
 
-    if (err_pb.row_index() >= rpc.ops().size()) {
+    if (err_pb.row_index() >= ops.size()) {
       LOG(ERROR) << "Received a per_row_error for an out-of-bound op index "
                  << err_pb.row_index() << " (sent only "
-                 << rpc.ops().size() << " ops)";
-      LOG(ERROR) << "Response from tablet " << rpc.tablet_id() << ":\n"
-                 << SecureDebugString(rpc.resp());
+                 << ops.size() << " ops)";
+      LOG(ERROR) << "Response from tablet " << tablet_id << ":\n"
+                 << SecureDebugString(resp);
       continue;
     }
-    gscoped_ptr<KuduWriteOperation> op = std::move(rpc.ops()[err_pb.row_index()]->write_op);
+    gscoped_ptr<KuduWriteOperation> op = std::move(ops[err_pb.row_index()]->write_op);
     VLOG(2) << "Error on op " << op->ToString() << ": "
             << SecureShortDebugString(err_pb.error());
     Status op_status = StatusFromPB(err_pb.error());
@@ -896,7 +1289,7 @@ void Batcher::ProcessWriteResponse(const WriteRpc& rpc,
   //     from which the Flush() is being called.
   {
     std::lock_guard<simple_spinlock> l(lock_);
-    for (InFlightOp* op : rpc.ops()) {
+    for (InFlightOp* op : ops) {
       CHECK_EQ(1, ops_.erase(op))
             << "Could not remove op " << op->ToString()
             << " from in-flight list";
@@ -19,6 +19,7 @@
 
 #include <cstdint>
 #include <mutex>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -36,6 +37,11 @@
 #include "kudu/util/status.h"
 
 namespace kudu {
+
+namespace tserver {
+class WriteResponsePB;
+} // namespace tserver
+
 namespace client {
 
 class KuduStatusCallback;
@@ -45,6 +51,7 @@ namespace internal {
 struct InFlightOp;
 
 class ErrorCollector;
+class MultiWriteRpc;
 class RemoteTablet;
 class WriteRpc;
 
@@ -83,6 +90,14 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
   // may time out before even sending an op). TODO: implement that
   void SetTimeout(const MonoDelta& timeout);
 
+  // Set whether to send the ops of the tablets led by the same tablet server
+  // in a single MultiWrite RPC. See KuduSession::SetMultiTabletWrites().
+  void SetMultiTabletWrites(bool enabled);
+
+  // Set whether to merge the UPSERT and UPDATE ops on a row into the op
+  // buffered before them. See KuduSession::SetWriteCoalescing().
+  void SetWriteCoalescing(bool enabled);
+
   // Add a new operation to the batch. Requires that the batch has not yet been flushed.
   //
   // NOTE: If this returns not-OK, does not take ownership of 'write_op'.
@@ -118,6 +133,18 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
     return first_op_time_;
   }
 
+  // Get the time FlushAsync() was called. Not initialized until then.
+  MonoTime flush_start_time() const {
+    std::lock_guard<simple_spinlock> l(lock_);
+    return flush_start_time_;
+  }
+
+  // Whether a tablet server asked to back off (i.e. responded with
+  // SERVICE_UNAVAILABLE) to any of the writes of this batcher.
+  bool server_busy() const {
+    return server_busy_.Load();
+  }
+
   // Return the total size (number of bytes) of all pending write operations
   // accumulated by the batcher.
   int64_t buffer_bytes_used() const {
@@ -131,6 +158,7 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
 
  private:
   friend class RefCountedThreadSafe<Batcher>;
+  friend class MultiWriteRpc;
   friend class WriteRpc;
 
   ~Batcher();
@@ -154,13 +182,23 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
   void MarkInFlightOpFailed(InFlightOp* op, const Status& s);
   void MarkInFlightOpFailedUnlocked(InFlightOp* op, const Status& s);
 
+  // If the last op added on the row 'row_key' may absorb 'write_op', merges
+  // 'write_op' into it and sets 'coalesced' to true. Otherwise, sets it to
+  // false, leaving 'write_op' to be added as usual.
+  Status CoalesceOp(const std::string& row_key,
+                    KuduWriteOperation* write_op,
+                    bool* coalesced);
+
   void CheckForFinishedFlush();
   void FlushBuffersIfReady();
   void FlushBuffer(RemoteTablet* tablet, const std::vector<InFlightOp*>& ops);
 
-  // Cleans up an RPC response, scooping out any errors and passing them up
-  // to the batcher.
-  void ProcessWriteResponse(const WriteRpc& rpc, const Status& s);
+  // Cleans up the response to the write of 'ops' to the tablet 'tablet_id',
+  // scooping out any errors and passing them up to the batcher.
+  void ProcessWriteResponse(const std::string& tablet_id,
+                            const std::vector<InFlightOp*>& ops,
+                            const tserver::WriteResponsePB& resp,
+                            const Status& s);
 
   // Async Callbacks.
   void TabletLookupFinished(InFlightOp* op, const Status& s);
@@ -222,6 +260,27 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
   // After flushing, the absolute deadline for all in-flight ops.
   MonoTime deadline_;
 
+  // The time FlushAsync() was called.
+  // Protected by lock_.
+  MonoTime flush_start_time_;
+
+  // See server_busy().
+  AtomicBool server_busy_;
+
+  // Whether the ops of the tablets led by the same tablet server are sent
+  // in a single MultiWrite RPC.
+  bool multi_tablet_writes_;
+
+  // Whether the UPSERT and UPDATE ops on a row are merged into the op
+  // buffered before them.
+  bool write_coalescing_;
+
+  // With write coalescing, the last op added on each row, keyed by table ID
+  // and encoded primary key, if the ops on the row added after it may be
+  // merged into it. Cleared by FlushAsync().
+  // Protected by lock_.
+  std::unordered_map<std::string, InFlightOp*> coalescable_ops_;
+
   // Number of outstanding lookups across all in-flight ops.
   //
   // Note: _not_ protected by lock_!
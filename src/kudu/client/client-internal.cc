@@ -65,6 +65,7 @@
 #include "kudu/util/net/dns_resolver.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/net/sockaddr.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/thread_restrictions.h"
 
 using std::pair;
@@ -107,6 +108,14 @@ using internal::ConnectToClusterRpc;
 using internal::RemoteTablet;
 using internal::RemoteTabletServer;
 
+namespace {
+
+// With the LOWEST_LATENCY replica selection, one in that many selections
+// picks a random replica instead of the one with the lowest latency.
+const int kLatencyExplorationOneIn = 16;
+
+} // anonymous namespace
+
 Status RetryFunc(const MonoTime& deadline,
                  const string& retry_msg,
                  const string& timeout_msg,
@@ -163,6 +172,9 @@ KuduClient::Data::~Data() {
   // fix urgently, because typically once a client is shutting down, latency
   // jitter on the reactor is not a big deal (and DNS resolutions are not in flight).
   ThreadRestrictions::ScopedAllowWait allow_wait;
+  if (async_pool_) {
+    async_pool_->Shutdown();
+  }
   dns_resolver_.reset();
 }
 
@@ -184,7 +196,8 @@ RemoteTabletServer* KuduClient::Data::SelectTServer(const scoped_refptr<RemoteTa
       break;
     }
     case CLOSEST_REPLICA:
-    case FIRST_REPLICA: {
+    case FIRST_REPLICA:
+    case LOWEST_LATENCY: {
       rt->GetRemoteTabletServers(candidates);
       // Exclude all the blacklisted candidates.
       vector<RemoteTabletServer*> filtered;
@@ -201,6 +214,26 @@ RemoteTabletServer* KuduClient::Data::SelectTServer(const scoped_refptr<RemoteTa
         }
         break;
       }
+      if (selection == LOWEST_LATENCY) {
+        if (filtered.empty()) {
+          break;
+        }
+        // Once in a while, pick a random replica so that a server which was
+        // slow gets a chance to show that it recovered.
+        if (rand() % kLatencyExplorationOneIn == 0) {
+          ret = filtered[rand() % filtered.size()];
+          break;
+        }
+        int64_t best_latency = 0;
+        for (RemoteTabletServer* rts : filtered) {
+          int64_t latency = rts->ExpectedLatencyMicros();
+          if (ret == nullptr || latency < best_latency) {
+            ret = rts;
+            best_latency = latency;
+          }
+        }
+        break;
+      }
       // Choose a replica as follows:
       // 1. If there is a replica local to the client, pick it. If there are
       // multiple, pick a random one.
@@ -56,6 +56,7 @@ namespace kudu {
 class DnsResolver;
 class PartitionSchema;
 class Sockaddr;
+class ThreadPool;
 
 namespace master {
 class AlterTableRequestPB;
@@ -244,6 +245,10 @@ class KuduClient::Data {
 
   std::shared_ptr<rpc::Messenger> messenger_;
   gscoped_ptr<DnsResolver> dns_resolver_;
+
+  // Runs the parts of the asynchronous client calls which may block, e.g.
+  // KuduScanner::OpenAsync(), off the reactor threads.
+  gscoped_ptr<ThreadPool> async_pool_;
   scoped_refptr<internal::MetaCache> meta_cache_;
 
   // Authorization tokens stored for each table, indexed by table ID. Note that
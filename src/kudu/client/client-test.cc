@@ -98,10 +98,12 @@
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/async_util.h"
 #include "kudu/util/barrier.h"
+#include "kudu/util/bitmap.h"
 #include "kudu/util/countdown_latch.h"
 #include "kudu/util/locks.h"  // IWYU pragma: keep
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/semaphore.h"
@@ -148,7 +150,9 @@ METRIC_DECLARE_histogram(handler_latency_kudu_master_MasterService_GetMasterRegi
 METRIC_DECLARE_histogram(handler_latency_kudu_master_MasterService_GetTabletLocations);
 METRIC_DECLARE_histogram(handler_latency_kudu_master_MasterService_GetTableLocations);
 METRIC_DECLARE_histogram(handler_latency_kudu_master_MasterService_GetTableSchema);
+METRIC_DECLARE_histogram(handler_latency_kudu_tserver_TabletServerService_MultiWrite);
 METRIC_DECLARE_histogram(handler_latency_kudu_tserver_TabletServerService_Scan);
+METRIC_DECLARE_histogram(handler_latency_kudu_tserver_TabletServerService_Write);
 
 using base::subtle::Atomic32;
 using base::subtle::NoBarrier_AtomicIncrement;
@@ -433,7 +437,25 @@ class ClientTest : public KuduTest {
       ASSERT_TRUE(ContainsKey(metrics, "cfile_cache_miss_bytes"));
       ASSERT_TRUE(ContainsKey(metrics, "cfile_cache_hit_bytes"));
       ASSERT_GT(metrics["cfile_cache_miss_bytes"] + metrics["cfile_cache_hit_bytes"], 0);
+      ASSERT_EQ(FLAGS_test_scan_num_rows, metrics["rows_scanned"]);
+      ASSERT_EQ(FLAGS_test_scan_num_rows, metrics["rows_returned"]);
+      ASSERT_FALSE(ContainsKey(metrics, "column.key.bytes_read"));
     }
+
+    // The per-column scan profile is only collected when enabled.
+    KuduScanner profiled_scanner(client_table_.get());
+    ASSERT_OK(profiled_scanner.SetProjectedColumnNames({ "key" }));
+    ASSERT_OK(profiled_scanner.SetScanProfileEnabled(true));
+    ASSERT_OK(profiled_scanner.Open());
+    ASSERT_TRUE(profiled_scanner.SetScanProfileEnabled(false).IsIllegalState());
+    KuduScanBatch batch;
+    while (profiled_scanner.HasMoreRows()) {
+      ASSERT_OK(profiled_scanner.NextBatch(&batch));
+    }
+    std::map<std::string, int64_t> metrics = profiled_scanner.GetResourceMetrics().Get();
+    ASSERT_GT(metrics["column.key.cells_read"], 0);
+    ASSERT_GT(metrics["column.key.bytes_read"], 0);
+    ASSERT_GT(metrics["column.key.blocks_read"], 0);
   }
 
   // Compares rows as obtained through a KuduScanBatch::RowPtr and through the
@@ -2038,6 +2060,7 @@ TEST_F(ClientTest, TestGetTabletServerBlacklist) {
   selections.push_back(KuduClient::LEADER_ONLY);
   selections.push_back(KuduClient::CLOSEST_REPLICA);
   selections.push_back(KuduClient::FIRST_REPLICA);
+  selections.push_back(KuduClient::LOWEST_LATENCY);
   for (KuduClient::ReplicaSelection selection : selections) {
     Status s = client_->data_->GetTabletServer(client_.get(), rt, selection,
                                                blacklist, &candidates, &rts);
@@ -2057,6 +2080,86 @@ TEST_F(ClientTest, TestGetTabletServerBlacklist) {
   }
 }
 
+// Checks that the LOWEST_LATENCY replica selection mostly picks the replica
+// with the lowest recorded latency, accounting for the RPCs in flight.
+TEST_F(ClientTest, TestLowestLatencyReplicaSelection) {
+  const int kNumSelections = 200;
+  shared_ptr<KuduTable> table;
+  ASSERT_NO_FATAL_FAILURE(CreateTable("lowest_latency",
+                                      3,
+                                      GenerateSplitRows(),
+                                      {},
+                                      &table));
+  scoped_refptr<internal::RemoteTablet> rt;
+  vector<internal::RemoteTabletServer*> tservers;
+  while (true) {
+    rt = MetaCacheLookup(table.get(), "");
+    ASSERT_TRUE(rt.get() != nullptr);
+    rt->GetRemoteTabletServers(&tservers);
+    if (tservers.size() == 3) {
+      break;
+    }
+    rt->MarkStale();
+    SleepFor(MonoDelta::FromMilliseconds(10));
+  }
+
+  // Record latencies of 10, 20 and 30ms.
+  for (int i = 0; i < tservers.size(); i++) {
+    MonoDelta latency = MonoDelta::FromMilliseconds(10 * (i + 1));
+    tservers[i]->StartRpc();
+    tservers[i]->FinishRpc(&latency);
+  }
+  const auto count_selections = [&](internal::RemoteTabletServer* expected) {
+    int count = 0;
+    set<string> blacklist;
+    vector<internal::RemoteTabletServer*> candidates;
+    for (int i = 0; i < kNumSelections; i++) {
+      internal::RemoteTabletServer* rts;
+      CHECK_OK(client_->data_->GetTabletServer(client_.get(), rt,
+                                               KuduClient::LOWEST_LATENCY,
+                                               blacklist, &candidates, &rts));
+      if (rts == expected) {
+        count++;
+      }
+    }
+    return count;
+  };
+  // Random replicas are picked once in a while.
+  ASSERT_GT(count_selections(tservers[0]), kNumSelections * 3 / 4);
+
+  // With two RPCs in flight, the first server is expected to be slower than
+  // the second one.
+  tservers[0]->StartRpc();
+  tservers[0]->StartRpc();
+  ASSERT_GT(count_selections(tservers[1]), kNumSelections * 3 / 4);
+  tservers[0]->FinishRpc(nullptr);
+  tservers[0]->FinishRpc(nullptr);
+  ASSERT_GT(count_selections(tservers[0]), kNumSelections * 3 / 4);
+}
+
+// Checks that writes to a tablet server which asked for backpressure are
+// delayed rather than sent right away.
+TEST_F(ClientTest, TestWriteBackpressure) {
+  const MonoDelta kDelay = MonoDelta::FromMilliseconds(500);
+  scoped_refptr<internal::RemoteTablet> rt = MetaCacheLookup(client_table_.get(), "");
+  ASSERT_TRUE(rt.get() != nullptr);
+  vector<internal::RemoteTabletServer*> tservers;
+  rt->GetRemoteTabletServers(&tservers);
+  ASSERT_FALSE(tservers.empty());
+  const MonoTime start = MonoTime::Now();
+  for (auto* ts : tservers) {
+    ts->SetWriteBackpressure(kDelay);
+  }
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(), 1));
+  ASSERT_GE(MonoTime::Now() - start, kDelay);
+
+  // Once the delay has passed, writes aren't delayed anymore.
+  SleepFor(kDelay);
+  for (auto* ts : tservers) {
+    ASSERT_LT(ts->write_backpressure_deadline(), MonoTime::Now());
+  }
+}
+
 TEST_F(ClientTest, TestScanWithEncodedRangePredicate) {
   shared_ptr<KuduTable> table;
   ASSERT_NO_FATAL_FAILURE(CreateTable("split-table",
@@ -2248,6 +2351,216 @@ TEST_F(ClientTest, TestScannerKeepAlive) {
   ASSERT_EQ(sum, 499500);
 }
 
+// Test scans which prefetch the next batches while the current one is
+// processed, with limits on the number and on the size of the batches
+// buffered.
+TEST_F(ClientTest, TestScanWithPrefetching) {
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(), 1000));
+  for (int64_t memory_limit_bytes :
+           { int64_t{1}, int64_t{KuduScanner::kPrefetchMemoryLimitBytes} }) {
+    SCOPED_TRACE(memory_limit_bytes);
+    KuduScanner scanner(client_table_.get());
+    ASSERT_OK(scanner.SetBatchSizeBytes(100));
+    ASSERT_OK(scanner.SetPrefetchDepth(3));
+    ASSERT_OK(scanner.SetPrefetchMemoryLimitBytes(memory_limit_bytes));
+    ASSERT_OK(scanner.Open());
+    KuduScanBatch batch;
+    int64_t sum = 0;
+    int64_t num_rows = 0;
+    while (scanner.HasMoreRows()) {
+      ASSERT_OK(scanner.NextBatch(&batch));
+      sum += SumResults(batch);
+      num_rows += batch.NumRows();
+    }
+    ASSERT_EQ(1000, num_rows);
+    ASSERT_EQ(499500, sum);
+  }
+
+  // Closing a scanner with prefetched batches closes it on the server side.
+  const tserver::ScannerManager* manager =
+    cluster_->mini_tablet_server(0)->server()->scanner_manager();
+  {
+    KuduScanner scanner(client_table_.get());
+    ASSERT_OK(scanner.SetBatchSizeBytes(100));
+    ASSERT_OK(scanner.SetPrefetchDepth(3));
+    ASSERT_OK(scanner.Open());
+    KuduScanBatch batch;
+    while (scanner.HasMoreRows()) {
+      ASSERT_OK(scanner.NextBatch(&batch));
+      if (batch.NumRows() > 0) break;
+    }
+    ASSERT_TRUE(scanner.HasMoreRows());
+    scanner.Close();
+    AssertScannersDisappear(manager);
+  }
+
+  KuduScanner scanner(client_table_.get());
+  Status s = scanner.SetPrefetchDepth(-1);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  s = scanner.SetPrefetchMemoryLimitBytes(0);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
+// Scans with the asynchronous API, with and without prefetching.
+TEST_F(ClientTest, TestAsyncScan) {
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(), 1000));
+  for (int prefetch_depth : { 0, 3 }) {
+    SCOPED_TRACE(prefetch_depth);
+    KuduScanner scanner(client_table_.get());
+    ASSERT_OK(scanner.SetBatchSizeBytes(100));
+    ASSERT_OK(scanner.SetPrefetchDepth(prefetch_depth));
+    Synchronizer s;
+    KuduStatusMemberCallback<Synchronizer> cb(&s, &Synchronizer::StatusCB);
+    scanner.OpenAsync(&cb);
+    ASSERT_OK(s.Wait());
+
+    KuduScanBatch batch;
+    int64_t sum = 0;
+    int64_t num_rows = 0;
+    while (scanner.HasMoreRows()) {
+      s.Reset();
+      scanner.NextBatchAsync(&batch, &cb);
+      ASSERT_OK(s.Wait());
+      sum += SumResults(batch);
+      num_rows += batch.NumRows();
+    }
+    ASSERT_EQ(1000, num_rows);
+    ASSERT_EQ(499500, sum);
+  }
+}
+
+// Scans with the columnar layout and reads the columns of the batches
+// directly from their sidecars.
+TEST_F(ClientTest, TestColumnarScan) {
+  const int kNumRows = 1000;
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(), kNumRows));
+  KuduScanner scanner(client_table_.get());
+  ASSERT_OK(scanner.SetProjectedColumnNames({ "key", "string_val" }));
+  ASSERT_OK(scanner.SetBatchSizeBytes(1024));
+  ASSERT_OK(scanner.SetRowFormatFlags(KuduScanner::COLUMNAR_LAYOUT));
+  ASSERT_OK(scanner.SetReadMode(KuduScanner::READ_AT_SNAPSHOT));
+  ASSERT_OK(scanner.Open());
+
+  vector<KuduRowResult> rows;
+  ASSERT_TRUE(scanner.NextBatch(&rows).IsIllegalState());
+
+  int64_t sum = 0;
+  int num_rows = 0;
+  KuduScanBatch batch;
+  while (scanner.HasMoreRows()) {
+    ASSERT_OK(scanner.NextBatch(&batch));
+    const int n = batch.NumRows();
+    if (n == 0) continue;
+    Slice keys;
+    ASSERT_OK(batch.GetFixedLengthColumn(0, &keys));
+    ASSERT_EQ(n * sizeof(int32_t), keys.size());
+    Slice offsets;
+    Slice strings;
+    ASSERT_OK(batch.GetVariableLengthColumn(1, &offsets, &strings));
+    ASSERT_EQ((n + 1) * sizeof(uint32_t), offsets.size());
+    Slice non_null_bitmap;
+    ASSERT_OK(batch.GetNonNullBitmapForColumn(1, &non_null_bitmap));
+    ASSERT_OK(batch.GetNonNullBitmapForColumn(0, &non_null_bitmap));
+    ASSERT_TRUE(non_null_bitmap.empty());
+    for (int i = 0; i < n; i++) {
+      int32_t key = UNALIGNED_LOAD32(keys.data() + i * sizeof(int32_t));
+      uint32_t start = UNALIGNED_LOAD32(offsets.data() + i * sizeof(uint32_t));
+      uint32_t end = UNALIGNED_LOAD32(offsets.data() + (i + 1) * sizeof(uint32_t));
+      ASSERT_EQ(StringPrintf("hello %d", key),
+                Slice(strings.data() + start, end - start).ToString());
+      sum += key;
+    }
+    num_rows += n;
+
+    // The accessors check the types of the columns.
+    Status s = batch.GetFixedLengthColumn(1, &keys);
+    ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+    s = batch.GetVariableLengthColumn(0, &offsets, &strings);
+    ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+    s = batch.GetFixedLengthColumn(2, &keys);
+    ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  }
+  ASSERT_EQ(kNumRows, num_rows);
+  ASSERT_EQ(kNumRows * (kNumRows - 1) / 2, sum);
+
+  // Batches in the row-wise layout don't give access to columns.
+  KuduScanner rowwise_scanner(client_table_.get());
+  ASSERT_OK(rowwise_scanner.Open());
+  ASSERT_OK(rowwise_scanner.NextBatch(&batch));
+  Slice data;
+  Status s = batch.GetFixedLengthColumn(0, &data);
+  ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+}
+
+// Inserts rows given in columnar form, with NULLs and an unset column taking
+// its default value.
+TEST_F(ClientTest, TestColumnarInserts) {
+  const int kNumRows = 100;
+  vector<int32_t> keys;
+  vector<int32_t> int_vals;
+  vector<uint32_t> offsets = { 0 };
+  string strings;
+  vector<uint8_t> non_null_bitmap(BitmapSize(kNumRows));
+  for (int i = 0; i < kNumRows; i++) {
+    keys.push_back(i);
+    int_vals.push_back(i * 2);
+    if (i % 3 != 0) {
+      BitmapSet(non_null_bitmap.data(), i);
+      strings += StringPrintf("hello %d", i);
+    }
+    offsets.push_back(strings.size());
+  }
+
+  KuduColumnarInserts inserts(client_table_, kNumRows);
+  ASSERT_EQ(kNumRows, inserts.num_rows());
+  ASSERT_OK(inserts.SetFixedLengthColumn(
+      0, Slice(reinterpret_cast<const uint8_t*>(keys.data()), kNumRows * sizeof(int32_t))));
+  ASSERT_OK(inserts.SetFixedLengthColumn(
+      1, Slice(reinterpret_cast<const uint8_t*>(int_vals.data()), kNumRows * sizeof(int32_t))));
+  const Slice offsets_slice(reinterpret_cast<const uint8_t*>(offsets.data()),
+                            offsets.size() * sizeof(uint32_t));
+  const Slice bitmap_slice(non_null_bitmap.data(), non_null_bitmap.size());
+  ASSERT_OK(inserts.SetVariableLengthColumn(2, offsets_slice, strings, bitmap_slice));
+
+  // The columns are checked against the schema.
+  Status s = inserts.SetFixedLengthColumn(2, Slice());
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  s = inserts.SetVariableLengthColumn(0, offsets_slice, strings);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  s = inserts.SetFixedLengthColumn(1, Slice("abc"));
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  s = inserts.SetFixedLengthColumn(
+      1, Slice(reinterpret_cast<const uint8_t*>(int_vals.data()), kNumRows * sizeof(int32_t)),
+      bitmap_slice);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  s = inserts.SetVariableLengthColumn(2, offsets_slice, Slice(strings.data(), 1));
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  s = inserts.SetFixedLengthColumn(4, Slice());
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+
+  shared_ptr<KuduSession> session = client_->NewSession();
+  ASSERT_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+  int num_applied;
+  ASSERT_OK(session->ApplyColumnarInserts(inserts, &num_applied));
+  ASSERT_EQ(kNumRows, num_applied);
+  FlushSessionOrDie(session);
+
+  vector<string> rows;
+  ScanTableToStrings(client_table_.get(), &rows);
+  ASSERT_EQ(kNumRows, rows.size());
+  EXPECT_EQ("(int32 key=0, int32 int_val=0, string string_val=NULL, "
+            "int32 non_null_with_default=12345)", rows[0]);
+  EXPECT_EQ("(int32 key=1, int32 int_val=2, string string_val=\"hello 1\", "
+            "int32 non_null_with_default=12345)", rows[1]);
+  EXPECT_EQ("(int32 key=98, int32 int_val=196, string string_val=\"hello 98\", "
+            "int32 non_null_with_default=12345)", rows[98]);
+
+  // Inserting the rows again fails on the server, for each row.
+  ASSERT_OK(session->ApplyColumnarInserts(inserts, nullptr));
+  ASSERT_TRUE(session->Flush().IsIOError());
+  ASSERT_EQ(kNumRows, session->CountPendingErrors());
+}
+
 // Test cleanup of scanners on the server side when closed.
 TEST_F(ClientTest, TestCloseScanner) {
   ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(), 10));
@@ -2451,6 +2764,91 @@ static Status ApplyDeleteToSession(KuduSession* session,
   return session->Apply(del.release());
 }
 
+// Writes to the two tablets of the test table, which are hosted by the same
+// tablet server, in a single RPC.
+TEST_F(ClientTest, TestMultiTabletWrites) {
+  const auto& metric_entity = cluster_->mini_tablet_server(0)->server()->metric_entity();
+  const auto& write_rpcs =
+      METRIC_handler_latency_kudu_tserver_TabletServerService_Write.Instantiate(metric_entity);
+  const auto& multi_write_rpcs =
+      METRIC_handler_latency_kudu_tserver_TabletServerService_MultiWrite.Instantiate(
+          metric_entity);
+
+  shared_ptr<KuduSession> session = client_->NewSession();
+  ASSERT_OK(session->SetMultiTabletWrites(true));
+  ASSERT_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+  // Look up the tablets' leaders first, so that the flush writes to both
+  // tablets at once.
+  ASSERT_OK(ApplyInsertToSession(session.get(), client_table_, 0, 0, "zero"));
+  ASSERT_OK(ApplyInsertToSession(session.get(), client_table_, 10, 10, "ten"));
+  ASSERT_OK(session->Flush());
+  ASSERT_OK(ApplyInsertToSession(session.get(), client_table_, 1, 1, "original"));
+  ASSERT_TRUE(session->SetMultiTabletWrites(false).IsIllegalState());
+  ASSERT_OK(session->Flush());
+
+  const int64_t num_write_rpcs = write_rpcs->TotalCount();
+  const int64_t num_multi_write_rpcs = multi_write_rpcs->TotalCount();
+  for (int i = 2; i < 20; i++) {
+    ASSERT_OK(ApplyInsertToSession(session.get(), client_table_, i, i, "hello"));
+  }
+  // A row error is reported for the op which failed.
+  ASSERT_OK(ApplyInsertToSession(session.get(), client_table_, 1, 1, "duplicate"));
+  Status s = session->Flush();
+  ASSERT_TRUE(s.IsIOError()) << s.ToString();
+  ASSERT_EQ(num_write_rpcs, write_rpcs->TotalCount());
+  ASSERT_EQ(num_multi_write_rpcs + 1, multi_write_rpcs->TotalCount());
+
+  vector<KuduError*> errors;
+  ElementDeleter d(&errors);
+  bool overflow;
+  session->GetPendingErrors(&errors, &overflow);
+  ASSERT_FALSE(overflow);
+  ASSERT_EQ(1, errors.size());
+  ASSERT_TRUE(errors[0]->status().IsAlreadyPresent()) << errors[0]->status().ToString();
+  ASSERT_EQ(20, CountRowsFromClient(client_table_.get()));
+}
+
+// Test that the UPSERT and UPDATE operations on the same row are merged
+// before being sent, and that other operations on the row aren't.
+TEST_F(ClientTest, TestWriteCoalescing) {
+  shared_ptr<KuduSession> session = client_->NewSession();
+  ASSERT_OK(session->SetWriteCoalescing(true));
+  ASSERT_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+
+  ASSERT_OK(ApplyUpsertToSession(session.get(), client_table_, 1, 1, "first"));
+  ASSERT_OK(ApplyUpdateToSession(session.get(), client_table_, 1, 2));
+  ASSERT_OK(ApplyUpsertToSession(session.get(), client_table_, 1, 3, "second"));
+  ASSERT_OK(ApplyUpdateToSession(session.get(), client_table_, 1, 4));
+  ASSERT_OK(ApplyUpsertToSession(session.get(), client_table_, 2, 1, "other"));
+  ASSERT_EQ(2, session->CountBufferedOperations());
+  ASSERT_TRUE(session->SetWriteCoalescing(false).IsIllegalState());
+  FlushSessionOrDie(session);
+
+  vector<string> rows;
+  ScanTableToStrings(client_table_.get(), &rows);
+  ASSERT_EQ(2, rows.size());
+  ASSERT_EQ(R"((int32 key=1, int32 int_val=4, string string_val="second", )"
+            "int32 non_null_with_default=12345)", rows[0]);
+
+  // The UPDATE following the DELETE isn't merged into the UPSERT before it,
+  // and fails since the row was deleted.
+  ASSERT_OK(ApplyUpsertToSession(session.get(), client_table_, 1, 5, "third"));
+  ASSERT_OK(ApplyDeleteToSession(session.get(), client_table_, 1));
+  ASSERT_OK(ApplyUpdateToSession(session.get(), client_table_, 1, 6));
+  ASSERT_OK(ApplyUpdateToSession(session.get(), client_table_, 1, 7));
+  ASSERT_EQ(3, session->CountBufferedOperations());
+  Status s = session->Flush();
+  ASSERT_TRUE(s.IsIOError()) << s.ToString();
+  vector<KuduError*> errors;
+  ElementDeleter d(&errors);
+  bool overflow;
+  session->GetPendingErrors(&errors, &overflow);
+  ASSERT_FALSE(overflow);
+  ASSERT_EQ(1, errors.size());
+  ASSERT_TRUE(errors[0]->status().IsNotFound()) << errors[0]->status().ToString();
+  ASSERT_EQ(1, CountRowsFromClient(client_table_.get()));
+}
+
 TEST_F(ClientTest, TestWriteTimeout) {
   shared_ptr<KuduSession> session = client_->NewSession();
   ASSERT_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
@@ -3447,6 +3845,61 @@ TEST_F(ClientTest, TestAutoFlushBackgroundApplyBlocks) {
   EXPECT_LT(wait_timeout_ms / 2, sw.elapsed().wall_millis());
 }
 
+// Test the adaptation of the flush watermark to the latency of flushes and
+// to busy tablet servers, then that writes go through with it.
+TEST_F(ClientTest, TestAdaptiveFlushWatermark) {
+  const size_t kBufferSizeBytes = 64 * 1024;
+  const int64_t kStaticWatermark = kBufferSizeBytes / 2;
+  const MonoDelta kFast = MonoDelta::FromMilliseconds(1);
+  const MonoDelta kSlow = MonoDelta::FromMilliseconds(1000);
+
+  shared_ptr<KuduSession> session(client_->NewSession());
+  ASSERT_OK(session->SetMutationBufferSpace(kBufferSizeBytes));
+  ASSERT_OK(session->SetMutationBufferFlushWatermark(0.5));
+  ASSERT_OK(session->SetMutationBufferFlushTargetLatency(100));
+  KuduSession::Data* data = session->data_;
+  {
+    std::lock_guard<Mutex> l(data->mutex_);
+    ASSERT_EQ(kStaticWatermark, data->FlushWatermarkUnlocked());
+
+    // Slow flushes and busy servers halve the watermark, down to a 64th of
+    // the static watermark.
+    data->AdaptWatermarkUnlocked(kSlow, false);
+    ASSERT_EQ(kStaticWatermark / 2, data->FlushWatermarkUnlocked());
+    data->AdaptWatermarkUnlocked(kFast, true);
+    ASSERT_EQ(kStaticWatermark / 4, data->FlushWatermarkUnlocked());
+    for (int i = 0; i < 10; i++) {
+      data->AdaptWatermarkUnlocked(kSlow, false);
+    }
+    ASSERT_EQ(kStaticWatermark / 64, data->FlushWatermarkUnlocked());
+
+    // Fast flushes make it grow back to the static watermark.
+    data->AdaptWatermarkUnlocked(kFast, false);
+    ASSERT_EQ(kStaticWatermark / 64 + kStaticWatermark / 16, data->FlushWatermarkUnlocked());
+    for (int i = 0; i < 20; i++) {
+      data->AdaptWatermarkUnlocked(kFast, false);
+    }
+    ASSERT_EQ(kStaticWatermark, data->FlushWatermarkUnlocked());
+  }
+
+  ASSERT_OK(session->SetFlushMode(KuduSession::AUTO_FLUSH_BACKGROUND));
+  const int kNumRows = 1000;
+  for (int i = 0; i < kNumRows; i++) {
+    ASSERT_OK(ApplyInsertToSession(session.get(), client_table_, i, i, "x"));
+  }
+  ASSERT_OK(session->Flush());
+  ASSERT_EQ(0, session->CountPendingErrors());
+  ASSERT_EQ(kNumRows, CountRowsFromClient(client_table_.get()));
+
+  // The target latency can't be changed with buffered writes, and can be
+  // unset.
+  ASSERT_OK(ApplyInsertToSession(session.get(), client_table_, kNumRows, 0, "x"));
+  Status s = session->SetMutationBufferFlushTargetLatency(0);
+  ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+  ASSERT_OK(session->Flush());
+  ASSERT_OK(session->SetMutationBufferFlushTargetLatency(0));
+}
+
 // Test that update updates and delete deletes with expected use
 TEST_F(ClientTest, TestMutationsWork) {
   shared_ptr<KuduSession> session = client_->NewSession();
@@ -4690,7 +5143,7 @@ TEST_F(ClientTest, TestInsertEmptyPK) {
     ASSERT_OK(session->Flush());
   }
   ASSERT_EQ("(string k1=\"\", string v1=\"updated\")", ReadRowAsString());
-  ASSERT_OK(tablet_replica->tablet()->FlushAllDMSForTests());
+  ASSERT_OK(tablet_replica->tablet()->FlushAllDMS());
   ASSERT_EQ("(string k1=\"\", string v1=\"updated\")", ReadRowAsString());
   ASSERT_OK(tablet_replica->tablet()->Compact(tablet::Tablet::FORCE_COMPACT_ALL));
   ASSERT_EQ("(string k1=\"\", string v1=\"updated\")", ReadRowAsString());
@@ -4703,7 +5156,7 @@ TEST_F(ClientTest, TestInsertEmptyPK) {
     ASSERT_OK(session->Flush());
   }
   ASSERT_EQ("<none>", ReadRowAsString());
-  ASSERT_OK(tablet_replica->tablet()->FlushAllDMSForTests());
+  ASSERT_OK(tablet_replica->tablet()->FlushAllDMS());
   ASSERT_EQ("<none>", ReadRowAsString());
   ASSERT_OK(tablet_replica->tablet()->Compact(tablet::Tablet::FORCE_COMPACT_ALL));
   ASSERT_EQ("<none>", ReadRowAsString());
@@ -38,6 +38,7 @@
 #include "kudu/client/error_collector.h"
 #include "kudu/client/master_proxy_rpc.h"
 #include "kudu/client/meta_cache.h"
+#include "kudu/client/parallel_scanner-internal.h"
 #include "kudu/client/partitioner-internal.h"
 #include "kudu/client/replica-internal.h"
 #include "kudu/client/row_result.h"
@@ -98,6 +99,7 @@
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/oid_generator.h"
 #include "kudu/util/scoped_cleanup.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/version_info.h"
 
 using kudu::master::AlterTableRequestPB;
@@ -370,6 +372,9 @@ Status KuduClientBuilder::Build(shared_ptr<KuduClient>* client) {
 
   c->data_->meta_cache_.reset(new MetaCache(c.get(), data_->replica_visibility_));
   c->data_->dns_resolver_.reset(new DnsResolver);
+  RETURN_NOT_OK(ThreadPoolBuilder("client-async")
+                .set_min_threads(0)
+                .Build(&c->data_->async_pool_));
 
   // Init local host names used for locality decisions.
   RETURN_NOT_OK_PREPEND(c->data_->InitLocalHostNames(),
@@ -1029,6 +1034,14 @@ Status KuduSession::SetExternalConsistencyMode(ExternalConsistencyMode m) {
   return data_->SetExternalConsistencyMode(m);
 }
 
+Status KuduSession::SetMultiTabletWrites(bool enabled) {
+  return data_->SetMultiTabletWrites(enabled);
+}
+
+Status KuduSession::SetWriteCoalescing(bool enabled) {
+  return data_->SetWriteCoalescing(enabled);
+}
+
 Status KuduSession::SetMutationBufferSpace(size_t size) {
   return data_->SetBufferBytesLimit(size);
 }
@@ -1042,6 +1055,10 @@ Status KuduSession::SetMutationBufferFlushInterval(unsigned int millis) {
   return data_->SetBufferFlushInterval(millis);
 }
 
+Status KuduSession::SetMutationBufferFlushTargetLatency(unsigned int millis) {
+  return data_->SetBufferFlushTargetLatency(millis);
+}
+
 Status KuduSession::SetMutationBufferMaxNum(unsigned int max_num) {
   return data_->SetMaxBatchersNum(max_num);
 }
@@ -1073,6 +1090,23 @@ Status KuduSession::Apply(KuduWriteOperation* write_op) {
   return Status::OK();
 }
 
+Status KuduSession::ApplyColumnarInserts(const KuduColumnarInserts& inserts,
+                                         int* num_applied) {
+  int applied = 0;
+  Status s;
+  for (int i = 0; i < inserts.num_rows(); i++) {
+    s = Apply(inserts.NewInsert(i));
+    if (!s.ok()) {
+      break;
+    }
+    applied++;
+  }
+  if (num_applied) {
+    *num_applied = applied;
+  }
+  return s;
+}
+
 int KuduSession::CountBufferedOperations() const {
   return data_->CountBufferedOperations();
 }
@@ -1402,6 +1436,7 @@ Status KuduScanner::SetRowFormatFlags(uint64_t flags) {
   switch (flags) {
     case NO_FLAGS:
     case PAD_UNIXTIME_MICROS_TO_16_BYTES:
+    case COLUMNAR_LAYOUT:
       break;
     default:
       return Status::InvalidArgument(Substitute("Invalid row format flags: $0", flags));
@@ -1420,6 +1455,28 @@ Status KuduScanner::SetLimit(int64_t limit) {
   return data_->mutable_configuration()->SetLimit(limit);
 }
 
+Status KuduScanner::SetPrefetchDepth(int depth) {
+  if (data_->open_) {
+    return Status::IllegalState("Prefetch depth must be set before Open()");
+  }
+  return data_->mutable_configuration()->SetPrefetchDepth(depth);
+}
+
+Status KuduScanner::SetPrefetchMemoryLimitBytes(int64_t limit_bytes) {
+  if (data_->open_) {
+    return Status::IllegalState("Prefetch memory limit must be set before Open()");
+  }
+  return data_->mutable_configuration()->SetPrefetchMemoryLimitBytes(limit_bytes);
+}
+
+Status KuduScanner::SetScanProfileEnabled(bool enabled) {
+  if (data_->open_) {
+    return Status::IllegalState("Scan profile must be enabled before Open()");
+  }
+  data_->mutable_configuration()->SetScanProfileEnabled(enabled);
+  return Status::OK();
+}
+
 const ResourceMetrics& KuduScanner::GetResourceMetrics() const {
   return data_->resource_metrics_;
 }
@@ -1491,6 +1548,14 @@ Status KuduScanner::Open() {
   return Status::OK();
 }
 
+void KuduScanner::OpenAsync(KuduStatusCallback* cb) {
+  Status s = data_->table_->client()->data_->async_pool_->SubmitFunc(
+      [this, cb]() { cb->Run(Open()); });
+  if (PREDICT_FALSE(!s.ok())) {
+    cb->Run(s);
+  }
+}
+
 Status KuduScanner::KeepAlive() {
   return data_->KeepAlive();
 }
@@ -1505,6 +1570,9 @@ void KuduScanner::Close() {
   // If the scan did not match any rows, the tserver will not assign a scanner ID.
   // This is reflected in the Open() response. In this case, there is no server-side state
   // to clean up.
+  // Wait for the prefetch RPC in flight, if any, so that the close request
+  // follows the last request sent.
+  data_->StopPrefetching();
   if (!data_->next_req_.scanner_id().empty()) {
     CHECK(data_->proxy_);
     gscoped_ptr<CloseCallback> closer(new CloseCallback);
@@ -1541,10 +1609,10 @@ Status KuduScanner::NextBatch(vector<KuduRowResult>* rows) {
 }
 
 Status KuduScanner::NextBatch(KuduScanBatch* batch) {
-  // TODO: do some double-buffering here -- when we return this batch
-  // we should already have fired off the RPC for the next batch, but
-  // need to do some swapping of the response objects around to avoid
-  // stomping on the memory the user is looking at.
+  // If prefetching is enabled, the RPC for the next batch is sent before
+  // returning this one. The responses are then swapped in from the
+  // prefetcher, since the returned batch holds on to the memory of its
+  // own response.
   CHECK(data_->open_);
   CHECK(data_->proxy_);
 
@@ -1558,12 +1626,12 @@ Status KuduScanner::NextBatch(KuduScanBatch* batch) {
     // We have data from a previous scan.
     VLOG(2) << "Extracting data from " << data_->DebugString();
     data_->data_in_open_ = false;
+    data_->MaybeStartPrefetching();
     return batch->data_->Reset(&data_->controller_,
                                data_->configuration().projection(),
                                data_->configuration().client_projection(),
                                data_->configuration().row_format_flags(),
-                               unique_ptr<RowwiseRowBlockPB>(
-                                   data_->last_response_.release_data()));
+                               &data_->last_response_);
   }
 
   if (data_->last_response_.has_more_results()) {
@@ -1573,50 +1641,17 @@ Status KuduScanner::NextBatch(KuduScanBatch* batch) {
     MonoTime batch_deadline = MonoTime::Now() + data_->configuration().timeout();
     data_->PrepareRequest(KuduScanner::Data::CONTINUE);
 
-    while (true) {
-      bool allow_time_for_failover = data_->configuration().is_fault_tolerant();
-      ScanRpcStatus result = data_->SendScanRpc(batch_deadline, allow_time_for_failover);
-
-      // Success case.
-      if (result.result == ScanRpcStatus::OK) {
-        if (data_->last_response_.has_last_primary_key()) {
-          data_->last_primary_key_ = data_->last_response_.last_primary_key();
-        }
-        data_->scan_attempts_ = 0;
-        return batch->data_->Reset(&data_->controller_,
-                                   data_->configuration().projection(),
-                                   data_->configuration().client_projection(),
-                                   data_->configuration().row_format_flags(),
-                                   unique_ptr<RowwiseRowBlockPB>(
-                                       data_->last_response_.release_data()));
-      }
-
-      data_->scan_attempts_++;
-
-      // Error handling.
-      set<string> blacklist;
-      bool needs_reopen = false;
-      Status s = data_->HandleError(result, batch_deadline, &blacklist, &needs_reopen);
-      if (!s.ok()) {
-        LOG(WARNING) << "Scan on tablet server " << data_->ts_->ToString() << " with "
-                     << data_->DebugString() << " failed: " << result.status.ToString();
-        return s;
-      }
-
-      if (data_->configuration().is_fault_tolerant()) {
-        LOG(WARNING) << "Attempting to retry " << data_->DebugString()
-                     << " elsewhere.";
-        return data_->ReopenCurrentTablet(batch_deadline, &blacklist);
-      }
-
-      if (blacklist.empty() && !needs_reopen) {
-        // If we didn't blacklist the current server, we can just retry again.
-        continue;
-      }
-      // If we blacklisted the current server, and it's not fault-tolerant, we can't
-      // retry anywhere, so just propagate the error.
-      return result.status;
+    bool has_batch;
+    RETURN_NOT_OK(data_->ContinueScan(batch_deadline, nullptr, &has_batch));
+    if (!has_batch) {
+      // The tablet was reopened: the next invocation will pick up its rows.
+      return Status::OK();
     }
+    return batch->data_->Reset(&data_->controller_,
+                               data_->configuration().projection(),
+                               data_->configuration().client_projection(),
+                               data_->configuration().row_format_flags(),
+                               &data_->last_response_);
   } else if (data_->MoreTablets()) {
     // More data may be available in other tablets.
     // No need to close the current tablet; we scanned all the data so the
@@ -1635,6 +1670,61 @@ Status KuduScanner::NextBatch(KuduScanBatch* batch) {
   }
 }
 
+void KuduScanner::NextBatchAsync(KuduScanBatch* batch, KuduStatusCallback* cb) {
+  CHECK(data_->open_);
+  CHECK(data_->proxy_);
+  ThreadPool* pool = data_->table_->client()->data_->async_pool_.get();
+
+  // Only the continuation of the scan of the current tablet, without a
+  // prefetched response to wait for, is sent from here: the other cases
+  // either don't send any RPC, or may block and are run by 'pool'.
+  const bool prefetching = data_->prefetcher_ && data_->prefetcher_->active();
+  if (data_->short_circuit_ || data_->data_in_open_ ||
+      (!data_->last_response_.has_more_results() && !data_->MoreTablets())) {
+    cb->Run(NextBatch(batch));
+    return;
+  }
+  if (!data_->last_response_.has_more_results() || prefetching) {
+    Status s = pool->SubmitFunc([this, batch, cb]() { cb->Run(NextBatch(batch)); });
+    if (PREDICT_FALSE(!s.ok())) {
+      cb->Run(s);
+    }
+    return;
+  }
+
+  batch->data_->Clear();
+  VLOG(2) << "Continuing " << data_->DebugString() << " asynchronously";
+  MonoTime batch_deadline = MonoTime::Now() + data_->configuration().timeout();
+  data_->PrepareRequest(KuduScanner::Data::CONTINUE);
+  bool allow_time_for_failover = data_->configuration().is_fault_tolerant();
+  data_->SendScanRpcAsync(
+      batch_deadline, allow_time_for_failover,
+      [this, pool, batch_deadline, batch, cb](const ScanRpcStatus& result) {
+        auto finish = [this, batch_deadline, batch, cb, result]() {
+          bool has_batch;
+          Status s = data_->ContinueScan(batch_deadline, &result, &has_batch);
+          if (s.ok() && has_batch) {
+            s = batch->data_->Reset(&data_->controller_,
+                                    data_->configuration().projection(),
+                                    data_->configuration().client_projection(),
+                                    data_->configuration().row_format_flags(),
+                                    &data_->last_response_);
+          }
+          cb->Run(s);
+        };
+        if (result.result == ScanRpcStatus::OK) {
+          // Nothing blocks on success, so finish on the reactor thread.
+          finish();
+          return;
+        }
+        // Handling errors may sleep before retrying, and reopen the tablet.
+        Status s = pool->SubmitFunc(finish);
+        if (PREDICT_FALSE(!s.ok())) {
+          cb->Run(s);
+        }
+      });
+}
+
 Status KuduScanner::GetCurrentServer(KuduTabletServer** server) {
   CHECK(data_->open_);
   internal::RemoteTabletServer* rts = data_->ts_;
@@ -1738,6 +1828,11 @@ Status KuduScanTokenBuilder::SetTimeoutMillis(int millis) {
   return Status::OK();
 }
 
+Status KuduScanTokenBuilder::SetSplitSizeBytes(uint64_t split_size_bytes) {
+  data_->SetSplitSizeBytes(split_size_bytes);
+  return Status::OK();
+}
+
 Status KuduScanTokenBuilder::AddConjunctPredicate(KuduPredicate* pred) {
   return data_->mutable_configuration()->AddConjunctPredicate(pred);
 }
@@ -1826,6 +1921,41 @@ const string& KuduTabletServer::location() const {
   return data_->location_;
 }
 
+////////////////////////////////////////////////////////////
+// KuduParallelScanner
+////////////////////////////////////////////////////////////
+KuduParallelScanner::KuduParallelScanner(const vector<KuduScanToken*>& tokens)
+    : data_(new Data(tokens)) {
+}
+
+KuduParallelScanner::~KuduParallelScanner() {
+  delete data_;
+}
+
+Status KuduParallelScanner::SetMaxConcurrentTablets(int max_tablets) {
+  return data_->SetMaxConcurrentTablets(max_tablets);
+}
+
+Status KuduParallelScanner::SetMaxConcurrentTabletsPerServer(int max_tablets) {
+  return data_->SetMaxConcurrentTabletsPerServer(max_tablets);
+}
+
+Status KuduParallelScanner::Open() {
+  return data_->Open();
+}
+
+void KuduParallelScanner::Close() {
+  data_->Close();
+}
+
+bool KuduParallelScanner::HasMoreRows() const {
+  return data_->HasMoreRows();
+}
+
+Status KuduParallelScanner::NextBatch(KuduScanBatch* batch) {
+  return data_->NextBatch(batch);
+}
+
 ////////////////////////////////////////////////////////////
 // KuduPartitionerBuilder
 ////////////////////////////////////////////////////////////
@@ -1865,5 +1995,10 @@ Status KuduPartitioner::PartitionRow(const KuduPartialRow& row, int* partition)
   return data_->PartitionRow(row, partition);
 }
 
+Status KuduPartitioner::PartitionRows(const vector<const KuduPartialRow*>& rows,
+                                      vector<int>* partitions) {
+  return data_->PartitionRows(rows, partitions);
+}
+
 } // namespace client
 } // namespace kudu
@@ -68,6 +68,7 @@ class LeaderMasterProxy;
 
 namespace client {
 
+class KuduColumnarInserts;
 class KuduDelete;
 class KuduInsert;
 class KuduLoggingCallback;
@@ -478,7 +479,15 @@ class KUDU_EXPORT KuduClient : public sp::enable_shared_from_this<KuduClient> {
                       ///< client, followed by all other replicas. If there are
                       ///< multiple closest replicas, one is chosen randomly.
 
-    FIRST_REPLICA     ///< Select the first replica in the list.
+    FIRST_REPLICA,    ///< Select the first replica in the list.
+
+    LOWEST_LATENCY    ///< Select the replica with the lowest expected latency,
+                      ///< as estimated from the latency of the recent scan
+                      ///< RPCs to its tablet server and from the number of
+                      ///< scan RPCs in flight to it. Replicas whose latency is
+                      ///< unknown are tried first, and a random replica is
+                      ///< occasionally chosen so that the estimates of the
+                      ///< other replicas are refreshed.
   };
 
   /// @return @c true iff client is configured to talk to multiple
@@ -605,6 +614,7 @@ class KUDU_EXPORT KuduClient : public sp::enable_shared_from_this<KuduClient> {
   FRIEND_TEST(ClientTest, TestCacheAuthzTokens);
   FRIEND_TEST(ClientTest, TestGetSecurityInfoFromMaster);
   FRIEND_TEST(ClientTest, TestGetTabletServerBlacklist);
+  FRIEND_TEST(ClientTest, TestLowestLatencyReplicaSelection);
   FRIEND_TEST(ClientTest, TestMasterDown);
   FRIEND_TEST(ClientTest, TestMasterLookupPermits);
   FRIEND_TEST(ClientTest, TestMetaCacheExpiry);
@@ -1503,6 +1513,55 @@ class KUDU_EXPORT KuduSession : public sp::enable_shared_from_this<KuduSession>
   Status SetExternalConsistencyMode(ExternalConsistencyMode m)
     WARN_UNUSED_RESULT;
 
+  /// Set whether to send the writes to the tablets led by the same tablet
+  /// server in a single RPC.
+  ///
+  /// By default, a flush sends one RPC per tablet written to. With this
+  /// option, it sends one RPC per tablet server instead, which reduces the
+  /// number of RPCs when writing to many tablets, e.g. of tables with many
+  /// hash partitions. The writes of tablets whose leader isn't known yet,
+  /// or which fail, are sent in an RPC per tablet as usual.
+  ///
+  /// @warning Unlike writes sent in an RPC per tablet, the writes sent
+  ///   together aren't retried with exactly-once semantics: if the leader of
+  ///   a tablet changes while its write is being replicated, the write may
+  ///   be applied twice. Tablet servers that don't support it make the
+  ///   client fall back to an RPC per tablet.
+  ///
+  /// @param [in] enabled
+  ///   Whether to send the writes in an RPC per tablet server.
+  /// @return Operation result status.
+  Status SetMultiTabletWrites(bool enabled) WARN_UNUSED_RESULT;
+
+  /// Set whether to merge the operations on the same row buffered by this
+  /// session before sending them.
+  ///
+  /// By default, every applied operation is sent to the tablet server, which
+  /// applies them one by one. With this option, an UPSERT or UPDATE applied
+  /// right after an UPSERT on the same row, or an UPDATE applied right after
+  /// an UPDATE on the same row, is merged into that operation instead: the
+  /// columns it sets overwrite those set by the earlier operation, which is
+  /// sent in place of both. The result is the same as applying both
+  /// operations, with fewer operations for the tablet server to apply when
+  /// the same rows are written repeatedly. Only the operations on the same
+  /// table, applied through the same KuduTable object, and buffered before
+  /// the same flush are merged. Other operations on a row, e.g. INSERT or
+  /// DELETE, are never merged, and the operations on the row applied after
+  /// them may only be merged into each other.
+  ///
+  /// @note Since the merged operations are sent as one, a failure is
+  ///   reported once, for the earlier operation with the merged row. The
+  ///   later operations aren't returned by KuduSession::GetPendingErrors().
+  ///
+  /// @note This setting has no effect in AUTO_FLUSH_SYNC mode, which sends
+  ///   every operation on its own.
+  ///
+  /// @param [in] enabled
+  ///   Whether to merge the operations on the same row.
+  /// @return Operation result status. Returns IllegalState if there are
+  ///   buffered writes.
+  Status SetWriteCoalescing(bool enabled) WARN_UNUSED_RESULT;
+
   /// Set the amount of buffer space used by this session for outbound writes.
   ///
   /// The effect of the buffer size varies based on the flush mode of
@@ -1571,6 +1630,30 @@ class KUDU_EXPORT KuduSession : public sp::enable_shared_from_this<KuduSession>
   /// @return Operation result status.
   Status SetMutationBufferFlushInterval(unsigned int millis) WARN_UNUSED_RESULT;
 
+  /// Set a target latency for the flushes of the mutation buffer, and adapt
+  /// the amount of data flushed at once to it.
+  ///
+  /// With a target latency, a session running in AUTO_FLUSH_BACKGROUND mode
+  /// measures how long each flush takes to complete. If a flush takes longer
+  /// than the target latency, or if a tablet server responds that it is too
+  /// busy to handle a write, the session halves the amount of fresh data it
+  /// accumulates before flushing. Otherwise, the amount grows back, up to the
+  /// watermark set by SetMutationBufferFlushWatermark(). The interval
+  /// set by SetMutationBufferFlushInterval() is also capped at the target
+  /// latency. By default, there is no target latency.
+  ///
+  /// @note This setting is applicable only for AUTO_FLUSH_BACKGROUND sessions.
+  ///   I.e., calling this method in other flush modes is safe, but
+  ///   the parameter has no effect until the session is switched into
+  ///   AUTO_FLUSH_BACKGROUND mode.
+  ///
+  /// @param [in] millis
+  ///   The target latency of flushes, in milliseconds, or 0 to flush at
+  ///   the static watermark.
+  /// @return Operation result status. Returns IllegalState if there are
+  ///   buffered writes.
+  Status SetMutationBufferFlushTargetLatency(unsigned int millis) WARN_UNUSED_RESULT;
+
   /// Set the maximum number of mutation buffers per KuduSession object.
   ///
   /// A KuduSession accumulates write operations submitted via the Apply()
@@ -1633,6 +1716,25 @@ class KUDU_EXPORT KuduSession : public sp::enable_shared_from_this<KuduSession>
   /// @return Operation result status.
   Status Apply(KuduWriteOperation* write_op) WARN_UNUSED_RESULT;
 
+  /// Apply the inserts of a batch of rows given in columnar form.
+  ///
+  /// This is equivalent to calling Apply() with an insert for each row of
+  /// the batch, in order, but fills the rows directly from the columns,
+  /// without the type checks of the KuduPartialRow setters nor copies of
+  /// the variable-length data.
+  ///
+  /// @param [in] inserts
+  ///   The rows to insert. The object may be destroyed after this call,
+  ///   but the data of its columns must remain valid until the rows have
+  ///   been flushed.
+  /// @param [out] num_applied
+  ///   If not NULL, the number of rows applied. On error, the rows before
+  ///   the first row Apply() failed on have been applied.
+  /// @return Operation result status: the status of the first failed
+  ///   Apply(), if any.
+  Status ApplyColumnarInserts(const KuduColumnarInserts& inserts,
+                              int* num_applied) WARN_UNUSED_RESULT;
+
   /// Flush any pending writes.
   ///
   /// This method initiates flushing of the current batch of buffered
@@ -1788,6 +1890,7 @@ class KUDU_EXPORT KuduSession : public sp::enable_shared_from_this<KuduSession>
   friend class KuduClient;
   friend class internal::Batcher;
   friend class ClientTest;
+  FRIEND_TEST(ClientTest, TestAdaptiveFlushWatermark);
   FRIEND_TEST(ClientTest, TestAutoFlushBackgroundApplyBlocks);
   FRIEND_TEST(ClientTest, TestAutoFlushBackgroundAndErrorCollector);
 
@@ -1874,6 +1977,10 @@ class KUDU_EXPORT KuduScanner {
   /// KuduClientBuilder::default_rpc_timeout().
   enum { kScanTimeoutMillis = 30000 };
 
+  /// Default limit on the memory used by prefetched batches.
+  /// See SetPrefetchMemoryLimitBytes().
+  enum { kPrefetchMemoryLimitBytes = 64 * 1024 * 1024 };
+
   /// Constructor for KuduScanner.
   ///
   /// @param [in] table
@@ -1996,6 +2103,19 @@ class KUDU_EXPORT KuduScanner {
   /// @return Result status of the operation (begin scanning).
   Status Open();
 
+  /// Begin scanning asynchronously.
+  ///
+  /// Like Open(), but returns immediately and calls @c cb with the result
+  /// once the scanner is open. The callback may be called either from a
+  /// client thread or the same thread which calls OpenAsync(), and it
+  /// should not block. No other method of the scanner may be called until
+  /// the callback is invoked.
+  ///
+  /// @param [in] cb
+  ///   Callback to call upon completion. The @c cb and the scanner must
+  ///   remain valid until it is invoked.
+  void OpenAsync(KuduStatusCallback* cb);
+
   /// Keep the current remote scanner alive.
   ///
   /// Keep the current remote scanner alive on the Tablet server for an
@@ -2060,6 +2180,26 @@ class KUDU_EXPORT KuduScanner {
   /// @return Operation result status.
   Status NextBatch(KuduScanBatch* batch);
 
+  /// Fetch the next batch of results for this scanner asynchronously.
+  ///
+  /// Like NextBatch(KuduScanBatch*), but returns immediately and calls
+  /// @c cb with the result once @c batch holds the next batch of rows.
+  /// When the batch is served by the current tablet server, the callback
+  /// is called from an IO thread, without tying up any other thread while
+  /// the RPC is in flight. Otherwise, e.g. when switching to the next
+  /// tablet or retrying an RPC, it may be called from a client thread or
+  /// the same thread which calls NextBatchAsync(). The callback should not
+  /// block, and no other method of the scanner may be called until it is
+  /// invoked.
+  ///
+  /// @param [out] batch
+  ///   Placeholder for the result. It must remain valid until @c cb is
+  ///   invoked.
+  /// @param [in] cb
+  ///   Callback to call upon completion. The @c cb and the scanner must
+  ///   remain valid until it is invoked.
+  void NextBatchAsync(KuduScanBatch* batch, KuduStatusCallback* cb);
+
   /// Get the KuduTabletServer that is currently handling the scan.
   ///
   /// More concretely, this is the server that handled the most recent
@@ -2071,6 +2211,8 @@ class KUDU_EXPORT KuduScanner {
   Status GetCurrentServer(KuduTabletServer** server);
 
   /// @return Cumulative resource metrics since the scan was started.
+  ///   These include the per-column metrics of the scan profile, named
+  ///   @c column.<name>.<metric>, if enabled with SetScanProfileEnabled().
   const ResourceMetrics& GetResourceMetrics() const;
 
   /// Set the hint for the size of the next batch in bytes.
@@ -2164,6 +2306,14 @@ class KUDU_EXPORT KuduScanner {
   ///   data for further decoding. Using KuduScanBatch::Row() might yield incorrect/corrupt
   ///   results and might even cause the client to crash.
   static const uint64_t PAD_UNIXTIME_MICROS_TO_16_BYTES = 1 << 0;
+  /// Makes the server return the data of each projected column in its own
+  /// RPC sidecars, rather than row by row.
+  /// @note The rows of the batches must then be accessed through
+  ///   KuduScanBatch::GetFixedLengthColumn(),
+  ///   KuduScanBatch::GetVariableLengthColumn() and
+  ///   KuduScanBatch::GetNonNullBitmapForColumn(). This flag can't be
+  ///   combined with PAD_UNIXTIME_MICROS_TO_16_BYTES.
+  static const uint64_t COLUMNAR_LAYOUT = 1 << 1;
 
   /// Optionally set row format modifier flags.
   ///
@@ -2202,6 +2352,43 @@ class KUDU_EXPORT KuduScanner {
   /// @return Operation result status.
   Status SetLimit(int64_t limit) WARN_UNUSED_RESULT;
 
+  /// Set the number of batches to fetch ahead of NextBatch().
+  ///
+  /// By default, a batch is only requested from the tablet server when
+  /// NextBatch() is called, so that the processing of the batches by the
+  /// application and the scanning of the next batch by the server don't
+  /// overlap. With a positive depth, the next batches of the current tablet
+  /// are requested as soon as a batch is returned, one at a time, and up to
+  /// @c depth of them are buffered by the scanner.
+  ///
+  /// @note The data of the buffered batches is kept in memory, up to the
+  ///   limit set by SetPrefetchMemoryLimitBytes().
+  ///
+  /// @param [in] depth
+  ///   The maximum number of batches to buffer, or 0 to disable prefetching.
+  /// @return Operation result status.
+  Status SetPrefetchDepth(int depth) WARN_UNUSED_RESULT;
+
+  /// Set the limit on the memory used by the batches fetched ahead of
+  /// NextBatch(). Once the buffered batches reach that size, no more
+  /// batches are prefetched until one is returned by NextBatch().
+  /// The default is @c kPrefetchMemoryLimitBytes.
+  ///
+  /// @param [in] limit_bytes
+  ///   The limit to set, in bytes. Must be greater than 0.
+  /// @return Operation result status.
+  Status SetPrefetchMemoryLimitBytes(int64_t limit_bytes) WARN_UNUSED_RESULT;
+
+  /// Set whether the tablet servers return the per-column profile of the
+  /// work done for the scan, i.e. the number of cells read from each column,
+  /// and the number of bytes and of blocks they were decoded from. The
+  /// profile is added to the metrics returned by GetResourceMetrics().
+  ///
+  /// @param [in] enabled
+  ///   If @c true, the scan profile is collected. Default is @c false.
+  /// @return Operation result status.
+  Status SetScanProfileEnabled(bool enabled) WARN_UNUSED_RESULT;
+
   /// @return String representation of this scan.
   ///
   /// @internal
@@ -2388,6 +2575,20 @@ class KUDU_EXPORT KuduScanTokenBuilder {
   /// @copydoc KuduScanner::SetTimeoutMillis
   Status SetTimeoutMillis(int millis) WARN_UNUSED_RESULT;
 
+  /// Split the tablets into several tokens each scanning about the given
+  /// amount of data, so that the tokens of tablets of uneven sizes can be
+  /// scanned in parallel with balanced load.
+  ///
+  /// The tablet servers estimate the size of the projected columns of the
+  /// primary key ranges within their tablets, so building the tokens
+  /// requires a round trip to a replica of each tablet.
+  ///
+  /// @param [in] split_size_bytes
+  ///   The target size of the data scanned by each token, in bytes.
+  ///   The tablets aren't split if it's 0, which is the default.
+  /// @return Operation result status.
+  Status SetSplitSizeBytes(uint64_t split_size_bytes) WARN_UNUSED_RESULT;
+
   /// Build the set of scan tokens.
   ///
   /// The builder may be reused after this call.
@@ -2407,6 +2608,84 @@ class KUDU_EXPORT KuduScanTokenBuilder {
   DISALLOW_COPY_AND_ASSIGN(KuduScanTokenBuilder);
 };
 
+/// @brief Scans the tablets of a set of scan tokens concurrently.
+///
+/// The rows of the tablets are returned as a single stream of batches, as if
+/// the tablets were scanned by a single KuduScanner, except that the batches
+/// of the different tablets are interleaved in no particular order.
+///
+/// The tablets are scanned by a pool of threads owned by the scanner, each
+/// running a KuduScanner built from a token. The number of tablets scanned
+/// at a time is capped both overall and per tablet server, so that a large
+/// scan doesn't overload the servers hosting many of its tablets.
+///
+/// @note This class is not thread-safe.
+class KUDU_EXPORT KuduParallelScanner {
+ public:
+  /// Construct an instance of the class.
+  ///
+  /// @param [in] tokens
+  ///   The tokens of the tablets to scan, e.g. as built by
+  ///   KuduScanTokenBuilder::Build(). The KuduParallelScanner does not take
+  ///   ownership of the tokens, which must remain valid for its lifetime.
+  explicit KuduParallelScanner(const std::vector<KuduScanToken*>& tokens);
+
+  /// Close the scanner, if it's open.
+  ~KuduParallelScanner();
+
+  /// Set the maximum number of tablets to scan concurrently.
+  ///
+  /// @param [in] max_tablets
+  ///   The limit to set. Must be greater than 0. The default is 8.
+  /// @return Operation result status.
+  Status SetMaxConcurrentTablets(int max_tablets) WARN_UNUSED_RESULT;
+
+  /// Set the maximum number of tablets to scan concurrently on a single
+  /// tablet server. A tablet is accounted to the server hosting its leader
+  /// replica, or its first replica if the leader is unknown.
+  ///
+  /// @param [in] max_tablets
+  ///   The limit to set. Must be greater than 0. The default is 2.
+  /// @return Operation result status.
+  Status SetMaxConcurrentTabletsPerServer(int max_tablets) WARN_UNUSED_RESULT;
+
+  /// Start scanning the tablets.
+  ///
+  /// @return Operation result status.
+  Status Open() WARN_UNUSED_RESULT;
+
+  /// Close the scanner.
+  ///
+  /// This stops the scans of the tablets which are in progress, and releases
+  /// the batches which weren't returned yet.
+  void Close();
+
+  /// Check if there may be rows to be fetched from this scanner.
+  ///
+  /// @return @c true if there may be rows to be fetched from this scanner.
+  ///   The method returns @c true provided there's at least one tablet left
+  ///   to scan or batch left to return, even if none of their rows match.
+  bool HasMoreRows() const;
+
+  /// Fetch the next batch of results, waiting for one of the tablets to
+  /// return a batch if none is available.
+  ///
+  /// @param [out] batch
+  ///   Placeholder for the result. The batch may be empty if the last
+  ///   tablets had no more rows.
+  /// @return Operation result status: the error of the first tablet scan
+  ///   which failed, if any.
+  Status NextBatch(KuduScanBatch* batch) WARN_UNUSED_RESULT;
+
+ private:
+  class KUDU_NO_EXPORT Data;
+
+  // Owned.
+  Data* data_;
+
+  DISALLOW_COPY_AND_ASSIGN(KuduParallelScanner);
+};
+
 /// @brief Builder for Partitioner instances.
 class KUDU_EXPORT KuduPartitionerBuilder {
  public:
@@ -2483,6 +2762,25 @@ class KUDU_EXPORT KuduPartitioner {
   ///   provided row does not have all columns of the partition key
   ///   set.
   Status PartitionRow(const KuduPartialRow& row, int* partition);
+
+  /// Determine the partition indices of a batch of rows.
+  ///
+  /// This gives the same results as calling @c PartitionRow on each row,
+  /// but encodes the partition keys of the whole batch at once, which is
+  /// cheaper for bulk loads that group their rows by partition before
+  /// writing them.
+  ///
+  /// @param [in] rows
+  ///   The rows to be partitioned.
+  /// @param [out] partitions
+  ///   The resulting partition indices, in the order of @c rows, with -1
+  ///   for the rows which fall into a non-covered range.
+  ///
+  /// @return Status::OK if successful. May return a bad Status if one of
+  ///   the provided rows does not have all columns of the partition key
+  ///   set, in which case @c partitions is unspecified.
+  Status PartitionRows(const std::vector<const KuduPartialRow*>& rows,
+                       std::vector<int>* partitions);
  private:
   class KUDU_NO_EXPORT Data;
 
@@ -17,6 +17,7 @@
 
 #include "kudu/client/meta_cache.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <mutex>
 #include <ostream>
@@ -81,8 +82,19 @@ namespace client {
 
 namespace internal {
 
+namespace {
+
+// The weight of the latest RPC in the moving average of the latency of the
+// RPCs to a tablet server, as a fraction of kLatencyEwmaScale.
+const int64_t kLatencyEwmaWeight = 2;
+const int64_t kLatencyEwmaScale = 10;
+
+} // anonymous namespace
+
 RemoteTabletServer::RemoteTabletServer(const master::TSInfoPB& pb)
-  : uuid_(pb.permanent_uuid()) {
+  : uuid_(pb.permanent_uuid()),
+    latency_ewma_us_(0),
+    rpcs_in_flight_(0) {
   Update(pb);
 }
 
@@ -110,7 +122,20 @@ void RemoteTabletServer::DnsResolutionFinished(const HostPort& hp,
 
   {
     std::lock_guard<simple_spinlock> l(lock_);
-    proxy_.reset(new TabletServerServiceProxy(client->data_->messenger_, (*addrs)[0], hp.host()));
+    Sockaddr addr = (*addrs)[0];
+    if (!unix_domain_socket_path_.empty() &&
+        (addr.IsAnyLocalAddress() || client->data_->IsLocalHostPort(hp))) {
+      Sockaddr uds_addr;
+      Status uds_s = uds_addr.ParseUnixDomainPath(unix_domain_socket_path_);
+      if (uds_s.ok()) {
+        VLOG(1) << "Connecting to local TS " << uuid_ << " at " << uds_addr.ToString();
+        addr = uds_addr;
+      } else {
+        KLOG_EVERY_N_SECS(WARNING, 1) << "Invalid UNIX domain socket path of TS " << uuid_
+                                      << ": " << uds_s.ToString();
+      }
+    }
+    proxy_.reset(new TabletServerServiceProxy(client->data_->messenger_, addr, hp.host()));
     proxy_->set_user_credentials(client->data_->user_credentials_);
   }
   user_callback.Run(s);
@@ -149,6 +174,7 @@ void RemoteTabletServer::Update(const master::TSInfoPB& pb) {
   for (const HostPortPB& hostport_pb : pb.rpc_addresses()) {
     rpc_hostports_.emplace_back(hostport_pb.host(), hostport_pb.port());
   }
+  unix_domain_socket_path_ = pb.unix_domain_socket_path();
   location_ = pb.location();
 }
 
@@ -181,6 +207,44 @@ void RemoteTabletServer::GetHostPorts(vector<HostPort>* host_ports) const {
   *host_ports = rpc_hostports_;
 }
 
+void RemoteTabletServer::StartRpc() {
+  rpcs_in_flight_++;
+}
+
+void RemoteTabletServer::FinishRpc(const MonoDelta* latency) {
+  DCHECK_GT(rpcs_in_flight_, 0);
+  rpcs_in_flight_--;
+  if (!latency) {
+    return;
+  }
+  // Ensure a recorded latency is never 0, which stands for an unknown latency.
+  int64_t latency_us = std::max<int64_t>(latency->ToMicroseconds(), 1);
+  int64_t old_ewma = latency_ewma_us_.load(std::memory_order_relaxed);
+  int64_t new_ewma;
+  do {
+    new_ewma = old_ewma == 0 ? latency_us :
+        std::max<int64_t>(1, (old_ewma * (kLatencyEwmaScale - kLatencyEwmaWeight) +
+                              latency_us * kLatencyEwmaWeight) / kLatencyEwmaScale);
+  } while (!latency_ewma_us_.compare_exchange_weak(old_ewma, new_ewma,
+                                                   std::memory_order_relaxed));
+}
+
+int64_t RemoteTabletServer::ExpectedLatencyMicros() const {
+  return latency_ewma_us_.load(std::memory_order_relaxed) *
+      (1 + rpcs_in_flight_.load(std::memory_order_relaxed));
+}
+
+void RemoteTabletServer::SetWriteBackpressure(const MonoDelta& delay) {
+  const MonoTime deadline = MonoTime::Now() + delay;
+  std::lock_guard<simple_spinlock> l(lock_);
+  write_backpressure_deadline_ = std::max(write_backpressure_deadline_, deadline);
+}
+
+MonoTime RemoteTabletServer::write_backpressure_deadline() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return write_backpressure_deadline_;
+}
+
 ////////////////////////////////////////////////////////////
 
 
@@ -197,6 +261,7 @@ void RemoteTablet::Refresh(const TabletServerMap& tservers,
     rep.failed = false;
     replicas_.push_back(rep);
   }
+  UpdateLeaderUnlocked();
   stale_ = false;
 }
 
@@ -220,6 +285,7 @@ void RemoteTablet::MarkReplicaFailed(RemoteTabletServer *ts,
       rep.failed = true;
     }
   }
+  UpdateLeaderUnlocked();
 }
 
 int RemoteTablet::GetNumFailedReplicas() const {
@@ -234,13 +300,7 @@ int RemoteTablet::GetNumFailedReplicas() const {
 }
 
 RemoteTabletServer* RemoteTablet::LeaderTServer() const {
-  std::lock_guard<simple_spinlock> l(lock_);
-  for (const RemoteReplica& replica : replicas_) {
-    if (!replica.failed && replica.role == RaftPeerPB::LEADER) {
-      return replica.ts;
-    }
-  }
-  return nullptr;
+  return leader_.load(std::memory_order_acquire);
 }
 
 bool RemoteTablet::HasLeader() const {
@@ -278,6 +338,7 @@ void RemoteTablet::MarkTServerAsLeader(const RemoteTabletServer* server) {
       replica.role = RaftPeerPB::FOLLOWER;
     }
   }
+  UpdateLeaderUnlocked();
   VLOG(3) << "Latest replicas: " << ReplicasAsStringUnlocked();
 }
 
@@ -288,6 +349,7 @@ void RemoteTablet::MarkTServerAsFollower(const RemoteTabletServer* server) {
       replica.role = RaftPeerPB::FOLLOWER;
     }
   }
+  UpdateLeaderUnlocked();
   VLOG(3) << "Latest replicas: " << ReplicasAsStringUnlocked();
 }
 
@@ -296,6 +358,18 @@ string RemoteTablet::ReplicasAsString() const {
   return ReplicasAsStringUnlocked();
 }
 
+void RemoteTablet::UpdateLeaderUnlocked() {
+  DCHECK(lock_.is_locked());
+  RemoteTabletServer* leader = nullptr;
+  for (const RemoteReplica& replica : replicas_) {
+    if (!replica.failed && replica.role == RaftPeerPB::LEADER) {
+      leader = replica.ts;
+      break;
+    }
+  }
+  leader_.store(leader, std::memory_order_release);
+}
+
 string RemoteTablet::ReplicasAsStringUnlocked() const {
   DCHECK(lock_.is_locked());
   string replicas_str;
@@ -894,20 +968,48 @@ Status MetaCache::ProcessLookupResponse(const LookupRpc& rpc,
     *cache_entry = FindFloorOrDie(tablets_by_key, cache_entry->upper_bound_partition_key());
     DCHECK(!cache_entry->is_non_covered_range());
   }
+  UpdateSnapshotUnlocked(rpc.table_id());
   return Status::OK();
 }
 
+const MetaCacheEntry* MetaCache::FindFloorEntry(const TabletSnapshot& snapshot,
+                                               const string& partition_key) {
+  const auto& bounds = snapshot.lower_bounds;
+  auto it = std::upper_bound(bounds.begin(), bounds.end(), partition_key);
+  if (it == bounds.begin()) {
+    return nullptr;
+  }
+  return &snapshot.entries[it - bounds.begin() - 1];
+}
+
+void MetaCache::UpdateSnapshotUnlocked(const string& table_id) {
+  DCHECK(lock_.is_write_locked());
+  const TabletMap* tablets = FindOrNull(tablets_by_table_and_key_, table_id);
+  if (!tablets) {
+    snapshots_by_table_.erase(table_id);
+    return;
+  }
+  TabletSnapshot snapshot;
+  snapshot.lower_bounds.reserve(tablets->size());
+  snapshot.entries.reserve(tablets->size());
+  for (const auto& e : *tablets) {
+    snapshot.lower_bounds.push_back(e.first);
+    snapshot.entries.push_back(e.second);
+  }
+  snapshots_by_table_[table_id] = std::move(snapshot);
+}
+
 bool MetaCache::LookupEntryByKeyFastPath(const KuduTable* table,
                                          const string& partition_key,
                                          MetaCacheEntry* entry) {
   shared_lock<rw_spinlock> l(lock_.get_lock());
-  const TabletMap* tablets = FindOrNull(tablets_by_table_and_key_, table->id());
-  if (PREDICT_FALSE(!tablets)) {
+  const TabletSnapshot* snapshot = FindOrNull(snapshots_by_table_, table->id());
+  if (PREDICT_FALSE(!snapshot)) {
     // No cache available for this table.
     return false;
   }
 
-  const MetaCacheEntry* e = FindFloorOrNull(*tablets, partition_key);
+  const MetaCacheEntry* e = FindFloorEntry(*snapshot, partition_key);
   if (PREDICT_FALSE(!e)) {
     // No tablets with a start partition key lower than 'partition_key'.
     return false;
@@ -930,22 +1032,35 @@ Status MetaCache::DoFastPathLookup(const KuduTable* table,
                                    string* partition_key,
                                    MetaCache::LookupType lookup_type,
                                    scoped_refptr<RemoteTablet>* remote_tablet) {
-  MetaCacheEntry entry;
-  while (PREDICT_TRUE(LookupEntryByKeyFastPath(table, *partition_key, &entry))
-         && (entry.is_non_covered_range() || entry.tablet()->HasLeader())) {
-    VLOG(4) << "Fast lookup: found " << entry.DebugString(table) << " for "
+  // Search the snapshot in place rather than through
+  // LookupEntryByKeyFastPath(), which copies the entry.
+  shared_lock<rw_spinlock> l(lock_.get_lock());
+  const TabletSnapshot* snapshot = FindOrNull(snapshots_by_table_, table->id());
+  if (PREDICT_FALSE(!snapshot)) {
+    // No cache available for this table.
+    return Status::Incomplete("");
+  }
+  while (true) {
+    const MetaCacheEntry* entry = FindFloorEntry(*snapshot, *partition_key);
+    if (PREDICT_FALSE(!entry || entry->stale() || !entry->Contains(*partition_key))) {
+      break;
+    }
+    if (!entry->is_non_covered_range() && !entry->tablet()->HasLeader()) {
+      break;
+    }
+    VLOG(4) << "Fast lookup: found " << entry->DebugString(table) << " for "
             << DebugLowerBoundPartitionKey(table, *partition_key);
-    if (!entry.is_non_covered_range()) {
+    if (!entry->is_non_covered_range()) {
       if (remote_tablet) {
-        *remote_tablet = entry.tablet();
+        *remote_tablet = entry->tablet();
       }
       return Status::OK();
     }
-    if (lookup_type == LookupType::kPoint || entry.upper_bound_partition_key().empty()) {
+    if (lookup_type == LookupType::kPoint || entry->upper_bound_partition_key().empty()) {
       return Status::NotFound("No tablet covering the requested range partition",
-                              entry.DebugString(table));
+                              entry->DebugString(table));
     }
-    *partition_key = entry.upper_bound_partition_key();
+    *partition_key = entry->upper_bound_partition_key();
   }
   return Status::Incomplete("");
 }
@@ -967,6 +1082,7 @@ void MetaCache::ClearNonCoveredRangeEntries(const std::string& table_id) {
       it++;
     }
   }
+  UpdateSnapshotUnlocked(table_id);
 }
 
 void MetaCache::ClearCache() {
@@ -975,6 +1091,7 @@ void MetaCache::ClearCache() {
   STLDeleteValues(&ts_cache_);
   tablets_by_id_.clear();
   tablets_by_table_and_key_.clear();
+  snapshots_by_table_.clear();
 }
 
 void MetaCache::LookupTabletByKey(const KuduTable* table,
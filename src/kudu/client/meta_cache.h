@@ -20,6 +20,7 @@
 #define KUDU_CLIENT_META_CACHE_H
 
 #include <atomic>
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <set>
@@ -89,6 +90,9 @@ class RemoteTabletServer {
   // Initialize the RPC proxy to this tablet server, if it is not already set up.
   // This will involve a DNS lookup if there is not already an active proxy.
   // If there is an active proxy, does nothing.
+  //
+  // If the tablet server is on the same host as the client and listens on a
+  // UNIX domain socket, the proxy connects to it rather than over TCP.
   void InitProxy(KuduClient* client, const StatusCallback& cb);
 
   // Update information from the given pb.
@@ -110,6 +114,26 @@ class RemoteTabletServer {
   // If no location is assigned, the returned string will be empty.
   std::string location() const;
 
+  // Tracks an RPC sent to this server: StartRpc() must be called when it
+  // is sent, and FinishRpc() when it completes, with its latency if it
+  // succeeded.
+  void StartRpc();
+  void FinishRpc(const MonoDelta* latency);
+
+  // Returns the expected latency of a new RPC to this server, in
+  // microseconds: the moving average of the latency of the completed RPCs,
+  // scaled by the number of RPCs in flight. Returns 0 if no latency was
+  // recorded yet.
+  int64_t ExpectedLatencyMicros() const;
+
+  // Records that the server asked for writes to be delayed by 'delay' from
+  // now because it's running low on memory.
+  void SetWriteBackpressure(const MonoDelta& delay);
+
+  // Returns the time until which writes to this server should be delayed,
+  // which may be in the past.
+  MonoTime write_backpressure_deadline() const;
+
  private:
   // Internal callback for DNS resolution.
   void DnsResolutionFinished(const HostPort& hp,
@@ -124,8 +148,19 @@ class RemoteTabletServer {
   std::string location_;
 
   std::vector<HostPort> rpc_hostports_;
+  // The path of the UNIX domain socket of the server, if it listens on one.
+  std::string unix_domain_socket_path_;
   std::shared_ptr<tserver::TabletServerServiceProxy> proxy_;
 
+  // The exponentially weighted moving average of the latency of the RPCs
+  // to this server, in microseconds, and the number of RPCs in flight.
+  std::atomic<int64_t> latency_ewma_us_;
+  std::atomic<int32_t> rpcs_in_flight_;
+
+  // The time until which writes to this server should be delayed. Protected
+  // by 'lock_'.
+  MonoTime write_backpressure_deadline_;
+
   DISALLOW_COPY_AND_ASSIGN(RemoteTabletServer);
 };
 
@@ -197,7 +232,8 @@ class RemoteTablet : public RefCountedThreadSafe<RemoteTablet> {
                Partition partition)
       : tablet_id_(std::move(tablet_id)),
         partition_(std::move(partition)),
-        stale_(false) {
+        stale_(false),
+        leader_(nullptr) {
   }
 
   // Updates this tablet's replica locations.
@@ -229,6 +265,8 @@ class RemoteTablet : public RefCountedThreadSafe<RemoteTablet> {
   // Returns NULL if there is currently no leader, or if the leader has
   // failed. Given that the replica list may change at any time,
   // callers should always check the result against NULL.
+  //
+  // Doesn't take any lock, since it's called for every lookup of the tablet.
   RemoteTabletServer* LeaderTServer() const;
 
   // Writes this tablet's TSes (across all replicas) to 'servers'. Skips
@@ -261,6 +299,10 @@ class RemoteTablet : public RefCountedThreadSafe<RemoteTablet> {
   // Same as ReplicasAsString(), except that the caller must hold lock_.
   std::string ReplicasAsStringUnlocked() const;
 
+  // Sets leader_ from replicas_. Must be called with lock_ held, after any
+  // change to replicas_.
+  void UpdateLeaderUnlocked();
+
   const std::string tablet_id_;
   const Partition partition_;
 
@@ -269,6 +311,10 @@ class RemoteTablet : public RefCountedThreadSafe<RemoteTablet> {
   mutable simple_spinlock lock_; // Protects replicas_.
   std::vector<RemoteReplica> replicas_;
 
+  // The first non-failed LEADER of replicas_, or NULL. Written with lock_
+  // held, but may be read without it.
+  std::atomic<RemoteTabletServer*> leader_;
+
   DISALLOW_COPY_AND_ASSIGN(RemoteTablet);
 };
 
@@ -446,6 +492,26 @@ class MetaCache : public RefCountedThreadSafe<MetaCache> {
                                 const std::string& partition_key,
                                 MetaCacheEntry* entry);
 
+  // A sorted, flat copy of the entries of a table's TabletMap, which the fast
+  // path binary searches instead of walking the map.
+  struct TabletSnapshot {
+    // The lower bound partition keys of 'entries', in the same order.
+    std::vector<std::string> lower_bounds;
+    std::vector<MetaCacheEntry> entries;
+  };
+
+  // Returns the entry of 'snapshot' whose lower bound is the greatest one not
+  // past 'partition_key', or NULL if there is none. The entry is returned even
+  // if it is stale or doesn't contain 'partition_key'.
+  static const MetaCacheEntry* FindFloorEntry(const TabletSnapshot& snapshot,
+                                              const std::string& partition_key);
+
+  // Rebuilds the snapshot of the given table from its TabletMap, which must
+  // be called after any change to the map.
+  //
+  // NOTE: Must be called with lock_ held for writing.
+  void UpdateSnapshotUnlocked(const std::string& table_id);
+
   // Perform the complete fast-path lookup. Returns:
   //  - NotFound if the lookup hits a non-covering range.
   //  - Incomplete if the fast path was not possible
@@ -489,6 +555,13 @@ class MetaCache : public RefCountedThreadSafe<MetaCache> {
   // Protected by lock_.
   std::unordered_map<std::string, TabletMap> tablets_by_table_and_key_;
 
+  // The snapshots of the tables in tablets_by_table_and_key_, keyed by table
+  // id. They are only rebuilt on master lookups and cache clearing, so the
+  // fast path only holds the per-CPU reader lock of lock_ while searching.
+  //
+  // Protected by lock_.
+  std::unordered_map<std::string, TabletSnapshot> snapshots_by_table_;
+
   // Cache of tablets, keyed by tablet ID.
   //
   // Protected by lock_
@@ -0,0 +1,228 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/client/parallel_scanner-internal.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <boost/bind.hpp> // IWYU pragma: keep
+#include <glog/logging.h>
+
+#include "kudu/client/scan_batch.h"
+#include "kudu/client/scanner-internal.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/threadpool.h"
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace client {
+
+KuduParallelScanner::Data::Data(const vector<KuduScanToken*>& tokens)
+    : tokens_(tokens),
+      max_concurrent_tablets_(8),
+      max_concurrent_tablets_per_server_(2),
+      cond_(&lock_),
+      open_(false),
+      closing_(false),
+      num_running_(0),
+      error_returned_(false) {
+}
+
+KuduParallelScanner::Data::~Data() {
+  Close();
+}
+
+Status KuduParallelScanner::Data::SetMaxConcurrentTablets(int max_tablets) {
+  if (open_) {
+    return Status::IllegalState("Concurrency must be set before Open()");
+  }
+  if (max_tablets <= 0) {
+    return Status::InvalidArgument("Maximum number of concurrent tablets must be positive");
+  }
+  max_concurrent_tablets_ = max_tablets;
+  return Status::OK();
+}
+
+Status KuduParallelScanner::Data::SetMaxConcurrentTabletsPerServer(int max_tablets) {
+  if (open_) {
+    return Status::IllegalState("Concurrency must be set before Open()");
+  }
+  if (max_tablets <= 0) {
+    return Status::InvalidArgument(
+        "Maximum number of concurrent tablets per server must be positive");
+  }
+  max_concurrent_tablets_per_server_ = max_tablets;
+  return Status::OK();
+}
+
+string KuduParallelScanner::Data::ServerUuid(const KuduScanToken& token) {
+  const vector<const KuduReplica*>& replicas = token.tablet().replicas();
+  for (const KuduReplica* replica : replicas) {
+    if (replica->is_leader()) {
+      return replica->ts().uuid();
+    }
+  }
+  return replicas.empty() ? "" : replicas[0]->ts().uuid();
+}
+
+Status KuduParallelScanner::Data::Open() {
+  if (open_) {
+    return Status::IllegalState("Scanner already open");
+  }
+  int num_threads = std::min<int>(max_concurrent_tablets_, tokens_.size());
+  RETURN_NOT_OK(ThreadPoolBuilder("parallel-scan")
+                .set_min_threads(0)
+                .set_max_threads(std::max(num_threads, 1))
+                .Build(&pool_));
+  MutexLock l(lock_);
+  for (size_t i = 0; i < tokens_.size(); i++) {
+    pending_.push_back(i);
+  }
+  open_ = true;
+  ScheduleScansUnlocked();
+  return status_;
+}
+
+void KuduParallelScanner::Data::ScheduleScansUnlocked() {
+  lock_.AssertAcquired();
+  for (auto it = pending_.begin();
+       it != pending_.end() && num_running_ < max_concurrent_tablets_ && status_.ok();) {
+    string uuid = ServerUuid(*tokens_[*it]);
+    int& num_running_on_server = num_running_by_server_[uuid];
+    if (num_running_on_server >= max_concurrent_tablets_per_server_) {
+      ++it;
+      continue;
+    }
+    Status s = pool_->SubmitFunc(boost::bind(&Data::ScanTablet, this, *it));
+    if (PREDICT_FALSE(!s.ok())) {
+      status_ = s;
+      break;
+    }
+    num_running_on_server++;
+    num_running_++;
+    it = pending_.erase(it);
+  }
+}
+
+void KuduParallelScanner::Data::ScanTablet(size_t idx) {
+  const KuduScanToken& token = *tokens_[idx];
+  Status s = DoScanTablet(token);
+  MutexLock l(lock_);
+  if (!s.ok() && status_.ok() && !closing_) {
+    status_ = s.CloneAndPrepend(Substitute("scan of tablet $0 failed", token.tablet().id()));
+  }
+  num_running_--;
+  num_running_by_server_[ServerUuid(token)]--;
+  if (!closing_) {
+    ScheduleScansUnlocked();
+  }
+  cond_.Broadcast();
+}
+
+Status KuduParallelScanner::Data::DoScanTablet(const KuduScanToken& token) {
+  KuduScanner* scanner_ptr;
+  RETURN_NOT_OK(token.IntoKuduScanner(&scanner_ptr));
+  unique_ptr<KuduScanner> scanner(scanner_ptr);
+  RETURN_NOT_OK(scanner->Open());
+  const size_t max_buffered_batches = 2 * max_concurrent_tablets_;
+  while (scanner->HasMoreRows()) {
+    unique_ptr<KuduScanBatch> batch(new KuduScanBatch);
+    RETURN_NOT_OK(scanner->NextBatch(batch.get()));
+    if (batch->NumRows() == 0) {
+      continue;
+    }
+    MutexLock l(lock_);
+    while (batches_.size() >= max_buffered_batches && !closing_ && status_.ok()) {
+      cond_.Wait();
+    }
+    if (closing_ || !status_.ok()) {
+      // The scan is abandoned: the scanner is closed when destroyed.
+      return Status::OK();
+    }
+    batches_.emplace_back(std::move(batch));
+    cond_.Broadcast();
+  }
+  return Status::OK();
+}
+
+bool KuduParallelScanner::Data::DoneUnlocked() const {
+  lock_.AssertAcquired();
+  return !status_.ok() || (pending_.empty() && num_running_ == 0);
+}
+
+bool KuduParallelScanner::Data::HasMoreRows() const {
+  CHECK(open_);
+  MutexLock l(lock_);
+  if (!status_.ok()) {
+    return !error_returned_;
+  }
+  return !batches_.empty() || !DoneUnlocked();
+}
+
+Status KuduParallelScanner::Data::NextBatch(KuduScanBatch* batch) {
+  CHECK(open_);
+  batch->data_->Clear();
+  unique_ptr<KuduScanBatch> next;
+  {
+    MutexLock l(lock_);
+    while (batches_.empty() && !DoneUnlocked()) {
+      cond_.Wait();
+    }
+    if (!status_.ok()) {
+      // The error is only returned once, after which HasMoreRows() is false.
+      error_returned_ = true;
+      batches_.clear();
+      pending_.clear();
+      closing_ = true;
+      cond_.Broadcast();
+      return status_;
+    }
+    if (batches_.empty()) {
+      return Status::OK();
+    }
+    next = std::move(batches_.front());
+    batches_.pop_front();
+    cond_.Broadcast();
+  }
+  std::swap(batch->data_, next->data_);
+  return Status::OK();
+}
+
+void KuduParallelScanner::Data::Close() {
+  if (!open_) {
+    return;
+  }
+  {
+    MutexLock l(lock_);
+    closing_ = true;
+    pending_.clear();
+    cond_.Broadcast();
+  }
+  // Wait for the scans in progress to notice, and shut the threads down.
+  pool_->Shutdown();
+  MutexLock l(lock_);
+  batches_.clear();
+  open_ = false;
+}
+
+} // namespace client
+} // namespace kudu
@@ -0,0 +1,114 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "kudu/client/client.h"
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/mutex.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class ThreadPool;
+
+namespace client {
+
+class KuduScanBatch;
+
+class KuduParallelScanner::Data {
+ public:
+  explicit Data(const std::vector<KuduScanToken*>& tokens);
+  ~Data();
+
+  Status SetMaxConcurrentTablets(int max_tablets);
+
+  Status SetMaxConcurrentTabletsPerServer(int max_tablets);
+
+  Status Open();
+
+  void Close();
+
+  bool HasMoreRows() const;
+
+  Status NextBatch(KuduScanBatch* batch);
+
+ private:
+  // Returns the UUID of the server to which the scan of 'token' is
+  // accounted: the server of its leader replica, or of its first replica.
+  static std::string ServerUuid(const KuduScanToken& token);
+
+  // Starts the scans of the pending tablets which fit under the limits.
+  void ScheduleScansUnlocked();
+
+  // Scans the tablet of the token at index 'idx' of 'tokens_', buffering its
+  // non-empty batches.
+  void ScanTablet(size_t idx);
+
+  // Runs the scan of a tablet, returning its first error.
+  Status DoScanTablet(const KuduScanToken& token);
+
+  // Whether all the tablets were scanned, or a scan failed.
+  bool DoneUnlocked() const;
+
+  const std::vector<KuduScanToken*> tokens_;
+
+  int max_concurrent_tablets_;
+  int max_concurrent_tablets_per_server_;
+
+  // The threads scanning the tablets.
+  gscoped_ptr<ThreadPool> pool_;
+
+  mutable Mutex lock_;
+
+  // Signaled when a batch is buffered or taken, and when a scan ends.
+  ConditionVariable cond_;
+
+  bool open_;
+
+  // Set when the scanner is closed, to stop the scans in progress.
+  bool closing_;
+
+  // The indexes in 'tokens_' of the tablets which remain to be scanned.
+  std::deque<size_t> pending_;
+
+  // The number of tablet scans in progress, overall and by server UUID.
+  int num_running_;
+  std::unordered_map<std::string, int> num_running_by_server_;
+
+  // The batches which weren't returned yet. At most twice as many batches as
+  // there are concurrent tablet scans are buffered.
+  std::deque<std::unique_ptr<KuduScanBatch>> batches_;
+
+  // The error of the first tablet scan which failed, if any, and whether it
+  // was returned by NextBatch().
+  Status status_;
+  bool error_returned_;
+
+  DISALLOW_COPY_AND_ASSIGN(Data);
+};
+
+} // namespace client
+} // namespace kudu
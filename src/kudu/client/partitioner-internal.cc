@@ -20,6 +20,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "kudu/client/client-internal.h"
 #include "kudu/client/client.h"
@@ -33,6 +34,7 @@
 
 using std::string;
 using std::unique_ptr;
+using std::vector;
 
 namespace kudu {
 namespace client {
@@ -83,5 +85,15 @@ Status KuduPartitioner::Data::PartitionRow(
   return Status::OK();
 }
 
+Status KuduPartitioner::Data::PartitionRows(
+    const vector<const KuduPartialRow*>& rows, vector<int>* partitions) {
+  RETURN_NOT_OK(table_->data_->partition_schema_.EncodeKeys(rows, &tmp_keys_));
+  partitions->resize(rows.size());
+  for (size_t i = 0; i < rows.size(); i++) {
+    (*partitions)[i] = FindFloorOrDie(partitions_by_start_key_, tmp_keys_[i]);
+  }
+  return Status::OK();
+}
+
 } // namespace client
 } // namespace kudu
@@ -19,6 +19,7 @@
 #include <map>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "kudu/client/client.h"
 #include "kudu/client/shared_ptr.h"
@@ -66,11 +67,14 @@ class KuduPartitionerBuilder::Data {
 class KuduPartitioner::Data {
  public:
   Status PartitionRow(const KuduPartialRow& row, int* partition);
+  Status PartitionRows(const std::vector<const KuduPartialRow*>& rows,
+                       std::vector<int>* partitions);
 
   sp::shared_ptr<KuduTable> table_;
   std::map<std::string, int> partitions_by_start_key_;
   int num_partitions_ = 0;
   std::string tmp_buf_;
+  std::vector<std::string> tmp_keys_;
 };
 
 
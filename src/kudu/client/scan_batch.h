@@ -145,10 +145,55 @@ class KUDU_EXPORT KuduScanBatch {
   ///
   /// @return a Slice that points to the raw indirect row data.
   Slice indirect_data() const;
+
+  /// Get the cell data of a column of fixed-length type, for a batch scanned
+  /// with the KuduScanner::COLUMNAR_LAYOUT row format flag.
+  ///
+  /// The cells of the NumRows() rows are stored contiguously, in the in-memory
+  /// format of their type (e.g. little-endian int64_t for INT64 and
+  /// UNIXTIME_MICROS columns). The cells of NULL values are zeroed.
+  ///
+  /// @param [in] idx
+  ///   The index of the column in the projection.
+  /// @param [out] data
+  ///   The cell data, which points into the RPC sidecar it was received in.
+  /// @return Operation result status. Returns IllegalState if the batch isn't
+  ///   in columnar layout, and InvalidArgument if the index is out of bounds
+  ///   or the column is of variable-length type.
+  Status GetFixedLengthColumn(int idx, Slice* data) const WARN_UNUSED_RESULT;
+
+  /// Get the data of a STRING or BINARY column, for a batch scanned with the
+  /// KuduScanner::COLUMNAR_LAYOUT row format flag.
+  ///
+  /// @param [in] idx
+  ///   The index of the column in the projection.
+  /// @param [out] offsets
+  ///   NumRows() + 1 little-endian uint32_t offsets into 'data': the value of
+  ///   row 'i' spans the bytes [offsets[i], offsets[i + 1]) of 'data'.
+  /// @param [out] data
+  ///   The concatenated values of the column.
+  /// @return Operation result status. Returns IllegalState if the batch isn't
+  ///   in columnar layout, and InvalidArgument if the index is out of bounds
+  ///   or the column is of fixed-length type.
+  Status GetVariableLengthColumn(int idx, Slice* offsets, Slice* data) const WARN_UNUSED_RESULT;
+
+  /// Get the non-NULL bitmap of a column, for a batch scanned with the
+  /// KuduScanner::COLUMNAR_LAYOUT row format flag.
+  ///
+  /// @param [in] idx
+  ///   The index of the column in the projection.
+  /// @param [out] data
+  ///   A bitmap with a bit set for every row whose cell isn't NULL, the bit
+  ///   of row 'i' being bit (i % 8) of byte (i / 8). For columns which aren't
+  ///   nullable, this is an empty Slice.
+  /// @return Operation result status. Returns IllegalState if the batch isn't
+  ///   in columnar layout, and InvalidArgument if the index is out of bounds.
+  Status GetNonNullBitmapForColumn(int idx, Slice* data) const WARN_UNUSED_RESULT;
   ///@}
 
  private:
   class KUDU_NO_EXPORT Data;
+  friend class KuduParallelScanner;
   friend class KuduScanner;
   friend class tools::ReplicaDumper;
 
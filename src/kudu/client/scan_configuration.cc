@@ -55,7 +55,10 @@ ScanConfiguration::ScanConfiguration(KuduTable* table)
       lower_bound_propagation_timestamp_(kNoTimestamp),
       timeout_(MonoDelta::FromMilliseconds(KuduScanner::kScanTimeoutMillis)),
       arena_(256),
-      row_format_flags_(KuduScanner::NO_FLAGS) {
+      row_format_flags_(KuduScanner::NO_FLAGS),
+      prefetch_depth_(0),
+      prefetch_memory_limit_bytes_(KuduScanner::kPrefetchMemoryLimitBytes),
+      scan_profile_enabled_(false) {
 }
 
 Status ScanConfiguration::SetProjectedColumnNames(const vector<string>& col_names) {
@@ -194,6 +197,26 @@ Status ScanConfiguration::SetRowFormatFlags(uint64_t flags) {
   return Status::OK();
 }
 
+Status ScanConfiguration::SetPrefetchDepth(int depth) {
+  if (depth < 0) {
+    return Status::InvalidArgument("Prefetch depth must be non-negative");
+  }
+  prefetch_depth_ = depth;
+  return Status::OK();
+}
+
+Status ScanConfiguration::SetPrefetchMemoryLimitBytes(int64_t limit_bytes) {
+  if (limit_bytes <= 0) {
+    return Status::InvalidArgument("Prefetch memory limit must be positive");
+  }
+  prefetch_memory_limit_bytes_ = limit_bytes;
+  return Status::OK();
+}
+
+void ScanConfiguration::SetScanProfileEnabled(bool enabled) {
+  scan_profile_enabled_ = enabled;
+}
+
 Status ScanConfiguration::SetLimit(int64_t limit) {
   if (limit < 0) {
     return Status::InvalidArgument("Limit must be non-negative");
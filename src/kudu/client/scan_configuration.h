@@ -100,6 +100,12 @@ class ScanConfiguration {
 
   Status SetLimit(int64_t limit);
 
+  Status SetPrefetchDepth(int depth);
+
+  Status SetPrefetchMemoryLimitBytes(int64_t limit_bytes);
+
+  void SetScanProfileEnabled(bool enabled);
+
   void OptimizeScanSpec();
 
   const KuduTable& table() {
@@ -171,6 +177,18 @@ class ScanConfiguration {
     return row_format_flags_;
   }
 
+  int prefetch_depth() const {
+    return prefetch_depth_;
+  }
+
+  int64_t prefetch_memory_limit_bytes() const {
+    return prefetch_memory_limit_bytes_;
+  }
+
+  bool scan_profile_enabled() const {
+    return scan_profile_enabled_;
+  }
+
   Arena* arena() {
     return &arena_;
   }
@@ -215,6 +233,11 @@ class ScanConfiguration {
   AutoReleasePool pool_;
 
   uint64_t row_format_flags_;
+
+  int prefetch_depth_;
+  int64_t prefetch_memory_limit_bytes_;
+
+  bool scan_profile_enabled_;
 };
 
 } // namespace client
@@ -45,9 +45,13 @@
 #include "kudu/common/types.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/consensus/metadata.pb.h"
+#include "kudu/security/token.pb.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/rpc/rpc_controller.h"
+#include "kudu/tserver/tserver.pb.h"
+#include "kudu/tserver/tserver_service.proxy.h"
 #include "kudu/util/async_util.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
@@ -63,6 +67,10 @@ namespace kudu {
 namespace client {
 
 using internal::MetaCache;
+using rpc::RpcController;
+using security::SignedTokenPB;
+using tserver::SplitKeyRangeRequestPB;
+using tserver::SplitKeyRangeResponsePB;
 
 KuduScanToken::Data::Data(KuduTable* table,
                           ScanTokenPB message,
@@ -213,7 +221,8 @@ Status KuduScanToken::Data::PBIntoScanner(KuduClient* client,
 }
 
 KuduScanTokenBuilder::Data::Data(KuduTable* table)
-    : configuration_(table) {
+    : configuration_(table),
+      split_size_bytes_(0) {
 }
 
 Status KuduScanTokenBuilder::Data::Build(vector<KuduScanToken*>* tokens) {
@@ -320,52 +329,123 @@ Status KuduScanTokenBuilder::Data::Build(vector<KuduScanToken*>* tokens) {
     vector<internal::RemoteReplica> replicas;
     tablet->GetRemoteReplicas(&replicas);
 
-    vector<const KuduReplica*> client_replicas;
-    ElementDeleter deleter(&client_replicas);
-
-    // Convert the replicas from their internal format to something appropriate
-    // for clients.
-    for (const auto& r : replicas) {
-      vector<HostPort> host_ports;
-      r.ts->GetHostPorts(&host_ports);
-      if (host_ports.empty()) {
-        return Status::IllegalState(Substitute(
-            "No host found for tablet server $0", r.ts->ToString()));
-      }
-      unique_ptr<KuduTabletServer> client_ts(new KuduTabletServer);
-      client_ts->data_ = new KuduTabletServer::Data(r.ts->permanent_uuid(),
-                                                    host_ports[0],
-                                                    r.ts->location());
-      bool is_leader = r.role == consensus::RaftPeerPB::LEADER;
-      bool is_voter = is_leader || r.role == consensus::RaftPeerPB::FOLLOWER;
-      unique_ptr<KuduReplica> client_replica(new KuduReplica);
-      client_replica->data_ = new KuduReplica::Data(is_leader, is_voter,
-                                                    std::move(client_ts));
-      client_replicas.push_back(client_replica.release());
+    // Splits the tablet's primary key range into ranges of about
+    // split_size_bytes_ bytes, each of which gets its own token.
+    vector<KeyRangePB> key_ranges;
+    if (split_size_bytes_ > 0) {
+      RETURN_NOT_OK(SplitKeyRange(tablet.get(), pb, deadline, &key_ranges));
+    }
+    if (key_ranges.empty()) {
+      // The tablet is scanned by a single token.
+      key_ranges.emplace_back();
     }
 
-    unique_ptr<KuduTablet> client_tablet(new KuduTablet);
-    client_tablet->data_ = new KuduTablet::Data(tablet->tablet_id(),
-                                                std::move(client_replicas));
-    client_replicas.clear();
-
-    // Create the scan token itself.
-    ScanTokenPB message;
-    message.CopyFrom(pb);
-    message.set_lower_bound_partition_key(
-        tablet->partition().partition_key_start());
-    message.set_upper_bound_partition_key(
-        tablet->partition().partition_key_end());
-    unique_ptr<KuduScanToken> client_scan_token(new KuduScanToken);
-    client_scan_token->data_ =
-        new KuduScanToken::Data(table,
-                                std::move(message),
-                                std::move(client_tablet));
-    tokens->push_back(client_scan_token.release());
+    for (const KeyRangePB& range : key_ranges) {
+      vector<const KuduReplica*> client_replicas;
+      ElementDeleter deleter(&client_replicas);
+
+      // Convert the replicas from their internal format to something appropriate
+      // for clients.
+      for (const auto& r : replicas) {
+        vector<HostPort> host_ports;
+        r.ts->GetHostPorts(&host_ports);
+        if (host_ports.empty()) {
+          return Status::IllegalState(Substitute(
+              "No host found for tablet server $0", r.ts->ToString()));
+        }
+        unique_ptr<KuduTabletServer> client_ts(new KuduTabletServer);
+        client_ts->data_ = new KuduTabletServer::Data(r.ts->permanent_uuid(),
+                                                      host_ports[0],
+                                                      r.ts->location());
+        bool is_leader = r.role == consensus::RaftPeerPB::LEADER;
+        bool is_voter = is_leader || r.role == consensus::RaftPeerPB::FOLLOWER;
+        unique_ptr<KuduReplica> client_replica(new KuduReplica);
+        client_replica->data_ = new KuduReplica::Data(is_leader, is_voter,
+                                                      std::move(client_ts));
+        client_replicas.push_back(client_replica.release());
+      }
+
+      unique_ptr<KuduTablet> client_tablet(new KuduTablet);
+      client_tablet->data_ = new KuduTablet::Data(tablet->tablet_id(),
+                                                  std::move(client_replicas));
+      client_replicas.clear();
+
+      // Create the scan token itself.
+      ScanTokenPB message;
+      message.CopyFrom(pb);
+      message.set_lower_bound_partition_key(
+          tablet->partition().partition_key_start());
+      message.set_upper_bound_partition_key(
+          tablet->partition().partition_key_end());
+      // The split ranges are within the bounds of the scan, with empty keys
+      // for the unbounded ends.
+      if (range.has_start_primary_key() && !range.start_primary_key().empty()) {
+        message.set_lower_bound_primary_key(range.start_primary_key());
+      }
+      if (range.has_stop_primary_key() && !range.stop_primary_key().empty()) {
+        message.set_upper_bound_primary_key(range.stop_primary_key());
+      }
+      unique_ptr<KuduScanToken> client_scan_token(new KuduScanToken);
+      client_scan_token->data_ =
+          new KuduScanToken::Data(table,
+                                  std::move(message),
+                                  std::move(client_tablet));
+      tokens->push_back(client_scan_token.release());
+    }
     pruner.RemovePartitionKeyRange(tablet->partition().partition_key_end());
   }
   return Status::OK();
 }
 
+Status KuduScanTokenBuilder::Data::SplitKeyRange(internal::RemoteTablet* tablet,
+                                                 const ScanTokenPB& pb,
+                                                 const MonoTime& deadline,
+                                                 vector<KeyRangePB>* ranges) {
+  KuduTable* table = configuration_.table_;
+  KuduClient* client = table->client();
+  internal::RemoteTabletServer* ts = tablet->LeaderTServer();
+  if (!ts) {
+    vector<internal::RemoteTabletServer*> servers;
+    tablet->GetRemoteTabletServers(&servers);
+    if (servers.empty()) {
+      return Status::ServiceUnavailable(Substitute(
+          "No replica of tablet $0 is available to split its key range",
+          tablet->tablet_id()));
+    }
+    ts = servers[0];
+  }
+  Synchronizer sync;
+  ts->InitProxy(client, sync.AsStatusCallback());
+  RETURN_NOT_OK(sync.Wait());
+
+  SplitKeyRangeRequestPB req;
+  req.set_tablet_id(tablet->tablet_id());
+  if (pb.has_lower_bound_primary_key()) {
+    req.set_start_primary_key(pb.lower_bound_primary_key());
+  }
+  if (pb.has_upper_bound_primary_key()) {
+    req.set_stop_primary_key(pb.upper_bound_primary_key());
+  }
+  req.set_target_chunk_size_bytes(split_size_bytes_);
+  *req.mutable_columns() = pb.projected_columns();
+  SignedTokenPB authz_token;
+  if (client->data_->FetchCachedAuthzToken(table->id(), &authz_token)) {
+    *req.mutable_authz_token() = std::move(authz_token);
+  }
+
+  SplitKeyRangeResponsePB resp;
+  RpcController controller;
+  controller.set_deadline(deadline);
+  RETURN_NOT_OK_PREPEND(ts->proxy()->SplitKeyRange(req, &resp, &controller),
+                        Substitute("Failed to split the key range of tablet $0",
+                                   tablet->tablet_id()));
+  if (resp.has_error()) {
+    return StatusFromPB(resp.error().status()).CloneAndPrepend(
+        Substitute("Failed to split the key range of tablet $0", tablet->tablet_id()));
+  }
+  ranges->assign(resp.ranges().begin(), resp.ranges().end());
+  return Status::OK();
+}
+
 } // namespace client
 } // namespace kudu
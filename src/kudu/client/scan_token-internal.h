@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -27,8 +28,16 @@
 #include "kudu/util/status.h"
 
 namespace kudu {
+
+class KeyRangePB;
+class MonoTime;
+
 namespace client {
 
+namespace internal {
+class RemoteTablet;
+} // namespace internal
+
 class KuduScanToken::Data {
  public:
   explicit Data(KuduTable* table,
@@ -72,8 +81,23 @@ class KuduScanTokenBuilder::Data {
     return &configuration_;
   }
 
+  void SetSplitSizeBytes(uint64_t split_size_bytes) {
+    split_size_bytes_ = split_size_bytes;
+  }
+
  private:
+  // Asks a replica of 'tablet' (its leader, if known) to split the primary
+  // key range of the token 'pb' within the tablet into ranges of about
+  // split_size_bytes_ bytes of the projected columns.
+  Status SplitKeyRange(internal::RemoteTablet* tablet,
+                       const ScanTokenPB& pb,
+                       const MonoTime& deadline,
+                       std::vector<KeyRangePB>* ranges);
+
   ScanConfiguration configuration_;
+
+  // If not 0, the target size of the data scanned by each token, in bytes.
+  uint64_t split_size_bytes_;
 };
 
 } // namespace client
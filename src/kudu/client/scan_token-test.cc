@@ -42,9 +42,13 @@
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/ref_counted.h"
 #include "kudu/mini-cluster/internal_mini_cluster.h"
+#include "kudu/tablet/tablet.h"
+#include "kudu/tablet/tablet_replica.h"
 #include "kudu/tserver/mini_tablet_server.h"
 #include "kudu/tserver/tablet_server.h"
+#include "kudu/tserver/ts_tablet_manager.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/sockaddr.h"
@@ -64,6 +68,7 @@ using std::thread;
 using std::unique_ptr;
 using std::unordered_set;
 using std::vector;
+using tablet::TabletReplica;
 using tserver::MiniTabletServer;
 
 class ScanTokenTest : public KuduTest {
@@ -637,5 +642,124 @@ TEST_F(ScanTokenTest, TestConcurrentAlterTable) {
   delete scanner_ptr;
 }
 
+// Scans all the tablets of a table with a KuduParallelScanner, with
+// concurrency limits lower than the number of tablets.
+TEST_F(ScanTokenTest, TestParallelScanner) {
+  const int kNumRows = 1000;
+  KuduSchema schema;
+  {
+    KuduSchemaBuilder builder;
+    builder.AddColumn("col")->NotNull()->Type(KuduColumnSchema::INT64)->PrimaryKey();
+    ASSERT_OK(builder.Build(&schema));
+  }
+  shared_ptr<KuduTable> table;
+  {
+    unique_ptr<client::KuduTableCreator> table_creator(client_->NewTableCreator());
+    ASSERT_OK(table_creator->table_name("table")
+                            .schema(&schema)
+                            .add_hash_partitions({ "col" }, 8)
+                            .num_replicas(1)
+                            .Create());
+    ASSERT_OK(client_->OpenTable("table", &table));
+  }
+  shared_ptr<KuduSession> session = client_->NewSession();
+  session->SetTimeoutMillis(10000);
+  ASSERT_OK(session->SetFlushMode(KuduSession::AUTO_FLUSH_BACKGROUND));
+  for (int i = 0; i < kNumRows; i++) {
+    unique_ptr<KuduInsert> insert(table->NewInsert());
+    ASSERT_OK(insert->mutable_row()->SetInt64("col", i));
+    ASSERT_OK(session->Apply(insert.release()));
+  }
+  ASSERT_OK(session->Flush());
+
+  vector<KuduScanToken*> tokens;
+  ElementDeleter deleter(&tokens);
+  KuduScanTokenBuilder builder(table.get());
+  // Use small batches so that each tablet is scanned in several batches.
+  ASSERT_OK(builder.SetBatchSizeBytes(64));
+  ASSERT_OK(builder.Build(&tokens));
+  ASSERT_EQ(8, tokens.size());
+
+  KuduParallelScanner scanner(tokens);
+  ASSERT_TRUE(scanner.SetMaxConcurrentTablets(0).IsInvalidArgument());
+  ASSERT_OK(scanner.SetMaxConcurrentTablets(3));
+  ASSERT_OK(scanner.SetMaxConcurrentTabletsPerServer(2));
+  ASSERT_OK(scanner.Open());
+  ASSERT_TRUE(scanner.SetMaxConcurrentTablets(4).IsIllegalState());
+
+  unordered_set<int64_t> keys;
+  KuduScanBatch batch;
+  while (scanner.HasMoreRows()) {
+    ASSERT_OK(scanner.NextBatch(&batch));
+    for (auto it = batch.begin(); it != batch.end(); ++it) {
+      int64_t key;
+      ASSERT_OK((*it).GetInt64(0, &key));
+      ASSERT_TRUE(keys.insert(key).second) << key;
+    }
+  }
+  ASSERT_EQ(kNumRows, keys.size());
+  scanner.Close();
+}
+
+// Splits the tablets of a table by size, and checks that the tokens scan
+// each row exactly once.
+TEST_F(ScanTokenTest, TestSplitSizeBytes) {
+  const int kNumRows = 20000;
+  KuduSchema schema;
+  {
+    KuduSchemaBuilder builder;
+    builder.AddColumn("col")->NotNull()->Type(KuduColumnSchema::INT64)->PrimaryKey();
+    ASSERT_OK(builder.Build(&schema));
+  }
+  shared_ptr<KuduTable> table;
+  {
+    unique_ptr<client::KuduTableCreator> table_creator(client_->NewTableCreator());
+    ASSERT_OK(table_creator->table_name("table")
+                            .schema(&schema)
+                            .add_hash_partitions({ "col" }, 2)
+                            .num_replicas(1)
+                            .Create());
+    ASSERT_OK(client_->OpenTable("table", &table));
+  }
+  shared_ptr<KuduSession> session = client_->NewSession();
+  session->SetTimeoutMillis(10000);
+  ASSERT_OK(session->SetFlushMode(KuduSession::AUTO_FLUSH_BACKGROUND));
+  for (int i = 0; i < kNumRows; i++) {
+    unique_ptr<KuduInsert> insert(table->NewInsert());
+    ASSERT_OK(insert->mutable_row()->SetInt64("col", i));
+    ASSERT_OK(session->Apply(insert.release()));
+  }
+  ASSERT_OK(session->Flush());
+
+  // Only the flushed data is split.
+  vector<scoped_refptr<TabletReplica>> replicas;
+  cluster_->mini_tablet_server(0)->server()->tablet_manager()->GetTabletReplicas(&replicas);
+  for (const auto& replica : replicas) {
+    ASSERT_OK(replica->tablet()->Flush());
+  }
+
+  {
+    vector<KuduScanToken*> tokens;
+    ElementDeleter deleter(&tokens);
+    KuduScanTokenBuilder builder(table.get());
+    ASSERT_OK(builder.SetSplitSizeBytes(1));
+    ASSERT_OK(builder.Build(&tokens));
+    ASSERT_GE(tokens.size(), 2);
+    ASSERT_EQ(kNumRows, CountRows(tokens));
+  }
+
+  { // With a lower bound on the primary key.
+    vector<KuduScanToken*> tokens;
+    ElementDeleter deleter(&tokens);
+    KuduScanTokenBuilder builder(table.get());
+    unique_ptr<KuduPartialRow> row(schema.NewRow());
+    ASSERT_OK(row->SetInt64("col", kNumRows / 2));
+    ASSERT_OK(builder.AddLowerBound(*row));
+    ASSERT_OK(builder.SetSplitSizeBytes(1));
+    ASSERT_OK(builder.Build(&tokens));
+    ASSERT_EQ(kNumRows / 2, CountRows(tokens));
+  }
+}
+
 } // namespace client
 } // namespace kudu
@@ -19,12 +19,14 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <functional>
 #include <ostream>
 #include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include <boost/bind.hpp> // IWYU pragma: keep
 #include <google/protobuf/descriptor.h>
 #include <google/protobuf/message.h>
 
@@ -66,12 +68,25 @@ using rpc::RpcController;
 using security::SignedTokenPB;
 using strings::Substitute;
 using tserver::NewScanRequestPB;
+using tserver::ScanResponsePB;
 using tserver::TabletServerFeatures;
 
 namespace client {
 
 using internal::RemoteTabletServer;
 
+namespace {
+
+// Returns the number of rows in 'resp', in whichever layout they are.
+int64_t NumRowsInResponse(const ScanResponsePB& resp) {
+  if (resp.has_columnar_data()) {
+    return resp.columnar_data().num_rows();
+  }
+  return resp.has_data() ? resp.data().num_rows() : 0;
+}
+
+} // anonymous namespace
+
 KuduScanner::Data::Data(KuduTable* table)
   : configuration_(table),
     open_(false),
@@ -85,6 +100,142 @@ KuduScanner::Data::Data(KuduTable* table)
 KuduScanner::Data::~Data() {
 }
 
+ScanPrefetcher::ScanPrefetcher(int depth, int64_t memory_limit_bytes)
+    : depth_(depth),
+      memory_limit_bytes_(memory_limit_bytes),
+      cond_(&lock_),
+      buffered_bytes_(0),
+      may_send_(false) {
+  DCHECK_GT(depth_, 0);
+}
+
+ScanPrefetcher::~ScanPrefetcher() {
+  Stop();
+}
+
+void ScanPrefetcher::Start(std::shared_ptr<tserver::TabletServerServiceProxy> proxy,
+                           const tserver::ScanRequestPB& last_req,
+                           const MonoDelta& timeout) {
+  tserver::ScanRequestPB req;
+  Response* response;
+  {
+    MutexLock l(lock_);
+    DCHECK(!in_flight_ && responses_.empty());
+    proxy_ = std::move(proxy);
+    timeout_ = timeout;
+    last_req_ = last_req;
+    last_req_.clear_new_scan_request();
+    may_send_ = true;
+    if (!PrepareNextRpcUnlocked(&req, &response)) {
+      return;
+    }
+  }
+  SendRpc(req, response);
+}
+
+bool ScanPrefetcher::active() const {
+  MutexLock l(lock_);
+  return in_flight_ || !responses_.empty();
+}
+
+bool ScanPrefetcher::PrepareNextRpcUnlocked(tserver::ScanRequestPB* req, Response** response) {
+  lock_.AssertAcquired();
+  if (!may_send_ || in_flight_ ||
+      responses_.size() >= static_cast<size_t>(depth_) ||
+      buffered_bytes_ >= memory_limit_bytes_) {
+    return false;
+  }
+  last_req_.set_call_seq_id(last_req_.call_seq_id() + 1);
+  in_flight_.reset(new Response);
+  in_flight_->call_seq_id = last_req_.call_seq_id();
+  in_flight_->rpc_deadline = MonoTime::Now() + timeout_;
+  in_flight_->controller.set_deadline(in_flight_->rpc_deadline);
+  in_flight_->size_bytes = 0;
+  *req = last_req_;
+  *response = in_flight_.get();
+  return true;
+}
+
+void ScanPrefetcher::SendRpc(const tserver::ScanRequestPB& req, Response* response) {
+  // The RPC is sent without holding the lock, since its callback may run
+  // before ScanAsync() returns.
+  proxy_->ScanAsync(req, &response->resp, &response->controller,
+                    boost::bind(&ScanPrefetcher::RpcCallback, this));
+}
+
+void ScanPrefetcher::RpcCallback() {
+  tserver::ScanRequestPB req;
+  Response* next = nullptr;
+  {
+    MutexLock l(lock_);
+    DCHECK(in_flight_);
+    unique_ptr<Response> response = std::move(in_flight_);
+    if (response->controller.status().ok() && !response->resp.has_error() &&
+        response->resp.has_more_results()) {
+      const RowwiseRowBlockPB& data = response->resp.data();
+      Slice sidecar;
+      if (data.has_rows_sidecar() &&
+          response->controller.GetInboundSidecar(data.rows_sidecar(), &sidecar).ok()) {
+        response->size_bytes += sidecar.size();
+      }
+      if (data.has_indirect_data_sidecar() &&
+          response->controller.GetInboundSidecar(data.indirect_data_sidecar(), &sidecar).ok()) {
+        response->size_bytes += sidecar.size();
+      }
+    } else {
+      // Either the RPC failed and must be retried by the caller, or the
+      // tablet has no more rows.
+      may_send_ = false;
+    }
+    buffered_bytes_ += response->size_bytes;
+    responses_.emplace_back(std::move(response));
+    cond_.Broadcast();
+    if (!PrepareNextRpcUnlocked(&req, &next)) {
+      return;
+    }
+  }
+  SendRpc(req, next);
+}
+
+Status ScanPrefetcher::Take(tserver::ScanResponsePB* resp, RpcController* controller,
+                            uint32_t* call_seq_id, MonoTime* rpc_deadline) {
+  unique_ptr<Response> response;
+  tserver::ScanRequestPB req;
+  Response* next = nullptr;
+  {
+    MutexLock l(lock_);
+    DCHECK(in_flight_ || !responses_.empty());
+    while (responses_.empty()) {
+      cond_.Wait();
+    }
+    response = std::move(responses_.front());
+    responses_.pop_front();
+    buffered_bytes_ -= response->size_bytes;
+    if (!PrepareNextRpcUnlocked(&req, &next)) {
+      next = nullptr;
+    }
+  }
+  if (next) {
+    SendRpc(req, next);
+  }
+  resp->Swap(&response->resp);
+  controller->Swap(&response->controller);
+  *call_seq_id = response->call_seq_id;
+  *rpc_deadline = response->rpc_deadline;
+  return controller->status();
+}
+
+uint32_t ScanPrefetcher::Stop() {
+  MutexLock l(lock_);
+  may_send_ = false;
+  while (in_flight_) {
+    cond_.Wait();
+  }
+  responses_.clear();
+  buffered_bytes_ = 0;
+  return last_req_.call_seq_id();
+}
+
 Status KuduScanner::Data::EnrichStatusMessage(Status s) const {
   if (scan_attempts_ > 1) {
     s = s.CloneAndPrepend(Substitute("after $0 scan attempts", scan_attempts_));
@@ -237,6 +388,12 @@ void KuduScanner::Data::UpdateResourceMetrics() {
       }
     }
   }
+  for (const auto& column : last_response_.scan_profile().columns()) {
+    const string prefix = Substitute("column.$0.", column.column_name());
+    resource_metrics_.Increment(prefix + "cells_read", column.cells_read());
+    resource_metrics_.Increment(prefix + "bytes_read", column.bytes_read());
+    resource_metrics_.Increment(prefix + "blocks_read", column.blocks_read());
+  }
 }
 
 string KuduScanner::Data::DebugString() const {
@@ -331,6 +488,28 @@ Status KuduScanner::Data::ReopenCurrentTablet(const MonoTime& deadline,
 
 ScanRpcStatus KuduScanner::Data::SendScanRpc(const MonoTime& overall_deadline,
                                              bool allow_time_for_failover) {
+  MonoTime rpc_deadline = PrepareScanRpc(overall_deadline, allow_time_for_failover);
+  MonoTime rpc_start = MonoTime::Now();
+  ts_->StartRpc();
+  Status rpc_status = proxy_->Scan(next_req_, &last_response_, &controller_);
+  return FinishScanRpc(rpc_status, rpc_start, overall_deadline, rpc_deadline);
+}
+
+void KuduScanner::Data::SendScanRpcAsync(const MonoTime& overall_deadline,
+                                         bool allow_time_for_failover,
+                                         std::function<void(const ScanRpcStatus&)> cb) {
+  MonoTime rpc_deadline = PrepareScanRpc(overall_deadline, allow_time_for_failover);
+  MonoTime rpc_start = MonoTime::Now();
+  ts_->StartRpc();
+  proxy_->ScanAsync(next_req_, &last_response_, &controller_,
+                    [this, rpc_start, overall_deadline, rpc_deadline, cb]() {
+                      cb(FinishScanRpc(controller_.status(), rpc_start,
+                                       overall_deadline, rpc_deadline));
+                    });
+}
+
+MonoTime KuduScanner::Data::PrepareScanRpc(const MonoTime& overall_deadline,
+                                           bool allow_time_for_failover) {
   // The user has specified a timeout which should apply to the total time for each call
   // to NextBatch(). However, for fault-tolerant scans, or for when we are first opening
   // a scanner, it's preferable to set a shorter timeout (the "default RPC timeout") for
@@ -352,6 +531,9 @@ ScanRpcStatus KuduScanner::Data::SendScanRpc(const MonoTime& overall_deadline,
   if (configuration().row_format_flags() & KuduScanner::PAD_UNIXTIME_MICROS_TO_16_BYTES) {
     controller_.RequireServerFeature(TabletServerFeatures::PAD_UNIXTIME_MICROS_TO_16_BYTES);
   }
+  if (configuration().row_format_flags() & KuduScanner::COLUMNAR_LAYOUT) {
+    controller_.RequireServerFeature(TabletServerFeatures::COLUMNAR_LAYOUT_FEATURE);
+  }
   if (next_req_.has_new_scan_request()) {
     // Only new scan requests require authz tokens. Scan continuations rely on
     // Kudu's prevention of scanner hijacking by different users.
@@ -364,24 +546,137 @@ ScanRpcStatus KuduScanner::Data::SendScanRpc(const MonoTime& overall_deadline,
       VLOG(1) << "no authz token for table " << table_->id();
     }
   }
-  ScanRpcStatus scan_status = AnalyzeResponse(
-      proxy_->Scan(next_req_,
-                   &last_response_,
-                   &controller_),
-      rpc_deadline, overall_deadline);
+  return rpc_deadline;
+}
+
+ScanRpcStatus KuduScanner::Data::FinishScanRpc(const Status& rpc_status,
+                                               const MonoTime& rpc_start,
+                                               const MonoTime& overall_deadline,
+                                               const MonoTime& rpc_deadline) {
+  // Track the latency of the RPCs to the server, which the LOWEST_LATENCY
+  // replica selection is based on. An RPC which timed out counts as slow.
+  if (rpc_status.ok() || rpc_status.IsTimedOut()) {
+    MonoDelta latency = MonoTime::Now() - rpc_start;
+    ts_->FinishRpc(&latency);
+  } else {
+    ts_->FinishRpc(nullptr);
+  }
+  ScanRpcStatus scan_status = AnalyzeResponse(rpc_status, rpc_deadline, overall_deadline);
   if (scan_status.result == ScanRpcStatus::OK) {
     UpdateResourceMetrics();
-    num_rows_returned_ += last_response_.data().num_rows();
+    num_rows_returned_ += NumRowsInResponse(last_response_);
   }
   return scan_status;
 }
 
+bool KuduScanner::Data::TakePrefetchedResponse(const MonoTime& overall_deadline,
+                                               ScanRpcStatus* status) {
+  if (!prefetcher_ || !prefetcher_->active()) {
+    return false;
+  }
+  uint32_t call_seq_id;
+  MonoTime rpc_deadline;
+  Status rpc_status = prefetcher_->Take(&last_response_, &controller_,
+                                        &call_seq_id, &rpc_deadline);
+  DCHECK_EQ(next_req_.call_seq_id(), call_seq_id);
+  // The RPC's deadline was set when it was prefetched, so a timeout leaves
+  // time to retry it within this batch's deadline.
+  *status = AnalyzeResponse(rpc_status, overall_deadline, rpc_deadline);
+  if (status->result == ScanRpcStatus::OK) {
+    UpdateResourceMetrics();
+    num_rows_returned_ += NumRowsInResponse(last_response_);
+  }
+  return true;
+}
+
+Status KuduScanner::Data::ContinueScan(const MonoTime& batch_deadline,
+                                       const ScanRpcStatus* first_result,
+                                       bool* has_batch) {
+  *has_batch = false;
+  ScanRpcStatus result;
+  bool sent = false;
+  if (first_result) {
+    result = *first_result;
+    sent = true;
+  } else {
+    sent = TakePrefetchedResponse(batch_deadline, &result);
+  }
+  while (true) {
+    if (!sent) {
+      bool allow_time_for_failover = configuration_.is_fault_tolerant();
+      result = SendScanRpc(batch_deadline, allow_time_for_failover);
+    }
+    sent = false;
+
+    // Success case.
+    if (result.result == ScanRpcStatus::OK) {
+      if (last_response_.has_last_primary_key()) {
+        last_primary_key_ = last_response_.last_primary_key();
+      }
+      scan_attempts_ = 0;
+      MaybeStartPrefetching();
+      *has_batch = true;
+      return Status::OK();
+    }
+
+    scan_attempts_++;
+
+    // Error handling.
+    set<string> blacklist;
+    bool needs_reopen = false;
+    Status s = HandleError(result, batch_deadline, &blacklist, &needs_reopen);
+    if (!s.ok()) {
+      LOG(WARNING) << "Scan on tablet server " << ts_->ToString() << " with "
+                   << DebugString() << " failed: " << result.status.ToString();
+      return s;
+    }
+
+    if (configuration_.is_fault_tolerant()) {
+      LOG(WARNING) << "Attempting to retry " << DebugString() << " elsewhere.";
+      return ReopenCurrentTablet(batch_deadline, &blacklist);
+    }
+
+    if (blacklist.empty() && !needs_reopen) {
+      // If we didn't blacklist the current server, we can just retry again.
+      continue;
+    }
+    // If we blacklisted the current server, and it's not fault-tolerant, we can't
+    // retry anywhere, so just propagate the error.
+    return result.status;
+  }
+}
+
+void KuduScanner::Data::MaybeStartPrefetching() {
+  if (configuration_.prefetch_depth() == 0 || !last_response_.has_more_results()) {
+    return;
+  }
+  if (!prefetcher_) {
+    prefetcher_.reset(new ScanPrefetcher(configuration_.prefetch_depth(),
+                                         configuration_.prefetch_memory_limit_bytes()));
+  }
+  if (!prefetcher_->active()) {
+    prefetcher_->Start(proxy_, next_req_, configuration_.timeout());
+  }
+}
+
+void KuduScanner::Data::StopPrefetching() {
+  if (!prefetcher_) {
+    return;
+  }
+  uint32_t last_call_seq_id = prefetcher_->Stop();
+  prefetcher_.reset();
+  if (last_call_seq_id > next_req_.call_seq_id()) {
+    next_req_.set_call_seq_id(last_call_seq_id);
+  }
+}
+
 Status KuduScanner::Data::OpenTablet(const string& partition_key,
                                      const MonoTime& deadline,
                                      set<string>* blacklist) {
-
+  StopPrefetching();
   PrepareRequest(KuduScanner::Data::NEW);
   next_req_.clear_scanner_id();
+  next_req_.set_include_scan_profile(configuration_.scan_profile_enabled());
   NewScanRequestPB* scan = next_req_.mutable_new_scan_request();
   scan->set_row_format_flags(configuration_.row_format_flags());
   const KuduScanner::ReadMode read_mode = configuration_.read_mode();
@@ -543,7 +838,7 @@ Status KuduScanner::Data::OpenTablet(const string& partition_key,
   partition_pruner_.RemovePartitionKeyRange(remote_->partition().partition_key_end());
 
   next_req_.clear_new_scan_request();
-  data_in_open_ = last_response_.has_data() && last_response_.data().num_rows() > 0;
+  data_in_open_ = NumRowsInResponse(last_response_) > 0;
   if (last_response_.has_more_results()) {
     next_req_.set_scanner_id(last_response_.scanner_id());
     VLOG(2) << "Opened tablet " << remote_->tablet_id()
@@ -698,6 +993,128 @@ Status KuduScanBatch::Data::Reset(RpcController* controller,
                                  pad_unixtime_micros_to_16_bytes);
 }
 
+Status KuduScanBatch::Data::Reset(RpcController* controller,
+                                  const Schema* projection,
+                                  const KuduSchema* client_projection,
+                                  uint64_t row_format_flags,
+                                  ScanResponsePB* resp) {
+  if (!(row_format_flags & KuduScanner::COLUMNAR_LAYOUT)) {
+    return Reset(controller, projection, client_projection, row_format_flags,
+                 unique_ptr<RowwiseRowBlockPB>(resp->release_data()));
+  }
+  CHECK(controller->finished());
+  controller_.Swap(controller);
+  projection_ = projection;
+  projected_row_size_ = CalculateProjectedRowSize(*projection_);
+  client_projection_ = client_projection;
+  row_format_flags_ = row_format_flags;
+  columns_.clear();
+  if (!resp->has_columnar_data()) {
+    // No new data; just clear out the old stuff.
+    columnar_resp_data_.Clear();
+    return Status::OK();
+  }
+  columnar_resp_data_.Swap(resp->mutable_columnar_data());
+  resp->clear_columnar_data();
+
+  const int64_t num_rows = columnar_resp_data_.num_rows();
+  if (num_rows == 0 && columnar_resp_data_.columns_size() == 0) {
+    return Status::OK();
+  }
+  if (PREDICT_FALSE(columnar_resp_data_.columns_size() != projection_->num_columns())) {
+    return Status::Corruption(Substitute(
+        "Server sent invalid response: $0 columns of data for a projection of $1 columns",
+        columnar_resp_data_.columns_size(), projection_->num_columns()));
+  }
+
+  // Check the sizes of the sidecars up front, so that the accessors can hand
+  // them out as they are.
+  columns_.resize(projection_->num_columns());
+  for (int i = 0; i < projection_->num_columns(); i++) {
+    const ColumnSchema& col_schema = projection_->column(i);
+    const ColumnarRowBlockPB::Column& col_pb = columnar_resp_data_.columns(i);
+    ColumnarColumn* col = &columns_[i];
+    Status s = controller_.GetInboundSidecar(col_pb.data_sidecar(), &col->data);
+    if (!s.ok()) {
+      return Status::Corruption("Server sent invalid response: "
+          "column data sidecar index corrupt", s.ToString());
+    }
+    size_t expected_data_size;
+    if (col_schema.type_info()->physical_type() == BINARY) {
+      s = controller_.GetInboundSidecar(col_pb.varlen_data_sidecar(), &col->varlen_data);
+      if (!s.ok()) {
+        return Status::Corruption("Server sent invalid response: "
+            "column varlen data sidecar index corrupt", s.ToString());
+      }
+      expected_data_size = (num_rows + 1) * sizeof(uint32_t);
+    } else {
+      expected_data_size = num_rows * col_schema.type_info()->size();
+    }
+    if (PREDICT_FALSE(col->data.size() != expected_data_size)) {
+      return Status::Corruption(Substitute(
+          "Server sent invalid response: $0 bytes of data for column $1, expected $2",
+          col->data.size(), col_schema.name(), expected_data_size));
+    }
+    if (col_schema.is_nullable()) {
+      s = controller_.GetInboundSidecar(col_pb.non_null_bitmap_sidecar(), &col->non_null_bitmap);
+      if (!s.ok()) {
+        return Status::Corruption("Server sent invalid response: "
+            "column non-null bitmap sidecar index corrupt", s.ToString());
+      }
+      if (PREDICT_FALSE(col->non_null_bitmap.size() < BitmapSize(num_rows))) {
+        return Status::Corruption(Substitute(
+            "Server sent invalid response: non-null bitmap of column $0 too short",
+            col_schema.name()));
+      }
+    }
+  }
+  return Status::OK();
+}
+
+Status KuduScanBatch::Data::GetFixedLengthColumn(int idx, Slice* data) const {
+  RETURN_NOT_OK(CheckColumnarColumn(idx));
+  if (PREDICT_FALSE(projection_->column(idx).type_info()->physical_type() == BINARY)) {
+    return Status::InvalidArgument("column is of variable-length type",
+                                   projection_->column(idx).name());
+  }
+  *data = columns_.empty() ? Slice() : columns_[idx].data;
+  return Status::OK();
+}
+
+Status KuduScanBatch::Data::GetVariableLengthColumn(int idx, Slice* offsets, Slice* data) const {
+  RETURN_NOT_OK(CheckColumnarColumn(idx));
+  if (PREDICT_FALSE(projection_->column(idx).type_info()->physical_type() != BINARY)) {
+    return Status::InvalidArgument("column is of fixed-length type",
+                                   projection_->column(idx).name());
+  }
+  if (columns_.empty()) {
+    // An empty batch: the single offset of zero rows.
+    static const uint32_t kZeroOffset = 0;
+    *offsets = Slice(reinterpret_cast<const uint8_t*>(&kZeroOffset), sizeof(kZeroOffset));
+    *data = Slice();
+    return Status::OK();
+  }
+  *offsets = columns_[idx].data;
+  *data = columns_[idx].varlen_data;
+  return Status::OK();
+}
+
+Status KuduScanBatch::Data::GetNonNullBitmapForColumn(int idx, Slice* data) const {
+  RETURN_NOT_OK(CheckColumnarColumn(idx));
+  *data = columns_.empty() ? Slice() : columns_[idx].non_null_bitmap;
+  return Status::OK();
+}
+
+Status KuduScanBatch::Data::CheckColumnarColumn(int idx) const {
+  if (PREDICT_FALSE(!(row_format_flags_ & KuduScanner::COLUMNAR_LAYOUT))) {
+    return Status::IllegalState("batch was not scanned with the COLUMNAR_LAYOUT row format flag");
+  }
+  if (PREDICT_FALSE(projection_ == nullptr || idx < 0 || idx >= projection_->num_columns())) {
+    return Status::InvalidArgument(Substitute("invalid column index: $0", idx));
+  }
+  return Status::OK();
+}
+
 void KuduScanBatch::Data::ExtractRows(vector<KuduScanBatch::RowPtr>* rows) {
   DCHECK_EQ(row_format_flags_, KuduScanner::NO_FLAGS) << "Cannot extract rows. "
       << "Row format modifier flags were selected: " << row_format_flags_;
@@ -727,6 +1144,8 @@ void KuduScanBatch::Data::ExtractRows(vector<KuduScanBatch::RowPtr>* rows) {
 
 void KuduScanBatch::Data::Clear() {
   resp_data_.Clear();
+  columnar_resp_data_.Clear();
+  columns_.clear();
   controller_.Reset();
 }
 
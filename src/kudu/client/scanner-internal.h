@@ -19,6 +19,8 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <ostream>
 #include <set>
@@ -39,12 +41,14 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
 
-class MonoTime;
 class Schema;
 
 namespace tserver {
@@ -117,6 +121,95 @@ struct ScanRpcStatus {
   Status status;
 };
 
+// Sends the continuation RPCs of a tablet scan ahead of the calls to
+// KuduScanner::NextBatch(), so that the tablet server scans the next batches
+// while the application processes the current one.
+//
+// The scan protocol requires the continuations of a scanner to be sent in
+// order, so there's at most one RPC in flight: each response which has more
+// results triggers the next RPC, until 'depth' responses are buffered or
+// their data reaches 'memory_limit_bytes'. Taking a buffered response makes
+// room for more.
+//
+// Prefetching stops at the first failed RPC. Its response is returned like
+// the others, so that the caller can handle the error and retry it.
+class ScanPrefetcher {
+ public:
+  ScanPrefetcher(int depth, int64_t memory_limit_bytes);
+
+  // Waits for the RPC in flight, if any.
+  ~ScanPrefetcher();
+
+  // Starts prefetching the continuations of 'last_req', the last request
+  // sent for the scan, which must be inactive. Each RPC's deadline is
+  // 'timeout' after it is sent.
+  void Start(std::shared_ptr<tserver::TabletServerServiceProxy> proxy,
+             const tserver::ScanRequestPB& last_req,
+             const MonoDelta& timeout);
+
+  // Whether there are prefetched responses to take, possibly after waiting
+  // for an RPC in flight.
+  bool active() const;
+
+  // Waits for the first prefetched response, and swaps it and its
+  // controller into 'resp' and 'controller'. Sets 'call_seq_id' to the call
+  // sequence ID of its request, and 'rpc_deadline' to the deadline of its
+  // RPC. Returns the status of the RPC. The prefetcher must be active.
+  Status Take(tserver::ScanResponsePB* resp, rpc::RpcController* controller,
+              uint32_t* call_seq_id, MonoTime* rpc_deadline);
+
+  // Waits for the RPC in flight, if any, and drops the prefetched responses.
+  // Returns the call sequence ID of the last request sent.
+  uint32_t Stop();
+
+ private:
+  // A prefetched response, or the RPC in flight.
+  struct Response {
+    tserver::ScanResponsePB resp;
+    rpc::RpcController controller;
+    uint32_t call_seq_id;
+    MonoTime rpc_deadline;
+    // The size of the response's row data.
+    int64_t size_bytes;
+  };
+
+  // Prepares the next continuation RPC if the last response succeeded, has
+  // more results, and there's room for another response. If so, returns
+  // true and sets 'req' and 'response' to the arguments of SendRpc().
+  bool PrepareNextRpcUnlocked(tserver::ScanRequestPB* req, Response** response);
+
+  // Sends the RPC prepared by PrepareNextRpcUnlocked().
+  void SendRpc(const tserver::ScanRequestPB& req, Response* response);
+
+  // Buffers the response of the RPC in flight.
+  void RpcCallback();
+
+  const int depth_;
+  const int64_t memory_limit_bytes_;
+
+  std::shared_ptr<tserver::TabletServerServiceProxy> proxy_;
+  MonoDelta timeout_;
+
+  mutable Mutex lock_;
+  ConditionVariable cond_;
+
+  // The request of the last RPC sent.
+  tserver::ScanRequestPB last_req_;
+
+  // The RPC in flight, if any.
+  std::unique_ptr<Response> in_flight_;
+
+  // The prefetched responses, in order, and the size of their row data.
+  std::deque<std::unique_ptr<Response>> responses_;
+  int64_t buffered_bytes_;
+
+  // Whether more RPCs may be sent: false once the scan is stopped, or a
+  // response failed or has no more results.
+  bool may_send_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScanPrefetcher);
+};
+
 class KuduScanner::Data {
  public:
 
@@ -132,6 +225,41 @@ class KuduScanner::Data {
   // The RPC and TS proxy should already have been prepared in next_req_, proxy_, etc.
   ScanRpcStatus SendScanRpc(const MonoTime& overall_deadline, bool allow_time_for_failover);
 
+  // Like SendScanRpc(), but sends the RPC asynchronously and calls 'cb' with
+  // its status on a reactor thread.
+  void SendScanRpcAsync(const MonoTime& overall_deadline,
+                        bool allow_time_for_failover,
+                        std::function<void(const ScanRpcStatus&)> cb);
+
+  // Sends the continuation in next_req_ of the current tablet's scan, handling
+  // errors and retrying until it succeeds or the error isn't retriable. If
+  // 'first_result' isn't null, it's the result of the first attempt, which
+  // was already sent. Otherwise, a prefetched response may be taken.
+  //
+  // Sets 'has_batch' to true if last_response_ holds the next batch. An OK
+  // status without a batch means the tablet was reopened, in which case the
+  // next batch may be in the response of the new scan (see data_in_open_).
+  //
+  // This function may sleep, and reopen the tablet.
+  Status ContinueScan(const MonoTime& batch_deadline,
+                      const ScanRpcStatus* first_result,
+                      bool* has_batch);
+
+  // If the scan prefetches batches, sets 'status' to the result of the
+  // prefetched response for the request in next_req_ and returns true, as if
+  // SendScanRpc() was called. Returns false if there's no prefetched
+  // response, in which case SendScanRpc() must be called instead.
+  bool TakePrefetchedResponse(const MonoTime& overall_deadline, ScanRpcStatus* status);
+
+  // Starts prefetching the next batches of the current tablet, if the scan
+  // prefetches batches, the last response has more results and batches
+  // aren't already being prefetched.
+  void MaybeStartPrefetching();
+
+  // Stops prefetching batches, dropping the prefetched ones, and updates
+  // next_req_ so that the next request follows the last one sent.
+  void StopPrefetching();
+
   // Called when KuduScanner::NextBatch or KuduScanner::Data::OpenTablet result in an RPC or
   // server error.
   //
@@ -247,6 +375,10 @@ class KuduScanner::Data {
   // Number of rows already returned.
   int64_t num_rows_returned_;
 
+  // Sends the continuations of the current tablet's scan ahead of
+  // NextBatch(), if prefetching is enabled.
+  std::unique_ptr<ScanPrefetcher> prefetcher_;
+
   // The deprecated "NextBatch(vector<KuduRowResult>*) API requires some local
   // storage for the actual row data. If that API is used, this member keeps the
   // actual storage for the batch that is returned.
@@ -269,6 +401,17 @@ class KuduScanner::Data {
   std::string DebugString() const;
 
  private:
+  // Sets up controller_ for the RPC of next_req_, and returns its deadline.
+  // See SendScanRpc().
+  MonoTime PrepareScanRpc(const MonoTime& overall_deadline, bool allow_time_for_failover);
+
+  // Accounts for the Scan RPC started at 'rpc_start' with the deadline
+  // 'rpc_deadline', and analyzes its response.
+  ScanRpcStatus FinishScanRpc(const Status& rpc_status,
+                              const MonoTime& rpc_start,
+                              const MonoTime& overall_deadline,
+                              const MonoTime& rpc_deadline);
+
   // Analyze the response of the last Scan RPC made by this scanner.
   //
   // The error handling of a scan RPC is fairly complex, since we have to handle
@@ -305,10 +448,26 @@ class KuduScanBatch::Data {
                uint64_t row_format_flags,
                std::unique_ptr<RowwiseRowBlockPB> resp_data);
 
+  // Like the above, but takes the data of 'resp', in whichever layout it was
+  // returned.
+  Status Reset(rpc::RpcController* controller,
+               const Schema* projection,
+               const KuduSchema* client_projection,
+               uint64_t row_format_flags,
+               tserver::ScanResponsePB* resp);
+
   int num_rows() const {
+    if (row_format_flags_ & KuduScanner::COLUMNAR_LAYOUT) {
+      return columnar_resp_data_.num_rows();
+    }
     return resp_data_.num_rows();
   }
 
+  // See KuduScanBatch::GetFixedLengthColumn() and the methods below it.
+  Status GetFixedLengthColumn(int idx, Slice* data) const;
+  Status GetVariableLengthColumn(int idx, Slice* offsets, Slice* data) const;
+  Status GetNonNullBitmapForColumn(int idx, Slice* data) const;
+
   KuduRowResult row(int idx) {
     DCHECK_EQ(row_format_flags_, KuduScanner::NO_FLAGS)
         << "Cannot decode individual rows. Row format flags were set: "
@@ -341,6 +500,18 @@ class KuduScanBatch::Data {
   // by the members above.
   Slice direct_data_, indirect_data_;
 
+  // The PB describing the sidecars of the data, when scanning with the
+  // COLUMNAR_LAYOUT row format flag.
+  ColumnarRowBlockPB columnar_resp_data_;
+
+  // Slices into the sidecars of each projected column, in columnar layout.
+  struct ColumnarColumn {
+    Slice data;
+    Slice varlen_data;
+    Slice non_null_bitmap;
+  };
+  std::vector<ColumnarColumn> columns_;
+
   // The projection being scanned.
   const Schema* projection_;
   // The KuduSchema version of 'projection_'
@@ -352,6 +523,11 @@ class KuduScanBatch::Data {
 
   // The number of bytes of direct data for each row.
   size_t projected_row_size_;
+
+ private:
+  // Returns an error unless the batch is in columnar layout and 'idx' is the
+  // index of a projected column.
+  Status CheckColumnarColumn(int idx) const;
 };
 
 } // namespace client
@@ -116,6 +116,7 @@ class KUDU_EXPORT KuduColumnStorageAttributes {
     RLE = 4,
     DICT_ENCODING = 5,
     BIT_SHUFFLE = 6,
+    DELTA_BIT_PACKED = 7,
 
     /// @deprecated GROUP_VARINT is not supported for valid types, and
     /// will fall back to another encoding on the server side.
@@ -129,6 +130,7 @@ class KUDU_EXPORT KuduColumnStorageAttributes {
     SNAPPY = 2,
     LZ4 = 3,
     ZLIB = 4,
+    ZSTD = 5,
   };
 
 
@@ -613,6 +615,7 @@ class KUDU_EXPORT KuduSchema {
  private:
   friend class ClientTest;
   friend class KuduClient;
+  friend class KuduColumnarInserts;
   friend class KuduScanner;
   friend class KuduScanToken;
   friend class KuduScanTokenBuilder;
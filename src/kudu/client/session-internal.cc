@@ -17,6 +17,7 @@
 
 #include "kudu/client/session-internal.h"
 
+#include <algorithm>
 #include <memory>
 #include <mutex>
 #include <utility>
@@ -59,6 +60,8 @@ KuduSession::Data::Data(shared_ptr<KuduClient> client,
       messenger_(std::move(messenger)),
       error_collector_(new ErrorCollector()),
       external_consistency_mode_(CLIENT_PROPAGATED),
+      multi_tablet_writes_(false),
+      write_coalescing_(false),
       flush_interval_(MonoDelta::FromMilliseconds(1000)),
       flush_task_active_(false),
       flush_mode_(AUTO_FLUSH_SYNC),
@@ -68,6 +71,7 @@ KuduSession::Data::Data(shared_ptr<KuduClient> client,
       buffer_bytes_limit_(7 * 1024 * 1024),
       buffer_watermark_pct_(50),
       buffer_bytes_used_(0),
+      adaptive_watermark_(0),
       buffer_pre_flush_enabled_(true) {
 }
 
@@ -78,8 +82,12 @@ void KuduSession::Data::Init(weak_ptr<KuduSession> session) {
 
 void KuduSession::Data::FlushFinished(Batcher* batcher) {
   const int64_t bytes_flushed = batcher->buffer_bytes_used();
+  const MonoTime flush_start_time = batcher->flush_start_time();
   {
     std::lock_guard<Mutex> l(mutex_);
+    if (flush_target_latency_.Initialized() && flush_start_time.Initialized()) {
+      AdaptWatermarkUnlocked(MonoTime::Now() - flush_start_time, batcher->server_busy());
+    }
     buffer_bytes_used_ -= bytes_flushed;
     --batchers_num_;
     // The logic of KuduSession::ApplyWriteOp() needs to know
@@ -122,6 +130,26 @@ Status KuduSession::Data::SetExternalConsistencyMode(
   return Status::OK();
 }
 
+Status KuduSession::Data::SetMultiTabletWrites(bool enabled) {
+  std::lock_guard<Mutex> l(mutex_);
+  if (HasPendingOperationsUnlocked()) {
+    return Status::IllegalState(
+        "Cannot change multi-tablet writes when writes are buffered");
+  }
+  multi_tablet_writes_ = enabled;
+  return Status::OK();
+}
+
+Status KuduSession::Data::SetWriteCoalescing(bool enabled) {
+  std::lock_guard<Mutex> l(mutex_);
+  if (HasPendingOperationsUnlocked()) {
+    return Status::IllegalState(
+        "Cannot change write coalescing when writes are buffered");
+  }
+  write_coalescing_ = enabled;
+  return Status::OK();
+}
+
 Status KuduSession::Data::SetFlushMode(FlushMode mode) {
   {
     std::lock_guard<Mutex> l(mutex_);
@@ -202,6 +230,52 @@ Status KuduSession::Data::SetBufferFlushInterval(unsigned int millis) {
   return Status::OK();
 }
 
+Status KuduSession::Data::SetBufferFlushTargetLatency(unsigned int millis) {
+  std::lock_guard<Mutex> l(mutex_);
+  if (HasPendingOperationsUnlocked()) {
+    // NOTE: this is an artificial restriction.
+    return Status::IllegalState(
+        "Cannot change buffer flush target latency when writes are buffered.");
+  }
+  // Thread-safety note: the flush_target_latency_ and adaptive_watermark_ are
+  // accessed from the background flush thread and on completion of flushes,
+  // so they should be modified under protection.
+  flush_target_latency_ = millis == 0 ? MonoDelta() : MonoDelta::FromMilliseconds(millis);
+  adaptive_watermark_ = StaticWatermark();
+  return Status::OK();
+}
+
+int64_t KuduSession::Data::StaticWatermark() const {
+  return buffer_bytes_limit_ * buffer_watermark_pct_ / 100;
+}
+
+int64_t KuduSession::Data::FlushWatermarkUnlocked() const {
+  mutex_.AssertAcquired();
+  if (!flush_target_latency_.Initialized()) {
+    return StaticWatermark();
+  }
+  // The buffer limit and watermark may have been changed since the target
+  // latency was set.
+  return std::min(adaptive_watermark_, StaticWatermark());
+}
+
+void KuduSession::Data::AdaptWatermarkUnlocked(const MonoDelta& latency, bool server_busy) {
+  mutex_.AssertAcquired();
+  const int64_t max_watermark = StaticWatermark();
+  // Not std::max(), which would odr-use kWatermarkNonEmptyBatcher.
+  const int64_t min_watermark = max_watermark / 64 > kWatermarkNonEmptyBatcher ?
+      max_watermark / 64 : kWatermarkNonEmptyBatcher;
+  int64_t watermark = std::min(adaptive_watermark_, max_watermark);
+  if (server_busy || latency > flush_target_latency_) {
+    watermark /= 2;
+  } else {
+    watermark += std::max<int64_t>(1, max_watermark / 16);
+  }
+  adaptive_watermark_ = std::max(min_watermark, std::min(max_watermark, watermark));
+  VLOG(2) << "Flush took " << latency.ToString() << (server_busy ? " (server busy)" : "")
+          << ", flush watermark set to " << adaptive_watermark_ << " bytes";
+}
+
 Status KuduSession::Data::SetMaxBatchersNum(unsigned int max_num) {
   // 1 is the minimum possible number of batchers per session.
   // 0 means there isn't any limit on the maximum number of batchers.
@@ -443,6 +517,7 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
       FlushCurrentBatcher(max_size - required_size + 1, nullptr);
     }
   }
+  int64_t flush_watermark;
   {
     std::lock_guard<Mutex> l(mutex_);
     if (flush_mode == AUTO_FLUSH_BACKGROUND) {
@@ -481,6 +556,8 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
       if (timeout_.Initialized()) {
         batcher->SetTimeout(timeout_);
       }
+      batcher->SetMultiTabletWrites(multi_tablet_writes_);
+      batcher->SetWriteCoalescing(write_coalescing_);
       batcher.swap(batcher_);
       ++batchers_num_;
     }
@@ -492,11 +569,10 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
     }
     // Finally, update the buffer space usage.
     buffer_bytes_used_ += required_size;
+    flush_watermark = FlushWatermarkUnlocked();
   }
 
   if (flush_mode == AUTO_FLUSH_BACKGROUND) {
-    const size_t flush_watermark =
-        buffer_bytes_limit_ * buffer_watermark_pct_ / 100;
     // In AUTO_FLUSH_BACKGROUND mode it's necessary to flush the newly added
     // operations if the flush watermark is reached. The current batcher is
     // the exclusive and the only container for the newly added operations.
@@ -544,6 +620,12 @@ void KuduSession::Data::TimeBasedFlushTask(
       return;
     }
     max_batcher_age = data->flush_interval_;
+    // Operations shouldn't wait in the buffer for longer than a flush is
+    // targeted to take.
+    if (data->flush_target_latency_.Initialized() &&
+        data->flush_target_latency_ < max_batcher_age) {
+      max_batcher_age = data->flush_target_latency_;
+    }
   }
 
   // Let's measure the age of a batcher as the time elapsed from the moment
@@ -81,6 +81,13 @@ class KuduSession::Data {
   // Set external consistency mode for the session.
   Status SetExternalConsistencyMode(KuduSession::ExternalConsistencyMode m);
 
+  // Set whether to send writes in an RPC per tablet server.
+  Status SetMultiTabletWrites(bool enabled);
+
+  // Set whether to merge the UPSERT and UPDATE operations on the same row
+  // buffered in a batcher.
+  Status SetWriteCoalescing(bool enabled);
+
   // Set limit on buffer space consumed by buffered write operations.
   Status SetBufferBytesLimit(size_t size);
 
@@ -90,6 +97,10 @@ class KuduSession::Data {
   // Set the interval of the background max-wait flushing (in milliseconds).
   Status SetBufferFlushInterval(unsigned int period_ms);
 
+  // Set the target latency of flushes (in milliseconds) which the flush
+  // watermark is adapted to, or disable the adaptation if 0.
+  Status SetBufferFlushTargetLatency(unsigned int millis);
+
   // Set the limit on maximum number of batchers with pending operations.
   Status SetMaxBatchersNum(unsigned int period_ms);
 
@@ -184,6 +195,12 @@ class KuduSession::Data {
 
   kudu::client::KuduSession::ExternalConsistencyMode external_consistency_mode_;
 
+  // Whether batches are sent in an RPC per tablet server.
+  bool multi_tablet_writes_;
+
+  // Whether batchers merge the UPSERT and UPDATE operations on the same row.
+  bool write_coalescing_;
+
   // Timeout for the next batch.
   MonoDelta timeout_;
 
@@ -241,10 +258,35 @@ class KuduSession::Data {
   // The total number of bytes used by buffered write operations.
   int64_t buffer_bytes_used_;  // protected by mutex_
 
+  // The target latency of flushes in AUTO_FLUSH_BACKGROUND mode, or
+  // uninitialized if the flush watermark isn't adapted.
+  MonoDelta flush_target_latency_;  // protected by mutex_
+
+  // The flush watermark (in bytes) used instead of the one given by
+  // buffer_watermark_pct_, when flush_target_latency_ is initialized.
+  int64_t adaptive_watermark_;  // protected by mutex_
+
  private:
+  FRIEND_TEST(ClientTest, TestAdaptiveFlushWatermark);
   FRIEND_TEST(ClientTest, TestAutoFlushBackgroundApplyBlocks);
   FRIEND_TEST(ClientTest, TestAutoFlushBackgroundAndErrorCollector);
 
+  // Returns the flush watermark (in bytes) given by buffer_bytes_limit_ and
+  // buffer_watermark_pct_.
+  int64_t StaticWatermark() const;
+
+  // Returns the flush watermark (in bytes) of the AUTO_FLUSH_BACKGROUND mode.
+  int64_t FlushWatermarkUnlocked() const;
+
+  // Adapts adaptive_watermark_ to the outcome of a flush which took
+  // 'latency' to complete, and during which the tablet servers asked to
+  // back off if 'server_busy' is true.
+  //
+  // The watermark is halved if the flush took longer than the target latency
+  // or if a server was busy, and is otherwise increased by a sixteenth of the
+  // static watermark, which is its upper bound.
+  void AdaptWatermarkUnlocked(const MonoDelta& latency, bool server_busy);
+
   bool buffer_pre_flush_enabled_; // Set to 'false' only in test scenarios.
 
   DISALLOW_COPY_AND_ASSIGN(Data);
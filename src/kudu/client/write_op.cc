@@ -17,7 +17,11 @@
 
 #include "kudu/client/write_op.h"
 
+#include <cstring>
 #include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <glog/logging.h>
 
@@ -30,13 +34,17 @@
 #include "kudu/common/types.h"
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/bitmap.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/status.h"
 
 namespace kudu {
 namespace client {
 
 using sp::shared_ptr;
+using strings::Substitute;
 
 RowOperationsPB_Type ToInternalWriteType(KuduWriteOperation::Type type) {
   switch (type) {
@@ -69,6 +77,25 @@ EncodedKey* KuduWriteOperation::CreateKey() const {
   return key.release();
 }
 
+Status KuduWriteOperation::MergeFrom(const KuduWriteOperation& other) {
+  DCHECK_EQ(table_.get(), other.table_.get());
+  ConstContiguousRow other_row(other.row_.schema(), other.row_.row_data_);
+  const Schema* schema = other_row.schema();
+  for (int i = schema->num_key_columns(); i < schema->num_columns(); i++) {
+    if (!other.row_.IsColumnSet(i)) {
+      continue;
+    }
+    if (other.row_.IsNull(i)) {
+      RETURN_NOT_OK(row_.SetNull(i));
+    } else {
+      RETURN_NOT_OK(row_.Set(i, other_row.cell_ptr(i)));
+    }
+  }
+  // The row may have grown.
+  size_in_buffer_ = 0;
+  return Status::OK();
+}
+
 int64_t KuduWriteOperation::SizeInBuffer() const {
   if (size_in_buffer_ > 0) {
     // Once computed, the raw size of the operation is cached and returned
@@ -129,6 +156,150 @@ KuduUpsert::KuduUpsert(const shared_ptr<KuduTable>& table)
 
 KuduUpsert::~KuduUpsert() {}
 
+// ColumnarInserts --------------------------------------------------------------
+
+class KuduColumnarInserts::Data {
+ public:
+  // A column set by SetFixedLengthColumn() or SetVariableLengthColumn().
+  struct Column {
+    int col_idx;
+    // The size of a cell, for fixed-length columns.
+    size_t cell_size;
+    Slice data;
+    // Empty for fixed-length columns.
+    Slice offsets;
+    Slice non_null_bitmap;
+  };
+
+  Data(shared_ptr<KuduTable> table, const Schema* schema, int num_rows)
+      : table_(std::move(table)),
+        schema_(schema),
+        num_rows_(num_rows) {
+  }
+
+  // Checks that the column can be set as a column of fixed- or variable-length
+  // type, with the given non-NULL bitmap.
+  Status CheckColumn(int col_idx, bool var_len, const Slice& non_null_bitmap) const {
+    if (PREDICT_FALSE(col_idx < 0 || col_idx >= schema_->num_columns())) {
+      return Status::InvalidArgument("column index out of bounds", std::to_string(col_idx));
+    }
+    const ColumnSchema& col = schema_->column(col_idx);
+    if (PREDICT_FALSE((col.type_info()->physical_type() == BINARY) != var_len)) {
+      return Status::InvalidArgument(
+          Substitute("column $0 is not of $1-length type",
+                     col.name(), var_len ? "variable" : "fixed"));
+    }
+    if (!non_null_bitmap.empty()) {
+      if (PREDICT_FALSE(!col.is_nullable())) {
+        return Status::InvalidArgument("non-NULL bitmap given for a column which isn't nullable",
+                                       col.name());
+      }
+      if (PREDICT_FALSE(non_null_bitmap.size() != BitmapSize(num_rows_))) {
+        return Status::InvalidArgument(
+            Substitute("non-NULL bitmap of column $0 has $1 bytes, expected $2",
+                       col.name(), non_null_bitmap.size(), BitmapSize(num_rows_)));
+      }
+    }
+    return Status::OK();
+  }
+
+  // Adds 'col', replacing the column of the same index if it was already set.
+  void AddColumn(const Column& col) {
+    for (Column& c : columns_) {
+      if (c.col_idx == col.col_idx) {
+        c = col;
+        return;
+      }
+    }
+    columns_.push_back(col);
+  }
+
+  const shared_ptr<KuduTable> table_;
+  const Schema* const schema_;
+  const int num_rows_;
+  std::vector<Column> columns_;
+};
+
+KuduColumnarInserts::KuduColumnarInserts(const shared_ptr<KuduTable>& table, int num_rows)
+    : data_(new Data(table, table->schema().schema_, num_rows)) {
+  CHECK_GE(num_rows, 0);
+}
+
+KuduColumnarInserts::~KuduColumnarInserts() {
+  delete data_;
+}
+
+int KuduColumnarInserts::num_rows() const {
+  return data_->num_rows_;
+}
+
+Status KuduColumnarInserts::SetFixedLengthColumn(int col_idx, const Slice& data,
+                                                 const Slice& non_null_bitmap) {
+  RETURN_NOT_OK(data_->CheckColumn(col_idx, false, non_null_bitmap));
+  const ColumnSchema& col = data_->schema_->column(col_idx);
+  size_t cell_size = col.type_info()->size();
+  if (PREDICT_FALSE(data.size() != cell_size * data_->num_rows_)) {
+    return Status::InvalidArgument(
+        Substitute("data of column $0 has $1 bytes, expected $2",
+                   col.name(), data.size(), cell_size * data_->num_rows_));
+  }
+  data_->AddColumn({ col_idx, cell_size, data, Slice(), non_null_bitmap });
+  return Status::OK();
+}
+
+Status KuduColumnarInserts::SetVariableLengthColumn(int col_idx, const Slice& offsets,
+                                                    const Slice& data,
+                                                    const Slice& non_null_bitmap) {
+  RETURN_NOT_OK(data_->CheckColumn(col_idx, true, non_null_bitmap));
+  const ColumnSchema& col = data_->schema_->column(col_idx);
+  const int num_rows = data_->num_rows_;
+  if (PREDICT_FALSE(offsets.size() != sizeof(uint32_t) * (num_rows + 1))) {
+    return Status::InvalidArgument(
+        Substitute("offsets of column $0 have $1 bytes, expected $2",
+                   col.name(), offsets.size(), sizeof(uint32_t) * (num_rows + 1)));
+  }
+  uint32_t prev = UNALIGNED_LOAD32(offsets.data());
+  for (int i = 1; i <= num_rows; i++) {
+    uint32_t offset = UNALIGNED_LOAD32(offsets.data() + i * sizeof(uint32_t));
+    if (PREDICT_FALSE(offset < prev || offset > data.size())) {
+      return Status::InvalidArgument(
+          Substitute("offset $0 of column $1 is out of bounds", i, col.name()));
+    }
+    prev = offset;
+  }
+  data_->AddColumn({ col_idx, 0, data, offsets, non_null_bitmap });
+  return Status::OK();
+}
+
+KuduInsert* KuduColumnarInserts::NewInsert(int row_idx) const {
+  DCHECK_LT(row_idx, data_->num_rows_);
+  KuduInsert* insert = data_->table_->NewInsert();
+  KuduPartialRow* row = insert->mutable_row();
+  const Schema* schema = row->schema();
+  ContiguousRow dst_row(schema, row->row_data_);
+  for (const Data::Column& col : data_->columns_) {
+    BitmapSet(row->isset_bitmap_, col.col_idx);
+    bool is_null = !col.non_null_bitmap.empty() &&
+        !BitmapTest(col.non_null_bitmap.data(), row_idx);
+    if (schema->column(col.col_idx).is_nullable()) {
+      dst_row.set_null(col.col_idx, is_null);
+    }
+    if (is_null) {
+      continue;
+    }
+    uint8_t* dst = dst_row.mutable_cell_ptr(col.col_idx);
+    if (col.offsets.empty()) {
+      memcpy(dst, col.data.data() + row_idx * col.cell_size, col.cell_size);
+    } else {
+      const uint8_t* offsets = col.offsets.data() + row_idx * sizeof(uint32_t);
+      uint32_t start = UNALIGNED_LOAD32(offsets);
+      uint32_t end = UNALIGNED_LOAD32(offsets + sizeof(uint32_t));
+      *reinterpret_cast<Slice*>(dst) = Slice(col.data.data() + start, end - start);
+    }
+  }
+  return insert;
+}
+
 
 } // namespace client
 } // namespace kudu
@@ -124,6 +124,10 @@ class KUDU_EXPORT KuduWriteOperation {
 
   const KuduTable* table() const { return table_.get(); }
 
+  // Overwrite the non-key cells of this operation's row with those set in
+  // 'other', which must be on the same table and row.
+  Status MergeFrom(const KuduWriteOperation& other);
+
   // Return the number of bytes required to buffer this operation,
   // including direct and indirect data. Once called, the result is cached
   // so subsequent calls will return the size previously computed.
@@ -240,6 +244,91 @@ class KUDU_EXPORT KuduDelete : public KuduWriteOperation {
   explicit KuduDelete(const sp::shared_ptr<KuduTable>& table);
 };
 
+/// @brief A batch of rows to insert, given in columnar form.
+///
+/// The cells of each column are given with the layout of the columnar
+/// accessors of KuduScanBatch, so the batches of a scan with the
+/// KuduScanner::COLUMNAR_LAYOUT row format flag can be inserted as is.
+/// Columns which aren't set take their default value, as with the columns
+/// of a KuduInsert which aren't set.
+///
+/// The data of the columns is not copied: it must remain valid until the
+/// rows have been flushed by the session they were applied to.
+///
+/// Typical usage example:
+/// @code
+///   KuduColumnarInserts inserts(table, num_rows);
+///   KUDU_CHECK_OK(inserts.SetFixedLengthColumn(0, Slice(keys, num_rows * 4)));
+///   KUDU_CHECK_OK(inserts.SetVariableLengthColumn(
+///       1, Slice(offsets, (num_rows + 1) * 4), Slice(values, values_size)));
+///   KUDU_CHECK_OK(session->ApplyColumnarInserts(inserts, NULL));
+/// @endcode
+class KUDU_EXPORT KuduColumnarInserts {
+ public:
+  /// Create a batch of rows to insert into a table.
+  ///
+  /// @param [in] table
+  ///   The table to insert the rows into.
+  /// @param [in] num_rows
+  ///   The number of rows in the batch.
+  KuduColumnarInserts(const sp::shared_ptr<KuduTable>& table, int num_rows);
+
+  ~KuduColumnarInserts();
+
+  /// @return The number of rows in the batch.
+  int num_rows() const;
+
+  /// Set the cells of a column of fixed-length type.
+  ///
+  /// @param [in] col_idx
+  ///   The index of the column in the table schema.
+  /// @param [in] data
+  ///   The cells of the num_rows() rows, stored contiguously in the in-memory
+  ///   format of their type. The cells of NULL values are ignored.
+  /// @param [in] non_null_bitmap
+  ///   A bitmap with a bit set for every row whose cell isn't NULL, the bit
+  ///   of row 'i' being bit (i % 8) of byte (i / 8), or an empty Slice if no
+  ///   cell is NULL. May only be non-empty for nullable columns.
+  /// @return Operation result status. Returns InvalidArgument if the index
+  ///   is out of bounds, the column is of variable-length type, or the size
+  ///   of one of the Slices doesn't match the number of rows.
+  Status SetFixedLengthColumn(int col_idx, const Slice& data,
+                              const Slice& non_null_bitmap = Slice())
+      WARN_UNUSED_RESULT;
+
+  /// Set the cells of a STRING or BINARY column.
+  ///
+  /// @param [in] col_idx
+  ///   The index of the column in the table schema.
+  /// @param [in] offsets
+  ///   num_rows() + 1 little-endian uint32_t offsets into 'data': the value
+  ///   of row 'i' spans the bytes [offsets[i], offsets[i + 1]) of 'data'.
+  /// @param [in] data
+  ///   The concatenated values of the column.
+  /// @param [in] non_null_bitmap
+  ///   The non-NULL bitmap of the column, as for SetFixedLengthColumn().
+  /// @return Operation result status. Returns InvalidArgument if the index
+  ///   is out of bounds, the column is of fixed-length type, the size of one
+  ///   of the Slices doesn't match the number of rows, or the offsets are
+  ///   out of the bounds of 'data'.
+  Status SetVariableLengthColumn(int col_idx, const Slice& offsets, const Slice& data,
+                                 const Slice& non_null_bitmap = Slice())
+      WARN_UNUSED_RESULT;
+
+ private:
+  class KUDU_NO_EXPORT Data;
+
+  friend class KuduSession;
+
+  // Creates the insert of the row of index 'row_idx', setting the cells of
+  // its row without the checks of the KuduPartialRow setters.
+  KuduInsert* NewInsert(int row_idx) const;
+
+  Data* data_; // Owned.
+
+  DISALLOW_COPY_AND_ASSIGN(KuduColumnarInserts);
+};
+
 } // namespace client
 } // namespace kudu
 
@@ -44,6 +44,7 @@
 
 
 DECLARE_bool(inject_unsync_time_errors);
+DECLARE_int32(ntp_error_refresh_interval_ms);
 DECLARE_string(time_source);
 
 using std::string;
@@ -351,6 +352,28 @@ TEST_F(HybridClockTest, TestRideOverNtpInterruption) {
 }
 
 #ifndef __APPLE__
+// Test that between the reads of the error bound from the kernel, the time
+// source extrapolates the error bound from the last read.
+TEST_F(HybridClockTest, TestCachedNtpError) {
+  FLAGS_ntp_error_refresh_interval_ms = 60 * 1000;
+  TimeService* time_service = clock_->time_service();
+  uint64_t now_usec[2];
+  uint64_t error_usec[2];
+
+  // The first read refreshes the error bound, and sleeping guarantees that
+  // the second one grows it.
+  ASSERT_OK(time_service->WalltimeWithError(&now_usec[0], &error_usec[0]));
+  SleepFor(MonoDelta::FromMilliseconds(10));
+  ASSERT_OK(time_service->WalltimeWithError(&now_usec[1], &error_usec[1]));
+  ASSERT_GE(now_usec[1], now_usec[0] + 10 * 1000);
+  ASSERT_GE(error_usec[1], error_usec[0] + time_service->skew_ppm());
+
+  // Injected errors are visible right away.
+  FLAGS_inject_unsync_time_errors = true;
+  Status s = time_service->WalltimeWithError(&now_usec[1], &error_usec[1]);
+  ASSERT_TRUE(s.IsServiceUnavailable()) << s.ToString();
+}
+
 TEST_F(HybridClockTest, TestNtpDiagnostics) {
   vector<string> log;
   clock_->time_service()->DumpDiagnostics(&log);
@@ -136,8 +136,6 @@ Status HybridClock::Init() {
 Timestamp HybridClock::Now() {
   Timestamp now;
   uint64_t error;
-
-  std::lock_guard<simple_spinlock> lock(lock_);
   NowWithError(&now, &error);
   return now;
 }
@@ -145,11 +143,7 @@ Timestamp HybridClock::Now() {
 Timestamp HybridClock::NowLatest() {
   Timestamp now;
   uint64_t error;
-
-  {
-    std::lock_guard<simple_spinlock> lock(lock_);
-    NowWithError(&now, &error);
-  }
+  NowWithError(&now, &error);
 
   uint64_t now_latest = GetPhysicalValueMicros(now) + error;
   uint64_t now_logical = GetLogicalValue(now);
@@ -174,11 +168,18 @@ void HybridClock::NowWithError(Timestamp* timestamp, uint64_t* max_error_usec) {
   WalltimeWithErrorOrDie(&now_usec, &error_usec);
 
   // If the physical time from the system clock is higher than our last-returned
-  // time, we should use the physical timestamp.
-  uint64_t candidate_phys_timestamp = now_usec << kBitsToShift;
-  if (PREDICT_TRUE(candidate_phys_timestamp > next_timestamp_)) {
-    next_timestamp_ = candidate_phys_timestamp;
-    *timestamp = Timestamp(next_timestamp_++);
+  // time, we should use the physical timestamp. Otherwise, we increment the
+  // logical value of the last-returned one. Either way, the timestamp is taken
+  // by a compare-and-swap, so that concurrent callers never get the same one.
+  const uint64_t candidate_phys_timestamp = now_usec << kBitsToShift;
+  uint64_t next = next_timestamp_.load();
+  uint64_t ts;
+  do {
+    ts = std::max(next, candidate_phys_timestamp);
+  } while (!next_timestamp_.compare_exchange_weak(next, ts + 1));
+
+  if (PREDICT_TRUE(ts == candidate_phys_timestamp)) {
+    *timestamp = Timestamp(ts);
     *max_error_usec = error_usec;
     VLOG(2) << Substitute("Current clock is higher than the last one. "
                           "Resetting logical values. Physical Value: $0 usec "
@@ -205,8 +206,8 @@ void HybridClock::NowWithError(Timestamp* timestamp, uint64_t* max_error_usec) {
   // This broadens the error interval for both cases but always returns
   // a correct error interval.
 
-  *max_error_usec = (next_timestamp_ >> kBitsToShift) - (now_usec - error_usec);
-  *timestamp = Timestamp(next_timestamp_++);
+  *max_error_usec = (ts >> kBitsToShift) - (now_usec - error_usec);
+  *timestamp = Timestamp(ts);
   VLOG(2) << Substitute("Current clock is lower than the last one. Returning "
                         "last read and incrementing logical values. "
                         "Clock: $0 Error: $1",
@@ -214,7 +215,6 @@ void HybridClock::NowWithError(Timestamp* timestamp, uint64_t* max_error_usec) {
 }
 
 Status HybridClock::Update(const Timestamp& to_update) {
-  std::lock_guard<simple_spinlock> lock(lock_);
   Timestamp now;
   uint64_t error_ignored;
   NowWithError(&now, &error_ignored);
@@ -236,8 +236,11 @@ Status HybridClock::Update(const Timestamp& to_update) {
   }
 
   // Our next timestamp must be higher than the one that we are updating
-  // from.
-  next_timestamp_ = to_update.value() + 1;
+  // from. Concurrent calls may have already moved it further.
+  uint64_t next = next_timestamp_.load();
+  while (next <= to_update.value() &&
+         !next_timestamp_.compare_exchange_weak(next, to_update.value() + 1)) {
+  }
   return Status::OK();
 }
 
@@ -259,10 +262,7 @@ Status HybridClock::WaitUntilAfter(const Timestamp& then,
   TRACE_EVENT0("clock", "HybridClock::WaitUntilAfter");
   Timestamp now;
   uint64_t error;
-  {
-    std::lock_guard<simple_spinlock> lock(lock_);
-    NowWithError(&now, &error);
-  }
+  NowWithError(&now, &error);
 
   // "unshift" the timestamps so that we can measure actual time
   uint64_t now_usec = GetPhysicalValueMicros(now);
@@ -300,10 +300,7 @@ Status HybridClock::WaitUntilAfterLocally(const Timestamp& then,
                                           const MonoTime& deadline) {
   Timestamp now;
   uint64_t error;
-  {
-    std::lock_guard<simple_spinlock> lock(lock_);
-    NowWithError(&now, &error);
-  }
+  NowWithError(&now, &error);
   if (now > then) {
     return Status::OK();
   }
@@ -324,11 +321,7 @@ bool HybridClock::IsAfter(Timestamp t) {
   uint64_t error_usec;
   WalltimeWithErrorOrDie(&now_usec, &error_usec);
 
-  Timestamp now;
-  {
-    std::lock_guard<simple_spinlock> lock(lock_);
-    now = Timestamp(std::max(next_timestamp_, now_usec << kBitsToShift));
-  }
+  Timestamp now(std::max(next_timestamp_.load(), now_usec << kBitsToShift));
   return t.value() < now.value();
 }
 
@@ -370,9 +363,12 @@ Status HybridClock::WalltimeWithError(uint64_t* now_usec, uint64_t* error_usec)
     MonoTime read_time_max_likelihood = read_time_before +
         MonoDelta::FromMicroseconds(read_time_error_us);
 
-    std::unique_lock<simple_spinlock> l(last_clock_read_lock_);
-    if (!last_clock_read_time_.Initialized() ||
-        last_clock_read_time_ < read_time_max_likelihood) {
+    // If another thread is already recording its own read, which is about as
+    // recent, skip recording this one rather than waiting for the lock.
+    std::unique_lock<simple_spinlock> l(last_clock_read_lock_, std::try_to_lock);
+    if (l.owns_lock() &&
+        (!last_clock_read_time_.Initialized() ||
+         last_clock_read_time_ < read_time_max_likelihood)) {
       last_clock_read_time_ = read_time_max_likelihood;
       last_clock_read_physical_ = *now_usec;
       last_clock_read_error_ = *error_usec + read_time_error_us;
@@ -418,8 +414,6 @@ uint64_t HybridClock::NowForMetrics() {
 uint64_t HybridClock::ErrorForMetrics() {
   Timestamp now;
   uint64_t error;
-
-  std::lock_guard<simple_spinlock> lock(lock_);
   NowWithError(&now, &error);
   return error;
 }
@@ -16,6 +16,8 @@
 // under the License.
 #pragma once
 
+#include <cstdint>
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -124,6 +126,8 @@ class HybridClock : public Clock {
   // error in micros. This may fail if the clock is unsynchronized or synchronized
   // but the error is too high and, since we can't do anything about it,
   // LOG(FATAL)'s in that case.
+  //
+  // Doesn't take any lock: the timestamps are handed out by compare-and-swap.
   void NowWithError(Timestamp* timestamp, uint64_t* max_error_usec);
 
   virtual std::string Stringify(Timestamp timestamp) OVERRIDE;
@@ -179,11 +183,9 @@ class HybridClock : public Clock {
   // service.
   std::unique_ptr<clock::TimeService> time_service_;
 
-  mutable simple_spinlock lock_;
-
   // The next timestamp to be generated from this clock, assuming that
   // the physical clock hasn't advanced beyond the value stored here.
-  uint64_t next_timestamp_;
+  std::atomic<uint64_t> next_timestamp_;
 
   // The last valid clock reading we got from the time source, along
   // with the monotime that we took that reading.
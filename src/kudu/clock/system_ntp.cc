@@ -19,7 +19,9 @@
 
 #include <sys/time.h>
 #include <sys/timex.h>
+#include <time.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <ostream>
 #include <string>
@@ -30,6 +32,7 @@
 #include <glog/logging.h>
 
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/walltime.h"
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/errno.h"
@@ -49,6 +52,17 @@ DEFINE_int32(ntp_initial_sync_wait_secs, 60,
 TAG_FLAG(ntp_initial_sync_wait_secs, evolving);
 TAG_FLAG(ntp_initial_sync_wait_secs, advanced);
 
+DEFINE_int32(ntp_error_refresh_interval_ms, 100,
+             "Interval in milliseconds between the reads of the clock error "
+             "bound from the kernel with ntp_adjtime(). In between, the time "
+             "is read with clock_gettime(), which doesn't enter the kernel, "
+             "and the error bound is extrapolated from the last read at the "
+             "clock's maximum skew rate. Zero reads the error bound on every "
+             "clock read.");
+TAG_FLAG(ntp_error_refresh_interval_ms, advanced);
+TAG_FLAG(ntp_error_refresh_interval_ms, experimental);
+TAG_FLAG(ntp_error_refresh_interval_ms, runtime);
+
 using std::string;
 using std::vector;
 using strings::Substitute;
@@ -206,9 +220,30 @@ Status SystemNtp::Init() {
 
 Status SystemNtp::WalltimeWithError(uint64_t *now_usec,
                                     uint64_t *error_usec) {
+  const int64_t skew_ppm = skew_ppm_;
+  const int64_t now_mono_usec = GetMonoTimeMicros();
+  if (PREDICT_TRUE(now_mono_usec <
+                   error_refresh_deadline_usec_.load(std::memory_order_acquire)) &&
+      PREDICT_TRUE(!FLAGS_inject_unsync_time_errors)) {
+    // Read the time through the vDSO, and extrapolate the error from the last
+    // ntp_adjtime() call. The kernel grows its own error bound at the skew
+    // rate too, but by steps once a second, hence the extra second of skew.
+    timespec ts;
+    PCHECK(clock_gettime(CLOCK_REALTIME, &ts) == 0);
+    *now_usec = ts.tv_sec * kMicrosPerSec + ts.tv_nsec / 1000;
+    *error_usec = std::max<int64_t>(
+        0, error_base_usec_.load(std::memory_order_relaxed) +
+           now_mono_usec * skew_ppm / static_cast<int64_t>(kMicrosPerSec) + skew_ppm);
+    return Status::OK();
+  }
+
   // Read the time. This will return an error if the clock is not synchronized.
   timex tx;
-  RETURN_NOT_OK(CallAdjTime(&tx));
+  Status s = CallAdjTime(&tx);
+  if (PREDICT_FALSE(!s.ok())) {
+    error_refresh_deadline_usec_.store(0, std::memory_order_release);
+    return s;
+  }
 
   if (tx.status & STA_NANO) {
     tx.time.tv_usec /= 1000;
@@ -217,6 +252,17 @@ Status SystemNtp::WalltimeWithError(uint64_t *now_usec,
 
   *now_usec = tx.time.tv_sec * kMicrosPerSec + tx.time.tv_usec;
   *error_usec = tx.maxerror;
+
+  const int32_t refresh_interval_ms = FLAGS_ntp_error_refresh_interval_ms;
+  if (refresh_interval_ms > 0) {
+    // 'now_mono_usec' was read before ntp_adjtime(), which only makes the
+    // extrapolated error larger.
+    error_base_usec_.store(
+        tx.maxerror - now_mono_usec * skew_ppm / static_cast<int64_t>(kMicrosPerSec),
+        std::memory_order_relaxed);
+    error_refresh_deadline_usec_.store(now_mono_usec + refresh_interval_ms * 1000L,
+                                       std::memory_order_release);
+  }
   return Status::OK();
 }
 
@@ -16,6 +16,7 @@
 // under the License.
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -59,6 +60,17 @@ class SystemNtp : public TimeService {
   // The skew rate in PPM reported by the kernel.
   uint64_t skew_ppm_ = 0;
 
+  // The kernel's maximum error as of the last ntp_adjtime() call,
+  // extrapolated back to monotonic time zero at 'skew_ppm_'. The maximum error
+  // at monotonic time T is then 'error_base_usec_' + T * 'skew_ppm_' / 10^6,
+  // which a single atomic is enough to publish.
+  std::atomic<int64_t> error_base_usec_ { 0 };
+
+  // The monotonic time in microseconds until which the error is extrapolated
+  // from 'error_base_usec_' rather than read with ntp_adjtime(). Zero while
+  // there is no valid reading.
+  std::atomic<int64_t> error_refresh_deadline_usec_ { 0 };
+
   DISALLOW_COPY_AND_ASSIGN(SystemNtp);
 };
 
@@ -18,6 +18,8 @@
 #ifndef KUDU_CODEGEN_CODE_GENERATOR_H
 #define KUDU_CODEGEN_CODE_GENERATOR_H
 
+#include <vector>
+
 #include "kudu/gutil/macros.h"
 #include "kudu/util/status.h"
 
@@ -30,7 +32,10 @@ class Schema;
 
 namespace codegen {
 
+class KeyEncoderFunctions;
+class PredicateEvaluatorFunctions;
 class RowProjectorFunctions;
+struct PredicateShape;
 
 // CodeGenerator is a top-level class that manages a per-module
 // LLVM context, ExecutionEngine initialization, native target loading,
@@ -67,6 +72,19 @@ class CodeGenerator {
   Status CompileRowProjector(const Schema& base, const Schema& proj,
                              scoped_refptr<RowProjectorFunctions>* out);
 
+  // Attempts to initialize the function evaluating predicates of the
+  // parameter shapes on row blocks of the parameter projection by compiling
+  // code for them. Writes to 'out' upon success.
+  Status CompilePredicateEvaluator(const Schema& projection,
+                                   const std::vector<PredicateShape>& shapes,
+                                   scoped_refptr<PredicateEvaluatorFunctions>* out);
+
+  // Attempts to initialize the function encoding the primary keys of rows
+  // of the parameter schema by compiling code for its key columns.
+  // Writes to 'out' upon success.
+  Status CompileKeyEncoder(const Schema& schema,
+                           scoped_refptr<KeyEncoderFunctions>* out);
+
  private:
   static void GlobalInit();
 
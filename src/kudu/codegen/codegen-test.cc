@@ -30,7 +30,11 @@
 
 #include "kudu/codegen/code_generator.h"
 #include "kudu/codegen/compilation_manager.h"
+#include "kudu/codegen/key_encoder.h"
+#include "kudu/codegen/predicate_evaluator.h"
 #include "kudu/codegen/row_projector.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/row.h"
 #include "kudu/common/rowblock.h"
@@ -38,6 +42,7 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/singleton.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/logging_test_util.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/random.h"
@@ -424,4 +429,139 @@ TEST_F(CodegenTest, TestCodeCache) {
   }
 }
 
+// Test that warming up the compilation manager for a schema compiles the
+// code requested by the first scans and writes of its tablets.
+TEST_F(CodegenTest, TestWarmUp) {
+  Singleton<CompilationManager>::UnsafeReset();
+  CompilationManager* cm = CompilationManager::GetSingleton();
+  cm->WarmUp(base_);
+  cm->Wait();
+
+  gscoped_ptr<CodegenRP> projector;
+  ASSERT_TRUE(cm->RequestRowProjector(&base_, &base_, &projector));
+  Schema key_projection = base_.CreateKeyProjection();
+  ASSERT_TRUE(cm->RequestRowProjector(&base_, &key_projection, &projector));
+  scoped_refptr<codegen::KeyEncoderFunctions> key_encoder;
+  ASSERT_TRUE(cm->RequestKeyEncoder(base_, &key_encoder));
+}
+
+// Test that the codegenned predicate evaluation selects the same rows as
+// evaluating each predicate with ColumnPredicate::Evaluate().
+TEST_F(CodegenTest, TestPredicateEvaluation) {
+  Schema projection;
+  vector<size_t> part_cols = { kKeyCol, kI32Col, kI32NullValCol };
+  ASSERT_OK(CreatePartialSchema(part_cols, &projection));
+  const ColumnSchema& key_col = projection.column(0);
+  const ColumnSchema& i32_col = projection.column(1);
+  const ColumnSchema& i32_null_col = projection.column(2);
+
+  // Fill a block with small random values, so that the predicates match
+  // some of the rows, and leave random rows unselected.
+  const int kNumRows = 1000;
+  Random rng(SeedRandom());
+  Arena arena(1024);
+  RowBlock block(projection, kNumRows, &arena);
+  ColumnBlock keys = block.column_block(0);
+  ColumnBlock i32s = block.column_block(1);
+  ColumnBlock i32_nulls = block.column_block(2);
+  vector<bool> unselected(kNumRows);
+  for (int i = 0; i < kNumRows; i++) {
+    uint64_t key = i;
+    int32_t val = static_cast<int32_t>(rng.Uniform(200)) - 100;
+    keys.SetCellValue(i, &key);
+    i32s.SetCellValue(i, &val);
+    i32_nulls.SetCellIsNull(i, rng.OneIn(4));
+    i32_nulls.SetCellValue(i, &val);
+    unselected[i] = rng.OneIn(8);
+  }
+  auto reset_selection = [&](SelectionVector* sel) {
+    sel->SetAllTrue();
+    for (int i = 0; i < kNumRows; i++) {
+      if (unselected[i]) {
+        sel->SetRowUnselected(i);
+      }
+    }
+  };
+
+  const uint64_t kKeyLower = 100;
+  const uint64_t kKeyUpper = 600;
+  const int32_t kValue = -10;
+  const int32_t kUpper = 50;
+  const vector<vector<ColumnPredicate>> predicate_sets = {
+    { ColumnPredicate::Range(key_col, &kKeyLower, &kKeyUpper) },
+    { ColumnPredicate::Range(key_col, nullptr, &kKeyUpper),
+      ColumnPredicate::Equality(i32_col, &kValue) },
+    { ColumnPredicate::Range(i32_col, &kValue, &kUpper),
+      ColumnPredicate::Range(i32_null_col, &kValue, nullptr) },
+    { ColumnPredicate::IsNull(i32_null_col) },
+    { ColumnPredicate::IsNotNull(i32_null_col),
+      ColumnPredicate::Range(key_col, &kKeyLower, nullptr) },
+    { ColumnPredicate::None(i32_col) },
+  };
+  codegen::CodeGenerator generator;
+  for (const auto& predicates : predicate_sets) {
+    SelectionVector expected(kNumRows);
+    reset_selection(&expected);
+    for (const auto& pred : predicates) {
+      SCOPED_TRACE(pred.ToString());
+      pred.Evaluate(block.column_block(projection.find_column(pred.column().name())),
+                    &expected);
+    }
+
+    vector<codegen::PredicateShape> shapes;
+    ASSERT_OK(codegen::PredicateEvaluatorFunctions::GetShapes(projection, predicates, &shapes));
+    scoped_refptr<codegen::PredicateEvaluatorFunctions> functions;
+    ASSERT_OK(generator.CompilePredicateEvaluator(projection, shapes, &functions));
+    codegen::PredicateEvaluator evaluator(predicates, functions);
+
+    reset_selection(block.selection_vector());
+    evaluator.Evaluate(&block);
+    ASSERT_TRUE(expected == *block.selection_vector());
+  }
+
+  // Predicates on strings aren't compiled.
+  const Slice kStr = "a";
+  vector<codegen::PredicateShape> shapes;
+  Schema str_projection;
+  ASSERT_OK(CreatePartialSchema({ kKeyCol, kStrCol }, &str_projection));
+  Status s = codegen::PredicateEvaluatorFunctions::GetShapes(
+      str_projection, { ColumnPredicate::Equality(str_projection.column(1), &kStr) }, &shapes);
+  ASSERT_TRUE(s.IsNotSupported()) << s.ToString();
+}
+
+// Test that the codegenned key encoding matches Schema::EncodeComparableKey()
+// for a composite key of various types.
+TEST_F(CodegenTest, TestKeyEncoding) {
+  Schema schema({ ColumnSchema("k8", INT8),
+                  ColumnSchema("kstr", STRING),
+                  ColumnSchema("ku32", UINT32),
+                  ColumnSchema("k64", INT64),
+                  ColumnSchema("kbin", BINARY),
+                  ColumnSchema("val", INT32, true) }, 5);
+
+  codegen::CodeGenerator generator;
+  scoped_refptr<codegen::KeyEncoderFunctions> functions;
+  ASSERT_OK(generator.CompileKeyEncoder(schema, &functions));
+
+  Random rng(SeedRandom());
+  const vector<Slice> kStrs = { "", "a", Slice("a\0b", 3), Slice("\0\0", 2), "abc" };
+  RowBuilder rb(schema);
+  faststring expected;
+  faststring encoded;
+  for (int i = 0; i < 100; i++) {
+    rb.Reset();
+    rb.AddInt8(static_cast<int8_t>(rng.Next32()));
+    rb.AddString(kStrs[rng.Uniform(kStrs.size())]);
+    rb.AddUint32(rng.Next32());
+    rb.AddInt64(static_cast<int64_t>(rng.Next64()));
+    rb.AddBinary(kStrs[rng.Uniform(kStrs.size())]);
+    rb.AddNull();
+    ConstContiguousRow row = rb.row();
+    schema.EncodeComparableKey(row, &expected);
+    // Leave garbage in the buffer, which must be replaced.
+    encoded.append("garbage");
+    ASSERT_EQ(Slice(expected), functions->Encode(row, &encoded));
+  }
+}
+
 } // namespace kudu
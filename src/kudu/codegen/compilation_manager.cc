@@ -17,10 +17,13 @@
 
 #include "kudu/codegen/compilation_manager.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <memory>
 #include <ostream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
@@ -28,7 +31,10 @@
 #include "kudu/codegen/code_cache.h"
 #include "kudu/codegen/code_generator.h"
 #include "kudu/codegen/jit_wrapper.h"
+#include "kudu/codegen/key_encoder.h"
+#include "kudu/codegen/predicate_evaluator.h"
 #include "kudu/codegen/row_projector.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/schema.h"
 #include "kudu/gutil/bind.h"
 #include "kudu/gutil/bind_helpers.h"
@@ -46,6 +52,7 @@
 #include "kudu/util/threadpool.h"
 
 using std::shared_ptr;
+using std::vector;
 
 DEFINE_bool(codegen_time_compilation, false, "Whether to print time that each code "
             "generation request took.");
@@ -65,11 +72,34 @@ METRIC_DEFINE_gauge_int64(server, code_cache_queries, "Codegen Cache Queries",
                           "Number of codegen cache queries (hits + misses) "
                           "since start",
                           kudu::EXPOSE_AS_COUNTER);
+METRIC_DEFINE_gauge_int64(server, code_cache_compilations, "Codegen Compilations",
+                          kudu::MetricUnit::kTasks,
+                          "Number of code generation compilations since start",
+                          kudu::EXPOSE_AS_COUNTER);
+METRIC_DEFINE_gauge_int64(server, code_cache_compilation_time, "Codegen Compilation Time",
+                          kudu::MetricUnit::kMicroseconds,
+                          "Total time spent compiling generated code since start. "
+                          "Divide by code_cache_compilations for the average "
+                          "compilation latency",
+                          kudu::EXPOSE_AS_COUNTER);
+
 namespace kudu {
 namespace codegen {
 
 namespace {
 
+// The counters of the compilations run by the compilation tasks.
+struct CompilationCounters {
+  AtomicInt<int64_t>* num_compilations;
+  AtomicInt<int64_t>* compilation_time_us;
+
+  // Records a compilation which started at 'start'.
+  void Record(const MonoTime& start) const {
+    num_compilations->Increment();
+    compilation_time_us->IncrementBy((MonoTime::Now() - start).ToMicroseconds());
+  }
+};
+
 // A CompilationTask is a ThreadPool's Runnable which, given a
 // pair of schemas and a cache to refer to, will generate code pertaining
 // to the two schemas and store it in the cache when run.
@@ -78,11 +108,12 @@ class CompilationTask : public Runnable {
   // Requires that the cache and generator are valid for the lifetime
   // of this object.
   CompilationTask(const Schema& base, const Schema& proj, CodeCache* cache,
-                  CodeGenerator* generator)
+                  CodeGenerator* generator, CompilationCounters counters)
     : base_(base),
       proj_(proj),
       cache_(cache),
-      generator_(generator) {}
+      generator_(generator),
+      counters_(counters) {}
 
   // Can only be run once.
   void Run() override {
@@ -106,9 +137,11 @@ class CompilationTask : public Runnable {
     if (cache_->Lookup(key)) return Status::OK();
 
     scoped_refptr<RowProjectorFunctions> functions;
+    MonoTime start = MonoTime::Now();
     LOG_TIMING_IF(INFO, FLAGS_codegen_time_compilation, "code-generating row projector") {
       RETURN_NOT_OK(generator_->CompileRowProjector(base_, proj_, &functions));
     }
+    counters_.Record(start);
 
     RETURN_NOT_OK(cache_->AddEntry(functions));
     return Status::OK();
@@ -118,16 +151,115 @@ class CompilationTask : public Runnable {
   Schema proj_;
   CodeCache* const cache_;
   CodeGenerator* const generator_;
+  const CompilationCounters counters_;
 
   DISALLOW_COPY_AND_ASSIGN(CompilationTask);
 };
 
+// Like CompilationTask, but generates the code evaluating predicates of
+// the given shapes on row blocks of the given projection.
+class PredicateCompilationTask : public Runnable {
+ public:
+  // Requires that the cache and generator are valid for the lifetime
+  // of this object.
+  PredicateCompilationTask(const Schema& projection, vector<PredicateShape> shapes,
+                           CodeCache* cache, CodeGenerator* generator,
+                           CompilationCounters counters)
+    : projection_(projection),
+      shapes_(std::move(shapes)),
+      cache_(cache),
+      generator_(generator),
+      counters_(counters) {}
+
+  // Can only be run once.
+  void Run() override {
+    WARN_NOT_OK(RunWithStatus(),
+                "Failed compilation of predicate evaluator for projection schema " +
+                projection_.ToString());
+  }
+
+ private:
+  Status RunWithStatus() {
+    faststring key;
+    RETURN_NOT_OK(PredicateEvaluatorFunctions::EncodeKey(projection_, shapes_, &key));
+
+    // Check again to make sure we didn't compile it already.
+    if (cache_->Lookup(key)) return Status::OK();
+
+    scoped_refptr<PredicateEvaluatorFunctions> functions;
+    MonoTime start = MonoTime::Now();
+    LOG_TIMING_IF(INFO, FLAGS_codegen_time_compilation, "code-generating predicate evaluator") {
+      RETURN_NOT_OK(generator_->CompilePredicateEvaluator(projection_, shapes_, &functions));
+    }
+    counters_.Record(start);
+
+    RETURN_NOT_OK(cache_->AddEntry(functions));
+    return Status::OK();
+  }
+
+  Schema projection_;
+  const vector<PredicateShape> shapes_;
+  CodeCache* const cache_;
+  CodeGenerator* const generator_;
+  const CompilationCounters counters_;
+
+  DISALLOW_COPY_AND_ASSIGN(PredicateCompilationTask);
+};
+
+// Like CompilationTask, but generates the code encoding the primary keys
+// of rows of the given schema.
+class KeyEncoderCompilationTask : public Runnable {
+ public:
+  // Requires that the cache and generator are valid for the lifetime
+  // of this object.
+  KeyEncoderCompilationTask(const Schema& schema, CodeCache* cache,
+                            CodeGenerator* generator, CompilationCounters counters)
+    : schema_(schema.CreateKeyProjection()),
+      cache_(cache),
+      generator_(generator),
+      counters_(counters) {}
+
+  // Can only be run once.
+  void Run() override {
+    WARN_NOT_OK(RunWithStatus(),
+                "Failed compilation of key encoder for schema " + schema_.ToString());
+  }
+
+ private:
+  Status RunWithStatus() {
+    faststring key;
+    RETURN_NOT_OK(KeyEncoderFunctions::EncodeKey(schema_, &key));
+
+    // Check again to make sure we didn't compile it already.
+    if (cache_->Lookup(key)) return Status::OK();
+
+    scoped_refptr<KeyEncoderFunctions> functions;
+    MonoTime start = MonoTime::Now();
+    LOG_TIMING_IF(INFO, FLAGS_codegen_time_compilation, "code-generating key encoder") {
+      RETURN_NOT_OK(generator_->CompileKeyEncoder(schema_, &functions));
+    }
+    counters_.Record(start);
+
+    RETURN_NOT_OK(cache_->AddEntry(functions));
+    return Status::OK();
+  }
+
+  Schema schema_;
+  CodeCache* const cache_;
+  CodeGenerator* const generator_;
+  const CompilationCounters counters_;
+
+  DISALLOW_COPY_AND_ASSIGN(KeyEncoderCompilationTask);
+};
+
 } // anonymous namespace
 
 CompilationManager::CompilationManager()
   : cache_(FLAGS_codegen_cache_capacity),
     hit_counter_(0),
-    query_counter_(0) {
+    query_counter_(0),
+    compilation_counter_(0),
+    compilation_time_counter_(0) {
   CHECK_OK(ThreadPoolBuilder("compiler_manager_pool")
            .set_min_threads(0)
            .set_max_threads(1)
@@ -167,8 +299,19 @@ Status CompilationManager::StartInstrumentation(const scoped_refptr<MetricEntity
                                          kMemOrderNoBarrier);
   metric_entity->NeverRetire(
       METRIC_code_cache_hits.InstantiateFunctionGauge(metric_entity, hits));
+  Callback<int64_t(void)> compilations = Bind(&AtomicInt<int64_t>::Load,
+                                              Unretained(&compilation_counter_),
+                                              kMemOrderNoBarrier);
+  Callback<int64_t(void)> compilation_time = Bind(&AtomicInt<int64_t>::Load,
+                                                  Unretained(&compilation_time_counter_),
+                                                  kMemOrderNoBarrier);
   metric_entity->NeverRetire(
       METRIC_code_cache_queries.InstantiateFunctionGauge(metric_entity, queries));
+  metric_entity->NeverRetire(
+      METRIC_code_cache_compilations.InstantiateFunctionGauge(metric_entity, compilations));
+  metric_entity->NeverRetire(
+      METRIC_code_cache_compilation_time.InstantiateFunctionGauge(metric_entity,
+                                                                  compilation_time));
   return Status::OK();
 }
 
@@ -187,7 +330,8 @@ bool CompilationManager::RequestRowProjector(const Schema* base_schema,
   // If not cached, add a request to compilation pool
   if (!cached) {
     shared_ptr<Runnable> task(
-      new CompilationTask(*base_schema, *projection, &cache_, &generator_));
+      new CompilationTask(*base_schema, *projection, &cache_, &generator_,
+                          { &compilation_counter_, &compilation_time_counter_ }));
     WARN_NOT_OK(pool_->Submit(task),
                 "RowProjector compilation request failed");
     return false;
@@ -199,5 +343,99 @@ bool CompilationManager::RequestRowProjector(const Schema* base_schema,
   return true;
 }
 
+bool CompilationManager::RequestPredicateEvaluator(const Schema* projection,
+                                                   vector<ColumnPredicate> predicates,
+                                                   gscoped_ptr<PredicateEvaluator>* out) {
+  // Sort the predicates so that the same set of predicates always maps to
+  // the same code, regardless of the order it was specified in.
+  std::sort(predicates.begin(), predicates.end(),
+            [&](const ColumnPredicate& a, const ColumnPredicate& b) {
+              return projection->find_column(a.column().name()) <
+                     projection->find_column(b.column().name());
+            });
+
+  // Predicates which can't be compiled are evaluated by the caller, so
+  // that's not worth a warning.
+  vector<PredicateShape> shapes;
+  Status s = PredicateEvaluatorFunctions::GetShapes(*projection, predicates, &shapes);
+  if (!s.ok()) {
+    VLOG(2) << "Not compiling predicate evaluator: " << s.ToString();
+    return false;
+  }
+
+  faststring key;
+  s = PredicateEvaluatorFunctions::EncodeKey(*projection, shapes, &key);
+  WARN_NOT_OK(s, "PredicateEvaluator compilation request failed");
+  if (!s.ok()) return false;
+  query_counter_.Increment();
+
+  scoped_refptr<PredicateEvaluatorFunctions> cached(
+    down_cast<PredicateEvaluatorFunctions*>(cache_.Lookup(key).get()));
+
+  // If not cached, add a request to compilation pool
+  if (!cached) {
+    shared_ptr<Runnable> task(
+      new PredicateCompilationTask(*projection, std::move(shapes), &cache_, &generator_,
+                                   { &compilation_counter_, &compilation_time_counter_ }));
+    WARN_NOT_OK(pool_->Submit(task),
+                "PredicateEvaluator compilation request failed");
+    return false;
+  }
+
+  hit_counter_.Increment();
+
+  out->reset(new PredicateEvaluator(std::move(predicates), std::move(cached)));
+  return true;
+}
+
+void CompilationManager::WarmUp(const Schema& schema) {
+  const CompilationCounters counters = { &compilation_counter_, &compilation_time_counter_ };
+  const Schema key_projection = schema.CreateKeyProjection();
+  const Schema empty_projection(vector<ColumnSchema>(), 0);
+  for (const Schema* projection : { &schema, &key_projection, &empty_projection }) {
+    faststring key;
+    if (!RowProjectorFunctions::EncodeKey(schema, *projection, &key).ok() ||
+        cache_.Lookup(key)) {
+      continue;
+    }
+    shared_ptr<Runnable> task(
+      new CompilationTask(schema, *projection, &cache_, &generator_, counters));
+    WARN_NOT_OK(pool_->Submit(task), "RowProjector warm-up compilation request failed");
+  }
+
+  faststring key;
+  if (KeyEncoderFunctions::EncodeKey(schema, &key).ok() && !cache_.Lookup(key)) {
+    shared_ptr<Runnable> task(
+      new KeyEncoderCompilationTask(schema, &cache_, &generator_, counters));
+    WARN_NOT_OK(pool_->Submit(task), "KeyEncoder warm-up compilation request failed");
+  }
+}
+
+bool CompilationManager::RequestKeyEncoder(const Schema& schema,
+                                           scoped_refptr<KeyEncoderFunctions>* out) {
+  faststring key;
+  Status s = KeyEncoderFunctions::EncodeKey(schema, &key);
+  WARN_NOT_OK(s, "KeyEncoder compilation request failed");
+  if (!s.ok()) return false;
+  query_counter_.Increment();
+
+  scoped_refptr<KeyEncoderFunctions> cached(
+    down_cast<KeyEncoderFunctions*>(cache_.Lookup(key).get()));
+
+  // If not cached, add a request to compilation pool
+  if (!cached) {
+    shared_ptr<Runnable> task(new KeyEncoderCompilationTask(
+        schema, &cache_, &generator_, { &compilation_counter_, &compilation_time_counter_ }));
+    WARN_NOT_OK(pool_->Submit(task),
+                "KeyEncoder compilation request failed");
+    return false;
+  }
+
+  hit_counter_.Increment();
+
+  *out = std::move(cached);
+  return true;
+}
+
 } // namespace codegen
 } // namespace kudu
@@ -19,6 +19,7 @@
 #define KUDU_CODEGEN_COMPILATION_MANAGER_H
 
 #include <cstdint>
+#include <vector>
 
 #include "kudu/codegen/code_generator.h"
 #include "kudu/codegen/code_cache.h"
@@ -31,12 +32,15 @@
 
 namespace kudu {
 
+class ColumnPredicate;
 class MetricEntity;
 class Schema;
 class ThreadPool;
 
 namespace codegen {
 
+class KeyEncoderFunctions;
+class PredicateEvaluator;
 class RowProjector;
 
 // The compilation manager is a top-level class which manages the actual
@@ -78,6 +82,32 @@ class CompilationManager {
                            const Schema* projection,
                            gscoped_ptr<RowProjector>* out);
 
+  // If a codegenned evaluator of 'predicates' on row blocks of 'projection'
+  // is ready, then it is written to 'out' and true is returned. The
+  // evaluator keeps the predicates, sorted by their projection column.
+  // Otherwise, this enqueues a compilation task for the shapes of the
+  // predicates (see PredicateShape) and returns false, unless some of the
+  // predicates can't be compiled. Upon any failure, false is returned.
+  // Does not write to 'out' if false is returned.
+  bool RequestPredicateEvaluator(const Schema* projection,
+                                 std::vector<ColumnPredicate> predicates,
+                                 gscoped_ptr<PredicateEvaluator>* out);
+
+  // If a codegenned encoder of the primary keys of rows of 'schema' is
+  // ready, then it is written to 'out' and true is returned. Otherwise,
+  // this enqueues a compilation task for the key columns of the schema and
+  // returns false. Upon any failure, false is returned.
+  // Does not write to 'out' if false is returned.
+  bool RequestKeyEncoder(const Schema& schema,
+                         scoped_refptr<KeyEncoderFunctions>* out);
+
+  // Enqueues compilation tasks for the code which is commonly used by a
+  // tablet of 'schema', unless it's already cached: the key encoder, and the
+  // MemRowSet row projectors to the full, key-only and empty projections.
+  // Used to compile the code ahead of the first writes and scans of tablets
+  // opened at startup. Doesn't count as cache queries.
+  void WarmUp(const Schema& schema);
+
   // Waits for all asynchronous compilation tasks to finish.
   void Wait();
 
@@ -99,6 +129,8 @@ class CompilationManager {
 
   AtomicInt<int64_t> hit_counter_;
   AtomicInt<int64_t> query_counter_;
+  AtomicInt<int64_t> compilation_counter_;
+  AtomicInt<int64_t> compilation_time_counter_;
 
   static const int kThreadTimeoutMs = 100;
 
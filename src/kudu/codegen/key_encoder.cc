@@ -0,0 +1,215 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/codegen/key_encoder.h"
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags_declare.h>
+#include <glog/logging.h>
+#include <llvm/ADT/Twine.h>
+#include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/IR/Argument.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Type.h>
+#include <llvm/IR/Value.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "kudu/codegen/jit_wrapper.h"
+#include "kudu/codegen/module_builder.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/key_encoder.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/strcat.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/status.h"
+
+namespace llvm {
+class LLVMContext;
+} // namespace llvm
+
+using llvm::Argument;
+using llvm::BasicBlock;
+using llvm::Function;
+using llvm::FunctionType;
+using llvm::LLVMContext;
+using llvm::PointerType;
+using llvm::Type;
+using llvm::Value;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+DECLARE_bool(codegen_dump_functions);
+
+namespace kudu {
+namespace codegen {
+
+namespace {
+
+// Generates a key encoding function of the form:
+// void(int8_t* src, faststring* dst)
+// Requires src is a contiguous row whose schema starts with the key columns
+// of 'schema'.
+//
+// The key columns must have been validated with IsTypeAllowableInKey().
+llvm::Function* MakeEncoding(const string& name,
+                             ModuleBuilder* mbuilder,
+                             const Schema& schema) {
+  // Get the IRBuilder
+  ModuleBuilder::LLVMBuilder* builder = mbuilder->builder();
+  LLVMContext& context = builder->getContext();
+
+  // Create the function after providing a declaration
+  vector<Type*> argtypes = { Type::getInt8PtrTy(context),
+                             PointerType::getUnqual(mbuilder->GetType("class.kudu::faststring")) };
+  FunctionType* fty =
+    FunctionType::get(Type::getVoidTy(context), argtypes, false);
+  Function* f = mbuilder->Create(fty, name);
+
+  // Get the function's Arguments
+  Function::arg_iterator it = f->arg_begin();
+  Argument* src = &*it++;
+  Argument* dst = &*it++;
+  DCHECK(it == f->arg_end());
+
+  // Give names to the arguments for debugging IR.
+  src->setName("src");
+  dst->setName("dst");
+
+  // Key encoding function in IR (note: values in angle brackets are
+  // constants whose values are determined right now, at JIT time).
+  //
+  // define void @name(i8* %src, faststring* %dst)
+  // entry:
+  //   call void @ClearFaststring(faststring* %dst)
+  //   <for each key column>
+  //     %src_cell = getelementptr i8* %src, i64 <column offset>
+  //     call void @EncodeKeyColumn<physical type>(
+  //       i8* %src_cell, i1 <is last key column>, faststring* %dst)
+  //   <end implicit for each>
+  //   ret void
+  //
+  // Since the encoding functions of the column types are inlined, this
+  // resolves the type dispatch and the column offsets of the encoding at
+  // JIT time.
+  builder->SetInsertPoint(BasicBlock::Create(context, "entry", f));
+  builder->CreateCall(mbuilder->GetFunction("_PrecompiledClearFaststring"), { dst });
+  for (int i = 0; i < schema.num_key_columns(); i++) {
+    const ColumnSchema& col = schema.column(i);
+    Function* encode_cell = mbuilder->GetFunction(
+        StrCat("_PrecompiledEncodeKeyColumn", DataType_Name(col.type_info()->physical_type())));
+    Value* src_cell = builder->CreateConstGEP1_64(src, schema.column_offset(i));
+    src_cell->setName(StrCat("src_cell_", i));
+    Value* is_last = builder->getInt1(i == schema.num_key_columns() - 1);
+    builder->CreateCall(encode_cell, { src_cell, is_last, dst });
+  }
+
+  // Return
+  builder->CreateRetVoid();
+
+  if (FLAGS_codegen_dump_functions) {
+    LOG(INFO) << "Dumping key encoding:";
+    f->print(llvm::errs(), nullptr);
+  }
+
+  return f;
+}
+
+} // anonymous namespace
+
+KeyEncoderFunctions::KeyEncoderFunctions(const Schema& key_schema,
+                                         EncodeFunction encode_f,
+                                         unique_ptr<JITCodeOwner> owner)
+  : JITWrapper(std::move(owner)),
+    key_schema_(key_schema),
+    encode_f_(encode_f) {
+  CHECK(encode_f != nullptr)
+    << "Promise to compile key encoding function not fulfilled by ModuleBuilder";
+}
+
+Status KeyEncoderFunctions::Create(const Schema& schema,
+                                   scoped_refptr<KeyEncoderFunctions>* out,
+                                   llvm::TargetMachine** tm) {
+  // Validate the key columns, so that the precompiled encoding functions
+  // of their types exist.
+  for (int i = 0; i < schema.num_key_columns(); i++) {
+    const ColumnSchema& col = schema.column(i);
+    if (col.is_nullable() || !IsTypeAllowableInKey(col.type_info())) {
+      return Status::InvalidArgument(
+          Substitute("column $0 is not a valid key column", col.ToString()));
+    }
+  }
+
+  ModuleBuilder builder;
+  RETURN_NOT_OK(builder.Init());
+
+  Function* encode = MakeEncoding("KeyEncode", &builder, schema);
+
+  // Have the ModuleBuilder accept a promise to compile the function
+  EncodeFunction encode_f;
+  builder.AddJITPromise(encode, &encode_f);
+
+  unique_ptr<JITCodeOwner> owner;
+  RETURN_NOT_OK(builder.Compile(&owner));
+
+  if (tm) {
+    *tm = builder.GetTargetMachine();
+  }
+  out->reset(new KeyEncoderFunctions(schema.CreateKeyProjection(), encode_f,
+                                     std::move(owner)));
+  return Status::OK();
+}
+
+namespace {
+// Convenience method which appends to a faststring
+template<typename T>
+void AddNext(faststring* fs, const T& val) {
+  fs->append(&val, sizeof(T));
+}
+} // anonymous namespace
+
+// Generates a key for the key columns of a schema. The key is unique
+// according to the criteria defined in the CodeCache class' block comment.
+// The key columns always come first in a row, so their types determine
+// their offsets too. The key consists of the following, in sequence.
+//
+// (1 byte) unique type identifier for KeyEncoderFunctions
+// (8 bytes) number, as unsigned long, of key columns
+// (4 bytes each) key column physical types, in order
+//
+// Writes to 'out' upon success.
+Status KeyEncoderFunctions::EncodeKey(const Schema& schema, faststring* out) {
+  AddNext(out, JITWrapper::KEY_ENCODER);
+  AddNext(out, schema.num_key_columns());
+  for (int i = 0; i < schema.num_key_columns(); i++) {
+    AddNext(out, schema.column(i).type_info()->physical_type());
+  }
+  return Status::OK();
+}
+
+} // namespace codegen
+} // namespace kudu
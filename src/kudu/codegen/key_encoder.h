@@ -0,0 +1,88 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <glog/logging.h>
+
+#include "kudu/codegen/jit_wrapper.h"
+#include "kudu/common/row.h"
+#include "kudu/common/schema.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace llvm {
+class TargetMachine;
+} // namespace llvm
+
+namespace kudu {
+namespace codegen {
+
+// The JITWrapper for the function encoding the primary keys of rows into
+// their comparable form. Contains the compiled function as well as the
+// key schema used to generate it.
+//
+// The encoding only depends on the types of the key columns, which can't be
+// altered, so the functions of a table remain valid across schema changes.
+class KeyEncoderFunctions : public JITWrapper {
+ public:
+  // Compiles the key encoding function for the key columns of 'schema'.
+  // Writes the llvm::TargetMachine* used to 'tm' (if not NULL)
+  // and the function to 'out' upon success.
+  static Status Create(const Schema& schema,
+                       scoped_refptr<KeyEncoderFunctions>* out,
+                       llvm::TargetMachine** tm = NULL);
+
+  const Schema& key_schema() { return key_schema_; }
+
+  // Replaces the contents of the buffer with the encoding of the key of
+  // the contiguous row.
+  typedef void(*EncodeFunction)(const uint8_t*, faststring*);
+  EncodeFunction encode() const { return encode_f_; }
+
+  // Encodes the key of 'row' to 'dst' the same way as
+  // Schema::EncodeComparableKey(), and returns it. The key columns of 'row'
+  // must have the types of the functions' key schema, possibly with
+  // different names.
+  template<class ContiguousRowType>
+  Slice Encode(const ContiguousRowType& row, faststring* dst) const {
+    DCHECK(key_schema_.KeyTypeEquals(*row.schema()));
+    encode_f_(row.row_data(), dst);
+    return Slice(*dst);
+  }
+
+  virtual Status EncodeOwnKey(faststring* out) OVERRIDE {
+    return EncodeKey(key_schema_, out);
+  }
+
+  static Status EncodeKey(const Schema& schema, faststring* out);
+
+ private:
+  KeyEncoderFunctions(const Schema& key_schema, EncodeFunction encode_f,
+                      std::unique_ptr<JITCodeOwner> owner);
+
+  const Schema key_schema_;
+  const EncodeFunction encode_f_;
+};
+
+} // namespace codegen
+} // namespace kudu
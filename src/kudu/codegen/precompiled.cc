@@ -36,9 +36,12 @@
 #include <cstdint>
 #include <cstring>
 
+#include "kudu/common/common.pb.h"
+#include "kudu/common/key_encoder.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/gutil/port.h"
 #include "kudu/util/bitmap.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/memory/arena.h"
 
 // Even though this file is only needed for IR purposes, we need to check for
@@ -163,5 +166,77 @@ IR_ALWAYS_INLINE void _PrecompiledCopyCellToRowBlockSetNull(
   dst->cell(col).set_null(is_null);
 }
 
+// declare i64 @_PrecompiledRowBlockNumRows(RowBlock* block)
+//
+//   Returns the number of rows in 'block', including the unselected ones.
+IR_ALWAYS_INLINE uint64_t _PrecompiledRowBlockNumRows(RowBlock* block) {
+  return block->nrows();
+}
+
+// declare i8* @_PrecompiledRowBlockColumnData(RowBlock* block, i64 col)
+//
+//   Returns the base pointer of the data of column 'col' of 'block'.
+IR_ALWAYS_INLINE uint8_t* _PrecompiledRowBlockColumnData(
+    RowBlock* block, uint64_t col) {
+  return block->column_data_base_ptr(col);
+}
+
+// declare i8* @_PrecompiledRowBlockColumnNullBitmap(RowBlock* block, i64 col)
+//
+//   Returns the null bitmap of column 'col' of 'block' (requires the column
+//   is nullable). A set bit indicates a non-null cell.
+IR_ALWAYS_INLINE uint8_t* _PrecompiledRowBlockColumnNullBitmap(
+    RowBlock* block, uint64_t col) {
+  return block->column_null_bitmap_ptr(col);
+}
+
+// declare i8* @_PrecompiledRowBlockSelectionBitmap(RowBlock* block)
+//
+//   Returns the bitmap of the selection vector of 'block'.
+IR_ALWAYS_INLINE uint8_t* _PrecompiledRowBlockSelectionBitmap(RowBlock* block) {
+  return block->selection_vector()->mutable_bitmap();
+}
+
+// declare i1 @_PrecompiledBitmapTest(i8* bitmap, i64 idx)
+IR_ALWAYS_INLINE bool _PrecompiledBitmapTest(uint8_t* bitmap, uint64_t idx) {
+  return BitmapTest(bitmap, idx);
+}
+
+// declare void @_PrecompiledBitmapClear(i8* bitmap, i64 idx)
+IR_ALWAYS_INLINE void _PrecompiledBitmapClear(uint8_t* bitmap, uint64_t idx) {
+  BitmapClear(bitmap, idx);
+}
+
+// declare void @_PrecompiledClearFaststring(faststring* dst)
+IR_ALWAYS_INLINE void _PrecompiledClearFaststring(faststring* dst) {
+  dst->clear();
+}
+
+// declare void @_PrecompiledEncodeKeyColumn<physical type>(
+//   i8* cell, i1 is_last, faststring* dst)
+//
+//   Appends the encoding of the key cell pointed to by 'cell' to 'dst', as
+//   a component of a composite key. 'is_last' should be true for the last
+//   key column. There's one such function for each type allowed in keys,
+//   suffixed by the name of the type.
+#define ENCODE_KEY_COLUMN_FUNCTION(type)                                  \
+  IR_ALWAYS_INLINE void _PrecompiledEncodeKeyColumn##type(                \
+      const uint8_t* cell, bool is_last, faststring* dst) {               \
+    KeyEncoderTraits<type, faststring>::EncodeWithSeparators(cell, is_last, dst); \
+  }
+
+ENCODE_KEY_COLUMN_FUNCTION(UINT8)
+ENCODE_KEY_COLUMN_FUNCTION(INT8)
+ENCODE_KEY_COLUMN_FUNCTION(UINT16)
+ENCODE_KEY_COLUMN_FUNCTION(INT16)
+ENCODE_KEY_COLUMN_FUNCTION(UINT32)
+ENCODE_KEY_COLUMN_FUNCTION(INT32)
+ENCODE_KEY_COLUMN_FUNCTION(UINT64)
+ENCODE_KEY_COLUMN_FUNCTION(INT64)
+ENCODE_KEY_COLUMN_FUNCTION(BINARY)
+ENCODE_KEY_COLUMN_FUNCTION(INT128)
+
+#undef ENCODE_KEY_COLUMN_FUNCTION
+
 } // extern "C"
 } // namespace kudu
@@ -0,0 +1,506 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/codegen/predicate_evaluator.h"
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags_declare.h>
+#include <glog/logging.h>
+#include <llvm/ADT/Twine.h>
+#include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/IR/Argument.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Type.h>
+#include <llvm/IR/Value.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "kudu/codegen/jit_wrapper.h"
+#include "kudu/codegen/module_builder.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/strcat.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/status.h"
+
+namespace llvm {
+class LLVMContext;
+} // namespace llvm
+
+using llvm::Argument;
+using llvm::BasicBlock;
+using llvm::Function;
+using llvm::FunctionType;
+using llvm::LLVMContext;
+using llvm::PHINode;
+using llvm::PointerType;
+using llvm::Type;
+using llvm::Value;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+DECLARE_bool(codegen_dump_functions);
+
+namespace kudu {
+namespace codegen {
+
+namespace {
+
+// Returns the LLVM type of the cells of the given physical type, or NULL
+// if the evaluation of predicates on such cells can't be compiled.
+Type* GetCellType(LLVMContext* context, DataType physical_type) {
+  switch (physical_type) {
+    case INT8:
+    case UINT8:
+      return Type::getInt8Ty(*context);
+    case INT16:
+    case UINT16:
+      return Type::getInt16Ty(*context);
+    case INT32:
+    case UINT32:
+      return Type::getInt32Ty(*context);
+    case INT64:
+    case UINT64:
+      return Type::getInt64Ty(*context);
+    case FLOAT:
+      return Type::getFloatTy(*context);
+    case DOUBLE:
+      return Type::getDoubleTy(*context);
+    default:
+      return nullptr;
+  }
+}
+
+bool IsUnsigned(DataType physical_type) {
+  return physical_type == UINT8 || physical_type == UINT16 ||
+         physical_type == UINT32 || physical_type == UINT64;
+}
+
+bool IsFloatingPoint(DataType physical_type) {
+  return physical_type == FLOAT || physical_type == DOUBLE;
+}
+
+// Returns whether comparisons of cells of the given physical type can be
+// compiled, i.e. whether GetCellType() supports it.
+bool IsComparable(DataType physical_type) {
+  return IsFloatingPoint(physical_type) || IsUnsigned(physical_type) ||
+         physical_type == INT8 || physical_type == INT16 ||
+         physical_type == INT32 || physical_type == INT64;
+}
+
+// The comparisons below mirror GenericCompare() in common/types.h: a NaN
+// compares equal to everything, so the floating point "greater or equal"
+// and "equal" comparisons are unordered, and "less than" is ordered.
+
+Value* CreateEqual(ModuleBuilder::LLVMBuilder* builder, DataType physical_type,
+                   Value* cell, Value* value) {
+  if (IsFloatingPoint(physical_type)) {
+    return builder->CreateFCmpUEQ(cell, value);
+  }
+  return builder->CreateICmpEQ(cell, value);
+}
+
+Value* CreateGreaterOrEqual(ModuleBuilder::LLVMBuilder* builder, DataType physical_type,
+                            Value* cell, Value* lower) {
+  if (IsFloatingPoint(physical_type)) {
+    return builder->CreateFCmpUGE(cell, lower);
+  }
+  if (IsUnsigned(physical_type)) {
+    return builder->CreateICmpUGE(cell, lower);
+  }
+  return builder->CreateICmpSGE(cell, lower);
+}
+
+Value* CreateLessThan(ModuleBuilder::LLVMBuilder* builder, DataType physical_type,
+                      Value* cell, Value* upper) {
+  if (IsFloatingPoint(physical_type)) {
+    return builder->CreateFCmpOLT(cell, upper);
+  }
+  if (IsUnsigned(physical_type)) {
+    return builder->CreateICmpULT(cell, upper);
+  }
+  return builder->CreateICmpSLT(cell, upper);
+}
+
+// The values which the evaluation of a predicate needs for every row,
+// computed once per row block.
+struct PredicateValues {
+  // The column's data, as a pointer to its cell type. NULL if the predicate
+  // doesn't need the cells.
+  Value* data = nullptr;
+  // The column's null bitmap. NULL if the column isn't nullable.
+  Value* null_bitmap = nullptr;
+  // The bounds of the predicate, loaded as values of the cell type.
+  Value* lower = nullptr;
+  Value* upper = nullptr;
+};
+
+// Generates a predicate evaluation function of the form:
+// void(RowBlock* block, i8** bounds)
+// which unselects the rows of the block which don't match all the predicates
+// of the given shapes.
+//
+// The shapes must have been validated by PredicateEvaluatorFunctions::GetShapes().
+llvm::Function* MakeEvaluation(const string& name,
+                               ModuleBuilder* mbuilder,
+                               const Schema& projection,
+                               const vector<PredicateShape>& shapes) {
+  // Get the IRBuilder
+  ModuleBuilder::LLVMBuilder* builder = mbuilder->builder();
+  LLVMContext& context = builder->getContext();
+
+  // Create the function after providing a declaration
+  Type* i8_ptr = Type::getInt8PtrTy(context);
+  vector<Type*> argtypes = { PointerType::getUnqual(mbuilder->GetType("class.kudu::RowBlock")),
+                             PointerType::getUnqual(i8_ptr) };
+  FunctionType* fty =
+    FunctionType::get(Type::getVoidTy(context), argtypes, false);
+  Function* f = mbuilder->Create(fty, name);
+
+  // Get the function's Arguments
+  Function::arg_iterator it = f->arg_begin();
+  Argument* block = &*it++;
+  Argument* bounds = &*it++;
+  DCHECK(it == f->arg_end());
+
+  // Give names to the arguments for debugging IR.
+  block->setName("block");
+  bounds->setName("bounds");
+
+  // Evaluation function in IR (note: values in angle brackets are
+  // constants whose values are determined right now, at JIT time).
+  //
+  // define void @name(RowBlock* %block, i8** %bounds)
+  // entry:
+  //   %nrows = call i64 @RowBlockNumRows(RowBlock* %block)
+  //   %sel = call i8* @RowBlockSelectionBitmap(RowBlock* %block)
+  //   <for each predicate>
+  //     %data = call i8* @RowBlockColumnData(RowBlock* %block, i64 <column index>)
+  //     %nulls = call i8* @RowBlockColumnNullBitmap(RowBlock* %block, i64 <column index>)
+  //     %lower = load <cell type>, bitcast(load i8*, i8** %bounds[<2 * predicate index>])
+  //     %upper = load <cell type>, bitcast(load i8*, i8** %bounds[<2 * predicate index + 1>])
+  //   <end implicit for each>
+  //   br label %loop
+  // loop:
+  //   %idx = phi i64 [0, %entry], [%next_idx, %next]
+  //   br (icmp ult i64 %idx, %nrows), label %row, label %exit
+  // row:
+  //   br (call i1 @BitmapTest(i8* %sel, i64 %idx)), label %eval, label %next
+  // eval:
+  //   %match = and <the result of each predicate on the cells at %idx>
+  //   br %match, label %next, label %unselect
+  // unselect:
+  //   call void @BitmapClear(i8* %sel, i64 %idx)
+  //   br label %next
+  // next:
+  //   %next_idx = add i64 %idx, 1
+  //   br label %loop
+  // exit:
+  //   ret void
+  //
+  // Only the values which a predicate needs are computed: e.g. the null
+  // bitmap only for nullable columns, and the bounds only if present.
+
+  // Retrieve appropriate precompiled rowblock functions
+  Function* num_rows = mbuilder->GetFunction("_PrecompiledRowBlockNumRows");
+  Function* column_data = mbuilder->GetFunction("_PrecompiledRowBlockColumnData");
+  Function* column_null_bitmap =
+    mbuilder->GetFunction("_PrecompiledRowBlockColumnNullBitmap");
+  Function* selection_bitmap =
+    mbuilder->GetFunction("_PrecompiledRowBlockSelectionBitmap");
+  Function* bitmap_test = mbuilder->GetFunction("_PrecompiledBitmapTest");
+  Function* bitmap_clear = mbuilder->GetFunction("_PrecompiledBitmapClear");
+
+  BasicBlock* entry = BasicBlock::Create(context, "entry", f);
+  BasicBlock* loop = BasicBlock::Create(context, "loop", f);
+  BasicBlock* row = BasicBlock::Create(context, "row", f);
+  BasicBlock* eval = BasicBlock::Create(context, "eval", f);
+  BasicBlock* unselect = BasicBlock::Create(context, "unselect", f);
+  BasicBlock* next = BasicBlock::Create(context, "next", f);
+  BasicBlock* exit = BasicBlock::Create(context, "exit", f);
+
+  // Compute the per-block values.
+  builder->SetInsertPoint(entry);
+  Value* nrows = builder->CreateCall(num_rows, { block });
+  nrows->setName("nrows");
+  Value* sel = builder->CreateCall(selection_bitmap, { block });
+  sel->setName("sel");
+  vector<PredicateValues> values(shapes.size());
+  for (int i = 0; i < shapes.size(); i++) {
+    const PredicateShape& shape = shapes[i];
+    const ColumnSchema& col = projection.column(shape.col_idx);
+    Type* cell_ptr_type = PointerType::getUnqual(
+        GetCellType(&context, col.type_info()->physical_type()));
+    Value* col_idx = builder->getInt64(shape.col_idx);
+    PredicateValues& v = values[i];
+    if (shape.type == PredicateType::Equality || shape.type == PredicateType::Range) {
+      v.data = builder->CreatePointerCast(builder->CreateCall(column_data, { block, col_idx }),
+                                          cell_ptr_type);
+      v.data->setName(StrCat("data_p", i));
+    }
+    if (col.is_nullable()) {
+      v.null_bitmap = builder->CreateCall(column_null_bitmap, { block, col_idx });
+      v.null_bitmap->setName(StrCat("nulls_p", i));
+    }
+    auto load_bound = [&](int bound_idx) {
+      Value* bound = builder->CreateLoad(builder->CreateConstGEP1_64(bounds, bound_idx));
+      return builder->CreateLoad(builder->CreatePointerCast(bound, cell_ptr_type));
+    };
+    if (shape.has_lower) {
+      v.lower = load_bound(2 * i);
+      v.lower->setName(StrCat("lower_p", i));
+    }
+    if (shape.has_upper) {
+      v.upper = load_bound(2 * i + 1);
+      v.upper->setName(StrCat("upper_p", i));
+    }
+  }
+  builder->CreateBr(loop);
+
+  // Loop over the rows.
+  builder->SetInsertPoint(loop);
+  PHINode* idx = builder->CreatePHI(Type::getInt64Ty(context), 2, "idx");
+  idx->addIncoming(builder->getInt64(0), entry);
+  builder->CreateCondBr(builder->CreateICmpULT(idx, nrows), row, exit);
+
+  // Skip the rows which are already unselected.
+  builder->SetInsertPoint(row);
+  Value* selected = builder->CreateCall(bitmap_test, { sel, idx });
+  builder->CreateCondBr(selected, eval, next);
+
+  // Evaluate the conjunction of the predicates.
+  builder->SetInsertPoint(eval);
+  Value* match = builder->getInt1(true);
+  for (int i = 0; i < shapes.size(); i++) {
+    const PredicateShape& shape = shapes[i];
+    const PredicateValues& v = values[i];
+    DataType physical_type = projection.column(shape.col_idx).type_info()->physical_type();
+    Value* not_null = builder->getInt1(true);
+    if (v.null_bitmap) {
+      not_null = builder->CreateCall(bitmap_test, { v.null_bitmap, idx });
+    }
+
+    Value* result = nullptr;
+    switch (shape.type) {
+      case PredicateType::None:
+        result = builder->getInt1(false);
+        break;
+      case PredicateType::IsNotNull:
+        result = not_null;
+        break;
+      case PredicateType::IsNull:
+        result = builder->CreateNot(not_null);
+        break;
+      case PredicateType::Equality: {
+        Value* cell = builder->CreateLoad(builder->CreateGEP(v.data, idx));
+        result = builder->CreateAnd(not_null, CreateEqual(builder, physical_type, cell, v.lower));
+        break;
+      }
+      case PredicateType::Range: {
+        Value* cell = builder->CreateLoad(builder->CreateGEP(v.data, idx));
+        result = not_null;
+        if (v.lower) {
+          result = builder->CreateAnd(
+              result, CreateGreaterOrEqual(builder, physical_type, cell, v.lower));
+        }
+        if (v.upper) {
+          result = builder->CreateAnd(
+              result, CreateLessThan(builder, physical_type, cell, v.upper));
+        }
+        break;
+      }
+      default:
+        LOG(FATAL) << "unsupported predicate type";
+    }
+    result->setName(StrCat("result_p", i));
+    match = builder->CreateAnd(match, result);
+  }
+  builder->CreateCondBr(match, next, unselect);
+
+  // Unselect the rows which don't match.
+  builder->SetInsertPoint(unselect);
+  builder->CreateCall(bitmap_clear, { sel, idx });
+  builder->CreateBr(next);
+
+  builder->SetInsertPoint(next);
+  Value* next_idx = builder->CreateAdd(idx, builder->getInt64(1));
+  next_idx->setName("next_idx");
+  idx->addIncoming(next_idx, next);
+  builder->CreateBr(loop);
+
+  // Return
+  builder->SetInsertPoint(exit);
+  builder->CreateRetVoid();
+
+  if (FLAGS_codegen_dump_functions) {
+    LOG(INFO) << "Dumping predicate evaluation:";
+    f->print(llvm::errs(), nullptr);
+  }
+
+  return f;
+}
+
+} // anonymous namespace
+
+PredicateEvaluatorFunctions::PredicateEvaluatorFunctions(const Schema& projection,
+                                                         vector<PredicateShape> shapes,
+                                                         EvaluationFunction evaluate_f,
+                                                         unique_ptr<JITCodeOwner> owner)
+  : JITWrapper(std::move(owner)),
+    projection_(projection),
+    shapes_(std::move(shapes)),
+    evaluate_f_(evaluate_f) {
+  CHECK(evaluate_f != nullptr)
+    << "Promise to compile evaluation function not fulfilled by ModuleBuilder";
+}
+
+Status PredicateEvaluatorFunctions::GetShapes(const Schema& projection,
+                                              const vector<ColumnPredicate>& predicates,
+                                              vector<PredicateShape>* shapes) {
+  shapes->clear();
+  for (const ColumnPredicate& pred : predicates) {
+    int col_idx = projection.find_column(pred.column().name());
+    if (col_idx == Schema::kColumnNotFound) {
+      return Status::InvalidArgument(
+          Substitute("predicate column $0 not found in the projection",
+                     pred.column().name()));
+    }
+    const ColumnSchema& col = projection.column(col_idx);
+    switch (pred.predicate_type()) {
+      case PredicateType::None:
+      case PredicateType::IsNotNull:
+      case PredicateType::IsNull:
+        break;
+      case PredicateType::Equality:
+      case PredicateType::Range: {
+        if (IsComparable(col.type_info()->physical_type())) {
+          break;
+        }
+        return Status::NotSupported(
+            Substitute("can't compile predicate $0 on a column of type $1",
+                       pred.ToString(), col.type_info()->name()));
+      }
+      default:
+        return Status::NotSupported(
+            Substitute("can't compile predicate $0", pred.ToString()));
+    }
+    bool has_value = pred.predicate_type() == PredicateType::Equality ||
+                     pred.predicate_type() == PredicateType::Range;
+    shapes->push_back({ static_cast<size_t>(col_idx),
+                        pred.predicate_type(),
+                        has_value && pred.raw_lower() != nullptr,
+                        pred.predicate_type() == PredicateType::Range &&
+                            pred.raw_upper() != nullptr });
+  }
+  return Status::OK();
+}
+
+Status PredicateEvaluatorFunctions::Create(const Schema& projection,
+                                           const vector<PredicateShape>& shapes,
+                                           scoped_refptr<PredicateEvaluatorFunctions>* out,
+                                           llvm::TargetMachine** tm) {
+  ModuleBuilder builder;
+  RETURN_NOT_OK(builder.Init());
+
+  Function* evaluate = MakeEvaluation("PredEval", &builder, projection, shapes);
+
+  // Have the ModuleBuilder accept a promise to compile the function
+  EvaluationFunction evaluate_f;
+  builder.AddJITPromise(evaluate, &evaluate_f);
+
+  unique_ptr<JITCodeOwner> owner;
+  RETURN_NOT_OK(builder.Compile(&owner));
+
+  if (tm) {
+    *tm = builder.GetTargetMachine();
+  }
+  out->reset(new PredicateEvaluatorFunctions(projection, shapes, evaluate_f,
+                                             std::move(owner)));
+  return Status::OK();
+}
+
+namespace {
+// Convenience method which appends to a faststring
+template<typename T>
+void AddNext(faststring* fs, const T& val) {
+  fs->append(&val, sizeof(T));
+}
+} // anonymous namespace
+
+// Generates a key for a projection and a sequence of predicate shapes. The
+// key is unique according to the criteria defined in the CodeCache class'
+// block comment. Only the columns of the predicates affect the generated
+// code, so the key consists of the following, in sequence.
+//
+// (1 byte) unique type identifier for PredicateEvaluatorFunctions
+// (8 bytes) number, as unsigned long, of predicates
+// (20 bytes each) predicate shapes, in order
+//   8 bytes for the projection column index
+//   4 bytes for the column's physical type
+//   1 byte for the column's nullability
+//   4 bytes for the predicate type
+//   1 byte for each of the presence of the lower and upper bounds
+//
+// Writes to 'out' upon success.
+Status PredicateEvaluatorFunctions::EncodeKey(const Schema& projection,
+                                              const vector<PredicateShape>& shapes,
+                                              faststring* out) {
+  AddNext(out, JITWrapper::PREDICATE_EVALUATOR);
+  AddNext(out, shapes.size());
+  for (const PredicateShape& shape : shapes) {
+    if (shape.col_idx >= projection.num_columns()) {
+      return Status::InvalidArgument("predicate column index out of bounds");
+    }
+    const ColumnSchema& col = projection.column(shape.col_idx);
+    AddNext(out, shape.col_idx);
+    AddNext(out, col.type_info()->physical_type());
+    AddNext(out, col.is_nullable());
+    AddNext(out, shape.type);
+    AddNext(out, shape.has_lower);
+    AddNext(out, shape.has_upper);
+  }
+  return Status::OK();
+}
+
+PredicateEvaluator::PredicateEvaluator(vector<ColumnPredicate> predicates,
+                                       scoped_refptr<PredicateEvaluatorFunctions> functions)
+  : predicates_(std::move(predicates)),
+    functions_(std::move(functions)) {
+  for (const ColumnPredicate& pred : predicates_) {
+    bool has_value = pred.predicate_type() == PredicateType::Equality ||
+                     pred.predicate_type() == PredicateType::Range;
+    bounds_.push_back(has_value ? pred.raw_lower() : nullptr);
+    bounds_.push_back(pred.predicate_type() == PredicateType::Range ?
+                      pred.raw_upper() : nullptr);
+  }
+}
+
+} // namespace codegen
+} // namespace kudu
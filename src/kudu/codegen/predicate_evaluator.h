@@ -0,0 +1,135 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "kudu/codegen/jit_wrapper.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/schema.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/status.h"
+
+namespace llvm {
+class TargetMachine;
+} // namespace llvm
+
+namespace kudu {
+
+class RowBlock;
+class faststring;
+
+namespace codegen {
+
+// The parts of a column predicate which determine the code evaluating it.
+// The bounds themselves are passed to the compiled function at evaluation
+// time, so that the code can be shared by all the scans with predicates of
+// the same shape.
+struct PredicateShape {
+  // The index of the predicate's column in the projection.
+  size_t col_idx;
+  PredicateType type;
+  bool has_lower;
+  bool has_upper;
+};
+
+// The JITWrapper for the function evaluating a conjunction of column
+// predicates on the rows of a RowBlock. Contains the compiled function as
+// well as the projection and the predicate shapes used to generate it.
+class PredicateEvaluatorFunctions : public JITWrapper {
+ public:
+  // Returns the shapes of 'predicates' on the columns of 'projection' in
+  // 'shapes', in the same order. Returns NotSupported if any of the
+  // predicates can't be compiled: only comparisons of fixed-size integer and
+  // floating point columns and null checks are supported right now.
+  static Status GetShapes(const Schema& projection,
+                          const std::vector<ColumnPredicate>& predicates,
+                          std::vector<PredicateShape>* shapes);
+
+  // Compiles the evaluation function for the given projection and
+  // predicate shapes.
+  // Writes the llvm::TargetMachine* used to 'tm' (if not NULL)
+  // and the function to 'out' upon success.
+  static Status Create(const Schema& projection,
+                       const std::vector<PredicateShape>& shapes,
+                       scoped_refptr<PredicateEvaluatorFunctions>* out,
+                       llvm::TargetMachine** tm = NULL);
+
+  const Schema& projection() { return projection_; }
+
+  // Unselects the selected rows of the block which don't match all the
+  // predicates. The second argument holds the bounds of the predicates,
+  // in the order of the shapes: the lower bound (or the value of an
+  // equality predicate) of the i-th predicate at index 2 * i, and its upper
+  // bound at index 2 * i + 1.
+  typedef void(*EvaluationFunction)(RowBlock*, const void* const*);
+  EvaluationFunction evaluate() const { return evaluate_f_; }
+
+  virtual Status EncodeOwnKey(faststring* out) OVERRIDE {
+    return EncodeKey(projection_, shapes_, out);
+  }
+
+  static Status EncodeKey(const Schema& projection,
+                          const std::vector<PredicateShape>& shapes,
+                          faststring* out);
+
+ private:
+  PredicateEvaluatorFunctions(const Schema& projection,
+                              std::vector<PredicateShape> shapes,
+                              EvaluationFunction evaluate_f,
+                              std::unique_ptr<JITCodeOwner> owner);
+
+  const Schema projection_;
+  const std::vector<PredicateShape> shapes_;
+  const EvaluationFunction evaluate_f_;
+};
+
+// Evaluates a conjunction of column predicates on row blocks with a
+// codegenned function, the same way as evaluating each predicate with
+// ColumnPredicate::Evaluate() would.
+//
+// The bounds of the predicates must remain valid for the lifetime of this
+// object.
+class PredicateEvaluator {
+ public:
+  // Requires that the predicates have the shapes which were used to create
+  // 'functions', in the same order.
+  PredicateEvaluator(std::vector<ColumnPredicate> predicates,
+                     scoped_refptr<PredicateEvaluatorFunctions> functions);
+
+  // Unselects the selected rows of 'block' which don't match all the
+  // predicates. 'block' must have the projection schema of the functions.
+  void Evaluate(RowBlock* block) const {
+    functions_->evaluate()(block, bounds_.data());
+  }
+
+  const std::vector<ColumnPredicate>& predicates() const { return predicates_; }
+
+ private:
+  const std::vector<ColumnPredicate> predicates_;
+  std::vector<const void*> bounds_;
+  scoped_refptr<PredicateEvaluatorFunctions> functions_;
+
+  DISALLOW_COPY_AND_ASSIGN(PredicateEvaluator);
+};
+
+} // namespace codegen
+} // namespace kudu
@@ -19,27 +19,36 @@
 
 #include <cmath>
 #include <cstdint>
+#include <cstring>
+#include <limits>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <boost/optional/optional.hpp>
 #include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
+#include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/bitmap.h"
 #include "kudu/util/bloom_filter.h"
 #include "kudu/util/hash.pb.h"
 #include "kudu/util/int128.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/random.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
 using std::vector;
 
+DECLARE_bool(predicate_eval_use_avx2);
+
 namespace kudu {
 
 class TestColumnPredicate : public KuduTest {
@@ -960,6 +969,97 @@ class TestColumnPredicate : public KuduTest {
               PredicateType::None);
   }
 
+  // Adds values which don't fit in 64 bits to the domain of 128-bit types,
+  // including values whose high or low halves are equal.
+  template <typename T>
+  static void AddWideValues(vector<T>* /* domain */) {
+  }
+  static void AddWideValues(vector<int128_t>* domain) {
+    const int128_t k2To64 = static_cast<int128_t>(1) << 64;
+    for (int128_t v : { k2To64, k2To64 + 1, -k2To64, -k2To64 - 1,
+                        static_cast<int128_t>(UINT64_MAX),
+                        static_cast<int128_t>(INT64_MAX) + 1 }) {
+      domain->push_back(v);
+    }
+  }
+
+  // Test that evaluating predicates on a column block of the given type
+  // selects the same rows as evaluating them cell by cell.
+  template <DataType type>
+  void TestEvaluate() {
+    typedef typename DataTypeTraits<type>::cpp_type T;
+    ColumnSchema column("c", type, true);
+
+    // The values of the cells and predicates. Signed types get negative
+    // values, and unsigned types values with the high bit set.
+    vector<T> domain;
+    for (int i = 0; i < 20; i++) {
+      domain.push_back(static_cast<T>(static_cast<int64_t>(i) - 10));
+    }
+    AddWideValues(&domain);
+
+    // Use a number of rows which isn't a multiple of the kernels' 64.
+    const size_t kNumRows = 64 * 5 + 17;
+    ScopedColumnBlock<type> block(kNumRows);
+    SelectionVector orig_sel(kNumRows);
+    orig_sel.SetAllTrue();
+    for (size_t i = 0; i < kNumRows; i++) {
+      block[i] = domain[rand_.Uniform(domain.size())];
+      if (std::numeric_limits<T>::has_quiet_NaN && rand_.OneIn(10)) {
+        block[i] = std::numeric_limits<T>::quiet_NaN();
+      }
+      block.SetCellIsNull(i, rand_.OneIn(5));
+      // Deselect an entire group of 64 rows, and some other rows.
+      if ((i >= 64 && i < 128) || rand_.OneIn(8)) {
+        BitmapClear(orig_sel.mutable_bitmap(), i);
+      }
+    }
+
+    vector<ColumnPredicate> predicates;
+    for (int i = 0; i < 10; i++) {
+      const T* a = &domain[rand_.Uniform(domain.size())];
+      const T* b = &domain[rand_.Uniform(domain.size())];
+      if (column.type_info()->Compare(a, b) > 0) {
+        std::swap(a, b);
+      }
+      predicates.push_back(ColumnPredicate::Range(column, a, nullptr));
+      predicates.push_back(ColumnPredicate::Range(column, nullptr, b));
+      predicates.push_back(ColumnPredicate::Range(column, a, b));
+      predicates.push_back(ColumnPredicate::Equality(column, a));
+
+      vector<const void*> values = { a, b, &domain[rand_.Uniform(domain.size())] };
+      predicates.push_back(ColumnPredicate::InList(column, &values));
+    }
+    {
+      // An IN list longer than the kernels support.
+      vector<const void*> values;
+      for (size_t i = 0; i < domain.size(); i += 2) {
+        values.push_back(&domain[i]);
+      }
+      predicates.push_back(ColumnPredicate::InList(column, &values));
+    }
+
+    for (bool use_avx2 : { true, false }) {
+      FLAGS_predicate_eval_use_avx2 = use_avx2;
+      for (const auto& p : predicates) {
+        if (p.predicate_type() == PredicateType::None) {
+          continue;
+        }
+        SCOPED_TRACE(strings::Substitute("$0, avx2: $1", p.ToString(), use_avx2));
+        SelectionVector sel(kNumRows);
+        memcpy(sel.mutable_bitmap(), orig_sel.bitmap(), BitmapSize(kNumRows));
+        p.Evaluate(block, &sel);
+        for (size_t i = 0; i < kNumRows; i++) {
+          bool expected = orig_sel.IsRowSelected(i) &&
+                          !block.is_null(i) &&
+                          p.EvaluateCell(column.type_info()->physical_type(),
+                                         block.cell_ptr(i));
+          ASSERT_EQ(expected, sel.IsRowSelected(i)) << "row " << i;
+        }
+      }
+    }
+  }
+
  protected:
   Random rand_;
 };
@@ -1468,6 +1568,83 @@ TEST_F(TestColumnPredicate, TestEquals) {
   ASSERT_NE(ColumnPredicate::None(c1), ColumnPredicate::None(c1dflt));
 }
 
+// Test checking whether predicates may match values within bounds.
+TEST_F(TestColumnPredicate, TestMayMatchRange) {
+  ColumnSchema c("c", INT32, true);
+  int32_t five = 5;
+  int32_t ten = 10;
+  int32_t fifteen = 15;
+  int32_t twenty = 20;
+
+  // Values in [10, 15].
+  const void* min = &ten;
+  const void* max = &fifteen;
+
+  ASSERT_FALSE(ColumnPredicate::None(c).MayMatchRange(true, true, min, max));
+  ASSERT_TRUE(ColumnPredicate::IsNull(c).MayMatchRange(true, true, min, max));
+  ASSERT_FALSE(ColumnPredicate::IsNull(c).MayMatchRange(false, true, min, max));
+  ASSERT_TRUE(ColumnPredicate::IsNotNull(c).MayMatchRange(false, true, min, max));
+  ASSERT_FALSE(ColumnPredicate::IsNotNull(c).MayMatchRange(true, false, nullptr, nullptr));
+
+  ASSERT_TRUE(ColumnPredicate::Equality(c, &ten).MayMatchRange(false, true, min, max));
+  ASSERT_TRUE(ColumnPredicate::Equality(c, &fifteen).MayMatchRange(false, true, min, max));
+  ASSERT_FALSE(ColumnPredicate::Equality(c, &five).MayMatchRange(false, true, min, max));
+  ASSERT_FALSE(ColumnPredicate::Equality(c, &twenty).MayMatchRange(false, true, min, max));
+  ASSERT_FALSE(ColumnPredicate::Equality(c, &ten).MayMatchRange(true, false, nullptr, nullptr));
+  // Unbounded values may match anything.
+  ASSERT_TRUE(ColumnPredicate::Equality(c, &twenty).MayMatchRange(false, true, min, nullptr));
+  ASSERT_TRUE(ColumnPredicate::Equality(c, &five).MayMatchRange(false, true, nullptr, max));
+
+  // Ranges are inclusive of their lower bound, and exclusive of their upper bound.
+  ASSERT_TRUE(ColumnPredicate::Range(c, &five, &twenty).MayMatchRange(false, true, min, max));
+  ASSERT_TRUE(ColumnPredicate::Range(c, &fifteen, &twenty).MayMatchRange(false, true, min, max));
+  ASSERT_FALSE(ColumnPredicate::Range(c, &five, &ten).MayMatchRange(false, true, min, max));
+  ASSERT_TRUE(ColumnPredicate::Range(c, &five, &fifteen).MayMatchRange(false, true, min, max));
+  ASSERT_TRUE(ColumnPredicate::Range(c, nullptr, &fifteen).MayMatchRange(false, true, min, max));
+  ASSERT_FALSE(ColumnPredicate::Range(c, nullptr, &five).MayMatchRange(false, true, min, max));
+  ASSERT_FALSE(ColumnPredicate::Range(c, &twenty, nullptr).MayMatchRange(false, true, min, max));
+  ASSERT_TRUE(ColumnPredicate::Range(c, &twenty, nullptr).MayMatchRange(false, true, min, nullptr));
+
+  {
+    vector<const void*> values = { &five, &twenty };
+    ColumnPredicate p = ColumnPredicate::InList(c, &values);
+    ASSERT_FALSE(p.MayMatchRange(false, true, min, max));
+    ASSERT_TRUE(p.MayMatchRange(false, true, nullptr, max));
+    ASSERT_TRUE(p.MayMatchRange(false, true, min, nullptr));
+  }
+  {
+    vector<const void*> values = { &five, &fifteen, &twenty };
+    ColumnPredicate p = ColumnPredicate::InList(c, &values);
+    ASSERT_TRUE(p.MayMatchRange(false, true, min, max));
+    ASSERT_FALSE(p.MayMatchRange(true, false, nullptr, nullptr));
+  }
+
+  // Binary columns.
+  ColumnSchema s("s", STRING, true);
+  Slice a("a");
+  Slice b("b");
+  Slice bb("bb");
+  Slice c_val("c");
+  ASSERT_TRUE(ColumnPredicate::Equality(s, &bb).MayMatchRange(false, true, &b, &c_val));
+  ASSERT_FALSE(ColumnPredicate::Equality(s, &a).MayMatchRange(false, true, &b, &c_val));
+  ASSERT_FALSE(ColumnPredicate::Range(s, &a, &b).MayMatchRange(false, true, &b, &c_val));
+  ASSERT_TRUE(ColumnPredicate::Range(s, &a, &bb).MayMatchRange(false, true, &b, &c_val));
+}
+
+TEST_F(TestColumnPredicate, TestEvaluate) {
+  NO_FATALS(TestEvaluate<INT8>());
+  NO_FATALS(TestEvaluate<INT16>());
+  NO_FATALS(TestEvaluate<INT32>());
+  NO_FATALS(TestEvaluate<INT64>());
+  NO_FATALS(TestEvaluate<UINT32>());
+  NO_FATALS(TestEvaluate<UINT64>());
+  NO_FATALS(TestEvaluate<INT128>());
+  NO_FATALS(TestEvaluate<DECIMAL128>());
+  NO_FATALS(TestEvaluate<UNIXTIME_MICROS>());
+  NO_FATALS(TestEvaluate<FLOAT>());
+  NO_FATALS(TestEvaluate<DOUBLE>());
+}
+
 using TestColumnPredicateDeathTest = TestColumnPredicate;
 
 // Ensure that ColumnPredicate::Merge(other) requires the 'other' predicate to
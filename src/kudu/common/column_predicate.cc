@@ -22,25 +22,37 @@
 #include <iterator>
 
 #include <boost/optional/optional.hpp>
+#include <gflags/gflags.h>
 
+#include "kudu/common/column_predicate_kernels.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/key_util.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
+#include "kudu/gutil/cpu.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/bitmap.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/memory/arena.h"
 
+DEFINE_bool(predicate_eval_use_avx2, true,
+            "Whether to evaluate predicates using AVX2 instructions if the CPU "
+            "supports them. If false, SSE4.2 instructions are used instead.");
+TAG_FLAG(predicate_eval_use_avx2, hidden);
+
 using std::move;
 using std::string;
 using std::vector;
 
 namespace kudu {
 
+using predicate_kernels::CellType;
+using predicate_kernels::KernelTable;
+
 ColumnPredicate::ColumnPredicate(PredicateType predicate_type,
                                  ColumnSchema column,
                                  const void* lower,
@@ -646,10 +658,36 @@ void ColumnPredicate::MergeIntoBloomFilter(const ColumnPredicate &other) {
 }
 
 namespace {
+
+// Returns the kernels to use on this CPU.
+const KernelTable& GetKernels() {
+  static const bool kHasAvx2 = base::CPU().has_avx2();
+  if (kHasAvx2 && FLAGS_predicate_eval_use_avx2) {
+    return predicate_kernels::Avx2Kernels();
+  }
+  return predicate_kernels::Sse42Kernels();
+}
+
+// Sets '*cell_type' to the kernel cell type of columns of 'physical_type'.
+// Returns false if there are no kernels for the type.
+bool GetKernelCellType(DataType physical_type, CellType* cell_type) {
+  switch (physical_type) {
+    case INT32: *cell_type = predicate_kernels::kInt32; return true;
+    case UINT32: *cell_type = predicate_kernels::kUInt32; return true;
+    case INT64: *cell_type = predicate_kernels::kInt64; return true;
+    case UINT64: *cell_type = predicate_kernels::kUInt64; return true;
+    case FLOAT: *cell_type = predicate_kernels::kFloat; return true;
+    case DOUBLE: *cell_type = predicate_kernels::kDouble; return true;
+    case INT128: *cell_type = predicate_kernels::kInt128; return true;
+    default: return false;
+  }
+}
+
+// Applies the predicate 'p' to the rows of 'block' starting at 'start_row'.
 template <typename P>
-void ApplyPredicate(const ColumnBlock& block, SelectionVector* sel, P p) {
+void ApplyPredicate(const ColumnBlock& block, size_t start_row, SelectionVector* sel, P p) {
   if (block.is_nullable()) {
-    for (size_t i = 0; i < block.nrows(); i++) {
+    for (size_t i = start_row; i < block.nrows(); i++) {
       if (!sel->IsRowSelected(i)) continue;
       const void* cell = block.nullable_cell_ptr(i);
       if (cell == nullptr || !p(cell)) {
@@ -657,7 +695,7 @@ void ApplyPredicate(const ColumnBlock& block, SelectionVector* sel, P p) {
       }
     }
   } else {
-    for (size_t i = 0; i < block.nrows(); i++) {
+    for (size_t i = start_row; i < block.nrows(); i++) {
       if (!sel->IsRowSelected(i)) continue;
       const void* cell = block.cell_ptr(i);
       if (!p(cell)) {
@@ -668,21 +706,56 @@ void ApplyPredicate(const ColumnBlock& block, SelectionVector* sel, P p) {
 }
 } // anonymous namespace
 
+size_t ColumnPredicate::EvaluateWithKernels(const ColumnBlock& block,
+                                            SelectionVector* sel) const {
+  CellType cell_type;
+  if (!GetKernelCellType(block.type_info()->physical_type(), &cell_type)) {
+    return 0;
+  }
+  const size_t num_words = block.nrows() / 64;
+  if (num_words == 0) {
+    return 0;
+  }
+  const KernelTable& kernels = GetKernels();
+  const uint8_t* non_null = block.is_nullable() ? block.null_bitmap() : nullptr;
+  switch (predicate_type()) {
+    case PredicateType::Range:
+      kernels.range[cell_type](block.data(), num_words, non_null, sel->mutable_bitmap(),
+                               lower_, upper_);
+      break;
+    case PredicateType::Equality:
+      kernels.equality[cell_type](block.data(), num_words, non_null, sel->mutable_bitmap(),
+                                  lower_);
+      break;
+    case PredicateType::InList:
+      if (values_.size() > predicate_kernels::kMaxInListValues) {
+        return 0;
+      }
+      kernels.in_list[cell_type](block.data(), num_words, non_null, sel->mutable_bitmap(),
+                                 values_.data(), values_.size());
+      break;
+    default:
+      return 0;
+  }
+  return num_words * 64;
+}
+
 template <DataType PhysicalType>
 void ColumnPredicate::EvaluateForPhysicalType(const ColumnBlock& block,
                                               SelectionVector* sel) const {
   switch (predicate_type()) {
     case PredicateType::Range: {
+      size_t start_row = EvaluateWithKernels(block, sel);
       if (lower_ == nullptr) {
-        ApplyPredicate(block, sel, [this] (const void* cell) {
+        ApplyPredicate(block, start_row, sel, [this] (const void* cell) {
           return DataTypeTraits<PhysicalType>::Compare(cell, this->upper_) < 0;
         });
       } else if (upper_ == nullptr) {
-        ApplyPredicate(block, sel, [this] (const void* cell) {
+        ApplyPredicate(block, start_row, sel, [this] (const void* cell) {
           return DataTypeTraits<PhysicalType>::Compare(cell, this->lower_) >= 0;
         });
       } else {
-        ApplyPredicate(block, sel, [this] (const void* cell) {
+        ApplyPredicate(block, start_row, sel, [this] (const void* cell) {
           return DataTypeTraits<PhysicalType>::Compare(cell, this->upper_) < 0 &&
                  DataTypeTraits<PhysicalType>::Compare(cell, this->lower_) >= 0;
         });
@@ -690,7 +763,8 @@ void ColumnPredicate::EvaluateForPhysicalType(const ColumnBlock& block,
       return;
     };
     case PredicateType::Equality: {
-      ApplyPredicate(block, sel, [this] (const void* cell) {
+      size_t start_row = EvaluateWithKernels(block, sel);
+      ApplyPredicate(block, start_row, sel, [this] (const void* cell) {
         return DataTypeTraits<PhysicalType>::Compare(cell, this->lower_) == 0;
       });
       return;
@@ -721,7 +795,8 @@ void ColumnPredicate::EvaluateForPhysicalType(const ColumnBlock& block,
       return;
     }
     case PredicateType::InList: {
-      ApplyPredicate(block, sel, [this] (const void* cell) {
+      size_t start_row = EvaluateWithKernels(block, sel);
+      ApplyPredicate(block, start_row, sel, [this] (const void* cell) {
         return std::binary_search(values_.begin(), values_.end(), cell,
                                   [] (const void* lhs, const void* rhs) {
                                     return DataTypeTraits<PhysicalType>::Compare(lhs, rhs) < 0;
@@ -731,7 +806,7 @@ void ColumnPredicate::EvaluateForPhysicalType(const ColumnBlock& block,
     };
     case PredicateType::None: LOG(FATAL) << "NONE predicate evaluation";
     case PredicateType::InBloomFilter: {
-      ApplyPredicate(block, sel, [this] (const void* cell) {
+      ApplyPredicate(block, 0, sel, [this] (const void* cell) {
           return EvaluateCell<PhysicalType>(cell);
       });
       return;
@@ -759,6 +834,43 @@ bool ColumnPredicate::EvaluateCell(DataType type, const void* cell) const {
   }
 }
 
+bool ColumnPredicate::MayMatchRange(bool has_nulls, bool has_values,
+                                    const void* min, const void* max) const {
+  const TypeInfo* type_info = column_.type_info();
+  switch (predicate_type()) {
+    case PredicateType::None: return false;
+    case PredicateType::IsNull: return has_nulls;
+    case PredicateType::IsNotNull: return has_values;
+    case PredicateType::Equality: {
+      return has_values &&
+          (min == nullptr || type_info->Compare(lower_, min) >= 0) &&
+          (max == nullptr || type_info->Compare(lower_, max) <= 0);
+    };
+    case PredicateType::Range:
+    case PredicateType::InBloomFilter: {
+      // The predicate's range [lower_, upper_) overlaps [min, max] unless it
+      // lies entirely above or below it.
+      return has_values &&
+          (lower_ == nullptr || max == nullptr || type_info->Compare(lower_, max) <= 0) &&
+          (upper_ == nullptr || min == nullptr || type_info->Compare(upper_, min) > 0);
+    };
+    case PredicateType::InList: {
+      if (!has_values) return false;
+      // The values are sorted, so only the smallest value not less than 'min'
+      // needs to be checked against 'max'.
+      auto it = values_.begin();
+      if (min != nullptr) {
+        it = std::lower_bound(values_.begin(), values_.end(), min,
+                              [&] (const void* lhs, const void* rhs) {
+                                return type_info->Compare(lhs, rhs) < 0;
+                              });
+      }
+      return it != values_.end() && (max == nullptr || type_info->Compare(*it, max) <= 0);
+    };
+  }
+  LOG(FATAL) << "unknown predicate type";
+}
+
 void ColumnPredicate::Evaluate(const ColumnBlock& block, SelectionVector* sel) const {
   DCHECK(sel);
   switch (block.type_info()->physical_type()) {
@@ -225,6 +225,17 @@ class ColumnPredicate {
   // Otherwise, use EvaluateCell<DataType>.
   bool EvaluateCell(DataType type, const void* cell) const;
 
+  // Returns whether the predicate may match any value of a set of cells about
+  // which only the following is known: whether any of them is NULL
+  // ('has_nulls'), whether any of them isn't ('has_values'), and inclusive
+  // bounds 'min' and 'max' on the non-NULL values. A null 'min' or 'max'
+  // means that the values are unbounded in that direction.
+  //
+  // A false result guarantees that none of the cells match; a true result
+  // may be a false positive.
+  bool MayMatchRange(bool has_nulls, bool has_values,
+                     const void* min, const void* max) const;
+
   // Print the predicate for debugging.
   std::string ToString() const;
 
@@ -370,6 +381,12 @@ class ColumnPredicate {
   void EvaluateForPhysicalType(const ColumnBlock& block,
                                SelectionVector* sel) const;
 
+  // Evaluates the predicate on the leading rows of 'block' in groups of 64
+  // using vectorized kernels, if the predicate and the column's type have
+  // them. Returns the number of rows evaluated, which is 0 if the kernels
+  // couldn't be used.
+  size_t EvaluateWithKernels(const ColumnBlock& block, SelectionVector* sel) const;
+
   // Evaluate the bloom filter and avoid the predicate type check on a single cell.
   template <DataType PhysicalType>
   bool EvaluateCellForBloomFilter(const void* cell) const {
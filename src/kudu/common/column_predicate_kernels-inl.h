@@ -0,0 +1,158 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// The instruction set independent parts of the predicate kernels, included
+// by the translation unit of each instruction set.
+//
+// NOTE: the translation units including this file are compiled with
+// different instruction sets. To keep the linker from picking a copy of an
+// inline function compiled for an instruction set the CPU doesn't support,
+// this file must not use any inline functions defined outside of it, and the
+// 'Ops' types it's instantiated with must have internal linkage.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "kudu/common/column_predicate_kernels.h"
+
+namespace kudu {
+namespace predicate_kernels {
+
+// Implements the kernels for a vector type and cell type described by 'Ops',
+// which provides:
+//
+//   typedef ... T;                  // the cell type
+//   typedef ... Vec;                // the vector type
+//   static const int kLanes;        // the number of cells in a vector
+//   static Vec Load(const T* p);    // loads kLanes cells from 'p'
+//   static Vec Set1(T v);           // broadcasts 'v' to every lane
+//
+// and the following lane comparisons, returning a bitmask of the lanes for
+// which the comparison holds:
+//
+//   static uint32_t Ge(Vec v, Vec lower);  // v >= lower
+//   static uint32_t Lt(Vec v, Vec upper);  // v < upper
+//   static uint32_t Eq(Vec v, Vec value);  // v == value
+template <class Ops>
+struct Kernels {
+  typedef typename Ops::T T;
+  typedef typename Ops::Vec Vec;
+
+  static_assert(64 % Ops::kLanes == 0, "lanes must evenly divide a word");
+
+  // Returns the bitmask of the 64 cells starting at 'cells' which satisfy
+  // 'pred', a function from a vector to its bitmask.
+  template <class Pred>
+  static uint64_t Match64(const T* cells, const Pred& pred) {
+    uint64_t mask = 0;
+    for (int i = 0; i < 64; i += Ops::kLanes) {
+      mask |= static_cast<uint64_t>(pred(Ops::Load(cells + i))) << i;
+    }
+    return mask;
+  }
+
+  template <class Pred>
+  static void Apply(const void* cells, size_t num_words, const uint8_t* non_null,
+                    uint8_t* sel, const Pred& pred) {
+    const T* c = reinterpret_cast<const T*>(cells);
+    for (size_t w = 0; w < num_words; w++, c += 64) {
+      uint64_t sel_word;
+      memcpy(&sel_word, sel + w * 8, 8);
+      if (non_null != nullptr) {
+        uint64_t non_null_word;
+        memcpy(&non_null_word, non_null + w * 8, 8);
+        sel_word &= non_null_word;
+      }
+      if (sel_word != 0) {
+        sel_word &= Match64(c, pred);
+      }
+      memcpy(sel + w * 8, &sel_word, 8);
+    }
+  }
+
+  static T LoadValue(const void* v) {
+    T t;
+    memcpy(&t, v, sizeof(T));
+    return t;
+  }
+
+  static void Range(const void* cells, size_t num_words, const uint8_t* non_null,
+                    uint8_t* sel, const void* lower, const void* upper) {
+    if (lower == nullptr && upper == nullptr) {
+      Apply(cells, num_words, non_null, sel, [](Vec) { return ~0U; });
+    } else if (lower == nullptr) {
+      const Vec u = Ops::Set1(LoadValue(upper));
+      Apply(cells, num_words, non_null, sel, [&](Vec v) { return Ops::Lt(v, u); });
+    } else if (upper == nullptr) {
+      const Vec l = Ops::Set1(LoadValue(lower));
+      Apply(cells, num_words, non_null, sel, [&](Vec v) { return Ops::Ge(v, l); });
+    } else {
+      const Vec l = Ops::Set1(LoadValue(lower));
+      const Vec u = Ops::Set1(LoadValue(upper));
+      Apply(cells, num_words, non_null, sel, [&](Vec v) {
+        return Ops::Ge(v, l) & Ops::Lt(v, u);
+      });
+    }
+  }
+
+  static void Equality(const void* cells, size_t num_words, const uint8_t* non_null,
+                       uint8_t* sel, const void* value) {
+    const Vec x = Ops::Set1(LoadValue(value));
+    Apply(cells, num_words, non_null, sel, [&](Vec v) { return Ops::Eq(v, x); });
+  }
+
+  static void InList(const void* cells, size_t num_words, const uint8_t* non_null,
+                     uint8_t* sel, const void* const* values, size_t num_values) {
+    Vec xs[kMaxInListValues];
+    for (size_t i = 0; i < num_values; i++) {
+      xs[i] = Ops::Set1(LoadValue(values[i]));
+    }
+    Apply(cells, num_words, non_null, sel, [&](Vec v) {
+      uint32_t mask = 0;
+      for (size_t i = 0; i < num_values; i++) {
+        mask |= Ops::Eq(v, xs[i]);
+      }
+      return mask;
+    });
+  }
+};
+
+// Builds the kernel table of the instruction set whose 'Ops' types for each
+// cell type are given.
+template <class Int32Ops, class UInt32Ops, class Int64Ops, class UInt64Ops,
+          class FloatOps, class DoubleOps, class Int128Ops>
+constexpr KernelTable MakeKernelTable() {
+  return KernelTable{
+    { &Kernels<Int32Ops>::Range, &Kernels<UInt32Ops>::Range,
+      &Kernels<Int64Ops>::Range, &Kernels<UInt64Ops>::Range,
+      &Kernels<FloatOps>::Range, &Kernels<DoubleOps>::Range,
+      &Kernels<Int128Ops>::Range },
+    { &Kernels<Int32Ops>::Equality, &Kernels<UInt32Ops>::Equality,
+      &Kernels<Int64Ops>::Equality, &Kernels<UInt64Ops>::Equality,
+      &Kernels<FloatOps>::Equality, &Kernels<DoubleOps>::Equality,
+      &Kernels<Int128Ops>::Equality },
+    { &Kernels<Int32Ops>::InList, &Kernels<UInt32Ops>::InList,
+      &Kernels<Int64Ops>::InList, &Kernels<UInt64Ops>::InList,
+      &Kernels<FloatOps>::InList, &Kernels<DoubleOps>::InList,
+      &Kernels<Int128Ops>::InList },
+  };
+}
+
+} // namespace predicate_kernels
+} // namespace kudu
@@ -0,0 +1,164 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// The SSE4.2 predicate kernels.
+
+#include <nmmintrin.h>
+
+#include <cstdint>
+
+#include "kudu/common/column_predicate_kernels-inl.h"
+#include "kudu/common/column_predicate_kernels.h"
+#include "kudu/util/int128.h"
+
+namespace kudu {
+namespace predicate_kernels {
+
+namespace {
+
+template <typename CellType, bool kUnsigned>
+struct Sse42Int32Ops {
+  typedef CellType T;
+  typedef __m128i Vec;
+  static const int kLanes = 4;
+
+  static Vec Bias(Vec v) {
+    // Unsigned comparisons are done as signed comparisons of the values with
+    // their sign bits flipped.
+    return kUnsigned ? _mm_xor_si128(v, _mm_set1_epi32(INT32_MIN)) : v;
+  }
+  static Vec Load(const T* p) {
+    return Bias(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+  }
+  static Vec Set1(T v) { return Bias(_mm_set1_epi32(static_cast<int32_t>(v))); }
+  static uint32_t Gt(Vec a, Vec b) {
+    return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(a, b)));
+  }
+  static uint32_t Ge(Vec v, Vec lower) { return ~Gt(lower, v) & 0xf; }
+  static uint32_t Lt(Vec v, Vec upper) { return Gt(upper, v); }
+  static uint32_t Eq(Vec v, Vec value) {
+    return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, value)));
+  }
+};
+
+template <typename CellType, bool kUnsigned>
+struct Sse42Int64Ops {
+  typedef CellType T;
+  typedef __m128i Vec;
+  static const int kLanes = 2;
+
+  static Vec Bias(Vec v) {
+    return kUnsigned ? _mm_xor_si128(v, _mm_set1_epi64x(INT64_MIN)) : v;
+  }
+  static Vec Load(const T* p) {
+    return Bias(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+  }
+  static Vec Set1(T v) { return Bias(_mm_set1_epi64x(static_cast<int64_t>(v))); }
+  static uint32_t Gt(Vec a, Vec b) {
+    return _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(a, b)));
+  }
+  static uint32_t Ge(Vec v, Vec lower) { return ~Gt(lower, v) & 0x3; }
+  static uint32_t Lt(Vec v, Vec upper) { return Gt(upper, v); }
+  static uint32_t Eq(Vec v, Vec value) {
+    return _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(v, value)));
+  }
+};
+
+// Floating point comparisons treat NaNs the way DataTypeTraits::Compare()
+// does, i.e. as equal to every value: NaN >= lower and NaN == value hold,
+// but NaN < upper doesn't.
+struct Sse42FloatOps {
+  typedef float T;
+  typedef __m128 Vec;
+  static const int kLanes = 4;
+
+  static Vec Load(const T* p) { return _mm_loadu_ps(p); }
+  static Vec Set1(T v) { return _mm_set1_ps(v); }
+  static uint32_t Ge(Vec v, Vec lower) { return _mm_movemask_ps(_mm_cmpnlt_ps(v, lower)); }
+  static uint32_t Lt(Vec v, Vec upper) { return _mm_movemask_ps(_mm_cmplt_ps(v, upper)); }
+  static uint32_t Eq(Vec v, Vec value) {
+    return _mm_movemask_ps(_mm_or_ps(_mm_cmpeq_ps(v, value), _mm_cmpunord_ps(v, value)));
+  }
+};
+
+struct Sse42DoubleOps {
+  typedef double T;
+  typedef __m128d Vec;
+  static const int kLanes = 2;
+
+  static Vec Load(const T* p) { return _mm_loadu_pd(p); }
+  static Vec Set1(T v) { return _mm_set1_pd(v); }
+  static uint32_t Ge(Vec v, Vec lower) { return _mm_movemask_pd(_mm_cmpnlt_pd(v, lower)); }
+  static uint32_t Lt(Vec v, Vec upper) { return _mm_movemask_pd(_mm_cmplt_pd(v, upper)); }
+  static uint32_t Eq(Vec v, Vec value) {
+    return _mm_movemask_pd(_mm_or_pd(_mm_cmpeq_pd(v, value), _mm_cmpunord_pd(v, value)));
+  }
+};
+
+// 128-bit integers are compared as pairs of 64-bit halves: the signed high
+// halves, and then the low halves, which are biased to be compared as
+// unsigned. A vector holds the halves of two cells in separate registers.
+struct Sse42Int128Ops {
+  typedef int128_t T;
+  struct Vec {
+    __m128i hi;
+    __m128i lo;
+  };
+  static const int kLanes = 2;
+
+  static __m128i BiasLo(__m128i v) { return _mm_xor_si128(v, _mm_set1_epi64x(INT64_MIN)); }
+  static Vec Load(const T* p) {
+    // Each cell is little-endian: its low half comes first.
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+    return Vec{ _mm_unpackhi_epi64(a, b), BiasLo(_mm_unpacklo_epi64(a, b)) };
+  }
+  static Vec Set1(T v) {
+    return Vec{ _mm_set1_epi64x(static_cast<int64_t>(v >> 64)),
+                BiasLo(_mm_set1_epi64x(static_cast<int64_t>(static_cast<uint64_t>(v)))) };
+  }
+  static uint32_t Gt(Vec a, Vec b) {
+    const __m128i gt = _mm_or_si128(_mm_cmpgt_epi64(a.hi, b.hi),
+                                    _mm_and_si128(_mm_cmpeq_epi64(a.hi, b.hi),
+                                                  _mm_cmpgt_epi64(a.lo, b.lo)));
+    return _mm_movemask_pd(_mm_castsi128_pd(gt));
+  }
+  static uint32_t Ge(Vec v, Vec lower) { return ~Gt(lower, v) & 0x3; }
+  static uint32_t Lt(Vec v, Vec upper) { return Gt(upper, v); }
+  static uint32_t Eq(Vec v, Vec value) {
+    const __m128i eq = _mm_and_si128(_mm_cmpeq_epi64(v.hi, value.hi),
+                                     _mm_cmpeq_epi64(v.lo, value.lo));
+    return _mm_movemask_pd(_mm_castsi128_pd(eq));
+  }
+};
+
+constexpr KernelTable kSse42Kernels = MakeKernelTable<Sse42Int32Ops<int32_t, false>,
+                                                  Sse42Int32Ops<uint32_t, true>,
+                                                  Sse42Int64Ops<int64_t, false>,
+                                                  Sse42Int64Ops<uint64_t, true>,
+                                                  Sse42FloatOps,
+                                                  Sse42DoubleOps,
+                                                  Sse42Int128Ops>();
+
+} // anonymous namespace
+
+const KernelTable& Sse42Kernels() {
+  return kSse42Kernels;
+}
+
+} // namespace predicate_kernels
+} // namespace kudu
@@ -0,0 +1,81 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Vectorized kernels evaluating column predicates on fixed-width columns,
+// 64 rows at a time. These are an implementation detail of ColumnPredicate.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace kudu {
+namespace predicate_kernels {
+
+// The cell types which have kernels.
+enum CellType {
+  kInt32,
+  kUInt32,
+  kInt64,
+  kUInt64,
+  kFloat,
+  kDouble,
+  kInt128,
+  kNumCellTypes
+};
+
+// The maximum number of values of an IN list which may be evaluated by the
+// kernels.
+constexpr size_t kMaxInListValues = 16;
+
+// Each kernel evaluates a predicate over 'num_words' groups of 64 contiguous
+// cells starting at 'cells', ANDing the results into the corresponding
+// little-endian 64-bit words of the selection bitmap 'sel'. If 'non_null' is
+// not null, rows whose bit is unset in it are deselected as well. Groups
+// without any selected rows are not evaluated.
+//
+// The predicate semantics match those of ColumnPredicate::EvaluateCell(),
+// including the treatment of floating point NaNs.
+
+// Selects a cell if (lower == nullptr || cell >= *lower) and
+// (upper == nullptr || cell < *upper).
+typedef void (*RangeKernel)(const void* cells, size_t num_words, const uint8_t* non_null,
+                            uint8_t* sel, const void* lower, const void* upper);
+
+// Selects a cell if cell == *value.
+typedef void (*EqualityKernel)(const void* cells, size_t num_words, const uint8_t* non_null,
+                               uint8_t* sel, const void* value);
+
+// Selects a cell if it's equal to one of the 'num_values' values, which may
+// be at most kMaxInListValues.
+typedef void (*InListKernel)(const void* cells, size_t num_words, const uint8_t* non_null,
+                             uint8_t* sel, const void* const* values, size_t num_values);
+
+struct KernelTable {
+  RangeKernel range[kNumCellTypes];
+  EqualityKernel equality[kNumCellTypes];
+  InListKernel in_list[kNumCellTypes];
+};
+
+// Kernels using SSE4.2 instructions, which every supported CPU has.
+const KernelTable& Sse42Kernels();
+
+// Kernels using AVX2 instructions. Must only be used if the CPU supports
+// AVX2.
+const KernelTable& Avx2Kernels();
+
+} // namespace predicate_kernels
+} // namespace kudu
@@ -0,0 +1,178 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// The AVX2 predicate kernels. This file is compiled with -mavx2, and its
+// kernels are only used if the CPU supports AVX2.
+
+#include <immintrin.h>
+
+#include <cstdint>
+
+#include "kudu/common/column_predicate_kernels-inl.h"
+#include "kudu/common/column_predicate_kernels.h"
+#include "kudu/util/int128.h"
+
+namespace kudu {
+namespace predicate_kernels {
+
+namespace {
+
+template <typename CellType, bool kUnsigned>
+struct Avx2Int32Ops {
+  typedef CellType T;
+  typedef __m256i Vec;
+  static const int kLanes = 8;
+
+  static Vec Bias(Vec v) {
+    // Unsigned comparisons are done as signed comparisons of the values with
+    // their sign bits flipped.
+    return kUnsigned ? _mm256_xor_si256(v, _mm256_set1_epi32(INT32_MIN)) : v;
+  }
+  static Vec Load(const T* p) {
+    return Bias(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+  }
+  static Vec Set1(T v) { return Bias(_mm256_set1_epi32(static_cast<int32_t>(v))); }
+  static uint32_t Gt(Vec a, Vec b) {
+    return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(a, b)));
+  }
+  static uint32_t Ge(Vec v, Vec lower) { return ~Gt(lower, v) & 0xff; }
+  static uint32_t Lt(Vec v, Vec upper) { return Gt(upper, v); }
+  static uint32_t Eq(Vec v, Vec value) {
+    return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, value)));
+  }
+};
+
+template <typename CellType, bool kUnsigned>
+struct Avx2Int64Ops {
+  typedef CellType T;
+  typedef __m256i Vec;
+  static const int kLanes = 4;
+
+  static Vec Bias(Vec v) {
+    return kUnsigned ? _mm256_xor_si256(v, _mm256_set1_epi64x(INT64_MIN)) : v;
+  }
+  static Vec Load(const T* p) {
+    return Bias(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+  }
+  static Vec Set1(T v) { return Bias(_mm256_set1_epi64x(static_cast<int64_t>(v))); }
+  static uint32_t Gt(Vec a, Vec b) {
+    return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(a, b)));
+  }
+  static uint32_t Ge(Vec v, Vec lower) { return ~Gt(lower, v) & 0xf; }
+  static uint32_t Lt(Vec v, Vec upper) { return Gt(upper, v); }
+  static uint32_t Eq(Vec v, Vec value) {
+    return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, value)));
+  }
+};
+
+// Floating point comparisons treat NaNs the way DataTypeTraits::Compare()
+// does, i.e. as equal to every value: NaN >= lower and NaN == value hold,
+// but NaN < upper doesn't.
+struct Avx2FloatOps {
+  typedef float T;
+  typedef __m256 Vec;
+  static const int kLanes = 8;
+
+  static Vec Load(const T* p) { return _mm256_loadu_ps(p); }
+  static Vec Set1(T v) { return _mm256_set1_ps(v); }
+  static uint32_t Ge(Vec v, Vec lower) {
+    return _mm256_movemask_ps(_mm256_cmp_ps(v, lower, _CMP_NLT_UQ));
+  }
+  static uint32_t Lt(Vec v, Vec upper) {
+    return _mm256_movemask_ps(_mm256_cmp_ps(v, upper, _CMP_LT_OQ));
+  }
+  static uint32_t Eq(Vec v, Vec value) {
+    return _mm256_movemask_ps(_mm256_cmp_ps(v, value, _CMP_EQ_UQ));
+  }
+};
+
+struct Avx2DoubleOps {
+  typedef double T;
+  typedef __m256d Vec;
+  static const int kLanes = 4;
+
+  static Vec Load(const T* p) { return _mm256_loadu_pd(p); }
+  static Vec Set1(T v) { return _mm256_set1_pd(v); }
+  static uint32_t Ge(Vec v, Vec lower) {
+    return _mm256_movemask_pd(_mm256_cmp_pd(v, lower, _CMP_NLT_UQ));
+  }
+  static uint32_t Lt(Vec v, Vec upper) {
+    return _mm256_movemask_pd(_mm256_cmp_pd(v, upper, _CMP_LT_OQ));
+  }
+  static uint32_t Eq(Vec v, Vec value) {
+    return _mm256_movemask_pd(_mm256_cmp_pd(v, value, _CMP_EQ_UQ));
+  }
+};
+
+// 128-bit integers are compared as pairs of 64-bit halves: the signed high
+// halves, and then the low halves, which are biased to be compared as
+// unsigned. A vector holds the halves of four cells in separate registers.
+struct Avx2Int128Ops {
+  typedef int128_t T;
+  struct Vec {
+    __m256i hi;
+    __m256i lo;
+  };
+  static const int kLanes = 4;
+
+  static __m256i BiasLo(__m256i v) {
+    return _mm256_xor_si256(v, _mm256_set1_epi64x(INT64_MIN));
+  }
+  static Vec Load(const T* p) {
+    // Each cell is little-endian: its low half comes first. Unpacking works
+    // within 128-bit lanes, leaving the halves of the cells in the order
+    // 0, 2, 1, 3, which the permutations restore.
+    const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 2));
+    return Vec{ _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(a, b), 0xd8),
+                BiasLo(_mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), 0xd8)) };
+  }
+  static Vec Set1(T v) {
+    return Vec{ _mm256_set1_epi64x(static_cast<int64_t>(v >> 64)),
+                BiasLo(_mm256_set1_epi64x(static_cast<int64_t>(static_cast<uint64_t>(v)))) };
+  }
+  static uint32_t Gt(Vec a, Vec b) {
+    const __m256i gt = _mm256_or_si256(_mm256_cmpgt_epi64(a.hi, b.hi),
+                                       _mm256_and_si256(_mm256_cmpeq_epi64(a.hi, b.hi),
+                                                        _mm256_cmpgt_epi64(a.lo, b.lo)));
+    return _mm256_movemask_pd(_mm256_castsi256_pd(gt));
+  }
+  static uint32_t Ge(Vec v, Vec lower) { return ~Gt(lower, v) & 0xf; }
+  static uint32_t Lt(Vec v, Vec upper) { return Gt(upper, v); }
+  static uint32_t Eq(Vec v, Vec value) {
+    const __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi64(v.hi, value.hi),
+                                        _mm256_cmpeq_epi64(v.lo, value.lo));
+    return _mm256_movemask_pd(_mm256_castsi256_pd(eq));
+  }
+};
+
+constexpr KernelTable kAvx2Kernels = MakeKernelTable<Avx2Int32Ops<int32_t, false>,
+                                                 Avx2Int32Ops<uint32_t, true>,
+                                                 Avx2Int64Ops<int64_t, false>,
+                                                 Avx2Int64Ops<uint64_t, true>,
+                                                 Avx2FloatOps,
+                                                 Avx2DoubleOps,
+                                                 Avx2Int128Ops>();
+
+} // anonymous namespace
+
+const KernelTable& Avx2Kernels() {
+  return kAvx2Kernels;
+}
+
+} // namespace predicate_kernels
+} // namespace kudu
@@ -0,0 +1,185 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/columnar_serialization.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/common/row.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/bitmap.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/test_util.h"
+
+using std::string;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+class ColumnarSerializationTest : public KuduTest {
+ public:
+  ColumnarSerializationTest()
+      : schema_({ ColumnSchema("key", INT32),
+                  ColumnSchema("str", STRING, true /* nullable */),
+                  ColumnSchema("val", INT64, true /* nullable */) },
+                1),
+        arena_(1024) {
+  }
+
+  // Fill 'block' with rows where row 'i' has key 'i + key_base'. Every third
+  // row has NULL cells in the nullable columns.
+  void FillRowBlock(RowBlock* block, int key_base) {
+    block->selection_vector()->SetAllTrue();
+    for (int i = 0; i < block->nrows(); i++) {
+      RowBlockRow row = block->row(i);
+      int key = i + key_base;
+      *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(0)) = key;
+      bool is_null = key % 3 == 0;
+      row.cell(1).set_null(is_null);
+      row.cell(2).set_null(is_null);
+      // Leave garbage in the NULL cells to check that it isn't serialized.
+      Slice s;
+      CHECK(arena_.RelocateSlice(Substitute("val-$0", key), &s));
+      *reinterpret_cast<Slice*>(row.mutable_cell_ptr(1)) = s;
+      *reinterpret_cast<int64_t*>(row.mutable_cell_ptr(2)) = key * 10L;
+    }
+  }
+
+ protected:
+  Schema schema_;
+  Arena arena_;
+};
+
+TEST_F(ColumnarSerializationTest, TestRoundTrip) {
+  const int kNumRows = 100;
+  Arena block_arena(1024);
+  RowBlock block(schema_, kNumRows, &block_arena);
+
+  // Serialize two blocks with different selection vectors, so that the
+  // destination bitmaps are appended at non byte-aligned offsets.
+  ColumnarSerializedBatch batch(schema_, schema_);
+  vector<int> expected_keys;
+  FillRowBlock(&block, 0);
+  for (int i = 0; i < kNumRows; i++) {
+    if (i % 7 == 0) {
+      block.selection_vector()->SetRowUnselected(i);
+    } else {
+      expected_keys.push_back(i);
+    }
+  }
+  batch.AddRowBlock(block);
+  FillRowBlock(&block, kNumRows);
+  for (int i = 0; i < kNumRows; i++) {
+    expected_keys.push_back(i + kNumRows);
+  }
+  batch.AddRowBlock(block);
+  ASSERT_EQ(expected_keys.size(), batch.num_rows());
+
+  const auto& cols = batch.columns();
+  ASSERT_EQ(3, cols.size());
+  // The key column is non-nullable and fixed-width.
+  ASSERT_EQ(nullptr, cols[0].varlen_data);
+  ASSERT_EQ(nullptr, cols[0].non_null_bitmap);
+  // The string column has offsets and varlen data.
+  ASSERT_NE(nullptr, cols[1].varlen_data);
+  ASSERT_NE(nullptr, cols[1].non_null_bitmap);
+  ASSERT_EQ((expected_keys.size() + 1) * sizeof(uint32_t), cols[1].data->size());
+  ASSERT_EQ(expected_keys.size() * sizeof(int64_t), cols[2].data->size());
+
+  const int32_t* keys = reinterpret_cast<const int32_t*>(cols[0].data->data());
+  const uint8_t* offsets = cols[1].data->data();
+  const uint8_t* str_bitmap = cols[1].non_null_bitmap->data();
+  const int64_t* vals = reinterpret_cast<const int64_t*>(cols[2].data->data());
+  const uint8_t* val_bitmap = cols[2].non_null_bitmap->data();
+  for (int i = 0; i < expected_keys.size(); i++) {
+    SCOPED_TRACE(i);
+    int key = expected_keys[i];
+    ASSERT_EQ(key, keys[i]);
+    bool is_null = key % 3 == 0;
+    ASSERT_EQ(!is_null, BitmapTest(str_bitmap, i));
+    ASSERT_EQ(!is_null, BitmapTest(val_bitmap, i));
+
+    uint32_t start = UNALIGNED_LOAD32(offsets + i * sizeof(uint32_t));
+    uint32_t end = UNALIGNED_LOAD32(offsets + (i + 1) * sizeof(uint32_t));
+    Slice str(cols[1].varlen_data->data() + start, end - start);
+    if (is_null) {
+      ASSERT_EQ(0, str.size());
+      ASSERT_EQ(0, vals[i]);
+    } else {
+      ASSERT_EQ(Substitute("val-$0", key), str.ToString());
+      ASSERT_EQ(key * 10L, vals[i]);
+    }
+  }
+  ASSERT_EQ(batch.TotalSizeBytes(),
+            cols[0].data->size() +
+            cols[1].data->size() + cols[1].varlen_data->size() +
+            cols[1].non_null_bitmap->size() +
+            cols[2].data->size() + cols[2].non_null_bitmap->size());
+}
+
+// Test that only the columns of the client projection are serialized, in the
+// order of the projection.
+TEST_F(ColumnarSerializationTest, TestProjection) {
+  const int kNumRows = 10;
+  Arena block_arena(1024);
+  RowBlock block(schema_, kNumRows, &block_arena);
+  FillRowBlock(&block, 1);
+
+  Schema projection({ ColumnSchema("val", INT64, true /* nullable */),
+                      ColumnSchema("key", INT32) }, 0);
+  ColumnarSerializedBatch batch(schema_, projection);
+  batch.AddRowBlock(block);
+  ASSERT_EQ(kNumRows, batch.num_rows());
+  const auto& cols = batch.columns();
+  ASSERT_EQ(2, cols.size());
+  ASSERT_NE(nullptr, cols[0].non_null_bitmap);
+  ASSERT_EQ(kNumRows * sizeof(int64_t), cols[0].data->size());
+  ASSERT_EQ(nullptr, cols[1].non_null_bitmap);
+  ASSERT_EQ(kNumRows * sizeof(int32_t), cols[1].data->size());
+  const int32_t* keys = reinterpret_cast<const int32_t*>(cols[1].data->data());
+  for (int i = 0; i < kNumRows; i++) {
+    ASSERT_EQ(i + 1, keys[i]);
+  }
+}
+
+// Test serializing a block with an empty projection, as for a COUNT(*) scan.
+TEST_F(ColumnarSerializationTest, TestNoColumns) {
+  Schema empty(vector<ColumnSchema>(), 0);
+  Arena block_arena(1024);
+  RowBlock block(empty, 1000, &block_arena);
+  block.selection_vector()->SetAllTrue();
+  for (int i = 0; i < 100; i++) {
+    block.selection_vector()->SetRowUnselected(i * 2);
+  }
+  ColumnarSerializedBatch batch(empty, empty);
+  batch.AddRowBlock(block);
+  ASSERT_EQ(900, batch.num_rows());
+  ASSERT_EQ(0, batch.TotalSizeBytes());
+}
+
+} // namespace kudu
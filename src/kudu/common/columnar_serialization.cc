@@ -0,0 +1,224 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/columnar_serialization.h"
+
+#include <cstring>
+#include <limits>
+
+#include <glog/logging.h>
+
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/fastmem.h"
+#include "kudu/util/bitmap.h"
+#include "kudu/util/slice.h"
+
+namespace kudu {
+
+namespace {
+
+// Append 'num_bits' bits from 'src' starting at 'src_offset' to the bitmap
+// 'dst', which currently holds 'dst_num_bits' bits.
+void AppendBits(const uint8_t* src, size_t src_offset, size_t num_bits,
+                faststring* dst, size_t dst_num_bits) {
+  size_t new_num_bits = dst_num_bits + num_bits;
+  size_t old_size = dst->size();
+  dst->resize(BitmapSize(new_num_bits));
+  if (dst->size() > old_size) {
+    memset(dst->data() + old_size, 0, dst->size() - old_size);
+  }
+  uint8_t* dst_bits = dst->data();
+  // Fast path: both sides byte-aligned, copy whole bytes.
+  if (src_offset % 8 == 0 && dst_num_bits % 8 == 0) {
+    size_t whole_bytes = num_bits / 8;
+    memcpy(dst_bits + dst_num_bits / 8, src + src_offset / 8, whole_bytes);
+    src_offset += whole_bytes * 8;
+    dst_num_bits += whole_bytes * 8;
+    num_bits -= whole_bytes * 8;
+  }
+  for (size_t i = 0; i < num_bits; i++) {
+    if (BitmapTest(src, src_offset + i)) {
+      BitmapSet(dst_bits, dst_num_bits + i);
+    }
+  }
+}
+
+template<bool IS_NULLABLE>
+void CopyFixedWidthColumn(const ColumnBlock& column_block,
+                          const SelectionVector& sel,
+                          size_t cell_size,
+                          int64_t dst_row_offset,
+                          ColumnarSerializedBatch::Column* dst) {
+  size_t num_selected = sel.CountSelected();
+  size_t old_size = dst->data->size();
+  dst->data->resize(old_size + num_selected * cell_size);
+  uint8_t* dst_data = dst->data->data() + old_size;
+
+  const uint8_t* src = column_block.data();
+  BitmapIterator selected_row_iter(sel.bitmap(), sel.nrows());
+  bool selected;
+  size_t run_size;
+  size_t row_idx = 0;
+  int64_t dst_row = dst_row_offset;
+  while ((run_size = selected_row_iter.Next(&selected))) {
+    if (selected) {
+      // Copy the whole run of selected cells at once. This is the common case
+      // for scans without predicates, where the whole block is one run.
+      strings::memcpy_inlined(dst_data, src + row_idx * cell_size, run_size * cell_size);
+      if (IS_NULLABLE) {
+        AppendBits(column_block.null_bitmap(), row_idx, run_size,
+                   dst->non_null_bitmap.get(), dst_row);
+        // Zero out NULL cells so that we don't leak unrelated data to the client.
+        for (size_t i = 0; i < run_size; i++) {
+          if (column_block.is_null(row_idx + i)) {
+            memset(dst_data + i * cell_size, 0, cell_size);
+          }
+        }
+      }
+      dst_data += run_size * cell_size;
+      dst_row += run_size;
+    }
+    row_idx += run_size;
+  }
+}
+
+template<bool IS_NULLABLE>
+void CopyBinaryColumn(const ColumnBlock& column_block,
+                      const SelectionVector& sel,
+                      int64_t dst_row_offset,
+                      ColumnarSerializedBatch::Column* dst) {
+  faststring* varlen = dst->varlen_data.get();
+  const Slice* src = reinterpret_cast<const Slice*>(column_block.data());
+
+  // Compute the total size of the selected values up front so that the
+  // varlen buffer is grown at most once per block.
+  size_t total_varlen = 0;
+  size_t num_selected = 0;
+  for (size_t i = 0; i < sel.nrows(); i++) {
+    if (!sel.IsRowSelected(i)) continue;
+    num_selected++;
+    if (IS_NULLABLE && column_block.is_null(i)) continue;
+    total_varlen += src[i].size();
+  }
+  CHECK_LE(varlen->size() + total_varlen, std::numeric_limits<uint32_t>::max())
+      << "columnar varlen data too large";
+
+  size_t old_offsets_size = dst->data->size();
+  dst->data->resize(old_offsets_size + num_selected * sizeof(uint32_t));
+  uint8_t* dst_offsets = dst->data->data() + old_offsets_size;
+  size_t old_varlen_size = varlen->size();
+  varlen->resize(old_varlen_size + total_varlen);
+  uint8_t* dst_varlen = varlen->data();
+  uint32_t cur_offset = old_varlen_size;
+
+  int64_t dst_row = dst_row_offset;
+  for (size_t i = 0; i < sel.nrows(); i++) {
+    if (!sel.IsRowSelected(i)) continue;
+    bool is_null = IS_NULLABLE && column_block.is_null(i);
+    if (IS_NULLABLE) {
+      AppendBits(column_block.null_bitmap(), i, 1, dst->non_null_bitmap.get(), dst_row);
+    }
+    if (!is_null) {
+      strings::memcpy_inlined(dst_varlen + cur_offset, src[i].data(), src[i].size());
+      cur_offset += src[i].size();
+    }
+    // The offset array has one more entry than there are rows: the entry for
+    // row 'i' is the end offset of its value.
+    UNALIGNED_STORE32(dst_offsets, cur_offset);
+    dst_offsets += sizeof(uint32_t);
+    dst_row++;
+  }
+}
+
+} // anonymous namespace
+
+ColumnarSerializedBatch::ColumnarSerializedBatch(const Schema& rowblock_schema,
+                                                 const Schema& client_projection_schema)
+    : num_rows_(0) {
+  int num_cols = client_projection_schema.num_columns();
+  rowblock_col_idxs_.reserve(num_cols);
+  is_varlen_.reserve(num_cols);
+  cell_sizes_.reserve(num_cols);
+  columns_.resize(num_cols);
+  for (int i = 0; i < num_cols; i++) {
+    const ColumnSchema& col = client_projection_schema.column(i);
+    int rowblock_idx = rowblock_schema.find_column(col.name());
+    CHECK_NE(rowblock_idx, Schema::kColumnNotFound) << col.name();
+    rowblock_col_idxs_.push_back(rowblock_idx);
+    bool is_varlen = col.type_info()->physical_type() == BINARY;
+    is_varlen_.push_back(is_varlen);
+    cell_sizes_.push_back(col.type_info()->size());
+    columns_[i].data.reset(new faststring());
+    if (is_varlen) {
+      columns_[i].varlen_data.reset(new faststring());
+      // The offsets array starts with the start offset of the first value.
+      uint32_t zero = 0;
+      columns_[i].data->append(&zero, sizeof(zero));
+    }
+    if (col.is_nullable()) {
+      columns_[i].non_null_bitmap.reset(new faststring());
+    }
+  }
+}
+
+void ColumnarSerializedBatch::AddRowBlock(const RowBlock& block) {
+  const SelectionVector& sel = *block.selection_vector();
+  size_t num_selected = sel.CountSelected();
+  if (num_selected == 0) return;
+
+  for (int i = 0; i < columns_.size(); i++) {
+    ColumnBlock column_block = block.column_block(rowblock_col_idxs_[i]);
+    Column* dst = &columns_[i];
+    bool nullable = dst->non_null_bitmap != nullptr;
+    DCHECK_EQ(nullable, column_block.is_nullable());
+    if (is_varlen_[i]) {
+      if (nullable) {
+        CopyBinaryColumn<true>(column_block, sel, num_rows_, dst);
+      } else {
+        CopyBinaryColumn<false>(column_block, sel, num_rows_, dst);
+      }
+    } else {
+      if (nullable) {
+        CopyFixedWidthColumn<true>(column_block, sel, cell_sizes_[i], num_rows_, dst);
+      } else {
+        CopyFixedWidthColumn<false>(column_block, sel, cell_sizes_[i], num_rows_, dst);
+      }
+    }
+  }
+  num_rows_ += num_selected;
+}
+
+int64_t ColumnarSerializedBatch::TotalSizeBytes() const {
+  int64_t total = 0;
+  for (const auto& col : columns_) {
+    total += col.data->size();
+    if (col.varlen_data) {
+      total += col.varlen_data->size();
+    }
+    if (col.non_null_bitmap) {
+      total += col.non_null_bitmap->size();
+    }
+  }
+  return total;
+}
+
+} // namespace kudu
@@ -0,0 +1,92 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/faststring.h"
+
+namespace kudu {
+
+class RowBlock;
+class Schema;
+
+// A batch of rows serialized in columnar layout, as returned to clients
+// which set the COLUMNAR_LAYOUT row format flag on a scan.
+//
+// Each projected column is serialized into its own set of buffers:
+//
+// - 'data': for fixed-width types, the cell values of the selected rows,
+//   packed contiguously. For BINARY-based types (STRING, BINARY), an array of
+//   num_rows + 1 little-endian uint32 offsets into 'varlen_data', such that
+//   the value of row 'i' spans [offsets[i], offsets[i + 1]).
+//
+// - 'varlen_data': only for BINARY-based types, the concatenated cell values.
+//
+// - 'non_null_bitmap': only for nullable columns, a bitmap with a bit set for
+//   each non-NULL cell. The contents of 'data' for NULL cells are zeroed.
+//
+// The buffers are meant to be attached to the response as RPC sidecars, so
+// that clients can hand them to vectorized readers without re-pivoting rows.
+class ColumnarSerializedBatch {
+ public:
+  struct Column {
+    std::unique_ptr<faststring> data;
+    // Only set for BINARY-based columns.
+    std::unique_ptr<faststring> varlen_data;
+    // Only set for nullable columns.
+    std::unique_ptr<faststring> non_null_bitmap;
+  };
+
+  // Create an empty batch for the columns in 'client_projection_schema'.
+  // The row blocks passed to AddRowBlock() must all have 'rowblock_schema',
+  // which must be a superset of 'client_projection_schema'.
+  ColumnarSerializedBatch(const Schema& rowblock_schema,
+                          const Schema& client_projection_schema);
+
+  // Append the selected rows of 'block' to the batch.
+  void AddRowBlock(const RowBlock& block);
+
+  // The total number of rows serialized so far.
+  int64_t num_rows() const { return num_rows_; }
+
+  // The total size in bytes of the serialized buffers.
+  int64_t TotalSizeBytes() const;
+
+  std::vector<Column>* mutable_columns() { return &columns_; }
+  const std::vector<Column>& columns() const { return columns_; }
+
+ private:
+  // For each column in the client projection, the corresponding index in the
+  // row block schema.
+  std::vector<int> rowblock_col_idxs_;
+  // Whether the column at the same index in 'columns_' is BINARY-based.
+  std::vector<bool> is_varlen_;
+  // The cell size in bytes of each column.
+  std::vector<size_t> cell_sizes_;
+
+  std::vector<Column> columns_;
+  int64_t num_rows_;
+
+  DISALLOW_COPY_AND_ASSIGN(ColumnarSerializedBatch);
+};
+
+} // namespace kudu
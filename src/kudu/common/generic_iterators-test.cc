@@ -45,6 +45,7 @@
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
+#include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/mathlimits.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -54,6 +55,7 @@
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
+#include "kudu/util/threadpool.h"
 
 DEFINE_int32(num_lists, 3, "Number of lists to merge");
 DEFINE_int32(num_rows, 1000, "Number of entries per list");
@@ -433,6 +435,128 @@ TEST(TestMergeIterator, TestDeDupGhostRows) {
                       /*include_deleted_rows=*/true));
 }
 
+// Test that the merge copies the blocks of sub-iterators whose key ranges
+// don't overlap without comparing each of their rows.
+TEST(TestMergeIterator, TestMergeBypassesNonOverlappingBlocks) {
+  const int kNumLists = 100;
+  const int kRowsPerList = 1000;
+  const int kNumInterleavedLists = 10;
+  vector<unique_ptr<RowwiseIterator>> to_merge;
+  for (int i = 0; i < kNumLists; i++) {
+    // Interleave the first lists in pairs, to exercise the per-row merge as
+    // well.
+    vector<uint32_t> ints;
+    for (int j = 0; j < kRowsPerList; j++) {
+      ints.emplace_back(i < kNumInterleavedLists ?
+                        (i / 2) * 2 * kRowsPerList + j * 2 + i % 2 :
+                        i * kRowsPerList + j);
+    }
+    unique_ptr<VectorIterator> vec_it(new VectorIterator(std::move(ints)));
+    vec_it->set_block_size(100);
+    to_merge.emplace_back(NewMaterializingIterator(std::move(vec_it)));
+  }
+  unique_ptr<RowwiseIterator> merger(
+      NewMergeIterator(MergeIteratorOptions(/*include_deleted_rows=*/false),
+                       std::move(to_merge)));
+  ASSERT_OK(merger->Init(nullptr));
+
+  RowBlock dst(kIntSchema, 100, nullptr);
+  uint32_t expected = 0;
+  while (merger->HasNext()) {
+    ASSERT_OK(merger->NextBlock(&dst));
+    for (int i = 0; i < dst.nrows(); i++) {
+      ASSERT_EQ(expected++, *kIntSchema.ExtractColumnFromRow<UINT32>(dst.row(i), kValColIdx));
+    }
+  }
+  ASSERT_EQ(kNumLists * kRowsPerList, expected);
+
+  // Merging the rows one at a time would take several comparisons per row.
+  // Only the interleaved lists should need them, the blocks of the others are
+  // copied after a few comparisons each.
+  int64_t num_comparisons = GetMergeIteratorNumComparisonsForTests(merger);
+  LOG(INFO) << "Total number of comparisons performed: " << num_comparisons;
+  ASSERT_LT(num_comparisons, kNumLists * kRowsPerList);
+}
+
+// Test that the ParallelUnionIterator returns the rows of all its inputs, with
+// the blocks read concurrently and fewer buffered blocks than inputs.
+TEST(TestParallelUnionIterator, TestUnion) {
+  const int kNumLists = 20;
+  const int kRowsPerList = 1000;
+  unique_ptr<ThreadPool> pool;
+  {
+    gscoped_ptr<ThreadPool> pool_ptr;
+    ASSERT_OK(ThreadPoolBuilder("scan").set_max_threads(4).Build(&pool_ptr));
+    pool.reset(pool_ptr.release());
+  }
+
+  // Deselect some of the rows, and filter out some others with a predicate
+  // which is evaluated by each sub-iterator.
+  TestIntRangePredicate predicate(100, MathLimits<uint32_t>::kMax);
+  vector<unique_ptr<SelectionVector>> selection_vectors;
+  unordered_set<uint32_t> expected;
+  vector<unique_ptr<RowwiseIterator>> to_union;
+  for (int i = 0; i < kNumLists; i++) {
+    vector<uint32_t> ints;
+    unique_ptr<SelectionVector> sv(new SelectionVector(kRowsPerList));
+    for (int j = 0; j < kRowsPerList; j++) {
+      uint32_t val = i * kRowsPerList + j;
+      ints.emplace_back(val);
+      if (j % 7 == 0) {
+        sv->SetRowUnselected(j);
+      } else {
+        sv->SetRowSelected(j);
+        if (val >= 100) {
+          expected.insert(val);
+        }
+      }
+    }
+    unique_ptr<VectorIterator> vec_it(new VectorIterator(std::move(ints)));
+    vec_it->set_block_size(64);
+    vec_it->set_selection_vector(sv.get());
+    selection_vectors.emplace_back(std::move(sv));
+    to_union.emplace_back(NewMaterializingIterator(std::move(vec_it)));
+  }
+
+  unique_ptr<RowwiseIterator> iter(NewParallelUnionIterator(
+      ParallelUnionIteratorOptions(pool.get(), /*max_concurrency=*/3,
+                                   /*max_buffered_blocks=*/2),
+      std::move(to_union)));
+  ScanSpec spec;
+  spec.AddPredicate(predicate.pred_);
+  ASSERT_OK(iter->Init(&spec));
+
+  unordered_set<uint32_t> actual;
+  RowBlock dst(kIntSchema, 50, nullptr);
+  while (iter->HasNext()) {
+    ASSERT_OK(iter->NextBlock(&dst));
+    for (int i = 0; i < dst.nrows(); i++) {
+      ASSERT_TRUE(dst.selection_vector()->IsRowSelected(i));
+      uint32_t val = *kIntSchema.ExtractColumnFromRow<UINT32>(dst.row(i), kValColIdx);
+      ASSERT_TRUE(actual.insert(val).second) << "duplicate row " << val;
+    }
+  }
+  ASSERT_EQ(expected, actual);
+
+  // Destroying an iterator in the middle of a scan stops its reads.
+  to_union.clear();
+  for (int i = 0; i < kNumLists; i++) {
+    vector<uint32_t> ints(kRowsPerList, i);
+    unique_ptr<VectorIterator> vec_it(new VectorIterator(std::move(ints)));
+    vec_it->set_block_size(10);
+    to_union.emplace_back(NewMaterializingIterator(std::move(vec_it)));
+  }
+  iter = NewParallelUnionIterator(
+      ParallelUnionIteratorOptions(pool.get(), /*max_concurrency=*/4,
+                                   /*max_buffered_blocks=*/4),
+      std::move(to_union));
+  ASSERT_OK(iter->Init(nullptr));
+  ASSERT_TRUE(iter->HasNext());
+  ASSERT_OK(iter->NextBlock(&dst));
+  ASSERT_GT(dst.nrows(), 0);
+  iter.reset();
+}
+
 // Test that the MaterializingIterator properly evaluates predicates when they apply
 // to single columns.
 TEST(TestMaterializingIterator, TestMaterializingPredicatePushdown) {
@@ -27,7 +27,6 @@
 #include <ostream>
 #include <string>
 #include <unordered_map>
-#include <unordered_set>
 #include <utility>
 
 #include <gflags/gflags.h>
@@ -49,10 +48,13 @@
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/condition_variable.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/memory/arena.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/object_pool.h"
+#include "kudu/util/threadpool.h"
 
 using std::deque;
 using std::get;
@@ -63,7 +65,6 @@ using std::shared_ptr;
 using std::sort;
 using std::string;
 using std::unique_ptr;
-using std::unordered_set;
 using std::vector;
 using strings::Substitute;
 
@@ -116,6 +117,13 @@ class MergeIterState {
     return next_row_;
   }
 
+  // Returns the last valid row of the current block. IsFullyExhausted() must
+  // return false at the time this method is invoked.
+  const RowBlockRow& last_row() const {
+    DCHECK_LT(rows_advanced_, rows_valid_);
+    return last_row_;
+  }
+
   // Initialize the underlying iterator to point to the first valid row, if
   // any. This method should be called before calling any other methods.
   Status Init() {
@@ -162,6 +170,9 @@ class MergeIterState {
   // The row currently pointed to by the iterator.
   RowBlockRow next_row_;
 
+  // The last selected row in read_block_.
+  RowBlockRow last_row_;
+
   // Row index of next_row_ in read_block_.
   size_t next_row_idx_;
 
@@ -214,6 +225,11 @@ Status MergeIterState::PullNextBlock() {
     // Seek next_row_ to the first selected row.
     CHECK(selection->FindFirstRowSelected(&next_row_idx_));
     next_row_.Reset(&read_block_, next_row_idx_);
+    size_t last_row_idx = read_block_.nrows() - 1;
+    while (!selection->IsRowSelected(last_row_idx)) {
+      last_row_idx--;
+    }
+    last_row_.Reset(&read_block_, last_row_idx);
     return Status::OK();
   }
 
@@ -260,6 +276,29 @@ class MergeIterator : public RowwiseIterator {
   Status MaterializeBlock(RowBlock* dst);
   Status InitSubIterators(ScanSpec *spec);
 
+  // Returns true if the next row of the sub-iterator at leaf 'a' of the loser
+  // tree sorts before the one at leaf 'b'. Exhausted leaves sort last, and
+  // ties are broken by the leaf index.
+  bool LeafWins(int a, int b);
+
+  // Builds the loser tree over leaves_.
+  void BuildLoserTree();
+
+  // Replays the matches on the path of the leaf 'leaf' to the root of the
+  // loser tree, after the next row of its sub-iterator changed.
+  //
+  // 'leaf' must have been the winner of the tree before the change.
+  void ReplayLeaf(int leaf);
+
+  // Returns true if the last row of the current block of the winner of the
+  // loser tree sorts before the next rows of all the other sub-iterators, so
+  // that the rest of the block can be copied without comparisons.
+  bool WinnerBlockPrecedesOthers();
+
+  // Advances the sub-iterator at leaf 'leaf', which must be the winner of the
+  // loser tree, removing it if it's exhausted.
+  Status AdvanceWinner(int leaf);
+
   const MergeIteratorOptions opts_;
 
   // Initialized during Init.
@@ -280,6 +319,17 @@ class MergeIterator : public RowwiseIterator {
   mutable rw_spinlock states_lock_;
   vector<unique_ptr<MergeIterState>> states_;
 
+  // The leaves of the loser tree used to find the smallest next row across
+  // the sub-iterators: a pointer into states_ or null once a sub-iterator is
+  // exhausted. Unlike states_, the leaves keep their indexes for the lifetime
+  // of the MergeIterator.
+  vector<MergeIterState*> leaves_;
+
+  // The internal nodes of the loser tree, laid out like a binary heap with
+  // the leaves following them: losers_[n] is the leaf which lost the match at
+  // node n, for 0 < n < leaves_.size(). losers_[0] is the overall winner.
+  vector<int> losers_;
+
   // Statistics (keyed by projection column index) accumulated so far by any
   // fully-consumed sub-iterators.
   vector<IteratorStats> finished_iter_stats_by_col_;
@@ -359,6 +409,11 @@ Status MergeIterator::Init(ScanSpec *spec) {
       }),
       states_.end());
 
+  for (const auto& s : states_) {
+    leaves_.emplace_back(s.get());
+  }
+  BuildLoserTree();
+
   initted_ = true;
   return Status::OK();
 }
@@ -410,121 +465,173 @@ void MergeIterator::PrepareBatch(RowBlock* dst) {
   dst->Resize(std::min(dst->row_capacity(), available));
 }
 
+bool MergeIterator::LeafWins(int a, int b) {
+  const MergeIterState* state_a = leaves_[a];
+  const MergeIterState* state_b = leaves_[b];
+  if (PREDICT_FALSE(state_a == nullptr)) return false;
+  if (PREDICT_FALSE(state_b == nullptr)) return true;
+  num_comparisons_++;
+  int cmp = schema_->Compare(state_a->next_row(), state_b->next_row());
+  return cmp < 0 || (cmp == 0 && a < b);
+}
+
+void MergeIterator::BuildLoserTree() {
+  // Play the leaves in one at a time: the first leaf to reach a node waits
+  // there, and the second one plays the match against it, leaving the loser
+  // at the node and carrying the winner up.
+  const int num_leaves = leaves_.size();
+  losers_.assign(num_leaves, -1);
+  for (int leaf = 0; leaf < num_leaves; leaf++) {
+    int winner = leaf;
+    int node = (leaf + num_leaves) / 2;
+    for (; node > 0 && losers_[node] != -1; node /= 2) {
+      if (LeafWins(losers_[node], winner)) {
+        std::swap(losers_[node], winner);
+      }
+    }
+    losers_[node] = winner;
+  }
+}
+
+void MergeIterator::ReplayLeaf(int leaf) {
+  DCHECK_EQ(leaf, losers_[0]);
+  const int num_leaves = leaves_.size();
+  int winner = leaf;
+  for (int node = (leaf + num_leaves) / 2; node > 0; node /= 2) {
+    if (LeafWins(losers_[node], winner)) {
+      std::swap(losers_[node], winner);
+    }
+  }
+  losers_[0] = winner;
+}
+
+bool MergeIterator::WinnerBlockPrecedesOthers() {
+  // The runner-up lost only to the winner, so it's one of the losers on the
+  // winner's path to the root.
+  const int num_leaves = leaves_.size();
+  const int winner = losers_[0];
+  const RowBlockRow& last_row = leaves_[winner]->last_row();
+  for (int node = (winner + num_leaves) / 2; node > 0; node /= 2) {
+    const MergeIterState* other = leaves_[losers_[node]];
+    if (other == nullptr) continue;
+    num_comparisons_++;
+    if (schema_->Compare(last_row, other->next_row()) >= 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Status MergeIterator::AdvanceWinner(int leaf) {
+  MergeIterState* state = leaves_[leaf];
+  RETURN_NOT_OK(state->Advance());
+  if (PREDICT_FALSE(state->IsFullyExhausted())) {
+    leaves_[leaf] = nullptr;
+    std::lock_guard<rw_spinlock> l(states_lock_);
+    state->AddStats(&finished_iter_stats_by_col_);
+    states_.erase(std::find_if(states_.begin(), states_.end(),
+                               [state](const unique_ptr<MergeIterState>& s) {
+                                 return s.get() == state;
+                               }));
+  }
+  ReplayLeaf(leaf);
+  return Status::OK();
+}
+
 // TODO(todd): this is an obvious spot to add codegen - there's a ton of branching
 // and such around the comparisons. A simple experiment indicated there's some
 // 2x to be gained.
 Status MergeIterator::MaterializeBlock(RowBlock *dst) {
-  // We need a vector to track the iterators whose next_row() contains the
-  // smallest row key at a given moment during the merge because there may be
-  // multiple deleted rows with the same row key across multiple rowsets, and
-  // up to one live instance, that we have to deduplicate.
-  vector<MergeIterState*> smallest(states_.size());
-
   // Initialize the selection vector.
   // MergeIterState only returns selected rows.
   dst->selection_vector()->SetAllTrue();
   size_t dst_row_idx = 0;
-  while (dst_row_idx < dst->nrows()) {
 
-    // Find the sub-iterator that is currently smallest.
-    smallest.clear();
-
-    // Typically the number of states_ is not that large, so using a priority
-    // queue is not worth it.
-    for (const auto& iter : states_) {
-      // To merge in row key order, we need to consume the smallest row at any
-      // given time. We locate that row by peeking at the next row in each of
-      // the states_ iterators, which includes all possible candidates for the
-      // next row in key order.
-      int cmp;
-      if (!smallest.empty()) {
-        // If we have a candidate for smallest row, compare it against the
-        // smallest row in each iterator.
-        cmp = schema_->Compare(iter->next_row(), smallest[0]->next_row());
-        num_comparisons_++;
-      }
-      if (smallest.empty() || cmp < 0) {
-        // If we have no candidates for the next row yet, or the row found is
-        // smaller than the previously-smallest, replace the smallest with the
-        // new row found.
-        smallest.clear();
-        smallest.emplace_back(iter.get());
-      } else if (!smallest.empty() && cmp == 0) {
-        // If we have found a duplicate of the smallest row, at least one must
-        // be a ghost row. Collect all duplicates in order to merge them later.
-        smallest.emplace_back(iter.get());
+  // The leaf which won the last match, and whether its current block was
+  // already checked for the bypass below. A sub-iterator is only checked once
+  // it wins twice in a row, so that interleaved inputs don't pay for it.
+  int last_winner = -1;
+  bool bypass_checked = false;
+  while (dst_row_idx < dst->nrows()) {
+    // The winner of the loser tree has the smallest next row. If it's
+    // exhausted, so are all the other sub-iterators.
+    const int winner = losers_[0];
+    MergeIterState* state = leaves_[winner];
+    if (PREDICT_FALSE(state == nullptr)) break;
+
+    if (winner != last_winner) {
+      last_winner = winner;
+      bypass_checked = false;
+    } else if (!bypass_checked) {
+      bypass_checked = true;
+      if (WinnerBlockPrecedesOthers()) {
+        // The rest of the winner's block sorts before every other row, so it
+        // can be copied as a run. There are no duplicates to deduplicate
+        // either, since the block's rows are strictly smaller than the others.
+        size_t num_rows = std::min(state->remaining_in_block(),
+                                   dst->nrows() - dst_row_idx);
+        for (size_t i = 0; i < num_rows - 1; i++) {
+          RowBlockRow dst_row = dst->row(dst_row_idx++);
+          RETURN_NOT_OK(CopyRow(state->next_row(), &dst_row, dst->arena()));
+          RETURN_NOT_OK(state->Advance());
+        }
+        // The last row may pull the next block or exhaust the sub-iterator, in
+        // which case the tree needs replaying.
+        RowBlockRow dst_row = dst->row(dst_row_idx++);
+        RETURN_NOT_OK(CopyRow(state->next_row(), &dst_row, dst->arena()));
+        RETURN_NOT_OK(AdvanceWinner(winner));
+        // If the winner stays on top, check its next block right away.
+        bypass_checked = false;
+        continue;
       }
     }
 
-    // If no iterators had any row left, then we're done iterating.
-    if (PREDICT_FALSE(smallest.empty())) break;
+    RowBlockRow dst_row = dst->row(dst_row_idx++);
+    RETURN_NOT_OK(CopyRow(state->next_row(), &dst_row, dst->arena()));
+    RETURN_NOT_OK(AdvanceWinner(winner));
 
-    MergeIterState* row_to_return_iter = nullptr;
     if (!opts_.include_deleted_rows) {
       // Since deleted rows are not included here, there can only be a single
-      // instance of any given row key in 'smallest'.
-      CHECK_EQ(1, smallest.size()) << "expected only a single smallest row";
-      row_to_return_iter = smallest[0];
-    } else {
-      // Deduplicate any deleted rows. Row instance de-duplication criteria:
-      // 1. If there is a non-deleted instance, return that instance.
-      // 2. If all rows are deleted, any instance will suffice because we
-      //    don't guarantee that we will return valid field values for deleted
-      //    rows.
-      int live_rows_found = 0;
-      for (const auto& s : smallest) {
-        bool is_deleted =
-            *schema_->ExtractColumnFromRow<IS_DELETED>(s->next_row(), is_deleted_col_index_);
-        if (!is_deleted) {
-          // We found the single live instance of the row.
-          row_to_return_iter = s;
+      // instance of any given row key.
+      continue;
+    }
+
+    // There may be multiple deleted instances of the row with the same row
+    // key across multiple rowsets, and up to one live instance, that we have to
+    // deduplicate. They're the next winners of the tree. Row instance
+    // de-duplication criteria:
+    // 1. If there is a non-deleted instance, return that instance.
+    // 2. If all rows are deleted, any instance will suffice because we
+    //    don't guarantee that we will return valid field values for deleted
+    //    rows.
+    bool is_deleted = *schema_->ExtractColumnFromRow<IS_DELETED>(dst_row, is_deleted_col_index_);
+#ifndef NDEBUG
+    int live_rows_found = is_deleted ? 0 : 1;
+#endif
+    while (true) {
+      const int dup = losers_[0];
+      MergeIterState* dup_state = leaves_[dup];
+      if (dup_state == nullptr) break;
+      num_comparisons_++;
+      if (schema_->Compare(dup_state->next_row(), dst_row) != 0) break;
+      bool dup_is_deleted =
+          *schema_->ExtractColumnFromRow<IS_DELETED>(dup_state->next_row(), is_deleted_col_index_);
+      if (!dup_is_deleted) {
 #ifndef NDEBUG
-          live_rows_found++; // In DEBUG mode, do a sanity-check count of the live rows.
-#else
-          break; // In RELEASE mode, short-circuit the loop.
+        live_rows_found++;
 #endif
+        if (is_deleted) {
+          // Replace the deleted instance with the single live one. The memory
+          // of the deleted instance stays in the arena until the next batch.
+          RETURN_NOT_OK(CopyRow(dup_state->next_row(), &dst_row, dst->arena()));
+          is_deleted = false;
         }
       }
-      DCHECK_LE(live_rows_found, 1) << "expected at most one live row";
-
-      // If all instances of a given row are deleted then return an arbitrary
-      // deleted instance.
-      if (row_to_return_iter == nullptr) {
-        row_to_return_iter = smallest[0];
-        DCHECK(*schema_->ExtractColumnFromRow<IS_DELETED>(row_to_return_iter->next_row(),
-                                                          is_deleted_col_index_))
-            << "expected deleted row";
-      }
-    }
-    RowBlockRow dst_row = dst->row(dst_row_idx++);
-    RETURN_NOT_OK(CopyRow(row_to_return_iter->next_row(), &dst_row, dst->arena()));
-
-    // Advance all matching sub-iterators and mark exhausted sub-iterators for
-    // removal.
-    unordered_set<MergeIterState*> exhausted;
-    for (MergeIterState* s : smallest) {
-      RETURN_NOT_OK(s->Advance());
-      if (s->IsFullyExhausted()) {
-        InsertOrDie(&exhausted, s);
-      }
-    }
-
-    // Remove the exhausted sub-iterators.
-    if (!exhausted.empty()) {
-      std::lock_guard<rw_spinlock> l(states_lock_);
-      for (MergeIterState* s : exhausted) {
-        s->AddStats(&finished_iter_stats_by_col_);
-      }
-      // TODO(mpercy): Consider making removal O(1) per element to remove by
-      // using a different data structure for 'states_'. The below
-      // erase-remove idiom gives us O(n) removal on a vector for an
-      // arbitrary number of elements to remove at once.
-      states_.erase(std::remove_if(states_.begin(), states_.end(),
-                                   [&exhausted](const unique_ptr<MergeIterState>& state) {
-                                     return ContainsKey(exhausted, state.get());
-                                   }),
-                    states_.end());
+      RETURN_NOT_OK(AdvanceWinner(dup));
     }
+    DCHECK_LE(live_rows_found, 1) << "expected at most one live row";
+    // The duplicates were consumed on this sub-iterator's behalf.
+    last_winner = -1;
   }
 
   // The number of rows actually copied to the destination RowBlock may be less
@@ -751,6 +858,359 @@ unique_ptr<RowwiseIterator> NewUnionIterator(
   return unique_ptr<RowwiseIterator>(new UnionIterator(std::move(iters)));
 }
 
+////////////////////////////////////////////////////////////
+// ParallelUnionIterator
+////////////////////////////////////////////////////////////
+
+// The number of rows in each block read by the ParallelUnionIterator.
+static const int kParallelUnionRowBuffer = 1000;
+
+// An iterator which unions the results of other iterators, like the
+// UnionIterator, but reads several of them concurrently on a thread pool. The
+// blocks of rows are returned in the order they were read, interleaving the
+// sub-iterators.
+//
+// The sub-iterators read ahead of the caller into a bounded number of blocks,
+// which bounds the memory used by the iterator: once all the blocks are full,
+// the reads pause until the caller consumes one.
+class ParallelUnionIterator : public RowwiseIterator {
+ public:
+  // Constructs a ParallelUnionIterator of the given iterators.
+  //
+  // The iterators must have matching schemas and should not yet be initialized.
+  ParallelUnionIterator(ParallelUnionIteratorOptions opts,
+                        vector<unique_ptr<RowwiseIterator>> iters);
+
+  // Waits for the reads in flight to finish.
+  virtual ~ParallelUnionIterator();
+
+  Status Init(ScanSpec *spec) OVERRIDE;
+
+  bool HasNext() const OVERRIDE;
+
+  string ToString() const OVERRIDE;
+
+  const Schema& schema() const OVERRIDE {
+    CHECK(initted_);
+    return *schema_;
+  }
+
+  void GetIteratorStats(vector<IteratorStats>* stats) const OVERRIDE;
+
+  Status NextBlock(RowBlock* dst) OVERRIDE;
+
+ private:
+  // A block of rows read from a sub-iterator.
+  struct Block {
+    explicit Block(const Schema& schema)
+        : arena(1024),
+          rows(schema, kParallelUnionRowBuffer, &arena) {
+    }
+
+    Arena arena;
+    RowBlock rows;
+  };
+
+  // A sub-iterator, along with its statistics as of the last block read from
+  // it. Only one thread at a time reads from a sub-iterator.
+  struct SubIterator {
+    unique_ptr<RowwiseIterator> iter;
+
+    // Protected by lock_. Cleared once the sub-iterator is exhausted.
+    vector<IteratorStats> stats;
+  };
+
+  // Submits reads of the pending sub-iterators, as long as there are free
+  // blocks to read into and the maximum concurrency isn't reached.
+  void StartReadsUnlocked();
+
+  // Reads blocks from 'sub' until it's exhausted, or until there are no free
+  // blocks left, in which case it's queued to be read later.
+  void ReadSubIterator(SubIterator* sub);
+
+  const ParallelUnionIteratorOptions opts_;
+
+  // Initialized during Init.
+  unique_ptr<Schema> schema_;
+
+  bool initted_;
+
+  // The number of iterators, used by ToString().
+  const int num_orig_iters_;
+
+  vector<unique_ptr<SubIterator>> sub_iters_;
+
+  // The copies of the scan spec used to initialize the sub-iterators. See
+  // UnionIterator::scan_spec_copies_ for details.
+  ObjectPool<ScanSpec> scan_spec_copies_;
+
+  // The token on which the sub-iterators are read.
+  unique_ptr<ThreadPoolToken> token_;
+
+  // Protects the members below.
+  mutable Mutex lock_;
+
+  // Signaled when a block is read, or when a read stops.
+  ConditionVariable cond_;
+
+  // The sub-iterators which are neither exhausted nor being read, in the order
+  // in which they should be read. The paused sub-iterators come first.
+  deque<SubIterator*> pending_;
+
+  // The number of sub-iterators being read.
+  int num_reading_;
+
+  // The blocks which were read but not fully returned yet, in the order in
+  // which they were read. Only the caller of NextBlock() pops blocks, and
+  // reads only ever append to it, so the front block may be accessed without
+  // holding lock_.
+  deque<unique_ptr<Block>> ready_;
+
+  // The number of rows of the front block of ready_ which were already
+  // returned. Only accessed by the caller of NextBlock().
+  size_t ready_offset_;
+
+  // The blocks available to read into.
+  vector<unique_ptr<Block>> free_;
+
+  // The number of blocks allocated so far.
+  int num_blocks_;
+
+  // Statistics (keyed by projection column index) accumulated so far by any
+  // fully-consumed sub-iterators.
+  vector<IteratorStats> finished_iter_stats_by_col_;
+
+  // The first error returned by a sub-iterator, if any.
+  Status status_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelUnionIterator);
+};
+
+ParallelUnionIterator::ParallelUnionIterator(ParallelUnionIteratorOptions opts,
+                                             vector<unique_ptr<RowwiseIterator>> iters)
+    : opts_(opts),
+      initted_(false),
+      num_orig_iters_(iters.size()),
+      cond_(&lock_),
+      num_reading_(0),
+      ready_offset_(0),
+      num_blocks_(0) {
+  CHECK_GT(iters.size(), 0);
+  CHECK(opts_.pool);
+  CHECK_GT(opts_.max_concurrency, 0);
+  CHECK_GT(opts_.max_buffered_blocks, 0);
+  for (auto& iter : iters) {
+    unique_ptr<SubIterator> sub(new SubIterator());
+    sub->iter = std::move(iter);
+    sub_iters_.emplace_back(std::move(sub));
+  }
+}
+
+ParallelUnionIterator::~ParallelUnionIterator() {
+  if (token_) {
+    token_->Shutdown();
+  }
+}
+
+Status ParallelUnionIterator::Init(ScanSpec *spec) {
+  CHECK(!initted_);
+
+  for (auto& sub : sub_iters_) {
+    ScanSpec *spec_copy = spec != nullptr ? scan_spec_copies_.Construct(*spec) : nullptr;
+    RETURN_NOT_OK(InitAndMaybeWrap(&sub->iter, spec_copy));
+  }
+  // Since we handle predicates in all the wrapped iterators, we can clear
+  // them here.
+  if (spec != nullptr) {
+    spec->RemovePredicates();
+  }
+
+  schema_.reset(new Schema(sub_iters_.front()->iter->schema()));
+  finished_iter_stats_by_col_.resize(schema_->num_columns());
+#ifndef NDEBUG
+  for (const auto& sub : sub_iters_) {
+    if (!sub->iter->schema().Equals(*schema_)) {
+      return Status::InvalidArgument(
+          Substitute("Schemas do not match: $0 vs. $1",
+                     schema_->ToString(), sub->iter->schema().ToString()));
+    }
+  }
+#endif
+
+  token_ = opts_.pool->NewToken(ThreadPool::ExecutionMode::CONCURRENT);
+  MutexLock l(lock_);
+  for (auto& sub : sub_iters_) {
+    sub->iter->GetIteratorStats(&sub->stats);
+    pending_.push_back(sub.get());
+  }
+  initted_ = true;
+  StartReadsUnlocked();
+  return Status::OK();
+}
+
+void ParallelUnionIterator::StartReadsUnlocked() {
+  lock_.AssertAcquired();
+  while (status_.ok() &&
+         !pending_.empty() &&
+         num_reading_ < opts_.max_concurrency &&
+         (!free_.empty() || num_blocks_ < opts_.max_buffered_blocks)) {
+    SubIterator* sub = pending_.front();
+    Status s = token_->SubmitFunc([this, sub]() { this->ReadSubIterator(sub); });
+    if (PREDICT_FALSE(!s.ok())) {
+      status_ = s.CloneAndPrepend("could not read rowsets in parallel");
+      cond_.Broadcast();
+      return;
+    }
+    pending_.pop_front();
+    num_reading_++;
+  }
+}
+
+void ParallelUnionIterator::ReadSubIterator(SubIterator* sub) {
+  while (sub->iter->HasNext()) {
+    unique_ptr<Block> block;
+    {
+      MutexLock l(lock_);
+      if (PREDICT_FALSE(!status_.ok())) {
+        num_reading_--;
+        cond_.Broadcast();
+        return;
+      }
+      if (!free_.empty()) {
+        block = std::move(free_.back());
+        free_.pop_back();
+      } else if (num_blocks_ < opts_.max_buffered_blocks) {
+        num_blocks_++;
+      } else {
+        // All the blocks are in use: resume once the caller consumes one.
+        pending_.push_front(sub);
+        num_reading_--;
+        cond_.Broadcast();
+        return;
+      }
+    }
+    if (!block) {
+      block.reset(new Block(*schema_));
+    }
+    block->arena.Reset();
+    Status s = sub->iter->NextBlock(&block->rows);
+    vector<IteratorStats> stats;
+    sub->iter->GetIteratorStats(&stats);
+
+    MutexLock l(lock_);
+    sub->stats = std::move(stats);
+    if (PREDICT_FALSE(!s.ok())) {
+      if (status_.ok()) {
+        status_ = s;
+      }
+      free_.emplace_back(std::move(block));
+      num_reading_--;
+      cond_.Broadcast();
+      return;
+    }
+    if (block->rows.selection_vector()->AnySelected()) {
+      ready_.emplace_back(std::move(block));
+      cond_.Broadcast();
+    } else {
+      free_.emplace_back(std::move(block));
+    }
+  }
+
+  // The sub-iterator is exhausted: free it, and start reading another one.
+  sub->iter.reset();
+  MutexLock l(lock_);
+  for (int i = 0; i < sub->stats.size(); i++) {
+    finished_iter_stats_by_col_[i] += sub->stats[i];
+  }
+  sub->stats.clear();
+  num_reading_--;
+  StartReadsUnlocked();
+  cond_.Broadcast();
+}
+
+bool ParallelUnionIterator::HasNext() const {
+  CHECK(initted_);
+  MutexLock l(lock_);
+  if (!ready_.empty() || num_reading_ > 0 || !status_.ok()) {
+    return true;
+  }
+  // The pending sub-iterators aren't being read, so it's safe to check them.
+  for (const SubIterator* sub : pending_) {
+    if (sub->iter->HasNext()) return true;
+  }
+  return false;
+}
+
+Status ParallelUnionIterator::NextBlock(RowBlock* dst) {
+  CHECK(initted_);
+  DCHECK_SCHEMA_EQ(dst->schema(), schema());
+  if (dst->arena()) {
+    dst->arena()->Reset();
+  }
+
+  Block* block;
+  {
+    MutexLock l(lock_);
+    while (ready_.empty() && status_.ok() && num_reading_ > 0) {
+      cond_.Wait();
+    }
+    RETURN_NOT_OK(status_);
+    if (ready_.empty()) {
+      dst->Resize(0);
+      return Status::OK();
+    }
+    block = ready_.front().get();
+  }
+
+  // Copy the selected rows of the block, as many as fit.
+  const SelectionVector* selection = block->rows.selection_vector();
+  const size_t num_rows = block->rows.nrows();
+  dst->Resize(dst->row_capacity());
+  size_t dst_row_idx = 0;
+  size_t row_idx = ready_offset_;
+  for (; row_idx < num_rows && dst_row_idx < dst->nrows(); row_idx++) {
+    if (!selection->IsRowSelected(row_idx)) continue;
+    RowBlockRow dst_row = dst->row(dst_row_idx++);
+    RETURN_NOT_OK(CopyRow(block->rows.row(row_idx), &dst_row, dst->arena()));
+  }
+  while (row_idx < num_rows && !selection->IsRowSelected(row_idx)) {
+    row_idx++;
+  }
+  dst->Resize(dst_row_idx);
+  dst->selection_vector()->SetAllTrue();
+
+  if (row_idx < num_rows) {
+    ready_offset_ = row_idx;
+    return Status::OK();
+  }
+  ready_offset_ = 0;
+  MutexLock l(lock_);
+  free_.emplace_back(std::move(ready_.front()));
+  ready_.pop_front();
+  StartReadsUnlocked();
+  return Status::OK();
+}
+
+string ParallelUnionIterator::ToString() const {
+  return Substitute("ParallelUnion($0 iters)", num_orig_iters_);
+}
+
+void ParallelUnionIterator::GetIteratorStats(vector<IteratorStats>* stats) const {
+  CHECK(initted_);
+  MutexLock l(lock_);
+  *stats = finished_iter_stats_by_col_;
+  for (const auto& sub : sub_iters_) {
+    for (int i = 0; i < sub->stats.size(); i++) {
+      (*stats)[i] += sub->stats[i];
+    }
+  }
+}
+
+unique_ptr<RowwiseIterator> NewParallelUnionIterator(
+    ParallelUnionIteratorOptions opts, vector<unique_ptr<RowwiseIterator>> iters) {
+  return unique_ptr<RowwiseIterator>(new ParallelUnionIterator(opts, std::move(iters)));
+}
+
 ////////////////////////////////////////////////////////////
 // MaterializingIterator
 ////////////////////////////////////////////////////////////
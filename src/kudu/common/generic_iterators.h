@@ -28,6 +28,7 @@ class ColumnPredicate;
 class ColumnwiseIterator;
 class RowwiseIterator;
 class ScanSpec;
+class ThreadPool;
 
 // Options struct for the MergeIterator.
 struct MergeIteratorOptions {
@@ -53,6 +54,33 @@ std::unique_ptr<RowwiseIterator> NewMergeIterator(
 std::unique_ptr<RowwiseIterator> NewUnionIterator(
     std::vector<std::unique_ptr<RowwiseIterator>> iters);
 
+// Options struct for the ParallelUnionIterator.
+struct ParallelUnionIteratorOptions {
+  ParallelUnionIteratorOptions(ThreadPool* pool, int max_concurrency, int max_buffered_blocks)
+      : pool(pool),
+        max_concurrency(max_concurrency),
+        max_buffered_blocks(max_buffered_blocks) {}
+
+  // The pool on which the sub-iterators are read. Must outlive the iterator.
+  ThreadPool* const pool;
+
+  // The maximum number of sub-iterators read concurrently.
+  const int max_concurrency;
+
+  // The maximum number of blocks of rows read ahead of the caller. This bounds
+  // the memory used by the iterator.
+  const int max_buffered_blocks;
+};
+
+// Constructs a ParallelUnionIterator of the given iterators. Like the
+// UnionIterator, but reads up to 'opts.max_concurrency' of the iterators
+// concurrently on 'opts.pool', interleaving their rows.
+//
+// The iterators must have matching schemas and should not yet be initialized.
+std::unique_ptr<RowwiseIterator> NewParallelUnionIterator(
+    ParallelUnionIteratorOptions opts,
+    std::vector<std::unique_ptr<RowwiseIterator>> iters);
+
 // Constructs a MaterializingIterator of the given ColumnwiseIterator.
 std::unique_ptr<RowwiseIterator> NewMaterializingIterator(
     std::unique_ptr<ColumnwiseIterator> iter);
@@ -30,8 +30,10 @@
 #include "kudu/common/common.pb.h"
 #include "kudu/common/partial_row.h"
 #include "kudu/common/partition.h"
+#include "kudu/common/row.h"
 #include "kudu/common/schema.h"
 #include "kudu/gutil/strings/join.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
@@ -39,8 +41,10 @@
 
 using boost::optional;
 using std::pair;
+using std::unique_ptr;
 using std::string;
 using std::vector;
+using strings::Substitute;
 
 namespace kudu {
 
@@ -309,6 +313,51 @@ TEST_F(PartitionTest, TestPartitionKeyEncoding) {
   }
 }
 
+// Checks that EncodeKeys() encodes the same keys as EncodeKey(), including
+// for rows with unset columns and rows of another schema.
+TEST_F(PartitionTest, TestBatchPartitionKeyEncoding) {
+  // CREATE TABLE t (a INT32, b VARCHAR, c VARCHAR, PRIMARY KEY (a, b, c))
+  // PARITITION BY [HASH BUCKET (a, b), HASH BUCKET (c), RANGE (a, b)];
+  Schema schema({ ColumnSchema("a", INT32),
+                  ColumnSchema("b", STRING),
+                  ColumnSchema("c", STRING) },
+                { ColumnId(0), ColumnId(1), ColumnId(2) }, 3);
+  Schema other_schema = schema;
+
+  PartitionSchemaPB schema_builder;
+  AddHashBucketComponent(&schema_builder, { "a", "b" }, 32, 0);
+  AddHashBucketComponent(&schema_builder, { "c" }, 7, 42);
+  SetRangePartitionComponent(&schema_builder, { "a", "b" });
+  PartitionSchema partition_schema;
+  ASSERT_OK(PartitionSchema::FromPB(schema_builder, schema, &partition_schema));
+
+  const int kNumRows = 100;
+  vector<unique_ptr<KuduPartialRow>> rows;
+  vector<const KuduPartialRow*> row_ptrs;
+  for (int i = 0; i < kNumRows; i++) {
+    rows.emplace_back(new KuduPartialRow(i % 10 == 9 ? &other_schema : &schema));
+    KuduPartialRow* row = rows.back().get();
+    ASSERT_OK(row->SetInt32("a", i));
+    ASSERT_OK(row->SetStringCopy("b", Substitute("b$0", i)));
+    if (i % 3 != 0) {
+      ASSERT_OK(row->SetStringCopy("c", Substitute("c$0", i)));
+    }
+    row_ptrs.push_back(row);
+  }
+
+  vector<string> keys = { "garbage" };
+  ASSERT_OK(partition_schema.EncodeKeys(row_ptrs, &keys));
+  ASSERT_EQ(kNumRows, keys.size());
+  for (int i = 0; i < kNumRows; i++) {
+    string key;
+    ASSERT_OK(partition_schema.EncodeKey(*row_ptrs[i], &key));
+    EXPECT_EQ(key, keys[i]) << i;
+  }
+
+  ASSERT_OK(partition_schema.EncodeKeys({}, &keys));
+  ASSERT_TRUE(keys.empty());
+}
+
 TEST_F(PartitionTest, TestCreateRangePartitions) {
   {
     // Splits:
@@ -464,6 +513,61 @@ TEST_F(PartitionTest, TestCreateHashBucketPartitions) {
             partition_schema.PartitionDebugString(partitions[2], schema));
 }
 
+// Verify that checking the rows in batches gives the same results as
+// checking them one at a time.
+TEST_F(PartitionTest, TestPartitionContainsRows) {
+  // CREATE TABLE t (a VARCHAR, b INT32, PRIMARY KEY (a, b))
+  // PARITITION BY [HASH BUCKET (a), HASH BUCKET (b)], RANGE (a);
+  Schema schema({ ColumnSchema("a", STRING),
+                  ColumnSchema("b", INT32) },
+                { ColumnId(0), ColumnId(1) }, 2);
+
+  PartitionSchemaPB schema_builder;
+  SetRangePartitionComponent(&schema_builder, { "a" });
+  AddHashBucketComponent(&schema_builder, { "a" }, 3, 42);
+  AddHashBucketComponent(&schema_builder, { "b" }, 2, 0);
+  PartitionSchema partition_schema;
+  ASSERT_OK(PartitionSchema::FromPB(schema_builder, schema, &partition_schema));
+
+  KuduPartialRow split(&schema);
+  ASSERT_OK(split.SetStringCopy("a", "m"));
+  vector<Partition> partitions;
+  ASSERT_OK(partition_schema.CreatePartitions({ split }, {}, schema, &partitions));
+  ASSERT_EQ(12, partitions.size());
+
+  vector<string> values;
+  for (int i = 0; i < 50; i++) {
+    values.emplace_back(string(1, 'a' + i % 26) + std::to_string(i));
+  }
+  vector<unique_ptr<RowBuilder>> builders;
+  vector<ConstContiguousRow> rows;
+  for (int i = 0; i < values.size(); i++) {
+    builders.emplace_back(new RowBuilder(schema));
+    builders.back()->AddString(Slice(values[i]));
+    builders.back()->AddInt32(i);
+    rows.emplace_back(builders.back()->row());
+  }
+
+  vector<int> rows_per_partition(partitions.size());
+  for (int p = 0; p < partitions.size(); p++) {
+    vector<bool> contains;
+    ASSERT_OK(partition_schema.PartitionContainsRows(partitions[p], rows, &contains));
+    ASSERT_EQ(rows.size(), contains.size());
+    for (int i = 0; i < rows.size(); i++) {
+      bool row_contained;
+      ASSERT_OK(partition_schema.PartitionContainsRow(partitions[p], rows[i], &row_contained));
+      ASSERT_EQ(row_contained, contains[i]);
+      rows_per_partition[p] += contains[i];
+    }
+  }
+  // Each row is in exactly one partition.
+  int total = 0;
+  for (int count : rows_per_partition) {
+    total += count;
+  }
+  ASSERT_EQ(rows.size(), total);
+}
+
 TEST_F(PartitionTest, TestCreatePartitions) {
   // Explicitly enable redaction. It should have no effect on the subsequent
   // partition pretty printing tests, as partitions are metadata and thus not
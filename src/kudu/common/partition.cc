@@ -210,6 +210,86 @@ Status PartitionSchema::EncodeKey(const KuduPartialRow& row, string* buf) const
   return EncodeColumns(row, range_schema_.column_ids, buf);
 }
 
+Status PartitionSchema::EncodeKeys(const vector<const KuduPartialRow*>& rows,
+                                   vector<string>* keys) const {
+  keys->resize(rows.size());
+  for (string& key : *keys) {
+    key.clear();
+  }
+  if (rows.empty()) {
+    return Status::OK();
+  }
+  const Schema* schema = rows[0]->schema();
+
+  // A partition column, resolved against 'schema'.
+  struct ResolvedColumn {
+    int idx;
+    const TypeInfo* type_info;
+    const KeyEncoder<string>* encoder;
+  };
+  const auto resolve = [&](const vector<ColumnId>& column_ids) {
+    vector<ResolvedColumn> cols;
+    cols.reserve(column_ids.size());
+    for (ColumnId column_id : column_ids) {
+      int32_t column_idx = schema->find_column_by_id(column_id);
+      CHECK(column_idx != Schema::kColumnNotFound);
+      const TypeInfo* type_info = schema->column(column_idx).type_info();
+      cols.push_back({ column_idx, type_info, &GetKeyEncoder<string>(type_info) });
+    }
+    return cols;
+  };
+  // Same as EncodeColumns(), with the columns already resolved.
+  const auto encode = [](const KuduPartialRow& row,
+                         const vector<ResolvedColumn>& cols,
+                         string* buf) {
+    ContiguousRow cont_row(row.schema(), row.row_data_);
+    for (size_t i = 0; i < cols.size(); i++) {
+      const ResolvedColumn& col = cols[i];
+      bool is_last = i + 1 == cols.size();
+      if (PREDICT_FALSE(!row.IsColumnSet(col.idx))) {
+        uint8_t min_value[kLargestTypeSize];
+        col.type_info->CopyMinValue(min_value);
+        col.encoder->Encode(min_value, is_last, buf);
+      } else {
+        col.encoder->Encode(cont_row.cell_ptr(col.idx), is_last, buf);
+      }
+    }
+  };
+
+  // Compute the buckets of each hash dimension for all the rows, which keeps
+  // the columns and seed of the dimension at hand in the inner loop.
+  const size_t num_dims = hash_bucket_schemas_.size();
+  vector<int32_t> buckets(rows.size() * num_dims);
+  string hash_buf;
+  for (size_t dim = 0; dim < num_dims; dim++) {
+    const HashBucketSchema& hash_bucket_schema = hash_bucket_schemas_[dim];
+    const vector<ResolvedColumn> cols = resolve(hash_bucket_schema.column_ids);
+    for (size_t i = 0; i < rows.size(); i++) {
+      if (PREDICT_FALSE(rows[i]->schema() != schema)) continue;
+      hash_buf.clear();
+      encode(*rows[i], cols, &hash_buf);
+      uint64_t hash = HashUtil::MurmurHash2_64(hash_buf.data(), hash_buf.length(),
+                                               hash_bucket_schema.seed);
+      buckets[i * num_dims + dim] = hash % static_cast<uint64_t>(hash_bucket_schema.num_buckets);
+    }
+  }
+
+  const KeyEncoder<string>& hash_encoder = GetKeyEncoder<string>(GetTypeInfo(UINT32));
+  const vector<ResolvedColumn> range_cols = resolve(range_schema_.column_ids);
+  for (size_t i = 0; i < rows.size(); i++) {
+    string* key = &(*keys)[i];
+    if (PREDICT_FALSE(rows[i]->schema() != schema)) {
+      RETURN_NOT_OK(EncodeKey(*rows[i], key));
+      continue;
+    }
+    for (size_t dim = 0; dim < num_dims; dim++) {
+      hash_encoder.Encode(&buckets[i * num_dims + dim], key);
+    }
+    encode(*rows[i], range_cols, key);
+  }
+  return Status::OK();
+}
+
 Status PartitionSchema::EncodeKey(const ConstContiguousRow& row, string* buf) const {
   const KeyEncoder<string>& hash_encoder = GetKeyEncoder<string>(GetTypeInfo(UINT32));
 
@@ -496,6 +576,45 @@ Status PartitionSchema::PartitionContainsRow(const Partition& partition,
   return PartitionContainsRowImpl(partition, row, contains);
 }
 
+Status PartitionSchema::PartitionContainsRows(const Partition& partition,
+                                              const vector<ConstContiguousRow>& rows,
+                                              vector<bool>* contains) const {
+  CHECK_EQ(partition.hash_buckets().size(), hash_bucket_schemas_.size());
+  contains->assign(rows.size(), true);
+
+  vector<string> encoded(rows.size());
+  vector<Slice> slices(rows.size());
+  vector<uint64_t> hashes(rows.size());
+  for (int i = 0; i < hash_bucket_schemas_.size(); i++) {
+    const HashBucketSchema& hash_bucket_schema = hash_bucket_schemas_[i];
+    for (int r = 0; r < rows.size(); r++) {
+      encoded[r].clear();
+      RETURN_NOT_OK(EncodeColumns(rows[r], hash_bucket_schema.column_ids, &encoded[r]));
+      slices[r] = Slice(encoded[r]);
+    }
+    HashUtil::MurmurHash2_64Batch(slices.data(), slices.size(), hash_bucket_schema.seed,
+                                  hashes.data());
+    for (int r = 0; r < rows.size(); r++) {
+      const int32_t bucket = hashes[r] % static_cast<uint64_t>(hash_bucket_schema.num_buckets);
+      if (bucket != partition.hash_buckets()[i]) {
+        (*contains)[r] = false;
+      }
+    }
+  }
+
+  string range_partition_key;
+  for (int r = 0; r < rows.size(); r++) {
+    if (!(*contains)[r]) {
+      continue;
+    }
+    range_partition_key.clear();
+    RETURN_NOT_OK(EncodeColumns(rows[r], range_schema_.column_ids, &range_partition_key));
+    (*contains)[r] = (Slice(range_partition_key).compare(partition.range_key_start()) >= 0)
+                  && (partition.range_key_end().empty()
+                      || Slice(range_partition_key).compare(partition.range_key_end()) < 0);
+  }
+  return Status::OK();
+}
 
 Status PartitionSchema::DecodeRangeKey(Slice* encoded_key,
                                        KuduPartialRow* row,
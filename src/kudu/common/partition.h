@@ -159,6 +159,15 @@ class PartitionSchema {
   Status EncodeKey(const KuduPartialRow& row, std::string* buf) const WARN_UNUSED_RESULT;
   Status EncodeKey(const ConstContiguousRow& row, std::string* buf) const WARN_UNUSED_RESULT;
 
+  // Replaces the contents of 'keys' with the encoded partition keys of 'rows',
+  // with the same results as calling EncodeKey() on each row.
+  //
+  // The partition columns are resolved once for the whole batch, and the hash
+  // buckets are computed one hash dimension at a time over all the rows. Rows
+  // whose schema isn't the one of the first row are encoded with EncodeKey().
+  Status EncodeKeys(const std::vector<const KuduPartialRow*>& rows,
+                    std::vector<std::string>* keys) const WARN_UNUSED_RESULT;
+
   // Creates the set of table partitions for a partition schema and collection
   // of split rows and split bounds.
   //
@@ -182,6 +191,13 @@ class PartitionSchema {
                               const ConstContiguousRow& row,
                               bool* contains) const WARN_UNUSED_RESULT;
 
+  // Tests which of the rows the partition contains, setting (*contains)[i]
+  // for rows[i]. Same as calling PartitionContainsRow() on each row, but the
+  // hash buckets of the rows are computed a batch at a time.
+  Status PartitionContainsRows(const Partition& partition,
+                               const std::vector<ConstContiguousRow>& rows,
+                               std::vector<bool>* contains) const WARN_UNUSED_RESULT;
+
   // Returns a text description of the partition suitable for debug printing.
   //
   // Partitions are considered metadata, so no redaction will happen on the hash
@@ -21,6 +21,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <numeric>
 #include <string>
 #include <utility>
 #include <vector>
@@ -868,6 +869,78 @@ TEST_F(PartitionPrunerTest, TestMultiColumnInListHashPruning) {
           ColumnPredicate::InList(schema.column(1), &b_values),
           ColumnPredicate::InList(schema.column(2), &c_values) },
         6, 2);
+
+  // b in [0, 100), c in [0, 100): the combinations hit every bucket.
+  vector<int8_t> values(100);
+  std::iota(values.begin(), values.end(), 0);
+  b_values.clear();
+  for (const int8_t& value : values) {
+    b_values.push_back(&value);
+  }
+  c_values = b_values;
+  Check({ ColumnPredicate::InList(schema.column(1), &b_values),
+          ColumnPredicate::InList(schema.column(2), &c_values) },
+        9, 1);
+}
+
+TEST_F(PartitionPrunerTest, TestRemovePartitionKeyRange) {
+  // CREATE TABLE t
+  // (a INT8, b INT8)
+  // PRIMARY KEY (a, b)
+  // DISTRIBUTE BY HASH(a) INTO 16 BUCKETS,
+  //               RANGE(b);
+  Schema schema({ ColumnSchema("a", INT8),
+                  ColumnSchema("b", INT8) },
+                { ColumnId(0), ColumnId(1) },
+                2);
+
+  PartitionSchema partition_schema;
+  auto pb = PartitionSchemaPB();
+  auto hash_component = pb.add_hash_bucket_schemas();
+  hash_component->add_columns()->set_name("a");
+  hash_component->set_num_buckets(16);
+  pb.mutable_range_schema()->add_columns()->set_name("b");
+  ASSERT_OK(PartitionSchema::FromPB(pb, schema, &partition_schema));
+
+  // b >= 0 AND b < 10: one partition key range per bucket.
+  int8_t zero = 0;
+  int8_t ten = 10;
+  ScanSpec spec;
+  spec.AddPredicate(ColumnPredicate::Range(schema.column(1), &zero, &ten));
+  AutoReleasePool p;
+  Arena arena(256);
+  spec.OptimizeScan(schema, &arena, &p, false);
+
+  PartitionPruner pruner;
+  pruner.Init(schema, partition_schema, spec);
+  ASSERT_EQ(16, pruner.NumRangesRemainingForTests());
+
+  // Partition keys are the big-endian bucket followed by the key encoding of
+  // 'b', whose sign bit is flipped.
+  auto partition_key = [] (uint8_t bucket, int8_t b) {
+    return string({ '\0', '\0', '\0', static_cast<char>(bucket),
+                    static_cast<char>(b ^ 0x80) });
+  };
+  ASSERT_EQ(partition_key(0, 0), pruner.NextPartitionKey());
+
+  // Remove the ranges of buckets 0 to 4, and part of that of bucket 5.
+  pruner.RemovePartitionKeyRange(partition_key(5, 5));
+  ASSERT_EQ(11, pruner.NumRangesRemainingForTests());
+  ASSERT_EQ(partition_key(5, 5), pruner.NextPartitionKey());
+
+  // Remove the ranges of buckets 5 to 9. The range of bucket 10 is above the
+  // upper bound.
+  pruner.RemovePartitionKeyRange(string("\0\0\0\x0a", 4));
+  ASSERT_EQ(6, pruner.NumRangesRemainingForTests());
+  ASSERT_EQ(partition_key(10, 0), pruner.NextPartitionKey());
+
+  // An upper bound at the end of a range removes it entirely.
+  pruner.RemovePartitionKeyRange(partition_key(10, 10));
+  ASSERT_EQ(5, pruner.NumRangesRemainingForTests());
+  ASSERT_EQ(partition_key(11, 0), pruner.NextPartitionKey());
+
+  pruner.RemovePartitionKeyRange("");
+  ASSERT_FALSE(pruner.HasMorePartitionKeyRanges());
 }
 
 TEST_F(PartitionPrunerTest, TestPruning) {
@@ -189,38 +189,65 @@ vector<bool> PartitionPruner::PruneHashComponent(
     const Schema& schema,
     const ScanSpec& scan_spec) {
   vector<bool> hash_bucket_bitset(hash_bucket_schema.num_buckets, false);
-  vector<string> encoded_strings(1, "");
-  for (size_t col_offset = 0; col_offset < hash_bucket_schema.column_ids.size(); ++col_offset) {
-    vector<string> new_encoded_strings;
-    const ColumnSchema& column = schema.column_by_id(hash_bucket_schema.column_ids[col_offset]);
+  const size_t num_columns = hash_bucket_schema.column_ids.size();
+  vector<const KeyEncoder<string>*> encoders;
+  vector<vector<const void*>> column_values;
+  encoders.reserve(num_columns);
+  column_values.reserve(num_columns);
+  for (const ColumnId& column_id : hash_bucket_schema.column_ids) {
+    const ColumnSchema& column = schema.column_by_id(column_id);
     const ColumnPredicate& predicate = FindOrDie(scan_spec.predicates(), column.name());
-    const KeyEncoder<string>& encoder = GetKeyEncoder<string>(column.type_info());
-
-    vector<const void*> predicate_values;
+    encoders.push_back(&GetKeyEncoder<string>(column.type_info()));
     if (predicate.predicate_type() == PredicateType::Equality) {
-      predicate_values.push_back(predicate.raw_lower());
+      column_values.push_back({ predicate.raw_lower() });
     } else {
       CHECK(predicate.predicate_type() == PredicateType::InList);
-      predicate_values.insert(predicate_values.end(),
-                              predicate.raw_values().begin(),
-                              predicate.raw_values().end());
+      column_values.push_back(predicate.raw_values());
     }
-    // For each of the encoded string, replicate it by the number of values in
-    // equality and in-list predicate.
-    for (const string& encoded_string : encoded_strings) {
-      for (const void* predicate_value : predicate_values) {
-        string new_encoded_string = encoded_string;
-        encoder.Encode(predicate_value,
-                       col_offset + 1 == hash_bucket_schema.column_ids.size(),
-                       &new_encoded_string);
-        new_encoded_strings.emplace_back(new_encoded_string);
-      }
+    if (column_values.back().empty()) {
+      return hash_bucket_bitset;
     }
-    encoded_strings.swap(new_encoded_strings);
   }
-  for (const string& encoded_string : encoded_strings) {
-    uint32_t hash = partition_schema.BucketForEncodedColumns(encoded_string, hash_bucket_schema);
-    hash_bucket_bitset[hash] = true;
+
+  // Enumerate the combinations of the values of the columns in order, like an
+  // odometer, without materializing them: 'value_idxs' is the current
+  // combination, and 'encoded' holds the encoding of its values up to the
+  // column 'col_offset', whose encoding starts at 'prefix_sizes[col_offset]'.
+  // The number of combinations is the product of the number of values of the
+  // columns, so stop as soon as every bucket is known to be hit.
+  vector<size_t> value_idxs(num_columns, 0);
+  vector<size_t> prefix_sizes(num_columns);
+  string encoded;
+  int32_t num_buckets_unset = hash_bucket_schema.num_buckets;
+  size_t col_offset = 0;
+  while (true) {
+    for (; col_offset < num_columns; col_offset++) {
+      prefix_sizes[col_offset] = encoded.size();
+      encoders[col_offset]->Encode(column_values[col_offset][value_idxs[col_offset]],
+                                   col_offset + 1 == num_columns,
+                                   &encoded);
+    }
+    uint32_t hash = partition_schema.BucketForEncodedColumns(encoded, hash_bucket_schema);
+    if (!hash_bucket_bitset[hash]) {
+      hash_bucket_bitset[hash] = true;
+      if (--num_buckets_unset == 0) {
+        break;
+      }
+    }
+
+    // Advance the last column which isn't on its last value, and reset the
+    // columns after it.
+    while (col_offset > 0 &&
+           value_idxs[col_offset - 1] + 1 == column_values[col_offset - 1].size()) {
+      col_offset--;
+      value_idxs[col_offset] = 0;
+    }
+    if (col_offset == 0) {
+      break;
+    }
+    col_offset--;
+    value_idxs[col_offset]++;
+    encoded.resize(prefix_sizes[col_offset]);
   }
   return hash_bucket_bitset;
 }
@@ -381,9 +408,12 @@ void PartitionPruner::Init(const Schema& schema,
     // exclusive.
     bool is_last = hash_idx + 1 == constrained_index && range_upper_bound.empty();
 
+    const vector<bool>& buckets_bitset = hash_bucket_bitsets[hash_idx];
     vector<tuple<string, string>> new_partition_key_ranges;
+    new_partition_key_ranges.reserve(
+        partition_key_ranges.size() *
+        std::count(buckets_bitset.begin(), buckets_bitset.end(), true));
     for (const auto& partition_key_range : partition_key_ranges) {
-      const vector<bool>& buckets_bitset = hash_bucket_bitsets[hash_idx];
       for (uint32_t bucket = 0; bucket < buckets_bitset.size(); ++bucket) {
         if (!buckets_bitset[bucket]) {
           continue;
@@ -448,15 +478,19 @@ void PartitionPruner::RemovePartitionKeyRange(const string& upper_bound) {
     return;
   }
 
-  for (auto range = partition_key_ranges_.rbegin();
-       range != partition_key_ranges_.rend();
-       range++) {
-    if (upper_bound <= get<0>(*range)) { break; }
-    if (get<1>(*range).empty() || upper_bound < get<1>(*range)) {
-      get<0>(*range) = upper_bound;
-    } else {
-      partition_key_ranges_.pop_back();
-    }
+  // The ranges are sorted and disjoint, so the ranges entirely below the upper
+  // bound are a suffix of the reverse sorted vector, found by binary search.
+  // The next range, if any, may start below the upper bound.
+  auto range = lower_bound(partition_key_ranges_.rbegin(), partition_key_ranges_.rend(),
+                           upper_bound,
+                           [] (const tuple<string, string>& scan_range, const string& upper_bound) {
+                             // return true if scan_range is entirely below upper_bound
+                             const string& scan_upper = get<1>(scan_range);
+                             return !scan_upper.empty() && scan_upper <= upper_bound;
+                           });
+  partition_key_ranges_.erase(range.base(), partition_key_ranges_.end());
+  if (!partition_key_ranges_.empty() && get<0>(partition_key_ranges_.back()) < upper_bound) {
+    get<0>(partition_key_ranges_.back()) = upper_bound;
   }
 }
 
@@ -123,6 +123,11 @@ class RowChangeList {
     return encoded_data_[0] == kDelete;
   }
 
+  bool is_update() const {
+    DCHECK_GT(encoded_data_.size(), 0);
+    return encoded_data_[0] == kUpdate;
+  }
+
   bool is_null() const {
     return encoded_data_.size() == 0;
   }
@@ -184,6 +189,13 @@ class RowChangeListEncoder {
                        int col_id,
                        const void* cell_ptr);
 
+  // Add a column update by its raw value, without knowledge of the schema.
+  // See EncodeColumnMutationRaw() below.
+  void AddRawColumnUpdate(int col_id, bool is_null, Slice new_val) {
+    SetType(RowChangeList::kUpdate);
+    EncodeColumnMutationRaw(col_id, is_null, new_val);
+  }
+
 
   RowChangeList as_changelist() {
     DCHECK_GT(dst_->size(), 0);
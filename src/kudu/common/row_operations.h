@@ -85,6 +85,16 @@ class RowOperationsPBDecoder {
                          const Schema* client_schema,
                          const Schema* tablet_schema,
                          Arena* dst_arena);
+
+  // Decodes the operations encoded in 'rows' and 'indirect_data', which are
+  // in the format of the fields of RowOperationsPB but may live in any
+  // buffer (e.g. RPC sidecars). The data must outlive the decoder and the
+  // decoded operations.
+  RowOperationsPBDecoder(Slice rows,
+                         Slice indirect_data,
+                         const Schema* client_schema,
+                         const Schema* tablet_schema,
+                         Arena* dst_arena);
   ~RowOperationsPBDecoder();
 
   template <DecoderMode mode>
@@ -119,7 +129,7 @@ class RowOperationsPBDecoder {
   Status DecodeOp(RowOperationsPB::Type type, const uint8_t* prototype_row_storage,
                   const ClientServerMapping& mapping, DecodedRowOperation* op);
 
-  const RowOperationsPB* const pb_;
+  const Slice indirect_data_;
   const Schema* const client_schema_;
   const Schema* const tablet_schema_;
   Arena* const dst_arena_;
@@ -17,8 +17,15 @@
 
 #include "kudu/common/rowblock.h"
 
+#include <memory>
+
 #include <gtest/gtest.h>
 
+#include "kudu/common/common.pb.h"
+#include "kudu/common/schema.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/memory/memory.h"
+
 namespace kudu {
 
 TEST(TestSelectionVector, TestEquals) {
@@ -43,4 +50,26 @@ TEST(TestSelectionVector, TestEquals) {
   ASSERT_NE(sv1, sv3);
 }
 
+TEST(TestRowBlock, TestPooledColumnBuffers) {
+  Schema schema({ ColumnSchema("key", INT32),
+                  ColumnSchema("val", INT64, true) },
+                1);
+  PoolingBufferAllocator* pool = PoolingBufferAllocator::Get();
+  pool->ReleaseCachedBuffers();
+  Arena arena(1024);
+  {
+    RowBlock block(schema, 100, &arena, pool);
+    for (int i = 0; i < 100; i++) {
+      *reinterpret_cast<int32_t*>(block.row(i).mutable_cell_ptr(0)) = i;
+      *reinterpret_cast<int64_t*>(block.row(i).mutable_cell_ptr(1)) = i;
+    }
+    ASSERT_EQ(99, *reinterpret_cast<const int32_t*>(block.row(99).cell_ptr(0)));
+    ASSERT_EQ(0, pool->cached_bytes());
+  }
+  // The column buffers and the null bitmap are pooled once the block is
+  // destructed.
+  ASSERT_EQ(512 + 1024 + 256, pool->cached_bytes());
+  pool->ReleaseCachedBuffers();
+}
+
 } // namespace kudu
@@ -20,6 +20,7 @@
 
 #include "kudu/gutil/bits.h"
 #include "kudu/util/bitmap.h"
+#include "kudu/util/memory/memory.h"
 
 namespace kudu {
 
@@ -112,10 +113,12 @@ bool operator!=(const SelectionVector& a, const SelectionVector& b) {
 //////////////////////////////
 RowBlock::RowBlock(const Schema &schema,
                    size_t nrows,
-                   Arena *arena)
+                   Arena *arena,
+                   BufferAllocator* allocator)
   : schema_(schema),
     columns_data_(schema.num_columns()),
     column_null_bitmaps_(schema.num_columns()),
+    allocator_(allocator),
     row_capacity_(nrows),
     nrows_(nrows),
     arena_(arena),
@@ -126,15 +129,19 @@ RowBlock::RowBlock(const Schema &schema,
   for (size_t i = 0; i < schema.num_columns(); ++i) {
     const ColumnSchema& col_schema = schema.column(i);
     size_t col_size = row_capacity_ * col_schema.type_info()->size();
-    columns_data_[i] = new uint8_t[col_size];
+    columns_data_[i] = AllocateBuffer(col_size);
 
     if (col_schema.is_nullable()) {
-      column_null_bitmaps_[i] = new uint8_t[bitmap_size];
+      column_null_bitmaps_[i] = AllocateBuffer(bitmap_size);
     }
   }
 }
 
 RowBlock::~RowBlock() {
+  if (allocator_) {
+    // The buffers free themselves.
+    return;
+  }
   for (uint8_t *column_data : columns_data_) {
     delete[] column_data;
   }
@@ -143,6 +150,15 @@ RowBlock::~RowBlock() {
   }
 }
 
+uint8_t* RowBlock::AllocateBuffer(size_t size) {
+  if (!allocator_) {
+    return new uint8_t[size];
+  }
+  Buffer* buffer = CHECK_NOTNULL(allocator_->Allocate(size));
+  buffers_.emplace_back(buffer);
+  return static_cast<uint8_t*>(buffer->data());
+}
+
 void RowBlock::Resize(size_t new_size) {
   CHECK_LE(new_size, row_capacity_);
   nrows_ = new_size;
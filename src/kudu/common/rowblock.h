@@ -20,6 +20,7 @@
 
 #include <cstdint>
 #include <cstring>
+#include <memory>
 #include <vector>
 
 #include <glog/logging.h>
@@ -35,6 +36,8 @@
 namespace kudu {
 
 class Arena;
+class Buffer;
+class BufferAllocator;
 class RowBlockRow;
 
 // Bit-vector representing the selection status of each row in a row block.
@@ -172,6 +175,11 @@ class SelectionVectorView {
     DCHECK_LE(nrows, sel_vec_->nrows() - row_offset_);
     BitmapChangeBits(sel_vec_->mutable_bitmap(), row_offset_, nrows, false);
   }
+  // Clears the 'nrows' bits starting at 'row_idx'.
+  void ClearBits(size_t row_idx, size_t nrows) {
+    DCHECK_LE(row_idx + nrows, sel_vec_->nrows() - row_offset_);
+    BitmapChangeBits(sel_vec_->mutable_bitmap(), row_offset_ + row_idx, nrows, false);
+  }
  private:
   SelectionVector* sel_vec_;
   size_t row_offset_;
@@ -192,9 +200,12 @@ class SelectionVectorView {
 // of the latter doesn't mean you _should_.
 class RowBlock {
  public:
+  // The column buffers are allocated by 'allocator' if it's not NULL, e.g. to
+  // reuse them through PoolingBufferAllocator, and from the heap otherwise.
   RowBlock(const Schema &schema,
            size_t nrows,
-           Arena *arena);
+           Arena *arena,
+           BufferAllocator* allocator = nullptr);
   ~RowBlock();
 
   // Resize the block to the given number of rows.
@@ -236,6 +247,14 @@ class RowBlock {
     return columns_data_[col_idx];
   }
 
+  // Return the null bitmap of the given column, or NULL if the column isn't
+  // nullable. A set bit indicates a non-null cell. Used by the codegen code
+  // for the same reason as column_data_base_ptr().
+  uint8_t* column_null_bitmap_ptr(size_t col_idx) const {
+    DCHECK_LT(col_idx, column_null_bitmaps_.size());
+    return column_null_bitmaps_[col_idx];
+  }
+
   // Return the number of rows in the row block. Note that this includes
   // rows which were filtered out by the selection vector.
   size_t nrows() const { return nrows_; }
@@ -286,10 +305,18 @@ class RowBlock {
     return block_size;
   }
 
+  // Allocates a column buffer of 'size' bytes.
+  uint8_t* AllocateBuffer(size_t size);
+
   Schema schema_;
   std::vector<uint8_t *> columns_data_;
   std::vector<uint8_t *> column_null_bitmaps_;
 
+  // The allocator of the column buffers, and the buffers it allocated, if
+  // they're not allocated from the heap.
+  BufferAllocator* const allocator_;
+  std::vector<std::unique_ptr<Buffer>> buffers_;
+
   // The maximum number of rows that can be stored in our allocated buffer.
   size_t row_capacity_;
 
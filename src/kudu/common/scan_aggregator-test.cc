@@ -0,0 +1,372 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/scan_aggregator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <google/protobuf/repeated_field.h>
+#include <gtest/gtest.h>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/common/row.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+using google::protobuf::RepeatedPtrField;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+class ScanAggregatorTest : public KuduTest {
+ public:
+  ScanAggregatorTest()
+      : schema_({ ColumnSchema("key", INT32),
+                  ColumnSchema("str", STRING, true /* nullable */),
+                  ColumnSchema("val", INT64, true /* nullable */),
+                  ColumnSchema("dbl", DOUBLE) },
+                1),
+        arena_(1024) {
+  }
+
+  static void AddAggregate(ScanAggregatePB::Type type, const string& column,
+                           RepeatedPtrField<ScanAggregatePB>* pbs) {
+    ScanAggregatePB* pb = pbs->Add();
+    pb->set_type(type);
+    if (!column.empty()) {
+      pb->set_column(column);
+    }
+  }
+
+  // Fill 'block' with rows where row 'i' has key 'i + key_base'. Rows with a
+  // key divisible by 3 have NULL cells in the nullable columns.
+  void FillRowBlock(RowBlock* block, int key_base) {
+    block->selection_vector()->SetAllTrue();
+    for (int i = 0; i < block->nrows(); i++) {
+      RowBlockRow row = block->row(i);
+      int key = i + key_base;
+      *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(0)) = key;
+      bool is_null = key % 3 == 0;
+      row.cell(1).set_null(is_null);
+      row.cell(2).set_null(is_null);
+      Slice s;
+      CHECK(arena_.RelocateSlice(Substitute("val-$0", key), &s));
+      *reinterpret_cast<Slice*>(row.mutable_cell_ptr(1)) = s;
+      *reinterpret_cast<int64_t*>(row.mutable_cell_ptr(2)) = key * 10L;
+      *reinterpret_cast<double*>(row.mutable_cell_ptr(3)) = key / 2.0;
+    }
+  }
+
+ protected:
+  Schema schema_;
+  Arena arena_;
+};
+
+TEST_F(ScanAggregatorTest, TestAggregates) {
+  RepeatedPtrField<ScanAggregatePB> pbs;
+  AddAggregate(ScanAggregatePB::COUNT, "", &pbs);
+  AddAggregate(ScanAggregatePB::COUNT, "val", &pbs);
+  AddAggregate(ScanAggregatePB::MIN, "str", &pbs);
+  AddAggregate(ScanAggregatePB::MAX, "str", &pbs);
+  AddAggregate(ScanAggregatePB::MIN, "key", &pbs);
+  AddAggregate(ScanAggregatePB::MAX, "val", &pbs);
+  AddAggregate(ScanAggregatePB::SUM, "val", &pbs);
+  AddAggregate(ScanAggregatePB::SUM, "dbl", &pbs);
+  unique_ptr<ScanAggregator> agg;
+  ASSERT_OK(ScanAggregator::Create(pbs, schema_, &agg));
+  ASSERT_EQ(8, agg->result_schema().num_columns());
+  ASSERT_EQ(4, agg->input_columns().size());
+
+  // Aggregate keys [1, 100), skipping the unselected even keys of the first
+  // block.
+  const int kNumRows = 50;
+  Arena block_arena(1024);
+  RowBlock block(schema_, kNumRows, &block_arena);
+  FillRowBlock(&block, 0);
+  for (int i = 0; i < kNumRows; i += 2) {
+    block.selection_vector()->SetRowUnselected(i);
+  }
+  ASSERT_OK(agg->AddRowBlock(block));
+  FillRowBlock(&block, kNumRows);
+  ASSERT_OK(agg->AddRowBlock(block));
+
+  int64_t count = 0;
+  int64_t count_val = 0;
+  int64_t sum_val = 0;
+  double sum_dbl = 0;
+  for (int key = 1; key < 2 * kNumRows; key++) {
+    if (key < kNumRows && key % 2 == 0) continue;
+    count++;
+    sum_dbl += key / 2.0;
+    if (key % 3 != 0) {
+      count_val++;
+      sum_val += key * 10L;
+    }
+  }
+
+  Arena result_arena(1024);
+  RowBlock result(agg->result_schema(), 1, &result_arena);
+  agg->GetResult(&result);
+  RowBlockRow row = result.row(0);
+  EXPECT_EQ(count, *reinterpret_cast<const int64_t*>(row.cell_ptr(0)));
+  EXPECT_EQ(count_val, *reinterpret_cast<const int64_t*>(row.cell_ptr(1)));
+  // "val-1" is the smallest and "val-98" the largest string.
+  EXPECT_EQ("val-1", reinterpret_cast<const Slice*>(row.cell_ptr(2))->ToString());
+  EXPECT_EQ("val-98", reinterpret_cast<const Slice*>(row.cell_ptr(3))->ToString());
+  EXPECT_EQ(1, *reinterpret_cast<const int32_t*>(row.cell_ptr(4)));
+  EXPECT_EQ(980, *reinterpret_cast<const int64_t*>(row.cell_ptr(5)));
+  EXPECT_EQ(sum_val, *reinterpret_cast<const int64_t*>(row.cell_ptr(6)));
+  EXPECT_DOUBLE_EQ(sum_dbl, *reinterpret_cast<const double*>(row.cell_ptr(7)));
+}
+
+// Test the results of aggregating no rows at all.
+TEST_F(ScanAggregatorTest, TestEmpty) {
+  RepeatedPtrField<ScanAggregatePB> pbs;
+  AddAggregate(ScanAggregatePB::COUNT, "", &pbs);
+  AddAggregate(ScanAggregatePB::MIN, "str", &pbs);
+  AddAggregate(ScanAggregatePB::SUM, "val", &pbs);
+  unique_ptr<ScanAggregator> agg;
+  ASSERT_OK(ScanAggregator::Create(pbs, schema_, &agg));
+
+  Arena result_arena(1024);
+  RowBlock result(agg->result_schema(), 1, &result_arena);
+  agg->GetResult(&result);
+  RowBlockRow row = result.row(0);
+  EXPECT_EQ(0, *reinterpret_cast<const int64_t*>(row.cell_ptr(0)));
+  EXPECT_TRUE(row.is_null(1));
+  EXPECT_TRUE(row.is_null(2));
+}
+
+// Test aggregating rows grouped by a nullable column, over several blocks.
+TEST_F(ScanAggregatorTest, TestGroupBy) {
+  Schema schema({ ColumnSchema("key", INT32),
+                  ColumnSchema("grp", STRING, true /* nullable */),
+                  ColumnSchema("val", INT32) },
+                1);
+  RepeatedPtrField<ScanAggregatePB> pbs;
+  AddAggregate(ScanAggregatePB::COUNT, "", &pbs);
+  AddAggregate(ScanAggregatePB::SUM, "val", &pbs);
+  AddAggregate(ScanAggregatePB::MAX, "key", &pbs);
+  RepeatedPtrField<string> group_by;
+  *group_by.Add() = "grp";
+  unique_ptr<ScanAggregator> agg;
+  ASSERT_OK(ScanAggregator::Create(pbs, group_by, 10, schema, &agg));
+  ASSERT_EQ(4, agg->result_schema().num_columns());
+  ASSERT_EQ("grp", agg->result_schema().column(0).name());
+  ASSERT_EQ(0, agg->num_groups());
+
+  // Rows with a key divisible by 7 are in the NULL group, the others in the
+  // group of their key modulo 3.
+  const auto group_of = [](int key) {
+    return key % 7 == 0 ? string("NULL") : Substitute(R"("g$0")", key % 3);
+  };
+  std::map<string, std::tuple<int64_t, int64_t, int32_t>> expected;
+  const int kNumBlocks = 3;
+  const int kRowsPerBlock = 40;
+  for (int b = 0; b < kNumBlocks; b++) {
+    Arena block_arena(1024);
+    RowBlock block(schema, kRowsPerBlock, &block_arena);
+    block.selection_vector()->SetAllTrue();
+    for (int i = 0; i < kRowsPerBlock; i++) {
+      int key = b * kRowsPerBlock + i;
+      RowBlockRow row = block.row(i);
+      *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(0)) = key;
+      row.cell(1).set_null(key % 7 == 0);
+      Slice s;
+      CHECK(block_arena.RelocateSlice(Substitute("g$0", key % 3), &s));
+      *reinterpret_cast<Slice*>(row.mutable_cell_ptr(1)) = s;
+      *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(2)) = key % 10;
+      auto& e = expected[group_of(key)];
+      std::get<0>(e)++;
+      std::get<1>(e) += key % 10;
+      std::get<2>(e) = key;
+    }
+    ASSERT_OK(agg->AddRowBlock(block));
+  }
+  ASSERT_EQ(expected.size(), agg->num_groups());
+
+  Arena result_arena(1024);
+  RowBlock result(agg->result_schema(), agg->num_groups(), &result_arena);
+  agg->GetResult(&result);
+  vector<string> results;
+  for (int i = 0; i < result.nrows(); i++) {
+    results.emplace_back(agg->result_schema().DebugRow(result.row(i)));
+  }
+  std::sort(results.begin(), results.end());
+  vector<string> expected_results;
+  for (const auto& e : expected) {
+    expected_results.emplace_back(Substitute(
+        "(string grp=$0, int64 0:count(*)=$1, int64 1:sum(val)=$2, int32 2:max(key)=$3)",
+        e.first, std::get<0>(e.second), std::get<1>(e.second), std::get<2>(e.second)));
+  }
+  std::sort(expected_results.begin(), expected_results.end());
+  ASSERT_EQ(expected_results, results);
+}
+
+TEST_F(ScanAggregatorTest, TestAddGroups) {
+  RepeatedPtrField<ScanAggregatePB> pbs;
+  AddAggregate(ScanAggregatePB::COUNT, "", &pbs);
+  AddAggregate(ScanAggregatePB::COUNT, "val", &pbs);
+  AddAggregate(ScanAggregatePB::MIN, "str", &pbs);
+  AddAggregate(ScanAggregatePB::SUM, "val", &pbs);
+  RepeatedPtrField<string> group_by;
+  *group_by.Add() = "key";
+  unique_ptr<ScanAggregator> agg;
+  ASSERT_OK(ScanAggregator::Create(pbs, group_by, 10, schema_, &agg));
+
+  // The groups must have the grouping and aggregated columns.
+  const vector<string> kKeyColumns = { "key" };
+  const vector<string> kColumns = { "val", "str" };
+  ASSERT_TRUE(agg->CanAddGroups(kKeyColumns, kColumns));
+  ASSERT_FALSE(agg->CanAddGroups({}, kColumns));
+  ASSERT_FALSE(agg->CanAddGroups(kKeyColumns, { "val" }));
+
+  // Key 2 is both in a row and in a group, and key 3 only in a group.
+  Arena block_arena(1024);
+  RowBlock block(schema_, 1, &block_arena);
+  FillRowBlock(&block, 2);
+  ASSERT_OK(agg->AddRowBlock(block));
+  const auto make_group = [](int32_t key, int64_t count, int64_t val_count,
+                             const string& min_str, int64_t val_sum) {
+    AggregatedGroup group;
+    group.key_values.emplace_back(reinterpret_cast<const char*>(&key), sizeof(key));
+    group.count = count;
+    group.columns.resize(2);
+    group.columns[0].count = val_count;
+    group.columns[0].int_sum = val_sum;
+    group.columns[1].count = val_count;
+    group.columns[1].min = min_str;
+    group.columns[1].max = min_str;
+    return group;
+  };
+  ASSERT_OK(agg->AddGroups(kKeyColumns, kColumns, { make_group(2, 3, 2, "a", 100),
+                                                    make_group(3, 5, 0, "", 0) }));
+  ASSERT_EQ(2, agg->num_groups());
+
+  Arena result_arena(1024);
+  RowBlock result(agg->result_schema(), agg->num_groups(), &result_arena);
+  agg->GetResult(&result);
+  ASSERT_EQ("(int32 key=2, int64 0:count(*)=4, int64 1:count(val)=3, "
+            "string 2:min(str)=\"a\", int64 3:sum(val)=120)",
+            agg->result_schema().DebugRow(result.row(0)));
+  ASSERT_EQ("(int32 key=3, int64 0:count(*)=5, int64 1:count(val)=0, "
+            "string 2:min(str)=NULL, int64 3:sum(val)=NULL)",
+            agg->result_schema().DebugRow(result.row(1)));
+
+  // An overflowed SUM can't be folded.
+  AggregatedGroup overflowed = make_group(2, 1, 1, "b", 0);
+  overflowed.columns[0].sum_overflowed = true;
+  Status s = agg->AddGroups(kKeyColumns, kColumns, { overflowed });
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
+TEST_F(ScanAggregatorTest, TestTooManyGroups) {
+  RepeatedPtrField<ScanAggregatePB> pbs;
+  AddAggregate(ScanAggregatePB::COUNT, "", &pbs);
+  RepeatedPtrField<string> group_by;
+  *group_by.Add() = "key";
+  unique_ptr<ScanAggregator> agg;
+  ASSERT_OK(ScanAggregator::Create(pbs, group_by, 10, schema_, &agg));
+
+  Arena block_arena(1024);
+  RowBlock block(schema_, 20, &block_arena);
+  FillRowBlock(&block, 0);
+  Status s = agg->AddRowBlock(block);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "more than 10 groups");
+
+  // Grouping columns must exist, and be listed once.
+  *group_by.Add() = "missing";
+  s = ScanAggregator::Create(pbs, group_by, 10, schema_, &agg);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "unknown column");
+  *group_by.Mutable(1) = "key";
+  s = ScanAggregator::Create(pbs, group_by, 10, schema_, &agg);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "more than once");
+}
+
+TEST_F(ScanAggregatorTest, TestSumOverflow) {
+  Schema schema({ ColumnSchema("key", INT64) }, 1);
+  RepeatedPtrField<ScanAggregatePB> pbs;
+  AddAggregate(ScanAggregatePB::SUM, "key", &pbs);
+  unique_ptr<ScanAggregator> agg;
+  ASSERT_OK(ScanAggregator::Create(pbs, schema, &agg));
+
+  Arena block_arena(1024);
+  RowBlock block(schema, 2, &block_arena);
+  block.selection_vector()->SetAllTrue();
+  for (int i = 0; i < 2; i++) {
+    *reinterpret_cast<int64_t*>(block.row(i).mutable_cell_ptr(0)) =
+        std::numeric_limits<int64_t>::max();
+  }
+  Status s = agg->AddRowBlock(block);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "overflow");
+}
+
+TEST_F(ScanAggregatorTest, TestInvalidAggregates) {
+  {
+    RepeatedPtrField<ScanAggregatePB> pbs;
+    AddAggregate(ScanAggregatePB::SUM, "str", &pbs);
+    unique_ptr<ScanAggregator> agg;
+    Status s = ScanAggregator::Create(pbs, schema_, &agg);
+    ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+    ASSERT_STR_CONTAINS(s.ToString(), "SUM is not supported");
+  }
+  {
+    RepeatedPtrField<ScanAggregatePB> pbs;
+    AddAggregate(ScanAggregatePB::MIN, "", &pbs);
+    unique_ptr<ScanAggregator> agg;
+    Status s = ScanAggregator::Create(pbs, schema_, &agg);
+    ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+    ASSERT_STR_CONTAINS(s.ToString(), "requires a column");
+  }
+  {
+    RepeatedPtrField<ScanAggregatePB> pbs;
+    AddAggregate(ScanAggregatePB::MAX, "missing", &pbs);
+    unique_ptr<ScanAggregator> agg;
+    Status s = ScanAggregator::Create(pbs, schema_, &agg);
+    ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+    ASSERT_STR_CONTAINS(s.ToString(), "unknown column");
+  }
+  {
+    RepeatedPtrField<ScanAggregatePB> pbs;
+    AddAggregate(ScanAggregatePB::UNKNOWN, "key", &pbs);
+    unique_ptr<ScanAggregator> agg;
+    Status s = ScanAggregator::Create(pbs, schema_, &agg);
+    ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  }
+}
+
+} // namespace kudu
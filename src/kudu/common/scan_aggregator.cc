@@ -0,0 +1,691 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/scan_aggregator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <glog/logging.h>
+#include <google/protobuf/repeated_field.h>
+
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/hash/city.h"
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/safe_math.h"
+#include "kudu/util/slice.h"
+
+using std::string;
+using std::unique_ptr;
+using std::unordered_map;
+using std::unordered_set;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+struct ScanAggregator::Aggregate {
+  ScanAggregatePB::Type type;
+
+  // The name of the aggregated column, or empty for COUNT(*).
+  string column;
+
+  // The type of the aggregated column, or null for COUNT(*).
+  const TypeInfo* type_info = nullptr;
+};
+
+// The running value of an aggregate, for one group.
+struct ScanAggregator::AggregateState {
+  // For COUNT, the number of rows or non-NULL cells. Otherwise, the number of
+  // non-NULL cells folded into the aggregate.
+  int64_t count = 0;
+
+  // The running SUM, for integer and floating point columns respectively.
+  int64_t int_sum = 0;
+  double double_sum = 0;
+
+  // The current MIN or MAX value: the cell data, or for BINARY-based columns
+  // the bytes of the value.
+  faststring value;
+};
+
+namespace {
+
+struct SliceHash {
+  size_t operator()(const Slice& s) const {
+    return util_hash::CityHash64(reinterpret_cast<const char*>(s.data()), s.size());
+  }
+};
+
+} // anonymous namespace
+
+// The groups of an aggregator, in the order in which they were first seen.
+// An aggregator without grouping has a single group, with an empty key.
+struct ScanAggregator::GroupTable {
+  explicit GroupTable(size_t max_groups)
+      : max_groups(max_groups),
+        arena(1024) {
+  }
+
+  const size_t max_groups;
+
+  // The encoded grouping values of each group, and the aggregates of each
+  // group, with one state per aggregate.
+  vector<Slice> keys;
+  vector<vector<AggregateState>> states;
+
+  // The index of each group in 'keys' and 'states', by encoded key. The
+  // keys point into 'arena'.
+  unordered_map<Slice, size_t, SliceHash> index;
+  Arena arena;
+};
+
+namespace {
+
+bool IsIntegerType(DataType type) {
+  switch (type) {
+    case INT8:
+    case INT16:
+    case INT32:
+    case INT64:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool IsFloatingPointType(DataType type) {
+  return type == FLOAT || type == DOUBLE;
+}
+
+const char* AggregateName(ScanAggregatePB::Type type) {
+  switch (type) {
+    case ScanAggregatePB::COUNT: return "count";
+    case ScanAggregatePB::MIN: return "min";
+    case ScanAggregatePB::MAX: return "max";
+    case ScanAggregatePB::SUM: return "sum";
+    default: return "unknown";
+  }
+}
+
+// Returns whether the selected row 'idx' of 'col' has a non-NULL value.
+inline bool IsSelectedValue(const SelectionVector& sel, const ColumnBlock& col, size_t idx) {
+  return sel.IsRowSelected(idx) && !(col.is_nullable() && col.is_null(idx));
+}
+
+template<DataType Type>
+Status SumIntegers(const SelectionVector& sel, const ColumnBlock& col,
+                   int64_t* sum, int64_t* count) {
+  typedef typename DataTypeTraits<Type>::cpp_type T;
+  const T* values = reinterpret_cast<const T*>(col.data());
+  int64_t s = *sum;
+  int64_t n = 0;
+  for (size_t i = 0; i < sel.nrows(); i++) {
+    if (!IsSelectedValue(sel, col, i)) continue;
+    bool overflowed;
+    s = AddWithOverflowCheck<int64_t>(s, values[i], &overflowed);
+    if (PREDICT_FALSE(overflowed)) {
+      return Status::InvalidArgument("SUM overflowed INT64");
+    }
+    n++;
+  }
+  *sum = s;
+  *count += n;
+  return Status::OK();
+}
+
+template<DataType Type>
+void SumFloatingPoint(const SelectionVector& sel, const ColumnBlock& col,
+                      double* sum, int64_t* count) {
+  typedef typename DataTypeTraits<Type>::cpp_type T;
+  const T* values = reinterpret_cast<const T*>(col.data());
+  double s = *sum;
+  int64_t n = 0;
+  for (size_t i = 0; i < sel.nrows(); i++) {
+    if (!IsSelectedValue(sel, col, i)) continue;
+    s += values[i];
+    n++;
+  }
+  *sum = s;
+  *count += n;
+}
+
+// Adds the integer or floating point 'cell' of a column of type 'type_info'
+// to the running sum.
+Status AddToSum(const TypeInfo* type_info, const uint8_t* cell,
+                int64_t* int_sum, double* double_sum) {
+  int64_t v;
+  switch (type_info->physical_type()) {
+    case INT8: v = *reinterpret_cast<const int8_t*>(cell); break;
+    case INT16: v = *reinterpret_cast<const int16_t*>(cell); break;
+    case INT32: v = *reinterpret_cast<const int32_t*>(cell); break;
+    case INT64: v = *reinterpret_cast<const int64_t*>(cell); break;
+    case FLOAT:
+      *double_sum += *reinterpret_cast<const float*>(cell);
+      return Status::OK();
+    case DOUBLE:
+      *double_sum += *reinterpret_cast<const double*>(cell);
+      return Status::OK();
+    default:
+      LOG(FATAL) << "unexpected SUM type: " << type_info->name();
+  }
+  bool overflowed;
+  *int_sum = AddWithOverflowCheck<int64_t>(*int_sum, v, &overflowed);
+  if (PREDICT_FALSE(overflowed)) {
+    return Status::InvalidArgument("SUM overflowed INT64");
+  }
+  return Status::OK();
+}
+
+// Appends the value of row 'idx' of 'col' to the encoded grouping key 'key'.
+// The encoding only needs to preserve equality: a NULL flag for nullable
+// columns, followed by the cell data or, for BINARY-based columns, the
+// length and bytes of the value.
+void EncodeGroupValue(const ColumnBlock& col, size_t idx, faststring* key) {
+  if (col.is_nullable()) {
+    bool is_null = col.is_null(idx);
+    key->push_back(is_null);
+    if (is_null) return;
+  }
+  const uint8_t* cell = col.cell_ptr(idx);
+  if (col.type_info()->physical_type() == BINARY) {
+    const Slice* s = reinterpret_cast<const Slice*>(cell);
+    uint32_t size = s->size();
+    key->append(&size, sizeof(size));
+    key->append(s->data(), s->size());
+  } else {
+    key->append(cell, col.type_info()->size());
+  }
+}
+
+// Like the above, for the non-NULL 'value' of 'col', stored as the cell data
+// or, for BINARY-based columns, as the bytes of the value.
+void EncodeGroupValue(const ColumnSchema& col, const string& value, faststring* key) {
+  if (col.is_nullable()) {
+    key->push_back(false);
+  }
+  if (col.type_info()->physical_type() == BINARY) {
+    uint32_t size = value.size();
+    key->append(&size, sizeof(size));
+  } else {
+    DCHECK_EQ(col.type_info()->size(), value.size());
+  }
+  key->append(value.data(), value.size());
+}
+
+// Decodes a value encoded by EncodeGroupValue() at the front of 'key' into
+// the cell 'col' of 'row', advancing 'key' past it. Indirect data is copied
+// to 'arena'.
+void DecodeGroupValue(const ColumnSchema& col, size_t col_idx, Arena* arena,
+                      Slice* key, RowBlockRow* row) {
+  if (col.is_nullable()) {
+    bool is_null = (*key)[0];
+    key->remove_prefix(1);
+    row->cell(col_idx).set_null(is_null);
+    if (is_null) return;
+  }
+  uint8_t* dst = row->mutable_cell_ptr(col_idx);
+  if (col.type_info()->physical_type() == BINARY) {
+    uint32_t size;
+    memcpy(&size, key->data(), sizeof(size));
+    key->remove_prefix(sizeof(size));
+    CHECK(arena->RelocateSlice(Slice(key->data(), size), reinterpret_cast<Slice*>(dst)));
+    key->remove_prefix(size);
+  } else {
+    memcpy(dst, key->data(), col.type_info()->size());
+    key->remove_prefix(col.type_info()->size());
+  }
+}
+
+// Folds the non-NULL 'cell' into the MIN or MAX 'state'.
+template<class State>
+void UpdateMinMax(ScanAggregatePB::Type type, const TypeInfo* type_info,
+                  const uint8_t* cell, State* state) {
+  const bool is_binary = type_info->physical_type() == BINARY;
+  if (state->count > 0) {
+    // 'cur' points at the current value in the layout of a cell.
+    Slice cur_slice(state->value);
+    const void* cur = is_binary ? static_cast<const void*>(&cur_slice) : state->value.data();
+    int cmp = type_info->Compare(cell, cur);
+    if (type == ScanAggregatePB::MIN ? cmp >= 0 : cmp <= 0) {
+      state->count++;
+      return;
+    }
+  }
+  if (is_binary) {
+    const Slice* s = reinterpret_cast<const Slice*>(cell);
+    state->value.assign_copy(s->data(), s->size());
+  } else {
+    state->value.assign_copy(cell, type_info->size());
+  }
+  state->count++;
+}
+
+} // anonymous namespace
+
+ScanAggregator::ScanAggregator() {}
+
+ScanAggregator::~ScanAggregator() {}
+
+Status ScanAggregator::Create(
+    const google::protobuf::RepeatedPtrField<ScanAggregatePB>& aggregates,
+    const Schema& tablet_schema,
+    unique_ptr<ScanAggregator>* aggregator) {
+  return Create(aggregates, google::protobuf::RepeatedPtrField<string>(), 1,
+                tablet_schema, aggregator);
+}
+
+Status ScanAggregator::Create(
+    const google::protobuf::RepeatedPtrField<ScanAggregatePB>& aggregates,
+    const google::protobuf::RepeatedPtrField<string>& group_by,
+    size_t max_groups,
+    const Schema& tablet_schema,
+    unique_ptr<ScanAggregator>* aggregator) {
+  unique_ptr<ScanAggregator> agg(new ScanAggregator());
+  vector<ColumnSchema> result_cols;
+  unordered_set<string> input_names;
+  unordered_set<string> group_by_names;
+  for (const string& name : group_by) {
+    int col_idx = tablet_schema.find_column(name);
+    if (col_idx == Schema::kColumnNotFound) {
+      return Status::InvalidArgument("unknown column in grouping", name);
+    }
+    if (!InsertIfNotPresent(&group_by_names, name)) {
+      return Status::InvalidArgument("column grouped by more than once", name);
+    }
+    const ColumnSchema& col = tablet_schema.column(col_idx);
+    agg->group_by_columns_.emplace_back(col);
+    result_cols.emplace_back(col.name(), col.type_info()->type(), col.is_nullable(),
+                             nullptr, nullptr, ColumnStorageAttributes(),
+                             col.type_attributes());
+    if (InsertIfNotPresent(&input_names, col.name())) {
+      agg->input_columns_.emplace_back(col);
+    }
+  }
+  for (int i = 0; i < aggregates.size(); i++) {
+    const ScanAggregatePB& pb = aggregates.Get(i);
+    unique_ptr<Aggregate> a(new Aggregate());
+    a->type = pb.type();
+    if (a->type != ScanAggregatePB::COUNT &&
+        a->type != ScanAggregatePB::MIN &&
+        a->type != ScanAggregatePB::MAX &&
+        a->type != ScanAggregatePB::SUM) {
+      return Status::InvalidArgument("unknown aggregate type", pb.ShortDebugString());
+    }
+    const ColumnSchema* col = nullptr;
+    if (pb.has_column()) {
+      int col_idx = tablet_schema.find_column(pb.column());
+      if (col_idx == Schema::kColumnNotFound) {
+        return Status::InvalidArgument("unknown column in aggregate", pb.column());
+      }
+      col = &tablet_schema.column(col_idx);
+      a->column = col->name();
+      a->type_info = col->type_info();
+      if (InsertIfNotPresent(&input_names, col->name())) {
+        agg->input_columns_.emplace_back(*col);
+      }
+    } else if (a->type != ScanAggregatePB::COUNT) {
+      return Status::InvalidArgument(
+          Substitute("$0 aggregate requires a column", AggregateName(a->type)));
+    }
+
+    string result_name = Substitute("$0:$1($2)", i, AggregateName(a->type),
+                                    col ? col->name() : "*");
+    switch (a->type) {
+      case ScanAggregatePB::COUNT:
+        result_cols.emplace_back(result_name, INT64);
+        break;
+      case ScanAggregatePB::MIN:
+      case ScanAggregatePB::MAX:
+        result_cols.emplace_back(result_name, col->type_info()->type(), true /* nullable */,
+                                 nullptr, nullptr, ColumnStorageAttributes(),
+                                 col->type_attributes());
+        break;
+      case ScanAggregatePB::SUM:
+        if (IsIntegerType(col->type_info()->type())) {
+          result_cols.emplace_back(result_name, INT64, true /* nullable */);
+        } else if (IsFloatingPointType(col->type_info()->type())) {
+          result_cols.emplace_back(result_name, DOUBLE, true /* nullable */);
+        } else {
+          return Status::InvalidArgument(
+              Substitute("SUM is not supported for column $0 of type $1",
+                         col->name(), col->type_info()->name()));
+        }
+        break;
+      default:
+        LOG(FATAL) << "unreachable";
+    }
+    agg->aggregates_.emplace_back(std::move(a));
+  }
+  RETURN_NOT_OK(agg->result_schema_.Reset(result_cols, 0));
+
+  agg->groups_.reset(new GroupTable(max_groups));
+  if (agg->group_by_columns_.empty()) {
+    // Without grouping, there's always exactly one result row.
+    agg->groups_->keys.emplace_back();
+    agg->groups_->states.emplace_back(agg->aggregates_.size());
+  }
+  *aggregator = std::move(agg);
+  return Status::OK();
+}
+
+size_t ScanAggregator::num_groups() const {
+  return groups_->keys.size();
+}
+
+Status ScanAggregator::AddRowBlock(const RowBlock& block) {
+  const SelectionVector& sel = *block.selection_vector();
+  if (!sel.AnySelected()) {
+    return Status::OK();
+  }
+  if (group_by_columns_.empty()) {
+    return AddRowBlockUngrouped(block, &groups_->states[0]);
+  }
+
+  vector<ColumnBlock> group_cols;
+  for (const ColumnSchema& col : group_by_columns_) {
+    int col_idx = block.schema().find_column(col.name());
+    DCHECK_NE(Schema::kColumnNotFound, col_idx) << col.name();
+    group_cols.emplace_back(block.column_block(col_idx));
+  }
+  // The aggregated columns, or null for COUNT(*).
+  vector<unique_ptr<ColumnBlock>> agg_cols;
+  for (const auto& a : aggregates_) {
+    if (a->column.empty()) {
+      agg_cols.emplace_back();
+      continue;
+    }
+    int col_idx = block.schema().find_column(a->column);
+    DCHECK_NE(Schema::kColumnNotFound, col_idx) << a->column;
+    agg_cols.emplace_back(new ColumnBlock(block.column_block(col_idx)));
+  }
+
+  // Look up the group of each selected row, and fold the row into the
+  // aggregates of its group.
+  faststring key;
+  for (size_t i = 0; i < sel.nrows(); i++) {
+    if (!sel.IsRowSelected(i)) continue;
+    key.clear();
+    for (const ColumnBlock& col : group_cols) {
+      EncodeGroupValue(col, i, &key);
+    }
+    size_t group_idx;
+    RETURN_NOT_OK(FindOrAddGroup(Slice(key), &group_idx));
+
+    vector<AggregateState>& states = groups_->states[group_idx];
+    for (size_t j = 0; j < aggregates_.size(); j++) {
+      const Aggregate& a = *aggregates_[j];
+      AggregateState* state = &states[j];
+      const ColumnBlock* col = agg_cols[j].get();
+      if (col == nullptr) {
+        state->count++;
+        continue;
+      }
+      if (col->is_nullable() && col->is_null(i)) continue;
+      const uint8_t* cell = col->cell_ptr(i);
+      switch (a.type) {
+        case ScanAggregatePB::COUNT:
+          state->count++;
+          break;
+        case ScanAggregatePB::MIN:
+        case ScanAggregatePB::MAX:
+          UpdateMinMax(a.type, a.type_info, cell, state);
+          break;
+        case ScanAggregatePB::SUM:
+          RETURN_NOT_OK(AddToSum(a.type_info, cell, &state->int_sum, &state->double_sum));
+          state->count++;
+          break;
+        default:
+          LOG(FATAL) << "unreachable";
+      }
+    }
+  }
+  return Status::OK();
+}
+
+Status ScanAggregator::FindOrAddGroup(const Slice& key, size_t* group_idx) {
+  size_t* found = FindOrNull(groups_->index, key);
+  if (found) {
+    *group_idx = *found;
+    return Status::OK();
+  }
+  if (groups_->keys.size() >= groups_->max_groups) {
+    return Status::InvalidArgument(
+        Substitute("aggregate scan has more than $0 groups", groups_->max_groups));
+  }
+  Slice stored_key;
+  if (PREDICT_FALSE(!groups_->arena.RelocateSlice(key, &stored_key))) {
+    return Status::RuntimeError("out of memory allocating aggregate group");
+  }
+  *group_idx = groups_->keys.size();
+  groups_->keys.push_back(stored_key);
+  groups_->states.emplace_back(aggregates_.size());
+  InsertOrDie(&groups_->index, stored_key, *group_idx);
+  return Status::OK();
+}
+
+bool ScanAggregator::CanAddGroups(const vector<string>& key_columns,
+                                  const vector<string>& columns) const {
+  for (const ColumnSchema& col : group_by_columns_) {
+    if (std::find(key_columns.begin(), key_columns.end(), col.name()) == key_columns.end()) {
+      return false;
+    }
+  }
+  for (const auto& a : aggregates_) {
+    if (!a->column.empty() &&
+        std::find(columns.begin(), columns.end(), a->column) == columns.end()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Status ScanAggregator::AddGroups(const vector<string>& key_columns,
+                                 const vector<string>& columns,
+                                 const vector<AggregatedGroup>& groups) {
+  DCHECK(CanAddGroups(key_columns, columns));
+  // The index of each grouping column in 'key_columns', and of each
+  // aggregated column in 'columns' (-1 for COUNT(*)).
+  vector<size_t> key_idxs;
+  for (const ColumnSchema& col : group_by_columns_) {
+    key_idxs.push_back(std::find(key_columns.begin(), key_columns.end(), col.name()) -
+                       key_columns.begin());
+  }
+  vector<int> col_idxs;
+  for (const auto& a : aggregates_) {
+    col_idxs.push_back(a->column.empty() ? -1 : static_cast<int>(
+        std::find(columns.begin(), columns.end(), a->column) - columns.begin()));
+  }
+
+  faststring key;
+  for (const AggregatedGroup& group : groups) {
+    DCHECK_EQ(key_columns.size(), group.key_values.size());
+    DCHECK_EQ(columns.size(), group.columns.size());
+    // Without grouping, all the groups fold into the single result row.
+    size_t group_idx = 0;
+    if (!group_by_columns_.empty()) {
+      key.clear();
+      for (size_t i = 0; i < group_by_columns_.size(); i++) {
+        EncodeGroupValue(group_by_columns_[i], group.key_values[key_idxs[i]], &key);
+      }
+      RETURN_NOT_OK(FindOrAddGroup(Slice(key), &group_idx));
+    }
+
+    vector<AggregateState>& states = groups_->states[group_idx];
+    for (size_t j = 0; j < aggregates_.size(); j++) {
+      const Aggregate& a = *aggregates_[j];
+      AggregateState* state = &states[j];
+      if (col_idxs[j] < 0) {
+        state->count += group.count;
+        continue;
+      }
+      const AggregatedGroup::Column& col = group.columns[col_idxs[j]];
+      if (col.count == 0) continue;
+      switch (a.type) {
+        case ScanAggregatePB::COUNT:
+          state->count += col.count;
+          break;
+        case ScanAggregatePB::MIN:
+        case ScanAggregatePB::MAX: {
+          const string& value = a.type == ScanAggregatePB::MIN ? col.min : col.max;
+          Slice value_slice(value);
+          const void* cell = a.type_info->physical_type() == BINARY ?
+              static_cast<const void*>(&value_slice) : value.data();
+          // UpdateMinMax() counts a single cell.
+          UpdateMinMax(a.type, a.type_info, static_cast<const uint8_t*>(cell), state);
+          state->count += col.count - 1;
+          break;
+        }
+        case ScanAggregatePB::SUM:
+          if (IsIntegerType(a.type_info->type())) {
+            bool overflowed;
+            state->int_sum = AddWithOverflowCheck<int64_t>(state->int_sum, col.int_sum,
+                                                           &overflowed);
+            if (PREDICT_FALSE(overflowed || col.sum_overflowed)) {
+              return Status::InvalidArgument("SUM overflowed INT64");
+            }
+          } else {
+            state->double_sum += col.double_sum;
+          }
+          state->count += col.count;
+          break;
+        default:
+          LOG(FATAL) << "unreachable";
+      }
+    }
+  }
+  return Status::OK();
+}
+
+Status ScanAggregator::AddRowBlockUngrouped(const RowBlock& block,
+                                            vector<AggregateState>* states) {
+  const SelectionVector& sel = *block.selection_vector();
+  for (size_t j = 0; j < aggregates_.size(); j++) {
+    const Aggregate& a = *aggregates_[j];
+    AggregateState* state = &(*states)[j];
+    if (a.column.empty()) {
+      state->count += sel.CountSelected();
+      continue;
+    }
+    int col_idx = block.schema().find_column(a.column);
+    DCHECK_NE(Schema::kColumnNotFound, col_idx) << a.column;
+    ColumnBlock col = block.column_block(col_idx);
+
+    switch (a.type) {
+      case ScanAggregatePB::COUNT:
+        for (size_t i = 0; i < sel.nrows(); i++) {
+          if (IsSelectedValue(sel, col, i)) state->count++;
+        }
+        break;
+      case ScanAggregatePB::MIN:
+      case ScanAggregatePB::MAX:
+        for (size_t i = 0; i < sel.nrows(); i++) {
+          if (!IsSelectedValue(sel, col, i)) continue;
+          UpdateMinMax(a.type, a.type_info, col.cell_ptr(i), state);
+        }
+        break;
+      case ScanAggregatePB::SUM:
+        switch (a.type_info->physical_type()) {
+          case INT8:
+            RETURN_NOT_OK(SumIntegers<INT8>(sel, col, &state->int_sum, &state->count));
+            break;
+          case INT16:
+            RETURN_NOT_OK(SumIntegers<INT16>(sel, col, &state->int_sum, &state->count));
+            break;
+          case INT32:
+            RETURN_NOT_OK(SumIntegers<INT32>(sel, col, &state->int_sum, &state->count));
+            break;
+          case INT64:
+            RETURN_NOT_OK(SumIntegers<INT64>(sel, col, &state->int_sum, &state->count));
+            break;
+          case FLOAT:
+            SumFloatingPoint<FLOAT>(sel, col, &state->double_sum, &state->count);
+            break;
+          case DOUBLE:
+            SumFloatingPoint<DOUBLE>(sel, col, &state->double_sum, &state->count);
+            break;
+          default:
+            LOG(FATAL) << "unexpected SUM type: " << a.type_info->name();
+        }
+        break;
+      default:
+        LOG(FATAL) << "unreachable";
+    }
+  }
+  return Status::OK();
+}
+
+void ScanAggregator::GetResult(RowBlock* block) const {
+  DCHECK(block->schema().Equals(result_schema_));
+  DCHECK_GE(block->nrows(), num_groups());
+  const size_t num_group_cols = group_by_columns_.size();
+  for (size_t r = 0; r < num_groups(); r++) {
+    RowBlockRow row = block->row(r);
+    Slice key = groups_->keys[r];
+    for (size_t i = 0; i < num_group_cols; i++) {
+      DecodeGroupValue(group_by_columns_[i], i, block->arena(), &key, &row);
+    }
+    DCHECK(key.empty());
+
+    const vector<AggregateState>& states = groups_->states[r];
+    for (size_t j = 0; j < aggregates_.size(); j++) {
+      const Aggregate& a = *aggregates_[j];
+      const AggregateState& state = states[j];
+      const size_t col_idx = num_group_cols + j;
+      uint8_t* dst = row.mutable_cell_ptr(col_idx);
+      if (a.type == ScanAggregatePB::COUNT) {
+        *reinterpret_cast<int64_t*>(dst) = state.count;
+        continue;
+      }
+      row.cell(col_idx).set_null(state.count == 0);
+      if (state.count == 0) {
+        continue;
+      }
+      switch (a.type) {
+        case ScanAggregatePB::MIN:
+        case ScanAggregatePB::MAX:
+          if (a.type_info->physical_type() == BINARY) {
+            Slice* dst_slice = reinterpret_cast<Slice*>(dst);
+            CHECK(block->arena()->RelocateSlice(Slice(state.value), dst_slice));
+          } else {
+            memcpy(dst, state.value.data(), a.type_info->size());
+          }
+          break;
+        case ScanAggregatePB::SUM:
+          if (IsIntegerType(a.type_info->type())) {
+            *reinterpret_cast<int64_t*>(dst) = state.int_sum;
+          } else {
+            *reinterpret_cast<double*>(dst) = state.double_sum;
+          }
+          break;
+        default:
+          LOG(FATAL) << "unreachable";
+      }
+    }
+  }
+}
+
+} // namespace kudu
@@ -0,0 +1,173 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "kudu/common/schema.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/status.h"
+
+namespace google {
+namespace protobuf {
+template <typename Element> class RepeatedPtrField;
+}
+}
+
+namespace kudu {
+
+class RowBlock;
+class ScanAggregatePB;
+class Slice;
+
+// The aggregates of a group of rows computed ahead of a scan, e.g. those of
+// the rows of a rowset which share a prefix of the primary key (see
+// tablet/rollup.h). Values are stored as the cell data or, for BINARY-based
+// columns, as the bytes of the value.
+struct AggregatedGroup {
+  // The aggregates of the non-NULL cells of a column.
+  struct Column {
+    int64_t count = 0;
+
+    // The smallest and largest values, if 'count' is positive.
+    std::string min;
+    std::string max;
+
+    // The sum of the values, for integer and floating point columns
+    // respectively. 'sum_overflowed' is set if an integer sum overflowed.
+    int64_t int_sum = 0;
+    double double_sum = 0;
+    bool sum_overflowed = false;
+  };
+
+  // The values of the columns the rows are grouped by.
+  std::vector<std::string> key_values;
+
+  // The number of rows.
+  int64_t count = 0;
+
+  // The aggregates of each aggregated column.
+  std::vector<Column> columns;
+};
+
+// Folds the selected rows of a scan into a set of COUNT, MIN, MAX and SUM
+// aggregates, so that a tablet server can return a single row of partial
+// aggregates instead of every matching row.
+//
+// The rows may also be grouped by the values of some columns, in which case
+// there's one row of aggregates per group. The groups are kept in a hash
+// table keyed by the encoded values of the grouping columns, so grouping is
+// meant for columns with few distinct values.
+//
+// The aggregates are composable: the results of several aggregators (e.g. of
+// the different tablets of a table) can be combined by the caller into the
+// aggregates of the union of their rows, group by group.
+class ScanAggregator {
+ public:
+  // Creates an aggregator for 'aggregates' over columns of 'tablet_schema',
+  // grouping the rows by the columns named in 'group_by', if any. At most
+  // 'max_groups' groups may be created.
+  //
+  // Returns InvalidArgument if an aggregate is malformed, references a
+  // column which doesn't exist, or is not supported for the column's type,
+  // or if a grouping column doesn't exist or is listed more than once.
+  static Status Create(
+      const google::protobuf::RepeatedPtrField<ScanAggregatePB>& aggregates,
+      const google::protobuf::RepeatedPtrField<std::string>& group_by,
+      size_t max_groups,
+      const Schema& tablet_schema,
+      std::unique_ptr<ScanAggregator>* aggregator);
+
+  // Like the above, without grouping.
+  static Status Create(
+      const google::protobuf::RepeatedPtrField<ScanAggregatePB>& aggregates,
+      const Schema& tablet_schema,
+      std::unique_ptr<ScanAggregator>* aggregator);
+
+  ~ScanAggregator();
+
+  // The columns which the aggregates and the grouping read. The row blocks
+  // passed to AddRowBlock() must contain these columns.
+  const std::vector<ColumnSchema>& input_columns() const { return input_columns_; }
+
+  // The schema of the result rows: one column per grouping column, with the
+  // column's name and type, followed by one column per aggregate.
+  const Schema& result_schema() const { return result_schema_; }
+
+  // Folds the selected rows of 'block' into the aggregates of their groups.
+  //
+  // Returns InvalidArgument if an integer SUM overflows, or if the rows
+  // would create more than 'max_groups' groups.
+  Status AddRowBlock(const RowBlock& block);
+
+  // Returns true if the aggregates of a set of rows may be computed from
+  // groups of these rows keyed by the columns named in 'key_columns', with
+  // the aggregates of the columns named in 'columns': every grouping column
+  // must be one of 'key_columns', and every aggregated column one of
+  // 'columns'.
+  bool CanAddGroups(const std::vector<std::string>& key_columns,
+                    const std::vector<std::string>& columns) const;
+
+  // Folds 'groups', keyed by 'key_columns' and with the aggregates of
+  // 'columns', into the aggregates. CanAddGroups() must be true for the
+  // columns.
+  //
+  // Returns InvalidArgument like AddRowBlock().
+  Status AddGroups(const std::vector<std::string>& key_columns,
+                   const std::vector<std::string>& columns,
+                   const std::vector<AggregatedGroup>& groups);
+
+  // The number of result rows: one per group, or exactly one if the rows
+  // aren't grouped.
+  size_t num_groups() const;
+
+  // Writes the current aggregates into the first num_groups() rows of
+  // 'block', which must have result_schema(). Indirect data is allocated
+  // from the block's arena.
+  void GetResult(RowBlock* block) const;
+
+ private:
+  struct Aggregate;
+  struct AggregateState;
+  struct GroupTable;
+
+  ScanAggregator();
+
+  // Folds the selected rows of 'block' into the aggregates of the single
+  // group of an aggregator without grouping.
+  Status AddRowBlockUngrouped(const RowBlock& block, std::vector<AggregateState>* states);
+
+  // Sets 'group_idx' to the index of the group with the encoded grouping
+  // values 'key', adding the group if it's new.
+  Status FindOrAddGroup(const Slice& key, size_t* group_idx);
+
+  std::vector<std::unique_ptr<Aggregate>> aggregates_;
+  std::vector<ColumnSchema> group_by_columns_;
+  std::vector<ColumnSchema> input_columns_;
+  Schema result_schema_;
+
+  // The aggregates of each group.
+  std::unique_ptr<GroupTable> groups_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScanAggregator);
+};
+
+} // namespace kudu
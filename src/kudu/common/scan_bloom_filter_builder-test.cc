@@ -0,0 +1,175 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/scan_bloom_filter_builder.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/row.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+class ScanBloomFilterBuilderTest : public KuduTest {
+ public:
+  ScanBloomFilterBuilderTest()
+      : schema_({ ColumnSchema("key", INT32),
+                  ColumnSchema("str", STRING, true /* nullable */) },
+                1) {
+  }
+
+  static ScanBloomFilterPB MakePB(const string& column, uint64_t expected_count) {
+    ScanBloomFilterPB pb;
+    pb.set_column(column);
+    pb.set_expected_count(expected_count);
+    return pb;
+  }
+
+  // Adds the rows with keys in ['start', 'end') to 'builder'. The 'str'
+  // column is the string form of the key, or NULL for odd keys.
+  void AddRows(int32_t start, int32_t end, ScanBloomFilterBuilder* builder) {
+    Arena arena(1024);
+    RowBlock block(schema_, end - start, &arena);
+    block.selection_vector()->SetAllTrue();
+    for (int32_t k = start; k < end; k++) {
+      RowBlockRow row = block.row(k - start);
+      *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(0)) = k;
+      row.cell(1).set_null(k % 2 != 0);
+      Slice s;
+      CHECK(arena.RelocateSlice(Substitute("$0", k), &s));
+      *reinterpret_cast<Slice*>(row.mutable_cell_ptr(1)) = s;
+    }
+    builder->AddRowBlock(block);
+  }
+
+  // Returns the number of hashes and the bitmap of the filter of 'builder'.
+  static std::pair<int32_t, string> GetResult(const ScanBloomFilterBuilder& builder) {
+    Arena arena(1024);
+    RowBlock block(builder.result_schema(), 1, &arena);
+    CHECK_OK(builder.GetResult(&block));
+    RowBlockRow row = block.row(0);
+    return { *reinterpret_cast<const int32_t*>(row.cell_ptr(0)),
+             reinterpret_cast<const Slice*>(row.cell_ptr(1))->ToString() };
+  }
+
+ protected:
+  Schema schema_;
+};
+
+// Builds the filters of two disjoint sets of rows, merges them, and checks
+// that the InBloomFilter predicate of the merged filter matches the values
+// of both sets.
+TEST_F(ScanBloomFilterBuilderTest, TestBuildAndMerge) {
+  const int kNumRows = 1000;
+  unique_ptr<ScanBloomFilterBuilder> b1;
+  unique_ptr<ScanBloomFilterBuilder> b2;
+  ASSERT_OK(ScanBloomFilterBuilder::Create(MakePB("key", kNumRows), 1024 * 1024, schema_, &b1));
+  ASSERT_OK(ScanBloomFilterBuilder::Create(MakePB("key", kNumRows), 1024 * 1024, schema_, &b2));
+  ASSERT_EQ("key", b1->input_column().name());
+  AddRows(0, kNumRows / 2, b1.get());
+  AddRows(kNumRows / 2, kNumRows, b2.get());
+  ASSERT_EQ(kNumRows / 2, b1->num_values());
+
+  auto r1 = GetResult(*b1);
+  auto r2 = GetResult(*b2);
+  ASSERT_EQ(r1.first, r2.first);
+  ASSERT_OK(ScanBloomFilterBuilder::MergeBloomData(r2.second, &r1.second));
+
+  vector<ColumnPredicate::BloomFilterInner> bfs;
+  bfs.emplace_back(Slice(r1.second), r1.first, CITY_HASH);
+  ColumnPredicate pred = ColumnPredicate::InBloomFilter(schema_.column(0), &bfs,
+                                                        nullptr, nullptr);
+  for (int32_t k = 0; k < kNumRows; k++) {
+    ASSERT_TRUE(pred.EvaluateCell<INT32>(&k)) << k;
+  }
+  // With the default 1% false positive rate, few other values match.
+  int false_positives = 0;
+  for (int32_t k = kNumRows; k < 2 * kNumRows; k++) {
+    false_positives += pred.EvaluateCell<INT32>(&k);
+  }
+  ASSERT_LT(false_positives, kNumRows / 20);
+}
+
+// Builds a filter over a nullable STRING column, which skips the NULLs.
+TEST_F(ScanBloomFilterBuilderTest, TestNullableBinaryColumn) {
+  const int kNumRows = 100;
+  ScanBloomFilterPB pb = MakePB("str", kNumRows);
+  pb.set_hash_algorithm(MURMUR_HASH_2);
+  unique_ptr<ScanBloomFilterBuilder> builder;
+  ASSERT_OK(ScanBloomFilterBuilder::Create(pb, 1024 * 1024, schema_, &builder));
+  AddRows(0, kNumRows, builder.get());
+  ASSERT_EQ(kNumRows / 2, builder->num_values());
+
+  auto result = GetResult(*builder);
+  vector<ColumnPredicate::BloomFilterInner> bfs;
+  bfs.emplace_back(Slice(result.second), result.first, MURMUR_HASH_2);
+  ColumnPredicate pred = ColumnPredicate::InBloomFilter(schema_.column(1), &bfs,
+                                                        nullptr, nullptr);
+  for (int32_t k = 0; k < kNumRows; k += 2) {
+    string value = Substitute("$0", k);
+    Slice s(value);
+    ASSERT_TRUE(pred.EvaluateCell<BINARY>(&s)) << value;
+  }
+}
+
+TEST_F(ScanBloomFilterBuilderTest, TestInvalidRequests) {
+  unique_ptr<ScanBloomFilterBuilder> builder;
+  Status s = ScanBloomFilterBuilder::Create(MakePB("missing", 10), 1024, schema_, &builder);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "unknown column");
+
+  s = ScanBloomFilterBuilder::Create(MakePB("key", 0), 1024, schema_, &builder);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "positive expected count");
+
+  ScanBloomFilterPB pb = MakePB("key", 10);
+  pb.set_fp_rate(1);
+  s = ScanBloomFilterBuilder::Create(pb, 1024, schema_, &builder);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "false positive rate");
+
+  s = ScanBloomFilterBuilder::Create(MakePB("key", 1000000), 1024, schema_, &builder);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "exceeds the maximum");
+
+  string dst(16, '\0');
+  s = ScanBloomFilterBuilder::MergeBloomData(Slice(string(8, '\0')), &dst);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
+} // namespace kudu
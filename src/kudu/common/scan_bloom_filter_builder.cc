@@ -0,0 +1,125 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/scan_bloom_filter_builder.h"
+
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/strings/substitute.h"
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+ScanBloomFilterBuilder::ScanBloomFilterBuilder(ColumnSchema input_column,
+                                               const BloomFilterSizing& sizing,
+                                               HashAlgorithm hash_algorithm)
+    : input_column_(std::move(input_column)),
+      hash_algorithm_(hash_algorithm),
+      filter_(sizing) {
+}
+
+ScanBloomFilterBuilder::~ScanBloomFilterBuilder() {}
+
+Status ScanBloomFilterBuilder::Create(const ScanBloomFilterPB& pb,
+                                      size_t max_bytes,
+                                      const Schema& tablet_schema,
+                                      unique_ptr<ScanBloomFilterBuilder>* builder) {
+  int col_idx = tablet_schema.find_column(pb.column());
+  if (col_idx == Schema::kColumnNotFound) {
+    return Status::InvalidArgument("unknown column in bloom filter", pb.column());
+  }
+  if (pb.expected_count() == 0) {
+    return Status::InvalidArgument("bloom filters require a positive expected count");
+  }
+  if (!(pb.fp_rate() > 0 && pb.fp_rate() < 1)) {
+    return Status::InvalidArgument(
+        Substitute("bloom filter false positive rate $0 is not in (0, 1)", pb.fp_rate()));
+  }
+  // Check the size before BloomFilterSizing computes it, since it CHECKs
+  // that the size fits in an int.
+  double n_bytes = -static_cast<double>(pb.expected_count()) * std::log(pb.fp_rate()) /
+                   (M_LN2 * M_LN2) / 8;
+  if (n_bytes > max_bytes) {
+    return Status::InvalidArgument(
+        Substitute("bloom filter of $0 bytes exceeds the maximum of $1 bytes",
+                   static_cast<uint64_t>(std::ceil(n_bytes)), max_bytes));
+  }
+  unique_ptr<ScanBloomFilterBuilder> b(new ScanBloomFilterBuilder(
+      tablet_schema.column(col_idx),
+      BloomFilterSizing::ByCountAndFPRate(pb.expected_count(), pb.fp_rate()),
+      pb.hash_algorithm()));
+  RETURN_NOT_OK(b->result_schema_.Reset({ ColumnSchema("nhash", INT32),
+                                          ColumnSchema("bloom_data", BINARY) }, 0));
+  *builder = std::move(b);
+  return Status::OK();
+}
+
+void ScanBloomFilterBuilder::AddRowBlock(const RowBlock& block) {
+  int col_idx = block.schema().find_column(input_column_.name());
+  DCHECK_NE(Schema::kColumnNotFound, col_idx) << input_column_.name();
+  const ColumnBlock col = block.column_block(col_idx);
+  const SelectionVector* sel = block.selection_vector();
+  // Hash the cells as ColumnPredicate::EvaluateCellForBloomFilter() does:
+  // the data of BINARY cells, and the in-memory value of the other cells.
+  const bool is_binary = col.type_info()->physical_type() == BINARY;
+  const size_t size = col.type_info()->size();
+  for (size_t i = 0; i < block.nrows(); i++) {
+    if (!sel->IsRowSelected(i) || (col.is_nullable() && col.is_null(i))) continue;
+    const uint8_t* cell = col.cell_ptr(i);
+    Slice value = is_binary ? *reinterpret_cast<const Slice*>(cell) : Slice(cell, size);
+    filter_.AddKey(BloomKeyProbe(value, hash_algorithm_));
+  }
+}
+
+Status ScanBloomFilterBuilder::GetResult(RowBlock* block) const {
+  DCHECK(block->schema().Equals(result_schema_));
+  DCHECK_GE(block->nrows(), 1);
+  RowBlockRow row = block->row(0);
+  *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(0)) = filter_.n_hashes();
+  Slice bloom_data;
+  if (PREDICT_FALSE(!block->arena()->RelocateSlice(filter_.slice(), &bloom_data))) {
+    return Status::RuntimeError("out of memory allocating bloom filter");
+  }
+  *reinterpret_cast<Slice*>(row.mutable_cell_ptr(1)) = bloom_data;
+  return Status::OK();
+}
+
+Status ScanBloomFilterBuilder::MergeBloomData(const Slice& src, string* dst) {
+  if (src.size() != dst->size()) {
+    return Status::InvalidArgument(
+        Substitute("can't merge bloom filters of $0 and $1 bytes", src.size(), dst->size()));
+  }
+  for (size_t i = 0; i < src.size(); i++) {
+    (*dst)[i] |= src[i];
+  }
+  return Status::OK();
+}
+
+} // namespace kudu
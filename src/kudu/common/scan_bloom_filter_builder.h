@@ -0,0 +1,101 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "kudu/common/schema.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/bloom_filter.h"
+#include "kudu/util/hash.pb.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class RowBlock;
+class ScanBloomFilterPB;
+
+// Builds a bloom filter over the non-NULL values of a column of the selected
+// rows of a scan, so that a tablet server can return a filter of the values
+// of a (small) table instead of its rows. The filter can then be used as an
+// InBloomFilter predicate on the same values in the scans of another table,
+// which is how a semi-join is pushed down to the scans of the larger side of
+// a join.
+//
+// The values are hashed the same way ColumnPredicate probes them, and the
+// filters of several builders created from the same request (e.g. for the
+// different tablets of a table) have the same size and number of hashes, so
+// that the caller can merge them with MergeBloomData().
+class ScanBloomFilterBuilder {
+ public:
+  // Creates a builder for the filter described by 'pb' over a column of
+  // 'tablet_schema'. The filter may be at most 'max_bytes' bytes.
+  //
+  // Returns InvalidArgument if the column doesn't exist, if the expected
+  // count or false positive rate is out of range, or if the filter would be
+  // larger than 'max_bytes'.
+  static Status Create(const ScanBloomFilterPB& pb,
+                       size_t max_bytes,
+                       const Schema& tablet_schema,
+                       std::unique_ptr<ScanBloomFilterBuilder>* builder);
+
+  ~ScanBloomFilterBuilder();
+
+  // The column whose values are added to the filter. The row blocks passed
+  // to AddRowBlock() must contain this column.
+  const ColumnSchema& input_column() const { return input_column_; }
+
+  // The schema of the result row: an INT32 'nhash' column and a BINARY
+  // 'bloom_data' column.
+  const Schema& result_schema() const { return result_schema_; }
+
+  // Adds the non-NULL values of the input column of the selected rows of
+  // 'block' to the filter.
+  void AddRowBlock(const RowBlock& block);
+
+  // The number of values added to the filter, including duplicates.
+  size_t num_values() const { return filter_.count(); }
+
+  // Writes the filter into the first row of 'block', which must have
+  // result_schema(). The bitmap is allocated from the block's arena.
+  Status GetResult(RowBlock* block) const;
+
+  // ORs the bitmap 'src' of a filter into the bitmap 'dst' of a filter with
+  // the same size and number of hashes, so that 'dst' contains the values
+  // of both.
+  //
+  // Returns InvalidArgument if the bitmaps don't have the same size.
+  static Status MergeBloomData(const Slice& src, std::string* dst);
+
+ private:
+  ScanBloomFilterBuilder(ColumnSchema input_column,
+                         const BloomFilterSizing& sizing,
+                         HashAlgorithm hash_algorithm);
+
+  const ColumnSchema input_column_;
+  const HashAlgorithm hash_algorithm_;
+  Schema result_schema_;
+
+  BloomFilterBuilder filter_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScanBloomFilterBuilder);
+};
+
+} // namespace kudu
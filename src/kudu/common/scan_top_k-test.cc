@@ -0,0 +1,244 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/scan_top_k.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <glog/logging.h>
+#include <google/protobuf/repeated_field.h>
+#include <gtest/gtest.h>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/common/row.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/random.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+using google::protobuf::RepeatedPtrField;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+class ScanTopKTest : public KuduTest {
+ public:
+  ScanTopKTest()
+      : schema_({ ColumnSchema("key", INT32),
+                  ColumnSchema("str", STRING, true /* nullable */),
+                  ColumnSchema("val", INT64, true /* nullable */) },
+                1) {
+  }
+
+  static void AddOrderBy(const string& column, bool descending,
+                         RepeatedPtrField<ScanOrderByPB>* pbs) {
+    ScanOrderByPB* pb = pbs->Add();
+    pb->set_column(column);
+    pb->set_descending(descending);
+  }
+
+  // The values of a row: its key, and the value of 'val', which is -1 for
+  // NULL. The 'str' column is NULL iff 'val' is NULL, and otherwise is the
+  // string form of the key.
+  typedef std::pair<int32_t, int64_t> RowValues;
+
+  static string RowToString(const RowValues& values) {
+    if (values.second < 0) {
+      return Substitute("(int32 key=$0, string str=NULL, int64 val=NULL)", values.first);
+    }
+    return Substitute(R"((int32 key=$0, string str="$0", int64 val=$1))",
+                      values.first, values.second);
+  }
+
+  // Fills 'block' with 'rows', allocating the strings from 'arena'.
+  void FillRowBlock(const vector<RowValues>& rows, Arena* arena, RowBlock* block) {
+    CHECK_LE(rows.size(), block->nrows());
+    block->Resize(rows.size());
+    block->selection_vector()->SetAllTrue();
+    for (size_t i = 0; i < rows.size(); i++) {
+      RowBlockRow row = block->row(i);
+      *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(0)) = rows[i].first;
+      bool is_null = rows[i].second < 0;
+      row.cell(1).set_null(is_null);
+      row.cell(2).set_null(is_null);
+      Slice s;
+      CHECK(arena->RelocateSlice(Substitute("$0", rows[i].first), &s));
+      *reinterpret_cast<Slice*>(row.mutable_cell_ptr(1)) = s;
+      *reinterpret_cast<int64_t*>(row.mutable_cell_ptr(2)) = rows[i].second;
+    }
+  }
+
+  // Returns the rows kept by 'top_k', as strings.
+  vector<string> GetResult(const ScanTopK& top_k) {
+    Arena arena(1024);
+    RowBlock block(schema_, top_k.num_rows(), &arena);
+    CHECK_OK(top_k.GetResult(&block));
+    vector<string> results;
+    for (size_t i = 0; i < block.nrows(); i++) {
+      results.emplace_back(schema_.DebugRow(block.row(i)));
+    }
+    return results;
+  }
+
+ protected:
+  Schema schema_;
+};
+
+// Orders by a single column, in decreasing order, with several blocks.
+TEST_F(ScanTopKTest, TestDescendingKey) {
+  RepeatedPtrField<ScanOrderByPB> pbs;
+  AddOrderBy("key", true, &pbs);
+  unique_ptr<ScanTopK> top_k;
+  ASSERT_OK(ScanTopK::Create(pbs, 3, schema_, &top_k));
+  ASSERT_EQ(1, top_k->input_columns().size());
+  top_k->Init(schema_);
+
+  Arena arena(1024);
+  RowBlock block(schema_, 10, &arena);
+  FillRowBlock({ { 5, 50 }, { 1, 10 }, { 9, 90 } }, &arena, &block);
+  // Unselected rows aren't kept.
+  block.selection_vector()->SetRowUnselected(2);
+  ASSERT_OK(top_k->AddRowBlock(block));
+  ASSERT_EQ(2, top_k->num_rows());
+  FillRowBlock({ { 2, -1 }, { 7, 70 }, { 3, 30 }, { 6, -1 } }, &arena, &block);
+  ASSERT_OK(top_k->AddRowBlock(block));
+  ASSERT_EQ(3, top_k->num_rows());
+
+  vector<string> results = GetResult(*top_k);
+  ASSERT_EQ(3, results.size());
+  EXPECT_EQ(RowToString({ 7, 70 }), results[0]);
+  EXPECT_EQ(RowToString({ 6, -1 }), results[1]);
+  EXPECT_EQ(RowToString({ 5, 50 }), results[2]);
+}
+
+// Orders by a nullable column and then by the key, and compares the results
+// with sorting all the rows.
+TEST_F(ScanTopKTest, TestRandomRows) {
+  const int kNumBlocks = 50;
+  const int kRowsPerBlock = 100;
+  const int kTopK = 10;
+
+  RepeatedPtrField<ScanOrderByPB> pbs;
+  AddOrderBy("val", false, &pbs);
+  AddOrderBy("key", true, &pbs);
+  unique_ptr<ScanTopK> top_k;
+  ASSERT_OK(ScanTopK::Create(pbs, kTopK, schema_, &top_k));
+  top_k->Init(schema_);
+
+  Random rng(SeedRandom());
+  vector<RowValues> all_rows;
+  for (int b = 0; b < kNumBlocks; b++) {
+    vector<RowValues> rows;
+    for (int i = 0; i < kRowsPerBlock; i++) {
+      int32_t key = b * kRowsPerBlock + i;
+      // Use a small domain so that there are duplicate values.
+      int64_t val = rng.OneIn(10) ? -1 : rng.Uniform(kNumBlocks * 5);
+      rows.emplace_back(key, val);
+    }
+    Arena arena(1024);
+    RowBlock block(schema_, kRowsPerBlock, &arena);
+    FillRowBlock(rows, &arena, &block);
+    ASSERT_OK(top_k->AddRowBlock(block));
+    all_rows.insert(all_rows.end(), rows.begin(), rows.end());
+  }
+
+  // NULLs come last, then ties on 'val' are ordered by decreasing key.
+  std::sort(all_rows.begin(), all_rows.end(), [](const RowValues& a, const RowValues& b) {
+    bool a_null = a.second < 0;
+    bool b_null = b.second < 0;
+    return std::make_tuple(a_null, a.second, -a.first) <
+           std::make_tuple(b_null, b.second, -b.first);
+  });
+  vector<string> results = GetResult(*top_k);
+  ASSERT_EQ(kTopK, results.size());
+  for (int i = 0; i < kTopK; i++) {
+    EXPECT_EQ(RowToString(all_rows[i]), results[i]);
+  }
+}
+
+// Adds rows in the reverse of the requested order, so that each row evicts a
+// kept row and the kept rows are compacted several times.
+TEST_F(ScanTopKTest, TestCompaction) {
+  const int kNumBlocks = 20;
+  const int kRowsPerBlock = 500;
+  const int kTopK = 100;
+
+  RepeatedPtrField<ScanOrderByPB> pbs;
+  AddOrderBy("str", false, &pbs);
+  unique_ptr<ScanTopK> top_k;
+  ASSERT_OK(ScanTopK::Create(pbs, kTopK, schema_, &top_k));
+  top_k->Init(schema_);
+
+  const int kNumRows = kNumBlocks * kRowsPerBlock;
+  for (int b = 0; b < kNumBlocks; b++) {
+    vector<RowValues> rows;
+    for (int i = 0; i < kRowsPerBlock; i++) {
+      // Use keys in [kNumRows, 2 * kNumRows) so that they all have the same
+      // number of digits.
+      rows.emplace_back(2 * kNumRows - 1 - (b * kRowsPerBlock + i), i);
+    }
+    Arena arena(1024);
+    RowBlock block(schema_, kRowsPerBlock, &arena);
+    FillRowBlock(rows, &arena, &block);
+    ASSERT_OK(top_k->AddRowBlock(block));
+  }
+
+  vector<string> results = GetResult(*top_k);
+  ASSERT_EQ(kTopK, results.size());
+  for (int i = 0; i < kTopK; i++) {
+    int32_t key = kNumRows + i;
+    EXPECT_EQ(RowToString({ key, (2 * kNumRows - 1 - key) % kRowsPerBlock }), results[i]);
+  }
+}
+
+TEST_F(ScanTopKTest, TestInvalidOrderBy) {
+  unique_ptr<ScanTopK> top_k;
+  RepeatedPtrField<ScanOrderByPB> pbs;
+  Status s = ScanTopK::Create(pbs, 10, schema_, &top_k);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+
+  AddOrderBy("key", false, &pbs);
+  s = ScanTopK::Create(pbs, 0, schema_, &top_k);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "positive limit");
+
+  AddOrderBy("missing", false, &pbs);
+  s = ScanTopK::Create(pbs, 10, schema_, &top_k);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "unknown column");
+
+  pbs.RemoveLast();
+  AddOrderBy("key", true, &pbs);
+  s = ScanTopK::Create(pbs, 10, schema_, &top_k);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "more than once");
+}
+
+} // namespace kudu
@@ -0,0 +1,188 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/scan_top_k.h"
+
+#include <algorithm>
+#include <unordered_set>
+#include <utility>
+
+#include <glog/logging.h>
+#include <google/protobuf/repeated_field.h>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/common/row.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/map-util.h"
+
+using std::string;
+using std::unique_ptr;
+using std::unordered_set;
+using std::vector;
+
+namespace kudu {
+
+namespace {
+
+// The initial size of the arena holding the kept rows.
+const size_t kInitialArenaSize = 32 * 1024;
+
+// The kept rows are compacted once at least that many rows, and at least
+// as many rows as are kept, were evicted.
+const size_t kMinEvictedRowsToCompact = 1024;
+
+} // anonymous namespace
+
+ScanTopK::ScanTopK(vector<OrderBy> order_by, int64_t k)
+    : order_by_(std::move(order_by)),
+      k_(k),
+      arena_(new Arena(kInitialArenaSize)),
+      num_evicted_(0) {
+}
+
+ScanTopK::~ScanTopK() {}
+
+Status ScanTopK::Create(
+    const google::protobuf::RepeatedPtrField<ScanOrderByPB>& order_by,
+    int64_t k,
+    const Schema& tablet_schema,
+    unique_ptr<ScanTopK>* top_k) {
+  if (order_by.empty()) {
+    return Status::InvalidArgument("top-k scans require at least one ordering column");
+  }
+  if (k <= 0) {
+    return Status::InvalidArgument("top-k scans require a positive limit");
+  }
+  vector<OrderBy> cols;
+  vector<ColumnSchema> input_columns;
+  unordered_set<string> names;
+  for (const ScanOrderByPB& pb : order_by) {
+    int col_idx = tablet_schema.find_column(pb.column());
+    if (col_idx == Schema::kColumnNotFound) {
+      return Status::InvalidArgument("unknown column in ordering", pb.column());
+    }
+    if (!InsertIfNotPresent(&names, pb.column())) {
+      return Status::InvalidArgument("column ordered by more than once", pb.column());
+    }
+    cols.push_back({ pb.column(), pb.descending(), 0 });
+    input_columns.emplace_back(tablet_schema.column(col_idx));
+  }
+  top_k->reset(new ScanTopK(std::move(cols), k));
+  (*top_k)->input_columns_ = std::move(input_columns);
+  return Status::OK();
+}
+
+void ScanTopK::Init(const Schema& schema) {
+  DCHECK(heap_.empty());
+  schema_ = schema;
+  for (OrderBy& col : order_by_) {
+    int col_idx = schema_.find_column(col.column);
+    CHECK_NE(Schema::kColumnNotFound, col_idx) << col.column;
+    col.col_idx = col_idx;
+  }
+}
+
+template<class RowTypeA, class RowTypeB>
+int ScanTopK::Compare(const RowTypeA& a, const RowTypeB& b) const {
+  for (const OrderBy& col : order_by_) {
+    const ColumnSchema& col_schema = schema_.column(col.col_idx);
+    int cmp;
+    // NULLs are ordered after all the other values, whatever the direction.
+    bool a_null = col_schema.is_nullable() && a.is_null(col.col_idx);
+    bool b_null = col_schema.is_nullable() && b.is_null(col.col_idx);
+    if (a_null || b_null) {
+      cmp = a_null - b_null;
+    } else {
+      cmp = col_schema.Compare(a.cell_ptr(col.col_idx), b.cell_ptr(col.col_idx));
+      if (col.descending) {
+        cmp = -cmp;
+      }
+    }
+    if (cmp != 0) {
+      return cmp;
+    }
+  }
+  return 0;
+}
+
+template<class RowType>
+Status ScanTopK::CopyToArena(const RowType& row, Arena* arena, uint8_t** dst) const {
+  uint8_t* row_data = static_cast<uint8_t*>(arena->AllocateBytes(
+      ContiguousRowHelper::row_size(schema_)));
+  if (PREDICT_FALSE(row_data == nullptr)) {
+    return Status::RuntimeError("out of memory allocating top-k row");
+  }
+  ContiguousRow dst_row(&schema_, row_data);
+  RETURN_NOT_OK(CopyRow(row, &dst_row, arena));
+  *dst = row_data;
+  return Status::OK();
+}
+
+Status ScanTopK::AddRowBlock(const RowBlock& block) {
+  DCHECK_SCHEMA_EQ(schema_, block.schema());
+  const auto heap_cmp = [this](const uint8_t* a, const uint8_t* b) {
+    return Compare(ConstContiguousRow(&schema_, a), ConstContiguousRow(&schema_, b)) < 0;
+  };
+  const SelectionVector* sel = block.selection_vector();
+  for (size_t i = 0; i < block.nrows(); i++) {
+    if (!sel->IsRowSelected(i)) continue;
+    RowBlockRow row = block.row(i);
+    if (heap_.size() == k_) {
+      if (Compare(row, ConstContiguousRow(&schema_, heap_.front())) >= 0) {
+        continue;
+      }
+      std::pop_heap(heap_.begin(), heap_.end(), heap_cmp);
+      heap_.pop_back();
+      num_evicted_++;
+    }
+    uint8_t* row_data;
+    RETURN_NOT_OK(CopyToArena(row, arena_.get(), &row_data));
+    heap_.push_back(row_data);
+    std::push_heap(heap_.begin(), heap_.end(), heap_cmp);
+  }
+  if (num_evicted_ >= std::max(k_, kMinEvictedRowsToCompact)) {
+    RETURN_NOT_OK(Compact());
+  }
+  return Status::OK();
+}
+
+Status ScanTopK::Compact() {
+  unique_ptr<Arena> arena(new Arena(kInitialArenaSize));
+  for (uint8_t*& row_data : heap_) {
+    RETURN_NOT_OK(CopyToArena(ConstContiguousRow(&schema_, row_data), arena.get(), &row_data));
+  }
+  arena_ = std::move(arena);
+  num_evicted_ = 0;
+  return Status::OK();
+}
+
+Status ScanTopK::GetResult(RowBlock* block) const {
+  DCHECK_SCHEMA_EQ(schema_, block->schema());
+  DCHECK_GE(block->nrows(), heap_.size());
+  vector<const uint8_t*> rows(heap_.begin(), heap_.end());
+  std::sort(rows.begin(), rows.end(), [this](const uint8_t* a, const uint8_t* b) {
+    return Compare(ConstContiguousRow(&schema_, a), ConstContiguousRow(&schema_, b)) < 0;
+  });
+  for (size_t i = 0; i < rows.size(); i++) {
+    RowBlockRow dst = block->row(i);
+    RETURN_NOT_OK(CopyRow(ConstContiguousRow(&schema_, rows[i]), &dst, block->arena()));
+  }
+  return Status::OK();
+}
+
+} // namespace kudu
@@ -0,0 +1,133 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "kudu/common/schema.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/status.h"
+
+namespace google {
+namespace protobuf {
+template <typename Element> class RepeatedPtrField;
+}
+}
+
+namespace kudu {
+
+class RowBlock;
+class ScanOrderByPB;
+
+// Keeps the first 'k' selected rows of a scan in the order given by a list of
+// columns, so that a tablet server answering an 'ORDER BY ... LIMIT k' query
+// can return k rows instead of every matching row.
+//
+// The rows are kept in a bounded max-heap whose top is the last of the kept
+// rows in the requested order: once the heap is full, a new row is only
+// copied if it sorts before that row, which it then replaces.
+//
+// The results of several instances (e.g. of the different tablets of a table)
+// can be merged by the caller into the top rows of the union of their rows.
+class ScanTopK {
+ public:
+  // Creates an instance keeping the first 'k' rows ordered by 'order_by',
+  // which references columns of 'tablet_schema'.
+  //
+  // Returns InvalidArgument if 'order_by' is empty, references a column
+  // which doesn't exist or references a column more than once, or if 'k'
+  // is not positive.
+  static Status Create(
+      const google::protobuf::RepeatedPtrField<ScanOrderByPB>& order_by,
+      int64_t k,
+      const Schema& tablet_schema,
+      std::unique_ptr<ScanTopK>* top_k);
+
+  ~ScanTopK();
+
+  // The columns by which the rows are ordered. The row blocks passed to
+  // AddRowBlock() must contain these columns.
+  const std::vector<ColumnSchema>& input_columns() const { return input_columns_; }
+
+  // Sets the schema of the row blocks which are passed to AddRowBlock().
+  // Must be called once, before any row is added.
+  void Init(const Schema& schema);
+
+  // Keeps the selected rows of 'block' which belong to the top 'k' rows seen
+  // so far, copying them and their indirect data.
+  Status AddRowBlock(const RowBlock& block);
+
+  // The number of rows kept, which is at most 'k'.
+  size_t num_rows() const { return heap_.size(); }
+
+  // The memory used by the kept rows.
+  size_t memory_footprint() const {
+    return arena_->memory_footprint() + heap_.capacity() * sizeof(uint8_t*);
+  }
+
+  // Writes the kept rows, in order, into the first num_rows() rows of
+  // 'block', which must have the schema passed to Init(). Indirect data is
+  // allocated from the block's arena.
+  Status GetResult(RowBlock* block) const;
+
+ private:
+  // A column by which the rows are ordered.
+  struct OrderBy {
+    std::string column;
+    bool descending;
+    // The index of the column in the schema passed to Init().
+    size_t col_idx;
+  };
+
+  ScanTopK(std::vector<OrderBy> order_by, int64_t k);
+
+  // Returns a negative value if 'a' sorts before 'b', a positive value if it
+  // sorts after it, and 0 if they are equal on all the ordering columns.
+  template<class RowTypeA, class RowTypeB>
+  int Compare(const RowTypeA& a, const RowTypeB& b) const;
+
+  // Copies 'row' to a new contiguous row in 'arena', setting 'dst' to it.
+  template<class RowType>
+  Status CopyToArena(const RowType& row, Arena* arena, uint8_t** dst) const;
+
+  // Copies the kept rows to a new arena, dropping the space of the rows
+  // which were evicted from the heap.
+  Status Compact();
+
+  std::vector<OrderBy> order_by_;
+  std::vector<ColumnSchema> input_columns_;
+  const size_t k_;
+
+  Schema schema_;
+
+  // The kept rows, as contiguous rows of 'schema_', in heap order.
+  std::vector<uint8_t*> heap_;
+
+  // The arena holding the kept rows and their indirect data, and the number
+  // of rows in it which were evicted from the heap since the last Compact().
+  std::unique_ptr<Arena> arena_;
+  size_t num_evicted_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScanTopK);
+};
+
+} // namespace kudu
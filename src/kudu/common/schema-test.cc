@@ -321,6 +321,53 @@ TEST_F(TestSchema, TestReset) {
   ASSERT_FALSE(schema.initialized());
 }
 
+TEST_F(TestSchema, TestTtlColumn) {
+  ColumnStorageAttributes ttl_attributes;
+  ttl_attributes.ttl_seconds = 3600;
+  const ColumnSchema ttl_col("ts", UNIXTIME_MICROS, false, nullptr, nullptr, ttl_attributes);
+  Schema schema;
+  ASSERT_OK(schema.Reset({ ColumnSchema("key", INT32), ttl_col }, 1));
+  ASSERT_EQ(1, schema.find_ttl_column());
+  ASSERT_STR_CONTAINS(ttl_col.attributes().ToString(), "TTL 3600s");
+
+  // A TTL must be on a single non-nullable timestamp column.
+  Status s = schema.Reset({ ColumnSchema("key", INT32),
+                            ColumnSchema("val", INT64, false, nullptr, nullptr,
+                                         ttl_attributes) }, 1);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  s = schema.Reset({ ColumnSchema("key", INT32),
+                     ColumnSchema("ts", UNIXTIME_MICROS, true, nullptr, nullptr,
+                                  ttl_attributes) }, 1);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  s = schema.Reset({ ColumnSchema("key", INT32), ttl_col,
+                     ColumnSchema("ts2", UNIXTIME_MICROS, false, nullptr, nullptr,
+                                  ttl_attributes) }, 1);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "More than one column has a TTL");
+}
+
+TEST_F(TestSchema, TestRollupColumns) {
+  ColumnStorageAttributes rollup_attributes;
+  rollup_attributes.rollup = true;
+  const ColumnSchema rollup_key("k1", INT32, false, nullptr, nullptr, rollup_attributes);
+  const ColumnSchema rollup_val("val", INT64, true, nullptr, nullptr, rollup_attributes);
+  Schema schema;
+  ASSERT_FALSE(schema.has_rollup());
+  ASSERT_OK(schema.Reset({ rollup_key, ColumnSchema("k2", INT32), rollup_val }, 2));
+  ASSERT_TRUE(schema.has_rollup());
+  ASSERT_STR_CONTAINS(rollup_val.attributes().ToString(), "ROLLUP");
+
+  // The rollup may aggregate all the rows of a rowset.
+  ASSERT_OK(schema.Reset({ ColumnSchema("k1", INT32), rollup_val }, 1));
+  ASSERT_TRUE(schema.has_rollup());
+
+  // The rows may only be grouped by a prefix of the key.
+  const ColumnSchema rollup_key2("k2", INT32, false, nullptr, nullptr, rollup_attributes);
+  Status s = schema.Reset({ ColumnSchema("k1", INT32), rollup_key2, rollup_val }, 2);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "prefix of the primary key");
+}
+
 // Test for KUDU-943, a bug where we suspected that Variant didn't behave
 // correctly with empty strings.
 TEST_F(TestSchema, TestEmptyVariant) {
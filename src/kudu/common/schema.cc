@@ -73,12 +73,20 @@ string ColumnTypeAttributes::ToStringForType(DataType type) const {
 }
 
 string ColumnStorageAttributes::ToString() const {
+  const string compression_level_str =
+      compression_level == 0 ? "" : Substitute(" LEVEL $0", compression_level);
   const string cfile_block_size_str =
       cfile_block_size == 0 ? "" : Substitute(" $0", cfile_block_size);
-  return Substitute("$0 $1$2",
+  const string ttl_str = ttl_seconds == 0 ? "" : Substitute(" TTL $0s", ttl_seconds);
+  return Substitute("$0 $1$2$3$4$5$6$7",
                     EncodingType_Name(encoding),
                     CompressionType_Name(compression),
-                    cfile_block_size_str);
+                    compression_level_str,
+                    cfile_block_size_str,
+                    secondary_index ? " SECONDARY_INDEX" : "",
+                    ttl_str,
+                    rollup ? " ROLLUP" : "",
+                    intern ? " INTERN" : "");
 }
 
 Status ColumnSchema::ApplyDelta(const ColumnSchemaDelta& col_delta) {
@@ -261,6 +269,34 @@ Status Schema::Reset(const vector<ColumnSchema>& cols,
     }
   }
 
+  // Verify that at most one column has a TTL, and that it's a timestamp.
+  int num_ttl_columns = 0;
+  for (const ColumnSchema& col : cols_) {
+    if (col.attributes().ttl_seconds == 0) {
+      continue;
+    }
+    if (PREDICT_FALSE(col.attributes().ttl_seconds < 0 ||
+                      col.type_info()->type() != UNIXTIME_MICROS ||
+                      col.is_nullable())) {
+      return Status::InvalidArgument(
+        "Bad schema", Substitute("A TTL must be positive and set on a non-nullable "
+                                 "UNIXTIME_MICROS column: $0", col.name()));
+    }
+    if (PREDICT_FALSE(++num_ttl_columns > 1)) {
+      return Status::InvalidArgument(
+        "Bad schema", Substitute("More than one column has a TTL: $0", col.name()));
+    }
+  }
+
+  // Verify that the rollup's grouping columns are a prefix of the key.
+  for (int i = 1; i < key_columns; ++i) {
+    if (PREDICT_FALSE(cols_[i].attributes().rollup && !cols_[i - 1].attributes().rollup)) {
+      return Status::InvalidArgument(
+        "Bad schema", Substitute("The rollup key columns must be a prefix of the "
+                                 "primary key: $0", cols_[i].name()));
+    }
+  }
+
   // Calculate the offset of each column in the row format.
   col_offsets_.reserve(cols_.size() + 1);  // Include space for total byte size at the end.
   size_t off = 0;
@@ -126,13 +126,23 @@ struct ColumnStorageAttributes {
   ColumnStorageAttributes()
     : encoding(AUTO_ENCODING),
       compression(DEFAULT_COMPRESSION),
-      cfile_block_size(0) {
+      compression_level(0),
+      cfile_block_size(0),
+      secondary_index(false),
+      ttl_seconds(0),
+      rollup(false),
+      intern(false) {
   }
 
   ColumnStorageAttributes(EncodingType enc, CompressionType cmp)
     : encoding(enc),
       compression(cmp),
-      cfile_block_size(0) {
+      compression_level(0),
+      cfile_block_size(0),
+      secondary_index(false),
+      ttl_seconds(0),
+      rollup(false),
+      intern(false) {
   }
 
   std::string ToString() const;
@@ -140,9 +150,36 @@ struct ColumnStorageAttributes {
   EncodingType encoding;
   CompressionType compression;
 
+  // The level of the compression codec, or 0 for the codec's default. Only
+  // ZLIB and ZSTD have levels: the default is used if the codec doesn't
+  // support the level.
+  int32_t compression_level;
+
   // The preferred block size for cfile blocks. If 0, uses the
   // server-wide default.
   int32_t cfile_block_size;
+
+  // Whether each DiskRowSet stores a secondary index of the column's values,
+  // used by equality and IN-list predicates on the column. See
+  // tablet/secondary_index.h.
+  bool secondary_index;
+
+  // If positive, the rows whose value of the column is older than this many
+  // seconds are expired: scans filter them out, and flushes and compactions
+  // drop them. Only allowed on a single non-nullable UNIXTIME_MICROS column.
+  int64_t ttl_seconds;
+
+  // Whether the column is part of the rollup of each DiskRowSet: the rows are
+  // grouped by the key columns which set it, which must be a prefix of the
+  // primary key, and the other columns which set it are aggregated per group.
+  // See tablet/rollup.h.
+  bool rollup;
+
+  // Whether each MemRowSet stores the distinct values of the column once,
+  // rows with the same value pointing to the same copy, as long as there are
+  // at most --mrs_intern_max_distinct_values of them. Only applies to BINARY
+  // columns: it suits those with few distinct values.
+  bool intern;
 };
 
 // A struct representing changes to a ColumnSchema.
@@ -923,6 +960,28 @@ class Schema {
     return kColumnNotFound;
   }
 
+  // Returns the index of the column with a TTL, or kColumnNotFound if there's
+  // none. See ColumnStorageAttributes::ttl_seconds.
+  int find_ttl_column() const {
+    for (int idx = 0; idx < num_columns(); idx++) {
+      if (column(idx).attributes().ttl_seconds > 0) {
+        return idx;
+      }
+    }
+    return kColumnNotFound;
+  }
+
+  // Returns true if some column is part of the rollup of each DiskRowSet. See
+  // ColumnStorageAttributes::rollup.
+  bool has_rollup() const {
+    for (const ColumnSchema& col : cols_) {
+      if (col.attributes().rollup) {
+        return true;
+      }
+    }
+    return false;
+  }
+
  private:
   // Return a stringified version of the first 'num_columns' columns of the
   // row.
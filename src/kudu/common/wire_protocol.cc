@@ -226,7 +226,22 @@ void ColumnSchemaToPB(const ColumnSchema& col_schema, ColumnSchemaPB *pb, int fl
   if (!(flags & SCHEMA_PB_WITHOUT_STORAGE_ATTRIBUTES)) {
     pb->set_encoding(col_schema.attributes().encoding);
     pb->set_compression(col_schema.attributes().compression);
+    if (col_schema.attributes().compression_level != 0) {
+      pb->set_compression_level(col_schema.attributes().compression_level);
+    }
     pb->set_cfile_block_size(col_schema.attributes().cfile_block_size);
+    if (col_schema.attributes().secondary_index) {
+      pb->set_secondary_index(true);
+    }
+    if (col_schema.attributes().ttl_seconds != 0) {
+      pb->set_ttl_seconds(col_schema.attributes().ttl_seconds);
+    }
+    if (col_schema.attributes().rollup) {
+      pb->set_rollup(true);
+    }
+    if (col_schema.attributes().intern) {
+      pb->set_intern(true);
+    }
   }
   if (col_schema.has_read_default()) {
     if (col_schema.type_info()->physical_type() == BINARY) {
@@ -289,9 +304,24 @@ ColumnSchema ColumnSchemaFromPB(const ColumnSchemaPB& pb) {
   if (pb.has_compression()) {
     attributes.compression = pb.compression();
   }
+  if (pb.has_compression_level()) {
+    attributes.compression_level = pb.compression_level();
+  }
   if (pb.has_cfile_block_size()) {
     attributes.cfile_block_size = pb.cfile_block_size();
   }
+  if (pb.has_secondary_index()) {
+    attributes.secondary_index = pb.secondary_index();
+  }
+  if (pb.has_ttl_seconds()) {
+    attributes.ttl_seconds = pb.ttl_seconds();
+  }
+  if (pb.has_rollup()) {
+    attributes.rollup = pb.rollup();
+  }
+  if (pb.has_intern()) {
+    attributes.intern = pb.intern();
+  }
   return ColumnSchema(pb.name(), pb.type(), pb.is_nullable(),
                       read_default_ptr, write_default_ptr,
                       attributes, type_attributes);
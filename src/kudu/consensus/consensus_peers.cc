@@ -19,11 +19,13 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <ostream>
 #include <string>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <gflags/gflags.h>
@@ -40,16 +42,20 @@
 #include "kudu/consensus/opid_util.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/rpc/messenger.h"
 #include "kudu/rpc/periodic.h"
 #include "kudu/rpc/response_callback.h"
 #include "kudu/rpc/rpc_controller.h"
+#include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/net/dns_resolver.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/pb_util.h"
@@ -64,6 +70,17 @@ DEFINE_int32(raft_get_node_instance_timeout_ms, 30000,
              "Timeout for retrieving node instance data over RPC.");
 TAG_FLAG(raft_get_node_instance_timeout_ms, hidden);
 
+DEFINE_int32(consensus_max_inflight_requests_per_peer, 1,
+             "Maximum number of UpdateConsensus requests in flight to each "
+             "follower. Once a follower is in sync with the leader, up to that "
+             "many requests are pipelined to it, so that the replication "
+             "throughput of a tablet isn't bound by the round trip time to its "
+             "followers. 1 only sends a request once the previous one was "
+             "answered.");
+TAG_FLAG(consensus_max_inflight_requests_per_peer, experimental);
+DEFINE_validator(consensus_max_inflight_requests_per_peer,
+                 [](const char* /*flagname*/, int32_t value) { return value >= 1; });
+
 DEFINE_double(fault_crash_on_leader_request_fraction, 0.0,
               "Fraction of the time when the leader will crash just before sending an "
               "UpdateConsensus RPC. (For testing only!)");
@@ -83,6 +100,24 @@ DEFINE_bool(enable_tablet_copy, true,
             "replica. For testing purposes only.");
 TAG_FLAG(enable_tablet_copy, unsafe);
 
+DEFINE_bool(raft_batch_heartbeats, false,
+            "Whether the status-only consensus requests, i.e. the heartbeats, sent by the "
+            "leader replicas of a tablet server to the followers hosted by another server "
+            "are coalesced into one RPC. This reduces the number of RPCs when many tablets "
+            "are shared by the servers, at the cost of delaying the heartbeats by up to "
+            "--raft_heartbeat_batch_window_ms.");
+TAG_FLAG(raft_batch_heartbeats, experimental);
+TAG_FLAG(raft_batch_heartbeats, runtime);
+
+DEFINE_int32(raft_heartbeat_batch_window_ms, 10,
+             "With --raft_batch_heartbeats, the number of milliseconds during which the "
+             "heartbeats sent to a server are collected before being sent in one RPC. "
+             "Should be much smaller than --raft_heartbeat_interval_ms.");
+TAG_FLAG(raft_heartbeat_batch_window_ms, experimental);
+TAG_FLAG(raft_heartbeat_batch_window_ms, runtime);
+DEFINE_validator(raft_heartbeat_batch_window_ms,
+                 [](const char* /*n*/, int32_t v) { return v >= 0; });
+
 DECLARE_int32(raft_heartbeat_interval_ms);
 
 using kudu::pb_util::SecureShortDebugString;
@@ -137,6 +172,7 @@ Peer::Peer(RaftPeerPB peer_pb,
       proxy_(std::move(proxy)),
       queue_(queue),
       failed_attempts_(0),
+      last_sent_committed_index_(kMinimumOpIdIndex),
       messenger_(std::move(messenger)),
       raft_pool_token_(raft_pool_token) {
 }
@@ -169,9 +205,9 @@ Status Peer::SignalRequest(bool even_if_queue_empty) {
     return Status::IllegalState("Peer was closed.");
   }
 
-  // Only allow one request at a time. No sense waking up the
-  // raft thread pool if the task will just abort anyway.
-  if (request_pending_) {
+  // No sense waking up the raft thread pool if the task will just abort
+  // anyway.
+  if (num_requests_in_flight_ >= FLAGS_consensus_max_inflight_requests_per_peer) {
     return Status::OK();
   }
 
@@ -192,9 +228,16 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
     return;
   }
 
-  // Only allow one request at a time.
-  if (request_pending_) {
-    return;
+  // Only allow one request at a time, unless more ops may be pipelined to
+  // the peer behind the requests in flight. Those requests aren't sent unless
+  // they carry ops and the previous exchanges with the peer succeeded.
+  bool pipelined = false;
+  if (num_requests_in_flight_ > 0) {
+    if (num_requests_in_flight_ >= FLAGS_consensus_max_inflight_requests_per_peer ||
+        failed_attempts_ > 0) {
+      return;
+    }
+    pipelined = true;
   }
 
   // For the first request sent by the peer, we send it even if the queue is empty,
@@ -219,30 +262,36 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
     return;
   }
 
-  // The peer has no pending request nor is sending: send the request.
-  bool needs_tablet_copy = false;
-  int64_t commit_index_before = request_.has_committed_index() ?
-      request_.committed_index() : kMinimumOpIdIndex;
-  Status s = queue_->RequestForPeer(peer_pb_.permanent_uuid(), &request_,
-                                    &replicate_msg_refs_, &needs_tablet_copy);
-  int64_t commit_index_after = request_.has_committed_index() ?
-      request_.committed_index() : kMinimumOpIdIndex;
+  if (idle_requests_.empty()) {
+    requests_.emplace_back(new UpdateRequest);
+    idle_requests_.push_back(requests_.back().get());
+  }
+  UpdateRequest* req = idle_requests_.back();
+  ConsensusRequestPB* request = &req->request;
 
+  bool needs_tablet_copy = false;
+  int64_t commit_index_before = last_sent_committed_index_;
+  Status s = queue_->RequestForPeer(peer_pb_.permanent_uuid(), request,
+                                    &req->replicate_msg_refs, &needs_tablet_copy,
+                                    pipelined);
   if (PREDICT_FALSE(!s.ok())) {
     VLOG_WITH_PREFIX_UNLOCKED(1) << s.ToString();
     return;
   }
+  int64_t commit_index_after = request->has_committed_index() ?
+      request->committed_index() : kMinimumOpIdIndex;
+  last_sent_committed_index_ = commit_index_after;
 
   if (PREDICT_FALSE(needs_tablet_copy)) {
     Status s = PrepareTabletCopyRequest();
     if (s.ok()) {
-      controller_.Reset();
-      request_pending_ = true;
+      tc_controller_.Reset();
+      num_requests_in_flight_++;
       l.unlock();
       // Capture a shared_ptr reference into the RPC callback so that we're guaranteed
       // that this object outlives the RPC.
       shared_ptr<Peer> s_this = shared_from_this();
-      proxy_->StartTabletCopyAsync(&tc_request_, &tc_response_, &controller_,
+      proxy_->StartTabletCopyAsync(&tc_request_, &tc_response_, &tc_controller_,
                                    [s_this]() {
                                      s_this->ProcessTabletCopyResponse();
                                    });
@@ -253,14 +302,15 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
     return;
   }
 
-  request_.set_tablet_id(tablet_id_);
-  request_.set_caller_uuid(leader_uuid_);
-  request_.set_dest_uuid(peer_pb_.permanent_uuid());
+  request->set_tablet_id(tablet_id_);
+  request->set_caller_uuid(leader_uuid_);
+  request->set_dest_uuid(peer_pb_.permanent_uuid());
 
-  bool req_has_ops = request_.ops_size() > 0 || (commit_index_after > commit_index_before);
+  bool req_has_ops = request->ops_size() > 0 || (commit_index_after > commit_index_before);
   // If the queue is empty, check if we were told to send a status-only
-  // message, if not just return.
-  if (PREDICT_FALSE(!req_has_ops && !even_if_queue_empty)) {
+  // message, if not just return. Pipelined requests are only sent with ops.
+  if (PREDICT_FALSE(!req_has_ops && !even_if_queue_empty) ||
+      (pipelined && request->ops_size() == 0)) {
     return;
   }
 
@@ -273,18 +323,24 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
 
 
   VLOG_WITH_PREFIX_UNLOCKED(2) << "Sending to peer " << peer_pb().permanent_uuid() << ": "
-      << SecureShortDebugString(request_);
-  controller_.Reset();
+      << SecureShortDebugString(*request);
+  req->controller.Reset();
+  req->send_time = MonoTime::Now();
 
-  request_pending_ = true;
+  idle_requests_.pop_back();
+  num_requests_in_flight_++;
   l.unlock();
   // Capture a shared_ptr reference into the RPC callback so that we're guaranteed
   // that this object outlives the RPC.
   shared_ptr<Peer> s_this = shared_from_this();
-  proxy_->UpdateAsync(&request_, &response_, &controller_,
-                      [s_this]() {
-                        s_this->ProcessResponse();
-                      });
+  const auto callback = [s_this, req]() {
+    s_this->ProcessResponse(req);
+  };
+  if (req_has_ops) {
+    proxy_->UpdateAsync(request, &req->response, &req->controller, callback);
+  } else {
+    proxy_->UpdateHeartbeatAsync(request, &req->response, &req->controller, callback);
+  }
 }
 
 Status Peer::StartElection() {
@@ -296,49 +352,50 @@ Status Peer::StartElection() {
   RETURN_NOT_OK(proxy_->StartElection(&req, &resp, &controller));
   RETURN_NOT_OK(controller.status());
   if (resp.has_error()) {
-    return StatusFromPB(response_.error().status());
+    return StatusFromPB(resp.error().status());
   }
   return Status::OK();
 }
 
-void Peer::ProcessResponse() {
+void Peer::ProcessResponse(UpdateRequest* req) {
   // Note: This method runs on the reactor thread.
   std::unique_lock<simple_spinlock> lock(peer_lock_);
   if (closed_) {
     return;
   }
-  CHECK(request_pending_);
+  CHECK_GT(num_requests_in_flight_, 0);
+  const ConsensusResponsePB& response = req->response;
 
   MAYBE_FAULT(FLAGS_fault_crash_after_leader_request_fraction);
 
   // Process RpcController errors.
-  const auto controller_status = controller_.status();
+  const auto controller_status = req->controller.status();
   if (!controller_status.ok()) {
     auto ps = controller_status.IsRemoteError() ?
         PeerStatus::REMOTE_ERROR : PeerStatus::RPC_LAYER_ERROR;
     queue_->UpdatePeerStatus(peer_pb_.permanent_uuid(), ps, controller_status);
-    ProcessResponseError(controller_status);
+    ProcessResponseError(req, controller_status);
     return;
   }
 
   // Process CANNOT_PREPARE.
   // TODO(todd): there is no integration test coverage of this code path. Likely a bug in
   // this path is responsible for KUDU-1779.
-  if (response_.status().has_error() &&
-      response_.status().error().code() == consensus::ConsensusErrorPB::CANNOT_PREPARE) {
-    Status response_status = StatusFromPB(response_.status().error().status());
+  if (response.status().has_error() &&
+      response.status().error().code() == consensus::ConsensusErrorPB::CANNOT_PREPARE) {
+    Status response_status = StatusFromPB(response.status().error().status());
     queue_->UpdatePeerStatus(peer_pb_.permanent_uuid(), PeerStatus::CANNOT_PREPARE,
                              response_status);
-    ProcessResponseError(response_status);
+    ProcessResponseError(req, response_status);
     return;
   }
 
   // Process tserver-level errors.
-  if (response_.has_error()) {
-    Status response_status = StatusFromPB(response_.error().status());
+  if (response.has_error()) {
+    Status response_status = StatusFromPB(response.error().status());
     PeerStatus ps;
-    TabletServerErrorPB resp_error = response_.error();
-    switch (response_.error().code()) {
+    TabletServerErrorPB resp_error = response.error();
+    switch (response.error().code()) {
       // We treat WRONG_SERVER_UUID as failed.
       case TabletServerErrorPB::WRONG_SERVER_UUID: FALLTHROUGH_INTENDED;
       case TabletServerErrorPB::TABLET_FAILED:
@@ -352,7 +409,7 @@ void Peer::ProcessResponse() {
         ps = PeerStatus::REMOTE_ERROR;
     }
     queue_->UpdatePeerStatus(peer_pb_.permanent_uuid(), ps, response_status);
-    ProcessResponseError(response_status);
+    ProcessResponseError(req, response_status);
     return;
   }
 
@@ -364,31 +421,37 @@ void Peer::ProcessResponse() {
   // Capture a weak_ptr reference into the submitted functor so that we can
   // safely handle the functor outliving its peer.
   weak_ptr<Peer> w_this = shared_from_this();
-  Status s = raft_pool_token_->SubmitFunc([w_this]() {
+  Status s = raft_pool_token_->SubmitFunc([w_this, req]() {
     if (auto p = w_this.lock()) {
-      p->DoProcessResponse();
+      p->DoProcessResponse(req);
 
     }
   });
   if (PREDICT_FALSE(!s.ok())) {
     LOG_WITH_PREFIX_UNLOCKED(WARNING) << "Unable to process peer response: " << s.ToString()
-        << ": " << SecureShortDebugString(response_);
-    request_pending_ = false;
+        << ": " << SecureShortDebugString(response);
+    ReleaseRequestUnlocked(req);
   }
 }
 
-void Peer::DoProcessResponse() {
+void Peer::DoProcessResponse(UpdateRequest* req) {
 
   VLOG_WITH_PREFIX_UNLOCKED(2) << "Response from peer " << peer_pb().permanent_uuid() << ": "
-      << SecureShortDebugString(response_);
+      << SecureShortDebugString(req->response);
 
-  bool send_more_immediately = queue_->ResponseFromPeer(peer_pb_.permanent_uuid(), response_);
+  // A peer which accepted the request doesn't vote for another candidate for
+  // the minimum election timeout, which extends the leader's lease.
+  if (!req->response.status().has_error()) {
+    queue_->UpdatePeerLeaseGrant(peer_pb_.permanent_uuid(), req->request.caller_term(),
+                                 req->send_time);
+  }
+  bool send_more_immediately = queue_->ResponseFromPeer(peer_pb_.permanent_uuid(),
+                                                        req->response);
 
   {
     std::unique_lock<simple_spinlock> lock(peer_lock_);
-    CHECK(request_pending_);
     failed_attempts_ = 0;
-    request_pending_ = false;
+    ReleaseRequestUnlocked(req);
   }
   // We're OK to read the state_ without a lock here -- if we get a race,
   // the worst thing that could happen is that we'll make one more request before
@@ -398,6 +461,13 @@ void Peer::DoProcessResponse() {
   }
 }
 
+void Peer::ReleaseRequestUnlocked(UpdateRequest* req) {
+  DCHECK(peer_lock_.is_locked());
+  CHECK_GT(num_requests_in_flight_, 0);
+  num_requests_in_flight_--;
+  idle_requests_.push_back(req);
+}
+
 Status Peer::PrepareTabletCopyRequest() {
   if (!FLAGS_enable_tablet_copy) {
     failed_attempts_++;
@@ -415,11 +485,11 @@ void Peer::ProcessTabletCopyResponse() {
   if (closed_) {
     return;
   }
-  CHECK(request_pending_);
-  request_pending_ = false;
+  CHECK_GT(num_requests_in_flight_, 0);
+  num_requests_in_flight_--;
 
   // If the response is OK, or ALREADY_INPROGRESS, then consider the RPC successful.
-  const auto controller_status = controller_.status();
+  const auto controller_status = tc_controller_.status();
   bool success =
     controller_status.ok() &&
     (!tc_response_.has_error() ||
@@ -439,13 +509,13 @@ void Peer::ProcessTabletCopyResponse() {
   }
 }
 
-void Peer::ProcessResponseError(const Status& status) {
+void Peer::ProcessResponseError(UpdateRequest* req, const Status& status) {
   failed_attempts_++;
   string resp_err_info;
-  if (response_.has_error()) {
+  if (req->response.has_error()) {
     resp_err_info = Substitute(" Error code: $0 ($1).",
-                               TabletServerErrorPB::Code_Name(response_.error().code()),
-                               response_.error().code());
+                               TabletServerErrorPB::Code_Name(req->response.error().code()),
+                               req->response.error().code());
   }
   // We log the warning at the first failure, then every
   // 'kNumRetriesBetweenLoggingFailedRequest' retries.
@@ -463,7 +533,7 @@ void Peer::ProcessResponseError(const Status& status) {
                  failed_attempts_,
                  kNumRetriesBetweenLoggingFailedRequest);
   }
-  request_pending_ = false;
+  ReleaseRequestUnlocked(req);
 }
 
 string Peer::LogPrefixUnlocked() const {
@@ -491,13 +561,17 @@ Peer::~Peer() {
   }
 
   // We don't own the ops (the queue does).
-  request_.mutable_ops()->ExtractSubrange(0, request_.ops_size(), nullptr);
+  for (const auto& req : requests_) {
+    req->request.mutable_ops()->ExtractSubrange(0, req->request.ops_size(), nullptr);
+  }
 }
 
 RpcPeerProxy::RpcPeerProxy(gscoped_ptr<HostPort> hostport,
-                           gscoped_ptr<ConsensusServiceProxy> consensus_proxy)
+                           gscoped_ptr<ConsensusServiceProxy> consensus_proxy,
+                           shared_ptr<HeartbeatBatcher> batcher)
     : hostport_(std::move(DCHECK_NOTNULL(hostport))),
-      consensus_proxy_(std::move(DCHECK_NOTNULL(consensus_proxy))) {
+      consensus_proxy_(std::move(DCHECK_NOTNULL(consensus_proxy))),
+      batcher_(std::move(batcher)) {
 }
 
 void RpcPeerProxy::UpdateAsync(const ConsensusRequestPB* request,
@@ -508,6 +582,17 @@ void RpcPeerProxy::UpdateAsync(const ConsensusRequestPB* request,
   consensus_proxy_->UpdateConsensusAsync(*request, response, controller, callback);
 }
 
+void RpcPeerProxy::UpdateHeartbeatAsync(const ConsensusRequestPB* request,
+                                        ConsensusResponsePB* response,
+                                        rpc::RpcController* controller,
+                                        const rpc::ResponseCallback& callback) {
+  if (batcher_ && FLAGS_raft_batch_heartbeats) {
+    batcher_->UpdateAsync(request, response, controller, callback);
+    return;
+  }
+  UpdateAsync(request, response, controller, callback);
+}
+
 Status RpcPeerProxy::StartElection(const RunLeaderElectionRequestPB* request,
                                  RunLeaderElectionResponsePB* response,
                                  rpc::RpcController* controller) {
@@ -530,6 +615,14 @@ void RpcPeerProxy::StartTabletCopyAsync(const StartTabletCopyRequestPB* request,
   consensus_proxy_->StartTabletCopyAsync(*request, response, controller, callback);
 }
 
+void RpcPeerProxy::SendSafeTimeAsync(const SendSafeTimeRequestPB* request,
+                                     SendSafeTimeResponsePB* response,
+                                     rpc::RpcController* controller,
+                                     const rpc::ResponseCallback& callback) {
+  controller->set_timeout(MonoDelta::FromMilliseconds(FLAGS_consensus_rpc_timeout_ms));
+  consensus_proxy_->SendSafeTimeAsync(*request, response, controller, callback);
+}
+
 string RpcPeerProxy::PeerName() const {
   return hostport_->ToString();
 }
@@ -540,7 +633,7 @@ Status CreateConsensusServiceProxyForHost(const shared_ptr<Messenger>& messenger
                                           const HostPort& hostport,
                                           gscoped_ptr<ConsensusServiceProxy>* new_proxy) {
   vector<Sockaddr> addrs;
-  RETURN_NOT_OK(hostport.ResolveAddresses(&addrs));
+  RETURN_NOT_OK(messenger->dns_resolver()->ResolveAddresses(hostport, &addrs));
   if (addrs.size() > 1) {
     LOG(WARNING)<< "Peer address '" << hostport.ToString() << "' "
     << "resolves to " << addrs.size() << " different addresses. Using "
@@ -550,8 +643,143 @@ Status CreateConsensusServiceProxyForHost(const shared_ptr<Messenger>& messenger
   return Status::OK();
 }
 
+// The heartbeat batchers, by messenger and destination server. A batcher
+// keeps its messenger alive, so the messenger of a live batcher can't be
+// confused with a new one at the same address.
+struct HeartbeatBatcherRegistry {
+  std::mutex lock;
+  std::map<std::pair<const Messenger*, string>, weak_ptr<HeartbeatBatcher>> batchers;
+};
+
+HeartbeatBatcherRegistry* GetHeartbeatBatcherRegistry() {
+  static HeartbeatBatcherRegistry* registry = new HeartbeatBatcherRegistry;
+  return registry;
+}
+
 } // anonymous namespace
 
+Status HeartbeatBatcher::GetOrCreate(const shared_ptr<Messenger>& messenger,
+                                     const HostPort& hostport,
+                                     shared_ptr<HeartbeatBatcher>* batcher) {
+  HeartbeatBatcherRegistry* registry = GetHeartbeatBatcherRegistry();
+  const auto key = std::make_pair(messenger.get(), hostport.ToString());
+  std::lock_guard<std::mutex> l(registry->lock);
+  shared_ptr<HeartbeatBatcher> b;
+  auto* existing = FindOrNull(registry->batchers, key);
+  if (existing) {
+    b = existing->lock();
+  }
+  if (!b) {
+    gscoped_ptr<ConsensusServiceProxy> proxy;
+    RETURN_NOT_OK(CreateConsensusServiceProxyForHost(messenger, hostport, &proxy));
+    b = std::make_shared<HeartbeatBatcher>(messenger, key.second, std::move(proxy));
+    // Drop the batchers which aren't used anymore.
+    for (auto it = registry->batchers.begin(); it != registry->batchers.end();) {
+      if (it->second.expired()) {
+        it = registry->batchers.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    registry->batchers[key] = b;
+  }
+  *batcher = std::move(b);
+  return Status::OK();
+}
+
+HeartbeatBatcher::HeartbeatBatcher(shared_ptr<Messenger> messenger,
+                                   string peer_name,
+                                   gscoped_ptr<ConsensusServiceProxy> consensus_proxy)
+    : messenger_(std::move(messenger)),
+      peer_name_(std::move(peer_name)),
+      consensus_proxy_(std::move(consensus_proxy)),
+      flush_scheduled_(false),
+      supported_(true) {
+}
+
+void HeartbeatBatcher::UpdateAsync(const ConsensusRequestPB* request,
+                                   ConsensusResponsePB* response,
+                                   rpc::RpcController* controller,
+                                   const rpc::ResponseCallback& callback) {
+  PendingUpdate update = { request, response, controller, callback };
+  if (PREDICT_FALSE(!supported_.Load())) {
+    SendUpdate(update);
+    return;
+  }
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    pending_.emplace_back(std::move(update));
+    if (flush_scheduled_) {
+      return;
+    }
+    flush_scheduled_ = true;
+  }
+  // If the messenger is shutting down, the flushed requests fail right away.
+  shared_ptr<HeartbeatBatcher> self = shared_from_this();
+  messenger_->ScheduleOnReactor([self](const Status& /*s*/) { self->Flush(); },
+                                MonoDelta::FromMilliseconds(
+                                    FLAGS_raft_heartbeat_batch_window_ms));
+}
+
+void HeartbeatBatcher::Flush() {
+  shared_ptr<Batch> batch = std::make_shared<Batch>();
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    batch->updates.swap(pending_);
+    flush_scheduled_ = false;
+  }
+  if (batch->updates.size() == 1) {
+    SendUpdate(batch->updates[0]);
+    return;
+  }
+  for (const PendingUpdate& update : batch->updates) {
+    *batch->request.add_requests() = *update.request;
+  }
+  batch->controller.set_timeout(MonoDelta::FromMilliseconds(FLAGS_consensus_rpc_timeout_ms));
+  shared_ptr<HeartbeatBatcher> self = shared_from_this();
+  consensus_proxy_->MultiUpdateConsensusAsync(batch->request, &batch->response,
+                                              &batch->controller,
+                                              [self, batch]() {
+                                                self->ProcessBatchResponse(batch);
+                                              });
+}
+
+void HeartbeatBatcher::SendUpdate(const PendingUpdate& update) {
+  update.controller->set_timeout(MonoDelta::FromMilliseconds(FLAGS_consensus_rpc_timeout_ms));
+  consensus_proxy_->UpdateConsensusAsync(*update.request, update.response,
+                                         update.controller, update.callback);
+}
+
+void HeartbeatBatcher::ProcessBatchResponse(const shared_ptr<Batch>& batch) {
+  // Note: This method runs on the reactor thread.
+  const Status s = batch->controller.status();
+  if (PREDICT_FALSE(!s.ok() ||
+                    batch->response.responses_size() != batch->updates.size())) {
+    const rpc::ErrorStatusPB* err = batch->controller.error_response();
+    if (s.IsRemoteError() && err &&
+        (err->code() == rpc::ErrorStatusPB::ERROR_NO_SUCH_METHOD ||
+         err->code() == rpc::ErrorStatusPB::ERROR_INVALID_REQUEST)) {
+      LOG(INFO) << peer_name_ << " doesn't support batched heartbeats: "
+                << s.ToString();
+      supported_.Store(false);
+    } else {
+      KLOG_EVERY_N_SECS(WARNING, 1) << "Batched heartbeats to " << peer_name_
+                                    << " failed, sending them one by one: " << s.ToString();
+    }
+    // Send the requests one by one for their controllers to get the outcome
+    // of the requests.
+    for (const PendingUpdate& update : batch->updates) {
+      SendUpdate(update);
+    }
+    return;
+  }
+  for (int i = 0; i < batch->updates.size(); i++) {
+    const PendingUpdate& update = batch->updates[i];
+    update.response->Swap(batch->response.mutable_responses(i));
+    update.callback();
+  }
+}
+
 RpcPeerProxyFactory::RpcPeerProxyFactory(shared_ptr<Messenger> messenger)
     : messenger_(std::move(messenger)) {}
 
@@ -561,7 +789,9 @@ Status RpcPeerProxyFactory::NewProxy(const RaftPeerPB& peer_pb,
   RETURN_NOT_OK(HostPortFromPB(peer_pb.last_known_addr(), hostport.get()));
   gscoped_ptr<ConsensusServiceProxy> new_proxy;
   RETURN_NOT_OK(CreateConsensusServiceProxyForHost(messenger_, *hostport, &new_proxy));
-  proxy->reset(new RpcPeerProxy(std::move(hostport), std::move(new_proxy)));
+  shared_ptr<HeartbeatBatcher> batcher;
+  RETURN_NOT_OK(HeartbeatBatcher::GetOrCreate(messenger_, *hostport, &batcher));
+  proxy->reset(new RpcPeerProxy(std::move(hostport), std::move(new_proxy), std::move(batcher)));
   return Status::OK();
 }
 
@@ -31,9 +31,12 @@
 #include "kudu/consensus/metadata.pb.h"
 #include "kudu/consensus/ref_counted_replicate.h"
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/macros.h"
 #include "kudu/rpc/response_callback.h"
 #include "kudu/rpc/rpc_controller.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/status.h"
 
@@ -124,17 +127,37 @@ class Peer : public std::enable_shared_from_this<Peer> {
        gscoped_ptr<PeerProxy> proxy,
        std::shared_ptr<rpc::Messenger> messenger);
 
+  // An UpdateConsensus request sent to the peer, with its response.
+  struct UpdateRequest {
+    ConsensusRequestPB request;
+    ConsensusResponsePB response;
+    rpc::RpcController controller;
+
+    // The time at which the request was sent.
+    MonoTime send_time;
+
+    // Reference-counted pointers to the ReplicateMsgs in 'request'. We may have
+    // loaded these messages from the LogCache, in which case we are potentially
+    // sharing the same object as other peers. Since the PB request itself can't
+    // hold reference counts, this holds them.
+    std::vector<ReplicateRefPtr> replicate_msg_refs;
+  };
+
   void SendNextRequest(bool even_if_queue_empty);
 
-  // Signals that a response was received from the peer.
+  // Signals that a response was received from the peer for 'req'.
   //
   // This method is called from the reactor thread and calls
   // DoProcessResponse() on raft_pool_token_ to do any work that requires IO or
   // lock-taking.
-  void ProcessResponse();
+  void ProcessResponse(UpdateRequest* req);
 
   // Run on 'raft_pool_token'. Does response handling that requires IO or may block.
-  void DoProcessResponse();
+  void DoProcessResponse(UpdateRequest* req);
+
+  // Makes 'req', whose exchange with the peer is over, available to send
+  // another request. Must be called with 'peer_lock_' held.
+  void ReleaseRequestUnlocked(UpdateRequest* req);
 
   // Fetch the desired tablet copy request from the queue and set up
   // tc_request_ appropriately.
@@ -146,8 +169,8 @@ class Peer : public std::enable_shared_from_this<Peer> {
   // Handle RPC callback from initiating tablet copy.
   void ProcessTabletCopyResponse();
 
-  // Signals there was an error sending the request to the peer.
-  void ProcessResponseError(const Status& status);
+  // Signals there was an error sending 'req' to the peer.
+  void ProcessResponseError(UpdateRequest* req, const Status& status);
 
   std::string LogPrefixUnlocked() const;
 
@@ -163,21 +186,19 @@ class Peer : public std::enable_shared_from_this<Peer> {
   PeerMessageQueue* queue_;
   uint64_t failed_attempts_;
 
-  // The latest consensus update request and response.
-  ConsensusRequestPB request_;
-  ConsensusResponsePB response_;
+  // All the consensus update requests allocated for the peer, at most
+  // --consensus_max_inflight_requests_per_peer of them, and the ones which
+  // aren't in flight. Protected by 'peer_lock_'.
+  std::vector<std::unique_ptr<UpdateRequest>> requests_;
+  std::vector<UpdateRequest*> idle_requests_;
+
+  // The committed index sent with the latest consensus update request.
+  int64_t last_sent_committed_index_;
 
   // The latest tablet copy request and response.
   StartTabletCopyRequestPB tc_request_;
   StartTabletCopyResponsePB tc_response_;
-
-  // Reference-counted pointers to any ReplicateMsgs which are in-flight to the peer. We
-  // may have loaded these messages from the LogCache, in which case we are potentially
-  // sharing the same object as other peers. Since the PB request_ itself can't hold
-  // reference counts, this holds them.
-  std::vector<ReplicateRefPtr> replicate_msg_refs_;
-
-  rpc::RpcController controller_;
+  rpc::RpcController tc_controller_;
 
   std::shared_ptr<rpc::Messenger> messenger_;
 
@@ -191,7 +212,8 @@ class Peer : public std::enable_shared_from_this<Peer> {
 
   // Lock that protects Peer state changes, initialization, etc.
   mutable simple_spinlock peer_lock_;
-  bool request_pending_ = false;
+  // The number of consensus update or tablet copy requests in flight.
+  int num_requests_in_flight_ = 0;
   bool closed_ = false;
   bool has_sent_first_request_ = false;
 };
@@ -208,6 +230,16 @@ class PeerProxy {
                            rpc::RpcController* controller,
                            const rpc::ResponseCallback& callback) = 0;
 
+  // Sends a status-only request, asynchronously, to a remote peer. The
+  // request may be coalesced with the ones sent to the same server for other
+  // tablets.
+  virtual void UpdateHeartbeatAsync(const ConsensusRequestPB* request,
+                                    ConsensusResponsePB* response,
+                                    rpc::RpcController* controller,
+                                    const rpc::ResponseCallback& callback) {
+    UpdateAsync(request, response, controller, callback);
+  }
+
   // Sends a RequestConsensusVote to a remote peer.
   virtual void RequestConsensusVoteAsync(const VoteRequestPB* request,
                                          VoteResponsePB* response,
@@ -226,6 +258,14 @@ class PeerProxy {
     LOG(DFATAL) << "Not implemented";
   }
 
+  // Asks the leader to send its safe time to the followers.
+  virtual void SendSafeTimeAsync(const SendSafeTimeRequestPB* /*request*/,
+                                 SendSafeTimeResponsePB* /*response*/,
+                                 rpc::RpcController* /*controller*/,
+                                 const rpc::ResponseCallback& /*callback*/) {
+    LOG(DFATAL) << "Not implemented";
+  }
+
   // Remote endpoint or description of the peer.
   virtual std::string PeerName() const = 0;
 };
@@ -243,17 +283,93 @@ class PeerProxyFactory {
   virtual const std::shared_ptr<rpc::Messenger>& messenger() const = 0;
 };
 
+// Coalesces the status-only consensus requests sent to a server for
+// different tablets into MultiUpdateConsensus() RPCs. The requests are
+// batched for --raft_heartbeat_batch_window_ms.
+//
+// There's one batcher per messenger and destination server, shared by the
+// RpcPeerProxies of all the tablets. If the batched RPC fails, e.g. because
+// the destination doesn't support it, the requests are sent one by one.
+class HeartbeatBatcher : public std::enable_shared_from_this<HeartbeatBatcher> {
+ public:
+  // Returns the batcher for the server at 'hostport', creating it if
+  // necessary.
+  static Status GetOrCreate(const std::shared_ptr<rpc::Messenger>& messenger,
+                            const HostPort& hostport,
+                            std::shared_ptr<HeartbeatBatcher>* batcher);
+
+  HeartbeatBatcher(std::shared_ptr<rpc::Messenger> messenger,
+                   std::string peer_name,
+                   gscoped_ptr<ConsensusServiceProxy> consensus_proxy);
+
+  // Queues 'request' to be sent in the next batch. 'request', 'response' and
+  // 'controller' must be valid until 'callback' is called, once 'response'
+  // or 'controller' hold the outcome of the request.
+  void UpdateAsync(const ConsensusRequestPB* request,
+                   ConsensusResponsePB* response,
+                   rpc::RpcController* controller,
+                   const rpc::ResponseCallback& callback);
+
+ private:
+  struct PendingUpdate {
+    const ConsensusRequestPB* request;
+    ConsensusResponsePB* response;
+    rpc::RpcController* controller;
+    rpc::ResponseCallback callback;
+  };
+
+  // A MultiUpdateConsensus() RPC in flight.
+  struct Batch {
+    MultiUpdateConsensusRequestPB request;
+    MultiUpdateConsensusResponsePB response;
+    rpc::RpcController controller;
+    std::vector<PendingUpdate> updates;
+  };
+
+  // Sends the pending requests.
+  void Flush();
+
+  // Sends 'update' on its own, with an UpdateConsensus() RPC.
+  void SendUpdate(const PendingUpdate& update);
+
+  // Dispatches the responses of 'batch' to its requests.
+  void ProcessBatchResponse(const std::shared_ptr<Batch>& batch);
+
+  const std::shared_ptr<rpc::Messenger> messenger_;
+  const std::string peer_name_;
+  const gscoped_ptr<ConsensusServiceProxy> consensus_proxy_;
+
+  simple_spinlock lock_;
+
+  // The requests to send in the next batch, and whether a flush of them is
+  // scheduled.
+  std::vector<PendingUpdate> pending_;
+  bool flush_scheduled_;
+
+  // Set to false if the destination doesn't support MultiUpdateConsensus().
+  AtomicBool supported_;
+
+  DISALLOW_COPY_AND_ASSIGN(HeartbeatBatcher);
+};
+
 // PeerProxy implementation that does RPC calls
 class RpcPeerProxy : public PeerProxy {
  public:
   RpcPeerProxy(gscoped_ptr<HostPort> hostport,
-               gscoped_ptr<ConsensusServiceProxy> consensus_proxy);
+               gscoped_ptr<ConsensusServiceProxy> consensus_proxy,
+               std::shared_ptr<HeartbeatBatcher> batcher = nullptr);
 
   void UpdateAsync(const ConsensusRequestPB* request,
                    ConsensusResponsePB* response,
                    rpc::RpcController* controller,
                    const rpc::ResponseCallback& callback) override;
 
+  // Batches the request with 'batcher_' if --raft_batch_heartbeats is set.
+  void UpdateHeartbeatAsync(const ConsensusRequestPB* request,
+                            ConsensusResponsePB* response,
+                            rpc::RpcController* controller,
+                            const rpc::ResponseCallback& callback) override;
+
   void RequestConsensusVoteAsync(const VoteRequestPB* request,
                                  VoteResponsePB* response,
                                  rpc::RpcController* controller,
@@ -268,11 +384,17 @@ class RpcPeerProxy : public PeerProxy {
                             rpc::RpcController* controller,
                             const rpc::ResponseCallback& callback) override;
 
+  void SendSafeTimeAsync(const SendSafeTimeRequestPB* request,
+                         SendSafeTimeResponsePB* response,
+                         rpc::RpcController* controller,
+                         const rpc::ResponseCallback& callback) override;
+
   std::string PeerName() const override;
 
  private:
   gscoped_ptr<HostPort> hostport_;
   gscoped_ptr<ConsensusServiceProxy> consensus_proxy_;
+  const std::shared_ptr<HeartbeatBatcher> batcher_;
 };
 
 // PeerProxyFactory implementation that generates RPCPeerProxies
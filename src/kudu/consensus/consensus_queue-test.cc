@@ -346,6 +346,112 @@ TEST_F(ConsensusQueueTest, TestGetPagedMessages) {
   request.mutable_ops()->ExtractSubrange(0, request.ops_size(), nullptr);
 }
 
+// Tests that pipelined requests carry the ops following the ones of the
+// requests in flight, and that requests are no longer pipelined once an
+// exchange with the peer failed.
+TEST_F(ConsensusQueueTest, TestPipelinedRequests) {
+  queue_->SetLeaderMode(kMinimumOpIdIndex, kMinimumTerm, BuildRaftConfigPBForTests(2));
+
+  // Size the batches so that each request carries 9 ops, as in
+  // TestGetPagedMessages.
+  ConsensusRequestPB page_size_estimator;
+  page_size_estimator.set_caller_term(14);
+  page_size_estimator.set_committed_index(0);
+  page_size_estimator.set_all_replicated_index(0);
+  page_size_estimator.set_last_idx_appended_to_leader(0);
+  page_size_estimator.mutable_preceding_id()->CopyFrom(MinimumOpId());
+  const int kOpsPerRequest = 9;
+  for (int i = 0; i < kOpsPerRequest; i++) {
+    page_size_estimator.mutable_ops()->AddAllocated(
+        CreateDummyReplicate(0, 0, clock_->Now(), 0).release());
+  }
+  google::FlagSaver saver;
+  FLAGS_consensus_max_batch_size_bytes = page_size_estimator.ByteSize();
+
+  ConsensusRequestPB request;
+  ConsensusResponsePB response;
+  response.set_responder_uuid(kPeerUuid);
+  bool send_more_immediately = false;
+  UpdatePeerWatermarkToOp(&request, &response, MinimumOpId(), MinimumOpId(),
+                          &send_more_immediately);
+  AppendReplicateMessagesToQueue(queue_.get(), clock_, 1, 100);
+
+  // Returns the index of the first op of the next request, which must be
+  // full, or sets 's' to the error.
+  vector<ReplicateRefPtr> refs;
+  bool needs_tablet_copy;
+  Status s;
+  auto next_request = [&](bool pipelined) -> int64_t {
+    s = queue_->RequestForPeer(kPeerUuid, &request, &refs, &needs_tablet_copy, pipelined);
+    if (!s.ok()) return -1;
+    CHECK_EQ(kOpsPerRequest, request.ops_size());
+    return request.ops(0).id().index();
+  };
+  auto ack_through = [&](int64_t index) {
+    response.mutable_status()->Clear();
+    // The ops appended by AppendReplicateMessagesToQueue() change term every 7 ops.
+    SetLastReceivedAndLastCommitted(&response, MakeOpId(index / 7, index));
+    return queue_->ResponseFromPeer(response.responder_uuid(), response);
+  };
+
+  // The last exchange was an LMP mismatch, so requests can't be pipelined.
+  ASSERT_EQ(1, next_request(false));
+  next_request(true);
+  ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+  ASSERT_TRUE(ack_through(9));
+
+  // Requests pipelined behind the one in flight carry the following ops.
+  ASSERT_EQ(10, next_request(false));
+  ASSERT_EQ(19, next_request(true));
+  ASSERT_EQ(28, next_request(true));
+
+  // Acking the first request doesn't make the next one start over after it.
+  ASSERT_TRUE(ack_through(18));
+  ASSERT_EQ(37, next_request(true));
+
+  // An LMP mismatch, e.g. because the follower received a pipelined request
+  // before the one preceding it, stops the pipelining and the next request
+  // starts after the last op the peer received.
+  RefuseWithLogPropertyMismatch(&response, MakeOpId(2, 18), MakeOpId(2, 18));
+  ASSERT_TRUE(queue_->ResponseFromPeer(response.responder_uuid(), response));
+  next_request(true);
+  ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+  ASSERT_EQ(19, next_request(false));
+
+  // extract the ops from the request to avoid double free
+  request.mutable_ops()->ExtractSubrange(0, request.ops_size(), nullptr);
+}
+
+// Tests that the safe time is sent along with ops if the request carries all
+// the appended ops, and only then.
+TEST_F(ConsensusQueueTest, TestSafeTimeSentWithOps) {
+  queue_->SetLeaderMode(kMinimumOpIdIndex, kMinimumTerm, BuildRaftConfigPBForTests(2));
+  ConsensusRequestPB request;
+  ConsensusResponsePB response;
+  bool send_more_immediately = false;
+  UpdatePeerWatermarkToOp(&request, &response, MinimumOpId(), MinimumOpId(),
+                          &send_more_immediately);
+  AppendReplicateMessagesToQueue(queue_.get(), clock_, 1, 10);
+
+  vector<ReplicateRefPtr> refs;
+  bool needs_tablet_copy;
+  ASSERT_OK(queue_->RequestForPeer(kPeerUuid, &request, &refs, &needs_tablet_copy));
+  ASSERT_EQ(10, request.ops_size());
+  ASSERT_TRUE(request.has_safe_timestamp());
+
+  // Only about half of the ops fit in the next request.
+  google::FlagSaver saver;
+  FLAGS_consensus_max_batch_size_bytes = request.ByteSize() / 2;
+  request.clear_safe_timestamp();
+  ASSERT_OK(queue_->RequestForPeer(kPeerUuid, &request, &refs, &needs_tablet_copy));
+  ASSERT_GT(request.ops_size(), 0);
+  ASSERT_LT(request.ops_size(), 10);
+  ASSERT_FALSE(request.has_safe_timestamp());
+
+  // extract the ops from the request to avoid double free
+  request.mutable_ops()->ExtractSubrange(0, request.ops_size(), nullptr);
+}
+
 TEST_F(ConsensusQueueTest, TestPeersDontAckBeyondWatermarks) {
   queue_->SetLeaderMode(kMinimumOpIdIndex, kMinimumTerm, BuildRaftConfigPBForTests(3));
   AppendReplicateMessagesToQueue(queue_.get(), clock_, 1, 100);
@@ -549,6 +655,64 @@ TEST_F(ConsensusQueueTest, TestNonVoterAcksDontCountTowardMajority) {
   ASSERT_FALSE(send_more_immediately);
 }
 
+// Tests that the leader lease starts at the latest time at which a majority
+// of the voters, counting the local peer, accepted a request of the current
+// term.
+TEST_F(ConsensusQueueTest, TestLeaderLeaseStartTime) {
+  const RaftConfigPB config = BuildRaftConfigPBForTests(/*num_voters=*/ 5,
+                                                        /*num_non_voters=*/ 1);
+  queue_->SetLeaderMode(kMinimumOpIdIndex, 1, config);
+  queue_->TrackPeer(MakePeer("peer-1", RaftPeerPB::VOTER));
+  queue_->TrackPeer(MakePeer("peer-2", RaftPeerPB::VOTER));
+  queue_->TrackPeer(MakePeer("peer-3", RaftPeerPB::VOTER));
+  queue_->TrackPeer(MakePeer("peer-4", RaftPeerPB::VOTER));
+  queue_->TrackPeer(MakePeer("non-voter-peer-0", RaftPeerPB::NON_VOTER));
+  ASSERT_EQ(MonoTime::Min(), queue_->GetLeaderLeaseStartTime());
+
+  const MonoTime t0 = MonoTime::Now();
+  const MonoTime t1 = t0 + MonoDelta::FromSeconds(1);
+  const MonoTime t2 = t0 + MonoDelta::FromSeconds(2);
+
+  // The grants of another term and of the non-voters don't count.
+  queue_->UpdatePeerLeaseGrant("peer-1", 0, t2);
+  queue_->UpdatePeerLeaseGrant("peer-1", 1, t1);
+  queue_->UpdatePeerLeaseGrant("non-voter-peer-0", 1, t2);
+  ASSERT_EQ(MonoTime::Min(), queue_->GetLeaderLeaseStartTime());
+
+  // The local peer, peer-1 and peer-2 are a majority.
+  queue_->UpdatePeerLeaseGrant("peer-2", 1, t0);
+  ASSERT_EQ(t0, queue_->GetLeaderLeaseStartTime());
+  queue_->UpdatePeerLeaseGrant("peer-3", 1, t2);
+  ASSERT_EQ(t1, queue_->GetLeaderLeaseStartTime());
+
+  // An older grant doesn't move the lease back.
+  queue_->UpdatePeerLeaseGrant("peer-3", 1, t0);
+  ASSERT_EQ(t1, queue_->GetLeaderLeaseStartTime());
+
+  // There is no lease out of leader mode, and the grants of the previous
+  // leadership are dropped.
+  queue_->SetNonLeaderMode(config);
+  ASSERT_EQ(MonoTime::Min(), queue_->GetLeaderLeaseStartTime());
+  queue_->SetLeaderMode(kMinimumOpIdIndex, 2, config);
+  ASSERT_EQ(MonoTime::Min(), queue_->GetLeaderLeaseStartTime());
+}
+
+// Tests that the callback passed to AppendOperation() is called once the
+// operation is in the queue and may be sent to the peers.
+TEST_F(ConsensusQueueTest, TestAppendedCallback) {
+  queue_->SetLeaderMode(kMinimumOpIdIndex, kMinimumTerm, BuildRaftConfigPBForTests(2));
+  ReplicateRefPtr msg = make_scoped_refptr_replicate(
+      CreateDummyReplicate(1, 1, clock_->Now(), 0).release());
+  int num_calls = 0;
+  ASSERT_OK(queue_->AppendOperation(msg, [&]() {
+        num_calls++;
+        ASSERT_OPID_EQ(MakeOpId(1, 1), queue_->GetLastOpIdInLog());
+      }));
+  ASSERT_EQ(1, num_calls);
+  log_->WaitUntilAllFlushed();
+  WaitForLocalPeerToAckIndex(1);
+}
+
 // In this test we append a sequence of operations to a log
 // and then start tracking a peer whose first required operation
 // is before the first operation in the queue.
@@ -121,10 +121,12 @@ const char* PeerStatusToString(PeerStatus p) {
 PeerMessageQueue::TrackedPeer::TrackedPeer(RaftPeerPB peer_pb)
     : peer_pb(std::move(peer_pb)),
       next_index(kInvalidOpIdIndex),
+      next_unsent_index(kInvalidOpIdIndex),
       last_received(MinimumOpId()),
       last_known_committed_index(MinimumOpId().index()),
       last_exchange_status(PeerStatus::NEW),
       last_communication_time(MonoTime::Now()),
+      last_lease_grant_time(MonoTime::Min()),
       wal_catchup_possible(true),
       last_overall_health_status(HealthReportPB::UNKNOWN),
       status_log_throttler(std::make_shared<logging::LogThrottler>()),
@@ -207,10 +209,11 @@ void PeerMessageQueue::SetLeaderMode(int64_t committed_index,
                                  << queue_state_.ToString();
 
   // Reset last communication time with all peers to reset the clock on the
-  // failure timeout.
+  // failure timeout. The lease grants of a previous leadership don't count.
   const auto now = MonoTime::Now();
   for (const PeersMap::value_type& entry : peers_map_) {
     entry.second->last_communication_time = now;
+    entry.second->last_lease_grant_time = MonoTime::Min();
   }
   time_manager_->SetLeaderMode();
 }
@@ -253,6 +256,7 @@ void PeerMessageQueue::TrackPeerUnlocked(const RaftPeerPB& peer_pb) {
   // does not have a log that matches ours, the normal queue negotiation
   // process will eventually find the right point to resume from.
   tracked_peer->next_index = queue_state_.last_appended.index() + 1;
+  tracked_peer->next_unsent_index = tracked_peer->next_index;
   InsertOrDie(&peers_map_, tracked_peer->uuid(), tracked_peer);
 
   CheckPeersInActiveConfigIfLeaderUnlocked();
@@ -357,13 +361,16 @@ void PeerMessageQueue::LocalPeerAppendFinished(const OpId& id,
   callback.Run(status);
 }
 
-Status PeerMessageQueue::AppendOperation(const ReplicateRefPtr& msg) {
+Status PeerMessageQueue::AppendOperation(const ReplicateRefPtr& msg,
+                                         const std::function<void()>& appended_callback) {
   return AppendOperations({ msg }, Bind(CrashIfNotOkStatusCB,
-                                        "Enqueued replicate operation failed to write to WAL"));
+                                        "Enqueued replicate operation failed to write to WAL"),
+                          appended_callback);
 }
 
 Status PeerMessageQueue::AppendOperations(const vector<ReplicateRefPtr>& msgs,
-                                          const StatusCallback& log_append_callback) {
+                                          const StatusCallback& log_append_callback,
+                                          const std::function<void()>& appended_callback) {
 
   DFAKE_SCOPED_LOCK(append_fake_lock_);
   std::unique_lock<simple_spinlock> lock(queue_lock_);
@@ -388,30 +395,42 @@ Status PeerMessageQueue::AppendOperations(const vector<ReplicateRefPtr>& msgs,
     }
   }
 
-  // Update safe time in the TimeManager if we're leader.
-  // This will 'unpin' safe time advancement, which had stopped since we assigned a timestamp to
-  // the message.
-  // Until we have leader leases, replicas only call this when the message is committed.
-  if (queue_state_.mode == LEADER) {
-    time_manager_->AdvanceSafeTimeWithMessage(*msgs.back()->get());
-  }
-
   // Unlock ourselves during Append to prevent a deadlock: it's possible that
   // the log buffer is full, in which case AppendOperations would block. However,
   // for the log buffer to empty, it may need to call LocalPeerAppendFinished()
   // which also needs queue_lock_.
   lock.unlock();
-  RETURN_NOT_OK(log_cache_.AppendOperations(msgs,
-                                            Bind(&PeerMessageQueue::LocalPeerAppendFinished,
-                                                 Unretained(this),
-                                                 last_id,
-                                                 log_append_callback)));
-  lock.lock();
-  DCHECK(last_id.IsInitialized());
-  queue_state_.last_appended = last_id;
-  UpdateMetricsUnlocked();
 
-  return Status::OK();
+  // The operations are appended to the queue as soon as they're in the log
+  // cache, so that the requests to the peers may include them while they are
+  // serialized and written to the local log.
+  DCHECK(last_id.IsInitialized());
+  auto cached_callback = [&]() {
+    {
+      std::lock_guard<simple_spinlock> l(queue_lock_);
+      queue_state_.last_appended = last_id;
+      UpdateMetricsUnlocked();
+
+      // Update safe time in the TimeManager if we're leader.
+      // This will 'unpin' safe time advancement, which had stopped since we assigned a
+      // timestamp to the message. This happens along with the update of 'last_appended'
+      // so that a request which carries all the ops up to 'last_appended' may carry
+      // the safe time too: see RequestForPeer().
+      // Until we have leader leases, replicas only call this when the message is committed.
+      if (queue_state_.mode == LEADER) {
+        time_manager_->AdvanceSafeTimeWithMessage(*msgs.back()->get());
+      }
+    }
+    if (appended_callback) {
+      appended_callback();
+    }
+  };
+  return log_cache_.AppendOperations(msgs,
+                                     Bind(&PeerMessageQueue::LocalPeerAppendFinished,
+                                          Unretained(this),
+                                          last_id,
+                                          log_append_callback),
+                                     cached_callback);
 }
 
 void PeerMessageQueue::TruncateOpsAfter(int64_t index) {
@@ -611,12 +630,15 @@ HealthReportPB::HealthStatus PeerMessageQueue::PeerHealthStatus(const TrackedPee
 Status PeerMessageQueue::RequestForPeer(const string& uuid,
                                         ConsensusRequestPB* request,
                                         vector<ReplicateRefPtr>* msg_refs,
-                                        bool* needs_tablet_copy) {
+                                        bool* needs_tablet_copy,
+                                        bool pipelined) {
   // Maintain a thread-safe copy of necessary members.
   OpId preceding_id;
   int64_t current_term;
   TrackedPeer peer_copy;
   MonoDelta unreachable_time;
+  Timestamp safe_time;
+  int64_t last_appended_index;
   {
     std::lock_guard<simple_spinlock> lock(queue_lock_);
     DCHECK_EQ(queue_state_.state, kQueueOpen);
@@ -628,6 +650,10 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
                                          "queue is not in leader mode", uuid));
     }
     peer_copy = *peer;
+    if (pipelined && peer_copy.last_exchange_status != PeerStatus::OK) {
+      return Status::IllegalState(Substitute("cannot pipeline requests to peer $0: $1",
+                                             uuid, peer_copy.ToString()));
+    }
 
     // Clear the requests without deleting the entries, as they may be in use by other peers.
     request->mutable_ops()->ExtractSubrange(0, request->ops_size(), nullptr);
@@ -642,11 +668,17 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
     request->set_last_idx_appended_to_leader(queue_state_.last_appended.index());
     request->set_caller_term(current_term);
     unreachable_time = MonoTime::Now() - peer_copy.last_communication_time;
+
+    // All the ops with lower timestamps than the safe time are appended up to
+    // 'last_appended', so the safe time may be sent along with them.
+    safe_time = time_manager_->GetSafeTime();
+    last_appended_index = queue_state_.last_appended.index();
   }
 
   // Always trigger a health status update check at the end of this function.
   bool wal_catchup_progress = false;
   bool wal_catchup_failure = false;
+  int64_t next_unsent_index = peer_copy.next_index;
   SCOPED_CLEANUP({
       std::lock_guard<simple_spinlock> lock(queue_lock_);
       TrackedPeer* peer = FindPtrOrNull(peers_map_, uuid);
@@ -657,6 +689,8 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
       }
       if (wal_catchup_progress) peer->wal_catchup_possible = true;
       if (wal_catchup_failure) peer->wal_catchup_possible = false;
+      peer->next_unsent_index = pipelined ?
+          std::max(peer->next_unsent_index, next_unsent_index) : next_unsent_index;
       UpdatePeerHealthUnlocked(peer);
     });
 
@@ -676,8 +710,12 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
     vector<ReplicateRefPtr> messages;
     int max_batch_size = FLAGS_consensus_max_batch_size_bytes - request->ByteSize();
 
-    // We try to get the follower's next_index from our log.
-    Status s = log_cache_.ReadOps(peer_copy.next_index - 1,
+    // We try to get the follower's next_index from our log, or the index
+    // following the in-flight requests if this one is pipelined.
+    if (pipelined) {
+      next_unsent_index = std::max(peer_copy.next_index, peer_copy.next_unsent_index);
+    }
+    Status s = log_cache_.ReadOps(next_unsent_index - 1,
                                   max_batch_size,
                                   &messages,
                                   &preceding_id);
@@ -720,6 +758,9 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
     for (const ReplicateRefPtr& msg : messages) {
       request->mutable_ops()->AddAllocated(msg->get());
     }
+    if (!messages.empty()) {
+      next_unsent_index = messages.back()->get()->id().index() + 1;
+    }
     msg_refs->swap(messages);
   }
 
@@ -737,11 +778,15 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
           << (request->committed_index() - last_op_sent)
           << " ops behind the committed index " << THROTTLE_MSG;
     }
+    // If the request carries all the appended ops, the follower may advance
+    // its safe time right away rather than with the next heartbeat.
+    if (last_op_sent >= last_appended_index) {
+      request->set_safe_timestamp(safe_time.value());
+    }
   // If we're not sending ops to the follower, set the safe time on the request.
-  // TODO(dralves) When we have leader leases, send this all the time.
   } else {
     if (PREDICT_TRUE(FLAGS_safe_time_advancement_without_writes)) {
-      request->set_safe_timestamp(time_manager_->GetSafeTime().value());
+      request->set_safe_timestamp(safe_time.value());
     } else {
       KLOG_EVERY_N_SECS(WARNING, 300) << "Safe time advancement without writes is disabled. "
             "Snapshot reads on non-leader replicas may stall if there are no writes in progress.";
@@ -1166,6 +1211,11 @@ bool PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
           << "Falling back to committed index " << peer->last_known_committed_index;
     }
 
+    // If the exchange failed, the requests which may still be in flight to
+    // the peer are disregarded and the next request starts at 'next_index'.
+    peer->next_unsent_index = peer->last_exchange_status == PeerStatus::OK ?
+        std::max(peer->next_unsent_index, peer->next_index) : peer->next_index;
+
     if (peer->last_exchange_status != PeerStatus::OK) {
       // In this case, 'send_more_immediately' has already been set by
       // UpdateExchangeStatus() to true in the case of an LMP mismatch, false
@@ -1291,6 +1341,40 @@ bool PeerMessageQueue::IsCommittedIndexInCurrentTerm() const {
       queue_state_.committed_index >= *queue_state_.first_index_in_current_term;
 }
 
+void PeerMessageQueue::UpdatePeerLeaseGrant(const string& uuid, int64_t term,
+                                            MonoTime request_send_time) {
+  std::lock_guard<simple_spinlock> lock(queue_lock_);
+  if (queue_state_.mode != LEADER || term != queue_state_.current_term) {
+    return;
+  }
+  TrackedPeer* peer = FindPtrOrNull(peers_map_, uuid);
+  if (peer && request_send_time > peer->last_lease_grant_time) {
+    peer->last_lease_grant_time = request_send_time;
+  }
+}
+
+MonoTime PeerMessageQueue::GetLeaderLeaseStartTime() const {
+  std::lock_guard<simple_spinlock> lock(queue_lock_);
+  if (queue_state_.mode != LEADER || queue_state_.majority_size_ <= 0) {
+    return MonoTime::Min();
+  }
+  vector<MonoTime> grant_times;
+  for (const PeersMap::value_type& entry : peers_map_) {
+    const TrackedPeer* peer = entry.second;
+    if (!IsRaftConfigVoter(peer->uuid(), *queue_state_.active_config)) {
+      continue;
+    }
+    // The local peer doesn't vote for anyone else while it's the leader.
+    grant_times.push_back(peer->uuid() == local_peer_pb_.permanent_uuid() ?
+                          MonoTime::Max() : peer->last_lease_grant_time);
+  }
+  if (grant_times.size() < queue_state_.majority_size_) {
+    return MonoTime::Min();
+  }
+  std::sort(grant_times.begin(), grant_times.end(), std::greater<MonoTime>());
+  return grant_times[queue_state_.majority_size_ - 1];
+}
+
 bool PeerMessageQueue::IsInLeaderMode() const {
   std::lock_guard<simple_spinlock> lock(queue_lock_);
   return queue_state_.mode == Mode::LEADER;
@@ -142,6 +142,11 @@ class PeerMessageQueue {
     // This corresponds to "nextIndex" as specified in Raft.
     int64_t next_index;
 
+    // The index following the last op sent to the peer, which may still be
+    // in flight. Requests pipelined behind the in-flight ones start at this
+    // index rather than at 'next_index'.
+    int64_t next_unsent_index;
+
     // The last operation that we've sent to this peer and that
     // it acked. Used for watermark movement.
     OpId last_received;
@@ -164,6 +169,12 @@ class PeerMessageQueue {
     // successful communication ever took place.
     MonoTime last_communication_time;
 
+    // The time at which this leader sent the last request of its current
+    // term that the peer accepted. Since a follower doesn't vote for another
+    // candidate for the minimum election timeout after accepting a request,
+    // this bounds the leader's lease with respect to this peer.
+    MonoTime last_lease_grant_time;
+
     // Set to false if it is determined that the remote peer has fallen behind
     // the local peer's WAL.
     bool wal_catchup_possible;
@@ -228,7 +239,11 @@ class PeerMessageQueue {
   //
   // This is thread-safe against all of the read methods, but not thread-safe
   // with concurrent Append calls.
-  Status AppendOperation(const ReplicateRefPtr& msg);
+  //
+  // If set, 'appended_callback' is called as soon as the message may be sent
+  // to the peers, i.e. before it is written to the local Log.
+  Status AppendOperation(const ReplicateRefPtr& msg,
+                         const std::function<void()>& appended_callback = nullptr);
 
   // Appends a vector of messages to be replicated to the peers.
   // Returns OK unless the message could not be added to the queue for some
@@ -238,8 +253,12 @@ class PeerMessageQueue {
   //
   // This is thread-safe against all of the read methods, but not thread-safe
   // with concurrent Append calls.
+  //
+  // If set, 'appended_callback' is called as soon as the messages may be sent
+  // to the peers, i.e. before they're written to the local Log.
   Status AppendOperations(const std::vector<ReplicateRefPtr>& msgs,
-                          const StatusCallback& log_append_callback);
+                          const StatusCallback& log_append_callback,
+                          const std::function<void()>& appended_callback = nullptr);
 
   // Truncate all operations coming after 'index'. Following this, the 'last_appended'
   // operation is reset to the OpId with this index, and the log cache will be truncated
@@ -260,6 +279,12 @@ class PeerMessageQueue {
   // Returns Status::Incomplete if we try to read an operation index from the
   // log that has not been written.
   //
+  // If 'pipelined' is true, the request is meant to be sent while other
+  // requests are in flight to the peer: its entries start after the last
+  // entry sent to the peer rather than after the last entry it acked.
+  // Returns Status::IllegalState if the last exchange with the peer wasn't
+  // successful, since its requests must then not be pipelined.
+  //
   // WARNING: In order to avoid copying the same messages to every peer,
   // entries are added to 'request' via AddAllocated() methods.
   // The owner of 'request' is expected not to delete the request prior
@@ -271,7 +296,8 @@ class PeerMessageQueue {
   Status RequestForPeer(const std::string& uuid,
                         ConsensusRequestPB* request,
                         std::vector<ReplicateRefPtr>* msg_refs,
-                        bool* needs_tablet_copy);
+                        bool* needs_tablet_copy,
+                        bool pipelined = false);
 
   // Fill in a StartTabletCopyRequest for the specified peer.
   // If that peer should not initiate Tablet Copy, returns a non-OK status.
@@ -322,6 +348,17 @@ class PeerMessageQueue {
   // Return true if the committed index falls within the current term.
   bool IsCommittedIndexInCurrentTerm() const;
 
+  // Records that the peer 'uuid' accepted a request of term 'term' that was
+  // sent at 'request_send_time'. Does nothing if 'term' isn't the current
+  // term of the queue.
+  void UpdatePeerLeaseGrant(const std::string& uuid, int64_t term,
+                            MonoTime request_send_time);
+
+  // Returns the latest time at which a majority of the voters, including the
+  // local peer, had accepted a request from this leader, or MonoTime::Min()
+  // if the queue isn't in leader mode or a majority never accepted one.
+  MonoTime GetLeaderLeaseStartTime() const;
+
   // Whether the queue run in the leader mode.
   bool IsInLeaderMode() const;
 
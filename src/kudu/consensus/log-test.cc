@@ -68,6 +68,8 @@ DECLARE_double(log_inject_io_error_on_preallocate_fraction);
 DECLARE_int64(fs_wal_dir_reserved_bytes);
 DECLARE_int64(disk_reserved_bytes_free_for_testing);
 DECLARE_string(log_compression_codec);
+DECLARE_bool(log_compression_adaptive);
+DECLARE_int32(log_compression_min_batch_bytes);
 
 namespace kudu {
 namespace log {
@@ -233,6 +235,38 @@ TEST_P(LogTestOptionalCompression, TestMultipleEntriesInABatch) {
   ASSERT_OK(log_->Close());
 }
 
+// Tests that, with adaptive compression, the small batches which are written
+// uncompressed and the larger ones which are compressed are both read back.
+TEST_F(LogTest, TestAdaptiveCompression) {
+  FLAGS_log_compression_codec = "LZ4";
+  FLAGS_log_compression_adaptive = true;
+  FLAGS_log_compression_min_batch_bytes = 1024;
+  ASSERT_OK(BuildLog());
+
+  OpId opid;
+  opid.set_term(1);
+  opid.set_index(1);
+  // A small batch, written uncompressed, then a larger batch of similar
+  // entries, which compresses well.
+  ASSERT_OK(AppendNoOpsToLogSync(clock_, log_.get(), &opid, 2));
+  ASSERT_OK(AppendNoOpsToLogSync(clock_, log_.get(), &opid, 100));
+  ASSERT_OK(log_->AllocateSegmentAndRollOver());
+
+  SegmentSequence segments;
+  ASSERT_OK(log_->reader()->GetSegmentsSnapshot(&segments));
+  const auto& features = segments[0]->header().incompatible_features();
+  ASSERT_EQ(1, features.size());
+  ASSERT_EQ(LogSegmentHeaderPB::UNCOMPRESSED_ENTRIES, features.Get(0));
+
+  LogEntries entries;
+  ASSERT_OK(segments[0]->ReadEntries(&entries));
+  ASSERT_EQ(102, entries.size());
+  for (int i = 0; i < entries.size(); i++) {
+    ASSERT_EQ(i + 1, entries[i]->replicate().id().index());
+  }
+  ASSERT_OK(log_->Close());
+}
+
 // Tests that everything works properly with fsync enabled:
 // This also tests SyncDir() (see KUDU-261), which is called whenever
 // a new log segment is initialized.
@@ -31,6 +31,7 @@
 #include "kudu/consensus/log_index.h"
 #include "kudu/consensus/log_metrics.h"
 #include "kudu/consensus/log_reader.h"
+#include "kudu/consensus/log_sync_group.h"
 #include "kudu/consensus/log_util.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/atomicops.h"
@@ -97,6 +98,15 @@ DEFINE_string(log_compression_codec, "LZ4",
               "Codec to use for compressing WAL segments.");
 TAG_FLAG(log_compression_codec, experimental);
 
+DEFINE_bool(log_compression_adaptive, false,
+            "Whether the WAL entry batches which are small or compress poorly are written "
+            "uncompressed rather than with --log_compression_codec. This saves the CPU "
+            "spent compressing and uncompressing them. See --log_compression_min_batch_bytes "
+            "and --log_compression_max_ratio. The WAL segments written with this enabled are "
+            "not readable by the versions of Kudu which don't support it.");
+TAG_FLAG(log_compression_adaptive, experimental);
+TAG_FLAG(log_compression_adaptive, runtime);
+
 // Fault/latency injection flags.
 // -----------------------------
 DEFINE_bool(log_inject_latency, false,
@@ -474,6 +484,7 @@ Log::Log(LogOptions options, FsManager* fs_manager, string log_path,
       append_thread_(new AppendThread(this)),
       force_sync_all_(options_.force_fsync_all),
       sync_disabled_(false),
+      sync_group_(nullptr),
       allocation_state_(kAllocationNotStarted),
       codec_(nullptr),
       metric_entity_(std::move(metric_entity)),
@@ -521,6 +532,9 @@ Status Log::Init() {
 
   if (force_sync_all_) {
     KLOG_FIRST_N(INFO, 1) << LogPrefix() << "Log is configured to fsync() on all Append() calls";
+    if (options_.group_fsync) {
+      sync_group_ = LogSyncGroup::Get(fs_manager_->env(), DirName(log_dir_));
+    }
   } else {
     KLOG_FIRST_N(INFO, 1) << LogPrefix()
                           << "Log is configured to *not* fsync() on all Append() calls";
@@ -748,7 +762,11 @@ Status Log::Sync() {
 
   if (force_sync_all_ && !sync_disabled_) {
     LOG_SLOW_EXECUTION(WARNING, 50, Substitute("$0Fsync log took a long time", LogPrefix())) {
-      RETURN_NOT_OK(active_segment_->Sync());
+      if (sync_group_) {
+        RETURN_NOT_OK(sync_group_->Sync(active_segment_.get()));
+      } else {
+        RETURN_NOT_OK(active_segment_->Sync());
+      }
 
       if (log_hooks_) {
         RETURN_NOT_OK_PREPEND(log_hooks_->PostSyncIfFsyncEnabled(),
@@ -1079,6 +1097,9 @@ Status Log::SwitchToAllocatedSegment() {
 
   if (codec_) {
     header.set_compression_codec(codec_->type());
+    if (FLAGS_log_compression_adaptive) {
+      header.add_incompatible_features(LogSegmentHeaderPB::UNCOMPRESSED_ENTRIES);
+    }
   }
 
   // Set up the new footer. This will be maintained as the segment is written.
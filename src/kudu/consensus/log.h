@@ -66,6 +66,7 @@ struct RetentionIndexes;
 class LogEntryBatch;
 class LogIndex;
 class LogReader;
+class LogSyncGroup;
 
 typedef BlockingQueue<LogEntryBatch*, LogEntryBatchLogicalSize> LogEntryBatchQueue;
 
@@ -398,6 +399,9 @@ class Log : public RefCountedThreadSafe<Log> {
   // This is used to disable fsync during bootstrap.
   bool sync_disabled_;
 
+  // If set, the group with which the fsyncs are group-committed.
+  LogSyncGroup* sync_group_;
+
   // The status of the most recent log-allocation action.
   Promise<Status> allocation_status_;
 
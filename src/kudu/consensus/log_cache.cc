@@ -17,6 +17,7 @@
 
 #include "kudu/consensus/log_cache.h"
 
+#include <functional>
 #include <map>
 #include <mutex>
 #include <ostream>
@@ -79,6 +80,18 @@ static const char kParentMemTrackerId[] = "log_cache";
 
 typedef vector<const ReplicateMsg*>::const_iterator MsgIter;
 
+namespace {
+// Calculate the total byte size that will be used on the wire to replicate
+// this message as part of a consensus update request. This accounts for the
+// length delimiting and tagging of the message.
+int64_t TotalByteSizeForMessage(const ReplicateMsg& msg) {
+  int msg_size = google::protobuf::internal::WireFormatLite::LengthDelimitedSize(
+    msg.ByteSize());
+  msg_size += 1; // for the type tag
+  return msg_size;
+}
+} // anonymous namespace
+
 LogCache::LogCache(const scoped_refptr<MetricEntity>& metric_entity,
                    scoped_refptr<log::Log> log,
                    string local_uuid,
@@ -109,7 +122,8 @@ LogCache::LogCache(const scoped_refptr<MetricEntity>& metric_entity,
   // code paths elsewhere.
   auto zero_op = new ReplicateMsg();
   *zero_op->mutable_id() = MinimumOpId();
-  InsertOrDie(&cache_, 0, { make_scoped_refptr_replicate(zero_op), zero_op->SpaceUsed() });
+  InsertOrDie(&cache_, 0, { make_scoped_refptr_replicate(zero_op), zero_op->SpaceUsed(),
+                            TotalByteSizeForMessage(*zero_op) });
 }
 
 LogCache::~LogCache() {
@@ -148,16 +162,19 @@ void LogCache::TruncateOpsAfterUnlocked(int64_t index) {
 }
 
 Status LogCache::AppendOperations(const vector<ReplicateRefPtr>& msgs,
-                                  const StatusCallback& callback) {
+                                  const StatusCallback& callback,
+                                  const std::function<void()>& cached_callback) {
   CHECK_GT(msgs.size(), 0);
 
-  // SpaceUsed is relatively expensive, so do calculations outside the lock
-  // and cache the result with each message.
+  // SpaceUsed and ByteSize are relatively expensive, so do calculations
+  // outside the lock and cache the results with each message.
   int64_t mem_required = 0;
   vector<CacheEntry> entries_to_insert;
   entries_to_insert.reserve(msgs.size());
   for (const auto& msg : msgs) {
-    CacheEntry e = { msg, static_cast<int64_t>(msg->get()->SpaceUsedLong()) };
+    CacheEntry e = { msg,
+                     static_cast<int64_t>(msg->get()->SpaceUsedLong()),
+                     TotalByteSizeForMessage(*msg->get()) };
     mem_required += e.mem_usage;
     entries_to_insert.emplace_back(std::move(e));
   }
@@ -210,6 +227,10 @@ Status LogCache::AppendOperations(const vector<ReplicateRefPtr>& msgs,
   metrics_.log_cache_size->IncrementBy(mem_required);
   metrics_.log_cache_num_ops->IncrementBy(msgs.size());
 
+  if (cached_callback) {
+    cached_callback();
+  }
+
   Status log_status = log_->AsyncAppendReplicates(
     msgs, Bind(&LogCache::LogCallback,
                Unretained(this),
@@ -280,18 +301,6 @@ Status LogCache::LookupOpId(int64_t op_index, OpId* op_id) const {
   return log_->reader()->LookupOpId(op_index, op_id);
 }
 
-namespace {
-// Calculate the total byte size that will be used on the wire to replicate
-// this message as part of a consensus update request. This accounts for the
-// length delimiting and tagging of the message.
-int64_t TotalByteSizeForMessage(const ReplicateMsg& msg) {
-  int msg_size = google::protobuf::internal::WireFormatLite::LengthDelimitedSize(
-    msg.ByteSize());
-  msg_size += 1; // for the type tag
-  return msg_size;
-}
-} // anonymous namespace
-
 Status LogCache::ReadOps(int64_t after_op_index,
                          int max_size_bytes,
                          std::vector<ReplicateRefPtr>* messages,
@@ -353,7 +362,7 @@ Status LogCache::ReadOps(int64_t after_op_index,
           continue;
         }
 
-        remaining_space -= TotalByteSizeForMessage(*msg->get());
+        remaining_space -= iter->second.wire_size;
         if (remaining_space < 0 && !messages->empty()) {
           break;
         }
@@ -18,6 +18,7 @@
 #define KUDU_CONSENSUS_LOG_CACHE_H
 
 #include <cstdint>
+#include <functional>
 #include <iosfwd>
 #include <map>
 #include <memory>
@@ -90,12 +91,17 @@ class LogCache {
   // Append the operations into the log and the cache.
   // When the messages have completed writing into the on-disk log, fires 'callback'.
   //
+  // If set, 'cached_callback' is called once the operations are in the cache,
+  // before they are serialized and queued for the on-disk log, so that they can
+  // be read and sent to the peers while they are written locally.
+  //
   // If the cache memory limit is exceeded, the entries may no longer be in the cache
   // when the callback fires.
   //
   // Returns non-OK if the Log append itself fails.
   Status AppendOperations(const std::vector<ReplicateRefPtr>& msgs,
-                          const StatusCallback& callback);
+                          const StatusCallback& callback,
+                          const std::function<void()>& cached_callback = nullptr);
 
   // Truncate any operations with index > 'index'.
   //
@@ -155,6 +161,12 @@ class LogCache {
     // The cached value of msg->SpaceUsedLong(). This method is expensive
     // to compute, so we compute it only once upon insertion.
     int64_t mem_usage;
+    // The size of the message on the wire once batched in a consensus
+    // update request. Like 'mem_usage', it is computed only once upon
+    // insertion rather than each time the message is read for a peer, which
+    // also avoids recomputing the protobuf's cached sizes while the message
+    // may be serialized concurrently for another peer.
+    int64_t wire_size;
   };
 
   // Try to evict the oldest operations from the queue, stopping either when
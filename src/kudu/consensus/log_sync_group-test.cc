@@ -0,0 +1,137 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/consensus/log_sync_group.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gflags/gflags_declare.h>
+#include <gtest/gtest.h>
+
+#include "kudu/consensus/log_util.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/env.h"
+#include "kudu/util/path_util.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+DECLARE_bool(never_fsync);
+DECLARE_double(env_inject_eio);
+DECLARE_string(env_inject_eio_globs);
+
+using std::shared_ptr;
+using std::string;
+using std::thread;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace log {
+
+class LogSyncGroupTest : public KuduTest {
+ protected:
+  // Creates a segment in 'dir', written to by the returned file.
+  void CreateSegment(const string& dir, int idx, shared_ptr<WritableFile>* file,
+                     unique_ptr<WritableLogSegment>* segment) {
+    const string path = JoinPathSegments(dir, Substitute("segment-$0", idx));
+    unique_ptr<WritableFile> f;
+    ASSERT_OK(env_->NewWritableFile(path, &f));
+    file->reset(f.release());
+    segment->reset(new WritableLogSegment(path, *file));
+  }
+};
+
+// Syncs the segments of many logs concurrently.
+TEST_F(LogSyncGroupTest, TestConcurrentSyncs) {
+  FLAGS_never_fsync = false;
+  const int kNumLogs = 8;
+  const int kNumSyncsPerLog = 50;
+  const string dir = GetTestPath("wals");
+  ASSERT_OK(env_->CreateDir(dir));
+  LogSyncGroup* group = LogSyncGroup::Get(env_, dir);
+  ASSERT_EQ(group, LogSyncGroup::Get(env_, dir));
+  ASSERT_NE(group, LogSyncGroup::Get(env_, GetTestPath("other")));
+
+  vector<shared_ptr<WritableFile>> files(kNumLogs);
+  vector<unique_ptr<WritableLogSegment>> segments(kNumLogs);
+  for (int i = 0; i < kNumLogs; i++) {
+    NO_FATALS(CreateSegment(dir, i, &files[i], &segments[i]));
+  }
+  vector<Status> statuses(kNumLogs);
+  vector<thread> threads;
+  for (int i = 0; i < kNumLogs; i++) {
+    threads.emplace_back([&, i]() {
+      for (int j = 0; j < kNumSyncsPerLog; j++) {
+        Status s = files[i]->Append(Slice("entry"));
+        if (s.ok()) {
+          s = group->Sync(segments[i].get());
+        }
+        if (!s.ok()) {
+          statuses[i] = s;
+          return;
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  for (const auto& s : statuses) {
+    ASSERT_OK(s);
+  }
+#if defined(__linux__)
+  ASSERT_GT(group->num_syncs(), 0);
+  ASSERT_LE(group->num_syncs(), kNumLogs * kNumSyncsPerLog);
+#endif
+  LOG(INFO) << "Synced " << kNumLogs * kNumSyncsPerLog << " appends with "
+            << group->num_syncs() << " filesystem syncs";
+}
+
+// Checks that a failed filesystem sync falls back to syncing the segment.
+TEST_F(LogSyncGroupTest, TestFailedSyncFallsBack) {
+  const string dir = GetTestPath("wals");
+  ASSERT_OK(env_->CreateDir(dir));
+  LogSyncGroup* group = LogSyncGroup::Get(env_, dir);
+  shared_ptr<WritableFile> file;
+  unique_ptr<WritableLogSegment> segment;
+  NO_FATALS(CreateSegment(dir, 0, &file, &segment));
+  ASSERT_OK(file->Append(Slice("entry")));
+
+  // Only the filesystem sync fails: the segment is synced on its own.
+  FLAGS_env_inject_eio = 1.0;
+  FLAGS_env_inject_eio_globs = dir;
+  ASSERT_OK(group->Sync(segment.get()));
+
+  // The errors of the segment are returned.
+  FLAGS_env_inject_eio = 0;
+  ASSERT_OK(file->Append(Slice("entry")));
+  FLAGS_env_inject_eio = 1.0;
+  FLAGS_env_inject_eio_globs = Substitute("$0,$1", dir, JoinPathSegments(dir, "**"));
+  Status s = group->Sync(segment.get());
+  ASSERT_TRUE(s.IsIOError()) << s.ToString();
+  FLAGS_env_inject_eio = 0;
+}
+
+} // namespace log
+} // namespace kudu
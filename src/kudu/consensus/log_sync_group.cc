@@ -0,0 +1,105 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/consensus/log_sync_group.h"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/consensus/log_util.h"
+#include "kudu/gutil/map-util.h"
+#include "kudu/util/env.h"
+#include "kudu/util/locks.h"
+
+using std::string;
+using std::unique_ptr;
+using std::unordered_map;
+
+namespace kudu {
+namespace log {
+
+LogSyncGroup* LogSyncGroup::Get(Env* env, const string& wals_root) {
+  static simple_spinlock lock;
+  static auto* groups = new unordered_map<string, unique_ptr<LogSyncGroup>>();
+  std::lock_guard<simple_spinlock> l(lock);
+  unique_ptr<LogSyncGroup>* group = FindOrNull(*groups, wals_root);
+  if (group) {
+    return group->get();
+  }
+  auto* new_group = new LogSyncGroup(env, wals_root);
+  EmplaceOrDie(groups, wals_root, unique_ptr<LogSyncGroup>(new_group));
+  return new_group;
+}
+
+LogSyncGroup::LogSyncGroup(Env* env, string wals_root)
+    : env_(env),
+      wals_root_(std::move(wals_root)),
+      cond_(&lock_),
+      sync_in_progress_(false),
+      syncs_started_(0),
+      syncs_finished_(0),
+      last_failed_sync_(0),
+      sync_not_supported_(false) {
+}
+
+Status LogSyncGroup::Sync(WritableLogSegment* segment) {
+  {
+    MutexLock l(lock_);
+    // A sync already in progress may have started before the data of
+    // 'segment' was written, so wait for the next one.
+    const int64_t target = syncs_started_ + 1;
+    while (!sync_not_supported_ && syncs_finished_ < target) {
+      if (sync_in_progress_) {
+        cond_.Wait();
+        continue;
+      }
+      const int64_t id = ++syncs_started_;
+      sync_in_progress_ = true;
+      l.Unlock();
+      Status s = env_->SyncFilesystem(wals_root_);
+      l.Lock();
+      if (PREDICT_FALSE(s.IsNotSupported())) {
+        sync_not_supported_ = true;
+      } else if (PREDICT_FALSE(!s.ok())) {
+        LOG(WARNING) << "Failed to sync the filesystem of " << wals_root_ << ": "
+                     << s.ToString();
+        last_failed_sync_ = id;
+      }
+      syncs_finished_ = id;
+      sync_in_progress_ = false;
+      cond_.Broadcast();
+    }
+    // Only the sync with id 'target' is known to cover 'segment', but any
+    // sync which started later does too.
+    if (!sync_not_supported_ && last_failed_sync_ < target) {
+      return Status::OK();
+    }
+  }
+  return segment->Sync();
+}
+
+int64_t LogSyncGroup::num_syncs() const {
+  MutexLock l(lock_);
+  return syncs_started_;
+}
+
+} // namespace log
+} // namespace kudu
@@ -0,0 +1,89 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/mutex.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class Env;
+
+namespace log {
+
+class WritableLogSegment;
+
+// Group-commits the fsyncs of the logs whose segments are on the same
+// filesystem: rather than each log syncing its own segment, a single
+// syncfs() makes durable the appends of all the logs waiting to sync.
+//
+// At most one sync of the filesystem is in progress at a time. The logs
+// which sync meanwhile wait for it to complete, and the first of them then
+// starts the next sync on behalf of all of them, so that under load the
+// number of syncs is bounded by the sync latency of the device rather than
+// by the number of logs.
+//
+// This class is thread-safe.
+class LogSyncGroup {
+ public:
+  // Returns the group of the logs in 'wals_root', creating it if it's the
+  // first of them. The groups are never destroyed.
+  static LogSyncGroup* Get(Env* env, const std::string& wals_root);
+
+  // Makes the data written to 'segment' durable, returning once a sync of
+  // the filesystem which started after the call is complete.
+  //
+  // If that sync failed, or if the platform can't sync a single filesystem,
+  // syncs 'segment' on its own instead, so that the errors returned are those
+  // of the segment.
+  Status Sync(WritableLogSegment* segment);
+
+  // The number of syncs of the filesystem which were started.
+  int64_t num_syncs() const;
+
+ private:
+  LogSyncGroup(Env* env, std::string wals_root);
+
+  Env* const env_;
+  const std::string wals_root_;
+
+  mutable Mutex lock_;
+  ConditionVariable cond_;
+
+  // Whether a sync of the filesystem is in progress.
+  bool sync_in_progress_;
+
+  // The number of syncs of the filesystem which were started and finished,
+  // which are also the ids of the last ones, and the id of the last sync
+  // which failed, or 0.
+  int64_t syncs_started_;
+  int64_t syncs_finished_;
+  int64_t last_failed_sync_;
+
+  // Set once syncing the filesystem isn't supported on this platform.
+  bool sync_not_supported_;
+
+  DISALLOW_COPY_AND_ASSIGN(LogSyncGroup);
+};
+
+} // namespace log
+} // namespace kudu
@@ -54,6 +54,15 @@ DEFINE_bool(log_force_fsync_all, false,
             "Whether the Log/WAL should explicitly call fsync() after each write.");
 TAG_FLAG(log_force_fsync_all, stable);
 
+DEFINE_bool(log_group_fsync, false,
+            "Whether the Log/WAL fsyncs of the tablets whose WALs are on the same "
+            "filesystem are group-committed into syncs of the whole filesystem. This "
+            "reduces the number of fsyncs when many tablets are written to with "
+            "--log_force_fsync_all, but the filesystem syncs also flush the other files "
+            "of the filesystem, so this should only be used with a dedicated WAL "
+            "filesystem. Only supported on Linux.");
+TAG_FLAG(log_group_fsync, experimental);
+
 DEFINE_bool(log_preallocate_segments, true,
             "Whether the WAL should preallocate the entire segment before writing to it");
 TAG_FLAG(log_preallocate_segments, advanced);
@@ -62,6 +71,24 @@ DEFINE_bool(log_async_preallocate_segments, true,
             "Whether the WAL segments preallocation should happen asynchronously");
 TAG_FLAG(log_async_preallocate_segments, advanced);
 
+DEFINE_int32(log_compression_min_batch_bytes, 256,
+             "In the WAL segments which may store uncompressed entries (see "
+             "--log_compression_adaptive), the minimum size of the entry batches "
+             "to compress. Smaller batches are written uncompressed.");
+TAG_FLAG(log_compression_min_batch_bytes, experimental);
+TAG_FLAG(log_compression_min_batch_bytes, runtime);
+
+DEFINE_double(log_compression_max_ratio, 0.9,
+              "In the WAL segments which may store uncompressed entries (see "
+              "--log_compression_adaptive), the maximum ratio of the compressed "
+              "to the uncompressed size of an entry batch for it to be written "
+              "compressed. Batches which compress worse are written uncompressed.");
+TAG_FLAG(log_compression_max_ratio, experimental);
+TAG_FLAG(log_compression_max_ratio, runtime);
+DEFINE_validator(log_compression_max_ratio, [](const char* /*n*/, double v) {
+  return v > 0 && v <= 1;
+});
+
 DEFINE_double(fault_crash_before_write_log_segment_header, 0.0,
               "Fraction of the time we will crash just before writing the log segment header");
 TAG_FLAG(fault_crash_before_write_log_segment_header, unsafe);
@@ -101,6 +128,7 @@ const uint32_t kLogSegmentMaxHeaderOrFooterSize = 8 * 1024 * 1024;
 LogOptions::LogOptions()
 : segment_size_mb(FLAGS_log_segment_size_mb),
   force_fsync_all(FLAGS_log_force_fsync_all),
+  group_fsync(FLAGS_log_group_fsync),
   preallocate_segments(FLAGS_log_preallocate_segments),
   async_preallocate_segments(FLAGS_log_async_preallocate_segments) {
 }
@@ -270,6 +298,17 @@ Status ReadableLogSegment::Open(Env* env,
   return Status::OK();
 }
 
+namespace {
+
+// Returns whether 'header' lists 'feature' in its incompatible features.
+bool HasFeature(const LogSegmentHeaderPB& header, LogSegmentHeaderPB::FeatureFlag feature) {
+  return std::find(header.incompatible_features().begin(),
+                   header.incompatible_features().end(),
+                   feature) != header.incompatible_features().end();
+}
+
+} // anonymous namespace
+
 ReadableLogSegment::ReadableLogSegment(
     std::string path, shared_ptr<RandomAccessFile> readable_file)
     : path_(std::move(path)),
@@ -277,6 +316,7 @@ ReadableLogSegment::ReadableLogSegment(
       readable_to_offset_(0),
       readable_file_(std::move(readable_file)),
       codec_(nullptr),
+      has_uncompressed_entries_(false),
       is_initialized_(false),
       footer_was_rebuilt_(false) {}
 
@@ -351,6 +391,7 @@ Status ReadableLogSegment::InitCompressionCodec() {
     RETURN_NOT_OK_PREPEND(GetCompressionCodec(header_.compression_codec(), &codec_),
                           "could not init compression codec");
   }
+  has_uncompressed_entries_ = HasFeature(header_, LogSegmentHeaderPB::UNCOMPRESSED_ENTRIES);
   return Status::OK();
 }
 
@@ -436,9 +477,11 @@ Status ReadableLogSegment::ReadHeader() {
                                                 header_size),
                         "Unable to parse protobuf");
 
-  if (header.incompatible_features_size() > 0) {
-    return Status::NotSupported("log segment uses a feature not supported by this version "
-                                "of Kudu");
+  for (int32_t feature : header.incompatible_features()) {
+    if (feature != LogSegmentHeaderPB::UNCOMPRESSED_ENTRIES) {
+      return Status::NotSupported("log segment uses a feature not supported by this version "
+                                  "of Kudu");
+    }
   }
 
   header_.Swap(&header);
@@ -707,9 +750,14 @@ Status ReadableLogSegment::ReadEntryBatch(int64_t* offset,
                    header.msg_length_compressed, *offset, path_, limit));
   }
 
+  // In the segments with the UNCOMPRESSED_ENTRIES feature, the entries which
+  // weren't compressed have the same compressed and uncompressed lengths.
+  const bool compressed = codec_ &&
+      !(has_uncompressed_entries_ && header.msg_length_compressed == header.msg_length);
+
   tmp_buf->clear();
   size_t buf_len = header.msg_length_compressed;
-  if (codec_) {
+  if (compressed) {
     // Reserve some space for the decompressed copy as well.
     buf_len += header.msg_length;
   }
@@ -730,7 +778,7 @@ Status ReadableLogSegment::ReadEntryBatch(int64_t* offset,
   }
 
   // If it was compressed, decompress it.
-  if (codec_) {
+  if (compressed) {
     // We pre-reserved space for the decompression up above.
     uint8_t* uncompress_buf = &(*tmp_buf)[header.msg_length_compressed];
     RETURN_NOT_OK_PREPEND(codec_->Uncompress(entry_batch_slice, uncompress_buf, header.msg_length),
@@ -758,6 +806,7 @@ WritableLogSegment::WritableLogSegment(string path,
       writable_file_(std::move(writable_file)),
       is_header_written_(false),
       is_footer_written_(false),
+      has_uncompressed_entries_(false),
       written_offset_(0) {}
 
 Status WritableLogSegment::WriteHeaderAndOpen(const LogSegmentHeaderPB& new_header) {
@@ -777,6 +826,7 @@ Status WritableLogSegment::WriteHeaderAndOpen(const LogSegmentHeaderPB& new_head
   RETURN_NOT_OK(writable_file()->Append(Slice(buf)));
 
   header_.CopyFrom(new_header);
+  has_uncompressed_entries_ = HasFeature(header_, LogSegmentHeaderPB::UNCOMPRESSED_ENTRIES);
   first_entry_offset_ = buf.size();
   written_offset_ = first_entry_offset_;
   is_header_written_ = true;
@@ -817,16 +867,22 @@ Status WritableLogSegment::WriteEntryBatch(const Slice& data,
   const uint32_t uncompressed_len = data.size();
 
   // If necessary, compress the data.
-  Slice data_to_write;
-  if (codec) {
+  Slice data_to_write = data;
+  if (codec && (!has_uncompressed_entries_ ||
+                static_cast<int64_t>(uncompressed_len) >= FLAGS_log_compression_min_batch_bytes)) {
     DCHECK_NE(header_.compression_codec(), NO_COMPRESSION);
     compress_buf_.resize(codec->MaxCompressedLength(uncompressed_len));
     size_t compressed_len;
     RETURN_NOT_OK(codec->Compress(data, &compress_buf_[0], &compressed_len));
     compress_buf_.resize(compressed_len);
-    data_to_write = Slice(compress_buf_.data(), compress_buf_.size());
-  } else {
-    data_to_write = data;
+    // Keep the batch uncompressed if it doesn't compress well enough. The
+    // compressed batch must be strictly smaller than the uncompressed one for
+    // the reader to tell them apart.
+    if (!has_uncompressed_entries_ ||
+        (compressed_len < uncompressed_len &&
+         compressed_len <= uncompressed_len * FLAGS_log_compression_max_ratio)) {
+      data_to_write = Slice(compress_buf_.data(), compress_buf_.size());
+    }
   }
 
   // Fill in the header.
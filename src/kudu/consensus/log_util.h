@@ -67,6 +67,10 @@ struct LogOptions {
   // Whether to call fsync on every call to Append().
   bool force_fsync_all;
 
+  // Whether the fsyncs are group-committed with those of the other logs on the
+  // same filesystem. See LogSyncGroup.
+  bool group_fsync;
+
   // Whether to fallocate segments before writing to them.
   bool preallocate_segments;
 
@@ -387,6 +391,11 @@ class ReadableLogSegment : public RefCountedThreadSafe<ReadableLogSegment> {
   // Compression codec used to decompress entries in this file.
   const CompressionCodec* codec_;
 
+  // Whether the segment has the UNCOMPRESSED_ENTRIES feature, i.e. whether
+  // the entries with equal compressed and uncompressed lengths are stored
+  // uncompressed.
+  bool has_uncompressed_entries_;
+
   bool is_initialized_;
 
   LogSegmentHeaderPB header_;
@@ -427,6 +436,10 @@ class WritableLogSegment {
   // and checksum. If 'codec' is not NULL, compresses the batch.
   // Makes sure that the log segment has not been closed.
   // Write a compressed entry to the log.
+  //
+  // If the segment header has the UNCOMPRESSED_ENTRIES feature, the batch is
+  // written uncompressed when it is smaller than --log_compression_min_batch_bytes
+  // or doesn't compress to less than --log_compression_max_ratio of its size.
   Status WriteEntryBatch(const Slice& data, const CompressionCodec* codec);
 
   // Makes sure the I/O buffers in the underlying writable file are flushed.
@@ -482,6 +495,9 @@ class WritableLogSegment {
 
   bool is_footer_written_;
 
+  // Whether the header has the UNCOMPRESSED_ENTRIES feature.
+  bool has_uncompressed_entries_;
+
   LogSegmentHeaderPB header_;
 
   LogSegmentFooterPB footer_;
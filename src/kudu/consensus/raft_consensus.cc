@@ -139,6 +139,26 @@ DEFINE_bool(raft_attempt_to_replace_replica_without_majority, false,
             "Warning! This is only intended for testing.");
 TAG_FLAG(raft_attempt_to_replace_replica_without_majority, unsafe);
 
+DEFINE_bool(raft_enable_leader_leases, false,
+            "Whether a leader holds a lease while a majority of the voters accepted "
+            "one of its requests within a fraction of the minimum election timeout. "
+            "A leader holding a lease serves snapshot scans which don't specify a "
+            "timestamp at its latest committed timestamp, without waiting for the "
+            "in-flight operations.");
+TAG_FLAG(raft_enable_leader_leases, experimental);
+TAG_FLAG(raft_enable_leader_leases, runtime);
+
+DEFINE_double(raft_leader_lease_fraction, 0.8,
+              "The fraction of the minimum election timeout, counted from the time "
+              "at which a majority of the voters accepted a request from the leader, "
+              "for which the leader holds its lease. The remainder accounts for the "
+              "drift between the clock rates of the servers.");
+TAG_FLAG(raft_leader_lease_fraction, experimental);
+TAG_FLAG(raft_leader_lease_fraction, runtime);
+DEFINE_validator(raft_leader_lease_fraction, [](const char* /*n*/, double v) {
+  return v > 0 && v < 1;
+});
+
 DECLARE_int32(memory_limit_warn_threshold_percentage);
 
 // Metrics
@@ -194,6 +214,7 @@ RaftConsensus::RaftConsensus(
       rng_(GetRandomSeed32()),
       leader_transfer_in_progress_(false),
       withhold_votes_until_(MonoTime::Min()),
+      safe_time_request_in_flight_(false),
       last_received_cur_leader_(MinimumOpId()),
       failed_elections_since_stable_leader_(0),
       shutdown_(false),
@@ -684,6 +705,7 @@ Status RaftConsensus::BecomeLeaderUnlocked() {
   replicate->set_op_type(NO_OP);
   replicate->mutable_noop_request(); // Define the no-op request field.
   CHECK_OK(time_manager_->AssignTimestamp(replicate));
+  leader_term_start_timestamp_ = Timestamp(replicate->timestamp());
 
   scoped_refptr<ConsensusRound> round(
       new ConsensusRound(this, make_scoped_refptr(new RefCountedReplicate(replicate))));
@@ -732,8 +754,6 @@ Status RaftConsensus::Replicate(const scoped_refptr<ConsensusRound>& round) {
     RETURN_NOT_OK(round->CheckBoundTerm(CurrentTermUnlocked()));
     RETURN_NOT_OK(AppendNewRoundToQueueUnlocked(round));
   }
-
-  peer_manager_->SignalRequest();
   return Status::OK();
 }
 
@@ -753,7 +773,11 @@ Status RaftConsensus::AppendNewRoundToQueueUnlocked(const scoped_refptr<Consensu
 
   // The only reasons for a bad status would be if the log itself were shut down,
   // or if we had an actual IO error, which we currently don't handle.
-  CHECK_OK_PREPEND(queue_->AppendOperation(round->replicate_scoped_refptr()),
+  //
+  // The peers are signaled as soon as the operation may be sent to them, so
+  // that it's replicated while it is written to the local log.
+  CHECK_OK_PREPEND(queue_->AppendOperation(round->replicate_scoped_refptr(),
+                                           [this]() { peer_manager_->SignalRequest(); }),
                    Substitute("$0: could not append to queue", LogPrefixUnlocked()));
   return Status::OK();
 }
@@ -1521,10 +1545,9 @@ Status RaftConsensus::UpdateReplica(const ConsensusRequestPB* request,
     }
 
     // All transactions that are going to be prepared were started, advance the safe timestamp.
-    // TODO(dralves) This is only correct because the queue only sets safe time when the request is
-    // an empty heartbeat. If we actually start setting this on a consensus request along with
-    // actual messages we need to be careful to ignore it if any of the messages fails to prepare.
-    if (request->has_safe_timestamp()) {
+    // The leader sets the safe time on requests which carry messages too, so it's ignored if
+    // any of them failed to prepare: the leader will send them again.
+    if (request->has_safe_timestamp() && prepare_status.ok()) {
       time_manager_->AdvanceSafeTime(Timestamp(request->safe_timestamp()));
     }
 
@@ -2356,6 +2379,110 @@ RaftPeerPB::Role RaftConsensus::role() const {
   return cmeta_->active_role();
 }
 
+bool RaftConsensus::HasLeaderLease(Timestamp* term_start_timestamp) const {
+  if (!FLAGS_raft_enable_leader_leases) {
+    return false;
+  }
+  {
+    ThreadRestrictions::AssertWaitAllowed();
+    LockGuard l(lock_);
+    if (state_ != kRunning || cmeta_->active_role() != RaftPeerPB::LEADER) {
+      return false;
+    }
+    *term_start_timestamp = leader_term_start_timestamp_;
+  }
+  // A leadership transfer makes a follower start an election which ignores
+  // the live leader.
+  if (leader_transfer_in_progress_.Load() || !queue_->IsCommittedIndexInCurrentTerm()) {
+    return false;
+  }
+  MonoTime lease_start = queue_->GetLeaderLeaseStartTime();
+  if (lease_start == MonoTime::Min()) {
+    return false;
+  }
+  // The local peer is a majority by itself in a single voter configuration.
+  if (lease_start == MonoTime::Max()) {
+    return true;
+  }
+  MonoDelta lease_duration = MonoDelta::FromNanoseconds(static_cast<int64_t>(
+      MinimumElectionTimeout().ToNanoseconds() * FLAGS_raft_leader_lease_fraction));
+  return MonoTime::Now() < lease_start + lease_duration;
+}
+
+Status RaftConsensus::SendSafeTimeToPeers() {
+  {
+    ThreadRestrictions::AssertWaitAllowed();
+    LockGuard l(lock_);
+    RETURN_NOT_OK(CheckRunningUnlocked());
+    RETURN_NOT_OK(CheckActiveLeaderUnlocked());
+  }
+  peer_manager_->SignalRequest(true);
+  return Status::OK();
+}
+
+void RaftConsensus::RequestSafeTimeFromLeader() {
+  RaftPeerPB leader_pb;
+  {
+    ThreadRestrictions::AssertWaitAllowed();
+    LockGuard l(lock_);
+    if (state_ != kRunning || cmeta_->active_role() == RaftPeerPB::LEADER ||
+        cmeta_->leader_uuid().empty()) {
+      return;
+    }
+    RaftConfigPB config = cmeta_->ActiveConfig();
+    RaftPeerPB* peer_pb;
+    if (!GetRaftConfigMember(&config, cmeta_->leader_uuid(), &peer_pb).ok()) {
+      return;
+    }
+    leader_pb = *peer_pb;
+  }
+  if (!safe_time_request_in_flight_.CompareAndSet(false, true)) {
+    return;
+  }
+
+  // Creating the proxy may resolve the leader's address, so it's done on the
+  // raft pool rather than on the scan's thread.
+  weak_ptr<RaftConsensus> w = shared_from_this();
+  Status s = raft_pool_token_->SubmitFunc([w, leader_pb]() {
+    auto self = w.lock();
+    if (!self) return;
+    struct SafeTimeCall {
+      gscoped_ptr<PeerProxy> proxy;
+      SendSafeTimeRequestPB req;
+      SendSafeTimeResponsePB resp;
+      rpc::RpcController controller;
+    };
+    auto call = std::make_shared<SafeTimeCall>();
+    Status s = self->peer_proxy_factory_->NewProxy(leader_pb, &call->proxy);
+    if (PREDICT_FALSE(!s.ok())) {
+      KLOG_EVERY_N_SECS(WARNING, 60) << self->LogPrefixThreadSafe()
+          << "Unable to create a proxy to the leader: " << s.ToString() << THROTTLE_MSG;
+      self->safe_time_request_in_flight_.Store(false);
+      return;
+    }
+    call->req.set_dest_uuid(leader_pb.permanent_uuid());
+    call->req.set_tablet_id(self->options_.tablet_id);
+    call->req.set_caller_uuid(self->peer_uuid());
+    PeerProxy* proxy = call->proxy.get();
+    proxy->SendSafeTimeAsync(&call->req, &call->resp, &call->controller, [w, call]() {
+      if (auto self = w.lock()) {
+        Status s = call->controller.status();
+        if (s.ok() && call->resp.has_error()) {
+          s = StatusFromPB(call->resp.error().status());
+        }
+        if (!s.ok()) {
+          VLOG(1) << self->LogPrefixThreadSafe()
+                  << "Unable to request the safe time from the leader: " << s.ToString();
+        }
+        self->safe_time_request_in_flight_.Store(false);
+      }
+    });
+  });
+  if (PREDICT_FALSE(!s.ok())) {
+    safe_time_request_in_flight_.Store(false);
+  }
+}
+
 int64_t RaftConsensus::CurrentTerm() const {
   LockGuard l(lock_);
   return CurrentTermUnlocked();
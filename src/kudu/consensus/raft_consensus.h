@@ -30,6 +30,7 @@
 #include <glog/logging.h>
 #include <gtest/gtest_prod.h>
 
+#include "kudu/common/timestamp.h"
 #include "kudu/consensus/consensus.pb.h"
 #include "kudu/consensus/consensus_meta.h"  // IWYU pragma: keep
 #include "kudu/consensus/consensus_queue.h"
@@ -310,6 +311,29 @@ class RaftConsensus : public std::enable_shared_from_this<RaftConsensus>,
   // Returns the current term.
   int64_t CurrentTerm() const;
 
+  // Returns true if leader leases are enabled and this replica is the leader
+  // and holds a lease: it committed an operation in its current term and a
+  // majority of the voters accepted a request it sent recently enough that
+  // none of them may have voted for another candidate since. While the lease
+  // is held no other replica can be elected, so the operations this replica
+  // committed are all the operations committed in the tablet.
+  //
+  // If so, sets 'term_start_timestamp' to the timestamp of the NO_OP which
+  // started the leader's term: the operations committed by the previous
+  // leaders have lower timestamps.
+  bool HasLeaderLease(Timestamp* term_start_timestamp) const;
+
+  // Makes the leader send a request carrying its safe time to each of the
+  // peers, rather than waiting for the next heartbeats.
+  // Returns IllegalState if this replica isn't the leader.
+  Status SendSafeTimeToPeers();
+
+  // Asks the leader, if there is one, to send its safe time, so that a
+  // snapshot scan waiting for the safe time of this follower doesn't have to
+  // wait for the next heartbeat. Does nothing if this replica is the leader
+  // or if such a request is already in flight.
+  void RequestSafeTimeFromLeader();
+
   // Returns the uuid of this peer.
   // Thread-safe.
   const std::string& peer_uuid() const;
@@ -874,6 +898,13 @@ class RaftConsensus : public std::enable_shared_from_this<RaftConsensus>,
   // nodes from disturbing the healthy leader.
   MonoTime withhold_votes_until_;
 
+  // The timestamp of the NO_OP replicated at the start of the current term,
+  // if this replica is the leader.
+  Timestamp leader_term_start_timestamp_;
+
+  // Whether a SendSafeTime() request to the leader is in flight.
+  AtomicBool safe_time_request_in_flight_;
+
   // The last OpId received from the current leader. This is updated whenever the follower
   // accepts operations from a leader, and passed back so that the leader knows from what
   // point to continue sending operations.
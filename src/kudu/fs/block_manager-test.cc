@@ -34,6 +34,7 @@
 
 #include "kudu/fs/block_id.h"
 #include "kudu/fs/block_manager.h"
+#include "kudu/fs/block_manager_util.h"
 #include "kudu/fs/data_dirs.h"
 #include "kudu/fs/error_manager.h"
 #include "kudu/fs/file_block_manager.h"
@@ -87,9 +88,16 @@ METRIC_DECLARE_counter(block_manager_total_writable_blocks);
 METRIC_DECLARE_counter(block_manager_total_readable_blocks);
 METRIC_DECLARE_counter(block_manager_total_bytes_written);
 METRIC_DECLARE_counter(block_manager_total_bytes_read);
+METRIC_DECLARE_counter(block_manager_total_read_ops);
+METRIC_DECLARE_histogram(block_manager_read_latency);
 
 // Data directory metrics.
 METRIC_DECLARE_gauge_uint64(data_dirs_full);
+METRIC_DECLARE_entity(data_directory);
+METRIC_DECLARE_counter(data_dir_bytes_read);
+METRIC_DECLARE_counter(data_dir_read_ops);
+METRIC_DECLARE_counter(data_dir_bytes_written);
+METRIC_DECLARE_histogram(data_dir_read_latency);
 
 // The LogBlockManager is only supported on Linux, since it requires hole punching.
 #define RETURN_NOT_LOG_BLOCK_MANAGER() \
@@ -162,12 +170,14 @@ class BlockManagerTest : public KuduTest {
                             const shared_ptr<MemTracker>& parent_mem_tracker,
                             const vector<string>& paths,
                             bool create,
-                            bool load_test_group = true) {
+                            bool load_test_group = true,
+                            MetricRegistry* metric_registry = nullptr) {
     // The directory manager must outlive the block manager. Destroy the block
     // manager first to enforce this.
     bm_.reset();
     DataDirManagerOptions opts;
     opts.metric_entity = metric_entity;
+    opts.metric_registry = metric_registry;
     if (create) {
       RETURN_NOT_OK(DataDirManager::CreateNewForTests(
           env_, paths, std::move(opts), &dd_manager_));
@@ -812,6 +822,52 @@ TYPED_TEST(BlockManagerTest, MetricsTest) {
   }
 }
 
+TYPED_TEST(BlockManagerTest, IOMetricsTest) {
+  const string kTestData = "test data";
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity = METRIC_ENTITY_server.Instantiate(&registry, "test");
+  ASSERT_OK(this->ReopenBlockManager(entity,
+                                     shared_ptr<MemTracker>(),
+                                     { this->test_dir_ },
+                                     false /* create */,
+                                     true /* load_test_group */,
+                                     &registry));
+
+  unique_ptr<WritableBlock> writer;
+  ASSERT_OK(this->bm_->CreateBlock(this->test_block_opts_, &writer));
+  ASSERT_OK(writer->Append(kTestData));
+  ASSERT_OK(writer->Close());
+
+  unique_ptr<ReadableBlock> reader;
+  ASSERT_OK(this->bm_->OpenBlock(writer->id(), &reader));
+  string result(kTestData.size(), '\0');
+  const int kNumReads = 3;
+  for (int i = 0; i < kNumReads; i++) {
+    ASSERT_OK(reader->Read(0, Slice(&result[0], result.size())));
+  }
+  ASSERT_OK(reader->Close());
+
+  // The reads are counted server-wide...
+  ASSERT_EQ(kNumReads, down_cast<Counter*>(
+      entity->FindOrNull(METRIC_block_manager_total_read_ops).get())->value());
+  ASSERT_EQ(kNumReads, down_cast<Histogram*>(
+      entity->FindOrNull(METRIC_block_manager_read_latency).get())->TotalCount());
+
+  // ...and against the entity of the only data directory.
+  ASSERT_EQ(1, this->dd_manager_->data_dirs().size());
+  const auto& dd = this->dd_manager_->data_dirs()[0];
+  scoped_refptr<MetricEntity> dir_entity = METRIC_ENTITY_data_directory.Instantiate(
+      &registry, dd->instance()->metadata()->path_set().uuid());
+  ASSERT_EQ(kNumReads * static_cast<int64_t>(kTestData.size()), down_cast<Counter*>(
+      dir_entity->FindOrNull(METRIC_data_dir_bytes_read).get())->value());
+  ASSERT_EQ(kNumReads, down_cast<Counter*>(
+      dir_entity->FindOrNull(METRIC_data_dir_read_ops).get())->value());
+  ASSERT_EQ(kNumReads, down_cast<Histogram*>(
+      dir_entity->FindOrNull(METRIC_data_dir_read_latency).get())->TotalCount());
+  ASSERT_EQ(static_cast<int64_t>(kTestData.size()), down_cast<Counter*>(
+      dir_entity->FindOrNull(METRIC_data_dir_bytes_written).get())->value());
+}
+
 TYPED_TEST(BlockManagerTest, MemTrackerTest) {
   ASSERT_NO_FATAL_FAILURE(this->RunMemTrackerTest());
 }
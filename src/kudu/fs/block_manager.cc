@@ -74,6 +74,16 @@ using strings::Substitute;
 namespace kudu {
 namespace fs {
 
+const char* StorageTierToString(StorageTier tier) {
+  switch (tier) {
+    case StorageTier::DEFAULT: return "default";
+    case StorageTier::FAST: return "fast";
+    case StorageTier::SLOW: return "slow";
+  }
+  LOG(FATAL) << "unknown storage tier: " << static_cast<int>(tier);
+  return nullptr;
+}
+
 BlockManagerOptions::BlockManagerOptions()
   : read_only(false) {}
 
@@ -31,6 +31,8 @@ namespace kudu {
 
 class BlockId;
 class Env;
+class MaintenanceManager;
+class MappedRegion;
 class MemTracker;
 class Slice;
 
@@ -165,16 +167,47 @@ class ReadableBlock : public Block {
   // If an error was encountered, returns a non-OK status.
   virtual Status ReadV(uint64_t offset, ArrayView<Slice> results) const = 0;
 
+  // Hints that the 'length' bytes beginning from 'offset' in the block will
+  // be read soon, so that they may be read from disk in the background.
+  // The range is clamped to the end of the block.
+  virtual Status Readahead(uint64_t offset, size_t length) const = 0;
+
+  // Maps the block into memory for reading, setting 'region' to the mapping
+  // of its bytes. The mapping must not be read once the block is closed,
+  // since the block's space may then be reclaimed if it's deleted.
+  virtual Status MapForRead(std::unique_ptr<MappedRegion>* region) const = 0;
+
   // Returns the memory usage of this object including the object itself.
   virtual size_t memory_footprint() const = 0;
 };
 
+// The storage tier of a data directory, as configured by
+// --fs_fast_data_dirs, or the tier on which a block is preferably placed.
+enum class StorageTier : uint8_t {
+  // No tier: the data directories aren't tiered, or the block may be placed
+  // in any directory. Must remain the first value, so that options which
+  // don't specify a tier default to it.
+  DEFAULT,
+
+  // Fast storage, e.g. SSDs.
+  FAST,
+
+  // Slow storage, e.g. HDDs.
+  SLOW,
+};
+
+const char* StorageTierToString(StorageTier tier);
+
 // Provides options and hints for block placement. This is used for identifying
-// the correct DataDirGroups to place blocks. In the future this may also be
-// used to specify directories based on block type (e.g. to prefer bloom block
-// placement into SSD-backed directories).
+// the correct DataDirGroups to place blocks, and within them the directories
+// of the preferred storage tier, if any.
 struct CreateBlockOptions {
   const std::string tablet_id;
+
+  // The storage tier on which the block is preferably placed. If the tablet's
+  // group has no directory of that tier with free space, the block is placed
+  // in any of the group's directories.
+  StorageTier tier;
 };
 
 // Block manager creation options.
@@ -271,6 +304,11 @@ class BlockManager {
 
   // Exposes the FsErrorManager used to handle fs errors.
   virtual FsErrorManager* error_manager() = 0;
+
+  // Registers the background operations that this block manager needs, if
+  // any, with 'maintenance_manager'. They are unregistered when the block
+  // manager is destroyed.
+  virtual void RegisterMaintenanceOps(MaintenanceManager* /*maintenance_manager*/) {}
 };
 
 // Group a set of block creations together in a transaction. This has two
@@ -64,6 +64,30 @@ METRIC_DEFINE_counter(server, block_manager_total_disk_sync,
                       kudu::MetricUnit::kBlocks,
                       "Number of disk synchronizations of block data since service start");
 
+METRIC_DEFINE_counter(server, block_manager_total_read_ops,
+                      "Block Data Reads",
+                      kudu::MetricUnit::kOperations,
+                      "Number of reads of block data since service start");
+
+METRIC_DEFINE_histogram(server, block_manager_read_latency,
+                        "Block Data Read Latency",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Time spent reading block data",
+                        60000000LU, 2);
+
+METRIC_DEFINE_histogram(server, block_manager_finalize_latency,
+                        "Block Finalize Latency",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Time spent finalizing data blocks written to, including "
+                        "the flush of their data, if any",
+                        60000000LU, 2);
+
+METRIC_DEFINE_histogram(server, block_manager_sync_latency,
+                        "Block Data Disk Synchronization Latency",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Time spent in disk synchronizations of block data",
+                        60000000LU, 2);
+
 namespace kudu {
 namespace fs {
 namespace internal {
@@ -79,7 +103,11 @@ BlockManagerMetrics::BlockManagerMetrics(const scoped_refptr<MetricEntity>& enti
     MINIT(total_blocks_deleted),
     MINIT(total_bytes_read),
     MINIT(total_bytes_written),
-    MINIT(total_disk_sync) {
+    MINIT(total_disk_sync),
+    MINIT(total_read_ops),
+    MINIT(read_latency),
+    MINIT(finalize_latency),
+    MINIT(sync_latency) {
 }
 #undef GINIT
 #undef MINIT
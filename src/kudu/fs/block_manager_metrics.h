@@ -39,6 +39,11 @@ struct BlockManagerMetrics {
   scoped_refptr<Counter> total_bytes_read;
   scoped_refptr<Counter> total_bytes_written;
   scoped_refptr<Counter> total_disk_sync;
+  scoped_refptr<Counter> total_read_ops;
+
+  scoped_refptr<Histogram> read_latency;
+  scoped_refptr<Histogram> finalize_latency;
+  scoped_refptr<Histogram> sync_latency;
 };
 
 } // namespace internal
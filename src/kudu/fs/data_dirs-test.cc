@@ -40,6 +40,7 @@
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/path_util.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
@@ -53,11 +54,16 @@ using strings::Substitute;
 
 DECLARE_bool(crash_on_eio);
 DECLARE_double(env_inject_eio);
+DECLARE_int32(fs_data_dir_write_rate_limit_read_latency_ms);
 DECLARE_int32(fs_data_dirs_full_disk_cache_seconds);
 DECLARE_int32(fs_target_data_dirs_per_tablet);
 DECLARE_int64(disk_reserved_bytes_free_for_testing);
+DECLARE_int64(disk_reserved_override_prefix_1_bytes_free_for_testing);
+DECLARE_int64(fs_data_dir_write_rate_limit_bytes_per_sec);
 DECLARE_int64(fs_data_dirs_reserved_bytes);
+DECLARE_string(disk_reserved_override_prefix_1_path_for_testing);
 DECLARE_string(env_inject_eio_globs);
+DECLARE_string(fs_fast_data_dirs);
 
 METRIC_DECLARE_gauge_uint64(data_dirs_failed);
 
@@ -441,5 +447,92 @@ TEST_F(TooManyDataDirManagerTest, TestTooManyInternedStrings) {
       DataDirManagerOptions(), &dd_manager_));
 }
 
+// Test that the writes to a data dir are limited, and that slow reads lower
+// the limit until they're fast again.
+TEST_F(DataDirsTest, TestWriteRateLimit) {
+  DataDir* dd = dd_manager_->data_dirs()[0].get();
+  ASSERT_EQ(0, dd->write_rate_limit());
+
+  const int64_t kRate = 1024 * 1024;
+  FLAGS_fs_data_dir_write_rate_limit_bytes_per_sec = kRate;
+  FLAGS_fs_data_dir_write_rate_limit_read_latency_ms = 10;
+  MonoTime start = MonoTime::Now();
+  dd->ThrottleWrite(kRate / 10);
+  dd->ThrottleWrite(kRate / 5);
+  ASSERT_GE(MonoTime::Now() - start, MonoDelta::FromMilliseconds(150));
+  ASSERT_EQ(kRate, dd->write_rate_limit());
+
+  // The limit is adjusted at most once per second.
+  SleepFor(MonoDelta::FromMilliseconds(1100));
+  dd->RecordReadLatency(MonoDelta::FromMilliseconds(100));
+  dd->ThrottleWrite(1);
+  ASSERT_EQ(kRate / 2, dd->write_rate_limit());
+
+  SleepFor(MonoDelta::FromMilliseconds(1100));
+  dd->RecordReadLatency(MonoDelta::FromMilliseconds(1));
+  dd->ThrottleWrite(1);
+  ASSERT_EQ(kRate / 2 + kRate / 10, dd->write_rate_limit());
+
+  FLAGS_fs_data_dir_write_rate_limit_bytes_per_sec = 0;
+  ASSERT_EQ(0, dd->write_rate_limit());
+}
+
+// Test that the data dirs of --fs_fast_data_dirs are on the fast tier, that
+// the groups include one of them, and that blocks go to the requested tier.
+TEST_F(DataDirsTest, TestStorageTiers) {
+  for (const auto& dd : dd_manager_->data_dirs()) {
+    ASSERT_EQ(StorageTier::DEFAULT, dd->tier());
+  }
+  const vector<string> dirs = GetDirNames(kNumDirs);
+  FLAGS_fs_fast_data_dirs = dirs[0];
+  dd_manager_.reset();
+  ASSERT_OK(DataDirManager::OpenExistingForTests(env_, dirs, DataDirManagerOptions(),
+                                                 &dd_manager_));
+  int num_fast = 0;
+  for (const auto& dd : dd_manager_->data_dirs()) {
+    ASSERT_NE(StorageTier::DEFAULT, dd->tier());
+    if (dd->tier() == StorageTier::FAST) {
+      num_fast++;
+    }
+  }
+  ASSERT_EQ(1, num_fast);
+
+  // Each group includes the fast dir, and a slow one.
+  FLAGS_fs_target_data_dirs_per_tablet = 2;
+  for (int i = 0; i < 20; i++) {
+    const string tablet_id = Substitute("tablet-$0", i);
+    ASSERT_OK(dd_manager_->CreateDataDirGroup(tablet_id));
+    for (StorageTier tier : { StorageTier::FAST, StorageTier::SLOW }) {
+      DataDir* dd;
+      ASSERT_OK(dd_manager_->GetNextDataDir(CreateBlockOptions({ tablet_id, tier }), &dd));
+      ASSERT_EQ(tier, dd->tier());
+    }
+  }
+
+  // Once the fast dir is full, blocks fall back to the slow dirs.
+  FLAGS_fs_data_dirs_full_disk_cache_seconds = 0;
+  FLAGS_fs_data_dirs_reserved_bytes = 1;
+  FLAGS_disk_reserved_override_prefix_1_path_for_testing = dirs[0];
+  FLAGS_disk_reserved_override_prefix_1_bytes_free_for_testing = 0;
+  for (const auto& dd : dd_manager_->data_dirs()) {
+    if (dd->tier() == StorageTier::FAST) {
+      ASSERT_OK(dd->RefreshIsFull(DataDir::RefreshMode::ALWAYS));
+      ASSERT_TRUE(dd->is_full());
+    }
+  }
+  DataDir* dd;
+  ASSERT_OK(dd_manager_->GetNextDataDir(
+      CreateBlockOptions({ "tablet-0", StorageTier::FAST }), &dd));
+  ASSERT_EQ(StorageTier::SLOW, dd->tier());
+
+  // The fast dirs must be data dirs.
+  FLAGS_fs_fast_data_dirs = GetTestPath("not-a-data-dir");
+  dd_manager_.reset();
+  Status s = DataDirManager::OpenExistingForTests(env_, dirs, DataDirManagerOptions(),
+                                                  &dd_manager_);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "not data directories");
+}
+
 } // namespace fs
 } //namespace kudu
@@ -46,6 +46,7 @@
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/join.h"
+#include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
@@ -61,6 +62,7 @@
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/test_util_prod.h"
 #include "kudu/util/threadpool.h"
+#include "kudu/util/trace.h"
 
 DEFINE_int32(fs_target_data_dirs_per_tablet, 3,
              "Indicates the target number of data dirs to spread each "
@@ -91,6 +93,37 @@ DEFINE_int32(fs_data_dirs_full_disk_cache_seconds, 30,
 TAG_FLAG(fs_data_dirs_full_disk_cache_seconds, advanced);
 TAG_FLAG(fs_data_dirs_full_disk_cache_seconds, evolving);
 
+DEFINE_int64(fs_data_dir_write_rate_limit_bytes_per_sec, 0,
+             "Maximum rate in bytes per second of the block writes to each data "
+             "directory, i.e. of the writes of flushes, compactions and tablet "
+             "copies. Limiting it keeps bursts of background writes from "
+             "saturating the disks at the expense of scans. 0 means unlimited.");
+TAG_FLAG(fs_data_dir_write_rate_limit_bytes_per_sec, advanced);
+TAG_FLAG(fs_data_dir_write_rate_limit_bytes_per_sec, experimental);
+TAG_FLAG(fs_data_dir_write_rate_limit_bytes_per_sec, runtime);
+
+DEFINE_int32(fs_data_dir_write_rate_limit_read_latency_ms, 0,
+             "Target average latency of the block reads from a data directory. "
+             "While the reads from a directory are slower than this, its write "
+             "rate limit is lowered, down to a tenth of "
+             "--fs_data_dir_write_rate_limit_bytes_per_sec. 0 disables the "
+             "adjustment of the limit.");
+TAG_FLAG(fs_data_dir_write_rate_limit_read_latency_ms, advanced);
+TAG_FLAG(fs_data_dir_write_rate_limit_read_latency_ms, experimental);
+TAG_FLAG(fs_data_dir_write_rate_limit_read_latency_ms, runtime);
+
+DEFINE_string(fs_fast_data_dirs, "",
+              "Comma-separated list of the directories of --fs_data_dirs which "
+              "are on fast storage, e.g. SSDs. If set, the data directories "
+              "are tiered: the others are considered slow storage, e.g. HDDs, "
+              "each tablet's directory group includes a fast directory when "
+              "possible, and the blocks which are read the most (bloom "
+              "filters, ad-hoc indexes, REDO deltas and newly flushed "
+              "rowsets) are preferably placed on fast directories, while the "
+              "rowsets written by compactions are preferably placed on slow "
+              "directories.");
+TAG_FLAG(fs_fast_data_dirs, experimental);
+
 DEFINE_bool(fs_lock_data_dirs, true,
             "Lock the data directories to prevent concurrent usage. "
             "Note that read-only concurrent usage is still allowed.");
@@ -107,6 +140,35 @@ METRIC_DEFINE_gauge_uint64(server, data_dirs_full,
                            kudu::MetricUnit::kDataDirectories,
                            "Number of data directories whose disks are currently full");
 
+METRIC_DEFINE_entity(data_directory);
+
+METRIC_DEFINE_counter(data_directory, data_dir_bytes_read,
+                      "Block Data Bytes Read",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes of block data read from this data directory "
+                      "since service start");
+METRIC_DEFINE_counter(data_directory, data_dir_read_ops,
+                      "Block Data Reads",
+                      kudu::MetricUnit::kOperations,
+                      "Number of reads of block data from this data directory since "
+                      "service start");
+METRIC_DEFINE_counter(data_directory, data_dir_bytes_written,
+                      "Block Data Bytes Written",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes of block data written to this data directory "
+                      "since service start");
+METRIC_DEFINE_histogram(data_directory, data_dir_read_latency,
+                        "Block Data Read Latency",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Time spent reading block data from this data directory",
+                        60000000LU, 2);
+METRIC_DEFINE_histogram(data_directory, data_dir_sync_latency,
+                        "Block Data Disk Synchronization Latency",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Time spent in disk synchronizations of the block data of this "
+                        "data directory",
+                        60000000LU, 2);
+
 DECLARE_bool(enable_data_block_fsync);
 DECLARE_string(block_manager);
 
@@ -205,24 +267,41 @@ DataDirMetrics::DataDirMetrics(const scoped_refptr<MetricEntity>& entity)
 }
 #undef GINIT
 
+#define MINIT(x) x(METRIC_data_dir_##x.Instantiate(entity))
+DataDirIOMetrics::DataDirIOMetrics(const scoped_refptr<MetricEntity>& entity)
+  : MINIT(bytes_read),
+    MINIT(read_ops),
+    MINIT(bytes_written),
+    MINIT(read_latency),
+    MINIT(sync_latency) {
+}
+#undef MINIT
+
 ////////////////////////////////////////////////////////////
 // DataDir
 ////////////////////////////////////////////////////////////
 
 DataDir::DataDir(Env* env,
                  DataDirMetrics* metrics,
+                 unique_ptr<DataDirIOMetrics> io_metrics,
                  DataDirFsType fs_type,
+                 StorageTier tier,
                  string dir,
                  unique_ptr<PathInstanceMetadataFile> metadata_file,
                  unique_ptr<ThreadPool> pool)
     : env_(env),
       metrics_(metrics),
+      io_metrics_(std::move(io_metrics)),
       fs_type_(fs_type),
+      tier_(tier),
       dir_(std::move(dir)),
       metadata_file_(std::move(metadata_file)),
       pool_(std::move(pool)),
       is_shutdown_(false),
-      is_full_(false) {
+      is_full_(false),
+      write_limiter_(0, MonoDelta::FromMilliseconds(100)),
+      read_latency_sum_us_(0),
+      num_reads_(0) {
 }
 
 DataDir::~DataDir() {
@@ -252,6 +331,80 @@ void DataDir::WaitOnClosures() {
   pool_->Wait();
 }
 
+void DataDir::ThrottleWrite(size_t bytes) {
+  if (FLAGS_fs_data_dir_write_rate_limit_bytes_per_sec <= 0) {
+    return;
+  }
+  MaybeUpdateWriteRateLimit(MonoTime::Now());
+  MonoDelta slept = write_limiter_.Acquire(bytes);
+  if (slept.ToNanoseconds() > 0) {
+    TRACE_COUNTER_INCREMENT("data_dir_write_throttled_us", slept.ToMicroseconds());
+  }
+}
+
+void DataDir::RecordReadLatency(MonoDelta latency) {
+  if (FLAGS_fs_data_dir_write_rate_limit_bytes_per_sec <= 0 ||
+      FLAGS_fs_data_dir_write_rate_limit_read_latency_ms <= 0) {
+    return;
+  }
+  read_latency_sum_us_.fetch_add(latency.ToMicroseconds(), std::memory_order_relaxed);
+  num_reads_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DataDir::RecordRead(size_t bytes, MonoDelta latency) {
+  RecordReadLatency(latency);
+  if (io_metrics_) {
+    io_metrics_->bytes_read->IncrementBy(bytes);
+    io_metrics_->read_ops->Increment();
+    io_metrics_->read_latency->Increment(latency.ToMicroseconds());
+  }
+}
+
+void DataDir::RecordWrite(size_t bytes) {
+  if (io_metrics_) {
+    io_metrics_->bytes_written->IncrementBy(bytes);
+  }
+}
+
+void DataDir::RecordSync(MonoDelta latency) {
+  if (io_metrics_) {
+    io_metrics_->sync_latency->Increment(latency.ToMicroseconds());
+  }
+}
+
+uint64_t DataDir::write_rate_limit() const {
+  return FLAGS_fs_data_dir_write_rate_limit_bytes_per_sec > 0 ? write_limiter_.rate() : 0;
+}
+
+void DataDir::MaybeUpdateWriteRateLimit(MonoTime now) {
+  std::unique_lock<simple_spinlock> l(write_limit_lock_, std::try_to_lock);
+  if (!l.owns_lock() ||
+      (last_write_limit_update_.Initialized() &&
+       now - last_write_limit_update_ < MonoDelta::FromSeconds(1))) {
+    return;
+  }
+  const uint64_t max_rate = FLAGS_fs_data_dir_write_rate_limit_bytes_per_sec;
+  const uint64_t min_rate = std::max<uint64_t>(1, max_rate / 10);
+  const int64_t num_reads = num_reads_.exchange(0, std::memory_order_relaxed);
+  const int64_t read_latency_sum_us = read_latency_sum_us_.exchange(0, std::memory_order_relaxed);
+  const int64_t target_us =
+      static_cast<int64_t>(FLAGS_fs_data_dir_write_rate_limit_read_latency_ms) * 1000;
+
+  uint64_t rate = write_limiter_.rate();
+  if (rate == 0 || rate > max_rate) {
+    rate = max_rate;
+  } else if (target_us > 0 && num_reads > 0 && read_latency_sum_us / num_reads > target_us) {
+    rate = std::max(min_rate, rate / 2);
+  } else {
+    rate = std::min(max_rate, rate + min_rate);
+  }
+  if (rate != write_limiter_.rate()) {
+    VLOG(1) << Substitute("Write rate limit of data dir $0: $1 bytes/s", dir_, rate);
+    write_limiter_.set_rate(rate);
+  }
+  last_write_limit_update_ = now;
+}
+
 Status DataDir::RefreshIsFull(RefreshMode mode) {
   switch (mode) {
     case RefreshMode::EXPIRED_ONLY: {
@@ -343,6 +496,7 @@ Status DataDirGroup::CopyToPB(const UuidByUuidIndexMap& uuid_by_uuid_idx,
 
 DataDirManagerOptions::DataDirManagerOptions()
     : block_manager_type(FLAGS_block_manager),
+      metric_registry(nullptr),
       read_only(false),
       consistency_check(ConsistencyCheckBehavior::ENFORCE_CONSISTENCY) {
 }
@@ -364,6 +518,7 @@ DataDirManager::DataDirManager(Env* env,
     : env_(env),
       opts_(std::move(opts)),
       canonicalized_data_fs_roots_(std::move(canonicalized_data_roots)),
+      tiered_(false),
       rng_(GetRandomSeed32()) {
   DCHECK_GT(canonicalized_data_fs_roots_.size(), 0);
   DCHECK(opts_.consistency_check != ConsistencyCheckBehavior::UPDATE_ON_DISK ||
@@ -701,13 +856,42 @@ Status DataDirManager::Open() {
                    JoinStrings(GetDataDirs(), ",")));
   }
 
+  // Find the data dirs on fast storage, if the dirs are tiered. The roots
+  // which can't be canonicalized, e.g. because their disk failed, are
+  // matched as is.
+  set<string> fast_data_dirs;
+  for (const auto& root : strings::Split(FLAGS_fs_fast_data_dirs, ",",
+                                         strings::SkipEmpty())) {
+    string canonicalized;
+    Status s = env_->Canonicalize(root.ToString(), &canonicalized);
+    if (PREDICT_FALSE(!s.ok())) {
+      LOG(WARNING) << Substitute("could not canonicalize fast data dir $0: $1",
+                                 root.ToString(), s.ToString());
+      canonicalized = root.ToString();
+    }
+    fast_data_dirs.emplace(JoinPathSegments(canonicalized, kDataDirName));
+  }
+
   // All instances are present and accounted for. Time to create the in-memory
   // data directory structures.
   int i = 0;
+  int num_fast_dirs = 0;
   vector<unique_ptr<DataDir>> dds;
   for (auto& instance : loaded_instances) {
     const string data_dir = instance->dir();
 
+    StorageTier tier = StorageTier::DEFAULT;
+    if (!fast_data_dirs.empty()) {
+      if (ContainsKey(fast_data_dirs, data_dir)) {
+        tier = StorageTier::FAST;
+        num_fast_dirs++;
+      } else {
+        tier = StorageTier::SLOW;
+      }
+      VLOG(1) << Substitute("data dir $0 is on the $1 storage tier",
+                            data_dir, StorageTierToString(tier));
+    }
+
     // Create a per-dir thread pool.
     gscoped_ptr<ThreadPool> pool;
     RETURN_NOT_OK(ThreadPoolBuilder(Substitute("data dir $0", i))
@@ -730,12 +914,28 @@ Status DataDirManager::Open() {
       }
     }
 
+    // Instantiate the IO metrics of the directory under an entity of its own,
+    // identified by the UUID of the directory if it's known.
+    unique_ptr<DataDirIOMetrics> io_metrics;
+    if (opts_.metric_registry) {
+      const string& id = instance->healthy() ?
+          instance->metadata()->path_set().uuid() : data_dir;
+      io_metrics.reset(new DataDirIOMetrics(METRIC_ENTITY_data_directory.Instantiate(
+          opts_.metric_registry, id, { { "path", data_dir } })));
+    }
+
     unique_ptr<DataDir> dd(new DataDir(
-        env_, metrics_.get(), fs_type, data_dir, std::move(instance),
-        unique_ptr<ThreadPool>(pool.release())));
+        env_, metrics_.get(), std::move(io_metrics), fs_type, tier, data_dir,
+        std::move(instance), unique_ptr<ThreadPool>(pool.release())));
     dds.emplace_back(std::move(dd));
     i++;
   }
+  if (PREDICT_FALSE(num_fast_dirs != fast_data_dirs.size())) {
+    return Status::InvalidArgument(
+        "--fs_fast_data_dirs lists directories which are not data directories",
+        FLAGS_fs_fast_data_dirs);
+  }
+  tiered_ = !fast_data_dirs.empty();
 
   // Use the per-dir thread pools to delete temporary files in parallel.
   for (const auto& dd : dds) {
@@ -977,15 +1177,22 @@ Status DataDirManager::GetNextDataDir(const CreateBlockOptions& opts, DataDir**
   iota(random_indices.begin(), random_indices.end(), 0);
   shuffle(random_indices.begin(), random_indices.end(), default_random_engine(rng_.Next()));
 
-  // Randomly select a member of the group that is not full.
-  for (int i : random_indices) {
-    int uuid_idx = (*group_uuid_indices)[i];
-    DataDir* candidate = FindOrDie(data_dir_by_uuid_idx_, uuid_idx);
-    Status s = candidate->RefreshIsFull(DataDir::RefreshMode::EXPIRED_ONLY);
-    WARN_NOT_OK(s, Substitute("failed to refresh fullness of $0", candidate->dir()));
-    if (s.ok() && !candidate->is_full()) {
-      *dir = candidate;
-      return Status::OK();
+  // Randomly select a member of the group that is not full, favoring those
+  // of the requested tier, if any.
+  const bool by_tier = tiered_ && opts.tier != StorageTier::DEFAULT;
+  for (int pass = by_tier ? 0 : 1; pass < 2; pass++) {
+    for (int i : random_indices) {
+      int uuid_idx = (*group_uuid_indices)[i];
+      DataDir* candidate = FindOrDie(data_dir_by_uuid_idx_, uuid_idx);
+      if (pass == 0 && candidate->tier() != opts.tier) {
+        continue;
+      }
+      Status s = candidate->RefreshIsFull(DataDir::RefreshMode::EXPIRED_ONLY);
+      WARN_NOT_OK(s, Substitute("failed to refresh fullness of $0", candidate->dir()));
+      if (s.ok() && !candidate->is_full()) {
+        *dir = candidate;
+        return Status::OK();
+      }
     }
   }
   string tablet_id_str = "";
@@ -1044,17 +1251,32 @@ void DataDirManager::GetDirsForGroupUnlocked(int target_size,
       candidate_indices.push_back(e.first);
     }
   }
-  while (group_indices->size() < target_size && !candidate_indices.empty()) {
-    shuffle(candidate_indices.begin(), candidate_indices.end(), default_random_engine(rng_.Next()));
-    if (candidate_indices.size() == 1 ||
-        FindOrDie(tablets_by_uuid_idx_map_, candidate_indices[0]).size() <
-            FindOrDie(tablets_by_uuid_idx_map_, candidate_indices[1]).size()) {
-      group_indices->push_back(candidate_indices[0]);
-      candidate_indices.erase(candidate_indices.begin());
-    } else {
-      group_indices->push_back(candidate_indices[1]);
-      candidate_indices.erase(candidate_indices.begin() + 1);
+  // Moves the less loaded of two random dirs of 'indices' to the group.
+  const auto select_dir = [&](vector<int>* indices) {
+    shuffle(indices->begin(), indices->end(), default_random_engine(rng_.Next()));
+    auto selected = indices->begin();
+    if (indices->size() > 1 &&
+        FindOrDie(tablets_by_uuid_idx_map_, (*indices)[0]).size() >=
+            FindOrDie(tablets_by_uuid_idx_map_, (*indices)[1]).size()) {
+      selected++;
     }
+    group_indices->push_back(*selected);
+    candidate_indices.erase(std::find(candidate_indices.begin(), candidate_indices.end(),
+                                      *selected));
+  };
+  if (tiered_ && group_indices->size() < target_size) {
+    vector<int> fast_indices;
+    for (int uuid_idx : candidate_indices) {
+      if (FindOrDie(data_dir_by_uuid_idx_, uuid_idx)->tier() == StorageTier::FAST) {
+        fast_indices.push_back(uuid_idx);
+      }
+    }
+    if (!fast_indices.empty()) {
+      select_dir(&fast_indices);
+    }
+  }
+  while (group_indices->size() < target_size && !candidate_indices.empty()) {
+    select_dir(&candidate_indices);
   }
 }
 
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <mutex>
@@ -35,6 +37,7 @@
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/random.h"
+#include "kudu/util/rate_limiter.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
@@ -61,6 +64,7 @@ typedef std::unordered_map<std::string, int> UuidIndexByUuidMap;
 
 class PathInstanceMetadataFile;
 struct CreateBlockOptions;
+enum class StorageTier : uint8_t;
 
 const char kInstanceMetadataFileName[] = "block_manager_instance";
 const char kDataDirName[] = "data";
@@ -137,12 +141,27 @@ struct DataDirMetrics {
   scoped_refptr<AtomicGauge<uint64_t>> data_dirs_full;
 };
 
+// Metrics of the block IO done in a single data directory, instantiated
+// under a 'data_directory' entity of its own.
+struct DataDirIOMetrics {
+  explicit DataDirIOMetrics(const scoped_refptr<MetricEntity>& entity);
+
+  scoped_refptr<Counter> bytes_read;
+  scoped_refptr<Counter> read_ops;
+  scoped_refptr<Counter> bytes_written;
+
+  scoped_refptr<Histogram> read_latency;
+  scoped_refptr<Histogram> sync_latency;
+};
+
 // Representation of a data directory in use by the block manager.
 class DataDir {
  public:
   DataDir(Env* env,
           DataDirMetrics* metrics,
+          std::unique_ptr<DataDirIOMetrics> io_metrics,
           DataDirFsType fs_type,
+          StorageTier tier,
           std::string dir,
           std::unique_ptr<PathInstanceMetadataFile> metadata_file,
           std::unique_ptr<ThreadPool> pool);
@@ -178,6 +197,10 @@ class DataDir {
 
   DataDirFsType fs_type() const { return fs_type_; }
 
+  // The storage tier of the dir, which is StorageTier::DEFAULT unless
+  // --fs_fast_data_dirs is set.
+  StorageTier tier() const { return tier_; }
+
   const std::string& dir() const { return dir_; }
 
   const PathInstanceMetadataFile* instance() const {
@@ -189,10 +212,42 @@ class DataDir {
     return is_full_;
   }
 
+  // Blocks until the write rate limit of the dir allows writing 'bytes' to
+  // it. The limit is --fs_data_dir_write_rate_limit_bytes_per_sec, lowered
+  // while the reads from the dir are slower than
+  // --fs_data_dir_write_rate_limit_read_latency_ms.
+  void ThrottleWrite(size_t bytes);
+
+  // Records the latency of a read from the dir, against which the write rate
+  // limit is adjusted.
+  void RecordReadLatency(MonoDelta latency);
+
+  // Returns the current write rate limit of the dir in bytes per second, or 0
+  // if writes aren't limited.
+  uint64_t write_rate_limit() const;
+
+  // Accounts a read of 'bytes' bytes of block data from the dir that took
+  // 'latency', including for the write rate limit as per RecordReadLatency().
+  void RecordRead(size_t bytes, MonoDelta latency);
+
+  // Accounts a write of 'bytes' bytes of block data to the dir.
+  void RecordWrite(size_t bytes);
+
+  // Accounts a sync of block data in the dir that took 'latency'.
+  void RecordSync(MonoDelta latency);
+
  private:
+  // Adjusts the write rate limit to the average latency of the reads since
+  // the last adjustment, at most once per second. The limit is halved when
+  // the reads are too slow, down to a tenth of the configured limit, and
+  // raised back by a tenth of the configured limit otherwise.
+  void MaybeUpdateWriteRateLimit(MonoTime now);
+
   Env* env_;
   DataDirMetrics* metrics_;
+  const std::unique_ptr<DataDirIOMetrics> io_metrics_;
   const DataDirFsType fs_type_;
+  const StorageTier tier_;
   const std::string dir_;
   const std::unique_ptr<PathInstanceMetadataFile> metadata_file_;
   const std::unique_ptr<ThreadPool> pool_;
@@ -204,6 +259,16 @@ class DataDir {
   MonoTime last_check_is_full_;
   bool is_full_;
 
+  RateLimiter write_limiter_;
+
+  // Protects 'last_write_limit_update_'.
+  simple_spinlock write_limit_lock_;
+  MonoTime last_write_limit_update_;
+
+  // The reads from the dir since the last update of the write rate limit.
+  std::atomic<int64_t> read_latency_sum_us_;
+  std::atomic<int64_t> num_reads_;
+
   DISALLOW_COPY_AND_ASSIGN(DataDir);
 };
 
@@ -223,6 +288,12 @@ struct DataDirManagerOptions {
   // Defaults to null.
   scoped_refptr<MetricEntity> metric_entity;
 
+  // The registry in which an entity is instantiated for the IO metrics of
+  // each data directory. If null, per-directory metrics will not be produced.
+  //
+  // Defaults to null.
+  MetricRegistry* metric_registry;
+
   // Whether the directory manager should only allow reading.
   //
   // Defaults to false.
@@ -463,6 +534,10 @@ class DataDirManager {
   // The resulting behavior fills directories that have fewer tablets stored on
   // them while not completely neglecting those with more tablets.
   //
+  // If the dirs are tiered, a fast dir is selected first, if any is
+  // available, so that the group may hold the blocks preferably placed on
+  // fast storage.
+  //
   // 'group_indices' is an output that stores the list of uuid_indices to be
   // added. Although this function does not itself change DataDirManager state,
   // its expected usage warrants that it is called within the scope of a
@@ -511,6 +586,10 @@ class DataDirManager {
   typedef std::set<int> FailedDataDirSet;
   FailedDataDirSet failed_data_dirs_;
 
+  // Whether the data dirs are tiered, i.e. whether --fs_fast_data_dirs was
+  // set when they were opened.
+  bool tiered_;
+
   // Lock protecting access to the dir group maps and to failed_data_dirs_.
   // A percpu_rwlock is used so threads attempting to read (e.g. to get the
   // next data directory for a Flush()) do not block each other, while threads
@@ -339,16 +339,17 @@ Status FileWritableBlock::Append(const Slice& data) {
 
 Status FileWritableBlock::AppendV(ArrayView<const Slice> data) {
   DCHECK(state_ == CLEAN || state_ == DIRTY) << "Invalid state: " << state_;
-  RETURN_NOT_OK_HANDLE_ERROR(writer_->AppendV(data));
-  RETURN_NOT_OK_HANDLE_ERROR(location_.data_dir()->RefreshIsFull(
-      DataDir::RefreshMode::ALWAYS));
-  state_ = DIRTY;
 
-  // Calculate the amount of data written
+  // Calculate the amount of data to write
   size_t bytes_written = accumulate(data.begin(), data.end(), static_cast<size_t>(0),
                                     [&](int sum, const Slice& curr) {
                                       return sum + curr.size();
                                     });
+  location_.data_dir()->ThrottleWrite(bytes_written);
+  RETURN_NOT_OK_HANDLE_ERROR(writer_->AppendV(data));
+  RETURN_NOT_OK_HANDLE_ERROR(location_.data_dir()->RefreshIsFull(
+      DataDir::RefreshMode::ALWAYS));
+  state_ = DIRTY;
   bytes_appended_ += bytes_written;
   return Status::OK();
 }
@@ -369,7 +370,12 @@ Status FileWritableBlock::Finalize() {
   VLOG(3) << "Finalizing block " << id();
   if (state_ == DIRTY &&
       FLAGS_block_manager_preflush_control == "finalize") {
+    MonoTime start = MonoTime::Now();
     FlushDataAsync();
+    if (block_manager_->metrics_) {
+      block_manager_->metrics_->finalize_latency->Increment(
+          (MonoTime::Now() - start).ToMicroseconds());
+    }
   }
   state_ = FINALIZED;
   return Status::OK();
@@ -395,7 +401,13 @@ Status FileWritableBlock::Close(SyncMode mode) {
     VLOG(3) << "Syncing block " << id();
     if (FLAGS_enable_data_block_fsync) {
       if (block_manager_->metrics_) block_manager_->metrics_->total_disk_sync->Increment();
+      MonoTime start = MonoTime::Now();
       sync = writer_->Sync();
+      MonoDelta latency = MonoTime::Now() - start;
+      if (block_manager_->metrics_) {
+        block_manager_->metrics_->sync_latency->Increment(latency.ToMicroseconds());
+      }
+      location_.data_dir()->RecordSync(latency);
     }
     if (sync.ok()) {
       sync = block_manager_->SyncMetadata(location_);
@@ -412,6 +424,7 @@ Status FileWritableBlock::Close(SyncMode mode) {
     block_manager_->metrics_->total_bytes_written->IncrementBy(BytesAppended());
     block_manager_->metrics_->total_blocks_created->Increment();
   }
+  location_.data_dir()->RecordWrite(BytesAppended());
 
   // Either Close() or Sync() could have run into an error.
   HandleError(close);
@@ -432,7 +445,7 @@ Status FileWritableBlock::Close(SyncMode mode) {
 // embed a FileBlockLocation, using the simpler BlockId instead.
 class FileReadableBlock : public ReadableBlock {
  public:
-  FileReadableBlock(FileBlockManager* block_manager, BlockId block_id,
+  FileReadableBlock(FileBlockManager* block_manager, DataDir* data_dir, BlockId block_id,
                     shared_ptr<RandomAccessFile> reader);
 
   virtual ~FileReadableBlock();
@@ -449,6 +462,10 @@ class FileReadableBlock : public ReadableBlock {
 
   virtual Status ReadV(uint64_t offset, ArrayView<Slice> results) const OVERRIDE;
 
+  virtual Status Readahead(uint64_t offset, size_t length) const OVERRIDE;
+
+  virtual Status MapForRead(unique_ptr<MappedRegion>* region) const OVERRIDE;
+
   virtual size_t memory_footprint() const OVERRIDE;
 
   void HandleError(const Status& s) const;
@@ -457,6 +474,9 @@ class FileReadableBlock : public ReadableBlock {
   // Back pointer to the owning block manager.
   FileBlockManager* block_manager_;
 
+  // The data directory the block is in.
+  DataDir* data_dir_;
+
   // The block's identifier.
   const BlockId block_id_;
 
@@ -478,9 +498,11 @@ void FileReadableBlock::HandleError(const Status& s) const {
 }
 
 FileReadableBlock::FileReadableBlock(FileBlockManager* block_manager,
+                                     DataDir* data_dir,
                                      BlockId block_id,
                                      shared_ptr<RandomAccessFile> reader)
     : block_manager_(block_manager),
+      data_dir_(data_dir),
       block_id_(block_id),
       reader_(std::move(reader)),
       closed_(false) {
@@ -528,20 +550,44 @@ Status FileReadableBlock::Read(uint64_t offset, Slice result) const {
 Status FileReadableBlock::ReadV(uint64_t offset, ArrayView<Slice> results) const {
   DCHECK(!closed_.Load());
 
+  MonoTime start_time = MonoTime::Now();
   RETURN_NOT_OK_HANDLE_ERROR(reader_->ReadV(offset, results));
-
+  MonoDelta latency = MonoTime::Now() - start_time;
+
+  // Calculate the read amount of data
+  size_t bytes_read = accumulate(results.begin(), results.end(), static_cast<size_t>(0),
+                                 [&](int sum, const Slice& curr) {
+                                   return sum + curr.size();
+                                 });
+  data_dir_->RecordRead(bytes_read, latency);
   if (block_manager_->metrics_) {
-    // Calculate the read amount of data
-    size_t bytes_read = accumulate(results.begin(), results.end(), static_cast<size_t>(0),
-                                   [&](int sum, const Slice& curr) {
-                                     return sum + curr.size();
-                                   });
     block_manager_->metrics_->total_bytes_read->IncrementBy(bytes_read);
+    block_manager_->metrics_->total_read_ops->Increment();
+    block_manager_->metrics_->read_latency->Increment(latency.ToMicroseconds());
   }
 
   return Status::OK();
 }
 
+Status FileReadableBlock::Readahead(uint64_t offset, size_t length) const {
+  DCHECK(!closed_.Load());
+
+  RETURN_NOT_OK_HANDLE_ERROR(reader_->Readahead(offset, length));
+  return Status::OK();
+}
+
+Status FileReadableBlock::MapForRead(unique_ptr<MappedRegion>* region) const {
+  DCHECK(!closed_.Load());
+
+  uint64_t size;
+  RETURN_NOT_OK(Size(&size));
+  if (size == 0) {
+    return Status::NotSupported("cannot map an empty block", id().ToString());
+  }
+  RETURN_NOT_OK_HANDLE_ERROR(reader_->MapForRead(0, size, region));
+  return Status::OK();
+}
+
 size_t FileReadableBlock::memory_footprint() const {
   DCHECK(reader_);
   return kudu_malloc_usable_size(this) + reader_->memory_footprint();
@@ -820,17 +866,19 @@ Status FileBlockManager::CreateBlock(const CreateBlockOptions& opts,
 
 Status FileBlockManager::OpenBlock(const BlockId& block_id,
                                    unique_ptr<ReadableBlock>* block) {
-  string path;
-  if (!FindBlockPath(block_id, &path)) {
+  DataDir* dir = dd_manager_->FindDataDirByUuidIndex(
+      internal::FileBlockLocation::GetDataDirIdx(block_id));
+  if (!dir) {
     return Status::NotFound(
         Substitute("Block $0 not found", block_id.ToString()));
   }
+  string path = internal::FileBlockLocation::FromBlockId(dir, block_id).GetFullPath();
 
   VLOG(1) << "Opening block with id " << block_id.ToString() << " at " << path;
 
   shared_ptr<RandomAccessFile> reader;
   RETURN_NOT_OK_FBM_DISK_FAILURE(file_cache_.OpenExistingFile(path, &reader));
-  block->reset(new internal::FileReadableBlock(this, block_id, reader));
+  block->reset(new internal::FileReadableBlock(this, dir, block_id, reader));
   return Status::OK();
 }
 
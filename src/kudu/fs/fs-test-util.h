@@ -85,6 +85,14 @@ class CountingReadableBlock : public ReadableBlock {
     return Status::OK();
   }
 
+  virtual Status Readahead(uint64_t offset, size_t length) const OVERRIDE {
+    return block_->Readahead(offset, length);
+  }
+
+  virtual Status MapForRead(std::unique_ptr<MappedRegion>* region) const OVERRIDE {
+    return block_->MapForRead(region);
+  }
+
   virtual size_t memory_footprint() const OVERRIDE {
     return block_->memory_footprint();
   }
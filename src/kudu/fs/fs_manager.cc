@@ -134,9 +134,11 @@ const char *FsManager::kDataDirName = "data";
 const char *FsManager::kCorruptedSuffix = ".corrupted";
 const char *FsManager::kInstanceMetadataFileName = "instance";
 const char *FsManager::kConsensusMetadataDirName = "consensus-meta";
+const char *FsManager::kBlockCacheKeysFileName = "block-cache-keys";
 
 FsManagerOpts::FsManagerOpts()
-  : wal_root(FLAGS_fs_wal_dir),
+  : metric_registry(nullptr),
+    wal_root(FLAGS_fs_wal_dir),
     metadata_root(FLAGS_fs_metadata_dir),
     block_manager_type(FLAGS_block_manager),
     read_only(false),
@@ -145,7 +147,8 @@ FsManagerOpts::FsManagerOpts()
 }
 
 FsManagerOpts::FsManagerOpts(const string& root)
-  : wal_root(root),
+  : metric_registry(nullptr),
+    wal_root(root),
     data_roots({ root }),
     block_manager_type(FLAGS_block_manager),
     read_only(false),
@@ -393,6 +396,7 @@ Status FsManager::Open(FsReport* report) {
   if (!dd_manager_) {
     DataDirManagerOptions dm_opts;
     dm_opts.metric_entity = opts_.metric_entity;
+    dm_opts.metric_registry = opts_.metric_registry;
     dm_opts.block_manager_type = opts_.block_manager_type;
     dm_opts.read_only = opts_.read_only;
     dm_opts.consistency_check = opts_.consistency_check;
@@ -80,6 +80,12 @@ struct FsManagerOpts {
   // Defaults to null.
   scoped_refptr<MetricEntity> metric_entity;
 
+  // The registry in which an entity is instantiated for the IO metrics of
+  // each data directory. If null, per-directory metrics will not be produced.
+  //
+  // Defaults to null.
+  MetricRegistry* metric_registry;
+
   // The memory tracker under which all new memory trackers will be parented.
   // If null, new memory trackers will be parented to the root tracker.
   //
@@ -234,6 +240,13 @@ class FsManager {
     return JoinPathSegments(GetConsensusMetadataDir(), tablet_id);
   }
 
+  // Return the path where the keys of the blocks in the block cache are
+  // saved across restarts.
+  std::string GetBlockCacheKeysPath() const {
+    DCHECK(initted_);
+    return JoinPathSegments(canonicalized_metadata_fs_root_.path, kBlockCacheKeysFileName);
+  }
+
   Env* env() { return env_; }
 
   bool read_only() const {
@@ -326,6 +339,7 @@ class FsManager {
   static const char *kInstanceMetadataMagicNumber;
   static const char *kTabletSuperBlockMagicNumber;
   static const char *kConsensusMetadataDirName;
+  static const char *kBlockCacheKeysFileName;
 
   // The environment to be used for all filesystem operations.
   Env* env_;
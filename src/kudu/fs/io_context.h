@@ -22,6 +22,8 @@
 namespace kudu {
 namespace fs {
 
+class IOMetrics;
+
 // An IOContext provides a single interface to pass state around during IO. A
 // single IOContext should correspond to a single high-level operation that
 // does IO, e.g. a scan, a tablet bootstrap, etc.
@@ -40,9 +42,43 @@ namespace fs {
 //   The expectation is that, because the lower-level modules may outlive the
 //   bootstrap and its IOContext, they will not store the pointers to the
 //   context, but may use them as method arguments as needed.
+//
+// An IOContext is an aggregate: members which aren't initialized explicitly,
+// e.g. by 'IOContext io_context({ tablet_id })', are value-initialized.
 struct IOContext {
+  // How the blocks read by an IO are to be cached.
+  enum CacheHint {
+    // Blocks are cached as requested by their readers.
+    CACHE_DEFAULT = 0,
+
+    // The IO reads most blocks once, e.g. in a compaction. Data blocks are
+    // neither inserted into the block cache nor counted as used by it, so
+    // that the IO doesn't evict blocks used by scans. Blocks already in the
+    // block cache are still used. Index, bloom filter and dictionary blocks,
+    // which are few and also needed by other operations, are cached as usual.
+    CACHE_READ_ONCE,
+  };
+
+  // The kind of operation doing the IO, by which it is accounted.
+  enum Source {
+    SOURCE_OTHER = 0,
+    SOURCE_SCAN,
+    SOURCE_FLUSH,
+    SOURCE_COMPACTION,
+    SOURCE_TABLET_COPY,
+  };
+
   // The tablet id associated with this IO.
   std::string tablet_id;
+
+  // The caching hint for the blocks read by this IO.
+  CacheHint cache_hint;
+
+  // The operation doing this IO.
+  Source source;
+
+  // The per-tablet metrics the IO is accounted against, if not null. Not owned.
+  IOMetrics* metrics;
 };
 
 }  // namespace fs
@@ -0,0 +1,138 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/fs/io_metrics.h"
+
+#include "kudu/util/monotime.h"
+
+METRIC_DEFINE_counter(tablet, io_scan_bytes_read,
+                      "Block Bytes Read By Scans",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes of block data read from disk by scans of this tablet");
+METRIC_DEFINE_counter(tablet, io_scan_read_ops,
+                      "Block Reads By Scans",
+                      kudu::MetricUnit::kOperations,
+                      "Number of block data reads from disk by scans of this tablet");
+METRIC_DEFINE_counter(tablet, io_compaction_bytes_read,
+                      "Block Bytes Read By Compactions",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes of block data read from disk by compactions "
+                      "of this tablet");
+METRIC_DEFINE_counter(tablet, io_compaction_read_ops,
+                      "Block Reads By Compactions",
+                      kudu::MetricUnit::kOperations,
+                      "Number of block data reads from disk by compactions of this tablet");
+METRIC_DEFINE_counter(tablet, io_tablet_copy_bytes_read,
+                      "Block Bytes Read By Tablet Copies",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes of block data read from disk to copy this tablet "
+                      "to other servers");
+METRIC_DEFINE_counter(tablet, io_tablet_copy_read_ops,
+                      "Block Reads By Tablet Copies",
+                      kudu::MetricUnit::kOperations,
+                      "Number of block data reads from disk to copy this tablet to "
+                      "other servers");
+METRIC_DEFINE_counter(tablet, io_other_bytes_read,
+                      "Block Bytes Read By Other Operations",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes of block data read from disk by operations of "
+                      "this tablet other than scans, compactions and tablet copies, "
+                      "e.g. by the key lookups of writes");
+METRIC_DEFINE_counter(tablet, io_other_read_ops,
+                      "Block Reads By Other Operations",
+                      kudu::MetricUnit::kOperations,
+                      "Number of block data reads from disk by operations of this "
+                      "tablet other than scans, compactions and tablet copies");
+METRIC_DEFINE_histogram(tablet, io_read_latency,
+                        "Block Read Latency",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Time spent reading block data from disk for this tablet",
+                        60000000LU, 2);
+
+METRIC_DEFINE_counter(tablet, io_flush_bytes_written,
+                      "Block Bytes Written By Flushes",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes of block data written by the flushes of this tablet");
+METRIC_DEFINE_counter(tablet, io_compaction_bytes_written,
+                      "Block Bytes Written By Compactions",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes of block data written by the compactions of "
+                      "this tablet");
+METRIC_DEFINE_counter(tablet, io_other_bytes_written,
+                      "Block Bytes Written By Other Operations",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes of block data written by operations of this "
+                      "tablet other than flushes and compactions");
+
+namespace kudu {
+namespace fs {
+
+#define MINIT(member, x) member(METRIC_io_##x.Instantiate(entity))
+IOMetrics::IOMetrics(const scoped_refptr<MetricEntity>& entity)
+    : MINIT(scan_bytes_read_, scan_bytes_read),
+      MINIT(scan_read_ops_, scan_read_ops),
+      MINIT(compaction_bytes_read_, compaction_bytes_read),
+      MINIT(compaction_read_ops_, compaction_read_ops),
+      MINIT(tablet_copy_bytes_read_, tablet_copy_bytes_read),
+      MINIT(tablet_copy_read_ops_, tablet_copy_read_ops),
+      MINIT(other_bytes_read_, other_bytes_read),
+      MINIT(other_read_ops_, other_read_ops),
+      MINIT(read_latency_, read_latency),
+      MINIT(flush_bytes_written_, flush_bytes_written),
+      MINIT(compaction_bytes_written_, compaction_bytes_written),
+      MINIT(other_bytes_written_, other_bytes_written) {
+}
+#undef MINIT
+
+void IOMetrics::RecordRead(IOContext::Source source, size_t bytes, const MonoDelta& latency) {
+  switch (source) {
+    case IOContext::SOURCE_SCAN:
+      scan_bytes_read_->IncrementBy(bytes);
+      scan_read_ops_->Increment();
+      break;
+    case IOContext::SOURCE_COMPACTION:
+      compaction_bytes_read_->IncrementBy(bytes);
+      compaction_read_ops_->Increment();
+      break;
+    case IOContext::SOURCE_TABLET_COPY:
+      tablet_copy_bytes_read_->IncrementBy(bytes);
+      tablet_copy_read_ops_->Increment();
+      break;
+    default:
+      other_bytes_read_->IncrementBy(bytes);
+      other_read_ops_->Increment();
+      break;
+  }
+  read_latency_->Increment(latency.ToMicroseconds());
+}
+
+void IOMetrics::RecordWrite(IOContext::Source source, size_t bytes) {
+  switch (source) {
+    case IOContext::SOURCE_FLUSH:
+      flush_bytes_written_->IncrementBy(bytes);
+      break;
+    case IOContext::SOURCE_COMPACTION:
+      compaction_bytes_written_->IncrementBy(bytes);
+      break;
+    default:
+      other_bytes_written_->IncrementBy(bytes);
+      break;
+  }
+}
+
+} // namespace fs
+} // namespace kudu
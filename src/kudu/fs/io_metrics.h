@@ -0,0 +1,65 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+
+#include "kudu/fs/io_context.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/metrics.h"
+
+namespace kudu {
+
+class MonoDelta;
+
+namespace fs {
+
+// Accounts the block IO done on behalf of a tablet, broken down by the
+// IOContext::Source of the IO. Instantiated against the tablet's metric
+// entity, and reached through IOContext::metrics by the lower layers.
+//
+// Reads are accounted to SOURCE_SCAN, SOURCE_COMPACTION, SOURCE_TABLET_COPY
+// or otherwise SOURCE_OTHER; writes to SOURCE_FLUSH, SOURCE_COMPACTION or
+// otherwise SOURCE_OTHER.
+class IOMetrics {
+ public:
+  explicit IOMetrics(const scoped_refptr<MetricEntity>& entity);
+
+  // Records a read of 'bytes' bytes in a single operation that took 'latency'.
+  void RecordRead(IOContext::Source source, size_t bytes, const MonoDelta& latency);
+
+  // Records a write of 'bytes' bytes.
+  void RecordWrite(IOContext::Source source, size_t bytes);
+
+ private:
+  scoped_refptr<Counter> scan_bytes_read_;
+  scoped_refptr<Counter> scan_read_ops_;
+  scoped_refptr<Counter> compaction_bytes_read_;
+  scoped_refptr<Counter> compaction_read_ops_;
+  scoped_refptr<Counter> tablet_copy_bytes_read_;
+  scoped_refptr<Counter> tablet_copy_read_ops_;
+  scoped_refptr<Counter> other_bytes_read_;
+  scoped_refptr<Counter> other_read_ops_;
+  scoped_refptr<Histogram> read_latency_;
+
+  scoped_refptr<Counter> flush_bytes_written_;
+  scoped_refptr<Counter> compaction_bytes_written_;
+  scoped_refptr<Counter> other_bytes_written_;
+};
+
+} // namespace fs
+} // namespace kudu
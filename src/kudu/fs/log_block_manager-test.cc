@@ -26,6 +26,7 @@
 #include <ostream>
 #include <set>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -55,10 +56,13 @@
 #include "kudu/gutil/strings/util.h"
 #include "kudu/util/atomic.h"
 #include "kudu/util/env.h"
+#include "kudu/util/maintenance_manager.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/path_util.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/random.h"
+#include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h" // IWYU pragma: keep
@@ -78,13 +82,18 @@ using strings::Substitute;
 DECLARE_bool(cache_force_single_shard);
 DECLARE_bool(crash_on_eio);
 DECLARE_bool(log_block_manager_delete_dead_container);
+DECLARE_bool(log_block_manager_drop_page_cache);
+DECLARE_bool(log_container_compact_metadata_at_runtime);
 DECLARE_double(env_inject_eio);
 DECLARE_double(log_container_excess_space_before_cleanup_fraction);
 DECLARE_double(log_container_live_metadata_before_compact_ratio);
+DECLARE_int32(log_container_hole_punch_rate_limit_per_sec);
+DECLARE_int32(log_container_open_threads_per_data_dir);
 DECLARE_int64(block_manager_max_open_files);
 DECLARE_int64(log_container_max_blocks);
 DECLARE_string(block_manager_preflush_control);
 DECLARE_string(env_inject_eio_globs);
+DECLARE_uint64(log_container_max_preallocate_bytes);
 DECLARE_uint64(log_container_preallocate_bytes);
 DECLARE_uint64(log_container_max_size);
 
@@ -98,6 +107,7 @@ METRIC_DECLARE_counter(log_block_manager_holes_punched);
 METRIC_DECLARE_gauge_uint64(log_block_manager_containers);
 METRIC_DECLARE_gauge_uint64(log_block_manager_full_containers);
 METRIC_DECLARE_gauge_uint64(log_block_manager_dead_containers_deleted);
+METRIC_DECLARE_counter(log_block_manager_metadata_files_compacted);
 
 namespace kudu {
 namespace fs {
@@ -870,6 +880,74 @@ TEST_F(LogBlockManagerTest, TestPreallocationAndTruncation) {
   }
 }
 
+// Test that a container written to quickly preallocates increasingly large
+// windows, up to --log_container_max_preallocate_bytes.
+TEST_F(LogBlockManagerTest, TestAdaptivePreallocation) {
+  const int64_t kMB = 1024 * 1024;
+  FLAGS_log_container_preallocate_bytes = kMB;
+  FLAGS_log_container_max_preallocate_bytes = 8 * kMB;
+
+  unique_ptr<uint8_t[]> data(new uint8_t[kMB]);
+  memset(data.get(), 0, kMB);
+  unique_ptr<WritableBlock> writer;
+  ASSERT_OK(bm_->CreateBlock(test_block_opts_, &writer));
+
+  // The first append preallocates 1 MB, the second another 2 MB, and the
+  // fourth another 4 MB. A fixed window would have preallocated 4 MB total.
+  for (int i = 0; i < 4; i++) {
+    ASSERT_OK(writer->Append({ data.get(), static_cast<size_t>(kMB) }));
+  }
+  string fname;
+  NO_FATALS(GetOnlyContainerDataFile(&fname));
+  uint64_t size;
+  ASSERT_OK(env_->GetFileSizeOnDisk(fname, &size));
+  ASSERT_EQ(7 * kMB, size);
+  ASSERT_OK(writer->Close());
+}
+
+// Test that a tablet keeps writing to the container it last used, rather than
+// interleaving its blocks with another tablet's.
+TEST_F(LogBlockManagerTest, TestContainerTabletAffinity) {
+  FLAGS_log_container_preallocate_bytes = 0;
+  uint64_t fs_block_size;
+  ASSERT_OK(env_->GetBlockSize(test_dir_, &fs_block_size));
+
+  const string kOtherTablet = "other_tablet";
+  ASSERT_OK(dd_manager_->CreateDataDirGroup(kOtherTablet));
+  const CreateBlockOptions other_block_opts({ kOtherTablet });
+  auto write_block = [&](WritableBlock* block, uint64_t num_fs_blocks) {
+    string data(num_fs_blocks * fs_block_size, 'x');
+    RETURN_NOT_OK(block->Append(data));
+    return block->Close();
+  };
+
+  // Write a block for each tablet concurrently, so each gets its own container.
+  // The other tablet's container is made available last and so would be
+  // handed out next without affinity.
+  unique_ptr<WritableBlock> writer;
+  unique_ptr<WritableBlock> other_writer;
+  ASSERT_OK(bm_->CreateBlock(test_block_opts_, &writer));
+  ASSERT_OK(bm_->CreateBlock(other_block_opts, &other_writer));
+  ASSERT_OK(write_block(writer.get(), 1));
+  ASSERT_OK(write_block(other_writer.get(), 3));
+
+  // The test tablet's next block should land in its own container.
+  ASSERT_OK(bm_->CreateBlock(test_block_opts_, &writer));
+  ASSERT_OK(write_block(writer.get(), 1));
+
+  vector<string> containers;
+  NO_FATALS(GetContainerNames(&containers));
+  ASSERT_EQ(2, containers.size());
+  vector<uint64_t> sizes;
+  for (const string& c : containers) {
+    uint64_t size;
+    ASSERT_OK(env_->GetFileSize(c + LogBlockManager::kContainerDataFileSuffix, &size));
+    sizes.push_back(size / fs_block_size);
+  }
+  std::sort(sizes.begin(), sizes.end());
+  ASSERT_EQ(vector<uint64_t>({ 2, 3 }), sizes);
+}
+
 TEST_F(LogBlockManagerTest, TestContainerWithManyHoles) {
   // This is a regression test of sorts for KUDU-1508, though it doesn't
   // actually fail if the fix is missing; it just corrupts the filesystem.
@@ -1070,6 +1148,105 @@ TEST_F(LogBlockManagerTest, TestFailMultipleTransactionsPerContainer) {
   }
 }
 
+// Tests that blocks written and read while their data is dropped from the
+// page cache are intact.
+TEST_F(LogBlockManagerTest, TestDropPageCache) {
+  FLAGS_log_block_manager_drop_page_cache = true;
+
+  // Write blocks of several sizes, some of them in the same container.
+  Random rand(SeedRandom());
+  vector<std::pair<BlockId, string>> blocks;
+  unique_ptr<BlockCreationTransaction> transaction = bm_->NewCreationTransaction();
+  for (int i = 0; i < 10; i++) {
+    string data(rand.Uniform(64 * 1024) + 1, 0);
+    for (auto& c : data) {
+      c = rand.Next();
+    }
+    unique_ptr<WritableBlock> block;
+    ASSERT_OK(bm_->CreateBlock(test_block_opts_, &block));
+    ASSERT_OK(block->Append(data));
+    ASSERT_OK(block->Finalize());
+    blocks.emplace_back(block->id(), std::move(data));
+    transaction->AddCreatedBlock(std::move(block));
+  }
+  ASSERT_OK(transaction->CommitCreatedBlocks());
+
+  // Read the blocks back, twice so that the second read comes from the disk.
+  for (int i = 0; i < 2; i++) {
+    for (const auto& b : blocks) {
+      unique_ptr<ReadableBlock> block;
+      ASSERT_OK(bm_->OpenBlock(b.first, &block));
+      string result(b.second.size(), 0);
+      ASSERT_OK(block->Read(0, Slice(&result[0], result.size())));
+      ASSERT_EQ(b.second, result);
+    }
+  }
+}
+
+TEST_F(LogBlockManagerTest, TestBatchedDeletionAndThrottledHolePunching) {
+  const int kNumBlocks = 40;
+  const int kRate = 10;
+  FLAGS_log_container_hole_punch_rate_limit_per_sec = kRate;
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity = METRIC_ENTITY_server.Instantiate(&registry, "test");
+  ASSERT_OK(ReopenBlockManager(entity));
+
+  // Write blocks into a single container.
+  vector<BlockId> blocks;
+  unique_ptr<BlockCreationTransaction> transaction = bm_->NewCreationTransaction();
+  for (int i = 0; i < kNumBlocks; i++) {
+    unique_ptr<WritableBlock> block;
+    ASSERT_OK(bm_->CreateBlock(test_block_opts_, &block));
+    ASSERT_OK(block->Append("test data"));
+    ASSERT_OK(block->Finalize());
+    blocks.emplace_back(block->id());
+    transaction->AddCreatedBlock(std::move(block));
+  }
+  ASSERT_OK(transaction->CommitCreatedBlocks());
+
+  // Delete every other block, so that no two deleted blocks are adjacent and
+  // each gets its own hole.
+  vector<BlockId> to_delete;
+  vector<BlockId> to_keep;
+  for (int i = 0; i < kNumBlocks; i++) {
+    (i % 2 == 0 ? to_delete : to_keep).emplace_back(blocks[i]);
+  }
+  MonoTime start = MonoTime::Now();
+  {
+    shared_ptr<BlockDeletionTransaction> deletion_transaction =
+        bm_->NewDeletionTransaction();
+    for (const auto& b : to_delete) {
+      deletion_transaction->AddDeletedBlock(b);
+    }
+    vector<BlockId> deleted;
+    ASSERT_OK(deletion_transaction->CommitDeletedBlocks(&deleted));
+    ASSERT_EQ(to_delete.size(), deleted.size());
+  }
+  for (const auto& data_dir : dd_manager_->data_dirs()) {
+    data_dir->WaitOnClosures();
+  }
+  MonoDelta elapsed = MonoTime::Now() - start;
+  NO_FATALS(CheckLogMetrics(entity, {},
+      { {kNumBlocks / 2, &METRIC_log_block_manager_holes_punched},
+        {kNumBlocks / 2, &METRIC_block_manager_total_blocks_deleted} }));
+
+  // The first second's worth of holes is punched right away; the rest are
+  // paced by the rate limit.
+  const int kThrottledHoles = kNumBlocks / 2 - kRate;
+  ASSERT_GE(elapsed.ToMilliseconds(), kThrottledHoles * 1000 / kRate / 2);
+
+  // The batched deletion records should have been persisted.
+  ASSERT_OK(ReopenBlockManager());
+  for (const auto& b : to_delete) {
+    unique_ptr<ReadableBlock> block;
+    ASSERT_TRUE(bm_->OpenBlock(b, &block).IsNotFound());
+  }
+  for (const auto& b : to_keep) {
+    unique_ptr<ReadableBlock> block;
+    ASSERT_OK(bm_->OpenBlock(b, &block));
+  }
+}
+
 TEST_F(LogBlockManagerTest, TestLookupBlockLimit) {
   int64_t limit_1024 = LogBlockManager::LookupBlockLimit(1024);
   int64_t limit_2048 = LogBlockManager::LookupBlockLimit(2048);
@@ -1121,6 +1298,64 @@ TEST_F(LogBlockManagerTest, TestContainerBlockLimiting) {
   NO_FATALS(AssertNumContainers(4));
 }
 
+// Tests that opening the containers with several threads yields the same
+// blocks and report as with one thread.
+TEST_F(LogBlockManagerTest, TestOpenContainersWithThreads) {
+  const int kNumBlocks = 500;
+  FLAGS_log_container_max_blocks = 10;
+  ASSERT_OK(ReopenBlockManager());
+
+  // Fill many containers, then delete every third block.
+  vector<BlockId> created;
+  for (int i = 0; i < kNumBlocks; i++) {
+    unique_ptr<WritableBlock> block;
+    ASSERT_OK(bm_->CreateBlock(test_block_opts_, &block));
+    ASSERT_OK(block->Append("aaaa"));
+    ASSERT_OK(block->Close());
+    created.emplace_back(block->id());
+  }
+  {
+    shared_ptr<BlockDeletionTransaction> deletion_transaction =
+        bm_->NewDeletionTransaction();
+    for (int i = 0; i < kNumBlocks; i += 3) {
+      deletion_transaction->AddDeletedBlock(created[i]);
+    }
+    vector<BlockId> deleted;
+    ASSERT_OK(deletion_transaction->CommitDeletedBlocks(&deleted));
+  }
+
+  auto reopen_and_get_blocks = [&](int num_threads, FsReport* report,
+                                   vector<BlockId>* block_ids) {
+    FLAGS_log_container_open_threads_per_data_dir = num_threads;
+    ASSERT_OK(ReopenBlockManager(nullptr, report));
+    ASSERT_OK(bm_->GetAllBlockIds(block_ids));
+    std::sort(block_ids->begin(), block_ids->end(), BlockIdCompare());
+  };
+  FsReport report_one_thread;
+  vector<BlockId> blocks_one_thread;
+  NO_FATALS(reopen_and_get_blocks(1, &report_one_thread, &blocks_one_thread));
+  FsReport report_threads;
+  vector<BlockId> blocks_threads;
+  NO_FATALS(reopen_and_get_blocks(8, &report_threads, &blocks_threads));
+
+  ASSERT_EQ(kNumBlocks - (kNumBlocks + 2) / 3, blocks_threads.size());
+  ASSERT_EQ(blocks_one_thread, blocks_threads);
+  ASSERT_EQ(report_one_thread.stats.lbm_container_count,
+            report_threads.stats.lbm_container_count);
+  ASSERT_EQ(report_one_thread.stats.live_block_count,
+            report_threads.stats.live_block_count);
+  ASSERT_EQ(report_one_thread.stats.live_block_bytes,
+            report_threads.stats.live_block_bytes);
+  ASSERT_FALSE(report_threads.HasFatalErrors());
+
+  // New blocks get IDs which weren't used.
+  unique_ptr<WritableBlock> block;
+  ASSERT_OK(bm_->CreateBlock(test_block_opts_, &block));
+  ASSERT_FALSE(std::binary_search(blocks_threads.begin(), blocks_threads.end(),
+                                  block->id(), BlockIdCompare()));
+  ASSERT_OK(block->Close());
+}
+
 TEST_F(LogBlockManagerTest, TestMisalignedBlocksFuzz) {
   FLAGS_log_container_preallocate_bytes = 0;
   const int kNumBlocks = 100;
@@ -1559,6 +1794,118 @@ TEST_F(LogBlockManagerTest, TestCompactFullContainerMetadataAtStartup) {
   ASSERT_EQ(last_live_aligned_bytes, report.stats.live_block_bytes_aligned);
 }
 
+// Tests that the metadata files of full containers can be compacted at runtime
+// while blocks are being deleted from them, without losing any block record.
+TEST_F(LogBlockManagerTest, TestCompactFullContainerMetadataAtRuntime) {
+  FLAGS_log_container_live_metadata_before_compact_ratio = 0.50;
+  FLAGS_log_container_max_blocks = 100;
+  const int kNumContainers = 10;
+
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity = METRIC_ENTITY_server.Instantiate(&registry, "test");
+  ASSERT_OK(ReopenBlockManager(entity));
+
+  // Fill up several containers, and pick the blocks to delete.
+  vector<BlockId> live_block_ids;
+  vector<BlockId> dead_block_ids;
+  for (int i = 0; i < kNumContainers * FLAGS_log_container_max_blocks; i++) {
+    unique_ptr<WritableBlock> block;
+    ASSERT_OK(bm_->CreateBlock(test_block_opts_, &block));
+    ASSERT_OK(block->Append("a"));
+    ASSERT_OK(block->Close());
+    if (i % 4 == 0) {
+      live_block_ids.emplace_back(block->id());
+    } else {
+      dead_block_ids.emplace_back(block->id());
+    }
+  }
+  NO_FATALS(AssertNumContainers(kNumContainers));
+  ASSERT_EQ(0, bm_->CountDeadRecordsToCompact());
+
+  // Delete the blocks from another thread while compacting.
+  AtomicBool deleting(true);
+  std::thread deleter([&]() {
+    for (const auto& id : dead_block_ids) {
+      shared_ptr<BlockDeletionTransaction> deletion_transaction =
+          bm_->NewDeletionTransaction();
+      deletion_transaction->AddDeletedBlock(id);
+      vector<BlockId> deleted;
+      CHECK_OK(deletion_transaction->CommitDeletedBlocks(&deleted));
+    }
+    deleting.Store(false);
+  });
+  Status s;
+  while (s.ok() && deleting.Load()) {
+    s = bm_->CompactContainersMetadata();
+  }
+  deleter.join();
+  ASSERT_OK(s);
+  ASSERT_OK(bm_->CompactContainersMetadata());
+  ASSERT_EQ(0, bm_->CountDeadRecordsToCompact());
+  // The last container may not be full, and then isn't compacted.
+  ASSERT_GE(down_cast<Counter*>(
+      entity->FindOrNull(METRIC_log_block_manager_metadata_files_compacted).get())->value(),
+      kNumContainers - 1);
+
+  // No block record was lost by the compactions, and only the live blocks
+  // are found.
+  FsReport report;
+  ASSERT_OK(ReopenBlockManager(nullptr, &report));
+  NO_FATALS(AssertEmptyReport(report));
+  ASSERT_EQ(live_block_ids.size(), report.stats.live_block_count);
+  for (const auto& id : live_block_ids) {
+    unique_ptr<ReadableBlock> block;
+    ASSERT_OK(bm_->OpenBlock(id, &block));
+  }
+  for (const auto& id : dead_block_ids) {
+    unique_ptr<ReadableBlock> block;
+    ASSERT_TRUE(bm_->OpenBlock(id, &block).IsNotFound());
+  }
+}
+
+// Tests that the maintenance op registered by the block manager compacts
+// container metadata files once enabled.
+TEST_F(LogBlockManagerTest, TestCompactMetadataMaintenanceOp) {
+  FLAGS_log_container_max_blocks = 10;
+
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity = METRIC_ENTITY_server.Instantiate(&registry, "test");
+  ASSERT_OK(ReopenBlockManager(entity));
+  MaintenanceManager::Options options;
+  options.num_threads = 1;
+  options.polling_interval_ms = 1;
+  options.history_size = 8;
+  shared_ptr<MaintenanceManager> maintenance_manager(
+      new MaintenanceManager(options, "test"));
+  ASSERT_OK(maintenance_manager->Start());
+  SCOPED_CLEANUP({
+    maintenance_manager->Shutdown();
+    bm_.reset();
+  });
+  bm_->RegisterMaintenanceOps(maintenance_manager.get());
+
+  // Fill up a container, and delete most of its blocks.
+  shared_ptr<BlockDeletionTransaction> deletion_transaction = bm_->NewDeletionTransaction();
+  for (int i = 0; i < FLAGS_log_container_max_blocks; i++) {
+    unique_ptr<WritableBlock> block;
+    ASSERT_OK(bm_->CreateBlock(test_block_opts_, &block));
+    ASSERT_OK(block->Close());
+    if (i > 0) {
+      deletion_transaction->AddDeletedBlock(block->id());
+    }
+  }
+  vector<BlockId> deleted;
+  ASSERT_OK(deletion_transaction->CommitDeletedBlocks(&deleted));
+  ASSERT_EQ(FLAGS_log_container_max_blocks - 1, bm_->CountDeadRecordsToCompact());
+
+  FLAGS_log_container_compact_metadata_at_runtime = true;
+  ASSERT_EVENTUALLY([&]() {
+    ASSERT_EQ(0, bm_->CountDeadRecordsToCompact());
+  });
+  ASSERT_EQ(1, down_cast<Counter*>(
+      entity->FindOrNull(METRIC_log_block_manager_metadata_files_compacted).get())->value());
+}
+
 // Regression test for a bug in which, after a metadata file was compacted,
 // we would not properly handle appending to the new (post-compaction) metadata.
 //
@@ -36,6 +36,7 @@
 #include <gflags/gflags.h>
 #include <gflags/gflags_declare.h>
 #include <glog/logging.h>
+#include <google/protobuf/message.h>
 
 #include "kudu/fs/block_manager_metrics.h"
 #include "kudu/fs/block_manager_util.h"
@@ -47,6 +48,7 @@
 #include "kudu/gutil/bind_helpers.h"
 #include "kudu/gutil/callback.h"
 #include "kudu/gutil/casts.h"
+#include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/numbers.h"
@@ -61,6 +63,7 @@
 #include "kudu/util/file_cache.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/maintenance_manager.h"
 #include "kudu/util/malloc.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
@@ -68,10 +71,13 @@
 #include "kudu/util/pb_util.h"
 #include "kudu/util/random.h"
 #include "kudu/util/random_util.h"
+#include "kudu/util/rate_limiter.h"
+#include "kudu/util/rw_mutex.h"
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/sorted_disjoint_interval_list.h"
 #include "kudu/util/test_util_prod.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/trace.h"
 
 DECLARE_bool(enable_data_block_fsync);
@@ -93,6 +99,19 @@ DEFINE_uint64(log_container_preallocate_bytes, 32LU * 1024 * 1024,
               "creating new blocks. Set to 0 to disable preallocation");
 TAG_FLAG(log_container_preallocate_bytes, advanced);
 
+DEFINE_uint64(log_container_max_preallocate_bytes, 256LU * 1024 * 1024,
+              "Maximum number of bytes to preallocate at once in a log container. "
+              "A container that is written to quickly grows its preallocation "
+              "window from --log_container_preallocate_bytes up to this size, "
+              "bounded by the space left before it reaches "
+              "--log_container_max_size, so that large writes such as flushes "
+              "and compactions end up in fewer, larger extents. Set it to "
+              "--log_container_preallocate_bytes or less to always preallocate "
+              "a fixed amount.");
+TAG_FLAG(log_container_max_preallocate_bytes, advanced);
+TAG_FLAG(log_container_max_preallocate_bytes, experimental);
+TAG_FLAG(log_container_max_preallocate_bytes, runtime);
+
 DEFINE_double(log_container_excess_space_before_cleanup_fraction, 0.10,
               "Additional fraction of a log container's calculated size that "
               "must be consumed on disk before the container is considered to "
@@ -103,9 +122,47 @@ TAG_FLAG(log_container_excess_space_before_cleanup_fraction, advanced);
 DEFINE_double(log_container_live_metadata_before_compact_ratio, 0.50,
               "Desired ratio of live block metadata in log containers. If a "
               "container's live to total block ratio dips below this value, "
-              "the container's metadata file will be compacted at startup.");
+              "the container's metadata file will be compacted at startup, and "
+              "at runtime if --log_container_compact_metadata_at_runtime is set.");
 TAG_FLAG(log_container_live_metadata_before_compact_ratio, experimental);
 
+DEFINE_bool(log_container_compact_metadata_at_runtime, false,
+            "When enabled, the metadata files of full log block containers whose "
+            "live to total block ratio dips below "
+            "--log_container_live_metadata_before_compact_ratio are compacted by a "
+            "background maintenance operation, instead of only at startup.");
+TAG_FLAG(log_container_compact_metadata_at_runtime, experimental);
+TAG_FLAG(log_container_compact_metadata_at_runtime, runtime);
+
+DEFINE_bool(log_block_manager_drop_page_cache, false,
+            "Whether to drop the data of log block containers from the OS page "
+            "cache once it has been written and synced, and once it has been read. "
+            "The block cache then holds the only cached copy of block data, and "
+            "large writes such as compactions don't evict other data from the page "
+            "cache.");
+TAG_FLAG(log_block_manager_drop_page_cache, experimental);
+TAG_FLAG(log_block_manager_drop_page_cache, runtime);
+
+DEFINE_int32(log_container_open_threads_per_data_dir, 4,
+             "Number of threads used to open the log block containers of each data "
+             "directory, i.e. to read their metadata files and to replay their block "
+             "records, at startup.");
+TAG_FLAG(log_container_open_threads_per_data_dir, advanced);
+DEFINE_validator(log_container_open_threads_per_data_dir,
+                 [](const char* /*n*/, int32_t v) { return v > 0; });
+
+DEFINE_int32(log_container_hole_punch_rate_limit_per_sec, 0,
+             "Maximum number of holes punched per second in the log block containers "
+             "of each data directory when blocks are deleted. Deleting many blocks "
+             "at once, e.g. after a large compaction or a tablet deletion, otherwise "
+             "issues a burst of hole punches that can stall other IO on the disk. "
+             "0 means unlimited.");
+TAG_FLAG(log_container_hole_punch_rate_limit_per_sec, advanced);
+TAG_FLAG(log_container_hole_punch_rate_limit_per_sec, experimental);
+TAG_FLAG(log_container_hole_punch_rate_limit_per_sec, runtime);
+DEFINE_validator(log_container_hole_punch_rate_limit_per_sec,
+                 [](const char* /*n*/, int32_t v) { return v >= 0; });
+
 DEFINE_bool(log_block_manager_test_hole_punching, true,
             "Ensure hole punching is supported by the underlying filesystem");
 TAG_FLAG(log_block_manager_test_hole_punching, advanced);
@@ -148,6 +205,24 @@ METRIC_DEFINE_counter(server, log_block_manager_dead_containers_deleted,
                       kudu::MetricUnit::kLogBlockContainers,
                       "Number of full (but dead) block containers that were deleted");
 
+METRIC_DEFINE_counter(server, log_block_manager_metadata_files_compacted,
+                      "Number of Block Container Metadata Files Compacted",
+                      kudu::MetricUnit::kLogBlockContainers,
+                      "Number of block container metadata files that were compacted "
+                      "at runtime since service start");
+
+METRIC_DEFINE_histogram(server, log_block_manager_compact_metadata_duration,
+                        "Block Container Metadata Compaction Duration",
+                        kudu::MetricUnit::kMilliseconds,
+                        "Time spent compacting the metadata files of block containers "
+                        "at runtime.",
+                        60000LU, 1);
+
+METRIC_DEFINE_gauge_uint32(server, log_block_manager_compact_metadata_running,
+                           "Block Container Metadata Compactions Running",
+                           kudu::MetricUnit::kMaintenanceOperations,
+                           "Number of block container metadata compactions currently running.");
+
 namespace kudu {
 
 namespace fs {
@@ -169,6 +244,28 @@ using std::unordered_set;
 using std::vector;
 using strings::Substitute;
 
+namespace {
+
+// Sorts block records such that their ordering reflects the ordering in the
+// metadata file they were read from.
+void SortBlockRecords(vector<BlockRecordPB>* records) {
+  std::sort(records->begin(), records->end(),
+            [](const BlockRecordPB& a, const BlockRecordPB& b) {
+    // Sort by timestamp.
+    if (a.timestamp_us() != b.timestamp_us()) {
+      return a.timestamp_us() < b.timestamp_us();
+    }
+
+    // If the timestamps match, sort by offset.
+    //
+    // If the offsets also match (i.e. both blocks are of zero length),
+    // it doesn't matter which of the two records comes first.
+    return a.offset() < b.offset();
+  });
+}
+
+} // anonymous namespace
+
 namespace internal {
 
 ////////////////////////////////////////////////////////////
@@ -193,6 +290,7 @@ struct LogBlockManagerMetrics {
 
   scoped_refptr<Counter> holes_punched;
   scoped_refptr<Counter> dead_containers_deleted;
+  scoped_refptr<Counter> metadata_files_compacted;
 };
 
 #define MINIT(x) x(METRIC_log_block_manager_##x.Instantiate(metric_entity))
@@ -204,7 +302,8 @@ LogBlockManagerMetrics::LogBlockManagerMetrics(const scoped_refptr<MetricEntity>
     GINIT(containers),
     GINIT(full_containers),
     MINIT(holes_punched),
-    MINIT(dead_containers_deleted) {
+    MINIT(dead_containers_deleted),
+    MINIT(metadata_files_compacted) {
 }
 #undef GINIT
 
@@ -311,6 +410,8 @@ class LogWritableBlock : public WritableBlock {
 
   LogBlockContainer* container() const { return container_.get(); }
 
+  int64_t block_offset() const { return block_offset_; }
+
  private:
   // The owning container.
   LogBlockContainerRefPtr container_;
@@ -400,6 +501,9 @@ class LogBlockContainer: public RefCountedThreadSafe<LogBlockContainer> {
   // block must be provided in 'block_start_offset' (since container
   // bookkeeping is only updated when a block is finished).
   //
+  // The amount preallocated adapts to the container's write rate: see
+  // NextPreallocationLength().
+  //
   // Does nothing if preallocation is disabled.
   Status EnsurePreallocated(int64_t block_start_offset,
                             size_t next_append_length);
@@ -416,17 +520,39 @@ class LogBlockContainer: public RefCountedThreadSafe<LogBlockContainer> {
   // See RWFile::ReadV().
   Status ReadVData(int64_t offset, ArrayView<Slice> results) const;
 
+  // Hints that 'length' bytes of the container's data file starting at
+  // 'offset' will be read soon.
+  Status ReadaheadData(int64_t offset, size_t length) const;
+
+  // Maps 'length' bytes of the container's data file starting at 'offset'
+  // into memory for reading. See RWFile::MapForRead().
+  Status MapData(int64_t offset, size_t length, unique_ptr<MappedRegion>* region) const;
+
+  // Hints that 'length' bytes of the container's data file starting at
+  // 'offset' may be dropped from the page cache, if
+  // --log_block_manager_drop_page_cache is set.
+  void DropDataFromPageCache(int64_t offset, size_t length) const;
+
   // Appends 'pb' to this container's metadata file.
   //
   // The on-disk effects of this call are made durable only after SyncMetadata().
   Status AppendMetadata(const BlockRecordPB& pb);
 
+  // Appends all of 'pbs' to this container's metadata file in a single write.
+  //
+  // On failure, some prefix of 'pbs' may have been written. The on-disk
+  // effects of this call are made durable only after SyncMetadata().
+  Status AppendMetadata(const vector<BlockRecordPB>& pbs);
+
   // Asynchronously flush this container's data file from 'offset' through
   // to 'length'.
   //
   // Does not guarantee data durability; use SyncData() for that.
   Status FlushData(int64_t offset, int64_t length);
 
+  // Accounts a sync of one of this container's files that took 'latency'.
+  void RecordSyncLatency(const MonoDelta& latency);
+
   // Asynchronously flush this container's metadata file (all dirty bits).
   //
   // Does not guarantee metadata durability; use SyncMetadata() for that.
@@ -450,6 +576,22 @@ class LogBlockContainer: public RefCountedThreadSafe<LogBlockContainer> {
   // file was changed.
   Status ReopenMetadataWriter();
 
+  // Rewrites this container's metadata file with only the records of its live
+  // blocks, if NeedsMetadataCompaction() still holds.
+  //
+  // The live records are read back from the metadata file itself while no
+  // other record may be appended to it, so this is safe with respect to
+  // concurrent block creations and deletions: a block whose DELETE record is
+  // not appended yet keeps its CREATE record in the new file.
+  //
+  // On success, 'compacted' is set to whether the file was rewritten and, if
+  // so, 'file_bytes_delta' to the number of bytes saved.
+  Status CompactMetadata(bool* compacted, int64_t* file_bytes_delta);
+
+  // Returns whether this container is full and so few of its block records
+  // are still live that its metadata file should be compacted at runtime.
+  bool NeedsMetadataCompaction() const;
+
   // Truncates this container's data file to 'next_block_offset_' if it is
   // full. This effectively removes any preallocated but unused space.
   //
@@ -527,6 +669,7 @@ class LogBlockContainer: public RefCountedThreadSafe<LogBlockContainer> {
   int64_t live_bytes() const { return live_bytes_.Load(); }
   int64_t live_bytes_aligned() const { return live_bytes_aligned_.Load(); }
   int64_t live_blocks() const { return live_blocks_.Load(); }
+  int64_t metadata_create_records() const { return metadata_create_records_.Load(); }
   int32_t blocks_being_written() const { return blocks_being_written_.Load(); }
   bool full() const {
     return next_block_offset() >= FLAGS_log_container_max_size ||
@@ -535,8 +678,19 @@ class LogBlockContainer: public RefCountedThreadSafe<LogBlockContainer> {
   bool dead() const { return dead_.Load(); }
   const LogBlockManagerMetrics* metrics() const { return metrics_; }
   DataDir* data_dir() const { return data_dir_; }
+
+  // The tablet that most recently took this container for writing. Protected
+  // by the block manager's lock.
+  const string& last_tablet_id() const { return last_tablet_id_; }
+  void set_last_tablet_id(const string& tablet_id) { last_tablet_id_ = tablet_id; }
   const PathInstanceMetadataPB* instance() const { return data_dir_->instance()->metadata(); }
 
+  // Sets the number of CREATE records in the metadata file, e.g. after it
+  // was rewritten with the live block records only.
+  void set_metadata_create_records(int64_t records) {
+    metadata_create_records_.Store(records);
+  }
+
   // Adjusts the number of blocks being written.
   // Positive means increase, negative means decrease.
   int32_t blocks_being_written_incr(int32_t value) {
@@ -635,13 +789,37 @@ class LogBlockContainer: public RefCountedThreadSafe<LogBlockContainer> {
 
   const boost::optional<int64_t> max_num_blocks_;
 
+  // Returns the number of bytes to preallocate at 'offset', and updates the
+  // preallocation window. The window doubles, up to
+  // --log_container_max_preallocate_bytes, when the previous window was used
+  // up quickly, and shrinks back towards --log_container_preallocate_bytes
+  // when it was used up slowly. The window is never extended past
+  // --log_container_max_size, the container's expected final size.
+  //
+  // This function is thread unsafe.
+  int64_t NextPreallocationLength(int64_t offset);
+
   // Offset up to which we have preallocated bytes.
   int64_t preallocated_offset_ = 0;
 
+  // See last_tablet_id().
+  string last_tablet_id_;
+
+  // Size of the current preallocation window, and when it was preallocated.
+  // Zero until the container first preallocates after being created or
+  // loaded.
+  int64_t preallocation_window_ = 0;
+  MonoTime last_preallocation_time_;
+
   // Opened file handles to the container's files.
   unique_ptr<WritablePBContainerFile> metadata_file_;
   shared_ptr<RWFile> data_file_;
 
+  // Protects 'metadata_file_' from being replaced by CompactMetadata() while
+  // it is in use. Held in shared mode to append records to the metadata file
+  // or to flush or sync it, and exclusively to compact it.
+  mutable RWMutex metadata_lock_;
+
   // The offset of the next block to be written to the container.
   AtomicInt<int64_t> next_block_offset_;
 
@@ -661,6 +839,10 @@ class LogBlockContainer: public RefCountedThreadSafe<LogBlockContainer> {
   // The number of not-yet-deleted blocks in the container.
   AtomicInt<int64_t> live_blocks_;
 
+  // The number of CREATE records in the container's metadata file. Unlike
+  // 'total_blocks_', it drops when the metadata file is compacted.
+  AtomicInt<int64_t> metadata_create_records_;
+
   // The number of LogWritableBlocks currently open for this container.
   AtomicInt<int32_t> blocks_being_written_;
 
@@ -704,6 +886,7 @@ LogBlockContainer::LogBlockContainer(
       live_bytes_(0),
       live_bytes_aligned_(0),
       live_blocks_(0),
+      metadata_create_records_(0),
       blocks_being_written_(0),
       dead_(false),
       metrics_(block_manager->metrics()) {
@@ -948,6 +1131,9 @@ Status LogBlockContainer::ProcessRecords(
     if (!read_status.ok()) {
       break;
     }
+    if (record.op_type() == CREATE) {
+      metadata_create_records_.Increment();
+    }
     RETURN_NOT_OK(ProcessRecord(&record, report,
                                 live_blocks, live_block_records, dead_blocks,
                                 &data_file_size, max_block_id));
@@ -1070,6 +1256,10 @@ Status LogBlockContainer::DoCloseBlocks(const vector<LogWritableBlock*>& blocks,
       VLOG(3) << "Syncing data file " << data_file_->filename();
       RETURN_NOT_OK(SyncData());
     }
+    // Unsynced pages are only dropped once the OS writes them back.
+    for (const auto* block : blocks) {
+      DropDataFromPageCache(block->block_offset(), block->BytesAppended());
+    }
 
     // Append metadata only after data is synced so that there's
     // no chance of metadata landing on the disk before the data.
@@ -1079,7 +1269,8 @@ Status LogBlockContainer::DoCloseBlocks(const vector<LogWritableBlock*>& blocks,
     }
 
     if (mode == SYNC) {
-      VLOG(3) << "Syncing metadata file " << metadata_file_->filename();
+      VLOG(3) << "Syncing metadata file "
+              << StrCat(ToString(), LogBlockManager::kContainerMetadataFileSuffix);
       RETURN_NOT_OK(SyncMetadata());
     }
 
@@ -1142,19 +1333,68 @@ Status LogBlockContainer::WriteVData(int64_t offset, ArrayView<const Slice> data
 Status LogBlockContainer::ReadData(int64_t offset, Slice result) const {
   DCHECK_GE(offset, 0);
   RETURN_NOT_OK_HANDLE_ERROR(data_file_->Read(offset, result));
+  DropDataFromPageCache(offset, result.size());
   return Status::OK();
 }
 Status LogBlockContainer::ReadVData(int64_t offset, ArrayView<Slice> results) const {
   DCHECK_GE(offset, 0);
   RETURN_NOT_OK_HANDLE_ERROR(data_file_->ReadV(offset, results));
+  size_t length = 0;
+  for (const auto& result : results) {
+    length += result.size();
+  }
+  DropDataFromPageCache(offset, length);
   return Status::OK();
 }
 
+Status LogBlockContainer::ReadaheadData(int64_t offset, size_t length) const {
+  DCHECK_GE(offset, 0);
+  RETURN_NOT_OK_HANDLE_ERROR(data_file_->Readahead(offset, length));
+  return Status::OK();
+}
+
+Status LogBlockContainer::MapData(int64_t offset, size_t length,
+                                  unique_ptr<MappedRegion>* region) const {
+  DCHECK_GE(offset, 0);
+  RETURN_NOT_OK_HANDLE_ERROR(data_file_->MapForRead(offset, length, region));
+  return Status::OK();
+}
+
+void LogBlockContainer::DropDataFromPageCache(int64_t offset, size_t length) const {
+  DCHECK_GE(offset, 0);
+  if (!FLAGS_log_block_manager_drop_page_cache) {
+    return;
+  }
+  // The data is still on disk, so failing to drop it is harmless.
+  WARN_NOT_OK(data_file_->DropCache(offset, length),
+              Substitute("could not drop data of container $0 from the page cache",
+                         ToString()));
+}
+
 Status LogBlockContainer::AppendMetadata(const BlockRecordPB& pb) {
   RETURN_NOT_OK_HANDLE_ERROR(read_only_status());
+  shared_lock<RWMutex> l(metadata_lock_);
   // Note: We don't check for sufficient disk space for metadata writes in
   // order to allow for block deletion on full disks.
   RETURN_NOT_OK_HANDLE_ERROR(metadata_file_->Append(pb));
+  if (pb.op_type() == CREATE) {
+    metadata_create_records_.Increment();
+  }
+  return Status::OK();
+}
+
+Status LogBlockContainer::AppendMetadata(const vector<BlockRecordPB>& pbs) {
+  RETURN_NOT_OK_HANDLE_ERROR(read_only_status());
+  vector<const google::protobuf::Message*> msgs;
+  msgs.reserve(pbs.size());
+  int64_t num_creates = 0;
+  for (const auto& pb : pbs) {
+    msgs.push_back(&pb);
+    if (pb.op_type() == CREATE) num_creates++;
+  }
+  shared_lock<RWMutex> l(metadata_lock_);
+  RETURN_NOT_OK_HANDLE_ERROR(metadata_file_->AppendMany(msgs));
+  metadata_create_records_.IncrementBy(num_creates);
   return Status::OK();
 }
 
@@ -1168,6 +1408,7 @@ Status LogBlockContainer::FlushData(int64_t offset, int64_t length) {
 
 Status LogBlockContainer::FlushMetadata() {
   RETURN_NOT_OK_HANDLE_ERROR(read_only_status());
+  shared_lock<RWMutex> l(metadata_lock_);
   RETURN_NOT_OK_HANDLE_ERROR(metadata_file_->Flush());
   return Status::OK();
 }
@@ -1176,20 +1417,32 @@ Status LogBlockContainer::SyncData() {
   RETURN_NOT_OK_HANDLE_ERROR(read_only_status());
   if (FLAGS_enable_data_block_fsync) {
     if (metrics_) metrics_->generic_metrics.total_disk_sync->Increment();
+    MonoTime start = MonoTime::Now();
     RETURN_NOT_OK_HANDLE_ERROR(data_file_->Sync());
+    RecordSyncLatency(MonoTime::Now() - start);
   }
   return Status::OK();
 }
 
 Status LogBlockContainer::SyncMetadata() {
   RETURN_NOT_OK_HANDLE_ERROR(read_only_status());
+  shared_lock<RWMutex> l(metadata_lock_);
   if (FLAGS_enable_data_block_fsync) {
     if (metrics_) metrics_->generic_metrics.total_disk_sync->Increment();
+    MonoTime start = MonoTime::Now();
     RETURN_NOT_OK_HANDLE_ERROR(metadata_file_->Sync());
+    RecordSyncLatency(MonoTime::Now() - start);
   }
   return Status::OK();
 }
 
+void LogBlockContainer::RecordSyncLatency(const MonoDelta& latency) {
+  if (metrics_) {
+    metrics_->generic_metrics.sync_latency->Increment(latency.ToMicroseconds());
+  }
+  data_dir_->RecordSync(latency);
+}
+
 Status LogBlockContainer::ReopenMetadataWriter() {
   shared_ptr<RWFile> f;
   RETURN_NOT_OK_HANDLE_ERROR(block_manager_->file_cache_.OpenExistingFile(
@@ -1203,6 +1456,79 @@ Status LogBlockContainer::ReopenMetadataWriter() {
   return Status::OK();
 }
 
+bool LogBlockContainer::NeedsMetadataCompaction() const {
+  if (!full() || dead() || read_only()) {
+    return false;
+  }
+  int64_t records = metadata_create_records();
+  return live_blocks() < records &&
+      static_cast<double>(live_blocks()) / records <=
+      FLAGS_log_container_live_metadata_before_compact_ratio;
+}
+
+Status LogBlockContainer::CompactMetadata(bool* compacted, int64_t* file_bytes_delta) {
+  std::lock_guard<RWMutex> l(metadata_lock_);
+  *compacted = false;
+  // Another compaction may have run since the container was picked.
+  if (!NeedsMetadataCompaction()) {
+    return Status::OK();
+  }
+
+  unique_ptr<RandomAccessFile> metadata_reader;
+  RETURN_NOT_OK_HANDLE_ERROR(block_manager()->env()->NewRandomAccessFile(
+      metadata_file_->filename(), &metadata_reader));
+  ReadablePBContainerFile pb_reader(std::move(metadata_reader));
+  RETURN_NOT_OK_HANDLE_ERROR(pb_reader.Open());
+
+  LogBlockManager::BlockRecordMap live_block_records;
+  Status read_status;
+  while (true) {
+    BlockRecordPB record;
+    read_status = pb_reader.ReadNextPB(&record);
+    if (!read_status.ok()) {
+      break;
+    }
+    const BlockId block_id(BlockId::FromPB(record.block_id()));
+    if (record.op_type() == CREATE) {
+      live_block_records[block_id].Swap(&record);
+    } else if (record.op_type() == DELETE) {
+      live_block_records.erase(block_id);
+    }
+  }
+  if (PREDICT_FALSE(!read_status.IsEndOfFile())) {
+    HandleError(read_status);
+    return read_status;
+  }
+
+  vector<BlockRecordPB> records(live_block_records.size());
+  int i = 0;
+  for (auto& e : live_block_records) {
+    records[i].Swap(&e.second);
+    i++;
+  }
+  SortBlockRecords(&records);
+  RETURN_NOT_OK(block_manager_->RewriteMetadataFile(*this, records, file_bytes_delta));
+
+  // The old metadata file is gone and its descriptor was invalidated, so new
+  // records can't be appended to this container if any of the following fails.
+  Status s = ReopenMetadataWriter();
+  if (s.ok() && FLAGS_enable_data_block_fsync) {
+    // Without this, the old metadata file may reappear after a crash, and it
+    // lacks the records appended to the new one.
+    if (metrics_) metrics_->generic_metrics.total_disk_sync->Increment();
+    s = block_manager()->env()->SyncDir(data_dir_->dir());
+    HandleError(s);
+  }
+  if (PREDICT_FALSE(!s.ok())) {
+    s = s.CloneAndPrepend("could not reopen compacted metadata file");
+    SetReadOnly(s);
+    return s;
+  }
+  metadata_create_records_.Store(records.size());
+  *compacted = true;
+  return Status::OK();
+}
+
 Status LogBlockContainer::EnsurePreallocated(int64_t block_start_offset,
                                              size_t next_append_length) {
   RETURN_NOT_OK_HANDLE_ERROR(read_only_status());
@@ -1217,7 +1543,7 @@ Status LogBlockContainer::EnsurePreallocated(int64_t block_start_offset,
   if (block_start_offset > preallocated_offset_ ||
       next_append_length > preallocated_offset_ - block_start_offset) {
     int64_t off = std::max(preallocated_offset_, block_start_offset);
-    int64_t len = FLAGS_log_container_preallocate_bytes;
+    int64_t len = NextPreallocationLength(off);
     RETURN_NOT_OK_HANDLE_ERROR(data_file_->PreAllocate(off, len, RWFile::CHANGE_FILE_SIZE));
     RETURN_NOT_OK_HANDLE_ERROR(data_dir_->RefreshIsFull(DataDir::RefreshMode::ALWAYS));
     VLOG(2) << Substitute("Preallocated $0 bytes at offset $1 in container $2",
@@ -1229,6 +1555,35 @@ Status LogBlockContainer::EnsurePreallocated(int64_t block_start_offset,
   return Status::OK();
 }
 
+int64_t LogBlockContainer::NextPreallocationLength(int64_t offset) {
+  // A window used up faster than this indicates a heavy writer, such as a
+  // flush or compaction, and a window used up slower than this a light one.
+  static const MonoDelta kFastWindowConsumption = MonoDelta::FromSeconds(1);
+  static const MonoDelta kSlowWindowConsumption = MonoDelta::FromSeconds(30);
+
+  const int64_t min_len = FLAGS_log_container_preallocate_bytes;
+  const int64_t max_len = std::max(min_len,
+      static_cast<int64_t>(FLAGS_log_container_max_preallocate_bytes));
+  MonoTime now = MonoTime::Now();
+  if (preallocation_window_ == 0) {
+    preallocation_window_ = min_len;
+  } else {
+    MonoDelta elapsed = now - last_preallocation_time_;
+    if (elapsed < kFastWindowConsumption) {
+      preallocation_window_ = std::min(preallocation_window_ * 2, max_len);
+    } else if (elapsed > kSlowWindowConsumption) {
+      preallocation_window_ = std::max(preallocation_window_ / 2, min_len);
+    }
+  }
+  preallocation_window_ = std::max(std::min(preallocation_window_, max_len), min_len);
+  last_preallocation_time_ = now;
+
+  // Don't grow past the point where the container will be considered full,
+  // but never preallocate less than the configured minimum.
+  int64_t remaining = static_cast<int64_t>(FLAGS_log_container_max_size) - offset;
+  return std::max(min_len, std::min(preallocation_window_, remaining));
+}
+
 void LogBlockContainer::FinalizeBlock(int64_t block_offset, int64_t block_length) {
   // Updates this container's next block offset before marking it as available
   // to ensure thread safety while updating internal bookkeeping state.
@@ -1318,6 +1673,7 @@ void LogBlockContainer::ContainerDeletionAsync(int64_t offset, int64_t length) {
     return;
   }
 
+  block_manager()->ThrottleHolePunch(data_dir());
   VLOG(3) << "Freeing space belonging to container " << ToString();
   Status s = PunchHole(offset, length);
   if (s.ok() && metrics_) metrics_->holes_punched->Increment();
@@ -1577,6 +1933,7 @@ Status LogWritableBlock::Abort() {
         container_->metrics()->generic_metrics.total_bytes_written->IncrementBy(
             block_length_);
       }
+      container_->data_dir()->RecordWrite(block_length_);
     }
     return container_->read_only_status().CloneAndPrepend(
         Substitute("container $0 is read-only", container_->ToString()));
@@ -1646,6 +2003,7 @@ Status LogWritableBlock::AppendV(ArrayView<const Slice> data) {
   int64_t cur_block_offset = block_offset_ + block_length_;
   RETURN_NOT_OK(container_->EnsurePreallocated(cur_block_offset, data_size));
 
+  container_->data_dir()->ThrottleWrite(data_size);
   MicrosecondsInt64 start_time = GetMonoTimeMicros();
   RETURN_NOT_OK(container_->WriteVData(cur_block_offset, data));
   MicrosecondsInt64 end_time = GetMonoTimeMicros();
@@ -1682,9 +2040,14 @@ Status LogWritableBlock::Finalize() {
   VLOG(3) << "Finalizing block " << id();
   if (state_ == DIRTY &&
       FLAGS_block_manager_preflush_control == "finalize") {
+    MonoTime start = MonoTime::Now();
     // We do not mark the container as read-only if FlushDataAsync() fails
     // since the corresponding metadata has not yet been appended.
     RETURN_NOT_OK(FlushDataAsync());
+    if (container_->metrics()) {
+      container_->metrics()->generic_metrics.finalize_latency->Increment(
+          (MonoTime::Now() - start).ToMicroseconds());
+    }
   }
 
   return Status::OK();
@@ -1707,6 +2070,7 @@ void LogWritableBlock::DoClose() {
         block_length_);
     container_->metrics()->generic_metrics.total_blocks_created->Increment();
   }
+  container_->data_dir()->RecordWrite(block_length_);
 
   // Finalize() was not called; this indicates we should
   // finalize the block.
@@ -1756,6 +2120,10 @@ class LogReadableBlock : public ReadableBlock {
 
   virtual Status ReadV(uint64_t offset, ArrayView<Slice> results) const OVERRIDE;
 
+  virtual Status Readahead(uint64_t offset, size_t length) const OVERRIDE;
+
+  virtual Status MapForRead(unique_ptr<MappedRegion>* region) const OVERRIDE;
+
   virtual size_t memory_footprint() const OVERRIDE;
 
  private:
@@ -1837,20 +2205,102 @@ Status LogReadableBlock::ReadV(uint64_t offset, ArrayView<Slice> results) const
 
   int64_t dur = end_time - start_time;
   TRACE_COUNTER_INCREMENT("lbm_read_time_us", dur);
+  log_block_->container()->data_dir()->RecordRead(read_length,
+                                                  MonoDelta::FromMicroseconds(dur));
 
   const char* counter = BUCKETED_COUNTER_NAME("lbm_reads", dur);
   TRACE_COUNTER_INCREMENT(counter, 1);
 
   if (log_block_->container()->metrics()) {
-    log_block_->container()->metrics()->generic_metrics.total_bytes_read->IncrementBy(read_length);
+    const BlockManagerMetrics* metrics = &log_block_->container()->metrics()->generic_metrics;
+    metrics->total_bytes_read->IncrementBy(read_length);
+    metrics->total_read_ops->Increment();
+    metrics->read_latency->Increment(dur);
   }
   return Status::OK();
 }
 
+Status LogReadableBlock::Readahead(uint64_t offset, size_t length) const {
+  DCHECK(!closed_.Load());
+
+  if (offset >= log_block_->length()) {
+    return Status::OK();
+  }
+  length = std::min<uint64_t>(length, log_block_->length() - offset);
+  return log_block_->container()->ReadaheadData(log_block_->offset() + offset, length);
+}
+
+Status LogReadableBlock::MapForRead(unique_ptr<MappedRegion>* region) const {
+  DCHECK(!closed_.Load());
+
+  if (log_block_->length() == 0) {
+    return Status::NotSupported("cannot map an empty block", id().ToString());
+  }
+  // The block holds a reference to its LogBlock, so its space isn't punched
+  // out of the container until it's closed.
+  return log_block_->container()->MapData(log_block_->offset(), log_block_->length(), region);
+}
+
 size_t LogReadableBlock::memory_footprint() const {
   return kudu_malloc_usable_size(this);
 }
 
+////////////////////////////////////////////////////////////
+// LogBlockManagerCompactMetadataOp
+////////////////////////////////////////////////////////////
+
+// Maintenance op that compacts the metadata files of the full containers
+// with few live blocks, so that they need not wait for the next startup.
+class LogBlockManagerCompactMetadataOp : public MaintenanceOp {
+ public:
+  // A rough size of a block record in a metadata file, used to estimate the
+  // space that compactions would reclaim.
+  static const int64_t kEstimatedBlockRecordBytes = 48;
+
+  LogBlockManagerCompactMetadataOp(LogBlockManager* lbm,
+                                   const scoped_refptr<MetricEntity>& metric_entity)
+      : MaintenanceOp("LogBlockManagerCompactMetadataOp", MaintenanceOp::LOW_IO_USAGE),
+        lbm_(lbm),
+        duration_(METRIC_log_block_manager_compact_metadata_duration.Instantiate(
+            metric_entity)),
+        running_(METRIC_log_block_manager_compact_metadata_running.Instantiate(
+            metric_entity, 0)) {
+  }
+
+  void UpdateStats(MaintenanceOpStats* stats) override {
+    if (!FLAGS_log_container_compact_metadata_at_runtime) {
+      stats->set_runnable(false);
+      return;
+    }
+    // Each dead block has both a CREATE and a DELETE record.
+    int64_t dead_records = 2 * lbm_->CountDeadRecordsToCompact();
+    stats->set_runnable(dead_records > 0);
+    stats->set_data_retained_bytes(dead_records * kEstimatedBlockRecordBytes);
+  }
+
+  bool Prepare() override {
+    return true;
+  }
+
+  void Perform() override {
+    WARN_NOT_OK(lbm_->CompactContainersMetadata(),
+                "could not compact container metadata files");
+  }
+
+  scoped_refptr<Histogram> DurationHistogram() const override {
+    return duration_;
+  }
+
+  scoped_refptr<AtomicGauge<uint32_t>> RunningGauge() const override {
+    return running_;
+  }
+
+ private:
+  LogBlockManager* const lbm_;
+  scoped_refptr<Histogram> duration_;
+  scoped_refptr<AtomicGauge<uint32_t>> running_;
+};
+
 } // namespace internal
 
 ////////////////////////////////////////////////////////////
@@ -1906,6 +2356,11 @@ LogBlockManager::LogBlockManager(Env* env,
 }
 
 LogBlockManager::~LogBlockManager() {
+  // The op may be running; this waits for it to finish.
+  if (compact_metadata_op_) {
+    compact_metadata_op_->Unregister();
+  }
+
   // Release all of the memory accounted by the blocks.
   int64_t mem = 0;
   for (const auto& entry : blocks_by_block_id_) {
@@ -1928,6 +2383,9 @@ Status LogBlockManager::Open(FsReport* report) {
   // Establish (and log) block limits for each data directory using kernel,
   // filesystem, and gflags information.
   for (const auto& dd : dd_manager_->data_dirs()) {
+    hole_punch_limiters_by_data_dir_[dd.get()].reset(new RateLimiter(
+        FLAGS_log_container_hole_punch_rate_limit_per_sec, MonoDelta::FromSeconds(1)));
+
     boost::optional<int64_t> limit;
     if (FLAGS_log_container_max_blocks == -1) {
       // No limit, unless this is KUDU-1508.
@@ -2088,6 +2546,70 @@ void LogBlockManager::NotifyBlockId(BlockId block_id) {
   next_block_id_.StoreMax(block_id.id() + 1);
 }
 
+void LogBlockManager::RegisterMaintenanceOps(MaintenanceManager* maintenance_manager) {
+  // The op needs a metric entity for its duration and running metrics.
+  if (opts_.read_only || !opts_.metric_entity) {
+    return;
+  }
+  CHECK(!compact_metadata_op_);
+  compact_metadata_op_.reset(new internal::LogBlockManagerCompactMetadataOp(
+      this, opts_.metric_entity));
+  maintenance_manager->RegisterOp(compact_metadata_op_.get());
+}
+
+int64_t LogBlockManager::CountDeadRecordsToCompact() {
+  int64_t dead_records = 0;
+  std::lock_guard<simple_spinlock> l(lock_);
+  for (const auto& e : all_containers_by_name_) {
+    const LogBlockContainerRefPtr& container = e.second;
+    if (container->NeedsMetadataCompaction()) {
+      dead_records += container->metadata_create_records() - container->live_blocks();
+    }
+  }
+  return dead_records;
+}
+
+Status LogBlockManager::CompactContainersMetadata() {
+  vector<LogBlockContainerRefPtr> containers;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    for (const auto& e : all_containers_by_name_) {
+      if (e.second->NeedsMetadataCompaction()) {
+        containers.emplace_back(e.second);
+      }
+    }
+  }
+
+  Status first_error;
+  int64_t metadata_files_compacted = 0;
+  int64_t metadata_bytes_delta = 0;
+  for (const auto& container : containers) {
+    bool compacted;
+    int64_t file_bytes_delta;
+    Status s = container->CompactMetadata(&compacted, &file_bytes_delta);
+    if (!s.ok()) {
+      if (first_error.ok()) {
+        first_error = s.CloneAndPrepend(Substitute(
+            "could not compact metadata file of container $0", container->ToString()));
+      }
+      continue;
+    }
+    if (!compacted) {
+      continue;
+    }
+    metadata_files_compacted++;
+    metadata_bytes_delta += file_bytes_delta;
+    if (metrics_) metrics_->metadata_files_compacted->Increment();
+    VLOG(1) << "Compacted metadata file of container " << container->ToString()
+            << " (saved " << file_bytes_delta << " bytes)";
+  }
+  if (metadata_files_compacted > 0) {
+    LOG(INFO) << Substitute("Compacted $0 metadata files ($1 metadata bytes)",
+                            metadata_files_compacted, metadata_bytes_delta);
+  }
+  return first_error;
+}
+
 void LogBlockManager::AddNewContainerUnlocked(const LogBlockContainerRefPtr& container) {
   DCHECK(lock_.is_locked());
   InsertOrDie(&all_containers_by_name_, container->ToString(), container);
@@ -2137,8 +2659,21 @@ Status LogBlockManager::GetOrCreateContainer(const CreateBlockOptions& opts,
     std::lock_guard<simple_spinlock> l(lock_);
     auto& d = available_containers_by_data_dir_[DCHECK_NOTNULL(dir)];
     if (!d.empty()) {
-      *container = d.front();
-      d.pop_front();
+      // Prefer a container that this tablet wrote to last, so that its
+      // flush and compaction output stays physically contiguous on disk.
+      auto it = d.begin();
+      if (!opts.tablet_id.empty()) {
+        auto same_tablet = std::find_if(d.begin(), d.end(),
+            [&](const LogBlockContainerRefPtr& c) {
+              return c->last_tablet_id() == opts.tablet_id;
+            });
+        if (same_tablet != d.end()) {
+          it = same_tablet;
+        }
+      }
+      *container = *it;
+      d.erase(it);
+      (*container)->set_last_tablet_id(opts.tablet_id);
       return Status::OK();
     }
   }
@@ -2156,6 +2691,7 @@ Status LogBlockManager::GetOrCreateContainer(const CreateBlockOptions& opts,
     std::lock_guard<simple_spinlock> l(lock_);
     dirty_dirs_.insert(dir->dir());
     AddNewContainerUnlocked(new_container);
+    new_container->set_last_tablet_id(opts.tablet_id);
   }
   *container = std::move(new_container);
   return Status::OK();
@@ -2288,18 +2824,30 @@ Status LogBlockManager::RemoveLogBlocks(vector<BlockId> block_ids,
     metrics()->bytes_under_management->DecrementBy(blocks_length);
   }
 
+  // Group the blocks by container so that each container's deletion records
+  // can be appended to its metadata file in a single write.
+  std::unordered_map<LogBlockContainer*, vector<LogBlockRefPtr>> lbs_by_container;
   for (auto& lb : lbs) {
     VLOG(3) << "Deleting block " << lb->block_id();
     lb->container()->BlockDeleted(lb);
+    lbs_by_container[lb->container()].emplace_back(std::move(lb));
+  }
+
+  for (auto& e : lbs_by_container) {
+    LogBlockContainer* container = e.first;
+    vector<LogBlockRefPtr>& container_lbs = e.second;
 
     // Record the on-disk deletion.
     //
     // TODO(unknown): what if this fails? Should we restore the in-memory block?
-    BlockRecordPB record;
-    lb->block_id().CopyToPB(record.mutable_block_id());
-    record.set_op_type(DELETE);
-    record.set_timestamp_us(GetCurrentTimeMicros());
-    Status s = lb->container()->AppendMetadata(record);
+    vector<BlockRecordPB> records(container_lbs.size());
+    const int64_t now_us = GetCurrentTimeMicros();
+    for (int i = 0; i < container_lbs.size(); i++) {
+      container_lbs[i]->block_id().CopyToPB(records[i].mutable_block_id());
+      records[i].set_op_type(DELETE);
+      records[i].set_timestamp_us(now_us);
+    }
+    Status s = container->AppendMetadata(records);
 
     // We don't bother fsyncing the metadata append for deletes in order to avoid
     // the disk overhead. Even if we did fsync it, we'd still need to account for
@@ -2313,7 +2861,9 @@ Status LogBlockManager::RemoveLogBlocks(vector<BlockId> block_ids,
         first_failure = s.CloneAndPrepend(
             "Unable to append deletion record to block metadata");
       }
-    } else {
+      continue;
+    }
+    for (auto& lb : container_lbs) {
       deleted->emplace_back(lb->block_id());
       log_blocks->emplace_back(std::move(lb));
     }
@@ -2352,63 +2902,36 @@ Status LogBlockManager::RemoveLogBlockUnlocked(const BlockId& block_id,
   return Status::OK();
 }
 
-void LogBlockManager::OpenDataDir(DataDir* dir,
-                                  FsReport* report,
-                                  Status* result_status) {
-  FsReport local_report;
-  local_report.data_dirs.push_back(dir->dir());
-
-  // We are going to perform these checks.
-  //
-  // Note: this isn't necessarily the complete set of FsReport checks; there
-  // may be checks that the LBM cannot perform.
-  local_report.full_container_space_check.emplace();
-  local_report.incomplete_container_check.emplace();
-  local_report.malformed_record_check.emplace();
-  local_report.misaligned_block_check.emplace();
-  local_report.partial_record_check.emplace();
-
-  // Keep track of deleted blocks whose space hasn't been punched; they will
-  // be repunched during repair.
-  vector<LogBlockRefPtr> need_repunching;
-
-  // Keep track of containers that have nothing but dead blocks; they will be
-  // deleted during repair.
-  vector<LogBlockContainerRefPtr> dead_containers;
-
-  // Keep track of containers whose live block ratio is low; their metadata
-  // files will be compacted during repair.
-  unordered_map<string, vector<BlockRecordPB>> low_live_block_containers;
-
-  // Find all containers and open them.
-  unordered_set<string> containers_seen;
-  vector<string> children;
-  Status s = env_->GetChildren(dir->dir(), &children);
-  if (!s.ok()) {
-    HANDLE_DISK_FAILURE(s, error_manager_->RunErrorNotificationCb(
-        ErrorHandlerType::DISK_ERROR, dir));
-    *result_status = s.CloneAndPrepend(Substitute(
-        "Could not list children of $0", dir->dir()));
+void LogBlockManager::ThrottleHolePunch(const DataDir* dir) {
+  const int32_t rate = FLAGS_log_container_hole_punch_rate_limit_per_sec;
+  if (rate <= 0) {
     return;
   }
-  MonoTime last_opened_container_log_time = MonoTime::Now();
-  for (const string& child : children) {
-    string container_name;
-    if (!TryStripSuffixString(
-            child, LogBlockManager::kContainerDataFileSuffix, &container_name) &&
-        !TryStripSuffixString(
-            child, LogBlockManager::kContainerMetadataFileSuffix, &container_name)) {
-      continue;
-    }
-    if (!InsertIfNotPresent(&containers_seen, container_name)) {
-      continue;
-    }
+  RateLimiter* limiter = FindPointeeOrNull(hole_punch_limiters_by_data_dir_, dir);
+  if (!limiter) {
+    return;
+  }
+  limiter->set_rate(rate);
+  MonoDelta slept = limiter->Acquire(1);
+  if (slept.ToNanoseconds() > 0) {
+    TRACE_COUNTER_INCREMENT("lbm_hole_punch_throttled_us", slept.ToMicroseconds());
+  }
+}
 
+Status LogBlockManager::OpenContainers(
+    DataDir* dir,
+    const vector<string>& container_names,
+    FsReport* report,
+    vector<LogBlockRefPtr>* need_repunching,
+    vector<LogBlockContainerRefPtr>* dead_containers,
+    unordered_map<string, vector<BlockRecordPB>>* low_live_block_containers) {
+  MonoTime last_opened_container_log_time = MonoTime::Now();
+  for (const string& container_name : container_names) {
     LogBlockContainerRefPtr container;
-    s = LogBlockContainer::Open(
-        this, dir, &local_report, container_name, &container);
+    Status s = LogBlockContainer::Open(
+        this, dir, report, container_name, &container);
     if (s.IsAborted()) {
-      // Skip the container. Open() added a record of it to 'local_report' for us.
+      // Skip the container. Open() added a record of it to 'report' for us.
       continue;
     }
     if (!s.ok()) {
@@ -2417,9 +2940,7 @@ void LogBlockManager::OpenDataDir(DataDir* dir,
         // especially for the kudu cli tool.
         continue;
       }
-      *result_status = s.CloneAndPrepend(Substitute(
-          "Could not open container $0", container_name));
-      return;
+      return s.CloneAndPrepend(Substitute("Could not open container $0", container_name));
     }
 
     // Process the records, building a container-local map for live blocks and
@@ -2440,15 +2961,14 @@ void LogBlockManager::OpenDataDir(DataDir* dir,
     BlockRecordMap live_block_records;
     vector<LogBlockRefPtr> dead_blocks;
     uint64_t max_block_id = 0;
-    s = container->ProcessRecords(&local_report,
+    s = container->ProcessRecords(report,
                                   &live_blocks,
                                   &live_block_records,
                                   &dead_blocks,
                                   &max_block_id);
     if (!s.ok()) {
-      *result_status = s.CloneAndPrepend(Substitute(
+      return s.CloneAndPrepend(Substitute(
           "Could not process records in container $0", container->ToString()));
-      return;
     }
 
     // With deleted blocks out of the way, check for misaligned blocks.
@@ -2460,7 +2980,7 @@ void LogBlockManager::OpenDataDir(DataDir* dir,
     for (const auto& e : live_blocks) {
       if (PREDICT_FALSE(e.second->offset() %
                         container->instance()->filesystem_block_size_bytes() != 0)) {
-        local_report.misaligned_block_check->entries.emplace_back(
+        report->misaligned_block_check->entries.emplace_back(
             container->ToString(), e.first);
 
       }
@@ -2474,7 +2994,7 @@ void LogBlockManager::OpenDataDir(DataDir* dir,
       // confusing to report it as such since it'll be a natural event at startup.
       if (container->live_blocks() == 0) {
         DCHECK(live_blocks.empty());
-        dead_containers.emplace_back(container);
+        dead_containers->emplace_back(container);
       } else if (static_cast<double>(container->live_blocks()) /
           container->total_blocks() <= FLAGS_log_container_live_metadata_before_compact_ratio) {
         // Metadata files of containers with very few live blocks will be compacted.
@@ -2497,21 +3017,9 @@ void LogBlockManager::OpenDataDir(DataDir* dir,
         // container (such as std::map) because while records are temporarily
         // retained for every container, only some containers will actually
         // undergo metadata compaction.
-        std::sort(records.begin(), records.end(),
-                  [](const BlockRecordPB& a, const BlockRecordPB& b) {
-          // Sort by timestamp.
-          if (a.timestamp_us() != b.timestamp_us()) {
-            return a.timestamp_us() < b.timestamp_us();
-          }
-
-          // If the timestamps match, sort by offset.
-          //
-          // If the offsets also match (i.e. both blocks are of zero length),
-          // it doesn't matter which of the two records comes first.
-          return a.offset() < b.offset();
-        });
-
-        low_live_block_containers[container->ToString()] = std::move(records);
+        SortBlockRecords(&records);
+
+        (*low_live_block_containers)[container->ToString()] = std::move(records);
       }
 
       // Having processed the block records, let's check whether any full
@@ -2546,37 +3054,36 @@ void LogBlockManager::OpenDataDir(DataDir* dir,
       if (!s.ok()) {
         HANDLE_DISK_FAILURE(s, error_manager_->RunErrorNotificationCb(
             ErrorHandlerType::DISK_ERROR, dir));
-        *result_status = s.CloneAndPrepend(Substitute(
+        return s.CloneAndPrepend(Substitute(
             "Could not get on-disk file size of container $0", container->ToString()));
-        return;
       }
       int64_t cleanup_threshold_size = container->live_bytes_aligned() *
           (1 + FLAGS_log_container_excess_space_before_cleanup_fraction);
       if (reported_size > cleanup_threshold_size) {
-        local_report.full_container_space_check->entries.emplace_back(
+        report->full_container_space_check->entries.emplace_back(
             container->ToString(), reported_size - container->live_bytes_aligned());
 
         // If the container is to be deleted outright, don't bother repunching
         // its blocks. The report entry remains, however, so it's clear that
         // there was a space discrepancy.
         if (container->live_blocks()) {
-          need_repunching.insert(need_repunching.end(),
+          need_repunching->insert(need_repunching->end(),
                                  dead_blocks.begin(), dead_blocks.end());
         }
       }
 
-      local_report.stats.lbm_full_container_count++;
+      report->stats.lbm_full_container_count++;
     }
-    local_report.stats.live_block_bytes += container->live_bytes();
-    local_report.stats.live_block_bytes_aligned += container->live_bytes_aligned();
-    local_report.stats.live_block_count += container->live_blocks();
-    local_report.stats.lbm_container_count++;
+    report->stats.live_block_bytes += container->live_bytes();
+    report->stats.live_block_bytes_aligned += container->live_bytes_aligned();
+    report->stats.live_block_count += container->live_blocks();
+    report->stats.lbm_container_count++;
 
     // Log number of containers opened every 10 seconds
     MonoTime now = MonoTime::Now();
     if ((now - last_opened_container_log_time).ToSeconds() > 10) {
       LOG(INFO) << Substitute("Opened $0 log block containers in $1",
-                              local_report.stats.lbm_container_count, dir->dir());
+                              report->stats.lbm_container_count, dir->dir());
       last_opened_container_log_time = now;
     }
 
@@ -2606,6 +3113,129 @@ void LogBlockManager::OpenDataDir(DataDir* dir,
       MakeContainerAvailableUnlocked(std::move(container));
     }
   }
+  return Status::OK();
+}
+
+void LogBlockManager::OpenDataDir(DataDir* dir,
+                                  FsReport* report,
+                                  Status* result_status) {
+  FsReport local_report;
+  local_report.data_dirs.push_back(dir->dir());
+
+  // We are going to perform these checks.
+  //
+  // Note: this isn't necessarily the complete set of FsReport checks; there
+  // may be checks that the LBM cannot perform.
+  local_report.full_container_space_check.emplace();
+  local_report.incomplete_container_check.emplace();
+  local_report.malformed_record_check.emplace();
+  local_report.misaligned_block_check.emplace();
+  local_report.partial_record_check.emplace();
+
+  // Keep track of deleted blocks whose space hasn't been punched; they will
+  // be repunched during repair.
+  vector<LogBlockRefPtr> need_repunching;
+
+  // Keep track of containers that have nothing but dead blocks; they will be
+  // deleted during repair.
+  vector<LogBlockContainerRefPtr> dead_containers;
+
+  // Keep track of containers whose live block ratio is low; their metadata
+  // files will be compacted during repair.
+  unordered_map<string, vector<BlockRecordPB>> low_live_block_containers;
+
+  // Find all containers and open them.
+  unordered_set<string> containers_seen;
+  vector<string> children;
+  Status s = env_->GetChildren(dir->dir(), &children);
+  if (!s.ok()) {
+    HANDLE_DISK_FAILURE(s, error_manager_->RunErrorNotificationCb(
+        ErrorHandlerType::DISK_ERROR, dir));
+    *result_status = s.CloneAndPrepend(Substitute(
+        "Could not list children of $0", dir->dir()));
+    return;
+  }
+  vector<string> container_names;
+  for (const string& child : children) {
+    string container_name;
+    if (!TryStripSuffixString(
+            child, LogBlockManager::kContainerDataFileSuffix, &container_name) &&
+        !TryStripSuffixString(
+            child, LogBlockManager::kContainerMetadataFileSuffix, &container_name)) {
+      continue;
+    }
+    if (InsertIfNotPresent(&containers_seen, container_name)) {
+      container_names.emplace_back(std::move(container_name));
+    }
+  }
+
+  // Open the containers, with several threads if so configured. Each thread
+  // opens a share of the containers, with its own report and repair lists,
+  // merged once all the containers are open.
+  const int num_threads = std::max<int>(
+      1, std::min<int>(FLAGS_log_container_open_threads_per_data_dir,
+                       container_names.size()));
+  if (num_threads == 1) {
+    s = OpenContainers(dir, container_names, &local_report, &need_repunching,
+                       &dead_containers, &low_live_block_containers);
+    if (!s.ok()) {
+      *result_status = s;
+      return;
+    }
+  } else {
+    gscoped_ptr<ThreadPool> pool;
+    s = ThreadPoolBuilder(Substitute("lbm open $0", dir->dir()))
+        .set_min_threads(num_threads)
+        .set_max_threads(num_threads)
+        .Build(&pool);
+    if (!s.ok()) {
+      *result_status = s.CloneAndPrepend("Could not create the container open pool");
+      return;
+    }
+    vector<vector<string>> names_by_thread(num_threads);
+    for (int i = 0; i < container_names.size(); i++) {
+      names_by_thread[i % num_threads].emplace_back(std::move(container_names[i]));
+    }
+    vector<FsReport> reports(num_threads);
+    vector<vector<LogBlockRefPtr>> need_repunching_by_thread(num_threads);
+    vector<vector<LogBlockContainerRefPtr>> dead_containers_by_thread(num_threads);
+    vector<unordered_map<string, vector<BlockRecordPB>>> low_live_by_thread(num_threads);
+    vector<Status> statuses(num_threads);
+    for (int i = 0; i < num_threads; i++) {
+      FsReport* thread_report = &reports[i];
+      thread_report->full_container_space_check.emplace();
+      thread_report->incomplete_container_check.emplace();
+      thread_report->malformed_record_check.emplace();
+      thread_report->misaligned_block_check.emplace();
+      thread_report->partial_record_check.emplace();
+      Status submit_status = pool->SubmitFunc([&, i]() {
+        statuses[i] = OpenContainers(dir, names_by_thread[i], &reports[i],
+                                     &need_repunching_by_thread[i],
+                                     &dead_containers_by_thread[i],
+                                     &low_live_by_thread[i]);
+      });
+      if (!submit_status.ok()) {
+        statuses[i] = submit_status;
+      }
+    }
+    pool->Wait();
+    for (int i = 0; i < num_threads; i++) {
+      if (!statuses[i].ok()) {
+        *result_status = statuses[i];
+        return;
+      }
+      local_report.MergeFrom(reports[i]);
+      need_repunching.insert(need_repunching.end(),
+                             need_repunching_by_thread[i].begin(),
+                             need_repunching_by_thread[i].end());
+      dead_containers.insert(dead_containers.end(),
+                             dead_containers_by_thread[i].begin(),
+                             dead_containers_by_thread[i].end());
+      for (auto& e : low_live_by_thread[i]) {
+        low_live_block_containers.emplace(e.first, std::move(e.second));
+      }
+    }
+  }
 
   // Like the rest of Open(), repairs are performed per data directory to take
   // advantage of parallelism.
@@ -2821,6 +3451,7 @@ Status LogBlockManager::Repair(
     // However, we're hosed if we can't open the new metadata file.
     RETURN_NOT_OK_PREPEND(container->ReopenMetadataWriter(),
                           "could not reopen new metadata file");
+    container->set_metadata_create_records(e.second.size());
 
     metadata_files_compacted++;
     metadata_bytes_delta += file_bytes_delta;
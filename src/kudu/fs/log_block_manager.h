@@ -46,7 +46,10 @@ namespace kudu {
 
 class BlockRecordPB;
 class Env;
+class MaintenanceManager;
+class MaintenanceOp;
 class RWFile;
+class RateLimiter;
 
 namespace fs {
 class DataDir;
@@ -58,6 +61,7 @@ namespace internal {
 class LogBlock;
 class LogBlockContainer;
 class LogBlockDeletionTransaction;
+class LogBlockManagerCompactMetadataOp;
 class LogWritableBlock;
 
 struct LogBlockManagerMetrics;
@@ -212,10 +216,16 @@ class LogBlockManager : public BlockManager {
 
   FsErrorManager* error_manager() override { return error_manager_; }
 
+  // Registers a maintenance op that compacts the metadata files of full
+  // containers at runtime; see --log_container_compact_metadata_at_runtime.
+  void RegisterMaintenanceOps(MaintenanceManager* maintenance_manager) override;
+
  private:
   FRIEND_TEST(LogBlockManagerTest, TestAbortBlock);
   FRIEND_TEST(LogBlockManagerTest, TestCloseFinalizedBlock);
+  FRIEND_TEST(LogBlockManagerTest, TestCompactFullContainerMetadataAtRuntime);
   FRIEND_TEST(LogBlockManagerTest, TestCompactFullContainerMetadataAtStartup);
+  FRIEND_TEST(LogBlockManagerTest, TestCompactMetadataMaintenanceOp);
   FRIEND_TEST(LogBlockManagerTest, TestFinalizeBlock);
   FRIEND_TEST(LogBlockManagerTest, TestLIFOContainerSelection);
   FRIEND_TEST(LogBlockManagerTest, TestLookupBlockLimit);
@@ -227,6 +237,7 @@ class LogBlockManager : public BlockManager {
 
   friend class internal::LogBlockContainer;
   friend class internal::LogBlockDeletionTransaction;
+  friend class internal::LogBlockManagerCompactMetadataOp;
   friend class internal::LogWritableBlock;
 
   // Type for the actual block map used to store all live blocks.
@@ -330,6 +341,10 @@ class LogBlockManager : public BlockManager {
   Status RemoveLogBlockUnlocked(const BlockId& block_id,
                                 LogBlockRefPtr* lb);
 
+  // Waits until --log_container_hole_punch_rate_limit_per_sec allows another
+  // hole to be punched in a container residing in 'dir'.
+  void ThrottleHolePunch(const DataDir* dir);
+
   // Repairs any inconsistencies for 'dir' described in 'report'.
   //
   // The following additional repairs will be performed:
@@ -359,10 +374,27 @@ class LogBlockManager : public BlockManager {
                              const std::vector<BlockRecordPB>& records,
                              int64_t* file_bytes_delta);
 
+  // Opens the containers named 'container_names' in 'dir', adding their live
+  // blocks to the block map. The results of consistency checking are written
+  // to 'report', and what must be repaired is appended to 'need_repunching',
+  // 'dead_containers' and 'low_live_block_containers' (see Repair()).
+  //
+  // May be called concurrently for different containers of the same 'dir'.
+  Status OpenContainers(
+      DataDir* dir,
+      const std::vector<std::string>& container_names,
+      FsReport* report,
+      std::vector<LogBlockRefPtr>* need_repunching,
+      std::vector<LogBlockContainerRefPtr>* dead_containers,
+      std::unordered_map<std::string, std::vector<BlockRecordPB>>* low_live_block_containers);
+
   // Opens a particular data directory belonging to the block manager. The
   // results of consistency checking (and repair, if applicable) are written to
   // 'report'.
   //
+  // The containers are opened by --log_container_open_threads_per_data_dir
+  // threads.
+  //
   // Success or failure is set in 'result_status'.
   void OpenDataDir(DataDir* dir,
                    FsReport* report,
@@ -375,6 +407,17 @@ class LogBlockManager : public BlockManager {
 
   Env* env() const { return env_; }
 
+  // Returns the number of dead block CREATE records in the metadata files of
+  // the containers that need compaction.
+  int64_t CountDeadRecordsToCompact();
+
+  // Compacts the metadata files of the containers that need it (see
+  // LogBlockContainer::NeedsMetadataCompaction()) while the block manager
+  // is in use.
+  //
+  // Returns the first error encountered, after trying every container.
+  Status CompactContainersMetadata();
+
   // Returns the path of the given container. Only for use by tests.
   static std::string ContainerPathForTests(internal::LogBlockContainer* container);
 
@@ -416,6 +459,11 @@ class LogBlockManager : public BlockManager {
   std::unordered_map<const DataDir*,
                      boost::optional<int64_t>> block_limits_by_data_dir_;
 
+  // Paces the hole punching of deleted blocks in each data directory, per
+  // --log_container_hole_punch_rate_limit_per_sec.
+  std::unordered_map<const DataDir*,
+                     std::unique_ptr<RateLimiter>> hole_punch_limiters_by_data_dir_;
+
   // Manages files opened for reading.
   FileCache<RWFile> file_cache_;
 
@@ -461,6 +509,9 @@ class LogBlockManager : public BlockManager {
   // May be null if instantiated without metrics.
   std::unique_ptr<internal::LogBlockManagerMetrics> metrics_;
 
+  // Compacts container metadata files at runtime, if registered.
+  std::unique_ptr<MaintenanceOp> compact_metadata_op_;
+
   DISALLOW_COPY_AND_ASSIGN(LogBlockManager);
 };
 
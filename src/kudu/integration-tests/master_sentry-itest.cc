@@ -267,6 +267,10 @@ class SentryITestBase : public HmsITestBase {
     // authorized.
     opts.extra_master_flags.emplace_back("--trusted_user_acl=impala");
     opts.extra_master_flags.emplace_back("--user_acl=test-user,impala");
+
+    // The tests alter privileges between operations, so they shouldn't be
+    // cached.
+    opts.extra_master_flags.emplace_back("--sentry_privileges_cache_ttl_ms=0");
     StartClusterWithOpts(std::move(opts));
 
     // Create principals 'impala' and 'kudu'. Configure to use the latter.
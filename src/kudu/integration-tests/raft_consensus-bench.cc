@@ -0,0 +1,278 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+// Benchmark of the replication throughput and commit latency of a Raft
+// configuration of three replicas, each of them running in its own
+// in-process tablet server with its own Messenger and write-ahead log.
+//
+// The leader replicates NO_OP operations carrying a random payload, so the
+// numbers don't include any of the work done to prepare and apply writes,
+// only the RPCs to the followers and the appends to the logs.
+//
+// The logs are stored under --raft_bench_cluster_root, so that they may be
+// placed on the device to benchmark. The parameters of the replication are
+// set with the regular server flags, e.g.:
+//
+//   --consensus_max_batch_size_bytes: the maximum size of a batch of
+//     operations sent to a follower.
+//   --consensus_max_inflight_requests_per_peer: the replication window,
+//     i.e. the number of requests pipelined to every follower.
+//   --log_compression_codec: the codec compressing the log batches.
+//   --raft_bench_fsync: how the logs are synced to disk.
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <gflags/gflags_declare.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kudu/clock/clock.h"
+#include "kudu/common/timestamp.h"
+#include "kudu/consensus/consensus.pb.h"
+#include "kudu/consensus/metadata.pb.h"
+#include "kudu/consensus/raft_consensus.h"
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/integration-tests/test_workload.h"
+#include "kudu/mini-cluster/internal_mini_cluster.h"
+#include "kudu/tablet/tablet_replica.h"
+#include "kudu/tserver/mini_tablet_server.h"
+#include "kudu/tserver/tablet_server.h"
+#include "kudu/tserver/ts_tablet_manager.h"
+#include "kudu/util/atomic.h"
+#include "kudu/util/hdr_histogram.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/random.h"
+#include "kudu/util/random_util.h"
+#include "kudu/util/semaphore.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+DECLARE_bool(log_force_fsync_all);
+DECLARE_bool(never_fsync);
+DECLARE_int32(consensus_max_batch_size_bytes);
+DECLARE_int32(consensus_max_inflight_requests_per_peer);
+DECLARE_string(log_compression_codec);
+
+DEFINE_string(raft_bench_cluster_root, "",
+              "Directory in which the data and the logs of the tablet servers "
+              "are stored. Defaults to the test directory");
+DEFINE_string(raft_bench_payload_sizes, "100,1000,10000",
+              "Comma-separated list of the sizes, in bytes, of the payloads "
+              "of the replicated operations");
+DEFINE_string(raft_bench_outstanding_ops, "1,16,128",
+              "Comma-separated list of the maximum numbers of operations "
+              "submitted to the leader and not yet committed. More "
+              "outstanding operations allow larger batches to be replicated "
+              "and group-committed to the logs");
+DEFINE_int32(raft_bench_num_ops, 20000,
+             "Number of operations replicated for every combination of "
+             "payload size and number of outstanding operations");
+DEFINE_string(raft_bench_fsync, "batch",
+              "How the logs are synced to disk: 'none' never syncs them, "
+              "'batch' syncs them as the servers do by default, and 'all' "
+              "syncs every batch of operations appended to them, as with "
+              "--log_force_fsync_all");
+
+using kudu::cluster::InternalMiniCluster;
+using kudu::cluster::InternalMiniClusterOptions;
+using kudu::consensus::ConsensusRound;
+using kudu::consensus::NO_OP;
+using kudu::consensus::RaftConsensus;
+using kudu::consensus::RaftPeerPB;
+using kudu::consensus::ReplicateMsg;
+using kudu::tablet::TabletReplica;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+class RaftConsensusBench : public KuduTest {
+ public:
+  void SetUp() override {
+    KuduTest::SetUp();
+    if (FLAGS_raft_bench_fsync == "none") {
+      FLAGS_never_fsync = true;
+    } else if (FLAGS_raft_bench_fsync == "batch") {
+      FLAGS_never_fsync = false;
+    } else if (FLAGS_raft_bench_fsync == "all") {
+      FLAGS_never_fsync = false;
+      FLAGS_log_force_fsync_all = true;
+    } else {
+      FAIL() << "invalid --raft_bench_fsync: " << FLAGS_raft_bench_fsync;
+    }
+
+    InternalMiniClusterOptions opts;
+    opts.num_tablet_servers = kNumReplicas;
+    opts.cluster_root = FLAGS_raft_bench_cluster_root;
+    cluster_.reset(new InternalMiniCluster(env_, std::move(opts)));
+    ASSERT_OK(cluster_->Start());
+
+    // Create a table with a single tablet replicated to all the servers.
+    TestWorkload workload(cluster_.get());
+    workload.set_num_replicas(kNumReplicas);
+    workload.set_num_tablets(1);
+    workload.Setup();
+
+    ASSERT_EVENTUALLY([&] {
+      NO_FATALS(FindLeader());
+    });
+  }
+
+  void TearDown() override {
+    leader_.reset();
+    if (cluster_) {
+      cluster_->Shutdown();
+    }
+    KuduTest::TearDown();
+  }
+
+ protected:
+  static constexpr int kNumReplicas = 3;
+
+  // Sets 'leader_' and 'leader_ts_' to the leader replica of the tablet and
+  // its tablet server, once all the replicas are running.
+  void FindLeader() {
+    leader_.reset();
+    int num_running = 0;
+    for (int i = 0; i < cluster_->num_tablet_servers(); i++) {
+      tserver::TabletServer* ts = cluster_->mini_tablet_server(i)->server();
+      vector<scoped_refptr<TabletReplica>> replicas;
+      ts->tablet_manager()->GetTabletReplicas(&replicas);
+      ASSERT_EQ(1, replicas.size());
+      RaftConsensus* consensus = replicas[0]->consensus();
+      ASSERT_NE(nullptr, consensus);
+      if (!consensus->IsRunning()) continue;
+      num_running++;
+      if (consensus->role() == RaftPeerPB::LEADER) {
+        leader_ = replicas[0];
+        leader_ts_ = ts;
+      }
+    }
+    ASSERT_EQ(kNumReplicas, num_running);
+    ASSERT_NE(nullptr, leader_.get());
+  }
+
+  struct RunResult {
+    RunResult()
+        : latency_us(new HdrHistogram(60 * 1000 * 1000, 2)),
+          num_failed(0) {
+    }
+    // Commit latencies of the operations, in microseconds.
+    unique_ptr<HdrHistogram> latency_us;
+    AtomicInt<int64_t> num_failed;
+    MonoDelta elapsed;
+  };
+
+  // Replicates --raft_bench_num_ops operations with a payload of
+  // 'payload_size' random bytes, keeping up to 'outstanding_ops' of them
+  // submitted to the leader and not yet committed.
+  void Run(int payload_size, int outstanding_ops, RunResult* result) {
+    Random rng(SeedRandom());
+    const string payload = RandomString(payload_size, &rng);
+    RaftConsensus* consensus = leader_->consensus();
+    Semaphore outstanding(outstanding_ops);
+
+    const MonoTime start = MonoTime::Now();
+    for (int i = 0; i < FLAGS_raft_bench_num_ops; i++) {
+      outstanding.Acquire();
+      gscoped_ptr<ReplicateMsg> msg(new ReplicateMsg);
+      msg->set_op_type(NO_OP);
+      msg->set_timestamp(leader_ts_->clock()->Now().ToUint64());
+      // The timestamps of the operations aren't used to advance the safe
+      // time of the tablet.
+      msg->mutable_noop_request()->set_timestamp_in_opid_order(false);
+      msg->mutable_noop_request()->set_payload_for_tests(payload);
+
+      const MonoTime submitted = MonoTime::Now();
+      scoped_refptr<ConsensusRound> round = consensus->NewRound(
+          std::move(msg), [&, submitted](const Status& s) {
+            if (s.ok()) {
+              result->latency_us->Increment((MonoTime::Now() - submitted).ToMicroseconds());
+            } else {
+              result->num_failed.Increment();
+            }
+            outstanding.Release();
+          });
+      ASSERT_OK(consensus->CheckLeadershipAndBindTerm(round));
+      ASSERT_OK(consensus->Replicate(round));
+    }
+    // Wait for all the operations to complete.
+    for (int i = 0; i < outstanding_ops; i++) {
+      outstanding.Acquire();
+    }
+    result->elapsed = MonoTime::Now() - start;
+  }
+
+  unique_ptr<InternalMiniCluster> cluster_;
+  scoped_refptr<TabletReplica> leader_;
+  tserver::TabletServer* leader_ts_;
+};
+
+TEST_F(RaftConsensusBench, ReplicateNoOps) {
+  vector<int> payload_sizes;
+  for (const auto& s : strings::Split(FLAGS_raft_bench_payload_sizes, ",",
+                                      strings::SkipEmpty())) {
+    payload_sizes.push_back(atoi(s.ToString().c_str()));
+  }
+  vector<int> outstanding_ops;
+  for (const auto& s : strings::Split(FLAGS_raft_bench_outstanding_ops, ",",
+                                      strings::SkipEmpty())) {
+    outstanding_ops.push_back(atoi(s.ToString().c_str()));
+  }
+
+  LOG(INFO) << Substitute("$0 replicas, fsync: $1, compression: $2, max batch size: $3 bytes, "
+                          "max in-flight requests per peer: $4",
+                          kNumReplicas, FLAGS_raft_bench_fsync, FLAGS_log_compression_codec,
+                          FLAGS_consensus_max_batch_size_bytes,
+                          FLAGS_consensus_max_inflight_requests_per_peer);
+  LOG(INFO) << StringPrintf("%10s %12s %12s %10s %10s %10s %10s %10s %8s",
+                            "payload", "outstanding", "ops/s", "MB/s", "p50 us",
+                            "p95 us", "p99 us", "max us", "failed");
+  for (int payload_size : payload_sizes) {
+    for (int outstanding : outstanding_ops) {
+      ASSERT_GT(outstanding, 0);
+      RunResult result;
+      NO_FATALS(Run(payload_size, outstanding, &result));
+      const double ops_per_sec = FLAGS_raft_bench_num_ops / result.elapsed.ToSeconds();
+      const HdrHistogram& h = *result.latency_us;
+      LOG(INFO) << StringPrintf(
+          "%10d %12d %12.0f %10.2f %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64
+          " %8" PRId64,
+          payload_size, outstanding, ops_per_sec,
+          ops_per_sec * payload_size / (1024 * 1024),
+          h.ValueAtPercentile(50), h.ValueAtPercentile(95), h.ValueAtPercentile(99),
+          h.MaxValue(), result.num_failed.Load());
+      ASSERT_EQ(0, result.num_failed.Load());
+    }
+  }
+}
+
+} // namespace kudu
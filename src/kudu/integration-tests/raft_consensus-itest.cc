@@ -116,6 +116,8 @@ using kudu::consensus::LeaderStepDownRequestPB;
 using kudu::consensus::LeaderStepDownResponsePB;
 using kudu::consensus::MajoritySize;
 using kudu::consensus::MakeOpId;
+using kudu::consensus::MultiUpdateConsensusRequestPB;
+using kudu::consensus::MultiUpdateConsensusResponsePB;
 using kudu::consensus::OpId;
 using kudu::consensus::RaftPeerAttrsPB;
 using kudu::consensus::RaftPeerPB;
@@ -1052,6 +1054,41 @@ TEST_F(RaftConsensusITest, TestKUDU_597) {
   }
 }
 
+// Test that MultiUpdateConsensus() handles each update like UpdateConsensus()
+// would, reporting the errors in the responses of the failed updates.
+TEST_F(RaftConsensusITest, TestMultiUpdateConsensus) {
+  TServerDetails* replica_ts;
+  NO_FATALS(SetupSingleReplicaTest(&replica_ts));
+
+  ConsensusServiceProxy* c_proxy = CHECK_NOTNULL(replica_ts->consensus_proxy.get());
+  MultiUpdateConsensusRequestPB req;
+  MultiUpdateConsensusResponsePB resp;
+  RpcController rpc;
+
+  ConsensusRequestPB* update = req.add_requests();
+  update->set_tablet_id(tablet_id_);
+  update->set_dest_uuid(replica_ts->uuid());
+  update->set_caller_uuid("fake_caller");
+  update->set_caller_term(2);
+  update->set_all_replicated_index(0);
+  update->mutable_preceding_id()->CopyFrom(MakeOpId(1, 1));
+
+  // The same update, for a tablet which doesn't exist.
+  *req.add_requests() = *update;
+  req.mutable_requests(1)->set_tablet_id("missing-tablet");
+
+  // The same update, for another server.
+  *req.add_requests() = *update;
+  req.mutable_requests(2)->set_dest_uuid("missing-server");
+
+  ASSERT_OK(c_proxy->MultiUpdateConsensus(req, &resp, &rpc));
+  ASSERT_EQ(3, resp.responses_size()) << SecureDebugString(resp);
+  ASSERT_FALSE(resp.responses(0).has_error()) << SecureDebugString(resp);
+  ASSERT_EQ(2, resp.responses(0).responder_term());
+  ASSERT_EQ(TabletServerErrorPB::TABLET_NOT_FOUND, resp.responses(1).error().code());
+  ASSERT_EQ(TabletServerErrorPB::WRONG_SERVER_UUID, resp.responses(2).error().code());
+}
+
 // Regression test for KUDU-1775: when a replica is restarted, and the first
 // request it receives from a leader results in a LMP mismatch error, the
 // replica should still respond with the correct 'last_committed_idx'.
@@ -201,7 +201,7 @@ TEST_F(TabletHistoryGcITest, TestUndoDeltaBlockGc) {
   // Manually flush all mem stores so that we can measure the maximum disk
   // size before moving the AHM. This ensures the test isn't flaky.
   ASSERT_OK(tablet->Flush());
-  ASSERT_OK(tablet->FlushAllDMSForTests());
+  ASSERT_OK(tablet->FlushAllDMS());
 
   uint64_t measured_size_before_gc = 0;
   ASSERT_OK(Env::Default()->GetFileSizeOnDiskRecursively(cluster_->GetTabletServerFsRoot(0),
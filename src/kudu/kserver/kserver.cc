@@ -55,6 +55,13 @@ static bool ValidateThreadPoolThreadLimit(const char* /*flagname*/, int32_t valu
 }
 DEFINE_validator(server_thread_pool_max_thread_count, &ValidateThreadPoolThreadLimit);
 
+DEFINE_bool(tablet_apply_pool_work_stealing, false,
+            "Whether the pool applying the operations to the tablets queues "
+            "them per worker thread, the idle threads stealing the operations "
+            "queued for the busy ones, rather than in a single shared queue. "
+            "The pool then runs as many threads as there are CPUs at all times.");
+TAG_FLAG(tablet_apply_pool_work_stealing, experimental);
+
 using std::string;
 using strings::Substitute;
 
@@ -69,21 +76,21 @@ METRIC_DEFINE_histogram(server, op_apply_queue_length, "Operation Apply Queue Le
                         "Number of operations waiting to be applied to the tablet. "
                         "High queue lengths indicate that the server is unable to process "
                         "operations as fast as they are being written to the WAL.",
-                        10000, 2);
+                        10000, 2, kudu::STRIPED);
 
 METRIC_DEFINE_histogram(server, op_apply_queue_time, "Operation Apply Queue Time",
                         MetricUnit::kMicroseconds,
                         "Time that operations spent waiting in the apply queue before being "
                         "processed. High queue times indicate that the server is unable to "
                         "process operations as fast as they are being written to the WAL.",
-                        10000000, 2);
+                        10000000, 2, kudu::STRIPED);
 
 METRIC_DEFINE_histogram(server, op_apply_run_time, "Operation Apply Run Time",
                         MetricUnit::kMicroseconds,
                         "Time that operations spent being applied to the tablet. "
                         "High values may indicate that the server is under-provisioned or "
                         "that operations consist of very large batches.",
-                        10000000, 2);
+                        10000000, 2, kudu::STRIPED);
 
 namespace {
 
@@ -142,6 +149,7 @@ Status KuduServer::Init() {
   };
   RETURN_NOT_OK(ThreadPoolBuilder("apply")
                 .set_metrics(std::move(metrics))
+                .set_work_stealing(FLAGS_tablet_apply_pool_work_stealing)
                 .Build(&tablet_apply_pool_));
 
   // These pools are shared by all replicas hosted by this server, and thus
@@ -71,6 +71,10 @@ class AuthzProvider {
   virtual Status AuthorizeGetTableMetadata(const std::string& table_name,
                                            const std::string& user) WARN_UNUSED_RESULT = 0;
 
+  // Drops any authorization metadata cached about the table, e.g. because it
+  // was renamed or dropped in the HMS.
+  virtual void InvalidateTable(const std::string& /*table_name*/) {}
+
   virtual ~AuthzProvider() {}
 
   // Checks if the given user is trusted and thus can be exempted from
@@ -0,0 +1,146 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/master/auto_rebalancer.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kudu/tools/rebalance_algo.h"
+
+using kudu::tools::ClusterInfo;
+using kudu::tools::TableReplicaMove;
+using std::string;
+using std::unordered_set;
+using std::vector;
+
+namespace kudu {
+namespace master {
+
+namespace {
+
+RebalancerTabletInfo MakeTablet(string tablet_id,
+                                string table_id,
+                                vector<string> replica_uuids,
+                                string leader_uuid = "") {
+  RebalancerTabletInfo info;
+  info.tablet_id = std::move(tablet_id);
+  info.table_id = std::move(table_id);
+  info.leader_uuid = std::move(leader_uuid);
+  info.replica_uuids = std::move(replica_uuids);
+  info.movable = true;
+  return info;
+}
+
+} // anonymous namespace
+
+TEST(AutoRebalancerTest, BuildClusterInfo) {
+  const vector<string> uuids = { "ts0", "ts1", "ts2" };
+  vector<RebalancerTabletInfo> tablets = {
+    MakeTablet("t0", "A", { "ts0", "ts1" }),
+    MakeTablet("t1", "A", { "ts0", "ts1" }),
+    // Replicas hosted by servers other than 'uuids' aren't counted.
+    MakeTablet("t2", "B", { "ts0", "ts3" }),
+  };
+  ClusterInfo ci;
+  AutoRebalancerTask::BuildClusterInfo(uuids, tablets, &ci);
+
+  const auto& totals = ci.balance.servers_by_total_replica_count;
+  ASSERT_EQ(3, totals.size());
+  ASSERT_EQ(0, totals.begin()->first);
+  ASSERT_EQ("ts2", totals.begin()->second);
+  ASSERT_EQ(3, totals.rbegin()->first);
+  ASSERT_EQ("ts0", totals.rbegin()->second);
+
+  // Every server gets an entry for every table, including the servers
+  // hosting none of the table's replicas.
+  const auto& by_skew = ci.balance.table_info_by_skew;
+  ASSERT_EQ(2, by_skew.size());
+  for (const auto& e : by_skew) {
+    ASSERT_EQ(3, e.second.servers_by_replica_count.size());
+    if (e.second.table_id == "A") {
+      ASSERT_EQ(2, e.first);
+    } else {
+      ASSERT_EQ("B", e.second.table_id);
+      ASSERT_EQ(1, e.first);
+    }
+  }
+}
+
+TEST(AutoRebalancerTest, SelectReplicaMoves) {
+  vector<RebalancerTabletInfo> tablets = {
+    // The source replica is the leader: not a candidate.
+    MakeTablet("t0", "A", { "ts0", "ts1" }, "ts0"),
+    MakeTablet("t1", "A", { "ts0", "ts1" }, "ts1"),
+    MakeTablet("t2", "A", { "ts0", "ts1" }, "ts1"),
+  };
+  const vector<TableReplicaMove> table_moves = {
+    { "A", "ts0", "ts2" },
+    { "A", "ts0", "ts3" },
+  };
+
+  // With a single move per server, only the first move goes through.
+  {
+    vector<RebalancerReplicaMove> moves;
+    AutoRebalancerTask::SelectReplicaMoves(table_moves, tablets, {}, 1, &moves);
+    ASSERT_EQ(1, moves.size());
+    ASSERT_EQ("t1", moves[0].tablet_id);
+    ASSERT_EQ("ts0", moves[0].from);
+    ASSERT_EQ("ts2", moves[0].to);
+  }
+
+  // Each tablet is moved at most once.
+  {
+    vector<RebalancerReplicaMove> moves;
+    AutoRebalancerTask::SelectReplicaMoves(table_moves, tablets, {}, 2, &moves);
+    ASSERT_EQ(2, moves.size());
+    ASSERT_EQ("t1", moves[0].tablet_id);
+    ASSERT_EQ("t2", moves[1].tablet_id);
+    ASSERT_EQ("ts3", moves[1].to);
+  }
+
+  // Saturated servers aren't destinations.
+  {
+    vector<RebalancerReplicaMove> moves;
+    AutoRebalancerTask::SelectReplicaMoves(table_moves, tablets, { "ts2" }, 2, &moves);
+    ASSERT_EQ(1, moves.size());
+    ASSERT_EQ("ts3", moves[0].to);
+  }
+
+  // In-flight moves count towards the per-server limit, and tablets with a
+  // move in flight aren't moved again.
+  {
+    tablets.push_back(MakeTablet("t3", "B", { "ts0", "ts1", "ts4" }, "ts1"));
+    tablets.back().moving_uuids = { "ts0", "ts4" };
+    tablets.back().movable = false;
+    vector<RebalancerReplicaMove> moves;
+    AutoRebalancerTask::SelectReplicaMoves(table_moves, tablets, {}, 1, &moves);
+    ASSERT_TRUE(moves.empty());
+    AutoRebalancerTask::SelectReplicaMoves(
+        { { "B", "ts1", "ts2" } }, tablets, {}, 1, &moves);
+    ASSERT_TRUE(moves.empty());
+  }
+}
+
+} // namespace master
+} // namespace kudu
@@ -0,0 +1,349 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/master/auto_rebalancer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include <boost/optional/optional.hpp>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/consensus/metadata.pb.h"
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/master/catalog_manager.h"
+#include "kudu/master/master.pb.h"
+#include "kudu/master/ts_descriptor.h"
+#include "kudu/master/ts_manager.h"
+#include "kudu/tools/rebalance_algo.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/thread.h"
+
+DEFINE_bool(auto_rebalancing_enabled, false,
+            "Whether the leader master continuously rebalances the replicas "
+            "of tablets across the tablet servers of the cluster.");
+TAG_FLAG(auto_rebalancing_enabled, experimental);
+TAG_FLAG(auto_rebalancing_enabled, runtime);
+
+DEFINE_int32(auto_rebalancing_interval_seconds, 30,
+             "How often the leader master runs a rebalancing iteration, "
+             "in seconds. Only used when --auto_rebalancing_enabled is set.");
+TAG_FLAG(auto_rebalancing_interval_seconds, experimental);
+TAG_FLAG(auto_rebalancing_interval_seconds, runtime);
+
+DEFINE_int32(auto_rebalancing_max_moves_per_server, 1,
+             "The maximum number of replica moves a tablet server may be "
+             "involved in at a time, either as the source or as the "
+             "destination, when the master rebalances the cluster. "
+             "In-flight moves count towards the limit.");
+TAG_FLAG(auto_rebalancing_max_moves_per_server, experimental);
+TAG_FLAG(auto_rebalancing_max_moves_per_server, runtime);
+
+DECLARE_bool(raft_prepare_replacement_before_eviction);
+DECLARE_double(placement_max_disk_used_ratio);
+
+using kudu::consensus::ConsensusStatePB;
+using kudu::consensus::RaftPeerPB;
+using kudu::tools::ClusterInfo;
+using kudu::tools::TableBalanceInfo;
+using kudu::tools::TableReplicaMove;
+using kudu::tools::TwoDimensionalGreedyAlgo;
+using std::map;
+using std::string;
+using std::unordered_map;
+using std::unordered_set;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace master {
+
+AutoRebalancerTask::AutoRebalancerTask(CatalogManager* catalog_manager,
+                                       TSManager* ts_manager)
+    : catalog_manager_(catalog_manager),
+      ts_manager_(ts_manager),
+      cond_(&lock_),
+      closing_(false) {
+}
+
+AutoRebalancerTask::~AutoRebalancerTask() {
+  Shutdown();
+}
+
+Status AutoRebalancerTask::Init() {
+  DCHECK(!thread_);
+  return kudu::Thread::Create("catalog manager", "auto-rebalancer",
+                              &AutoRebalancerTask::RunLoop, this, &thread_);
+}
+
+void AutoRebalancerTask::Shutdown() {
+  {
+    MutexLock l(lock_);
+    if (closing_) {
+      return;
+    }
+    closing_ = true;
+    cond_.Broadcast();
+  }
+  if (thread_) {
+    CHECK_OK(ThreadJoiner(thread_.get()).Join());
+    thread_.reset();
+  }
+}
+
+void AutoRebalancerTask::RunLoop() {
+  while (true) {
+    {
+      MutexLock l(lock_);
+      if (!closing_) {
+        cond_.WaitFor(MonoDelta::FromSeconds(FLAGS_auto_rebalancing_interval_seconds));
+      }
+      if (closing_) {
+        break;
+      }
+    }
+    if (FLAGS_auto_rebalancing_enabled) {
+      WARN_NOT_OK(RunOnce(), "auto-rebalancing iteration failed");
+    }
+  }
+  VLOG(1) << "Auto-rebalancer thread shutting down";
+}
+
+Status AutoRebalancerTask::RunOnce() {
+  if (!FLAGS_raft_prepare_replacement_before_eviction) {
+    return Status::NotSupported(
+        "rebalancing requires --raft_prepare_replacement_before_eviction");
+  }
+  const int max_moves_per_server = FLAGS_auto_rebalancing_max_moves_per_server;
+  if (max_moves_per_server <= 0) {
+    return Status::OK();
+  }
+
+  CatalogManager::ScopedLeaderSharedLock l(catalog_manager_);
+  if (!l.first_failed_status().ok()) {
+    // Only the leader master rebalances the cluster.
+    return Status::OK();
+  }
+
+  // Snapshot the placement of the replicas of every tablet that might be
+  // moved, straight from the catalog.
+  vector<scoped_refptr<TableInfo>> tables;
+  RETURN_NOT_OK(catalog_manager_->GetAllTables(&tables));
+  vector<RebalancerTabletInfo> tablet_infos;
+  unordered_map<string, scoped_refptr<TabletInfo>> tablets_by_id;
+  for (const auto& table : tables) {
+    {
+      TableMetadataLock table_lock(table.get(), LockMode::READ);
+      // Single-replica tablets can't be moved without making them unavailable.
+      if (!table_lock.data().is_running() ||
+          table_lock.data().pb.num_replicas() <= 1) {
+        continue;
+      }
+    }
+    vector<scoped_refptr<TabletInfo>> tablets;
+    table->GetAllTablets(&tablets);
+    for (auto& tablet : tablets) {
+      TabletMetadataLock tablet_lock(tablet.get(), LockMode::READ);
+      if (!tablet_lock.data().is_running() ||
+          !tablet_lock.data().pb.has_consensus_state()) {
+        continue;
+      }
+      const ConsensusStatePB& cstate = tablet_lock.data().pb.consensus_state();
+      RebalancerTabletInfo info;
+      info.tablet_id = tablet->id();
+      info.table_id = table->id();
+      info.leader_uuid = cstate.leader_uuid();
+      info.movable = !cstate.leader_uuid().empty() && !cstate.has_pending_config();
+      for (const auto& peer : cstate.committed_config().peers()) {
+        if (peer.member_type() == RaftPeerPB::VOTER) {
+          if (peer.attrs().replace()) {
+            info.moving_uuids.emplace_back(peer.permanent_uuid());
+            info.movable = false;
+          } else {
+            info.replica_uuids.emplace_back(peer.permanent_uuid());
+          }
+        } else {
+          info.movable = false;
+          if (peer.attrs().promote()) {
+            info.replica_uuids.emplace_back(peer.permanent_uuid());
+            info.moving_uuids.emplace_back(peer.permanent_uuid());
+          }
+        }
+      }
+      tablet_infos.emplace_back(std::move(info));
+      tablets_by_id.emplace(tablet->id(), std::move(tablet));
+    }
+  }
+
+  // Group the live tablet servers by location: replicas are only moved
+  // between tablet servers of the same location.
+  TSDescriptorVector descs;
+  ts_manager_->GetAllLiveDescriptors(&descs);
+  map<string, vector<string>> uuids_by_location;
+  unordered_set<string> saturated_uuids;
+  for (const auto& desc : descs) {
+    const auto location = desc->location();
+    uuids_by_location[location ? *location : ""].emplace_back(desc->permanent_uuid());
+    if (desc->IsDiskSaturated(FLAGS_placement_max_disk_used_ratio)) {
+      saturated_uuids.emplace(desc->permanent_uuid());
+    }
+  }
+
+  TwoDimensionalGreedyAlgo algo;
+  vector<RebalancerReplicaMove> moves;
+  for (const auto& e : uuids_by_location) {
+    const auto& uuids = e.second;
+    if (uuids.size() < 2) {
+      continue;
+    }
+    ClusterInfo ci;
+    BuildClusterInfo(uuids, tablet_infos, &ci);
+    vector<TableReplicaMove> table_moves;
+    RETURN_NOT_OK(algo.GetNextMoves(ci, uuids.size() * max_moves_per_server,
+                                    &table_moves));
+    SelectReplicaMoves(table_moves, tablet_infos, saturated_uuids,
+                       max_moves_per_server, &moves);
+  }
+
+  for (const auto& move : moves) {
+    WARN_NOT_OK(catalog_manager_->ScheduleReplicaMove(
+        FindOrDie(tablets_by_id, move.tablet_id), move.from, move.to),
+        Substitute("failed to schedule move of tablet $0 replica from $1 to $2",
+                   move.tablet_id, move.from, move.to));
+  }
+  if (!moves.empty()) {
+    LOG(INFO) << Substitute("auto-rebalancer scheduled $0 replica moves",
+                            moves.size());
+  }
+  return Status::OK();
+}
+
+void AutoRebalancerTask::BuildClusterInfo(
+    const vector<string>& tserver_uuids,
+    const vector<RebalancerTabletInfo>& tablets,
+    ClusterInfo* info) {
+  DCHECK(info);
+  // Every tablet server gets an entry for every table, so that the servers
+  // hosting no replicas of a table are candidates for hosting its replicas.
+  unordered_map<string, int32_t> total_counts;
+  for (const auto& uuid : tserver_uuids) {
+    total_counts.emplace(uuid, 0);
+  }
+  unordered_map<string, unordered_map<string, int32_t>> table_counts;
+  for (const auto& tablet : tablets) {
+    for (const auto& uuid : tablet.replica_uuids) {
+      auto* total = FindOrNull(total_counts, uuid);
+      if (!total) {
+        continue;
+      }
+      ++(*total);
+      auto& counts = LookupOrEmplace(&table_counts, tablet.table_id,
+                                     unordered_map<string, int32_t>());
+      ++counts[uuid];
+    }
+  }
+
+  ClusterInfo result;
+  for (const auto& e : total_counts) {
+    result.balance.servers_by_total_replica_count.emplace(e.second, e.first);
+  }
+  for (const auto& e : table_counts) {
+    TableBalanceInfo tbi;
+    tbi.table_id = e.first;
+    int32_t max_count = std::numeric_limits<int32_t>::min();
+    int32_t min_count = std::numeric_limits<int32_t>::max();
+    for (const auto& uuid : tserver_uuids) {
+      const int32_t count = FindWithDefault(e.second, uuid, 0);
+      tbi.servers_by_replica_count.emplace(count, uuid);
+      max_count = std::max(count, max_count);
+      min_count = std::min(count, min_count);
+    }
+    result.balance.table_info_by_skew.emplace(max_count - min_count, std::move(tbi));
+  }
+  for (const auto& uuid : tserver_uuids) {
+    result.locality.servers_by_location[""].emplace(uuid);
+    result.locality.location_by_ts_id.emplace(uuid, "");
+  }
+  *info = std::move(result);
+}
+
+void AutoRebalancerTask::SelectReplicaMoves(
+    const vector<TableReplicaMove>& table_moves,
+    const vector<RebalancerTabletInfo>& tablets,
+    const unordered_set<string>& excluded_destinations,
+    int max_moves_per_server,
+    vector<RebalancerReplicaMove>* moves) {
+  DCHECK(moves);
+  unordered_map<string, int> moves_per_server;
+  for (const auto& tablet : tablets) {
+    for (const auto& uuid : tablet.moving_uuids) {
+      ++moves_per_server[uuid];
+    }
+  }
+  unordered_set<string> moved_tablets;
+  for (const auto& move : *moves) {
+    ++moves_per_server[move.from];
+    ++moves_per_server[move.to];
+    moved_tablets.emplace(move.tablet_id);
+  }
+  unordered_map<string, vector<const RebalancerTabletInfo*>> tablets_by_table;
+  for (const auto& tablet : tablets) {
+    if (tablet.movable) {
+      tablets_by_table[tablet.table_id].emplace_back(&tablet);
+    }
+  }
+
+  for (const auto& table_move : table_moves) {
+    if (ContainsKey(excluded_destinations, table_move.to) ||
+        moves_per_server[table_move.from] >= max_moves_per_server ||
+        moves_per_server[table_move.to] >= max_moves_per_server) {
+      continue;
+    }
+    const auto* candidates = FindOrNull(tablets_by_table, table_move.table_id);
+    if (!candidates) {
+      continue;
+    }
+    for (const auto* tablet : *candidates) {
+      const auto& uuids = tablet->replica_uuids;
+      // Moving the leader replica would first require a leader step-down,
+      // so prefer the tablets whose source replica is a follower.
+      if (ContainsKey(moved_tablets, tablet->tablet_id) ||
+          tablet->leader_uuid == table_move.from ||
+          std::find(uuids.begin(), uuids.end(), table_move.from) == uuids.end() ||
+          std::find(uuids.begin(), uuids.end(), table_move.to) != uuids.end()) {
+        continue;
+      }
+      moves->push_back({ tablet->tablet_id, table_move.from, table_move.to });
+      ++moves_per_server[table_move.from];
+      ++moves_per_server[table_move.to];
+      moved_tablets.emplace(tablet->tablet_id);
+      break;
+    }
+  }
+}
+
+} // namespace master
+} // namespace kudu
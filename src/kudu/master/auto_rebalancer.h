@@ -0,0 +1,159 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <gtest/gtest_prod.h>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/mutex.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class Thread;
+
+namespace tools {
+struct ClusterInfo;
+struct TableReplicaMove;
+} // namespace tools
+
+namespace master {
+
+class CatalogManager;
+class TSManager;
+
+// A snapshot of the placement of a tablet's replicas, as seen by the auto
+// rebalancer.
+struct RebalancerTabletInfo {
+  std::string tablet_id;
+  std::string table_id;
+
+  // The tablet server hosting the leader replica, if any.
+  std::string leader_uuid;
+
+  // Tablet servers counted as hosting the tablet's replicas. Replicas which
+  // are being replaced are not counted, while the replicas replacing them
+  // are: in-flight moves are treated as if they've already completed.
+  std::vector<std::string> replica_uuids;
+
+  // Tablet servers that are the source or the destination of an in-flight
+  // replica move of the tablet.
+  std::vector<std::string> moving_uuids;
+
+  // Whether one of the tablet's replicas may be moved, i.e. the tablet has a
+  // leader, all its replicas are voters, and no config change is in flight.
+  bool movable = false;
+};
+
+// A directive to move a replica of a tablet between two tablet servers.
+struct RebalancerReplicaMove {
+  std::string tablet_id;
+  std::string from;
+  std::string to;
+};
+
+// A background task which continuously rebalances the replicas of the
+// cluster's tablets across tablet servers.
+//
+// This is the master-side counterpart of the 'kudu cluster rebalance' tool:
+// every --auto_rebalancing_interval_seconds, the leader master builds the
+// cluster's balance information from the catalog's view of the tablets'
+// committed configs (rather than from a ksck run), and feeds it to the
+// same two-dimensional greedy algorithm the tool uses. Each resulting move
+// is scheduled as a single Raft config change which adds the destination as
+// a non-voter to be promoted and marks the source replica for replacement;
+// the catalog manager evicts the source replica once its replacement has
+// caught up, as it does when re-replicating any replica marked for
+// replacement.
+//
+// Rebalancing is done within each location separately, so that the moves
+// never change the placement of replicas across locations.
+//
+// To bound the impact of rebalancing on the cluster, no tablet server is
+// the source or the destination of more than
+// --auto_rebalancing_max_moves_per_server moves at a time, counting the
+// in-flight moves, and tablet servers whose data directories are saturated
+// are never chosen as destinations.
+class AutoRebalancerTask {
+ public:
+  AutoRebalancerTask(CatalogManager* catalog_manager, TSManager* ts_manager);
+  ~AutoRebalancerTask();
+
+  // Starts the rebalancer's thread.
+  Status Init() WARN_UNUSED_RESULT;
+
+  // Stops the rebalancer's thread. Moves that have already been scheduled
+  // are not cancelled.
+  void Shutdown();
+
+ private:
+  FRIEND_TEST(AutoRebalancerTest, BuildClusterInfo);
+  FRIEND_TEST(AutoRebalancerTest, SelectReplicaMoves);
+
+  // Runs the main loop of the rebalancer's thread.
+  void RunLoop();
+
+  // Runs a single rebalancing iteration if this master is the leader.
+  Status RunOnce();
+
+  // Populates 'info' with the balance information of the tablet servers in
+  // 'tserver_uuids', counting only the replicas in 'tablets' which are hosted
+  // by those tablet servers. Tables with a single replica are expected to
+  // have been filtered out of 'tablets'.
+  static void BuildClusterInfo(const std::vector<std::string>& tserver_uuids,
+                               const std::vector<RebalancerTabletInfo>& tablets,
+                               tools::ClusterInfo* info);
+
+  // Translates the table-level moves in 'table_moves' into moves of
+  // specific tablets' replicas in 'tablets', appending them to 'moves'.
+  // A move is dropped if no suitable tablet is found, if its destination is
+  // in 'excluded_destinations', or if its source or destination is already
+  // involved in 'max_moves_per_server' moves, counting in-flight ones.
+  static void SelectReplicaMoves(
+      const std::vector<tools::TableReplicaMove>& table_moves,
+      const std::vector<RebalancerTabletInfo>& tablets,
+      const std::unordered_set<std::string>& excluded_destinations,
+      int max_moves_per_server,
+      std::vector<RebalancerReplicaMove>* moves);
+
+  CatalogManager* catalog_manager_;
+  TSManager* ts_manager_;
+
+  // The rebalancer's thread.
+  scoped_refptr<kudu::Thread> thread_;
+
+  // Protects 'closing_'.
+  Mutex lock_;
+
+  // Signaled on shutdown.
+  ConditionVariable cond_;
+
+  // Set to true when the task is shutting down.
+  bool closing_;
+
+  DISALLOW_COPY_AND_ASSIGN(AutoRebalancerTask);
+};
+
+} // namespace master
+} // namespace kudu
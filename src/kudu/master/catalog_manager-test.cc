@@ -15,20 +15,31 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <cstdint>
+#include <memory>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/common.pb.h"
+#include "kudu/common/partial_row.h"
+#include "kudu/common/partition.h"
+#include "kudu/common/partition_pruner.h"
+#include "kudu/common/scan_spec.h"
+#include "kudu/common/schema.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/catalog_manager.h"
 #include "kudu/master/master.pb.h"
 #include "kudu/master/ts_descriptor.h"
+#include "kudu/util/auto_release_pool.h"
 #include "kudu/util/cow_object.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
@@ -95,6 +106,134 @@ TEST(TableInfoTest, TestAssignmentRanges) {
   }
 }
 
+// Test that only the tablets surviving partition pruning are returned when
+// looking up tablets with a partition pruner.
+TEST(TableInfoTest, TestPrunedTabletsInRange) {
+  Schema schema({ ColumnSchema("key", INT32) }, 1);
+  PartitionSchema partition_schema;
+  ASSERT_OK(PartitionSchema::FromPB(PartitionSchemaPB(), schema, &partition_schema));
+  vector<KuduPartialRow> splits;
+  for (int32_t split : { 10, 20, 30 }) {
+    KuduPartialRow row(&schema);
+    ASSERT_OK(row.SetInt32("key", split));
+    splits.emplace_back(std::move(row));
+  }
+  vector<Partition> partitions;
+  ASSERT_OK(partition_schema.CreatePartitions(splits, {}, schema, &partitions));
+  ASSERT_EQ(4, partitions.size());
+
+  scoped_refptr<TableInfo> table(new TableInfo(CURRENT_TEST_NAME()));
+  for (int i = 0; i < partitions.size(); i++) {
+    scoped_refptr<TabletInfo> tablet(new TabletInfo(table, Substitute("tablet-$0", i)));
+    {
+      TabletMetadataLock meta_lock(tablet.get(), LockMode::WRITE);
+      partitions[i].ToPB(meta_lock.mutable_data()->pb.mutable_partition());
+      meta_lock.mutable_data()->pb.set_state(SysTabletsEntryPB::RUNNING);
+      meta_lock.Commit();
+    }
+    TabletMetadataLock meta_lock(tablet.get(), LockMode::READ);
+    table->AddRemoveTablets({ tablet }, {});
+  }
+
+  auto get_tablets = [&] (const int32_t* lower, const int32_t* upper,
+                          const GetTableLocationsRequestPB& req) {
+    ScanSpec spec;
+    spec.AddPredicate(ColumnPredicate::Range(schema.column(0), lower, upper));
+    Arena arena(256);
+    AutoReleasePool pool;
+    spec.OptimizeScan(schema, &arena, &pool, false);
+    PartitionPruner pruner;
+    pruner.Init(schema, partition_schema, spec);
+    vector<scoped_refptr<TabletInfo>> tablets;
+    table->GetTabletsInRange(&req, &tablets, &pruner);
+    vector<string> ids;
+    for (const auto& tablet : tablets) {
+      ids.emplace_back(tablet->id());
+    }
+    return ids;
+  };
+
+  GetTableLocationsRequestPB req;
+  req.set_max_returned_locations(10);
+  const int32_t k5 = 5;
+  const int32_t k15 = 15;
+  const int32_t k25 = 25;
+  const int32_t k35 = 35;
+  ASSERT_EQ(vector<string>({ "tablet-1", "tablet-2" }), get_tablets(&k15, &k25, req));
+  ASSERT_EQ(vector<string>({ "tablet-3" }), get_tablets(&k35, nullptr, req));
+  ASSERT_EQ(vector<string>({ "tablet-0" }), get_tablets(nullptr, &k5, req));
+
+  // The partition key range and the maximum number of returned locations
+  // still apply.
+  req.set_max_returned_locations(1);
+  ASSERT_EQ(vector<string>({ "tablet-1" }), get_tablets(&k15, &k25, req));
+  req.set_max_returned_locations(10);
+  req.set_partition_key_start(partitions[2].partition_key_start());
+  ASSERT_EQ(vector<string>({ "tablet-2" }), get_tablets(&k15, &k25, req));
+  req.clear_partition_key_start();
+  req.set_partition_key_end(partitions[1].partition_key_start());
+  ASSERT_EQ(vector<string>({ "tablet-1" }), get_tablets(&k15, &k25, req));
+  ASSERT_EQ(vector<string>({ "tablet-0", "tablet-1" }), get_tablets(&k5, nullptr, req));
+}
+
+// Test that a tablet's cached locations are only returned while the table's
+// locations version and the cache epoch they were built at are current.
+TEST(TableInfoTest, TestCachedTabletLocations) {
+  scoped_refptr<TableInfo> table(new TableInfo(CURRENT_TEST_NAME()));
+  scoped_refptr<TabletInfo> tablet(new TabletInfo(table, "tablet"));
+  {
+    TabletMetadataLock meta_lock(tablet.get(), LockMode::READ);
+    table->AddRemoveTablets({ tablet }, {});
+  }
+  const int64_t version = table->locations_version();
+  ASSERT_EQ(nullptr, tablet->GetCachedLocations(VOTER_REPLICA, version, 0));
+
+  auto locs = std::make_shared<TabletLocationsPB>();
+  locs->set_tablet_id(tablet->id());
+  tablet->SetCachedLocations(VOTER_REPLICA, version, 0, locs);
+  ASSERT_EQ(locs, tablet->GetCachedLocations(VOTER_REPLICA, version, 0));
+
+  // Locations are cached separately per replica type filter.
+  ASSERT_EQ(nullptr, tablet->GetCachedLocations(ANY_REPLICA, version, 0));
+
+  // A newer epoch or table version makes the cached locations stale.
+  ASSERT_EQ(nullptr, tablet->GetCachedLocations(VOTER_REPLICA, version, 1));
+  table->BumpLocationsVersion();
+  ASSERT_EQ(nullptr, tablet->GetCachedLocations(
+      VOTER_REPLICA, table->locations_version(), 0));
+
+  // Older locations don't replace newer ones.
+  tablet->SetCachedLocations(VOTER_REPLICA, table->locations_version(), 0, locs);
+  tablet->SetCachedLocations(VOTER_REPLICA, version, 0,
+                             std::make_shared<TabletLocationsPB>());
+  ASSERT_EQ(locs, tablet->GetCachedLocations(
+      VOTER_REPLICA, table->locations_version(), 0));
+}
+
+// Test that releasing one tablet from a group lock leaves the others locked
+// and discards nothing but that tablet's pending mutation.
+TEST(TableInfoTest, TestGroupLockUnlockObject) {
+  scoped_refptr<TableInfo> table(new TableInfo(CURRENT_TEST_NAME()));
+  scoped_refptr<TabletInfo> t1(new TabletInfo(table, "t1"));
+  scoped_refptr<TabletInfo> t2(new TabletInfo(table, "t2"));
+
+  TabletMetadataGroupLock lock(LockMode::RELEASED);
+  lock.AddMutableInfos({ t1, t2 });
+  lock.Lock(LockMode::WRITE);
+  t1->mutable_metadata()->mutable_dirty()->pb.set_state(SysTabletsEntryPB::RUNNING);
+  t2->mutable_metadata()->mutable_dirty()->pb.set_state(SysTabletsEntryPB::RUNNING);
+
+  lock.UnlockObject(t1->id());
+  ASSERT_FALSE(t1->metadata().IsWriteLocked());
+  ASSERT_TRUE(t2->metadata().IsWriteLocked());
+
+  // Unknown keys are ignored.
+  lock.UnlockObject("unknown");
+  lock.Commit();
+  ASSERT_NE(SysTabletsEntryPB::RUNNING, t1->metadata().state().pb.state());
+  ASSERT_EQ(SysTabletsEntryPB::RUNNING, t2->metadata().state().pb.state());
+}
+
 TEST(TestTSDescriptor, TestReplicaCreationsDecay) {
   TSDescriptor ts("test");
   ASSERT_EQ(0, ts.RecentReplicaCreations());
@@ -66,13 +66,17 @@
 #include <gflags/gflags.h>
 #include <gflags/gflags_declare.h>
 #include <glog/logging.h>
+#include <google/protobuf/repeated_field.h>
 
 #include "kudu/cfile/type_encodings.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/key_encoder.h"
 #include "kudu/common/partial_row.h"
 #include "kudu/common/partition.h"
+#include "kudu/common/partition_pruner.h"
 #include "kudu/common/row_operations.h"
+#include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
 #include "kudu/common/wire_protocol.h"
@@ -99,6 +103,7 @@
 #include "kudu/gutil/walltime.h"
 #include "kudu/hms/hms_catalog.h"
 #include "kudu/master/authz_provider.h"
+#include "kudu/master/auto_rebalancer.h"
 #include "kudu/master/default_authz_provider.h"
 #include "kudu/master/hms_notification_log_listener.h"
 #include "kudu/master/master.h"
@@ -107,6 +112,7 @@
 #include "kudu/master/placement_policy.h"
 #include "kudu/master/sentry_authz_provider.h"
 #include "kudu/master/sys_catalog.h"
+#include "kudu/master/table_locations_cache.h"
 #include "kudu/master/ts_descriptor.h"
 #include "kudu/master/ts_manager.h"
 #include "kudu/rpc/messenger.h"
@@ -127,11 +133,13 @@
 #include "kudu/tablet/transactions/transaction_tracker.h"
 #include "kudu/tserver/tserver_admin.pb.h"
 #include "kudu/tserver/tserver_admin.proxy.h"
+#include "kudu/util/auto_release_pool.h"
 #include "kudu/util/condition_variable.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/mutex.h"
 #include "kudu/util/pb_util.h"
@@ -229,6 +237,21 @@ DEFINE_int32(table_locations_ttl_ms, 5 * 60 * 1000, // 5 minutes
              "until after waiting for the ttl period.");
 TAG_FLAG(table_locations_ttl_ms, advanced);
 
+DEFINE_int32(table_locations_cache_size_mb, 64,
+             "Capacity of the cache of GetTableLocations responses built by the "
+             "leader master, in MiB. Repeated lookups of the same partition key "
+             "range of a table are served from the cache as long as neither the "
+             "table's tablets nor their replicas have changed. Set to 0 to "
+             "disable the cache.");
+TAG_FLAG(table_locations_cache_size_mb, advanced);
+
+DEFINE_bool(tablet_locations_cache_enabled, true,
+            "Whether the leader master keeps the most recently built locations "
+            "of every tablet, reusing them until the tablet's table or the "
+            "tablet servers' registrations change.");
+TAG_FLAG(tablet_locations_cache_enabled, advanced);
+TAG_FLAG(tablet_locations_cache_enabled, runtime);
+
 DEFINE_bool(catalog_manager_fail_ts_rpcs, false,
             "Whether all master->TS async calls should fail. Only for testing!");
 TAG_FLAG(catalog_manager_fail_ts_rpcs, hidden);
@@ -314,9 +337,13 @@ namespace master {
 class TableLoader : public TableVisitor {
  public:
   explicit TableLoader(CatalogManager *catalog_manager)
-    : catalog_manager_(catalog_manager) {
+    : catalog_manager_(catalog_manager),
+      num_loaded_(0) {
   }
 
+  // Returns the number of tables loaded so far.
+  int64_t num_loaded() const { return num_loaded_; }
+
   Status VisitTable(const string& table_id,
                     const SysTablesEntryPB& metadata) override {
     CHECK(!ContainsKey(catalog_manager_->table_ids_map_, table_id))
@@ -345,9 +372,12 @@ class TableLoader : public TableVisitor {
       }
     }
     l.Commit();
+    num_loaded_++;
 
+    // Loading is summarized by VisitTablesAndTabletsUnlocked(); with many
+    // tables, logging every one of them slows down becoming leader.
     if (!is_deleted) {
-      LOG(INFO) << Substitute("Loaded metadata for table $0", table->ToString());
+      VLOG(1) << Substitute("Loaded metadata for table $0", table->ToString());
     }
     VLOG(2) << Substitute("Metadata for table $0: $1",
                           table->ToString(), SecureShortDebugString(metadata));
@@ -357,6 +387,8 @@ class TableLoader : public TableVisitor {
  private:
   CatalogManager *catalog_manager_;
 
+  int64_t num_loaded_;
+
   DISALLOW_COPY_AND_ASSIGN(TableLoader);
 };
 
@@ -367,9 +399,13 @@ class TableLoader : public TableVisitor {
 class TabletLoader : public TabletVisitor {
  public:
   explicit TabletLoader(CatalogManager *catalog_manager)
-    : catalog_manager_(catalog_manager) {
+    : catalog_manager_(catalog_manager),
+      num_loaded_(0) {
   }
 
+  // Returns the number of tablets loaded so far.
+  int64_t num_loaded() const { return num_loaded_; }
+
   Status VisitTablet(const string& table_id,
                      const string& tablet_id,
                      const SysTabletsEntryPB& metadata) override {
@@ -401,9 +437,10 @@ class TabletLoader : public TabletVisitor {
       // from clean state, which is uninitialized for these brand new tablets.
       TabletMetadataLock l(tablet.get(), LockMode::READ);
       table->AddRemoveTablets({ tablet }, {});
-      LOG(INFO) << Substitute("Loaded metadata for tablet $0 (table $1)",
-                              tablet_id, table->ToString());
+      VLOG(1) << Substitute("Loaded metadata for tablet $0 (table $1)",
+                            tablet_id, table->ToString());
     }
+    num_loaded_++;
 
     VLOG(2) << Substitute("Metadata for tablet $0: $1",
                           tablet_id, SecureShortDebugString(metadata));
@@ -413,6 +450,8 @@ class TabletLoader : public TabletVisitor {
  private:
   CatalogManager *catalog_manager_;
 
+  int64_t num_loaded_;
+
   DISALLOW_COPY_AND_ASSIGN(TabletLoader);
 };
 
@@ -698,6 +737,9 @@ CatalogManager::CatalogManager(Master* master)
            // closely timed consecutive elections).
            .set_max_threads(1)
            .Build(&leader_election_pool_));
+  table_locations_cache_.reset(new TableLocationsCache(
+      static_cast<size_t>(std::max(FLAGS_table_locations_cache_size_mb, 0)) * 1024 * 1024,
+      master_->metric_entity().get()));
 }
 
 CatalogManager::~CatalogManager() {
@@ -762,6 +804,10 @@ Status CatalogManager::Init(bool is_first_run) {
   RETURN_NOT_OK_PREPEND(background_tasks_->Init(),
                         "Failed to initialize catalog manager background tasks");
 
+  auto_rebalancer_.reset(new AutoRebalancerTask(this, master_->ts_manager()));
+  RETURN_NOT_OK_PREPEND(auto_rebalancer_->Init(),
+                        "Failed to initialize the auto-rebalancer task");
+
   {
     std::lock_guard<simple_spinlock> l(state_lock_);
     CHECK_EQ(kStarting, state_);
@@ -1170,18 +1216,25 @@ Status CatalogManager::VisitTablesAndTabletsUnlocked() {
   AppendValuesFromMap(table_ids_map_, &tables);
   AbortAndWaitForAllTasks(tables);
 
-  // Clear the existing state.
+  // Clear the existing state. The reloaded tables start over with fresh
+  // locations versions, so cached locations must not be reused.
   normalized_table_names_map_.clear();
   table_ids_map_.clear();
   tablet_map_.clear();
+  table_locations_cache_->Invalidate();
 
   // Visit tables and tablets, load them into memory.
+  const MonoTime start = MonoTime::Now();
   TableLoader table_loader(this);
   RETURN_NOT_OK_PREPEND(sys_catalog_->VisitTables(&table_loader),
                         "Failed while visiting tables in sys catalog");
   TabletLoader tablet_loader(this);
   RETURN_NOT_OK_PREPEND(sys_catalog_->VisitTablets(&tablet_loader),
                         "Failed while visiting tablets in sys catalog");
+  LOG_WITH_PREFIX(INFO) << Substitute(
+      "Loaded metadata for $0 tables and $1 tablets in $2",
+      table_loader.num_loaded(), tablet_loader.num_loaded(),
+      (MonoTime::Now() - start).ToString());
   return Status::OK();
 }
 
@@ -1236,6 +1289,10 @@ void CatalogManager::Shutdown() {
     background_tasks_->Shutdown();
   }
 
+  if (auto_rebalancer_) {
+    auto_rebalancer_->Shutdown();
+  }
+
   if (authz_provider_) {
     authz_provider_->Stop();
   }
@@ -2014,6 +2071,7 @@ Status CatalogManager::DeleteTable(const DeleteTableRequestPB& req,
   // 6. Commit the dirty table state.
   TRACE("Committing in-memory state");
   l.Commit();
+  table->BumpLocationsVersion();
 
   // 7. Abort any extant tasks belonging to the table.
   TRACE("Aborting table tasks");
@@ -2646,6 +2704,7 @@ Status CatalogManager::AlterTable(const AlterTableRequestPB& req,
   // GetTabletLocations returns a deleted tablet, the retry will never include
   // the tablet again.
   tablets_to_drop_lock.Commit();
+  table->BumpLocationsVersion();
 
   // If there are schema changes, then update the entry in the Hive Metastore.
   // This is done on a best-effort basis, since Kudu is the source of truth for
@@ -3721,6 +3780,83 @@ bool AsyncEvictReplicaTask::SendRequest(int attempt) {
   return true;
 }
 
+// Moves a replica of a tablet to another tablet server, by adding the new
+// replica as a non-voter to be promoted and marking the replica being moved
+// for replacement in a single config change. Once the new replica is
+// promoted, the replica marked for replacement is evicted as part of the
+// regular processing of the tablet's reports.
+class AsyncMoveReplicaTask : public AsyncChangeConfigTask {
+ public:
+  AsyncMoveReplicaTask(Master* master,
+                       scoped_refptr<TabletInfo> tablet,
+                       ConsensusStatePB cstate,
+                       string from_uuid,
+                       shared_ptr<TSDescriptor> to_desc);
+
+  string type_name() const override;
+
+ protected:
+  bool SendRequest(int attempt) override;
+
+ private:
+  const string from_uuid_;
+  const shared_ptr<TSDescriptor> to_desc_;
+};
+
+AsyncMoveReplicaTask::AsyncMoveReplicaTask(Master* master,
+                                           scoped_refptr<TabletInfo> tablet,
+                                           ConsensusStatePB cstate,
+                                           string from_uuid,
+                                           shared_ptr<TSDescriptor> to_desc)
+    : AsyncChangeConfigTask(master, std::move(tablet), std::move(cstate),
+                            consensus::ADD_PEER),
+      from_uuid_(std::move(from_uuid)),
+      to_desc_(std::move(to_desc)) {
+}
+
+string AsyncMoveReplicaTask::type_name() const {
+  return "ChangeConfig:MoveReplica";
+}
+
+bool AsyncMoveReplicaTask::SendRequest(int attempt) {
+  // Bail if we're retrying in vain.
+  if (!CheckOpIdIndex()) {
+    return false;
+  }
+
+  LOG(INFO) << Substitute("Sending $0 on tablet $1 from $2 to $3 (attempt $4)",
+                          type_name(), tablet_->id(), from_uuid_,
+                          to_desc_->permanent_uuid(), attempt);
+
+  consensus::BulkChangeConfigRequestPB req;
+  req.set_dest_uuid(target_ts_desc_->permanent_uuid());
+  req.set_tablet_id(tablet_->id());
+  req.set_cas_config_opid_index(cstate_.committed_config().opid_index());
+  {
+    auto* change = req.add_config_changes();
+    change->set_type(consensus::MODIFY_PEER);
+    change->mutable_peer()->set_permanent_uuid(from_uuid_);
+    change->mutable_peer()->mutable_attrs()->set_replace(true);
+  }
+  {
+    auto* change = req.add_config_changes();
+    change->set_type(consensus::ADD_PEER);
+    RaftPeerPB* peer = change->mutable_peer();
+    peer->set_permanent_uuid(to_desc_->permanent_uuid());
+    peer->set_member_type(RaftPeerPB::NON_VOTER);
+    peer->mutable_attrs()->set_promote(true);
+    ServerRegistrationPB peer_reg;
+    to_desc_->GetRegistration(&peer_reg);
+    CHECK_GT(peer_reg.rpc_addresses_size(), 0);
+    *peer->mutable_last_known_addr() = peer_reg.rpc_addresses(0);
+  }
+  VLOG(1) << Substitute("Sending $0 request to $1: $2",
+                        type_name(), target_ts_desc_->ToString(), SecureDebugString(req));
+  consensus_proxy_->BulkChangeConfigAsync(req, &resp_, &rpc_,
+                                          boost::bind(&AsyncMoveReplicaTask::RpcCallback, this));
+  return true;
+}
+
 Status CatalogManager::ProcessTabletReport(
     TSDescriptor* ts_desc,
     const TabletReportPB& full_report,
@@ -4060,10 +4196,15 @@ Status CatalogManager::ProcessTabletReport(
     }
 
     // 9. If the tablet was mutated, add it to the tablets to be re-persisted.
+    // Otherwise, release its lock right away: every tserver hosting one of
+    // its replicas reports the tablet, and there's no reason for them to wait
+    // on this report's catalog write when nothing is going to be written.
     //
     // Done here and not on a per-mutation basis to avoid duplicate entries.
     if (tablet_was_mutated) {
       mutated_tablets.push_back(tablet);
+    } else {
+      tablets_lock.UnlockObject(tablet_id);
     }
   }
 
@@ -4089,6 +4230,9 @@ Status CatalogManager::ProcessTabletReport(
 
   // 12. Publish the in-memory tablet mutations and release the locks.
   tablets_lock.Commit();
+  for (const auto& tablet : actions.tablets_to_update) {
+    tablet->table()->BumpLocationsVersion();
+  }
 
   // 13. Process all tablet schema version changes.
   //
@@ -4482,6 +4626,9 @@ Status CatalogManager::ProcessPendingAssignments(
   // Expose tablet metadata changes before the new tablets themselves.
   lock_out.Commit();
   lock_in.Commit();
+  for (const auto& t : deferred.tablets_to_update) {
+    t->table()->BumpLocationsVersion();
+  }
 
   for (const auto& t : deferred.tablets_to_add) {
     // We can't reuse the WRITE tablet locks from committer_out for this
@@ -4585,6 +4732,20 @@ Status CatalogManager::BuildLocationsForTablet(
     const scoped_refptr<TabletInfo>& tablet,
     master::ReplicaTypeFilter filter,
     TabletLocationsPB* locs_pb) {
+  // As in GetTableLocations(), the version and epoch must be read before
+  // building the locations so that a racing change makes them stale.
+  const bool use_cache = FLAGS_tablet_locations_cache_enabled;
+  const int64_t locations_version = tablet->table()->locations_version();
+  const int64_t cache_epoch = table_locations_cache_->epoch();
+  if (use_cache) {
+    shared_ptr<const TabletLocationsPB> cached =
+        tablet->GetCachedLocations(filter, locations_version, cache_epoch);
+    if (cached) {
+      locs_pb->CopyFrom(*cached);
+      return Status::OK();
+    }
+  }
+
   TabletMetadataLock l_tablet(tablet.get(), LockMode::READ);
   if (PREDICT_FALSE(l_tablet.data().is_deleted())) {
     return Status::NotFound("Tablet deleted", l_tablet.data().pb.state_msg());
@@ -4634,6 +4795,9 @@ Status CatalogManager::BuildLocationsForTablet(
       ServerRegistrationPB reg;
       ts_desc->GetRegistration(&reg);
       tsinfo_pb->mutable_rpc_addresses()->Swap(reg.mutable_rpc_addresses());
+      if (reg.has_unix_domain_socket_path()) {
+        tsinfo_pb->set_unix_domain_socket_path(reg.unix_domain_socket_path());
+      }
       if (ts_desc->location()) tsinfo_pb->set_location(*(ts_desc->location()));
     } else {
       // If we've never received a heartbeat from the tserver, we'll fall back
@@ -4650,6 +4814,10 @@ Status CatalogManager::BuildLocationsForTablet(
   // No longer used; always set to false.
   locs_pb->set_deprecated_stale(false);
 
+  if (use_cache) {
+    tablet->SetCachedLocations(filter, locations_version, cache_epoch,
+                               std::make_shared<const TabletLocationsPB>(*locs_pb));
+  }
   return Status::OK();
 }
 
@@ -4751,6 +4919,7 @@ Status CatalogManager::ReplaceTablet(const string& tablet_id, ReplaceTabletRespo
 
   // Commit state changes for the old tablet.
   l_old_tablet.Commit();
+  table->BumpLocationsVersion();
 
   // Finish up by kicking off the delete of the old tablet.
   {
@@ -4765,6 +4934,33 @@ Status CatalogManager::ReplaceTablet(const string& tablet_id, ReplaceTabletRespo
   return Status::OK();
 }
 
+namespace {
+
+// Initializes 'pruner' with the predicates of a GetTableLocations request
+// against the table with the metadata in 'table_pb'.
+Status InitPartitionPruner(const SysTablesEntryPB& table_pb,
+                           const google::protobuf::RepeatedPtrField<ColumnPredicatePB>& preds,
+                           PartitionPruner* pruner) {
+  Schema schema;
+  RETURN_NOT_OK(SchemaFromPB(table_pb.schema(), &schema));
+  PartitionSchema partition_schema;
+  RETURN_NOT_OK(PartitionSchema::FromPB(table_pb.partition_schema(), schema, &partition_schema));
+
+  Arena arena(1024);
+  AutoReleasePool pool;
+  ScanSpec spec;
+  for (const auto& pred_pb : preds) {
+    boost::optional<ColumnPredicate> pred;
+    RETURN_NOT_OK(ColumnPredicateFromPB(schema, &arena, pred_pb, &pred));
+    spec.AddPredicate(std::move(*pred));
+  }
+  spec.OptimizeScan(schema, &arena, &pool, /* remove_pushed_predicates */ false);
+  pruner->Init(schema, partition_schema, spec);
+  return Status::OK();
+}
+
+} // anonymous namespace
+
 Status CatalogManager::GetTableLocations(const GetTableLocationsRequestPB* req,
                                          GetTableLocationsResponsePB* resp,
                                          optional<const string&> user) {
@@ -4793,8 +4989,27 @@ Status CatalogManager::GetTableLocations(const GetTableLocationsRequestPB* req,
                                           &table, &l));
   RETURN_NOT_OK(CheckIfTableDeletedOrNotRunning(&l, resp));
 
+  // The version and epoch must be read before building the locations: if
+  // either moves while the locations are built, the inserted entry will be
+  // considered stale by subsequent lookups.
+  const string cache_key = TableLocationsCache::MakeKey(table->id(), *req);
+  const int64_t locations_version = table->locations_version();
+  const int64_t cache_epoch = table_locations_cache_->epoch();
+  if (table_locations_cache_->Lookup(cache_key, locations_version, resp)) {
+    TRACE("Served table locations from cache");
+    resp->set_ttl_millis(FLAGS_table_locations_ttl_ms);
+    return Status::OK();
+  }
+
   vector<scoped_refptr<TabletInfo>> tablets_in_range;
-  table->GetTabletsInRange(req, &tablets_in_range);
+  if (req->predicates_size() > 0) {
+    PartitionPruner pruner;
+    RETURN_NOT_OK(SetupError(InitPartitionPruner(l.data().pb, req->predicates(), &pruner),
+                             resp, MasterErrorPB::UNKNOWN_ERROR));
+    table->GetTabletsInRange(req, &tablets_in_range, &pruner);
+  } else {
+    table->GetTabletsInRange(req, &tablets_in_range);
+  }
 
   for (const auto& tablet : tablets_in_range) {
     Status s = BuildLocationsForTablet(
@@ -4822,10 +5037,65 @@ Status CatalogManager::GetTableLocations(const GetTableLocationsRequestPB* req,
           << s.ToString();
     }
   }
+  if (!resp->has_error()) {
+    table_locations_cache_->Insert(cache_key, locations_version, cache_epoch, *resp);
+  }
   resp->set_ttl_millis(FLAGS_table_locations_ttl_ms);
   return Status::OK();
 }
 
+void CatalogManager::InvalidateTableLocationsCache() {
+  table_locations_cache_->Invalidate();
+}
+
+Status CatalogManager::ScheduleReplicaMove(const scoped_refptr<TabletInfo>& tablet,
+                                           const string& from_uuid,
+                                           const string& to_uuid) {
+  leader_lock_.AssertAcquiredForReading();
+  RETURN_NOT_OK(CheckOnline());
+
+  ConsensusStatePB cstate;
+  {
+    TabletMetadataLock l(tablet.get(), LockMode::READ);
+    if (!l.data().is_running() || !l.data().pb.has_consensus_state()) {
+      return Status::IllegalState("tablet is not running", tablet->id());
+    }
+    cstate = l.data().pb.consensus_state();
+  }
+  if (cstate.has_pending_config()) {
+    return Status::IllegalState("tablet has a pending config change", tablet->id());
+  }
+  bool is_source_voter = false;
+  for (const auto& peer : cstate.committed_config().peers()) {
+    if (peer.permanent_uuid() == to_uuid) {
+      return Status::AlreadyPresent(Substitute(
+          "tablet server $0 already hosts a replica of tablet $1",
+          to_uuid, tablet->id()));
+    }
+    if (peer.member_type() != RaftPeerPB::VOTER || peer.attrs().replace()) {
+      return Status::IllegalState("tablet has a replica move in flight", tablet->id());
+    }
+    if (peer.permanent_uuid() == from_uuid) {
+      is_source_voter = true;
+    }
+  }
+  if (!is_source_voter) {
+    return Status::NotFound(Substitute(
+        "tablet server $0 doesn't host a voter replica of tablet $1",
+        from_uuid, tablet->id()));
+  }
+  shared_ptr<TSDescriptor> to_desc;
+  if (!master_->ts_manager()->LookupTSByUUID(to_uuid, &to_desc)) {
+    return Status::NotFound("unknown tablet server", to_uuid);
+  }
+
+  auto* task = new AsyncMoveReplicaTask(master_, tablet, std::move(cstate),
+                                        from_uuid, std::move(to_desc));
+  tablet->table()->AddTask(task);
+  WARN_NOT_OK(task->Run(), Substitute("Failed to send $0", task->description()));
+  return Status::OK();
+}
+
 void CatalogManager::DumpState(std::ostream* out) const {
   TableInfoMap ids_copy, names_copy;
   TabletInfoMap tablets_copy;
@@ -5140,6 +5410,37 @@ int64_t TabletInfo::reported_schema_version() const {
   return reported_schema_version_;
 }
 
+shared_ptr<const TabletLocationsPB> TabletInfo::GetCachedLocations(
+    ReplicaTypeFilter filter, int64_t version, int64_t epoch) const {
+  if (filter != ANY_REPLICA && filter != VOTER_REPLICA) {
+    return nullptr;
+  }
+  std::lock_guard<simple_spinlock> l(lock_);
+  const CachedLocations& cached = cached_locations_[filter];
+  if (cached.version != version || cached.epoch != epoch) {
+    return nullptr;
+  }
+  return cached.locs;
+}
+
+void TabletInfo::SetCachedLocations(ReplicaTypeFilter filter,
+                                    int64_t version,
+                                    int64_t epoch,
+                                    shared_ptr<const TabletLocationsPB> locs) {
+  if (filter != ANY_REPLICA && filter != VOTER_REPLICA) {
+    return;
+  }
+  std::lock_guard<simple_spinlock> l(lock_);
+  CachedLocations* cached = &cached_locations_[filter];
+  if (cached->version > version ||
+      (cached->version == version && cached->epoch >= epoch)) {
+    return;
+  }
+  cached->version = version;
+  cached->epoch = epoch;
+  cached->locs = std::move(locs);
+}
+
 string TabletInfo::ToString() const {
   return Substitute("$0 (table $1)", tablet_id_,
                     (table_ != nullptr ? table_->ToString() : "MISSING"));
@@ -5154,7 +5455,10 @@ void PersistentTabletInfo::set_state(SysTabletsEntryPB::State state, const strin
 // TableInfo
 ////////////////////////////////////////////////////////////
 
-TableInfo::TableInfo(string table_id) : table_id_(std::move(table_id)) {}
+TableInfo::TableInfo(string table_id)
+    : table_id_(std::move(table_id)),
+      locations_version_(0) {
+}
 
 TableInfo::~TableInfo() {
 }
@@ -5187,6 +5491,7 @@ void TableInfo::AddRemoveTablets(const vector<scoped_refptr<TabletInfo>>& tablet
     }
     IncrementSchemaVersionCountUnlocked(tablet->reported_schema_version());
   }
+  BumpLocationsVersion();
 
 #ifndef NDEBUG
   if (tablet_map_.empty()) {
@@ -5196,10 +5501,48 @@ void TableInfo::AddRemoveTablets(const vector<scoped_refptr<TabletInfo>>& tablet
 }
 
 void TableInfo::GetTabletsInRange(const GetTableLocationsRequestPB* req,
-                                  vector<scoped_refptr<TabletInfo>>* ret) const {
+                                  vector<scoped_refptr<TabletInfo>>* ret,
+                                  PartitionPruner* pruner) const {
   shared_lock<rw_spinlock> l(lock_);
   int max_returned_locations = req->max_returned_locations();
 
+  if (pruner) {
+    // Jump straight from one partition key range that survived pruning to
+    // the next, rather than visiting every tablet in between.
+    if (req->has_partition_key_start()) {
+      pruner->RemovePartitionKeyRange(req->partition_key_start());
+    }
+    int count = 0;
+    while (pruner->HasMorePartitionKeyRanges() && count < max_returned_locations) {
+      const string& key = pruner->NextPartitionKey();
+      auto it = tablet_map_.upper_bound(key);
+      if (it != tablet_map_.begin()) {
+        --it;
+      }
+      if (it == tablet_map_.end()) {
+        break;
+      }
+      if (it->first > key) {
+        // The range starts before the first tablet; skip to the tablet.
+        pruner->RemovePartitionKeyRange(it->first);
+        continue;
+      }
+      if (req->has_partition_key_end() && it->first > req->partition_key_end()) {
+        break;
+      }
+      ret->emplace_back(make_scoped_refptr(it->second));
+      count++;
+      // No other tablet contains keys below the next tablet's start, even
+      // if this tablet's partition ends before it.
+      const auto next = std::next(it);
+      if (next == tablet_map_.end()) {
+        break;
+      }
+      pruner->RemovePartitionKeyRange(next->first);
+    }
+    return;
+  }
+
   RawTabletInfoMap::const_iterator it, it_end;
   if (req->has_partition_key_start()) {
     it = tablet_map_.upper_bound(req->partition_key_start());
@@ -43,6 +43,7 @@
 #include "kudu/master/master.pb.h"
 #include "kudu/tserver/tablet_replica_lookup.h"
 #include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/cow_object.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/monotime.h"
@@ -58,6 +59,7 @@ class CreateTableStressTest_TestConcurrentCreateTableAndReloadMetadata_Test;
 class MonitoredTask;
 class NodeInstancePB;
 class PartitionPB;
+class PartitionPruner;
 class PartitionSchema;
 class Schema;
 class ThreadPool;
@@ -94,12 +96,14 @@ class TabletReplica;
 namespace master {
 
 class AuthzProvider;
+class AutoRebalancerTask;
 class CatalogManagerBgTasks;
 class HmsNotificationLogListenerTask;
 class Master;
 class PlacementPolicy;
 class SysCatalogTable;
 class TSDescriptor;
+class TableLocationsCache;
 class TableInfo;
 
 struct DeferredAssignmentActions;
@@ -176,6 +180,19 @@ class TabletInfo : public RefCountedThreadSafe<TabletInfo> {
   // Simple accessor for reported_schema_version_.
   int64_t reported_schema_version() const;
 
+  // Returns the tablet's locations previously built for 'filter' if they
+  // were built at the table's locations version 'version' and within the
+  // table locations cache epoch 'epoch'. Otherwise returns null.
+  std::shared_ptr<const TabletLocationsPB> GetCachedLocations(
+      ReplicaTypeFilter filter, int64_t version, int64_t epoch) const;
+
+  // Caches the tablet's locations built for 'filter'. The 'version' and
+  // 'epoch' must have been read before the locations started being built.
+  void SetCachedLocations(ReplicaTypeFilter filter,
+                          int64_t version,
+                          int64_t epoch,
+                          std::shared_ptr<const TabletLocationsPB> locs);
+
   // No synchronization needed.
   std::string ToString() const;
 
@@ -183,6 +200,13 @@ class TabletInfo : public RefCountedThreadSafe<TabletInfo> {
   friend class RefCountedThreadSafe<TabletInfo>;
   ~TabletInfo();
 
+  // Locations of the tablet built for a particular replica type filter.
+  struct CachedLocations {
+    int64_t version = -1;
+    int64_t epoch = -1;
+    std::shared_ptr<const TabletLocationsPB> locs;
+  };
+
   const std::string tablet_id_;
   const scoped_refptr<TableInfo> table_;
 
@@ -200,6 +224,9 @@ class TabletInfo : public RefCountedThreadSafe<TabletInfo> {
   // Set to NOT_YET_REPORTED when the tablet hasn't yet reported.
   int64_t reported_schema_version_;
 
+  // Cached locations, indexed by ReplicaTypeFilter (in-memory only).
+  CachedLocations cached_locations_[2];
+
   DISALLOW_COPY_AND_ASSIGN(TabletInfo);
 };
 
@@ -254,8 +281,12 @@ class TableInfo : public RefCountedThreadSafe<TableInfo> {
                         const std::vector<scoped_refptr<TabletInfo>>& tablets_to_drop);
 
   // This only returns tablets which are in RUNNING state.
+  //
+  // If 'pruner' is set, only the tablets overlapping the pruner's partition
+  // key ranges are returned; the pruner's ranges are consumed in the process.
   void GetTabletsInRange(const GetTableLocationsRequestPB* req,
-                         std::vector<scoped_refptr<TabletInfo>>* ret) const;
+                         std::vector<scoped_refptr<TabletInfo>>* ret,
+                         PartitionPruner* pruner = nullptr) const;
 
   // Adds all tablets to the vector in partition key sorted order.
   void GetAllTablets(std::vector<scoped_refptr<TabletInfo>>* ret) const;
@@ -295,6 +326,15 @@ class TableInfo : public RefCountedThreadSafe<TableInfo> {
     return tablet_map_.size();
   }
 
+  // Returns the version of the table's tablet locations. The version is
+  // bumped whenever a change which may affect the result of a
+  // GetTableLocations request against the table has been published.
+  int64_t locations_version() const { return locations_version_.Load(); }
+
+  // Bumps the version of the table's tablet locations. Must be called after
+  // the corresponding table or tablet changes have been made visible.
+  void BumpLocationsVersion() { locations_version_.Increment(); }
+
  private:
   friend class RefCountedThreadSafe<TableInfo>;
   friend class TabletInfo;
@@ -321,6 +361,9 @@ class TableInfo : public RefCountedThreadSafe<TableInfo> {
 
   CowObject<PersistentTableInfo> metadata_;
 
+  // See locations_version().
+  AtomicInt<int64_t> locations_version_;
+
   // List of pending tasks (e.g. create/alter tablet requests)
   std::unordered_set<MonitoredTask*> pending_tasks_;
 
@@ -596,6 +639,24 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
                            GetTableLocationsResponsePB* resp,
                            boost::optional<const std::string&> user);
 
+  // Invalidates every cached GetTableLocations response. Must be called when
+  // the registration of a tablet server changes, since the responses embed
+  // the tablet servers' addresses and locations.
+  void InvalidateTableLocationsCache();
+
+  // Schedules an asynchronous move of the replica of 'tablet' hosted by the
+  // tablet server 'from_uuid' to the tablet server 'to_uuid'. The move is
+  // done by a single config change which adds the new replica as a non-voter
+  // to be promoted and marks the replica being moved for replacement.
+  //
+  // Returns an error if the tablet's config doesn't allow for the move, e.g.
+  // the source isn't a voter of the config, the destination is already in
+  // the config, or another config change is in flight. Caller must hold
+  // leader_lock_.
+  Status ScheduleReplicaMove(const scoped_refptr<TabletInfo>& tablet,
+                             const std::string& from_uuid,
+                             const std::string& to_uuid);
+
   // Look up the locations of the given tablet. If 'user' is provided, checks
   // that the user is authorized to get such information. Adds only information
   // on replicas which satisfy the 'filter'. The locations vector is overwritten
@@ -679,6 +740,11 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
 
   virtual const NodeInstancePB& NodeInstance() const override;
 
+  // The opening of the system tablet is never deferred.
+  virtual void OpenTabletIfDeferred(
+      const scoped_refptr<tablet::TabletReplica>& /*replica*/) override {
+  }
+
   bool IsInitialized() const;
 
   virtual void StartTabletCopy(
@@ -693,6 +759,10 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
     return hms_catalog_.get();
   }
 
+  master::AuthzProvider* authz_provider() const {
+    return authz_provider_.get();
+  }
+
   // Returns the normalized form of the provided table name.
   //
   // If the HMS integration is configured and the table name is a valid HMS
@@ -843,6 +913,10 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
   // and the replica type filter specified. Populates locs_pb and returns
   // Status::OK on success. Returns Status::ServiceUnavailable if tablet is
   // not running.
+  //
+  // Unless disabled with --tablet_locations_cache_enabled, the built
+  // locations are kept in the TabletInfo and reused while they remain
+  // valid (see TabletInfo::GetCachedLocations()).
   Status BuildLocationsForTablet(const scoped_refptr<TabletInfo>& tablet,
                                  master::ReplicaTypeFilter filter,
                                  TabletLocationsPB* locs_pb);
@@ -1024,6 +1098,9 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
   std::unique_ptr<hms::HmsCatalog> hms_catalog_;
   std::unique_ptr<HmsNotificationLogListenerTask> hms_notification_log_listener_;
 
+  // Background task rebalancing the tablets' replicas across tablet servers.
+  std::unique_ptr<AutoRebalancerTask> auto_rebalancer_;
+
   std::unique_ptr<master::AuthzProvider> authz_provider_;
 
   enum State {
@@ -1042,6 +1119,9 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
   // Singleton pool that serializes invocations of ElectedAsLeaderCb().
   gscoped_ptr<ThreadPool> leader_election_pool_;
 
+  // Cache of built GetTableLocations responses.
+  std::unique_ptr<TableLocationsCache> table_locations_cache_;
+
   // This field is updated when a node becomes leader master,
   // waits for all outstanding uncommitted metadata (table and tablet metadata)
   // in the sys catalog to commit, and then reads that metadata into in-memory
@@ -0,0 +1,111 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/master/compaction_coordinator.h"
+
+#include <string>
+#include <vector>
+
+#include <gflags/gflags_declare.h>
+#include <gtest/gtest.h>
+
+#include "kudu/master/master.pb.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/test_util.h"
+
+DECLARE_int32(master_compaction_report_expiry_ms);
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+namespace master {
+
+class CompactionCoordinatorTest : public KuduTest {
+ protected:
+  // Process a report of 'ts_uuid' with the replica of 'tablet_id', unless
+  // it's empty, and return the deferred tablets.
+  vector<string> Report(const string& ts_uuid, const string& tablet_id,
+                        bool compacting, bool has_backlog) {
+    CompactionReportPB report;
+    if (!tablet_id.empty()) {
+      auto* tablet_pb = report.add_tablets();
+      tablet_pb->set_tablet_id(tablet_id);
+      tablet_pb->set_compacting(compacting);
+      tablet_pb->set_has_backlog(has_backlog);
+    }
+    vector<string> deferred;
+    coordinator_.ProcessReport(ts_uuid, report, now_, &deferred);
+    return deferred;
+  }
+
+  CompactionCoordinator coordinator_;
+  MonoTime now_ = MonoTime::Now();
+};
+
+TEST_F(CompactionCoordinatorTest, TestStaggersCompactions) {
+  const vector<string> kNone;
+  const vector<string> kTablet = { "tablet" };
+
+  // The first replica with a backlog may compact, the others wait for it.
+  ASSERT_EQ(kNone, Report("ts1", "tablet", false, true));
+  ASSERT_EQ(kTablet, Report("ts2", "tablet", false, true));
+  ASSERT_EQ(kTablet, Report("ts3", "tablet", false, true));
+  ASSERT_EQ(kNone, Report("ts1", "tablet", true, true));
+  ASSERT_EQ(kTablet, Report("ts2", "tablet", false, true));
+
+  // Other tablets are independent.
+  ASSERT_EQ(kNone, Report("ts2", "other", false, true));
+
+  // Once the compacting replica is done, another one may compact.
+  ASSERT_EQ(kNone, Report("ts1", "", false, false));
+  ASSERT_EQ(kNone, Report("ts2", "tablet", false, true));
+  ASSERT_EQ(kTablet, Report("ts3", "tablet", false, true));
+  ASSERT_EQ(kTablet, Report("ts1", "tablet", false, true));
+
+  // Running compactions aren't deferred, even if another replica was allowed
+  // to compact, since they can't be stopped. They defer the others though.
+  ASSERT_EQ(kNone, Report("ts3", "tablet", true, true));
+  ASSERT_EQ(kNone, Report("ts2", "", false, false));
+  ASSERT_EQ(kTablet, Report("ts1", "tablet", false, true));
+  ASSERT_EQ(kNone, Report("ts3", "", false, false));
+  ASSERT_EQ(kNone, Report("ts1", "tablet", false, true));
+
+  // The tablets are forgotten once no replica reports them.
+  ASSERT_EQ(1, coordinator_.NumTabletsForTests());
+  ASSERT_EQ(kNone, Report("ts1", "", false, false));
+  ASSERT_EQ(0, coordinator_.NumTabletsForTests());
+}
+
+// Test that the replicas which stop reporting don't defer the compactions of
+// the others forever.
+TEST_F(CompactionCoordinatorTest, TestReportsExpire) {
+  const vector<string> kNone;
+  const vector<string> kTablet = { "tablet" };
+  ASSERT_EQ(kNone, Report("ts1", "tablet", true, false));
+  ASSERT_EQ(kTablet, Report("ts2", "tablet", false, true));
+
+  now_ += MonoDelta::FromMilliseconds(FLAGS_master_compaction_report_expiry_ms / 2);
+  ASSERT_EQ(kTablet, Report("ts2", "tablet", false, true));
+
+  now_ += MonoDelta::FromMilliseconds(FLAGS_master_compaction_report_expiry_ms);
+  ASSERT_EQ(kNone, Report("ts2", "tablet", false, true));
+  ASSERT_EQ(kTablet, Report("ts1", "tablet", false, true));
+}
+
+} // namespace master
+} // namespace kudu
@@ -0,0 +1,140 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/master/compaction_coordinator.h"
+
+#include <mutex>
+#include <utility>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/map-util.h"
+#include "kudu/master/master.pb.h"
+#include "kudu/util/flag_tags.h"
+
+DEFINE_int32(master_compaction_report_expiry_ms, 10 * 1000,
+             "The period of time after which the master forgets the reported "
+             "compactions of a tablet replica, if its tablet server doesn't "
+             "report it again. A replica which was allowed to compact stops "
+             "deferring the compactions of the other replicas then.");
+TAG_FLAG(master_compaction_report_expiry_ms, experimental);
+TAG_FLAG(master_compaction_report_expiry_ms, runtime);
+
+using std::string;
+using std::unordered_set;
+using std::vector;
+
+namespace kudu {
+namespace master {
+
+bool CompactionCoordinator::IsReplicaActive(const TabletState& tablet,
+                                            const string& ts_uuid,
+                                            const MonoTime& now) {
+  const ReplicaState* replica = FindOrNull(tablet.replicas, ts_uuid);
+  return replica && now - replica->last_report <
+      MonoDelta::FromMilliseconds(FLAGS_master_compaction_report_expiry_ms);
+}
+
+void CompactionCoordinator::ProcessReport(const string& ts_uuid,
+                                          const CompactionReportPB& report,
+                                          const MonoTime& now,
+                                          vector<string>* deferred_tablet_ids) {
+  deferred_tablet_ids->clear();
+  unordered_set<string> reported;
+  for (const auto& tablet_pb : report.tablets()) {
+    reported.insert(tablet_pb.tablet_id());
+  }
+
+  std::lock_guard<simple_spinlock> l(lock_);
+
+  // Forget the replicas which are neither compacting nor have a backlog
+  // anymore. They don't defer the compactions of the other replicas.
+  auto& prev_reported = tablets_by_ts_[ts_uuid];
+  for (const auto& tablet_id : prev_reported) {
+    if (ContainsKey(reported, tablet_id)) {
+      continue;
+    }
+    auto it = tablets_.find(tablet_id);
+    if (it == tablets_.end()) {
+      continue;
+    }
+    it->second.replicas.erase(ts_uuid);
+    if (it->second.compacting_ts_uuid == ts_uuid) {
+      it->second.compacting_ts_uuid.clear();
+    }
+    if (it->second.replicas.empty()) {
+      tablets_.erase(it);
+    }
+  }
+
+  for (const auto& tablet_pb : report.tablets()) {
+    TabletState& tablet = tablets_[tablet_pb.tablet_id()];
+    ReplicaState& replica = tablet.replicas[ts_uuid];
+    replica.compacting = tablet_pb.compacting();
+    replica.last_report = now;
+
+    // Forget the replicas whose tablet servers stopped reporting.
+    for (auto it = tablet.replicas.begin(); it != tablet.replicas.end();) {
+      if (!IsReplicaActive(tablet, it->first, now)) {
+        it = tablet.replicas.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    if (!ContainsKey(tablet.replicas, tablet.compacting_ts_uuid)) {
+      tablet.compacting_ts_uuid.clear();
+    }
+
+    // Another replica is busy if it's allowed to compact, or if it started
+    // compacting concurrently with this one before either was reported.
+    bool other_replica_busy = !tablet.compacting_ts_uuid.empty() &&
+        tablet.compacting_ts_uuid != ts_uuid;
+    for (const auto& other : tablet.replicas) {
+      if (other.first != ts_uuid && other.second.compacting) {
+        other_replica_busy = true;
+      }
+    }
+
+    if (tablet_pb.compacting()) {
+      // A running compaction can't be stopped.
+      if (tablet.compacting_ts_uuid.empty()) {
+        tablet.compacting_ts_uuid = ts_uuid;
+      }
+    } else if (other_replica_busy) {
+      deferred_tablet_ids->push_back(tablet_pb.tablet_id());
+    } else {
+      tablet.compacting_ts_uuid = ts_uuid;
+    }
+  }
+
+  if (reported.empty()) {
+    tablets_by_ts_.erase(ts_uuid);
+  } else {
+    prev_reported = std::move(reported);
+  }
+  VLOG(2) << "Deferred the compactions of " << deferred_tablet_ids->size()
+          << " tablets of tablet server " << ts_uuid;
+}
+
+int CompactionCoordinator::NumTabletsForTests() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return tablets_.size();
+}
+
+} // namespace master
+} // namespace kudu
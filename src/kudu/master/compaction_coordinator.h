@@ -0,0 +1,91 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
+
+namespace kudu {
+namespace master {
+
+class CompactionReportPB;
+
+// Staggers the heavy compactions (rowset and major delta compactions) of the
+// replicas of each tablet, so that the other replicas stay available as
+// low-latency read targets while one of them compacts.
+//
+// The tablet servers report the replicas which are compacting or have a
+// backlog of compactions in their heartbeats. The first replica of a tablet to
+// report a backlog is allowed to compact, and the compactions of the others
+// are deferred until it's done: until it reports neither a running
+// compaction nor a backlog, or until it stops reporting.
+//
+// This class is thread-safe.
+class CompactionCoordinator {
+ public:
+  CompactionCoordinator() = default;
+
+  // Process the compaction report of the tablet server 'ts_uuid', received
+  // at 'now'. Fills 'deferred_tablet_ids' with the tablets on which the
+  // tablet server should not start heavy compactions.
+  void ProcessReport(const std::string& ts_uuid,
+                     const CompactionReportPB& report,
+                     const MonoTime& now,
+                     std::vector<std::string>* deferred_tablet_ids);
+
+  // Return the number of tablets with reported compactions.
+  int NumTabletsForTests() const;
+
+ private:
+  // The last report of a tablet replica.
+  struct ReplicaState {
+    bool compacting = false;
+    MonoTime last_report;
+  };
+
+  struct TabletState {
+    // Keyed by tablet server UUID.
+    std::unordered_map<std::string, ReplicaState> replicas;
+    // The tablet server whose replica is allowed to compact, if any.
+    std::string compacting_ts_uuid;
+  };
+
+  // Return true if the replica of 'tablet' on the tablet server 'ts_uuid'
+  // reported recently enough, as of 'now'.
+  static bool IsReplicaActive(const TabletState& tablet,
+                              const std::string& ts_uuid,
+                              const MonoTime& now);
+
+  mutable simple_spinlock lock_;
+
+  // Protected by lock_.
+  std::unordered_map<std::string, TabletState> tablets_;
+
+  // The tablets reported by each tablet server. Protected by lock_.
+  std::unordered_map<std::string, std::unordered_set<std::string>> tablets_by_ts_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompactionCoordinator);
+};
+
+} // namespace master
+} // namespace kudu
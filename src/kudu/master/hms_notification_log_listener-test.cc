@@ -18,6 +18,7 @@
 #include "kudu/master/hms_notification_log_listener.h"
 
 #include <cstdint>
+#include <string>
 #include <thread>
 
 #include <gflags/gflags_declare.h>
@@ -32,6 +33,8 @@
 DECLARE_uint32(hive_metastore_notification_log_poll_period_seconds);
 DECLARE_uint32(hive_metastore_notification_log_poll_inject_latency_ms);
 
+using std::string;
+
 namespace kudu {
 namespace master {
 
@@ -100,5 +103,50 @@ TEST_F(HmsNotificationLogListenerTest, TestWaitAndShutdown) {
   listener.Shutdown();
   waiter.join();
 }
+
+// Test which consecutive changes of tables are coalesced.
+TEST_F(HmsNotificationLogListenerTest, TestCoalesceTableChanges) {
+  using TableChange = HmsNotificationLogListenerTask::TableChange;
+  auto rename = [] (const string& table_id, const string& table_name,
+                    const string& new_table_name, int64_t event_id) {
+    return TableChange{ TableChange::RENAME, table_id, table_name, new_table_name,
+                        event_id, event_id };
+  };
+  auto drop = [] (const string& table_id, const string& table_name, int64_t event_id) {
+    return TableChange{ TableChange::DROP, table_id, table_name, "", event_id, event_id };
+  };
+
+  // Renames of a table are chained.
+  TableChange change = rename("id", "db.a", "db.b", 1);
+  ASSERT_TRUE(HmsNotificationLogListenerTask::CoalesceTableChange(
+      rename("id", "db.b", "db.c", 2), &change));
+  ASSERT_EQ(TableChange::RENAME, change.type);
+  ASSERT_EQ("db.a", change.table_name);
+  ASSERT_EQ("db.c", change.new_table_name);
+  ASSERT_EQ(1, change.first_event_id);
+  ASSERT_EQ(2, change.last_event_id);
+
+  // Changes of another table, or of the table by another name, aren't.
+  ASSERT_FALSE(HmsNotificationLogListenerTask::CoalesceTableChange(
+      rename("other", "db.c", "db.d", 3), &change));
+  ASSERT_FALSE(HmsNotificationLogListenerTask::CoalesceTableChange(
+      rename("id", "db.b", "db.d", 3), &change));
+  ASSERT_FALSE(HmsNotificationLogListenerTask::CoalesceTableChange(
+      drop("id", "db.a", 3), &change));
+  ASSERT_EQ("db.c", change.new_table_name);
+  ASSERT_EQ(2, change.last_event_id);
+
+  // A rename followed by a drop drops the table by its original name.
+  ASSERT_TRUE(HmsNotificationLogListenerTask::CoalesceTableChange(
+      drop("id", "db.c", 3), &change));
+  ASSERT_EQ(TableChange::DROP, change.type);
+  ASSERT_EQ("db.a", change.table_name);
+  ASSERT_EQ(3, change.last_event_id);
+
+  // Nothing is coalesced with a drop.
+  ASSERT_FALSE(HmsNotificationLogListenerTask::CoalesceTableChange(
+      drop("id", "db.a", 4), &change));
+  ASSERT_EQ(3, change.last_event_id);
+}
 } // namespace master
 } // namespace kudu
@@ -25,6 +25,7 @@
 #include <utility>
 #include <vector>
 
+#include <boost/optional/optional.hpp>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <rapidjson/document.h>
@@ -37,6 +38,7 @@
 #include "kudu/hms/hive_metastore_types.h"
 #include "kudu/hms/hms_catalog.h"
 #include "kudu/hms/hms_client.h"
+#include "kudu/master/authz_provider.h"
 #include "kudu/master/catalog_manager.h"
 #include "kudu/util/async_util.h"
 #include "kudu/util/flag_tags.h"
@@ -212,8 +214,35 @@ Status DeserializeTable(const hive::NotificationEvent(event),
   Slice slice(value.GetString(), value.GetStringLength());
   return hms::HmsClient::DeserializeJsonTable(slice, table);
 }
+
+// Returns a text string appropriate for debugging a table change.
+string TableChangeDebugString(const HmsNotificationLogListenerTask::TableChange& change) {
+  string events = change.first_event_id == change.last_event_id ?
+      Substitute("event $0", change.last_event_id) :
+      Substitute("events $0-$1", change.first_event_id, change.last_event_id);
+  if (change.type == HmsNotificationLogListenerTask::TableChange::RENAME) {
+    return Substitute("rename of table $0 from $1 to $2 ($3)", change.table_id,
+                      change.table_name, change.new_table_name, events);
+  }
+  return Substitute("drop of table $0 $1 ($2)", change.table_id, change.table_name, events);
+}
 } // anonymous namespace
 
+bool HmsNotificationLogListenerTask::CoalesceTableChange(const TableChange& next,
+                                                         TableChange* change) {
+  // Nothing follows a drop, and a change which doesn't apply to the table by
+  // its new name fails on its own: it's left for the catalog manager to reject.
+  if (change->type != TableChange::RENAME ||
+      next.table_id != change->table_id ||
+      next.table_name != change->new_table_name) {
+    return false;
+  }
+  change->type = next.type;
+  change->new_table_name = next.new_table_name;
+  change->last_event_id = next.last_event_id;
+  return true;
+}
+
 Status HmsNotificationLogListenerTask::Poll() {
   if (!catalog_manager_) {
     SleepFor(MonoDelta::FromMilliseconds(
@@ -256,6 +285,19 @@ Status HmsNotificationLogListenerTask::Poll() {
                                                                                 &events),
                           "failed to retrieve notification log events");
 
+    // The changes in response to the latest consecutive events on a Kudu
+    // table, and their coalescing. They're applied when an event on another
+    // table, or one which can't be coalesced with them, is handled, and before
+    // retrieving the next batch of events.
+    vector<TableChange> changes;
+    boost::optional<TableChange> coalesced;
+    auto apply_changes = [&] {
+      if (!coalesced) return;
+      ApplyTableChanges(*coalesced, changes, &durable_event_id);
+      changes.clear();
+      coalesced = boost::none;
+    };
+
     for (const auto& event : events) {
       VLOG(1) << "Processing notification log event: " << EventDebugString(event);
 
@@ -271,10 +313,11 @@ Status HmsNotificationLogListenerTask::Poll() {
       }
 
       Status s;
+      boost::optional<TableChange> change;
       if (event.eventType == "ALTER_TABLE") {
-        s = HandleAlterTableEvent(event, &durable_event_id);
+        s = HandleAlterTableEvent(event, &change);
       } else if (event.eventType == "DROP_TABLE") {
-        s = HandleDropTableEvent(event, &durable_event_id);
+        s = HandleDropTableEvent(event, &change);
       }
 
       // Failing to properly handle a notification is not a fatal error, instead
@@ -296,6 +339,14 @@ Status HmsNotificationLogListenerTask::Poll() {
       WARN_NOT_OK(s, Substitute("Failed to handle Hive Metastore notification: $0",
                                  EventDebugString(event)));
 
+      if (change) {
+        if (!coalesced || !CoalesceTableChange(*change, coalesced.get_ptr())) {
+          apply_changes();
+          coalesced = change;
+        }
+        changes.emplace_back(std::move(*change));
+      }
+
       // Short-circuit when leadership is lost to prevent applying notification
       // events out of order.
       if (l.has_term_changed()) {
@@ -306,6 +357,12 @@ Status HmsNotificationLogListenerTask::Poll() {
       processed_event_id = event.eventId;
     }
 
+    apply_changes();
+    if (l.has_term_changed()) {
+      return Status::ServiceUnavailable(
+          "lost leadership while handling Hive Metastore notification log events");
+    }
+
     // If the last set of events was smaller than the batch size then we can
     // assume that we've read all of the available events.
     if (events.size() < batch_size) break;
@@ -327,7 +384,7 @@ Status HmsNotificationLogListenerTask::Poll() {
 }
 
 Status HmsNotificationLogListenerTask::HandleAlterTableEvent(const hive::NotificationEvent& event,
-                                                             int64_t* durable_event_id) {
+                                                             boost::optional<TableChange>* change) {
   Document message;
   RETURN_NOT_OK(ParseMessage(event, &message));
 
@@ -365,20 +422,24 @@ Status HmsNotificationLogListenerTask::HandleAlterTableEvent(const hive::Notific
   string before_table_name = Substitute("$0.$1", before_table.dbName, before_table.tableName);
   string after_table_name = Substitute("$0.$1", event.dbName, event.tableName);
 
+  // Privileges cached for either name may no longer hold, e.g. because they
+  // follow the table in Sentry.
+  catalog_manager_->authz_provider()->InvalidateTable(before_table_name);
+  catalog_manager_->authz_provider()->InvalidateTable(after_table_name);
+
   if (before_table_name == after_table_name) {
     VLOG(2) << "Ignoring non-rename alter table event on table "
             << *table_id << " " << before_table_name;
     return Status::OK();
   }
 
-  RETURN_NOT_OK(catalog_manager_->RenameTableHms(*table_id, before_table_name,
-                                                 after_table_name, event.eventId));
-  *durable_event_id = event.eventId;
+  *change = TableChange{ TableChange::RENAME, *table_id, std::move(before_table_name),
+                         std::move(after_table_name), event.eventId, event.eventId };
   return Status::OK();
 }
 
 Status HmsNotificationLogListenerTask::HandleDropTableEvent(const hive::NotificationEvent& event,
-                                                            int64_t* durable_event_id) {
+                                                            boost::optional<TableChange>* change) {
   Document message;
   RETURN_NOT_OK(ParseMessage(event, &message));
 
@@ -402,10 +463,50 @@ Status HmsNotificationLogListenerTask::HandleDropTableEvent(const hive::Notifica
   // unsynchronized. If the catalogs are unsynchronized, it's better to return
   // an error than liberally delete data.
   string table_name = Substitute("$0.$1", event.dbName, event.tableName);
-  RETURN_NOT_OK(catalog_manager_->DeleteTableHms(table_name, *table_id, event.eventId));
-  *durable_event_id = event.eventId;
+  catalog_manager_->authz_provider()->InvalidateTable(table_name);
+  *change = TableChange{ TableChange::DROP, *table_id, std::move(table_name), "",
+                         event.eventId, event.eventId };
+  return Status::OK();
+}
+
+Status HmsNotificationLogListenerTask::ApplyTableChange(const TableChange& change,
+                                                        int64_t* durable_event_id) {
+  if (change.type == TableChange::DROP) {
+    RETURN_NOT_OK(catalog_manager_->DeleteTableHms(change.table_name, change.table_id,
+                                                   change.last_event_id));
+  } else if (change.table_name != change.new_table_name) {
+    RETURN_NOT_OK(catalog_manager_->RenameTableHms(change.table_id, change.table_name,
+                                                   change.new_table_name,
+                                                   change.last_event_id));
+  } else {
+    // The table was renamed back to its original name: there's nothing to do.
+    VLOG(2) << "Ignoring " << TableChangeDebugString(change);
+    return Status::OK();
+  }
+  *durable_event_id = change.last_event_id;
   return Status::OK();
 }
 
+void HmsNotificationLogListenerTask::ApplyTableChanges(const TableChange& coalesced,
+                                                       const vector<TableChange>& changes,
+                                                       int64_t* durable_event_id) {
+  DCHECK(!changes.empty());
+  VLOG(1) << "Applying " << TableChangeDebugString(coalesced);
+  Status s = ApplyTableChange(coalesced, durable_event_id);
+  if (s.ok() || changes.size() == 1) {
+    WARN_NOT_OK(s, Substitute("Failed to apply $0", TableChangeDebugString(coalesced)));
+    return;
+  }
+
+  // One of the events may not apply to the Kudu catalog, e.g. because it's a
+  // rollback of an HMS change which failed in Kudu: apply those which do.
+  LOG(WARNING) << Substitute("Failed to apply $0: $1; applying its events one at a time",
+                             TableChangeDebugString(coalesced), s.ToString());
+  for (const auto& change : changes) {
+    WARN_NOT_OK(ApplyTableChange(change, durable_event_id),
+                Substitute("Failed to apply $0", TableChangeDebugString(change)));
+  }
+}
+
 } // namespace master
 } // namespace kudu
@@ -18,8 +18,11 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
 #include <vector>
 
+#include <boost/optional/optional.hpp>
+
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/util/condition_variable.h"
@@ -75,6 +78,12 @@ class CatalogManager;
 // identified. For other changes made in ALTER TABLE statements, such as ALTER
 // TABLE DROP COLUMN, there is no way to identify with certainty which column
 // has been dropped, since we do not store column IDs in the HMS table entries.
+//
+// Consecutive rename and drop events on the same table are coalesced into a
+// single change to the Kudu catalog: renaming a table from A to B and then from
+// B to C renames it from A to C, and renaming it from A to B before dropping it
+// drops table A. This saves a catalog write per event when tools issue bursts
+// of changes to the same table.
 class HmsNotificationLogListenerTask {
  public:
 
@@ -97,6 +106,36 @@ class HmsNotificationLogListenerTask {
   // to be processed, no error will be returned.
   Status WaitForCatchUp(const MonoTime& deadline) WARN_UNUSED_RESULT;
 
+  // A change to a Kudu table in response to notification log events.
+  struct TableChange {
+    enum Type {
+      RENAME,
+      DROP,
+    };
+    Type type;
+
+    std::string table_id;
+
+    // The name of the table before the change.
+    std::string table_name;
+
+    // The name of the table after a rename.
+    std::string new_table_name;
+
+    // The IDs of the first and of the last events the change responds to.
+    int64_t first_event_id;
+    int64_t last_event_id;
+  };
+
+  // Coalesces 'next', which follows 'change', into 'change' if it's a change
+  // of the same table which can be applied along with it, i.e. if 'change' is
+  // a rename and 'next' applies to the table by its new name.
+  //
+  // Returns false, leaving 'change' unmodified, if they can't be coalesced.
+  //
+  // Exposed for testing.
+  static bool CoalesceTableChange(const TableChange& next, TableChange* change);
+
  private:
 
   // Runs the main loop of the listening thread.
@@ -108,16 +147,28 @@ class HmsNotificationLogListenerTask {
   // Handles an ALTER TABLE event. Must only be called on the listening thread.
   //
   // The event is parsed, and if it is a rename table event for a Kudu table,
-  // the table is renamed in the local catalog.  All other events are ignored.
+  // 'change' is set to the corresponding rename. All other events are ignored.
   Status HandleAlterTableEvent(const hive::NotificationEvent& event,
-                               int64_t* durable_event_id) WARN_UNUSED_RESULT;
+                               boost::optional<TableChange>* change) WARN_UNUSED_RESULT;
 
   // Handles a DROP TABLE event. Must only be called on the listening thread.
   //
-  // The event is parsed, and if it is a drop table event for a Kudu table, the
-  // table is deleted in the local catalog. All other events are ignored.
+  // The event is parsed, and if it is a drop table event for a Kudu table,
+  // 'change' is set to the corresponding drop. All other events are ignored.
   Status HandleDropTableEvent(const hive::NotificationEvent& event,
-                              int64_t* durable_event_id) WARN_UNUSED_RESULT;
+                              boost::optional<TableChange>* change) WARN_UNUSED_RESULT;
+
+  // Applies 'change' to the local catalog, recording its last event ID as
+  // the latest handled event ID in 'durable_event_id'.
+  Status ApplyTableChange(const TableChange& change,
+                          int64_t* durable_event_id) WARN_UNUSED_RESULT;
+
+  // Applies 'coalesced', the coalescing of 'changes', to the local catalog.
+  // If it fails, falls back to applying each of 'changes' in turn, so that
+  // the catalog synchronizes as far as the events allow. Failures are logged.
+  void ApplyTableChanges(const TableChange& coalesced,
+                         const std::vector<TableChange>& changes,
+                         int64_t* durable_event_id);
 
   // The associated catalog manager.
   //
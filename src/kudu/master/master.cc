@@ -40,6 +40,7 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/catalog_manager.h"
+#include "kudu/master/compaction_coordinator.h"
 #include "kudu/master/location_cache.h"
 #include "kudu/master/master.pb.h"
 #include "kudu/master/master.proxy.h"
@@ -137,7 +138,8 @@ Master::Master(const MasterOptions& opts)
     catalog_manager_(new CatalogManager(this)),
     path_handlers_(new MasterPathHandlers(this)),
     opts_(opts),
-    registration_initialized_(false) {
+    registration_initialized_(false),
+    compaction_coordinator_(new CompactionCoordinator()) {
   const auto& location_cmd = FLAGS_location_mapping_cmd;
   if (!location_cmd.empty()) {
     location_cache_.reset(new LocationCache(location_cmd, metric_entity_.get()));
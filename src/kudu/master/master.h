@@ -49,6 +49,7 @@ class TokenSigner;
 namespace master {
 
 class CatalogManager;
+class CompactionCoordinator;
 class MasterCertAuthority;
 class MasterPathHandlers;
 class TSManager;
@@ -88,6 +89,8 @@ class Master : public kserver::KuduServer {
 
   LocationCache* location_cache() { return location_cache_.get(); }
 
+  CompactionCoordinator* compaction_coordinator() { return compaction_coordinator_.get(); }
+
   // Get the RPC and HTTP addresses for this master instance.
   Status GetMasterRegistration(ServerRegistrationPB* registration) const;
 
@@ -160,6 +163,9 @@ class Master : public kserver::KuduServer {
 
   gscoped_ptr<TSManager> ts_manager_;
 
+  // Staggers the heavy compactions across the replicas of each tablet.
+  std::unique_ptr<CompactionCoordinator> compaction_coordinator_;
+
   DISALLOW_COPY_AND_ASSIGN(Master);
 };
 
@@ -36,6 +36,7 @@
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/hms/hms_catalog.h"
 #include "kudu/master/catalog_manager.h"
+#include "kudu/master/compaction_coordinator.h"
 #include "kudu/master/location_cache.h"
 #include "kudu/master/master.h"
 #include "kudu/master/master.pb.h"
@@ -221,6 +222,9 @@ void MasterServiceImpl::TSHeartbeat(const TSHeartbeatRequestPB* req,
       rpc->RespondFailure(s);
       return;
     }
+    // The tablet server may have come back with different addresses, so
+    // previously built table locations may no longer be accurate.
+    server_->catalog_manager()->InvalidateTableLocationsCache();
   } else {
     Status s = server_->ts_manager()->LookupTS(req->common().ts_instance(), &ts_desc);
     if (s.IsNotFound()) {
@@ -248,18 +252,50 @@ void MasterServiceImpl::TSHeartbeat(const TSHeartbeatRequestPB* req,
   // 4. Update tserver soft state based on the heartbeat contents.
   ts_desc->UpdateHeartbeatTime();
   ts_desc->set_num_live_replicas(req->num_live_tablets());
+  if (req->has_load()) {
+    ts_desc->UpdateLoad(req->load());
+  }
 
-  // 5. Only leaders handle tablet reports.
-  if (is_leader_master && req->has_tablet_report()) {
-    Status s = server_->catalog_manager()->ProcessTabletReport(
-        ts_desc.get(), req->tablet_report(), resp->mutable_tablet_report(), rpc);
+  // 5. Every master keeps the tablets reported by the tserver, so that its
+  //    reports may be deltas, but only leaders handle the tablet reports.
+  if (req->has_tablet_report()) {
+    TabletReportPB resolved_report;
+    Status s = ts_desc->MergeTabletReport(req->tablet_report(),
+                                          is_leader_master ? &resolved_report : nullptr);
     if (!s.ok()) {
-      rpc->RespondFailure(s.CloneAndPrepend("Failed to process tablet report"));
-      return;
+      DCHECK(s.IsIncomplete()) << s.ToString();
+      LOG(INFO) << Substitute("Unable to merge tablet report from $0, requesting a full "
+                              "tablet report: $1", rpc->requestor_string(), s.ToString());
+      resp->set_needs_full_tablet_report(true);
+    } else {
+      if (ts_desc->merged_tablet_report_seq() >= 0) {
+        resp->set_acked_tablet_report_sequence_number(ts_desc->merged_tablet_report_seq());
+      } else {
+        resp->set_needs_full_tablet_report(true);
+      }
+      if (is_leader_master) {
+        s = server_->catalog_manager()->ProcessTabletReport(
+            ts_desc.get(), resolved_report, resp->mutable_tablet_report(), rpc);
+        if (!s.ok()) {
+          rpc->RespondFailure(s.CloneAndPrepend("Failed to process tablet report"));
+          return;
+        }
+      }
+    }
+  }
+
+  // 6. Only leaders coordinate the compactions of the tablet replicas.
+  if (is_leader_master && req->has_compaction_report()) {
+    vector<string> deferred_tablet_ids;
+    server_->compaction_coordinator()->ProcessReport(
+        ts_desc->permanent_uuid(), req->compaction_report(), MonoTime::Now(),
+        &deferred_tablet_ids);
+    for (auto& tablet_id : deferred_tablet_ids) {
+      resp->add_compaction_deferred_tablet_ids(std::move(tablet_id));
     }
   }
 
-  // 6. Only leaders sign CSR from tablet servers (if present).
+  // 7. Only leaders sign CSR from tablet servers (if present).
   if (is_leader_master && req->has_csr_der()) {
     string cert;
     Status s = server_->cert_authority()->SignServerCSR(
@@ -273,7 +309,7 @@ void MasterServiceImpl::TSHeartbeat(const TSHeartbeatRequestPB* req,
     resp->add_ca_cert_der(server_->cert_authority()->ca_cert_der());
   }
 
-  // 7. Only leaders send public parts of non-expired TSK which the TS doesn't
+  // 8. Only leaders send public parts of non-expired TSK which the TS doesn't
   //    have, except if the '--master_non_leader_masters_propagate_tsk'
   //    test-only flag is set.
   if ((is_leader_master ||
@@ -30,6 +30,7 @@
 #include <gtest/gtest.h>
 
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/master/master.pb.h"
 #include "kudu/master/ts_descriptor.h"
 #include "kudu/util/random.h"
 #include "kudu/util/random_util.h"
@@ -334,6 +335,44 @@ TEST_F(PlacementPolicyTest, PlaceTabletReplicasNoLoc) {
   }
 }
 
+// Tablet servers with saturated disks should not get new replicas unless
+// there's no other choice.
+TEST_F(PlacementPolicyTest, PlaceTabletReplicasDiskSaturated) {
+  const vector<LocationInfo> cluster_info = {
+    { "", { { "ts0", 0 }, { "ts1", 10 }, { "ts2", 10 }, } },
+  };
+  ASSERT_OK(Prepare(cluster_info));
+  TServerLoadPB load;
+  load.set_num_data_dirs(1);
+  load.set_data_dirs_capacity_bytes(100);
+  load.set_data_dirs_available_bytes(1);
+  GetDescriptors({ "ts0" }).front()->UpdateLoad(load);
+
+  const auto& all = descriptors();
+  PlacementPolicy policy(all, rng());
+  for (auto i = 0; i < 100; ++i) {
+    TSDescriptorVector result;
+    ASSERT_OK(policy.PlaceTabletReplicas(1, &result));
+    ASSERT_EQ(1, result.size());
+    // The least loaded server is avoided because its disks are saturated.
+    ASSERT_NE("ts0", result.front()->permanent_uuid());
+  }
+
+  // The saturated server is still used when it's the only one left.
+  {
+    TSDescriptorVector result;
+    ASSERT_OK(policy.PlaceTabletReplicas(3, &result));
+    TSDescriptorsMap m;
+    ASSERT_OK(TSDescriptorVectorToMap(result, &m));
+    ASSERT_EQ(1, m.count("ts0"));
+  }
+  {
+    shared_ptr<TSDescriptor> extra;
+    ASSERT_OK(policy.PlaceExtraTabletReplica(GetDescriptors({ "ts1", "ts2" }), &extra));
+    ASSERT_EQ("ts0", extra->permanent_uuid());
+  }
+}
+
 TEST_F(PlacementPolicyTest, PlaceTabletReplicas) {
   const vector<LocationInfo> cluster_info = {
     { "A", { { "A_ts0", 2 }, { "A_ts1", 1 }, { "A_ts2", 3 }, } },
@@ -30,13 +30,25 @@
 #include <vector>
 
 #include <boost/optional/optional.hpp>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/ts_descriptor.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/random.h"
 
+DEFINE_double(placement_max_disk_used_ratio, 0.95,
+              "Tablet servers whose data directories are all full, or whose "
+              "data directories' filesystems have more than this fraction of "
+              "their capacity in use, are not selected to host new tablet "
+              "replicas unless no other tablet server is available. A ratio "
+              "of 1 or more only avoids servers whose data directories are "
+              "all full.");
+TAG_FLAG(placement_max_disk_used_ratio, advanced);
+TAG_FLAG(placement_max_disk_used_ratio, runtime);
+
 using std::multimap;
 using std::numeric_limits;
 using std::set;
@@ -79,8 +91,10 @@ shared_ptr<TSDescriptor> PickBetterReplica(
   // we batch the selection process before sending any creation commands to the
   // servers themselves.
   //
-  // TODO(wdberkeley): in the future we may want to factor in other items such
-  // as available disk space, actual request load, etc.
+  // Servers with saturated disks were already filtered out by the caller
+  // whenever possible. Between servers with the same load, the one with the
+  // smaller maintenance backlog is preferred, since new replicas would only
+  // add to it.
   double load_a = GetTSLoad(a.get());
   double load_b = GetTSLoad(b.get());
   if (load_a < load_b) {
@@ -89,6 +103,14 @@ shared_ptr<TSDescriptor> PickBetterReplica(
   if (load_b < load_a) {
     return b;
   }
+  int backlog_a = a->maintenance_backlog_ops();
+  int backlog_b = b->maintenance_backlog_ops();
+  if (backlog_a < backlog_b) {
+    return a;
+  }
+  if (backlog_b < backlog_a) {
+    return b;
+  }
   // If the load is the same, we can just pick randomly.
   return two_choices[rng->Uniform(2)];
 }
@@ -276,11 +298,25 @@ Status PlacementPolicy::SelectReplicas(const TSDescriptorVector& source_ts_descs
 shared_ptr<TSDescriptor> PlacementPolicy::SelectReplica(
     const TSDescriptorVector& ts_descs,
     const set<shared_ptr<TSDescriptor>>& excluded) const {
-  // Pick two random servers, excluding those we've already picked.
+  // Pick two random servers, excluding those we've already picked and,
+  // if there are any other servers left, those whose disks are saturated.
   // If we've only got one server left, 'two_choices' will actually
   // just contain one element.
   vector<shared_ptr<TSDescriptor>> two_choices;
-  rng_->ReservoirSample(ts_descs, 2, excluded, &two_choices);
+  set<shared_ptr<TSDescriptor>> excluded_saturated;
+  for (const auto& ts : ts_descs) {
+    if (ts->IsDiskSaturated(FLAGS_placement_max_disk_used_ratio) &&
+        !ContainsKey(excluded, ts)) {
+      excluded_saturated.emplace(ts);
+    }
+  }
+  if (!excluded_saturated.empty()) {
+    excluded_saturated.insert(excluded.begin(), excluded.end());
+    rng_->ReservoirSample(ts_descs, 2, excluded_saturated, &two_choices);
+  }
+  if (two_choices.empty()) {
+    rng_->ReservoirSample(ts_descs, 2, excluded, &two_choices);
+  }
   DCHECK_LE(two_choices.size(), 2);
 
   if (two_choices.size() == 2) {
@@ -127,8 +127,9 @@ class PlacementPolicy {
                         TSDescriptorVector* result_ts_desc) const;
 
   // Given the tablet servers in 'ts_descs', pick a tablet server to host
-  // a tablet replica, excluding tablet servers in 'excluded'. If there are no
-  // servers in 'ts_descs' that are not in 'existing', return nullptr.
+  // a tablet replica, excluding tablet servers in 'excluded'. Servers whose
+  // disks are saturated are only picked if there are no others. If there are
+  // no servers in 'ts_descs' that are not in 'existing', return nullptr.
   std::shared_ptr<TSDescriptor> SelectReplica(
       const TSDescriptorVector& ts_descs,
       const std::set<std::shared_ptr<TSDescriptor>>& excluded) const;
@@ -33,11 +33,13 @@
 #include "kudu/sentry/sentry_authorizable_scope.h"
 #include "kudu/sentry/sentry_client.h"
 #include "kudu/sentry/sentry_policy_service_types.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_int32(sentry_privileges_cache_ttl_ms);
 DECLARE_int32(sentry_service_recv_timeout_seconds);
 DECLARE_int32(sentry_service_send_timeout_seconds);
 DECLARE_string(sentry_service_rpc_addresses);
@@ -82,6 +84,9 @@ class SentryAuthzProviderTest : public SentryTestBase {
     // Configure the SentryAuthzProvider flags.
     FLAGS_sentry_service_security_mode = KerberosEnabled() ? "kerberos" : "none";
     FLAGS_sentry_service_rpc_addresses = sentry_->address().ToString();
+    // Most tests alter privileges between authorizations, so they shouldn't
+    // be cached.
+    FLAGS_sentry_privileges_cache_ttl_ms = 0;
     sentry_authz_provider_.reset(new SentryAuthzProvider());
     ASSERT_OK(sentry_authz_provider_->Start());
   }
@@ -286,6 +291,36 @@ TEST_P(TestTableAuthorization, TestPrivilegeCaseSensitivity) {
   ASSERT_OK(sentry_authz_provider_->AuthorizeCreateTable("DB.table", kTestUser, kTestUser));
 }
 
+// Checks that privileges are cached until they expire or the table is
+// invalidated.
+TEST_P(TestTableAuthorization, TestPrivilegesCache) {
+  FLAGS_sentry_privileges_cache_ttl_ms = 60 * 1000;
+  ASSERT_OK(CreateRoleAndAddToGroups(sentry_client_.get(), kRoleName, kUserGroup));
+  Status s = sentry_authz_provider_->AuthorizeGetTableMetadata("db.table", kTestUser);
+  ASSERT_TRUE(s.IsNotAuthorized()) << s.ToString();
+
+  // The grant isn't seen while the privileges are cached.
+  TSentryPrivilege privilege = GetTablePrivilege("db", "table", "METADATA");
+  ASSERT_OK(AlterRoleGrantPrivilege(sentry_client_.get(), kRoleName, privilege));
+  s = sentry_authz_provider_->AuthorizeGetTableMetadata("db.table", kTestUser);
+  ASSERT_TRUE(s.IsNotAuthorized()) << s.ToString();
+
+  // Invalidating the table, whatever the case of its name, refetches them.
+  sentry_authz_provider_->InvalidateTable("DB.Table");
+  ASSERT_OK(sentry_authz_provider_->AuthorizeGetTableMetadata("db.table", kTestUser));
+
+  // Cached privileges are used while Sentry is unavailable.
+  ASSERT_OK(StopSentry());
+  ASSERT_OK(sentry_authz_provider_->AuthorizeGetTableMetadata("db.table", kTestUser));
+
+  // Expired privileges are refetched.
+  FLAGS_sentry_privileges_cache_ttl_ms = 1;
+  SleepFor(MonoDelta::FromMilliseconds(10));
+  s = sentry_authz_provider_->AuthorizeGetTableMetadata("db.table", kTestUser);
+  ASSERT_TRUE(s.IsNetworkError()) << s.ToString();
+  ASSERT_OK(StartSentry());
+}
+
 // Test to ensure the authorization hierarchy rule of SentryAuthzProvider
 // works as expected.
 class TestAuthzHierarchy : public SentryAuthzProviderTest,
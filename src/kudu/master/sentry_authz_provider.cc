@@ -17,16 +17,22 @@
 
 #include "kudu/master/sentry_authz_provider.h"
 
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <ostream>
 #include <utility>
 #include <vector>
 
+#include <boost/algorithm/string/case_conv.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/common/table_util.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/sentry/sentry_action.h"
 #include "kudu/sentry/sentry_client.h"
@@ -41,6 +47,8 @@ using sentry::TListSentryPrivilegesRequest;
 using sentry::TListSentryPrivilegesResponse;
 using sentry::TSentryAuthorizable;
 using sentry::TSentryGrantOption;
+using sentry::TSentryPrivilege;
+using std::shared_ptr;
 using std::string;
 using std::vector;
 
@@ -111,6 +119,15 @@ DEFINE_int32(sentry_service_max_message_size_bytes, 100 * 1024 * 1024,
 TAG_FLAG(sentry_service_max_message_size_bytes, advanced);
 TAG_FLAG(sentry_service_max_message_size_bytes, experimental);
 
+DEFINE_int32(sentry_privileges_cache_ttl_ms, 10000,
+             "The time, in milliseconds, for which the privileges of a user on a "
+             "table or database fetched from the Sentry service are cached by the "
+             "master. Privileges granted or revoked in Sentry may take this long "
+             "to be enforced. Set to 0 to disable the cache.");
+TAG_FLAG(sentry_privileges_cache_ttl_ms, advanced);
+TAG_FLAG(sentry_privileges_cache_ttl_ms, experimental);
+TAG_FLAG(sentry_privileges_cache_ttl_ms, runtime);
+
 using strings::Substitute;
 
 namespace kudu {
@@ -121,6 +138,10 @@ using sentry::SentryAuthorizableScope;
 
 namespace master {
 
+// The maximum number of users' privileges cached. Expired privileges are
+// evicted when it's reached, and the whole cache if none are expired.
+static const size_t kMaxCachedPrivileges = 100000;
+
 // Validates the sentry_service_rpc_addresses gflag.
 static bool ValidateAddresses(const char* flag_name, const string& addresses) {
   vector<HostPort> host_ports;
@@ -200,6 +221,19 @@ Status GetAuthorizable(const string& table_ident,
   return Status::OK();
 }
 
+// Returns the key of an authorizable in the privileges cache.
+string CacheKey(const TSentryAuthorizable& authorizable) {
+  if (!authorizable.__isset.db) {
+    return "";
+  }
+  string key = authorizable.db;
+  if (authorizable.__isset.table) {
+    key += "." + authorizable.table;
+  }
+  boost::algorithm::to_lower(key);
+  return key;
+}
+
 } // anonymous namespace
 
 Status SentryAuthzProvider::AuthorizeCreateTable(const string& table_name,
@@ -296,20 +330,12 @@ Status SentryAuthzProvider::Authorize(SentryAuthorizableScope::Scope scope,
   // rule (1) mentioned above. Therefore, we need to validate privilege scope, in addition
   // to action and grant option. Otherwise, privilege escalation can happen.
 
-  TListSentryPrivilegesRequest request;
-  request.__set_requestorUserName(FLAGS_kudu_service_name);
-  request.__set_principalName(user);
-  request.__set_authorizableHierarchy(authorizable);
-  TListSentryPrivilegesResponse response;
-
-  RETURN_NOT_OK(ha_client_.Execute(
-      [&] (SentryClient* client) {
-        return client->ListPrivilegesByUser(request, &response);
-      }));
+  shared_ptr<const Privileges> privileges;
+  RETURN_NOT_OK(GetPrivileges(authorizable, user, &privileges));
 
   SentryAction required_action(action);
   SentryAuthorizableScope required_scope(scope);
-  for (const auto& privilege : response.privileges) {
+  for (const auto& privilege : *privileges) {
     // A grant option cannot imply the other if the latter is set
     // but the former is not.
     if (require_grant_option && privilege.grantOption != TSentryGrantOption::ENABLED) {
@@ -349,5 +375,77 @@ Status SentryAuthzProvider::Authorize(SentryAuthorizableScope::Scope scope,
   return Status::NotAuthorized("unauthorized action");
 }
 
+Status SentryAuthzProvider::GetPrivileges(const TSentryAuthorizable& authorizable,
+                                          const string& user,
+                                          shared_ptr<const Privileges>* privileges) {
+  const int32_t ttl_ms = FLAGS_sentry_privileges_cache_ttl_ms;
+  const string key = CacheKey(authorizable);
+  if (ttl_ms > 0) {
+    std::lock_guard<simple_spinlock> l(cache_lock_);
+    const auto* users = FindOrNull(cache_, key);
+    const CachedPrivileges* cached = users ? FindOrNull(*users, user) : nullptr;
+    if (cached && cached->expiration_time > MonoTime::Now()) {
+      *privileges = cached->privileges;
+      return Status::OK();
+    }
+  }
+
+  TListSentryPrivilegesRequest request;
+  request.__set_requestorUserName(FLAGS_kudu_service_name);
+  request.__set_principalName(user);
+  request.__set_authorizableHierarchy(authorizable);
+  TListSentryPrivilegesResponse response;
+
+  RETURN_NOT_OK(ha_client_.Execute(
+      [&] (SentryClient* client) {
+        return client->ListPrivilegesByUser(request, &response);
+      }));
+
+  shared_ptr<const Privileges> fetched = std::make_shared<const Privileges>(
+      response.privileges.begin(), response.privileges.end());
+  if (ttl_ms > 0) {
+    const MonoTime now = MonoTime::Now();
+    std::lock_guard<simple_spinlock> l(cache_lock_);
+    if (num_cached_ >= kMaxCachedPrivileges) {
+      for (auto it = cache_.begin(); it != cache_.end();) {
+        auto& users = it->second;
+        for (auto user_it = users.begin(); user_it != users.end();) {
+          if (user_it->second.expiration_time <= now) {
+            user_it = users.erase(user_it);
+            num_cached_--;
+          } else {
+            ++user_it;
+          }
+        }
+        it = users.empty() ? cache_.erase(it) : std::next(it);
+      }
+      if (num_cached_ >= kMaxCachedPrivileges) {
+        cache_.clear();
+        num_cached_ = 0;
+      }
+    }
+    auto& users = cache_[key];
+    CachedPrivileges& cached = users[user];
+    if (!cached.privileges) {
+      num_cached_++;
+    }
+    cached.privileges = fetched;
+    cached.expiration_time = now + MonoDelta::FromMilliseconds(ttl_ms);
+  }
+  *privileges = std::move(fetched);
+  return Status::OK();
+}
+
+void SentryAuthzProvider::InvalidateTable(const string& table_name) {
+  string key = table_name;
+  boost::algorithm::to_lower(key);
+  std::lock_guard<simple_spinlock> l(cache_lock_);
+  auto it = cache_.find(key);
+  if (it != cache_.end()) {
+    num_cached_ -= it->second.size();
+    cache_.erase(it);
+  }
+}
+
 } // namespace master
 } // namespace kudu
@@ -17,7 +17,11 @@
 
 #pragma once
 
+#include <cstddef>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <gtest/gtest_prod.h>
 
@@ -27,8 +31,15 @@
 #include "kudu/sentry/sentry_authorizable_scope.h"
 #include "kudu/sentry/sentry_client.h"
 #include "kudu/thrift/client.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 
+namespace sentry {
+class TSentryAuthorizable;
+class TSentryPrivilege;
+} // namespace sentry
+
 namespace kudu {
 
 namespace master {
@@ -37,6 +48,11 @@ namespace master {
 // for authorization metadata and allows or denies the actions performed by
 // users based on the metadata.
 //
+// The privileges listed by Sentry for a user on an authorizable are cached for
+// --sentry_privileges_cache_ttl_ms, so that a burst of requests on the same
+// table, e.g. the authz token requests of a job's scan tokens, costs a single
+// round trip to Sentry. Cached privileges may thus be stale for up to the TTL.
+//
 // This class is thread-safe after Start() is called.
 class SentryAuthzProvider : public AuthzProvider {
  public:
@@ -74,9 +90,25 @@ class SentryAuthzProvider : public AuthzProvider {
   Status AuthorizeGetTableMetadata(const std::string& table_name,
                                    const std::string& user) override WARN_UNUSED_RESULT;
 
+  void InvalidateTable(const std::string& table_name) override;
+
  private:
   FRIEND_TEST(TestAuthzHierarchy, TestAuthorizableScope);
 
+  typedef std::vector<::sentry::TSentryPrivilege> Privileges;
+
+  // The privileges of a user on an authorizable.
+  struct CachedPrivileges {
+    std::shared_ptr<const Privileges> privileges;
+    MonoTime expiration_time;
+  };
+
+  // Sets 'privileges' to the privileges of 'user' matching the hierarchy of
+  // 'authorizable', fetching them from Sentry unless they're cached.
+  Status GetPrivileges(const ::sentry::TSentryAuthorizable& authorizable,
+                       const std::string& user,
+                       std::shared_ptr<const Privileges>* privileges);
+
   // Checks if the user can perform an action on the table identifier (in the format
   // <database-name>.<table-name>), based on the given authorizable scope and the
   // grant option. Note that the authorizable scope should be equal or higher than
@@ -92,6 +124,17 @@ class SentryAuthzProvider : public AuthzProvider {
                    bool require_grant_option = false);
 
   thrift::HaClient<sentry::SentryClient> ha_client_;
+
+  // Protects 'cache_' and 'num_cached_'.
+  simple_spinlock cache_lock_;
+
+  // The cached privileges, keyed by the lowercased name of the authorizable
+  // ('<database>' or '<database>.<table>') and then by user.
+  std::unordered_map<std::string,
+                     std::unordered_map<std::string, CachedPrivileges>> cache_;
+
+  // The number of users' privileges in 'cache_'.
+  size_t num_cached_ = 0;
 };
 
 } // namespace master
@@ -597,11 +597,10 @@ Status SysCatalogTable::GetEntryFromRow(
       row, schema_.find_column(kSysCatalogTableColId));
   const Slice* data = schema_.ExtractColumnFromRow<STRING>(
       row, schema_.find_column(kSysCatalogTableColMetadata));
-  string str_id = id->ToString();
+  entry_id->assign(reinterpret_cast<const char*>(id->data()), id->size());
   RETURN_NOT_OK_PREPEND(
       pb_util::ParseFromArray(entry_data, data->data(), data->size()),
-      "unable to parse metadata field for row " + str_id);
-  *entry_id = std::move(str_id);
+      "unable to parse metadata field for row " + *entry_id);
 
   return Status::OK();
 }
@@ -628,6 +627,10 @@ Status SysCatalogTable::ProcessRows(
 
   Arena arena(32 * 1024);
   RowBlock block(iter->schema(), 512, &arena);
+  // Reused across rows: parsing clears the message but keeps its allocated
+  // sub-messages and strings, which matters when there are millions of rows.
+  string entry_id;
+  T entry_data;
   while (iter->HasNext()) {
     RETURN_NOT_OK(iter->NextBlock(&block));
     const size_t nrows = block.nrows();
@@ -635,8 +638,6 @@ Status SysCatalogTable::ProcessRows(
       if (!block.selection_vector()->IsRowSelected(i)) {
         continue;
       }
-      string entry_id;
-      T entry_data;
       RETURN_NOT_OK(GetEntryFromRow(block.row(i), &entry_id, &entry_data));
       RETURN_NOT_OK(processor(entry_id, entry_data));
     }
@@ -0,0 +1,163 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/master/table_locations_cache.h"
+
+#include <cstdint>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/master/master.pb.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+METRIC_DECLARE_counter(table_locations_cache_hits);
+METRIC_DECLARE_counter(table_locations_cache_queries);
+
+using std::string;
+using strings::Substitute;
+
+namespace kudu {
+namespace master {
+
+class TableLocationsCacheTest : public KuduTest {
+ protected:
+  void SetUp() override {
+    KuduTest::SetUp();
+    metric_entity_ = METRIC_ENTITY_server.Instantiate(&metric_registry_,
+                                                      "TableLocationsCacheTest");
+  }
+
+  void CheckMetrics(int64_t expected_queries, int64_t expected_hits) {
+    scoped_refptr<Counter> cache_queries(metric_entity_->FindOrCreateCounter(
+        &METRIC_table_locations_cache_queries));
+    ASSERT_EQ(expected_queries, cache_queries->value());
+    scoped_refptr<Counter> cache_hits(metric_entity_->FindOrCreateCounter(
+        &METRIC_table_locations_cache_hits));
+    ASSERT_EQ(expected_hits, cache_hits->value());
+  }
+
+  static GetTableLocationsResponsePB MakeResponse(const string& tablet_id) {
+    GetTableLocationsResponsePB resp;
+    resp.add_tablet_locations()->set_tablet_id(tablet_id);
+    return resp;
+  }
+
+  MetricRegistry metric_registry_;
+  scoped_refptr<MetricEntity> metric_entity_;
+};
+
+TEST_F(TableLocationsCacheTest, KeyDependsOnRequest) {
+  GetTableLocationsRequestPB req;
+  const string base = TableLocationsCache::MakeKey("t", req);
+  ASSERT_NE(base, TableLocationsCache::MakeKey("u", req));
+
+  req.set_partition_key_start("a");
+  const string with_start = TableLocationsCache::MakeKey("t", req);
+  ASSERT_NE(base, with_start);
+
+  // An empty end key is not the same as an unbounded range.
+  req.set_partition_key_end("");
+  ASSERT_NE(with_start, TableLocationsCache::MakeKey("t", req));
+
+  // Binary keys mustn't be confused with the key's separators.
+  GetTableLocationsRequestPB req1;
+  req1.set_partition_key_start(string("a:1:b", 5));
+  GetTableLocationsRequestPB req2;
+  req2.set_partition_key_start("a");
+  req2.set_partition_key_end("b");
+  ASSERT_NE(TableLocationsCache::MakeKey("t", req1),
+            TableLocationsCache::MakeKey("t", req2));
+
+  GetTableLocationsRequestPB req3;
+  req3.set_max_returned_locations(1);
+  ASSERT_NE(base, TableLocationsCache::MakeKey("t", req3));
+  req3.set_max_returned_locations(req.max_returned_locations());
+  req3.set_replica_type_filter(ANY_REPLICA);
+  ASSERT_NE(base, TableLocationsCache::MakeKey("t", req3));
+
+  GetTableLocationsRequestPB req4;
+  req4.add_predicates()->set_column("c");
+  const string with_pred = TableLocationsCache::MakeKey("t", req4);
+  ASSERT_NE(base, with_pred);
+  req4.mutable_predicates(0)->mutable_is_not_null();
+  ASSERT_NE(with_pred, TableLocationsCache::MakeKey("t", req4));
+}
+
+TEST_F(TableLocationsCacheTest, VersionsAndEpochs) {
+  TableLocationsCache cache(1024 * 1024, metric_entity_.get());
+  GetTableLocationsResponsePB resp;
+  ASSERT_FALSE(cache.Lookup("k", 0, &resp));
+
+  int64_t epoch = cache.epoch();
+  cache.Insert("k", 0, epoch, MakeResponse("t0"));
+  ASSERT_TRUE(cache.Lookup("k", 0, &resp));
+  ASSERT_EQ("t0", resp.tablet_locations(0).tablet_id());
+  NO_FATALS(CheckMetrics(2, 1));
+
+  // A newer table version makes the entry stale.
+  resp.Clear();
+  ASSERT_FALSE(cache.Lookup("k", 1, &resp));
+  ASSERT_EQ(0, resp.tablet_locations_size());
+  cache.Insert("k", 1, epoch, MakeResponse("t1"));
+  ASSERT_TRUE(cache.Lookup("k", 1, &resp));
+  ASSERT_EQ("t1", resp.tablet_locations(0).tablet_id());
+
+  // An older response doesn't replace a newer one.
+  cache.Insert("k", 0, epoch, MakeResponse("t0"));
+  ASSERT_TRUE(cache.Lookup("k", 1, &resp));
+  ASSERT_EQ("t1", resp.tablet_locations(0).tablet_id());
+
+  // Invalidating the cache makes every entry stale, including entries whose
+  // responses started being built before the invalidation.
+  cache.Invalidate();
+  ASSERT_FALSE(cache.Lookup("k", 1, &resp));
+  cache.Insert("k", 1, epoch, MakeResponse("t1"));
+  ASSERT_FALSE(cache.Lookup("k", 1, &resp));
+  cache.Insert("k", 1, cache.epoch(), MakeResponse("t2"));
+  ASSERT_TRUE(cache.Lookup("k", 1, &resp));
+  ASSERT_EQ("t2", resp.tablet_locations(0).tablet_id());
+}
+
+TEST_F(TableLocationsCacheTest, Capacity) {
+  {
+    TableLocationsCache disabled(0, metric_entity_.get());
+    GetTableLocationsResponsePB resp;
+    disabled.Insert("k", 0, disabled.epoch(), MakeResponse("t"));
+    ASSERT_FALSE(disabled.Lookup("k", 0, &resp));
+    NO_FATALS(CheckMetrics(0, 0));
+  }
+
+  // Insert many more entries than fit; the cache must stay usable and keep
+  // serving the most recently inserted entries.
+  TableLocationsCache cache(16 * 1024);
+  for (int i = 0; i < 10000; i++) {
+    const string key = Substitute("key-$0", i);
+    cache.Insert(key, 0, cache.epoch(), MakeResponse(key));
+    GetTableLocationsResponsePB resp;
+    ASSERT_TRUE(cache.Lookup(key, 0, &resp));
+    ASSERT_EQ(key, resp.tablet_locations(0).tablet_id());
+  }
+}
+
+} // namespace master
+} // namespace kudu
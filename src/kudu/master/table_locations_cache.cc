@@ -0,0 +1,174 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/master/table_locations_cache.h"
+
+#include <functional>
+#include <mutex>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/master/master.pb.h"
+
+METRIC_DEFINE_counter(server, table_locations_cache_hits,
+                      "Table Locations Cache Hits",
+                      kudu::MetricUnit::kCacheHits,
+                      "Number of GetTableLocations requests served from "
+                      "the table locations cache");
+METRIC_DEFINE_counter(server, table_locations_cache_queries,
+                      "Table Locations Cache Queries",
+                      kudu::MetricUnit::kCacheQueries,
+                      "Number of queries to the table locations cache");
+
+using std::string;
+using strings::Substitute;
+
+namespace kudu {
+namespace master {
+
+TableLocationsCache::TableLocationsCache(size_t capacity_bytes,
+                                         MetricEntity* metric_entity)
+    : stripe_capacity_bytes_(capacity_bytes / kNumStripes),
+      epoch_(0) {
+  if (metric_entity != nullptr) {
+    cache_hits_ = metric_entity->FindOrCreateCounter(
+        &METRIC_table_locations_cache_hits);
+    cache_queries_ = metric_entity->FindOrCreateCounter(
+        &METRIC_table_locations_cache_queries);
+  }
+}
+
+string TableLocationsCache::MakeKey(const string& table_id,
+                                    const GetTableLocationsRequestPB& req) {
+  // Partition keys are arbitrary binary strings, so they're length-prefixed
+  // to keep distinct requests from mapping to the same key.
+  string key = Substitute("$0:$1:$2:$3:", table_id,
+                          static_cast<int>(req.replica_type_filter()),
+                          req.max_returned_locations(),
+                          req.partition_key_start().size());
+  key.append(req.partition_key_start());
+  if (req.has_partition_key_end()) {
+    key.append(Substitute(":$0:", req.partition_key_end().size()));
+    key.append(req.partition_key_end());
+  }
+  for (const auto& pred : req.predicates()) {
+    const string pred_str = pred.SerializeAsString();
+    key.append(Substitute(":p$0:", pred_str.size()));
+    key.append(pred_str);
+  }
+  return key;
+}
+
+TableLocationsCache::Stripe* TableLocationsCache::GetStripe(const string& key) {
+  return &stripes_[std::hash<string>()(key) % kNumStripes];
+}
+
+bool TableLocationsCache::Lookup(const string& key,
+                                 int64_t table_version,
+                                 GetTableLocationsResponsePB* resp) {
+  if (stripe_capacity_bytes_ == 0) {
+    return false;
+  }
+  if (cache_queries_) {
+    cache_queries_->Increment();
+  }
+  const int64_t cur_epoch = epoch();
+  std::shared_ptr<const GetTableLocationsResponsePB> cached;
+  {
+    Stripe* stripe = GetStripe(key);
+    std::lock_guard<simple_spinlock> l(stripe->lock);
+    auto it = stripe->entries.find(key);
+    if (it == stripe->entries.end()) {
+      return false;
+    }
+    const Entry& e = it->second;
+    if (e.table_version != table_version || e.epoch != cur_epoch) {
+      // Versions and epochs only move forward, so an entry built at an older
+      // one will never be valid again.
+      if (e.table_version < table_version || e.epoch < cur_epoch) {
+        stripe->usage -= e.charge;
+        stripe->entries.erase(it);
+      }
+      return false;
+    }
+    cached = e.resp;
+  }
+  // The cached response is immutable, so it's safe to copy it without
+  // holding the stripe's lock.
+  resp->CopyFrom(*cached);
+  if (cache_hits_) {
+    cache_hits_->Increment();
+  }
+  return true;
+}
+
+void TableLocationsCache::Insert(const string& key,
+                                 int64_t table_version,
+                                 int64_t epoch,
+                                 const GetTableLocationsResponsePB& resp) {
+  if (stripe_capacity_bytes_ == 0) {
+    return;
+  }
+  const size_t charge = key.size() + resp.ByteSizeLong();
+  if (charge > stripe_capacity_bytes_) {
+    return;
+  }
+  std::shared_ptr<const GetTableLocationsResponsePB> cached(
+      new GetTableLocationsResponsePB(resp));
+  Stripe* stripe = GetStripe(key);
+  std::lock_guard<simple_spinlock> l(stripe->lock);
+  auto it = stripe->entries.find(key);
+  if (it != stripe->entries.end()) {
+    Entry* e = &it->second;
+    if (e->table_version > table_version ||
+        (e->table_version == table_version && e->epoch >= epoch)) {
+      // A concurrent lookup already cached a response at least as recent.
+      return;
+    }
+    stripe->usage -= e->charge;
+    stripe->entries.erase(it);
+  }
+  EvictUnlocked(stripe, charge);
+  stripe->entries.emplace(key, Entry{ table_version, epoch, charge, std::move(cached) });
+  stripe->usage += charge;
+}
+
+void TableLocationsCache::EvictUnlocked(Stripe* stripe, size_t charge) {
+  DCHECK(stripe->lock.is_locked());
+  if (stripe->usage + charge <= stripe_capacity_bytes_) {
+    return;
+  }
+  const int64_t cur_epoch = epoch();
+  for (auto it = stripe->entries.begin(); it != stripe->entries.end();) {
+    if (it->second.epoch < cur_epoch) {
+      stripe->usage -= it->second.charge;
+      it = stripe->entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  if (stripe->usage + charge > stripe_capacity_bytes_) {
+    stripe->entries.clear();
+    stripe->usage = 0;
+  }
+}
+
+} // namespace master
+} // namespace kudu
@@ -0,0 +1,133 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/atomic.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/metrics.h"
+
+namespace kudu {
+namespace master {
+
+class GetTableLocationsRequestPB;
+class GetTableLocationsResponsePB;
+
+// A cache of fully-built GetTableLocations responses.
+//
+// Building the response for a large table requires taking the metadata lock
+// of every tablet in the range and looking up every replica's tablet server,
+// which is the dominant cost of serving clients' meta cache refreshes. This
+// cache stores the built responses as immutable snapshots so that repeated
+// lookups for the same range only copy the cached response.
+//
+// The cache is split into stripes, each protected by its own spinlock, so
+// that concurrent lookups of different tables don't contend with each other.
+//
+// Entries are validated rather than explicitly invalidated: every entry is
+// stamped with the version of its table's locations and with the cache-wide
+// epoch at the time its response started to be built. A lookup only hits if
+// both still match, so a writer merely needs to bump the relevant version
+// (after publishing its changes) to make stale entries unreachable. Stale
+// entries are dropped lazily, either when looked up or when their stripe
+// runs over its share of the capacity.
+class TableLocationsCache {
+ public:
+  // 'capacity_bytes' bounds the approximate memory footprint of the cached
+  // responses; a capacity of 0 disables caching. The 'metric_entity' is used
+  // to register the cache hit and query counters.
+  explicit TableLocationsCache(size_t capacity_bytes,
+                               MetricEntity* metric_entity = nullptr);
+  ~TableLocationsCache() = default;
+
+  // Builds the cache key for a GetTableLocations request against the table
+  // with the specified identifier. Only the request fields which affect the
+  // contents of the response are part of the key.
+  static std::string MakeKey(const std::string& table_id,
+                             const GetTableLocationsRequestPB& req);
+
+  // Returns the current cache-wide epoch. Callers building a response to be
+  // inserted into the cache must read the epoch before building it.
+  int64_t epoch() const { return epoch_.Load(); }
+
+  // Makes every entry in the cache stale. Used when state shared by all
+  // tables changes, e.g. when a tablet server re-registers with new
+  // addresses or the catalog is reloaded.
+  void Invalidate() { epoch_.Increment(); }
+
+  // Looks up the response cached for 'key'. If it was built at
+  // 'table_version' within the current epoch, copies it into 'resp' and
+  // returns true. Otherwise returns false, leaving 'resp' untouched.
+  bool Lookup(const std::string& key,
+              int64_t table_version,
+              GetTableLocationsResponsePB* resp);
+
+  // Caches 'resp' under 'key'. The 'table_version' and 'epoch' must have
+  // been read before 'resp' started being built.
+  void Insert(const std::string& key,
+              int64_t table_version,
+              int64_t epoch,
+              const GetTableLocationsResponsePB& resp);
+
+ private:
+  struct Entry {
+    int64_t table_version;
+    int64_t epoch;
+    size_t charge;
+    std::shared_ptr<const GetTableLocationsResponsePB> resp;
+  };
+
+  struct Stripe {
+    simple_spinlock lock;
+    std::unordered_map<std::string, Entry> entries;
+    size_t usage = 0;
+  };
+
+  static constexpr int kNumStripes = 16;
+
+  Stripe* GetStripe(const std::string& key);
+
+  // Makes room for an entry of 'charge' bytes in 'stripe', first by dropping
+  // entries from previous epochs and then, if that's not enough, by dropping
+  // everything.
+  //
+  // Must be called with the stripe's lock held.
+  void EvictUnlocked(Stripe* stripe, size_t charge);
+
+  // The capacity of each individual stripe.
+  const size_t stripe_capacity_bytes_;
+
+  AtomicInt<int64_t> epoch_;
+
+  std::array<Stripe, kNumStripes> stripes_;
+
+  scoped_refptr<Counter> cache_hits_;
+  scoped_refptr<Counter> cache_queries_;
+
+  DISALLOW_COPY_AND_ASSIGN(TableLocationsCache);
+};
+
+} // namespace master
+} // namespace kudu
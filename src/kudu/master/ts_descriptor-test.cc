@@ -17,6 +17,8 @@
 
 #include "kudu/master/ts_descriptor.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -27,7 +29,9 @@
 
 #include "kudu/common/common.pb.h"
 #include "kudu/common/wire_protocol.pb.h"
+#include "kudu/consensus/metadata.pb.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/master/master.pb.h"
 #include "kudu/util/test_macros.h"
 
 using std::shared_ptr;
@@ -91,5 +95,118 @@ TEST(TSDescriptorTest, TestLocationCmd) {
   ASSERT_OK(TSDescriptor::RegisterNew(instance, registration, location, &desc));
   ASSERT_EQ(location, desc->location());
 }
+
+TEST(TSDescriptorTest, TestDiskSaturation) {
+  NodeInstancePB instance;
+  ServerRegistrationPB registration;
+  SetupBasicRegistrationInfo("test", &instance, &registration);
+  shared_ptr<TSDescriptor> desc;
+  ASSERT_OK(TSDescriptor::RegisterNew(instance, registration, {}, &desc));
+
+  // A server that never reported its load isn't considered saturated.
+  ASSERT_FALSE(desc->IsDiskSaturated(0.5));
+
+  TServerLoadPB load;
+  load.set_num_data_dirs(2);
+  load.set_num_full_data_dirs(1);
+  load.set_data_dirs_capacity_bytes(1000);
+  load.set_data_dirs_available_bytes(400);
+  load.set_maintenance_backlog_ops(3);
+  desc->UpdateLoad(load);
+  ASSERT_FALSE(desc->IsDiskSaturated(0.9));
+  ASSERT_TRUE(desc->IsDiskSaturated(0.5));
+  ASSERT_EQ(3, desc->maintenance_backlog_ops());
+
+  // Once all data directories are full, the server is saturated regardless
+  // of the ratio.
+  load.set_num_full_data_dirs(2);
+  desc->UpdateLoad(load);
+  ASSERT_TRUE(desc->IsDiskSaturated(1.0));
+}
+
+TEST(TSDescriptorTest, TestMergeTabletReports) {
+  NodeInstancePB instance;
+  ServerRegistrationPB registration;
+  SetupBasicRegistrationInfo("test", &instance, &registration);
+  shared_ptr<TSDescriptor> desc;
+  ASSERT_OK(TSDescriptor::RegisterNew(instance, registration, {}, &desc));
+  ASSERT_EQ(-1, desc->merged_tablet_report_seq());
+
+  auto add_tablet = [](TabletReportPB* report, const string& tablet_id, int64_t term) {
+    ReportedTabletPB* tablet = report->add_updated_tablets();
+    tablet->set_tablet_id(tablet_id);
+    tablet->set_schema_version(1);
+    if (term >= 0) {
+      tablet->mutable_consensus_state()->set_current_term(term);
+    } else {
+      tablet->set_consensus_state_unchanged(true);
+    }
+  };
+
+  // A delta can't be merged before a full report.
+  TabletReportPB delta;
+  delta.set_is_incremental(true);
+  delta.set_sequence_number(0);
+  delta.set_base_sequence_number(0);
+  TabletReportPB resolved;
+  ASSERT_TRUE(desc->MergeTabletReport(delta, &resolved).IsIncomplete());
+
+  TabletReportPB full;
+  full.set_is_incremental(false);
+  full.set_sequence_number(1);
+  add_tablet(&full, "a", 1);
+  add_tablet(&full, "b", 1);
+  add_tablet(&full, "c", 1);
+  ASSERT_OK(desc->MergeTabletReport(full, nullptr));
+  ASSERT_EQ(1, desc->merged_tablet_report_seq());
+
+  // An incremental delta omits the unchanged consensus state of 'a'.
+  delta.Clear();
+  delta.set_is_incremental(true);
+  delta.set_sequence_number(2);
+  delta.set_base_sequence_number(1);
+  add_tablet(&delta, "a", -1);
+  delta.mutable_updated_tablets(0)->set_schema_version(2);
+  delta.add_removed_tablet_ids("b");
+  ASSERT_OK(desc->MergeTabletReport(delta, &resolved));
+  ASSERT_TRUE(resolved.is_incremental());
+  ASSERT_FALSE(resolved.has_base_sequence_number());
+  ASSERT_EQ(1, resolved.updated_tablets_size());
+  ASSERT_EQ(2, resolved.updated_tablets(0).schema_version());
+  ASSERT_EQ(1, resolved.updated_tablets(0).consensus_state().current_term());
+  ASSERT_FALSE(resolved.updated_tablets(0).consensus_state_unchanged());
+  ASSERT_EQ(1, resolved.removed_tablet_ids_size());
+
+  // A full delta lists only the changed tablets, and resolves to all of them.
+  delta.Clear();
+  delta.set_is_incremental(false);
+  delta.set_sequence_number(3);
+  delta.set_base_sequence_number(2);
+  add_tablet(&delta, "d", 1);
+  ASSERT_OK(desc->MergeTabletReport(delta, &resolved));
+  ASSERT_FALSE(resolved.is_incremental());
+  vector<string> tablet_ids;
+  for (const auto& tablet : resolved.updated_tablets()) {
+    tablet_ids.push_back(tablet.tablet_id());
+    if (tablet.tablet_id() == "a") {
+      ASSERT_EQ(2, tablet.schema_version());
+    }
+  }
+  std::sort(tablet_ids.begin(), tablet_ids.end());
+  ASSERT_EQ(vector<string>({ "a", "c", "d" }), tablet_ids);
+  ASSERT_EQ(0, resolved.removed_tablet_ids_size());
+  ASSERT_EQ(3, desc->merged_tablet_report_seq());
+
+  // Deltas relative to reports which weren't merged can't be resolved.
+  delta.set_sequence_number(5);
+  delta.set_base_sequence_number(4);
+  ASSERT_TRUE(desc->MergeTabletReport(delta, &resolved).IsIncomplete());
+
+  // The reported tablets are forgotten when the server re-registers.
+  ASSERT_OK(desc->Register(instance, registration, {}));
+  ASSERT_EQ(-1, desc->merged_tablet_report_seq());
+  delta.set_base_sequence_number(3);
+  ASSERT_TRUE(desc->MergeTabletReport(delta, &resolved).IsIncomplete());
+}
 } // namespace master
 } // namespace kudu
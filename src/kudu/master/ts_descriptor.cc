@@ -32,9 +32,14 @@
 #include "kudu/common/wire_protocol.h"
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/consensus/consensus.proxy.h"
+#include "kudu/consensus/metadata.pb.h"
+#include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/master/master.pb.h"
+#include "kudu/rpc/messenger.h"
 #include "kudu/tserver/tserver_admin.proxy.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/net/dns_resolver.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/pb_util.h"
@@ -71,7 +76,13 @@ TSDescriptor::TSDescriptor(std::string perm_id)
       last_heartbeat_(MonoTime::Now()),
       recent_replica_creations_(0),
       last_replica_creations_decay_(MonoTime::Now()),
-      num_live_replicas_(0) {
+      num_live_replicas_(0),
+      num_data_dirs_(0),
+      num_full_data_dirs_(0),
+      data_dirs_capacity_bytes_(0),
+      data_dirs_available_bytes_(0),
+      maintenance_backlog_ops_(0),
+      merged_tablet_report_seq_(-1) {
 }
 
 // Compares two repeated HostPortPB fields. Returns true if equal, false otherwise.
@@ -139,6 +150,80 @@ Status TSDescriptor::Register(const NodeInstancePB& instance,
   ts_admin_proxy_.reset();
   consensus_proxy_.reset();
   location_ = location;
+  {
+    // The server may have restarted: its next reports aren't relative to
+    // the previous ones.
+    std::lock_guard<simple_spinlock> l(reported_tablets_lock_);
+    reported_tablets_.clear();
+    merged_tablet_report_seq_ = -1;
+  }
+  return Status::OK();
+}
+
+Status TSDescriptor::MergeTabletReport(const TabletReportPB& report,
+                                       TabletReportPB* resolved) {
+  std::lock_guard<simple_spinlock> l(reported_tablets_lock_);
+  const bool is_delta = report.has_base_sequence_number();
+  if (!report.is_incremental() && !is_delta) {
+    reported_tablets_.clear();
+  } else if (merged_tablet_report_seq_ < 0) {
+    if (is_delta) {
+      return Status::Incomplete(Substitute(
+          "tablet report $0 is relative to report $1 which wasn't merged",
+          report.sequence_number(), report.base_sequence_number()));
+    }
+    // There are no reported tablets to merge an incremental report into.
+    if (resolved) {
+      *resolved = report;
+    }
+    return Status::OK();
+  } else if (is_delta && report.base_sequence_number() > merged_tablet_report_seq_) {
+    return Status::Incomplete(Substitute(
+        "tablet report $0 is relative to report $1 but the last merged report is $2",
+        report.sequence_number(), report.base_sequence_number(),
+        merged_tablet_report_seq_));
+  }
+
+  if (resolved) {
+    resolved->Clear();
+    resolved->set_is_incremental(report.is_incremental());
+    resolved->set_sequence_number(report.sequence_number());
+  }
+  for (const auto& tablet : report.updated_tablets()) {
+    ReportedTabletPB& merged = reported_tablets_[tablet.tablet_id()];
+    if (tablet.consensus_state_unchanged()) {
+      if (PREDICT_FALSE(!is_delta || !merged.has_consensus_state())) {
+        reported_tablets_.clear();
+        merged_tablet_report_seq_ = -1;
+        return Status::Incomplete(Substitute(
+            "tablet report $0 omits the consensus state of unknown tablet $1",
+            report.sequence_number(), tablet.tablet_id()));
+      }
+      consensus::ConsensusStatePB cstate;
+      cstate.Swap(merged.mutable_consensus_state());
+      merged = tablet;
+      merged.clear_consensus_state_unchanged();
+      merged.mutable_consensus_state()->Swap(&cstate);
+    } else {
+      merged = tablet;
+    }
+    if (resolved && report.is_incremental()) {
+      *resolved->add_updated_tablets() = merged;
+    }
+  }
+  for (const auto& tablet_id : report.removed_tablet_ids()) {
+    reported_tablets_.erase(tablet_id);
+    if (resolved && report.is_incremental()) {
+      resolved->add_removed_tablet_ids(tablet_id);
+    }
+  }
+  if (resolved && !report.is_incremental()) {
+    resolved->mutable_updated_tablets()->Reserve(reported_tablets_.size());
+    for (const auto& e : reported_tablets_) {
+      *resolved->add_updated_tablets() = e.second;
+    }
+  }
+  merged_tablet_report_seq_ = report.sequence_number();
   return Status::OK();
 }
 
@@ -192,6 +277,28 @@ double TSDescriptor::RecentReplicaCreations() {
   return recent_replica_creations_;
 }
 
+void TSDescriptor::UpdateLoad(const TServerLoadPB& load) {
+  std::lock_guard<rw_spinlock> l(lock_);
+  num_data_dirs_ = load.num_data_dirs();
+  num_full_data_dirs_ = load.num_full_data_dirs();
+  data_dirs_capacity_bytes_ = load.data_dirs_capacity_bytes();
+  data_dirs_available_bytes_ = load.data_dirs_available_bytes();
+  maintenance_backlog_ops_ = load.maintenance_backlog_ops();
+}
+
+bool TSDescriptor::IsDiskSaturated(double max_used_ratio) const {
+  shared_lock<rw_spinlock> l(lock_);
+  if (num_data_dirs_ > 0 && num_full_data_dirs_ >= num_data_dirs_) {
+    return true;
+  }
+  if (data_dirs_capacity_bytes_ <= 0) {
+    return false;
+  }
+  const double used_ratio =
+      1.0 - static_cast<double>(data_dirs_available_bytes_) / data_dirs_capacity_bytes_;
+  return used_ratio > max_used_ratio;
+}
+
 void TSDescriptor::GetRegistration(ServerRegistrationPB* reg) const {
   shared_lock<rw_spinlock> l(lock_);
   CHECK(registration_) << "No registration";
@@ -204,7 +311,8 @@ void TSDescriptor::GetNodeInstancePB(NodeInstancePB* instance_pb) const {
   instance_pb->set_instance_seqno(latest_seqno_);
 }
 
-Status TSDescriptor::ResolveSockaddr(Sockaddr* addr, string* host) const {
+Status TSDescriptor::ResolveSockaddr(DnsResolver* resolver, Sockaddr* addr,
+                                     string* host) const {
   vector<HostPort> hostports;
   {
     shared_lock<rw_spinlock> l(lock_);
@@ -217,7 +325,7 @@ Status TSDescriptor::ResolveSockaddr(Sockaddr* addr, string* host) const {
   HostPort last_hostport;
   vector<Sockaddr> addrs;
   for (const HostPort& hostport : hostports) {
-    RETURN_NOT_OK(hostport.ResolveAddresses(&addrs));
+    RETURN_NOT_OK(resolver->ResolveAddresses(hostport, &addrs));
     if (!addrs.empty()) {
       last_hostport = hostport;
       break;
@@ -251,7 +359,7 @@ Status TSDescriptor::GetTSAdminProxy(const shared_ptr<rpc::Messenger>& messenger
 
   Sockaddr addr;
   string host;
-  RETURN_NOT_OK(ResolveSockaddr(&addr, &host));
+  RETURN_NOT_OK(ResolveSockaddr(messenger->dns_resolver(), &addr, &host));
 
   std::lock_guard<rw_spinlock> l(lock_);
   if (!ts_admin_proxy_) {
@@ -274,7 +382,7 @@ Status TSDescriptor::GetConsensusProxy(const shared_ptr<rpc::Messenger>& messeng
 
   Sockaddr addr;
   string host;
-  RETURN_NOT_OK(ResolveSockaddr(&addr, &host));
+  RETURN_NOT_OK(ResolveSockaddr(messenger->dns_resolver(), &addr, &host));
 
   std::lock_guard<rw_spinlock> l(lock_);
   if (!consensus_proxy_) {
@@ -21,6 +21,7 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/optional/optional.hpp>
@@ -30,6 +31,7 @@
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/master/master.pb.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/make_shared.h"
 #include "kudu/util/monotime.h"
@@ -37,6 +39,7 @@
 
 namespace kudu {
 
+class DnsResolver;
 class Sockaddr;
 
 namespace consensus {
@@ -53,6 +56,8 @@ class TabletServerAdminServiceProxy;
 
 namespace master {
 
+class TServerLoadPB;
+
 // Master-side view of a single tablet server.
 //
 // Tracks the last heartbeat, status, instance identifier, location, etc.
@@ -122,6 +127,21 @@ class TSDescriptor : public enable_make_shared<TSDescriptor> {
     return num_live_replicas_;
   }
 
+  // Update the resource usage statistics from the last heartbeat.
+  void UpdateLoad(const TServerLoadPB& load);
+
+  // Return whether the disks of this server are too full to host new
+  // replicas: either all of its data directories are full or more than
+  // 'max_used_ratio' of their capacity is used. Returns false if the server
+  // never reported its disk usage.
+  bool IsDiskSaturated(double max_used_ratio) const;
+
+  // Return the maintenance op backlog from the last heartbeat.
+  int maintenance_backlog_ops() const {
+    shared_lock<rw_spinlock> l(lock_);
+    return maintenance_backlog_ops_;
+  }
+
   // Return the location of the tablet server. This returns a safe copy
   // since the location could change at any time if the tablet server
   // re-registers.
@@ -130,6 +150,23 @@ class TSDescriptor : public enable_make_shared<TSDescriptor> {
     return location_;
   }
 
+  // Merge the tablet report 'report' into the tablets reported by this
+  // server. If 'resolved' isn't null, set it to the equivalent report
+  // without deltas.
+  //
+  // Returns Incomplete if 'report' is a delta relative to reports which
+  // weren't merged, e.g. because the server re-registered since. The
+  // reported tablets are then unknown until the next full report.
+  Status MergeTabletReport(const TabletReportPB& report, TabletReportPB* resolved);
+
+  // Return the sequence number of the last tablet report merged into the
+  // tablets reported by this server, or -1 if they're unknown, i.e. no full
+  // report was merged since the server registered.
+  int32_t merged_tablet_report_seq() const {
+    std::lock_guard<simple_spinlock> l(reported_tablets_lock_);
+    return merged_tablet_report_seq_;
+  }
+
   // Return a string form of this TS, suitable for printing.
   // Includes the UUID as well as last known host/port.
   std::string ToString() const;
@@ -141,10 +178,10 @@ class TSDescriptor : public enable_make_shared<TSDescriptor> {
   FRIEND_TEST(TestTSDescriptor, TestReplicaCreationsDecay);
   friend class PlacementPolicyTest;
 
-  // Uses DNS to resolve registered hosts to a single Sockaddr.
-  // Returns the resolved address as well as the hostname associated with it
-  // in 'addr' and 'host'.
-  Status ResolveSockaddr(Sockaddr* addr, std::string* host) const;
+  // Uses DNS, through 'resolver', to resolve registered hosts to a single
+  // Sockaddr. Returns the resolved address as well as the hostname associated
+  // with it in 'addr' and 'host'.
+  Status ResolveSockaddr(DnsResolver* resolver, Sockaddr* addr, std::string* host) const;
 
   void DecayRecentReplicaCreationsUnlocked();
 
@@ -164,11 +201,29 @@ class TSDescriptor : public enable_make_shared<TSDescriptor> {
   // The number of live replicas on this host, from the last heartbeat.
   int num_live_replicas_;
 
+  // Resource usage statistics, from the last heartbeat.
+  int num_data_dirs_;
+  int num_full_data_dirs_;
+  int64_t data_dirs_capacity_bytes_;
+  int64_t data_dirs_available_bytes_;
+  int maintenance_backlog_ops_;
+
   // The tablet server's location, as determined by the master at registration.
   boost::optional<std::string> location_;
 
   gscoped_ptr<ServerRegistrationPB> registration_;
 
+  // Protects 'reported_tablets_' and 'merged_tablet_report_seq_'. Acquired
+  // after 'lock_' if both are held.
+  mutable simple_spinlock reported_tablets_lock_;
+
+  // The tablets reported by this server, keyed by tablet ID, as of the tablet
+  // report with sequence number 'merged_tablet_report_seq_'. Every master
+  // keeps them, so that the reports may be deltas, even when it's not the
+  // leader: a newly elected leader already knows the tablets.
+  std::unordered_map<std::string, ReportedTabletPB> reported_tablets_;
+  int32_t merged_tablet_report_seq_;
+
   std::shared_ptr<tserver::TabletServerAdminServiceProxy> ts_admin_proxy_;
   std::shared_ptr<consensus::ConsensusServiceProxy> consensus_proxy_;
 
@@ -17,6 +17,8 @@
 
 #include "kudu/rpc/acceptor_pool.h"
 
+#include <unistd.h>
+
 #include <string>
 #include <ostream>
 #include <vector>
@@ -129,6 +131,15 @@ void AcceptorPool::Shutdown() {
   // here, it would  necessary to wait until Messenger::Shutdown() is called for
   // the corresponding messenger object to close this socket.
   ignore_result(socket_.Close());
+
+  // Remove the file of a UNIX domain socket, so that clients don't try to
+  // connect to it anymore.
+  if (bind_address_.is_unix()) {
+    const string path = bind_address_.UnixDomainPath();
+    if (!path.empty() && path[0] != '@') {
+      ignore_result(unlink(path.c_str()));
+    }
+  }
 }
 
 Sockaddr AcceptorPool::bind_address() const {
@@ -158,7 +169,7 @@ void AcceptorPool::RunThread() {
                                     << THROTTLE_MSG;
       continue;
     }
-    s = new_sock.SetNoDelay(true);
+    s = bind_address_.is_unix() ? Status::OK() : new_sock.SetNoDelay(true);
     if (!s.ok()) {
       KLOG_EVERY_N_SECS(WARNING, 1) << "Acceptor with remote = " << remote.ToString()
           << " failed to set TCP_NODELAY on a newly accepted socket: "
@@ -66,6 +66,7 @@ using std::unique_ptr;
 
 using strings::Substitute;
 
+DECLARE_bool(rpc_compress_loopback_sidecars);
 DECLARE_bool(rpc_encrypt_loopback_connections);
 
 namespace kudu {
@@ -186,13 +187,24 @@ Status ClientNegotiation::Negotiate(unique_ptr<ErrorStatusPB>* rpc_error) {
   // TODO(KUDU-1921): allow the client to require TLS.
   if (encryption_ != RpcEncryption::DISABLED &&
       ContainsKey(server_features_, TLS)) {
+    // When using SASL authentication, verifying the server's certificate is
+    // not necessary. This allows the client to still use TLS encryption for
+    // connections to servers which only have a self-signed certificate.
+    const bool verify_server = negotiated_authn_ != AuthenticationType::SASL;
+
+    // Resume the last session with the server, if any, to skip the key
+    // exchange. Since the authentication type determines which end verifies
+    // the certificate of the other, sessions are kept apart by type.
+    string session_key;
+    Sockaddr server_addr;
+    if (socket_->GetPeerAddress(&server_addr).ok()) {
+      session_key = Substitute("$0/$1", server_addr.ToString(),
+                               AuthenticationTypeToString(negotiated_authn_));
+    }
     RETURN_NOT_OK(tls_context_->InitiateHandshake(security::TlsHandshakeType::CLIENT,
-                                                  &tls_handshake_));
-
-    if (negotiated_authn_ == AuthenticationType::SASL) {
-      // When using SASL authentication, verifying the server's certificate is
-      // not necessary. This allows the client to still use TLS encryption for
-      // connections to servers which only have a self-signed certificate.
+                                                  &tls_handshake_,
+                                                  session_key));
+    if (!verify_server) {
       tls_handshake_.set_verification_mode(security::TlsVerificationMode::VERIFY_NONE);
     }
 
@@ -321,6 +333,12 @@ Status ClientNegotiation::SendNegotiate() {
     }
   }
 
+  // Decompressing the sidecars received from a local server would only cost
+  // CPU, so only accept compressed sidecars from remote servers.
+  if (!socket_->IsLoopbackConnection() || FLAGS_rpc_compress_loopback_sidecars) {
+    client_features_.insert(LZ4_SIDECAR_COMPRESSION);
+  }
+
   for (RpcFeatureFlag feature : client_features_) {
     msg.add_supported_features(feature);
   }
@@ -497,6 +515,13 @@ Status ClientNegotiation::HandleTlsHandshake(const NegotiatePB& response) {
   // an Incomplete status.
   RETURN_NOT_OK(s);
 
+  if (!token.empty()) {
+    // When resuming a session, the client sends the last handshake message,
+    // which the server acknowledges with an empty token.
+    RETURN_NOT_OK(SendTlsHandshake(std::move(token)));
+    return Status::Incomplete("awaiting TLS handshake acknowledgement");
+  }
+
   // TLS handshake is finished.
   if (ContainsKey(server_features_, TLS_AUTHENTICATION_ONLY) &&
       ContainsKey(client_features_, TLS_AUTHENTICATION_ONLY)) {
@@ -505,8 +530,9 @@ Status ClientNegotiation::HandleTlsHandshake(const NegotiatePB& response) {
     return tls_handshake_.FinishNoWrap(*socket_);
   }
 
-  TRACE("Negotiated $0 with cipher $1",
-        tls_handshake_.GetProtocol(), tls_handshake_.GetCipherDescription());
+  TRACE("Negotiated $0 with cipher $1$2",
+        tls_handshake_.GetProtocol(), tls_handshake_.GetCipherDescription(),
+        tls_handshake_.session_reused() ? " (resumed session)" : "");
   return tls_handshake_.Finish(&socket_);
 }
 
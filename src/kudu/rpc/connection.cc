@@ -31,6 +31,7 @@
 #include <boost/intrusive/detail/list_iterator.hpp>
 #include <boost/intrusive/list.hpp>
 #include <ev.h>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/gutil/map-util.h"
@@ -44,6 +45,7 @@
 #include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/rpc/rpc_introspection.pb.h"
 #include "kudu/rpc/transfer.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/net/socket.h"
 #include "kudu/util/slice.h"
@@ -61,6 +63,38 @@ using std::shared_ptr;
 using std::unique_ptr;
 using strings::Substitute;
 
+DEFINE_int32(rpc_max_outbound_transfers_per_write, 16,
+             "The maximum number of queued outbound calls or responses of a connection "
+             "which are written to its socket with a single syscall. Batching the "
+             "transfers saves syscalls when many small RPCs are in flight. The value "
+             "is capped at 64.");
+TAG_FLAG(rpc_max_outbound_transfers_per_write, advanced);
+TAG_FLAG(rpc_max_outbound_transfers_per_write, runtime);
+
+DEFINE_int32(rpc_outbound_coalesce_delay_us, 0,
+             "If positive, the time for which the transfers queued on an idle connection "
+             "are held before being written, so that the calls or responses queued in "
+             "the meantime are written with the same syscall. This trades some latency "
+             "for fewer syscalls under high fan-out of small RPCs. The transfers are "
+             "written without waiting once --rpc_outbound_coalesce_bytes are queued.");
+TAG_FLAG(rpc_outbound_coalesce_delay_us, advanced);
+TAG_FLAG(rpc_outbound_coalesce_delay_us, runtime);
+
+DEFINE_int64(rpc_outbound_coalesce_bytes, 256 * 1024,
+             "The maximum number of bytes of queued outbound transfers of a connection "
+             "which are gathered into a single syscall. Also the number of queued bytes "
+             "after which the transfers held per --rpc_outbound_coalesce_delay_us are "
+             "written right away.");
+TAG_FLAG(rpc_outbound_coalesce_bytes, advanced);
+TAG_FLAG(rpc_outbound_coalesce_bytes, runtime);
+
+DEFINE_int32(rpc_read_ahead_bytes, 16 * 1024,
+             "The number of bytes read ahead from the socket of each new connection, so "
+             "that the small calls or responses which arrive together are received with a "
+             "single syscall, and handled in the same wakeup of the reactor thread. "
+             "0 disables the read-ahead.");
+TAG_FLAG(rpc_read_ahead_bytes, advanced);
+
 namespace kudu {
 namespace rpc {
 
@@ -68,6 +102,14 @@ typedef OutboundCall::Phase Phase;
 
 namespace {
 
+// The maximum number of outbound transfers written with a single syscall,
+// whose slices stay well below IOV_MAX.
+const int kMaxTransfersPerWrite = 64;
+
+} // anonymous namespace
+
+namespace {
+
 // tcp_info struct duplicated from linux/tcp.h.
 //
 // This allows us to decouple the compile-time Linux headers from the
@@ -205,7 +247,9 @@ Connection::Connection(ReactorThread *reactor_thread,
       socket_(std::move(socket)),
       direction_(direction),
       last_activity_time_(MonoTime::Now()),
+      read_ahead_(FLAGS_rpc_read_ahead_bytes),
       is_epoll_registered_(false),
+      coalesced_bytes_(0),
       next_call_id_(1),
       credentials_policy_(policy),
       negotiation_complete_(false),
@@ -230,6 +274,8 @@ void Connection::EpollRegister(ev::loop_ref& loop) {
   read_io_.set(socket_->GetFd(), ev::READ);
   read_io_.set<Connection, &Connection::ReadHandler>(this);
   read_io_.start();
+  coalesce_timer_.set(loop);
+  coalesce_timer_.set<Connection, &Connection::CoalesceTimerHandler>(this);
   is_epoll_registered_ = true;
 }
 
@@ -315,6 +361,7 @@ void Connection::Shutdown(const Status &status,
 
   read_io_.stop();
   write_io_.stop();
+  coalesce_timer_.stop();
   is_epoll_registered_ = false;
   if (socket_) {
     WARN_NOT_OK(socket_->Close(), "Error closing socket");
@@ -333,12 +380,36 @@ void Connection::QueueOutbound(gscoped_ptr<OutboundTransfer> transfer) {
 
   DVLOG(3) << "Queueing transfer: " << transfer->HexDump();
 
+  const int32_t transfer_bytes = transfer->TotalLength();
   outbound_transfers_.push_back(*transfer.release());
 
   if (negotiation_complete_ && !write_io_.is_active()) {
     // If we weren't currently in the middle of sending anything,
     // then our write_io_ interest is stopped. Need to re-start it.
     // Only do this after connection negotiation is done doing its work.
+    //
+    // When coalescing is enabled, the interest is only re-started once the
+    // delay expires or enough bytes are queued, so that the transfers queued
+    // by the reactor tasks in the meantime are written together.
+    if (FLAGS_rpc_outbound_coalesce_delay_us > 0) {
+      coalesced_bytes_ += transfer_bytes;
+      if (coalesced_bytes_ < FLAGS_rpc_outbound_coalesce_bytes) {
+        if (!coalesce_timer_.is_active()) {
+          coalesce_timer_.start(FLAGS_rpc_outbound_coalesce_delay_us / 1e6, 0);
+        }
+        return;
+      }
+      coalesce_timer_.stop();
+    }
+    coalesced_bytes_ = 0;
+    write_io_.start();
+  }
+}
+
+void Connection::CoalesceTimerHandler(ev::timer& /*watcher*/, int /*revents*/) {
+  DCHECK(reactor_thread_->IsCurrentThread());
+  coalesced_bytes_ = 0;
+  if (!outbound_transfers_.empty() && !write_io_.is_active()) {
     write_io_.start();
   }
 }
@@ -547,6 +618,7 @@ struct ResponseTransferCallbacks : public TransferCallbacks {
   }
 
   virtual void NotifyTransferFinished() OVERRIDE {
+    call_->RecordResponseSent();
     delete this;
   }
 
@@ -635,11 +707,14 @@ void Connection::ReadHandler(ev::io &watcher, int revents) {
   }
   last_activity_time_ = reactor_thread_->cur_time();
 
+  // Handling a transfer may destroy the connection, but the transfers which
+  // were read ahead are handled within the loop below.
+  scoped_refptr<Connection> self(this);
   while (true) {
     if (!inbound_) {
       inbound_.reset(new InboundTransfer());
     }
-    Status status = inbound_->ReceiveBuffer(*socket_);
+    Status status = inbound_->ReceiveBuffer(*socket_, &read_ahead_);
     if (PREDICT_FALSE(!status.ok())) {
       if (status.posix_code() == ESHUTDOWN) {
         VLOG(1) << ToString() << " shut down by remote end.";
@@ -663,14 +738,13 @@ void Connection::ReadHandler(ev::io &watcher, int revents) {
       LOG(FATAL) << "Invalid direction: " << direction_;
     }
 
-    // TODO: it would seem that it would be good to loop around and see if
-    // there is more data on the socket by trying another recv(), but it turns
-    // out that it really hurts throughput to do so. A better approach
-    // might be for each InboundTransfer to actually try to read an extra byte,
-    // and if it succeeds, then we'd copy that byte into a new InboundTransfer
-    // and loop around, since it's likely the next call also arrived at the
-    // same time.
-    break;
+    // Loop around only if the next transfers were already read ahead: trying
+    // another recv() to see if there is more data on the socket really hurts
+    // throughput. If a transfer wasn't read entirely from the buffered bytes,
+    // they were all consumed, so none is left behind once we return.
+    if (read_ahead_.empty() || !is_epoll_registered_) {
+      break;
+    }
   }
 }
 
@@ -737,7 +811,6 @@ void Connection::WriteHandler(ev::io &watcher, int revents) {
   }
   DVLOG(3) << ToString() << ": writeHandler: revents = " << revents;
 
-  OutboundTransfer *transfer;
   if (outbound_transfers_.empty()) {
     LOG(WARNING) << ToString() << " got a ready-to-write callback, but there is "
       "nothing to write.";
@@ -745,17 +818,26 @@ void Connection::WriteHandler(ev::io &watcher, int revents) {
     return;
   }
 
+  const int max_batch = std::max(1, std::min(FLAGS_rpc_max_outbound_transfers_per_write,
+                                             kMaxTransfersPerWrite));
+  const int64_t max_batch_bytes = FLAGS_rpc_outbound_coalesce_bytes;
+  OutboundTransfer* batch[kMaxTransfersPerWrite];
   while (!outbound_transfers_.empty()) {
-    transfer = &(outbound_transfers_.front());
-
-    if (!transfer->TransferStarted()) {
-
-      if (transfer->is_for_outbound_call()) {
+    // Gather the transfers at the front of the queue which are ready to be
+    // sent, so that they're written with a single syscall.
+    int n_batch = 0;
+    int64_t batch_bytes = 0;
+    auto it = outbound_transfers_.begin();
+    while (it != outbound_transfers_.end() && n_batch < max_batch &&
+           (n_batch == 0 || batch_bytes < max_batch_bytes)) {
+      OutboundTransfer* transfer = &*it;
+
+      if (!transfer->TransferStarted() && transfer->is_for_outbound_call()) {
         CallAwaitingResponse* car = FindOrDie(awaiting_response_, transfer->call_id());
         if (!car->call) {
           // If the call has already timed out or has already been cancelled, the 'call'
           // field would be set to NULL. In that case, don't bother sending it.
-          outbound_transfers_.pop_front();
+          it = outbound_transfers_.erase(it);
           transfer->Abort(Status::Aborted("already timed out or cancelled"));
           delete transfer;
           continue;
@@ -768,7 +850,7 @@ void Connection::WriteHandler(ev::io &watcher, int revents) {
         const set<RpcFeatureFlag>& required_features = car->call->required_rpc_features();
         if (!includes(remote_features_.begin(), remote_features_.end(),
                       required_features.begin(), required_features.end())) {
-          outbound_transfers_.pop_front();
+          it = outbound_transfers_.erase(it);
           Status s = Status::NotSupported("server does not support the required RPC features");
           transfer->Abort(s);
           Phase phase = negotiation_complete_ ? Phase::REMOTE_CALL : Phase::CONNECTION_NEGOTIATION;
@@ -785,23 +867,32 @@ void Connection::WriteHandler(ev::io &watcher, int revents) {
         // Test cancellation when 'call_' is in 'SENDING' state.
         MaybeInjectCancellation(car->call);
       }
+      batch[n_batch++] = transfer;
+      batch_bytes += transfer->TotalLength();
+      ++it;
+    }
+    if (n_batch == 0) {
+      break;
     }
 
     last_activity_time_ = reactor_thread_->cur_time();
-    Status status = transfer->SendBuffer(*socket_);
+    Status status = OutboundTransfer::SendBuffers(*socket_, batch, n_batch);
     if (PREDICT_FALSE(!status.ok())) {
       LOG(WARNING) << ToString() << " send error: " << status.ToString();
       reactor_thread_->DestroyConnection(this, status);
       return;
     }
 
-    if (!transfer->TransferFinished()) {
-      DVLOG(3) << ToString() << ": writeHandler: xfer not finished.";
-      return;
+    for (int i = 0; i < n_batch; i++) {
+      OutboundTransfer* transfer = batch[i];
+      if (!transfer->TransferFinished()) {
+        DVLOG(3) << ToString() << ": writeHandler: xfer not finished.";
+        return;
+      }
+      DCHECK_EQ(transfer, &outbound_transfers_.front());
+      outbound_transfers_.pop_front();
+      delete transfer;
     }
-
-    outbound_transfers_.pop_front();
-    delete transfer;
   }
 
   // If we were able to write all of our outbound transfers,
@@ -896,7 +987,7 @@ Status Connection::DumpPB(const DumpConnectionsRequestPB& req,
     LOG(FATAL);
   }
 #ifdef __linux__
-  if (negotiation_complete_) {
+  if (negotiation_complete_ && remote_.is_ip()) {
     // TODO(todd): it's a little strange to not set socket level stats during
     // negotiation, but we don't have access to the socket here until negotiation
     // is complete.
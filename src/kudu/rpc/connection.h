@@ -180,6 +180,10 @@ class Connection : public RefCountedThreadSafe<Connection> {
   // libev callback when we may write to the socket.
   void WriteHandler(ev::io &watcher, int revents);
 
+  // libev callback when the delay for coalescing the outbound transfers
+  // queued on an idle connection expires.
+  void CoalesceTimerHandler(ev::timer& watcher, int revents);
+
   // Safe to be called from other threads.
   std::string ToString() const;
 
@@ -211,6 +215,12 @@ class Connection : public RefCountedThreadSafe<Connection> {
     remote_features_ = std::move(remote_features);
   }
 
+  // The RPC features supported by the remote peer. Only valid once the
+  // negotiation is complete, after which it doesn't change.
+  const std::set<RpcFeatureFlag>& remote_features() const {
+    return remote_features_;
+  }
+
   void set_remote_user(RemoteUser user) {
     DCHECK_EQ(direction_, SERVER);
     remote_user_ = std::move(user);
@@ -326,12 +336,20 @@ class Connection : public RefCountedThreadSafe<Connection> {
   // the inbound transfer, if any
   gscoped_ptr<InboundTransfer> inbound_;
 
+  // the bytes read from the socket ahead of the inbound transfers
+  ReadAheadBuffer read_ahead_;
+
   // notifies us when our socket is writable.
   ev::io write_io_;
 
   // notifies us when our socket is readable.
   ev::io read_io_;
 
+  // Delays re-starting 'write_io_' per --rpc_outbound_coalesce_delay_us, and
+  // the number of bytes queued since it was started.
+  ev::timer coalesce_timer_;
+  int64_t coalesced_bytes_;
+
   // Set to true when the connection is registered on a loop.
   // This is used for a sanity check in the destructor that we are properly
   // un-registered before shutting down.
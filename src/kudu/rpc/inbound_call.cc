@@ -21,12 +21,14 @@
 #include <memory>
 #include <ostream>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <google/protobuf/message.h>
 #include <google/protobuf/message_lite.h>
 
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/rpc/connection.h"
 #include "kudu/rpc/rpc_introspection.pb.h"
 #include "kudu/rpc/rpc_sidecar.h"
@@ -34,7 +36,11 @@
 #include "kudu/rpc/serialization.h"
 #include "kudu/rpc/service_if.h"
 #include "kudu/rpc/transfer.h"
+#include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/debug/trace_event.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/trace.h"
@@ -45,6 +51,15 @@ class FieldDescriptor;
 }
 }
 
+DEFINE_int64(rpc_compress_sidecars_min_bytes, 0,
+             "The minimum size of the sidecars of an RPC response which are "
+             "compressed with LZ4 before being sent to a remote client. "
+             "Compressing reduces the network traffic of large responses, such "
+             "as scan results, at the expense of CPU on both sides. "
+             "If 0, the sidecars aren't compressed.");
+TAG_FLAG(rpc_compress_sidecars_min_bytes, advanced);
+TAG_FLAG(rpc_compress_sidecars_min_bytes, runtime);
+
 using google::protobuf::FieldDescriptor;
 using google::protobuf::Message;
 using google::protobuf::MessageLite;
@@ -70,6 +85,7 @@ Status InboundCall::ParseFrom(gscoped_ptr<InboundTransfer> transfer) {
   TRACE_EVENT_FLOW_BEGIN0("rpc", "InboundCall", this);
   TRACE_EVENT0("rpc", "InboundCall::ParseFrom");
   RETURN_NOT_OK(serialization::ParseMessage(transfer->data(), &header_, &serialized_request_));
+  timing_.time_read_started = transfer->start_time();
 
   // Adopt the service/method info from the header as soon as it's available.
   if (PREDICT_FALSE(!header_.has_remote_method())) {
@@ -155,12 +171,13 @@ void InboundCall::ApplicationErrorToPB(int error_ext_id, const std::string& mess
 void InboundCall::Respond(const MessageLite& response,
                           bool is_success) {
   TRACE_EVENT_FLOW_END0("rpc", "InboundCall", this);
+  RecordHandlingCompleted();
   SerializeResponseBuffer(response, is_success);
 
   TRACE_EVENT_ASYNC_END1("rpc", "InboundCall", this,
                          "method", remote_method_.method_name());
   TRACE_TO(trace_, "Queueing $0 response", is_success ? "success" : "failure");
-  RecordHandlingCompleted();
+  RecordResponseQueued();
   conn_->rpcz_store()->AddCall(this);
   conn_->QueueResponseForCall(gscoped_ptr<InboundCall>(this));
 }
@@ -182,6 +199,7 @@ void InboundCall::SerializeResponseBuffer(const MessageLite& response,
   ResponseHeader resp_hdr;
   resp_hdr.set_call_id(header_.call_id());
   resp_hdr.set_is_error(!is_success);
+  MaybeCompressSidecars(&resp_hdr);
   int32_t sidecar_byte_size = 0;
   for (const unique_ptr<RpcSidecar>& car : outbound_sidecars_) {
     resp_hdr.add_sidecar_offsets(sidecar_byte_size + protobuf_msg_size);
@@ -197,6 +215,40 @@ void InboundCall::SerializeResponseBuffer(const MessageLite& response,
                                  &response_hdr_buf_);
 }
 
+void InboundCall::MaybeCompressSidecars(ResponseHeader* resp_hdr) {
+  const int64_t min_bytes = FLAGS_rpc_compress_sidecars_min_bytes;
+  if (min_bytes <= 0 || outbound_sidecars_.empty() ||
+      !ContainsKey(conn_->remote_features(), LZ4_SIDECAR_COMPRESSION)) {
+    return;
+  }
+  const CompressionCodec* codec;
+  CHECK_OK(GetCompressionCodec(LZ4, &codec));
+  bool compressed_any = false;
+  for (unique_ptr<RpcSidecar>& car : outbound_sidecars_) {
+    const Slice data = car->AsSlice();
+    uint32_t uncompressed_size = 0;
+    if (static_cast<int64_t>(data.size()) >= min_bytes) {
+      unique_ptr<faststring> buf(new faststring());
+      buf->resize(codec->MaxCompressedLength(data.size()));
+      size_t compressed_size;
+      Status s = codec->Compress(data, buf->data(), &compressed_size);
+      // Incompressible data is sent as is.
+      if (s.ok() && compressed_size < data.size()) {
+        uncompressed_size = data.size();
+        buf->resize(compressed_size);
+        car = RpcSidecar::FromFaststring(std::move(buf));
+        compressed_any = true;
+      }
+    }
+    resp_hdr->add_sidecar_uncompressed_sizes(uncompressed_size);
+  }
+  if (!compressed_any) {
+    resp_hdr->clear_sidecar_uncompressed_sizes();
+  } else {
+    TRACE("Compressed response sidecars");
+  }
+}
+
 size_t InboundCall::SerializeResponseTo(TransferPayload* slices) const {
   TRACE_EVENT0("rpc", "InboundCall::SerializeResponseTo");
   DCHECK_GT(response_hdr_buf_.size(), 0);
@@ -286,8 +338,15 @@ void InboundCall::RecordHandlingStarted(Histogram* incoming_queue_time) {
   DCHECK(incoming_queue_time != nullptr);
   DCHECK(!timing_.time_handled.Initialized());  // Protect against multiple calls.
   timing_.time_handled = MonoTime::Now();
-  incoming_queue_time->Increment(
-      (timing_.time_handled - timing_.time_received).ToMicroseconds());
+  const int64_t queue_time_us = (timing_.time_handled - timing_.time_received).ToMicroseconds();
+  incoming_queue_time->Increment(queue_time_us);
+  if (method_info_) {
+    method_info_->queue_time_histogram->Increment(queue_time_us);
+    if (timing_.time_read_started.Initialized()) {
+      method_info_->request_read_latency_histogram->Increment(
+          (timing_.time_received - timing_.time_read_started).ToMicroseconds());
+    }
+  }
 }
 
 void InboundCall::RecordHandlingCompleted() {
@@ -306,6 +365,24 @@ void InboundCall::RecordHandlingCompleted() {
   }
 }
 
+void InboundCall::RecordResponseQueued() {
+  DCHECK(!timing_.time_response_queued.Initialized());  // Protect against multiple calls.
+  timing_.time_response_queued = MonoTime::Now();
+
+  // Like the handler latency, only count the calls which were handled.
+  if (method_info_ && timing_.time_handled.Initialized()) {
+    method_info_->response_serialize_latency_histogram->Increment(
+        (timing_.time_response_queued - timing_.time_completed).ToMicroseconds());
+  }
+}
+
+void InboundCall::RecordResponseSent() {
+  if (method_info_ && timing_.time_handled.Initialized()) {
+    method_info_->response_write_latency_histogram->Increment(
+        (MonoTime::Now() - timing_.time_response_queued).ToMicroseconds());
+  }
+}
+
 bool InboundCall::ClientTimedOut() const {
   return MonoTime::Now() >= deadline_;
 }
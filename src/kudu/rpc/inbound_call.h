@@ -26,6 +26,7 @@
 #include <vector>
 
 #include <glog/logging.h>
+#include <google/protobuf/arena.h>
 
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
@@ -60,12 +61,15 @@ class RpcCallInProgressPB;
 class RpcSidecar;
 
 struct InboundCallTiming {
+  MonoTime time_read_started;  // Time the first byte of the call was read.
   MonoTime time_received;   // Time the call was first accepted.
   MonoTime time_handled;    // Time the call handler was kicked off.
   MonoTime time_completed;  // Time the call handler completed.
+  MonoTime time_response_queued;  // Time the response was serialized and queued.
 
+  // The time between accepting the call and queueing its response.
   MonoDelta TotalDuration() const {
-    return time_completed - time_received;
+    return time_response_queued - time_received;
   }
 };
 
@@ -153,6 +157,12 @@ class InboundCall {
     return header_;
   }
 
+  // Returns the arena which the protobufs of the call may be allocated on,
+  // and which is destroyed with the call.
+  google::protobuf::Arena* pb_arena() {
+    return &pb_arena_;
+  }
+
   // Associate this call with a particular method that will be invoked
   // by the service.
   void set_method_info(scoped_refptr<RpcMethodInfo> info) {
@@ -172,11 +182,17 @@ class InboundCall {
   void RecordCallReceived();
 
   // When RPC call Handle() was called on the server side.
-  // Updates the Histogram with time elapsed since the call was received,
-  // and should only be called once on a given instance.
+  // Updates the Histogram and the method's histograms with the time elapsed
+  // since the call was received, and the method's histogram with the time
+  // spent reading the call. Should only be called once on a given instance.
   // Not thread-safe. Should only be called by the current "owner" thread.
   void RecordHandlingStarted(Histogram* incoming_queue_time);
 
+  // When the last byte of the response was written to the connection.
+  // Updates the method's histogram with the time elapsed since the response
+  // was queued. Called by the reactor thread.
+  void RecordResponseSent();
+
   // Return true if the deadline set by the client has already elapsed.
   // In this case, the server may stop processing the call, since the
   // call response will be ignored anyway.
@@ -221,12 +237,22 @@ class InboundCall {
   void SerializeResponseBuffer(const google::protobuf::MessageLite& response,
                                bool is_success);
 
+  // If the client supports it, replaces the outbound sidecars of at least
+  // --rpc_compress_sidecars_min_bytes bytes by their LZ4 compression, when
+  // it is smaller. Records the uncompressed sizes in 'resp_hdr'.
+  void MaybeCompressSidecars(ResponseHeader* resp_hdr);
+
   // When RPC call Handle() completed execution on the server side.
   // Updates the Histogram with time elapsed since the call was started,
   // and should only be called once on a given instance.
   // Not thread-safe. Should only be called by the current "owner" thread.
   void RecordHandlingCompleted();
 
+  // When the response was serialized and is about to be queued.
+  // Updates the method's histogram with the time elapsed since the handler
+  // completed.
+  void RecordResponseQueued();
+
   // The connection on which this inbound call arrived.
   scoped_refptr<Connection> conn_;
 
@@ -277,6 +303,10 @@ class InboundCall {
   // client did not pass a timeout.
   MonoTime deadline_;
 
+  // The arena of the request and response protobufs of the methods with the
+  // 'pb_arena_rpc' option. See RpcMethodInfo::use_pb_arena.
+  google::protobuf::Arena pb_arena_;
+
   DISALLOW_COPY_AND_ASSIGN(InboundCall);
 };
 
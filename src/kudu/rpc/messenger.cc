@@ -17,6 +17,10 @@
 
 #include "kudu/rpc/messenger.h"
 
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
 #include <cstdlib>
 #include <functional>
 #include <mutex>
@@ -50,7 +54,9 @@
 #include "kudu/util/flags.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/net/dns_resolver.h"
 #include "kudu/util/net/socket.h"
+#include "kudu/util/os-util.h"
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/status.h"
 #include "kudu/util/thread_restrictions.h"
@@ -82,7 +88,8 @@ MessengerBuilder::MessengerBuilder(std::string name)
       rpc_tls_ciphers_(kudu::security::SecurityDefaults::kDefaultTlsCiphers),
       rpc_tls_min_protocol_(kudu::security::SecurityDefaults::kDefaultTlsMinVersion),
       enable_inbound_tls_(false),
-      reuseport_(false) {
+      reuseport_(false),
+      numa_aware_(false) {
 }
 
 MessengerBuilder& MessengerBuilder::set_connection_keepalive_time(const MonoDelta &keepalive) {
@@ -184,6 +191,11 @@ MessengerBuilder& MessengerBuilder::set_reuseport() {
   return *this;
 }
 
+MessengerBuilder& MessengerBuilder::set_numa_aware() {
+  numa_aware_ = true;
+  return *this;
+}
+
 Status MessengerBuilder::Build(shared_ptr<Messenger> *msgr) {
   // Initialize SASL library before we start making requests
   RETURN_NOT_OK(SaslInit(!keytab_file_.empty()));
@@ -304,6 +316,33 @@ void Messenger::ShutdownInternal(ShutdownMode mode) {
   }
 }
 
+namespace {
+
+// Removes the file of the UNIX domain socket at 'addr' if it is left over
+// from a previous process, since binding to it would fail otherwise.
+Status RemoveStaleUnixDomainSocket(const Sockaddr& addr) {
+  const string path = addr.UnixDomainPath();
+  if (path.empty() || path[0] == '@') {
+    // Abstract sockets are removed with their last reference.
+    return Status::OK();
+  }
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    return Status::OK();
+  }
+  if (!S_ISSOCK(st.st_mode)) {
+    return Status::AlreadyPresent("cannot listen on a UNIX domain socket path which is "
+                                  "not a socket", path);
+  }
+  if (unlink(path.c_str()) != 0) {
+    int err = errno;
+    return Status::IOError("cannot remove stale UNIX domain socket", path, err);
+  }
+  return Status::OK();
+}
+
+} // anonymous namespace
+
 Status Messenger::AddAcceptorPool(const Sockaddr &accept_addr,
                                   shared_ptr<AcceptorPool>* pool) {
   // Before listening, if we expect to require Kerberos, we want to verify
@@ -314,10 +353,14 @@ Status Messenger::AddAcceptorPool(const Sockaddr &accept_addr,
                           "GSSAPI/Kerberos not properly configured");
   }
 
+  if (accept_addr.is_unix()) {
+    RETURN_NOT_OK(RemoveStaleUnixDomainSocket(accept_addr));
+  }
+
   Socket sock;
-  RETURN_NOT_OK(sock.Init(0));
+  RETURN_NOT_OK(sock.Init(accept_addr.family(), 0));
   RETURN_NOT_OK(sock.SetReuseAddr(true));
-  if (reuseport_) {
+  if (reuseport_ && accept_addr.is_ip()) {
     RETURN_NOT_OK(sock.SetReusePort(true));
   }
   RETURN_NOT_OK(sock.Bind(accept_addr));
@@ -407,11 +450,13 @@ Messenger::Messenger(const MessengerBuilder &bld)
     tls_context_(new security::TlsContext(bld.rpc_tls_ciphers_, bld.rpc_tls_min_protocol_)),
     token_verifier_(new security::TokenVerifier()),
     rpcz_store_(new RpczStore()),
+    dns_resolver_(new DnsResolver()),
     metric_entity_(bld.metric_entity_),
     rpc_negotiation_timeout_ms_(bld.rpc_negotiation_timeout_ms_),
     sasl_proto_name_(bld.sasl_proto_name_),
     keytab_file_(bld.keytab_file_),
     reuseport_(bld.reuseport_),
+    numa_aware_(bld.numa_aware_),
     retain_self_(this) {
   for (int i = 0; i < bld.num_reactors_; i++) {
     reactors_.push_back(new Reactor(retain_self_, i, bld));
@@ -442,8 +487,23 @@ Reactor* Messenger::RemoteToReactor(const Sockaddr &remote) {
 
 Status Messenger::Init() {
   RETURN_NOT_OK(tls_context_->Init());
-  for (Reactor* r : reactors_) {
+  if (numa_aware_) {
+    Status s = GetNumaNodeCpus(&numa_node_cpus_);
+    if (!s.ok()) {
+      LOG(WARNING) << "Unable to get the NUMA topology, not pinning the RPC threads: "
+                   << s.ToString();
+      numa_node_cpus_.clear();
+    }
+  }
+  for (size_t i = 0; i < reactors_.size(); i++) {
+    Reactor* r = reactors_[i];
     RETURN_NOT_OK(r->Init());
+    if (!numa_node_cpus_.empty()) {
+      // The connections of a reactor stay on it, so their buffers stay local
+      // to the reactor's node.
+      WARN_NOT_OK(r->SetCpuAffinity(numa_node_cpus_[i % numa_node_cpus_.size()]),
+                  Substitute("Unable to pin reactor $0", r->name()));
+    }
   }
 
   return Status::OK();
@@ -46,6 +46,7 @@ class function;
 
 namespace kudu {
 
+class DnsResolver;
 class Socket;
 class ThreadPool;
 
@@ -166,6 +167,10 @@ class MessengerBuilder {
   // Configure the messenger to set the SO_REUSEPORT socket option.
   MessengerBuilder& set_reuseport();
 
+  // Configure the messenger to pin its reactor threads to the CPUs of the
+  // NUMA nodes of the machine, spreading them over the nodes.
+  MessengerBuilder& set_numa_aware();
+
   Status Build(std::shared_ptr<Messenger> *msgr);
 
  private:
@@ -189,6 +194,7 @@ class MessengerBuilder {
   std::string keytab_file_;
   bool enable_inbound_tls_;
   bool reuseport_;
+  bool numa_aware_;
 };
 
 // A Messenger is a container for the reactor threads which run event loops
@@ -301,8 +307,17 @@ class Messenger {
 
   RpczStore* rpcz_store() { return rpcz_store_.get(); }
 
+  // The caching DNS resolver shared by the users of this messenger.
+  DnsResolver* dns_resolver() { return dns_resolver_.get(); }
+
   int num_reactors() const { return reactors_.size(); }
 
+  // The CPUs of each NUMA node to which the threads of the messenger and of
+  // its service pools are pinned. Empty if the messenger isn't NUMA-aware.
+  const std::vector<std::vector<int>>& numa_node_cpus() const {
+    return numa_node_cpus_;
+  }
+
   const std::string& name() const {
     return name_;
   }
@@ -393,6 +408,8 @@ class Messenger {
 
   std::unique_ptr<RpczStore> rpcz_store_;
 
+  std::unique_ptr<DnsResolver> dns_resolver_;
+
   scoped_refptr<MetricEntity> metric_entity_;
 
   // Timeout in milliseconds after which an incomplete connection negotiation will timeout.
@@ -407,6 +424,10 @@ class Messenger {
   // Whether to set SO_REUSEPORT on the listening sockets.
   bool reuseport_;
 
+  // See numa_node_cpus(). Set by Init().
+  const bool numa_aware_;
+  std::vector<std::vector<int>> numa_node_cpus_;
+
   // The ownership of the Messenger object is somewhat subtle. The pointer graph
   // looks like this:
   //
@@ -72,6 +72,12 @@ DEFINE_bool(rpc_encrypt_loopback_connections, false,
             "an attacker.");
 TAG_FLAG(rpc_encrypt_loopback_connections, advanced);
 
+DEFINE_bool(rpc_compress_loopback_sidecars, false,
+            "Whether clients accept compressed response sidecars on RPC "
+            "connections that stay within a single host. Only useful for tests.");
+TAG_FLAG(rpc_compress_loopback_sidecars, hidden);
+TAG_FLAG(rpc_compress_loopback_sidecars, unsafe);
+
 using std::string;
 using std::unique_ptr;
 using strings::Substitute;
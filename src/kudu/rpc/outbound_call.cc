@@ -40,6 +40,8 @@
 #include "kudu/rpc/rpc_sidecar.h"
 #include "kudu/rpc/serialization.h"
 #include "kudu/rpc/transfer.h"
+#include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/kernel_stack_watchdog.h"
 #include "kudu/util/net/sockaddr.h"
@@ -508,6 +510,36 @@ Status CallResponse::GetSidecar(int idx, Slice* sidecar) const {
   return Status::OK();
 }
 
+Status CallResponse::DecompressSidecars() {
+  const auto& sizes = header_.sidecar_uncompressed_sizes();
+  if (sizes.size() != header_.sidecar_offsets_size()) {
+    return Status::Corruption(strings::Substitute(
+        "Received $0 uncompressed sidecar sizes for $1 sidecars",
+        sizes.size(), header_.sidecar_offsets_size()));
+  }
+  const CompressionCodec* codec;
+  RETURN_NOT_OK(GetCompressionCodec(LZ4, &codec));
+  int64_t total_size = 0;
+  for (int i = 0; i < sizes.size(); i++) {
+    const uint32_t size = sizes.Get(i);
+    if (size == 0) {
+      continue;
+    }
+    total_size += size;
+    if (total_size > TransferLimits::kMaxTotalSidecarBytes) {
+      return Status::Corruption(strings::Substitute(
+          "Received compressed sidecars of $0 bytes or more, expected at most $1",
+          total_size, TransferLimits::kMaxTotalSidecarBytes));
+    }
+    unique_ptr<uint8_t[]> buf(new uint8_t[size]);
+    RETURN_NOT_OK_PREPEND(codec->Uncompress(sidecar_slices_[i], buf.get(), size),
+                          strings::Substitute("unable to decompress sidecar $0", i));
+    sidecar_slices_[i] = Slice(buf.get(), size);
+    decompressed_sidecars_.emplace_back(std::move(buf));
+  }
+  return Status::OK();
+}
+
 Status CallResponse::ParseFrom(gscoped_ptr<InboundTransfer> transfer) {
   CHECK(!parsed_);
   RETURN_NOT_OK(serialization::ParseMessage(transfer->data(), &header_,
@@ -516,6 +548,9 @@ Status CallResponse::ParseFrom(gscoped_ptr<InboundTransfer> transfer) {
   // Use information from header to extract the payload slices.
   RETURN_NOT_OK(RpcSidecar::ParseSidecars(header_.sidecar_offsets(),
           serialized_response_, sidecar_slices_));
+  if (header_.sidecar_uncompressed_sizes_size() > 0) {
+    RETURN_NOT_OK(DecompressSidecars());
+  }
 
   if (header_.sidecar_offsets_size() > 0) {
     serialized_response_ =
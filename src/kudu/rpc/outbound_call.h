@@ -322,6 +322,10 @@ class CallResponse {
   Status GetSidecar(int idx, Slice* sidecar) const;
 
  private:
+  // Decompresses the sidecars which the server compressed, replacing their
+  // slices in 'sidecar_slices_'.
+  Status DecompressSidecars();
+
   // True once ParseFrom() is called.
   bool parsed_;
 
@@ -332,9 +336,13 @@ class CallResponse {
   // This slice refers to memory allocated by transfer_
   Slice serialized_response_;
 
-  // Slices of data for rpc sidecars. They point into memory owned by transfer_.
+  // Slices of data for rpc sidecars. They point into memory owned by transfer_,
+  // or by decompressed_sidecars_ for the sidecars which were compressed.
   Slice sidecar_slices_[TransferLimits::kMaxSidecars];
 
+  // The buffers holding the decompressed sidecars.
+  std::vector<std::unique_ptr<uint8_t[]>> decompressed_sidecars_;
+
   // The incoming transfer data - retained because serialized_response_
   // and sidecar_slices_ refer into its data.
   gscoped_ptr<InboundTransfer> transfer_;
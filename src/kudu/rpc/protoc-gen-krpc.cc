@@ -207,6 +207,10 @@ class MethodSubstitutions : public Substituter {
     (*map)["metric_enum_key"] = strings::Substitute("kMetricIndex$0", method_->name());
     bool track_result = static_cast<bool>(method_->options().GetExtension(track_rpc_result));
     (*map)["track_result"] = track_result ? " true" : "false";
+    bool high_priority = static_cast<bool>(method_->options().GetExtension(high_priority_rpc));
+    (*map)["high_priority"] = high_priority ? "true" : "false";
+    bool use_pb_arena = static_cast<bool>(method_->options().GetExtension(pb_arena_rpc));
+    (*map)["use_pb_arena"] = use_pb_arena ? "true" : "false";
     (*map)["authz_method"] = GetAuthzMethod(*method_).get_value_or("AuthorizeAllowAll");
   }
 
@@ -468,6 +472,34 @@ class CodeGenerator : public ::google::protobuf::compiler::CodeGenerator {
           "  \"$rpc_full_name$ RPC Time\",\n"
           "  kudu::MetricUnit::kMicroseconds,\n"
           "  \"Microseconds spent handling $rpc_full_name$() RPC requests\",\n"
+          "  60000000LU, 2, kudu::STRIPED);\n"
+          "\n"
+          "METRIC_DEFINE_histogram(server, request_read_latency_$rpc_full_name_plainchars$,\n"
+          "  \"$rpc_full_name$ RPC Request Read Time\",\n"
+          "  kudu::MetricUnit::kMicroseconds,\n"
+          "  \"Microseconds spent by the reactor threads reading $rpc_full_name$() RPC \"\n"
+          "  \"requests from the network, from their first to their last byte\",\n"
+          "  60000000LU, 2);\n"
+          "\n"
+          "METRIC_DEFINE_histogram(server, queue_time_$rpc_full_name_plainchars$,\n"
+          "  \"$rpc_full_name$ RPC Queue Time\",\n"
+          "  kudu::MetricUnit::kMicroseconds,\n"
+          "  \"Microseconds spent by $rpc_full_name$() RPC requests in the service queue \"\n"
+          "  \"before being handled\",\n"
+          "  60000000LU, 2, kudu::STRIPED);\n"
+          "\n"
+          "METRIC_DEFINE_histogram(server, response_serialize_latency_$rpc_full_name_plainchars$,\n"
+          "  \"$rpc_full_name$ RPC Response Serialization Time\",\n"
+          "  kudu::MetricUnit::kMicroseconds,\n"
+          "  \"Microseconds spent serializing the responses of $rpc_full_name$() RPC \"\n"
+          "  \"requests\",\n"
+          "  60000000LU, 2);\n"
+          "\n"
+          "METRIC_DEFINE_histogram(server, response_write_latency_$rpc_full_name_plainchars$,\n"
+          "  \"$rpc_full_name$ RPC Response Write Time\",\n"
+          "  kudu::MetricUnit::kMicroseconds,\n"
+          "  \"Microseconds between queueing the responses of $rpc_full_name$() RPC \"\n"
+          "  \"requests and the reactor threads writing their last byte to the network\",\n"
           "  60000000LU, 2);\n"
           "\n");
         subs->Pop();
@@ -514,8 +546,20 @@ class CodeGenerator : public ::google::protobuf::compiler::CodeGenerator {
               "                           ctx);\n"
               "    };\n"
               "    mi->track_result = $track_result$;\n"
+              "    mi->high_priority = $high_priority$;\n"
+              "    mi->use_pb_arena = $use_pb_arena$;\n"
               "    mi->handler_latency_histogram =\n"
               "        METRIC_handler_latency_$rpc_full_name_plainchars$.Instantiate(entity);\n"
+              "    mi->request_read_latency_histogram =\n"
+              "        METRIC_request_read_latency_$rpc_full_name_plainchars$.Instantiate(entity);\n"
+              "    mi->queue_time_histogram =\n"
+              "        METRIC_queue_time_$rpc_full_name_plainchars$.Instantiate(entity);\n"
+              "    mi->response_serialize_latency_histogram =\n"
+              "        METRIC_response_serialize_latency_$rpc_full_name_plainchars$.Instantiate(\n"
+              "            entity);\n"
+              "    mi->response_write_latency_histogram =\n"
+              "        METRIC_response_write_latency_$rpc_full_name_plainchars$.Instantiate(\n"
+              "            entity);\n"
               "    mi->func = [this](const Message* req, Message* resp, RpcContext* ctx) {\n"
               "      this->$rpc_name$(static_cast<const $request$*>(req),\n"
               "                       static_cast<$response$*>(resp),\n"
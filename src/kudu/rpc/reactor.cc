@@ -23,6 +23,7 @@
 #include <ostream>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <boost/bind.hpp> // IWYU pragma: keep
 #include <boost/intrusive/list.hpp>
@@ -42,6 +43,7 @@
 #include "kudu/rpc/outbound_call.h"
 #include "kudu/rpc/rpc_introspection.pb.h"
 #include "kudu/rpc/server_negotiation.h"
+#include "kudu/util/async_logger.h"
 #include "kudu/util/countdown_latch.h"
 #include "kudu/util/debug/sanitizer_scopes.h"
 #include "kudu/util/flag_tags.h"
@@ -49,6 +51,7 @@
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/net/socket.h"
+#include "kudu/util/os-util.h"
 #include "kudu/util/status.h"
 #include "kudu/util/thread.h"
 #include "kudu/util/thread_restrictions.h"
@@ -67,6 +70,7 @@ static const int kDefaultLibEvFlags = ev::AUTO;
 using std::string;
 using std::shared_ptr;
 using std::unique_ptr;
+using std::vector;
 using strings::Substitute;
 
 DEFINE_bool(rpc_reopen_outbound_connections, false,
@@ -80,6 +84,16 @@ DEFINE_bool(rpc_reopen_outbound_connections, false,
 TAG_FLAG(rpc_reopen_outbound_connections, unsafe);
 TAG_FLAG(rpc_reopen_outbound_connections, runtime);
 
+DEFINE_int32(rpc_reactor_max_log_messages_per_sec, 100,
+             "The maximum rate of the messages logged by each reactor thread "
+             "to the asynchronous log, beyond which they're dropped and "
+             "counted, so that bursts of logging don't delay the network I/O. "
+             "The ERROR and FATAL messages are never dropped. 0 disables the "
+             "limit. Only relevant when --log_async is enabled.");
+TAG_FLAG(rpc_reactor_max_log_messages_per_sec, advanced);
+DEFINE_validator(rpc_reactor_max_log_messages_per_sec,
+                 [](const char* /*flagname*/, int32_t value) { return value >= 0; });
+
 METRIC_DEFINE_histogram(server, reactor_load_percent,
                         "Reactor Thread Load Percentage",
                         kudu::MetricUnit::kUnits,
@@ -168,6 +182,11 @@ Status ReactorThread::Init() {
   return kudu::Thread::Create("reactor", "rpc reactor", &ReactorThread::RunThread, this, &thread_);
 }
 
+Status ReactorThread::SetCpuAffinity(const vector<int>& cpus) {
+  DCHECK(thread_) << "Not started";
+  return SetThreadCpuAffinity(thread_->tid(), cpus);
+}
+
 void ReactorThread::InvokePendingCb(struct ev_loop* loop) {
   // Calculate the number of cycles spent calling our callbacks.
   // This is called quite frequently so we use CycleClock rather than MonoTime
@@ -473,6 +492,7 @@ bool ReactorThread::IsCurrentThread() const {
 void ReactorThread::RunThread() {
   ThreadRestrictions::SetWaitAllowed(false);
   ThreadRestrictions::SetIOAllowed(false);
+  AsyncLogger::RateLimitCurrentThread(FLAGS_rpc_reactor_max_log_messages_per_sec);
   DVLOG(6) << "Calling ReactorThread::RunThread()...";
   loop_.run(0);
   VLOG(1) << name() << " thread exiting.";
@@ -544,7 +564,7 @@ Status ReactorThread::FindOrStartConnection(const ConnectionId& conn_id,
 
   // Create a new socket and start connecting to the remote.
   Socket sock;
-  RETURN_NOT_OK(CreateClientSocket(&sock));
+  RETURN_NOT_OK(CreateClientSocket(conn_id.remote().family(), &sock));
   RETURN_NOT_OK(StartConnect(&sock, conn_id.remote()));
 
   unique_ptr<Socket> new_socket(new Socket(sock.Release()));
@@ -612,9 +632,9 @@ void ReactorThread::CompleteConnectionNegotiation(
   conn->EpollRegister(loop_);
 }
 
-Status ReactorThread::CreateClientSocket(Socket *sock) {
-  Status ret = sock->Init(Socket::FLAG_NONBLOCKING);
-  if (ret.ok()) {
+Status ReactorThread::CreateClientSocket(int family, Socket* sock) {
+  Status ret = sock->Init(family, Socket::FLAG_NONBLOCKING);
+  if (ret.ok() && family != AF_UNIX) {
     ret = sock->SetNoDelay(true);
   }
   LOG_IF(WARNING, !ret.ok())
@@ -728,6 +748,10 @@ Status Reactor::Init() {
   return thread_.Init();
 }
 
+Status Reactor::SetCpuAffinity(const vector<int>& cpus) {
+  return thread_.SetCpuAffinity(cpus);
+}
+
 void Reactor::Shutdown(Messenger::ShutdownMode mode) {
   {
     std::lock_guard<LockType> l(lock_);
@@ -22,6 +22,7 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <boost/function.hpp> // IWYU pragma: keep
 #include <boost/intrusive/list.hpp>
@@ -148,6 +149,9 @@ class ReactorThread {
   // This may be called from another thread.
   Status Init();
 
+  // Restricts the thread to run on 'cpus'. Must be called after Init().
+  Status SetCpuAffinity(const std::vector<int>& cpus);
+
   // Add any connections on this reactor thread into the given status dump.
   Status DumpConnections(const DumpConnectionsRequestPB& req,
                          DumpConnectionsResponsePB* resp);
@@ -248,8 +252,9 @@ class ReactorThread {
   // is skipped.
   void ScanIdleConnections();
 
-  // Create a new client socket (non-blocking, NODELAY)
-  static Status CreateClientSocket(Socket *sock);
+  // Create a new client socket of the given address family (non-blocking,
+  // NODELAY for TCP sockets)
+  static Status CreateClientSocket(int family, Socket* sock);
 
   // Initiate a new connection on the given socket.
   static Status StartConnect(Socket *sock, const Sockaddr &remote);
@@ -344,6 +349,9 @@ class Reactor {
           const MessengerBuilder &bld);
   Status Init();
 
+  // Restricts the reactor thread to run on 'cpus'. Must be called after Init().
+  Status SetCpuAffinity(const std::vector<int>& cpus);
+
   // Shuts down the reactor and its corresponding thread, optionally waiting
   // until the thread has exited.
   void Shutdown(Messenger::ShutdownMode mode);
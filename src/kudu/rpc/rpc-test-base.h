@@ -128,6 +128,18 @@ class GenericCalculatorService : public ServiceIf {
   std::string service_name() const override { return kFullServiceName; }
   static std::string static_service_name() { return kFullServiceName; }
 
+  // Fills 'str' with 'size' random bytes or, if 'compressible' is true, with
+  // a short random pattern repeated up to 'size' bytes.
+  static void FillString(size_t size, bool compressible, Random* r, faststring* str) {
+    const size_t kPatternSize = 64;
+    str->resize(size);
+    size_t random_size = compressible ? std::min(size, kPatternSize) : size;
+    RandomString(str->data(), random_size, r);
+    for (size_t i = random_size; i < size; i++) {
+      str->data()[i] = str->data()[i % random_size];
+    }
+  }
+
  private:
   void DoAdd(InboundCall *incoming) {
     Slice param(incoming->serialized_request());
@@ -152,11 +164,8 @@ class GenericCalculatorService : public ServiceIf {
     std::unique_ptr<faststring> second(new faststring);
 
     Random r(req.random_seed());
-    first->resize(req.size1());
-    RandomString(first->data(), req.size1(), &r);
-
-    second->resize(req.size2());
-    RandomString(second->data(), req.size2(), &r);
+    FillString(req.size1(), req.compressible(), &r, first.get());
+    FillString(req.size2(), req.compressible(), &r, second.get());
 
     SendTwoStringsResponsePB resp;
     int idx1, idx2;
@@ -477,13 +486,14 @@ class RpcTestBase : public KuduTest {
     return Status::OK();
   }
 
-  void DoTestSidecar(const Proxy &p, int size1, int size2) {
+  void DoTestSidecar(const Proxy &p, int size1, int size2, bool compressible = false) {
     const uint32_t kSeed = 12345;
 
     SendTwoStringsRequestPB req;
     req.set_size1(size1);
     req.set_size2(size2);
     req.set_random_seed(kSeed);
+    req.set_compressible(compressible);
 
     SendTwoStringsResponsePB resp;
     RpcController controller;
@@ -496,12 +506,10 @@ class RpcTestBase : public KuduTest {
     Random rng(kSeed);
     faststring expected;
 
-    expected.resize(size1);
-    RandomString(expected.data(), size1, &rng);
+    GenericCalculatorService::FillString(size1, compressible, &rng, &expected);
     CHECK_EQ(0, first.compare(Slice(expected)));
 
-    expected.resize(size2);
-    RandomString(expected.data(), size2, &rng);
+    GenericCalculatorService::FillString(size2, compressible, &rng, &expected);
     CHECK_EQ(0, second.compare(Slice(expected)));
   }
 
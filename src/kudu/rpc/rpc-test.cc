@@ -68,10 +68,20 @@
 #include "kudu/util/thread.h"
 
 METRIC_DECLARE_histogram(handler_latency_kudu_rpc_test_CalculatorService_Sleep);
+METRIC_DECLARE_histogram(queue_time_kudu_rpc_test_CalculatorService_Sleep);
+METRIC_DECLARE_histogram(request_read_latency_kudu_rpc_test_CalculatorService_Sleep);
+METRIC_DECLARE_histogram(response_serialize_latency_kudu_rpc_test_CalculatorService_Sleep);
+METRIC_DECLARE_histogram(response_write_latency_kudu_rpc_test_CalculatorService_Sleep);
 METRIC_DECLARE_histogram(rpc_incoming_queue_time);
 
+DECLARE_bool(rpc_compress_loopback_sidecars);
 DECLARE_bool(rpc_reopen_outbound_connections);
+DECLARE_int32(rpc_max_outbound_transfers_per_write);
+DECLARE_int32(rpc_outbound_coalesce_delay_us);
+DECLARE_int64(rpc_outbound_coalesce_bytes);
+DECLARE_int32(rpc_read_ahead_bytes);
 DECLARE_int32(rpc_negotiation_inject_delay_ms);
+DECLARE_int64(rpc_compress_sidecars_min_bytes);
 
 using std::shared_ptr;
 using std::string;
@@ -162,6 +172,32 @@ TEST_P(TestRpc, TestNegotiationDeadlock) {
   ASSERT_OK(DoTestSyncCall(p, GenericCalculatorService::kAddMethodName));
 }
 
+// Test making RPC calls to a messenger whose threads are pinned to the CPUs
+// of the NUMA nodes.
+TEST_P(TestRpc, TestNumaAwareMessenger) {
+  bool enable_ssl = GetParam();
+  MessengerBuilder mb("TestRpc.TestNumaAwareMessenger");
+  mb.set_num_reactors(3)
+      .set_numa_aware()
+      .set_metric_entity(metric_entity_);
+  if (enable_ssl) mb.enable_inbound_tls();
+  shared_ptr<Messenger> messenger;
+  ASSERT_OK(mb.Build(&messenger));
+#if defined(__linux__)
+  ASSERT_FALSE(messenger->numa_node_cpus().empty());
+#endif
+
+  Sockaddr server_addr;
+  ASSERT_OK(StartTestServerWithCustomMessenger(&server_addr, messenger, enable_ssl));
+  shared_ptr<Messenger> client_messenger;
+  ASSERT_OK(CreateMessenger("Client", &client_messenger, 1, enable_ssl));
+  Proxy p(client_messenger, server_addr, server_addr.host(),
+          GenericCalculatorService::static_service_name());
+  for (int i = 0; i < 10; i++) {
+    ASSERT_OK(DoTestSyncCall(p, GenericCalculatorService::kAddMethodName));
+  }
+}
+
 // Test making successful RPC calls.
 TEST_P(TestRpc, TestCall) {
   // Set up server.
@@ -184,6 +220,34 @@ TEST_P(TestRpc, TestCall) {
   }
 }
 
+// Test making RPC calls over a UNIX domain socket accepted by the same
+// messenger as the TCP socket.
+TEST_P(TestRpc, TestCallOverUnixDomainSocket) {
+  Sockaddr tcp_addr;
+  bool enable_ssl = GetParam();
+  ASSERT_OK(StartTestServer(&tcp_addr, enable_ssl));
+
+  const string path = GetTestPath("rpc.sock");
+  Sockaddr uds_addr;
+  ASSERT_OK(uds_addr.ParseUnixDomainPath(path));
+  shared_ptr<AcceptorPool> pool;
+  ASSERT_OK(server_messenger_->AddAcceptorPool(uds_addr, &pool));
+  ASSERT_OK(pool->Start(1));
+  ASSERT_TRUE(Env::Default()->FileExists(path));
+
+  shared_ptr<Messenger> client_messenger;
+  ASSERT_OK(CreateMessenger("Client", &client_messenger, 1, enable_ssl));
+  Proxy p(client_messenger, uds_addr, "localhost",
+          GenericCalculatorService::static_service_name());
+  for (int i = 0; i < 10; i++) {
+    ASSERT_OK(DoTestSyncCall(p, GenericCalculatorService::kAddMethodName));
+  }
+
+  // The socket file is removed once the pool is shut down.
+  pool->Shutdown();
+  ASSERT_FALSE(Env::Default()->FileExists(path));
+}
+
 // Test for KUDU-2091 and KUDU-2220.
 TEST_P(TestRpc, TestCallWithChainCertAndChainCA) {
   bool enable_ssl = GetParam();
@@ -809,6 +873,32 @@ TEST_P(TestRpc, TestRpcSidecar) {
   DoTestOutgoingSidecarExpectOK(p, 3000 * 1024, 2000 * 1024);
 }
 
+// Test that the large sidecars of responses are compressed and decompressed
+// intact, and that incompressible ones are sent as is.
+TEST_P(TestRpc, TestCompressedRpcSidecars) {
+  FLAGS_rpc_compress_sidecars_min_bytes = 1024;
+  FLAGS_rpc_compress_loopback_sidecars = true;
+
+  // Set up server.
+  Sockaddr server_addr;
+  bool enable_ssl = GetParam();
+  ASSERT_OK(StartTestServer(&server_addr, enable_ssl));
+
+  // Set up client.
+  shared_ptr<Messenger> client_messenger;
+  ASSERT_OK(CreateMessenger("Client", &client_messenger, 1, enable_ssl));
+  Proxy p(client_messenger, server_addr, server_addr.host(),
+          GenericCalculatorService::static_service_name());
+
+  for (bool compressible : { true, false }) {
+    SCOPED_TRACE(compressible ? "compressible" : "incompressible");
+    DoTestSidecar(p, 0, 0, compressible);
+    // Only the second sidecar is large enough to be compressed.
+    DoTestSidecar(p, 123, 4567, compressible);
+    DoTestSidecar(p, 3000 * 1024, 2000 * 1024, compressible);
+  }
+}
+
 TEST_P(TestRpc, TestRpcSidecarLimits) {
   {
     // Test that the limits on the number of sidecars is respected.
@@ -1120,6 +1210,46 @@ TEST_P(TestRpc, TestRpcHandlerLatencyMetric) {
   ASSERT_TRUE(FindOrDie(metric_map, &METRIC_rpc_incoming_queue_time));
 }
 
+// Test that each phase of a call is recorded in the histograms of its method.
+TEST_P(TestRpc, TestRpcPhaseLatencyMetrics) {
+  Sockaddr server_addr;
+  bool enable_ssl = GetParam();
+  ASSERT_OK(StartTestServerWithGeneratedCode(&server_addr, enable_ssl));
+
+  shared_ptr<Messenger> client_messenger;
+  ASSERT_OK(CreateMessenger("Client", &client_messenger, 1, enable_ssl));
+  Proxy p(client_messenger, server_addr, server_addr.host(),
+          CalculatorService::static_service_name());
+
+  const int kNumCalls = 3;
+  for (int i = 0; i < kNumCalls; i++) {
+    RpcController controller;
+    SleepRequestPB req;
+    req.set_sleep_micros(1000);
+    SleepResponsePB resp;
+    ASSERT_OK(p.SyncRequest("Sleep", req, &resp, &controller));
+  }
+
+  const auto metric_map = server_messenger_->metric_entity()->UnsafeMetricsMapForTests();
+  const auto get_histogram = [&](const HistogramPrototype& prototype) {
+    return down_cast<Histogram*>(FindOrDie(metric_map, &prototype).get());
+  };
+  for (const HistogramPrototype* prototype : {
+         &METRIC_request_read_latency_kudu_rpc_test_CalculatorService_Sleep,
+         &METRIC_queue_time_kudu_rpc_test_CalculatorService_Sleep,
+         &METRIC_handler_latency_kudu_rpc_test_CalculatorService_Sleep,
+         &METRIC_response_serialize_latency_kudu_rpc_test_CalculatorService_Sleep }) {
+    SCOPED_TRACE(prototype->name());
+    ASSERT_EQ(kNumCalls, get_histogram(*prototype)->TotalCount());
+  }
+  // The response of the last call may be received by the client before the
+  // server's reactor notices that it was written.
+  ASSERT_EVENTUALLY([&]() {
+    ASSERT_EQ(kNumCalls, get_histogram(
+        METRIC_response_write_latency_kudu_rpc_test_CalculatorService_Sleep)->TotalCount());
+  });
+}
+
 static void DestroyMessengerCallback(shared_ptr<Messenger>* messenger,
                                      CountDownLatch* latch) {
   messenger->reset();
@@ -1445,5 +1575,117 @@ TEST_P(TestRpc, TestCancellationMultiThreads) {
   client_messenger->Shutdown();
 }
 
+// Sends many concurrent calls on a single connection, so that the queued
+// outbound transfers are written in batches, and checks their results.
+TEST_P(TestRpc, TestConcurrentCallsBatchedWrites) {
+  const int kNumCalls = 500;
+  Sockaddr server_addr;
+  bool enable_ssl = GetParam();
+  ASSERT_OK(StartTestServer(&server_addr, enable_ssl));
+  shared_ptr<Messenger> client_messenger;
+  ASSERT_OK(CreateMessenger("Client", &client_messenger, 1, enable_ssl));
+  Proxy p(client_messenger, server_addr, server_addr.host(),
+          GenericCalculatorService::static_service_name());
+
+  for (int max_transfers : { 1, 4, 64 }) {
+    SCOPED_TRACE(max_transfers);
+    FLAGS_rpc_max_outbound_transfers_per_write = max_transfers;
+    vector<AddRequestPB> reqs(kNumCalls);
+    vector<AddResponsePB> resps(kNumCalls);
+    vector<RpcController> controllers(kNumCalls);
+    CountDownLatch latch(kNumCalls);
+    for (int i = 0; i < kNumCalls; i++) {
+      reqs[i].set_x(i);
+      reqs[i].set_y(2 * i);
+      controllers[i].set_timeout(MonoDelta::FromSeconds(10));
+      p.AsyncRequest(GenericCalculatorService::kAddMethodName, reqs[i], &resps[i],
+                     &controllers[i],
+                     boost::bind(&CountDownLatch::CountDown, boost::ref(latch)));
+    }
+    latch.Wait();
+    for (int i = 0; i < kNumCalls; i++) {
+      ASSERT_OK(controllers[i].status());
+      ASSERT_EQ(3 * i, resps[i].result());
+    }
+  }
+  client_messenger->Shutdown();
+}
+
+// Sends many concurrent calls on a single connection while the outbound
+// transfers are held for coalescing, with byte caps making them be written
+// right away, in several batches, or after the delay.
+TEST_P(TestRpc, TestConcurrentCallsCoalescedWrites) {
+  const int kNumCalls = 200;
+  Sockaddr server_addr;
+  bool enable_ssl = GetParam();
+  ASSERT_OK(StartTestServer(&server_addr, enable_ssl));
+  shared_ptr<Messenger> client_messenger;
+  ASSERT_OK(CreateMessenger("Client", &client_messenger, 1, enable_ssl));
+  Proxy p(client_messenger, server_addr, server_addr.host(),
+          GenericCalculatorService::static_service_name());
+
+  FLAGS_rpc_outbound_coalesce_delay_us = 2000;
+  for (int64_t max_bytes : { 1, 1024, 1024 * 1024 }) {
+    SCOPED_TRACE(max_bytes);
+    FLAGS_rpc_outbound_coalesce_bytes = max_bytes;
+    vector<AddRequestPB> reqs(kNumCalls);
+    vector<AddResponsePB> resps(kNumCalls);
+    vector<RpcController> controllers(kNumCalls);
+    CountDownLatch latch(kNumCalls);
+    for (int i = 0; i < kNumCalls; i++) {
+      reqs[i].set_x(i);
+      reqs[i].set_y(2 * i);
+      controllers[i].set_timeout(MonoDelta::FromSeconds(10));
+      p.AsyncRequest(GenericCalculatorService::kAddMethodName, reqs[i], &resps[i],
+                     &controllers[i],
+                     boost::bind(&CountDownLatch::CountDown, boost::ref(latch)));
+    }
+    latch.Wait();
+    for (int i = 0; i < kNumCalls; i++) {
+      ASSERT_OK(controllers[i].status());
+      ASSERT_EQ(3 * i, resps[i].result());
+    }
+  }
+  client_messenger->Shutdown();
+}
+
+// Sends many concurrent calls, written together, on connections reading
+// ahead fewer bytes than a call, a few calls at a time, or not at all.
+TEST_P(TestRpc, TestConcurrentCallsReadAhead) {
+  const int kNumCalls = 200;
+  Sockaddr server_addr;
+  bool enable_ssl = GetParam();
+  ASSERT_OK(StartTestServer(&server_addr, enable_ssl));
+
+  FLAGS_rpc_outbound_coalesce_delay_us = 2000;
+  for (int32_t read_ahead_bytes : { 0, 5, 1024, 16 * 1024 }) {
+    SCOPED_TRACE(read_ahead_bytes);
+    // The flag is read when the connections are created.
+    FLAGS_rpc_read_ahead_bytes = read_ahead_bytes;
+    shared_ptr<Messenger> client_messenger;
+    ASSERT_OK(CreateMessenger("Client", &client_messenger, 1, enable_ssl));
+    Proxy p(client_messenger, server_addr, server_addr.host(),
+            GenericCalculatorService::static_service_name());
+    vector<AddRequestPB> reqs(kNumCalls);
+    vector<AddResponsePB> resps(kNumCalls);
+    vector<RpcController> controllers(kNumCalls);
+    CountDownLatch latch(kNumCalls);
+    for (int i = 0; i < kNumCalls; i++) {
+      reqs[i].set_x(i);
+      reqs[i].set_y(2 * i);
+      controllers[i].set_timeout(MonoDelta::FromSeconds(10));
+      p.AsyncRequest(GenericCalculatorService::kAddMethodName, reqs[i], &resps[i],
+                     &controllers[i],
+                     boost::bind(&CountDownLatch::CountDown, boost::ref(latch)));
+    }
+    latch.Wait();
+    for (int i = 0; i < kNumCalls; i++) {
+      ASSERT_OK(controllers[i].status());
+      ASSERT_EQ(3 * i, resps[i].result());
+    }
+    client_messenger->Shutdown();
+  }
+}
+
 } // namespace rpc
 } // namespace kudu
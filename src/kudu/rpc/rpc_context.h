@@ -67,9 +67,13 @@ class RpcContext {
  public:
   // Create an RpcContext. This is called only from generated code
   // and is not a public API.
+  //
+  // The context takes ownership of the protobufs, unless 'pbs_on_arena' is
+  // true, in which case they're allocated on the arena of 'call'.
   RpcContext(InboundCall *call,
              const google::protobuf::Message *request_pb,
-             google::protobuf::Message *response_pb);
+             google::protobuf::Message *response_pb,
+             bool pbs_on_arena = false);
 
   ~RpcContext();
 
@@ -202,8 +206,8 @@ class RpcContext {
   // Return the name of the RPC service being called.
   std::string service_name() const;
 
-  const google::protobuf::Message *request_pb() const { return request_pb_.get(); }
-  google::protobuf::Message *response_pb() const { return response_pb_.get(); }
+  const google::protobuf::Message *request_pb() const { return request_pb_; }
+  google::protobuf::Message *response_pb() const { return response_pb_; }
 
   // Return an upper bound on the client timeout deadline. This does not
   // account for transmission delays between the client and the server.
@@ -241,8 +245,11 @@ class RpcContext {
  private:
   friend class ResultTracker;
   InboundCall* const call_;
-  const gscoped_ptr<const google::protobuf::Message> request_pb_;
-  const gscoped_ptr<google::protobuf::Message> response_pb_;
+  const google::protobuf::Message* const request_pb_;
+  google::protobuf::Message* const response_pb_;
+  // Whether 'request_pb_' and 'response_pb_' are allocated on the arena of
+  // the call rather than owned by this object.
+  const bool pbs_on_arena_;
   scoped_refptr<ResultTracker> result_tracker_;
 };
 
@@ -669,6 +669,9 @@ TEST_F(RpcStubTest, TestDumpSampledCalls) {
                       "    }");
   ASSERT_STR_CONTAINS(SecureDebugString(sampled_rpcs), "SleepRequestPB");
   ASSERT_STR_CONTAINS(SecureDebugString(sampled_rpcs), "duration_ms");
+  ASSERT_STR_CONTAINS(SecureDebugString(sampled_rpcs), "queue_micros");
+  ASSERT_STR_CONTAINS(SecureDebugString(sampled_rpcs), "handler_micros");
+  ASSERT_STR_CONTAINS(SecureDebugString(sampled_rpcs), "serialize_micros");
 }
 
 namespace {
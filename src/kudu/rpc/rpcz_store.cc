@@ -44,6 +44,7 @@
 #include "kudu/util/monotime.h"
 #include "kudu/util/trace.h"
 #include "kudu/util/trace_metrics.h"
+#include "kudu/util/trace_ring.h"
 
 DEFINE_bool(rpc_dump_all_traces, false,
             "If true, dump all RPC traces at INFO level");
@@ -95,11 +96,15 @@ class MethodSampler {
                               const string& child_path,
                               RpczSamplePB* sample_pb);
 
+  // Sets the durations of the phases of a sampled call in 'sample_pb'.
+  static void SetPhaseTimings(const InboundCallTiming& timing, RpczSamplePB* sample_pb);
+
   // An individual recorded sample.
   struct Sample {
     RequestHeader header;
     scoped_refptr<Trace> trace;
     int duration_ms;
+    InboundCallTiming timing;
   };
 
   // A sample, including the particular time at which it was
@@ -157,7 +162,7 @@ void MethodSampler::SampleCall(InboundCall* call) {
   MicrosecondsInt64 now = GetMonoTimeMicros();
   int64_t us_since_trace = now - bucket->last_sample_time.Load();
   if (us_since_trace > kSampleIntervalMs * 1000) {
-    Sample new_sample = {call->header(), call->trace(), duration_ms};
+    Sample new_sample = {call->header(), call->trace(), duration_ms, call->timing()};
     {
       std::unique_lock<simple_spinlock> lock(bucket->sample_lock, std::try_to_lock);
       // If another thread is already taking a sample, it's not worth waiting.
@@ -205,9 +210,25 @@ void MethodSampler::GetSamplePBs(RpczMethodPB* method_pb) {
 
     GetTraceMetrics(*bucket.sample.trace.get(), "", sample_pb);
     sample_pb->set_duration_ms(bucket.sample.duration_ms);
+    SetPhaseTimings(bucket.sample.timing, sample_pb);
   }
 }
 
+void MethodSampler::SetPhaseTimings(const InboundCallTiming& timing,
+                                    RpczSamplePB* sample_pb) {
+  if (timing.time_read_started.Initialized()) {
+    sample_pb->set_read_micros(
+        (timing.time_received - timing.time_read_started).ToMicroseconds());
+  }
+  if (!timing.time_handled.Initialized()) {
+    return;
+  }
+  sample_pb->set_queue_micros((timing.time_handled - timing.time_received).ToMicroseconds());
+  sample_pb->set_handler_micros((timing.time_completed - timing.time_handled).ToMicroseconds());
+  sample_pb->set_serialize_micros(
+      (timing.time_response_queued - timing.time_completed).ToMicroseconds());
+}
+
 RpczStore::RpczStore() {}
 RpczStore::~RpczStore() {}
 
@@ -268,6 +289,11 @@ void RpczStore::LogTrace(InboundCall* call) {
   } else if (duration_ms > FLAGS_rpc_duration_too_long_ms) {
     LOG(INFO) << call->ToString() << " took " << duration_ms << "ms. "
               << "Request Metrics: " << call->trace()->MetricsAsJSON();
+    vector<TraceRing::Event> events;
+    TraceRing::CollectEvents(*call->trace(), &events);
+    if (!events.empty()) {
+      LOG(INFO) << "Trace ring events:\n" << TraceRing::EventsToString(events);
+    }
   }
 }
 
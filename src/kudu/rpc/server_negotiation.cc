@@ -952,6 +952,10 @@ int ServerNegotiation::PlainAuthCb(sasl_conn_t* /*conn*/,
 }
 
 bool ServerNegotiation::IsTrustedConnection(const Sockaddr& addr) {
+  // Connections over UNIX domain sockets come from the local host.
+  if (addr.is_unix()) {
+    return true;
+  }
   static std::once_flag once;
   std::call_once(once, [] {
     g_trusted_subnets = new vector<Network>();
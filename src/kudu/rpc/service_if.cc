@@ -104,13 +104,19 @@ void GeneratedServiceIf::Handle(InboundCall *call) {
     RespondBadMethod(call);
     return;
   }
-  unique_ptr<Message> req(method_info->req_prototype->New());
+  // The protobufs allocated on the arena of the call are freed with the call,
+  // after the response is sent.
+  google::protobuf::Arena* arena = method_info->use_pb_arena ? call->pb_arena() : nullptr;
+  unique_ptr<Message> req(method_info->req_prototype->New(arena));
   if (PREDICT_FALSE(!ParseParam(call, req.get()))) {
+    if (arena) {
+      ignore_result(req.release());
+    }
     return;
   }
-  Message* resp = method_info->resp_prototype->New();
+  Message* resp = method_info->resp_prototype->New(arena);
 
-  RpcContext* ctx = new RpcContext(call, req.release(), resp);
+  RpcContext* ctx = new RpcContext(call, req.release(), resp, arena != nullptr);
   if (!method_info->authz_method(ctx->request_pb(), resp, ctx)) {
     // The authz_method itself should have responded to the RPC.
     return;
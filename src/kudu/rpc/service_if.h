@@ -47,11 +47,26 @@ struct RpcMethodInfo : public RefCountedThreadSafe<RpcMethodInfo> {
   std::unique_ptr<google::protobuf::Message> req_prototype;
   std::unique_ptr<google::protobuf::Message> resp_prototype;
 
+  // The latencies of the phases of the calls of this method on the server:
+  // reading the request, waiting in the service queue, running the handler,
+  // serializing the response and writing it. See InboundCallTiming.
+  scoped_refptr<Histogram> request_read_latency_histogram;
+  scoped_refptr<Histogram> queue_time_histogram;
   scoped_refptr<Histogram> handler_latency_histogram;
+  scoped_refptr<Histogram> response_serialize_latency_histogram;
+  scoped_refptr<Histogram> response_write_latency_histogram;
 
   // Whether we should track this method's result, using ResultTracker.
   bool track_result;
 
+  // Whether the calls of this method are dequeued ahead of the calls of the
+  // other methods of the service.
+  bool high_priority;
+
+  // Whether the request and the response of the calls of this method are
+  // allocated on the protobuf arena of the call.
+  bool use_pb_arena;
+
   // The authorization function for this RPC. If this function
   // returns false, the RPC has already been handled (i.e. rejected)
   // by the authorization function.
@@ -41,9 +41,11 @@
 #include "kudu/util/logging.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/net/sockaddr.h"
+#include "kudu/util/os-util.h"
 #include "kudu/util/status.h"
 #include "kudu/util/thread.h"
 #include "kudu/util/trace.h"
+#include "kudu/util/trace_ring.h"
 
 using std::shared_ptr;
 using std::string;
@@ -54,7 +56,7 @@ METRIC_DEFINE_histogram(server, rpc_incoming_queue_time,
                         "RPC Queue Time",
                         kudu::MetricUnit::kMicroseconds,
                         "Number of microseconds incoming RPC requests spend in the worker queue",
-                        60000000LU, 3);
+                        60000000LU, 3, kudu::STRIPED);
 
 METRIC_DEFINE_counter(server, rpcs_timed_out_in_queue,
                       "RPC Queue Timeouts",
@@ -91,6 +93,11 @@ Status ServicePool::Init(int num_threads) {
     scoped_refptr<kudu::Thread> new_thread;
     CHECK_OK(kudu::Thread::Create("service pool", "rpc worker",
         &ServicePool::RunThread, this, &new_thread));
+    if (!thread_cpu_groups_.empty()) {
+      WARN_NOT_OK(SetThreadCpuAffinity(
+          new_thread->tid(), thread_cpu_groups_[i % thread_cpu_groups_.size()]),
+                  Substitute("Unable to pin a worker thread of $0", service_name()));
+    }
     threads_.push_back(new_thread);
   }
   return Status::OK();
@@ -201,6 +208,9 @@ void ServicePool::RunThread() {
 
     incoming->RecordHandlingStarted(incoming_queue_time_.get());
     ADOPT_TRACE(incoming->trace());
+    TRACE_RING("Dequeued call after $0us in the queue",
+               (incoming->timing().time_handled -
+                incoming->timing().time_received).ToMicroseconds());
 
     if (PREDICT_FALSE(incoming->ClientTimedOut())) {
       TRACE_TO(incoming->trace(), "Skipping call since client already timed out");
@@ -68,6 +68,12 @@ class ServicePool : public RpcService {
     too_busy_hook_ = std::move(hook);
   }
 
+  // Set the groups of CPUs to which the threads started by Init() are pinned,
+  // spreading the threads over the groups. If empty, the threads aren't pinned.
+  void set_thread_cpu_groups(std::vector<std::vector<int>> cpu_groups) {
+    thread_cpu_groups_ = std::move(cpu_groups);
+  }
+
   // Start up the thread pool.
   virtual Status Init(int num_threads);
 
@@ -108,6 +114,8 @@ class ServicePool : public RpcService {
 
   std::function<void(void)> too_busy_hook_;
 
+  std::vector<std::vector<int>> thread_cpu_groups_;
+
   DISALLOW_COPY_AND_ASSIGN(ServicePool);
 };
 
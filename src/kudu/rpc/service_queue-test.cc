@@ -30,7 +30,9 @@
 
 #include "kudu/gutil/atomicops.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/ref_counted.h"
 #include "kudu/rpc/inbound_call.h"
+#include "kudu/rpc/service_if.h"
 #include "kudu/rpc/service_queue.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/stopwatch.h"
@@ -50,6 +52,8 @@ DEFINE_int32(num_consumers, 20,
 DEFINE_int32(max_queue_size, 50,
              "Max queue length");
 
+DECLARE_int32(rpc_high_priority_weight);
+
 namespace kudu {
 namespace rpc {
 
@@ -147,5 +151,81 @@ TEST(TestServiceQueue, LifoServiceQueuePerf) {
   LOG(INFO) << "Avg idle workers:     " << total_idle_workers / static_cast<double>(total_sample);
 }
 
+// Returns a new call of a method with the given priority, received after
+// the calls created before.
+static InboundCall* NewCall(bool high_priority) {
+  // Ensure that the calls are received at different times.
+  SleepFor(MonoDelta::FromMicroseconds(10));
+  InboundCall* call = new InboundCall(nullptr);
+  scoped_refptr<RpcMethodInfo> info(new RpcMethodInfo());
+  info->high_priority = high_priority;
+  call->set_method_info(std::move(info));
+  return call;
+}
+
+TEST(TestServiceQueue, TestHighPriorityCalls) {
+  FLAGS_rpc_high_priority_weight = 2;
+
+  // Each queue is accessed from its own thread, since a consumer thread
+  // is bound to the first queue it reads from.
+  std::thread t([]() {
+    LifoServiceQueue queue(10);
+    vector<InboundCall*> calls;
+    for (bool high_priority : { false, false, true, true, true }) {
+      calls.push_back(NewCall(high_priority));
+      boost::optional<InboundCall*> evicted;
+      ASSERT_EQ(QUEUE_SUCCESS, queue.Put(calls.back(), &evicted));
+      ASSERT_TRUE(evicted == boost::none);
+    }
+    ASSERT_EQ(5, queue.estimated_queue_length());
+
+    // Two high-priority calls are dequeued for each normal call.
+    for (int idx : { 2, 3, 0, 4, 1 }) {
+      unique_ptr<InboundCall> call;
+      ASSERT_TRUE(queue.BlockingGet(&call));
+      ASSERT_EQ(calls[idx], call.get());
+    }
+    ASSERT_TRUE(queue.empty());
+  });
+  t.join();
+
+  std::thread t2([]() {
+    LifoServiceQueue queue(2);
+    boost::optional<InboundCall*> evicted;
+    unique_ptr<InboundCall> n1(NewCall(false));
+    unique_ptr<InboundCall> n2(NewCall(false));
+    ASSERT_EQ(QUEUE_SUCCESS, queue.Put(n1.get(), &evicted));
+    ASSERT_EQ(QUEUE_SUCCESS, queue.Put(n2.get(), &evicted));
+
+    // A high-priority call evicts the latest normal call.
+    unique_ptr<InboundCall> h1(NewCall(true));
+    ASSERT_EQ(QUEUE_SUCCESS, queue.Put(h1.get(), &evicted));
+    ASSERT_EQ(n2.get(), evicted.get());
+
+    // A later normal call doesn't evict anything.
+    unique_ptr<InboundCall> n3(NewCall(false));
+    evicted = boost::none;
+    ASSERT_EQ(QUEUE_FULL, queue.Put(n3.get(), &evicted));
+
+    unique_ptr<InboundCall> h2(NewCall(true));
+    ASSERT_EQ(QUEUE_SUCCESS, queue.Put(h2.get(), &evicted));
+    ASSERT_EQ(n1.get(), evicted.get());
+
+    // Normal calls can't evict high-priority calls.
+    evicted = boost::none;
+    ASSERT_EQ(QUEUE_FULL, queue.Put(n3.get(), &evicted));
+
+    // The queued calls are owned by the unique_ptrs above.
+    queue.Shutdown();
+    for (InboundCall* expected : { h1.get(), h2.get() }) {
+      unique_ptr<InboundCall> call;
+      ASSERT_TRUE(queue.BlockingGet(&call));
+      ASSERT_EQ(expected, call.release());
+    }
+    ASSERT_TRUE(queue.empty());
+  });
+  t2.join();
+}
+
 } // namespace rpc
 } // namespace kudu
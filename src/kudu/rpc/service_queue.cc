@@ -21,8 +21,17 @@
 #include <ostream>
 
 #include <boost/optional/optional.hpp>
+#include <gflags/gflags.h>
 
 #include "kudu/gutil/port.h"
+#include "kudu/util/flag_tags.h"
+
+DEFINE_int32(rpc_high_priority_weight, 8,
+             "The number of calls of high-priority RPC methods, like keep-alives and "
+             "Raft heartbeats, which a service dequeues for each call of its other "
+             "methods when both kinds are queued.");
+TAG_FLAG(rpc_high_priority_weight, advanced);
+TAG_FLAG(rpc_high_priority_weight, runtime);
 
 namespace kudu {
 namespace rpc {
@@ -31,15 +40,40 @@ __thread LifoServiceQueue::ConsumerState* LifoServiceQueue::tl_consumer_ = nullp
 
 LifoServiceQueue::LifoServiceQueue(int max_size)
    : shutdown_(false),
-     max_queue_size_(max_size) {
+     max_queue_size_(max_size),
+     high_priority_streak_(0) {
   CHECK_GT(max_queue_size_, 0);
 }
 
 LifoServiceQueue::~LifoServiceQueue() {
-  DCHECK(queue_.empty())
+  DCHECK(queue_.empty() && high_priority_queue_.empty())
       << "ServiceQueue holds bare pointers at destruction time";
 }
 
+InboundCall* LifoServiceQueue::PopUnlocked() {
+  DCHECK(lock_.is_locked());
+  CallQueue* q;
+  if (high_priority_queue_.empty()) {
+    q = &queue_;
+  } else if (queue_.empty()) {
+    q = &high_priority_queue_;
+  } else if (high_priority_streak_ < FLAGS_rpc_high_priority_weight) {
+    // Both kinds of calls are waiting.
+    high_priority_streak_++;
+    q = &high_priority_queue_;
+  } else {
+    q = &queue_;
+  }
+  if (q == &queue_) {
+    high_priority_streak_ = 0;
+  }
+  DCHECK(!q->empty());
+  auto it = q->begin();
+  InboundCall* call = *it;
+  q->erase(it);
+  return call;
+}
+
 bool LifoServiceQueue::BlockingGet(std::unique_ptr<InboundCall>* out) {
   auto consumer = tl_consumer_;
   if (PREDICT_FALSE(!consumer)) {
@@ -51,10 +85,8 @@ bool LifoServiceQueue::BlockingGet(std::unique_ptr<InboundCall>* out) {
   while (true) {
     {
       std::lock_guard<simple_spinlock> l(lock_);
-      if (!queue_.empty()) {
-        auto it = queue_.begin();
-        out->reset(*it);
-        queue_.erase(it);
+      if (!queue_.empty() || !high_priority_queue_.empty()) {
+        out->reset(PopUnlocked());
         return true;
       }
       if (PREDICT_FALSE(shutdown_)) {
@@ -80,10 +112,11 @@ QueueStatus LifoServiceQueue::Put(InboundCall* call,
     return QUEUE_SHUTDOWN;
   }
 
-  DCHECK(!(waiting_consumers_.size() > 0 && queue_.size() > 0));
+  const size_t queue_size = queue_.size() + high_priority_queue_.size();
+  DCHECK(!(waiting_consumers_.size() > 0 && queue_size > 0));
 
   // fast path
-  if (queue_.empty() && waiting_consumers_.size() > 0) {
+  if (queue_size == 0 && waiting_consumers_.size() > 0) {
     auto consumer = waiting_consumers_[waiting_consumers_.size() - 1];
     waiting_consumers_.pop_back();
     // Notify condition var(and wake up consumer thread) takes time,
@@ -93,20 +126,30 @@ QueueStatus LifoServiceQueue::Put(InboundCall* call,
     return QUEUE_SUCCESS;
   }
 
-  if (PREDICT_FALSE(queue_.size() >= max_queue_size_)) {
-    // eviction
-    DCHECK_EQ(queue_.size(), max_queue_size_);
-    auto it = queue_.end();
+  const bool high_priority = IsHighPriority(call);
+  if (PREDICT_FALSE(queue_size >= max_queue_size_)) {
+    // eviction: normal calls are evicted first, so a high-priority call
+    // evicts the normal call with the latest deadline, if any.
+    DCHECK_EQ(queue_size, max_queue_size_);
+    CallQueue* q = queue_.empty() ? &high_priority_queue_ : &queue_;
+    if (!high_priority && q == &high_priority_queue_) {
+      return QUEUE_FULL;
+    }
+    auto it = q->end();
     --it;
-    if (DeadlineLess(*it, call)) {
+    if (high_priority == (q == &high_priority_queue_) && DeadlineLess(*it, call)) {
       return QUEUE_FULL;
     }
 
     *evicted = *it;
-    queue_.erase(it);
+    q->erase(it);
   }
 
-  queue_.insert(call);
+  if (high_priority) {
+    high_priority_queue_.insert(call);
+  } else {
+    queue_.insert(call);
+  }
   return QUEUE_SUCCESS;
 }
 
@@ -123,7 +166,7 @@ void LifoServiceQueue::Shutdown() {
 
 bool LifoServiceQueue::empty() const {
   std::lock_guard<simple_spinlock> l(lock_);
-  return queue_.empty();
+  return queue_.empty() && high_priority_queue_.empty();
 }
 
 int LifoServiceQueue::max_size() const {
@@ -134,6 +177,10 @@ std::string LifoServiceQueue::ToString() const {
   std::string ret;
 
   std::lock_guard<simple_spinlock> l(lock_);
+  for (const auto* t : high_priority_queue_) {
+    ret.append(t->ToString());
+    ret.append("\n");
+  }
   for (const auto* t : queue_) {
     ret.append(t->ToString());
     ret.append("\n");
@@ -27,6 +27,7 @@
 #include "kudu/gutil/dynamic_annotations.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/rpc/inbound_call.h"
+#include "kudu/rpc/service_if.h"
 #include "kudu/util/condition_variable.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/monotime.h"
@@ -57,6 +58,12 @@ enum QueueStatus {
 // can evict any call that does not have a deadline. This incentivizes clients to
 // provide accurate deadlines for their calls.
 //
+// The calls of the methods marked with the 'high_priority_rpc' option, like
+// keep-alives and Raft heartbeats, are kept in a separate queue so that they
+// don't wait behind heavier calls: when both queues hold calls, up to
+// --rpc_high_priority_weight high-priority calls are dequeued for each
+// normal call. On overflow, normal calls are evicted first.
+//
 // In order to improve concurrent throughput, this class uses a LIFO design:
 // Each consumer thread has its own lock and condition variable. If a
 // consumer arrives and there is no work available in the queue, it will not
@@ -117,7 +124,7 @@ class LifoServiceQueue {
     // so this method won't try to traverse any actual nodes of the underlying
     // RB tree. Investigation of the libstdcxx implementation confirms that
     // size() is a simple field access of the _Rb_tree structure.
-    int ret = queue_.size();
+    int ret = queue_.size() + high_priority_queue_.size();
     ANNOTATE_IGNORE_READS_END();
     return ret;
   }
@@ -153,6 +160,18 @@ class LifoServiceQueue {
     }
   };
 
+  typedef std::multiset<InboundCall*, DeadlineLessStruct> CallQueue;
+
+  // Whether 'call' belongs to the high-priority queue.
+  static bool IsHighPriority(InboundCall* call) {
+    const RpcMethodInfo* info = call->method_info();
+    return info != nullptr && info->high_priority;
+  }
+
+  // Removes the next call to handle from the queues, which must not both be
+  // empty.
+  InboundCall* PopUnlocked();
+
   // The thread-local record corresponding to a single consumer thread.
   // Threads push this record onto the waiting_consumers_ stack when
   // they are awaiting work. Producers pop the top waiting consumer and
@@ -209,9 +228,15 @@ class LifoServiceQueue {
   // Stack of consumer threads which are currently waiting for work.
   std::vector<ConsumerState*> waiting_consumers_;
 
-  // The actual queue. Work is only added to the queue when there were no
-  // consumers available for a "direct hand-off".
-  std::multiset<InboundCall*, DeadlineLessStruct> queue_;
+  // The actual queues, of the normal and of the high-priority calls. Work is
+  // only added to the queues when there were no consumers available for a
+  // "direct hand-off".
+  CallQueue queue_;
+  CallQueue high_priority_queue_;
+
+  // The number of high-priority calls dequeued in a row while normal calls
+  // were waiting.
+  int high_priority_streak_;
 
   // The total set of consumers who have ever accessed this queue.
   std::vector<std::unique_ptr<ConsumerState>> consumers_;
@@ -20,6 +20,7 @@
 #include <sys/uio.h>
 
 #include <algorithm>
+#include <cstring>
 #include <cstdint>
 #include <iostream>
 #include <limits>
@@ -34,6 +35,7 @@
 #include "kudu/rpc/constants.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/net/socket.h"
 
 DEFINE_int64(rpc_max_message_size, (50 * 1024 * 1024),
@@ -79,23 +81,57 @@ using strings::Substitute;
 TransferCallbacks::~TransferCallbacks()
 {}
 
+ReadAheadBuffer::ReadAheadBuffer(int32_t capacity)
+    : capacity_(capacity),
+      offset_(0) {
+}
+
+Status ReadAheadBuffer::Recv(Socket* socket, uint8_t* buf, int32_t amt, int32_t* nread) {
+  if (empty()) {
+    if (amt >= capacity_) {
+      return socket->Recv(buf, amt, nread);
+    }
+    buf_.resize(capacity_);
+    int32_t nbuffered;
+    Status s = socket->Recv(buf_.data(), capacity_, &nbuffered);
+    if (PREDICT_FALSE(!s.ok())) {
+      buf_.clear();
+      offset_ = 0;
+      return s;
+    }
+    buf_.resize(nbuffered);
+    offset_ = 0;
+  }
+  *nread = std::min<int32_t>(amt, buf_.size() - offset_);
+  memcpy(buf, &buf_[offset_], *nread);
+  offset_ += *nread;
+  return Status::OK();
+}
+
 InboundTransfer::InboundTransfer()
   : total_length_(kMsgLengthPrefixLength),
     cur_offset_(0) {
   buf_.resize(kMsgLengthPrefixLength);
 }
 
-Status InboundTransfer::ReceiveBuffer(Socket &socket) {
+Status InboundTransfer::ReceiveBuffer(Socket &socket, ReadAheadBuffer* read_ahead) {
+  const auto recv = [&](uint8_t* buf, int32_t amt, int32_t* nread) {
+    return read_ahead ? read_ahead->Recv(&socket, buf, amt, nread)
+                      : socket.Recv(buf, amt, nread);
+  };
   if (cur_offset_ < kMsgLengthPrefixLength) {
     // receive uint32 length prefix
     int32_t rem = kMsgLengthPrefixLength - cur_offset_;
     int32_t nread;
-    Status status = socket.Recv(&buf_[cur_offset_], rem, &nread);
+    Status status = recv(&buf_[cur_offset_], rem, &nread);
     RETURN_ON_ERROR_OR_SOCKET_NOT_READY(status);
     if (nread == 0) {
       return Status::OK();
     }
     DCHECK_GE(nread, 0);
+    if (cur_offset_ == 0) {
+      start_time_ = MonoTime::Now();
+    }
     cur_offset_ += nread;
     if (cur_offset_ < kMsgLengthPrefixLength) {
       // If we still don't have the full length prefix, we can't continue
@@ -133,7 +169,7 @@ Status InboundTransfer::ReceiveBuffer(Socket &socket) {
   // currently only used for unit tests.
   int32_t rem = std::min(total_length_ - cur_offset_,
       static_cast<uint32_t>(std::numeric_limits<int32_t>::max()));
-  Status status = socket.Recv(&buf_[cur_offset_], rem, &nread);
+  Status status = recv(&buf_[cur_offset_], rem, &nread);
   RETURN_ON_ERROR_OR_SOCKET_NOT_READY(status);
   cur_offset_ += nread;
 
@@ -198,20 +234,21 @@ void OutboundTransfer::Abort(const Status &status) {
 }
 
 Status OutboundTransfer::SendBuffer(Socket &socket) {
-  CHECK_LT(cur_slice_idx_, n_payload_slices_);
+  OutboundTransfer* transfer = this;
+  return SendBuffers(socket, &transfer, 1);
+}
 
-  started_ = true;
-  int n_iovecs = n_payload_slices_ - cur_slice_idx_;
-  struct iovec iovec[n_iovecs];
-  {
-    int offset_in_slice = cur_offset_in_slice_;
-    for (int i = 0; i < n_iovecs; i++) {
-      Slice &slice = payload_slices_[cur_slice_idx_ + i];
-      iovec[i].iov_base = slice.mutable_data() + offset_in_slice;
-      iovec[i].iov_len = slice.size() - offset_in_slice;
-
-      offset_in_slice = 0;
-    }
+Status OutboundTransfer::SendBuffers(Socket& socket,
+                                     OutboundTransfer* const* transfers,
+                                     int n_transfers) {
+  DCHECK_GT(n_transfers, 0);
+  struct iovec iovec[n_transfers * TransferLimits::kMaxPayloadSlices];
+  int n_iovecs = 0;
+  for (int i = 0; i < n_transfers; i++) {
+    OutboundTransfer* transfer = transfers[i];
+    CHECK_LT(transfer->cur_slice_idx_, transfer->n_payload_slices_);
+    transfer->started_ = true;
+    n_iovecs += transfer->FillIovecs(iovec + n_iovecs);
   }
 
   int64_t written;
@@ -219,6 +256,27 @@ Status OutboundTransfer::SendBuffer(Socket &socket) {
   RETURN_ON_ERROR_OR_SOCKET_NOT_READY(status);
 
   // Adjust our accounting of current writer position.
+  for (int i = 0; i < n_transfers && written > 0; i++) {
+    written = transfers[i]->Advance(written);
+  }
+  DCHECK_EQ(0, written);
+  return Status::OK();
+}
+
+int OutboundTransfer::FillIovecs(struct ::iovec* iov) {
+  int n_iovecs = n_payload_slices_ - cur_slice_idx_;
+  int offset_in_slice = cur_offset_in_slice_;
+  for (int i = 0; i < n_iovecs; i++) {
+    Slice &slice = payload_slices_[cur_slice_idx_ + i];
+    iov[i].iov_base = slice.mutable_data() + offset_in_slice;
+    iov[i].iov_len = slice.size() - offset_in_slice;
+
+    offset_in_slice = 0;
+  }
+  return n_iovecs;
+}
+
+int64_t OutboundTransfer::Advance(int64_t written) {
   for (int i = cur_slice_idx_; i < n_payload_slices_; i++) {
     Slice &slice = payload_slices_[i];
     int rem_in_slice = slice.size() - cur_offset_in_slice_;
@@ -232,6 +290,7 @@ Status OutboundTransfer::SendBuffer(Socket &socket) {
     } else {
       // Partially used up this slice, just advance the offset within it.
       cur_offset_in_slice_ += written;
+      written = 0;
       break;
     }
   }
@@ -243,8 +302,7 @@ Status OutboundTransfer::SendBuffer(Socket &socket) {
     DCHECK_LT(cur_slice_idx_, n_payload_slices_);
     DCHECK_LT(cur_offset_in_slice_, payload_slices_[cur_slice_idx_].size());
   }
-
-  return Status::OK();
+  return written;
 }
 
 bool OutboundTransfer::TransferStarted() const {
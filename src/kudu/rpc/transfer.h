@@ -31,11 +31,14 @@
 #include "kudu/gutil/macros.h"
 #include "kudu/rpc/constants.h"
 #include "kudu/util/faststring.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
 DECLARE_int64(rpc_max_message_size);
 
+struct iovec;
+
 namespace kudu {
 
 class Socket;
@@ -57,6 +60,40 @@ class TransferLimits {
 
 typedef std::array<Slice, TransferLimits::kMaxPayloadSlices> TransferPayload;
 
+// The bytes read from a socket ahead of the inbound transfers which need
+// them. Small messages which arrive together, e.g. the calls or responses
+// which the remote end wrote with a single syscall, are then received with a
+// single recv() rather than two each, and handled in the same wakeup of the
+// reactor thread.
+class ReadAheadBuffer {
+ public:
+  // Reads at most 'capacity' bytes ahead: 0 disables the read-ahead.
+  explicit ReadAheadBuffer(int32_t capacity);
+
+  // Reads up to 'amt' bytes into 'buf', setting 'nread' to the number of
+  // bytes read.
+  //
+  // The buffered bytes are returned first, without reading from the socket.
+  // Otherwise, reads that are smaller than the capacity read as many bytes
+  // as are available from the socket into the buffer. So, if fewer than
+  // 'amt' bytes are read, the buffer is empty afterwards.
+  Status Recv(Socket* socket, uint8_t* buf, int32_t amt, int32_t* nread);
+
+  // Whether there are no buffered bytes.
+  bool empty() const {
+    return offset_ == buf_.size();
+  }
+
+ private:
+  const int32_t capacity_;
+
+  // The buffered bytes are those of 'buf_' from 'offset_'.
+  faststring buf_;
+  size_t offset_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReadAheadBuffer);
+};
+
 // This class is used internally by the RPC layer to represent an inbound
 // transfer in progress.
 //
@@ -68,8 +105,8 @@ class InboundTransfer {
 
   InboundTransfer();
 
-  // read from the socket into our buffer
-  Status ReceiveBuffer(Socket &socket);
+  // read from the socket into our buffer, through 'read_ahead' if it's set
+  Status ReceiveBuffer(Socket &socket, ReadAheadBuffer* read_ahead = nullptr);
 
   // Return true if any bytes have yet been sent.
   bool TransferStarted() const;
@@ -81,6 +118,11 @@ class InboundTransfer {
     return Slice(buf_);
   }
 
+  // The time at which the first bytes of the transfer were received.
+  MonoTime start_time() const {
+    return start_time_;
+  }
+
   // Return a string indicating the status of this transfer (number of bytes received, etc)
   // suitable for logging.
   std::string StatusAsString() const;
@@ -94,6 +136,8 @@ class InboundTransfer {
   uint32_t total_length_;
   uint32_t cur_offset_;
 
+  MonoTime start_time_;
+
   DISALLOW_COPY_AND_ASSIGN(InboundTransfer);
 };
 
@@ -141,6 +185,14 @@ class OutboundTransfer : public boost::intrusive::list_base_hook<> {
   // send from our buffers into the sock
   Status SendBuffer(Socket &socket);
 
+  // Sends as much as possible of the 'n_transfers' transfers, in order, with
+  // a single writev() call, which saves the syscalls of sending the
+  // transfers one by one when many small calls or responses are queued.
+  // All the transfers must be unfinished.
+  static Status SendBuffers(Socket& socket,
+                            OutboundTransfer* const* transfers,
+                            int n_transfers);
+
   // Return true if any bytes have yet been sent.
   bool TransferStarted() const;
 
@@ -169,6 +221,15 @@ class OutboundTransfer : public boost::intrusive::list_base_hook<> {
                    size_t n_payload_slices,
                    TransferCallbacks *callbacks);
 
+  // Fills 'iov' with the slices remaining to send, and returns their number,
+  // which is at most kMaxPayloadSlices.
+  int FillIovecs(struct ::iovec* iov);
+
+  // Accounts for 'written' bytes sent, and returns the number of those which
+  // were beyond the end of this transfer. Notifies the callbacks if the
+  // transfer is finished.
+  int64_t Advance(int64_t written);
+
   // Slices to send. Uses an array here instead of a vector to avoid an expensive
   // vector construction (improved performance a couple percent).
   TransferPayload payload_slices_;
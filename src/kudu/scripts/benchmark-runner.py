@@ -0,0 +1,467 @@
+#!/usr/bin/env python
+#
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+#################################################################
+# Runs a curated set of benchmarks, records their results in a JSON file
+# and compares them with the results of a baseline run.
+#
+# Unlike benchmarks.sh, which records its results in the stats database used
+# by the Jenkins jobs, this script needs nothing but a build of Kudu: the
+# cluster benchmarks run against a mini-cluster started with
+# 'kudu test mini_cluster'.
+#
+# Every benchmark is run --num-samples times, and the comparison of every
+# metric with the baseline uses the two-sided Mann-Whitney U test on the
+# samples of both runs. A metric regressed if the difference is significant
+# and its median changed by more than --min-change in the bad direction.
+# The script exits with status 1 if any metric regressed.
+#
+# Example invocations:
+#   benchmark-runner.py run --build-dir build/release --output base.json
+#   benchmark-runner.py run --build-dir build/release --output new.json \
+#       --baseline base.json
+#   benchmark-runner.py compare base.json new.json
+#
+# The result files look like:
+#   {
+#     "schema_version": 1,
+#     "start_timestamp": "2019-06-01T10:00:00",
+#     "git_hash": "...",
+#     "hostname": "...",
+#     "num_samples": 5,
+#     "metrics": [
+#       {
+#         "benchmark": "rpc-bench",
+#         "metric": "reqs_per_sec",
+#         "unit": "req/s",
+#         "higher_is_better": true,
+#         "samples": [ 84404.4, ... ]
+#       },
+#       ...
+#     ]
+#   }
+# Metrics are identified by their 'benchmark' and 'metric' names, which are
+# kept stable across versions of this script.
+#################################################################
+
+import argparse
+import datetime
+import json
+import math
+import os
+import re
+import shutil
+import socket
+import subprocess
+import sys
+import tempfile
+
+from collections import OrderedDict
+
+RESULT_SCHEMA_VERSION = 1
+
+HUMAN_READABLE_SUFFIXES = { '': 1, 'k': 1e3, 'M': 1e6, 'B': 1e9, 'T': 1e12 }
+
+def timestamp():
+  return datetime.datetime.now().replace(microsecond=0).isoformat()
+
+def parse_human_readable(s):
+  """ Parses a number formatted by HumanReadableNum, e.g. '12.34M'. """
+  m = re.match(r'^([\d.]+)([kMBT]?)$', s)
+  if not m:
+    raise ValueError("not a number: %s" % s)
+  return float(m.group(1)) * HUMAN_READABLE_SUFFIXES[m.group(2)]
+
+class Metric(object):
+  """ A metric reported by a benchmark. """
+  def __init__(self, name, unit, higher_is_better):
+    self.name = name
+    self.unit = unit
+    self.higher_is_better = higher_is_better
+
+class Benchmark(object):
+  """
+  A benchmark binary and how to parse its metrics out of its output.
+
+  'parse' is a function taking the output of a run and returning a list of
+  (Metric, value) pairs.
+  """
+  def __init__(self, name, binary, args, parse, env=None, needs_cluster=False):
+    self.name = name
+    self.binary = binary
+    self.args = args
+    self.parse = parse
+    self.env = env or {}
+    self.needs_cluster = needs_cluster
+
+  def command(self, opts, masters):
+    args = self.args(opts, masters) if callable(self.args) else self.args
+    return [os.path.join(opts.build_dir, 'bin', self.binary)] + args
+
+def parse_rpc_bench(output):
+  # "I1009 15:00:30.023576 27043 rpc-bench.cc:108] Reqs/sec:         84404.4"
+  return [(Metric('reqs_per_sec', 'req/s', True), float(v))
+          for v in re.findall(r'Reqs/sec:\s+([\d.]+)', output)]
+
+def parse_cache_bench(output):
+  # "... cache-bench.cc:185] ZIPFIAN ratio=1.00x n_unique=262144: 12.34M lookups/sec"
+  results = []
+  for pattern, ratio, rate in re.findall(
+      r'(ZIPFIAN|UNIFORM) ratio=([\d.]+)x n_unique=\d+: (\S+) lookups/sec', output):
+    results.append((Metric('%s_%sx_lookups_per_sec' % (pattern.lower(), ratio),
+                           'lookup/s', True),
+                    parse_human_readable(rate)))
+  return results
+
+def parse_mt_tablet_test(output):
+  # "[       OK ] MultiThreadedTabletTest/5.DoTestAllAtOnce (14966 ms)"
+  return [(Metric('test_%s_runtime_ms' % idx, 'ms', False), float(ms))
+          for idx, ms in re.findall(
+              r'OK \] MultiThreadedTabletTest/(\d+)\.DoTestAllAtOnce \((\d+) ms\)', output)]
+
+def parse_wal_hiccup(output):
+  # "Test results for setup 3:" followed by "throughput: 123.4" and "p99: 5678"
+  results = []
+  for setup, body in re.findall(r'Test results for setup (\d+):(.*?)max:', output, re.S):
+    m = re.search(r'throughput: ([\d.e+]+)', body)
+    if m:
+      results.append((Metric('setup_%s_throughput_mb_per_sec' % setup, 'MB/s', True),
+                      float(m.group(1))))
+    m = re.search(r'p99: (\d+)', body)
+    if m:
+      results.append((Metric('setup_%s_p99_us' % setup, 'us', False), float(m.group(1))))
+  return results
+
+def parse_tpch1(output):
+  results = [(Metric('loading_sec', 's', False), float(v))
+             for v in re.findall(r'Time spent loading: real ([\d.]+)s', output)]
+  results += [(Metric('query_sec', 's', False), float(v))
+              for v in re.findall(r'Time spent querying for iteration # \d+: real ([\d.]+)s',
+                                  output)]
+  return results
+
+def parse_loadgen(output):
+  # "Generator report\n  time total  : 1234.5 ms"
+  return [(Metric('insert_time_ms', 'ms', False), float(v))
+          for v in re.findall(r'time total\s*: ([\d.]+) ms', output)[:1]]
+
+def parse_workload(output):
+  # "  op   count  errors  ops/sec  mean_us  p50_us  p95_us  p99_us  p99.9_us  max_us"
+  results = []
+  report = output.split('Workload report', 1)
+  if len(report) < 2:
+    return results
+  for op, ops_per_sec, p99 in re.findall(
+      r'^\s+(\w+)\s+\d+\s+\d+\s+([\d.]+)\s+\d+\s+\d+\s+\d+\s+(\d+)\s+\d+\s+\d+\s*$',
+      report[1], re.M):
+    results.append((Metric('%s_ops_per_sec' % op, 'op/s', True), float(ops_per_sec)))
+    results.append((Metric('%s_p99_us' % op, 'us', False), float(p99)))
+  return results
+
+def tpch1_args(opts, masters):
+  return ['--tpch_path_to_data=%s' % opts.tpch_data,
+          '--mini_cluster_base_dir=%s' % os.path.join(opts.work_dir, 'tpch1')]
+
+def loadgen_args(opts, masters):
+  return ['perf', 'loadgen', masters,
+          '--num_threads=%d' % opts.client_threads,
+          '--num_rows_per_thread=%d' % opts.loadgen_rows_per_thread,
+          '--table_num_replicas=1']
+
+def workload_args(opts, masters):
+  return ['perf', 'workload', masters,
+          '--num_threads=%d' % opts.client_threads,
+          '--workload_duration_sec=%d' % opts.workload_duration_sec,
+          '--table_num_replicas=1']
+
+BENCHMARKS = [
+  Benchmark('rpc-bench', 'rpc-bench', ['--gtest_filter=*BenchmarkCalls'], parse_rpc_bench,
+            env={ 'KUDU_ALLOW_SLOW_TESTS': 'true' }),
+  Benchmark('cache-bench', 'cache-bench', ['--run_seconds=5'], parse_cache_bench),
+  Benchmark('mt-tablet-test', 'mt-tablet-test',
+            ['--gtest_filter=*DoTestAllAtOnce*',
+             '--num_counter_threads=0',
+             '--tablet_test_flush_threshold_mb=32',
+             '--num_slowreader_threads=0',
+             '--flusher_backoff=1.0',
+             '--flusher_initial_frequency_ms=1000',
+             '--inserts_per_thread=1000000'],
+            parse_mt_tablet_test),
+  Benchmark('wal_hiccup', 'wal_hiccup', [], parse_wal_hiccup),
+  Benchmark('tpch1', 'tpch1', tpch1_args, parse_tpch1),
+  Benchmark('loadgen', 'kudu', loadgen_args, parse_loadgen, needs_cluster=True),
+  Benchmark('workload', 'kudu', workload_args, parse_workload, needs_cluster=True),
+]
+
+class MiniCluster(object):
+  """ A mini-cluster run by the 'kudu test mini_cluster' control shell. """
+  def __init__(self, opts):
+    self.proc = subprocess.Popen(
+        [os.path.join(opts.build_dir, 'bin', 'kudu'), 'test', 'mini_cluster',
+         '--serialization=json'],
+        stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+    self.send_and_receive({ 'create_cluster': {
+        'numMasters': 1,
+        'numTservers': opts.num_tservers,
+        'clusterRoot': os.path.join(opts.work_dir, 'mini-cluster') }})
+    self.send_and_receive({ 'start_cluster': {} })
+    masters = self.send_and_receive({ 'get_masters': {} })
+    self.master_addresses = ','.join(
+        '%s:%d' % (m['boundRpcAddress']['host'], m['boundRpcAddress']['port'])
+        for m in masters['getMasters']['masters'])
+
+  def send_and_receive(self, request):
+    self.proc.stdin.write((json.dumps(request) + '\n').encode('utf-8'))
+    self.proc.stdin.flush()
+    response = json.loads(self.proc.stdout.readline().decode('utf-8'))
+    if 'error' in response:
+      raise Exception('mini-cluster error: %s' % response['error'])
+    return response
+
+  def stop(self):
+    self.send_and_receive({ 'destroy_cluster': {} })
+    self.proc.stdin.close()
+    if self.proc.wait() != 0:
+      raise Exception('mini-cluster exited with code %d' % self.proc.returncode)
+
+def run_benchmark(opts, benchmark, masters, log_dir):
+  """
+  Runs 'benchmark' --num-samples times, returning a dictionary of the samples
+  of its metrics, by metric name.
+  """
+  samples = OrderedDict()
+  env = dict(os.environ)
+  env.update(benchmark.env)
+  for i in range(opts.num_samples):
+    cmd = benchmark.command(opts, masters)
+    log_path = os.path.join(log_dir, '%s.%d.log' % (benchmark.name, i))
+    print('Running %s (sample %d/%d)' % (benchmark.name, i + 1, opts.num_samples))
+    with open(log_path, 'w') as log:
+      ret = subprocess.call(cmd, stdout=log, stderr=subprocess.STDOUT, env=env,
+                            cwd=opts.work_dir)
+    with open(log_path) as log:
+      output = log.read()
+    if ret != 0:
+      raise Exception('%s failed with exit code %d; see %s' % (' '.join(cmd), ret, log_path))
+    values = benchmark.parse(output)
+    if not values:
+      raise Exception('no results found in the output of %s; see %s' % (benchmark.name, log_path))
+    for metric, value in values:
+      entry = samples.setdefault(metric.name, (metric, []))
+      entry[1].append(value)
+  return samples
+
+def git_hash():
+  try:
+    return subprocess.check_output(['git', 'rev-parse', 'HEAD'],
+                                   stderr=subprocess.STDOUT).decode('utf-8').strip()
+  except (OSError, subprocess.CalledProcessError):
+    return None
+
+def run_benchmarks(opts):
+  selected = [b for b in BENCHMARKS if not opts.benchmarks or b.name in opts.benchmarks]
+  if not opts.tpch_data:
+    if opts.benchmarks and 'tpch1' in opts.benchmarks:
+      raise Exception('tpch1 needs --tpch-data')
+    selected = [b for b in selected if b.name != 'tpch1']
+
+  results = OrderedDict()
+  results['schema_version'] = RESULT_SCHEMA_VERSION
+  results['start_timestamp'] = timestamp()
+  results['git_hash'] = git_hash()
+  results['hostname'] = socket.gethostname()
+  results['num_samples'] = opts.num_samples
+  results['metrics'] = []
+
+  log_dir = os.path.join(opts.work_dir, 'logs')
+  os.makedirs(log_dir)
+  cluster = None
+  try:
+    for benchmark in selected:
+      masters = None
+      if benchmark.needs_cluster:
+        if cluster is None:
+          cluster = MiniCluster(opts)
+        masters = cluster.master_addresses
+      for name, (metric, samples) in run_benchmark(opts, benchmark, masters, log_dir).items():
+        entry = OrderedDict()
+        entry['benchmark'] = benchmark.name
+        entry['metric'] = name
+        entry['unit'] = metric.unit
+        entry['higher_is_better'] = metric.higher_is_better
+        entry['samples'] = samples
+        results['metrics'].append(entry)
+  finally:
+    if cluster is not None:
+      cluster.stop()
+  results['end_timestamp'] = timestamp()
+  return results
+
+def median(values):
+  s = sorted(values)
+  n = len(s)
+  return s[n // 2] if n % 2 else (s[n // 2 - 1] + s[n // 2]) / 2.0
+
+def mann_whitney_u_p_value(a, b):
+  """
+  Returns the two-sided p-value of the Mann-Whitney U test of samples 'a' and
+  'b', using the normal approximation with tie and continuity corrections.
+  """
+  n1 = len(a)
+  n2 = len(b)
+  if n1 == 0 or n2 == 0:
+    return 1.0
+  combined = sorted([(v, 0) for v in a] + [(v, 1) for v in b])
+  ranks = [0.0] * len(combined)
+  tie_term = 0.0
+  i = 0
+  while i < len(combined):
+    j = i
+    while j + 1 < len(combined) and combined[j + 1][0] == combined[i][0]:
+      j += 1
+    # Tied values get the average of their ranks.
+    for k in range(i, j + 1):
+      ranks[k] = (i + j) / 2.0 + 1
+    t = j - i + 1
+    tie_term += t ** 3 - t
+    i = j + 1
+  r1 = sum(r for r, (_, group) in zip(ranks, combined) if group == 0)
+  u1 = r1 - n1 * (n1 + 1) / 2.0
+  u = min(u1, n1 * n2 - u1)
+  n = n1 + n2
+  variance = n1 * n2 / 12.0 * ((n + 1) - tie_term / (n * (n - 1)))
+  if variance <= 0:
+    return 1.0
+  z = (abs(u - n1 * n2 / 2.0) - 0.5) / math.sqrt(variance)
+  if z <= 0:
+    return 1.0
+  return math.erfc(z / math.sqrt(2))
+
+def compare_results(baseline, current, alpha, min_change):
+  """
+  Compares the metrics of 'current' with those of 'baseline', printing a
+  report. Returns the number of regressed metrics.
+  """
+  for results in (baseline, current):
+    if results.get('schema_version') != RESULT_SCHEMA_VERSION:
+      raise Exception('unsupported result schema version: %s' % results.get('schema_version'))
+  baseline_metrics = dict(((m['benchmark'], m['metric']), m) for m in baseline['metrics'])
+  print('%-16s %-36s %14s %14s %9s %8s  %s' % (
+      'benchmark', 'metric', 'baseline', 'current', 'change', 'p-value', 'verdict'))
+  num_regressions = 0
+  for m in current['metrics']:
+    base = baseline_metrics.get((m['benchmark'], m['metric']))
+    if base is None:
+      continue
+    base_median = median(base['samples'])
+    cur_median = median(m['samples'])
+    change = (cur_median - base_median) / base_median if base_median else 0.0
+    p_value = mann_whitney_u_p_value(base['samples'], m['samples'])
+    improved = change > 0 if m['higher_is_better'] else change < 0
+    verdict = ''
+    if p_value < alpha and abs(change) > min_change:
+      verdict = 'improved' if improved else 'REGRESSED'
+      if not improved:
+        num_regressions += 1
+    print('%-16s %-36s %14.2f %14.2f %+8.1f%% %8.3f  %s' % (
+        m['benchmark'], m['metric'], base_median, cur_median, change * 100, p_value, verdict))
+  return num_regressions
+
+def parse_args():
+  """ Parse command-line arguments """
+  parser = argparse.ArgumentParser(description='Run Kudu benchmarks and track regressions',
+                                   formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+  subparsers = parser.add_subparsers(dest='command')
+
+  run = subparsers.add_parser('run', help='Run the benchmarks',
+                              formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+  run.add_argument('--build-dir', default='build/latest',
+                   help='The Kudu build directory, whose bin/ subdirectory has the binaries')
+  run.add_argument('--output', required=True, help='The file the results are written to')
+  run.add_argument('--baseline', help='If set, the results of a run to compare with')
+  run.add_argument('--benchmarks', nargs='*',
+                   choices=[b.name for b in BENCHMARKS],
+                   help='The benchmarks to run. All of them if not set')
+  run.add_argument('--num-samples', type=int, default=5,
+                   help='The number of times every benchmark is run')
+  run.add_argument('--work-dir',
+                   help='The directory for the logs and the data of the benchmarks. '
+                        'A temporary directory, removed on success, if not set')
+  run.add_argument('--num-tservers', type=int, default=3,
+                   help='The number of tablet servers of the mini-cluster')
+  run.add_argument('--client-threads', type=int, default=4,
+                   help='The number of client threads of the cluster benchmarks')
+  run.add_argument('--loadgen-rows-per-thread', type=int, default=1000000,
+                   help='The number of rows inserted by every loadgen thread')
+  run.add_argument('--workload-duration-sec', type=int, default=30,
+                   help='The duration of the mixed workload')
+  run.add_argument('--tpch-data',
+                   help='The path to the TPC-H lineitem.tbl file. tpch1 is skipped if not set')
+
+  compare = subparsers.add_parser('compare', help='Compare the results of two runs',
+                                  formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+  compare.add_argument('baseline', help='The results of the baseline run')
+  compare.add_argument('current', help='The results of the run to compare')
+
+  for p in (run, compare):
+    p.add_argument('--alpha', type=float, default=0.05,
+                   help='The significance level of the comparison')
+    p.add_argument('--min-change', type=float, default=0.05,
+                   help='The minimum relative change of a metric reported as a regression')
+
+  opts = parser.parse_args()
+  if opts.command is None:
+    parser.error('a command is required')
+  return opts
+
+def main():
+  opts = parse_args()
+  if opts.command == 'compare':
+    with open(opts.baseline) as f:
+      baseline = json.load(f)
+    with open(opts.current) as f:
+      current = json.load(f)
+    sys.exit(1 if compare_results(baseline, current, opts.alpha, opts.min_change) else 0)
+
+  opts.build_dir = os.path.abspath(opts.build_dir)
+  remove_work_dir = opts.work_dir is None
+  if remove_work_dir:
+    opts.work_dir = tempfile.mkdtemp(prefix='kudu-bench.')
+  else:
+    opts.work_dir = os.path.abspath(opts.work_dir)
+    if not os.path.isdir(opts.work_dir):
+      os.makedirs(opts.work_dir)
+  print('Logs and data are in %s' % opts.work_dir)
+
+  results = run_benchmarks(opts)
+  with open(opts.output, 'w') as f:
+    json.dump(results, f, indent=2, separators=(',', ': '))
+    f.write('\n')
+  print('Results written to %s' % opts.output)
+
+  num_regressions = 0
+  if opts.baseline:
+    with open(opts.baseline) as f:
+      baseline = json.load(f)
+    num_regressions = compare_results(baseline, results, opts.alpha, opts.min_change)
+  if remove_work_dir:
+    shutil.rmtree(opts.work_dir)
+  sys.exit(1 if num_regressions else 0)
+
+if __name__ == "__main__":
+  main()
@@ -18,6 +18,7 @@
 #include "kudu/security/tls_context.h"
 
 #include <algorithm>
+#include <limits>
 #include <mutex>
 #include <ostream>
 #include <string>
@@ -33,6 +34,7 @@
 
 #include "kudu/gutil/basictypes.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/security/ca/cert_management.h"
 #include "kudu/security/cert.h"
@@ -42,6 +44,7 @@
 #include "kudu/security/security_flags.h"
 #include "kudu/security/tls_handshake.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/status.h"
@@ -73,6 +76,13 @@ using std::string;
 using std::unique_lock;
 using std::vector;
 
+DEFINE_int32(rpc_tls_session_timeout_seconds, 600,
+             "The time, in seconds, for which the TLS sessions of RPC connections "
+             "may be resumed by new connections between the same endpoints, "
+             "which then skip the key exchange and the certificate verification "
+             "of a full TLS handshake. Set to 0 to disable TLS session resumption.");
+TAG_FLAG(rpc_tls_session_timeout_seconds, advanced);
+
 DEFINE_int32(ipki_server_key_size, 2048,
              "the number of bits for server cert's private key. The server cert "
              "is used for TLS connections to and from clients and other servers.");
@@ -86,12 +96,21 @@ using ca::CertRequestGenerator;
 template<> struct SslTypeTraits<SSL> {
   static constexpr auto kFreeFunc = &SSL_free;
 };
+template<> struct SslTypeTraits<SSL_SESSION> {
+  static constexpr auto kFreeFunc = &SSL_SESSION_free;
+};
 template<> struct SslTypeTraits<X509_STORE_CTX> {
   static constexpr auto kFreeFunc = &X509_STORE_CTX_free;
 };
 
 namespace {
 
+// Sessions are only resumed by contexts with the same ID context.
+const unsigned char kSessionIdContext[] = "kudu-rpc";
+
+// The maximum number of TLS sessions cached by a client.
+const size_t kMaxClientSessions = 1024;
+
 Status CheckMaxSupportedTlsVersion(int tls_version, const char* tls_version_str) {
   // OpenSSL 1.1 and newer supports all of the TLS versions we care about, so
   // the below check is only necessary in older versions of OpenSSL.
@@ -143,7 +162,10 @@ Status TlsContext::Init() {
   if (!ctx_) {
     return Status::RuntimeError("failed to create TLS context", GetOpenSSLErrors());
   }
-  SSL_CTX_set_mode(ctx_.get(), SSL_MODE_AUTO_RETRY | SSL_MODE_ENABLE_PARTIAL_WRITE);
+  // TlsSocket::Writev() may retry a write with a different buffer holding the
+  // same data.
+  SSL_CTX_set_mode(ctx_.get(), SSL_MODE_AUTO_RETRY | SSL_MODE_ENABLE_PARTIAL_WRITE |
+                               SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
 
   // Disable SSLv2 and SSLv3 which are vulnerable to various issues such as POODLE.
   // We support versions back to TLSv1.0 since OpenSSL on RHEL 6.4 and earlier does not
@@ -190,6 +212,21 @@ Status TlsContext::Init() {
 #endif
 #endif
 
+  // Servers cache the sessions of their clients, which may then resume them
+  // instead of doing a full handshake. Session tickets are disabled so that
+  // the sessions remain under the control of the server, which flushes them
+  // when its certificates change (see FlushSessionsUnlocked()).
+  if (FLAGS_rpc_tls_session_timeout_seconds > 0) {
+    SSL_CTX_set_session_cache_mode(ctx_.get(), SSL_SESS_CACHE_SERVER);
+    SSL_CTX_set_timeout(ctx_.get(), FLAGS_rpc_tls_session_timeout_seconds);
+    OPENSSL_RET_NOT_OK(SSL_CTX_set_session_id_context(ctx_.get(), kSessionIdContext,
+                                                      sizeof(kSessionIdContext) - 1),
+                       "failed to set TLS session ID context");
+  } else {
+    SSL_CTX_set_session_cache_mode(ctx_.get(), SSL_SESS_CACHE_OFF);
+  }
+  SSL_CTX_set_options(ctx_.get(), SSL_OP_NO_TICKET);
+
   // TODO(KUDU-1926): is it possible to disable client-side renegotiation? it seems there
   // have been various CVEs related to this feature that we don't need.
   return Status::OK();
@@ -247,6 +284,7 @@ Status TlsContext::UseCertificateAndKey(const Cert& cert, const PrivateKey& key)
   OPENSSL_RET_NOT_OK(SSL_CTX_use_certificate(ctx_.get(), cert.GetTopOfChainX509()),
                      "failed to use certificate");
   has_cert_ = true;
+  FlushSessionsUnlocked();
   return Status::OK();
 }
 
@@ -290,6 +328,7 @@ Status TlsContext::AddTrustedCertificate(const Cert& cert) {
     }
   }
   trusted_cert_count_ += 1;
+  FlushSessionsUnlocked();
   return Status::OK();
 }
 
@@ -402,6 +441,7 @@ Status TlsContext::GenerateSelfSignedCertAndKey() {
                      "failed to use certificate");
   has_cert_ = true;
   csr_ = std::move(csr);
+  FlushSessionsUnlocked();
   return Status::OK();
 }
 
@@ -449,6 +489,7 @@ Status TlsContext::AdoptSignedCert(const Cert& cert) {
     << "certificate does not match the private key";
 
   csr_ = boost::none;
+  FlushSessionsUnlocked();
 
   return Status::OK();
 }
@@ -488,7 +529,8 @@ Status TlsContext::LoadCertificateAuthority(const string& certificate_path) {
 }
 
 Status TlsContext::InitiateHandshake(TlsHandshakeType handshake_type,
-                                     TlsHandshake* handshake) const {
+                                     TlsHandshake* handshake,
+                                     const string& session_key) const {
   SCOPED_OPENSSL_NO_PENDING_ERRORS;
   CHECK(ctx_);
   CHECK(!handshake->ssl_);
@@ -510,11 +552,51 @@ Status TlsContext::InitiateHandshake(TlsHandshakeType handshake_type,
       break;
     case TlsHandshakeType::CLIENT:
       SSL_set_connect_state(handshake->ssl());
+      if (!session_key.empty() && FLAGS_rpc_tls_session_timeout_seconds > 0) {
+        handshake->context_ = this;
+        handshake->session_key_ = session_key;
+        std::lock_guard<simple_spinlock> l(sessions_lock_);
+        const auto* session = FindOrNull(client_sessions_, session_key);
+        if (session && SSL_set_session(handshake->ssl(), session->get()) != 1) {
+          // Fall back to a full handshake.
+          ERR_clear_error();
+        }
+      }
       break;
   }
 
   return Status::OK();
 }
 
+void TlsContext::CacheSession(const string& session_key, SSL* ssl) const {
+  if (SSL_session_reused(ssl)) {
+    return;
+  }
+  c_unique_ptr<SSL_SESSION> session = ssl_make_unique(SSL_get1_session(ssl));
+  if (!session) {
+    return;
+  }
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+  // With TLS 1.3, the resumable sessions are only sent by the server after the
+  // handshake.
+  if (!SSL_SESSION_is_resumable(session.get())) {
+    return;
+  }
+#endif
+  std::lock_guard<simple_spinlock> l(sessions_lock_);
+  if (client_sessions_.size() >= kMaxClientSessions) {
+    client_sessions_.clear();
+  }
+  client_sessions_[session_key] = std::move(session);
+}
+
+void TlsContext::FlushSessionsUnlocked() {
+  // The sessions were established with the former certificates, which a
+  // resumed session would keep presenting and trusting.
+  SSL_CTX_flush_sessions(ctx_.get(), std::numeric_limits<long>::max());
+  std::lock_guard<simple_spinlock> l(sessions_lock_);
+  client_sessions_.clear();
+}
+
 } // namespace security
 } // namespace kudu
@@ -17,9 +17,11 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/optional/optional.hpp>
@@ -65,6 +67,11 @@ class PrivateKey;
 // connections, when mutual TLS authentication is not needed (for example, for
 // token or Kerberos authenticated connections).
 //
+// Clients keep the sessions of their verified handshakes, which new
+// connections to the same servers may resume (see InitiateHandshake()), and
+// servers cache the sessions of their clients. Both are flushed when the
+// context's certificates or trust store change.
+//
 // This class is thread-safe after initialization.
 class TlsContext {
 
@@ -161,8 +168,14 @@ class TlsContext {
   Status LoadCertificateAuthority(const std::string& certificate_path) WARN_UNUSED_RESULT;
 
   // Initiates a new TlsHandshake instance.
+  //
+  // If 'session_key' is not empty, a client handshake resumes the session last
+  // cached with the same key, if any, and its session is cached with the key
+  // once it's verified. The key must identify the server and the verification
+  // mode of the handshake.
   Status InitiateHandshake(TlsHandshakeType handshake_type,
-                           TlsHandshake* handshake) const WARN_UNUSED_RESULT;
+                           TlsHandshake* handshake,
+                           const std::string& session_key = "") const WARN_UNUSED_RESULT;
 
   // Return the number of certs that have been marked as trusted.
   // Used by tests.
@@ -174,9 +187,18 @@ class TlsContext {
   bool is_external_cert() const { return is_external_cert_; }
 
  private:
+  friend class TlsHandshake;
 
   Status VerifyCertChainUnlocked(const Cert& cert) WARN_UNUSED_RESULT;
 
+  // Caches the session of the verified client handshake of 'ssl' with the key
+  // 'session_key'.
+  void CacheSession(const std::string& session_key, SSL* ssl) const;
+
+  // Flushes the cached client and server sessions. Called with 'lock_' held in
+  // write mode whenever the certificates change.
+  void FlushSessionsUnlocked();
+
   // The cipher suite preferences to use for TLS-secured RPC connections. Uses the OpenSSL
   // cipher preference list format. See man (1) ciphers for more information.
   std::string tls_ciphers_;
@@ -196,6 +218,12 @@ class TlsContext {
   bool has_cert_;
   bool is_external_cert_;
   boost::optional<CertSignRequest> csr_;
+
+  // Protects 'client_sessions_'.
+  mutable simple_spinlock sessions_lock_;
+
+  // The sessions of the client handshakes, keyed by their session keys.
+  mutable std::unordered_map<std::string, c_unique_ptr<SSL_SESSION>> client_sessions_;
 };
 
 } // namespace security
@@ -34,6 +34,7 @@
 #include "kudu/security/security-test-util.h"
 #include "kudu/security/tls_context.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/net/socket.h"
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
@@ -89,10 +90,16 @@ class TestTlsHandshakeBase : public KuduTest {
  protected:
   // Run a handshake using 'client_tls_' and 'server_tls_'. The client and server
   // verification modes are set to 'client_verify' and 'server_verify' respectively.
+  //
+  // If 'session_key' is not empty, the client resumes and caches the session
+  // with that key, and 'session_reused' is set to whether it was resumed.
   Status RunHandshake(TlsVerificationMode client_verify,
-                      TlsVerificationMode server_verify) {
+                      TlsVerificationMode server_verify,
+                      const string& session_key = "",
+                      bool* session_reused = nullptr) {
     TlsHandshake client, server;
-    RETURN_NOT_OK(client_tls_.InitiateHandshake(TlsHandshakeType::CLIENT, &client));
+    RETURN_NOT_OK(client_tls_.InitiateHandshake(TlsHandshakeType::CLIENT, &client,
+                                                session_key));
     RETURN_NOT_OK(server_tls_.InitiateHandshake(TlsHandshakeType::SERVER, &server));
 
     client.set_verification_mode(client_verify);
@@ -113,7 +120,7 @@ class TestTlsHandshakeBase : public KuduTest {
         }
       }
       if (!server_done) {
-        CHECK(!client_done);
+        // The server finishes first, unless the session is resumed.
         Status s = server.Continue(to_server, &to_client);
         VLOG(1) << "server->client: " << to_client.size() << " bytes";
         if (s.ok()) {
@@ -124,6 +131,12 @@ class TestTlsHandshakeBase : public KuduTest {
         }
       }
     }
+    if (session_reused) {
+      *session_reused = client.session_reused();
+    }
+    if (!session_key.empty()) {
+      RETURN_NOT_OK(client.FinishNoWrap(Socket()));
+    }
     return Status::OK();
   }
 
@@ -280,6 +293,44 @@ TEST_F(TestTlsHandshake, TestTlsContextCertTransition) {
                          TlsVerificationMode::VERIFY_NONE));
 }
 
+// Checks that clients resume their verified sessions, until the certificates
+// of either end change.
+TEST_F(TestTlsHandshake, TestSessionResumption) {
+  PrivateKey ca_key;
+  Cert ca_cert;
+  ASSERT_OK(GenerateSelfSignedCAForTests(&ca_key, &ca_cert));
+  ASSERT_OK(ConfigureTlsContext(PkiConfig::SIGNED, ca_cert, ca_key, &client_tls_));
+  ASSERT_OK(ConfigureTlsContext(PkiConfig::SIGNED, ca_cert, ca_key, &server_tls_));
+
+  const auto kVerify = TlsVerificationMode::VERIFY_REMOTE_CERT_AND_HOST;
+  bool reused;
+  ASSERT_OK(RunHandshake(kVerify, kVerify, "server", &reused));
+  ASSERT_FALSE(reused);
+  ASSERT_OK(RunHandshake(kVerify, kVerify, "server", &reused));
+  ASSERT_TRUE(reused);
+
+  // Sessions are only resumed with the same key.
+  ASSERT_OK(RunHandshake(kVerify, kVerify, "other-server", &reused));
+  ASSERT_FALSE(reused);
+  ASSERT_OK(RunHandshake(kVerify, kVerify, "", &reused));
+  ASSERT_FALSE(reused);
+
+  // Changing the trust store of the client drops its sessions.
+  PrivateKey other_ca_key;
+  Cert other_ca_cert;
+  ASSERT_OK(GenerateSelfSignedCAForTests(&other_ca_key, &other_ca_cert));
+  ASSERT_OK(client_tls_.AddTrustedCertificate(other_ca_cert));
+  ASSERT_OK(RunHandshake(kVerify, kVerify, "server", &reused));
+  ASSERT_FALSE(reused);
+  ASSERT_OK(RunHandshake(kVerify, kVerify, "server", &reused));
+  ASSERT_TRUE(reused);
+
+  // So does changing that of the server.
+  ASSERT_OK(server_tls_.AddTrustedCertificate(other_ca_cert));
+  ASSERT_OK(RunHandshake(kVerify, kVerify, "server", &reused));
+  ASSERT_FALSE(reused);
+}
+
 TEST_P(TestTlsHandshake, TestHandshake) {
   Case test_case = GetParam();
 
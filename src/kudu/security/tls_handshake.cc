@@ -27,6 +27,7 @@
 #include "kudu/gutil/strings/strip.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/security/cert.h"
+#include "kudu/security/tls_context.h"
 #include "kudu/security/tls_socket.h"
 #include "kudu/util/net/socket.h"
 #include "kudu/util/status.h"
@@ -200,6 +201,7 @@ Status TlsHandshake::Finish(unique_ptr<Socket>* socket) {
   SCOPED_OPENSSL_NO_PENDING_ERRORS;
   RETURN_NOT_OK(GetCerts());
   RETURN_NOT_OK(Verify(**socket));
+  CacheSession();
 
   int fd = (*socket)->Release();
 
@@ -219,7 +221,15 @@ Status TlsHandshake::Finish(unique_ptr<Socket>* socket) {
 Status TlsHandshake::FinishNoWrap(const Socket& socket) {
   SCOPED_OPENSSL_NO_PENDING_ERRORS;
   RETURN_NOT_OK(GetCerts());
-  return Verify(socket);
+  RETURN_NOT_OK(Verify(socket));
+  CacheSession();
+  return Status::OK();
+}
+
+void TlsHandshake::CacheSession() {
+  if (context_ && !session_key_.empty()) {
+    context_->CacheSession(session_key_, ssl_.get());
+  }
 }
 
 Status TlsHandshake::GetLocalCert(Cert* cert) const {
@@ -252,6 +262,11 @@ string TlsHandshake::GetProtocol() const {
   return SSL_get_version(ssl_.get());
 }
 
+bool TlsHandshake::session_reused() const {
+  CHECK(has_started_);
+  return SSL_session_reused(ssl_.get());
+}
+
 string TlsHandshake::GetCipherDescription() const {
   SCOPED_OPENSSL_NO_PENDING_ERRORS;
   CHECK(has_started_);
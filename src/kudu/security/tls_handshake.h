@@ -34,6 +34,8 @@ class Socket;
 
 namespace security {
 
+class TlsContext;
+
 enum class TlsHandshakeType {
   // The local endpoint is the TLS client (initiator).
   CLIENT,
@@ -130,6 +132,10 @@ class TlsHandshake {
   // handshake is complete and before 'Finish()'.
   std::string GetProtocol() const;
 
+  // Returns true if the handshake resumed a previous session. Only valid to
+  // call after the handshake is complete and before 'Finish()'.
+  bool session_reused() const;
+
   // Retrive the description of the negotiated cipher.
   // Only valid to call after the handshake is complete and before 'Finish()'.
   std::string GetCipherDescription() const;
@@ -160,9 +166,17 @@ class TlsHandshake {
   // Verifies that the handshake is valid for the provided socket.
   Status Verify(const Socket& socket) const WARN_UNUSED_RESULT;
 
+  // Caches the session of the verified handshake, if it has a session key.
+  void CacheSession();
+
   // Owned SSL handle.
   c_unique_ptr<SSL> ssl_;
 
+  // The context caching the session of a client handshake under
+  // 'session_key_', if any. Set by TlsContext::InitiateHandshake.
+  const TlsContext* context_ = nullptr;
+  std::string session_key_;
+
   Cert local_cert_;
   Cert remote_cert_;
 };
@@ -19,12 +19,15 @@
 
 #include <sys/uio.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <string>
 #include <utility>
 
 #include <glog/logging.h>
 #include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/ssl3.h>
 
 #include "kudu/gutil/basictypes.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -39,6 +42,13 @@ using strings::Substitute;
 namespace kudu {
 namespace security {
 
+namespace {
+
+// The maximum size of the data of a TLS record.
+const size_t kMaxRecordSize = SSL3_RT_MAX_PLAIN_LENGTH;
+
+} // anonymous namespace
+
 TlsSocket::TlsSocket(int fd, c_unique_ptr<SSL> ssl)
     : Socket(fd),
       ssl_(std::move(ssl)) {
@@ -87,16 +97,55 @@ Status TlsSocket::Writev(const struct ::iovec *iov, int iov_len, int64_t *nwritt
   // Allows packets to be aggresively be accumulated before sending.
   RETURN_NOT_OK(SetTcpCork(1));
   Status write_status = Status::OK();
-  for (int i = 0; i < iov_len; ++i) {
-    int32_t frame_size = iov[i].iov_len;
+  // The position of the next byte to write: its iovec, and its offset in it.
+  int i = 0;
+  size_t offset = 0;
+  while (true) {
+    // Skip the empty buffers: SSL_write() can't write them.
+    while (i < iov_len && iov[i].iov_len == offset) {
+      i++;
+      offset = 0;
+    }
+    if (i == iov_len) break;
+
+    const uint8_t* buf = static_cast<const uint8_t*>(iov[i].iov_base) + offset;
+    size_t len = iov[i].iov_len - offset;
+    // Each SSL_write() produces at least one record, which is encrypted and
+    // authenticated separately, so the small buffers (such as the headers of
+    // the RPC calls) which follow each other are coalesced into full records.
+    //
+    // If SSL_write() can't make progress, the next call to Writev() starts
+    // at the same position with at least the same buffers, so it retries
+    // with at least the same bytes, as OpenSSL requires.
+    if (len < kMaxRecordSize && i + 1 < iov_len) {
+      write_buf_.clear();
+      write_buf_.append(buf, len);
+      for (int j = i + 1; j < iov_len && write_buf_.size() < kMaxRecordSize; j++) {
+        write_buf_.append(iov[j].iov_base,
+                          std::min(iov[j].iov_len, kMaxRecordSize - write_buf_.size()));
+      }
+      buf = write_buf_.data();
+      len = write_buf_.size();
+    }
     int32_t bytes_written;
     // Don't return before unsetting TCP_CORK.
-    write_status = Write(static_cast<uint8_t*>(iov[i].iov_base), frame_size, &bytes_written);
+    write_status = Write(buf, len, &bytes_written);
     if (!write_status.ok()) break;
+    // The socket is not ready to write more.
+    if (bytes_written == 0) break;
 
     // nwritten should have the correct amount written.
     *nwritten += bytes_written;
-    if (bytes_written < frame_size) break;
+    size_t to_skip = bytes_written;
+    while (to_skip > 0) {
+      size_t n = std::min(to_skip, iov[i].iov_len - offset);
+      to_skip -= n;
+      offset += n;
+      if (offset == iov[i].iov_len) {
+        i++;
+        offset = 0;
+      }
+    }
   }
   RETURN_NOT_OK(SetTcpCork(0));
   // If we did manage to write something, but not everything, due to a temporary socket
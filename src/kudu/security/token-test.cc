@@ -720,6 +720,38 @@ TEST_F(TokenTest, TestEndToEnd_InvalidCases) {
   }
 }
 
+// Test that tokens whose signatures were verified are only trusted again if
+// they're presented unchanged.
+TEST_F(TokenTest, TestVerifiedTokenCache) {
+  TokenSigner signer(kTokenValiditySeconds, kTokenValiditySeconds, 10);
+  {
+    std::unique_ptr<TokenSigningPrivateKey> key;
+    ASSERT_OK(signer.CheckNeedKey(&key));
+    ASSERT_NE(nullptr, key.get());
+    ASSERT_OK(signer.AddKey(std::move(key)));
+  }
+  TokenVerifier verifier;
+  ASSERT_OK(verifier.ImportKeys(signer.verifier().ExportKeys()));
+
+  SignedTokenPB signed_token = MakeUnsignedToken(WallTime_Now() + 600);
+  ASSERT_OK(signer.SignToken(&signed_token));
+  for (int i = 0; i < 2; i++) {
+    TokenPB token;
+    ASSERT_EQ(VerificationResult::VALID, verifier.VerifyTokenSignature(signed_token, &token));
+    ASSERT_TRUE(token.has_expire_unix_epoch_seconds());
+  }
+
+  // The signature of a verified token doesn't vouch for other data.
+  {
+    SignedTokenPB forged_token = MakeUnsignedToken(WallTime_Now() + 1200);
+    forged_token.set_signature(signed_token.signature());
+    forged_token.set_signing_key_seq_num(signed_token.signing_key_seq_num());
+    TokenPB token;
+    ASSERT_EQ(VerificationResult::INVALID_SIGNATURE,
+              verifier.VerifyTokenSignature(forged_token, &token));
+  }
+}
+
 // Test functionality of the TokenVerifier::ImportKeys() method.
 TEST_F(TokenTest, TestTokenVerifierImportKeys) {
   TokenVerifier verifier;
@@ -25,16 +25,27 @@
 #include <utility>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "kudu/gutil/endian.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/walltime.h"
 #include "kudu/security/token.pb.h"
 #include "kudu/security/token_signing_key.h"
+#include "kudu/util/cache.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
+DEFINE_int32(token_verifier_cache_capacity_mb, 4,
+             "The capacity, in MiB, of the cache of the tokens whose signatures "
+             "were verified by a server, which skips the verification of the "
+             "signatures of tokens presented again. Set to 0 to disable the cache.");
+TAG_FLAG(token_verifier_cache_capacity_mb, advanced);
+
 using std::lock_guard;
 using std::string;
 using std::transform;
@@ -44,7 +55,25 @@ using std::vector;
 namespace kudu {
 namespace security {
 
+namespace {
+
+// Returns the key of 'signed_token' in the cache of verified tokens.
+string VerifiedTokenKey(const SignedTokenPB& signed_token) {
+  string key(sizeof(uint64_t), '\0');
+  BigEndian::Store64(&key[0], signed_token.signing_key_seq_num());
+  key.append(signed_token.signature());
+  key.append(signed_token.token_data());
+  return key;
+}
+
+} // anonymous namespace
+
 TokenVerifier::TokenVerifier() {
+  if (FLAGS_token_verifier_cache_capacity_mb > 0) {
+    verified_tokens_.reset(NewCache<Cache::EvictionPolicy::LRU>(
+        static_cast<size_t>(FLAGS_token_verifier_cache_capacity_mb) * 1024 * 1024,
+        "verified-token-cache"));
+  }
 }
 
 TokenVerifier::~TokenVerifier() {
@@ -129,6 +158,7 @@ VerificationResult TokenVerifier::VerifyTokenSignature(const SignedTokenPB& sign
     }
   }
 
+  string cache_key;
   {
     shared_lock<RWMutex> l(lock_);
     auto* tsk = FindPointeeOrNull(keys_by_seq_, signed_token.signing_key_seq_num());
@@ -138,11 +168,27 @@ VerificationResult TokenVerifier::VerifyTokenSignature(const SignedTokenPB& sign
     if (tsk->pb().expire_unix_epoch_seconds() < now) {
       return VerificationResult::EXPIRED_SIGNING_KEY;
     }
+    if (verified_tokens_) {
+      // Keys are never replaced, so a token verified with the key of its
+      // sequence number remains so.
+      cache_key = VerifiedTokenKey(signed_token);
+      Cache::UniqueHandle h(verified_tokens_->Lookup(cache_key, Cache::EXPECT_IN_CACHE),
+                            Cache::HandleDeleter(verified_tokens_.get()));
+      if (h) {
+        return VerificationResult::VALID;
+      }
+    }
     if (!tsk->VerifySignature(signed_token)) {
       return VerificationResult::INVALID_SIGNATURE;
     }
   }
 
+  if (verified_tokens_) {
+    Cache::PendingHandle* pending = verified_tokens_->Allocate(cache_key, 0);
+    if (pending) {
+      verified_tokens_->Release(verified_tokens_->Insert(pending, nullptr));
+    }
+  }
   return VerificationResult::VALID;
 }
 
@@ -27,6 +27,7 @@
 
 namespace kudu {
 
+class Cache;
 class Status;
 
 namespace security {
@@ -54,6 +55,12 @@ enum class VerificationResult;
 // and is not yet expired. Any business rules around authorization or
 // authentication are left up to callers.
 //
+// The tokens whose signatures are verified are kept in a bounded LRU cache,
+// so that a token presented again, e.g. the authz token of every scan of a
+// table by a client, skips the signature verification. The other checks,
+// including those of the token's and the signing key's expiration, are done
+// every time.
+//
 // NOTE: old tokens are never removed from the underlying storage of this
 // class. The assumption is that tokens rotate so infreqeuently that this
 // slow leak is not worrisome. If this class is adopted for any use cases
@@ -95,6 +102,11 @@ class TokenVerifier {
   mutable RWMutex lock_;
   KeysMap keys_by_seq_;
 
+  // The signed tokens whose signatures were verified, keyed by the signing
+  // key sequence number, the signature and the token data. Null if
+  // --token_verifier_cache_capacity_mb is 0.
+  std::unique_ptr<Cache> verified_tokens_;
+
   DISALLOW_COPY_AND_ASSIGN(TokenVerifier);
 };
 
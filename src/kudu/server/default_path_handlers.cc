@@ -324,13 +324,26 @@ void AddDefaultPathHandlers(Webserver* webserver) {
 }
 
 
+// Sets 'requested_metrics' to the metrics requested by 'req', all of them by
+// default.
+static void GetRequestedMetrics(const Webserver::WebRequest& req,
+                                vector<string>* requested_metrics) {
+  const string* requested_metrics_param = FindOrNull(req.parsed_args, "metrics");
+  if (requested_metrics_param != nullptr) {
+    SplitStringUsing(*requested_metrics_param, ",", requested_metrics);
+  } else {
+    // Default to including all metrics.
+    requested_metrics->emplace_back("*");
+  }
+}
+
 static void WriteMetricsAsJson(const MetricRegistry* const metrics,
                                const Webserver::WebRequest& req,
-                               Webserver::PrerenderedWebResponse* resp) {
-  ostringstream* output = resp->output;
-  const string* requested_metrics_param = FindOrNull(req.parsed_args, "metrics");
+                               std::ostream* output) {
   vector<string> requested_metrics;
+  GetRequestedMetrics(req, &requested_metrics);
   MetricJsonOptions opts;
+ = FindOrNull(req.parsed_args, "metrics");
 
   {
     string arg = FindWithDefault(req.parsed_args, "include_raw_histograms", "false");
@@ -348,31 +361,49 @@ static void WriteMetricsAsJson(const MetricRegistry* const metrics,
   }
 
   JsonWriter writer(output, json_mode);
-
-  if (requested_metrics_param != nullptr) {
-    SplitStringUsing(*requested_metrics_param, ",", &requested_metrics);
-  } else {
-    // Default to including all metrics.
-    requested_metrics.emplace_back("*");
-  }
-
   WARN_NOT_OK(metrics->WriteAsJson(&writer, requested_metrics, opts),
               "Couldn't write JSON metrics over HTTP");
 }
 
+// Writes the metrics in the Prometheus text format. Besides 'metrics', the
+// request may set 'types', the comma-separated entity types to include, and
+// 'merge_by', the entity attribute whose values the metrics are summed by.
+static void WriteMetricsAsPrometheus(const MetricRegistry* const metrics,
+                                     const Webserver::WebRequest& req,
+                                     std::ostream* output) {
+  vector<string> requested_metrics;
+  GetRequestedMetrics(req, &requested_metrics);
+  MetricPrometheusOptions opts;
+  const string* types = FindOrNull(req.parsed_args, "types");
+  if (types != nullptr) {
+    SplitStringUsing(*types, ",", &opts.entity_types);
+  }
+  opts.merge_by_attribute = FindWithDefault(req.parsed_args, "merge_by", "");
+  {
+    string arg = FindWithDefault(req.parsed_args, "include_untouched", "true");
+    opts.include_untouched_metrics = ParseLeadingBoolValue(arg.c_str(), true);
+  }
+  WARN_NOT_OK(metrics->WriteAsPrometheus(output, requested_metrics, opts),
+              "Couldn't write Prometheus metrics over HTTP");
+}
+
 void RegisterMetricsJsonHandler(Webserver* webserver, const MetricRegistry* const metrics) {
-  Webserver::PrerenderedPathHandlerCallback callback = boost::bind(WriteMetricsAsJson, metrics,
-                                                                   _1, _2);
-  bool not_styled = false;
+  Webserver::StreamingPathHandlerCallback callback = boost::bind(WriteMetricsAsJson, metrics,
+                                                                 _1, _2);
   bool not_on_nav_bar = false;
   bool is_on_nav_bar = true;
-  webserver->RegisterPrerenderedPathHandler("/metrics", "Metrics", callback,
-                                            not_styled, is_on_nav_bar);
+  webserver->RegisterStreamingPathHandler("/metrics", "Metrics", callback,
+                                          "text/plain", is_on_nav_bar);
 
   // The old name -- this is preserved for compatibility with older releases of
   // monitoring software which expects the old name.
-  webserver->RegisterPrerenderedPathHandler("/jsonmetricz", "Metrics", callback,
-                                            not_styled, not_on_nav_bar);
+  webserver->RegisterStreamingPathHandler("/jsonmetricz", "Metrics", callback,
+                                          "text/plain", not_on_nav_bar);
+
+  webserver->RegisterStreamingPathHandler(
+      "/metrics_prometheus", "Prometheus Metrics",
+      boost::bind(WriteMetricsAsPrometheus, metrics, _1, _2),
+      "text/plain; version=0.0.4", not_on_nav_bar);
 }
 
 } // namespace kudu
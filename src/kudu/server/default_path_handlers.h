@@ -27,7 +27,8 @@ class Webserver;
 // logs and configuration flags.
 void AddDefaultPathHandlers(Webserver* webserver);
 
-// Adds an endpoint to get metrics in JSON format.
+// Adds endpoints to get metrics in JSON format and in the Prometheus text
+// format.
 void RegisterMetricsJsonHandler(Webserver* webserver, const MetricRegistry* const metrics);
 
 } // namespace kudu
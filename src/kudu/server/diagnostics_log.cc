@@ -37,6 +37,7 @@
 #include "kudu/gutil/walltime.h"
 #include "kudu/util/array_view.h"
 #include "kudu/util/condition_variable.h"
+#include "kudu/util/cpu_sampler.h"
 #include "kudu/util/debug-util.h"
 #include "kudu/util/env.h"
 #include "kudu/util/flag_tags.h"
@@ -79,9 +80,55 @@ DEFINE_int32(diagnostics_log_stack_traces_interval_ms, 60000,
 TAG_FLAG(diagnostics_log_stack_traces_interval_ms, runtime);
 TAG_FLAG(diagnostics_log_stack_traces_interval_ms, experimental);
 
+DEFINE_int32(diagnostics_log_cpu_sampling_hz, 100,
+             "The frequency, in samples per second of CPU time, at which the server samples "
+             "the stacks of its threads using the CPU. The samples are attributed to their "
+             "thread pool and tablet, and aggregated into the diagnostics log every "
+             "--diagnostics_log_cpu_samples_interval_ms. Setting this to 0 disables CPU "
+             "sampling.");
+TAG_FLAG(diagnostics_log_cpu_sampling_hz, runtime);
+TAG_FLAG(diagnostics_log_cpu_sampling_hz, experimental);
+
+DEFINE_int32(diagnostics_log_cpu_samples_interval_ms, 60000,
+             "The interval at which the server logs the CPU samples aggregated since the "
+             "previous interval to the diagnostics log.");
+TAG_FLAG(diagnostics_log_cpu_samples_interval_ms, runtime);
+TAG_FLAG(diagnostics_log_cpu_samples_interval_ms, experimental);
+
+static bool ValidateCpuSamplingHz(const char* flagname, int32_t value) {
+  if (value >= 0 && value <= 1000) {
+    return true;
+  }
+  LOG(ERROR) << Substitute("$0 must be between 0 and 1000, value $1 is invalid",
+                           flagname, value);
+  return false;
+}
+DEFINE_validator(diagnostics_log_cpu_sampling_hz, &ValidateCpuSamplingHz);
+
 namespace kudu {
 namespace server {
 
+namespace {
+
+// Writes a 'symbols' record for 'new_symbols' to 'buf', if not empty.
+void WriteSymbolsRecord(MicrosecondsInt64 now,
+                        const vector<pair<void*, string>>& new_symbols,
+                        std::ostringstream* buf) {
+  if (new_symbols.empty()) return;
+  *buf << "I" << FormatTimestampForLog(now)
+       << " symbols " << now << " ";
+  JsonWriter jw(buf, JsonWriter::COMPACT);
+  jw.StartObject();
+  for (auto& p : new_symbols) {
+    jw.String(StringPrintf("%p", p.first));
+    jw.String(p.second);
+  }
+  jw.EndObject();
+  *buf << "\n";
+}
+
+} // anonymous namespace
+
 // Track which symbols have been emitted to the log already.
 class DiagnosticsLog::SymbolSet {
  public:
@@ -115,7 +162,8 @@ DiagnosticsLog::DiagnosticsLog(string log_dir,
     metric_registry_(metric_registry),
     wake_(&lock_),
     metrics_log_interval_(MonoDelta::FromSeconds(60)),
-    symbols_(new SymbolSet()) {
+    symbols_(new SymbolSet()),
+    cpu_sampler_(new CpuSampler()) {
 }
 DiagnosticsLog::~DiagnosticsLog() {
   Stop();
@@ -143,8 +191,10 @@ Status DiagnosticsLog::Start() {
   if (!s.ok()) {
     // Don't leave the log open if we failed to start our thread.
     log_.reset();
+    return s;
   }
-  return s;
+  UpdateCpuSampler();
+  return Status::OK();
 }
 
 void DiagnosticsLog::Stop() {
@@ -158,6 +208,8 @@ void DiagnosticsLog::Stop() {
   thread_->Join();
   thread_.reset();
   stop_ = false;
+  cpu_sampler_->Stop();
+  cpu_sampling_hz_ = 0;
   WARN_NOT_OK(log_->Close(), "Unable to close diagnostics log");
 }
 
@@ -183,6 +235,12 @@ MonoTime DiagnosticsLog::ComputeNextWakeup(DiagnosticsLog::WakeupType type) cons
       break;
     case WakeupType::METRICS:
       return MonoTime::Now() + metrics_log_interval_;
+    case WakeupType::CPU_SAMPLES:
+      // As with the stacks, wake up periodically even if the logging is
+      // disabled, to notice changes of the flags.
+      return MonoTime::Now() + MonoDelta::FromMilliseconds(
+          FLAGS_diagnostics_log_cpu_samples_interval_ms > 0 ?
+          FLAGS_diagnostics_log_cpu_samples_interval_ms : 5000);
   }
   __builtin_unreachable();
 }
@@ -195,6 +253,7 @@ void DiagnosticsLog::RunThread() {
   priority_queue<QueueElem, vector<QueueElem>, std::greater<QueueElem>> wakeups;
   wakeups.emplace(ComputeNextWakeup(WakeupType::METRICS), WakeupType::METRICS);
   wakeups.emplace(ComputeNextWakeup(WakeupType::STACKS), WakeupType::STACKS);
+  wakeups.emplace(ComputeNextWakeup(WakeupType::CPU_SAMPLES), WakeupType::CPU_SAMPLES);
 
   while (!stop_) {
     MonoTime next_log = wakeups.top().first;
@@ -225,6 +284,8 @@ void DiagnosticsLog::RunThread() {
       WARN_NOT_OK(LogMetrics(), "Unable to collect metrics to diagnostics log");
     } else if (what == WakeupType::STACKS && FLAGS_diagnostics_log_stack_traces_interval_ms >= 0) {
       WARN_NOT_OK(LogStacks(reason), "Unable to collect stacks to diagnostics log");
+    } else if (what == WakeupType::CPU_SAMPLES) {
+      WARN_NOT_OK(LogCpuSamples(), "Unable to collect CPU samples to diagnostics log");
     }
   }
 }
@@ -249,33 +310,10 @@ Status DiagnosticsLog::LogStacks(const string& reason) {
   snap.VisitGroups([&](ArrayView<StackTraceSnapshot::ThreadInfo> group) {
       const StackTrace& stack = group[0].stack;
       for (int i = 0; i < stack.num_frames(); i++) {
-        void* addr = stack.frame(i);
-        if (symbols_->Add(addr)) {
-          char buf[1024];
-          // Subtract 1 from the address before symbolizing, because the
-          // address on the stack is actually the return address of the function
-          // call rather than the address of the call instruction itself.
-          if (google::Symbolize(static_cast<char*>(addr) - 1, buf, sizeof(buf))) {
-            new_symbols.emplace_back(addr, buf);
-          }
-          // If symbolization fails, don't bother adding it. Readers of the log
-          // will just see that it's missing from the symbol map and should handle that
-          // as an unknown symbol.
-        }
+        AddNewSymbol(stack.frame(i), &new_symbols);
       }
     });
-  if (!new_symbols.empty()) {
-    buf << "I" << FormatTimestampForLog(now)
-        << " symbols " << now << " ";
-    JsonWriter jw(&buf, JsonWriter::COMPACT);
-    jw.StartObject();
-    for (auto& p : new_symbols) {
-      jw.String(StringPrintf("%p", p.first));
-      jw.String(p.second);
-    }
-    jw.EndObject();
-    buf << "\n";
-  }
+  WriteSymbolsRecord(now, new_symbols, &buf);
 
   buf << "I" << FormatTimestampForLog(now) << " stacks " << now << " ";
   JsonWriter jw(&buf, JsonWriter::COMPACT);
@@ -318,6 +356,92 @@ Status DiagnosticsLog::LogStacks(const string& reason) {
   return Status::OK();
 }
 
+void DiagnosticsLog::AddNewSymbol(void* addr, vector<pair<void*, string>>* new_symbols) {
+  if (symbols_->Add(addr)) {
+    char buf[1024];
+    // Subtract 1 from the address before symbolizing, because the
+    // address on the stack is actually the return address of the function
+    // call rather than the address of the call instruction itself.
+    if (google::Symbolize(static_cast<char*>(addr) - 1, buf, sizeof(buf))) {
+      new_symbols->emplace_back(addr, buf);
+    }
+    // If symbolization fails, don't bother adding it. Readers of the log
+    // will just see that it's missing from the symbol map and should handle that
+    // as an unknown symbol.
+  }
+}
+
+void DiagnosticsLog::UpdateCpuSampler() {
+  const int hz = FLAGS_diagnostics_log_cpu_sampling_hz;
+  if (hz == cpu_sampling_hz_) return;
+  cpu_sampling_hz_ = hz;
+  cpu_sampler_->Stop();
+  if (hz > 0) {
+    // Only one server of a process may sample its CPU usage, e.g. in tests
+    // running several servers in the same process.
+    WARN_NOT_OK(cpu_sampler_->Start(hz), "Unable to sample CPU usage to diagnostics log");
+  }
+}
+
+Status DiagnosticsLog::LogCpuSamples() {
+  const int hz = cpu_sampler_->hz();
+  vector<CpuSampler::Sample> samples;
+  int64_t num_dropped;
+  cpu_sampler_->TakeSamples(&samples, &num_dropped);
+  // Follow the changes of the sampling frequency, once the samples taken at
+  // the previous frequency are collected.
+  UpdateCpuSampler();
+  if (samples.empty() && num_dropped == 0) {
+    return Status::OK();
+  }
+
+  std::ostringstream buf;
+  MicrosecondsInt64 now = GetCurrentTimeMicros();
+
+  // The symbols are dictionary-encoded as for the stacks records.
+  symbols_->ResetIfLogRolled(log_->roll_count());
+  vector<pair<void*, string>> new_symbols;
+  for (const auto& sample : samples) {
+    for (int i = 0; i < sample.stack.num_frames(); i++) {
+      AddNewSymbol(sample.stack.frame(i), &new_symbols);
+    }
+  }
+  WriteSymbolsRecord(now, new_symbols, &buf);
+
+  buf << "I" << FormatTimestampForLog(now) << " cpu_samples " << now << " ";
+  JsonWriter jw(&buf, JsonWriter::COMPACT);
+  jw.StartObject();
+  jw.String("hz");
+  jw.Int(hz);
+  jw.String("dropped");
+  jw.Int64(num_dropped);
+  jw.String("samples");
+  jw.StartArray();
+  for (const auto& sample : samples) {
+    jw.StartObject();
+    jw.String("thread");
+    jw.String(sample.thread);
+    if (!sample.tablet.empty()) {
+      jw.String("tablet");
+      jw.String(sample.tablet);
+    }
+    jw.String("count");
+    jw.Int64(sample.count);
+    jw.String("stack");
+    jw.StartArray();
+    for (int i = 0; i < sample.stack.num_frames(); i++) {
+      jw.String(StringPrintf("%p", sample.stack.frame(i)));
+    }
+    jw.EndArray();
+    jw.EndObject();
+  }
+  jw.EndArray();
+  jw.EndObject();
+  buf << "\n";
+
+  return log_->Append(buf.str());
+}
+
 Status DiagnosticsLog::LogMetrics() {
   MetricJsonOptions opts;
   opts.include_raw_histograms = true;
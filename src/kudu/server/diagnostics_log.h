@@ -19,6 +19,8 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <boost/optional/optional.hpp>
 
@@ -30,6 +32,7 @@
 
 namespace kudu {
 
+class CpuSampler;
 class MetricRegistry;
 class RollingLog;
 class Thread;
@@ -58,12 +61,22 @@ class DiagnosticsLog {
 
   enum class WakeupType {
     METRICS,
-    STACKS
+    STACKS,
+    CPU_SAMPLES
   };
 
   void RunThread();
   Status LogMetrics();
   Status LogStacks(const std::string& reason);
+  Status LogCpuSamples();
+
+  // Starts, stops or restarts the CPU sampler according to
+  // --diagnostics_log_cpu_sampling_hz.
+  void UpdateCpuSampler();
+
+  // Symbolizes 'addr' into 'new_symbols' if it hasn't been output to the
+  // current log file yet.
+  void AddNewSymbol(void* addr, std::vector<std::pair<void*, std::string>>* new_symbols);
 
   MonoTime ComputeNextWakeup(DiagnosticsLog::WakeupType type) const;
 
@@ -89,6 +102,11 @@ class DiagnosticsLog {
   // Out-of-line this internal data to keep the header smaller.
   std::unique_ptr<SymbolSet> symbols_;
 
+  std::unique_ptr<CpuSampler> cpu_sampler_;
+
+  // The CPU sampling frequency last requested from 'cpu_sampler_'.
+  int cpu_sampling_hz_ = 0;
+
   DISALLOW_COPY_AND_ASSIGN(DiagnosticsLog);
 };
 
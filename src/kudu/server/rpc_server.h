@@ -53,6 +53,7 @@ struct RpcServerOptions {
   uint16_t default_port;
   size_t service_queue_length;
   bool rpc_reuseport;
+  std::string unix_domain_socket_path;
 };
 
 class RpcServer {
@@ -88,6 +89,12 @@ class RpcServer {
   // to the world. Requires that the server has been Start()ed.
   Status GetAdvertisedAddresses(std::vector<Sockaddr>* addresses) const WARN_UNUSED_RESULT;
 
+  // The path of the UNIX domain socket the server accepts connections on, or
+  // an empty string if it doesn't listen on one.
+  const std::string& unix_domain_socket_path() const {
+    return options_.unix_domain_socket_path;
+  }
+
   const rpc::ServicePool* service_pool(const std::string& service_name) const;
 
   // Return all of the currently-registered service pools.
@@ -120,6 +127,12 @@ class RpcServer {
 
   std::vector<std::shared_ptr<rpc::AcceptorPool> > acceptor_pools_;
 
+  // The address of the UNIX domain socket to listen on, and its acceptor
+  // pool, if RpcServerOptions::unix_domain_socket_path is set. Kept apart
+  // from 'acceptor_pools_' so that it isn't among the bound addresses.
+  Sockaddr unix_domain_socket_addr_;
+  std::shared_ptr<rpc::AcceptorPool> unix_domain_socket_pool_;
+
   // Function called when one of this server's pools rejects an RPC due to queue overflow.
   std::function<void(rpc::ServicePool*)> too_busy_hook_;
 
@@ -86,6 +86,14 @@
 DEFINE_int32(num_reactor_threads, 4, "Number of libev reactor threads to start.");
 TAG_FLAG(num_reactor_threads, advanced);
 
+DEFINE_bool(numa_aware_rpc_threads, false,
+            "Whether to pin the RPC reactor threads and the RPC service worker "
+            "threads to the CPUs of the NUMA nodes of the machine, spreading them "
+            "over the nodes. This avoids moving threads and their data between "
+            "nodes on multi-socket machines.");
+TAG_FLAG(numa_aware_rpc_threads, advanced);
+TAG_FLAG(numa_aware_rpc_threads, experimental);
+
 DEFINE_int32(min_negotiation_threads, 0, "Minimum number of connection negotiation threads.");
 TAG_FLAG(min_negotiation_threads, advanced);
 
@@ -359,6 +367,7 @@ ServerBase::ServerBase(string name, const ServerBaseOptions& options,
       stop_background_threads_latch_(1) {
   FsManagerOpts fs_opts;
   fs_opts.metric_entity = metric_entity_;
+  fs_opts.metric_registry = metric_registry_.get();
   fs_opts.parent_mem_tracker = mem_tracker_;
   fs_opts.block_manager_type = options.fs_opts.block_manager_type;
   fs_opts.wal_root = options.fs_opts.wal_root;
@@ -471,6 +480,9 @@ Status ServerBase::Init() {
   if (options_.rpc_opts.rpc_reuseport) {
     builder.set_reuseport();
   }
+  if (FLAGS_numa_aware_rpc_threads) {
+    builder.set_numa_aware();
+  }
 
   RETURN_NOT_OK(builder.Build(&messenger_));
   rpc_server_->set_too_busy_hook(std::bind(
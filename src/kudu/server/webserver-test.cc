@@ -19,6 +19,8 @@
 
 #include <iosfwd>
 #include <memory>
+#include <ostream>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -209,6 +211,41 @@ TEST_F(WebserverTest, TestHttpCompression) {
   ASSERT_STR_CONTAINS(buf_.ToString(), "memz");
 }
 
+TEST_F(WebserverTest, TestStreamingPathHandler) {
+  // The response is larger than the buffers of the response and of the
+  // compressor, so that it's sent in several chunks.
+  const int kNumLines = 100000;
+  server_->RegisterStreamingPathHandler(
+      "/streaming", "Streaming",
+      [&](const Webserver::WebRequest& /*req*/, std::ostream* out) {
+        for (int i = 0; i < kNumLines; i++) {
+          *out << i << "\n";
+        }
+      },
+      "text/plain; version=0.0.4", false);
+  std::ostringstream expected;
+  for (int i = 0; i < kNumLines; i++) {
+    expected << i << "\n";
+  }
+  string url = strings::Substitute("http://$0/streaming", addr_.ToString());
+
+  curl_.set_return_headers(true);
+  ASSERT_OK(curl_.FetchURL(url, &buf_));
+  ASSERT_STR_CONTAINS(buf_.ToString(), "Transfer-Encoding: chunked");
+  ASSERT_STR_CONTAINS(buf_.ToString(), "Content-Type: text/plain; version=0.0.4");
+  ASSERT_STR_NOT_CONTAINS(buf_.ToString(), "Content-Length");
+
+  // Curl decodes the chunks.
+  curl_.set_return_headers(false);
+  ASSERT_OK(curl_.FetchURL(url, &buf_));
+  ASSERT_EQ(expected.str(), buf_.ToString());
+
+  ASSERT_OK(curl_.FetchURL(url, &buf_, {"Accept-Encoding: gzip"}));
+  std::ostringstream oss;
+  ASSERT_OK(zlib::Uncompress(Slice(buf_.ToString()), &oss));
+  ASSERT_EQ(expected.str(), oss.str());
+}
+
 TEST_F(SslWebserverTest, TestSSL) {
   // We use a self-signed cert, so we need to disable cert verification in curl.
   curl_.set_verify_peer(false);
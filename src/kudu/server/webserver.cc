@@ -26,7 +26,9 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <ostream>
 #include <sstream>
+#include <streambuf>
 #include <string>
 #include <unordered_set>
 #include <utility>
@@ -41,6 +43,7 @@
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/numbers.h"
 #include "kudu/gutil/strings/split.h"
@@ -55,6 +58,8 @@
 #include "kudu/util/logging.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/net/sockaddr.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
 #include "kudu/util/url-coding.h"
 #include "kudu/util/version_info.h"
 #include "kudu/util/zlib.h"
@@ -69,6 +74,7 @@ using mustache::RenderTemplate;
 using std::ostringstream;
 using std::stringstream;
 using std::string;
+using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
 
@@ -403,6 +409,118 @@ int Webserver::BeginRequestCallback(struct sq_connection* connection,
   return RunPathHandler(*handler, connection, request_info);
 }
 
+namespace {
+
+// Returns true if the client accepts gzip-compressed responses.
+bool AcceptsGzip(struct sq_connection* connection) {
+  const char* accept_encoding_str = sq_get_header(connection, "Accept-Encoding");
+  vector<string> encodings = strings::Split(accept_encoding_str, ",");
+  for (string& encoding : encodings) {
+    StripWhiteSpace(&encoding);
+    if (encoding == "gzip") {
+      return true;
+    }
+  }
+  return false;
+}
+
+// A streambuf which sends the data written to it as the body of an HTTP
+// response with the chunked transfer encoding, gzip-compressed by
+// 'compressor' if it's not null. The data is buffered into chunks of a
+// fixed size, so that the whole body is never held in memory.
+class ChunkedResponseBuf : public std::streambuf {
+ public:
+  ChunkedResponseBuf(struct sq_connection* connection,
+                     zlib::StreamingCompressor* compressor)
+      : connection_(connection),
+        compressor_(compressor),
+        failed_(false) {
+    setp(buf_, buf_ + sizeof(buf_));
+  }
+
+  // Sends the buffered data and the last chunk. Returns false if the
+  // response couldn't be sent in full, e.g. if the client went away.
+  bool Finish() {
+    if (!FlushBuffer()) {
+      return false;
+    }
+    if (compressor_) {
+      std::ostringstream compressed;
+      Status s = compressor_->Finish(&compressed);
+      if (!s.ok()) {
+        LOG(WARNING) << "Could not compress output: " << s.ToString();
+        return false;
+      }
+      if (!WriteChunk(compressed.str())) {
+        return false;
+      }
+    }
+    return Write("0\r\n\r\n");
+  }
+
+ protected:
+  int_type overflow(int_type c) override {
+    if (!FlushBuffer()) {
+      return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  int sync() override {
+    return FlushBuffer() ? 0 : -1;
+  }
+
+ private:
+  bool FlushBuffer() {
+    if (failed_) {
+      return false;
+    }
+    const Slice data(pbase(), pptr() - pbase());
+    setp(buf_, buf_ + sizeof(buf_));
+    if (!compressor_) {
+      return WriteChunk(data);
+    }
+    std::ostringstream compressed;
+    Status s = compressor_->Compress(data, &compressed);
+    if (!s.ok()) {
+      LOG(WARNING) << "Could not compress output: " << s.ToString();
+      failed_ = true;
+      return false;
+    }
+    return WriteChunk(compressed.str());
+  }
+
+  bool WriteChunk(const Slice& data) {
+    // An empty chunk would end the body.
+    if (data.empty()) {
+      return true;
+    }
+    return Write(StringPrintf("%zx\r\n", data.size())) && Write(data) && Write("\r\n");
+  }
+
+  bool Write(const Slice& data) {
+    // Make sure to use sq_write for printing the body; sq_printf truncates at 8KB.
+    if (!failed_ &&
+        sq_write(connection_, data.data(), data.size()) != static_cast<int>(data.size())) {
+      failed_ = true;
+    }
+    return !failed_;
+  }
+
+  struct sq_connection* const connection_;
+  zlib::StreamingCompressor* const compressor_;
+  bool failed_;
+  char buf_[16 * 1024];
+
+  DISALLOW_COPY_AND_ASSIGN(ChunkedResponseBuf);
+};
+
+} // anonymous namespace
+
 int Webserver::RunPathHandler(const PathHandler& handler,
                               struct sq_connection* connection,
                               struct sq_request_info* request_info) {
@@ -458,6 +576,17 @@ int Webserver::RunPathHandler(const PathHandler& handler,
     use_style = false;
   }
 
+  // Check if the gzip compression is accepted by the caller.
+  const bool accepts_gzip = AcceptsGzip(connection);
+
+  // HTTP/1.0 clients don't support the chunked transfer encoding: the
+  // responses of streaming handlers are buffered for them.
+  if (handler.is_streaming() && request_info->http_version != nullptr &&
+      strcmp(request_info->http_version, "1.1") == 0) {
+    RunStreamingPathHandler(handler, req, accepts_gzip, connection);
+    return 1;
+  }
+
   ostringstream content;
   PrerenderedWebResponse resp { HttpStatusCode::Ok, HttpResponseHeaders{}, &content };
   // Enable or disable redaction from the web UI based on the setting of --redact.
@@ -478,28 +607,23 @@ int Webserver::RunPathHandler(const PathHandler& handler,
     full_content = content.str();
   }
 
-  // Check if the gzip compression is accepted by the caller. If so, compress the content.
-  const char* accept_encoding_str = sq_get_header(connection, "Accept-Encoding");
+  // If the gzip compression is accepted by the caller, compress the content.
   bool is_compressed = false;
-  vector<string> encodings = strings::Split(accept_encoding_str, ",");
-  for (string& encoding : encodings) {
-    StripWhiteSpace(&encoding);
-    if (encoding == "gzip") {
-      ostringstream oss;
-      Status s = zlib::Compress(Slice(full_content), &oss);
-      if (s.ok()) {
-        full_content = oss.str();
-        is_compressed = true;
-      } else {
-        LOG(WARNING) << "Could not compress output: " << s.ToString();
-      }
-      break;
+  if (accepts_gzip) {
+    ostringstream oss;
+    Status s = zlib::Compress(Slice(full_content), &oss);
+    if (s.ok()) {
+      full_content = oss.str();
+      is_compressed = true;
+    } else {
+      LOG(WARNING) << "Could not compress output: " << s.ToString();
     }
   }
 
   ostringstream headers_stream;
   headers_stream << Substitute("HTTP/1.1 $0\r\n", HttpStatusCodeToString(resp.status_code));
-  headers_stream << Substitute("Content-Type: $0\r\n", use_style ? "text/html" : "text/plain");
+  headers_stream << Substitute("Content-Type: $0\r\n",
+                               use_style ? "text/html" : handler.content_type());
   headers_stream << Substitute("Content-Length: $0\r\n", full_content.length());
   if (is_compressed) headers_stream << "Content-Encoding: gzip\r\n";
   headers_stream << Substitute("X-Frame-Options: $0\r\n", FLAGS_webserver_x_frame_options);
@@ -521,6 +645,45 @@ int Webserver::RunPathHandler(const PathHandler& handler,
   return 1;
 }
 
+void Webserver::RunStreamingPathHandler(const PathHandler& handler,
+                                        const WebRequest& req,
+                                        bool accepts_gzip,
+                                        struct sq_connection* connection) {
+  unique_ptr<zlib::StreamingCompressor> compressor;
+  if (accepts_gzip) {
+    compressor.reset(new zlib::StreamingCompressor());
+    Status s = compressor->Init();
+    if (!s.ok()) {
+      LOG(WARNING) << "Could not compress output: " << s.ToString();
+      compressor.reset();
+    }
+  }
+
+  ostringstream headers_stream;
+  headers_stream << Substitute("HTTP/1.1 $0\r\n", HttpStatusCodeToString(HttpStatusCode::Ok));
+  headers_stream << Substitute("Content-Type: $0\r\n", handler.content_type());
+  headers_stream << "Transfer-Encoding: chunked\r\n";
+  if (compressor) headers_stream << "Content-Encoding: gzip\r\n";
+  headers_stream << Substitute("X-Frame-Options: $0\r\n", FLAGS_webserver_x_frame_options);
+  headers_stream << "\r\n";
+  string headers = headers_stream.str();
+  sq_write(connection, headers.c_str(), headers.length());
+
+  ChunkedResponseBuf buf(connection, compressor.get());
+  std::ostream out(&buf);
+  // See RunPathHandler().
+  if (kudu::g_should_redact == kudu::RedactContext::ALL) {
+    handler.streaming_callback()(req, &out);
+  } else {
+    ScopedDisableRedaction s;
+    handler.streaming_callback()(req, &out);
+  }
+  out.flush();
+  if (!buf.Finish()) {
+    VLOG(1) << "Could not send the full response for " << handler.alias();
+  }
+}
+
 void Webserver::RegisterPathHandler(const string& path, const string& alias,
     const PathHandlerCallback& callback, bool is_styled, bool is_on_nav_bar) {
   string render_path = (path == "/") ? "/home" : path;
@@ -543,6 +706,14 @@ void Webserver::RegisterPrerenderedPathHandler(const string& path, const string&
   InsertOrDie(&path_handlers_, path, new PathHandler(is_styled, is_on_nav_bar, alias, callback));
 }
 
+void Webserver::RegisterStreamingPathHandler(const string& path, const string& alias,
+    const StreamingPathHandlerCallback& callback, const string& content_type,
+    bool is_on_nav_bar) {
+  std::lock_guard<RWMutex> l(lock_);
+  InsertOrDie(&path_handlers_, path,
+              new PathHandler(is_on_nav_bar, alias, callback, content_type));
+}
+
 string Webserver::MustachePartialTag(const string& path) const {
   return Substitute("{{> $0.mustache}}", path);
 }
@@ -78,6 +78,13 @@ class Webserver : public WebCallbackRegistry {
                                       bool is_styled,
                                       bool is_on_nav_bar) override;
 
+  // Register a route 'path' whose response is streamed to the client. The
+  // responses to HTTP/1.1 requests use the chunked transfer encoding.
+  void RegisterStreamingPathHandler(const std::string& path, const std::string& alias,
+                                    const StreamingPathHandlerCallback& callback,
+                                    const std::string& content_type,
+                                    bool is_on_nav_bar) override;
+
   // Change the footer HTML to be displayed at the bottom of all styled web pages.
   void set_footer_html(const std::string& html);
 
@@ -93,12 +100,31 @@ class Webserver : public WebCallbackRegistry {
         : is_styled_(is_styled),
           is_on_nav_bar_(is_on_nav_bar),
           alias_(std::move(alias)),
-          callback_(std::move(callback)) {}
+          callback_(std::move(callback)),
+          content_type_("text/plain") {}
+
+    // A handler whose response is streamed. Its callback buffers the response.
+    PathHandler(bool is_on_nav_bar, std::string alias,
+                StreamingPathHandlerCallback streaming_callback,
+                std::string content_type)
+        : is_styled_(false),
+          is_on_nav_bar_(is_on_nav_bar),
+          alias_(std::move(alias)),
+          callback_([streaming_callback](const WebRequest& req, PrerenderedWebResponse* resp) {
+            streaming_callback(req, resp->output);
+          }),
+          streaming_callback_(std::move(streaming_callback)),
+          content_type_(std::move(content_type)) {}
 
     bool is_styled() const { return is_styled_; }
     bool is_on_nav_bar() const { return is_on_nav_bar_; }
     const std::string& alias() const { return alias_; }
     const PrerenderedPathHandlerCallback& callback() const { return callback_; }
+    bool is_streaming() const { return !streaming_callback_.empty(); }
+    const StreamingPathHandlerCallback& streaming_callback() const {
+      return streaming_callback_;
+    }
+    const std::string& content_type() const { return content_type_; }
 
    private:
     // If true, the page appears is rendered styled.
@@ -112,6 +138,12 @@ class Webserver : public WebCallbackRegistry {
 
     // Callback to render output for this page.
     PrerenderedPathHandlerCallback callback_;
+
+    // Callback to stream the output for this page, if it's streamed.
+    StreamingPathHandlerCallback streaming_callback_;
+
+    // The content type of the unstyled output.
+    std::string content_type_;
   };
 
   bool static_pages_available() const;
@@ -146,6 +178,13 @@ class Webserver : public WebCallbackRegistry {
                      struct sq_connection* connection,
                      struct sq_request_info* request_info);
 
+  // Runs the streaming handler 'handler', sending its output to 'connection'
+  // with the chunked transfer encoding.
+  void RunStreamingPathHandler(const PathHandler& handler,
+                               const WebRequest& req,
+                               bool accepts_gzip,
+                               struct sq_connection* connection);
+
   // Callback to funnel mongoose logs through glog.
   static int LogMessageCallbackStatic(const struct sq_connection* connection,
                                       const char* message);
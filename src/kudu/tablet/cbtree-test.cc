@@ -37,6 +37,7 @@
 #include "kudu/util/memory/overwrite.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/stopwatch.h"
+#include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
 using std::string;
@@ -347,6 +348,81 @@ TEST_F(TestCBTree, TestInsertAndVerifyRandom) {
   }
 }
 
+// Inserts the keys 'start_idx', 'start_idx + step', ... up to 'end_idx'
+// formatted so that they sort in increasing order.
+template<class T>
+void InsertSortedRange(CBTree<T> *tree, int start_idx, int end_idx, int step) {
+  char kbuf[64];
+  char vbuf[64];
+  for (int i = start_idx; i < end_idx; i += step) {
+    snprintf(kbuf, sizeof(kbuf), "key_%08d", i);
+    snprintf(vbuf, sizeof(vbuf), "val_%d", i);
+    if (!tree->Insert(Slice(kbuf), Slice(vbuf))) {
+      FAIL() << "Failed insert at iteration " << i;
+    }
+  }
+}
+
+// Verifies that the tree contains exactly the keys inserted by
+// InsertSortedRange() from 0 to 'n_keys', in order.
+template<class T>
+void VerifySortedRange(const CBTree<T> &tree, int n_keys) {
+  char kbuf[64];
+  char vbuf[64];
+  gscoped_ptr<CBTreeIterator<T>> iter(tree.NewIterator());
+  ASSERT_TRUE(iter->SeekToStart());
+  for (int i = 0; i < n_keys; i++) {
+    ASSERT_TRUE(iter->IsValid());
+    snprintf(kbuf, sizeof(kbuf), "key_%08d", i);
+    snprintf(vbuf, sizeof(vbuf), "val_%d", i);
+    Slice k, v;
+    iter->GetCurrentEntry(&k, &v);
+    ASSERT_EQ(Slice(kbuf), k);
+    ASSERT_EQ(Slice(vbuf), v);
+    VerifyGet(tree, Slice(kbuf), Slice(vbuf));
+    iter->Next();
+  }
+  ASSERT_FALSE(iter->IsValid());
+}
+
+template<class T>
+void DoTestSortedInsert() {
+  const int kNumKeys = 10000;
+  {
+    CBTree<T> t;
+    NO_FATALS(InsertSortedRange(&t, 0, kNumKeys, 1));
+    NO_FATALS(VerifySortedRange(t, kNumKeys));
+
+    // Appending an existing key fails.
+    ASSERT_FALSE(t.Insert(Slice("key_00009999"), Slice("xxx")));
+
+    // Keys which sort before the last key still go through the whole tree.
+    ASSERT_TRUE(t.Insert(Slice("key_00000000a"), Slice("val")));
+    ASSERT_FALSE(t.Insert(Slice("key_00000000a"), Slice("xxx")));
+    VerifyGet(t, Slice("key_00000000a"), Slice("val"));
+  }
+
+  // Several threads appending concurrently.
+  const int kNumThreads = 8;
+  CBTree<T> t;
+  vector<thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back(InsertSortedRange<T>, &t, i, kNumKeys, kNumThreads);
+  }
+  for (thread& thr : threads) {
+    thr.join();
+  }
+  NO_FATALS(VerifySortedRange(t, kNumKeys));
+}
+
+// Test inserting keys in increasing order, which appends them to the
+// rightmost leaf.
+TEST_F(TestCBTree, TestSortedInsert) {
+  DoTestSortedInsert<BTreeTraits>();
+  DoTestSortedInsert<SmallFanoutTraits>();
+  DoTestSortedInsert<RacyTraits>();
+}
+
 // Thread which cycles through doing the following:
 // - lock the node
 // - either mark it splitting or inserting (alternatingly)
@@ -31,6 +31,7 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include "kudu/cfile/cfile_reader.h"
 #include "kudu/common/column_materialization_context.h"
 #include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
@@ -44,10 +45,13 @@
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
 #include "kudu/gutil/integral_types.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/stringpiece.h"
 #include "kudu/tablet/diskrowset.h"
+#include "kudu/tablet/rowset.h"
+#include "kudu/tablet/rowset_key_index.h"
 #include "kudu/tablet/tablet-test-util.h"
 #include "kudu/util/auto_release_pool.h"
 #include "kudu/util/bloom_filter.h"
@@ -58,7 +62,11 @@
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 
+DECLARE_bool(cfile_set_late_materialization);
+DECLARE_int32(cfile_set_open_threads);
 DECLARE_int32(cfile_default_block_size);
+DECLARE_int64(cfile_set_key_index_memory_limit_mb);
+DECLARE_double(cfile_set_secondary_index_max_match_ratio);
 
 using std::shared_ptr;
 using std::string;
@@ -73,7 +81,8 @@ class TestCFileSet : public KuduRowSetTest {
   TestCFileSet() :
     KuduRowSetTest(Schema({ ColumnSchema("c0", INT32),
                             ColumnSchema("c1", INT32, false, nullptr, nullptr, GetRLEStorage()),
-                            ColumnSchema("c2", INT32) }, 1))
+                            ColumnSchema("c2", INT32, false, nullptr, nullptr,
+                                         GetIndexedStorage()) }, 1))
   {}
 
   virtual void SetUp() OVERRIDE {
@@ -265,6 +274,12 @@ class TestCFileSet : public KuduRowSetTest {
     return attr;
   }
 
+  ColumnStorageAttributes GetIndexedStorage() const {
+    ColumnStorageAttributes attr;
+    attr.secondary_index = true;
+    return attr;
+  }
+
  protected:
   static const int32_t kNoBound;
   google::FlagSaver saver;
@@ -384,6 +399,93 @@ TEST_F(TestCFileSet, TestIteratePartialSchema) {
   }
 }
 
+// Opens the CFiles of a projection in parallel, and ensures that only those
+// are opened and that the scan results are unchanged.
+TEST_F(TestCFileSet, TestParallelOpen) {
+  const int kNumRows = 1000;
+  FLAGS_cfile_set_open_threads = 4;
+  WriteTestRowSet(kNumRows);
+
+  shared_ptr<CFileSet> fileset;
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), nullptr, &fileset));
+  Schema proj;
+  ASSERT_OK(schema_.CreateProjectionByNames({ "c1", "c2" }, &proj));
+  ASSERT_OK(fileset->InitColumnReaders(proj, nullptr));
+  EXPECT_FALSE(FindOrDie(fileset->readers_by_col_id_, schema_.column_id(0))->initialized());
+  EXPECT_TRUE(FindOrDie(fileset->readers_by_col_id_, schema_.column_id(1))->initialized());
+  EXPECT_TRUE(FindOrDie(fileset->readers_by_col_id_, schema_.column_id(2))->initialized());
+
+  // Creating the iterator of the whole schema opens the remaining CFile.
+  unique_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&schema_, nullptr));
+  unique_ptr<RowwiseIterator> iter(NewMaterializingIterator(std::move(cfile_iter)));
+  ASSERT_OK(iter->Init(nullptr));
+  for (const auto& e : fileset->readers_by_col_id_) {
+    EXPECT_TRUE(e.second->initialized());
+  }
+  vector<string> results;
+  ASSERT_OK(IterateToStringList(iter.get(), &results));
+  ASSERT_EQ(kNumRows, results.size());
+  for (int i = 0; i < kNumRows; i++) {
+    ASSERT_EQ(StringPrintf("(int32 c0=%d, int32 c1=%d, int32 c2=%d)", i * 2, i * 10, i * 100),
+              results[i]);
+  }
+}
+
+// Test that key lookups find the same rows with and without the in-memory
+// key index.
+TEST_F(TestCFileSet, TestKeyIndex) {
+  const int kNumRows = 10000;
+  WriteTestRowSet(kNumRows);
+
+  for (int64_t limit_mb : { 0, 256 }) {
+    SCOPED_TRACE(limit_mb);
+    FLAGS_cfile_set_key_index_memory_limit_mb = limit_mb;
+    shared_ptr<CFileSet> fileset;
+    ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), nullptr, &fileset));
+
+    Schema key_schema = schema_.CreateKeyProjection();
+    ProbeStats stats;
+    vector<const RowSetKeyProbe*> probes;
+    vector<ProbeStats*> probe_stats;
+    vector<unique_ptr<RowSetKeyProbe>> probe_storage;
+    Arena arena(1024);
+    // Probe the keys before, between and after the even keys of the rowset.
+    for (int key = -1; key <= kNumRows * 2; key++) {
+      RowBuilder rb(key_schema);
+      rb.AddInt32(key);
+      ConstContiguousRow row(&key_schema, arena.AddSlice(rb.data()));
+      probe_storage.emplace_back(new RowSetKeyProbe(row));
+      probes.push_back(probe_storage.back().get());
+      probe_stats.push_back(&stats);
+
+      bool present;
+      rowid_t rowid;
+      ASSERT_OK(fileset->CheckRowPresent(*probes.back(), nullptr, &present, &rowid, &stats));
+      bool expected = key >= 0 && key < kNumRows * 2 && key % 2 == 0;
+      ASSERT_EQ(expected, present) << key;
+      if (present) {
+        ASSERT_EQ(key / 2, rowid);
+      }
+    }
+    // The key index is loaded by the first lookup, if enabled.
+    ASSERT_EQ(limit_mb > 0, fileset->key_index_ != nullptr);
+    if (fileset->key_index_) {
+      ASSERT_GT(fileset->key_index_->num_blocks(), 10);
+    }
+
+    vector<bool> present;
+    vector<rowid_t> rowids;
+    ASSERT_OK(fileset->CheckRowsPresent(probes, probe_stats, nullptr, &present, &rowids));
+    for (int i = 0; i < probes.size(); i++) {
+      int key = i - 1;
+      ASSERT_EQ(key >= 0 && key < kNumRows * 2 && key % 2 == 0, present[i]) << key;
+      if (present[i]) {
+        ASSERT_EQ(key / 2, rowids[i]);
+      }
+    }
+  }
+}
+
 // Add a range predicate on the key column and ensure that only the relevant small number of rows
 // are read off disk.
 TEST_F(TestCFileSet, TestRangeScan) {
@@ -465,6 +567,142 @@ TEST_F(TestCFileSet, TestRangePredicates2) {
   DoTestRangeScan(fileset, kNumRows * 10, kNoBound);
 }
 
+// Test that columns without predicates are only materialized for the rows
+// which passed the predicates when the scan is selective.
+TEST_F(TestCFileSet, TestLateMaterialization) {
+  const int kNumRows = 10000;
+  WriteTestRowSet(kNumRows);
+
+  shared_ptr<CFileSet> fileset;
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), nullptr, &fileset));
+
+  for (bool late_materialization : { false, true }) {
+    FLAGS_cfile_set_late_materialization = late_materialization;
+    SCOPED_TRACE(late_materialization);
+
+    unique_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&schema_, nullptr));
+    unique_ptr<RowwiseIterator> iter(NewMaterializingIterator(std::move(cfile_iter)));
+
+    // Select a few isolated rows and a short range of rows using a predicate on
+    // the non-key column c1, which contains the row index * 10.
+    vector<int32_t> rows = { 5, 6, 1234, 5000 };
+    for (int32_t r = 7000; r < 7100; r++) {
+      rows.push_back(r);
+    }
+    rows.push_back(9999);
+    vector<int32_t> c1_values;
+    for (int32_t r : rows) {
+      c1_values.push_back(r * 10);
+    }
+    vector<const void*> value_ptrs;
+    for (const auto& v : c1_values) {
+      value_ptrs.push_back(&v);
+    }
+    ScanSpec spec;
+    spec.AddPredicate(ColumnPredicate::InList(schema_.column(1), &value_ptrs));
+    ASSERT_OK(iter->Init(&spec));
+
+    Arena arena(1024);
+    RowBlock block(schema_, 1000, &arena);
+    vector<int32_t> selected_rows;
+    while (iter->HasNext()) {
+      ASSERT_OK_FAST(iter->NextBlock(&block));
+      for (size_t i = 0; i < block.nrows(); i++) {
+        if (!block.selection_vector()->IsRowSelected(i)) continue;
+        RowBlockRow row = block.row(i);
+        int32_t idx = *schema_.ExtractColumnFromRow<INT32>(row, 1) / 10;
+        ASSERT_EQ(idx * 2, *schema_.ExtractColumnFromRow<INT32>(row, 0));
+        ASSERT_EQ(idx * 100, *schema_.ExtractColumnFromRow<INT32>(row, 2));
+        selected_rows.push_back(idx);
+      }
+    }
+    ASSERT_EQ(rows, selected_rows);
+
+    vector<IteratorStats> stats;
+    iter->GetIteratorStats(&stats);
+    ASSERT_EQ(3, stats.size());
+    if (late_materialization) {
+      // Only the ranges around the selected rows should have been read.
+      ASSERT_LT(stats[2].cells_read, kNumRows / 4);
+    } else {
+      ASSERT_EQ(kNumRows, stats[2].cells_read);
+    }
+  }
+}
+
+TEST_F(TestCFileSet, TestSecondaryIndex) {
+  const int kNumRows = 10000;
+  WriteTestRowSet(kNumRows);
+  ASSERT_EQ(1, rowset_meta_->GetSecondaryIndexBlocksById().size());
+
+  shared_ptr<CFileSet> fileset;
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), nullptr, &fileset));
+  ASSERT_TRUE(fileset->has_secondary_index_for_column_id(schema_.column_id(2)));
+  ASSERT_FALSE(fileset->has_secondary_index_for_column_id(schema_.column_id(1)));
+  ASSERT_GT(fileset->SecondaryIndexOnDiskSize(), 0);
+
+  // Scans with a predicate on the indexed column c2, which contains the row
+  // index * 100, and returns the indexes of the selected rows and the number
+  // of cells of c2 which were read.
+  auto scan = [&](const ColumnPredicate& pred, vector<int32_t>* rows, int64_t* cells_read) {
+    unique_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&schema_, nullptr));
+    unique_ptr<RowwiseIterator> iter(NewMaterializingIterator(std::move(cfile_iter)));
+    ScanSpec spec;
+    spec.AddPredicate(pred);
+    ASSERT_OK(iter->Init(&spec));
+    Arena arena(1024);
+    RowBlock block(schema_, 1000, &arena);
+    rows->clear();
+    while (iter->HasNext()) {
+      ASSERT_OK_FAST(iter->NextBlock(&block));
+      for (size_t i = 0; i < block.nrows(); i++) {
+        if (!block.selection_vector()->IsRowSelected(i)) continue;
+        RowBlockRow row = block.row(i);
+        int32_t idx = *schema_.ExtractColumnFromRow<INT32>(row, 2) / 100;
+        ASSERT_EQ(idx * 2, *schema_.ExtractColumnFromRow<INT32>(row, 0));
+        ASSERT_EQ(idx * 10, *schema_.ExtractColumnFromRow<INT32>(row, 1));
+        rows->push_back(idx);
+      }
+    }
+    vector<IteratorStats> stats;
+    iter->GetIteratorStats(&stats);
+    ASSERT_EQ(3, stats.size());
+    *cells_read = stats[2].cells_read;
+  };
+
+  // With a ratio of 0, the index is only used when no row matches.
+  for (double max_match_ratio : { 0.1, 0.0 }) {
+    FLAGS_cfile_set_secondary_index_max_match_ratio = max_match_ratio;
+    SCOPED_TRACE(max_match_ratio);
+    const bool index_used = max_match_ratio > 0;
+    vector<int32_t> rows;
+    int64_t cells_read;
+
+    int32_t value = 5000 * 100;
+    NO_FATALS(scan(ColumnPredicate::Equality(schema_.column(2), &value), &rows, &cells_read));
+    ASSERT_EQ(vector<int32_t>({ 5000 }), rows);
+    if (index_used) {
+      ASSERT_LT(cells_read, 100);
+    }
+
+    value = 5000 * 100 + 1;
+    NO_FATALS(scan(ColumnPredicate::Equality(schema_.column(2), &value), &rows, &cells_read));
+    ASSERT_TRUE(rows.empty());
+    ASSERT_EQ(0, cells_read);
+
+    vector<int32_t> values = { 9999 * 100, 3 * 100, 4 * 100, 7 * 100 + 1, 1234 * 100 };
+    vector<const void*> value_ptrs;
+    for (const auto& v : values) {
+      value_ptrs.push_back(&v);
+    }
+    NO_FATALS(scan(ColumnPredicate::InList(schema_.column(2), &value_ptrs), &rows, &cells_read));
+    ASSERT_EQ(vector<int32_t>({ 3, 4, 1234, 9999 }), rows);
+    if (index_used) {
+      ASSERT_LT(cells_read, 100);
+    }
+  }
+}
+
 TEST_F(TestCFileSet, TestBloomFilterPredicates) {
   const int kNumRows = 100;
   BloomFilterBuilder bfb1_contain(
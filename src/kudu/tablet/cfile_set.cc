@@ -17,6 +17,7 @@
 #include "kudu/tablet/cfile_set.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <ostream>
 #include <string>
@@ -34,6 +35,7 @@
 #include "kudu/cfile/cfile_reader.h"
 #include "kudu/cfile/cfile_util.h"
 #include "kudu/common/column_materialization_context.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/iterator_stats.h"
@@ -45,22 +47,77 @@
 #include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/dynamic_annotations.h"
+#include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/map-util.h"
+#include "kudu/gutil/once.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/diskrowset.h"
 #include "kudu/tablet/rowset.h"
+#include "kudu/tablet/rollup.h"
+#include "kudu/tablet/rowset_key_index.h"
 #include "kudu/tablet/rowset_metadata.h"
+#include "kudu/tablet/secondary_index.h"
+#include "kudu/util/bitmap.h"
+#include "kudu/util/bloom_filter.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/mem_tracker.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
+#include "kudu/util/threadpool.h"
 
 DEFINE_bool(consult_bloom_filters, true, "Whether to consult bloom filters on row presence checks");
 TAG_FLAG(consult_bloom_filters, hidden);
 
+DEFINE_bool(cfile_set_late_materialization, true,
+            "Whether to materialize columns without predicates only for the ranges "
+            "of each batch containing rows which passed the scan's predicates, "
+            "skipping the reading and decoding of the rest of the batch.");
+TAG_FLAG(cfile_set_late_materialization, advanced);
+TAG_FLAG(cfile_set_late_materialization, runtime);
+
+DEFINE_int32(cfile_set_late_materialization_min_gap_rows, 256,
+             "The minimum number of unselected rows between two ranges of selected "
+             "rows for them to be materialized separately when late "
+             "materialization is enabled. Ranges closer than this are merged, "
+             "trading decoding unselected rows for fewer column seeks.");
+TAG_FLAG(cfile_set_late_materialization_min_gap_rows, advanced);
+TAG_FLAG(cfile_set_late_materialization_min_gap_rows, runtime);
+
+DEFINE_int32(cfile_set_open_threads, 0,
+             "Number of threads, shared by all scans, which fully open the "
+             "lazily opened CFiles of the projected columns of a rowset in "
+             "parallel when a scan first reads it, overlapping the reads of "
+             "their footers and headers. If 0, the CFiles of a rowset are "
+             "opened one after the other by the scanning thread.");
+TAG_FLAG(cfile_set_open_threads, experimental);
+DEFINE_validator(cfile_set_open_threads,
+                 [](const char* /*flagname*/, int32_t value) { return value >= 0; });
+
+DEFINE_double(cfile_set_secondary_index_max_match_ratio, 0.1,
+              "The maximum ratio of the rows of a rowset which may match an "
+              "equality or IN-list predicate for the predicate to be evaluated "
+              "with the secondary index of its column. Less selective "
+              "predicates are evaluated against the column's data.");
+TAG_FLAG(cfile_set_secondary_index_max_match_ratio, advanced);
+TAG_FLAG(cfile_set_secondary_index_max_match_ratio, runtime);
+
+DEFINE_int64(cfile_set_key_index_memory_limit_mb, 256,
+             "The maximum memory, in MiB, used by the in-memory copies of the "
+             "leaf entries of the key indexes of rowsets, which let key lookups "
+             "read the data block which may hold a key directly rather than "
+             "seeking the on-disk index. The copy of a rowset's key index is "
+             "loaded by its first key lookup; rowsets whose copy doesn't fit "
+             "seek the on-disk index. If 0, no copy is loaded. If -1, there is "
+             "no limit.");
+TAG_FLAG(cfile_set_key_index_memory_limit_mb, advanced);
+TAG_FLAG(cfile_set_key_index_memory_limit_mb, experimental);
+
 DECLARE_bool(rowset_metadata_store_keys);
 
 namespace kudu {
@@ -87,6 +144,22 @@ using strings::Substitute;
 // Utilities
 ////////////////////////////////////////////////////////////
 
+namespace {
+
+GoogleOnceType g_open_pool_once = GOOGLE_ONCE_INIT;
+ThreadPool* g_open_pool = nullptr;
+
+void InitOpenPool() {
+  gscoped_ptr<ThreadPool> pool;
+  CHECK_OK(ThreadPoolBuilder("cfile-open")
+           .set_min_threads(0)
+           .set_max_threads(FLAGS_cfile_set_open_threads)
+           .Build(&pool));
+  g_open_pool = pool.release();
+}
+
+} // anonymous namespace
+
 static Status OpenReader(FsManager* fs,
                          shared_ptr<MemTracker> parent_mem_tracker,
                          const BlockId& block_id,
@@ -150,6 +223,9 @@ Status CFileSet::DoOpen(const IOContext* io_context) {
   }
   readers_by_col_id_.shrink_to_fit();
 
+  RETURN_NOT_OK(OpenSecondaryIndexReaders(io_context));
+  RETURN_NOT_OK(OpenRollupReader(io_context));
+
   if (rowset_metadata_->has_adhoc_index_block()) {
     RETURN_NOT_OK(OpenReader(rowset_metadata_->fs_manager(),
                              parent_mem_tracker_,
@@ -197,6 +273,62 @@ Status CFileSet::OpenBloomReader(const IOContext* io_context) {
   return Status::OK();
 }
 
+Status CFileSet::OpenSecondaryIndexReaders(const IOContext* io_context) {
+  FsManager* fs = rowset_metadata_->fs_manager();
+  for (const auto& e : rowset_metadata_->GetSecondaryIndexBlocksById()) {
+    int col_idx = tablet_schema().find_column_by_id(e.first);
+    if (col_idx == Schema::kColumnNotFound) {
+      // The column was dropped.
+      continue;
+    }
+    unique_ptr<ReadableBlock> block;
+    RETURN_NOT_OK(fs->OpenBlock(e.second, &block));
+    unique_ptr<SecondaryIndexReader> reader;
+    RETURN_NOT_OK(SecondaryIndexReader::OpenNoInit(tablet_schema().column(col_idx).type_info(),
+                                                   std::move(block),
+                                                   parent_mem_tracker_,
+                                                   io_context,
+                                                   &reader));
+    index_readers_by_col_id_[e.first] = std::move(reader);
+  }
+  index_readers_by_col_id_.shrink_to_fit();
+  return Status::OK();
+}
+
+Status CFileSet::OpenRollupReader(const IOContext* io_context) {
+  if (!rowset_metadata_->has_rollup_block()) {
+    return Status::OK();
+  }
+  vector<ColumnId> key_col_ids = rowset_metadata_->rollup_key_column_ids();
+  vector<ColumnId> col_ids = rowset_metadata_->rollup_column_ids();
+  auto get_types = [&](const vector<ColumnId>& ids, vector<const TypeInfo*>* types) {
+    for (const ColumnId& col_id : ids) {
+      int col_idx = tablet_schema().find_column_by_id(col_id);
+      if (col_idx == Schema::kColumnNotFound) {
+        return false;
+      }
+      types->push_back(tablet_schema().column(col_idx).type_info());
+    }
+    return true;
+  };
+  vector<const TypeInfo*> key_types;
+  vector<const TypeInfo*> col_types;
+  if (!get_types(key_col_ids, &key_types) || !get_types(col_ids, &col_types)) {
+    // A column of the rollup was dropped, and the rollup can't be decoded
+    // without its type.
+    return Status::OK();
+  }
+  unique_ptr<ReadableBlock> block;
+  RETURN_NOT_OK(rowset_metadata_->fs_manager()->OpenBlock(rowset_metadata_->rollup_block(),
+                                                          &block));
+  RETURN_NOT_OK(RollupReader::OpenNoInit(std::move(key_types), std::move(col_types),
+                                         std::move(block), parent_mem_tracker_, io_context,
+                                         &rollup_reader_));
+  rollup_key_col_ids_ = std::move(key_col_ids);
+  rollup_col_ids_ = std::move(col_ids);
+  return Status::OK();
+}
+
 Status CFileSet::LoadMinMaxKeys(const IOContext* io_context) {
   CFileReader* key_reader = key_index_reader();
   RETURN_NOT_OK(key_index_reader()->Init(io_context));
@@ -240,6 +372,54 @@ Status CFileSet::CountRows(const IOContext* io_context, rowid_t *count) const {
   return key_index_reader()->CountRows(count);
 }
 
+Status CFileSet::SampleEncodedKeys(int num_samples,
+                                   const IOContext* io_context,
+                                   vector<string>* keys) const {
+  keys->clear();
+  rowid_t num_rows;
+  RETURN_NOT_OK(CountRows(io_context, &num_rows));
+  if (num_rows == 0 || num_samples <= 0) {
+    return Status::OK();
+  }
+
+  // Read the key columns of each sampled row, and encode them.
+  const Schema key_schema = tablet_schema().CreateKeyProjection();
+  vector<unique_ptr<CFileIterator>> iters(key_schema.num_columns());
+  for (int i = 0; i < key_schema.num_columns(); i++) {
+    RETURN_NOT_OK(NewColumnIterator(key_schema.column_id(i), CFileReader::DONT_CACHE_BLOCK,
+                                    io_context, &iters[i]));
+  }
+  Arena arena(1024);
+  RowBlock block(key_schema, 1, &arena);
+  SelectionVector sel(1);
+  sel.SetAllTrue();
+  faststring encoded_key;
+  rowid_t prev_idx = 0;
+  for (int s = 1; s <= num_samples; s++) {
+    // The first row, whose key is the minimum key, isn't sampled.
+    const rowid_t idx =
+        static_cast<uint64_t>(num_rows) * s / (static_cast<uint64_t>(num_samples) + 1);
+    if (idx == prev_idx) {
+      continue;
+    }
+    prev_idx = idx;
+    arena.Reset();
+    for (int i = 0; i < key_schema.num_columns(); i++) {
+      CFileIterator* iter = iters[i].get();
+      RETURN_NOT_OK(iter->SeekToOrdinal(idx));
+      size_t n = 1;
+      RETURN_NOT_OK(iter->PrepareBatch(&n));
+      ColumnBlock col_block(block.column_block(i));
+      ColumnMaterializationContext ctx(i, nullptr, &col_block, &sel);
+      RETURN_NOT_OK(iter->Scan(&ctx));
+      RETURN_NOT_OK(iter->FinishBatch());
+    }
+    key_schema.EncodeComparableKey(block.row(0), &encoded_key);
+    keys->emplace_back(encoded_key.ToString());
+  }
+  return Status::OK();
+}
+
 Status CFileSet::GetBounds(string* min_encoded_key,
                            string* max_encoded_key) const {
   *min_encoded_key = min_encoded_key_;
@@ -258,6 +438,18 @@ uint64_t CFileSet::BloomFileOnDiskSize() const {
   return bloom_reader_->FileSize();
 }
 
+uint64_t CFileSet::SecondaryIndexOnDiskSize() const {
+  uint64_t ret = 0;
+  for (const auto& e : index_readers_by_col_id_) {
+    ret += e.second->file_size();
+  }
+  return ret;
+}
+
+uint64_t CFileSet::RollupOnDiskSize() const {
+  return rollup_reader_ ? rollup_reader_->file_size() : 0;
+}
+
 uint64_t CFileSet::OnDiskDataSize() const {
   uint64_t ret = 0;
   for (const auto& e : readers_by_col_id_) {
@@ -270,6 +462,92 @@ uint64_t CFileSet::OnDiskColumnDataSize(const ColumnId& col_id) const {
   return FindOrDie(readers_by_col_id_, col_id)->file_size();
 }
 
+Status CFileSet::GetColumnReader(ColumnId col_id,
+                                 const IOContext* io_context,
+                                 CFileReader** reader) const {
+  const auto* r = FindOrNull(readers_by_col_id_, col_id);
+  if (r == nullptr) {
+    *reader = nullptr;
+    return Status::OK();
+  }
+  RETURN_NOT_OK((*r)->Init(io_context));
+  *reader = r->get();
+  return Status::OK();
+}
+
+Status CFileSet::FindRowsInSecondaryIndex(ColumnId col_id,
+                                          const ColumnPredicate& pred,
+                                          size_t max_rows,
+                                          const IOContext* io_context,
+                                          vector<rowid_t>* rowids) const {
+  return FindOrDie(index_readers_by_col_id_, col_id)->FindRows(pred, max_rows, io_context,
+                                                               rowids);
+}
+
+Status CFileSet::GetRollupColumns(vector<string>* key_columns,
+                                  vector<string>* columns) const {
+  DCHECK(rollup_reader_);
+  // The columns are named by the current schema, since they may have been
+  // renamed since the rowset was written.
+  auto get_names = [&](const vector<ColumnId>& ids, vector<string>* names) {
+    names->clear();
+    for (const ColumnId& col_id : ids) {
+      int col_idx = tablet_schema().find_column_by_id(col_id);
+      if (col_idx == Schema::kColumnNotFound) {
+        return Status::NotFound("rollup column was dropped");
+      }
+      names->push_back(tablet_schema().column(col_idx).name());
+    }
+    return Status::OK();
+  };
+  RETURN_NOT_OK(get_names(rollup_key_col_ids_, key_columns));
+  return get_names(rollup_col_ids_, columns);
+}
+
+Status CFileSet::ReadRollup(const IOContext* io_context,
+                            vector<AggregatedGroup>* groups) const {
+  DCHECK(rollup_reader_);
+  return rollup_reader_->ReadGroups(io_context, groups);
+}
+
+Status CFileSet::InitColumnReaders(const Schema& projection,
+                                   const IOContext* io_context) const {
+  if (FLAGS_cfile_set_open_threads <= 0) {
+    return Status::OK();
+  }
+  vector<CFileReader*> readers;
+  for (int i = 0; i < projection.num_columns(); i++) {
+    const auto* r = FindOrNull(readers_by_col_id_, projection.column_id(i));
+    if (r != nullptr && !(*r)->initialized()) {
+      readers.push_back(r->get());
+    }
+  }
+  if (readers.size() < 2) {
+    return Status::OK();
+  }
+
+  GoogleOnceInit(&g_open_pool_once, &InitOpenPool);
+  unique_ptr<ThreadPoolToken> token =
+      g_open_pool->NewToken(ThreadPool::ExecutionMode::CONCURRENT);
+  // The first reader is opened by the calling thread.
+  vector<Status> statuses(readers.size());
+  for (int i = 1; i < readers.size(); i++) {
+    Status s = token->SubmitFunc([&, i]() {
+      statuses[i] = readers[i]->Init(io_context);
+    });
+    if (PREDICT_FALSE(!s.ok())) {
+      statuses[i] = readers[i]->Init(io_context);
+    }
+  }
+  statuses[0] = readers[0]->Init(io_context);
+  token->Wait();
+  for (int i = 0; i < readers.size(); i++) {
+    RETURN_NOT_OK_PREPEND(statuses[i], Substitute("could not open CFile $0",
+                                                  readers[i]->block_id().ToString()));
+  }
+  return Status::OK();
+}
+
 Status CFileSet::FindRow(const RowSetKeyProbe &probe,
                          const IOContext* io_context,
                          boost::optional<rowid_t>* idx,
@@ -302,6 +580,47 @@ Status CFileSet::FindRow(const RowSetKeyProbe &probe,
   stats->keys_consulted++;
   unique_ptr<CFileIterator> key_iter;
   RETURN_NOT_OK(NewKeyIterator(io_context, &key_iter));
+  RETURN_NOT_OK(InitKeyIndex(io_context));
+  return SeekToRow(key_iter.get(), probe, idx);
+}
+
+Status CFileSet::InitKeyIndex(const IOContext* io_context) const {
+  return key_index_once_.Init([&] {
+    if (FLAGS_cfile_set_key_index_memory_limit_mb == 0) {
+      return Status::OK();
+    }
+    int64_t limit = FLAGS_cfile_set_key_index_memory_limit_mb < 0 ?
+        -1 : FLAGS_cfile_set_key_index_memory_limit_mb * 1024 * 1024;
+    Status s = RowSetKeyIndex::Load(
+        key_index_reader(), io_context,
+        MemTracker::FindOrCreateGlobalTracker(limit, "rowset_key_index"), &key_index_);
+    if (PREDICT_FALSE(s.IsDiskFailure())) {
+      return s;
+    }
+    // Otherwise, lookups seek the on-disk index.
+    if (!s.ok()) {
+      VLOG(1) << Substitute("Not loading the key index of $0: $1", ToString(), s.ToString());
+    }
+    return Status::OK();
+  });
+}
+
+Status CFileSet::SeekToRow(CFileIterator* key_iter,
+                           const RowSetKeyProbe& probe,
+                           boost::optional<rowid_t>* idx) const {
+  if (key_index_) {
+    bool exact;
+    rowid_t ordinal;
+    RETURN_NOT_OK(key_iter->FindInDataBlock(probe.encoded_key(),
+                                            key_index_->FindBlock(probe.encoded_key_slice()),
+                                            &exact, &ordinal));
+    if (exact) {
+      *idx = ordinal;
+    } else {
+      *idx = boost::none;
+    }
+    return Status::OK();
+  }
 
   bool exact;
   Status s = key_iter->SeekAtOrAfter(probe.encoded_key(), &exact);
@@ -330,6 +649,61 @@ Status CFileSet::CheckRowPresent(const RowSetKeyProbe& probe, const IOContext* i
   return Status::OK();
 }
 
+Status CFileSet::CheckRowsPresent(const vector<const RowSetKeyProbe*>& probes,
+                                  const vector<ProbeStats*>& stats,
+                                  const IOContext* io_context,
+                                  vector<bool>* present,
+                                  vector<rowid_t>* rowids) const {
+  DCHECK_EQ(probes.size(), stats.size());
+  vector<bool> maybe_present(probes.size(), true);
+  if (FLAGS_consult_bloom_filters) {
+    // Fully open the BloomFileReader if it was lazily opened earlier.
+    //
+    // If it's already initialized, this is a no-op.
+    RETURN_NOT_OK(bloom_reader_->Init(io_context));
+
+    vector<const BloomKeyProbe*> bloom_probes;
+    bloom_probes.reserve(probes.size());
+    for (int i = 0; i < probes.size(); i++) {
+      stats[i]->blooms_consulted++;
+      bloom_probes.push_back(&probes[i]->bloom_probe());
+    }
+    Status s = bloom_reader_->CheckKeysPresent(bloom_probes, io_context, &maybe_present);
+    if (!s.ok()) {
+      KLOG_EVERY_N_SECS(WARNING, 1) << Substitute("Unable to query bloom in $0: $1",
+          rowset_metadata_->bloom_block().ToString(), s.ToString());
+      if (PREDICT_FALSE(s.IsDiskFailure())) {
+        // If the bloom lookup failed because of a disk failure, return early
+        // since I/O to the tablet should be stopped.
+        return s;
+      }
+      // Continue with the slow path for all the rows.
+      maybe_present.assign(probes.size(), true);
+    }
+  }
+
+  present->assign(probes.size(), false);
+  rowids->resize(probes.size());
+  unique_ptr<CFileIterator> key_iter;
+  for (int i = 0; i < probes.size(); i++) {
+    if (!maybe_present[i]) {
+      continue;
+    }
+    stats[i]->keys_consulted++;
+    if (!key_iter) {
+      RETURN_NOT_OK(NewKeyIterator(io_context, &key_iter));
+      RETURN_NOT_OK(InitKeyIndex(io_context));
+    }
+    boost::optional<rowid_t> opt_rowid;
+    RETURN_NOT_OK(SeekToRow(key_iter.get(), *probes[i], &opt_rowid));
+    if (opt_rowid) {
+      (*present)[i] = true;
+      (*rowids)[i] = *opt_rowid;
+    }
+  }
+  return Status::OK();
+}
+
 Status CFileSet::NewKeyIterator(const IOContext* io_context,
                                 unique_ptr<CFileIterator>* key_iter) const {
   RETURN_NOT_OK(key_index_reader()->Init(io_context));
@@ -352,6 +726,8 @@ Status CFileSet::Iterator::CreateColumnIterators(const ScanSpec* spec) {
     cache_blocks = CFileReader::DONT_CACHE_BLOCK;
   }
 
+  RETURN_NOT_OK(base_data_->InitColumnReaders(*projection_, io_context_));
+
   for (int proj_col_idx = 0;
        proj_col_idx < projection_->num_columns();
        proj_col_idx++) {
@@ -378,6 +754,7 @@ Status CFileSet::Iterator::CreateColumnIterators(const ScanSpec* spec) {
   }
 
   col_iters_.swap(ret_iters);
+  indexed_rows_.resize(col_iters_.size());
   return Status::OK();
 }
 
@@ -529,15 +906,164 @@ Status CFileSet::Iterator::InitializeSelectionVector(SelectionVector *sel_vec) {
 Status CFileSet::Iterator::MaterializeColumn(ColumnMaterializationContext *ctx) {
   CHECK_EQ(prepared_count_, ctx->block()->nrows());
   DCHECK_LT(ctx->col_idx(), col_iters_.size());
+  ColumnIterator* iter = col_iters_[ctx->col_idx()].get();
+
+  // If the predicate may be evaluated against the base data (i.e. there are
+  // no deltas which could change the column's values), look up the matching
+  // rows in the column's secondary index, or check the column's statistics:
+  // if no row of the batch can match, the column's blocks needn't be read or
+  // decoded at all.
+  if (ctx->pred() && ctx->DecoderEvalNotDisabled() && !cols_prepared_[ctx->col_idx()]) {
+    const vector<rowid_t>* rowids;
+    RETURN_NOT_OK(GetIndexedRows(*ctx, &rowids));
+    if (rowids) {
+      return MaterializeIndexedRows(ctx, *rowids);
+    }
+
+    bool may_match;
+    RETURN_NOT_OK(iter->MayMatchPredicate(*ctx->pred(), cur_idx_, prepared_count_,
+                                          &may_match));
+    if (!may_match) {
+      ctx->sel()->SetAllFalse();
+      ctx->SetDecoderEvalSupported();
+      return Status::OK();
+    }
+  }
+
+  // Columns without predicates are materialized after the predicates have
+  // been evaluated, so if the scan is selective only the rows which passed
+  // them need to be read.
+  if (!ctx->pred() && FLAGS_cfile_set_late_materialization &&
+      !cols_prepared_[ctx->col_idx()] && ctx->sel() && FindSelectedRuns(*ctx->sel())) {
+    return MaterializeSelectedRuns(ctx);
+  }
 
   RETURN_NOT_OK(PrepareColumn(ctx));
-  ColumnIterator* iter = col_iters_[ctx->col_idx()].get();
 
   RETURN_NOT_OK(iter->Scan(ctx));
 
   return Status::OK();
 }
 
+bool CFileSet::Iterator::FindSelectedRuns(const SelectionVector& sel) {
+  DCHECK_EQ(prepared_count_, sel.nrows());
+  selected_runs_.clear();
+  const size_t min_gap = std::max(FLAGS_cfile_set_late_materialization_min_gap_rows, 8);
+  const uint8_t* bitmap = sel.bitmap();
+  size_t covered = 0;
+  // Work a byte (8 rows) at a time, so the runs start on byte boundaries of
+  // the selection vector and the destination block's null bitmap.
+  for (size_t byte = 0; byte * 8 < prepared_count_; byte++) {
+    if (bitmap[byte] == 0) continue;
+    size_t start = byte * 8;
+    size_t end = std::min(start + 8, prepared_count_);
+    if (!selected_runs_.empty() && start - selected_runs_.back().second < min_gap) {
+      covered += end - selected_runs_.back().second;
+      selected_runs_.back().second = end;
+    } else {
+      covered += end - start;
+      selected_runs_.emplace_back(start, end);
+    }
+  }
+  // If most of the batch needs to be read anyway, it's cheaper to read it all
+  // at once.
+  return covered <= prepared_count_ / 2;
+}
+
+Status CFileSet::Iterator::MaterializeSelectedRuns(ColumnMaterializationContext* ctx) {
+  ColumnIterator* iter = col_iters_[ctx->col_idx()].get();
+  ColumnBlock* dst = ctx->block();
+  for (const auto& run : selected_runs_) {
+    const size_t start = run.first;
+    const size_t count = run.second - run.first;
+    DCHECK_EQ(0, start % 8);
+    RETURN_NOT_OK(iter->SeekToOrdinal(cur_idx_ + start));
+    size_t n = count;
+    RETURN_NOT_OK(iter->PrepareBatch(&n));
+    if (n != count) {
+      return Status::Corruption(
+          Substitute("Column $0 ($1) didn't yield enough rows at offset $2: expected "
+                     "$3 but only got $4", ctx->col_idx(),
+                     projection_->column(ctx->col_idx()).ToString(),
+                     cur_idx_ + start, count, n));
+    }
+    ColumnBlock run_block(dst->type_info(),
+                          dst->is_nullable() ? dst->null_bitmap() + start / 8 : nullptr,
+                          dst->data() + start * dst->stride(),
+                          count,
+                          dst->arena());
+    // The context has no predicate, so the selection vector is only used to
+    // track the scan's position.
+    SelectionVector run_sel(count);
+    run_sel.SetAllTrue();
+    ColumnMaterializationContext run_ctx(ctx->col_idx(), nullptr, &run_block, &run_sel);
+    RETURN_NOT_OK(iter->Scan(&run_ctx));
+    RETURN_NOT_OK(iter->FinishBatch());
+  }
+  // The column iterator is now positioned within the batch, so the column
+  // will be re-seeked the next time it's prepared.
+  return Status::OK();
+}
+
+Status CFileSet::Iterator::GetIndexedRows(const ColumnMaterializationContext& ctx,
+                                          const vector<rowid_t>** rowids) {
+  IndexedRows* indexed = &indexed_rows_[ctx.col_idx()];
+  if (!indexed->looked_up) {
+    indexed->looked_up = true;
+    const ColumnId col_id = projection_->column_id(ctx.col_idx());
+    const PredicateType type = ctx.pred()->predicate_type();
+    if ((type == PredicateType::Equality || type == PredicateType::InList) &&
+        base_data_->has_secondary_index_for_column_id(col_id)) {
+      const size_t max_rows = static_cast<size_t>(
+          row_count_ * FLAGS_cfile_set_secondary_index_max_match_ratio);
+      Status s = base_data_->FindRowsInSecondaryIndex(col_id, *ctx.pred(), max_rows,
+                                                      io_context_, &indexed->rowids);
+      if (s.IsIncomplete()) {
+        VLOG(1) << "Predicate " << ctx.pred()->ToString() << " matches more than "
+                << max_rows << " rows of " << base_data_->ToString()
+                << ", not using the secondary index";
+        indexed->rowids.clear();
+      } else {
+        RETURN_NOT_OK_PREPEND(s, Substitute("could not look up the secondary index of $0",
+                                            projection_->column(ctx.col_idx()).ToString()));
+        indexed->usable = true;
+      }
+    }
+  }
+  *rowids = indexed->usable ? &indexed->rowids : nullptr;
+  return Status::OK();
+}
+
+Status CFileSet::Iterator::MaterializeIndexedRows(ColumnMaterializationContext* ctx,
+                                                  const vector<rowid_t>& rowids) {
+  SelectionVector* sel = ctx->sel();
+  DCHECK_EQ(prepared_count_, sel->nrows());
+  auto it = std::lower_bound(rowids.begin(), rowids.end(), cur_idx_);
+  const auto end = std::lower_bound(it, rowids.end(), cur_idx_ + prepared_count_);
+  SelectionVector matched(prepared_count_);
+  matched.SetAllFalse();
+  for (; it != end; ++it) {
+    matched.SetRowSelected(*it - cur_idx_);
+  }
+  uint8_t* bitmap = sel->mutable_bitmap();
+  const uint8_t* matched_bitmap = matched.bitmap();
+  for (size_t i = 0; i < BitmapSize(prepared_count_); i++) {
+    bitmap[i] &= matched_bitmap[i];
+  }
+  // The predicate needn't be evaluated again on the column's values.
+  ctx->SetDecoderEvalSupported();
+  if (!sel->AnySelected()) {
+    return Status::OK();
+  }
+
+  // The column is still materialized, since it may be projected.
+  if (FindSelectedRuns(*sel)) {
+    return MaterializeSelectedRuns(ctx);
+  }
+  RETURN_NOT_OK(PrepareColumn(ctx));
+  return col_iters_[ctx->col_idx()]->Scan(ctx);
+}
+
 Status CFileSet::Iterator::FinishBatch() {
   CHECK_GT(prepared_count_, 0);
 
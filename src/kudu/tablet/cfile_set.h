@@ -37,6 +37,7 @@
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/tablet/rowset_metadata.h"
+#include "kudu/util/once.h"
 #include "kudu/util/status.h"
 
 namespace boost {
@@ -47,7 +48,9 @@ class optional;
 namespace kudu {
 
 class ColumnMaterializationContext;
+class ColumnPredicate;
 class MemTracker;
+struct AggregatedGroup;
 class ScanSpec;
 class SelectionVector;
 struct IteratorStats;
@@ -62,7 +65,10 @@ struct IOContext;
 
 namespace tablet {
 
+class RollupReader;
+class RowSetKeyIndex;
 class RowSetKeyProbe;
+class SecondaryIndexReader;
 struct ProbeStats;
 
 // Set of CFiles which make up the base data for a single rowset
@@ -89,6 +95,11 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
   Status GetBounds(std::string* min_encoded_key,
                    std::string* max_encoded_key) const;
 
+  // See RowSet::SampleEncodedKeys
+  Status SampleEncodedKeys(int num_samples,
+                           const fs::IOContext* io_context,
+                           std::vector<std::string>* keys) const;
+
   // The on-disk size, in bytes, of this cfile set's ad hoc index.
   // Returns 0 if there is no ad hoc index.
   uint64_t AdhocIndexOnDiskSize() const;
@@ -97,8 +108,16 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
   // Returns 0 if there are no bloomfiles.
   uint64_t BloomFileOnDiskSize() const;
 
+  // The on-disk size, in bytes, of this cfile set's secondary indexes.
+  uint64_t SecondaryIndexOnDiskSize() const;
+
+  // The on-disk size, in bytes, of this cfile set's rollup.
+  // Returns 0 if there is no rollup.
+  uint64_t RollupOnDiskSize() const;
+
   // The size on-disk of this cfile set's data, in bytes.
-  // Excludes the ad hoc index and bloomfiles.
+  // Excludes the ad hoc index, the secondary indexes, the rollup and
+  // bloomfiles.
   uint64_t OnDiskDataSize() const;
 
   // The size on-disk of column cfile's data, in bytes.
@@ -120,15 +139,73 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
   Status CheckRowPresent(const RowSetKeyProbe& probe, const fs::IOContext* io_context,
                          bool* present, rowid_t* rowid, ProbeStats* stats) const;
 
+  // Check if each of the given rows, sorted by increasing key, is present,
+  // like CheckRowPresent(). Sets (*present)[i] and (*rowids)[i] for
+  // probes[i], whose stats are added to stats[i]. The bloom filter probes
+  // are batched, and a single key index iterator is used.
+  Status CheckRowsPresent(const std::vector<const RowSetKeyProbe*>& probes,
+                          const std::vector<ProbeStats*>& stats,
+                          const fs::IOContext* io_context,
+                          std::vector<bool>* present,
+                          std::vector<rowid_t>* rowids) const;
+
   // Return true if there exists a CFile for the given column ID.
   bool has_data_for_column_id(ColumnId col_id) const {
     return ContainsKey(readers_by_col_id_, col_id);
   }
 
+  // Return true if there exists a secondary index for the given column ID.
+  bool has_secondary_index_for_column_id(ColumnId col_id) const {
+    return ContainsKey(index_readers_by_col_id_, col_id);
+  }
+
+  // Sets 'rowids' to the sorted indexes of the rows whose base data matches
+  // 'pred', an equality or IN-list predicate, looked up in the secondary index
+  // of the column of the given ID, which must exist.
+  //
+  // Returns Incomplete if more than 'max_rows' rows match.
+  Status FindRowsInSecondaryIndex(ColumnId col_id,
+                                  const ColumnPredicate& pred,
+                                  size_t max_rows,
+                                  const fs::IOContext* io_context,
+                                  std::vector<rowid_t>* rowids) const;
+
+  // Return true if there exists a rollup of the base data.
+  bool has_rollup() const {
+    return rollup_reader_ != nullptr;
+  }
+
+  // Sets 'key_columns' and 'columns' to the current names of the columns the
+  // groups of the rollup, which must exist, are keyed by and aggregate.
+  //
+  // Returns NotFound if a column of the rollup was dropped.
+  Status GetRollupColumns(std::vector<std::string>* key_columns,
+                          std::vector<std::string>* columns) const;
+
+  // Sets 'groups' to the groups of the rollup, which must exist.
+  Status ReadRollup(const fs::IOContext* io_context,
+                    std::vector<AggregatedGroup>* groups) const;
+
+  // Sets '*reader' to the reader of the CFile of the given column ID, fully
+  // opening it if it was lazily opened, or to nullptr if there's no such
+  // CFile. The reader remains valid for the lifetime of this object.
+  Status GetColumnReader(ColumnId col_id,
+                         const fs::IOContext* io_context,
+                         cfile::CFileReader** reader) const;
+
+  // Fully opens the lazily opened CFiles of the columns of 'projection'. If
+  // --cfile_set_open_threads is positive and several CFiles are unopened,
+  // their footers and headers are read in parallel. Otherwise, this is a
+  // no-op: each CFile is opened when its first iterator is created.
+  Status InitColumnReaders(const Schema& projection,
+                           const fs::IOContext* io_context) const;
+
   virtual ~CFileSet();
 
  private:
   friend class Iterator;
+  FRIEND_TEST(TestCFileSet, TestKeyIndex);
+  FRIEND_TEST(TestCFileSet, TestParallelOpen);
 
   DISALLOW_COPY_AND_ASSIGN(CFileSet);
 
@@ -137,6 +214,8 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
 
   Status DoOpen(const fs::IOContext* io_context);
   Status OpenBloomReader(const fs::IOContext* io_context);
+  Status OpenSecondaryIndexReaders(const fs::IOContext* io_context);
+  Status OpenRollupReader(const fs::IOContext* io_context);
   Status LoadMinMaxKeys(const fs::IOContext* io_context);
 
   Status NewColumnIterator(ColumnId col_id,
@@ -146,6 +225,18 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
   Status NewKeyIterator(const fs::IOContext* io_context,
                         std::unique_ptr<cfile::CFileIterator>* key_iter) const;
 
+  // Loads the in-memory key index, if it hasn't been attempted yet and it
+  // fits in --cfile_set_key_index_memory_limit_mb. The key index reader must
+  // be initialized.
+  Status InitKeyIndex(const fs::IOContext* io_context) const;
+
+  // Looks up the given row key with 'key_iter', and sets *idx to its index, or
+  // to boost::none if the row is not found. Goes directly to the data block
+  // which may hold the key if the key index was loaded.
+  Status SeekToRow(cfile::CFileIterator* key_iter,
+                   const RowSetKeyProbe& probe,
+                   boost::optional<rowid_t>* idx) const;
+
   // Return the CFileReader responsible for reading the key index.
   // (the ad-hoc reader for composite keys, otherwise the key column reader)
   cfile::CFileReader* key_index_reader() const;
@@ -169,6 +260,21 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
   // index pertains to more than one column, as in the case of composite keys.
   std::unique_ptr<cfile::CFileReader> ad_hoc_idx_reader_;
   std::unique_ptr<cfile::BloomFileReader> bloom_reader_;
+
+  // The in-memory copy of the leaf entries of the key index, loaded by the
+  // first key lookup. Null if it doesn't fit in the memory limit.
+  mutable KuduOnceLambda key_index_once_;
+  mutable std::unique_ptr<RowSetKeyIndex> key_index_;
+
+  // Map of column ID to the reader of the column's secondary index.
+  typedef boost::container::flat_map<int, std::unique_ptr<SecondaryIndexReader>>
+      IndexReaderMap;
+  IndexReaderMap index_readers_by_col_id_;
+
+  // The reader of the rollup, if any, and the IDs of the columns it's over.
+  std::unique_ptr<RollupReader> rollup_reader_;
+  std::vector<ColumnId> rollup_key_col_ids_;
+  std::vector<ColumnId> rollup_col_ids_;
 };
 
 
@@ -242,6 +348,28 @@ class CFileSet::Iterator : public ColumnwiseIterator {
   // Prepare the given column if not already prepared.
   Status PrepareColumn(ColumnMaterializationContext *ctx);
 
+  // If few enough rows of the batch are selected, fills 'selected_runs_' with
+  // the ranges of the batch containing the selected rows and returns true.
+  // Each range starts on a multiple of 8 rows, and ranges separated by fewer
+  // than --cfile_set_late_materialization_min_gap_rows rows are merged.
+  bool FindSelectedRuns(const SelectionVector& sel);
+
+  // Materializes only the rows of the batch in 'selected_runs_' of the
+  // column, without preparing the column for the whole batch.
+  Status MaterializeSelectedRuns(ColumnMaterializationContext* ctx);
+
+  // If the predicate of 'ctx' may be evaluated with the secondary index of
+  // its column, sets '*rowids' to the indexes of the rows matching it, looking
+  // them up the first time. Otherwise, sets '*rowids' to nullptr.
+  Status GetIndexedRows(const ColumnMaterializationContext& ctx,
+                        const std::vector<rowid_t>** rowids);
+
+  // Evaluates the predicate of 'ctx' by unselecting the rows of the batch
+  // which aren't in 'rowids', and materializes the column for the rows which
+  // remain selected.
+  Status MaterializeIndexedRows(ColumnMaterializationContext* ctx,
+                                const std::vector<rowid_t>& rowids);
+
   const std::shared_ptr<CFileSet const> base_data_;
   const Schema* projection_;
 
@@ -270,6 +398,22 @@ class CFileSet::Iterator : public ColumnwiseIterator {
   // materialized, it doesn't need to be read off disk.
   std::vector<bool> cols_prepared_;
 
+  // The [start, end) offsets within the batch of the ranges materialized by
+  // MaterializeSelectedRuns().
+  std::vector<std::pair<size_t, size_t>> selected_runs_;
+
+  // The rows matching the predicates of the projected columns, looked up in
+  // their secondary indexes, indexed like 'col_iters_'.
+  struct IndexedRows {
+    // Whether the index was looked up.
+    bool looked_up = false;
+    // Whether the index may be used, i.e. whether the column has an index,
+    // the predicate is an equality or IN-list predicate and not too many rows
+    // match it.
+    bool usable = false;
+    std::vector<rowid_t> rowids;
+  };
+  std::vector<IndexedRows> indexed_rows_;
 };
 
 } // namespace tablet
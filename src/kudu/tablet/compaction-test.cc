@@ -66,9 +66,11 @@
 #include "kudu/tablet/tablet.pb.h"
 #include "kudu/tablet/tablet_mem_trackers.h"
 #include "kudu/tablet/tablet_metadata.h"
+#include "kudu/tablet/tablet_metrics.h"
 #include "kudu/util/env.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/memory/arena.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
@@ -87,6 +89,9 @@ DEFINE_int32(merge_benchmark_num_rowsets, 3,
 DEFINE_int32(merge_benchmark_num_rows_per_rowset, 500000,
              "Number of rowsets as input to the merge");
 
+DECLARE_bool(tablet_compaction_copy_data_blocks);
+DECLARE_int32(tablet_compaction_min_key_range_size_mb);
+DECLARE_int32(tablet_compaction_num_key_ranges);
 DECLARE_string(block_manager);
 
 using std::shared_ptr;
@@ -940,6 +945,97 @@ TEST_F(TestCompaction, TestOneToOne) {
   DoFlushAndReopen(compact_input.get(), schema_, snap3, kLargeRollThreshold, nullptr);
 }
 
+// Test that flushes drop the rows expired by the TTL column, and that the
+// deltas they miss are dropped with them.
+TEST_F(TestCompaction, TestFlushDropsExpiredRows) {
+  ColumnStorageAttributes ttl_attributes;
+  ttl_attributes.ttl_seconds = 1;
+  SchemaBuilder builder;
+  ASSERT_OK(builder.AddKeyColumn("key", STRING));
+  ASSERT_OK(builder.AddColumn(ColumnSchema("ts", UNIXTIME_MICROS, false, nullptr, nullptr,
+                                           ttl_attributes), false));
+  const Schema schema = builder.Build();
+  const ColumnId ts_col_id = schema.column_id(1);
+
+  shared_ptr<MemRowSet> mrs;
+  ASSERT_OK(MemRowSet::Create(0, schema, log_anchor_registry_.get(),
+                              mem_trackers_.tablet_tracker, &mrs));
+  const auto key = [](int i) { return Substitute("row $0", i); };
+  for (int i = 0; i < 10; i++) {
+    ScopedTransaction tx(&mvcc_, clock_->Now());
+    tx.StartApplying();
+    RowBuilder rb(schema);
+    rb.AddString(key(i));
+    rb.AddTimestamp(i * 100);
+    ASSERT_OK(mrs->Insert(tx.timestamp(), rb.row(), op_id_));
+    tx.Commit();
+  }
+  const auto mutate = [&](RowSet* rs, int i, const int64_t* ts) {
+    ScopedTransaction tx(&mvcc_, clock_->Now());
+    tx.StartApplying();
+    faststring buf;
+    RowChangeListEncoder enc(&buf);
+    if (ts) {
+      enc.AddColumnUpdate(schema.column_by_id(ts_col_id), ts_col_id, ts);
+    } else {
+      enc.SetToDelete();
+    }
+    RowBuilder rb(schema.CreateKeyProjection());
+    rb.AddString(key(i));
+    RowSetKeyProbe probe(rb.row());
+    ProbeStats stats;
+    OperationResultPB result;
+    RETURN_NOT_OK(rs->MutateRow(tx.timestamp(), probe, RowChangeList(buf), op_id_,
+                                nullptr, &stats, &result));
+    tx.Commit();
+    return Status::OK();
+  };
+  // The rows whose timestamp is below 500 are expired, unless they're
+  // deleted: row 2 is refreshed, row 7 expires, and row 3 is deleted.
+  const int64_t kFresh = 1000;
+  const int64_t kStale = 0;
+  ASSERT_OK(mutate(mrs.get(), 2, &kFresh));
+  ASSERT_OK(mutate(mrs.get(), 7, &kStale));
+  ASSERT_OK(mutate(mrs.get(), 3, nullptr));
+  const HistoryGcOpts history_gc_opts = HistoryGcOpts::Disabled().WithRowExpiration(500);
+
+  MvccSnapshot snap(mvcc_);
+  gscoped_ptr<CompactionInput> input(CompactionInput::Create(*mrs, &schema, snap));
+  RollingDiskRowSetWriter rsw(tablet()->metadata(), schema, Tablet::DefaultBloomSizing(),
+                              kLargeRollThreshold);
+  ASSERT_OK(rsw.Open());
+  int64_t rows_gced = 0;
+  ASSERT_OK(FlushCompactionInput(input.get(), snap, history_gc_opts, &rsw, &rows_gced));
+  ASSERT_OK(rsw.Finish());
+  ASSERT_EQ(4, rows_gced);
+  ASSERT_EQ(6, rsw.rows_written_count());
+  vector<shared_ptr<RowSetMetadata>> metas;
+  rsw.GetWrittenRowSetMetadata(&metas);
+  ASSERT_EQ(1, metas.size());
+  shared_ptr<DiskRowSet> rs;
+  ASSERT_OK(DiskRowSet::Open(metas[0], log_anchor_registry_.get(), mem_trackers_, nullptr, &rs));
+
+  // Mutations missed by the flush go to the output row, if it wasn't dropped.
+  ASSERT_OK(mutate(mrs.get(), 9, &kFresh));
+  ASSERT_OK(mutate(mrs.get(), 0, &kFresh));
+  MvccSnapshot snap2(mvcc_);
+  input.reset(CompactionInput::Create(*mrs, &schema, snap2));
+  ASSERT_OK(ReupdateMissedDeltas(nullptr, input.get(), history_gc_opts, snap, snap2, { rs }));
+
+  vector<string> out;
+  ASSERT_OK(CompactionInput::Create(*rs, &schema, MvccSnapshot(mvcc_), nullptr, &input));
+  IterateInput(input.get(), &out);
+  const vector<int> kKeptRows = { 2, 3, 5, 6, 8, 9 };
+  ASSERT_EQ(kKeptRows.size(), out.size());
+  for (int i = 0; i < out.size(); i++) {
+    SCOPED_TRACE(out[i]);
+    ASSERT_STR_CONTAINS(out[i], Substitute("\"$0\"", key(kKeptRows[i])));
+    // Row 3 is still deleted, and row 9 has the update it missed.
+    ASSERT_EQ(kKeptRows[i] == 3 || kKeptRows[i] == 9,
+              out[i].find("Redo Mutations: [];") == string::npos);
+  }
+}
+
 // Test merging two row sets and the second one has updates, KUDU-102
 // We re-create the conditions by providing two DRS that are both the input and the
 // output of a compaction, and trying to merge two MRS.
@@ -1110,6 +1206,109 @@ TEST_F(TestCompaction, TestConcurrentCompactionRowSetPicking) {
   ASSERT_EQ(kExpectedRows, num_rows);
 }
 
+// Test that a compaction split into key ranges merged in parallel outputs the
+// same rows as one which isn't split.
+TEST_F(TestCompaction, TestCompactionInKeyRanges) {
+  FLAGS_tablet_compaction_num_key_ranges = 4;
+  FLAGS_tablet_compaction_min_key_range_size_mb = 0;
+  const int kNumRowSets = 4;
+  const int kNumRowsPerRowSet = 1000;
+  {
+    LocalTabletWriter writer(tablet().get(), &client_schema());
+    KuduPartialRow row(&client_schema());
+
+    // Flush overlapping rowsets, then update and delete some of the rows.
+    for (int i = 0; i < kNumRowSets; i++) {
+      for (int j = 0; j < kNumRowsPerRowSet; j++) {
+        const int val = i + j * kNumRowSets;
+        ASSERT_OK(row.SetStringCopy("key", Substitute("hello $0", val)));
+        ASSERT_OK(row.SetInt32("val", val));
+        ASSERT_OK(writer.Insert(row));
+      }
+      ASSERT_OK(tablet()->Flush());
+    }
+    for (int val = 0; val < kNumRowSets * kNumRowsPerRowSet; val += 7) {
+      ASSERT_OK(row.SetStringCopy("key", Substitute("hello $0", val)));
+      if (val % 2 == 0) {
+        ASSERT_OK(row.SetInt32("val", -val));
+        ASSERT_OK(writer.Update(row));
+      } else {
+        ASSERT_OK(writer.Delete(row));
+      }
+    }
+  }
+  vector<string> rows_before;
+  ASSERT_OK(DumpTablet(*tablet(), client_schema(), &rows_before));
+
+  ASSERT_OK(tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  ASSERT_GT(tablet()->num_rowsets(), 1);
+  vector<string> rows_after;
+  ASSERT_OK(DumpTablet(*tablet(), client_schema(), &rows_after));
+  ASSERT_EQ(rows_before, rows_after);
+
+  // The work of the merges of all the key ranges is accounted for.
+  const TabletMetrics* metrics = tablet()->metrics();
+  ASSERT_GT(metrics->compact_rs_bytes_read->value(), 0);
+  ASSERT_GT(metrics->compact_rs_bytes_written->value(), 0);
+  ASSERT_LE(metrics->compact_rs_bytes_written->value(), metrics->bytes_flushed->value());
+  ASSERT_GT(metrics->compact_rs_cpu_time->value(), 0);
+}
+
+// Test compacting rowsets some of which don't overlap any other and have no
+// mutations, whose data blocks are copied.
+TEST_F(TestCompaction, TestCompactionCopiesDataBlocks) {
+  FLAGS_tablet_compaction_copy_data_blocks = true;
+  const int kNumRowsPerRowSet = 1000;
+  {
+    LocalTabletWriter writer(tablet().get(), &client_schema());
+    KuduPartialRow row(&client_schema());
+    const auto insert_rows = [&](const string& prefix, int first, int step) {
+      for (int j = 0; j < kNumRowsPerRowSet; j++) {
+        const int val = first + j * step;
+        RETURN_NOT_OK(row.SetStringCopy("key", Substitute("$0 $1", prefix, val)));
+        RETURN_NOT_OK(row.SetInt32("val", val));
+        if (val % 3 == 0) {
+          RETURN_NOT_OK(row.SetNull("nullable_val"));
+        } else {
+          RETURN_NOT_OK(row.SetInt32("nullable_val", -val));
+        }
+        RETURN_NOT_OK(writer.Insert(row));
+      }
+      return tablet()->Flush();
+    };
+    // Two rowsets which don't overlap, in between two overlapping ones, and
+    // a last one which doesn't overlap but whose rows are updated.
+    ASSERT_OK(insert_rows("a", 0, 1));
+    ASSERT_OK(insert_rows("b", 0, 2));
+    ASSERT_OK(insert_rows("b", 1, 2));
+    ASSERT_OK(insert_rows("c", 0, 1));
+    ASSERT_OK(insert_rows("d", 0, 1));
+    for (int val = 0; val < kNumRowsPerRowSet; val += 7) {
+      for (const char* prefix : { "b", "d" }) {
+        ASSERT_OK(row.SetStringCopy("key", Substitute("$0 $1", prefix, val)));
+        if (val % 2 == 0) {
+          ASSERT_OK(row.SetInt32("val", -val));
+          ASSERT_OK(writer.Update(row));
+        } else {
+          ASSERT_OK(writer.Delete(row));
+        }
+      }
+    }
+  }
+  vector<string> rows_before;
+  ASSERT_OK(DumpTablet(*tablet(), client_schema(), &rows_before));
+
+  ASSERT_OK(tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  vector<string> rows_after;
+  ASSERT_OK(DumpTablet(*tablet(), client_schema(), &rows_after));
+  ASSERT_EQ(rows_before, rows_after);
+
+  // The output rowsets, whose blocks are copied again by another compaction.
+  ASSERT_OK(tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  ASSERT_OK(DumpTablet(*tablet(), client_schema(), &rows_after));
+  ASSERT_EQ(rows_before, rows_after);
+}
+
 TEST_F(TestCompaction, TestCompactionFreesDiskSpace) {
   {
     // We must force the LocalTabletWriter out of scope before measuring
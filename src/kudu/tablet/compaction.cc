@@ -19,16 +19,21 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <deque>
 #include <memory>
 #include <ostream>
 #include <string>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include <glog/logging.h>
 
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/zone_map.h"
 #include "kudu/clock/hybrid_clock.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/generic_iterators.h"
 #include "kudu/common/iterator.h"
 #include "kudu/common/row.h"
@@ -59,6 +64,7 @@
 using kudu::clock::HybridClock;
 using kudu::fs::IOContext;
 using std::deque;
+using std::pair;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
@@ -91,15 +97,25 @@ class MemRowSetCompactionInput : public CompactionInput {
                            const MvccSnapshot& snap,
                            const Schema* projection)
     : arena_(32*1024),
-      has_more_blocks_(false) {
+      has_more_blocks_(false),
+      reached_upper_bound_(false) {
     RowIteratorOptions opts;
     opts.projection = projection;
     opts.snap_to_include = snap;
     iter_.reset(memrowset.NewIterator(opts));
   }
 
+  void SetKeyRange(const EncodedKey* lower_bound, const EncodedKey* upper_bound) override {
+    if (lower_bound) {
+      key_range_.SetLowerBoundKey(lower_bound);
+    }
+    if (upper_bound) {
+      key_range_.SetExclusiveUpperBoundKey(upper_bound);
+    }
+  }
+
   Status Init() override {
-    RETURN_NOT_OK(iter_->Init(nullptr));
+    RETURN_NOT_OK(iter_->Init(&key_range_));
     has_more_blocks_ = iter_->HasNext();
     return Status::OK();
   }
@@ -122,6 +138,10 @@ class MemRowSetCompactionInput : public CompactionInput {
     RowChangeListEncoder undo_encoder(&buffer_);
     int next_row_index = 0;
     for (int i = 0; i < num_in_block; ++i) {
+      if (iter_->has_upper_bound() && iter_->out_of_bounds(iter_->GetCurrentEncodedKey())) {
+        reached_upper_bound_ = true;
+        break;
+      }
       // TODO(todd): A copy is performed to make all CompactionInputRow have the same schema
       CompactionInputRow& input_row = block->at(next_row_index);
       input_row.row.Reset(row_block_.get(), next_row_index);
@@ -162,7 +182,7 @@ class MemRowSetCompactionInput : public CompactionInput {
       block->resize(next_row_index);
     }
 
-    has_more_blocks_ = iter_->HasNext();
+    has_more_blocks_ = !reached_upper_bound_ && iter_->HasNext();
     return Status::OK();
   }
 
@@ -187,7 +207,13 @@ class MemRowSetCompactionInput : public CompactionInput {
 
   faststring buffer_;
 
+  // The key range of the input.
+  ScanSpec key_range_;
+
   bool has_more_blocks_;
+
+  // Set once a row past the upper bound of the key range was found.
+  bool reached_upper_bound_;
 };
 
 ////////////////////////////////////////////////////////////
@@ -195,10 +221,12 @@ class MemRowSetCompactionInput : public CompactionInput {
 // CompactionInput yielding rows and mutations from an on-disk DiskRowSet.
 class DiskRowSetCompactionInput : public CompactionInput {
  public:
-  DiskRowSetCompactionInput(unique_ptr<RowwiseIterator> base_iter,
+  DiskRowSetCompactionInput(const CFileSet::Iterator* base_cfile_iter,
+                            unique_ptr<RowwiseIterator> base_iter,
                             unique_ptr<DeltaIterator> redo_delta_iter,
                             unique_ptr<DeltaIterator> undo_delta_iter)
-      : base_iter_(std::move(base_iter)),
+      : base_cfile_iter_(base_cfile_iter),
+        base_iter_(std::move(base_iter)),
         redo_delta_iter_(std::move(redo_delta_iter)),
         undo_delta_iter_(std::move(undo_delta_iter)),
         arena_(32 * 1024),
@@ -206,14 +234,27 @@ class DiskRowSetCompactionInput : public CompactionInput {
         redo_mutation_block_(kRowsPerBlock, static_cast<Mutation *>(nullptr)),
         undo_mutation_block_(kRowsPerBlock, static_cast<Mutation *>(nullptr)) {}
 
+  void SetKeyRange(const EncodedKey* lower_bound, const EncodedKey* upper_bound) override {
+    lower_bound_ = lower_bound;
+    upper_bound_ = upper_bound;
+  }
+
   Status Init() override {
     ScanSpec spec;
     spec.set_cache_blocks(false);
+    if (lower_bound_) {
+      spec.SetLowerBoundKey(lower_bound_);
+    }
+    if (upper_bound_) {
+      spec.SetExclusiveUpperBoundKey(upper_bound_);
+    }
     RETURN_NOT_OK(base_iter_->Init(&spec));
+    // The key range is pushed down into a range of ordinals in the base data.
+    const rowid_t first_row_idx = base_cfile_iter_->cur_ordinal_idx();
     RETURN_NOT_OK(redo_delta_iter_->Init(&spec));
-    RETURN_NOT_OK(redo_delta_iter_->SeekToOrdinal(0));
+    RETURN_NOT_OK(redo_delta_iter_->SeekToOrdinal(first_row_idx));
     RETURN_NOT_OK(undo_delta_iter_->Init(&spec));
-    RETURN_NOT_OK(undo_delta_iter_->SeekToOrdinal(0));
+    RETURN_NOT_OK(undo_delta_iter_->SeekToOrdinal(first_row_idx));
     return Status::OK();
   }
 
@@ -259,6 +300,8 @@ class DiskRowSetCompactionInput : public CompactionInput {
 
  private:
   DISALLOW_COPY_AND_ASSIGN(DiskRowSetCompactionInput);
+  // The iterator over the base data, owned by 'base_iter_'.
+  const CFileSet::Iterator* base_cfile_iter_;
   unique_ptr<RowwiseIterator> base_iter_;
   unique_ptr<DeltaIterator> redo_delta_iter_;
   unique_ptr<DeltaIterator> undo_delta_iter_;
@@ -270,6 +313,10 @@ class DiskRowSetCompactionInput : public CompactionInput {
   vector<Mutation *> redo_mutation_block_;
   vector<Mutation *> undo_mutation_block_;
 
+  // The key range of the input, if any.
+  const EncodedKey* lower_bound_ = nullptr;
+  const EncodedKey* upper_bound_ = nullptr;
+
   enum {
     kRowsPerBlock = 100
   };
@@ -424,6 +471,12 @@ class MergeCompactionInput : public CompactionInput {
     STLDeleteElements(&states_);
   }
 
+  void SetKeyRange(const EncodedKey* lower_bound, const EncodedKey* upper_bound) override {
+    for (MergeState *state : states_) {
+      state->input->SetKeyRange(lower_bound, upper_bound);
+    }
+  }
+
   Status Init() override {
     for (MergeState *state : states_) {
       RETURN_NOT_OK(state->input->Init());
@@ -852,7 +905,8 @@ Status CompactionInput::Create(const DiskRowSet &rowset,
                                gscoped_ptr<CompactionInput>* out) {
   CHECK(projection->has_column_ids());
 
-  unique_ptr<ColumnwiseIterator> base_cwise(rowset.base_data_->NewIterator(projection, io_context));
+  unique_ptr<CFileSet::Iterator> base_cwise(rowset.base_data_->NewIterator(projection, io_context));
+  const CFileSet::Iterator* base_cfile_iter = base_cwise.get();
   unique_ptr<RowwiseIterator> base_iter(NewMaterializingIterator(std::move(base_cwise)));
 
   // Creates a DeltaIteratorMerger that will only include the relevant REDO deltas.
@@ -873,7 +927,8 @@ Status CompactionInput::Create(const DiskRowSet &rowset,
   RETURN_NOT_OK_PREPEND(rowset.delta_tracker_->NewDeltaIterator(
       undo_opts, DeltaTracker::UNDOS_ONLY, &undo_deltas), "Could not open UNDOs");
 
-  out->reset(new DiskRowSetCompactionInput(std::move(base_iter),
+  out->reset(new DiskRowSetCompactionInput(base_cfile_iter,
+                                           std::move(base_iter),
                                            std::move(redo_deltas),
                                            std::move(undo_deltas)));
   return Status::OK();
@@ -1092,16 +1147,128 @@ Status ApplyMutationsAndGenerateUndos(const MvccSnapshot& snap,
   #undef ERROR_LOG_CONTEXT
 }
 
-Status FlushCompactionInput(CompactionInput* input,
-                            const MvccSnapshot& snap,
-                            const HistoryGcOpts& history_gc_opts,
-                            RollingDiskRowSetWriter* out) {
+namespace {
+
+// Returns the value of the TTL column of 'row', at index 'ttl_col_idx' of its
+// schema.
+int64_t GetTtlValue(const RowBlockRow& row, int ttl_col_idx) {
+  return *reinterpret_cast<const int64_t*>(row.cell_ptr(ttl_col_idx));
+}
+
+// Sets '*expired' to whether FlushCompactionInputRows() dropped 'row' as
+// expired when flushing it at 'snap': the row is expired if the TTL column, at
+// index 'ttl_col_idx' of its schema, is expired in its latest version in
+// 'snap', unless it's deleted in that version.
+Status IsRowExpiredInSnapshot(const CompactionInputRow& row,
+                              const MvccSnapshot& snap,
+                              const HistoryGcOpts& history_gc_opts,
+                              int ttl_col_idx,
+                              bool* expired) {
+  const ColumnId ttl_col_id = row.row.schema()->column_id(ttl_col_idx);
+  int64_t ttl_value = GetTtlValue(row.row, ttl_col_idx);
+  bool deleted = false;
+  for (const Mutation* mut = row.redo_head; mut != nullptr; mut = mut->acquire_next()) {
+    if (!snap.IsCommitted(mut->timestamp())) {
+      continue;
+    }
+    RowChangeListDecoder decoder(mut->changelist());
+    RETURN_NOT_OK(decoder.Init());
+    deleted = decoder.is_delete();
+    if (deleted) {
+      continue;
+    }
+    while (decoder.HasNext()) {
+      RowChangeListDecoder::DecodedUpdate update;
+      RETURN_NOT_OK(decoder.DecodeNext(&update));
+      if (update.col_id == ttl_col_id && !update.null &&
+          update.raw_value.size() == sizeof(ttl_value)) {
+        memcpy(&ttl_value, update.raw_value.data(), sizeof(ttl_value));
+      }
+    }
+  }
+  *expired = !deleted && history_gc_opts.IsExpired(ttl_value);
+  return Status::OK();
+}
+
+// The expiration of the rows of a DiskRowSet without deltas.
+enum class RowSetExpiration {
+  // No row is expired.
+  NONE,
+  // Some rows may be expired.
+  SOME,
+  // All the rows are expired.
+  ALL,
+};
+
+// Determines the expiration of the rows of 'drs', which must have no deltas,
+// from the zone map of its TTL column: there's no need to read the rows of a
+// rowset which is wholly expired, nor to check those of a rowset which has no
+// expired rows.
+Status GetRowSetExpiration(const DiskRowSet& drs,
+                           const Schema& schema,
+                           const HistoryGcOpts& history_gc_opts,
+                           const IOContext* io_context,
+                           RowSetExpiration* expiration) {
+  *expiration = RowSetExpiration::NONE;
+  const int ttl_col_idx = history_gc_opts.expiration_enabled() ?
+      schema.find_ttl_column() : Schema::kColumnNotFound;
+  if (ttl_col_idx == Schema::kColumnNotFound) {
+    return Status::OK();
+  }
+  rowid_t num_rows;
+  RETURN_NOT_OK(drs.CountRows(io_context, &num_rows));
+  if (num_rows == 0) {
+    return Status::OK();
+  }
+
+  // The column may have been added after the rowset was written, or its file
+  // may have no zone map: the rows must then be checked one by one.
+  *expiration = RowSetExpiration::SOME;
+  cfile::CFileReader* reader;
+  RETURN_NOT_OK(drs.GetBaseDataColumnReader(schema.column_id(ttl_col_idx), io_context, &reader));
+  if (reader == nullptr) {
+    return Status::OK();
+  }
+  const cfile::ZoneMap* zone_map;
+  RETURN_NOT_OK(reader->GetZoneMap(io_context, &zone_map));
+  if (zone_map == nullptr) {
+    return Status::OK();
+  }
+  const ColumnSchema& col = schema.column(ttl_col_idx);
+  const int64_t cutoff = history_gc_opts.expiration_cutoff_micros();
+  if (!zone_map->MayMatch(ColumnPredicate::Range(col, nullptr, &cutoff), 0, num_rows - 1)) {
+    *expiration = RowSetExpiration::NONE;
+  } else if (!zone_map->MayMatch(ColumnPredicate::Range(col, &cutoff, nullptr),
+                                 0, num_rows - 1)) {
+    *expiration = RowSetExpiration::ALL;
+  }
+  return Status::OK();
+}
+
+// Flushes the rows of 'input' to 'out'. The rows may be projected on a subset
+// of the columns of the output, the others having already been appended with
+// RollingDiskRowSetWriter::AppendColumnDataBlocks().
+//
+// If 'passthrough' is true, every row of the input is expected to be written
+// as is: the output is never rolled, and IllegalState is returned if a row is
+// mutated in 'snap' or garbage collected.
+Status FlushCompactionInputRows(CompactionInput* input,
+                                const MvccSnapshot& snap,
+                                const HistoryGcOpts& history_gc_opts,
+                                bool passthrough,
+                                RollingDiskRowSetWriter* out,
+                                int64_t* rows_gced) {
   RETURN_NOT_OK(input->Init());
   vector<CompactionInputRow> rows;
 
-  DCHECK(out->schema().has_column_ids());
+  DCHECK(input->schema().has_column_ids());
 
-  RowBlock block(out->schema(), kCompactionOutputBlockNumRows, nullptr);
+  RowBlock block(input->schema(), kCompactionOutputBlockNumRows, nullptr);
+
+  // The TTL column is projected out of a rowset whose data blocks are copied,
+  // but such a rowset has no expired rows.
+  const int ttl_col_idx = history_gc_opts.expiration_enabled() ?
+      input->schema().find_ttl_column() : Schema::kColumnNotFound;
 
   while (input->HasMoreBlocks()) {
     RETURN_NOT_OK(input->PrepareBlock(&rows));
@@ -1109,12 +1276,25 @@ Status FlushCompactionInput(CompactionInput* input,
     int n = 0;
     for (int i = 0; i < rows.size(); i++) {
       CompactionInputRow* input_row = &rows[i];
-      RETURN_NOT_OK(out->RollIfNecessary());
+      if (!passthrough) {
+        RETURN_NOT_OK(out->RollIfNecessary());
+      }
 
       const Schema* schema = input_row->row.schema();
-      DCHECK_SCHEMA_EQ(*schema, out->schema());
+      DCHECK_SCHEMA_EQ(*schema, input->schema());
       DCHECK(schema->has_column_ids());
 
+      if (passthrough) {
+        for (const Mutation* mut = input_row->redo_head;
+             mut != nullptr;
+             mut = mut->acquire_next()) {
+          if (PREDICT_FALSE(snap.IsCommitted(mut->timestamp()))) {
+            return Status::IllegalState("row mutated in a rowset whose data blocks were copied",
+                                        schema->DebugRow(input_row->row));
+          }
+        }
+      }
+
       RowBlockRow dst_row = block.row(n);
       RETURN_NOT_OK(CopyRow(input_row->row, &dst_row, static_cast<Arena*>(nullptr)));
 
@@ -1143,12 +1323,29 @@ Status FlushCompactionInput(CompactionInput* input,
                          new_redos_head,
                          &is_garbage_collected);
 
+      // Drop the row if it's expired in its latest version. A deleted row is
+      // garbage collected as any other, once its deletion is ancient history.
+      // See IsRowExpiredInSnapshot(), which must agree.
+      if (!is_garbage_collected && new_redos_head == nullptr &&
+          ttl_col_idx != Schema::kColumnNotFound &&
+          history_gc_opts.IsExpired(GetTtlValue(dst_row, ttl_col_idx))) {
+        is_garbage_collected = true;
+      }
+
       DVLOG(4) << "Output Row: " << RowToString(dst_row, new_redos_head, new_undos_head) <<
           "; Was garbage collected? " << is_garbage_collected;
 
       // Whether this row was garbage collected
       if (is_garbage_collected) {
+        if (PREDICT_FALSE(passthrough)) {
+          return Status::IllegalState(
+              "row garbage collected in a rowset whose data blocks were copied",
+              schema->DebugRow(input_row->row));
+        }
         // Don't flush the row.
+        if (rows_gced) {
+          (*rows_gced)++;
+        }
         continue;
       }
 
@@ -1183,6 +1380,188 @@ Status FlushCompactionInput(CompactionInput* input,
   return Status::OK();
 }
 
+// Return the columns of the base data of 'drs' whose data blocks may be
+// copied to the current output rowset of 'out', as pairs of the index of the
+// column in 'schema' and its reader.
+Status GetCopyableColumns(const DiskRowSet& drs,
+                          const Schema& schema,
+                          const IOContext* io_context,
+                          const RollingDiskRowSetWriter& out,
+                          vector<pair<int, cfile::CFileReader*>>* columns) {
+  columns->clear();
+  for (int i = schema.num_key_columns(); i < schema.num_columns(); i++) {
+    cfile::CFileReader* reader;
+    RETURN_NOT_OK(drs.GetBaseDataColumnReader(schema.column_id(i), io_context, &reader));
+    if (reader != nullptr && out.CanAppendColumnDataBlocks(i, *reader)) {
+      columns->emplace_back(i, reader);
+    }
+  }
+  return Status::OK();
+}
+
+// Flushes the rows of 'drs' to 'out', copying the data blocks of the columns
+// which allow it. See FlushRowSetsInCompaction().
+Status FlushRowSetWithDataBlocks(const DiskRowSet& drs,
+                                 const Schema& schema,
+                                 const MvccSnapshot& snap,
+                                 const HistoryGcOpts& history_gc_opts,
+                                 const IOContext* io_context,
+                                 RollingDiskRowSetWriter* out,
+                                 int64_t* rows_gced) {
+  // The copied blocks go to the rowset that the rows go to.
+  RETURN_NOT_OK(out->RollIfNecessary());
+
+  vector<pair<int, cfile::CFileReader*>> columns;
+  RETURN_NOT_OK(GetCopyableColumns(drs, schema, io_context, *out, &columns));
+  rowid_t num_rows;
+  RETURN_NOT_OK(drs.CountRows(io_context, &num_rows));
+
+  // The other columns are read and written row by row: that includes the
+  // keys, which are needed for the bloom filter and the ad hoc index.
+  vector<ColumnSchema> cols;
+  vector<ColumnId> col_ids;
+  int next_copied = 0;
+  for (int i = 0; i < schema.num_columns(); i++) {
+    if (next_copied < columns.size() && columns[next_copied].first == i) {
+      next_copied++;
+      continue;
+    }
+    cols.push_back(schema.column(i));
+    col_ids.push_back(schema.column_id(i));
+  }
+  const Schema projection(cols, col_ids, schema.num_key_columns());
+
+  VLOG(1) << Substitute("Copying the data blocks of $0 of $1 columns of $2 ($3 rows)",
+                        columns.size(), schema.num_columns(), drs.ToString(), num_rows);
+  const int64_t rows_written_before = out->rows_written_count();
+  RETURN_NOT_OK(out->AppendColumnDataBlocks(columns, num_rows, io_context));
+
+  gscoped_ptr<CompactionInput> input;
+  RETURN_NOT_OK(CompactionInput::Create(drs, &projection, snap, io_context, &input));
+  RETURN_NOT_OK(FlushCompactionInputRows(input.get(), snap, history_gc_opts,
+                                         /*passthrough=*/true, out, rows_gced));
+  if (PREDICT_FALSE(out->rows_written_count() - rows_written_before != num_rows)) {
+    return Status::IllegalState(
+        Substitute("flushed $0 rows of $1 while copying its data blocks, expected $2",
+                   out->rows_written_count() - rows_written_before, drs.ToString(), num_rows));
+  }
+  return Status::OK();
+}
+
+} // anonymous namespace
+
+Status FlushCompactionInput(CompactionInput* input,
+                            const MvccSnapshot& snap,
+                            const HistoryGcOpts& history_gc_opts,
+                            RollingDiskRowSetWriter* out,
+                            int64_t* rows_gced) {
+  DCHECK_SCHEMA_EQ(input->schema(), out->schema());
+  return FlushCompactionInputRows(input, snap, history_gc_opts, /*passthrough=*/false,
+                                  out, rows_gced);
+}
+
+Status FlushRowSetsInCompaction(const RowSetsInCompaction& input,
+                                const Schema* schema,
+                                const MvccSnapshot& snap,
+                                const HistoryGcOpts& history_gc_opts,
+                                const IOContext* io_context,
+                                RollingDiskRowSetWriter* out,
+                                int64_t* rows_gced) {
+  DCHECK_SCHEMA_EQ(*schema, out->schema());
+  DCHECK(schema->has_column_ids());
+
+  // Sort the rowsets by their key ranges.
+  struct RowSetBounds {
+    shared_ptr<RowSet> rowset;
+    string min_key;
+    string max_key;
+  };
+  vector<RowSetBounds> sorted;
+  for (const auto& rs : input.rowsets()) {
+    RowSetBounds b;
+    b.rowset = rs;
+    RETURN_NOT_OK(rs->GetBounds(&b.min_key, &b.max_key));
+    sorted.emplace_back(std::move(b));
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [](const RowSetBounds& a, const RowSetBounds& b) {
+              return a.min_key < b.min_key;
+            });
+
+  // A rowset whose data blocks are copied must not overlap any other, so
+  // that its rows are output as a whole, in the same order as the merge of
+  // all the rowsets. Its rows must not be mutated or expired either.
+  //
+  // Likewise, a rowset whose rows are all expired is dropped as a whole.
+  vector<bool> copyable(sorted.size());
+  vector<bool> expired(sorted.size());
+  const string* prefix_max_key = nullptr;
+  for (int i = 0; i < sorted.size(); i++) {
+    const RowSetBounds& b = sorted[i];
+    const DiskRowSet* drs = dynamic_cast<const DiskRowSet*>(b.rowset.get());
+    copyable[i] = drs != nullptr &&
+        (prefix_max_key == nullptr || *prefix_max_key < b.min_key) &&
+        (i + 1 == sorted.size() || b.max_key < sorted[i + 1].min_key) &&
+        drs->CountDeltaStores() == 0 &&
+        drs->DeltaMemStoreEmpty();
+    if (copyable[i]) {
+      RowSetExpiration expiration;
+      RETURN_NOT_OK(GetRowSetExpiration(*drs, *schema, history_gc_opts, io_context,
+                                        &expiration));
+      expired[i] = expiration == RowSetExpiration::ALL;
+      copyable[i] = expiration == RowSetExpiration::NONE;
+    }
+    if (copyable[i]) {
+      vector<pair<int, cfile::CFileReader*>> columns;
+      RETURN_NOT_OK(GetCopyableColumns(*drs, *schema, io_context, *out, &columns));
+      copyable[i] = !columns.empty();
+    }
+    if (prefix_max_key == nullptr || *prefix_max_key < b.max_key) {
+      prefix_max_key = &b.max_key;
+    }
+  }
+
+  // Merge the runs of rowsets which can't be copied, in between the others.
+  int i = 0;
+  while (i < sorted.size()) {
+    if (expired[i]) {
+      rowid_t num_rows;
+      RETURN_NOT_OK(sorted[i].rowset->CountRows(io_context, &num_rows));
+      VLOG(1) << Substitute("Dropping $0: all its $1 rows are expired",
+                            sorted[i].rowset->ToString(), num_rows);
+      if (rows_gced) {
+        *rows_gced += num_rows;
+      }
+      i++;
+      continue;
+    }
+    if (copyable[i]) {
+      RETURN_NOT_OK(FlushRowSetWithDataBlocks(
+          *down_cast<DiskRowSet*>(sorted[i].rowset.get()), *schema, snap,
+          history_gc_opts, io_context, out, rows_gced));
+      i++;
+      continue;
+    }
+    vector<shared_ptr<CompactionInput>> inputs;
+    for (; i < sorted.size() && !copyable[i] && !expired[i]; i++) {
+      gscoped_ptr<CompactionInput> rs_input;
+      RETURN_NOT_OK_PREPEND(sorted[i].rowset->NewCompactionInput(schema, snap, io_context,
+                                                                 &rs_input),
+                            Substitute("Could not create compaction input for rowset $0",
+                                       sorted[i].rowset->ToString()));
+      inputs.emplace_back(rs_input.release());
+    }
+    shared_ptr<CompactionInput> merge;
+    if (inputs.size() == 1) {
+      merge.swap(inputs[0]);
+    } else {
+      merge.reset(CompactionInput::Merge(inputs, schema));
+    }
+    RETURN_NOT_OK(FlushCompactionInput(merge.get(), snap, history_gc_opts, out, rows_gced));
+  }
+  return Status::OK();
+}
+
 Status ReupdateMissedDeltas(const IOContext* io_context,
                             CompactionInput *input,
                             const HistoryGcOpts& history_gc_opts,
@@ -1216,6 +1595,8 @@ Status ReupdateMissedDeltas(const IOContext* io_context,
   vector<CompactionInputRow> rows;
   const Schema* schema = &input->schema();
   const Schema key_schema(input->schema().CreateKeyProjection());
+  const int ttl_col_idx = history_gc_opts.expiration_enabled() ?
+      schema->find_ttl_column() : Schema::kColumnNotFound;
 
   rowid_t output_row_offset = 0;
   while (input->HasMoreBlocks()) {
@@ -1224,6 +1605,13 @@ Status ReupdateMissedDeltas(const IOContext* io_context,
     for (const CompactionInputRow &row : rows) {
       DVLOG(4) << "Revisiting row: " << CompactionInputRowToString(row);
 
+      // The mutations missed by an expired row are dropped along with it.
+      bool is_expired = false;
+      if (ttl_col_idx != Schema::kColumnNotFound) {
+        RETURN_NOT_OK(IsRowExpiredInSnapshot(row, snap_to_exclude, history_gc_opts,
+                                             ttl_col_idx, &is_expired));
+      }
+
       bool is_garbage_collected = false;
       for (const Mutation *mut = row.redo_head;
            mut != nullptr;
@@ -1249,6 +1637,12 @@ Status ReupdateMissedDeltas(const IOContext* io_context,
         // garbage collected.
         DCHECK(!is_garbage_collected);
 
+        if (is_expired) {
+          DVLOG(3) << "Dropping missed delta for expired row " << schema->DebugRow(row.row)
+                   << " @" << mut->timestamp() << ": " << mut->changelist().ToString(*schema);
+          continue;
+        }
+
         // We should never see a REINSERT in an input RowSet which was not
         // caught in the original flush. REINSERT only occurs when an INSERT is
         // done to a row when a ghost is already present for that row in
@@ -1323,7 +1717,7 @@ Status ReupdateMissedDeltas(const IOContext* io_context,
         }
       }
 
-      if (is_garbage_collected) {
+      if (is_garbage_collected || is_expired) {
         DVLOG(4) << "Skipping GCed input row: " << schema->DebugRow(row.row)
                  << " while reupdating missed deltas";
       } else {
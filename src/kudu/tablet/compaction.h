@@ -18,6 +18,7 @@
 #define KUDU_TABLET_COMPACTION_H
 
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -35,6 +36,7 @@
 namespace kudu {
 
 class Arena;
+class EncodedKey;
 class Schema;
 
 namespace fs {
@@ -78,10 +80,37 @@ class HistoryGcOpts {
     return ancient_history_mark_;
   }
 
+  // Returns a copy of these options which also drop the rows expired by the
+  // TTL column of the schema, those whose value of the column is lower than
+  // 'cutoff_micros'. See ColumnStorageAttributes::ttl_seconds.
+  HistoryGcOpts WithRowExpiration(int64_t cutoff_micros) const {
+    return HistoryGcOpts(gc_enabled_, ancient_history_mark_, true, cutoff_micros);
+  }
+
+  // Returns true if the expired rows are dropped.
+  bool expiration_enabled() const {
+    return expiration_enabled_;
+  }
+
+  // Returns true if a row whose value of the TTL column is 'micros' is expired.
+  // Returns false for any value if expiration is disabled.
+  bool IsExpired(int64_t micros) const {
+    return expiration_enabled_ && micros < expiration_cutoff_micros_;
+  }
+
+  // Returns the value of the TTL column below which rows are expired.
+  // Ignored if expiration is disabled.
+  int64_t expiration_cutoff_micros() const {
+    return expiration_cutoff_micros_;
+  }
+
  private:
-  HistoryGcOpts(bool gc_enabled, Timestamp ahm)
+  HistoryGcOpts(bool gc_enabled, Timestamp ahm,
+                bool expiration_enabled = false, int64_t expiration_cutoff_micros = 0)
       : gc_enabled_(gc_enabled),
-        ancient_history_mark_(ahm) {
+        ancient_history_mark_(ahm),
+        expiration_enabled_(expiration_enabled),
+        expiration_cutoff_micros_(expiration_cutoff_micros) {
   }
 
   // Whether historical records prior to the ancient history mark should be
@@ -91,6 +120,11 @@ class HistoryGcOpts {
   // A timestamp prior to which no history will be preserved.
   // Ignored if 'enabled' != GC_ENABLED.
   const Timestamp ancient_history_mark_;
+
+  // Whether the rows expired by the TTL column should be dropped, and the
+  // value of the column below which they are.
+  const bool expiration_enabled_;
+  const int64_t expiration_cutoff_micros_;
 };
 
 // Interface for an input feeding into a compaction or flush.
@@ -122,6 +156,11 @@ class CompactionInput {
   static CompactionInput *Merge(const std::vector<std::shared_ptr<CompactionInput> > &inputs,
                                 const Schema *schema);
 
+  // Restrict the input to the rows whose keys are in ['lower_bound', 'upper_bound').
+  // Either bound may be null, leaving that side of the range unbounded. Must be
+  // called before Init(), and the keys must outlive the input.
+  virtual void SetKeyRange(const EncodedKey* lower_bound, const EncodedKey* upper_bound) = 0;
+
   virtual Status Init() = 0;
   virtual Status PrepareBlock(std::vector<CompactionInputRow> *block) = 0;
 
@@ -226,12 +265,31 @@ Status ApplyMutationsAndGenerateUndos(const MvccSnapshot& snap,
 // Iterate through this compaction input, flushing all rows to the given RollingDiskRowSetWriter.
 // The 'snap' argument should match the MvccSnapshot used to create the compaction input.
 //
+// If 'rows_gced' isn't null, it's incremented by the number of rows which
+// weren't flushed because their history is ancient.
+//
 // After return of this function, this CompactionInput object is "used up" and will
 // no longer be useful.
 Status FlushCompactionInput(CompactionInput *input,
                             const MvccSnapshot &snap,
                             const HistoryGcOpts& history_gc_opts,
-                            RollingDiskRowSetWriter *out);
+                            RollingDiskRowSetWriter *out,
+                            int64_t* rows_gced = nullptr);
+
+// Flush all the rows of the rowsets of 'input' to 'out', as FlushCompactionInput()
+// of their merge would, but copying the data blocks of the non-key columns of
+// the rowsets which don't overlap any other and have no mutations, rather
+// than decoding and re-encoding them row by row. 'schema' is the schema of the
+// output, and 'snap' the snapshot of the compaction.
+//
+// The rows are output in the same order as by the merge of the rowsets.
+Status FlushRowSetsInCompaction(const RowSetsInCompaction& input,
+                                const Schema* schema,
+                                const MvccSnapshot& snap,
+                                const HistoryGcOpts& history_gc_opts,
+                                const fs::IOContext* io_context,
+                                RollingDiskRowSetWriter* out,
+                                int64_t* rows_gced = nullptr);
 
 // Iterate through this compaction input, finding any mutations which came between
 // snap_to_exclude and snap_to_include (ie those transactions that were not yet
@@ -18,6 +18,7 @@
 #include "kudu/tablet/compaction_policy.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <limits>
 #include <memory>
 #include <ostream>
@@ -30,6 +31,9 @@
 #include <glog/stl_logging.h>
 #include <gtest/gtest.h>
 
+#include "kudu/common/common.pb.h"
+#include "kudu/common/key_encoder.h"
+#include "kudu/common/types.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/numbers.h"
 #include "kudu/gutil/strings/split.h"
@@ -46,12 +50,15 @@
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
+using std::shared_ptr;
 using std::string;
 using std::vector;
 
 DECLARE_double(compaction_minimum_improvement);
 DECLARE_double(compaction_small_rowset_tradeoff);
 DECLARE_int64(budgeted_compaction_target_rowset_size);
+DECLARE_int32(time_window_compaction_max_frozen_window_rowsets);
+DECLARE_int32(time_window_compaction_num_active_windows);
 
 namespace kudu {
 namespace tablet {
@@ -630,5 +637,71 @@ TEST_F(TestCompactionPolicy, TestKUDU2704) {
   ASSERT_EQ(2, picked.size());
   ASSERT_GT(quality, 0.0);
 }
+
+// Return a rowset of a tablet keyed on a single INT64 column.
+static shared_ptr<RowSet> MakeInt64RowSet(int64_t min_key, int64_t max_key) {
+  const KeyEncoder<faststring>& encoder = GetKeyEncoder<faststring>(GetTypeInfo(INT64));
+  faststring min_buf, max_buf;
+  encoder.Encode(&min_key, &min_buf);
+  encoder.Encode(&max_key, &max_buf);
+  return std::make_shared<MockDiskRowSet>(min_buf.ToString(), max_buf.ToString());
+}
+
+// Test that the time window policy only compacts rowsets of the same window,
+// out of the active windows or of frozen windows with too many rowsets.
+TEST_F(TestCompactionPolicy, TestTimeWindowSelection) {
+  FLAGS_time_window_compaction_num_active_windows = 2;
+  FLAGS_time_window_compaction_max_frozen_window_rowsets = 8;
+  constexpr auto kBudgetMb = 1000;
+  constexpr auto kWindowSize = 100;
+
+  // Four overlapping rowsets in the frozen window [0, 100), two in the active
+  // window [500, 600) and three in the newest window [600, 700).
+  const RowSetVector rowsets = {
+    MakeInt64RowSet(0, 50),
+    MakeInt64RowSet(10, 60),
+    MakeInt64RowSet(20, 90),
+    MakeInt64RowSet(30, 95),
+    MakeInt64RowSet(500, 550),
+    MakeInt64RowSet(520, 590),
+    MakeInt64RowSet(600, 610),
+    MakeInt64RowSet(605, 650),
+    MakeInt64RowSet(620, 699),
+  };
+  RowSetTree tree;
+  ASSERT_OK(tree.Reset(rowsets));
+  TimeWindowCompactionPolicy policy(kBudgetMb, INT64, /*window_col_is_last=*/true,
+                                    kWindowSize);
+
+  CompactionSelection picked;
+  double quality = 0.0;
+  ASSERT_OK(policy.PickRowSets(tree, &picked, &quality, /*log=*/nullptr));
+  ASSERT_EQ(CompactionSelection({ rowsets[6].get(), rowsets[7].get(), rowsets[8].get() }),
+            picked);
+  ASSERT_GT(quality, 0.0);
+
+  // The frozen window is compacted once late writes left it with too many
+  // rowsets.
+  FLAGS_time_window_compaction_max_frozen_window_rowsets = 3;
+  picked.clear();
+  ASSERT_OK(policy.PickRowSets(tree, &picked, &quality, /*log=*/nullptr));
+  ASSERT_EQ(CompactionSelection({ rowsets[0].get(), rowsets[1].get(),
+                                  rowsets[2].get(), rowsets[3].get() }),
+            picked);
+
+  // Windows with a single rowset aren't compacted.
+  const RowSetVector single_rowsets = {
+    MakeInt64RowSet(0, 50),
+    MakeInt64RowSet(100, 150),
+    MakeInt64RowSet(200, 250),
+  };
+  RowSetTree single_tree;
+  ASSERT_OK(single_tree.Reset(single_rowsets));
+  picked.clear();
+  ASSERT_OK(policy.PickRowSets(single_tree, &picked, &quality, /*log=*/nullptr));
+  ASSERT_TRUE(picked.empty());
+  ASSERT_EQ(0.0, quality);
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -18,7 +18,9 @@
 #include "kudu/tablet/compaction_policy.h"
 
 #include <algorithm>
+#include <cstring>
 #include <limits>
+#include <map>
 #include <ostream>
 #include <queue>
 #include <string>
@@ -29,14 +31,20 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "kudu/common/key_encoder.h"
+#include "kudu/common/types.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/rowset_info.h"
 #include "kudu/tablet/svg_dump.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/knapsack_solver.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
+using std::map;
+using std::string;
 using std::vector;
 using strings::Substitute;
 
@@ -59,6 +67,22 @@ DEFINE_double(compaction_minimum_improvement, 0.01f,
               "compaction will be considered ineligible.");
 TAG_FLAG(compaction_minimum_improvement, advanced);
 
+DEFINE_int32(time_window_compaction_num_active_windows, 2,
+             "The number of most recent time windows whose rowsets are compacted "
+             "when the time window compaction policy is used. The rowsets of "
+             "older windows are frozen.");
+TAG_FLAG(time_window_compaction_num_active_windows, advanced);
+TAG_FLAG(time_window_compaction_num_active_windows, experimental);
+TAG_FLAG(time_window_compaction_num_active_windows, runtime);
+
+DEFINE_int32(time_window_compaction_max_frozen_window_rowsets, 8,
+             "The number of rowsets that late writes to a frozen time window "
+             "may leave it with before it's compacted again, when the time "
+             "window compaction policy is used.");
+TAG_FLAG(time_window_compaction_max_frozen_window_rowsets, advanced);
+TAG_FLAG(time_window_compaction_max_frozen_window_rowsets, experimental);
+TAG_FLAG(time_window_compaction_max_frozen_window_rowsets, runtime);
+
 namespace kudu {
 namespace tablet {
 
@@ -513,5 +537,176 @@ Status BudgetedCompactionPolicy::PickRowSets(
   return Status::OK();
 }
 
+////////////////////////////////////////////////////////////
+// TimeWindowCompactionPolicy
+////////////////////////////////////////////////////////////
+
+TimeWindowCompactionPolicy::TimeWindowCompactionPolicy(int size_budget_mb,
+                                                       DataType window_col_type,
+                                                       bool window_col_is_last,
+                                                       int64_t window_size)
+  : size_budget_mb_(size_budget_mb),
+    window_col_type_(window_col_type),
+    window_col_is_last_(window_col_is_last),
+    window_size_(window_size) {
+  CHECK_GT(size_budget_mb, 0);
+  CHECK(IsValidWindowColumnType(window_col_type));
+  CHECK_GT(window_size, 0);
+}
+
+bool TimeWindowCompactionPolicy::IsValidWindowColumnType(DataType type) {
+  switch (type) {
+    case INT8:
+    case INT16:
+    case INT32:
+    case INT64:
+    case UNIXTIME_MICROS:
+      return true;
+    default:
+      return false;
+  }
+}
+
+uint64_t TimeWindowCompactionPolicy::target_rowset_size() const {
+  CHECK_GT(FLAGS_budgeted_compaction_target_rowset_size, 0);
+  return FLAGS_budgeted_compaction_target_rowset_size;
+}
+
+Status TimeWindowCompactionPolicy::DecodeWindow(const string& encoded_key,
+                                                int64_t* window) const {
+  const TypeInfo* type_info = GetTypeInfo(window_col_type_);
+  Slice key(encoded_key);
+  uint8_t cell[sizeof(int64_t)];
+  RETURN_NOT_OK(GetKeyEncoder<faststring>(type_info).Decode(
+      &key, window_col_is_last_, /*arena=*/nullptr, cell));
+  int64_t val;
+  switch (window_col_type_) {
+    case INT8: {
+      int8_t v;
+      memcpy(&v, cell, sizeof(v));
+      val = v;
+      break;
+    }
+    case INT16: {
+      int16_t v;
+      memcpy(&v, cell, sizeof(v));
+      val = v;
+      break;
+    }
+    case INT32: {
+      int32_t v;
+      memcpy(&v, cell, sizeof(v));
+      val = v;
+      break;
+    }
+    default:
+      memcpy(&val, cell, sizeof(val));
+      break;
+  }
+  // Round towards negative infinity, so that all windows have the same width.
+  *window = val / window_size_;
+  if (val % window_size_ < 0) {
+    (*window)--;
+  }
+  return Status::OK();
+}
+
+Status TimeWindowCompactionPolicy::PickRowSets(
+    const RowSetTree& tree,
+    CompactionSelection* picked,
+    double* quality,
+    std::vector<std::string>* log) {
+  DCHECK(picked);
+  DCHECK(quality);
+  *quality = 0.0;
+
+  vector<RowSetInfo> asc_min_key, asc_max_key;
+  RowSetInfo::ComputeCdfAndCollectOrdered(tree,
+                                          /*average_height=*/nullptr,
+                                          &asc_min_key,
+                                          &asc_max_key);
+
+  // Group the rowsets by the window of their minimum key, in ascending order
+  // of minimum key.
+  map<int64_t, vector<const RowSetInfo*>> rowsets_by_window;
+  for (const auto& cand : asc_min_key) {
+    if (!cand.has_bounds()) {
+      continue;
+    }
+    int64_t window;
+    RETURN_NOT_OK_PREPEND(DecodeWindow(cand.min_key(), &window),
+                          "unable to decode the time window of a rowset");
+    rowsets_by_window[window].push_back(&cand);
+  }
+  if (rowsets_by_window.empty()) {
+    if (log) {
+      LOG_STRING(INFO, log) << "No rowsets to compact";
+    }
+    return Status::OK();
+  }
+
+  // Pick the window with the most rowsets, preferring the most recent ones,
+  // among the active windows and the frozen ones with too many rowsets.
+  const int64_t newest_window = rowsets_by_window.rbegin()->first;
+  const vector<const RowSetInfo*>* best_rowsets = nullptr;
+  int64_t best_window = 0;
+  for (const auto& e : rowsets_by_window) {
+    const bool active =
+        e.first > newest_window - FLAGS_time_window_compaction_num_active_windows;
+    const size_t num_rowsets = e.second.size();
+    if (num_rowsets < 2 ||
+        (!active && num_rowsets <= FLAGS_time_window_compaction_max_frozen_window_rowsets)) {
+      continue;
+    }
+    if (best_rowsets == nullptr || num_rowsets >= best_rowsets->size()) {
+      best_rowsets = &e.second;
+      best_window = e.first;
+    }
+  }
+  if (best_rowsets == nullptr) {
+    if (log) {
+      LOG_STRING(INFO, log) << "No time window to compact";
+    }
+    return Status::OK();
+  }
+
+  // Pick the rowsets of the window in key order, within the budget. The
+  // quality is the decrease in the average height of the tablet.
+  CompactionSelection selection;
+  int budget_used_mb = 0;
+  double width_sum = 0.0;
+  double union_min = std::numeric_limits<double>::max();
+  double union_max = 0.0;
+  for (const RowSetInfo* cand : *best_rowsets) {
+    if (budget_used_mb + cand->base_and_redos_size_mb() > size_budget_mb_ &&
+        selection.size() >= 2) {
+      break;
+    }
+    budget_used_mb += cand->base_and_redos_size_mb();
+    selection.insert(cand->rowset());
+    width_sum += cand->width();
+    union_min = std::min(union_min, cand->cdf_min_key());
+    union_max = std::max(union_max, cand->cdf_max_key());
+  }
+  const double value = width_sum - (union_max - union_min);
+
+  if (VLOG_IS_ON(1) || log != nullptr) {
+    LOG_STRING(INFO, log) << Substitute("Time window compaction selection in window $0:",
+                                        best_window);
+    for (const RowSetInfo* cand : *best_rowsets) {
+      const char *checkbox = ContainsKey(selection, cand->rowset()) ? "[x]" : "[ ]";
+      LOG_STRING(INFO, log) << "  " << checkbox << " " << cand->ToString();
+    }
+    LOG_STRING(INFO, log) << "Solution value: " << value;
+  }
+
+  // Merging the rowsets of a window reduces their number even if they don't
+  // overlap, so the selection has at least the minimum quality.
+  *quality = std::max(value, FLAGS_compaction_minimum_improvement);
+  picked->swap(selection);
+  DumpCompactionSVGToFile(asc_min_key, *picked);
+  return Status::OK();
+}
+
 } // namespace tablet
 } // namespace kudu
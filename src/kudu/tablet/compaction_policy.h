@@ -23,6 +23,7 @@
 #include <unordered_set>
 #include <vector>
 
+#include "kudu/common/common.pb.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/util/status.h"
 
@@ -127,6 +128,46 @@ class BudgetedCompactionPolicy : public CompactionPolicy {
   const size_t size_budget_mb_;
 };
 
+// A compaction policy for time-series tables, whose first primary key column
+// is a timestamp and whose writes mostly append to the most recent time range.
+//
+// The rowsets are grouped by the time window their minimum key falls in, and
+// only rowsets of the same window are compacted together. Only the most
+// recent windows are compacted: older windows are frozen, unless late writes
+// left them with too many rowsets. Unlike the budgeted policy, this doesn't
+// keep on rewriting the recent data into the older data, which cuts the
+// write amplification of append-only workloads.
+class TimeWindowCompactionPolicy : public CompactionPolicy {
+ public:
+  // 'window_col_type' is the type of the first key column, which must be an
+  // integer type. 'window_col_is_last' is true if it's the only key column.
+  // 'window_size' is the width of a window, in the units of the column.
+  TimeWindowCompactionPolicy(int size_budget_mb,
+                             DataType window_col_type,
+                             bool window_col_is_last,
+                             int64_t window_size);
+
+  // Return true if a column of type 'type' may be used to group rowsets by
+  // time window.
+  static bool IsValidWindowColumnType(DataType type);
+
+  Status PickRowSets(const RowSetTree& tree,
+                     CompactionSelection* picked,
+                     double* quality,
+                     std::vector<std::string>* log) override;
+
+  uint64_t target_rowset_size() const override;
+
+ private:
+  // Decode the window of the encoded key 'encoded_key' into '*window'.
+  Status DecodeWindow(const std::string& encoded_key, int64_t* window) const;
+
+  const size_t size_budget_mb_;
+  const DataType window_col_type_;
+  const bool window_col_is_last_;
+  const int64_t window_size_;
+};
+
 } // namespace tablet
 } // namespace kudu
 #endif
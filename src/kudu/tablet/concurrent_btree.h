@@ -35,6 +35,10 @@
 // - The leaf nodes are linked together with a "next" pointer. This makes
 //   scanning simpler (the Masstree implementation avoids this because it
 //   complicates the removal operation)
+// - Inserts of keys which sort after all the keys in the tree, as when keys
+//   are inserted in increasing order, go straight to the rightmost leaf
+//   without traversing the tree. When the rightmost leaf is split by such an
+//   insert, it's left full rather than split in half.
 //
 // NOTE: this code disables TSAN for the most part. This is because it uses
 // some "clever" concurrency mechanisms which are difficult to model in TSAN.
@@ -44,6 +48,7 @@
 #define KUDU_TABLET_CONCURRENT_BTREE_H
 
 #include <algorithm>
+#include <atomic>
 #include <boost/smart_ptr/detail/yield_k.hpp>
 #include <boost/utility/binary.hpp>
 #include <memory>
@@ -695,6 +700,25 @@ class LeafNode : public NodeBase<Traits> {
     ret->idx_ = Find(ret->key(), &ret->exists_);
   }
 
+  // Prepare a mutation for a key which sorts after all the keys of this
+  // node, as checked by IsAppend().
+  void PrepareAppend(PreparedMutation<Traits> *ret) {
+    DCHECK(this->IsLocked());
+    ret->leaf_ = this;
+    ret->idx_ = num_entries_;
+    ret->exists_ = false;
+  }
+
+  // Return true if the given key sorts after all the keys of this node,
+  // which must not be empty.
+  //
+  // Note that, if the lock is not held, this may return bogus results, in
+  // which case it must be checked again under the lock.
+  bool IsAppend(const Slice &key) const {
+    size_t num_entries = num_entries_;
+    return num_entries > 0 && key.compare(GetKey(num_entries - 1)) > 0;
+  }
+
   // Insert a new entry into this leaf node.
   InsertStatus Insert(PreparedMutation<Traits> *mut, const Slice &val) {
     DCHECK_EQ(this, mut->leaf());
@@ -956,7 +980,10 @@ class CBTree {
   }
 
   explicit CBTree(std::shared_ptr<typename Traits::ArenaType> arena)
-      : arena_(std::move(arena)), root_(NewLeaf(false)), frozen_(false) {}
+      : arena_(std::move(arena)),
+        root_(NewLeaf(false)),
+        frozen_(false),
+        rightmost_leaf_(root_.leaf_node_ptr()) {}
 
   ~CBTree() {
     RecursiveDelete(root_);
@@ -1272,6 +1299,9 @@ class CBTree {
 
   void PrepareMutation(PreparedMutation<Traits> *mutation) {
     DCHECK_EQ(mutation->tree(), this);
+    if (PrepareAppend(mutation)) {
+      return;
+    }
     while (true) {
       AtomicVersion stable_version;
       LeafNode<Traits> *lnode = TraverseToLeaf(mutation->key(), &stable_version);
@@ -1288,6 +1318,32 @@ class CBTree {
     }
   }
 
+  // Fast path of PrepareMutation() for keys which sort after all the keys
+  // in the tree. Such keys belong to the rightmost leaf, so the mutation is
+  // prepared against it without traversing the tree.
+  //
+  // Returns false, with no node locked, if the key doesn't sort after the
+  // last key of the rightmost leaf.
+  bool PrepareAppend(PreparedMutation<Traits> *mutation) {
+    LeafNode<Traits> *lnode = rightmost_leaf_.load(std::memory_order_acquire);
+
+    // Check without the lock first, so that inserts in random order don't
+    // contend on the lock of the rightmost leaf.
+    if (!lnode->IsAppend(mutation->key())) {
+      return false;
+    }
+
+    lnode->Lock();
+    // Only the rightmost leaf has no next leaf. If the node was split in the
+    // meantime, the key may belong to its new sibling instead.
+    if (lnode->next_ != NULL || !lnode->IsAppend(mutation->key())) {
+      lnode->Unlock();
+      return false;
+    }
+    lnode->PrepareAppend(mutation);
+    return true;
+  }
+
   // Inserts the given key/value into the prepared leaf node.
   // If the leaf node is already full, handles splitting it and
   // propagating splits up the tree.
@@ -1412,10 +1468,16 @@ class CBTree {
   // Split the given leaf node 'node', creating a new node
   // with the higher half of the elements.
   //
+  // If 'append' is true, the node is the rightmost leaf and the split makes
+  // room for a key which sorts after all of its keys. Only its last element
+  // is moved to the new node then: if keys are inserted in increasing order,
+  // no other key will be inserted in 'node', which is best left full.
+  //
   // N.B: the new node is initially locked, but doesn't have the
   // SPLITTING flag. This function sets the SPLITTING flag before
   // modifying it.
   void SplitLeafNode(LeafNode<Traits> *node,
+                     bool append,
                      LeafNode<Traits> **new_node) {
     DCHECK(node->IsLocked());
 
@@ -1439,6 +1501,9 @@ class CBTree {
 
     // Copy half the keys from node into the new leaf
     int copy_start = node->num_entries() / 2;
+    if (append && node->num_entries() > 1) {
+      copy_start = node->num_entries() - 1;
+    }
     CHECK_GT(copy_start, 0) <<
       "Trying to split a node with 0 or 1 entries";
 
@@ -1448,6 +1513,12 @@ class CBTree {
               new_leaf->vals_);
     new_leaf->num_entries_ = node->num_entries() - copy_start;
 
+    // The new leaf is still locked: appends to it wait until it's been
+    // added to the tree.
+    if (new_leaf->next_ == NULL) {
+      rightmost_leaf_.store(new_leaf, std::memory_order_release);
+    }
+
     // Truncate the left node to remove the keys which have been
     // moved to the right node.
     node->SetSplitting();
@@ -1473,7 +1544,8 @@ class CBTree {
     //DebugPrint();
 
     LeafNode<Traits> *new_leaf;
-    SplitLeafNode(node, &new_leaf);
+    bool append = node->next_ == NULL && mutation->idx() == node->num_entries();
+    SplitLeafNode(node, append, &new_leaf);
 
     // The new leaf node is returned still locked.
     DCHECK(new_leaf->IsLocked());
@@ -1604,6 +1676,10 @@ class CBTree {
   // frozen, it may not be un-frozen. If an iterator is created on
   // a frozen tree, it will be more efficient.
   bool frozen_;
+
+  // The rightmost leaf node, which inserts of keys sorting after all the
+  // keys of the tree are prepared against. Updated when it's split.
+  std::atomic<LeafNode<Traits>*> rightmost_leaf_;
 };
 
 template<class Traits>
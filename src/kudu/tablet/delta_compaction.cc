@@ -17,6 +17,7 @@
 
 #include "kudu/tablet/delta_compaction.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <map>
 #include <ostream>
@@ -24,8 +25,14 @@
 #include <utility>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "kudu/cfile/block_pointer.h"
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/cfile_writer.h"
+#include "kudu/common/column_materialization_context.h"
+#include "kudu/common/columnblock.h"
 #include "kudu/common/generic_iterators.h"
 #include "kudu/common/iterator.h"
 #include "kudu/common/row.h"
@@ -35,6 +42,8 @@
 #include "kudu/common/scan_spec.h"
 #include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
+#include "kudu/fs/io_context.h"
+#include "kudu/fs/io_metrics.h"
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/join.h"
@@ -49,9 +58,18 @@
 #include "kudu/tablet/mutation.h"
 #include "kudu/tablet/mvcc.h"
 #include "kudu/tablet/rowset_metadata.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/trace.h"
 
+DEFINE_bool(major_delta_compaction_copy_unchanged_blocks, false,
+            "Whether major delta compactions only rewrite the data blocks of "
+            "the compacted columns which hold rows with deltas, copying the "
+            "others, rather than rewriting the whole columns.");
+TAG_FLAG(major_delta_compaction_copy_unchanged_blocks, experimental);
+TAG_FLAG(major_delta_compaction_copy_unchanged_blocks, runtime);
+
+using std::pair;
 using std::shared_ptr;
 
 namespace kudu {
@@ -60,6 +78,7 @@ using fs::BlockCreationTransaction;
 using fs::BlockManager;
 using fs::CreateBlockOptions;
 using fs::IOContext;
+using fs::StorageTier;
 using fs::WritableBlock;
 using std::string;
 using std::unique_ptr;
@@ -114,9 +133,108 @@ string MajorDeltaCompaction::ColumnNamesToString() const {
   return JoinStrings(col_names, ", ");
 }
 
-Status MajorDeltaCompaction::FlushRowSetAndDeltas(const IOContext* io_context) {
-  CHECK_EQ(state_, kInitialized);
+Status MajorDeltaCompaction::ApplyDeltasToBlock(rowid_t first_row,
+                                                RowBlock* block,
+                                                Arena* arena,
+                                                DeltaStats* undo_stats) {
+  size_t n = block->nrows();
+
+  // 2) Fetch all the REDO mutations.
+  vector<Mutation *> redo_mutation_block(kRowsPerBlock, static_cast<Mutation *>(nullptr));
+  RETURN_NOT_OK(delta_iter_->PrepareBatch(n, DeltaIterator::PREPARE_FOR_COLLECT));
+  RETURN_NOT_OK(delta_iter_->CollectMutations(&redo_mutation_block, block->arena()));
+
+  // 3) Write new UNDO mutations for the current block. The REDO mutations
+  //    are written out in step 6.
+  // We know that we're reading everything from disk so we're including all transactions.
+  MvccSnapshot snap = MvccSnapshot::CreateSnapshotIncludingAllTransactions();
+  vector<CompactionInputRow> input_rows;
+  input_rows.resize(block->nrows());
+  for (int i = 0; i < block->nrows(); i++) {
+    CompactionInputRow* input_row = &input_rows[i];
+    input_row->row.Reset(block, i);
+    input_row->redo_head = redo_mutation_block[i];
+    Mutation::ReverseMutationList(&input_row->redo_head);
+    input_row->undo_head = nullptr;
+
+    RowBlockRow dst_row = block->row(i);
+    RETURN_NOT_OK(CopyRow(input_row->row, &dst_row, static_cast<Arena*>(nullptr)));
+
+    Mutation* new_undos_head = nullptr;
+    // We're ignoring the result from new_redos_head because we'll find them
+    // later at step 5.
+    Mutation* new_redos_head = nullptr;
+
+    // Since this is a delta compaction the input and output row id's are the same.
+    rowid_t row_id = first_row + input_row->row.row_index();
+
+    DVLOG(3) << "MDC Input Row - RowId: " << row_id << " "
+             << CompactionInputRowToString(*input_row);
+
+    // NOTE: This is presently ignored.
+    bool is_garbage_collected;
+
+    RETURN_NOT_OK(ApplyMutationsAndGenerateUndos(snap,
+                                                 *input_row,
+                                                 &new_undos_head,
+                                                 &new_redos_head,
+                                                 arena,
+                                                 &dst_row));
+
+    RemoveAncientUndos(history_gc_opts_,
+                       &new_undos_head,
+                       new_redos_head,
+                       &is_garbage_collected);
+
+    DVLOG(3) << "MDC Output Row - RowId: " << row_id << " "
+             << RowToString(dst_row, new_undos_head, new_redos_head);
+
+    // We only create a new undo delta file if we need to.
+    if (new_undos_head != nullptr && !new_undo_delta_writer_) {
+      RETURN_NOT_OK(OpenUndoDeltaFileWriter());
+    }
+    for (const Mutation *mut = new_undos_head; mut != nullptr; mut = mut->next()) {
+      DeltaKey undo_key(first_row + dst_row.row_index(), mut->timestamp());
+      RETURN_NOT_OK(new_undo_delta_writer_->AppendDelta<UNDO>(undo_key, mut->changelist()));
+      undo_stats->UpdateStats(mut->timestamp(), mut->changelist());
+      undo_delta_mutations_written_++;
+    }
+  }
+
+  return Status::OK();
+}
 
+Status MajorDeltaCompaction::WriteRemainingRedoDeltas(Arena* arena, DeltaStats* redo_stats) {
+  // 5) Remove the columns that we've done our major REDO delta compaction on
+  //    from this delta flush, except keep all the delete and reinsert
+  //    mutations.
+  arena->Reset();
+  vector<DeltaKeyAndUpdate> out;
+  RETURN_NOT_OK(delta_iter_->FilterColumnIdsAndCollectDeltas(column_ids_, &out, arena));
+
+  // We only create a new redo delta file if we need to.
+  if (!out.empty() && !new_redo_delta_writer_) {
+    RETURN_NOT_OK(OpenRedoDeltaFileWriter());
+  }
+
+  // 6) Write the remaining REDO deltas that we haven't compacted away back
+  //    into a REDO delta file.
+  for (const DeltaKeyAndUpdate& key_and_update : out) {
+    RowChangeList update(key_and_update.cell);
+    DVLOG(4) << "Keeping delta as REDO: "
+             << key_and_update.Stringify(DeltaType::REDO, base_schema_);
+    RETURN_NOT_OK_PREPEND(new_redo_delta_writer_->AppendDelta<REDO>(key_and_update.key, update),
+                          "Failed to append a delta");
+    WARN_NOT_OK(redo_stats->UpdateStats(key_and_update.key.timestamp(), update),
+                "Failed to update stats");
+  }
+  redo_delta_mutations_written_ += out.size();
+  return Status::OK();
+}
+
+Status MajorDeltaCompaction::RewriteAllRows(const IOContext* io_context,
+                                            DeltaStats* redo_stats,
+                                            DeltaStats* undo_stats) {
   unique_ptr<ColumnwiseIterator> old_base_data_cwise(base_data_->NewIterator(&partial_schema_,
                                                                              io_context));
   unique_ptr<RowwiseIterator> old_base_data_rwise(
@@ -128,18 +246,13 @@ Status MajorDeltaCompaction::FlushRowSetAndDeltas(const IOContext* io_context) {
       old_base_data_rwise->Init(&spec),
       "Unable to open iterator for specified columns (" + partial_schema_.ToString() + ")");
 
-  RETURN_NOT_OK(delta_iter_->Init(&spec));
   RETURN_NOT_OK(delta_iter_->SeekToOrdinal(0));
 
   Arena arena(32 * 1024);
   RowBlock block(partial_schema_, kRowsPerBlock, &arena);
 
   DVLOG(1) << "Applying deltas and rewriting columns (" << partial_schema_.ToString() << ")";
-  DeltaStats redo_stats;
-  DeltaStats undo_stats;
   size_t nrows = 0;
-  // We know that we're reading everything from disk so we're including all transactions.
-  MvccSnapshot snap = MvccSnapshot::CreateSnapshotIncludingAllTransactions();
   while (old_base_data_rwise->HasNext()) {
 
     // 1) Get the next batch of base data for the columns we're compacting.
@@ -147,94 +260,279 @@ Status MajorDeltaCompaction::FlushRowSetAndDeltas(const IOContext* io_context) {
     RETURN_NOT_OK(old_base_data_rwise->NextBlock(&block));
     size_t n = block.nrows();
 
-    // 2) Fetch all the REDO mutations.
-    vector<Mutation *> redo_mutation_block(kRowsPerBlock, static_cast<Mutation *>(nullptr));
-    RETURN_NOT_OK(delta_iter_->PrepareBatch(n, DeltaIterator::PREPARE_FOR_COLLECT));
-    RETURN_NOT_OK(delta_iter_->CollectMutations(&redo_mutation_block, block.arena()));
-
-    // 3) Write new UNDO mutations for the current block. The REDO mutations
-    //    are written out in step 6.
-    vector<CompactionInputRow> input_rows;
-    input_rows.resize(block.nrows());
-    for (int i = 0; i < block.nrows(); i++) {
-      CompactionInputRow* input_row = &input_rows[i];
-      input_row->row.Reset(&block, i);
-      input_row->redo_head = redo_mutation_block[i];
-      Mutation::ReverseMutationList(&input_row->redo_head);
-      input_row->undo_head = nullptr;
-
-      RowBlockRow dst_row = block.row(i);
-      RETURN_NOT_OK(CopyRow(input_row->row, &dst_row, static_cast<Arena*>(nullptr)));
-
-      Mutation* new_undos_head = nullptr;
-      // We're ignoring the result from new_redos_head because we'll find them
-      // later at step 5.
-      Mutation* new_redos_head = nullptr;
-
-      // Since this is a delta compaction the input and output row id's are the same.
-      rowid_t row_id = nrows + input_row->row.row_index();
-
-      DVLOG(3) << "MDC Input Row - RowId: " << row_id << " "
-               << CompactionInputRowToString(*input_row);
-
-      // NOTE: This is presently ignored.
-      bool is_garbage_collected;
-
-      RETURN_NOT_OK(ApplyMutationsAndGenerateUndos(snap,
-                                                   *input_row,
-                                                   &new_undos_head,
-                                                   &new_redos_head,
-                                                   &arena,
-                                                   &dst_row));
-
-      RemoveAncientUndos(history_gc_opts_,
-                         &new_undos_head,
-                         new_redos_head,
-                         &is_garbage_collected);
-
-      DVLOG(3) << "MDC Output Row - RowId: " << row_id << " "
-               << RowToString(dst_row, new_undos_head, new_redos_head);
-
-      // We only create a new undo delta file if we need to.
-      if (new_undos_head != nullptr && !new_undo_delta_writer_) {
-        RETURN_NOT_OK(OpenUndoDeltaFileWriter());
+    // 2-3) Apply the deltas, and write the UNDO deltas.
+    RETURN_NOT_OK(ApplyDeltasToBlock(nrows, &block, &arena, undo_stats));
+
+    // 4) Write the new base data.
+    RETURN_NOT_OK(base_data_writer_->AppendBlock(block));
+
+    // 5-6) Write the REDO deltas which aren't compacted.
+    RETURN_NOT_OK(WriteRemainingRedoDeltas(&arena, redo_stats));
+    nrows += n;
+  }
+  return Status::OK();
+}
+
+namespace {
+
+// The data blocks of a compacted column of the base data.
+struct ColumnDataBlocks {
+  cfile::CFileReader* reader = nullptr;
+  unique_ptr<cfile::CFileIterator> iter;
+
+  // Whether the data blocks may be copied.
+  bool copyable = false;
+
+  // The ordinal of the first row of each data block, and the number of rows.
+  vector<rowid_t> ordinals;
+
+  // Whether each data block holds rows with deltas.
+  vector<bool> dirty;
+
+  // The number of rows written to the output so far.
+  rowid_t num_written = 0;
+
+  // Return the index of the block holding row 'ordinal'.
+  int BlockOf(rowid_t ordinal) const {
+    return std::upper_bound(ordinals.begin(), ordinals.end(), ordinal) - ordinals.begin() - 1;
+  }
+};
+
+// Return true if any row of 'rows', sorted, is in [first, last).
+bool AnyRowInRange(const vector<rowid_t>& rows, rowid_t first, rowid_t last) {
+  auto it = std::lower_bound(rows.begin(), rows.end(), first);
+  return it != rows.end() && *it < last;
+}
+
+Status AppendColumnBlock(const ColumnBlock& column, cfile::CFileWriter* writer) {
+  if (column.is_nullable()) {
+    return writer->AppendNullableEntries(column.null_bitmap(), column.data(), column.nrows());
+  }
+  return writer->AppendEntries(column.data(), column.nrows());
+}
+
+// Copies the clean data blocks of 'col' from the last row written up to the
+// first dirty block or the block holding row 'last_row', whichever is first.
+Status CopyCleanBlocks(ColumnDataBlocks* col, rowid_t last_row,
+                       cfile::CFileWriter* writer, const IOContext* io_context) {
+  const rowid_t first = col->num_written;
+  int b = col->BlockOf(first);
+  DCHECK_EQ(col->ordinals[b], first);
+  while (col->num_written < last_row && !col->dirty[b]) {
+    col->num_written = col->ordinals[++b];
+  }
+  return writer->AppendDataBlocks(col->reader, first, col->num_written, io_context);
+}
+
+} // anonymous namespace
+
+Status MajorDeltaCompaction::RewriteChangedBlocks(const IOContext* io_context,
+                                                  DeltaStats* redo_stats,
+                                                  DeltaStats* undo_stats,
+                                                  bool* rewritten) {
+  *rewritten = false;
+  const int num_cols = partial_schema_.num_columns();
+  if (num_cols == 0) {
+    return Status::OK();
+  }
+  rowid_t num_rows;
+  RETURN_NOT_OK(base_data_->CountRows(io_context, &num_rows));
+
+  // Find the data blocks of each column.
+  vector<ColumnDataBlocks> cols(num_cols);
+  for (int i = 0; i < num_cols; i++) {
+    ColumnDataBlocks* col = &cols[i];
+    RETURN_NOT_OK(base_data_->GetColumnReader(partial_schema_.column_id(i), io_context,
+                                              &col->reader));
+    // Columns added since the base data was written have no blocks.
+    if (col->reader == nullptr) {
+      return Status::OK();
+    }
+    // The columns whose blocks can't be copied are rewritten as a whole, as
+    // if they had a single block.
+    col->copyable = base_data_writer_->CanAppendDataBlocks(i, *col->reader);
+    if (col->copyable) {
+      vector<pair<rowid_t, cfile::BlockPointer>> blocks;
+      RETURN_NOT_OK(col->reader->ReadDataBlockPointers(io_context, &blocks));
+      for (const auto& b : blocks) {
+        col->ordinals.push_back(b.first);
       }
-      for (const Mutation *mut = new_undos_head; mut != nullptr; mut = mut->next()) {
-        DeltaKey undo_key(nrows + dst_row.row_index(), mut->timestamp());
-        RETURN_NOT_OK(new_undo_delta_writer_->AppendDelta<UNDO>(undo_key, mut->changelist()));
-        undo_stats.UpdateStats(mut->timestamp(), mut->changelist());
-        undo_delta_mutations_written_++;
+    } else {
+      col->ordinals.push_back(0);
+    }
+    col->ordinals.push_back(num_rows);
+  }
+
+  // Find the rows with deltas. All the deltas are relevant to the snapshot
+  // of the compaction.
+  vector<rowid_t> rows_with_deltas;
+  {
+    RETURN_NOT_OK(delta_iter_->SeekToOrdinal(0));
+    Arena arena(32 * 1024);
+    vector<Mutation*> mutations;
+    for (rowid_t first = 0; first < num_rows; first += kRowsPerBlock) {
+      const size_t n = std::min<rowid_t>(kRowsPerBlock, num_rows - first);
+      arena.Reset();
+      mutations.assign(n, nullptr);
+      RETURN_NOT_OK(delta_iter_->PrepareBatch(n, DeltaIterator::PREPARE_FOR_COLLECT));
+      RETURN_NOT_OK(delta_iter_->CollectMutations(&mutations, &arena));
+      for (size_t i = 0; i < n; i++) {
+        if (mutations[i] != nullptr) {
+          rows_with_deltas.push_back(first + i);
+        }
       }
     }
+  }
 
-    // 4) Write the new base data.
-    RETURN_NOT_OK(base_data_writer_->AppendBlock(block));
+  // Rewrite all the blocks if none can be copied.
+  bool any_clean = false;
+  for (auto& col : cols) {
+    const int num_blocks = col.ordinals.size() - 1;
+    col.dirty.resize(num_blocks);
+    for (int b = 0; b < num_blocks; b++) {
+      col.dirty[b] = !col.copyable ||
+          AnyRowInRange(rows_with_deltas, col.ordinals[b], col.ordinals[b + 1]);
+      any_clean |= !col.dirty[b];
+    }
+  }
+  if (!any_clean) {
+    return Status::OK();
+  }
 
-    // 5) Remove the columns that we've done our major REDO delta compaction on
-    //    from this delta flush, except keep all the delete and reinsert
-    //    mutations.
-    arena.Reset();
-    vector<DeltaKeyAndUpdate> out;
-    RETURN_NOT_OK(delta_iter_->FilterColumnIdsAndCollectDeltas(column_ids_, &out, &arena));
+  // The rows are processed in segments between the block boundaries of all
+  // the columns, so that each segment is within a single block of each column.
+  vector<rowid_t> boundaries;
+  for (const auto& col : cols) {
+    boundaries.insert(boundaries.end(), col.ordinals.begin(), col.ordinals.end());
+  }
+  std::sort(boundaries.begin(), boundaries.end());
+  boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
 
-    // We only create a new redo delta file if we need to.
-    if (!out.empty() && !new_redo_delta_writer_) {
-      RETURN_NOT_OK(OpenRedoDeltaFileWriter());
+  Arena arena(32 * 1024);
+  RowBlock block(partial_schema_, kRowsPerBlock, &arena);
+  rowid_t delta_iter_pos = num_rows;
+  size_t blocks_copied = 0;
+  size_t blocks_rewritten = 0;
+  DVLOG(1) << "Applying deltas and rewriting the changed blocks of columns ("
+           << partial_schema_.ToString() << ")";
+  for (int k = 0; k + 1 < boundaries.size(); k++) {
+    const rowid_t seg_first = boundaries[k];
+    const rowid_t seg_last = boundaries[k + 1];
+    vector<int> dirty_cols;
+    for (int i = 0; i < num_cols; i++) {
+      if (cols[i].dirty[cols[i].BlockOf(seg_first)]) {
+        dirty_cols.push_back(i);
+      }
+    }
+    if (dirty_cols.empty()) {
+      continue;
+    }
+    // The rows with deltas have a dirty block in every column.
+    const bool has_deltas = AnyRowInRange(rows_with_deltas, seg_first, seg_last);
+    DCHECK(!has_deltas || dirty_cols.size() == num_cols);
+    for (int i : dirty_cols) {
+      ColumnDataBlocks* col = &cols[i];
+      if (col->num_written < seg_first) {
+        size_t before = col->num_written;
+        RETURN_NOT_OK(CopyCleanBlocks(col, seg_first, base_data_writer_->writer_for_col_idx(i),
+                                      io_context));
+        blocks_copied += col->BlockOf(col->num_written) - col->BlockOf(before);
+      }
+      DCHECK_EQ(seg_first, col->num_written);
+      if (col->ordinals[col->BlockOf(seg_first)] == seg_first) {
+        blocks_rewritten++;
+      }
+      // The iterator is only seeked past the copied blocks.
+      if (!col->iter) {
+        RETURN_NOT_OK(col->reader->NewIterator(&col->iter, cfile::CFileReader::DONT_CACHE_BLOCK,
+                                               io_context));
+        RETURN_NOT_OK(col->iter->SeekToOrdinal(seg_first));
+      } else if (col->iter->GetCurrentOrdinal() != seg_first) {
+        RETURN_NOT_OK(col->iter->SeekToOrdinal(seg_first));
+      }
+    }
+    if (has_deltas && delta_iter_pos != seg_first) {
+      RETURN_NOT_OK(delta_iter_->SeekToOrdinal(seg_first));
     }
 
-    // 6) Write the remaining REDO deltas that we haven't compacted away back
-    //    into a REDO delta file.
-    for (const DeltaKeyAndUpdate& key_and_update : out) {
-      RowChangeList update(key_and_update.cell);
-      DVLOG(4) << "Keeping delta as REDO: "
-               << key_and_update.Stringify(DeltaType::REDO, base_schema_);
-      RETURN_NOT_OK_PREPEND(new_redo_delta_writer_->AppendDelta<REDO>(key_and_update.key, update),
-                            "Failed to append a delta");
-      WARN_NOT_OK(redo_stats.UpdateStats(key_and_update.key.timestamp(), update),
-                  "Failed to update stats");
+    for (rowid_t first = seg_first; first < seg_last; first += kRowsPerBlock) {
+      size_t n = std::min<rowid_t>(kRowsPerBlock, seg_last - first);
+      arena.Reset();
+      block.Resize(n);
+      block.selection_vector()->SetAllTrue();
+      for (int i : dirty_cols) {
+        cfile::CFileIterator* iter = cols[i].iter.get();
+        size_t prepared = n;
+        RETURN_NOT_OK(iter->PrepareBatch(&prepared));
+        if (PREDICT_FALSE(prepared != n)) {
+          return Status::Corruption(Substitute("$0: expected $1 rows at row $2, got $3",
+                                               cols[i].reader->ToString(), n, first, prepared));
+        }
+        ColumnBlock col_block(block.column_block(i));
+        ColumnMaterializationContext ctx(i, nullptr, &col_block, block.selection_vector());
+        RETURN_NOT_OK(iter->Scan(&ctx));
+        RETURN_NOT_OK(iter->FinishBatch());
+      }
+      if (has_deltas) {
+        RETURN_NOT_OK(ApplyDeltasToBlock(first, &block, &arena, undo_stats));
+      }
+      for (int i : dirty_cols) {
+        RETURN_NOT_OK(AppendColumnBlock(block.column_block(i),
+                                        base_data_writer_->writer_for_col_idx(i)));
+        cols[i].num_written += n;
+      }
+      if (has_deltas) {
+        RETURN_NOT_OK(WriteRemainingRedoDeltas(&arena, redo_stats));
+      }
     }
-    redo_delta_mutations_written_ += out.size();
-    nrows += n;
+    if (has_deltas) {
+      delta_iter_pos = seg_last;
+    }
+  }
+  for (int i = 0; i < num_cols; i++) {
+    ColumnDataBlocks* col = &cols[i];
+    if (col->num_written < num_rows) {
+      size_t before = col->num_written;
+      RETURN_NOT_OK(CopyCleanBlocks(col, num_rows, base_data_writer_->writer_for_col_idx(i),
+                                    io_context));
+      blocks_copied += col->BlockOf(col->num_written) - col->BlockOf(before);
+    }
+    DCHECK_EQ(num_rows, col->num_written);
+  }
+  VLOG(1) << Substitute("Rewrote $0 and copied $1 data blocks of columns ($2)",
+                        blocks_rewritten, blocks_copied, partial_schema_.ToString());
+  TRACE_COUNTER_INCREMENT("delta_compaction_blocks_copied", blocks_copied);
+  TRACE_COUNTER_INCREMENT("delta_compaction_blocks_rewritten", blocks_rewritten);
+  *rewritten = true;
+  return Status::OK();
+}
+
+Status MajorDeltaCompaction::FlushRowSetAndDeltas(const IOContext* io_context) {
+  CHECK_EQ(state_, kInitialized);
+
+  ScanSpec spec;
+  spec.set_cache_blocks(false);
+  RETURN_NOT_OK(delta_iter_->Init(&spec));
+
+  DeltaStats redo_stats;
+  DeltaStats undo_stats;
+  bool rewritten = false;
+  if (FLAGS_major_delta_compaction_copy_unchanged_blocks) {
+    RETURN_NOT_OK(RewriteChangedBlocks(io_context, &redo_stats, &undo_stats, &rewritten));
+  }
+  if (!rewritten) {
+    RETURN_NOT_OK(RewriteAllRows(io_context, &redo_stats, &undo_stats));
+  }
+
+  if (io_context && io_context->metrics) {
+    size_t bytes_written = base_data_writer_->written_size();
+    if (redo_delta_mutations_written_ > 0) {
+      bytes_written += new_redo_delta_writer_->written_size();
+    }
+    if (undo_delta_mutations_written_ > 0) {
+      bytes_written += new_undo_delta_writer_->written_size();
+    }
+    io_context->metrics->RecordWrite(io_context->source, bytes_written);
   }
 
   BlockManager* bm = fs_manager_->block_manager();
@@ -249,6 +547,7 @@ Status MajorDeltaCompaction::FlushRowSetAndDeltas(const IOContext* io_context) {
   if (undo_delta_mutations_written_ > 0) {
     new_undo_delta_writer_->WriteDeltaStats(undo_stats);
     RETURN_NOT_OK(new_undo_delta_writer_->FinishAndReleaseBlock(transaction.get()));
+    new_undo_max_timestamp_ = undo_stats.max_timestamp();
   }
   transaction->CommitCreatedBlocks();
 
@@ -277,7 +576,7 @@ Status MajorDeltaCompaction::OpenBaseDataWriter() {
 
 Status MajorDeltaCompaction::OpenRedoDeltaFileWriter() {
   unique_ptr<WritableBlock> block;
-  CreateBlockOptions opts({ tablet_id_ });
+  CreateBlockOptions opts({ tablet_id_, StorageTier::FAST });
   RETURN_NOT_OK_PREPEND(fs_manager_->CreateNewBlock(opts, &block),
                         "Unable to create REDO delta output block");
   new_redo_delta_block_ = block->id();
@@ -287,7 +586,8 @@ Status MajorDeltaCompaction::OpenRedoDeltaFileWriter() {
 
 Status MajorDeltaCompaction::OpenUndoDeltaFileWriter() {
   unique_ptr<WritableBlock> block;
-  CreateBlockOptions opts({ tablet_id_ });
+  // UNDO deltas are only read by scans in the past.
+  CreateBlockOptions opts({ tablet_id_, StorageTier::SLOW });
   RETURN_NOT_OK_PREPEND(fs_manager_->CreateNewBlock(opts, &block),
                         "Unable to create UNDO delta output block");
   new_undo_delta_block_ = block->id();
@@ -374,7 +674,7 @@ void MajorDeltaCompaction::CreateMetadataUpdate(
                                  new_delta_blocks);
 
   if (undo_delta_mutations_written_ > 0) {
-    update->SetNewUndoBlock(new_undo_delta_block_);
+    update->SetNewUndoBlock(new_undo_delta_block_, new_undo_max_timestamp_);
   }
 
   // Replace old column blocks with new ones
@@ -22,7 +22,9 @@
 #include <string>
 #include <vector>
 
+#include "kudu/common/rowid.h"
 #include "kudu/common/schema.h"
+#include "kudu/common/timestamp.h"
 #include "kudu/fs/block_id.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/tablet/compaction.h"
@@ -31,7 +33,9 @@
 
 namespace kudu {
 
+class Arena;
 class FsManager;
+class RowBlock;
 
 namespace fs {
 struct IOContext;
@@ -41,6 +45,7 @@ namespace tablet {
 
 class CFileSet;
 class DeltaFileWriter;
+class DeltaStats;
 class DeltaTracker;
 class MultiColumnWriter;
 class RowSetMetadataUpdate;
@@ -99,6 +104,32 @@ class MajorDeltaCompaction {
   // deltas need to be written back into a delta file.
   Status FlushRowSetAndDeltas(const fs::IOContext* io_context);
 
+  // Rewrites all the rows of the compacted columns.
+  Status RewriteAllRows(const fs::IOContext* io_context,
+                        DeltaStats* redo_stats,
+                        DeltaStats* undo_stats);
+
+  // Rewrites the data blocks of the compacted columns which hold rows with
+  // deltas, and copies the others. The columns whose blocks can't be copied
+  // are rewritten as a whole. Sets '*rewritten' to false without writing
+  // anything if some column has no base data, or if no block can be copied.
+  Status RewriteChangedBlocks(const fs::IOContext* io_context,
+                              DeltaStats* redo_stats,
+                              DeltaStats* undo_stats,
+                              bool* rewritten);
+
+  // Applies the deltas of the rows of 'block', the first of which is row
+  // 'first_row', and writes their UNDO deltas. The delta iterator must be
+  // positioned at 'first_row'.
+  Status ApplyDeltasToBlock(rowid_t first_row,
+                            RowBlock* block,
+                            Arena* arena,
+                            DeltaStats* undo_stats);
+
+  // Writes back the REDO deltas of the batch prepared by ApplyDeltasToBlock()
+  // which aren't compacted. Resets 'arena'.
+  Status WriteRemainingRedoDeltas(Arena* arena, DeltaStats* redo_stats);
+
   FsManager* const fs_manager_;
 
   // TODO: doc me
@@ -136,6 +167,7 @@ class MajorDeltaCompaction {
 
   gscoped_ptr<DeltaFileWriter> new_undo_delta_writer_;
   BlockId new_undo_delta_block_;
+  Timestamp new_undo_max_timestamp_;
 
   size_t redo_delta_mutations_written_;
   size_t undo_delta_mutations_written_;
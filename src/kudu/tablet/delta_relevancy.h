@@ -111,6 +111,28 @@ inline bool IsDeltaRelevantForApply<UNDO>(const MvccSnapshot& snap,
   return false;
 }
 
+// Returns whether all deltas within the time range 'delta_ts_start' to
+// 'delta_ts_end' are relevant under the apply criteria to 'snap', in which
+// case the relevancy of each of them needn't be checked.
+template<DeltaType Type>
+inline bool AreAllDeltasRelevantForApply(const MvccSnapshot& snap,
+                                         const Timestamp& delta_ts_start,
+                                         const Timestamp& delta_ts_end);
+
+template<>
+inline bool AreAllDeltasRelevantForApply<REDO>(const MvccSnapshot& snap,
+                                               const Timestamp& /* delta_ts_start */,
+                                               const Timestamp& delta_ts_end) {
+  return !snap.MayHaveUncommittedTransactionsAtOrBefore(delta_ts_end);
+}
+
+template<>
+inline bool AreAllDeltasRelevantForApply<UNDO>(const MvccSnapshot& snap,
+                                               const Timestamp& delta_ts_start,
+                                               const Timestamp& /* delta_ts_end */) {
+  return !snap.MayHaveCommittedTransactionsAtOrAfter(delta_ts_start);
+}
+
 // Returns whether deltas within the time range 'delta_ts_start' to
 // 'delta_ts_end' are relevant under the select criteria to 'snap_start' and 'snap_end'.
 inline bool IsDeltaRelevantForSelect(const MvccSnapshot& snap_start,
@@ -70,6 +70,7 @@ DeltaPreparer<Traits>::DeltaPreparer(RowIteratorOptions opts)
       cur_prepared_idx_(0),
       prev_prepared_idx_(0),
       prepared_flags_(DeltaIterator::PREPARE_NONE),
+      all_relevant_for_apply_(false),
       deletion_state_(UNKNOWN) {
 }
 
@@ -159,8 +160,9 @@ Status DeltaPreparer<Traits>::AddDelta(const DeltaKey& key, Slice val, bool* fin
   bool finished_row_for_apply_or_collect = false;
   if (prepared_flags_ & (DeltaIterator::PREPARE_FOR_APPLY |
                          DeltaIterator::PREPARE_FOR_COLLECT)) {
-    relevant_for_apply_or_collect = IsDeltaRelevantForApply<Traits::kType>(
-        opts_.snap_to_include, key.timestamp(), &finished_row_for_apply_or_collect);
+    relevant_for_apply_or_collect = all_relevant_for_apply_ ||
+        IsDeltaRelevantForApply<Traits::kType>(
+            opts_.snap_to_include, key.timestamp(), &finished_row_for_apply_or_collect);
   }
 
   if (prepared_flags_ & DeltaIterator::PREPARE_FOR_APPLY &&
@@ -187,25 +189,7 @@ Status DeltaPreparer<Traits>::AddDelta(const DeltaKey& key, Slice val, bool* fin
           // This column isn't being projected.
           continue;
         }
-        int col_size = opts_.projection->column(col_idx).type_info()->size();
-
-        // If we already have an earlier update for the same column, we can
-        // just overwrite that one.
-        if (updates_by_col_[col_idx].empty() ||
-            updates_by_col_[col_idx].back().row_id != key.row_idx()) {
-          updates_by_col_[col_idx].emplace_back();
-        }
-
-        ColumnUpdate& cu = updates_by_col_[col_idx].back();
-        cu.row_id = key.row_idx();
-        if (col_val == nullptr) {
-          cu.new_val_ptr = nullptr;
-        } else {
-          memcpy(cu.new_val_buf, col_val, col_size);
-          // NOTE: we're constructing a pointer here to an element inside the deque.
-          // This is safe because deques never invalidate pointers to their elements.
-          cu.new_val_ptr = cu.new_val_buf;
-        }
+        AddColumnUpdateToApply(key.row_idx(), col_idx, col_val);
       }
     }
   }
@@ -228,6 +212,58 @@ Status DeltaPreparer<Traits>::AddDelta(const DeltaKey& key, Slice val, bool* fin
   return Status::OK();
 }
 
+template<class Traits>
+Status DeltaPreparer<Traits>::AddColumnUpdate(const DeltaKey& key, ColumnId col_id, bool is_null,
+                                              Slice raw_value, bool* finished_row) {
+  DCHECK_EQ(DeltaIterator::PREPARE_FOR_APPLY, prepared_flags_);
+  MaybeProcessPreviousRowChange(key.row_idx());
+
+  bool finished_row_for_apply = false;
+  if (all_relevant_for_apply_ ||
+      IsDeltaRelevantForApply<Traits::kType>(
+          opts_.snap_to_include, key.timestamp(), &finished_row_for_apply)) {
+    RowChangeListDecoder::DecodedUpdate dec;
+    dec.col_id = col_id;
+    dec.null = is_null;
+    dec.raw_value = raw_value;
+    int col_idx;
+    const void* col_val;
+    RETURN_NOT_OK(dec.Validate(*opts_.projection, &col_idx, &col_val));
+    if (col_idx != -1) {
+      AddColumnUpdateToApply(key.row_idx(), col_idx, col_val);
+    }
+  }
+  if (finished_row_for_apply) {
+    *finished_row = true;
+  }
+  last_added_idx_ = key.row_idx();
+  return Status::OK();
+}
+
+template<class Traits>
+void DeltaPreparer<Traits>::AddColumnUpdateToApply(rowid_t row_id, int col_idx,
+                                                   const void* col_val) {
+  int col_size = opts_.projection->column(col_idx).type_info()->size();
+
+  // If we already have an earlier update for the same column, we can
+  // just overwrite that one.
+  if (updates_by_col_[col_idx].empty() ||
+      updates_by_col_[col_idx].back().row_id != row_id) {
+    updates_by_col_[col_idx].emplace_back();
+  }
+
+  ColumnUpdate& cu = updates_by_col_[col_idx].back();
+  cu.row_id = row_id;
+  if (col_val == nullptr) {
+    cu.new_val_ptr = nullptr;
+  } else {
+    memcpy(cu.new_val_buf, col_val, col_size);
+    // NOTE: we're constructing a pointer here to an element inside the deque.
+    // This is safe because deques never invalidate pointers to their elements.
+    cu.new_val_ptr = cu.new_val_buf;
+  }
+}
+
 template<class Traits>
 Status DeltaPreparer<Traits>::ApplyUpdates(size_t col_to_apply, ColumnBlock* dst,
                                            const SelectionVector& filter) {
@@ -259,7 +295,27 @@ Status DeltaPreparer<Traits>::ApplyUpdates(size_t col_to_apply, ColumnBlock* dst
   }
 
   const ColumnSchema* col_schema = &opts_.projection->column(col_to_apply);
-  for (const ColumnUpdate& cu : updates_by_col_[col_to_apply]) {
+  const UpdatesForColumn& updates = updates_by_col_[col_to_apply];
+  if (col_schema->type_info()->physical_type() != BINARY) {
+    // Cells without indirect data are copied in place, skipping the per-cell
+    // type dispatch of CopyCell().
+    const bool nullable = dst->is_nullable();
+    for (const ColumnUpdate& cu : updates) {
+      int32_t idx_in_block = cu.row_id - prev_prepared_idx_;
+      DCHECK_GE(idx_in_block, 0);
+      if (!filter.IsRowSelected(idx_in_block)) {
+        continue;
+      }
+      if (nullable) {
+        dst->SetCellIsNull(idx_in_block, cu.new_val_ptr == nullptr);
+      }
+      if (cu.new_val_ptr != nullptr) {
+        dst->SetCellValue(idx_in_block, cu.new_val_ptr);
+      }
+    }
+    return Status::OK();
+  }
+  for (const ColumnUpdate& cu : updates) {
     int32_t idx_in_block = cu.row_id - prev_prepared_idx_;
     DCHECK_GE(idx_in_block, 0);
     if (!filter.IsRowSelected(idx_in_block)) {
@@ -52,6 +52,7 @@ namespace tablet {
 class DeltaFileWriter;
 class DeltaIterator;
 class DeltaStats;
+class MvccSnapshot;
 class Mutation;
 
 // Interface for the pieces of the system that track deltas/updates.
@@ -79,6 +80,16 @@ class DeltaStore {
   virtual Status NewDeltaIterator(const RowIteratorOptions& opts,
                                   std::unique_ptr<DeltaIterator>* iterator) const = 0;
 
+  // Sets '*relevant' to false if the store can't include deltas which are
+  // relevant under the select criteria to 'snap_start' and 'snap_end', i.e.
+  // deltas of transactions committed in 'snap_end' but not in 'snap_start'.
+  // Diff scans between the snapshots needn't read such a store. May
+  // initialize the store to read its statistics.
+  virtual Status IsRelevantForSelect(const MvccSnapshot& snap_start,
+                                     const MvccSnapshot& snap_end,
+                                     const fs::IOContext* io_context,
+                                     bool* relevant) = 0;
+
   // Set *deleted to true if the latest update for the given row is a deletion.
   virtual Status CheckRowDeleted(rowid_t row_idx, const fs::IOContext* io_context,
                                  bool *deleted) const = 0;
@@ -315,6 +326,17 @@ class DeltaPreparer : public PreparedDeltas {
   // Call when a new delta becomes available in DeltaIterator::PrepareBatch.
   Status AddDelta(const DeltaKey& key, Slice val, bool* finished_row);
 
+  // Prepares the update of the single column 'col_id' by the delta given by
+  // 'key', setting it to NULL if 'is_null' is set, or else to the value
+  // whose raw encoding is 'raw_value', as in RowChangeListDecoder. This is
+  // equivalent to AddDelta() with a change list updating that column only,
+  // without encoding or decoding one.
+  //
+  // May only be called when the batch is prepared only for
+  // PREPARE_FOR_APPLY.
+  Status AddColumnUpdate(const DeltaKey& key, ColumnId col_id, bool is_null,
+                         Slice raw_value, bool* finished_row);
+
   Status ApplyUpdates(size_t col_to_apply, ColumnBlock* dst,
                       const SelectionVector& filter) override;
 
@@ -330,6 +352,14 @@ class DeltaPreparer : public PreparedDeltas {
 
   bool MayHaveDeltas() const override;
 
+  // Sets whether all the deltas to be added are known to be relevant under
+  // the apply criteria, e.g. because the timestamp range of the store is
+  // committed in the snapshot. If so, their relevancy isn't checked one by
+  // one.
+  void set_all_relevant_for_apply(bool all_relevant) {
+    all_relevant_for_apply_ = all_relevant;
+  }
+
   rowid_t cur_prepared_idx() const { return cur_prepared_idx_; }
   boost::optional<rowid_t> last_added_idx() const { return last_added_idx_; }
   const RowIteratorOptions& opts() const { return opts_; }
@@ -348,6 +378,10 @@ class DeltaPreparer : public PreparedDeltas {
   // Update the deletion state of the current row being processed based on 'op'.
   void UpdateDeletionState(RowChangeList::ChangeType op);
 
+  // Records the update of the projected column 'col_idx' of 'row_id' to the
+  // cell pointed to by 'col_val', or to NULL if it's null.
+  void AddColumnUpdateToApply(rowid_t row_id, int col_idx, const void* col_val);
+
   // Options with which the DeltaPreparer's iterator was constructed.
   const RowIteratorOptions opts_;
 
@@ -367,6 +401,9 @@ class DeltaPreparer : public PreparedDeltas {
   // Whether there are any prepared blocks.
   int prepared_flags_;
 
+  // Whether all deltas are relevant under the apply criteria.
+  bool all_relevant_for_apply_;
+
   // State when prepared_flags_ & PREPARED_FOR_APPLY
   // ------------------------------------------------------------
   struct ColumnUpdate {
@@ -34,6 +34,8 @@
 #include "kudu/fs/block_id.h"
 #include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
+#include "kudu/fs/io_context.h"
+#include "kudu/fs/io_metrics.h"
 #include "kudu/gutil/basictypes.h"
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/port.h"
@@ -45,6 +47,7 @@
 #include "kudu/tablet/delta_store.h"
 #include "kudu/tablet/deltafile.h"
 #include "kudu/tablet/deltamemstore.h"
+#include "kudu/tablet/mvcc.h"
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/rowset_metadata.h"
 #include "kudu/tablet/tablet.pb.h"
@@ -64,6 +67,7 @@ using cfile::ReaderOptions;
 using fs::CreateBlockOptions;
 using fs::IOContext;
 using fs::ReadableBlock;
+using fs::StorageTier;
 using fs::WritableBlock;
 using log::LogAnchorRegistry;
 using std::set;
@@ -409,7 +413,8 @@ Status DeltaTracker::CompactStores(const IOContext* io_context, int start_idx, i
   // Open a writer for the new destination delta block
   FsManager* fs = rowset_metadata_->fs_manager();
   unique_ptr<WritableBlock> block;
-  CreateBlockOptions opts({ rowset_metadata_->tablet_metadata()->tablet_id() });
+  CreateBlockOptions opts({ rowset_metadata_->tablet_metadata()->tablet_id(),
+                            StorageTier::FAST });
   RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(opts, &block),
                         "Could not allocate delta block");
   BlockId new_block_id(block->id());
@@ -437,6 +442,16 @@ Status DeltaTracker::CompactStores(const IOContext* io_context, int start_idx, i
   return Status::OK();
 }
 
+bool DeltaTracker::GetUndoMaxTimestamp(DeltaStore* undo, Timestamp* max_timestamp) const {
+  if (undo->Initted()) {
+    *max_timestamp = undo->delta_stats().max_timestamp();
+    return true;
+  }
+  // This is always a safe downcast because UNDO deltas are always on disk.
+  const BlockId& block_id = down_cast<DeltaFileReader*>(undo)->block_id();
+  return rowset_metadata_->undo_delta_block_max_timestamp(block_id, max_timestamp);
+}
+
 Status DeltaTracker::EstimateBytesInPotentiallyAncientUndoDeltas(Timestamp ancient_history_mark,
                                                                  int64_t* bytes) {
   DCHECK_NE(Timestamp::kInvalidTimestamp, ancient_history_mark);
@@ -446,9 +461,10 @@ Status DeltaTracker::EstimateBytesInPotentiallyAncientUndoDeltas(Timestamp ancie
 
   int64_t tmp_bytes = 0;
   for (const auto& undo : boost::adaptors::reverse(undos_newest_first)) {
-    // Short-circuit once we hit an initialized delta block with 'max_timestamp' > AHM.
-    if (undo->Initted() &&
-        undo->delta_stats().max_timestamp() >= ancient_history_mark) {
+    // Short-circuit once we hit a delta block known to have 'max_timestamp' > AHM.
+    Timestamp max_timestamp;
+    if (GetUndoMaxTimestamp(undo.get(), &max_timestamp) &&
+        max_timestamp >= ancient_history_mark) {
       break;
     }
     tmp_bytes += undo->EstimateSize(); // Can be called before Init().
@@ -468,19 +484,26 @@ Status DeltaTracker::InitUndoDeltas(Timestamp ancient_history_mark,
   int64_t tmp_blocks_initialized = 0;
   int64_t tmp_bytes_in_ancient_undos = 0;
 
-  // Traverse oldest-first, initializing delta stores as we go.
+  // Traverse oldest-first, initializing delta stores as we go. The stores
+  // whose max timestamp is recorded in the rowset metadata don't need to be
+  // initialized to know whether they're ancient.
   for (auto& undo : boost::adaptors::reverse(undos_newest_first)) {
-    if (deadline.Initialized() && MonoTime::Now() >= deadline) break;
-
-    if (!undo->Initted()) {
-      RETURN_NOT_OK(undo->Init(io_context));
-      tmp_blocks_initialized++;
+    Timestamp max_timestamp;
+    if (ancient_history_mark == Timestamp::kInvalidTimestamp ||
+        !GetUndoMaxTimestamp(undo.get(), &max_timestamp)) {
+      if (deadline.Initialized() && MonoTime::Now() >= deadline) break;
+
+      if (!undo->Initted()) {
+        RETURN_NOT_OK(undo->Init(io_context));
+        tmp_blocks_initialized++;
+      }
+      max_timestamp = undo->delta_stats().max_timestamp();
     }
 
     // Stop initializing delta files once we start hitting newer deltas that
     // are not GC'able.
     if (ancient_history_mark != Timestamp::kInvalidTimestamp &&
-        undo->delta_stats().max_timestamp() >= ancient_history_mark) break;
+        max_timestamp >= ancient_history_mark) break;
 
     // We only want to count the bytes in the ancient undos so this needs to
     // come after the short-circuit above.
@@ -492,6 +515,40 @@ Status DeltaTracker::InitUndoDeltas(Timestamp ancient_history_mark,
   return Status::OK();
 }
 
+Status DeltaTracker::AllUndoDeltasCommittedIn(const MvccSnapshot& snap,
+                                              const IOContext* io_context,
+                                              bool* committed) {
+  SharedDeltaStoreVector undos;
+  CollectStores(&undos, UNDOS_ONLY);
+  for (const auto& undo : undos) {
+    if (!undo->Initted()) {
+      RETURN_NOT_OK(undo->Init(io_context));
+    }
+    if (snap.MayHaveUncommittedTransactionsAtOrBefore(undo->delta_stats().max_timestamp())) {
+      *committed = false;
+      return Status::OK();
+    }
+  }
+  *committed = true;
+  return Status::OK();
+}
+
+Status DeltaTracker::AnyDeltasRelevantForSelect(const MvccSnapshot& snap_start,
+                                                const MvccSnapshot& snap_end,
+                                                const IOContext* io_context,
+                                                bool* relevant) const {
+  SharedDeltaStoreVector stores;
+  CollectStores(&stores, UNDOS_AND_REDOS);
+  for (const auto& store : stores) {
+    RETURN_NOT_OK(store->IsRelevantForSelect(snap_start, snap_end, io_context, relevant));
+    if (*relevant) {
+      return Status::OK();
+    }
+  }
+  *relevant = false;
+  return Status::OK();
+}
+
 Status DeltaTracker::DeleteAncientUndoDeltas(Timestamp ancient_history_mark,
                                              const IOContext* io_context,
                                              int64_t* blocks_deleted, int64_t* bytes_deleted) {
@@ -522,8 +579,10 @@ Status DeltaTracker::DeleteAncientUndoDeltas(Timestamp ancient_history_mark,
 
   // Traverse oldest-first.
   for (auto& undo : boost::adaptors::reverse(undos_newest_first)) {
-    if (!undo->Initted()) break; // Never initialize the deltas in this code path (it's slow).
-    if (undo->delta_stats().max_timestamp() >= ancient_history_mark) break;
+    // Never initialize the deltas in this code path (it's slow).
+    Timestamp max_timestamp;
+    if (!GetUndoMaxTimestamp(undo.get(), &max_timestamp)) break;
+    if (max_timestamp >= ancient_history_mark) break;
     tmp_blocks_deleted++;
     tmp_bytes_deleted += undo->EstimateSize();
     // This is always a safe downcast because UNDO deltas are always on disk.
@@ -569,6 +628,9 @@ Status DeltaTracker::DoCompactStores(const IOContext* io_context,
                                                ITERATE_OVER_ALL_ROWS,
                                                &dfw));
   RETURN_NOT_OK(dfw.Finish());
+  if (io_context && io_context->metrics) {
+    io_context->metrics->RecordWrite(io_context->source, dfw.written_size());
+  }
   return Status::OK();
 }
 
@@ -681,7 +743,8 @@ Status DeltaTracker::FlushDMS(DeltaMemStore* dms,
   // Open file for write.
   FsManager* fs = rowset_metadata_->fs_manager();
   unique_ptr<WritableBlock> writable_block;
-  CreateBlockOptions opts({ rowset_metadata_->tablet_metadata()->tablet_id() });
+  CreateBlockOptions opts({ rowset_metadata_->tablet_metadata()->tablet_id(),
+                            StorageTier::FAST });
   RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(opts, &writable_block),
                         "Unable to allocate new delta data writable_block");
   BlockId block_id(writable_block->id());
@@ -695,6 +758,9 @@ Status DeltaTracker::FlushDMS(DeltaMemStore* dms,
   RETURN_NOT_OK(dms->FlushToFile(&dfw, &stats));
   RETURN_NOT_OK(dfw.Finish());
   const auto bytes_written = dfw.written_size();
+  if (io_context && io_context->metrics) {
+    io_context->metrics->RecordWrite(io_context->source, bytes_written);
+  }
   TRACE_COUNTER_INCREMENT("bytes_written", bytes_written);
   TRACE_COUNTER_INCREMENT("delete_count", stats->delete_count());
   TRACE_COUNTER_INCREMENT("reinsert_count", stats->reinsert_count());
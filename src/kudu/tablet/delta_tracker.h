@@ -64,6 +64,7 @@ namespace tablet {
 
 class DeltaFileReader;
 class DeltaMemStore;
+class MvccSnapshot;
 class OperationResultPB;
 class RowSetMetadata;
 class RowSetMetadataUpdate;
@@ -184,6 +185,22 @@ class DeltaTracker {
                         int64_t* delta_blocks_initialized,
                         int64_t* bytes_in_ancient_undos);
 
+  // Sets '*committed' to true if all the UNDO deltas are of transactions
+  // committed in 'snap', i.e. if none of them applies to scans of 'snap'.
+  // Initializes the UNDO delta stores to read their statistics.
+  Status AllUndoDeltasCommittedIn(const MvccSnapshot& snap,
+                                  const fs::IOContext* io_context,
+                                  bool* committed);
+
+  // Sets '*relevant' to false if none of the delta stores include deltas of
+  // transactions committed in 'snap_end' but not in 'snap_start', i.e. if
+  // none of the rows changed between the snapshots. Initializes the delta
+  // stores to read their statistics.
+  Status AnyDeltasRelevantForSelect(const MvccSnapshot& snap_start,
+                                    const MvccSnapshot& snap_end,
+                                    const fs::IOContext* io_context,
+                                    bool* relevant) const;
+
   // See RowSet::DeleteAncientUndoDeltas().
   Status DeleteAncientUndoDeltas(Timestamp ancient_history_mark, const fs::IOContext* io_context,
                                  int64_t* blocks_deleted, int64_t* bytes_deleted);
@@ -284,6 +301,12 @@ class DeltaTracker {
                   std::shared_ptr<DeltaFileReader>* dfr,
                   MetadataFlushType flush_type);
 
+  // Sets '*max_timestamp' to the max timestamp of the deltas of the UNDO
+  // store 'undo' if it's known without reading the store, i.e. if the store
+  // is initialized or its max timestamp is recorded in the rowset metadata.
+  // Returns false otherwise.
+  bool GetUndoMaxTimestamp(DeltaStore* undo, Timestamp* max_timestamp) const;
+
   // This collects undo and/or redo stores into '*stores'.
   void CollectStores(std::vector<std::shared_ptr<DeltaStore>>* stores,
                      WhichStores which) const;
@@ -45,6 +45,7 @@
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/delta_relevancy.h"
+#include "kudu/tablet/delta_stats.h"
 #include "kudu/tablet/mvcc.h"
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/tablet.pb.h"
@@ -360,6 +361,18 @@ Status DeltaFileReader::NewDeltaIterator(const RowIteratorOptions& opts,
   return Status::NotFound("MvccSnapshot outside the range of this delta.");
 }
 
+Status DeltaFileReader::IsRelevantForSelect(const MvccSnapshot& snap_start,
+                                            const MvccSnapshot& snap_end,
+                                            const IOContext* io_context,
+                                            bool* relevant) {
+  // The timestamp range of the file is in its delta stats.
+  RETURN_NOT_OK(Init(io_context));
+  *relevant = IsDeltaRelevantForSelect(snap_start, snap_end,
+                                       delta_stats_->min_timestamp(),
+                                       delta_stats_->max_timestamp());
+  return Status::OK();
+}
+
 Status DeltaFileReader::CheckRowDeleted(rowid_t row_idx, const IOContext* io_context,
                                         bool* deleted) const {
   RETURN_NOT_OK(const_cast<DeltaFileReader*>(this)->Init(io_context));
@@ -448,6 +461,12 @@ Status DeltaFileIterator<Type>::SeekToOrdinal(rowid_t idx) {
     return Status::OK();
   }
 
+  // If the whole timestamp range of the file is relevant, the relevancy of
+  // its deltas needn't be checked one by one.
+  const DeltaStats& stats = dfr_->delta_stats();
+  preparer_.set_all_relevant_for_apply(AreAllDeltasRelevantForApply<Type>(
+      preparer_.opts().snap_to_include, stats.min_timestamp(), stats.max_timestamp()));
+
   if (!index_iter_) {
     index_iter_.reset(IndexTreeIterator::Create(
         preparer_.opts().io_context,
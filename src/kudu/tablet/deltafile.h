@@ -161,6 +161,12 @@ class DeltaFileReader : public DeltaStore,
   Status NewDeltaIterator(const RowIteratorOptions& opts,
                           std::unique_ptr<DeltaIterator>* iterator) const OVERRIDE;
 
+  // See DeltaStore::IsRelevantForSelect
+  virtual Status IsRelevantForSelect(const MvccSnapshot& snap_start,
+                                     const MvccSnapshot& snap_end,
+                                     const fs::IOContext* io_context,
+                                     bool* relevant) OVERRIDE;
+
   // See DeltaStore::CheckRowDeleted
   virtual Status CheckRowDeleted(rowid_t row_idx,
                                  const fs::IOContext* io_context,
@@ -77,6 +77,8 @@ DEFINE_int32(benchmark_num_passes,
 #endif
              "Number of passes to apply deltas in the benchmark");
 
+DECLARE_bool(dms_columnar_updates);
+
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
@@ -639,7 +641,33 @@ TEST_F(TestDeltaMemStore, TestCollectMutations) {
 
 // Generates a series of random deltas,  writes them to a DMS, reads them back
 // using a DMSIterator, and verifies the results.
-TEST_F(TestDeltaMemStore, TestFuzz) {
+// Test that the DMS is culled from scans whose snapshots precede all of its
+// deltas.
+TEST_F(TestDeltaMemStore, TestCullBySnapshot) {
+  RowIteratorOptions opts;
+  opts.projection = &schema_;
+  unique_ptr<DeltaIterator> iter;
+
+  // An empty DMS is irrelevant to any snapshot.
+  opts.snap_to_include = MvccSnapshot(mvcc_);
+  Status s = dms_->NewDeltaIterator(opts, &iter);
+  ASSERT_TRUE(s.IsNotFound()) << s.ToString();
+
+  MvccSnapshot snap_before(mvcc_);
+  NO_FATALS(UpdateIntsAtIndexes(vector<uint32_t>({ 1, 2 })));
+  opts.snap_to_include = snap_before;
+  s = dms_->NewDeltaIterator(opts, &iter);
+  ASSERT_TRUE(s.IsNotFound()) << s.ToString();
+
+  opts.snap_to_include = MvccSnapshot(mvcc_);
+  ASSERT_OK(dms_->NewDeltaIterator(opts, &iter));
+  opts.snap_to_include = MvccSnapshot::CreateSnapshotIncludingAllTransactions();
+  ASSERT_OK(dms_->NewDeltaIterator(opts, &iter));
+}
+
+// Build a random DMS over a wide schema and verify it against the mirrored
+// deltas.
+static void RunDMSFuzzTest() {
   // Arbitrary constants to control the running time and coverage of the test.
   const int kNumColumns = 100;
   const int kNumRows = 1000;
@@ -669,5 +697,87 @@ TEST_F(TestDeltaMemStore, TestFuzz) {
       /*test_filter_column_ids_and_collect_deltas=*/false));
 }
 
+TEST_F(TestDeltaMemStore, TestFuzz) {
+  NO_FATALS(RunDMSFuzzTest());
+}
+
+TEST_F(TestDeltaMemStore, TestFuzzColumnarUpdates) {
+  FLAGS_dms_columnar_updates = true;
+  NO_FATALS(RunDMSFuzzTest());
+}
+
+// Test that updates stored in per-column trees are merged back into the
+// mutations of their rows, in timestamp order and alongside deletes.
+TEST_F(TestDeltaMemStore, TestColumnarUpdates) {
+  FLAGS_dms_columnar_updates = true;
+  ASSERT_OK(DeltaMemStore::Create(0, 0, new log::LogAnchorRegistry(),
+                                  MemTracker::GetRootTracker(), &dms_));
+  ASSERT_OK(dms_->Init(nullptr));
+
+  // Row 5 gets an update of both columns, then an update of one of them.
+  faststring buf;
+  RowChangeListEncoder update(&buf);
+  Slice str("hello");
+  uint32_t val = 1;
+  {
+    ScopedTransaction tx(&mvcc_, clock_->Now());
+    tx.StartApplying();
+    update.AddColumnUpdate(schema_.column(0), schema_.column_id(0), &str);
+    update.AddColumnUpdate(schema_.column(kIntColumn), schema_.column_id(kIntColumn), &val);
+    ASSERT_OK(dms_->Update(tx.timestamp(), 5, RowChangeList(buf), op_id_));
+    tx.Commit();
+  }
+  {
+    ScopedTransaction tx(&mvcc_, clock_->Now());
+    tx.StartApplying();
+    update.Reset();
+    val = 2;
+    update.AddColumnUpdate(schema_.column(kIntColumn), schema_.column_id(kIntColumn), &val);
+    ASSERT_OK(dms_->Update(tx.timestamp(), 5, RowChangeList(buf), op_id_));
+    tx.Commit();
+  }
+  // Row 7 is updated, then deleted.
+  NO_FATALS(UpdateIntsAtIndexes(vector<uint32_t>({ 7 })));
+  {
+    ScopedTransaction tx(&mvcc_, clock_->Now());
+    tx.StartApplying();
+    update.Reset();
+    update.SetToDelete();
+    ASSERT_OK(dms_->Update(tx.timestamp(), 7, RowChangeList(buf), op_id_));
+    tx.Commit();
+  }
+  ASSERT_EQ(5, dms_->Count());
+  ASSERT_FALSE(dms_->Empty());
+
+  // Applying the updates only reads the projected column.
+  ScopedColumnBlock<UINT32> read_back(10);
+  for (int i = 0; i < 10; i++) {
+    read_back[i] = 0;
+  }
+  NO_FATALS(ApplyUpdates(MvccSnapshot(mvcc_), 0, kIntColumn, &read_back));
+  ASSERT_EQ(2, read_back[5]);
+  ASSERT_EQ(0, read_back[6]);
+  // The deleted row is filtered out before its updates are applied.
+  ASSERT_EQ(0, read_back[7]);
+
+  // Collecting them rebuilds the mutations of each row, newest first.
+  RowIteratorOptions opts;
+  opts.projection = &schema_;
+  opts.snap_to_include = MvccSnapshot(mvcc_);
+  unique_ptr<DeltaIterator> iter;
+  ASSERT_OK(dms_->NewDeltaIterator(opts, &iter));
+  ASSERT_OK(iter->Init(nullptr));
+  ASSERT_OK(iter->SeekToOrdinal(0));
+  ASSERT_OK(iter->PrepareBatch(10, DeltaIterator::PREPARE_FOR_COLLECT));
+  Arena arena(1024);
+  vector<Mutation*> mutations(10);
+  ASSERT_OK(iter->CollectMutations(&mutations, &arena));
+  EXPECT_EQ(R"([@2(SET col3=2), @1(SET col1="hello", col3=1)])",
+            Mutation::StringifyMutationList(schema_, mutations[5]));
+  EXPECT_EQ("[@4(DELETE), @3(SET col3=70)]",
+            Mutation::StringifyMutationList(schema_, mutations[7]));
+  EXPECT_EQ("[]", Mutation::StringifyMutationList(schema_, mutations[6]));
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -18,10 +18,12 @@
 #include "kudu/tablet/deltamemstore.h"
 
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <utility>
 
 #include <boost/optional/optional.hpp>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/common/row_changelist.h"
@@ -30,14 +32,23 @@
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/delta_key.h"
+#include "kudu/tablet/delta_relevancy.h"
 #include "kudu/tablet/deltafile.h"
+#include "kudu/tablet/mvcc.h"
 #include "kudu/tablet/rowset.h"
 #include "kudu/util/faststring.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/memcmpable_varint.h"
 #include "kudu/util/memory/memory.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
+DEFINE_bool(dms_columnar_updates, false,
+            "Whether DeltaMemStores store updates in a per-column layout, which makes "
+            "applying them to scanned columns cheaper, and skips the updates of columns "
+            "which aren't scanned. Suited to tables updating a few columns frequently.");
+TAG_FLAG(dms_columnar_updates, experimental);
+
 namespace kudu {
 namespace tablet {
 
@@ -78,9 +89,11 @@ DeltaMemStore::DeltaMemStore(int64_t id,
         HeapBufferAllocator::Get(), std::move(parent_tracker))),
     arena_(new ThreadSafeMemoryTrackingArena(kInitialArenaSize, allocator_)),
     tree_(arena_),
+    columnar_updates_(FLAGS_dms_columnar_updates),
     anchorer_(log_anchor_registry,
               Substitute("Rowset-$0/DeltaMemStore-$1", rs_id_, id_)),
-    disambiguator_sequence_number_(0) {
+    disambiguator_sequence_number_(0),
+    min_timestamp_(Timestamp::kMax.value()) {
 }
 
 Status DeltaMemStore::Init(const IOContext* /*io_context*/) {
@@ -97,14 +110,26 @@ Status DeltaMemStore::Update(Timestamp timestamp,
 
   key.EncodeTo(&buf);
 
+  // Timestamps mostly increase, so the minimum is rarely lowered. It's
+  // lowered before the delta is inserted.
+  if (PREDICT_FALSE(timestamp.value() < min_timestamp_.Load())) {
+    min_timestamp_.StoreMin(timestamp.value());
+  }
+
+  if (columnar_updates_ && update.is_update()) {
+    RETURN_NOT_OK(UpdateColumns(&buf, update));
+    anchorer_.AnchorIfMinimum(op_id.index());
+    return Status::OK();
+  }
+
   Slice key_slice(buf);
   btree::PreparedMutation<DMSTreeTraits> mutation(key_slice);
   mutation.Prepare(&tree_);
-  if (PREDICT_FALSE(mutation.exists())) {
+  if (PREDICT_FALSE(mutation.exists() ||
+                    (columnar_updates_ && ColumnTreesContain(key_slice)))) {
     // We already have a delta for this row at the same timestamp.
     // Try again with a disambiguating sequence number appended to the key.
-    int seq = disambiguator_sequence_number_.Increment();
-    PutMemcmpableVarint64(&buf, seq);
+    Disambiguate(&buf);
     key_slice = Slice(buf);
     mutation.Reset(key_slice);
     mutation.Prepare(&tree_);
@@ -121,21 +146,210 @@ Status DeltaMemStore::Update(Timestamp timestamp,
   return Status::OK();
 }
 
+void DeltaMemStore::Disambiguate(faststring* key_buf) {
+  int seq = disambiguator_sequence_number_.Increment();
+  PutMemcmpableVarint64(key_buf, seq);
+}
+
+namespace {
+
+// Returns true if 'tree' has an entry with the key 'key'.
+bool TreeContains(const DeltaMemStore::DMSTree& tree, const Slice& key) {
+  // Values are never empty, so a zero-length buffer only tells whether the
+  // key exists.
+  size_t len = 0;
+  return tree.GetCopy(key, nullptr, &len) != DeltaMemStore::DMSTree::GET_NOT_FOUND;
+}
+
+// Decodes a value of a column tree into whether it's NULL and its raw value.
+void DecodeColumnValue(Slice val, bool* is_null, Slice* raw_value) {
+  DCHECK_GE(val.size(), 1);
+  *is_null = val[0] == 0;
+  val.remove_prefix(1);
+  *raw_value = val;
+}
+
+} // anonymous namespace
+
+Status DeltaMemStore::UpdateColumns(faststring* key_buf, const RowChangeList& update) {
+  RowChangeListDecoder decoder(update);
+  RETURN_NOT_OK(decoder.Init());
+  vector<RowChangeListDecoder::DecodedUpdate> col_updates;
+  vector<DMSTree*> trees;
+  bool exists = TreeContains(tree_, Slice(*key_buf));
+  while (decoder.HasNext()) {
+    col_updates.emplace_back();
+    RETURN_NOT_OK(decoder.DecodeNext(&col_updates.back()));
+    trees.push_back(GetOrCreateColumnTree(col_updates.back().col_id));
+    exists = exists || TreeContains(*trees.back(), Slice(*key_buf));
+  }
+  if (PREDICT_FALSE(exists)) {
+    // Updates of the same row at the same timestamp must sort in the order
+    // they were applied, whatever trees they're in. An earlier update of
+    // other columns with the same key doesn't matter though, since the two
+    // don't conflict.
+    Disambiguate(key_buf);
+  }
+
+  Slice key_slice(*key_buf);
+  faststring val;
+  for (int i = 0; i < col_updates.size(); i++) {
+    const auto& col_update = col_updates[i];
+    val.clear();
+    val.push_back(col_update.null ? 0 : 1);
+    if (!col_update.null) {
+      val.append(col_update.raw_value.data(), col_update.raw_value.size());
+    }
+    btree::PreparedMutation<DMSTreeTraits> mutation(key_slice);
+    mutation.Prepare(trees[i]);
+    CHECK(!mutation.exists()) << "Duplicate delta in the tree of column "
+                              << col_update.col_id;
+    if (PREDICT_FALSE(!mutation.Insert(Slice(val)))) {
+      return Status::IOError("Unable to insert into tree");
+    }
+  }
+  return Status::OK();
+}
+
+DeltaMemStore::DMSTree* DeltaMemStore::GetOrCreateColumnTree(ColumnId col_id) {
+  {
+    shared_lock<rw_spinlock> l(column_trees_lock_);
+    auto it = column_trees_.find(col_id);
+    if (it != column_trees_.end()) {
+      return it->second.get();
+    }
+  }
+  std::lock_guard<rw_spinlock> l(column_trees_lock_);
+  auto& tree = column_trees_[col_id];
+  if (!tree) {
+    tree.reset(new DMSTree(arena_));
+  }
+  return tree.get();
+}
+
+void DeltaMemStore::GetColumnTrees(ColumnTrees* trees) const {
+  trees->clear();
+  if (!columnar_updates_) {
+    return;
+  }
+  shared_lock<rw_spinlock> l(column_trees_lock_);
+  for (const auto& e : column_trees_) {
+    trees->emplace_back(e.first, e.second.get());
+  }
+}
+
+bool DeltaMemStore::ColumnTreesContain(const Slice& key) const {
+  ColumnTrees trees;
+  GetColumnTrees(&trees);
+  for (const auto& e : trees) {
+    if (TreeContains(*e.second, key)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t DeltaMemStore::Count() const {
+  size_t count = tree_.count();
+  ColumnTrees trees;
+  GetColumnTrees(&trees);
+  for (const auto& e : trees) {
+    count += e.second->count();
+  }
+  return count;
+}
+
+bool DeltaMemStore::Empty() const {
+  if (!tree_.empty()) {
+    return false;
+  }
+  ColumnTrees trees;
+  GetColumnTrees(&trees);
+  for (const auto& e : trees) {
+    if (!e.second->empty()) {
+      return false;
+    }
+  }
+  return true;
+}
+
 Status DeltaMemStore::FlushToFile(DeltaFileWriter *dfw,
                                   gscoped_ptr<DeltaStats>* stats_ret) {
   gscoped_ptr<DeltaStats> stats(new DeltaStats());
 
   gscoped_ptr<DMSTreeIter> iter(tree_.NewIterator());
   iter->SeekToStart();
-  while (iter->IsValid()) {
+
+  // The updates in the per-column layout are merged with the deltas of the
+  // main tree, combining those with the same key into a single change list,
+  // as they would have been stored in the main tree.
+  ColumnTrees trees;
+  GetColumnTrees(&trees);
+  vector<unique_ptr<DMSTreeIter>> col_iters;
+  for (const auto& e : trees) {
+    col_iters.emplace_back(e.second->NewIterator());
+    col_iters.back()->SeekToStart();
+  }
+  faststring min_key;
+  faststring rcl_buf;
+  while (true) {
+    bool have_min = false;
+    bool from_main = false;
     Slice key_slice, val;
-    iter->GetCurrentEntry(&key_slice, &val);
+    if (iter->IsValid()) {
+      iter->GetCurrentEntry(&key_slice, &val);
+      min_key.assign_copy(key_slice.data(), key_slice.size());
+      have_min = true;
+      from_main = true;
+    }
+    for (const auto& col_iter : col_iters) {
+      if (!col_iter->IsValid()) continue;
+      col_iter->GetCurrentEntry(&key_slice, &val);
+      if (!have_min || key_slice.compare(Slice(min_key)) < 0) {
+        min_key.assign_copy(key_slice.data(), key_slice.size());
+        have_min = true;
+        from_main = false;
+      }
+    }
+    if (!have_min) {
+      break;
+    }
+
+    key_slice = Slice(min_key);
     DeltaKey key;
     RETURN_NOT_OK(key.DecodeFrom(&key_slice));
-    RowChangeList rcl(val);
+    RowChangeList rcl;
+    if (from_main) {
+      iter->GetCurrentEntry(&key_slice, &val);
+      rcl = RowChangeList(val);
+    } else {
+      RowChangeListEncoder encoder(&rcl_buf);
+      encoder.Reset();
+      for (int i = 0; i < col_iters.size(); i++) {
+        if (!col_iters[i]->IsValid()) continue;
+        col_iters[i]->GetCurrentEntry(&key_slice, &val);
+        if (key_slice != Slice(min_key)) continue;
+        bool is_null;
+        Slice raw_value;
+        DecodeColumnValue(val, &is_null, &raw_value);
+        encoder.AddRawColumnUpdate(trees[i].first, is_null, raw_value);
+      }
+      rcl = encoder.as_changelist();
+    }
     RETURN_NOT_OK_PREPEND(dfw->AppendDelta<REDO>(key, rcl), "Failed to append delta");
     stats->UpdateStats(key.timestamp(), rcl);
-    iter->Next();
+
+    if (from_main) {
+      iter->Next();
+    } else {
+      for (const auto& col_iter : col_iters) {
+        if (!col_iter->IsValid()) continue;
+        col_iter->GetCurrentEntry(&key_slice, &val);
+        if (key_slice == Slice(min_key)) {
+          col_iter->Next();
+        }
+      }
+    }
   }
   dfw->WriteDeltaStats(*stats);
 
@@ -145,10 +359,33 @@ Status DeltaMemStore::FlushToFile(DeltaFileWriter *dfw,
 
 Status DeltaMemStore::NewDeltaIterator(const RowIteratorOptions& opts,
                                        unique_ptr<DeltaIterator>* iterator) const {
+  // The deltas committed in the snapshot were all applied before it was
+  // taken. So if the snapshot has no committed transactions at or after the
+  // lowest timestamp of the DMS, none of its deltas, current or future, are
+  // relevant for applying. Deltas relevant for selecting must be committed
+  // in the snapshot too.
+  Timestamp min_timestamp(min_timestamp_.Load());
+  if (!opts.snap_to_include.MayHaveCommittedTransactionsAtOrAfter(min_timestamp)) {
+    VLOG(2) << "Culling DMS " << ToString() << " with min ts " << min_timestamp.ToString()
+            << " for " << opts.snap_to_include.ToString();
+    return Status::NotFound("MvccSnapshot outside the range of this delta.");
+  }
   iterator->reset(new DMSIterator(shared_from_this(), opts));
   return Status::OK();
 }
 
+Status DeltaMemStore::IsRelevantForSelect(const MvccSnapshot& snap_start,
+                                          const MvccSnapshot& snap_end,
+                                          const IOContext* /*io_context*/,
+                                          bool* relevant) {
+  // The minimum timestamp is lowered before a delta is inserted, so it
+  // covers the deltas of all the transactions committed in 'snap_end'.
+  *relevant = !Empty() &&
+      IsDeltaRelevantForSelect(snap_start, snap_end,
+                               Timestamp(min_timestamp_.Load()), Timestamp::kMax);
+  return Status::OK();
+}
+
 Status DeltaMemStore::CheckRowDeleted(rowid_t row_idx,
                                       const IOContext* /*io_context*/,
                                       bool *deleted) const {
@@ -189,6 +426,12 @@ Status DeltaMemStore::CheckRowDeleted(rowid_t row_idx,
 
 void DeltaMemStore::DebugPrint() const {
   tree_.DebugPrint();
+  ColumnTrees trees;
+  GetColumnTrees(&trees);
+  for (const auto& e : trees) {
+    LOG(INFO) << "Updates of column " << e.first << ":";
+    e.second->DebugPrint();
+  }
 }
 
 ////////////////////////////////////////////////////////////
@@ -200,6 +443,7 @@ DMSIterator::DMSIterator(const shared_ptr<const DeltaMemStore>& dms,
     : dms_(dms),
       preparer_(std::move(opts)),
       iter_(dms->tree_.NewIterator()),
+      arena_(256),
       seeked_(false) {}
 
 Status DMSIterator::Init(ScanSpec* /*spec*/) {
@@ -214,11 +458,60 @@ Status DMSIterator::SeekToOrdinal(rowid_t row_idx) {
 
   bool exact; /* unused */
   iter_->SeekAtOrAfter(Slice(buf), &exact);
+  for (auto& cursor : column_cursors_) {
+    cursor.iter->SeekAtOrAfter(Slice(buf), &exact);
+  }
+  AddColumnCursors(row_idx);
   preparer_.Seek(row_idx);
   seeked_ = true;
   return Status::OK();
 }
 
+void DMSIterator::AddColumnCursors(rowid_t row_idx) {
+  DeltaMemStore::ColumnTrees trees;
+  dms_->GetColumnTrees(&trees);
+  if (trees.size() == column_cursors_.size()) {
+    return;
+  }
+  faststring buf;
+  DeltaKey key(row_idx, Timestamp(0));
+  key.EncodeTo(&buf);
+  for (const auto& e : trees) {
+    bool found = false;
+    for (const auto& cursor : column_cursors_) {
+      if (cursor.col_id == e.first) {
+        found = true;
+        break;
+      }
+    }
+    if (found) continue;
+    ColumnCursor cursor;
+    cursor.col_id = e.first;
+    cursor.projected =
+        preparer_.opts().projection->find_column_by_id(e.first) != Schema::kColumnNotFound;
+    cursor.iter.reset(e.second->NewIterator());
+    bool exact; /* unused */
+    cursor.iter->SeekAtOrAfter(Slice(buf), &exact);
+    column_cursors_.emplace_back(std::move(cursor));
+  }
+}
+
+DMSIterator::ColumnCursor* DMSIterator::MinColumnCursor(bool projected_only, Slice* key) {
+  ColumnCursor* min_cursor = nullptr;
+  for (auto& cursor : column_cursors_) {
+    if ((projected_only && !cursor.projected) || !cursor.iter->IsValid()) {
+      continue;
+    }
+    Slice cur_key, val;
+    cursor.iter->GetCurrentEntry(&cur_key, &val);
+    if (min_cursor == nullptr || cur_key.compare(*key) < 0) {
+      min_cursor = &cursor;
+      *key = cur_key;
+    }
+  }
+  return min_cursor;
+}
+
 Status DMSIterator::PrepareBatch(size_t nrows, int prepare_flags) {
   // This current implementation copies the whole batch worth of deltas
   // into a buffer local to this iterator, after filtering out deltas which
@@ -237,10 +530,55 @@ Status DMSIterator::PrepareBatch(size_t nrows, int prepare_flags) {
   rowid_t stop_row = start_row + nrows - 1;
 
   preparer_.Start(nrows, prepare_flags);
+
+  // In the per-column layout, the updates of each column are merged with the
+  // deltas of the main tree in key order. When only applying updates, those
+  // of the columns which aren't projected are skipped, and the others are
+  // applied without going through a change list.
+  AddColumnCursors(start_row);
+  const bool apply_only = prepare_flags == PREPARE_FOR_APPLY;
+  arena_.Reset();
+  faststring rcl_buf;
+
   bool finished_row = false;
-  while (iter_->IsValid()) {
+  while (true) {
     Slice key_slice, val;
-    iter_->GetCurrentEntry(&key_slice, &val);
+    Slice col_key;
+    ColumnCursor* col_cursor = MinColumnCursor(apply_only, &col_key);
+    bool from_main = false;
+    if (iter_->IsValid()) {
+      iter_->GetCurrentEntry(&key_slice, &val);
+      from_main = col_cursor == nullptr || key_slice.compare(col_key) < 0;
+    } else if (col_cursor == nullptr) {
+      break;
+    }
+    if (!from_main) {
+      key_slice = col_key;
+    }
+    const Slice encoded_key = key_slice;
+
+    // Advances past the current entry. Without the fast path, the updates of
+    // all the columns with the current key are combined, so they're all
+    // skipped.
+    auto next = [&]() {
+      if (from_main) {
+        iter_->Next();
+      } else if (apply_only) {
+        col_cursor->iter->Next();
+      } else {
+        faststring cur_key;
+        cur_key.assign_copy(encoded_key.data(), encoded_key.size());
+        for (auto& cursor : column_cursors_) {
+          Slice k, v;
+          if (!cursor.iter->IsValid()) continue;
+          cursor.iter->GetCurrentEntry(&k, &v);
+          if (k == Slice(cur_key)) {
+            cursor.iter->Next();
+          }
+        }
+      }
+    };
+
     DeltaKey key;
     RETURN_NOT_OK(key.DecodeFrom(&key_slice));
     rowid_t cur_row = key.row_idx();
@@ -251,7 +589,7 @@ Status DMSIterator::PrepareBatch(size_t nrows, int prepare_flags) {
     if (preparer_.last_added_idx() &&
         preparer_.last_added_idx() == cur_row &&
         finished_row) {
-      iter_->Next();
+      next();
       continue;
     }
     finished_row = false;
@@ -261,6 +599,39 @@ Status DMSIterator::PrepareBatch(size_t nrows, int prepare_flags) {
       break;
     }
 
+    if (!from_main) {
+      if (apply_only) {
+        bool is_null;
+        Slice raw_value;
+        col_cursor->iter->GetCurrentEntry(&key_slice, &val);
+        DecodeColumnValue(val, &is_null, &raw_value);
+        RETURN_NOT_OK(preparer_.AddColumnUpdate(key, col_cursor->col_id, is_null, raw_value,
+                                                &finished_row));
+      } else {
+        // Other preparations need the change list of the updates with this
+        // key, which must remain valid until the next batch.
+        RowChangeListEncoder encoder(&rcl_buf);
+        encoder.Reset();
+        for (auto& cursor : column_cursors_) {
+          Slice k, v;
+          if (!cursor.iter->IsValid()) continue;
+          cursor.iter->GetCurrentEntry(&k, &v);
+          if (k != encoded_key) continue;
+          bool is_null;
+          Slice raw_value;
+          DecodeColumnValue(v, &is_null, &raw_value);
+          encoder.AddRawColumnUpdate(cursor.col_id, is_null, raw_value);
+        }
+        Slice rcl;
+        if (PREDICT_FALSE(!arena_.RelocateSlice(Slice(rcl_buf), &rcl))) {
+          return Status::RuntimeError("Out of memory for delta change lists");
+        }
+        RETURN_NOT_OK(preparer_.AddDelta(key, rcl, &finished_row));
+      }
+      next();
+      continue;
+    }
+
     // Note: if AddDelta() sets 'finished_row' to true, we could skip the
     // remaining deltas for this row by seeking the tree iterator. This trades
     // off the cost of a seek against the cost of decoding some irrelevant delta
@@ -273,6 +644,19 @@ Status DMSIterator::PrepareBatch(size_t nrows, int prepare_flags) {
     RETURN_NOT_OK(preparer_.AddDelta(key, val, &finished_row));
     iter_->Next();
   }
+
+  // The updates of the columns which weren't projected were skipped.
+  if (apply_only) {
+    faststring buf;
+    DeltaKey key(stop_row + 1, Timestamp(0));
+    key.EncodeTo(&buf);
+    for (auto& cursor : column_cursors_) {
+      if (!cursor.projected) {
+        bool exact; /* unused */
+        cursor.iter->SeekAtOrAfter(Slice(buf), &exact);
+      }
+    }
+  }
   preparer_.Finish(nrows);
   return Status::OK();
 }
@@ -301,7 +685,15 @@ Status DMSIterator::FilterColumnIdsAndCollectDeltas(const vector<ColumnId>& col_
 }
 
 bool DMSIterator::HasNext() {
-  return iter_->IsValid();
+  if (iter_->IsValid()) {
+    return true;
+  }
+  for (const auto& cursor : column_cursors_) {
+    if (cursor.iter->IsValid()) {
+      return true;
+    }
+  }
+  return false;
 }
 
 bool DMSIterator::MayHaveDeltas() const {
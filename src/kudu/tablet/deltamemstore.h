@@ -19,11 +19,14 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "kudu/common/rowid.h"
+#include "kudu/common/schema.h"
 #include "kudu/consensus/log_anchor_registry.h"
 #include "kudu/gutil/atomicops.h"
 #include "kudu/gutil/gscoped_ptr.h"
@@ -33,7 +36,9 @@
 #include "kudu/tablet/delta_stats.h"
 #include "kudu/tablet/delta_store.h"
 #include "kudu/util/atomic.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/memory/arena.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
@@ -45,7 +50,7 @@ class RowChangeList;
 class ScanSpec;
 class SelectionVector;
 class Timestamp;
-struct ColumnId;
+class faststring;
 
 namespace consensus {
 class OpId;
@@ -68,6 +73,13 @@ struct DMSTreeTraits : public btree::BTreeTraits {
 // In-memory storage for data which has been recently updated.
 // This essentially tracks a 'diff' per row, which contains the
 // modified columns.
+//
+// If --dms_columnar_updates is set, updates are instead stored in a
+// per-column layout: a tree per updated column, keyed by DeltaKey like the
+// main tree, whose values are the new values of the column. Applying them to
+// a column block takes no RowChangeList decoding, and the updates of columns
+// which aren't projected are skipped altogether. Deletes are always stored
+// in the main tree.
 
 class DeltaMemStore : public DeltaStore,
                       public std::enable_shared_from_this<DeltaMemStore> {
@@ -90,13 +102,11 @@ class DeltaMemStore : public DeltaStore,
                 const RowChangeList &update,
                 const consensus::OpId& op_id);
 
-  size_t Count() const {
-    return tree_.count();
-  }
+  // Return the number of deltas. In the per-column layout, an update counts
+  // once per updated column.
+  size_t Count() const;
 
-  bool Empty() const {
-    return tree_.empty();
-  }
+  bool Empty() const;
 
   // Dump a debug version of the tree to the logs. This is not thread-safe, so
   // is only really useful in unit tests.
@@ -121,6 +131,14 @@ class DeltaMemStore : public DeltaStore,
   virtual Status NewDeltaIterator(const RowIteratorOptions& opts,
                                   std::unique_ptr<DeltaIterator>* iterator) const OVERRIDE;
 
+  // The DMS tracks the lowest timestamp of its deltas, but not the highest:
+  // it's relevant unless it's empty or all its deltas are uncommitted in
+  // 'snap_end'.
+  virtual Status IsRelevantForSelect(const MvccSnapshot& snap_start,
+                                     const MvccSnapshot& snap_end,
+                                     const fs::IOContext* io_context,
+                                     bool* relevant) OVERRIDE;
+
   virtual Status CheckRowDeleted(rowid_t row_idx, const fs::IOContext* io_context,
                                  bool* deleted) const OVERRIDE;
 
@@ -159,6 +177,28 @@ class DeltaMemStore : public DeltaStore,
     return tree_;
   }
 
+  // The trees of the updates of each column, in the per-column layout.
+  typedef std::vector<std::pair<ColumnId, const DMSTree*>> ColumnTrees;
+
+  // Sets 'trees' to the trees of the updates of each column created so far,
+  // in increasing order of column ID.
+  void GetColumnTrees(ColumnTrees* trees) const;
+
+  // Returns the tree of the updates of 'col_id', creating it if needed.
+  DMSTree* GetOrCreateColumnTree(ColumnId col_id);
+
+  // Returns true if a delta with the encoded key 'key' is stored in the
+  // tree of the updates of any column.
+  bool ColumnTreesContain(const Slice& key) const;
+
+  // Stores the column updates of 'update' with the encoded key in 'key_buf'
+  // in the per-column layout.
+  Status UpdateColumns(faststring* key_buf, const RowChangeList& update);
+
+  // Makes the encoded key in 'key_buf', which is already taken, unique by
+  // appending a sequence number to it.
+  void Disambiguate(faststring* key_buf);
+
   const int64_t id_;    // DeltaMemStore ID.
   const int64_t rs_id_; // Rowset ID.
 
@@ -169,6 +209,18 @@ class DeltaMemStore : public DeltaStore,
   // Concurrent B-Tree storing <key index> -> RowChangeList
   DMSTree tree_;
 
+  // Whether updates are stored in the per-column layout.
+  const bool columnar_updates_;
+
+  // Protects 'column_trees_'. The trees are never removed, so pointers to
+  // them remain valid for the lifetime of the DMS.
+  mutable rw_spinlock column_trees_lock_;
+
+  // Concurrent B-Trees storing <key index> -> new value of the column, for
+  // each updated column. The values are a byte which is 0 for NULL, and
+  // otherwise 1, followed by the raw value of the column.
+  std::map<ColumnId, std::unique_ptr<DMSTree>> column_trees_;
+
   log::MinLogIndexAnchorer anchorer_;
 
   const DeltaStats delta_stats_;
@@ -181,6 +233,11 @@ class DeltaMemStore : public DeltaStore,
   // number, and is only used in the case that such a collision occurs.
   AtomicInt<Atomic32> disambiguator_sequence_number_;
 
+  // The lowest timestamp of the deltas of the DMS, or Timestamp::kMax if
+  // it's empty. Used to cull the DMS from scans whose snapshots precede all
+  // of its deltas.
+  AtomicInt<uint64_t> min_timestamp_;
+
   DISALLOW_COPY_AND_ASSIGN(DeltaMemStore);
 };
 
@@ -231,12 +288,36 @@ class DMSIterator : public DeltaIterator {
   DMSIterator(const std::shared_ptr<const DeltaMemStore> &dms,
               RowIteratorOptions opts);
 
+  // An iterator over the tree of the updates of a column.
+  struct ColumnCursor {
+    ColumnId col_id;
+    bool projected;
+    std::unique_ptr<DeltaMemStore::DMSTreeIter> iter;
+  };
+
+  // Creates the cursors over the column trees created since the last call,
+  // positioned at 'row_idx'.
+  void AddColumnCursors(rowid_t row_idx);
+
+  // Returns the cursor with the smallest current key, or nullptr if none is
+  // valid, setting 'key' to its key. Only projected columns are considered
+  // if 'projected_only' is set.
+  ColumnCursor* MinColumnCursor(bool projected_only, Slice* key);
+
   const std::shared_ptr<const DeltaMemStore> dms_;
 
   DeltaPreparer<DMSPreparerTraits> preparer_;
 
   gscoped_ptr<DeltaMemStore::DMSTreeIter> iter_;
 
+  // The cursors over the trees of the updates of each column, in the
+  // per-column layout.
+  std::vector<ColumnCursor> column_cursors_;
+
+  // Holds the change lists made of column updates, when they are prepared
+  // for more than applying them. Reset on each batch.
+  Arena arena_;
+
   bool initted_;
 
   // True if SeekToOrdinal() been called at least once.
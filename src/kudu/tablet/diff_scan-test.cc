@@ -75,7 +75,7 @@ TEST_P(DiffScanTest, TestDiffScan) {
 
   // 2. Delete the row and flush the DMS.
   ASSERT_OK(DeleteTestRow(&writer, kRowKey));
-  ASSERT_OK(tablet->FlushAllDMSForTests());
+  ASSERT_OK(tablet->FlushAllDMS());
 
   // 3. Insert the same row key (with another value) and flush the MRS.
   ASSERT_OK(InsertTestRow(&writer, kRowKey, 2));
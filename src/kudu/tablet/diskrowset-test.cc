@@ -78,6 +78,7 @@ DEFINE_double(update_fraction, 0.1f, "fraction of rows to update");
 DECLARE_bool(cfile_lazy_open);
 DECLARE_bool(crash_on_eio);
 DECLARE_int32(cfile_default_block_size);
+DECLARE_int32(flush_column_encoding_threads);
 DECLARE_double(env_inject_eio);
 DECLARE_double(tablet_delta_store_major_compact_min_ratio);
 DECLARE_int32(tablet_delta_store_minor_compact_max);
@@ -175,6 +176,20 @@ TEST_F(TestRowSet, TestRowSetRoundTrip) {
   }
 }
 
+// Test writing the columns of a rowset in parallel.
+TEST_F(TestRowSet, TestParallelColumnWriting) {
+  FLAGS_flush_column_encoding_threads = 4;
+  WriteTestRowSet();
+
+  shared_ptr<DiskRowSet> rs;
+  ASSERT_OK(OpenTestRowSet(&rs));
+  IterateProjection(*rs, schema_, n_rows_);
+
+  Schema proj_val;
+  ASSERT_OK(schema_.CreateProjectionByNames({ "val" }, &proj_val));
+  IterateProjection(*rs, proj_val, n_rows_);
+}
+
 // Test writing a rowset, and then updating some rows in it.
 TEST_F(TestRowSet, TestRowSetUpdate) {
   WriteTestRowSet();
@@ -620,6 +635,53 @@ TEST_F(TestRowSet, TestCompactStores) {
   }
   ASSERT_TRUE(is_sorted(results.begin(), results.end()));
 }
+// Test that diff scans may skip a DiskRowSet whose delta stores have no
+// deltas committed between their snapshots.
+TEST_F(TestRowSet, TestIsRelevantForDiffScan) {
+  // Note: Our test methods here don't write UNDO delete deltas.
+  WriteTestRowSet(10);
+  shared_ptr<DiskRowSet> rs;
+  ASSERT_OK(OpenTestRowSet(&rs));
+  MvccSnapshot snap0(mvcc_);
+
+  auto is_relevant = [&](const MvccSnapshot& snap_start, const MvccSnapshot& snap_end) {
+    RowIteratorOptions opts;
+    opts.projection = &schema_;
+    opts.snap_to_exclude = snap_start;
+    opts.snap_to_include = snap_end;
+    bool relevant;
+    CHECK_OK(rs->IsRelevantForDiffScan(opts, &relevant));
+    return relevant;
+  };
+
+  // Without deltas, no row changed.
+  MvccSnapshot snap1(mvcc_);
+  ASSERT_FALSE(is_relevant(snap0, snap1));
+
+  // The DMS doesn't track the highest timestamp of its deltas, so it's
+  // relevant to diff scans ending after its first delta.
+  OperationResultPB result;
+  ASSERT_OK(UpdateRow(rs.get(), 5, 12345, &result));
+  MvccSnapshot snap2(mvcc_);
+  ASSERT_FALSE(is_relevant(snap0, snap1));
+  ASSERT_TRUE(is_relevant(snap1, snap2));
+  ASSERT_TRUE(is_relevant(snap2, snap2));
+
+  // Once flushed, the timestamp range of the deltas is known.
+  ASSERT_OK(rs->FlushDeltas(nullptr));
+  MvccSnapshot snap3(mvcc_);
+  ASSERT_FALSE(is_relevant(snap0, snap1));
+  ASSERT_TRUE(is_relevant(snap0, snap2));
+  ASSERT_TRUE(is_relevant(snap1, snap3));
+  ASSERT_FALSE(is_relevant(snap2, snap3));
+
+  // Converting the REDO deltas to UNDO deltas doesn't change their
+  // timestamps.
+  ASSERT_OK(rs->MajorCompactDeltaStores(nullptr, HistoryGcOpts::Disabled()));
+  ASSERT_EQ(1, rs->delta_tracker()->CountUndoDeltaStores());
+  ASSERT_TRUE(is_relevant(snap1, snap3));
+  ASSERT_FALSE(is_relevant(snap2, snap3));
+}
 
 TEST_F(TestRowSet, TestGCAncientStores) {
   // Disable lazy open so that major delta compactions don't require manual REDO initialization.
@@ -728,7 +790,7 @@ INSTANTIATE_TEST_CASE_P(RowIteratorOptionsPermutations, DiffScanRowSetTest,
 // of rows, but we randomly flush/compact between each update operation so that
 // the test operates on a variety of different on-disk and in-memory layouts.
 TEST_P(DiffScanRowSetTest, TestFuzz) {
-  fs::IOContext test_context;
+  fs::IOContext test_context = {};
 
   // Create and open a DRS with four rows.
   shared_ptr<DiskRowSet> rs;
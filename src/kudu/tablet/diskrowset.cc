@@ -34,13 +34,16 @@
 #include "kudu/common/generic_iterators.h"
 #include "kudu/common/iterator.h"
 #include "kudu/common/rowblock.h"
+#include "kudu/common/scan_aggregator.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
 #include "kudu/common/types.h"
 #include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/cfile_set.h"
 #include "kudu/tablet/compaction.h"
 #include "kudu/tablet/delta_compaction.h"
@@ -51,6 +54,8 @@
 #include "kudu/tablet/multi_column_writer.h"
 #include "kudu/tablet/mutation.h"
 #include "kudu/tablet/mvcc.h"
+#include "kudu/tablet/rollup.h"
+#include "kudu/tablet/secondary_index.h"
 #include "kudu/util/compression/compression.pb.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/flag_tags.h"
@@ -91,26 +96,32 @@ class OpId;
 namespace tablet {
 
 using cfile::BloomFileWriter;
+using cfile::CFileReader;
 using fs::BlockManager;
 using fs::BlockCreationTransaction;
 using fs::CreateBlockOptions;
 using fs::IOContext;
+using fs::StorageTier;
 using fs::WritableBlock;
 using log::LogAnchorRegistry;
+using std::pair;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
 using std::vector;
+using strings::Substitute;
 
 const char *DiskRowSet::kMinKeyMetaEntryName = "min_key";
 const char *DiskRowSet::kMaxKeyMetaEntryName = "max_key";
 
 DiskRowSetWriter::DiskRowSetWriter(RowSetMetadata* rowset_metadata,
                                    const Schema* schema,
-                                   BloomFilterSizing bloom_sizing)
+                                   BloomFilterSizing bloom_sizing,
+                                   fs::StorageTier data_tier)
     : rowset_metadata_(rowset_metadata),
       schema_(schema),
       bloom_sizing_(bloom_sizing),
+      data_tier_(data_tier),
       finished_(false),
       written_count_(0) {
   CHECK(schema->has_column_ids());
@@ -121,7 +132,7 @@ Status DiskRowSetWriter::Open() {
 
   FsManager* fs = rowset_metadata_->fs_manager();
   const string& tablet_id = rowset_metadata_->tablet_metadata()->tablet_id();
-  col_writer_.reset(new MultiColumnWriter(fs, schema_, tablet_id));
+  col_writer_.reset(new MultiColumnWriter(fs, schema_, tablet_id, data_tier_));
   RETURN_NOT_OK(col_writer_->Open());
 
   // Open bloom filter.
@@ -132,6 +143,12 @@ Status DiskRowSetWriter::Open() {
     RETURN_NOT_OK(InitAdHocIndexWriter());
   }
 
+  RETURN_NOT_OK(InitSecondaryIndexWriters());
+
+  if (schema_->has_rollup()) {
+    RETURN_NOT_OK(InitRollupWriter());
+  }
+
   return Status::OK();
 }
 
@@ -140,7 +157,7 @@ Status DiskRowSetWriter::InitBloomFileWriter() {
   unique_ptr<WritableBlock> block;
   FsManager* fs = rowset_metadata_->fs_manager();
   const string& tablet_id = rowset_metadata_->tablet_metadata()->tablet_id();
-  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(CreateBlockOptions({ tablet_id }),
+  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(CreateBlockOptions({ tablet_id, StorageTier::FAST }),
                                            &block),
                         "Couldn't allocate a block for bloom filter");
   rowset_metadata_->set_bloom_block(block->id());
@@ -155,7 +172,7 @@ Status DiskRowSetWriter::InitAdHocIndexWriter() {
   unique_ptr<WritableBlock> block;
   FsManager* fs = rowset_metadata_->fs_manager();
   const string& tablet_id = rowset_metadata_->tablet_metadata()->tablet_id();
-  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(CreateBlockOptions({ tablet_id }),
+  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(CreateBlockOptions({ tablet_id, StorageTier::FAST }),
                                            &block),
                         "Couldn't allocate a block for compoound index");
 
@@ -183,8 +200,49 @@ Status DiskRowSetWriter::InitAdHocIndexWriter() {
 
 }
 
+Status DiskRowSetWriter::InitSecondaryIndexWriters() {
+  TRACE_EVENT0("tablet", "DiskRowSetWriter::InitSecondaryIndexWriters");
+  FsManager* fs = rowset_metadata_->fs_manager();
+  const string& tablet_id = rowset_metadata_->tablet_metadata()->tablet_id();
+  for (int i = 0; i < schema_->num_columns(); i++) {
+    const ColumnSchema& col = schema_->column(i);
+    if (!col.attributes().secondary_index) {
+      continue;
+    }
+    if (!SecondaryIndexWriter::CanIndex(col)) {
+      KLOG_FIRST_N(WARNING, 1) << "Values of column " << col.ToString()
+                               << " can't be indexed";
+      continue;
+    }
+    // Like the ad-hoc index, the secondary indexes are read by lookups.
+    unique_ptr<WritableBlock> block;
+    RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(CreateBlockOptions({ tablet_id, StorageTier::FAST }),
+                                             &block),
+                          "Couldn't allocate a block for secondary index");
+    unique_ptr<SecondaryIndexWriter> writer(
+        new SecondaryIndexWriter(col.type_info(), std::move(block)));
+    RETURN_NOT_OK(writer->Start());
+    index_writers_.emplace(i, std::move(writer));
+  }
+  return Status::OK();
+}
+
+Status DiskRowSetWriter::InitRollupWriter() {
+  TRACE_EVENT0("tablet", "DiskRowSetWriter::InitRollupWriter");
+  FsManager* fs = rowset_metadata_->fs_manager();
+  const string& tablet_id = rowset_metadata_->tablet_metadata()->tablet_id();
+  // The rollup is read by aggregate scans in place of the rows.
+  unique_ptr<WritableBlock> block;
+  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(CreateBlockOptions({ tablet_id, StorageTier::FAST }),
+                                           &block),
+                        "Couldn't allocate a block for rollup");
+  rollup_writer_.reset(new RollupWriter(schema_, std::move(block)));
+  return rollup_writer_->Start();
+}
+
 Status DiskRowSetWriter::AppendBlock(const RowBlock &block) {
-  DCHECK_EQ(block.schema().num_columns(), schema_->num_columns());
+  // The keys are encoded out of the first columns of the block.
+  DCHECK_EQ(block.schema().num_key_columns(), schema_->num_key_columns());
   CHECK(!finished_);
 
   // If this is the very first block, encode the first key and save it as metadata
@@ -201,6 +259,24 @@ Status DiskRowSetWriter::AppendBlock(const RowBlock &block) {
   // Write the batch to each of the columns
   RETURN_NOT_OK(col_writer_->AppendBlock(block));
 
+  // Buffer the entries of the secondary indexes. The indexed columns are never
+  // appended with AppendColumnDataBlocks(), so they're in every block.
+  const bool projected = block.schema().num_columns() != schema_->num_columns();
+  for (const auto& e : index_writers_) {
+    int block_idx = e.first;
+    if (projected) {
+      block_idx = block.schema().find_column_by_id(schema_->column_id(e.first));
+      DCHECK_NE(Schema::kColumnNotFound, block_idx);
+    }
+    e.second->AppendCells(block.column_block(block_idx), written_count_);
+  }
+
+  // Fold the rows into the rollup. Like the indexed columns, the rollup
+  // columns are in every block.
+  if (rollup_writer_) {
+    RETURN_NOT_OK(rollup_writer_->AppendBlock(block));
+  }
+
 #ifndef NDEBUG
     faststring prev_key;
 #endif
@@ -235,6 +311,23 @@ Status DiskRowSetWriter::AppendBlock(const RowBlock &block) {
   return Status::OK();
 }
 
+bool DiskRowSetWriter::CanAppendColumnDataBlocks(int col_idx,
+                                                 const CFileReader& reader) const {
+  DCHECK_GE(col_idx, schema_->num_key_columns());
+  // The rows of the indexed and rollup columns must go through AppendBlock().
+  return !ContainsKey(index_writers_, col_idx) &&
+      !(rollup_writer_ && schema_->column(col_idx).attributes().rollup) &&
+      col_writer_->CanAppendDataBlocks(col_idx, reader);
+}
+
+Status DiskRowSetWriter::AppendColumnDataBlocks(int col_idx,
+                                                CFileReader* reader,
+                                                const IOContext* io_context) {
+  DCHECK_GE(col_idx, schema_->num_key_columns());
+  CHECK(!finished_);
+  return col_writer_->AppendDataBlocks(col_idx, reader, io_context);
+}
+
 Status DiskRowSetWriter::Finish() {
   TRACE_EVENT0("tablet", "DiskRowSetWriter::Finish");
   BlockManager* bm = rowset_metadata_->fs_manager()->block_manager();
@@ -282,6 +375,37 @@ Status DiskRowSetWriter::FinishAndReleaseBlocks(BlockCreationTransaction* transa
     }
   }
 
+  // Finish the secondary indexes.
+  std::map<ColumnId, BlockId> index_blocks;
+  for (const auto& e : index_writers_) {
+    Status s = e.second->FinishAndReleaseBlock(transaction);
+    if (!s.ok()) {
+      LOG(WARNING) << "Unable to Finish secondary index writer: " << s.ToString();
+      return s;
+    }
+    index_blocks.emplace(schema_->column_id(e.first), e.second->block_id());
+  }
+  rowset_metadata_->SetSecondaryIndexBlocks(index_blocks);
+
+  // Finish the rollup.
+  if (rollup_writer_) {
+    Status s = rollup_writer_->FinishAndReleaseBlock(transaction);
+    if (!s.ok()) {
+      LOG(WARNING) << "Unable to Finish rollup writer: " << s.ToString();
+      return s;
+    }
+    vector<ColumnId> key_col_ids;
+    for (int col_idx : rollup_writer_->key_col_idxs()) {
+      key_col_ids.push_back(schema_->column_id(col_idx));
+    }
+    vector<ColumnId> col_ids;
+    for (int col_idx : rollup_writer_->col_idxs()) {
+      col_ids.push_back(schema_->column_id(col_idx));
+    }
+    rowset_metadata_->SetRollupBlock(rollup_writer_->block_id(), std::move(key_col_ids),
+                                     std::move(col_ids));
+  }
+
   // Finish bloom.
   Status s = bloom_writer_->FinishAndReleaseBlock(transaction);
   if (!s.ok()) {
@@ -312,6 +436,14 @@ size_t DiskRowSetWriter::written_size() const {
     size += ad_hoc_index_writer_->written_size();
   }
 
+  for (const auto& e : index_writers_) {
+    size += e.second->written_size();
+  }
+
+  if (rollup_writer_) {
+    size += rollup_writer_->written_size();
+  }
+
   return size;
 }
 
@@ -326,8 +458,10 @@ RollingDiskRowSetWriter::RollingDiskRowSetWriter(
       schema_(schema),
       bloom_sizing_(bloom_sizing),
       target_rowset_size_(target_rowset_size),
+      data_tier_(StorageTier::DEFAULT),
       row_idx_in_cur_drs_(0),
       can_roll_(false),
+      rows_pending_append_(0),
       written_count_(0),
       written_size_(0) {
   BlockManager* bm = tablet_metadata->fs_manager()->block_manager();
@@ -351,15 +485,17 @@ Status RollingDiskRowSetWriter::RollWriter() {
 
   RETURN_NOT_OK(tablet_metadata_->CreateRowSet(&cur_drs_metadata_));
 
-  cur_writer_.reset(new DiskRowSetWriter(cur_drs_metadata_.get(), &schema_, bloom_sizing_));
+  cur_writer_.reset(new DiskRowSetWriter(cur_drs_metadata_.get(), &schema_, bloom_sizing_,
+                                         data_tier_));
   RETURN_NOT_OK(cur_writer_->Open());
 
   FsManager* fs = tablet_metadata_->fs_manager();
   unique_ptr<WritableBlock> undo_data_block;
   unique_ptr<WritableBlock> redo_data_block;
-  RETURN_NOT_OK(fs->CreateNewBlock(CreateBlockOptions({ tablet_metadata_->tablet_id() }),
+  const string& tablet_id = tablet_metadata_->tablet_id();
+  RETURN_NOT_OK(fs->CreateNewBlock(CreateBlockOptions({ tablet_id, data_tier_ }),
                                    &undo_data_block));
-  RETURN_NOT_OK(fs->CreateNewBlock(CreateBlockOptions({ tablet_metadata_->tablet_id() }),
+  RETURN_NOT_OK(fs->CreateNewBlock(CreateBlockOptions({ tablet_id, StorageTier::FAST }),
                                    &redo_data_block));
   cur_undo_ds_block_id_ = undo_data_block->id();
   cur_redo_ds_block_id_ = redo_data_block->id();
@@ -390,7 +526,35 @@ Status RollingDiskRowSetWriter::AppendBlock(const RowBlock &block) {
   written_count_ += block.nrows();
 
   row_idx_in_cur_drs_ += block.nrows();
-  can_roll_ = true;
+  if (rows_pending_append_ > 0) {
+    DCHECK_LE(block.nrows(), rows_pending_append_);
+    rows_pending_append_ -= std::min<rowid_t>(block.nrows(), rows_pending_append_);
+  }
+  can_roll_ = rows_pending_append_ == 0;
+  return Status::OK();
+}
+
+bool RollingDiskRowSetWriter::CanAppendColumnDataBlocks(int col_idx,
+                                                        const CFileReader& reader) const {
+  DCHECK_EQ(state_, kStarted);
+  return cur_writer_->CanAppendColumnDataBlocks(col_idx, reader);
+}
+
+Status RollingDiskRowSetWriter::AppendColumnDataBlocks(
+    const vector<pair<int, CFileReader*>>& col_readers,
+    rowid_t num_rows,
+    const IOContext* io_context) {
+  DCHECK_EQ(state_, kStarted);
+  DCHECK_EQ(0, rows_pending_append_);
+  if (col_readers.empty() || num_rows == 0) {
+    return Status::OK();
+  }
+  for (const auto& col_reader : col_readers) {
+    RETURN_NOT_OK(cur_writer_->AppendColumnDataBlocks(col_reader.first, col_reader.second,
+                                                      io_context));
+  }
+  rows_pending_append_ = num_rows;
+  can_roll_ = false;
   return Status::OK();
 }
 
@@ -455,7 +619,8 @@ Status RollingDiskRowSetWriter::FinishCurrentWriter() {
     Status s = cur_undo_writer_->FinishAndReleaseBlock(block_transaction_.get());
     if (!s.IsAborted()) {
       RETURN_NOT_OK(s);
-      cur_drs_metadata_->CommitUndoDeltaDataBlock(cur_undo_ds_block_id_);
+      cur_drs_metadata_->CommitUndoDeltaDataBlock(cur_undo_ds_block_id_,
+                                                  cur_undo_delta_stats->max_timestamp());
     } else {
       DCHECK_EQ(cur_undo_delta_stats->min_timestamp(), Timestamp::kMax);
     }
@@ -487,6 +652,10 @@ Status RollingDiskRowSetWriter::Finish() {
   TRACE_EVENT0("tablet", "RollingDiskRowSetWriter::Finish");
   DCHECK_EQ(state_, kStarted);
 
+  if (PREDICT_FALSE(rows_pending_append_ > 0)) {
+    return Status::IllegalState(Substitute("$0 rows were only appended to some columns",
+                                           rows_pending_append_));
+  }
   RETURN_NOT_OK(FinishCurrentWriter());
   RETURN_NOT_OK(block_transaction_->CommitCreatedBlocks());
 
@@ -669,6 +838,53 @@ Status DiskRowSet::NewRowIterator(const RowIteratorOptions& opts,
   return Status::OK();
 }
 
+Status DiskRowSet::IsRelevantForDiffScan(const RowIteratorOptions& opts,
+                                         bool* relevant) const {
+  DCHECK(open_);
+  DCHECK(opts.snap_to_exclude);
+  shared_lock<rw_spinlock> l(component_lock_);
+  return delta_tracker_->AnyDeltasRelevantForSelect(*opts.snap_to_exclude, opts.snap_to_include,
+                                                    opts.io_context, relevant);
+}
+
+Status DiskRowSet::FoldRollup(const RowIteratorOptions& opts, bool* folded) const {
+  DCHECK(open_);
+  DCHECK(opts.aggregator);
+  *folded = false;
+  if (opts.snap_to_exclude || opts.include_deleted_rows) {
+    return Status::OK();
+  }
+  shared_lock<rw_spinlock> l(component_lock_);
+  if (!base_data_->has_rollup() ||
+      delta_tracker_->CountRedoDeltaStores() > 0 ||
+      !delta_tracker_->DeltaMemStoreEmpty()) {
+    return Status::OK();
+  }
+  vector<string> key_columns;
+  vector<string> columns;
+  Status s = base_data_->GetRollupColumns(&key_columns, &columns);
+  if (s.IsNotFound()) {
+    return Status::OK();
+  }
+  RETURN_NOT_OK(s);
+  if (!opts.aggregator->CanAddGroups(key_columns, columns)) {
+    return Status::OK();
+  }
+  bool undos_committed;
+  RETURN_NOT_OK(delta_tracker_->AllUndoDeltasCommittedIn(opts.snap_to_include, opts.io_context,
+                                                         &undos_committed));
+  if (!undos_committed) {
+    return Status::OK();
+  }
+
+  vector<AggregatedGroup> groups;
+  RETURN_NOT_OK_PREPEND(base_data_->ReadRollup(opts.io_context, &groups),
+                        Substitute("could not read the rollup of $0", ToString()));
+  RETURN_NOT_OK(opts.aggregator->AddGroups(key_columns, columns, groups));
+  *folded = true;
+  return Status::OK();
+}
+
 Status DiskRowSet::NewCompactionInput(const Schema* projection,
                                       const MvccSnapshot &snap,
                                       const IOContext* io_context,
@@ -740,6 +956,36 @@ Status DiskRowSet::CheckRowPresent(const RowSetKeyProbe &probe,
   return Status::OK();
 }
 
+Status DiskRowSet::CheckRowsPresent(const vector<const RowSetKeyProbe*>& probes,
+                                    const vector<ProbeStats*>& stats,
+                                    const IOContext* io_context,
+                                    vector<bool>* present) const {
+  DCHECK(open_);
+#ifndef NDEBUG
+  rowid_t num_rows;
+  RETURN_NOT_OK(CountRows(io_context, &num_rows));
+#endif
+  shared_lock<rw_spinlock> l(component_lock_);
+
+  vector<rowid_t> row_idxs;
+  RETURN_NOT_OK(base_data_->CheckRowsPresent(probes, stats, io_context, present, &row_idxs));
+  for (int i = 0; i < probes.size(); i++) {
+    if (!(*present)[i]) {
+      // If it wasn't in the base data, then it's definitely not in the rowset.
+      continue;
+    }
+#ifndef NDEBUG
+    CHECK_LT(row_idxs[i], num_rows);
+#endif
+
+    // Otherwise it might be in the base data but deleted.
+    bool deleted = false;
+    RETURN_NOT_OK(delta_tracker_->CheckRowDeleted(row_idxs[i], io_context, &deleted, stats[i]));
+    (*present)[i] = !deleted;
+  }
+  return Status::OK();
+}
+
 Status DiskRowSet::CountRows(const IOContext* io_context, rowid_t *count) const {
   DCHECK(open_);
   rowid_t num_rows = num_rows_.load();
@@ -760,12 +1006,22 @@ Status DiskRowSet::GetBounds(std::string* min_encoded_key,
   return base_data_->GetBounds(min_encoded_key, max_encoded_key);
 }
 
+Status DiskRowSet::SampleEncodedKeys(int num_samples,
+                                     const IOContext* io_context,
+                                     vector<string>* keys) const {
+  DCHECK(open_);
+  shared_lock<rw_spinlock> l(component_lock_);
+  return base_data_->SampleEncodedKeys(num_samples, io_context, keys);
+}
+
 void DiskRowSet::GetDiskRowSetSpaceUsage(DiskRowSetSpace* drss) const {
   DCHECK(open_);
   shared_lock<rw_spinlock> l(component_lock_);
   drss->base_data_size = base_data_->OnDiskDataSize();
   drss->bloom_size = base_data_->BloomFileOnDiskSize();
   drss->ad_hoc_index_size = base_data_->AdhocIndexOnDiskSize();
+  drss->secondary_index_size = base_data_->SecondaryIndexOnDiskSize();
+  drss->rollup_size = base_data_->RollupOnDiskSize();
   drss->redo_deltas_size = delta_tracker_->RedoDeltaOnDiskSize();
   drss->undo_deltas_size = delta_tracker_->UndoDeltaOnDiskSize();
 }
@@ -791,6 +1047,14 @@ uint64_t DiskRowSet::OnDiskBaseDataColumnSize(const ColumnId& col_id) const {
   return 0;
 }
 
+Status DiskRowSet::GetBaseDataColumnReader(ColumnId col_id,
+                                           const IOContext* io_context,
+                                           CFileReader** reader) const {
+  DCHECK(open_);
+  shared_lock<rw_spinlock> l(component_lock_);
+  return base_data_->GetColumnReader(col_id, io_context, reader);
+}
+
 uint64_t DiskRowSet::OnDiskBaseDataSizeWithRedos() const {
   DiskRowSetSpace drss;
   GetDiskRowSetSpaceUsage(&drss);
@@ -23,9 +23,11 @@
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <glog/logging.h>
@@ -34,6 +36,7 @@
 #include "kudu/common/rowid.h"
 #include "kudu/common/schema.h"
 #include "kudu/fs/block_id.h"
+#include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
@@ -59,6 +62,7 @@ class Timestamp;
 
 namespace cfile {
 class BloomFileWriter;
+class CFileReader;
 class CFileWriter;
 }
 
@@ -86,12 +90,19 @@ class MultiColumnWriter;
 class Mutation;
 class MvccSnapshot;
 class OperationResultPB;
+class RollupWriter;
+class SecondaryIndexWriter;
 
 class DiskRowSetWriter {
  public:
   // TODO: document ownership of rowset_metadata
+  //
+  // The column data is placed preferably on the storage tier 'data_tier',
+  // while the bloom filter and the ad-hoc index, which are read by every
+  // row lookup, are placed preferably on fast storage.
   DiskRowSetWriter(RowSetMetadata* rowset_metadata, const Schema* schema,
-                   BloomFilterSizing bloom_sizing);
+                   BloomFilterSizing bloom_sizing,
+                   fs::StorageTier data_tier = fs::StorageTier::DEFAULT);
 
   ~DiskRowSetWriter();
 
@@ -100,8 +111,22 @@ class DiskRowSetWriter {
   // The block is written to all column writers as well as the bloom filter,
   // if configured.
   // Rows must be appended in ascending order.
+  //
+  // The block may be projected on the key columns and a subset of the other
+  // columns, the rest of which must be appended with AppendColumnDataBlocks().
   Status AppendBlock(const RowBlock &block);
 
+  // Return true if the data blocks of 'reader' may be appended to the non-key
+  // column of index 'col_idx' with AppendColumnDataBlocks().
+  bool CanAppendColumnDataBlocks(int col_idx, const cfile::CFileReader& reader) const;
+
+  // Append all the data blocks of 'reader' to the non-key column of index
+  // 'col_idx'. The rows of the other columns must be appended with
+  // AppendBlock(), projected without that column.
+  Status AppendColumnDataBlocks(int col_idx,
+                                cfile::CFileReader* reader,
+                                const fs::IOContext* io_context);
+
   // Closes the CFiles and their underlying writable blocks.
   // If no rows were written, returns Status::Aborted().
   Status Finish();
@@ -135,6 +160,13 @@ class DiskRowSetWriter {
   // this index is written to a new file instead of embedded in the col_* files
   Status InitAdHocIndexWriter();
 
+  // Initializes the writers of the secondary indexes of the columns whose
+  // storage attributes ask for one.
+  Status InitSecondaryIndexWriters();
+
+  // Initializes the writer of the rollup, for schemas which have one.
+  Status InitRollupWriter();
+
   // Return the cfile::Writer responsible for writing the key index.
   // (the ad-hoc writer for composite keys, otherwise the key column writer)
   cfile::CFileWriter *key_index_writer();
@@ -143,6 +175,7 @@ class DiskRowSetWriter {
   const Schema* const schema_;
 
   BloomFilterSizing bloom_sizing_;
+  const fs::StorageTier data_tier_;
 
   bool finished_;
   rowid_t written_count_;
@@ -150,6 +183,11 @@ class DiskRowSetWriter {
   gscoped_ptr<cfile::BloomFileWriter> bloom_writer_;
   gscoped_ptr<cfile::CFileWriter> ad_hoc_index_writer_;
 
+  // The writers of the secondary indexes, keyed by column index.
+  std::map<int, std::unique_ptr<SecondaryIndexWriter>> index_writers_;
+
+  std::unique_ptr<RollupWriter> rollup_writer_;
+
   // The last encoded key written.
   faststring last_encoded_key_;
 };
@@ -172,6 +210,14 @@ class RollingDiskRowSetWriter {
 
   Status Open();
 
+  // Sets the storage tier on which the column data and the UNDO deltas of
+  // the rowsets are preferably placed. The REDO deltas are preferably placed
+  // on fast storage. Must be called before Open().
+  void set_data_tier(fs::StorageTier tier) {
+    DCHECK_EQ(kInitialized, state_);
+    data_tier_ = tier;
+  }
+
   // The block is written to all column writers as well as the bloom filter,
   // if configured.
   // Rows must be appended in ascending order.
@@ -182,6 +228,19 @@ class RollingDiskRowSetWriter {
   // and data files are aligned.
   Status AppendBlock(const RowBlock &block);
 
+  // Return true if the data blocks of 'reader' may be appended to the non-key
+  // column of index 'col_idx' of the current output rowset.
+  bool CanAppendColumnDataBlocks(int col_idx, const cfile::CFileReader& reader) const;
+
+  // Append all the data blocks of the given readers, each holding 'num_rows'
+  // rows, to the non-key columns of the given indexes. The same rows must
+  // then be appended with AppendBlock(), projected without those columns,
+  // and the output doesn't roll until they all are.
+  Status AppendColumnDataBlocks(
+      const std::vector<std::pair<int, cfile::CFileReader*>>& col_readers,
+      rowid_t num_rows,
+      const fs::IOContext* io_context);
+
   // Appends a sequence of REDO deltas for the same row to the current
   // redo delta file. 'row_idx_in_next_block' is the positional index after
   // the last written block. The 'row_idx_in_drs' out parameter will be set
@@ -245,6 +304,7 @@ class RollingDiskRowSetWriter {
   std::shared_ptr<RowSetMetadata> cur_drs_metadata_;
   const BloomFilterSizing bloom_sizing_;
   const size_t target_rowset_size_;
+  fs::StorageTier data_tier_;
 
   gscoped_ptr<DiskRowSetWriter> cur_writer_;
 
@@ -263,6 +323,10 @@ class RollingDiskRowSetWriter {
   // and data writers are aligned (i.e. just after we've appended a new block of data).
   bool can_roll_;
 
+  // The number of rows whose data blocks were appended to some columns by
+  // AppendColumnDataBlocks(), but which weren't yet appended to the others.
+  rowid_t rows_pending_append_;
+
   // RowSetMetadata objects for diskrowsets which have been successfully
   // written out.
   RowSetMetadataVector written_drs_metas_;
@@ -290,12 +354,15 @@ struct DiskRowSetSpace {
   uint64_t base_data_size;
   uint64_t bloom_size;
   uint64_t ad_hoc_index_size;
+  uint64_t secondary_index_size;
+  uint64_t rollup_size;
   uint64_t redo_deltas_size;
   uint64_t undo_deltas_size;
 
   // Helper method to compute the size of the diskrowset's underlying cfile set.
   uint64_t CFileSetOnDiskSize() {
-    return base_data_size + bloom_size + ad_hoc_index_size;
+    return base_data_size + bloom_size + ad_hoc_index_size + secondary_index_size +
+        rollup_size;
   }
 };
 
@@ -352,6 +419,11 @@ class DiskRowSet : public RowSet {
   Status CheckRowPresent(const RowSetKeyProbe &probe, const fs::IOContext* io_context,
                          bool *present, ProbeStats* stats) const override;
 
+  Status CheckRowsPresent(const std::vector<const RowSetKeyProbe*>& probes,
+                          const std::vector<ProbeStats*>& stats,
+                          const fs::IOContext* io_context,
+                          std::vector<bool>* present) const override;
+
   ////////////////////
   // Read functions.
   ////////////////////
@@ -363,6 +435,18 @@ class DiskRowSet : public RowSet {
                                     const fs::IOContext* io_context,
                                     gscoped_ptr<CompactionInput>* out) const override;
 
+  // See RowSet::FoldRollup(). The rollup is exact if the rows visible in
+  // 'opts.snap_to_include' are the base data: there must be no REDO deltas
+  // and the UNDO deltas, including those of the insertions of the rows, must
+  // all be committed in the snapshot.
+  Status FoldRollup(const RowIteratorOptions& opts, bool* folded) const override;
+
+  // See RowSet::IsRelevantForDiffScan(). The insertions of the rows are
+  // UNDO deltas, and their later mutations are REDO deltas, so no row
+  // changed between the snapshots if none of the delta stores has deltas
+  // committed in between.
+  Status IsRelevantForDiffScan(const RowIteratorOptions& opts, bool* relevant) const override;
+
   // Gets the number of rows in this rowset, checking 'num_rows_' first. If not
   // yet set, consults the base data and stores the result in 'num_rows_'.
   Status CountRows(const fs::IOContext* io_context, rowid_t *count) const final override;
@@ -371,6 +455,11 @@ class DiskRowSet : public RowSet {
   virtual Status GetBounds(std::string* min_encoded_key,
                            std::string* max_encoded_key) const override;
 
+  // See RowSet::SampleEncodedKeys(...)
+  Status SampleEncodedKeys(int num_samples,
+                           const fs::IOContext* io_context,
+                           std::vector<std::string>* keys) const override;
+
   void GetDiskRowSetSpaceUsage(DiskRowSetSpace* drss) const;
 
   uint64_t OnDiskSize() const override;
@@ -379,6 +468,13 @@ class DiskRowSet : public RowSet {
 
   uint64_t OnDiskBaseDataColumnSize(const ColumnId& col_id) const override;
 
+  // Sets '*reader' to the reader of the base data of the given column ID, or
+  // to nullptr if the base data has no such column. The reader remains valid
+  // as long as the base data isn't replaced by a major delta compaction.
+  Status GetBaseDataColumnReader(ColumnId col_id,
+                                 const fs::IOContext* io_context,
+                                 cfile::CFileReader** reader) const;
+
   uint64_t OnDiskBaseDataSizeWithRedos() const override;
 
   size_t DeltaMemStoreSize() const override;
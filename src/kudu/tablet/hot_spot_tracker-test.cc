@@ -0,0 +1,169 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/hot_spot_tracker.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags_declare.h>
+#include <gtest/gtest.h>
+
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/iterator.h"
+#include "kudu/common/partial_row.h"
+#include "kudu/common/scan_spec.h"
+#include "kudu/common/schema.h"
+#include "kudu/tablet/local_tablet_writer.h"
+#include "kudu/tablet/tablet-test-util.h"
+#include "kudu/tablet/tablet.h"
+#include "kudu/util/auto_release_pool.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/test_macros.h"
+
+DECLARE_int32(hot_keys_sample_interval);
+DECLARE_int32(hot_spots_window_sec);
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace kudu {
+namespace tablet {
+
+class HotSpotTrackerTest : public KuduTabletTest {
+ public:
+  HotSpotTrackerTest()
+      : KuduTabletTest(Schema({ ColumnSchema("key", INT32),
+                                ColumnSchema("val", INT32) },
+                              1)) {
+    // Sample every operation, so that the counts are exact.
+    FLAGS_hot_keys_sample_interval = 1;
+  }
+};
+
+TEST_F(HotSpotTrackerTest, TestHotKeys) {
+  HotSpotTracker tracker;
+  for (int i = 0; i < 3; i++) {
+    tracker.RecordKey(HotSpotTracker::WRITE, "a");
+  }
+  tracker.RecordKey(HotSpotTracker::WRITE, "b");
+  tracker.RecordKey(HotSpotTracker::READ, "c");
+
+  HotSpotTracker::Load load;
+  tracker.GetLoad(HotSpotTracker::WRITE, 1, &load);
+  ASSERT_EQ(4, load.total_key_count);
+  ASSERT_EQ(1, load.hot_keys.size());
+  ASSERT_EQ("a", load.hot_keys[0].item);
+  ASSERT_EQ(3, load.hot_keys[0].count);
+
+  tracker.GetLoad(HotSpotTracker::READ, 10, &load);
+  ASSERT_EQ(1, load.total_key_count);
+  ASSERT_EQ(1, load.hot_keys.size());
+  ASSERT_EQ("c", load.hot_keys[0].item);
+
+  // No key is sampled once the sampling is disabled.
+  FLAGS_hot_keys_sample_interval = 0;
+  tracker.RecordKey(HotSpotTracker::READ, "c");
+  tracker.GetLoad(HotSpotTracker::READ, 10, &load);
+  ASSERT_EQ(1, load.total_key_count);
+}
+
+TEST_F(HotSpotTrackerTest, TestWindows) {
+  FLAGS_hot_spots_window_sec = 1;
+  HotSpotTracker tracker;
+  tracker.RecordRows(HotSpotTracker::WRITE, 1000);
+  tracker.RecordKey(HotSpotTracker::WRITE, "a");
+  tracker.RecordKey(HotSpotTracker::WRITE, "a");
+
+  // Until the first window is over, the rates are over the current one.
+  HotSpotTracker::Load load;
+  tracker.GetLoad(HotSpotTracker::WRITE, 10, &load);
+  ASSERT_GT(load.rows_per_sec, 1000);
+  tracker.GetLoad(HotSpotTracker::READ, 10, &load);
+  ASSERT_EQ(0, load.rows_per_sec);
+
+  // Once it's over, the rates are over the last complete window, and the
+  // counts of the keys are halved.
+  SleepFor(MonoDelta::FromMilliseconds(1100));
+  for (int i = 0; i < 2; i++) {
+    tracker.GetLoad(HotSpotTracker::WRITE, 10, &load);
+    ASSERT_GT(load.rows_per_sec, 500);
+    ASSERT_LT(load.rows_per_sec, 1000);
+    ASSERT_EQ(1, load.total_key_count);
+    ASSERT_EQ(1, load.hot_keys.size());
+    ASSERT_EQ(1, load.hot_keys[0].count);
+    // The rows of the current window don't count yet.
+    tracker.RecordRows(HotSpotTracker::WRITE, 1000000);
+  }
+}
+
+// Verify that the writes and the point lookups of a tablet are tracked.
+TEST_F(HotSpotTrackerTest, TestTabletLoad) {
+  // The keys are decoded to be compared.
+  ScopedDisableRedaction no_redaction;
+  LocalTabletWriter writer(tablet().get(), &client_schema_);
+  KuduPartialRow row(&client_schema_);
+  for (int32_t i = 0; i < 10; i++) {
+    ASSERT_OK(row.SetInt32(0, i));
+    ASSERT_OK(row.SetInt32(1, i));
+    ASSERT_OK(writer.Insert(row));
+  }
+  for (int32_t i = 0; i < 10; i++) {
+    ASSERT_OK(row.SetInt32(0, 5));
+    ASSERT_OK(row.SetInt32(1, i));
+    ASSERT_OK(writer.Update(row));
+  }
+
+  HotSpotTracker::Load load;
+  tablet()->hot_spots()->GetLoad(HotSpotTracker::WRITE, 1, &load);
+  ASSERT_EQ(20, load.total_key_count);
+  ASSERT_EQ(1, load.hot_keys.size());
+  ASSERT_EQ("(int32 key=5)",
+            schema_.DebugEncodedRowKey(load.hot_keys[0].item, Schema::START_KEY));
+  ASSERT_EQ(11, load.hot_keys[0].count);
+
+  for (int i = 0; i < 3; i++) {
+    Arena arena(1024);
+    AutoReleasePool pool;
+    ScanSpec spec;
+    const int32_t key = 7;
+    spec.AddPredicate(ColumnPredicate::Equality(schema_.column(0), &key));
+    spec.OptimizeScan(schema_, &arena, &pool, true);
+    unique_ptr<RowwiseIterator> iter;
+    ASSERT_OK(tablet()->NewRowIterator(client_schema_, &iter));
+    ASSERT_OK(iter->Init(&spec));
+    vector<string> rows;
+    ASSERT_OK(IterateToStringList(iter.get(), &rows));
+    ASSERT_EQ(1, rows.size());
+  }
+  tablet()->hot_spots()->GetLoad(HotSpotTracker::READ, 1, &load);
+  ASSERT_EQ(3, load.total_key_count);
+  ASSERT_EQ(1, load.hot_keys.size());
+  ASSERT_EQ("(int32 key=7)",
+            schema_.DebugEncodedRowKey(load.hot_keys[0].item, Schema::START_KEY));
+  ASSERT_GT(load.rows_per_sec, 0);
+}
+
+} // namespace tablet
+} // namespace kudu
@@ -0,0 +1,114 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/hot_spot_tracker.h"
+
+#include <mutex>
+
+#include <gflags/gflags.h>
+
+#include "kudu/util/flag_tags.h"
+
+DEFINE_int32(hot_keys_sample_interval, 64,
+             "One in this many row operations of each thread has its primary "
+             "key sampled to find the keys written and read the most in each "
+             "tablet. 0 disables the sampling.");
+TAG_FLAG(hot_keys_sample_interval, advanced);
+TAG_FLAG(hot_keys_sample_interval, runtime);
+DEFINE_validator(hot_keys_sample_interval,
+                 [](const char* /*flagname*/, int32_t value) { return value >= 0; });
+
+DEFINE_int32(hot_keys_per_tablet, 16,
+             "The number of written keys, and of read keys, counted in each "
+             "tablet to find its hot keys.");
+TAG_FLAG(hot_keys_per_tablet, advanced);
+DEFINE_validator(hot_keys_per_tablet,
+                 [](const char* /*flagname*/, int32_t value) { return value > 0; });
+
+DEFINE_int32(hot_spots_window_sec, 60,
+             "The length of the windows over which the rates of the rows "
+             "written to and read from each tablet are computed, in seconds. "
+             "The counts of the hot keys of the tablets are halved at the end "
+             "of each window.");
+TAG_FLAG(hot_spots_window_sec, advanced);
+TAG_FLAG(hot_spots_window_sec, runtime);
+DEFINE_validator(hot_spots_window_sec,
+                 [](const char* /*flagname*/, int32_t value) { return value > 0; });
+
+namespace kudu {
+namespace tablet {
+
+namespace {
+
+// The number of row operations of the current thread until the next sample.
+__thread int32_t tls_rows_until_sample = 0;
+
+} // anonymous namespace
+
+HotSpotTracker::HotSpotTracker()
+    : window_start_(MonoTime::Now()),
+      has_last_window_(false),
+      last_window_rows_per_sec_{ 0, 0 },
+      written_keys_(FLAGS_hot_keys_per_tablet),
+      read_keys_(FLAGS_hot_keys_per_tablet) {
+  rows_[WRITE] = 0;
+  rows_[READ] = 0;
+}
+
+void HotSpotTracker::RecordKey(OpType type, const Slice& encoded_key) {
+  const int32_t interval = FLAGS_hot_keys_sample_interval;
+  if (interval <= 0 || --tls_rows_until_sample > 0) {
+    return;
+  }
+  tls_rows_until_sample = interval;
+
+  // Each sample stands for 'interval' rows.
+  const MonoTime now = MonoTime::Now();
+  std::lock_guard<simple_spinlock> l(lock_);
+  MaybeRotateUnlocked(now);
+  keys(type)->Add(encoded_key, interval);
+}
+
+void HotSpotTracker::GetLoad(OpType type, int max_keys, Load* load) {
+  const MonoTime now = MonoTime::Now();
+  std::lock_guard<simple_spinlock> l(lock_);
+  MaybeRotateUnlocked(now);
+  if (has_last_window_) {
+    load->rows_per_sec = last_window_rows_per_sec_[type];
+  } else {
+    const double elapsed_sec = (now - window_start_).ToSeconds();
+    load->rows_per_sec = elapsed_sec > 0 ? rows_[type].load() / elapsed_sec : 0;
+  }
+  load->total_key_count = keys(type)->total();
+  load->hot_keys = keys(type)->TopK(max_keys);
+}
+
+void HotSpotTracker::MaybeRotateUnlocked(const MonoTime& now) {
+  const MonoDelta elapsed = now - window_start_;
+  if (elapsed < MonoDelta::FromSeconds(FLAGS_hot_spots_window_sec)) {
+    return;
+  }
+  for (OpType type : { WRITE, READ }) {
+    last_window_rows_per_sec_[type] = rows_[type].exchange(0) / elapsed.ToSeconds();
+    keys(type)->Decay();
+  }
+  window_start_ = now;
+  has_last_window_ = true;
+}
+
+} // namespace tablet
+} // namespace kudu
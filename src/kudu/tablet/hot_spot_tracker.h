@@ -0,0 +1,97 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/heavy_hitters.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/slice.h"
+
+namespace kudu {
+namespace tablet {
+
+// Tracks the recent load of a tablet: the rates of the rows written to it
+// and read from it, and the primary keys written and read the most.
+//
+// The rates are computed over windows of --hot_spots_window_sec seconds. The
+// keys are sampled, one in --hot_keys_sample_interval row operations of each
+// thread, and the counts of the keys are halved at the end of each window so
+// that the hot keys reflect the recent load.
+//
+// This class is thread-safe.
+class HotSpotTracker {
+ public:
+  enum OpType {
+    WRITE = 0,
+    READ = 1,
+  };
+
+  // The recent load of one type of operation.
+  struct Load {
+    // The rate of the rows over the last complete window, or over the
+    // current one if none was completed yet.
+    double rows_per_sec;
+    // The estimated number of rows of the sampled operations, decayed, which
+    // the counts of 'hot_keys' are a share of.
+    int64_t total_key_count;
+    // The encoded primary keys operated on the most, from the hottest one.
+    std::vector<HeavyHitters::Entry> hot_keys;
+  };
+
+  HotSpotTracker();
+
+  // Records operations on 'num_rows' rows.
+  void RecordRows(OpType type, int64_t num_rows) {
+    rows_[type].fetch_add(num_rows, std::memory_order_relaxed);
+  }
+
+  // Records an operation on the row with the given encoded primary key,
+  // which is only counted if it's sampled.
+  void RecordKey(OpType type, const Slice& encoded_key);
+
+  // Returns the recent load of 'type', with at most 'max_keys' hot keys.
+  void GetLoad(OpType type, int max_keys, Load* load);
+
+ private:
+  // Starts a new window if the current one is over.
+  void MaybeRotateUnlocked(const MonoTime& now);
+
+  HeavyHitters* keys(OpType type) {
+    return type == WRITE ? &written_keys_ : &read_keys_;
+  }
+
+  // The number of rows since the start of the current window.
+  std::atomic<int64_t> rows_[2];
+
+  // Protects the members below.
+  simple_spinlock lock_;
+  MonoTime window_start_;
+  bool has_last_window_;
+  double last_window_rows_per_sec_[2];
+  HeavyHitters written_keys_;
+  HeavyHitters read_keys_;
+
+  DISALLOW_COPY_AND_ASSIGN(HotSpotTracker);
+};
+
+} // namespace tablet
+} // namespace kudu
@@ -21,6 +21,7 @@
 #include <mutex>
 #include <ostream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <gflags/gflags.h>
@@ -35,6 +36,7 @@
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
+#include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 #include "kudu/util/thread.h"
 
@@ -117,6 +119,87 @@ TEST_F(LockManagerTest, TestMoveLock) {
   ASSERT_FALSE(row_lock.acquired()); // NOLINT(bugprone-use-after-move)
 }
 
+// Test locking and unlocking many rows at once, including the same row
+// several times.
+TEST_F(LockManagerTest, TestBatchedLockUnlock) {
+  const int kNumKeys = 1000;
+  vector<string> key_strings;
+  for (int i = 0; i < kNumKeys; i++) {
+    key_strings.emplace_back(StringPrintf("key%04d", i));
+  }
+  vector<Slice> keys(key_strings.begin(), key_strings.end());
+  keys.emplace_back(key_strings[0]);
+
+  for (int iter = 0; iter < 3; iter++) {
+    vector<ScopedRowLock> locks;
+    lock_manager_.AcquireLocks(kFakeTransaction, keys, LockManager::LOCK_EXCLUSIVE, &locks);
+    ASSERT_EQ(keys.size(), locks.size());
+    for (int i = 0; i < keys.size(); i++) {
+      ASSERT_TRUE(locks[i].acquired());
+      NO_FATALS(VerifyAlreadyLocked(keys[i]));
+    }
+
+    // Release the first lock and half of the others in a batch, and the rest
+    // individually.
+    const auto released = [](int i) { return i == 0 || i % 2 != 0; };
+    vector<ScopedRowLock*> to_release;
+    for (int i = 0; i < locks.size(); i++) {
+      if (released(i)) {
+        to_release.push_back(&locks[i]);
+      }
+    }
+    LockManager::ReleaseLocks(to_release);
+    for (int i = 0; i < locks.size(); i++) {
+      ASSERT_EQ(!released(i), locks[i].acquired());
+    }
+    // The first key is still locked, through its second lock.
+    NO_FATALS(VerifyAlreadyLocked(keys[0]));
+    ScopedRowLock l(&lock_manager_, kFakeTransaction, keys[1], LockManager::LOCK_EXCLUSIVE);
+    ASSERT_TRUE(l.acquired());
+  }
+}
+
+// Test threads locking overlapping batches of rows.
+TEST_F(LockManagerTest, TestBatchedContention) {
+  const int kNumKeys = 100;
+  vector<string> key_strings;
+  for (int i = 0; i < kNumKeys; i++) {
+    key_strings.emplace_back(StringPrintf("key%03d", i));
+  }
+  vector<int> counters(kNumKeys);
+  vector<std::thread> threads;
+  for (int t = 0; t < FLAGS_num_test_threads; t++) {
+    threads.emplace_back([&, t]() {
+      // Each thread is its own transaction.
+      const TransactionState* tx = reinterpret_cast<const TransactionState*>(t + 1);
+      vector<Slice> keys;
+      for (int i = t % 2; i < kNumKeys; i += 2) {
+        keys.emplace_back(key_strings[i]);
+      }
+      for (int i = 0; i < FLAGS_num_iterations / 10; i++) {
+        vector<ScopedRowLock> locks;
+        lock_manager_.AcquireLocks(tx, keys, LockManager::LOCK_EXCLUSIVE, &locks);
+        for (int k = t % 2; k < kNumKeys; k += 2) {
+          counters[k]++;
+        }
+        vector<ScopedRowLock*> to_release;
+        for (auto& lock : locks) {
+          to_release.push_back(&lock);
+        }
+        LockManager::ReleaseLocks(to_release);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  const int kNumThreadsPerKey[] = { (FLAGS_num_test_threads + 1) / 2,
+                                    FLAGS_num_test_threads / 2 };
+  for (int k = 0; k < kNumKeys; k++) {
+    ASSERT_EQ(kNumThreadsPerKey[k % 2] * (FLAGS_num_iterations / 10), counters[k]);
+  }
+}
+
 class LmTestResource {
  public:
   explicit LmTestResource(const Slice* id)
@@ -21,6 +21,7 @@
 #include <mutex>
 #include <ostream>
 #include <string>
+#include <vector>
 
 #include <glog/logging.h>
 
@@ -38,6 +39,7 @@
 #include "kudu/util/trace.h"
 
 using base::subtle::NoBarrier_Load;
+using std::vector;
 
 namespace kudu {
 namespace tablet {
@@ -100,142 +102,271 @@ class LockEntry {
   const TransactionState* holder_;
 };
 
+// A hash table of lock entries, split into shards by key hash.
+//
+// Each shard has its own buckets and is resized on its own, so that entries
+// are looked up without any lock shared by the whole table, and a resize only
+// stalls the lookups of the keys of its shard.
 class LockTable {
- private:
-  struct Bucket {
-    simple_spinlock lock;
-    // First entry chained from this bucket, or NULL if the bucket is empty.
-    LockEntry *chain_head;
-    Bucket() : chain_head(nullptr) {}
-  };
-
  public:
-  LockTable() : mask_(0), size_(0), item_count_(0) {
-    Resize();
-  }
+  LockTable() {}
 
-  ~LockTable() {
-    // Sanity checks: The table shouldn't be destructed when there are any entries in it.
-    DCHECK_EQ(0, NoBarrier_Load(&(item_count_))) << "There are some unreleased locks";
-    for (size_t i = 0; i < size_; ++i) {
-      for (LockEntry *p = buckets_[i].chain_head; p != nullptr; p = p->ht_next_) {
-        DCHECK(p == nullptr) << "The entry " << p->ToString() << " was not released";
-      }
-    }
-  }
+  ~LockTable() {}
 
   LockEntry *GetLockEntry(const Slice &key);
   void ReleaseLockEntry(LockEntry *entry);
 
- private:
-  Bucket *FindBucket(uint64_t hash) const {
-    return &(buckets_[hash & mask_]);
-  }
+  // Like GetLockEntry() on each of 'keys', setting the corresponding elements
+  // of 'entries', but locking each shard once for the whole batch.
+  void GetLockEntries(const vector<Slice>& keys, vector<LockEntry*>* entries);
 
-  // Return a pointer to slot that points to a lock entry that
-  // matches key/hash. If there is no such lock entry, return a
-  // pointer to the trailing slot in the corresponding linked list.
-  LockEntry **FindSlot(Bucket *bucket, const Slice& key, uint64_t hash) const {
-    LockEntry **node = &(bucket->chain_head);
-    while (*node && !(*node)->Equals(key, hash)) {
-      node = &((*node)->ht_next_);
+  // Like ReleaseLockEntry() on each of 'entries', but locking each shard once
+  // for the whole batch.
+  void ReleaseLockEntries(const vector<LockEntry*>& entries);
+
+ private:
+  class Shard {
+   private:
+    struct Bucket {
+      simple_spinlock lock;
+      // First entry chained from this bucket, or NULL if the bucket is empty.
+      LockEntry *chain_head;
+      Bucket() : chain_head(nullptr) {}
+    };
+
+   public:
+    Shard() : mask_(0), size_(0), item_count_(0) {
+      Resize();
     }
-    return node;
-  }
 
-  // Return a pointer to slot that points to a lock entry that
-  // matches the specified 'entry'.
-  // If there is no such lock entry, NULL is returned.
-  LockEntry **FindEntry(Bucket *bucket, LockEntry *entry) const {
-    for (LockEntry **node = &(bucket->chain_head); *node != nullptr; node = &((*node)->ht_next_)) {
-      if (*node == entry) {
-        return node;
+    ~Shard() {
+      // Sanity checks: The table shouldn't be destructed when there are any entries in it.
+      DCHECK_EQ(0, NoBarrier_Load(&(item_count_))) << "There are some unreleased locks";
+      for (size_t i = 0; i < size_; ++i) {
+        for (LockEntry *p = buckets_[i].chain_head; p != nullptr; p = p->ht_next_) {
+          DCHECK(p == nullptr) << "The entry " << p->ToString() << " was not released";
+        }
       }
     }
-    return nullptr;
-  }
-
-  void Resize();
-
- private:
-  // table rwlock used as write on resize
-  percpu_rwlock lock_;
-  // size - 1 used to lookup the bucket (hash & mask_)
-  uint64_t mask_;
-  // number of buckets in the table
-  uint64_t size_;
-  // table buckets
-  gscoped_array<Bucket> buckets_;
-  // number of items in the table
-  base::subtle::Atomic64 item_count_;
-};
 
-LockEntry *LockTable::GetLockEntry(const Slice& key) {
-  auto new_entry = new LockEntry(key);
-  LockEntry *old_entry;
+    // Protects the bucket array: held in shared mode to look up and modify
+    // the chains of the buckets, and exclusively to resize.
+    rw_spinlock& lock() { return lock_; }
 
-  {
-    shared_lock<rw_spinlock> l(lock_.get_lock());
-    Bucket *bucket = FindBucket(new_entry->key_hash_);
-    {
+    // Returns the entry matching 'new_entry', taking a reference to it, or
+    // inserts 'new_entry' if there is none and returns it.
+    //
+    // Must be called with lock() held in shared mode.
+    LockEntry* InsertUnlocked(LockEntry* new_entry) {
+      Bucket *bucket = FindBucket(new_entry->key_hash_);
       std::lock_guard<simple_spinlock> bucket_lock(bucket->lock);
       LockEntry **node = FindSlot(bucket, new_entry->key_, new_entry->key_hash_);
-      old_entry = *node;
+      LockEntry* old_entry = *node;
       if (old_entry != nullptr) {
         old_entry->refs_++;
-      } else {
-        new_entry->ht_next_ = nullptr;
-        new_entry->CopyKey();
-        *node = new_entry;
+        return old_entry;
       }
+      new_entry->ht_next_ = nullptr;
+      new_entry->CopyKey();
+      *node = new_entry;
+      return new_entry;
     }
-  }
 
-  if (old_entry != nullptr) {
-    delete new_entry;
-    return old_entry;
-  }
+    // Drops a reference to 'entry'. Returns true if that was the last one, in
+    // which case the entry was removed from the shard and must be deleted.
+    //
+    // Must be called with lock() held in shared mode.
+    bool RemoveUnlocked(LockEntry* entry) {
+      Bucket *bucket = FindBucket(entry->key_hash_);
+      std::lock_guard<simple_spinlock> bucket_lock(bucket->lock);
+      LockEntry **node = FindEntry(bucket, entry);
+      if (PREDICT_FALSE(node == nullptr)) {
+        LOG(DFATAL) << "Unable to find LockEntry on release";
+        return false;
+      }
+      // ASSUMPTION: There are few updates, so locking the same row at the same time is rare
+      // TODO: Move out this if we're going with the TryLock
+      if (--entry->refs_ > 0) {
+        return false;
+      }
+      *node = entry->ht_next_;
+      return true;
+    }
 
-  if (base::subtle::NoBarrier_AtomicIncrement(&item_count_, 1) > size_) {
-    std::unique_lock<percpu_rwlock> table_wrlock(lock_, std::try_to_lock);
-    // if we can't take the lock, means that someone else is resizing.
-    // (The percpu_rwlock try_lock waits for readers to complete)
-    if (table_wrlock.owns_lock()) {
-      Resize();
+    // Accounts for 'num_inserted' entries having been inserted, resizing the
+    // shard if needed.
+    //
+    // Must be called without holding lock().
+    void AddItems(int64_t num_inserted) {
+      if (base::subtle::NoBarrier_AtomicIncrement(&item_count_, num_inserted) > size_) {
+        std::unique_lock<rw_spinlock> shard_wrlock(lock_, std::try_to_lock);
+        // if we can't take the lock, means that someone else is resizing.
+        // (The rw_spinlock try_lock waits for readers to complete)
+        if (shard_wrlock.owns_lock()) {
+          Resize();
+        }
+      }
+    }
+
+    void RemoveItems(int64_t num_removed) {
+      base::subtle::NoBarrier_AtomicIncrement(&item_count_, -num_removed);
+    }
+
+   private:
+    Bucket *FindBucket(uint64_t hash) const {
+      return &(buckets_[hash & mask_]);
+    }
+
+    // Return a pointer to slot that points to a lock entry that
+    // matches key/hash. If there is no such lock entry, return a
+    // pointer to the trailing slot in the corresponding linked list.
+    LockEntry **FindSlot(Bucket *bucket, const Slice& key, uint64_t hash) const {
+      LockEntry **node = &(bucket->chain_head);
+      while (*node && !(*node)->Equals(key, hash)) {
+        node = &((*node)->ht_next_);
+      }
+      return node;
     }
+
+    // Return a pointer to slot that points to a lock entry that
+    // matches the specified 'entry'.
+    // If there is no such lock entry, NULL is returned.
+    LockEntry **FindEntry(Bucket *bucket, LockEntry *entry) const {
+      for (LockEntry **node = &(bucket->chain_head); *node != nullptr;
+           node = &((*node)->ht_next_)) {
+        if (*node == entry) {
+          return node;
+        }
+      }
+      return nullptr;
+    }
+
+    void Resize();
+
+    // shard rwlock used as write on resize
+    rw_spinlock lock_;
+    // size - 1 used to lookup the bucket (hash & mask_)
+    uint64_t mask_;
+    // number of buckets in the shard
+    uint64_t size_;
+    // shard buckets
+    gscoped_array<Bucket> buckets_;
+    // number of items in the shard
+    base::subtle::Atomic64 item_count_;
+
+    DISALLOW_COPY_AND_ASSIGN(Shard);
+  };
+
+  // The shard of a key is given by the high bits of its hash, while its bucket
+  // within the shard is given by the low bits.
+  static constexpr int kNumShardsLog2 = 4;
+  static constexpr int kNumShards = 1 << kNumShardsLog2;
+
+  static int ShardIndex(uint64_t hash) {
+    return hash >> (64 - kNumShardsLog2);
   }
 
+  Shard shards_[kNumShards];
+
+  DISALLOW_COPY_AND_ASSIGN(LockTable);
+};
+
+LockEntry *LockTable::GetLockEntry(const Slice& key) {
+  auto new_entry = new LockEntry(key);
+  Shard* shard = &shards_[ShardIndex(new_entry->key_hash_)];
+  LockEntry *entry;
+  {
+    shared_lock<rw_spinlock> l(shard->lock());
+    entry = shard->InsertUnlocked(new_entry);
+  }
+
+  if (entry != new_entry) {
+    delete new_entry;
+    return entry;
+  }
+  shard->AddItems(1);
   return new_entry;
 }
 
 void LockTable::ReleaseLockEntry(LockEntry *entry) {
-  bool removed = false;
+  Shard* shard = &shards_[ShardIndex(entry->key_hash_)];
+  bool removed;
   {
-    std::lock_guard<rw_spinlock> table_rdlock(lock_.get_lock());
-    Bucket *bucket = FindBucket(entry->key_hash_);
+    shared_lock<rw_spinlock> l(shard->lock());
+    removed = shard->RemoveUnlocked(entry);
+  }
+  if (removed) {
+    shard->RemoveItems(1);
+    delete entry;
+  }
+}
+
+void LockTable::GetLockEntries(const vector<Slice>& keys, vector<LockEntry*>* entries) {
+  // Create the entries, grouping them by shard.
+  vector<LockEntry*> new_entries(keys.size());
+  vector<vector<int>> indexes_by_shard(kNumShards);
+  for (int i = 0; i < keys.size(); i++) {
+    new_entries[i] = new LockEntry(keys[i]);
+    indexes_by_shard[ShardIndex(new_entries[i]->key_hash_)].push_back(i);
+  }
+
+  entries->resize(keys.size());
+  for (int s = 0; s < kNumShards; s++) {
+    const vector<int>& indexes = indexes_by_shard[s];
+    if (indexes.empty()) {
+      continue;
+    }
+    Shard* shard = &shards_[s];
+    int64_t num_inserted = 0;
     {
-      std::lock_guard<simple_spinlock> bucket_lock(bucket->lock);
-      LockEntry **node = FindEntry(bucket, entry);
-      if (node != nullptr) {
-        // ASSUMPTION: There are few updates, so locking the same row at the same time is rare
-        // TODO: Move out this if we're going with the TryLock
-        if (--entry->refs_ > 0)
-          return;
-
-        *node = entry->ht_next_;
-        removed = true;
+      shared_lock<rw_spinlock> l(shard->lock());
+      for (int i : indexes) {
+        LockEntry* entry = shard->InsertUnlocked(new_entries[i]);
+        if (entry == new_entries[i]) {
+          num_inserted++;
+        } else {
+          delete new_entries[i];
+        }
+        (*entries)[i] = entry;
       }
     }
+    if (num_inserted > 0) {
+      shard->AddItems(num_inserted);
+    }
   }
+}
 
-  DCHECK(removed) << "Unable to find LockEntry on release";
-  base::subtle::NoBarrier_AtomicIncrement(&item_count_, -1);
-  delete entry;
+void LockTable::ReleaseLockEntries(const vector<LockEntry*>& entries) {
+  vector<vector<LockEntry*>> entries_by_shard(kNumShards);
+  for (LockEntry* entry : entries) {
+    entries_by_shard[ShardIndex(entry->key_hash_)].push_back(entry);
+  }
+
+  vector<LockEntry*> removed;
+  for (int s = 0; s < kNumShards; s++) {
+    if (entries_by_shard[s].empty()) {
+      continue;
+    }
+    Shard* shard = &shards_[s];
+    removed.clear();
+    {
+      shared_lock<rw_spinlock> l(shard->lock());
+      for (LockEntry* entry : entries_by_shard[s]) {
+        if (shard->RemoveUnlocked(entry)) {
+          removed.push_back(entry);
+        }
+      }
+    }
+    shard->RemoveItems(removed.size());
+    for (LockEntry* entry : removed) {
+      delete entry;
+    }
+  }
 }
 
-void LockTable::Resize() {
+void LockTable::Shard::Resize() {
   // Calculate a new table size
-  size_t new_size = 16;
+  size_t new_size = 8;
   while (new_size < base::subtle::NoBarrier_Load(&item_count_)) {
     new_size <<= 1;
   }
@@ -289,6 +420,16 @@ ScopedRowLock::ScopedRowLock(LockManager *manager,
   }
 }
 
+ScopedRowLock::ScopedRowLock(LockManager* manager,
+                             LockEntry* entry,
+                             LockManager::LockStatus ls)
+  : manager_(DCHECK_NOTNULL(manager)),
+    acquired_(ls == LockManager::LOCK_ACQUIRED),
+    entry_(entry),
+    ls_(ls) {
+  CHECK_NE(ls_, LockManager::LOCK_BUSY);
+}
+
 ScopedRowLock::ScopedRowLock(ScopedRowLock&& other) noexcept {
   TakeState(&other);
 }
@@ -337,11 +478,50 @@ LockManager::LockStatus LockManager::Lock(const Slice& key,
                                           LockManager::LockMode mode,
                                           LockEntry** entry) {
   *entry = locks_->GetLockEntry(key);
+  return AcquireEntry(key, tx, *entry);
+}
+
+void LockManager::AcquireLocks(const TransactionState* tx,
+                               const vector<Slice>& keys,
+                               LockMode /*mode*/,
+                               vector<ScopedRowLock>* locks) {
+  vector<LockEntry*> entries;
+  locks_->GetLockEntries(keys, &entries);
+  locks->clear();
+  locks->reserve(keys.size());
+  for (int i = 0; i < keys.size(); i++) {
+    LockStatus ls = AcquireEntry(keys[i], tx, entries[i]);
+    locks->emplace_back(ScopedRowLock(this, entries[i], ls));
+  }
+}
+
+void LockManager::ReleaseLocks(const vector<ScopedRowLock*>& locks) {
+  LockManager* manager = nullptr;
+  vector<LockEntry*> entries;
+  entries.reserve(locks.size());
+  for (ScopedRowLock* lock : locks) {
+    if (lock->entry_ == nullptr) {
+      continue;
+    }
+    DCHECK(manager == nullptr || manager == lock->manager_);
+    manager = lock->manager_;
+    ReleaseEntry(lock->entry_, lock->ls_);
+    entries.push_back(lock->entry_);
+    lock->acquired_ = false;
+    lock->entry_ = nullptr;
+  }
+  if (manager) {
+    manager->locks_->ReleaseLockEntries(entries);
+  }
+}
 
+LockManager::LockStatus LockManager::AcquireEntry(const Slice& key,
+                                                  const TransactionState* tx,
+                                                  LockEntry* entry) {
   // We expect low contention, so just try to try_lock first. This is faster
   // than a timed_lock, since we don't have to do a syscall to get the current
   // time.
-  if (!(*entry)->sem.TryAcquire()) {
+  if (!entry->sem.TryAcquire()) {
     // If the current holder of this lock is the same transaction just return
     // a LOCK_ALREADY_ACQUIRED status without actually acquiring the mutex.
     //
@@ -351,8 +531,8 @@ LockManager::LockStatus LockManager::Lock(const Slice& key,
     // obtained and released at the same time). If at any time in the future
     // we opt to perform more fine grained locking, possibly letting transactions
     // release a portion of the locks they no longer need, this no longer is OK.
-    if (ANNOTATE_UNPROTECTED_READ((*entry)->holder_) == tx) {
-      (*entry)->recursion_++;
+    if (ANNOTATE_UNPROTECTED_READ(entry->holder_) == tx) {
+      entry->recursion_++;
       return LOCK_ACQUIRED;
     }
 
@@ -363,8 +543,8 @@ LockManager::LockStatus LockManager::Lock(const Slice& key,
     TRACE_COUNTER_INCREMENT("row_lock_wait_count", 1);
     MicrosecondsInt64 start_wait_us = GetMonoTimeMicros();
     int waited_seconds = 0;
-    while (!(*entry)->sem.TimedAcquire(MonoDelta::FromSeconds(1))) {
-      const TransactionState* cur_holder = ANNOTATE_UNPROTECTED_READ((*entry)->holder_);
+    while (!entry->sem.TimedAcquire(MonoDelta::FromSeconds(1))) {
+      const TransactionState* cur_holder = ANNOTATE_UNPROTECTED_READ(entry->holder_);
       LOG(WARNING) << "Waited " << (++waited_seconds) << " seconds to obtain row lock on key "
                    << KUDU_REDACT(key.ToDebugString()) << " cur holder: " << cur_holder;
       // TODO(unknown): would be nice to also include some info about the blocking transaction,
@@ -378,7 +558,7 @@ LockManager::LockStatus LockManager::Lock(const Slice& key,
     }
   }
 
-  (*entry)->holder_ = tx;
+  entry->holder_ = tx;
   return LOCK_ACQUIRED;
 }
 
@@ -397,6 +577,11 @@ LockManager::LockStatus LockManager::TryLock(const Slice& key,
 }
 
 void LockManager::Release(LockEntry *lock, LockStatus ls) {
+  ReleaseEntry(lock, ls);
+  locks_->ReleaseLockEntry(lock);
+}
+
+void LockManager::ReleaseEntry(LockEntry* lock, LockStatus ls) {
   DCHECK_NOTNULL(lock)->holder_ = nullptr;
   if (ls == LOCK_ACQUIRED) {
     if (lock->recursion_ > 0) {
@@ -405,7 +590,6 @@ void LockManager::Release(LockEntry *lock, LockStatus ls) {
       lock->sem.Release();
     }
   }
-  locks_->ReleaseLockEntry(lock);
 }
 
 } // namespace tablet
@@ -18,6 +18,7 @@
 #define KUDU_TABLET_LOCK_MANAGER_H
 
 #include <cstddef>
+#include <vector>
 
 #include "kudu/gutil/macros.h"
 #include "kudu/util/slice.h"
@@ -26,6 +27,7 @@ namespace kudu { namespace tablet {
 
 class LockTable;
 class LockEntry;
+class ScopedRowLock;
 class TransactionState;
 
 // Super-simple lock manager implementation. This only supports exclusive
@@ -49,6 +51,21 @@ class LockManager {
     LOCK_EXCLUSIVE
   };
 
+  // Locks all of 'keys' for 'tx', waiting for the rows locked by other
+  // transactions, as if constructing a ScopedRowLock for each of them. The
+  // lock table is visited in one pass for the whole batch. 'locks' is set to
+  // the locks of the keys, in the same order. The keys must remain valid
+  // and unchanged for the lifetime of the locks.
+  void AcquireLocks(const TransactionState* tx,
+                    const std::vector<Slice>& keys,
+                    LockMode mode,
+                    std::vector<ScopedRowLock>* locks);
+
+  // Releases all of 'locks', which must have been acquired from the same
+  // manager, in one pass over its lock table. Locks which aren't held are
+  // skipped.
+  static void ReleaseLocks(const std::vector<ScopedRowLock*>& locks);
+
  private:
   friend class ScopedRowLock;
   friend class LockManagerTest;
@@ -59,6 +76,12 @@ class LockManager {
                      LockMode mode, LockEntry **entry);
   void Release(LockEntry *lock, LockStatus ls);
 
+  // Acquires the lock of 'entry', the lock table entry of 'key', for 'tx'.
+  LockStatus AcquireEntry(const Slice& key, const TransactionState* tx, LockEntry* entry);
+
+  // Releases the lock of 'entry', without releasing the entry itself.
+  static void ReleaseEntry(LockEntry* lock, LockStatus ls);
+
   LockTable *locks_;
 
   DISALLOW_COPY_AND_ASSIGN(LockManager);
@@ -116,6 +139,11 @@ class ScopedRowLock {
   ~ScopedRowLock();
 
  private:
+  friend class LockManager;
+
+  // Holds the lock of 'entry', acquired with status 'ls'.
+  ScopedRowLock(LockManager* manager, LockEntry* entry, LockManager::LockStatus ls);
+
   void TakeState(ScopedRowLock* other);
 
   LockManager *manager_;
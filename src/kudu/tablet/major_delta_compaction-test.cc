@@ -42,7 +42,9 @@
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 
+DECLARE_bool(major_delta_compaction_copy_unchanged_blocks);
 DECLARE_double(cfile_inject_corruption);
+DECLARE_int32(cfile_default_block_size);
 
 using std::shared_ptr;
 using std::string;
@@ -298,6 +300,47 @@ TEST_F(TestMajorDeltaCompaction, TestUndos) {
   ASSERT_NO_FATAL_FAILURE(VerifyData());
 }
 
+// Test that the data blocks without updates are copied as they are, and that
+// the undos of the rewritten blocks are written.
+TEST_F(TestMajorDeltaCompaction, TestCompactCopiesUnchangedBlocks) {
+  FLAGS_major_delta_compaction_copy_unchanged_blocks = true;
+  // Use small blocks so that the base data has many of them.
+  FLAGS_cfile_default_block_size = 1024;
+  const int kNumRows = 5000;
+  const int kNumUpdatedRows = 100;
+
+  ASSERT_NO_FATAL_FAILURE(WriteTestTablet(kNumRows));
+  ASSERT_OK(tablet()->Flush());
+
+  vector<shared_ptr<RowSet> > all_rowsets;
+  tablet()->GetRowSetsForTests(&all_rowsets);
+  shared_ptr<RowSet> rs = all_rowsets.front();
+
+  MvccSnapshot snap(*tablet()->mvcc_manager());
+  vector<ExpectedRow> old_state(expected_state_);
+
+  // Only update the first rows, so that the later blocks have no deltas.
+  ASSERT_NO_FATAL_FAILURE(UpdateRows(kNumUpdatedRows, false));
+  ASSERT_OK(tablet()->FlushBiggestDMS());
+  ASSERT_NO_FATAL_FAILURE(UpdateRows(kNumUpdatedRows, true));
+
+  // val4 is dictionary-encoded, so its blocks can't be copied and it's
+  // rewritten as a whole.
+  vector<ColumnId> col_ids_to_compact = { schema_.column_id(1),
+                                          schema_.column_id(3),
+                                          schema_.column_id(4) };
+  ASSERT_OK(tablet()->DoMajorDeltaCompaction(col_ids_to_compact, rs));
+  ASSERT_NO_FATAL_FAILURE(VerifyData());
+  ASSERT_NO_FATAL_FAILURE(VerifyDataWithMvccAndExpectedState(snap, old_state));
+
+  // Compact the unflushed updates too.
+  ASSERT_OK(tablet()->FlushBiggestDMS());
+  col_ids_to_compact.pop_back();
+  ASSERT_OK(tablet()->DoMajorDeltaCompaction(col_ids_to_compact, rs));
+  ASSERT_NO_FATAL_FAILURE(VerifyData());
+  ASSERT_NO_FATAL_FAILURE(VerifyDataWithMvccAndExpectedState(snap, old_state));
+}
+
 // Test that the delete REDO mutations are written back and not filtered out.
 TEST_F(TestMajorDeltaCompaction, TestCarryDeletesOver) {
   const int kNumRows = 100;
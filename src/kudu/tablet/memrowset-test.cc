@@ -31,10 +31,14 @@
 
 #include "kudu/clock/clock.h"
 #include "kudu/clock/logical_clock.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/common.pb.h"
+#include "kudu/common/generic_iterators.h"
+#include "kudu/common/iterator.h"
 #include "kudu/common/row.h"
 #include "kudu/common/row_changelist.h"
 #include "kudu/common/rowblock.h"
+#include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
 #include "kudu/consensus/log_anchor_registry.h"
@@ -56,6 +60,9 @@
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_bool(mrs_use_codegen);
+DECLARE_int32(mrs_intern_max_distinct_values);
+
 DEFINE_int32(roundtrip_num_rows, 10000,
              "Number of rows to use for the round-trip test");
 DEFINE_int32(num_scan_passes, 1,
@@ -419,6 +426,55 @@ TEST_F(TestMemRowSet, TestInsertCopiesToArena) {
   }
 }
 
+// Test that the values of an interned column are stored once per MemRowSet,
+// and that the values beyond the limit of distinct values are still copied.
+TEST_F(TestMemRowSet, TestInsertInternsValues) {
+  FLAGS_mrs_intern_max_distinct_values = 2;
+  ColumnStorageAttributes attrs;
+  attrs.intern = true;
+  const Schema schema({ ColumnSchema("key", STRING),
+                        ColumnSchema("host", STRING, false, nullptr, nullptr, attrs),
+                        ColumnSchema("msg", STRING) }, 1);
+  const string kLongValue(1024, 'x');
+
+  // Insert the same long value into either the interned or the other column.
+  auto insert_rows = [&](bool interned, shared_ptr<MemRowSet>* mrs) {
+    ASSERT_OK(MemRowSet::Create(0, schema, log_anchor_registry_.get(),
+                                MemTracker::GetRootTracker(), mrs));
+    RowBuilder rb(schema);
+    for (int i = 0; i < 100; i++) {
+      rb.Reset();
+      rb.AddString(StringPrintf("row %02d", i));
+      // The third distinct value of 'host' is past the limit.
+      rb.AddString(interned ? kLongValue : StringPrintf("host%d", i % 3));
+      rb.AddString(interned ? StringPrintf("msg%d", i) : kLongValue);
+      ASSERT_OK((*mrs)->Insert(Timestamp(i), rb.row(), op_id_));
+    }
+  };
+  shared_ptr<MemRowSet> interned_mrs;
+  NO_FATALS(insert_rows(true, &interned_mrs));
+  shared_ptr<MemRowSet> copied_mrs;
+  NO_FATALS(insert_rows(false, &copied_mrs));
+  ASSERT_LT(interned_mrs->memory_footprint() + 50 * kLongValue.size(),
+            copied_mrs->memory_footprint());
+
+  RowIteratorOptions opts;
+  opts.projection = &schema;
+  opts.snap_to_include = MvccSnapshot::CreateSnapshotIncludingAllTransactions();
+  vector<string> rows;
+  ASSERT_OK(DumpRowSet(*copied_mrs, opts, &rows));
+  ASSERT_EQ(100, rows.size());
+  for (int i = 0; i < rows.size(); i++) {
+    ASSERT_STR_CONTAINS(rows[i], StringPrintf(R"(string host="host%d")", i % 3));
+  }
+  rows.clear();
+  ASSERT_OK(DumpRowSet(*interned_mrs, opts, &rows));
+  ASSERT_EQ(100, rows.size());
+  for (const auto& row : rows) {
+    ASSERT_STR_CONTAINS(row, kLongValue);
+  }
+}
+
 TEST_F(TestMemRowSet, TestDelete) {
   const char kRowKey[] = "hello world";
   bool present;
@@ -772,5 +828,66 @@ TEST_F(TestMemRowSet, TestScanVirtualColumnIsDeleted) {
   }
 }
 
+// Test that the predicates of a scan are evaluated on the MemRowSet rows
+// before they're projected, and that rows whose predicate columns were
+// mutated are still evaluated correctly.
+TEST_F(TestMemRowSet, TestScanWithPredicates) {
+  // Keep the predicates in the spec, so that the MemRowSet iterator's own
+  // evaluation can be observed.
+  FLAGS_mrs_use_codegen = false;
+
+  shared_ptr<MemRowSet> mrs;
+  ASSERT_OK(MemRowSet::Create(0, schema_, log_anchor_registry_.get(),
+                              MemTracker::GetRootTracker(), &mrs));
+  for (uint32_t i = 0; i < 100; i++) {
+    ASSERT_OK(InsertRow(mrs.get(), StringPrintf("row %02d", i), i));
+  }
+  // Move a row into the range of the predicate, and another out of it.
+  OperationResultPB result;
+  ASSERT_OK(UpdateRow(mrs.get(), "row 50", 15, &result));
+  ASSERT_OK(UpdateRow(mrs.get(), "row 12", 99, &result));
+
+  // Scan the rows with 10 <= val < 20.
+  const uint32_t kLower = 10;
+  const uint32_t kUpper = 20;
+  RowIteratorOptions opts;
+  opts.projection = &schema_;
+  opts.snap_to_include = MvccSnapshot::CreateSnapshotIncludingAllTransactions();
+
+  // The MemRowSet iterator only returns the rows which match before their
+  // mutations, and the rows whose 'val' was mutated.
+  {
+    ScanSpec spec;
+    spec.AddPredicate(ColumnPredicate::Range(schema_.column(1), &kLower, &kUpper));
+    unique_ptr<MemRowSet::Iterator> iter(mrs->NewIterator(opts));
+    ASSERT_OK(iter->Init(&spec));
+    ASSERT_EQ(1, spec.predicates().size());
+    Arena arena(1024);
+    RowBlock block(schema_, 100, &arena);
+    int selected = 0;
+    while (iter->HasNext()) {
+      ASSERT_OK(iter->NextBlock(&block));
+      selected += block.selection_vector()->CountSelected();
+    }
+    ASSERT_EQ(11, selected);
+  }
+
+  // After the evaluation of the predicates on the projected rows, the
+  // mutations are taken into account.
+  {
+    ScanSpec spec;
+    spec.AddPredicate(ColumnPredicate::Range(schema_.column(1), &kLower, &kUpper));
+    unique_ptr<RowwiseIterator> iter(mrs->NewIterator(opts));
+    ASSERT_OK(InitAndMaybeWrap(&iter, &spec));
+    vector<string> rows;
+    ASSERT_OK(IterateToStringList(iter.get(), &rows));
+    ASSERT_EQ(10, rows.size());
+    for (const string& row : rows) {
+      ASSERT_STR_NOT_CONTAINS(row, "row 12");
+    }
+    ASSERT_EQ(R"((string key="row 50", uint32 val=15))", rows.back());
+  }
+}
+
 } // namespace tablet
 } // namespace kudu
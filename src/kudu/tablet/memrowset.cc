@@ -17,9 +17,12 @@
 
 #include "kudu/tablet/memrowset.h"
 
+#include <cstring>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <type_traits>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -27,7 +30,10 @@
 #include <glog/logging.h>
 
 #include "kudu/codegen/compilation_manager.h"
+#include "kudu/codegen/key_encoder.h"
+#include "kudu/codegen/predicate_evaluator.h"
 #include "kudu/codegen/row_projector.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/row.h"
@@ -37,6 +43,7 @@
 #include "kudu/consensus/log_anchor_registry.h"
 #include "kudu/consensus/opid.pb.h"
 #include "kudu/gutil/dynamic_annotations.h"
+#include "kudu/gutil/hash/city.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/compaction.h"
@@ -44,6 +51,7 @@
 #include "kudu/tablet/mvcc.h"
 #include "kudu/tablet/tablet.pb.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/memory/memory.h"
 
@@ -51,6 +59,13 @@ DEFINE_bool(mrs_use_codegen, true, "whether the memrowset should use code "
             "generation for iteration");
 TAG_FLAG(mrs_use_codegen, hidden);
 
+DEFINE_int32(mrs_intern_max_distinct_values, 4096,
+             "The maximum number of distinct values of each interned column that "
+             "a MemRowSet stores once. Values beyond these are copied for each "
+             "row, as for columns which aren't interned.");
+TAG_FLAG(mrs_intern_max_distinct_values, advanced);
+TAG_FLAG(mrs_intern_max_distinct_values, experimental);
+
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
@@ -89,6 +104,12 @@ bool MRSRow::IsGhost() const {
 
 namespace {
 
+struct SliceHash {
+  size_t operator()(const Slice& s) const {
+    return util_hash::CityHash64(reinterpret_cast<const char*>(s.data()), s.size());
+  }
+};
+
 shared_ptr<MemTracker> CreateMemTrackerForMemRowSet(
     int64_t id, shared_ptr<MemTracker> parent_tracker) {
   string mem_tracker_id = Substitute("MemRowSet-$0", id);
@@ -97,6 +118,56 @@ shared_ptr<MemTracker> CreateMemTrackerForMemRowSet(
 
 } // anonymous namespace
 
+class MemRowSet::InternedValues {
+ public:
+  explicit InternedValues(size_t max_values)
+      : max_values_(max_values) {
+  }
+
+  // Points 'value' to the copy of its value in 'arena', copying it there if
+  // it's the first time it's seen. Returns false, leaving 'value' unmodified,
+  // if it's a new value and there are already too many distinct values.
+  bool Intern(ThreadSafeMemoryTrackingArena* arena, Slice* value) {
+    {
+      shared_lock<rw_spinlock> l(lock_);
+      auto it = values_.find(*value);
+      if (PREDICT_TRUE(it != values_.end())) {
+        *value = *it;
+        return true;
+      }
+    }
+
+    std::lock_guard<rw_spinlock> l(lock_);
+    auto it = values_.find(*value);
+    if (it != values_.end()) {
+      *value = *it;
+      return true;
+    }
+    if (values_.size() >= max_values_) {
+      return false;
+    }
+    uint8_t* copy = static_cast<uint8_t*>(arena->AllocateBytes(value->size()));
+    if (PREDICT_FALSE(copy == nullptr)) {
+      return false;
+    }
+    memcpy(copy, value->data(), value->size());
+    *value = Slice(copy, value->size());
+    values_.insert(*value);
+    return true;
+  }
+
+ private:
+  const size_t max_values_;
+
+  // Protects 'values_'.
+  rw_spinlock lock_;
+
+  // The interned values, pointing into the arena.
+  std::unordered_set<Slice, SliceHash> values_;
+
+  DISALLOW_COPY_AND_ASSIGN(InternedValues);
+};
+
 Status MemRowSet::Create(int64_t id,
                          const Schema &schema,
                          LogAnchorRegistry* log_anchor_registry,
@@ -116,7 +187,7 @@ MemRowSet::MemRowSet(int64_t id,
   : id_(id),
     schema_(schema),
     allocator_(new MemoryTrackingBufferAllocator(
-        HeapBufferAllocator::Get(),
+        HugePageBufferAllocator::Get(),
         CreateMemTrackerForMemRowSet(id, std::move(parent_tracker)))),
     arena_(new ThreadSafeMemoryTrackingArena(kInitialArenaSize, allocator_)),
     tree_(arena_),
@@ -125,8 +196,29 @@ MemRowSet::MemRowSet(int64_t id,
     anchorer_(log_anchor_registry, Substitute("MemRowSet-$0", id_)),
     has_been_compacted_(false) {
   CHECK(schema.has_column_ids());
+  if (HugePageBufferAllocator::Get()->mode() != HugePageBufferAllocator::NONE) {
+    // Let the arena grow to components backed by huge pages.
+    arena_->SetMaxBufferSize(4 * HugePageBufferAllocator::kHugePageSize);
+  }
   ANNOTATE_BENIGN_RACE(&debug_insert_count_, "insert count isnt accurate");
   ANNOTATE_BENIGN_RACE(&debug_update_count_, "update count isnt accurate");
+  // MemRowSets are replaced on every flush, so the key encoder is requested
+  // once per MemRowSet: only the first ones of a tablet miss it.
+  if (FLAGS_mrs_use_codegen) {
+    codegen::CompilationManager::GetSingleton()->RequestKeyEncoder(schema_, &key_encoder_);
+  }
+  if (FLAGS_mrs_intern_max_distinct_values > 0) {
+    for (int i = 0; i < schema_.num_columns(); i++) {
+      const ColumnSchema& col = schema_.column(i);
+      if (!col.attributes().intern || col.type_info()->physical_type() != BINARY) {
+        continue;
+      }
+      if (interned_values_.empty()) {
+        interned_values_.resize(schema_.num_columns());
+      }
+      interned_values_[i].reset(new InternedValues(FLAGS_mrs_intern_max_distinct_values));
+    }
+  }
 }
 
 MemRowSet::~MemRowSet() {
@@ -157,7 +249,11 @@ Status MemRowSet::Insert(Timestamp timestamp,
 
   {
     faststring enc_key_buf;
-    schema_.EncodeComparableKey(row, &enc_key_buf);
+    if (key_encoder_) {
+      key_encoder_->Encode(row, &enc_key_buf);
+    } else {
+      schema_.EncodeComparableKey(row, &enc_key_buf);
+    }
     Slice enc_key(enc_key_buf);
 
     btree::PreparedMutation<MSBTreeTraits> mutation(enc_key);
@@ -185,7 +281,11 @@ Status MemRowSet::Insert(Timestamp timestamp,
     DEFINE_MRSROW_ON_STACK(this, mrsrow, mrsrow_slice);
     mrsrow.header_->insertion_timestamp = timestamp;
     mrsrow.header_->redo_head = nullptr;
-    RETURN_NOT_OK(mrsrow.CopyRow(row, arena_.get()));
+    if (interned_values_.empty()) {
+      RETURN_NOT_OK(mrsrow.CopyRow(row, arena_.get()));
+    } else {
+      RETURN_NOT_OK(CopyRowInterning(row, &mrsrow));
+    }
 
     CHECK(mutation.Insert(mrsrow_slice))
     << "Expected to be able to insert, since the prepared mutation "
@@ -198,6 +298,44 @@ Status MemRowSet::Insert(Timestamp timestamp,
   return Status::OK();
 }
 
+Status MemRowSet::CopyRowInterning(const ConstContiguousRow& row, MRSRow* ms_row) {
+  memcpy(ms_row->row_slice_.mutable_data(), row.row_data(), ms_row->row_slice_.size());
+
+  // Intern the values of the interned columns, and copy the indirect data of
+  // the other columns in one allocation, as RelocateIndirectDataToArena() does.
+  size_t size = 0;
+  for (int i = 0; i < schema_.num_columns(); i++) {
+    MRSRow::Cell cell = ms_row->cell(i);
+    if (cell.typeinfo()->physical_type() != BINARY ||
+        (cell.is_nullable() && cell.is_null())) {
+      continue;
+    }
+    Slice* slice = reinterpret_cast<Slice*>(cell.mutable_ptr());
+    InternedValues* values = interned_values_[i].get();
+    if (!values) {
+      size += slice->size();
+    } else if (!values->Intern(arena_.get(), slice) &&
+               PREDICT_FALSE(!arena_->RelocateSlice(*slice, slice))) {
+      return Status::RuntimeError("unable to copy the row into the MemRowSet");
+    }
+  }
+  if (size == 0) return Status::OK();
+
+  uint8_t* dst = static_cast<uint8_t*>(arena_->AllocateBytes(size));
+  for (int i = 0; i < schema_.num_columns(); i++) {
+    MRSRow::Cell cell = ms_row->cell(i);
+    if (cell.typeinfo()->physical_type() != BINARY ||
+        (cell.is_nullable() && cell.is_null()) ||
+        interned_values_[i]) {
+      continue;
+    }
+    Slice* slice = reinterpret_cast<Slice*>(cell.mutable_ptr());
+    slice->relocate(dst);
+    dst += slice->size();
+  }
+  return Status::OK();
+}
+
 Status MemRowSet::Reinsert(Timestamp timestamp, const ConstContiguousRow& row, MRSRow *ms_row) {
   DCHECK_SCHEMA_EQ(schema_, *row.schema());
 
@@ -428,6 +566,36 @@ Status MemRowSet::Iterator::Init(ScanSpec *spec) {
     exclusive_upper_bound_.reset(upper_bound);
   }
 
+  // Evaluate the predicates on the MemRowSet rows first, so that the rows
+  // which don't match aren't projected. Columns which were added after the
+  // MemRowSet was created only have their default value, which is left to
+  // the evaluation on the projected rows.
+  if (spec && opts_.projection->has_column_ids()) {
+    const Schema& mrs_schema = memrowset_->schema_nonvirtual();
+    for (const auto& col_pred : spec->predicates()) {
+      const ColumnPredicate& pred = col_pred.second;
+      int proj_idx = opts_.projection->find_column(pred.column().name());
+      if (proj_idx == Schema::kColumnNotFound) continue;
+      ColumnId col_id = opts_.projection->column_id(proj_idx);
+      int mrs_idx = mrs_schema.find_column_by_id(col_id);
+      if (mrs_idx == Schema::kColumnNotFound) continue;
+      row_predicates_.push_back({ pred, static_cast<size_t>(mrs_idx), col_id });
+    }
+  }
+
+  // If a codegenned evaluator of the predicates is ready, evaluate them
+  // while fetching the rows, rather than in a PredicateEvaluatingIterator.
+  if (spec && FLAGS_mrs_use_codegen && !spec->predicates().empty()) {
+    vector<ColumnPredicate> predicates;
+    for (const auto& col_pred : spec->predicates()) {
+      predicates.push_back(col_pred.second);
+    }
+    if (codegen::CompilationManager::GetSingleton()->RequestPredicateEvaluator(
+            opts_.projection, std::move(predicates), &predicate_evaluator_)) {
+      spec->RemovePredicates();
+    }
+  }
+
   state_ = kScanning;
   return Status::OK();
 }
@@ -485,6 +653,10 @@ Status MemRowSet::Iterator::NextBlock(RowBlock *dst) {
   // Clear unreached bits by resizing
   dst->Resize(fetched);
 
+  if (predicate_evaluator_) {
+    predicate_evaluator_->Evaluate(dst);
+  }
+
   return Status::OK();
 }
 
@@ -522,17 +694,24 @@ Status MemRowSet::Iterator::FetchRows(RowBlock* dst, size_t* fetched) {
     bool insert_excluded = opts_.snap_to_exclude &&
                            opts_.snap_to_exclude->IsCommitted(row.insertion_timestamp());
     bool unset_in_sel_vector;
-    ApplyStatus apply_status;
+    ApplyStatus apply_status = NONE_APPLIED;
     if (insert_excluded || opts_.snap_to_include.IsCommitted(row.insertion_timestamp())) {
-      RETURN_NOT_OK(projector_->ProjectRowForRead(row, &dst_row, dst->arena()));
-
-      // Roll-forward MVCC for committed updates.
       Mutation* redo_head = reinterpret_cast<Mutation*>(
           base::subtle::Acquire_Load(reinterpret_cast<AtomicWord*>(&row.header_->redo_head)));
-      RETURN_NOT_OK(ApplyMutationsToProjectedRow(
-          redo_head, &dst_row, dst->arena(), &apply_status));
-      unset_in_sel_vector = (apply_status == APPLIED_AND_DELETED && !opts_.include_deleted_rows) ||
-                            (apply_status == NONE_APPLIED && insert_excluded);
+      if (!row_predicates_.empty() && !MayMatchPredicates(row, redo_head)) {
+        // The row doesn't match whatever its mutations, so there's no need to
+        // project it or to apply them.
+        unset_in_sel_vector = true;
+      } else {
+        RETURN_NOT_OK(projector_->ProjectRowForRead(row, &dst_row, dst->arena()));
+
+        // Roll-forward MVCC for committed updates.
+        RETURN_NOT_OK(ApplyMutationsToProjectedRow(
+            redo_head, &dst_row, dst->arena(), &apply_status));
+        unset_in_sel_vector =
+            (apply_status == APPLIED_AND_DELETED && !opts_.include_deleted_rows) ||
+            (apply_status == NONE_APPLIED && insert_excluded);
+      }
     } else {
       // The insertion is too new; the entire row should be omitted.
       unset_in_sel_vector = true;
@@ -626,6 +805,48 @@ Status MemRowSet::Iterator::ApplyMutationsToProjectedRow(
   return Status::OK();
 }
 
+bool MemRowSet::Iterator::MayMatchPredicates(const MRSRow& row,
+                                             const Mutation* mutation_head) const {
+  // Look for mutations of the predicate columns, whether or not they're
+  // visible in the snapshot. REINSERTs may change any column.
+  for (const Mutation* mut = mutation_head; mut != nullptr; mut = mut->acquire_next()) {
+    RowChangeListDecoder decoder(mut->changelist());
+    if (PREDICT_FALSE(!decoder.Init().ok()) || decoder.is_reinsert()) {
+      return true;
+    }
+    if (decoder.is_delete()) {
+      continue;
+    }
+    while (decoder.HasNext()) {
+      RowChangeListDecoder::DecodedUpdate update;
+      if (PREDICT_FALSE(!decoder.DecodeNext(&update).ok())) {
+        return true;
+      }
+      for (const RowPredicate& p : row_predicates_) {
+        if (update.col_id == p.col_id) {
+          return true;
+        }
+      }
+    }
+  }
+
+  const Schema* schema = row.schema();
+  for (const RowPredicate& p : row_predicates_) {
+    const ColumnSchema& col = schema->column(p.col_idx);
+    bool matches;
+    if (col.is_nullable() && row.is_null(p.col_idx)) {
+      matches = p.predicate.predicate_type() == PredicateType::IsNull;
+    } else {
+      matches = p.predicate.EvaluateCell(col.type_info()->physical_type(),
+                                         row.cell_ptr(p.col_idx));
+    }
+    if (!matches) {
+      return false;
+    }
+  }
+  return true;
+}
+
 // Copy the current MRSRow to the 'dst_row' provided using the iterator projection schema.
 Status MemRowSet::Iterator::GetCurrentRow(RowBlockRow* dst_row,
                                           Arena* row_arena,
@@ -28,6 +28,7 @@
 #include <boost/optional/optional.hpp>
 #include <glog/logging.h>
 
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/iterator.h"
 #include "kudu/common/row.h"
 #include "kudu/common/rowid.h"
@@ -37,6 +38,7 @@
 #include "kudu/gutil/atomicops.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
 #include "kudu/tablet/concurrent_btree.h"
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/rowset_metadata.h"
@@ -56,6 +58,11 @@ class RowChangeList;
 class ScanSpec;
 struct IteratorStats;
 
+namespace codegen {
+class KeyEncoderFunctions;
+class PredicateEvaluator;
+}  // namespace codegen
+
 namespace fs {
 struct IOContext;
 }  // namespace fs
@@ -424,12 +431,20 @@ class MemRowSet : public RowSet,
             log::LogAnchorRegistry* log_anchor_registry,
             std::shared_ptr<MemTracker> parent_tracker);
 
+  // The distinct values of a column whose storage attributes set 'intern',
+  // each copied once into the arena.
+  class InternedValues;
+
   // Perform a "Reinsert" -- handle an insertion into a row which was previously
   // inserted and deleted, but still has an entry in the MemRowSet.
   Status Reinsert(Timestamp timestamp,
                   const ConstContiguousRow& row,
                   MRSRow *ms_row);
 
+  // Like MRSRow::CopyRow(), but points the cells of the interned columns to
+  // the copies of their values in the arena.
+  Status CopyRowInterning(const ConstContiguousRow& row, MRSRow* ms_row);
+
   typedef btree::CBTree<MSBTreeTraits> MSBTree;
 
   int64_t id_;
@@ -442,6 +457,14 @@ class MemRowSet : public RowSet,
 
   MSBTree tree_;
 
+  // The interned values of each column, indexed by column, or null for the
+  // columns which aren't interned. Empty if no column is.
+  std::vector<std::unique_ptr<InternedValues>> interned_values_;
+
+  // The codegenned encoder of the keys of inserted rows, if it was compiled
+  // by the time this MemRowSet was created.
+  scoped_refptr<codegen::KeyEncoderFunctions> key_encoder_;
+
   // Approximate counts of mutations. This variable is updated non-atomically,
   // so it cannot be relied upon to be in any way accurate. It's only used
   // as a sanity check during flush.
@@ -485,6 +508,14 @@ class MemRowSet::Iterator : public RowwiseIterator {
     return exclusive_upper_bound_.is_initialized();
   }
 
+  // Return the encoded key of the current row.
+  Slice GetCurrentEncodedKey() const {
+    DCHECK_NE(state_, kUninitialized) << "not initted";
+    Slice key, dummy;
+    iter_->GetCurrentEntry(&key, &dummy);
+    return key;
+  }
+
   bool out_of_bounds(const Slice &key) const {
     DCHECK(has_upper_bound()) << "No upper bound set!";
 
@@ -581,6 +612,23 @@ class MemRowSet::Iterator : public RowwiseIterator {
                                       Arena* dst_arena,
                                       ApplyStatus* apply_status);
 
+  // Returns whether 'row' may match the scan's predicates, evaluating them on
+  // the MemRowSet row itself rather than on its projection. A row whose
+  // mutations may change the value of a predicate column always may match.
+  bool MayMatchPredicates(const MRSRow& row, const Mutation* mutation_head) const;
+
+  // A predicate of the scan, evaluated on the MemRowSet rows before their
+  // projection. The predicates are still evaluated on the projected rows
+  // afterwards, which accounts for mutations and takes care of the rows for
+  // which the predicates couldn't be evaluated here.
+  struct RowPredicate {
+    ColumnPredicate predicate;
+    // The index and ID of the predicate's column in the MemRowSet schema.
+    size_t col_idx;
+    ColumnId col_id;
+  };
+  std::vector<RowPredicate> row_predicates_;
+
   const std::shared_ptr<const MemRowSet> memrowset_;
   gscoped_ptr<MemRowSet::MSBTIter> iter_;
 
@@ -593,6 +641,10 @@ class MemRowSet::Iterator : public RowwiseIterator {
   const gscoped_ptr<MRSRowProjector> projector_;
   DeltaProjector delta_projector_;
 
+  // The codegenned evaluator of the scan's predicates, if the predicates
+  // were pushed down into this iterator in Init().
+  gscoped_ptr<codegen::PredicateEvaluator> predicate_evaluator_;
+
   // The index of the first IS_DELETED virtual column in the projection schema,
   // or kColumnNotFound if one doesn't exist.
   const int projection_vc_is_deleted_idx_;
@@ -22,9 +22,11 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include "kudu/common/timestamp.h"
 #include "kudu/fs/block_id.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/tablet/metadata.pb.h"
 #include "kudu/tablet/rowset_metadata.h"
 #include "kudu/tablet/tablet_metadata.h"
 #include "kudu/util/status.h"
@@ -136,5 +138,37 @@ TEST_F(MetadataTest, RSMD_TestReplaceDeltas_Bad_DoesntExist) {
                BlockId::JoinStrings(all_blocks_)));
 }
 
+// Test that the max timestamps of the UNDO delta blocks are persisted, and
+// follow the blocks through updates.
+TEST_F(MetadataTest, RSMD_TestUndoMaxTimestamps) {
+  ASSERT_OK(meta_->CommitUndoDeltaDataBlock(BlockId(10), Timestamp(100)));
+  ASSERT_OK(meta_->CommitUndoDeltaDataBlock(BlockId(11), Timestamp(200)));
+
+  RowSetDataPB pb;
+  meta_->ToProtobuf(&pb);
+  ASSERT_EQ(2, pb.undo_deltas_size());
+  ASSERT_EQ(100, pb.undo_deltas(0).max_timestamp());
+  ASSERT_EQ(200, pb.undo_deltas(1).max_timestamp());
+
+  // Blocks written by versions which didn't record the max timestamp don't
+  // have one.
+  pb.mutable_undo_deltas(1)->clear_max_timestamp();
+  unique_ptr<RowSetMetadata> loaded;
+  ASSERT_OK(RowSetMetadata::Load(tablet_meta_.get(), pb, &loaded));
+  Timestamp max_timestamp;
+  ASSERT_TRUE(loaded->undo_delta_block_max_timestamp(BlockId(10), &max_timestamp));
+  ASSERT_EQ(Timestamp(100), max_timestamp);
+  ASSERT_FALSE(loaded->undo_delta_block_max_timestamp(BlockId(11), &max_timestamp));
+
+  vector<BlockId> removed;
+  loaded->CommitUpdate(RowSetMetadataUpdate()
+                       .RemoveUndoDeltaBlocks({ BlockId(10) })
+                       .SetNewUndoBlock(BlockId(12), Timestamp(300)), &removed);
+  ASSERT_EQ(vector<BlockId>({ BlockId(10) }), removed);
+  ASSERT_FALSE(loaded->undo_delta_block_max_timestamp(BlockId(10), &max_timestamp));
+  ASSERT_TRUE(loaded->undo_delta_block_max_timestamp(BlockId(12), &max_timestamp));
+  ASSERT_EQ(Timestamp(300), max_timestamp);
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -17,11 +17,15 @@
 
 #include "kudu/tablet/multi_column_writer.h"
 
+#include <algorithm>
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <string>
 #include <utility>
 
+#include <gflags/gflags.h>
+
 #include "kudu/cfile/cfile_util.h"
 #include "kudu/cfile/cfile_writer.h"
 #include "kudu/common/columnblock.h"
@@ -31,8 +35,21 @@
 #include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/once.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/threadpool.h"
+
+DEFINE_int32(flush_column_encoding_threads, 0,
+             "Number of threads, shared by all flushes and compactions, which "
+             "encode, compress and write the columns of rowsets in parallel "
+             "with the flushing thread. If 0, each flush writes its columns "
+             "on its own thread.");
+TAG_FLAG(flush_column_encoding_threads, experimental);
+DEFINE_validator(flush_column_encoding_threads,
+                 [](const char* /*flagname*/, int32_t value) { return value >= 0; });
 
 namespace kudu {
 namespace tablet {
@@ -40,16 +57,61 @@ namespace tablet {
 using cfile::CFileWriter;
 using fs::BlockCreationTransaction;
 using fs::CreateBlockOptions;
+using fs::IOContext;
 using fs::WritableBlock;
 using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+GoogleOnceType g_column_pool_once = GOOGLE_ONCE_INIT;
+ThreadPool* g_column_pool = nullptr;
+
+void InitColumnPool() {
+  gscoped_ptr<ThreadPool> pool;
+  CHECK_OK(ThreadPoolBuilder("column-writer")
+           .set_max_threads(FLAGS_flush_column_encoding_threads)
+           .Build(&pool));
+  g_column_pool = pool.release();
+}
+
+// Adds the blocks finished by concurrent column writers to a transaction.
+class LockedBlockCreationTransaction : public BlockCreationTransaction {
+ public:
+  explicit LockedBlockCreationTransaction(BlockCreationTransaction* transaction)
+      : transaction_(transaction) {
+  }
+
+  void AddCreatedBlock(unique_ptr<WritableBlock> block) override {
+    std::lock_guard<simple_spinlock> l(lock_);
+    transaction_->AddCreatedBlock(std::move(block));
+  }
+
+  Status CommitCreatedBlocks() override {
+    LOG(DFATAL) << "the blocks are committed by the transaction of the caller";
+    return Status::IllegalState("unexpected commit");
+  }
+
+ private:
+  simple_spinlock lock_;
+  BlockCreationTransaction* const transaction_;
+};
+
+} // anonymous namespace
 
 MultiColumnWriter::MultiColumnWriter(FsManager* fs,
                                      const Schema* schema,
-                                     std::string tablet_id)
+                                     std::string tablet_id,
+                                     fs::StorageTier tier)
   : fs_(fs),
     schema_(schema),
     finished_(false),
-    tablet_id_(std::move(tablet_id)) {
+    tablet_id_(std::move(tablet_id)),
+    tier_(tier) {
+  if (FLAGS_flush_column_encoding_threads > 0 && schema_->num_columns() > 1) {
+    GoogleOnceInit(&g_column_pool_once, &InitColumnPool);
+    pool_token_ = g_column_pool->NewToken(ThreadPool::ExecutionMode::CONCURRENT);
+  }
 }
 
 MultiColumnWriter::~MultiColumnWriter() {
@@ -60,7 +122,7 @@ Status MultiColumnWriter::Open() {
   CHECK(cfile_writers_.empty());
 
   // Open columns.
-  const CreateBlockOptions block_opts({ tablet_id_ });
+  const CreateBlockOptions block_opts({ tablet_id_, tier_ });
   for (int i = 0; i < schema_->num_columns(); i++) {
     const ColumnSchema &col = schema_->column(i);
 
@@ -70,6 +132,10 @@ Status MultiColumnWriter::Open() {
     // the corresponding rows.
     opts.write_posidx = true;
 
+    // Keep per-block statistics so that scans can skip blocks which can't
+    // match their predicates.
+    opts.write_zone_map = true;
+
     /// Set the column storage attributes.
     opts.storage_attributes = col.attributes();
 
@@ -102,31 +168,92 @@ Status MultiColumnWriter::Open() {
   return Status::OK();
 }
 
+Status MultiColumnWriter::ForEachColumn(const std::function<Status(int)>& f) {
+  const int num_cols = schema_->num_columns();
+  if (!pool_token_) {
+    for (int i = 0; i < num_cols; i++) {
+      RETURN_NOT_OK(f(i));
+    }
+    return Status::OK();
+  }
+
+  // The columns are striped across the tasks, one of which is run by the
+  // calling thread.
+  const int num_tasks = std::min(num_cols, FLAGS_flush_column_encoding_threads + 1);
+  vector<Status> statuses(num_tasks);
+  const auto run_task = [&](int task) {
+    for (int i = task; i < num_cols; i += num_tasks) {
+      statuses[task] = f(i);
+      if (PREDICT_FALSE(!statuses[task].ok())) {
+        return;
+      }
+    }
+  };
+  for (int task = 1; task < num_tasks; task++) {
+    Status s = pool_token_->SubmitFunc([&run_task, task]() { run_task(task); });
+    if (PREDICT_FALSE(!s.ok())) {
+      // The submitted tasks refer to this frame.
+      pool_token_->Wait();
+      return s;
+    }
+  }
+  run_task(0);
+  pool_token_->Wait();
+  for (const Status& s : statuses) {
+    RETURN_NOT_OK(s);
+  }
+  return Status::OK();
+}
+
 Status MultiColumnWriter::AppendBlock(const RowBlock& block) {
-  for (int i = 0; i < schema_->num_columns(); i++) {
-    ColumnBlock column = block.column_block(i);
+  const bool projected = block.schema().num_columns() != schema_->num_columns();
+  return ForEachColumn([&](int i) {
+    int block_idx = i;
+    if (projected) {
+      block_idx = block.schema().find_column_by_id(schema_->column_id(i));
+      if (block_idx == Schema::kColumnNotFound) {
+        return Status::OK();
+      }
+    }
+    ColumnBlock column = block.column_block(block_idx);
     if (column.is_nullable()) {
-      RETURN_NOT_OK(cfile_writers_[i]->AppendNullableEntries(column.null_bitmap(),
-          column.data(), column.nrows()));
-    } else {
-      RETURN_NOT_OK(cfile_writers_[i]->AppendEntries(column.data(), column.nrows()));
+      return cfile_writers_[i]->AppendNullableEntries(column.null_bitmap(),
+          column.data(), column.nrows());
     }
-  }
+    return cfile_writers_[i]->AppendEntries(column.data(), column.nrows());
+  });
+}
+
+bool MultiColumnWriter::CanAppendDataBlocks(int col_idx,
+                                            const cfile::CFileReader& reader) const {
+  DCHECK_LT(col_idx, cfile_writers_.size());
+  return cfile_writers_[col_idx]->CanAppendDataBlocks(reader);
+}
+
+Status MultiColumnWriter::AppendDataBlocks(int col_idx,
+                                           cfile::CFileReader* reader,
+                                           const IOContext* io_context) {
+  DCHECK_LT(col_idx, cfile_writers_.size());
+  RETURN_NOT_OK_PREPEND(cfile_writers_[col_idx]->AppendDataBlocks(reader, io_context),
+                        "Unable to append data blocks to column " +
+                        schema_->column(col_idx).ToString());
   return Status::OK();
 }
 
 Status MultiColumnWriter::FinishAndReleaseBlocks(
     BlockCreationTransaction* transaction) {
   CHECK(!finished_);
-  for (int i = 0; i < schema_->num_columns(); i++) {
+  LockedBlockCreationTransaction locked_transaction(transaction);
+  BlockCreationTransaction* dst = pool_token_ ? &locked_transaction : transaction;
+  RETURN_NOT_OK(ForEachColumn([&](int i) {
     CFileWriter *writer = cfile_writers_[i];
-    Status s = writer->FinishAndReleaseBlock(transaction);
+    Status s = writer->FinishAndReleaseBlock(dst);
     if (!s.ok()) {
       LOG(WARNING) << "Unable to Finish writer for column " <<
         schema_->column(i).ToString() << ": " << s.ToString();
-      return s;
     }
-  }
+    return s;
+  }));
   finished_ = true;
   return Status::OK();
 }
@@ -18,13 +18,16 @@
 #define KUDU_TABLET_MULTI_COLUMN_WRITER_H
 
 #include <cstddef>
+#include <functional>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <glog/logging.h>
 
 #include "kudu/fs/block_id.h"
+#include "kudu/fs/block_manager.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/util/status.h"
 
@@ -33,25 +36,36 @@ namespace kudu {
 class FsManager;
 class RowBlock;
 class Schema;
+class ThreadPoolToken;
 struct ColumnId;
 
 namespace cfile {
+class CFileReader;
 class CFileWriter;
 } // namespace cfile
 
 namespace fs {
 class BlockCreationTransaction;
+struct IOContext;
 } // namespace fs
 
 namespace tablet {
 
 // Wrapper which writes several columns in parallel corresponding to some
-// Schema. Written blocks will fall in the tablet_id's data dir group.
+// Schema. Written blocks will fall in the tablet_id's data dir group, on the
+// dirs of storage tier 'tier' if possible.
+//
+// If --flush_column_encoding_threads is set, the columns are encoded,
+// compressed and written by a thread pool shared by all the writers of the
+// process, as well as by the calling thread. Each call returns once all of
+// its columns are written, so a writer never holds more than one block of
+// rows.
 class MultiColumnWriter {
  public:
   MultiColumnWriter(FsManager* fs,
                     const Schema* schema,
-                    std::string tablet_id);
+                    std::string tablet_id,
+                    fs::StorageTier tier = fs::StorageTier::DEFAULT);
 
   virtual ~MultiColumnWriter();
 
@@ -60,9 +74,22 @@ class MultiColumnWriter {
 
   // Append the given block to the output columns.
   //
+  // The block may be projected on a subset of the columns, matched by ID, in
+  // which case the other columns must be appended with AppendDataBlocks().
+  //
   // Note that the selection vector here is ignored.
   Status AppendBlock(const RowBlock& block);
 
+  // Return true if the data blocks of 'reader' may be appended to the column
+  // of index 'col_idx' with AppendDataBlocks().
+  bool CanAppendDataBlocks(int col_idx, const cfile::CFileReader& reader) const;
+
+  // Append all the data blocks of 'reader' to the column of index 'col_idx'.
+  // See CFileWriter::AppendDataBlocks().
+  Status AppendDataBlocks(int col_idx,
+                          cfile::CFileReader* reader,
+                          const fs::IOContext* io_context);
+
   // Close the in-progress CFiles, finalizing the underlying writable
   // blocks and releasing them to 'transaction'.
   Status FinishAndReleaseBlocks(fs::BlockCreationTransaction* transaction);
@@ -81,16 +108,25 @@ class MultiColumnWriter {
   void GetFlushedBlocksByColumnId(std::map<ColumnId, BlockId>* ret) const;
 
  private:
+  // Call 'f' with the index of each column, in parallel if a thread pool is
+  // used, and return the first error.
+  Status ForEachColumn(const std::function<Status(int)>& f);
+
   FsManager* const fs_;
   const Schema* const schema_;
 
   bool finished_;
 
   const std::string tablet_id_;
+  const fs::StorageTier tier_;
 
   std::vector<cfile::CFileWriter *> cfile_writers_;
   std::vector<BlockId> block_ids_;
 
+  // The token of the tasks writing columns, or null if the columns are
+  // written by the calling thread only.
+  std::unique_ptr<ThreadPoolToken> pool_token_;
+
   DISALLOW_COPY_AND_ASSIGN(MultiColumnWriter);
 };
 
@@ -240,6 +240,8 @@ TEST_F(MvccTest, TestSafeTimeWithOutOfOrderTxns) {
 
   // Committing 'txn_in_the_past' should not advance safe time or clean time.
   mgr.CommitTransaction(txn_in_the_past);
+  ASSERT_EQ(Timestamp::kInitialTimestamp, mgr.GetCleanTimestamp());
+  ASSERT_EQ(Timestamp(51), mgr.GetNoneCommittedAtOrAfterTimestamp());
 
   // Now take a snapshot.
   MvccSnapshot snap1;
@@ -640,6 +642,49 @@ TEST_F(MvccTest, TestTxnAbort) {
   ASSERT_EQ(tx3, mgr.GetCleanTimestamp());
 }
 
+// Test that transactions which finish out of order are accounted for until
+// the earlier ones finish, and that the timestamp of an aborted transaction
+// can be reused.
+TEST_F(MvccTest, TestOutOfOrderFinishAndRestart) {
+  MvccManager mgr;
+  mgr.StartTransaction(Timestamp(10));
+  mgr.StartTransaction(Timestamp(30));
+  mgr.StartTransaction(Timestamp(20));
+  ASSERT_EQ(3, mgr.CountTransactionsInFlight());
+  ASSERT_EQ(Timestamp(10), mgr.earliest_in_flight_);
+  mgr.AdjustSafeTime(Timestamp(30));
+
+  // Finishing the later transactions doesn't move the earliest one.
+  mgr.AbortTransaction(Timestamp(20));
+  mgr.StartApplyingTransaction(Timestamp(30));
+  mgr.CommitTransaction(Timestamp(30));
+  ASSERT_EQ(1, mgr.CountTransactionsInFlight());
+  ASSERT_EQ(Timestamp(10), mgr.earliest_in_flight_);
+  ASSERT_EQ(Timestamp::kInitialTimestamp, mgr.GetCleanTimestamp());
+  ASSERT_FALSE(mgr.AreAllTransactionsCommitted(Timestamp(11)));
+
+  // The aborted timestamp can be started again, but not the committed one.
+  mgr.StartTransaction(Timestamp(20));
+  ASSERT_EQ(2, mgr.CountTransactionsInFlight());
+  EXPECT_DEATH({
+      mgr.StartTransaction(Timestamp(30));
+    }, "already-committed");
+
+  mgr.StartApplyingTransaction(Timestamp(10));
+  mgr.CommitTransaction(Timestamp(10));
+  ASSERT_EQ(Timestamp(20), mgr.earliest_in_flight_);
+  ASSERT_EQ(Timestamp(20), mgr.GetCleanTimestamp());
+  ASSERT_TRUE(mgr.AreAllTransactionsCommitted(Timestamp(19)));
+  ASSERT_FALSE(mgr.AreAllTransactionsCommitted(Timestamp(20)));
+
+  mgr.StartApplyingTransaction(Timestamp(20));
+  mgr.CommitTransaction(Timestamp(20));
+  ASSERT_EQ(0, mgr.CountTransactionsInFlight());
+  ASSERT_TRUE(mgr.timestamps_in_flight_.empty());
+  ASSERT_EQ(Timestamp::kMax, mgr.earliest_in_flight_);
+  ASSERT_EQ(Timestamp(30), mgr.GetCleanTimestamp());
+}
+
 // This tests for a bug we were observing, where a clean snapshot would not
 // coalesce to the latest timestamp.
 TEST_F(MvccTest, TestAutomaticCleanTimeMoveToSafeTimeOnCommit) {
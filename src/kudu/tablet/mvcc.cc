@@ -25,7 +25,6 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
-#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/strcat.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -48,8 +47,10 @@ namespace tablet {
 using strings::Substitute;
 
 MvccManager::MvccManager()
-  : safe_time_(Timestamp::kMin),
+  : num_in_flight_(0),
+    safe_time_(Timestamp::kMin),
     earliest_in_flight_(Timestamp::kMax),
+    clean_time_(Timestamp::kInitialTimestamp.value()),
     open_(true) {
   cur_snap_.all_committed_before_ = Timestamp::kInitialTimestamp;
   cur_snap_.none_committed_at_or_after_ = Timestamp::kInitialTimestamp;
@@ -79,19 +80,19 @@ void MvccManager::StartTransaction(Timestamp timestamp) {
 
 void MvccManager::StartApplyingTransaction(Timestamp timestamp) {
   std::lock_guard<LockType> l(lock_);
-  auto it = timestamps_in_flight_.find(timestamp.value());
-  if (PREDICT_FALSE(it == timestamps_in_flight_.end())) {
+  InFlightTxn* txn = FindInFlightUnlocked(timestamp);
+  if (PREDICT_FALSE(txn == nullptr)) {
     LOG(FATAL) << "Cannot mark timestamp " << timestamp.ToString() << " as APPLYING: "
                << "not in the in-flight map.";
   }
 
-  TxnState cur_state = it->second;
+  TxnState cur_state = txn->state;
   if (PREDICT_FALSE(cur_state != RESERVED)) {
     LOG(FATAL) << "Cannot mark timestamp " << timestamp.ToString() << " as APPLYING: "
                << "wrong state: " << cur_state;
   }
 
-  it->second = APPLYING;
+  txn->state = APPLYING;
 }
 
 bool MvccManager::InitTransactionUnlocked(const Timestamp& timestamp) {
@@ -100,11 +101,32 @@ bool MvccManager::InitTransactionUnlocked(const Timestamp& timestamp) {
     return false;
   }
 
+  // The common case: the timestamp is the latest one.
+  if (timestamps_in_flight_.empty() ||
+      timestamps_in_flight_.back().timestamp < timestamp.value()) {
+    timestamps_in_flight_.push_back({ timestamp.value(), RESERVED });
+  } else {
+    auto it = std::lower_bound(timestamps_in_flight_.begin(), timestamps_in_flight_.end(),
+                               timestamp.value(),
+                               [](const InFlightTxn& txn, Timestamp::val_type ts) {
+                                 return txn.timestamp < ts;
+                               });
+    if (it != timestamps_in_flight_.end() && it->timestamp == timestamp.value()) {
+      if (it->state != FINISHED) {
+        return false;
+      }
+      // The timestamp of an aborted transaction which hasn't been trimmed yet.
+      it->state = RESERVED;
+    } else {
+      timestamps_in_flight_.insert(it, { timestamp.value(), RESERVED });
+    }
+  }
+  num_in_flight_.fetch_add(1, std::memory_order_relaxed);
+
   if (timestamp < earliest_in_flight_) {
     earliest_in_flight_ = timestamp;
   }
-
-  return InsertIfNotPresent(&timestamps_in_flight_, timestamp.value(), RESERVED);
+  return true;
 }
 
 void MvccManager::AbortTransaction(Timestamp timestamp) {
@@ -146,16 +168,32 @@ void MvccManager::CommitTransaction(Timestamp timestamp) {
   }
 }
 
-MvccManager::TxnState MvccManager::RemoveInFlightAndGetStateUnlocked(Timestamp ts) {
+MvccManager::InFlightTxn* MvccManager::FindInFlightUnlocked(Timestamp ts) {
   DCHECK(lock_.is_locked());
 
-  auto it = timestamps_in_flight_.find(ts.value());
-  if (it == timestamps_in_flight_.end()) {
+  auto it = std::lower_bound(timestamps_in_flight_.begin(), timestamps_in_flight_.end(),
+                             ts.value(),
+                             [](const InFlightTxn& txn, Timestamp::val_type ts) {
+                               return txn.timestamp < ts;
+                             });
+  if (it == timestamps_in_flight_.end() || it->timestamp != ts.value() ||
+      it->state == FINISHED) {
+    return nullptr;
+  }
+  return &*it;
+}
+
+MvccManager::TxnState MvccManager::RemoveInFlightAndGetStateUnlocked(Timestamp ts) {
+  InFlightTxn* txn = FindInFlightUnlocked(ts);
+  if (txn == nullptr) {
     LOG(FATAL) << "Trying to remove timestamp which isn't in the in-flight set: "
                << ts.ToString();
   }
-  TxnState state = it->second;
-  timestamps_in_flight_.erase(it);
+  TxnState state = txn->state;
+  // The entry is trimmed by AdvanceEarliestInFlightTimestamp() once it
+  // reaches the front.
+  txn->state = FINISHED;
+  num_in_flight_.fetch_sub(1, std::memory_order_relaxed);
   return state;
 }
 
@@ -180,11 +218,14 @@ void MvccManager::CommitTransactionUnlocked(Timestamp timestamp,
 }
 
 void MvccManager::AdvanceEarliestInFlightTimestamp() {
+  while (!timestamps_in_flight_.empty() &&
+         timestamps_in_flight_.front().state == FINISHED) {
+    timestamps_in_flight_.pop_front();
+  }
   if (timestamps_in_flight_.empty()) {
     earliest_in_flight_ = Timestamp::kMax;
   } else {
-    earliest_in_flight_ = Timestamp(std::min_element(timestamps_in_flight_.begin(),
-                                                     timestamps_in_flight_.end())->first);
+    earliest_in_flight_ = Timestamp(timestamps_in_flight_.front().timestamp);
   }
 }
 
@@ -252,6 +293,7 @@ void MvccManager::AdjustCleanTime() {
     cur_snap_.all_committed_before_ = safe_time_;
   }
 
+  clean_time_.store(cur_snap_.all_committed_before_.value(), std::memory_order_release);
   DVLOG(4) << "Adjusted clean time to: " << cur_snap_.all_committed_before_;
 
   // Filter out any committed timestamps that now fall below the watermark
@@ -347,12 +389,7 @@ bool MvccManager::AreAllTransactionsCommittedUnlocked(Timestamp ts) const {
 bool MvccManager::AnyApplyingAtOrBeforeUnlocked(Timestamp ts) const {
   // TODO(todd) this is not actually checking on the applying txns, it's checking on
   // _all in-flight_. Is this a bug?
-  for (const InFlightMap::value_type entry : timestamps_in_flight_) {
-    if (entry.first <= ts.value()) {
-      return true;
-    }
-  }
-  return false;
+  return earliest_in_flight_ <= ts;
 }
 
 void MvccManager::TakeSnapshot(MvccSnapshot *snap) const {
@@ -378,9 +415,12 @@ Status MvccManager::WaitForApplyingTransactionsToCommit() const {
   Timestamp wait_for = Timestamp::kMin;
   {
     std::lock_guard<LockType> l(lock_);
-    for (const InFlightMap::value_type entry : timestamps_in_flight_) {
-      if (entry.second == APPLYING) {
-        wait_for = Timestamp(std::max(entry.first, wait_for.value()));
+    // The transactions are sorted by timestamp: the last APPLYING one is the
+    // highest.
+    for (auto it = timestamps_in_flight_.rbegin(); it != timestamps_in_flight_.rend(); ++it) {
+      if (it->state == APPLYING) {
+        wait_for = Timestamp(it->timestamp);
+        break;
       }
     }
   }
@@ -397,26 +437,34 @@ Status MvccManager::WaitForApplyingTransactionsToCommit() const {
 }
 
 bool MvccManager::AreAllTransactionsCommitted(Timestamp ts) const {
+  // The clean time only moves forward, so there is no need for the lock if
+  // 'ts' is already before it.
+  if (ts.value() < clean_time_.load(std::memory_order_acquire)) {
+    return true;
+  }
   std::lock_guard<LockType> l(lock_);
   return AreAllTransactionsCommittedUnlocked(ts);
 }
 
 int MvccManager::CountTransactionsInFlight() const {
-  std::lock_guard<LockType> l(lock_);
-  return timestamps_in_flight_.size();
+  return num_in_flight_.load(std::memory_order_relaxed);
 }
 
 Timestamp MvccManager::GetCleanTimestamp() const {
+  return Timestamp(clean_time_.load(std::memory_order_acquire));
+}
+
+Timestamp MvccManager::GetNoneCommittedAtOrAfterTimestamp() const {
   std::lock_guard<LockType> l(lock_);
-  return cur_snap_.all_committed_before_;
+  return cur_snap_.none_committed_at_or_after_;
 }
 
 void MvccManager::GetApplyingTransactionsTimestamps(std::vector<Timestamp>* timestamps) const {
   std::lock_guard<LockType> l(lock_);
-  timestamps->reserve(timestamps_in_flight_.size());
-  for (const InFlightMap::value_type entry : timestamps_in_flight_) {
-    if (entry.second == APPLYING) {
-      timestamps->push_back(Timestamp(entry.first));
+  timestamps->reserve(num_in_flight_.load(std::memory_order_relaxed));
+  for (const InFlightTxn& txn : timestamps_in_flight_) {
+    if (txn.state == APPLYING) {
+      timestamps->push_back(Timestamp(txn.timestamp));
     }
   }
 }
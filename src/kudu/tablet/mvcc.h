@@ -18,9 +18,9 @@
 #pragma once
 
 #include <atomic>
+#include <deque>
 #include <mutex>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 #include <gtest/gtest_prod.h>
@@ -266,13 +266,18 @@ class MvccManager {
 
   bool AreAllTransactionsCommitted(Timestamp ts) const;
 
-  // Return the number of transactions in flight..
+  // Return the number of transactions in flight. Doesn't take the lock.
   int CountTransactionsInFlight() const;
 
   // Returns the earliest possible timestamp for an uncommitted transaction.
   // All timestamps before this one are guaranteed to be committed.
+  // Doesn't take the lock.
   Timestamp GetCleanTimestamp() const;
 
+  // Returns the earliest timestamp at or after which no transaction has been
+  // committed. All committed transactions have lower timestamps.
+  Timestamp GetNoneCommittedAtOrAfterTimestamp() const;
+
   // Return the timestamps of all transactions which are currently 'APPLYING'
   // (i.e. those which have started to apply their operations to in-memory data
   // structures). Other transactions may have reserved their timestamps via
@@ -298,6 +303,7 @@ class MvccManager {
   friend class MvccTest;
   FRIEND_TEST(MvccTest, TestAreAllTransactionsCommitted);
   FRIEND_TEST(MvccTest, TestTxnAbort);
+  FRIEND_TEST(MvccTest, TestOutOfOrderFinishAndRestart);
   FRIEND_TEST(MvccTest, TestAutomaticCleanTimeMoveToSafeTimeOnCommit);
   FRIEND_TEST(MvccTest, TestWaitForApplyingTransactionsToCommit);
   FRIEND_TEST(MvccTest, TestWaitForCleanSnapshot_SnapAfterSafeTimeWithInFlights);
@@ -305,7 +311,15 @@ class MvccManager {
 
   enum TxnState {
     RESERVED,
-    APPLYING
+    APPLYING,
+    // Committed or aborted, but not yet trimmed from the front of
+    // 'timestamps_in_flight_'.
+    FINISHED
+  };
+
+  struct InFlightTxn {
+    Timestamp::val_type timestamp;
+    TxnState state;
   };
 
   bool InitTransactionUnlocked(const Timestamp& timestamp);
@@ -349,8 +363,12 @@ class MvccManager {
   void CommitTransactionUnlocked(Timestamp timestamp,
                                  bool* was_earliest_in_flight);
 
-  // Remove the timestamp 'ts' from the in-flight map.
-  // FATALs if the ts is not in the in-flight map.
+  // Returns the in-flight transaction with timestamp 'ts', or nullptr if
+  // there is none.
+  InFlightTxn* FindInFlightUnlocked(Timestamp ts);
+
+  // Remove the timestamp 'ts' from the in-flight set.
+  // FATALs if the ts is not in the in-flight set.
   // Returns its state.
   TxnState RemoveInFlightAndGetStateUnlocked(Timestamp ts);
 
@@ -359,9 +377,9 @@ class MvccManager {
   // currently in flight and on what is the latest value of 'safe_time_'.
   void AdjustCleanTime();
 
-  // Advances the earliest in-flight timestamp, based on which transactions are
-  // currently in-flight. Usually called when the previous earliest transaction
-  // commits or aborts.
+  // Advances the earliest in-flight timestamp, trimming the finished
+  // transactions from the front of 'timestamps_in_flight_'. Called when the
+  // previous earliest transaction commits or aborts.
   void AdvanceEarliestInFlightTimestamp();
 
   int GetNumWaitersForTests() const {
@@ -374,9 +392,20 @@ class MvccManager {
 
   MvccSnapshot cur_snap_;
 
-  // The set of timestamps corresponding to currently in-flight transactions.
-  typedef std::unordered_map<Timestamp::val_type, TxnState> InFlightMap;
-  InFlightMap timestamps_in_flight_;
+  // The currently in-flight transactions, sorted by timestamp.
+  //
+  // Timestamps are almost always assigned in increasing order, so a new
+  // transaction is appended and the earliest one is at the front. A
+  // transaction which commits or aborts out of order is only marked FINISHED,
+  // and is trimmed once all the transactions before it are finished too. This
+  // keeps the start and commit paths free of rehashing and of scans for the
+  // new earliest transaction.
+  typedef std::deque<InFlightTxn> InFlightQueue;
+  InFlightQueue timestamps_in_flight_;
+
+  // The number of transactions of 'timestamps_in_flight_' which aren't
+  // FINISHED.
+  std::atomic<int> num_in_flight_;
 
   // A transaction timestamp below which all transactions are either committed or in-flight,
   // meaning no new transactions will be started with a timestamp that is equal
@@ -384,10 +413,13 @@ class MvccManager {
   Timestamp safe_time_;
 
   // The minimum timestamp in timestamps_in_flight_, or Timestamp::kMax
-  // if that set is empty. This is cached in order to avoid having to iterate
-  // over timestamps_in_flight_ on every commit.
+  // if that set is empty.
   Timestamp earliest_in_flight_;
 
+  // A copy of 'cur_snap_.all_committed_before_', so that the clean time can
+  // be read without taking the lock.
+  std::atomic<Timestamp::val_type> clean_time_;
+
   mutable std::vector<WaitingState*> waiters_;
 
   std::atomic<bool> open_;
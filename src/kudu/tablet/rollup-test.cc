@@ -0,0 +1,200 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/rollup.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/repeated_field.h>
+#include <gtest/gtest.h>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/common/iterator.h"
+#include "kudu/common/partial_row.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/scan_aggregator.h"
+#include "kudu/common/schema.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/tablet/local_tablet_writer.h"
+#include "kudu/tablet/rowset.h"
+#include "kudu/tablet/tablet-test-util.h"
+#include "kudu/tablet/tablet.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+
+using google::protobuf::RepeatedPtrField;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace tablet {
+
+static ColumnSchema RollupColumn(const string& name, DataType type, bool nullable = false) {
+  ColumnStorageAttributes attrs;
+  attrs.rollup = true;
+  return ColumnSchema(name, type, nullable, nullptr, nullptr, attrs);
+}
+
+// The rows are grouped by 'group', and 'val' and 'str' are aggregated.
+static Schema CreateRollupTestSchema() {
+  return Schema({ RollupColumn("group", INT32),
+                  ColumnSchema("key", INT32),
+                  RollupColumn("val", INT64, true /* nullable */),
+                  RollupColumn("str", STRING),
+                  ColumnSchema("other", INT32) },
+                2);
+}
+
+class RollupTest : public KuduTabletTest {
+ public:
+  RollupTest()
+      : KuduTabletTest(CreateRollupTestSchema()) {
+  }
+
+ protected:
+  // Inserts the rows [0, 'num_rows'): row 'i' is in group 'i / 25', and has
+  // a NULL 'val' if 'i' is divisible by 10.
+  void InsertRows(int num_rows) {
+    LocalTabletWriter writer(tablet().get(), &client_schema_);
+    for (int i = 0; i < num_rows; i++) {
+      KuduPartialRow row(&client_schema_);
+      ASSERT_OK(row.SetInt32("group", i / 25));
+      ASSERT_OK(row.SetInt32("key", i));
+      if (i % 10 != 0) {
+        ASSERT_OK(row.SetInt64("val", i * 10L));
+      }
+      ASSERT_OK(row.SetStringCopy("str", Substitute("s$0", i % 7)));
+      ASSERT_OK(row.SetInt32("other", -i));
+      ASSERT_OK(writer.Insert(row));
+    }
+  }
+
+  void CreateAggregator(const vector<string>& group_by, unique_ptr<ScanAggregator>* agg) {
+    RepeatedPtrField<ScanAggregatePB> pbs;
+    auto add = [&](ScanAggregatePB::Type type, const string& column) {
+      ScanAggregatePB* pb = pbs.Add();
+      pb->set_type(type);
+      if (!column.empty()) {
+        pb->set_column(column);
+      }
+    };
+    add(ScanAggregatePB::COUNT, "");
+    add(ScanAggregatePB::COUNT, "val");
+    add(ScanAggregatePB::SUM, "val");
+    add(ScanAggregatePB::MIN, "val");
+    add(ScanAggregatePB::MAX, "str");
+    RepeatedPtrField<string> group_by_pb(group_by.begin(), group_by.end());
+    ASSERT_OK(ScanAggregator::Create(pbs, group_by_pb, 100, schema_, agg));
+  }
+
+  // Aggregates the rows of the tablet, grouped by 'group_by', letting the
+  // rowsets fold their rollups if 'fold' is true. Sets 'results' to the
+  // result rows and 'rows_read' to the number of rows which were read.
+  void Aggregate(const vector<string>& group_by, bool fold,
+                 vector<string>* results, int* rows_read) {
+    unique_ptr<ScanAggregator> agg;
+    NO_FATALS(CreateAggregator(group_by, &agg));
+    RowIteratorOptions opts;
+    opts.projection = &client_schema_;
+    opts.aggregator = fold ? agg.get() : nullptr;
+    unique_ptr<RowwiseIterator> iter;
+    ASSERT_OK(tablet()->NewRowIterator(std::move(opts), &iter));
+    ASSERT_OK(iter->Init(nullptr));
+
+    *rows_read = 0;
+    Arena arena(1024);
+    RowBlock block(iter->schema(), 100, &arena);
+    while (iter->HasNext()) {
+      arena.Reset();
+      ASSERT_OK(iter->NextBlock(&block));
+      ASSERT_OK(agg->AddRowBlock(block));
+      *rows_read += block.selection_vector()->CountSelected();
+    }
+
+    Arena result_arena(1024);
+    RowBlock result(agg->result_schema(), agg->num_groups(), &result_arena);
+    agg->GetResult(&result);
+    results->clear();
+    for (size_t i = 0; i < agg->num_groups(); i++) {
+      results->emplace_back(agg->result_schema().DebugRow(result.row(i)));
+    }
+  }
+};
+
+TEST_F(RollupTest, TestFoldRollups) {
+  NO_FATALS(InsertRows(100));
+  ASSERT_OK(tablet()->Flush());
+
+  for (const vector<string>& group_by : { vector<string>(), vector<string>({ "group" }) }) {
+    SCOPED_TRACE(group_by.size());
+    vector<string> expected;
+    int rows_read;
+    NO_FATALS(Aggregate(group_by, false, &expected, &rows_read));
+    ASSERT_EQ(100, rows_read);
+
+    // The rowset's rollup answers the whole scan.
+    vector<string> results;
+    NO_FATALS(Aggregate(group_by, true, &results, &rows_read));
+    ASSERT_EQ(0, rows_read);
+    ASSERT_EQ(expected, results);
+  }
+
+  vector<string> results;
+  int rows_read;
+  NO_FATALS(Aggregate({ "group" }, true, &results, &rows_read));
+  ASSERT_EQ(4, results.size());
+  ASSERT_EQ("(int32 group=0, int64 0:count(*)=25, int64 1:count(val)=22, "
+            "int64 2:sum(val)=2700, int64 3:min(val)=10, string 4:max(str)=\"s6\")",
+            results[0]);
+
+  // Grouping by a column which isn't in the rollup reads the rows.
+  NO_FATALS(Aggregate({ "key" }, true, &results, &rows_read));
+  ASSERT_EQ(100, rows_read);
+}
+
+TEST_F(RollupTest, TestRowSetsWithDeltasAreRead) {
+  NO_FATALS(InsertRows(50));
+  ASSERT_OK(tablet()->Flush());
+
+  // Update a row of the rowset: its rollup is no longer exact.
+  {
+    LocalTabletWriter writer(tablet().get(), &client_schema_);
+    KuduPartialRow row(&client_schema_);
+    ASSERT_OK(row.SetInt32("group", 0));
+    ASSERT_OK(row.SetInt32("key", 1));
+    ASSERT_OK(row.SetInt64("val", 1000));
+    ASSERT_OK(writer.Update(row));
+  }
+
+  vector<string> expected;
+  int rows_read;
+  NO_FATALS(Aggregate({ "group" }, false, &expected, &rows_read));
+  vector<string> results;
+  NO_FATALS(Aggregate({ "group" }, true, &results, &rows_read));
+  ASSERT_EQ(50, rows_read);
+  ASSERT_EQ(expected, results);
+  ASSERT_STR_CONTAINS(results[0], "sum(val)=3690");
+}
+
+} // namespace tablet
+} // namespace kudu
@@ -0,0 +1,397 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/rollup.h"
+
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/cfile/cfile_writer.h"
+#include "kudu/common/column_materialization_context.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/rowid.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/fs/block_manager.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/safe_math.h"
+#include "kudu/util/slice.h"
+
+namespace kudu {
+namespace tablet {
+
+using cfile::CFileIterator;
+using cfile::CFileReader;
+using cfile::CFileWriter;
+using fs::BlockCreationTransaction;
+using fs::IOContext;
+using fs::ReadableBlock;
+using fs::WritableBlock;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+// The number of groups read at a time.
+const size_t kReadBatchSize = 256;
+
+enum class SumType {
+  NONE,
+  INTEGER,
+  FLOATING_POINT,
+};
+
+// The kind of SUM of the values of 'type', like ScanAggregator's.
+SumType GetSumType(const TypeInfo* type) {
+  switch (type->type()) {
+    case INT8:
+    case INT16:
+    case INT32:
+    case INT64:
+      return SumType::INTEGER;
+    case FLOAT:
+    case DOUBLE:
+      return SumType::FLOATING_POINT;
+    default:
+      return SumType::NONE;
+  }
+}
+
+// The bytes of the value of 'cell': the cell data or, for BINARY-based
+// types, the indirect data.
+Slice ValueBytes(const TypeInfo* type, const void* cell) {
+  if (type->physical_type() == BINARY) {
+    return *static_cast<const Slice*>(cell);
+  }
+  return Slice(static_cast<const uint8_t*>(cell), type->size());
+}
+
+// The inverse of ValueBytes(): a pointer to a cell holding 'value', using
+// 'slice' as the cell of BINARY-based types.
+const void* ValueCell(const TypeInfo* type, const string& value, Slice* slice) {
+  if (type->physical_type() == BINARY) {
+    *slice = Slice(value);
+    return slice;
+  }
+  return value.data();
+}
+
+// Folds the non-NULL 'cell' into the aggregates 'col' of its column.
+void AddToColumn(const TypeInfo* type, const void* cell, AggregatedGroup::Column* col) {
+  Slice cur;
+  if (col->count == 0) {
+    col->min = ValueBytes(type, cell).ToString();
+    col->max = col->min;
+  } else if (type->Compare(cell, ValueCell(type, col->min, &cur)) < 0) {
+    col->min = ValueBytes(type, cell).ToString();
+  } else if (type->Compare(cell, ValueCell(type, col->max, &cur)) > 0) {
+    col->max = ValueBytes(type, cell).ToString();
+  }
+  col->count++;
+
+  int64_t v;
+  switch (type->type()) {
+    case INT8: v = *static_cast<const int8_t*>(cell); break;
+    case INT16: v = *static_cast<const int16_t*>(cell); break;
+    case INT32: v = *static_cast<const int32_t*>(cell); break;
+    case INT64: v = *static_cast<const int64_t*>(cell); break;
+    case FLOAT:
+      col->double_sum += *static_cast<const float*>(cell);
+      return;
+    case DOUBLE:
+      col->double_sum += *static_cast<const double*>(cell);
+      return;
+    default:
+      return;
+  }
+  bool overflowed;
+  col->int_sum = AddWithOverflowCheck<int64_t>(col->int_sum, v, &overflowed);
+  col->sum_overflowed |= overflowed;
+}
+
+Status DecodeGroup(const vector<const TypeInfo*>& key_types,
+                   const vector<const TypeInfo*>& col_types,
+                   Slice entry,
+                   AggregatedGroup* group) {
+  const Status corruption = Status::Corruption("bad rollup entry");
+  Slice value;
+  for (const TypeInfo* type : key_types) {
+    if (!GetLengthPrefixedSlice(&entry, &value) ||
+        (type->physical_type() != BINARY && value.size() != type->size())) {
+      return corruption;
+    }
+    group->key_values.emplace_back(value.ToString());
+  }
+  uint64_t count;
+  if (!GetVarint64(&entry, &count)) {
+    return corruption;
+  }
+  group->count = count;
+  for (const TypeInfo* type : col_types) {
+    group->columns.emplace_back();
+    AggregatedGroup::Column* col = &group->columns.back();
+    if (!GetVarint64(&entry, &count)) {
+      return corruption;
+    }
+    col->count = count;
+    if (count == 0) {
+      continue;
+    }
+    if (!GetLengthPrefixedSlice(&entry, &value)) {
+      return corruption;
+    }
+    col->min = value.ToString();
+    if (!GetLengthPrefixedSlice(&entry, &value)) {
+      return corruption;
+    }
+    col->max = value.ToString();
+    const SumType sum_type = GetSumType(type);
+    if (sum_type == SumType::NONE) {
+      continue;
+    }
+    if (entry.size() < 1 + sizeof(uint64_t)) {
+      return corruption;
+    }
+    col->sum_overflowed = entry[0] != 0;
+    uint64_t sum = DecodeFixed64(entry.data() + 1);
+    entry.remove_prefix(1 + sizeof(uint64_t));
+    if (sum_type == SumType::INTEGER) {
+      col->int_sum = static_cast<int64_t>(sum);
+    } else {
+      memcpy(&col->double_sum, &sum, sizeof(sum));
+    }
+  }
+  if (!entry.empty()) {
+    return corruption;
+  }
+  return Status::OK();
+}
+
+} // anonymous namespace
+
+////////////////////////////////////////////////////////////
+// RollupWriter
+////////////////////////////////////////////////////////////
+
+RollupWriter::RollupWriter(const Schema* schema, unique_ptr<WritableBlock> block)
+    : schema_(schema),
+      block_id_(block->id()),
+      has_group_(false),
+      written_size_(0) {
+  DCHECK(schema_->has_rollup());
+  for (int i = 0; i < schema_->num_columns(); i++) {
+    if (!schema_->column(i).attributes().rollup) {
+      continue;
+    }
+    if (i < schema_->num_key_columns()) {
+      key_col_idxs_.push_back(i);
+    } else {
+      col_idxs_.push_back(i);
+    }
+  }
+
+  cfile::WriterOptions opts;
+  // The rollup is always read from its first group.
+  opts.write_validx = false;
+  opts.write_posidx = true;
+  opts.storage_attributes.encoding = PLAIN_ENCODING;
+  opts.storage_attributes.compression = LZ4;
+  writer_.reset(new CFileWriter(std::move(opts), GetTypeInfo(BINARY), false, std::move(block)));
+}
+
+RollupWriter::~RollupWriter() {
+}
+
+Status RollupWriter::Start() {
+  return writer_->Start();
+}
+
+Status RollupWriter::AppendBlock(const RowBlock& block) {
+  const bool projected = block.schema().num_columns() != schema_->num_columns();
+  auto block_column = [&](int col_idx) {
+    int block_idx = col_idx;
+    if (projected) {
+      block_idx = block.schema().find_column_by_id(schema_->column_id(col_idx));
+      DCHECK_NE(Schema::kColumnNotFound, block_idx);
+    }
+    return block.column_block(block_idx);
+  };
+  vector<ColumnBlock> key_cols;
+  for (int col_idx : key_col_idxs_) {
+    key_cols.emplace_back(block_column(col_idx));
+  }
+  vector<ColumnBlock> cols;
+  for (int col_idx : col_idxs_) {
+    cols.emplace_back(block_column(col_idx));
+  }
+
+  for (size_t i = 0; i < block.nrows(); i++) {
+    bool same_group = has_group_;
+    for (size_t k = 0; same_group && k < key_cols.size(); k++) {
+      same_group = ValueBytes(key_cols[k].type_info(), key_cols[k].cell_ptr(i)) ==
+          Slice(group_.key_values[k]);
+    }
+    if (!same_group) {
+      if (has_group_) {
+        RETURN_NOT_OK(WriteGroup());
+      }
+      group_ = AggregatedGroup();
+      for (const ColumnBlock& key_col : key_cols) {
+        group_.key_values.emplace_back(
+            ValueBytes(key_col.type_info(), key_col.cell_ptr(i)).ToString());
+      }
+      group_.columns.resize(cols.size());
+      has_group_ = true;
+    }
+
+    group_.count++;
+    for (size_t c = 0; c < cols.size(); c++) {
+      const ColumnBlock& col = cols[c];
+      if (col.is_nullable() && col.is_null(i)) {
+        continue;
+      }
+      AddToColumn(col.type_info(), col.cell_ptr(i), &group_.columns[c]);
+    }
+  }
+  return Status::OK();
+}
+
+Status RollupWriter::WriteGroup() {
+  entry_.clear();
+  for (const string& value : group_.key_values) {
+    PutLengthPrefixedSlice(&entry_, Slice(value));
+  }
+  PutVarint64(&entry_, group_.count);
+  for (size_t c = 0; c < col_idxs_.size(); c++) {
+    const AggregatedGroup::Column& col = group_.columns[c];
+    PutVarint64(&entry_, col.count);
+    if (col.count == 0) {
+      continue;
+    }
+    PutLengthPrefixedSlice(&entry_, Slice(col.min));
+    PutLengthPrefixedSlice(&entry_, Slice(col.max));
+    const SumType sum_type = GetSumType(schema_->column(col_idxs_[c]).type_info());
+    if (sum_type == SumType::NONE) {
+      continue;
+    }
+    entry_.push_back(col.sum_overflowed ? 1 : 0);
+    uint64_t sum;
+    if (sum_type == SumType::INTEGER) {
+      sum = static_cast<uint64_t>(col.int_sum);
+    } else {
+      memcpy(&sum, &col.double_sum, sizeof(sum));
+    }
+    PutFixed64(&entry_, sum);
+  }
+  Slice entry(entry_);
+  RETURN_NOT_OK(writer_->AppendEntries(&entry, 1));
+  written_size_ += entry_.size();
+  return Status::OK();
+}
+
+Status RollupWriter::FinishAndReleaseBlock(BlockCreationTransaction* transaction) {
+  if (has_group_) {
+    RETURN_NOT_OK(WriteGroup());
+    has_group_ = false;
+  }
+  return writer_->FinishAndReleaseBlock(transaction);
+}
+
+////////////////////////////////////////////////////////////
+// RollupReader
+////////////////////////////////////////////////////////////
+
+Status RollupReader::OpenNoInit(vector<const TypeInfo*> key_types,
+                                vector<const TypeInfo*> col_types,
+                                unique_ptr<ReadableBlock> block,
+                                shared_ptr<MemTracker> parent_mem_tracker,
+                                const IOContext* io_context,
+                                unique_ptr<RollupReader>* reader) {
+  cfile::ReaderOptions opts;
+  opts.parent_mem_tracker = std::move(parent_mem_tracker);
+  opts.io_context = io_context;
+  unique_ptr<CFileReader> cfile_reader;
+  RETURN_NOT_OK(CFileReader::OpenNoInit(std::move(block), std::move(opts), &cfile_reader));
+  reader->reset(new RollupReader(std::move(key_types), std::move(col_types),
+                                 std::move(cfile_reader)));
+  return Status::OK();
+}
+
+RollupReader::RollupReader(vector<const TypeInfo*> key_types,
+                           vector<const TypeInfo*> col_types,
+                           unique_ptr<CFileReader> reader)
+    : key_types_(std::move(key_types)),
+      col_types_(std::move(col_types)),
+      reader_(std::move(reader)) {
+}
+
+RollupReader::~RollupReader() {
+}
+
+uint64_t RollupReader::file_size() const {
+  return reader_->file_size();
+}
+
+Status RollupReader::ReadGroups(const IOContext* io_context,
+                                vector<AggregatedGroup>* groups) const {
+  groups->clear();
+  RETURN_NOT_OK(reader_->Init(io_context));
+  rowid_t num_entries;
+  RETURN_NOT_OK(reader_->CountRows(&num_entries));
+  if (num_entries == 0) {
+    // The rowset has no rows.
+    return Status::OK();
+  }
+
+  unique_ptr<CFileIterator> iter;
+  RETURN_NOT_OK(reader_->NewIterator(&iter, CFileReader::CACHE_BLOCK, io_context));
+  RETURN_NOT_OK(iter->SeekToFirst());
+  groups->reserve(num_entries);
+  Arena arena(1024);
+  vector<Slice> entries(kReadBatchSize);
+  SelectionVector sel(kReadBatchSize);
+  while (iter->HasNext()) {
+    arena.Reset();
+    size_t n = kReadBatchSize;
+    RETURN_NOT_OK(iter->PrepareBatch(&n));
+    ColumnBlock block(GetTypeInfo(BINARY), nullptr, entries.data(), n, &arena);
+    sel.Resize(n);
+    sel.SetAllTrue();
+    ColumnMaterializationContext ctx(0, nullptr, &block, &sel);
+    RETURN_NOT_OK(iter->Scan(&ctx));
+    RETURN_NOT_OK(iter->FinishBatch());
+    for (size_t i = 0; i < n; i++) {
+      groups->emplace_back();
+      RETURN_NOT_OK(DecodeGroup(key_types_, col_types_, entries[i], &groups->back()));
+    }
+  }
+  return Status::OK();
+}
+
+} // namespace tablet
+} // namespace kudu
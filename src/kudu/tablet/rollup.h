@@ -0,0 +1,158 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_TABLET_ROLLUP_H
+#define KUDU_TABLET_ROLLUP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "kudu/common/scan_aggregator.h"
+#include "kudu/fs/block_id.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class MemTracker;
+class RowBlock;
+class Schema;
+class TypeInfo;
+
+namespace cfile {
+class CFileReader;
+class CFileWriter;
+} // namespace cfile
+
+namespace fs {
+class BlockCreationTransaction;
+class ReadableBlock;
+class WritableBlock;
+struct IOContext;
+} // namespace fs
+
+namespace tablet {
+
+// The rollup of a DiskRowSet pre-aggregates its rows, grouped by the values of
+// the key columns whose storage attributes set 'rollup' (a prefix of the
+// primary key, possibly empty). For each group, it stores the number of rows
+// and, for each non-key column which sets 'rollup', the COUNT, MIN and MAX of
+// its non-NULL values and, for integer and floating point columns, their SUM.
+// Aggregate scans may fold the rollup of a rowset instead of reading its rows:
+// see DiskRowSet::FoldRollup().
+//
+// It's a BINARY CFile with one entry per group, in key order. Each entry is:
+// - the length-prefixed value of each key column,
+// - the varint number of rows,
+// - for each aggregated column, the varint number of non-NULL values and,
+//   if it's positive, the length-prefixed MIN and MAX values followed, if
+//   the column has a SUM, by an overflow byte and the fixed 64-bit sum.
+// Values are the cell data or, for BINARY-based columns, the bytes of the
+// value.
+
+// Writes the rollup of a DiskRowSet.
+//
+// Rows are appended in primary key order, so the rows of a group are
+// consecutive and each group is written as soon as it's complete.
+class RollupWriter {
+ public:
+  // Creates a writer of the rollup of rows of 'schema', which must have one
+  // (see Schema::has_rollup()). 'schema' must outlive the writer.
+  RollupWriter(const Schema* schema, std::unique_ptr<fs::WritableBlock> block);
+
+  ~RollupWriter();
+
+  Status Start();
+
+  // Folds the rows of 'block', which follow those of the previous blocks in
+  // primary key order, into their groups. 'block' may have a projection of
+  // the schema, as long as it has all the rollup columns.
+  Status AppendBlock(const RowBlock& block);
+
+  // Writes the last group and closes the CFile, releasing its block to
+  // 'transaction'.
+  Status FinishAndReleaseBlock(fs::BlockCreationTransaction* transaction);
+
+  // The indexes in the schema of the columns the rows are grouped by and of
+  // the aggregated columns.
+  const std::vector<int>& key_col_idxs() const { return key_col_idxs_; }
+  const std::vector<int>& col_idxs() const { return col_idxs_; }
+
+  // The size of the groups written so far.
+  size_t written_size() const { return written_size_; }
+
+  const BlockId& block_id() const { return block_id_; }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(RollupWriter);
+
+  // Encodes the current group and appends it to the CFile.
+  Status WriteGroup();
+
+  const Schema* schema_;
+  std::vector<int> key_col_idxs_;
+  std::vector<int> col_idxs_;
+
+  const BlockId block_id_;
+  std::unique_ptr<cfile::CFileWriter> writer_;
+
+  // The group of the last rows appended, if any.
+  bool has_group_;
+  AggregatedGroup group_;
+
+  faststring entry_;
+  size_t written_size_;
+};
+
+// Reads the rollup of a DiskRowSet.
+class RollupReader {
+ public:
+  // Lazily opens the rollup stored in 'block', whose key columns and
+  // aggregated columns have the types 'key_types' and 'col_types'. It's
+  // fully opened by the first read.
+  static Status OpenNoInit(std::vector<const TypeInfo*> key_types,
+                           std::vector<const TypeInfo*> col_types,
+                           std::unique_ptr<fs::ReadableBlock> block,
+                           std::shared_ptr<MemTracker> parent_mem_tracker,
+                           const fs::IOContext* io_context,
+                           std::unique_ptr<RollupReader>* reader);
+
+  ~RollupReader();
+
+  // Sets 'groups' to the groups of the rollup, in key order.
+  Status ReadGroups(const fs::IOContext* io_context,
+                    std::vector<AggregatedGroup>* groups) const;
+
+  uint64_t file_size() const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(RollupReader);
+
+  RollupReader(std::vector<const TypeInfo*> key_types,
+               std::vector<const TypeInfo*> col_types,
+               std::unique_ptr<cfile::CFileReader> reader);
+
+  const std::vector<const TypeInfo*> key_types_;
+  const std::vector<const TypeInfo*> col_types_;
+  std::unique_ptr<cfile::CFileReader> reader_;
+};
+
+} // namespace tablet
+} // namespace kudu
+#endif
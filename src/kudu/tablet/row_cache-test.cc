@@ -0,0 +1,170 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/row_cache.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags_declare.h>
+#include <gtest/gtest.h>
+
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/iterator.h"
+#include "kudu/common/partial_row.h"
+#include "kudu/common/scan_spec.h"
+#include "kudu/common/schema.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/tablet/local_tablet_writer.h"
+#include "kudu/tablet/tablet-test-util.h"
+#include "kudu/tablet/tablet.h"
+#include "kudu/tablet/tablet_metrics.h"
+#include "kudu/util/auto_release_pool.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/test_macros.h"
+
+DECLARE_int32(tablet_row_cache_capacity_mb);
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace kudu {
+namespace tablet {
+
+static Schema CreateRowCacheTestSchema() {
+  return Schema({ ColumnSchema("key", INT32),
+                  ColumnSchema("val", STRING),
+                  ColumnSchema("val2", INT32, true) },
+                1);
+}
+
+class RowCacheTest : public KuduTabletTest {
+ public:
+  RowCacheTest()
+      : KuduTabletTest(CreateRowCacheTestSchema()) {
+    // The tablet is created by SetUp().
+    FLAGS_tablet_row_cache_capacity_mb = 1;
+  }
+
+ protected:
+  void Write(RowOperationsPB::Type type, int32_t key, const string& val) {
+    LocalTabletWriter writer(tablet().get(), &client_schema_);
+    KuduPartialRow row(&client_schema_);
+    ASSERT_OK(row.SetInt32(0, key));
+    if (type != RowOperationsPB::DELETE) {
+      ASSERT_OK(row.SetStringCopy(1, val));
+    }
+    switch (type) {
+      case RowOperationsPB::INSERT: ASSERT_OK(writer.Insert(row)); break;
+      case RowOperationsPB::UPDATE: ASSERT_OK(writer.Update(row)); break;
+      case RowOperationsPB::DELETE: ASSERT_OK(writer.Delete(row)); break;
+      default: FAIL();
+    }
+  }
+
+  // Looks up 'key' as the tablet server would, projected on 'projection'.
+  void Lookup(const Schema& projection, int32_t key, vector<string>* rows) {
+    Arena arena(1024);
+    AutoReleasePool pool;
+    ScanSpec spec;
+    spec.AddPredicate(ColumnPredicate::Equality(schema_.column(0), &key));
+    spec.OptimizeScan(schema_, &arena, &pool, true);
+    unique_ptr<RowwiseIterator> iter;
+    ASSERT_OK(tablet()->NewRowIterator(projection, &iter));
+    ASSERT_OK(iter->Init(&spec));
+    rows->clear();
+    ASSERT_OK(IterateToStringList(iter.get(), rows));
+  }
+
+  int64_t hits() const {
+    return harness_->tablet()->metrics()->row_cache_hits->value();
+  }
+  int64_t misses() const {
+    return harness_->tablet()->metrics()->row_cache_misses->value();
+  }
+};
+
+TEST_F(RowCacheTest, TestLookups) {
+  NO_FATALS(Write(RowOperationsPB::INSERT, 1, "a"));
+  NO_FATALS(Write(RowOperationsPB::INSERT, 2, "b"));
+  ASSERT_OK(tablet()->Flush());
+
+  const vector<string> kExpected = { R"((int32 key=1, string val="a", int32 val2=NULL))" };
+  vector<string> rows;
+  NO_FATALS(Lookup(client_schema_, 1, &rows));
+  ASSERT_EQ(kExpected, rows);
+  ASSERT_EQ(0, hits());
+  ASSERT_EQ(1, misses());
+
+  NO_FATALS(Lookup(client_schema_, 1, &rows));
+  ASSERT_EQ(kExpected, rows);
+  ASSERT_EQ(1, hits());
+
+  // The cached row is projected.
+  const Schema projection({ ColumnSchema("val", STRING) }, 0);
+  NO_FATALS(Lookup(projection, 1, &rows));
+  ASSERT_EQ(vector<string>({ R"((string val="a"))" }), rows);
+  ASSERT_EQ(2, hits());
+
+  // Rows which aren't found aren't cached.
+  NO_FATALS(Lookup(client_schema_, 3, &rows));
+  ASSERT_TRUE(rows.empty());
+  NO_FATALS(Lookup(client_schema_, 3, &rows));
+  ASSERT_TRUE(rows.empty());
+  ASSERT_EQ(2, hits());
+  ASSERT_EQ(3, misses());
+}
+
+TEST_F(RowCacheTest, TestInvalidation) {
+  NO_FATALS(Write(RowOperationsPB::INSERT, 1, "a"));
+  vector<string> rows;
+  NO_FATALS(Lookup(client_schema_, 1, &rows));
+  NO_FATALS(Lookup(client_schema_, 1, &rows));
+  ASSERT_EQ(1, hits());
+
+  // Writes invalidate the cached row.
+  NO_FATALS(Write(RowOperationsPB::UPDATE, 1, "b"));
+  NO_FATALS(Lookup(client_schema_, 1, &rows));
+  ASSERT_EQ(vector<string>({ R"((int32 key=1, string val="b", int32 val2=NULL))" }), rows);
+  ASSERT_EQ(1, hits());
+  NO_FATALS(Lookup(client_schema_, 1, &rows));
+  ASSERT_EQ(vector<string>({ R"((int32 key=1, string val="b", int32 val2=NULL))" }), rows);
+  ASSERT_EQ(2, hits());
+
+  NO_FATALS(Write(RowOperationsPB::DELETE, 1, ""));
+  NO_FATALS(Lookup(client_schema_, 1, &rows));
+  ASSERT_TRUE(rows.empty());
+  ASSERT_EQ(2, hits());
+}
+
+// Range scans don't go through the row cache.
+TEST_F(RowCacheTest, TestRangeScan) {
+  NO_FATALS(Write(RowOperationsPB::INSERT, 1, "a"));
+  NO_FATALS(Write(RowOperationsPB::INSERT, 2, "b"));
+  vector<string> rows;
+  ASSERT_OK(DumpTablet(*tablet(), client_schema_, &rows));
+  ASSERT_EQ(2, rows.size());
+  ASSERT_EQ(0, hits() + misses());
+}
+
+} // namespace tablet
+} // namespace kudu
@@ -0,0 +1,189 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/row_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/tablet/mvcc.h"
+#include "kudu/util/hash_util.h"
+
+using std::string;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace tablet {
+
+namespace {
+
+// The header of a cached row, followed by the row in its contiguous format
+// and by its indirect data.
+struct EntryHeader {
+  // No write to the row was applied after this timestamp.
+  uint64_t last_write;
+  uint32_t schema_version;
+  uint32_t padding;
+};
+
+} // anonymous namespace
+
+RowCache::RowCache(size_t capacity)
+    : cache_(NewCache(capacity, "row")) {
+}
+
+int RowCache::StripeIndex(const Slice& key) {
+  return HashUtil::MurmurHash2_64(key.data(), key.size(), 0) % kNumStripes;
+}
+
+bool RowCache::Lookup(const Slice& key, uint32_t schema_version, const MvccSnapshot& snap,
+                      RowHandle* handle) {
+  Cache::UniqueHandle h(cache_->Lookup(key, Cache::EXPECT_IN_CACHE),
+                        Cache::HandleDeleter(cache_.get()));
+  if (!h) {
+    return false;
+  }
+  EntryHeader header;
+  memcpy(&header, cache_->Value(h.get()).data(), sizeof(header));
+  if (header.schema_version != schema_version ||
+      snap.MayHaveUncommittedTransactionsAtOrBefore(Timestamp(header.last_write))) {
+    return false;
+  }
+  handle->row_data_ = cache_->Value(h.get()).data() + sizeof(header);
+  handle->handle_ = std::move(h);
+  return true;
+}
+
+RowCache::ReadToken RowCache::BeginRead(const Slice& key) const {
+  ReadToken token;
+  token.stripe = StripeIndex(key);
+  const Stripe& stripe = stripes_[token.stripe];
+  std::lock_guard<simple_spinlock> l(stripe.lock);
+  token.epoch = stripe.epoch;
+  token.last_write = stripe.last_write;
+  return token;
+}
+
+void RowCache::Insert(const Slice& key, const ReadToken& token, const MvccSnapshot& snap,
+                      uint32_t schema_version, const ConstContiguousRow& row) {
+  // Writes applied before the read started must be visible in the row.
+  if (snap.MayHaveUncommittedTransactionsAtOrBefore(token.last_write)) {
+    return;
+  }
+
+  const Schema* schema = row.schema();
+  const auto has_indirect_data = [&](int col_idx) {
+    const ColumnSchema& col = schema->column(col_idx);
+    return col.type_info()->physical_type() == BINARY &&
+        !(col.is_nullable() && row.is_null(col_idx));
+  };
+  const size_t row_size = ContiguousRowHelper::row_size(*schema);
+  size_t indirect_size = 0;
+  for (int i = 0; i < schema->num_columns(); i++) {
+    if (has_indirect_data(i)) {
+      indirect_size += reinterpret_cast<const Slice*>(row.cell_ptr(i))->size();
+    }
+  }
+  const size_t entry_size = sizeof(EntryHeader) + row_size + indirect_size;
+  Cache::PendingHandle* ph = cache_->Allocate(key, entry_size);
+  if (PREDICT_FALSE(ph == nullptr)) {
+    return;
+  }
+
+  // Copy the row, pointing its cells at the copy of their indirect data.
+  uint8_t* entry = cache_->MutableValue(ph);
+  EntryHeader header;
+  header.last_write = token.last_write.value();
+  header.schema_version = schema_version;
+  header.padding = 0;
+  memcpy(entry, &header, sizeof(header));
+  uint8_t* row_data = entry + sizeof(header);
+  memcpy(row_data, row.row_data(), row_size);
+  uint8_t* indirect = row_data + row_size;
+  ContiguousRow copy(schema, row_data);
+  for (int i = 0; i < schema->num_columns(); i++) {
+    if (has_indirect_data(i)) {
+      Slice* cell = reinterpret_cast<Slice*>(copy.mutable_cell_ptr(i));
+      memcpy(indirect, cell->data(), cell->size());
+      *cell = Slice(indirect, cell->size());
+      indirect += cell->size();
+    }
+  }
+
+  Stripe& stripe = stripes_[token.stripe];
+  std::lock_guard<simple_spinlock> l(stripe.lock);
+  if (stripe.epoch != token.epoch) {
+    // A row of the stripe was written to since the read started.
+    cache_->Free(ph);
+    return;
+  }
+  cache_->Release(cache_->Insert(ph, nullptr));
+}
+
+void RowCache::Invalidate(const Slice& key, Timestamp timestamp) {
+  Stripe& stripe = stripes_[StripeIndex(key)];
+  std::lock_guard<simple_spinlock> l(stripe.lock);
+  stripe.epoch++;
+  stripe.last_write = std::max(stripe.last_write, timestamp);
+  cache_->Erase(key);
+}
+
+MaterializedRowIterator::MaterializedRowIterator(const Schema* full_schema,
+                                                 const Schema& projection)
+    : full_schema_(full_schema),
+      projection_(projection),
+      projector_(full_schema_, &projection_),
+      stats_(projection_.num_columns()),
+      arena_(1024),
+      next_row_(0) {
+}
+
+Status MaterializedRowIterator::Init(ScanSpec* /*spec*/) {
+  return projector_.Init();
+}
+
+Status MaterializedRowIterator::NextBlock(RowBlock* dst) {
+  const size_t n = std::min(rows_.size() - next_row_, dst->row_capacity());
+  dst->Resize(n);
+  if (dst->arena()) {
+    dst->arena()->Reset();
+  }
+  dst->selection_vector()->SetAllTrue();
+  for (size_t i = 0; i < n; i++) {
+    ConstContiguousRow src_row(full_schema_, rows_[next_row_++]);
+    RowBlockRow dst_row = dst->row(i);
+    RETURN_NOT_OK(projector_.ProjectRowForRead(src_row, &dst_row, dst->arena()));
+  }
+  return Status::OK();
+}
+
+string MaterializedRowIterator::ToString() const {
+  return Substitute("materialized rows($0)", rows_.size());
+}
+
+} // namespace tablet
+} // namespace kudu
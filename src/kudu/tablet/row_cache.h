@@ -0,0 +1,195 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "kudu/common/iterator.h"
+#include "kudu/common/iterator_stats.h"
+#include "kudu/common/row.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/timestamp.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/cache.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class RowBlock;
+class ScanSpec;
+
+namespace tablet {
+
+class MvccSnapshot;
+
+// A cache of the rows of a tablet, keyed by their encoded primary key, which
+// serves repeated point lookups without going through the rowsets.
+//
+// The cached rows are invalidated when written to. Since writes are applied
+// before they're committed, and since reads may run at any snapshot, each
+// entry records a timestamp after which no write to its row was applied. An
+// entry is only used by reads whose snapshot includes all transactions up to
+// that timestamp.
+//
+// This class is thread-safe.
+class RowCache {
+ public:
+  // The state of the cache for a row when starting to read it, which tells
+  // whether the row read may be inserted.
+  struct ReadToken {
+    int stripe;
+    uint64_t epoch;
+    Timestamp last_write;
+  };
+
+  // A reference to a cached row, which remains valid while the handle is
+  // alive.
+  class RowHandle {
+   public:
+    RowHandle()
+        : handle_(nullptr, Cache::HandleDeleter(nullptr)),
+          row_data_(nullptr) {
+    }
+
+    // The data of the row, in the contiguous row format of the schema passed
+    // to Insert(). Indirect data is stored in the entry itself.
+    const uint8_t* row_data() const {
+      return row_data_;
+    }
+
+   private:
+    friend class RowCache;
+
+    Cache::UniqueHandle handle_;
+    const uint8_t* row_data_;
+  };
+
+  // Creates a cache of up to 'capacity' bytes.
+  explicit RowCache(size_t capacity);
+
+  // Looks up the row with the encoded primary key 'key'. Returns true and
+  // sets 'handle' if it's cached with the given schema version and its
+  // latest value is visible in 'snap'.
+  bool Lookup(const Slice& key, uint32_t schema_version, const MvccSnapshot& snap,
+              RowHandle* handle);
+
+  // Returns the state of the cache for 'key', which must be called before
+  // starting to read the row.
+  ReadToken BeginRead(const Slice& key) const;
+
+  // Inserts 'row', read at 'snap' after calling BeginRead() for its key. The
+  // row isn't inserted if the row was written to since, or if writes applied
+  // before aren't visible in 'snap'.
+  void Insert(const Slice& key, const ReadToken& token, const MvccSnapshot& snap,
+              uint32_t schema_version, const ConstContiguousRow& row);
+
+  // Invalidates the cached row with the encoded primary key 'key', which is
+  // being written to by a transaction with the given timestamp.
+  void Invalidate(const Slice& key, Timestamp timestamp);
+
+ private:
+  static constexpr int kNumStripes = 64;
+
+  // Writes to the keys mapped to a stripe.
+  struct Stripe {
+    mutable simple_spinlock lock;
+    // Incremented on each write.
+    uint64_t epoch = 0;
+    // The highest timestamp of the writes applied so far.
+    Timestamp last_write = Timestamp::kMin;
+  };
+
+  static int StripeIndex(const Slice& key);
+
+  const std::unique_ptr<Cache> cache_;
+  Stripe stripes_[kNumStripes];
+
+  DISALLOW_COPY_AND_ASSIGN(RowCache);
+};
+
+// An iterator over rows materialized in memory with the full schema of a
+// tablet, projected on the fly. Used to serve point lookups from a RowCache.
+class MaterializedRowIterator : public RowwiseIterator {
+ public:
+  // 'full_schema' must remain valid for the lifetime of the iterator.
+  MaterializedRowIterator(const Schema* full_schema, const Schema& projection);
+
+  // Adds a row to return, in 'full_schema'. The row and its indirect data
+  // must remain valid for the lifetime of the iterator.
+  void AddRow(const uint8_t* row_data) {
+    rows_.push_back(row_data);
+  }
+
+  // Keeps 'handle' alive for the lifetime of the iterator.
+  void HoldHandle(RowCache::RowHandle handle) {
+    handle_ = std::move(handle);
+  }
+
+  // The arena which may hold the rows.
+  Arena* arena() { return &arena_; }
+
+  // Sets the stats returned by GetIteratorStats(), one per projected column,
+  // e.g. those of reading the rows.
+  void SetIteratorStats(std::vector<IteratorStats> stats) {
+    DCHECK_EQ(projection_.num_columns(), stats.size());
+    stats_ = std::move(stats);
+  }
+
+  Status Init(ScanSpec* spec) override;
+
+  bool HasNext() const override {
+    return next_row_ < rows_.size();
+  }
+
+  Status NextBlock(RowBlock* dst) override;
+
+  std::string ToString() const override;
+
+  const Schema& schema() const override {
+    return projection_;
+  }
+
+  void GetIteratorStats(std::vector<IteratorStats>* stats) const override {
+    *stats = stats_;
+  }
+
+ private:
+  const Schema* full_schema_;
+  const Schema projection_;
+  RowProjector projector_;
+  std::vector<IteratorStats> stats_;
+
+  Arena arena_;
+  RowCache::RowHandle handle_;
+  std::vector<const uint8_t*> rows_;
+  size_t next_row_;
+
+  DISALLOW_COPY_AND_ASSIGN(MaterializedRowIterator);
+};
+
+} // namespace tablet
+} // namespace kudu
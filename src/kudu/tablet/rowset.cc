@@ -23,11 +23,13 @@
 #include <utility>
 #include <vector>
 
+#include "kudu/codegen/key_encoder.h"
 #include "kudu/common/generic_iterators.h"
 #include "kudu/common/iterator.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/faststring.h"
 #include "kudu/tablet/rowset_metadata.h"
 
 using std::shared_ptr;
@@ -42,16 +44,51 @@ using fs::IOContext;
 
 namespace tablet {
 
+Status RowSet::CheckRowsPresent(const vector<const RowSetKeyProbe*>& probes,
+                                const vector<ProbeStats*>& stats,
+                                const IOContext* io_context,
+                                vector<bool>* present) const {
+  DCHECK_EQ(probes.size(), stats.size());
+  present->assign(probes.size(), false);
+  for (int i = 0; i < probes.size(); i++) {
+    bool row_present;
+    RETURN_NOT_OK(CheckRowPresent(*probes[i], io_context, &row_present, stats[i]));
+    (*present)[i] = row_present;
+  }
+  return Status::OK();
+}
+
+RowSetKeyProbe::RowSetKeyProbe(ConstContiguousRow row_key,
+                               const codegen::KeyEncoderFunctions& key_encoder)
+    : row_key_(row_key) {
+  faststring encoded;
+  key_encoder.Encode(row_key_, &encoded);
+  const Schema* schema = row_key_.schema();
+  vector<const void*> raw_keys;
+  raw_keys.reserve(schema->num_key_columns());
+  for (int i = 0; i < schema->num_key_columns(); i++) {
+    raw_keys.push_back(row_key_.cell_ptr(i));
+  }
+  encoded_key_.reset(new EncodedKey(&encoded, &raw_keys, schema->num_key_columns()));
+  bloom_probe_ = BloomKeyProbe(encoded_key_slice());
+}
+
 RowIteratorOptions::RowIteratorOptions()
     : projection(nullptr),
       snap_to_include(MvccSnapshot::CreateSnapshotIncludingAllTransactions()),
       order(OrderMode::UNORDERED),
-      include_deleted_rows(false) {}
+      include_deleted_rows(false),
+      scan_pool(nullptr),
+      max_parallel_rowsets(1),
+      max_buffered_blocks(1),
+      aggregator(nullptr) {}
 
 DuplicatingRowSet::DuplicatingRowSet(RowSetVector old_rowsets,
-                                     RowSetVector new_rowsets)
+                                     RowSetVector new_rowsets,
+                                     bool drops_expired_rows)
     : old_rowsets_(std::move(old_rowsets)),
-      new_rowsets_(std::move(new_rowsets)) {
+      new_rowsets_(std::move(new_rowsets)),
+      drops_expired_rows_(drops_expired_rows) {
   CHECK_GT(old_rowsets_.size(), 0);
   CHECK_GT(new_rowsets_.size(), 0);
 }
@@ -176,6 +213,10 @@ Status DuplicatingRowSet::MutateRow(Timestamp timestamp,
     }
     // IsNotFound is OK - it might be in a different one.
   }
+  if (mirrored_count == 0 && drops_expired_rows_) {
+    // The row expired and was dropped from the output: so is the mutation.
+    return Status::OK();
+  }
   CHECK_EQ(mirrored_count, 1)
     << "Updated row in compaction input, but didn't mirror in exactly 1 new rowset: "
     << probe.schema()->CreateKeyProjection().DebugRow(probe.row_key());
@@ -46,10 +46,16 @@ namespace kudu {
 class MonoTime; // IWYU pragma: keep
 class RowChangeList;
 class RowwiseIterator;
+class ScanAggregator;
 class Schema;
 class Slice;
+class ThreadPool;
 struct ColumnId;
 
+namespace codegen {
+class KeyEncoderFunctions;
+}
+
 namespace consensus {
 class OpId;
 }
@@ -102,6 +108,28 @@ struct RowIteratorOptions {
   //
   // Defaults to false.
   bool include_deleted_rows;
+
+  // If set, UNORDERED iterations over several rowsets read up to
+  // 'max_parallel_rowsets' of them concurrently on this pool, buffering up to
+  // 'max_buffered_blocks' blocks of rows. Otherwise, the rowsets are read one
+  // after the other by the iterating thread.
+  //
+  // Defaults to nullptr.
+  ThreadPool* scan_pool;
+
+  // Defaults to 1.
+  int max_parallel_rowsets;
+
+  // Defaults to 1.
+  int max_buffered_blocks;
+
+  // If set, the iteration is that of an aggregate scan without predicates
+  // into this aggregator, and rowsets whose rollup is exact for the iteration
+  // may fold it into the aggregator instead of returning their rows. See
+  // RowSet::FoldRollup().
+  //
+  // Defaults to nullptr.
+  ScanAggregator* aggregator;
 };
 
 class RowSet {
@@ -121,6 +149,17 @@ class RowSet {
   virtual Status CheckRowPresent(const RowSetKeyProbe &probe, const fs::IOContext* io_context,
                                  bool *present, ProbeStats* stats) const = 0;
 
+  // Check if each of the given row keys, sorted in increasing order, is
+  // present in this rowset, like CheckRowPresent(). Sets (*present)[i] for
+  // probes[i], whose stats are added to stats[i].
+  //
+  // The default implementation checks the keys one at a time. Rowsets which
+  // can amortize the checks across keys override it.
+  virtual Status CheckRowsPresent(const std::vector<const RowSetKeyProbe*>& probes,
+                                  const std::vector<ProbeStats*>& stats,
+                                  const fs::IOContext* io_context,
+                                  std::vector<bool>* present) const;
+
   // Update/delete a row in this rowset.
   // The 'update_schema' is the client schema used to encode the 'update' RowChangeList.
   //
@@ -165,6 +204,35 @@ class RowSet {
   virtual Status GetBounds(std::string* min_encoded_key,
                            std::string* max_encoded_key) const = 0;
 
+  // Return in 'keys' the encoded keys of up to 'num_samples' rows of this
+  // RowSet, evenly spaced in key order.
+  //
+  // Returns Status::NotSupported if the rowset can't sample its keys.
+  virtual Status SampleEncodedKeys(int /*num_samples*/,
+                                   const fs::IOContext* /*io_context*/,
+                                   std::vector<std::string>* /*keys*/) const {
+    return Status::NotSupported("rowset keys can't be sampled");
+  }
+
+  // If this RowSet has a rollup which is exact for the rows an iteration
+  // with 'opts' would return, folds it into 'opts.aggregator', which must be
+  // set, and sets '*folded' to true: the iteration then needn't read this
+  // RowSet. Otherwise, sets '*folded' to false and leaves the aggregator
+  // unchanged.
+  virtual Status FoldRollup(const RowIteratorOptions& /*opts*/, bool* folded) const {
+    *folded = false;
+    return Status::OK();
+  }
+
+  // Sets '*relevant' to false if none of the rows of this RowSet may have
+  // changed between the start and end snapshots of the diff scan 'opts',
+  // which must set 'snap_to_exclude': the scan then needn't read this RowSet.
+  virtual Status IsRelevantForDiffScan(const RowIteratorOptions& /*opts*/,
+                                       bool* relevant) const {
+    *relevant = true;
+    return Status::OK();
+  }
+
   // Return a displayable string for this rowset.
   virtual std::string ToString() const = 0;
 
@@ -213,14 +281,17 @@ class RowSet {
   virtual Status MinorCompactDeltaStores(const fs::IOContext* io_context) = 0;
 
   // Estimate the number of bytes in ancient undo delta stores. This may be an
-  // overestimate. The argument 'ancient_history_mark' must be valid (it may
-  // not be equal to Timestamp::kInvalidTimestamp).
+  // overestimate if the max timestamp of some stores is neither recorded in
+  // the rowset metadata nor known from their initialization. The argument
+  // 'ancient_history_mark' must be valid (it may not be equal to
+  // Timestamp::kInvalidTimestamp).
   virtual Status EstimateBytesInPotentiallyAncientUndoDeltas(Timestamp ancient_history_mark,
                                                              int64_t* bytes) = 0;
 
   // Initialize undo delta blocks until the given 'deadline' is passed, or
   // until all undo delta blocks with a max timestamp older than
-  // 'ancient_history_mark' have been initialized.
+  // 'ancient_history_mark' have been initialized. The blocks whose max
+  // timestamp is recorded in the rowset metadata aren't initialized.
   //
   // Invoking this method may also improve the estimate given by
   // EstimateBytesInPotentiallyAncientUndoDeltas().
@@ -242,8 +313,9 @@ class RowSet {
                                 int64_t* delta_blocks_initialized,
                                 int64_t* bytes_in_ancient_undos) = 0;
 
-  // Delete all initialized undo delta blocks with a max timestamp earlier than
-  // the specified 'ancient_history_mark'.
+  // Delete all undo delta blocks with a known max timestamp earlier than the
+  // specified 'ancient_history_mark', i.e. the blocks which are initialized or
+  // whose max timestamp is recorded in the rowset metadata.
   //
   // Note: This method does not flush updates to the rowset metadata. If this
   // method returns OK, the caller is responsible for persisting changes to the
@@ -308,6 +380,11 @@ class RowSetKeyProbe {
     bloom_probe_ = BloomKeyProbe(encoded_key_slice());
   }
 
+  // Like above, but encodes the key with the codegenned 'key_encoder',
+  // which must have been compiled for the key columns of 'row_key'.
+  RowSetKeyProbe(ConstContiguousRow row_key,
+                 const codegen::KeyEncoderFunctions& key_encoder);
+
   // RowSetKeyProbes are usually allocated on the stack, which means that we
   // must copy it if we require it later (e.g. Table::Mutate()).
   //
@@ -377,7 +454,10 @@ struct ProbeStats {
 // See compaction.txt for a little more detail on how this is used.
 class DuplicatingRowSet : public RowSet {
  public:
-  DuplicatingRowSet(RowSetVector old_rowsets, RowSetVector new_rowsets);
+  // If 'drops_expired_rows' is true, the flush or compaction drops the expired
+  // rows of the input, which are thus missing from the output.
+  DuplicatingRowSet(RowSetVector old_rowsets, RowSetVector new_rowsets,
+                    bool drops_expired_rows = false);
 
   virtual Status MutateRow(Timestamp timestamp,
                            const RowSetKeyProbe &probe,
@@ -493,6 +573,7 @@ class DuplicatingRowSet : public RowSet {
 
   RowSetVector old_rowsets_;
   RowSetVector new_rowsets_;
+  const bool drops_expired_rows_;
 };
 
 
@@ -0,0 +1,129 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/rowset_key_index.h"
+
+#include <limits>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/index_btree.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/mem_tracker.h"
+
+namespace kudu {
+namespace tablet {
+
+using cfile::BlockPointer;
+using cfile::CFileReader;
+using cfile::IndexTreeIterator;
+using fs::IOContext;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+Status RowSetKeyIndex::Load(const CFileReader* key_reader,
+                            const IOContext* io_context,
+                            shared_ptr<MemTracker> mem_tracker,
+                            unique_ptr<RowSetKeyIndex>* index) {
+  if (!key_reader->has_validx()) {
+    return Status::NotSupported("no value index present");
+  }
+  unique_ptr<IndexTreeIterator> iter(
+      IndexTreeIterator::Create(io_context, key_reader, key_reader->validx_root()));
+  RETURN_NOT_OK(iter->SeekToFirst());
+
+  string keys;
+  vector<uint32_t> key_offsets = { 0 };
+  vector<BlockPointer> blocks;
+  auto footprint = [&] {
+    return sizeof(RowSetKeyIndex) + keys.capacity() +
+        key_offsets.capacity() * sizeof(uint32_t) + blocks.capacity() * sizeof(BlockPointer);
+  };
+  while (true) {
+    Slice key = iter->GetCurrentKey();
+    keys.append(reinterpret_cast<const char*>(key.data()), key.size());
+    if (PREDICT_FALSE(keys.size() > std::numeric_limits<uint32_t>::max())) {
+      return Status::Incomplete("key index is too large");
+    }
+    key_offsets.push_back(keys.size());
+    blocks.push_back(iter->GetCurrentBlockPointer());
+
+    // Stop reading the index early if it can't fit anyway.
+    if (blocks.size() % 1024 == 0 &&
+        static_cast<int64_t>(footprint()) > mem_tracker->SpareCapacity()) {
+      return Status::Incomplete(Substitute("key index exceeds the memory limit of $0",
+                                           mem_tracker->id()));
+    }
+    if (!iter->HasNext()) {
+      break;
+    }
+    RETURN_NOT_OK(iter->Next());
+  }
+
+  keys.shrink_to_fit();
+  key_offsets.shrink_to_fit();
+  blocks.shrink_to_fit();
+  size_t memory_footprint = footprint();
+  if (!mem_tracker->TryConsume(memory_footprint)) {
+    return Status::Incomplete(Substitute("key index exceeds the memory limit of $0",
+                                         mem_tracker->id()));
+  }
+  index->reset(new RowSetKeyIndex(std::move(keys), std::move(key_offsets), std::move(blocks),
+                                  std::move(mem_tracker), memory_footprint));
+  return Status::OK();
+}
+
+RowSetKeyIndex::RowSetKeyIndex(string keys,
+                               vector<uint32_t> key_offsets,
+                               vector<BlockPointer> blocks,
+                               shared_ptr<MemTracker> mem_tracker,
+                               size_t memory_footprint)
+    : keys_(std::move(keys)),
+      key_offsets_(std::move(key_offsets)),
+      blocks_(std::move(blocks)),
+      mem_tracker_(std::move(mem_tracker)),
+      memory_footprint_(memory_footprint) {
+  DCHECK(!blocks_.empty());
+  DCHECK_EQ(blocks_.size() + 1, key_offsets_.size());
+}
+
+RowSetKeyIndex::~RowSetKeyIndex() {
+  mem_tracker_->Release(memory_footprint_);
+}
+
+const BlockPointer& RowSetKeyIndex::FindBlock(const Slice& encoded_key) const {
+  // Find the first block whose key is after 'encoded_key'.
+  size_t lo = 0;
+  size_t hi = blocks_.size();
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (key(mid).compare(encoded_key) <= 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return blocks_[lo == 0 ? 0 : lo - 1];
+}
+
+} // namespace tablet
+} // namespace kudu
@@ -0,0 +1,101 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_TABLET_ROWSET_KEY_INDEX_H
+#define KUDU_TABLET_ROWSET_KEY_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "kudu/cfile/block_pointer.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class MemTracker;
+
+namespace cfile {
+class CFileReader;
+} // namespace cfile
+
+namespace fs {
+struct IOContext;
+} // namespace fs
+
+namespace tablet {
+
+// An in-memory copy of the leaf level of the value index of the key CFile of a
+// DiskRowSet, i.e. of its ad hoc index or of its key column's CFile: the index
+// key and the pointer of each data block, in key order.
+//
+// Looking a key up in it gives the data block which may hold the key without
+// seeking the on-disk index tree, which costs a block cache lookup, or a read,
+// per level of the tree.
+class RowSetKeyIndex {
+ public:
+  // Reads the leaf entries of the value index of 'key_reader', which must be
+  // initialized, charging their memory to 'mem_tracker'.
+  //
+  // Returns Incomplete if 'mem_tracker' can't consume the memory of the index.
+  static Status Load(const cfile::CFileReader* key_reader,
+                     const fs::IOContext* io_context,
+                     std::shared_ptr<MemTracker> mem_tracker,
+                     std::unique_ptr<RowSetKeyIndex>* index);
+
+  ~RowSetKeyIndex();
+
+  // Returns the pointer to the data block the value index maps 'encoded_key'
+  // to: the last block whose index key is at or before it, or the first block
+  // if there's none. The key is in the rowset only if it's in that block.
+  const cfile::BlockPointer& FindBlock(const Slice& encoded_key) const;
+
+  size_t num_blocks() const { return blocks_.size(); }
+
+  // The memory charged to the tracker, in bytes.
+  size_t memory_footprint() const { return memory_footprint_; }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(RowSetKeyIndex);
+
+  RowSetKeyIndex(std::string keys,
+                 std::vector<uint32_t> key_offsets,
+                 std::vector<cfile::BlockPointer> blocks,
+                 std::shared_ptr<MemTracker> mem_tracker,
+                 size_t memory_footprint);
+
+  // Returns the index key of the block at 'idx'.
+  Slice key(size_t idx) const {
+    return Slice(keys_.data() + key_offsets_[idx], key_offsets_[idx + 1] - key_offsets_[idx]);
+  }
+
+  // The concatenated index keys of the blocks, the key of block 'i' spanning
+  // the range ['key_offsets_[i]', 'key_offsets_[i + 1]').
+  const std::string keys_;
+  const std::vector<uint32_t> key_offsets_;
+  const std::vector<cfile::BlockPointer> blocks_;
+
+  const std::shared_ptr<MemTracker> mem_tracker_;
+  const size_t memory_footprint_;
+};
+
+} // namespace tablet
+} // namespace kudu
+#endif
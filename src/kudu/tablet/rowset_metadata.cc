@@ -105,6 +105,27 @@ void RowSetMetadata::LoadFromPB(const RowSetDataPB& pb) {
     blocks_by_col_id_[col_id] = BlockId::FromPB(col_pb.block());
   }
 
+  // Load Secondary Index Files.
+  index_blocks_by_col_id_.clear();
+  for (const SecondaryIndexDataPB& index_pb : pb.secondary_indexes()) {
+    ColumnId col_id = ColumnId(index_pb.column_id());
+    index_blocks_by_col_id_[col_id] = BlockId::FromPB(index_pb.block());
+  }
+
+  // Load Rollup File.
+  rollup_block_ = BlockId();
+  rollup_key_col_ids_.clear();
+  rollup_col_ids_.clear();
+  if (pb.has_rollup()) {
+    rollup_block_ = BlockId::FromPB(pb.rollup().block());
+    for (int32_t col_id : pb.rollup().key_column_ids()) {
+      rollup_key_col_ids_.emplace_back(col_id);
+    }
+    for (int32_t col_id : pb.rollup().column_ids()) {
+      rollup_col_ids_.emplace_back(col_id);
+    }
+  }
+
   // Load redo delta files.
   redo_delta_blocks_.clear();
   for (const DeltaDataPB& redo_delta_pb : pb.redo_deltas()) {
@@ -115,8 +136,13 @@ void RowSetMetadata::LoadFromPB(const RowSetDataPB& pb) {
 
   // Load undo delta files.
   undo_delta_blocks_.clear();
+  undo_max_timestamps_.clear();
   for (const DeltaDataPB& undo_delta_pb : pb.undo_deltas()) {
-    undo_delta_blocks_.push_back(BlockId::FromPB(undo_delta_pb.block()));
+    BlockId block_id = BlockId::FromPB(undo_delta_pb.block());
+    undo_delta_blocks_.push_back(block_id);
+    if (undo_delta_pb.has_max_timestamp()) {
+      undo_max_timestamps_[block_id] = Timestamp(undo_delta_pb.max_timestamp());
+    }
   }
 }
 
@@ -135,6 +161,25 @@ void RowSetMetadata::ToProtobuf(RowSetDataPB *pb) {
     col_data->set_column_id(col_id);
   }
 
+  // Write Secondary Index Files
+  for (const ColumnIdToBlockIdMap::value_type& e : index_blocks_by_col_id_) {
+    SecondaryIndexDataPB* index_data = pb->add_secondary_indexes();
+    e.second.CopyToPB(index_data->mutable_block());
+    index_data->set_column_id(e.first);
+  }
+
+  // Write Rollup File
+  if (!rollup_block_.IsNull()) {
+    RollupDataPB* rollup_data = pb->mutable_rollup();
+    rollup_block_.CopyToPB(rollup_data->mutable_block());
+    for (const ColumnId& col_id : rollup_key_col_ids_) {
+      rollup_data->add_key_column_ids(col_id);
+    }
+    for (const ColumnId& col_id : rollup_col_ids_) {
+      rollup_data->add_column_ids(col_id);
+    }
+  }
+
   // Write Delta Files
   pb->set_last_durable_dms_id(last_durable_redo_dms_id_);
 
@@ -146,6 +191,10 @@ void RowSetMetadata::ToProtobuf(RowSetDataPB *pb) {
   for (const BlockId& undo_delta_block : undo_delta_blocks_) {
     DeltaDataPB *undo_delta_pb = pb->add_undo_deltas();
     undo_delta_block.CopyToPB(undo_delta_pb->mutable_block());
+    Timestamp max_timestamp;
+    if (FindCopy(undo_max_timestamps_, undo_delta_block, &max_timestamp)) {
+      undo_delta_pb->set_max_timestamp(max_timestamp.ToUint64());
+    }
   }
 
   // Write Bloom File
@@ -176,6 +225,24 @@ void RowSetMetadata::SetColumnDataBlocks(const std::map<ColumnId, BlockId>& bloc
   blocks_by_col_id_ = std::move(new_map);
 }
 
+void RowSetMetadata::SetSecondaryIndexBlocks(
+    const std::map<ColumnId, BlockId>& blocks_by_col_id) {
+  ColumnIdToBlockIdMap new_map(blocks_by_col_id.begin(), blocks_by_col_id.end());
+  new_map.shrink_to_fit();
+  std::lock_guard<LockType> l(lock_);
+  index_blocks_by_col_id_ = std::move(new_map);
+}
+
+void RowSetMetadata::SetRollupBlock(const BlockId& block_id,
+                                    vector<ColumnId> key_col_ids,
+                                    vector<ColumnId> col_ids) {
+  std::lock_guard<LockType> l(lock_);
+  DCHECK(rollup_block_.IsNull());
+  rollup_block_ = block_id;
+  rollup_key_col_ids_ = std::move(key_col_ids);
+  rollup_col_ids_ = std::move(col_ids);
+}
+
 Status RowSetMetadata::CommitRedoDeltaDataBlock(int64_t dms_id,
                                                 const BlockId& block_id) {
   std::lock_guard<LockType> l(lock_);
@@ -184,9 +251,11 @@ Status RowSetMetadata::CommitRedoDeltaDataBlock(int64_t dms_id,
   return Status::OK();
 }
 
-Status RowSetMetadata::CommitUndoDeltaDataBlock(const BlockId& block_id) {
+Status RowSetMetadata::CommitUndoDeltaDataBlock(const BlockId& block_id,
+                                                Timestamp max_timestamp) {
   std::lock_guard<LockType> l(lock_);
   undo_delta_blocks_.push_back(block_id);
+  undo_max_timestamps_[block_id] = max_timestamp;
   return Status::OK();
 }
 
@@ -230,6 +299,7 @@ void RowSetMetadata::CommitUpdate(const RowSetMetadataUpdate& update,
       if (ContainsKey(undos_to_remove, *iter)) {
         removed->push_back(*iter);
         undos_to_remove.erase(*iter);
+        undo_max_timestamps_.erase(*iter);
         iter = undo_delta_blocks_.erase(iter);
       } else {
         ++iter;
@@ -246,6 +316,7 @@ void RowSetMetadata::CommitUpdate(const RowSetMetadataUpdate& update,
     if (!update.new_undo_block_.IsNull()) {
       // Front-loading to keep the UNDO files in their natural order.
       undo_delta_blocks_.insert(undo_delta_blocks_.begin(), update.new_undo_block_);
+      undo_max_timestamps_[update.new_undo_block_] = update.new_undo_max_timestamp_;
     }
 
     for (const ColumnIdToBlockIdMap::value_type& e : update.cols_to_replace_) {
@@ -256,12 +327,42 @@ void RowSetMetadata::CommitUpdate(const RowSetMetadataUpdate& update,
       if (UpdateReturnCopy(&blocks_by_col_id_, e.first, e.second, &old_block_id)) {
         removed->push_back(old_block_id);
       }
+      // The index no longer matches the new base data of the column.
+      if (FindCopy(index_blocks_by_col_id_, e.first, &old_block_id)) {
+        index_blocks_by_col_id_.erase(e.first);
+        removed->push_back(old_block_id);
+      }
     }
 
     for (const ColumnId& col_id : update.col_ids_to_remove_) {
       BlockId old = FindOrDie(blocks_by_col_id_, col_id);
       CHECK_EQ(1, blocks_by_col_id_.erase(col_id));
       removed->push_back(old);
+      if (FindCopy(index_blocks_by_col_id_, col_id, &old)) {
+        index_blocks_by_col_id_.erase(col_id);
+        removed->push_back(old);
+      }
+    }
+
+    // The rollup no longer matches the base data of its columns.
+    if (!rollup_block_.IsNull()) {
+      auto in_rollup = [&](const ColumnId& col_id) {
+        return std::find(rollup_key_col_ids_.begin(), rollup_key_col_ids_.end(), col_id) !=
+            rollup_key_col_ids_.end() ||
+            std::find(rollup_col_ids_.begin(), rollup_col_ids_.end(), col_id) !=
+            rollup_col_ids_.end();
+      };
+      bool changed = std::any_of(update.col_ids_to_remove_.begin(),
+                                 update.col_ids_to_remove_.end(), in_rollup);
+      for (const ColumnIdToBlockIdMap::value_type& e : update.cols_to_replace_) {
+        changed |= in_rollup(e.first);
+      }
+      if (changed) {
+        removed->push_back(rollup_block_);
+        rollup_block_ = BlockId();
+        rollup_key_col_ids_.clear();
+        rollup_col_ids_.clear();
+      }
     }
   }
 
@@ -278,6 +379,10 @@ vector<BlockId> RowSetMetadata::GetAllBlocks() {
     blocks.push_back(bloom_block_);
   }
   AppendValuesFromMap(blocks_by_col_id_, &blocks);
+  AppendValuesFromMap(index_blocks_by_col_id_, &blocks);
+  if (!rollup_block_.IsNull()) {
+    blocks.push_back(rollup_block_);
+  }
 
   blocks.insert(blocks.end(),
                 undo_delta_blocks_.begin(), undo_delta_blocks_.end());
@@ -318,8 +423,10 @@ RowSetMetadataUpdate& RowSetMetadataUpdate::RemoveUndoDeltaBlocks(
   return *this;
 }
 
-RowSetMetadataUpdate& RowSetMetadataUpdate::SetNewUndoBlock(const BlockId& undo_block) {
+RowSetMetadataUpdate& RowSetMetadataUpdate::SetNewUndoBlock(const BlockId& undo_block,
+                                                            Timestamp max_timestamp) {
   new_undo_block_ = undo_block;
+  new_undo_max_timestamp_ = max_timestamp;
   return *this;
 }
 
@@ -22,6 +22,7 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -31,6 +32,7 @@
 #include <glog/logging.h>
 
 #include "kudu/common/schema.h"
+#include "kudu/common/timestamp.h"
 #include "kudu/fs/block_id.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/macros.h"
@@ -117,9 +119,17 @@ class RowSetMetadata {
 
   void SetColumnDataBlocks(const std::map<ColumnId, BlockId>& blocks_by_col_id);
 
+  void SetSecondaryIndexBlocks(const std::map<ColumnId, BlockId>& blocks_by_col_id);
+
+  void SetRollupBlock(const BlockId& block_id,
+                      std::vector<ColumnId> key_col_ids,
+                      std::vector<ColumnId> col_ids);
+
   Status CommitRedoDeltaDataBlock(int64_t dms_id, const BlockId& block_id);
 
-  Status CommitUndoDeltaDataBlock(const BlockId& block_id);
+  // Adds the UNDO delta block 'block_id', whose deltas have a max timestamp
+  // of 'max_timestamp'.
+  Status CommitUndoDeltaDataBlock(const BlockId& block_id, Timestamp max_timestamp);
 
   bool has_encoded_keys_unlocked() const {
     return min_encoded_key_ != boost::none && max_encoded_key_ != boost::none;
@@ -177,6 +187,33 @@ class RowSetMetadata {
     return blocks_by_col_id_;
   }
 
+  ColumnIdToBlockIdMap GetSecondaryIndexBlocksById() const {
+    std::lock_guard<LockType> l(lock_);
+    return index_blocks_by_col_id_;
+  }
+
+  bool has_rollup_block() const {
+    std::lock_guard<LockType> l(lock_);
+    return !rollup_block_.IsNull();
+  }
+
+  BlockId rollup_block() const {
+    std::lock_guard<LockType> l(lock_);
+    return rollup_block_;
+  }
+
+  // The IDs of the columns the rows of the rollup are grouped by.
+  std::vector<ColumnId> rollup_key_column_ids() const {
+    std::lock_guard<LockType> l(lock_);
+    return rollup_key_col_ids_;
+  }
+
+  // The IDs of the columns aggregated by the rollup.
+  std::vector<ColumnId> rollup_column_ids() const {
+    std::lock_guard<LockType> l(lock_);
+    return rollup_col_ids_;
+  }
+
   std::vector<BlockId> redo_delta_blocks() const {
     std::lock_guard<LockType> l(lock_);
     return redo_delta_blocks_;
@@ -187,6 +224,14 @@ class RowSetMetadata {
     return undo_delta_blocks_;
   }
 
+  // Sets '*max_timestamp' to the max timestamp of the deltas of the UNDO
+  // delta block 'block_id'. Returns false if it isn't recorded, e.g. because
+  // the block was written by a version which didn't record it.
+  bool undo_delta_block_max_timestamp(const BlockId& block_id, Timestamp* max_timestamp) const {
+    std::lock_guard<LockType> l(lock_);
+    return FindCopy(undo_max_timestamps_, block_id, max_timestamp);
+  }
+
   TabletMetadata *tablet_metadata() const { return tablet_metadata_; }
 
   int64_t last_durable_redo_dms_id() const {
@@ -261,9 +306,21 @@ class RowSetMetadata {
 
   // Map of column ID to block ID.
   ColumnIdToBlockIdMap blocks_by_col_id_;
+
+  // Map of column ID to the block ID of the column's secondary index.
+  ColumnIdToBlockIdMap index_blocks_by_col_id_;
+
+  // The rollup of the rowset, if any, and the columns it's over.
+  BlockId rollup_block_;
+  std::vector<ColumnId> rollup_key_col_ids_;
+  std::vector<ColumnId> rollup_col_ids_;
+
   std::vector<BlockId> redo_delta_blocks_;
   std::vector<BlockId> undo_delta_blocks_;
 
+  // The max timestamps of the UNDO delta blocks which have one recorded.
+  std::unordered_map<BlockId, Timestamp, BlockIdHash, BlockIdEqual> undo_max_timestamps_;
+
   int64_t last_durable_redo_dms_id_;
 
   DISALLOW_COPY_AND_ASSIGN(RowSetMetadata);
@@ -288,15 +345,19 @@ class RowSetMetadataUpdate {
   // Remove the specified undo delta blocks.
   RowSetMetadataUpdate& RemoveUndoDeltaBlocks(const std::vector<BlockId>& to_remove);
 
-  // Replace the CFile for the given column ID.
+  // Replace the CFile for the given column ID. The secondary index of the
+  // column and the rollup of the rowset, if it's over the column, are removed
+  // since they were computed from the replaced CFile.
   RowSetMetadataUpdate& ReplaceColumnId(ColumnId col_id, const BlockId& block_id);
 
-  // Remove the CFile for the given column ID.
+  // Remove the CFile and the secondary index, if any, for the given column ID,
+  // as well as the rollup of the rowset if it's over the column.
   RowSetMetadataUpdate& RemoveColumnId(ColumnId col_id);
 
-  // Add a new UNDO delta block to the list of UNDO files.
+  // Add a new UNDO delta block, whose deltas have a max timestamp of
+  // 'max_timestamp', to the list of UNDO files.
   // We'll need to replace them instead when we start GCing.
-  RowSetMetadataUpdate& SetNewUndoBlock(const BlockId& undo_block);
+  RowSetMetadataUpdate& SetNewUndoBlock(const BlockId& undo_block, Timestamp max_timestamp);
 
  private:
   friend class RowSetMetadata;
@@ -312,6 +373,7 @@ class RowSetMetadataUpdate {
 
   std::vector<BlockId> remove_undo_blocks_;
   BlockId new_undo_block_;
+  Timestamp new_undo_max_timestamp_;
 
   DISALLOW_COPY_AND_ASSIGN(RowSetMetadataUpdate);
 };
@@ -35,12 +35,14 @@
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/rowset_tree.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
 using std::shared_ptr;
 using std::string;
+using std::unique_ptr;
 using std::unordered_set;
 using std::vector;
 using strings::Substitute;
@@ -398,5 +400,107 @@ TEST_F(TestRowSetTree, TestEndpointsConsistency) {
   }
 }
 
+// Test that a tree reset from another one, minus and plus some rowsets,
+// matches a tree built from scratch with the resulting rowsets, and that it
+// remains valid once the other tree is destroyed.
+TEST_F(TestRowSetTree, TestIncrementalReset) {
+  SeedRandom();
+  RowSetVector vec = GenerateRandomRowSets(100);
+  vec.push_back(shared_ptr<RowSet>(new MockMemRowSet()));
+  unique_ptr<RowSetTree> old_tree(new RowSetTree());
+  ASSERT_OK(old_tree->Reset(vec));
+
+  // Remove every third rowset, including the MemRowSet, as a flush and a
+  // compaction would.
+  RowSetVector to_remove;
+  RowSetVector expected;
+  for (int i = 0; i < vec.size(); i++) {
+    if (i % 3 == 0 || i == vec.size() - 1) {
+      to_remove.push_back(vec[i]);
+    } else {
+      expected.push_back(vec[i]);
+    }
+  }
+  RowSetVector to_add = GenerateRandomRowSets(20);
+  to_add.push_back(shared_ptr<RowSet>(new MockMemRowSet()));
+  expected.insert(expected.end(), to_add.begin(), to_add.end());
+
+  RowSetTree tree;
+  ASSERT_OK(tree.Reset(*old_tree, to_remove, to_add));
+  old_tree.reset();
+  RowSetTree expected_tree;
+  ASSERT_OK(expected_tree.Reset(expected));
+
+  ASSERT_EQ(expected_tree.all_rowsets(), tree.all_rowsets());
+  ASSERT_EQ(expected_tree.key_endpoints().size(), tree.key_endpoints().size());
+  for (int i = 0; i < tree.key_endpoints().size(); i++) {
+    const auto& expected_endpoint = expected_tree.key_endpoints()[i];
+    const auto& endpoint = tree.key_endpoints()[i];
+    ASSERT_EQ(expected_endpoint.rowset_, endpoint.rowset_);
+    ASSERT_EQ(expected_endpoint.endpoint_, endpoint.endpoint_);
+    ASSERT_EQ(expected_endpoint.slice_, endpoint.slice_);
+  }
+  for (int i = 0; i < 100; i++) {
+    const string key = StringPrintf("%04d", rand() % 10000);
+    vector<RowSet*> expected_out;
+    vector<RowSet*> out;
+    expected_tree.FindRowSetsWithKeyInRange(key, &expected_out);
+    tree.FindRowSetsWithKeyInRange(key, &out);
+    std::sort(expected_out.begin(), expected_out.end());
+    std::sort(out.begin(), out.end());
+    ASSERT_EQ(expected_out, out) << key;
+  }
+
+  // The rowsets to remove must be in the tree.
+  RowSetTree bad_tree;
+  Status s = bad_tree.Reset(tree, to_remove, {});
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
+TEST_F(TestRowSetTree, TestFindSplitKey) {
+  string split_key;
+  {
+    RowSetTree tree;
+    ASSERT_OK(tree.Reset({ shared_ptr<RowSet>(new MockMemRowSet()) }));
+    Status s = tree.FindSplitKey(&split_key);
+    ASSERT_TRUE(s.IsNotFound()) << s.ToString();
+  }
+  {
+    RowSetTree tree;
+    ASSERT_OK(tree.Reset({ shared_ptr<RowSet>(new MockDiskRowSet("3", "3")),
+                           shared_ptr<RowSet>(new MockDiskRowSet("3", "3")) }));
+    Status s = tree.FindSplitKey(&split_key);
+    ASSERT_TRUE(s.IsNotFound()) << s.ToString();
+  }
+  {
+    // Evenly-sized disjoint rowsets are split in the middle.
+    RowSetTree tree;
+    ASSERT_OK(tree.Reset({ shared_ptr<RowSet>(new MockDiskRowSet("0", "1")),
+                           shared_ptr<RowSet>(new MockDiskRowSet("2", "3")),
+                           shared_ptr<RowSet>(new MockDiskRowSet("4", "5")),
+                           shared_ptr<RowSet>(new MockDiskRowSet("6", "7")),
+                           shared_ptr<RowSet>(new MockMemRowSet()) }));
+    ASSERT_OK(tree.FindSplitKey(&split_key));
+    ASSERT_EQ("4", split_key);
+  }
+  {
+    // The split follows the sizes of the rowsets.
+    RowSetTree tree;
+    ASSERT_OK(tree.Reset({ shared_ptr<RowSet>(new MockDiskRowSet("0", "1", 100)),
+                           shared_ptr<RowSet>(new MockDiskRowSet("2", "3", 100)),
+                           shared_ptr<RowSet>(new MockDiskRowSet("4", "5", 1000)) }));
+    ASSERT_OK(tree.FindSplitKey(&split_key));
+    ASSERT_EQ("5", split_key);
+  }
+  {
+    // A single rowset is split at its upper bound, leaving the lower half
+    // with all but its last key.
+    RowSetTree tree;
+    ASSERT_OK(tree.Reset({ shared_ptr<RowSet>(new MockDiskRowSet("0", "9")) }));
+    ASSERT_OK(tree.FindSplitKey(&split_key));
+    ASSERT_EQ("9", split_key);
+  }
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -21,22 +21,27 @@
 #include <cstddef>
 #include <functional>
 #include <memory>
+#include <iterator>
 #include <string>
+#include <unordered_set>
 #include <vector>
 #include <ostream>
 
 #include <glog/logging.h>
 
-#include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/rowset_metadata.h"
 #include "kudu/util/interval_tree-inl.h"
 #include "kudu/util/interval_tree.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/status.h"
 
 using std::vector;
 using std::shared_ptr;
 using std::string;
+using std::unordered_set;
 
 namespace kudu {
 namespace tablet {
@@ -121,23 +126,17 @@ struct RowSetIntervalTraits {
   }
 };
 
-RowSetTree::RowSetTree()
-  : initted_(false) {
-}
-
-Status RowSetTree::Reset(const RowSetVector &rowsets) {
-  CHECK(!initted_);
-  std::vector<RowSetWithBounds *> entries;
-  RowSetVector unbounded;
-  ElementDeleter deleter(&entries);
-  entries.reserve(rowsets.size());
-  std::vector<RSEndpoint> endpoints;
-  endpoints.reserve(rowsets.size()*2);
+namespace {
 
-  // Iterate over each of the provided RowSets, fetching their
-  // bounds and adding them to the local vectors.
+// Fetches the bounds of each of 'rowsets', adding an entry to 'entries' and
+// its endpoints to 'endpoints' for the ones which have bounds, and adding the
+// others to 'unbounded'.
+Status GetRowSetsWithBounds(const RowSetVector& rowsets,
+                            vector<shared_ptr<RowSetWithBounds>>* entries,
+                            vector<RowSetTree::RSEndpoint>* endpoints,
+                            RowSetVector* unbounded) {
   for (const shared_ptr<RowSet> &rs : rowsets) {
-    gscoped_ptr<RowSetWithBounds> rsit(new RowSetWithBounds());
+    shared_ptr<RowSetWithBounds> rsit(new RowSetWithBounds());
     rsit->rowset = rs.get();
     string min_key, max_key;
     Status s = rs->GetBounds(&min_key, &max_key);
@@ -146,7 +145,7 @@ Status RowSetTree::Reset(const RowSetVector &rowsets) {
       // data gets inserted. Therefore we can't put it in the static
       // interval tree -- instead put it on the list which is consulted
       // on every access.
-      unbounded.push_back(rs);
+      unbounded->push_back(rs);
       continue;
     } else if (!s.ok()) {
       LOG(WARNING) << "Unable to construct RowSetTree: "
@@ -162,11 +161,31 @@ Status RowSetTree::Reset(const RowSetVector &rowsets) {
     rsit->max_key = std::move(max_key);
 
     // Load into key endpoints.
-    endpoints.emplace_back(rsit->rowset, START, rsit->min_key);
-    endpoints.emplace_back(rsit->rowset, STOP, rsit->max_key);
+    endpoints->emplace_back(rsit->rowset, RowSetTree::START, rsit->min_key);
+    endpoints->emplace_back(rsit->rowset, RowSetTree::STOP, rsit->max_key);
 
-    entries.push_back(rsit.release());
+    entries->push_back(std::move(rsit));
   }
+  return Status::OK();
+}
+
+} // anonymous namespace
+
+RowSetTree::RowSetTree()
+  : initted_(false) {
+}
+
+Status RowSetTree::Reset(const RowSetVector &rowsets) {
+  CHECK(!initted_);
+  std::vector<shared_ptr<RowSetWithBounds>> entries;
+  RowSetVector unbounded;
+  entries.reserve(rowsets.size());
+  std::vector<RSEndpoint> endpoints;
+  endpoints.reserve(rowsets.size()*2);
+
+  // Iterate over each of the provided RowSets, fetching their
+  // bounds and adding them to the local vectors.
+  RETURN_NOT_OK(GetRowSetsWithBounds(rowsets, &entries, &endpoints, &unbounded));
 
   // Sort endpoints
   std::sort(endpoints.begin(), endpoints.end(), RSEndpointBySliceCompare);
@@ -174,7 +193,7 @@ Status RowSetTree::Reset(const RowSetVector &rowsets) {
   // Install the vectors into the object.
   entries_.swap(entries);
   unbounded_rowsets_.swap(unbounded);
-  tree_.reset(new IntervalTree<RowSetIntervalTraits>(entries_));
+  BuildTree();
   key_endpoints_.swap(endpoints);
   all_rowsets_.assign(rowsets.begin(), rowsets.end());
 
@@ -191,6 +210,140 @@ Status RowSetTree::Reset(const RowSetVector &rowsets) {
   return Status::OK();
 }
 
+Status RowSetTree::Reset(const RowSetTree& old_tree,
+                         const RowSetVector& rowsets_to_remove,
+                         const RowSetVector& rowsets_to_add) {
+  CHECK(!initted_);
+  DCHECK(old_tree.initted_);
+
+  unordered_set<const RowSet*> to_remove;
+  to_remove.reserve(rowsets_to_remove.size());
+  for (const shared_ptr<RowSet>& rs : rowsets_to_remove) {
+    to_remove.insert(rs.get());
+  }
+  const auto is_removed = [&](const RowSet* rs) {
+    return ContainsKey(to_remove, rs);
+  };
+
+  RowSetVector all_rowsets;
+  all_rowsets.reserve(old_tree.all_rowsets_.size() + rowsets_to_add.size());
+  for (const shared_ptr<RowSet>& rs : old_tree.all_rowsets_) {
+    if (!is_removed(rs.get())) {
+      all_rowsets.push_back(rs);
+    }
+  }
+  if (all_rowsets.size() + to_remove.size() != old_tree.all_rowsets_.size()) {
+    return Status::InvalidArgument(strings::Substitute(
+        "$0 of the $1 rowsets to remove are not in the rowset tree",
+        all_rowsets.size() + to_remove.size() - old_tree.all_rowsets_.size(),
+        to_remove.size()));
+  }
+  std::copy(rowsets_to_add.begin(), rowsets_to_add.end(), std::back_inserter(all_rowsets));
+
+  // Share the entries of the kept rowsets with the old tree.
+  std::vector<shared_ptr<RowSetWithBounds>> entries;
+  RowSetVector unbounded;
+  entries.reserve(old_tree.entries_.size() + rowsets_to_add.size());
+  for (const shared_ptr<RowSetWithBounds>& e : old_tree.entries_) {
+    if (!is_removed(e->rowset)) {
+      entries.push_back(e);
+    }
+  }
+  for (const shared_ptr<RowSet>& rs : old_tree.unbounded_rowsets_) {
+    if (!is_removed(rs.get())) {
+      unbounded.push_back(rs);
+    }
+  }
+
+  // The endpoints of the kept rowsets are still sorted: only the ones of the
+  // added rowsets need to be sorted before merging them in.
+  std::vector<RSEndpoint> added_endpoints;
+  added_endpoints.reserve(rowsets_to_add.size() * 2);
+  RETURN_NOT_OK(GetRowSetsWithBounds(rowsets_to_add, &entries, &added_endpoints, &unbounded));
+  std::sort(added_endpoints.begin(), added_endpoints.end(), RSEndpointBySliceCompare);
+
+  std::vector<RSEndpoint> kept_endpoints;
+  kept_endpoints.reserve(old_tree.key_endpoints_.size());
+  for (const RSEndpoint& e : old_tree.key_endpoints_) {
+    if (!is_removed(e.rowset_)) {
+      kept_endpoints.push_back(e);
+    }
+  }
+  std::vector<RSEndpoint> endpoints;
+  endpoints.reserve(kept_endpoints.size() + added_endpoints.size());
+  std::merge(kept_endpoints.begin(), kept_endpoints.end(),
+             added_endpoints.begin(), added_endpoints.end(),
+             std::back_inserter(endpoints), RSEndpointBySliceCompare);
+
+  // Install the vectors into the object.
+  entries_.swap(entries);
+  unbounded_rowsets_.swap(unbounded);
+  BuildTree();
+  key_endpoints_.swap(endpoints);
+  all_rowsets_.swap(all_rowsets);
+
+  // Update the mapping from DRS ID to DRS.
+  drs_by_id_ = old_tree.drs_by_id_;
+  for (const shared_ptr<RowSet>& rs : rowsets_to_remove) {
+    if (rs->metadata()) {
+      drs_by_id_.erase(rs->metadata()->id());
+    }
+  }
+  for (const shared_ptr<RowSet>& rs : rowsets_to_add) {
+    if (rs->metadata()) {
+      InsertOrDie(&drs_by_id_, rs->metadata()->id(), rs.get());
+    }
+  }
+
+  initted_ = true;
+
+  return Status::OK();
+}
+
+void RowSetTree::BuildTree() {
+  vector<RowSetWithBounds*> intervals;
+  intervals.reserve(entries_.size());
+  for (const shared_ptr<RowSetWithBounds>& e : entries_) {
+    intervals.push_back(e.get());
+  }
+  tree_.reset(new IntervalTree<RowSetIntervalTraits>(intervals));
+}
+
+Status RowSetTree::FindSplitKey(string* split_key) const {
+  DCHECK(initted_);
+
+  uint64_t total_size = 0;
+  for (const shared_ptr<RowSetWithBounds>& e : entries_) {
+    total_size += e->rowset->OnDiskBaseDataSize();
+  }
+  if (total_size == 0 || key_endpoints_.empty()) {
+    return Status::NotFound("no data to split");
+  }
+
+  // Sweep the endpoints in key order. Before each endpoint, the data at lower
+  // keys is the one of the rowsets which stopped, plus half of the one of the
+  // rowsets still open. At the last endpoint, that's at least half of the
+  // data, so a key is found unless all the endpoints are at the lowest key.
+  const Slice& min_key = key_endpoints_.front().slice_;
+  uint64_t stopped_size = 0;
+  uint64_t open_size = 0;
+  for (const RSEndpoint& rse : key_endpoints_) {
+    if (rse.slice_.compare(min_key) > 0 &&
+        stopped_size * 2 + open_size >= total_size) {
+      *split_key = rse.slice_.ToString();
+      return Status::OK();
+    }
+    const uint64_t size = rse.rowset_->OnDiskBaseDataSize();
+    if (rse.endpoint_ == START) {
+      open_size += size;
+    } else {
+      open_size -= size;
+      stopped_size += size;
+    }
+  }
+  return Status::NotFound("all the rows have the same key");
+}
+
 void RowSetTree::FindRowSetsIntersectingInterval(const boost::optional<Slice>& lower_bound,
                                                  const boost::optional<Slice>& upper_bound,
                                                  vector<RowSet*>* rowsets) const {
@@ -262,7 +415,6 @@ void RowSetTree::ForEachRowSetContainingKeys(
 
 
 RowSetTree::~RowSetTree() {
-  STLDeleteElements(&entries_);
 }
 
 } // namespace tablet
@@ -19,6 +19,7 @@
 
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -68,6 +69,20 @@ class RowSetTree {
 
   RowSetTree();
   Status Reset(const RowSetVector &rowsets);
+
+  // Resets this tree to the rowsets of 'old_tree', minus 'rowsets_to_remove'
+  // and plus 'rowsets_to_add', which are put at the end of all_rowsets().
+  //
+  // This is cheaper than Reset() with the resulting rowsets: the bounds of the
+  // rowsets of 'old_tree' are shared with it rather than fetched and copied
+  // again, and their already-sorted endpoints are merged with the ones of the
+  // added rowsets rather than sorted again.
+  //
+  // Returns InvalidArgument if some of 'rowsets_to_remove' are not in
+  // 'old_tree'.
+  Status Reset(const RowSetTree& old_tree,
+               const RowSetVector& rowsets_to_remove,
+               const RowSetVector& rowsets_to_add);
   ~RowSetTree();
 
   // Return all RowSets whose range may contain the given encoded key.
@@ -98,6 +113,19 @@ class RowSetTree {
                                        const boost::optional<Slice>& upper_bound,
                                        std::vector<RowSet*>* rowsets) const;
 
+  // Sets 'split_key' to an encoded key which splits the data of the rowsets
+  // with known bounds in two halves of about the same size, for instance to
+  // split the tablet there.
+  //
+  // The data of each rowset is assumed to be spread evenly between its
+  // bounds, and only the bounds of the rowsets are candidates, so the halves
+  // are only as even as the rowsets are small. The split key is greater than
+  // the lowest bound, so that neither half is empty.
+  //
+  // Returns NotFound if the rowsets with known bounds have no data, or all of
+  // them have the same single key.
+  Status FindSplitKey(std::string* split_key) const;
+
   const RowSetVector &all_rowsets() const { return all_rowsets_; }
 
   RowSet* drs_by_id(int64_t drs_id) const {
@@ -119,10 +147,14 @@ class RowSetTree {
   // TODO map to usage statistics as well. See KUDU-???
   std::vector<RSEndpoint> key_endpoints_;
 
+  // Builds 'tree_' from 'entries_'.
+  void BuildTree();
+
   // Container for all of the entries in tree_. IntervalTree does
-  // not itself manage memory, so this provides a simple way to enumerate
-  // all the entry structs and free them in the destructor.
-  std::vector<RowSetWithBounds *> entries_;
+  // not itself manage memory, so this owns the entry structs. They are
+  // shared with the trees reset from this one, whose endpoints point to
+  // their keys.
+  std::vector<std::shared_ptr<RowSetWithBounds>> entries_;
 
   // All of the rowsets which were put in this RowSetTree.
   RowSetVector all_rowsets_;
@@ -0,0 +1,236 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/secondary_index.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/cfile/cfile_writer.h"
+#include "kudu/common/column_materialization_context.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/encoded_key.h"
+#include "kudu/common/key_encoder.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/fs/block_manager.h"
+#include "kudu/gutil/endian.h"
+#include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/slice.h"
+
+namespace kudu {
+namespace tablet {
+
+using cfile::CFileIterator;
+using cfile::CFileReader;
+using cfile::CFileWriter;
+using fs::BlockCreationTransaction;
+using fs::IOContext;
+using fs::ReadableBlock;
+using fs::WritableBlock;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+// The number of index entries read at a time by lookups.
+const size_t kLookupBatchSize = 256;
+
+} // anonymous namespace
+
+////////////////////////////////////////////////////////////
+// SecondaryIndexWriter
+////////////////////////////////////////////////////////////
+
+bool SecondaryIndexWriter::CanIndex(const ColumnSchema& col_schema) {
+  switch (col_schema.type_info()->physical_type()) {
+    case BOOL:
+    case FLOAT:
+    case DOUBLE:
+      return false;
+    default:
+      return true;
+  }
+}
+
+SecondaryIndexWriter::SecondaryIndexWriter(const TypeInfo* type_info,
+                                           unique_ptr<WritableBlock> block)
+    : key_encoder_(GetKeyEncoder<faststring>(type_info)),
+      block_id_(block->id()),
+      written_size_(0) {
+  cfile::WriterOptions opts;
+  // Lookups seek to the first entry of a value.
+  opts.write_validx = true;
+  opts.write_posidx = false;
+  opts.storage_attributes.encoding = PREFIX_ENCODING;
+  opts.storage_attributes.compression = LZ4;
+  writer_.reset(new CFileWriter(std::move(opts), GetTypeInfo(BINARY), false, std::move(block)));
+}
+
+SecondaryIndexWriter::~SecondaryIndexWriter() {
+}
+
+Status SecondaryIndexWriter::Start() {
+  return writer_->Start();
+}
+
+void SecondaryIndexWriter::AppendCells(const ColumnBlock& cells, rowid_t first_rowid) {
+  faststring entry;
+  for (size_t i = 0; i < cells.nrows(); i++) {
+    if (cells.is_nullable() && cells.is_null(i)) {
+      continue;
+    }
+    entry.clear();
+    key_encoder_.Encode(cells.cell_ptr(i), false, &entry);
+    uint8_t rowid_buf[sizeof(rowid_t)];
+    BigEndian::Store32(rowid_buf, first_rowid + i);
+    entry.append(rowid_buf, sizeof(rowid_buf));
+    entries_.emplace_back(entry.ToString());
+    written_size_ += entry.size();
+  }
+}
+
+Status SecondaryIndexWriter::FinishAndReleaseBlock(BlockCreationTransaction* transaction) {
+  std::sort(entries_.begin(), entries_.end());
+  vector<Slice> slices(entries_.begin(), entries_.end());
+  if (!slices.empty()) {
+    RETURN_NOT_OK(writer_->AppendEntries(slices.data(), slices.size()));
+  }
+  RETURN_NOT_OK(writer_->FinishAndReleaseBlock(transaction));
+  vector<string>().swap(entries_);
+  return Status::OK();
+}
+
+////////////////////////////////////////////////////////////
+// SecondaryIndexReader
+////////////////////////////////////////////////////////////
+
+Status SecondaryIndexReader::OpenNoInit(const TypeInfo* type_info,
+                                        unique_ptr<ReadableBlock> block,
+                                        shared_ptr<MemTracker> parent_mem_tracker,
+                                        const IOContext* io_context,
+                                        unique_ptr<SecondaryIndexReader>* reader) {
+  cfile::ReaderOptions opts;
+  opts.parent_mem_tracker = std::move(parent_mem_tracker);
+  opts.io_context = io_context;
+  unique_ptr<CFileReader> cfile_reader;
+  RETURN_NOT_OK(CFileReader::OpenNoInit(std::move(block), std::move(opts), &cfile_reader));
+  reader->reset(new SecondaryIndexReader(type_info, std::move(cfile_reader)));
+  return Status::OK();
+}
+
+SecondaryIndexReader::SecondaryIndexReader(const TypeInfo* type_info,
+                                           unique_ptr<CFileReader> reader)
+    : key_encoder_(GetKeyEncoder<faststring>(type_info)),
+      reader_(std::move(reader)) {
+}
+
+SecondaryIndexReader::~SecondaryIndexReader() {
+}
+
+uint64_t SecondaryIndexReader::file_size() const {
+  return reader_->file_size();
+}
+
+Status SecondaryIndexReader::FindRows(const ColumnPredicate& pred,
+                                      size_t max_rows,
+                                      const IOContext* io_context,
+                                      vector<rowid_t>* rowids) const {
+  DCHECK(pred.predicate_type() == PredicateType::Equality ||
+         pred.predicate_type() == PredicateType::InList);
+  rowids->clear();
+  RETURN_NOT_OK(reader_->Init(io_context));
+  rowid_t num_entries;
+  RETURN_NOT_OK(reader_->CountRows(&num_entries));
+  if (num_entries == 0) {
+    // All the cells of the column are NULL.
+    return Status::OK();
+  }
+
+  unique_ptr<CFileIterator> iter;
+  RETURN_NOT_OK(reader_->NewIterator(&iter, CFileReader::CACHE_BLOCK, io_context));
+  if (pred.predicate_type() == PredicateType::Equality) {
+    return FindValue(iter.get(), pred.raw_lower(), max_rows, rowids);
+  }
+  for (const void* value : pred.raw_values()) {
+    RETURN_NOT_OK(FindValue(iter.get(), value, max_rows, rowids));
+  }
+  std::sort(rowids->begin(), rowids->end());
+  return Status::OK();
+}
+
+Status SecondaryIndexReader::FindValue(CFileIterator* iter,
+                                       const void* value,
+                                       size_t max_rows,
+                                       vector<rowid_t>* rowids) const {
+  faststring prefix;
+  key_encoder_.Encode(value, false, &prefix);
+  const Slice prefix_slice(prefix);
+
+  // The index has a single BINARY column, sought by its raw value.
+  faststring key_data;
+  key_data.assign_copy(prefix.data(), prefix.size());
+  vector<const void*> raw_keys = { &prefix_slice };
+  EncodedKey key(&key_data, &raw_keys, 1);
+  bool exact;
+  Status s = iter->SeekAtOrAfter(key, &exact);
+  if (s.IsNotFound()) {
+    // The value is greater than all the indexed values.
+    return Status::OK();
+  }
+  RETURN_NOT_OK(s);
+
+  const size_t entry_size = prefix.size() + sizeof(rowid_t);
+  Arena arena(1024);
+  vector<Slice> entries(kLookupBatchSize);
+  SelectionVector sel(kLookupBatchSize);
+  while (iter->HasNext()) {
+    arena.Reset();
+    size_t n = kLookupBatchSize;
+    RETURN_NOT_OK(iter->PrepareBatch(&n));
+    ColumnBlock block(GetTypeInfo(BINARY), nullptr, entries.data(), n, &arena);
+    sel.Resize(n);
+    sel.SetAllTrue();
+    ColumnMaterializationContext ctx(0, nullptr, &block, &sel);
+    RETURN_NOT_OK(iter->Scan(&ctx));
+    RETURN_NOT_OK(iter->FinishBatch());
+    for (size_t i = 0; i < n; i++) {
+      const Slice& entry = entries[i];
+      if (entry.size() != entry_size || !entry.starts_with(prefix_slice)) {
+        return Status::OK();
+      }
+      if (PREDICT_FALSE(rowids->size() >= max_rows)) {
+        return Status::Incomplete("too many rows match the predicate");
+      }
+      rowids->push_back(BigEndian::Load32(entry.data() + prefix.size()));
+    }
+  }
+  return Status::OK();
+}
+
+} // namespace tablet
+} // namespace kudu
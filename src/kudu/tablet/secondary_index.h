@@ -0,0 +1,150 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_TABLET_SECONDARY_INDEX_H
+#define KUDU_TABLET_SECONDARY_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "kudu/common/rowid.h"
+#include "kudu/fs/block_id.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class ColumnBlock;
+class ColumnPredicate;
+class ColumnSchema;
+class MemTracker;
+class TypeInfo;
+
+template <typename Buffer>
+class KeyEncoder;
+
+namespace cfile {
+class CFileIterator;
+class CFileReader;
+class CFileWriter;
+} // namespace cfile
+
+namespace fs {
+class BlockCreationTransaction;
+class ReadableBlock;
+class WritableBlock;
+struct IOContext;
+} // namespace fs
+
+namespace tablet {
+
+// The secondary index of a column of a DiskRowSet maps the non-NULL values of
+// the column to the indexes of the rows holding them.
+//
+// It's a BINARY CFile with a value index, whose entries are the (value, row
+// index) pairs of the column's cells, sorted by value and then by row index.
+// Each entry is the key encoding of the value, with separators as if it were
+// the first column of a composite key, followed by the big-endian row index.
+// The encoding of a value is thus a distinct prefix of the entries of its rows.
+
+// Writes the secondary index of a column.
+//
+// Rows are appended in primary key order, not in value order, so the entries
+// are buffered in memory until the index is finished.
+class SecondaryIndexWriter {
+ public:
+  // Returns true if the values of 'col_schema' may be indexed, i.e. if they
+  // have a key encoding.
+  static bool CanIndex(const ColumnSchema& col_schema);
+
+  SecondaryIndexWriter(const TypeInfo* type_info,
+                       std::unique_ptr<fs::WritableBlock> block);
+
+  ~SecondaryIndexWriter();
+
+  Status Start();
+
+  // Adds the non-NULL cells of 'cells', which are those of the rows starting
+  // at index 'first_rowid', to the index.
+  void AppendCells(const ColumnBlock& cells, rowid_t first_rowid);
+
+  // Sorts the buffered entries, writes them and closes the CFile, releasing
+  // its block to 'transaction'.
+  Status FinishAndReleaseBlock(fs::BlockCreationTransaction* transaction);
+
+  // The size of the entries buffered so far.
+  size_t written_size() const { return written_size_; }
+
+  const BlockId& block_id() const { return block_id_; }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(SecondaryIndexWriter);
+
+  const KeyEncoder<faststring>& key_encoder_;
+  const BlockId block_id_;
+  std::unique_ptr<cfile::CFileWriter> writer_;
+
+  std::vector<std::string> entries_;
+  size_t written_size_;
+};
+
+// Reads the secondary index of a column.
+class SecondaryIndexReader {
+ public:
+  // Lazily opens the index of a column of type 'type_info' stored in 'block'.
+  // It's fully opened by the first lookup.
+  static Status OpenNoInit(const TypeInfo* type_info,
+                           std::unique_ptr<fs::ReadableBlock> block,
+                           std::shared_ptr<MemTracker> parent_mem_tracker,
+                           const fs::IOContext* io_context,
+                           std::unique_ptr<SecondaryIndexReader>* reader);
+
+  ~SecondaryIndexReader();
+
+  // Sets 'rowids' to the sorted indexes of the rows matching 'pred', which
+  // must be an equality or an IN-list predicate on the indexed column.
+  //
+  // Returns Incomplete if more than 'max_rows' rows match.
+  Status FindRows(const ColumnPredicate& pred,
+                  size_t max_rows,
+                  const fs::IOContext* io_context,
+                  std::vector<rowid_t>* rowids) const;
+
+  uint64_t file_size() const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(SecondaryIndexReader);
+
+  SecondaryIndexReader(const TypeInfo* type_info,
+                       std::unique_ptr<cfile::CFileReader> reader);
+
+  // Appends the indexes of the rows whose value is 'value' to 'rowids'.
+  Status FindValue(cfile::CFileIterator* iter,
+                   const void* value,
+                   size_t max_rows,
+                   std::vector<rowid_t>* rowids) const;
+
+  const KeyEncoder<faststring>& key_encoder_;
+  std::unique_ptr<cfile::CFileReader> reader_;
+};
+
+} // namespace tablet
+} // namespace kudu
+#endif
@@ -296,6 +296,11 @@ TEST_P(TabletDecoderEvalTest, EvaluateEmpty) {
   TestScanAndFilter(50, 50, 55);
 }
 
+TEST_P(TabletDecoderEvalTest, EvaluateAllMatch) {
+  // Predicate [0, 50) matches every dictionary entry.
+  TestScanAndFilter(50, 0, 50);
+}
+
 TEST_P(TabletDecoderEvalTest, NullableLowCardinality) {
   // Fill a tablet with pattern [0, 50) but with values [0, 40) as NULL.
   // Query for values [30, 50).
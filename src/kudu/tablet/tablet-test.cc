@@ -69,6 +69,8 @@
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/test_macros.h"
 
+DECLARE_int32(tablet_num_memrowsets);
+
 DEFINE_int32(testflush_num_inserts, 1000,
              "Number of rows inserted in TestFlush");
 DEFINE_int32(testiterator_num_inserts, 1000,
@@ -1118,6 +1120,47 @@ TYPED_TEST(TestTablet, TestMetricsInit) {
   }
 }
 
+class TestTabletMultipleMemRowSets : public TestTablet<IntKeyTestSetup<INT64>> {
+ public:
+  TestTabletMultipleMemRowSets() {
+    // The tablet is created by SetUp().
+    FLAGS_tablet_num_memrowsets = 4;
+  }
+};
+
+// Test that rows striped across multiple MemRowSets are inserted, mutated
+// and flushed as if there was a single one.
+TEST_F(TestTabletMultipleMemRowSets, TestInsertMutateAndFlush) {
+  const int kNumRows = 1000;
+  InsertTestRows(0, kNumRows, 0);
+  ASSERT_EQ(kNumRows, TabletCount());
+  ASSERT_FALSE(tablet()->MemRowSetEmpty());
+
+  LocalTabletWriter writer(tablet().get(), &client_schema_);
+  for (int i = 0; i < kNumRows; i += 10) {
+    // Duplicate keys are detected in whichever MemRowSet the key maps to.
+    Status s = InsertTestRow(&writer, i, 0);
+    ASSERT_TRUE(s.IsAlreadyPresent()) << s.ToString();
+    ASSERT_OK(UpdateTestRow(&writer, i, 1));
+  }
+  const TestRowVerifier verifier = [](int32_t key_idx, int32_t val) {
+    return val == (key_idx % 10 == 0 ? 1 : 0);
+  };
+  NO_FATALS(VerifyTestRowsWithVerifier(0, kNumRows, verifier));
+
+  // All the MemRowSets are flushed together, and replaced by new ones.
+  const int32_t mrs_id = tablet()->CurrentMrsIdForTests();
+  ASSERT_OK(tablet()->Flush());
+  ASSERT_TRUE(tablet()->MemRowSetEmpty());
+  ASSERT_EQ(mrs_id + 4, tablet()->CurrentMrsIdForTests());
+  ASSERT_EQ(mrs_id, tablet()->metadata()->last_durable_mrs_id());
+  ASSERT_EQ(kNumRows, TabletCount());
+  NO_FATALS(VerifyTestRowsWithVerifier(0, kNumRows, verifier));
+
+  Status s = InsertTestRow(&writer, 0, 0);
+  ASSERT_TRUE(s.IsAlreadyPresent()) << s.ToString();
+}
+
 // Test that we find the correct log segment size for different indexes.
 TEST(TestTablet, TestGetReplaySizeForIndex) {
   std::map<int64_t, int64_t> replay_size_map;
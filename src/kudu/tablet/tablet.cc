@@ -21,6 +21,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <mutex>
 #include <ostream>
@@ -30,19 +31,25 @@
 #include <utility>
 #include <vector>
 
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/optional/optional.hpp>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/clock/hybrid_clock.h"
+#include "kudu/codegen/compilation_manager.h"
+#include "kudu/codegen/key_encoder.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/generic_iterators.h"
 #include "kudu/common/iterator.h"
+#include "kudu/common/iterator_stats.h"
+#include "kudu/common/key_util.h"
 #include "kudu/common/partition.h"
 #include "kudu/common/row.h"
 #include "kudu/common/row_changelist.h"
 #include "kudu/common/row_operations.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/common/rowid.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
@@ -51,13 +58,17 @@
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/consensus/log_anchor_registry.h"
 #include "kudu/consensus/opid.pb.h"
+#include "kudu/fs/block_manager.h"
+#include "kudu/fs/data_dirs.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/fs/io_context.h"
+#include "kudu/fs/io_metrics.h"
 #include "kudu/gutil/bind.h"
 #include "kudu/gutil/bind_helpers.h"
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/human_readable.h"
+#include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/threading/thread_collision_warner.h"
 #include "kudu/tablet/compaction.h"
@@ -65,6 +76,8 @@
 #include "kudu/tablet/delta_tracker.h"
 #include "kudu/tablet/diskrowset.h"
 #include "kudu/tablet/memrowset.h"
+#include "kudu/tablet/hot_spot_tracker.h"
+#include "kudu/tablet/row_cache.h"
 #include "kudu/tablet/row_op.h"
 #include "kudu/tablet/rowset_info.h"
 #include "kudu/tablet/rowset_metadata.h"
@@ -82,14 +95,18 @@
 #include "kudu/util/faststring.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/hash_util.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/maintenance_manager.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/process_memory.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status_callback.h"
+#include "kudu/util/stopwatch.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/throttler.h"
 #include "kudu/util/trace.h"
 #include "kudu/util/url-coding.h"
@@ -98,6 +115,21 @@ DEFINE_int32(tablet_compaction_budget_mb, 128,
              "Budget for a single compaction");
 TAG_FLAG(tablet_compaction_budget_mb, experimental);
 
+DEFINE_string(tablet_time_window_compaction_tables, "",
+              "Comma-separated list of the names of the tables whose tablets "
+              "use the time window compaction policy instead of the budgeted "
+              "one. The first primary key column of these tables must be an "
+              "integer or timestamp column holding the time of the rows.");
+TAG_FLAG(tablet_time_window_compaction_tables, experimental);
+
+DEFINE_int64(tablet_time_window_compaction_window_size, 24L * 60 * 60 * 1000 * 1000,
+             "The width of the time windows of the time window compaction "
+             "policy, in the units of the first primary key column. The "
+             "default is a day for UNIXTIME_MICROS columns.");
+TAG_FLAG(tablet_time_window_compaction_window_size, experimental);
+DEFINE_validator(tablet_time_window_compaction_window_size,
+                 [](const char* /*flagname*/, int64_t value) { return value > 0; });
+
 DEFINE_int32(tablet_bloom_block_size, 4096,
              "Block size of the bloom filters used for tablet keys.");
 TAG_FLAG(tablet_bloom_block_size, advanced);
@@ -109,6 +141,26 @@ DEFINE_double(tablet_bloom_target_fp_rate, 0.0001f,
               "required for bloom filters.");
 TAG_FLAG(tablet_bloom_target_fp_rate, advanced);
 
+DEFINE_string(tablet_bloom_filter_type, "classic",
+              "The type of the key filters of new rowsets. Must be one of 'classic', "
+              "'split_block', whose filters answer a key presence check with a single "
+              "cache line access at the expense of slightly more space, or 'xor', whose "
+              "filters take less space for the same false-positive rate. Rowsets written "
+              "with filters other than 'classic' can't be read by versions of Kudu which "
+              "don't support them.");
+TAG_FLAG(tablet_bloom_filter_type, experimental);
+DEFINE_validator(tablet_bloom_filter_type, [](const char* /* flag_name */,
+                                               const std::string& value) {
+    if (boost::iequals(value, "classic") ||
+        boost::iequals(value, "split_block") ||
+        boost::iequals(value, "xor")) {
+      return true;
+    }
+    LOG(ERROR) << "unknown value for 'tablet_bloom_filter_type': '" << value << "'"
+               << " (expected one of 'classic', 'split_block' or 'xor')";
+    return false;
+  });
+
 
 DEFINE_double(fault_crash_before_flush_tablet_meta_after_compaction, 0.0,
               "Fraction of the time, during compaction, to crash before flushing metadata");
@@ -134,6 +186,46 @@ DEFINE_double(tablet_throttler_burst_factor, 1.0f,
              "base rate.");
 TAG_FLAG(tablet_throttler_burst_factor, experimental);
 
+DEFINE_int32(tablet_row_cache_capacity_mb, 0,
+             "Capacity of the cache of each tablet serving repeated lookups of "
+             "rows by their full primary key, in MB. Rows are cached with all "
+             "their columns, and invalidated when written to. 0 disables the "
+             "row cache.");
+TAG_FLAG(tablet_row_cache_capacity_mb, experimental);
+
+DEFINE_int32(tablet_num_memrowsets, 1,
+             "Number of MemRowSets of each tablet, across which inserts are "
+             "striped by hash of their primary key so that concurrent writers "
+             "contend less on a single MemRowSet. The MemRowSets are flushed "
+             "together.");
+TAG_FLAG(tablet_num_memrowsets, experimental);
+DEFINE_validator(tablet_num_memrowsets,
+                 [](const char* /*flagname*/, int32_t value) { return value >= 1; });
+
+DEFINE_int32(tablet_compaction_num_key_ranges, 1,
+             "Maximum number of disjoint key ranges into which a rowset "
+             "compaction is split, each range being merged on its own thread. "
+             "Ranges hold at least --tablet_compaction_min_key_range_size_mb "
+             "of input data. 1 merges each compaction on a single thread.");
+TAG_FLAG(tablet_compaction_num_key_ranges, experimental);
+TAG_FLAG(tablet_compaction_num_key_ranges, runtime);
+DEFINE_validator(tablet_compaction_num_key_ranges,
+                 [](const char* /*flagname*/, int32_t value) { return value >= 1; });
+
+DEFINE_int32(tablet_compaction_min_key_range_size_mb, 32,
+             "Minimum size of the input data of each key range of a compaction "
+             "split by --tablet_compaction_num_key_ranges, in MB.");
+TAG_FLAG(tablet_compaction_min_key_range_size_mb, experimental);
+TAG_FLAG(tablet_compaction_min_key_range_size_mb, runtime);
+
+DEFINE_bool(tablet_compaction_copy_data_blocks, false,
+            "Whether rowset compactions copy the data blocks of the non-key "
+            "columns of the input rowsets which don't overlap any other and "
+            "have no mutations, rather than re-encoding their rows. Not "
+            "applied to compactions split by --tablet_compaction_num_key_ranges.");
+TAG_FLAG(tablet_compaction_copy_data_blocks, experimental);
+TAG_FLAG(tablet_compaction_copy_data_blocks, runtime);
+
 DEFINE_int32(tablet_history_max_age_sec, 15 * 60,
              "Number of seconds to retain tablet history. Reads initiated at a "
              "snapshot that is older than this age will be rejected. "
@@ -157,6 +249,12 @@ DEFINE_int32(max_encoded_key_size_bytes, 16 * 1024,
              "result in an error.");
 TAG_FLAG(max_encoded_key_size_bytes, unsafe);
 
+DEFINE_bool(tablet_use_codegen_key_encoder, true,
+            "Whether to encode the primary keys of written rows with code-generated "
+            "functions. Rows are encoded with the generic key encoders until the "
+            "functions for the schema of a table are compiled.");
+TAG_FLAG(tablet_use_codegen_key_encoder, hidden);
+
 METRIC_DEFINE_entity(tablet);
 METRIC_DEFINE_gauge_size(tablet, memrowset_size, "MemRowSet Memory Usage",
                          kudu::MetricUnit::kBytes,
@@ -189,7 +287,24 @@ struct IteratorStats;
 
 namespace tablet {
 
-static CompactionPolicy *CreateCompactionPolicy() {
+static CompactionPolicy *CreateCompactionPolicy(const TabletMetadata& metadata) {
+  const vector<string> time_window_tables =
+      strings::Split(FLAGS_tablet_time_window_compaction_tables, ",", strings::SkipEmpty());
+  if (std::find(time_window_tables.begin(), time_window_tables.end(),
+                metadata.table_name()) != time_window_tables.end()) {
+    const Schema& schema = metadata.schema();
+    const ColumnSchema& window_col = schema.column(0);
+    if (TimeWindowCompactionPolicy::IsValidWindowColumnType(window_col.type_info()->type())) {
+      return new TimeWindowCompactionPolicy(FLAGS_tablet_compaction_budget_mb,
+                                            window_col.type_info()->type(),
+                                            schema.num_key_columns() == 1,
+                                            FLAGS_tablet_time_window_compaction_window_size);
+    }
+    LOG(WARNING) << Substitute("T $0: the first key column $1 of table $2 can't be used "
+                               "for time window compactions, using the budgeted policy",
+                               metadata.tablet_id(), window_col.ToString(),
+                               metadata.table_name());
+  }
   return new BudgetedCompactionPolicy(FLAGS_tablet_compaction_budget_mb);
 }
 
@@ -197,9 +312,19 @@ static CompactionPolicy *CreateCompactionPolicy() {
 // TabletComponents
 ////////////////////////////////////////////////////////////
 
-TabletComponents::TabletComponents(shared_ptr<MemRowSet> mrs,
+TabletComponents::TabletComponents(MemRowSetVector mrss,
                                    shared_ptr<RowSetTree> rs_tree)
-    : memrowset(std::move(mrs)), rowsets(std::move(rs_tree)) {}
+    : memrowsets(std::move(mrss)), rowsets(std::move(rs_tree)) {
+  DCHECK(!memrowsets.empty());
+}
+
+MemRowSet* TabletComponents::memrowset_for_key(const Slice& encoded_key) const {
+  if (memrowsets.size() == 1) {
+    return memrowsets[0].get();
+  }
+  uint64_t hash = HashUtil::MurmurHash2_64(encoded_key.data(), encoded_key.size(), 0);
+  return memrowsets[hash % memrowsets.size()].get();
+}
 
 ////////////////////////////////////////////////////////////
 // Tablet
@@ -214,12 +339,16 @@ Tablet::Tablet(scoped_refptr<TabletMetadata> metadata,
     metadata_(std::move(metadata)),
     log_anchor_registry_(std::move(log_anchor_registry)),
     mem_trackers_(tablet_id(), std::move(parent_mem_tracker)),
+    hot_spots_(new HotSpotTracker()),
+    num_memrowsets_(FLAGS_tablet_num_memrowsets),
     next_mrs_id_(0),
     clock_(std::move(clock)),
     rowsets_flush_sem_(1),
-    state_(kInitialized) {
+    state_(kInitialized),
+    rowset_compaction_backlog_(false),
+    major_delta_compaction_backlog_(false) {
       CHECK(schema()->has_column_ids());
-  compaction_policy_.reset(CreateCompactionPolicy());
+  compaction_policy_.reset(CreateCompactionPolicy(*metadata_.get()));
 
   if (metric_registry) {
     MetricEntity::AttributeMap attrs;
@@ -246,6 +375,10 @@ Tablet::Tablet(scoped_refptr<TabletMetadata> metadata,
                                    FLAGS_tablet_throttler_bytes_per_sec,
                                    FLAGS_tablet_throttler_burst_factor));
   }
+
+  if (FLAGS_tablet_row_cache_capacity_mb > 0) {
+    row_cache_.reset(new RowCache(FLAGS_tablet_row_cache_capacity_mb * 1024L * 1024L));
+  }
 }
 
 Tablet::~Tablet() {
@@ -271,7 +404,7 @@ Status Tablet::Open() {
 
   RowSetVector rowsets_opened;
 
-  fs::IOContext io_context({ tablet_id() });
+  const IOContext io_context = MakeIOContext(IOContext::SOURCE_OTHER);
   // open the tablet row-sets
   for (const shared_ptr<RowSetMetadata>& rowset_meta : metadata_->rowsets()) {
     shared_ptr<DiskRowSet> rowset;
@@ -301,13 +434,10 @@ Status Tablet::Open() {
     metrics_->average_diskrowset_height->set_value(avg_height);
   }
 
-  // Now that the current state is loaded, create the new MemRowSet with the next id.
-  shared_ptr<MemRowSet> new_mrs;
-  RETURN_NOT_OK(MemRowSet::Create(next_mrs_id_++, *schema(),
-                                  log_anchor_registry_.get(),
-                                  mem_trackers_.tablet_tracker,
-                                  &new_mrs));
-  components_ = new TabletComponents(new_mrs, new_rowset_tree);
+  // Now that the current state is loaded, create the new MemRowSets with the next ids.
+  MemRowSetVector new_mrss;
+  RETURN_NOT_OK(CreateMemRowSetsUnlocked(*schema(), &new_mrss));
+  components_ = new TabletComponents(std::move(new_mrss), new_rowset_tree);
 
   {
     std::lock_guard<simple_spinlock> l(state_lock_);
@@ -375,8 +505,15 @@ Status Tablet::GetMappedReadProjection(const Schema& projection,
 }
 
 BloomFilterSizing Tablet::DefaultBloomSizing() {
+  BloomFilterType type = BloomFilterType::CLASSIC;
+  if (boost::iequals(FLAGS_tablet_bloom_filter_type, "split_block")) {
+    type = BloomFilterType::SPLIT_BLOCK;
+  } else if (boost::iequals(FLAGS_tablet_bloom_filter_type, "xor")) {
+    type = BloomFilterType::XOR;
+  }
   return BloomFilterSizing::BySizeAndFPRate(FLAGS_tablet_bloom_block_size,
-                                            FLAGS_tablet_bloom_target_fp_rate);
+                                            FLAGS_tablet_bloom_target_fp_rate,
+                                            type);
 }
 
 void Tablet::SplitKeyRange(const EncodedKey* start_key,
@@ -440,7 +577,8 @@ Status Tablet::DecodeWriteOperations(const Schema* client_schema,
   vector<DecodedRowOperation> ops;
 
   // Decode the ops
-  RowOperationsPBDecoder dec(&tx_state->request()->row_operations(),
+  RowOperationsPBDecoder dec(tx_state->rows_data(),
+                             tx_state->indirect_data(),
                              client_schema,
                              schema(),
                              tx_state->arena());
@@ -459,13 +597,52 @@ Status Tablet::AcquireRowLocks(WriteTransactionState* tx_state) {
   TRACE_EVENT1("tablet", "Tablet::AcquireRowLocks",
                "num_locks", tx_state->row_ops().size());
   TRACE("PREPARE: Acquiring locks for $0 operations", tx_state->row_ops().size());
+  vector<Slice> keys;
+  keys.reserve(tx_state->row_ops().size());
+
+  // Look up the codegenned key encoder once for the whole batch.
+  scoped_refptr<codegen::KeyEncoderFunctions> key_encoder;
+  if (FLAGS_tablet_use_codegen_key_encoder) {
+    codegen::CompilationManager::GetSingleton()->RequestKeyEncoder(key_schema_, &key_encoder);
+  }
+  vector<ConstContiguousRow> row_keys;
+  row_keys.reserve(tx_state->row_ops().size());
   for (RowOp* op : tx_state->row_ops()) {
-    RETURN_NOT_OK(AcquireLockForOp(tx_state, op));
+    ConstContiguousRow row_key(&key_schema_, op->decoded_op.row_data);
+    if (key_encoder) {
+      op->key_probe.reset(new tablet::RowSetKeyProbe(row_key, *key_encoder.get()));
+    } else {
+      op->key_probe.reset(new tablet::RowSetKeyProbe(row_key));
+    }
+    row_keys.push_back(row_key);
+    keys.push_back(op->key_probe->encoded_key_slice());
+  }
+  RETURN_NOT_OK(CheckRowsInTablet(row_keys));
+
+  // Lock all the rows in one pass over the lock table.
+  vector<ScopedRowLock> locks;
+  lock_manager_.AcquireLocks(tx_state, keys, LockManager::LOCK_EXCLUSIVE, &locks);
+  for (int i = 0; i < locks.size(); i++) {
+    tx_state->row_ops()[i]->row_lock = std::move(locks[i]);
   }
   TRACE("PREPARE: locks acquired");
   return Status::OK();
 }
 
+Status Tablet::CheckRowsInTablet(const vector<ConstContiguousRow>& rows) const {
+  vector<bool> contains;
+  RETURN_NOT_OK(metadata_->partition_schema().PartitionContainsRows(metadata_->partition(),
+                                                                    rows,
+                                                                    &contains));
+  for (int i = 0; i < rows.size(); i++) {
+    if (PREDICT_FALSE(!contains[i])) {
+      // Build the same error as for a single row.
+      return CheckRowInTablet(rows[i]);
+    }
+  }
+  return Status::OK();
+}
+
 Status Tablet::CheckRowInTablet(const ConstContiguousRow& row) const {
   bool contains_row;
   RETURN_NOT_OK(metadata_->partition_schema().PartitionContainsRow(metadata_->partition(),
@@ -482,18 +659,6 @@ Status Tablet::CheckRowInTablet(const ConstContiguousRow& row) const {
   return Status::OK();
 }
 
-Status Tablet::AcquireLockForOp(WriteTransactionState* tx_state, RowOp* op) {
-  ConstContiguousRow row_key(&key_schema_, op->decoded_op.row_data);
-  op->key_probe.reset(new tablet::RowSetKeyProbe(row_key));
-  RETURN_NOT_OK(CheckRowInTablet(row_key));
-
-  op->row_lock = ScopedRowLock(&lock_manager_,
-                               tx_state,
-                               op->key_probe->encoded_key_slice(),
-                               LockManager::LOCK_EXCLUSIVE);
-  return Status::OK();
-}
-
 void Tablet::AssignTimestampAndStartTransactionForTests(WriteTransactionState* tx_state) {
   CHECK(!tx_state->has_timestamp());
   // Don't support COMMIT_WAIT for tests that don't boot a tablet server.
@@ -640,13 +805,14 @@ Status Tablet::InsertOrUpsertUnlocked(const IOContext* io_context,
 
   // Now try to op into memrowset. The memrowset itself will return
   // AlreadyPresent if it has already been oped there.
-  Status s = comps->memrowset->Insert(ts, row, tx_state->op_id());
+  MemRowSet* mrs = comps->memrowset_for_key(op->key_probe->encoded_key_slice());
+  Status s = mrs->Insert(ts, row, tx_state->op_id());
   if (s.ok()) {
-    op->SetInsertSucceeded(comps->memrowset->mrs_id());
+    op->SetInsertSucceeded(mrs->mrs_id());
   } else {
     if (s.IsAlreadyPresent()) {
       if (is_upsert) {
-        return ApplyUpsertAsUpdate(io_context, tx_state, op, comps->memrowset.get(), stats);
+        return ApplyUpsertAsUpdate(io_context, tx_state, op, mrs, stats);
       }
       if (metrics_) {
         metrics_->insertions_failed_dup_key->Increment();
@@ -732,7 +898,7 @@ vector<RowSet*> Tablet::FindRowSetsToCheck(const RowOp* op,
   // COMMIT message which tells us specifically which memory store to apply it to.
   for (const auto& store : op->orig_result_from_log_->mutated_stores()) {
     if (store.has_mrs_id()) {
-      to_check.push_back(comps->memrowset.get());
+      to_check.push_back(comps->memrowset_for_key(op->key_probe->encoded_key_slice()));
     } else {
       DCHECK(store.has_rs_id());
       RowSet* drs = comps->rowsets->drs_by_id(store.rs_id());
@@ -763,7 +929,8 @@ Status Tablet::MutateRowUnlocked(const IOContext* io_context,
   // If we found the row in any existing RowSet, mutate it there. Otherwise
   // attempt to mutate in the MRS.
   RowSet* rs_to_attempt = mutate->present_in_rowset ?
-      mutate->present_in_rowset : comps->memrowset.get();
+      mutate->present_in_rowset :
+      comps->memrowset_for_key(mutate->key_probe->encoded_key_slice());
   Status s = rs_to_attempt->MutateRow(ts,
                                       *mutate->key_probe,
                                       mutate->decoded_op.changelist,
@@ -854,6 +1021,12 @@ Status Tablet::BulkCheckPresence(const IOContext* io_context, WriteTransactionSt
   // 'pending_group' and then calls 'ProcessPendingGroup' when the next group
   // begins.
   vector<pair<RowSet*, int>> pending_group;
+  // The ops of the group which weren't found present yet, with their probes,
+  // stats, and the results of checking them.
+  vector<RowOp*> group_ops;
+  vector<const RowSetKeyProbe*> group_probes;
+  vector<ProbeStats*> group_stats;
+  vector<bool> group_present;
   Status s;
   const auto& ProcessPendingGroup = [&]() {
     if (pending_group.empty() || !s.ok()) return;
@@ -867,6 +1040,9 @@ Status Tablet::BulkCheckPresence(const IOContext* io_context, WriteTransactionSt
                             return s_a.compare(s_b) < 0;
                           }));
     RowSet* rs = pending_group[0].first;
+    group_ops.clear();
+    group_probes.clear();
+    group_stats.clear();
     for (auto it = pending_group.begin();
          it != pending_group.end();
          ++it) {
@@ -877,20 +1053,26 @@ Status Tablet::BulkCheckPresence(const IOContext* io_context, WriteTransactionSt
         // Already found this op present somewhere.
         continue;
       }
-
-      bool present = false;
-      s = rs->CheckRowPresent(*op->key_probe, io_context,
-                              &present, tx_state->mutable_op_stats(op_idx));
-      if (PREDICT_FALSE(!s.ok())) {
-        LOG(WARNING) << Substitute("Tablet $0 failed to check row presence for op $1: $2",
-            tablet_id(), op->ToString(key_schema_), s.ToString());
-        return;
-      }
-      if (present) {
-        op->present_in_rowset = rs;
-      }
+      group_ops.push_back(op);
+      group_probes.push_back(op->key_probe.get());
+      group_stats.push_back(tx_state->mutable_op_stats(op_idx));
     }
     pending_group.clear();
+    if (group_ops.empty()) return;
+
+    // Check the whole group at once, so that the rowset can batch its bloom
+    // filter probes.
+    s = rs->CheckRowsPresent(group_probes, group_stats, io_context, &group_present);
+    if (PREDICT_FALSE(!s.ok())) {
+      LOG(WARNING) << Substitute("Tablet $0 failed to check row presence for $1 ops in $2: $3",
+          tablet_id(), group_ops.size(), rs->ToString(), s.ToString());
+      return;
+    }
+    for (int i = 0; i < group_ops.size(); i++) {
+      if (group_present[i]) {
+        group_ops[i]->present_in_rowset = rs;
+      }
+    }
   };
 
   const TabletComponents* comps = DCHECK_NOTNULL(tx_state->tablet_components());
@@ -938,7 +1120,7 @@ Status Tablet::ApplyRowOperations(WriteTransactionState* tx_state) {
     ValidateOpOrMarkFailed(op);
   }
 
-  IOContext io_context({ tablet_id() });
+  const IOContext io_context = MakeIOContext(IOContext::SOURCE_OTHER);
   RETURN_NOT_OK(BulkCheckPresence(&io_context, tx_state));
 
   // Actually apply the ops.
@@ -949,7 +1131,9 @@ Status Tablet::ApplyRowOperations(WriteTransactionState* tx_state) {
     RETURN_NOT_OK(ApplyRowOperation(&io_context, tx_state, row_op,
                                     tx_state->mutable_op_stats(op_idx)));
     DCHECK(row_op->has_result());
+    hot_spots_->RecordKey(HotSpotTracker::WRITE, row_op->key_probe->encoded_key_slice());
   }
+  hot_spots_->RecordRows(HotSpotTracker::WRITE, num_ops);
 
   if (metrics_ && num_ops > 0) {
     metrics_->AddProbeStats(tx_state->mutable_op_stats(0), num_ops, tx_state->arena());
@@ -976,6 +1160,10 @@ Status Tablet::ApplyRowOperation(const IOContext* io_context,
     return Status::OK();
   }
 
+  if (row_cache_) {
+    row_cache_->Invalidate(row_op->key_probe->encoded_key_slice(), tx_state->timestamp());
+  }
+
   // If we were unable to check rowset presence in batch (e.g. because we are processing
   // a batch which contains some duplicate keys) we need to do so now.
   if (PREDICT_FALSE(!row_op->checked_present)) {
@@ -1021,36 +1209,9 @@ void Tablet::ModifyRowSetTree(const RowSetTree& old_tree,
                               const RowSetVector& rowsets_to_remove,
                               const RowSetVector& rowsets_to_add,
                               RowSetTree* new_tree) {
-  RowSetVector post_swap;
-
-  // O(n^2) diff algorithm to collect the set of rowsets excluding
-  // the rowsets that were included in the compaction
-  int num_removed = 0;
-
-  for (const shared_ptr<RowSet> &rs : old_tree.all_rowsets()) {
-    // Determine if it should be removed
-    bool should_remove = false;
-    for (const shared_ptr<RowSet> &to_remove : rowsets_to_remove) {
-      if (to_remove == rs) {
-        should_remove = true;
-        num_removed++;
-        break;
-      }
-    }
-    if (!should_remove) {
-      post_swap.push_back(rs);
-    }
-  }
-
-  CHECK_EQ(num_removed, rowsets_to_remove.size());
-
-  // Then push the new rowsets on the end of the new list
-  std::copy(rowsets_to_add.begin(),
-            rowsets_to_add.end(),
-            std::back_inserter(post_swap));
-
-
-  CHECK_OK(new_tree->Reset(post_swap));
+  // The rowsets kept from 'old_tree' share their bounds with it, so only the
+  // added rowsets are sorted into the new tree.
+  CHECK_OK(new_tree->Reset(old_tree, rowsets_to_remove, rowsets_to_add));
 }
 
 void Tablet::AtomicSwapRowSets(const RowSetVector &old_rowsets,
@@ -1067,7 +1228,7 @@ void Tablet::AtomicSwapRowSetsUnlocked(const RowSetVector &to_remove,
   ModifyRowSetTree(*components_->rowsets,
                    to_remove, to_add, new_tree.get());
 
-  components_ = new TabletComponents(components_->memrowset, new_tree);
+  components_ = new TabletComponents(components_->memrowsets, new_tree);
 
   // Recompute the average rowset height.
   // TODO(wdberkeley): We should be able to cache the computation of the CDF
@@ -1114,12 +1275,30 @@ bool Tablet::GetTabletAncientHistoryMark(Timestamp* ancient_history_mark) const
   return true;
 }
 
+bool Tablet::GetRowExpirationCutoff(const Schema& schema,
+                                    clock::Clock* clock,
+                                    int64_t* cutoff_micros) {
+  const int ttl_col_idx = schema.find_ttl_column();
+  if (ttl_col_idx == Schema::kColumnNotFound || !clock->HasPhysicalComponent()) {
+    return false;
+  }
+  const int64_t now_micros = HybridClock::GetPhysicalValueMicros(clock->Now());
+  const int64_t ttl_seconds = schema.column(ttl_col_idx).attributes().ttl_seconds;
+  // Nothing is expired if the TTL goes back before the epoch.
+  *cutoff_micros = ttl_seconds <= now_micros / 1000000 ?
+      now_micros - ttl_seconds * 1000000 : std::numeric_limits<int64_t>::min();
+  return true;
+}
+
 HistoryGcOpts Tablet::GetHistoryGcOpts() const {
   Timestamp ancient_history_mark;
-  if (GetTabletAncientHistoryMark(&ancient_history_mark)) {
-    return HistoryGcOpts::Enabled(ancient_history_mark);
+  HistoryGcOpts opts = GetTabletAncientHistoryMark(&ancient_history_mark) ?
+      HistoryGcOpts::Enabled(ancient_history_mark) : HistoryGcOpts::Disabled();
+  int64_t expiration_cutoff_micros;
+  if (GetRowExpirationCutoff(*schema(), clock_.get(), &expiration_cutoff_micros)) {
+    return opts.WithRowExpiration(expiration_cutoff_micros);
   }
-  return HistoryGcOpts::Disabled();
+  return opts;
 }
 
 Status Tablet::Flush() {
@@ -1132,52 +1311,67 @@ Status Tablet::FlushUnlocked() {
   TRACE_EVENT0("tablet", "Tablet::FlushUnlocked");
   RETURN_NOT_OK(CheckHasNotBeenStopped());
   RowSetsInCompaction input;
-  shared_ptr<MemRowSet> old_mrs;
+  MemRowSetVector old_mrss;
   {
-    // Create a new MRS with the latest schema.
+    // Create new MRSs with the latest schema.
     std::lock_guard<rw_spinlock> lock(component_lock_);
-    RETURN_NOT_OK(ReplaceMemRowSetUnlocked(&input, &old_mrs));
+    RETURN_NOT_OK(ReplaceMemRowSetsUnlocked(&input, &old_mrss));
   }
 
-  // Wait for any in-flight transactions to finish against the old MRS
-  // before we flush it.
+  // Wait for any in-flight transactions to finish against the old MRSs
+  // before we flush them.
   //
   // This may fail if the tablet has been stopped.
   RETURN_NOT_OK(mvcc_.WaitForApplyingTransactionsToCommit());
 
-  // Note: "input" should only contain old_mrs.
-  return FlushInternal(input, old_mrs);
+  // Note: "input" should only contain old_mrss.
+  return FlushInternal(input, old_mrss);
 }
 
-Status Tablet::ReplaceMemRowSetUnlocked(RowSetsInCompaction *compaction,
-                                        shared_ptr<MemRowSet> *old_ms) {
-  *old_ms = components_->memrowset;
-  // Mark the memrowset rowset as locked, so compactions won't consider it
-  // for inclusion in any concurrent compactions.
-  std::unique_lock<std::mutex> ms_lock(*(*old_ms)->compact_flush_lock(), std::try_to_lock);
-  CHECK(ms_lock.owns_lock());
+Status Tablet::CreateMemRowSetsUnlocked(const Schema& schema, MemRowSetVector* mrss) {
+  MemRowSetVector new_mrss;
+  for (int i = 0; i < num_memrowsets_; i++) {
+    shared_ptr<MemRowSet> new_mrs;
+    RETURN_NOT_OK(MemRowSet::Create(next_mrs_id_++, schema,
+                                    log_anchor_registry_.get(),
+                                    mem_trackers_.tablet_tracker,
+                                    &new_mrs));
+    new_mrss.emplace_back(std::move(new_mrs));
+  }
+  *mrss = std::move(new_mrss);
+  return Status::OK();
+}
 
-  // Add to compaction.
-  compaction->AddRowSet(*old_ms, std::move(ms_lock));
+Status Tablet::ReplaceMemRowSetsUnlocked(RowSetsInCompaction *compaction,
+                                         MemRowSetVector* old_mrss) {
+  *old_mrss = components_->memrowsets;
+  RowSetVector old_rowsets;
+  for (const auto& old_ms : *old_mrss) {
+    // Mark the memrowset rowset as locked, so compactions won't consider it
+    // for inclusion in any concurrent compactions.
+    std::unique_lock<std::mutex> ms_lock(*old_ms->compact_flush_lock(), std::try_to_lock);
+    CHECK(ms_lock.owns_lock());
 
-  shared_ptr<MemRowSet> new_mrs;
-  RETURN_NOT_OK(MemRowSet::Create(next_mrs_id_++, *schema(),
-                                  log_anchor_registry_.get(),
-                                  mem_trackers_.tablet_tracker,
-                                  &new_mrs));
+    // Add to compaction.
+    compaction->AddRowSet(old_ms, std::move(ms_lock));
+    old_rowsets.push_back(old_ms);
+  }
+
+  MemRowSetVector new_mrss;
+  RETURN_NOT_OK(CreateMemRowSetsUnlocked(*schema(), &new_mrss));
   shared_ptr<RowSetTree> new_rst(new RowSetTree());
   ModifyRowSetTree(*components_->rowsets,
                    RowSetVector(), // remove nothing
-                   { *old_ms }, // add the old MRS
+                   old_rowsets, // add the old MRSs
                    new_rst.get());
 
-  // Swap it in
-  components_ = new TabletComponents(new_mrs, new_rst);
+  // Swap them in
+  components_ = new TabletComponents(std::move(new_mrss), new_rst);
   return Status::OK();
 }
 
 Status Tablet::FlushInternal(const RowSetsInCompaction& input,
-                             const shared_ptr<MemRowSet>& old_ms) {
+                             const MemRowSetVector& old_mrss) {
   {
     std::lock_guard<simple_spinlock> l(state_lock_);
     RETURN_NOT_OK(CheckHasNotBeenStoppedUnlocked());
@@ -1188,19 +1382,29 @@ Status Tablet::FlushInternal(const RowSetsInCompaction& input,
   // it in as a new rowset, replacing it with an empty one.
   //
   // At this point, we have already swapped in a new empty rowset, and
-  // any new inserts are going into that one. 'old_ms' is effectively
+  // any new inserts are going into that one. 'old_mrss' are effectively
   // frozen -- no new inserts should arrive after this point.
   //
-  // NOTE: updates and deletes may still arrive into 'old_ms' at this point.
+  // NOTE: updates and deletes may still arrive into 'old_mrss' at this point.
   //
   // TODO(perf): there's a memrowset.Freeze() call which we might be able to
   // use to improve iteration performance during the flush. The old design
   // used this, but not certain whether it's still doable with the new design.
 
-  uint64_t start_insert_count = old_ms->debug_insert_count();
-  int64_t mrs_being_flushed = old_ms->mrs_id();
+  // The MRSs have consecutive ids: flushing them all together makes the
+  // highest one durable.
+  uint64_t start_insert_count = 0;
+  int64_t mrs_being_flushed = -1;
+  bool empty = true;
+  size_t memory_footprint = 0;
+  for (const auto& old_ms : old_mrss) {
+    start_insert_count += old_ms->debug_insert_count();
+    mrs_being_flushed = std::max<int64_t>(mrs_being_flushed, old_ms->mrs_id());
+    empty &= old_ms->empty();
+    memory_footprint += old_ms->memory_footprint();
+  }
 
-  if (old_ms->empty()) {
+  if (empty) {
     // If we're flushing an empty RowSet, we can short circuit here rather than
     // waiting until the check at the end of DoCompactionAndFlush(). This avoids
     // the need to create cfiles and write their headers only to later delete
@@ -1217,12 +1421,16 @@ Status Tablet::FlushInternal(const RowSetsInCompaction& input,
   VLOG_WITH_PREFIX(1) << Substitute("Flush: entering stage 1 (old memrowset"
                                     "already frozen for inserts). Memstore"
                                     "in-memory size: $0 bytes",
-                                    old_ms->memory_footprint());
+                                    memory_footprint);
 
   RETURN_NOT_OK(DoMergeCompactionOrFlush(input, mrs_being_flushed));
 
   // Sanity check that no insertions happened during our flush.
-  CHECK_EQ(start_insert_count, old_ms->debug_insert_count())
+  uint64_t end_insert_count = 0;
+  for (const auto& old_ms : old_mrss) {
+    end_insert_count += old_ms->debug_insert_count();
+  }
+  CHECK_EQ(start_insert_count, end_insert_count)
     << "Sanity check failed: insertions continued in memrowset "
     << "after flush was triggered! Aborting to prevent data loss.";
 
@@ -1301,15 +1509,18 @@ Status Tablet::RewindSchemaForBootstrap(const Schema& new_schema,
   {
     std::lock_guard<rw_spinlock> lock(component_lock_);
 
-    shared_ptr<MemRowSet> old_mrs = components_->memrowset;
     shared_ptr<RowSetTree> old_rowsets = components_->rowsets;
-    CHECK(old_mrs->empty());
-    shared_ptr<MemRowSet> new_mrs;
-    RETURN_NOT_OK(MemRowSet::Create(old_mrs->mrs_id(), new_schema,
-                                    log_anchor_registry_.get(),
-                                    mem_trackers_.tablet_tracker,
-                                    &new_mrs));
-    components_ = new TabletComponents(new_mrs, old_rowsets);
+    MemRowSetVector new_mrss;
+    for (const auto& old_mrs : components_->memrowsets) {
+      CHECK(old_mrs->empty());
+      shared_ptr<MemRowSet> new_mrs;
+      RETURN_NOT_OK(MemRowSet::Create(old_mrs->mrs_id(), new_schema,
+                                      log_anchor_registry_.get(),
+                                      mem_trackers_.tablet_tracker,
+                                      &new_mrs));
+      new_mrss.emplace_back(std::move(new_mrs));
+    }
+    components_ = new TabletComponents(std::move(new_mrss), old_rowsets);
   }
   return Status::OK();
 }
@@ -1331,7 +1542,7 @@ void Tablet::SetFlushCompactCommonHooksForTests(
 
 int32_t Tablet::CurrentMrsIdForTests() const {
   shared_lock<rw_spinlock> l(component_lock_);
-  return components_->memrowset->mrs_id();
+  return components_->memrowsets.back()->mrs_id();
 }
 
 bool Tablet::ShouldThrottleAllow(int64_t bytes) {
@@ -1520,6 +1731,159 @@ Status Tablet::FlushMetadata(const RowSetVector& to_remove,
   return metadata_->UpdateAndFlush(to_remove_meta, to_add, mrs_being_flushed);
 }
 
+void Tablet::PickCompactionSplitKeys(const RowSetsInCompaction& input,
+                                     const IOContext* io_context,
+                                     vector<string>* split_keys) const {
+  // The number of keys sampled from each rowset for each key range.
+  static const int kSamplesPerRange = 16;
+
+  split_keys->clear();
+  uint64_t total_size = 0;
+  for (const auto& rs : input.rowsets()) {
+    total_size += rs->OnDiskSize();
+  }
+  const uint64_t min_range_size = std::max<uint64_t>(
+      1, static_cast<uint64_t>(FLAGS_tablet_compaction_min_key_range_size_mb) * 1024 * 1024);
+  const int num_ranges = std::min<uint64_t>(FLAGS_tablet_compaction_num_key_ranges,
+                                            total_size / min_range_size);
+  if (num_ranges <= 1) {
+    return;
+  }
+
+  // Sample the keys of each rowset, each sample standing for an equal share
+  // of the rowset's size.
+  vector<pair<string, double>> samples;
+  for (const auto& rs : input.rowsets()) {
+    vector<string> keys;
+    Status s = rs->SampleEncodedKeys(kSamplesPerRange * num_ranges, io_context, &keys);
+    if (PREDICT_FALSE(!s.ok())) {
+      LOG_WITH_PREFIX(WARNING) << "Unable to split the compaction into key ranges: "
+                               << s.ToString();
+      return;
+    }
+    const double weight = static_cast<double>(rs->OnDiskSize()) / (keys.size() + 1);
+    for (auto& key : keys) {
+      samples.emplace_back(std::move(key), weight);
+    }
+  }
+  std::sort(samples.begin(), samples.end());
+
+  // Split where the cumulative size of the samples crosses each multiple of
+  // the range size.
+  const double range_size = static_cast<double>(total_size) / num_ranges;
+  double cumulative_size = 0;
+  for (const auto& sample : samples) {
+    cumulative_size += sample.second;
+    if (cumulative_size >= range_size * (split_keys->size() + 1) &&
+        (split_keys->empty() || split_keys->back() < sample.first)) {
+      split_keys->push_back(sample.first);
+      if (split_keys->size() + 1 == num_ranges) {
+        break;
+      }
+    }
+  }
+}
+
+Status Tablet::WriteCompactionOutput(const RowSetsInCompaction& input,
+                                     int64_t mrs_being_flushed,
+                                     const MvccSnapshot& snap,
+                                     const HistoryGcOpts& history_gc_opts,
+                                     const IOContext* io_context,
+                                     int64_t* rows_gced,
+                                     int64_t* helpers_cpu_time_us,
+                                     vector<unique_ptr<RollingDiskRowSetWriter>>* writers) {
+  // Flushes already write the columns of their output in parallel.
+  vector<string> split_keys;
+  if (mrs_being_flushed == TabletMetadata::kNoMrsFlushed) {
+    PickCompactionSplitKeys(input, io_context, &split_keys);
+  }
+  const int num_ranges = split_keys.size() + 1;
+  Arena arena(1024);
+  vector<gscoped_ptr<EncodedKey>> bounds(split_keys.size());
+  for (int i = 0; i < split_keys.size(); i++) {
+    RETURN_NOT_OK(EncodedKey::DecodeEncodedString(*schema(), &arena, split_keys[i],
+                                                  &bounds[i]));
+  }
+
+  writers->clear();
+  vector<shared_ptr<CompactionInput>> merges(num_ranges);
+  for (int i = 0; i < num_ranges; i++) {
+    RETURN_NOT_OK(input.CreateCompactionInput(snap, schema(), io_context, &merges[i]));
+    if (num_ranges > 1) {
+      merges[i]->SetKeyRange(i == 0 ? nullptr : bounds[i - 1].get(),
+                             i == num_ranges - 1 ? nullptr : bounds[i].get());
+    }
+    unique_ptr<RollingDiskRowSetWriter> drsw(
+        new RollingDiskRowSetWriter(metadata_.get(), merges[i]->schema(), DefaultBloomSizing(),
+                                    compaction_policy_->target_rowset_size()));
+    // Newly flushed rows are the most likely to be read, while compactions
+    // move the rows which survived them to slow storage.
+    drsw->set_data_tier(mrs_being_flushed == TabletMetadata::kNoMrsFlushed ?
+                        fs::StorageTier::SLOW : fs::StorageTier::FAST);
+    RETURN_NOT_OK_PREPEND(drsw->Open(), "Failed to open DiskRowSet for flush");
+    writers->emplace_back(std::move(drsw));
+  }
+
+  *rows_gced = 0;
+  *helpers_cpu_time_us = 0;
+  vector<int64_t> range_rows_gced(num_ranges);
+  // The data blocks of compactions which aren't split may be copied. The
+  // merged input is still used to reupdate the missed deltas.
+  const bool copy_data_blocks = mrs_being_flushed == TabletMetadata::kNoMrsFlushed &&
+      num_ranges == 1 && FLAGS_tablet_compaction_copy_data_blocks;
+  const auto write_range = [&](int i) {
+    RollingDiskRowSetWriter* drsw = (*writers)[i].get();
+    if (copy_data_blocks) {
+      RETURN_NOT_OK_PREPEND(FlushRowSetsInCompaction(input, schema(), snap, history_gc_opts,
+                                                     io_context, drsw, &range_rows_gced[i]),
+                            "Flush to disk failed");
+    } else {
+      RETURN_NOT_OK_PREPEND(FlushCompactionInput(merges[i].get(), snap, history_gc_opts, drsw,
+                                                 &range_rows_gced[i]),
+                            "Flush to disk failed");
+    }
+    return drsw->Finish().CloneAndPrepend("Failed to finish DRS writer");
+  };
+  if (num_ranges == 1) {
+    RETURN_NOT_OK(write_range(0));
+    *rows_gced = range_rows_gced[0];
+    return Status::OK();
+  }
+
+  VLOG_WITH_PREFIX(1) << Substitute("Compaction: merging $0 key ranges in parallel", num_ranges);
+  gscoped_ptr<ThreadPool> pool;
+  RETURN_NOT_OK(ThreadPoolBuilder("compact-range")
+                .set_min_threads(0)
+                .set_max_threads(num_ranges - 1)
+                .Build(&pool));
+  vector<Status> statuses(num_ranges);
+  vector<int64_t> range_cpu_time_us(num_ranges);
+  for (int i = 1; i < num_ranges; i++) {
+    Status s = pool->SubmitFunc([&, i]() {
+      Stopwatch sw(Stopwatch::THIS_THREAD);
+      sw.start();
+      statuses[i] = write_range(i);
+      sw.stop();
+      range_cpu_time_us[i] = (sw.elapsed().user + sw.elapsed().system) / 1000;
+    });
+    if (PREDICT_FALSE(!s.ok())) {
+      statuses[i] = s;
+    }
+  }
+  // The first range is merged on the calling thread.
+  statuses[0] = write_range(0);
+  pool->Wait();
+  pool->Shutdown();
+  for (const auto& s : statuses) {
+    RETURN_NOT_OK(s);
+  }
+  for (int i = 0; i < num_ranges; i++) {
+    *rows_gced += range_rows_gced[i];
+    *helpers_cpu_time_us += range_cpu_time_us[i];
+  }
+  return Status::OK();
+}
+
 Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
                                         int64_t mrs_being_flushed) {
   const char *op_name =
@@ -1528,7 +1892,15 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
                "tablet_id", tablet_id(),
                "op", op_name);
 
-  const IOContext io_context({ tablet_id() });
+  const IOContext io_context = MakeIOContext(
+      mrs_being_flushed == TabletMetadata::kNoMrsFlushed ? IOContext::SOURCE_COMPACTION
+                                                         : IOContext::SOURCE_FLUSH,
+      IOContext::CACHE_READ_ONCE);
+
+  // The CPU time of the operation on this thread. That of the threads merging
+  // other key ranges is returned by WriteCompactionOutput().
+  Stopwatch cpu_sw(Stopwatch::THIS_THREAD);
+  cpu_sw.start();
 
   MvccSnapshot flush_snap(mvcc_);
   VLOG_WITH_PREFIX(1) << Substitute("$0: entering phase 1 (flushing snapshot). "
@@ -1540,17 +1912,48 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
                           "PostTakeMvccSnapshot hook failed");
   }
 
-  shared_ptr<CompactionInput> merge;
-  RETURN_NOT_OK(input.CreateCompactionInput(flush_snap, schema(), &io_context, &merge));
-
-  RollingDiskRowSetWriter drsw(metadata_.get(), merge->schema(), DefaultBloomSizing(),
-                               compaction_policy_->target_rowset_size());
-  RETURN_NOT_OK_PREPEND(drsw.Open(), "Failed to open DiskRowSet for flush");
-
   HistoryGcOpts history_gc_opts = GetHistoryGcOpts();
-  RETURN_NOT_OK_PREPEND(FlushCompactionInput(merge.get(), flush_snap, history_gc_opts, &drsw),
-                        "Flush to disk failed");
-  RETURN_NOT_OK_PREPEND(drsw.Finish(), "Failed to finish DRS writer");
+  vector<unique_ptr<RollingDiskRowSetWriter>> drsws;
+  int64_t rows_gced;
+  int64_t helpers_cpu_time_us;
+  RETURN_NOT_OK(WriteCompactionOutput(input, mrs_being_flushed, flush_snap, history_gc_opts,
+                                      &io_context, &rows_gced, &helpers_cpu_time_us, &drsws));
+  int64_t rows_written = 0;
+  int drs_written = 0;
+  uint64_t bytes_written = 0;
+  for (const auto& drsw : drsws) {
+    rows_written += drsw->rows_written_count();
+    drs_written += drsw->drs_written_count();
+    bytes_written += drsw->written_size();
+  }
+  if (io_context.metrics) {
+    io_context.metrics->RecordWrite(io_context.source, bytes_written);
+  }
+
+  // Account for the work of a successful compaction, so that its write
+  // amplification may be tracked.
+  const auto record_compaction_stats = [&]() {
+    if (mrs_being_flushed != TabletMetadata::kNoMrsFlushed) {
+      return;
+    }
+    cpu_sw.stop();
+    const int64_t cpu_time_us =
+        (cpu_sw.elapsed().user + cpu_sw.elapsed().system) / 1000 + helpers_cpu_time_us;
+    uint64_t bytes_read = 0;
+    for (const auto& rs : input.rowsets()) {
+      bytes_read += rs->OnDiskSize();
+    }
+    TRACE_COUNTER_INCREMENT("compact_rs_bytes_read", bytes_read);
+    TRACE_COUNTER_INCREMENT("compact_rs_bytes_written", bytes_written);
+    TRACE_COUNTER_INCREMENT("compact_rs_rows_gced", rows_gced);
+    TRACE_COUNTER_INCREMENT("compact_rs_cpu_time_us", cpu_time_us);
+    if (metrics_) {
+      metrics_->compact_rs_bytes_read->IncrementBy(bytes_read);
+      metrics_->compact_rs_bytes_written->IncrementBy(bytes_written);
+      metrics_->compact_rs_rows_gced->IncrementBy(rows_gced);
+      metrics_->compact_rs_cpu_time->IncrementBy(cpu_time_us);
+    }
+  };
 
   if (common_hooks_) {
     RETURN_NOT_OK_PREPEND(common_hooks_->PostWriteSnapshot(),
@@ -1560,19 +1963,25 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
   // Though unlikely, it's possible that no rows were written because all of
   // the input rows were GCed in this compaction. In that case, we don't
   // actually want to reopen.
-  if (drsw.rows_written_count() == 0) {
+  if (rows_written == 0) {
     LOG_WITH_PREFIX(INFO) << op_name << " resulted in no output rows (all input rows "
                           << "were GCed!)  Removing all input rowsets.";
-    return HandleEmptyCompactionOrFlush(input.rowsets(), mrs_being_flushed);
+    RETURN_NOT_OK(HandleEmptyCompactionOrFlush(input.rowsets(), mrs_being_flushed));
+    record_compaction_stats();
+    return Status::OK();
   }
 
   // The RollingDiskRowSet writer wrote out one or more RowSets as the
   // output. Open these into 'new_rowsets'.
   vector<shared_ptr<RowSet> > new_disk_rowsets;
   RowSetMetadataVector new_drs_metas;
-  drsw.GetWrittenRowSetMetadata(&new_drs_metas);
+  for (const auto& drsw : drsws) {
+    RowSetMetadataVector metas;
+    drsw->GetWrittenRowSetMetadata(&metas);
+    new_drs_metas.insert(new_drs_metas.end(), metas.begin(), metas.end());
+  }
 
-  if (metrics_.get()) metrics_->bytes_flushed->IncrementBy(drsw.written_size());
+  if (metrics_.get()) metrics_->bytes_flushed->IncrementBy(bytes_written);
   CHECK(!new_drs_metas.empty());
   {
     TRACE_EVENT0("tablet", "Opening compaction results");
@@ -1622,7 +2031,8 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
                                     "duplicate updates in new rowsets)",
                                     op_name);
   shared_ptr<DuplicatingRowSet> inprogress_rowset(
-    new DuplicatingRowSet(input.rowsets(), new_disk_rowsets));
+    new DuplicatingRowSet(input.rowsets(), new_disk_rowsets,
+                          history_gc_opts.expiration_enabled()));
 
   // The next step is to swap in the DuplicatingRowSet, and at the same time, determine an
   // MVCC snapshot which includes all of the transactions that saw a pre-DuplicatingRowSet
@@ -1677,6 +2087,7 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
   VLOG_WITH_PREFIX(1) << Substitute("$0: Phase 2: carrying over any updates "
                                     "which arrived during Phase 1. Snapshot: $1",
                                     op_name, non_duplicated_txns_snap.ToString());
+  shared_ptr<CompactionInput> merge;
   RETURN_NOT_OK_PREPEND(
       input.CreateCompactionInput(non_duplicated_txns_snap, schema(), &io_context, &merge),
           Substitute("Failed to create $0 inputs", op_name).c_str());
@@ -1724,12 +2135,10 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
   // their metadata was written to disk.
   AtomicSwapRowSets({ inprogress_rowset }, new_disk_rowsets);
 
-  const auto rows_written = drsw.rows_written_count();
-  const auto drs_written = drsw.drs_written_count();
-  const auto bytes_written = drsw.written_size();
   TRACE_COUNTER_INCREMENT("rows_written", rows_written);
   TRACE_COUNTER_INCREMENT("drs_written", drs_written);
   TRACE_COUNTER_INCREMENT("bytes_written", bytes_written);
+  record_compaction_stats();
   VLOG_WITH_PREFIX(1) << Substitute("$0 successful on $1 rows ($2 rowsets, $3 bytes)",
                                     op_name,
                                     rows_written,
@@ -1793,7 +2202,7 @@ void Tablet::UpdateCompactionStats(MaintenanceOpStats* stats) {
   // been in the last 5 minutes, and somehow scale the compaction quality
   // based on that, so we favor hot tablets.
   double quality = 0;
-  unordered_set<const RowSet*> picked_set_ignored;
+  unordered_set<const RowSet*> picked_set;
 
   shared_ptr<RowSetTree> rowsets_copy;
   {
@@ -1803,14 +2212,35 @@ void Tablet::UpdateCompactionStats(MaintenanceOpStats* stats) {
 
   {
     std::lock_guard<std::mutex> compact_lock(compact_select_lock_);
-    WARN_NOT_OK(compaction_policy_->PickRowSets(*rowsets_copy, &picked_set_ignored, &quality, NULL),
+    WARN_NOT_OK(compaction_policy_->PickRowSets(*rowsets_copy, &picked_set, &quality, NULL),
                 Substitute("Couldn't determine compaction quality for $0", tablet_id()));
   }
+  uint64_t picked_size = 0;
+  for (const auto* rs : picked_set) {
+    picked_size += rs->OnDiskSize();
+  }
 
   VLOG_WITH_PREFIX(1) << "Best compaction for " << tablet_id() << ": " << quality;
 
   stats->set_runnable(quality >= 0);
   stats->set_perf_improvement(quality);
+  stats->set_workload_bytes(picked_size);
+}
+
+bool Tablet::IsHeavyCompactionRunning() const {
+  return metrics_ && (metrics_->compact_rs_running->value() > 0 ||
+                      metrics_->delta_major_compact_rs_running->value() > 0);
+}
+
+void Tablet::DeferHeavyCompactionsUntil(const MonoTime& deadline) {
+  std::lock_guard<simple_spinlock> l(compaction_deferral_lock_);
+  heavy_compactions_deferred_until_ = deadline;
+}
+
+bool Tablet::HeavyCompactionsDeferred() const {
+  std::lock_guard<simple_spinlock> l(compaction_deferral_lock_);
+  return heavy_compactions_deferred_until_.Initialized() &&
+      MonoTime::Now() < heavy_compactions_deferred_until_;
 }
 
 
@@ -1820,8 +2250,10 @@ Status Tablet::DebugDump(vector<string> *lines) {
   LOG_STRING(INFO, lines) << "Dumping tablet:";
   LOG_STRING(INFO, lines) << "---------------------------";
 
-  LOG_STRING(INFO, lines) << "MRS " << components_->memrowset->ToString() << ":";
-  RETURN_NOT_OK(components_->memrowset->DebugDump(lines));
+  for (const auto& mrs : components_->memrowsets) {
+    LOG_STRING(INFO, lines) << "MRS " << mrs->ToString() << ":";
+    RETURN_NOT_OK(mrs->DebugDump(lines));
+  }
 
   for (const shared_ptr<RowSet> &rs : components_->rowsets->all_rowsets()) {
     LOG_STRING(INFO, lines) << "RowSet " << rs->ToString() << ":";
@@ -1844,10 +2276,12 @@ Status Tablet::CaptureConsistentIterators(
   vector<unique_ptr<RowwiseIterator>> ret;
 
 
-  // Grab the memrowset iterator.
-  unique_ptr<RowwiseIterator> ms_iter;
-  RETURN_NOT_OK(components_->memrowset->NewRowIterator(opts, &ms_iter));
-  ret.emplace_back(ms_iter.release());
+  // Grab the memrowset iterators.
+  for (const auto& mrs : components_->memrowsets) {
+    unique_ptr<RowwiseIterator> ms_iter;
+    RETURN_NOT_OK(mrs->NewRowIterator(opts, &ms_iter));
+    ret.emplace_back(ms_iter.release());
+  }
 
 
   // Cull row-sets in the case of key-range queries.
@@ -1859,6 +2293,15 @@ Status Tablet::CaptureConsistentIterators(
     vector<RowSet*> interval_sets;
     components_->rowsets->FindRowSetsIntersectingInterval(lower_bound, upper_bound, &interval_sets);
     for (const RowSet *rs : interval_sets) {
+      if (opts.snap_to_exclude) {
+        bool relevant;
+        RETURN_NOT_OK_PREPEND(rs->IsRelevantForDiffScan(opts, &relevant),
+                              Substitute("Could not check the deltas of rowset $0",
+                                         rs->ToString()));
+        if (!relevant) {
+          continue;
+        }
+      }
       unique_ptr<RowwiseIterator> row_it;
       RETURN_NOT_OK_PREPEND(rs->NewRowIterator(opts, &row_it),
                             Substitute("Could not create iterator for rowset $0",
@@ -1869,9 +2312,33 @@ Status Tablet::CaptureConsistentIterators(
     return Status::OK();
   }
 
+  // Aggregate scans without predicates may fold the rollups of rowsets
+  // instead of reading their rows.
+  const bool fold_rollups = opts.aggregator &&
+      (spec == nullptr || spec->predicates().empty());
+
   // If there are no encoded predicates of the primary keys, then
   // fall back to grabbing all rowset iterators.
   for (const shared_ptr<RowSet> &rs : components_->rowsets->all_rowsets()) {
+    // Diff scans skip the rowsets which didn't change between their snapshots.
+    if (opts.snap_to_exclude) {
+      bool relevant;
+      RETURN_NOT_OK_PREPEND(rs->IsRelevantForDiffScan(opts, &relevant),
+                            Substitute("Could not check the deltas of rowset $0",
+                                       rs->ToString()));
+      if (!relevant) {
+        continue;
+      }
+    }
+    if (fold_rollups) {
+      bool folded;
+      RETURN_NOT_OK_PREPEND(rs->FoldRollup(opts, &folded),
+                            Substitute("Could not fold the rollup of rowset $0",
+                                       rs->ToString()));
+      if (folded) {
+        continue;
+      }
+    }
     unique_ptr<RowwiseIterator> row_it;
     RETURN_NOT_OK_PREPEND(rs->NewRowIterator(opts, &row_it),
                           Substitute("Could not create iterator for rowset $0",
@@ -1890,8 +2357,11 @@ Status Tablet::CountRows(uint64_t *count) const {
   GetComponents(&comps);
 
   // Now sum up the counts.
-  IOContext io_context({ tablet_id() });
-  *count = comps->memrowset->entry_count();
+  const IOContext io_context = MakeIOContext(IOContext::SOURCE_OTHER);
+  *count = 0;
+  for (const auto& mrs : comps->memrowsets) {
+    *count += mrs->entry_count();
+  }
   for (const shared_ptr<RowSet> &rowset : comps->rowsets->all_rowsets()) {
     rowid_t l_count;
     RETURN_NOT_OK(rowset->CountRows(&io_context, &l_count));
@@ -1906,7 +2376,11 @@ size_t Tablet::MemRowSetSize() const {
   GetComponents(&comps);
 
   if (comps) {
-    return comps->memrowset->memory_footprint();
+    size_t size = 0;
+    for (const auto& mrs : comps->memrowsets) {
+      size += mrs->memory_footprint();
+    }
+    return size;
   }
   return 0;
 }
@@ -1915,14 +2389,27 @@ bool Tablet::MemRowSetEmpty() const {
   scoped_refptr<TabletComponents> comps;
   GetComponents(&comps);
 
-  return comps->memrowset->empty();
+  for (const auto& mrs : comps->memrowsets) {
+    if (!mrs->empty()) {
+      return false;
+    }
+  }
+  return true;
 }
 
 size_t Tablet::MemRowSetLogReplaySize(const ReplaySizeMap& replay_size_map) const {
   scoped_refptr<TabletComponents> comps;
   GetComponents(&comps);
 
-  return GetReplaySizeForIndex(comps->memrowset->MinUnflushedLogIndex(), replay_size_map);
+  // The earliest index anchored by any of the MemRowSets, if any.
+  int64_t min_log_index = -1;
+  for (const auto& mrs : comps->memrowsets) {
+    int64_t index = mrs->MinUnflushedLogIndex();
+    if (index != -1 && (min_log_index == -1 || index < min_log_index)) {
+      min_log_index = index;
+    }
+  }
+  return GetReplaySizeForIndex(min_log_index, replay_size_map);
 }
 
 size_t Tablet::OnDiskSize() const {
@@ -1952,6 +2439,15 @@ size_t Tablet::OnDiskDataSize() const {
   return ret;
 }
 
+Status Tablet::FindSplitKey(string* split_key) const {
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+  if (!comps) {
+    return Status::NotFound("tablet has no rowsets");
+  }
+  return comps->rowsets->FindSplitKey(split_key);
+}
+
 size_t Tablet::DeltaMemStoresSize() const {
   scoped_refptr<TabletComponents> comps;
   GetComponents(&comps);
@@ -1995,7 +2491,7 @@ Status Tablet::FlushBestDMS(const ReplaySizeMap &replay_size_map) const {
   RETURN_IF_STOPPED_OR_CHECK_STATE(kOpen);
   shared_ptr<RowSet> rowset = FindBestDMSToFlush(replay_size_map);
   if (rowset) {
-    IOContext io_context({ tablet_id() });
+    const IOContext io_context = MakeIOContext(IOContext::SOURCE_FLUSH);
     return rowset->FlushDeltas(&io_context);
   }
   return Status::OK();
@@ -2064,7 +2560,7 @@ Status Tablet::FlushBiggestDMS() {
   return max_size > 0 ? biggest_drs->FlushDeltas(nullptr) : Status::OK();
 }
 
-Status Tablet::FlushAllDMSForTests() {
+Status Tablet::FlushAllDMS() {
   RETURN_IF_STOPPED_OR_CHECK_STATE(kOpen);
   scoped_refptr<TabletComponents> comps;
   GetComponents(&comps);
@@ -2079,7 +2575,7 @@ Status Tablet::MajorCompactAllDeltaStoresForTests() {
   RETURN_IF_STOPPED_OR_CHECK_STATE(kOpen);
   scoped_refptr<TabletComponents> comps;
   GetComponents(&comps);
-  IOContext io_context({ tablet_id() });
+  const IOContext io_context = MakeIOContext(IOContext::SOURCE_COMPACTION);
   for (const auto& rs : comps->rowsets->all_rowsets()) {
     if (!rs->IsAvailableForCompaction()) continue;
     DiskRowSet* drs = down_cast<DiskRowSet*>(rs.get());
@@ -2113,7 +2609,8 @@ Status Tablet::CompactWorstDeltas(RowSet::DeltaCompactionType type) {
   // We just released compact_select_lock_ so other compactions can select and run, but the
   // rowset is ours.
   DCHECK(perf_improv != 0);
-  IOContext io_context({ tablet_id() });
+  const IOContext io_context = MakeIOContext(IOContext::SOURCE_COMPACTION,
+                                             IOContext::CACHE_READ_ONCE);
   if (type == RowSet::MINOR_DELTA_COMPACTION) {
     RETURN_NOT_OK_PREPEND(rs->MinorCompactDeltaStores(&io_context),
                           "Failed minor delta compaction on " + rs->ToString());
@@ -2184,7 +2681,8 @@ Status Tablet::EstimateBytesInPotentiallyAncientUndoDeltas(int64_t* bytes) {
 Status Tablet::InitAncientUndoDeltas(MonoDelta time_budget, int64_t* bytes_in_ancient_undos) {
   MonoTime tablet_init_start = MonoTime::Now();
 
-  IOContext io_context({ tablet_id() });
+  const IOContext io_context = MakeIOContext(IOContext::SOURCE_OTHER,
+                                             IOContext::CACHE_READ_ONCE);
   Timestamp ancient_history_mark;
   if (!Tablet::GetTabletAncientHistoryMark(&ancient_history_mark)) {
     VLOG_WITH_PREFIX(1) << "Cannot get ancient history mark. "
@@ -2273,7 +2771,8 @@ Status Tablet::DeleteAncientUndoDeltas(int64_t* blocks_deleted, int64_t* bytes_d
 
   int64_t tablet_blocks_deleted = 0;
   int64_t tablet_bytes_deleted = 0;
-  fs::IOContext io_context({ tablet_id() });
+  const IOContext io_context = MakeIOContext(IOContext::SOURCE_OTHER,
+                                             IOContext::CACHE_READ_ONCE);
   for (const auto& rowset : rowsets_to_gc_undos) {
     int64_t rowset_blocks_deleted;
     int64_t rowset_bytes_deleted;
@@ -2298,6 +2797,14 @@ Status Tablet::DeleteAncientUndoDeltas(int64_t* blocks_deleted, int64_t* bytes_d
   return Status::OK();
 }
 
+void Tablet::GetDataDirs(vector<string>* dirs) const {
+  Status s = metadata_->fs_manager()->dd_manager()->FindDataDirsByTabletId(tablet_id(), dirs);
+  if (PREDICT_FALSE(!s.ok())) {
+    VLOG_WITH_PREFIX(1) << "Unable to find the data dirs of the tablet: " << s.ToString();
+    dirs->clear();
+  }
+}
+
 int64_t Tablet::CountUndoDeltasForTests() const {
   scoped_refptr<TabletComponents> comps;
   GetComponents(&comps);
@@ -2440,14 +2947,54 @@ string Tablet::LogPrefix() const {
   return Substitute("T $0 P $1: ", tablet_id(), metadata_->fs_manager()->uuid());
 }
 
+IOContext Tablet::MakeIOContext(IOContext::Source source,
+                                IOContext::CacheHint cache_hint) const {
+  return IOContext({ tablet_id(), cache_hint, source,
+                     metrics_ ? &metrics_->io : nullptr });
+}
+
 ////////////////////////////////////////////////////////////
 // Tablet::Iterator
 ////////////////////////////////////////////////////////////
 
+namespace {
+
+// Returns true if 'spec' selects nothing but the row with a given primary
+// key, setting 'key' to the encoded key. A scan spec optimized with
+// ScanSpec::OptimizeScan() does so if the exclusive upper bound is the
+// successor of the lower bound and no predicates are left.
+bool GetPointLookupKey(const Schema& schema, const ScanSpec& spec, string* key) {
+  const EncodedKey* lower = spec.lower_bound_key();
+  const EncodedKey* upper = spec.exclusive_upper_bound_key();
+  if (!spec.predicates().empty() || lower == nullptr || upper == nullptr ||
+      lower->raw_keys().size() != schema.num_key_columns()) {
+    return false;
+  }
+  Arena arena(256);
+  uint8_t* buf = static_cast<uint8_t*>(arena.AllocateBytes(schema.key_byte_size()));
+  if (PREDICT_FALSE(buf == nullptr)) {
+    return false;
+  }
+  ContiguousRow successor(&schema, buf);
+  for (int i = 0; i < schema.num_key_columns(); i++) {
+    memcpy(successor.mutable_cell_ptr(i), lower->raw_keys()[i],
+           schema.column(i).type_info()->size());
+  }
+  if (!key_util::IncrementPrimaryKey(&successor, &arena) ||
+      EncodedKey::FromContiguousRow(ConstContiguousRow(successor))->encoded_key() !=
+      upper->encoded_key()) {
+    return false;
+  }
+  *key = lower->encoded_key().ToString();
+  return true;
+}
+
+} // anonymous namespace
+
 Tablet::Iterator::Iterator(const Tablet* tablet,
                            RowIteratorOptions opts)
     : tablet_(tablet),
-      io_context_({ tablet->tablet_id() }),
+      io_context_(tablet->MakeIOContext(IOContext::SOURCE_SCAN)),
       projection_(*CHECK_NOTNULL(opts.projection)),
       opts_(std::move(opts)) {
   opts_.io_context = &io_context_;
@@ -2462,6 +3009,23 @@ Status Tablet::Iterator::Init(ScanSpec *spec) {
 
   RETURN_NOT_OK(tablet_->GetMappedReadProjection(projection_, &projection_));
 
+  // The scans starting at a key, e.g. the point lookups, count as reads of
+  // that key.
+  if (spec != nullptr && spec->lower_bound_key() != nullptr) {
+    tablet_->hot_spots_->RecordKey(HotSpotTracker::READ,
+                                   spec->lower_bound_key()->encoded_key());
+  }
+
+  string key;
+  if (tablet_->row_cache_ && spec != nullptr && !opts_.snap_to_exclude &&
+      !opts_.include_deleted_rows && GetPointLookupKey(*tablet_->schema(), *spec, &key)) {
+    bool initted;
+    RETURN_NOT_OK(InitFromRowCache(spec, key, &initted));
+    if (initted) {
+      return Status::OK();
+    }
+  }
+
   vector<unique_ptr<RowwiseIterator>> iters;
   RETURN_NOT_OK(tablet_->CaptureConsistentIterators(opts_, spec, &iters));
   TRACE_COUNTER_INCREMENT("rowset_iterators", iters.size());
@@ -2472,7 +3036,14 @@ Status Tablet::Iterator::Init(ScanSpec *spec) {
       break;
     case UNORDERED:
     default:
-      iter_ = NewUnionIterator(std::move(iters));
+      if (opts_.scan_pool && opts_.max_parallel_rowsets > 1 && iters.size() > 1) {
+        iter_ = NewParallelUnionIterator(
+            ParallelUnionIteratorOptions(opts_.scan_pool, opts_.max_parallel_rowsets,
+                                         opts_.max_buffered_blocks),
+            std::move(iters));
+      } else {
+        iter_ = NewUnionIterator(std::move(iters));
+      }
       break;
   }
 
@@ -2480,6 +3051,92 @@ Status Tablet::Iterator::Init(ScanSpec *spec) {
   return Status::OK();
 }
 
+Status Tablet::Iterator::InitFromRowCache(ScanSpec* spec, const string& key, bool* initted) {
+  *initted = false;
+  RowCache* row_cache = tablet_->row_cache_.get();
+
+  // The cached rows are in the layout of a particular schema version. If the
+  // schema is being altered, bypass the cache.
+  const uint32_t schema_version = tablet_->metadata()->schema_version();
+  full_schema_ = *tablet_->schema();
+  if (tablet_->metadata()->schema_version() != schema_version) {
+    return Status::OK();
+  }
+
+  RowCache::RowHandle handle;
+  if (row_cache->Lookup(key, schema_version, opts_.snap_to_include, &handle)) {
+    if (tablet_->metrics_) {
+      tablet_->metrics_->row_cache_hits->Increment();
+    }
+    unique_ptr<MaterializedRowIterator> iter(
+        new MaterializedRowIterator(&full_schema_, projection_));
+    iter->AddRow(handle.row_data());
+    iter->HoldHandle(std::move(handle));
+    RETURN_NOT_OK(iter->Init(spec));
+    iter_ = std::move(iter);
+    *initted = true;
+    return Status::OK();
+  }
+  if (tablet_->metrics_) {
+    tablet_->metrics_->row_cache_misses->Increment();
+  }
+
+  // Read the row with all its columns, so that it may be cached regardless of
+  // the projection.
+  const RowCache::ReadToken token = row_cache->BeginRead(key);
+  RowIteratorOptions opts = opts_;
+  opts.projection = &full_schema_;
+  vector<unique_ptr<RowwiseIterator>> iters;
+  RETURN_NOT_OK(tablet_->CaptureConsistentIterators(opts, spec, &iters));
+  TRACE_COUNTER_INCREMENT("rowset_iterators", iters.size());
+  unique_ptr<RowwiseIterator> rowset_iter = NewUnionIterator(std::move(iters));
+  RETURN_NOT_OK(rowset_iter->Init(spec));
+
+  unique_ptr<MaterializedRowIterator> iter(
+      new MaterializedRowIterator(&full_schema_, projection_));
+  const size_t row_size = ContiguousRowHelper::row_size(full_schema_);
+  Arena block_arena(1024);
+  RowBlock block(full_schema_, 100, &block_arena);
+  int num_rows = 0;
+  uint8_t* row_data = nullptr;
+  while (rowset_iter->HasNext()) {
+    RETURN_NOT_OK(rowset_iter->NextBlock(&block));
+    for (size_t i = 0; i < block.nrows(); i++) {
+      if (!block.selection_vector()->IsRowSelected(i)) {
+        continue;
+      }
+      row_data = static_cast<uint8_t*>(iter->arena()->AllocateBytes(row_size));
+      if (PREDICT_FALSE(row_data == nullptr)) {
+        return Status::RuntimeError("out of memory materializing row");
+      }
+      ContiguousRow row(&full_schema_, row_data);
+      RETURN_NOT_OK(CopyRow(block.row(i), &row, iter->arena()));
+      iter->AddRow(row_data);
+      num_rows++;
+    }
+  }
+  if (num_rows == 1) {
+    row_cache->Insert(key, token, opts_.snap_to_include, schema_version,
+                      ConstContiguousRow(&full_schema_, row_data));
+  }
+
+  // Report the stats of the projected columns only.
+  vector<IteratorStats> rowset_stats;
+  rowset_iter->GetIteratorStats(&rowset_stats);
+  vector<IteratorStats> projected_stats(projection_.num_columns());
+  for (int i = 0; i < projection_.num_columns(); i++) {
+    const int idx = full_schema_.find_column_by_id(projection_.column_id(i));
+    if (idx != Schema::kColumnNotFound) {
+      projected_stats[i] = rowset_stats[idx];
+    }
+  }
+  iter->SetIteratorStats(std::move(projected_stats));
+  RETURN_NOT_OK(iter->Init(spec));
+  iter_ = std::move(iter);
+  *initted = true;
+  return Status::OK();
+}
+
 bool Tablet::Iterator::HasNext() const {
   DCHECK(iter_.get() != nullptr) << "Not initialized!";
   return iter_->HasNext();
@@ -2487,7 +3144,9 @@ bool Tablet::Iterator::HasNext() const {
 
 Status Tablet::Iterator::NextBlock(RowBlock *dst) {
   DCHECK(iter_.get() != nullptr) << "Not initialized!";
-  return iter_->NextBlock(dst);
+  RETURN_NOT_OK(iter_->NextBlock(dst));
+  tablet_->hot_spots_->RecordRows(HotSpotTracker::READ, dst->nrows());
+  return Status::OK();
 }
 
 string Tablet::Iterator::ToString() const {
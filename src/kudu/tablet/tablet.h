@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <iosfwd>
@@ -48,8 +49,10 @@
 #include "kudu/util/bloom_filter.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/rw_semaphore.h"
 #include "kudu/util/semaphore.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
@@ -77,14 +80,19 @@ namespace tablet {
 class AlterSchemaTransactionState;
 class CompactionPolicy;
 class HistoryGcOpts;
+class HotSpotTracker;
 class MemRowSet;
 class RowSetTree;
+class RowCache;
+class RollingDiskRowSetWriter;
 class RowSetsInCompaction;
 class WriteTransactionState;
 struct RowOp;
 struct TabletComponents;
 struct TabletMetrics;
 
+typedef std::vector<std::shared_ptr<MemRowSet>> MemRowSetVector;
+
 class Tablet {
  public:
   typedef std::map<int64_t, int64_t> ReplaySizeMap;
@@ -142,6 +150,10 @@ class Tablet {
 
   // Acquire locks for each of the operations in the given txn.
   //
+  // The rows are all locked in one pass over the lock table, after checking
+  // that they belong to this tablet. This also sets the row ops'
+  // RowSetKeyProbes.
+  //
   // Note that, if this fails, it's still possible that the transaction
   // state holds _some_ of the locks. In that case, we expect that
   // the transaction will still clean them up when it is aborted (or
@@ -170,11 +182,6 @@ class Tablet {
   // Returns Status::AlreadyPresent() if an entry with the same key is already
   // present in the tablet.
   // Returns Status::OK unless allocation fails.
-  //
-  // Acquires the row lock for the given operation, setting it in the
-  // RowOp struct. This also sets the row op's RowSetKeyProbe.
-  Status AcquireLockForOp(WriteTransactionState* tx_state,
-                          RowOp* op);
 
   // Signal that the given transaction is about to Apply.
   void StartApplying(WriteTransactionState* tx_state);
@@ -256,6 +263,30 @@ class Tablet {
   // Update the statistics for performing a compaction.
   void UpdateCompactionStats(MaintenanceOpStats* stats);
 
+  // The heavy compactions, i.e. the rowset and major delta compactions, may be
+  // staggered across the replicas of the tablet by the master. The maintenance
+  // ops record whether they are worth running, and the heartbeater reports it.
+  void set_rowset_compaction_backlog(bool has_backlog) {
+    rowset_compaction_backlog_ = has_backlog;
+  }
+  void set_major_delta_compaction_backlog(bool has_backlog) {
+    major_delta_compaction_backlog_ = has_backlog;
+  }
+  bool HasHeavyCompactionBacklog() const {
+    return rowset_compaction_backlog_ || major_delta_compaction_backlog_;
+  }
+
+  // Return true if a heavy compaction of the tablet is running.
+  bool IsHeavyCompactionRunning() const;
+
+  // Don't start heavy compactions until 'deadline', because other replicas
+  // of the tablet are compacting. An uninitialized 'deadline' allows them
+  // again.
+  void DeferHeavyCompactionsUntil(const MonoTime& deadline);
+
+  // Return true if heavy compactions shouldn't be started.
+  bool HeavyCompactionsDeferred() const;
+
   // Returns the exact current size of the MRS, in bytes. A value greater than 0 doesn't imply
   // that the MRS has data, only that it has allocated that amount of memory.
   // This method takes a read lock on component_lock_ and is thread-safe.
@@ -278,6 +309,13 @@ class Tablet {
   // Excludes all metadata (both tablet metadata and the metadata of this tablet's rowsets).
   size_t OnDiskDataSize() const;
 
+  // Sets 'split_key' to an encoded primary key which splits the on-disk data
+  // of this tablet in two halves of about the same size. The rows of the
+  // MemRowSets aren't accounted for. See RowSetTree::FindSplitKey().
+  //
+  // Returns NotFound if the tablet has no on-disk data to split.
+  Status FindSplitKey(std::string* split_key) const;
+
   // Get the total size of all the DMS
   size_t DeltaMemStoresSize() const;
 
@@ -295,8 +333,8 @@ class Tablet {
   // Flush only the biggest DMS
   Status FlushBiggestDMS();
 
-  // Flush all delta memstores. Only used for tests.
-  Status FlushAllDMSForTests();
+  // Flush all delta memstores.
+  Status FlushAllDMS();
 
   // Run a major compaction on all delta stores. Initializes any un-initialized
   // redo delta stores. Only used for tests.
@@ -334,6 +372,10 @@ class Tablet {
   Status DeleteAncientUndoDeltas(int64_t* blocks_deleted = nullptr,
                                  int64_t* bytes_deleted = nullptr);
 
+  // Return in 'dirs' the directory names of the tablet's data dir group, or
+  // an empty list if they can't be found.
+  void GetDataDirs(std::vector<std::string>* dirs) const;
+
   // Count the number of deltas in the tablet. Only used for tests.
   int64_t CountUndoDeltasForTests() const;
   int64_t CountRedoDeltasForTests() const;
@@ -393,7 +435,15 @@ class Tablet {
   // Otherwise, returns false.
   bool GetTabletAncientHistoryMark(Timestamp* ancient_history_mark) const WARN_UNUSED_RESULT;
 
-  // Calculates history GC options based on properties of the Clock implementation.
+  // Calculates the value of the TTL column of 'schema' below which rows are
+  // expired as of now according to 'clock', and returns true iff 'schema' has
+  // a TTL column and 'clock' is a HybridClock. Otherwise, returns false.
+  static bool GetRowExpirationCutoff(const Schema& schema,
+                                     clock::Clock* clock,
+                                     int64_t* cutoff_micros) WARN_UNUSED_RESULT;
+
+  // Calculates history GC options based on properties of the Clock implementation
+  // and on the TTL column of the schema, if any.
   HistoryGcOpts GetHistoryGcOpts() const;
 
   // Method used by tests to retrieve all rowsets of this table. This
@@ -423,6 +473,9 @@ class Tablet {
   // May be NULL in unit tests, etc.
   TabletMetrics* metrics() { return metrics_.get(); }
 
+  // Return the tracker of the recent load of this tablet.
+  HotSpotTracker* hot_spots() const { return hot_spots_.get(); }
+
   // Return handle to the metric entity of this tablet.
   const scoped_refptr<MetricEntity>& GetMetricEntity() const {
     return metric_entity_;
@@ -458,6 +511,7 @@ class Tablet {
  private:
   friend class Iterator;
   friend class TabletReplicaTest;
+  friend class WritePathBench;
   FRIEND_TEST(TestTablet, TestGetReplaySizeForIndex);
   FRIEND_TEST(TestTabletStringKey, TestSplitKeyRange);
   FRIEND_TEST(TestTabletStringKey, TestSplitKeyRangeWithZeroRowSets);
@@ -524,6 +578,12 @@ class Tablet {
   // Validate the contents of 'op' and return a bad Status if it is invalid.
   Status ValidateOp(const RowOp& op) const;
 
+  // Returns the context of IO done on behalf of this tablet by an operation
+  // of kind 'source', accounted against the tablet's metrics if it has any.
+  fs::IOContext MakeIOContext(
+      fs::IOContext::Source source,
+      fs::IOContext::CacheHint cache_hint = fs::IOContext::CACHE_DEFAULT) const;
+
   // Validate 'op' as in 'ValidateOp()' above. If it is invalid, marks the op as failed
   // and returns false. If valid, marks the op as validated and returns true.
   bool ValidateOpOrMarkFailed(RowOp* op) const;
@@ -588,6 +648,31 @@ class Tablet {
   Status PickRowSetsToCompact(RowSetsInCompaction *picked,
                               CompactFlags flags) const;
 
+  // Return in 'split_keys' the encoded keys splitting the rowsets of 'input'
+  // into key ranges of similar sizes, which may be compacted in parallel. The
+  // keys are picked out of samples of the rowsets' keys. No keys are returned
+  // if the compaction shouldn't be split.
+  void PickCompactionSplitKeys(const RowSetsInCompaction& input,
+                               const fs::IOContext* io_context,
+                               std::vector<std::string>* split_keys) const;
+
+  // Phase 1 of a merge compaction or a flush: writes the rows of 'input' as
+  // of 'snap' to new rowsets. The writers of the rowsets are returned in
+  // 'writers', in key order. Compactions may be split into disjoint key
+  // ranges, each written in parallel by its own writer.
+  //
+  // Sets 'rows_gced' to the number of rows whose history was ancient, and
+  // 'helpers_cpu_time_us' to the CPU time spent by threads other than the
+  // calling one.
+  Status WriteCompactionOutput(const RowSetsInCompaction& input,
+                               int64_t mrs_being_flushed,
+                               const MvccSnapshot& snap,
+                               const HistoryGcOpts& history_gc_opts,
+                               const fs::IOContext* io_context,
+                               int64_t* rows_gced,
+                               int64_t* helpers_cpu_time_us,
+                               std::vector<std::unique_ptr<RollingDiskRowSetWriter>>* writers);
+
   // Performs a merge compaction or a flush.
   Status DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
                                   int64_t mrs_being_flushed);
@@ -622,17 +707,21 @@ class Tablet {
     *comps = components_;
   }
 
-  // Create a new MemRowSet, replacing the current one.
-  // The 'old_ms' pointer will be set to the current MemRowSet set before the replacement.
-  // If the MemRowSet is not empty it will be added to the 'compaction' input
-  // and the MemRowSet compaction lock will be taken to prevent the inclusion
-  // in any concurrent compactions.
-  Status ReplaceMemRowSetUnlocked(RowSetsInCompaction *compaction,
-                                  std::shared_ptr<MemRowSet> *old_ms);
+  // Creates the MemRowSets that inserts are striped across, with the given
+  // schema and with new ids.
+  Status CreateMemRowSetsUnlocked(const Schema& schema, MemRowSetVector* mrss);
+
+  // Create new MemRowSets, replacing the current ones.
+  // The 'old_mrss' vector will be set to the current MemRowSets before the replacement.
+  // They will be added to the 'compaction' input and their compaction locks
+  // will be taken to prevent the inclusion in any concurrent compactions.
+  Status ReplaceMemRowSetsUnlocked(RowSetsInCompaction *compaction,
+                                   MemRowSetVector* old_mrss);
 
-  // TODO: Document me.
+  // Flushes the MemRowSets 'old_mrss', swapped out by
+  // ReplaceMemRowSetsUnlocked() into 'input', to disk, all together.
   Status FlushInternal(const RowSetsInCompaction& input,
-                       const std::shared_ptr<MemRowSet>& old_ms);
+                       const MemRowSetVector& old_mrss);
 
   // Convert the specified read client schema (without IDs) to a server schema (with IDs)
   // This method is used by NewRowIterator().
@@ -641,6 +730,10 @@ class Tablet {
 
   Status CheckRowInTablet(const ConstContiguousRow& row) const;
 
+  // Returns the error of CheckRowInTablet() for the first of 'rows' which
+  // isn't in the tablet, if any. The rows are checked as a batch.
+  Status CheckRowsInTablet(const std::vector<ConstContiguousRow>& rows) const;
+
   // Helper method to find the rowset that has the DMS with the highest retention.
   std::shared_ptr<RowSet> FindBestDMSToFlush(const ReplaySizeMap& replay_size_map) const;
 
@@ -703,6 +796,14 @@ class Tablet {
 
   std::unique_ptr<Throttler> throttler_;
 
+  // Caches rows for point lookups, if enabled. Immutable after construction.
+  std::unique_ptr<RowCache> row_cache_;
+
+  const std::unique_ptr<HotSpotTracker> hot_spots_;
+
+  // The number of MemRowSets that inserts are striped across.
+  const int num_memrowsets_;
+
   int64_t next_mrs_id_;
 
   // A pointer to the server's clock.
@@ -730,6 +831,13 @@ class Tablet {
 
   State state_;
 
+  // Whether the heavy compactions are worth running, and the time until
+  // which they are deferred, protected by 'compaction_deferral_lock_'.
+  std::atomic<bool> rowset_compaction_backlog_;
+  std::atomic<bool> major_delta_compaction_backlog_;
+  mutable simple_spinlock compaction_deferral_lock_;
+  MonoTime heavy_compactions_deferred_until_;
+
   // Fake lock used to ensure calls to RegisterMaintenanceOps and
   // UnregisterMaintenanceOps don't overlap. This serves to ensure that only
   // one thread is updating the maintenance op list at a time.
@@ -805,10 +913,19 @@ class Tablet::Iterator : public RowwiseIterator {
   Iterator(const Tablet* tablet,
            RowIteratorOptions opts);
 
+  // Initializes the iterator to return the row with the encoded primary key
+  // 'key' through the tablet's row cache, reading and caching the row if it
+  // isn't cached yet. Sets 'initted' to false if the row cache can't be used.
+  Status InitFromRowCache(ScanSpec* spec, const std::string& key, bool* initted);
+
   const Tablet* tablet_;
   fs::IOContext io_context_;
   Schema projection_;
   RowIteratorOptions opts_;
+
+  // The schema of the tablet, for the rows read through the row cache.
+  Schema full_schema_;
+
   std::unique_ptr<RowwiseIterator> iter_;
 };
 
@@ -816,9 +933,16 @@ class Tablet::Iterator : public RowwiseIterator {
 // This structure is immutable -- a transaction can grab it and be sure
 // that it won't change.
 struct TabletComponents : public RefCountedThreadSafe<TabletComponents> {
-  TabletComponents(std::shared_ptr<MemRowSet> mrs,
+  TabletComponents(MemRowSetVector mrss,
                    std::shared_ptr<RowSetTree> rs_tree);
-  const std::shared_ptr<MemRowSet> memrowset;
+
+  // Returns the MemRowSet which the row with the encoded key 'encoded_key'
+  // is inserted into, if it's not in any other rowset.
+  MemRowSet* memrowset_for_key(const Slice& encoded_key) const;
+
+  // The MemRowSets, across which inserts are striped by hash of their key.
+  // They all have the same schema and are flushed together.
+  const MemRowSetVector memrowsets;
   const std::shared_ptr<RowSetTree> rowsets;
 };
 
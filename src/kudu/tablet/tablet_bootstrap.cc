@@ -17,6 +17,7 @@
 
 #include "kudu/tablet/tablet_bootstrap.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <iterator>
 #include <map>
@@ -79,6 +80,7 @@
 #include "kudu/tablet/transactions/write_transaction.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/tserver/tserver_admin.pb.h"
+#include "kudu/util/blocking_queue.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
@@ -91,6 +93,7 @@
 #include "kudu/util/pb_util.h"
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/stopwatch.h"
+#include "kudu/util/thread.h"
 
 DECLARE_int32(group_commit_queue_size_bytes);
 
@@ -100,6 +103,12 @@ DEFINE_double(fault_crash_during_log_replay, 0.0,
               "(For testing only!)");
 TAG_FLAG(fault_crash_during_log_replay, unsafe);
 
+DEFINE_int64(tablet_bootstrap_log_read_ahead_bytes, 64 * 1024 * 1024,
+             "The maximum number of bytes of log entries which are read, decompressed "
+             "and decoded by a separate thread ahead of their replay during tablet "
+             "bootstrap.");
+TAG_FLAG(tablet_bootstrap_log_read_ahead_bytes, advanced);
+
 DECLARE_int32(max_clock_sync_error_usec);
 
 using kudu::clock::Clock;
@@ -1150,6 +1159,92 @@ void TabletBootstrap::DumpReplayStateToLog(const ReplayState& state) {
   }
 }
 
+// Reads the entries of a sequence of log segments on a separate thread, ahead
+// of their replay, so that reading, decompressing and decoding the entries
+// is overlapped with replaying them.
+class LogReadAhead {
+ public:
+  // An entry read from a segment, or the status which ended the reading of
+  // a segment: EndOfFile once all its entries were read, or an error, after
+  // which no more segments are read.
+  struct Entry {
+    unique_ptr<LogEntryPB> entry;
+    Status status;
+
+    // The offsets of the segment reader after reading the entry.
+    int64_t offset;
+    int64_t read_up_to_offset;
+
+    // The number of bytes read from the segment for the entry.
+    size_t size;
+  };
+
+  LogReadAhead(log::SegmentSequence segments, int64_t max_bytes)
+      : segments_(std::move(segments)),
+        queue_(std::max<int64_t>(1, max_bytes)) {
+  }
+
+  ~LogReadAhead() {
+    queue_.Shutdown();
+    if (thread_) {
+      CHECK_OK(ThreadJoiner(thread_.get()).Join());
+    }
+    Entry* e;
+    while (queue_.BlockingGet(&e)) {
+      delete e;
+    }
+  }
+
+  Status Start() {
+    return Thread::Create("tablet", "bootstrap-log-read-ahead",
+                          &LogReadAhead::Run, this, &thread_);
+  }
+
+  // Returns the next entry, in order.
+  gscoped_ptr<Entry> Next() {
+    gscoped_ptr<Entry> e;
+    CHECK(queue_.BlockingGet(&e));
+    return e.Pass();
+  }
+
+ private:
+  struct EntrySize {
+    static size_t logical_size(const Entry* e) {
+      return e->size;
+    }
+  };
+
+  void Run() {
+    for (const scoped_refptr<ReadableLogSegment>& segment : segments_) {
+      log::LogEntryReader reader(segment.get());
+      while (true) {
+        const int64_t start_offset = reader.offset();
+        gscoped_ptr<Entry> e(new Entry);
+        e->status = reader.ReadNextEntry(&e->entry);
+        e->offset = reader.offset();
+        e->read_up_to_offset = reader.read_up_to_offset();
+        // The entries of a batch are read at once: count the bytes of the
+        // batch for its first entry, and at least one for each entry.
+        e->size = std::max<int64_t>(1, e->offset - start_offset);
+        const bool end_of_segment = !e->status.ok();
+        const bool read_error = end_of_segment && !e->status.IsEndOfFile();
+        if (!queue_.BlockingPut(&e) || read_error) {
+          return;
+        }
+        if (end_of_segment) {
+          break;
+        }
+      }
+    }
+  }
+
+  const log::SegmentSequence segments_;
+  BlockingQueue<Entry*, EntrySize> queue_;
+  scoped_refptr<Thread> thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(LogReadAhead);
+};
+
 Status TabletBootstrap::PlaySegments(const IOContext* io_context,
                                      ConsensusBootstrapInfo* consensus_info) {
   ReplayState state;
@@ -1179,14 +1274,20 @@ Status TabletBootstrap::PlaySegments(const IOContext* io_context,
   const auto kStatusUpdateInterval = MonoDelta::FromSeconds(5);
   int segment_count = 0;
 
-  for (const scoped_refptr<ReadableLogSegment>& segment : segments) {
-    log::LogEntryReader reader(segment.get());
+  LogReadAhead read_ahead(segments, FLAGS_tablet_bootstrap_log_read_ahead_bytes);
+  RETURN_NOT_OK_PREPEND(read_ahead.Start(), "Failed to start reading the log");
 
+  for (const scoped_refptr<ReadableLogSegment>& segment : segments) {
     int entry_count = 0;
+    int64_t offset = 0;
+    int64_t read_up_to_offset = 0;
     while (true) {
       {
-        unique_ptr<LogEntryPB> entry;
-        Status s = reader.ReadNextEntry(&entry);
+        gscoped_ptr<LogReadAhead::Entry> read_entry = read_ahead.Next();
+        unique_ptr<LogEntryPB> entry = std::move(read_entry->entry);
+        offset = read_entry->offset;
+        read_up_to_offset = read_entry->read_up_to_offset;
+        Status s = read_entry->status;
         if (PREDICT_FALSE(!s.ok())) {
           if (s.IsEndOfFile()) {
             break;
@@ -1218,8 +1319,8 @@ Status TabletBootstrap::PlaySegments(const IOContext* io_context,
         SetStatusMessage(Substitute("Bootstrap replaying log segment $0/$1 "
                                     "($2/$3 this segment, stats: $4)",
                                     segment_count + 1, log_reader_->num_segments(),
-                                    HumanReadableNumBytes::ToString(reader.offset()),
-                                    HumanReadableNumBytes::ToString(reader.read_up_to_offset()),
+                                    HumanReadableNumBytes::ToString(offset),
+                                    HumanReadableNumBytes::ToString(read_up_to_offset),
                                     stats_.ToString()));
         last_status_update = now;
       }
@@ -63,6 +63,7 @@ DECLARE_int32(tablet_history_max_age_sec);
 DECLARE_string(time_source);
 
 using kudu::clock::HybridClock;
+using std::shared_ptr;
 using std::string;
 using std::vector;
 using strings::Substitute;
@@ -134,7 +135,7 @@ void TabletHistoryGcTest::UpdateOriginalRows(int64_t num_rowsets, int64_t rows_p
                                              int32_t val) {
   for (int rowset_id = 0; rowset_id < num_rowsets; rowset_id++) {
     UpsertTestRows(rowset_id * rows_per_rowset, rows_per_rowset, val);
-    ASSERT_OK(tablet()->FlushAllDMSForTests());
+    ASSERT_OK(tablet()->FlushAllDMS());
   }
   ASSERT_EQ(num_rowsets, tablet()->num_rowsets());
 }
@@ -598,13 +599,13 @@ TEST_F(TabletHistoryGcNoMaintMgrTest, TestUndoDeltaBlockGc) {
   const int expected_undo_blocks = (kNumMutationsPerRow + 1) * num_rowsets_;
   ASSERT_EQ(expected_undo_blocks, tablet()->CountUndoDeltasForTests());
 
-  // There will be uninitialized undos so we will estimate that there may be
-  // undos to GC.
+  // The undos aren't initialized, but their max timestamps are recorded in
+  // the rowset metadata, so the estimate is exact: there are no undos to GC.
   int64_t bytes;
   ASSERT_OK(tablet()->EstimateBytesInPotentiallyAncientUndoDeltas(&bytes));
-  ASSERT_GT(bytes, 0);
+  ASSERT_EQ(0, bytes);
 
-  // Now initialize the undos. Our estimates should be back to 0.
+  // Initializing the undos doesn't change that.
   int64_t bytes_in_ancient_undos = 0;
   const MonoDelta kNoTimeLimit = MonoDelta();
   ASSERT_OK(tablet()->InitAncientUndoDeltas(kNoTimeLimit, &bytes_in_ancient_undos));
@@ -615,6 +616,20 @@ TEST_F(TabletHistoryGcNoMaintMgrTest, TestUndoDeltaBlockGc) {
   // Move the clock so all deltas should be ancient.
   NO_FATALS(AddTimeToHybridClock(MonoDelta::FromSeconds(FLAGS_tablet_history_max_age_sec + 1)));
 
+  // None of the undos needs to be read to find that they're ancient.
+  Timestamp ancient_history_mark;
+  ASSERT_TRUE(tablet()->GetTabletAncientHistoryMark(&ancient_history_mark));
+  vector<shared_ptr<RowSet>> rowsets;
+  tablet()->GetRowSetsForTests(&rowsets);
+  for (const auto& rowset : rowsets) {
+    int64_t blocks_initialized;
+    int64_t rowset_bytes_in_ancient_undos;
+    ASSERT_OK(rowset->InitUndoDeltas(ancient_history_mark, MonoTime(), nullptr,
+                                     &blocks_initialized, &rowset_bytes_in_ancient_undos));
+    ASSERT_EQ(0, blocks_initialized);
+    ASSERT_GT(rowset_bytes_in_ancient_undos, 0);
+  }
+
   // Initialize and delete undos.
   ASSERT_OK(tablet()->InitAncientUndoDeltas(kNoTimeLimit, &bytes_in_ancient_undos));
   ASSERT_GT(bytes_in_ancient_undos, 0);
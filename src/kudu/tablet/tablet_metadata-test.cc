@@ -20,6 +20,7 @@
 #include <ostream>
 #include <string>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
@@ -33,10 +34,17 @@
 #include "kudu/tablet/tablet-test-util.h"
 #include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet_metadata.h"
+#include "kudu/util/env.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 
+DECLARE_bool(tablet_metadata_append_updates);
+DECLARE_double(tablet_metadata_checkpoint_ratio);
+
+using std::string;
+using std::unique_ptr;
+
 namespace kudu {
 namespace tablet {
 
@@ -55,6 +63,13 @@ class TestTabletMetadata : public KuduTabletTest {
   void BuildPartialRow(int key, int intval, const char* strval,
                        gscoped_ptr<KuduPartialRow>* row);
 
+  // Inserts a row with key 'key' and flushes it to a new rowset.
+  void InsertAndFlush(int key);
+
+  // Asserts that the superblock on disk and that of a newly loaded copy of
+  // the metadata are the superblock in memory.
+  void AssertSuperBlockPersisted();
+
  protected:
   gscoped_ptr<LocalTabletWriter> writer_;
 };
@@ -67,6 +82,30 @@ void TestTabletMetadata::BuildPartialRow(int key, int intval, const char* strval
   CHECK_OK((*row)->SetStringCopy(2, strval));
 }
 
+void TestTabletMetadata::InsertAndFlush(int key) {
+  gscoped_ptr<KuduPartialRow> row;
+  BuildPartialRow(key, key, "foo", &row);
+  ASSERT_OK(writer_->Insert(*row));
+  ASSERT_OK(harness_->tablet()->Flush());
+}
+
+void TestTabletMetadata::AssertSuperBlockPersisted() {
+  TabletMetadata* meta = harness_->tablet()->metadata();
+  TabletSuperBlockPB expected;
+  ASSERT_OK(meta->ToSuperBlock(&expected));
+  TabletSuperBlockPB on_disk;
+  ASSERT_OK(meta->ReadSuperBlockFromDisk(&on_disk));
+  ASSERT_EQ(expected.SerializeAsString(), on_disk.SerializeAsString())
+      << pb_util::SecureDebugString(expected)
+      << pb_util::SecureDebugString(on_disk);
+
+  scoped_refptr<TabletMetadata> loaded;
+  ASSERT_OK(TabletMetadata::Load(fs_manager(), meta->tablet_id(), &loaded));
+  TabletSuperBlockPB reloaded;
+  ASSERT_OK(loaded->ToSuperBlock(&reloaded));
+  ASSERT_EQ(expected.SerializeAsString(), reloaded.SerializeAsString());
+}
+
 // Test that loading & storing the superblock results in an equivalent file.
 TEST_F(TestTabletMetadata, TestLoadFromSuperBlock) {
   // Write some data to the tablet and flush.
@@ -142,6 +181,80 @@ TEST_F(TestTabletMetadata, TestOnDiskSize) {
   ASSERT_GE(final_size, superblock_pb.ByteSize());
 }
 
+// Test that flushes may append the changes of the superblock to the tablet
+// metadata file, which is rewritten once the updates are large enough.
+TEST_F(TestTabletMetadata, TestAppendSuperBlockUpdates) {
+  FLAGS_tablet_metadata_append_updates = true;
+  FLAGS_tablet_metadata_checkpoint_ratio = 100;
+  TabletMetadata* meta = harness_->tablet()->metadata();
+
+  // The first flush rewrites the superblock, and the next ones append to it.
+  for (int i = 0; i < 3; i++) {
+    NO_FATALS(InsertAndFlush(i));
+    NO_FATALS(AssertSuperBlockPersisted());
+  }
+  ASSERT_EQ(3, meta->rowsets().size());
+
+  // An update without rowset changes is smaller than the whole superblock.
+  TabletSuperBlockPB superblock;
+  ASSERT_OK(meta->ToSuperBlock(&superblock));
+  int64_t size_before = meta->on_disk_size();
+  ASSERT_OK(meta->Flush());
+  ASSERT_LT(meta->on_disk_size() - size_before, superblock.ByteSize());
+  NO_FATALS(AssertSuperBlockPersisted());
+
+  // Compactions remove rowsets.
+  ASSERT_OK(harness_->tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  ASSERT_EQ(1, meta->rowsets().size());
+  NO_FATALS(AssertSuperBlockPersisted());
+
+  // Once the updates are larger than the superblock, the next flush
+  // rewrites it.
+  FLAGS_tablet_metadata_checkpoint_ratio = 0;
+  size_before = meta->on_disk_size();
+  ASSERT_OK(meta->Flush());
+  ASSERT_LT(meta->on_disk_size(), size_before);
+  NO_FATALS(AssertSuperBlockPersisted());
+}
+
+// Test that a partial update at the end of the tablet metadata file, left by
+// a failed flush, is ignored and that the next flush rewrites the file.
+TEST_F(TestTabletMetadata, TestPartialSuperBlockUpdate) {
+  FLAGS_tablet_metadata_append_updates = true;
+  FLAGS_tablet_metadata_checkpoint_ratio = 100;
+  TabletMetadata* meta = harness_->tablet()->metadata();
+  NO_FATALS(InsertAndFlush(0));
+  TabletSuperBlockPB expected;
+  ASSERT_OK(meta->ToSuperBlock(&expected));
+  NO_FATALS(InsertAndFlush(1));
+
+  // Truncate the last update.
+  Env* env = fs_manager()->env();
+  const string path = fs_manager()->GetTabletMetadataPath(meta->tablet_id());
+  uint64_t size;
+  ASSERT_OK(env->GetFileSize(path, &size));
+  {
+    RWFileOptions opts;
+    opts.mode = Env::OPEN_EXISTING;
+    unique_ptr<RWFile> file;
+    ASSERT_OK(env->NewRWFile(opts, path, &file));
+    ASSERT_OK(file->Truncate(size - 3));
+    ASSERT_OK(file->Close());
+  }
+  TabletSuperBlockPB on_disk;
+  ASSERT_OK(meta->ReadSuperBlockFromDisk(&on_disk));
+  ASSERT_EQ(expected.SerializeAsString(), on_disk.SerializeAsString());
+
+  // The metadata loaded from the file doesn't append after the partial update.
+  scoped_refptr<TabletMetadata> loaded;
+  ASSERT_OK(TabletMetadata::Load(fs_manager(), meta->tablet_id(), &loaded));
+  ASSERT_OK(loaded->Flush());
+  ASSERT_OK(loaded->Flush());
+  TabletSuperBlockPB reloaded;
+  ASSERT_OK(loaded->ReadSuperBlockFromDisk(&reloaded));
+  ASSERT_EQ(expected.SerializeAsString(), reloaded.SerializeAsString());
+}
+
 
 } // namespace tablet
 } // namespace kudu
@@ -22,9 +22,13 @@
 #include <ostream>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 #include <boost/optional/optional.hpp>
 #include <gflags/gflags.h>
+#include <google/protobuf/repeated_field.h>
 
 #include "kudu/common/schema.h"
 #include "kudu/common/wire_protocol.h"
@@ -58,17 +62,34 @@ TAG_FLAG(enable_tablet_orphaned_block_deletion, advanced);
 TAG_FLAG(enable_tablet_orphaned_block_deletion, hidden);
 TAG_FLAG(enable_tablet_orphaned_block_deletion, runtime);
 
+DEFINE_bool(tablet_metadata_append_updates, false,
+            "Whether flushes of tablet metadata append the changes of the superblock "
+            "to the tablet metadata file instead of rewriting the whole superblock. "
+            "Tablet metadata files with appended updates can't be read by versions "
+            "of Kudu which don't support them.");
+TAG_FLAG(tablet_metadata_append_updates, experimental);
+
+DEFINE_double(tablet_metadata_checkpoint_ratio, 1.0,
+              "When --tablet_metadata_append_updates is set, the ratio of the size of "
+              "the updates appended to a tablet metadata file to the size of its full "
+              "superblock above which the next flush rewrites the whole superblock.");
+TAG_FLAG(tablet_metadata_checkpoint_ratio, experimental);
+
 using base::subtle::Barrier_AtomicIncrement;
 using kudu::consensus::MinimumOpId;
 using kudu::consensus::OpId;
 using kudu::fs::BlockManager;
 using kudu::fs::BlockDeletionTransaction;
+using kudu::pb_util::ReadablePBContainerFile;
 using kudu::pb_util::SecureDebugString;
 using kudu::pb_util::SecureShortDebugString;
+using kudu::pb_util::WritablePBContainerFile;
 using std::memory_order_relaxed;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
+using std::unordered_map;
+using std::unordered_set;
 using std::vector;
 using strings::Substitute;
 
@@ -77,6 +98,46 @@ namespace tablet {
 
 const int64_t kNoDurableMemStore = -1;
 
+namespace {
+
+// Applies the superblock update 'update' to 'superblock': its fields replace
+// those of 'superblock', except that the rowsets which it doesn't remove or
+// change are kept, in order. New rowsets are added at the end.
+void ApplySuperBlockUpdate(const TabletSuperBlockPB& update, TabletSuperBlockPB* superblock) {
+  google::protobuf::RepeatedPtrField<RowSetDataPB> rowsets;
+  rowsets.Swap(superblock->mutable_rowsets());
+  *superblock = update;
+  superblock->clear_rowsets();
+  superblock->clear_incremental();
+  superblock->clear_removed_rowset_ids();
+
+  const unordered_set<int64_t> removed(update.removed_rowset_ids().begin(),
+                                       update.removed_rowset_ids().end());
+  unordered_map<int64_t, const RowSetDataPB*> changed;
+  for (const auto& rowset : update.rowsets()) {
+    changed.emplace(rowset.id(), &rowset);
+  }
+  for (auto& rowset : rowsets) {
+    if (ContainsKey(removed, rowset.id())) {
+      continue;
+    }
+    const RowSetDataPB* changed_rowset = FindPtrOrNull(changed, rowset.id());
+    if (changed_rowset) {
+      *superblock->add_rowsets() = *changed_rowset;
+      changed.erase(rowset.id());
+    } else {
+      superblock->add_rowsets()->Swap(&rowset);
+    }
+  }
+  for (const auto& rowset : update.rowsets()) {
+    if (ContainsKey(changed, rowset.id())) {
+      *superblock->add_rowsets() = rowset;
+    }
+  }
+}
+
+} // anonymous namespace
+
 // ============================================================================
 //  Tablet Metadata
 // ============================================================================
@@ -172,6 +233,12 @@ vector<BlockIdPB> TabletMetadata::CollectBlockIdPBs(const TabletSuperBlockPB& su
     if (rowset.has_adhoc_index_block()) {
       block_ids.push_back(rowset.adhoc_index_block());
     }
+    for (const SecondaryIndexDataPB& index : rowset.secondary_indexes()) {
+      block_ids.push_back(index.block());
+    }
+    if (rowset.has_rollup()) {
+      block_ids.push_back(rowset.rollup().block());
+    }
   }
   return block_ids;
 }
@@ -283,7 +350,10 @@ TabletMetadata::TabletMetadata(FsManager* fs_manager, string tablet_id,
       num_flush_pins_(0),
       needs_flush_(false),
       flush_count_for_tests_(0),
-      pre_flush_callback_(Bind(DoNothingStatusClosure)) {
+      pre_flush_callback_(Bind(DoNothingStatusClosure)),
+      can_append_updates_(false),
+      checkpoint_size_(0),
+      appended_size_(0) {
   CHECK(schema_->has_column_ids());
   CHECK_GT(schema_->num_key_columns(), 0);
 }
@@ -302,7 +372,10 @@ TabletMetadata::TabletMetadata(FsManager* fs_manager, string tablet_id)
       num_flush_pins_(0),
       needs_flush_(false),
       flush_count_for_tests_(0),
-      pre_flush_callback_(Bind(DoNothingStatusClosure)) {}
+      pre_flush_callback_(Bind(DoNothingStatusClosure)),
+      can_append_updates_(false),
+      checkpoint_size_(0),
+      appended_size_(0) {}
 
 Status TabletMetadata::LoadFromDisk() {
   TRACE_EVENT1("tablet", "TabletMetadata::LoadFromDisk",
@@ -311,10 +384,16 @@ Status TabletMetadata::LoadFromDisk() {
   CHECK_EQ(state_, kNotLoadedYet);
 
   TabletSuperBlockPB superblock;
-  RETURN_NOT_OK(ReadSuperBlockFromDisk(&superblock));
+  uint64_t checkpoint_size;
+  bool clean;
+  RETURN_NOT_OK(ReadSuperBlockFromDisk(&superblock, &checkpoint_size, &clean));
   RETURN_NOT_OK_PREPEND(LoadFromSuperBlock(superblock),
                         "Failed to load data from superblock protobuf");
   RETURN_NOT_OK(UpdateOnDiskSize());
+  {
+    MutexLock l_flush(flush_lock_);
+    ResetSuperBlockUpdatesUnlocked(superblock, checkpoint_size, clean);
+  }
   state_ = kInitialized;
   return Status::OK();
 }
@@ -544,7 +623,7 @@ Status TabletMetadata::Flush() {
     orphaned.assign(orphaned_blocks_.begin(), orphaned_blocks_.end());
   }
   pre_flush_callback_.Run();
-  RETURN_NOT_OK(ReplaceSuperBlockUnlocked(pb));
+  RETURN_NOT_OK(FlushSuperBlockUnlocked(pb));
   TRACE("Metadata flushed");
   l_flush.Unlock();
 
@@ -611,10 +690,84 @@ Status TabletMetadata::ReplaceSuperBlockUnlocked(const TabletSuperBlockPB &pb) {
                         Substitute("Failed to write tablet metadata $0", tablet_id_));
   flush_count_for_tests_++;
   RETURN_NOT_OK(UpdateOnDiskSize());
+  ResetSuperBlockUpdatesUnlocked(pb, on_disk_size(), true);
 
   return Status::OK();
 }
 
+Status TabletMetadata::FlushSuperBlockUnlocked(const TabletSuperBlockPB& pb) {
+  flush_lock_.AssertAcquired();
+  if (can_append_updates_ && FLAGS_tablet_metadata_append_updates &&
+      appended_size_ <= checkpoint_size_ * FLAGS_tablet_metadata_checkpoint_ratio) {
+    return AppendSuperBlockUpdateUnlocked(pb);
+  }
+  return ReplaceSuperBlockUnlocked(pb);
+}
+
+Status TabletMetadata::AppendSuperBlockUpdateUnlocked(const TabletSuperBlockPB& pb) {
+  flush_lock_.AssertAcquired();
+  DCHECK(can_append_updates_);
+
+  TabletSuperBlockPB update(pb);
+  update.clear_rowsets();
+  update.set_incremental(true);
+  unordered_map<int64_t, string> rowsets;
+  for (const auto& rowset : pb.rowsets()) {
+    string data = rowset.SerializeAsString();
+    const string* flushed = FindOrNull(flushed_rowsets_, rowset.id());
+    if (!flushed || *flushed != data) {
+      *update.add_rowsets() = rowset;
+    }
+    rowsets.emplace(rowset.id(), std::move(data));
+  }
+  for (const auto& e : flushed_rowsets_) {
+    if (!ContainsKey(rowsets, e.first)) {
+      update.add_removed_rowset_ids(e.first);
+    }
+  }
+
+  // A failed append may leave a partial update at the end of the file, after
+  // which no update may be appended: the next flush rewrites the file.
+  can_append_updates_ = false;
+  string path = fs_manager_->GetTabletMetadataPath(tablet_id_);
+  RWFileOptions opts;
+  opts.mode = Env::OPEN_EXISTING;
+  unique_ptr<RWFile> file;
+  RETURN_NOT_OK_PREPEND(fs_manager_->env()->NewRWFile(opts, path, &file),
+                        Substitute("Failed to open tablet metadata $0", tablet_id_));
+  WritablePBContainerFile pb_file(std::move(file));
+  RETURN_NOT_OK_PREPEND(pb_file.OpenExisting(),
+                        Substitute("Failed to open tablet metadata $0", tablet_id_));
+  RETURN_NOT_OK_PREPEND(pb_file.Append(update),
+                        Substitute("Failed to write tablet metadata $0", tablet_id_));
+  RETURN_NOT_OK_PREPEND(pb_file.Sync(),
+                        Substitute("Failed to write tablet metadata $0", tablet_id_));
+  RETURN_NOT_OK_PREPEND(pb_file.Close(),
+                        Substitute("Failed to write tablet metadata $0", tablet_id_));
+  flush_count_for_tests_++;
+  RETURN_NOT_OK(UpdateOnDiskSize());
+
+  flushed_rowsets_.swap(rowsets);
+  appended_size_ = on_disk_size() - checkpoint_size_;
+  can_append_updates_ = true;
+  return Status::OK();
+}
+
+void TabletMetadata::ResetSuperBlockUpdatesUnlocked(const TabletSuperBlockPB& pb,
+                                                    uint64_t checkpoint_size,
+                                                    bool clean) {
+  flush_lock_.AssertAcquired();
+  flushed_rowsets_.clear();
+  checkpoint_size_ = checkpoint_size;
+  appended_size_ = on_disk_size() - checkpoint_size;
+  can_append_updates_ = clean && FLAGS_tablet_metadata_append_updates;
+  if (can_append_updates_) {
+    for (const auto& rowset : pb.rowsets()) {
+      flushed_rowsets_.emplace(rowset.id(), rowset.SerializeAsString());
+    }
+  }
+}
+
 void TabletMetadata::SetPreFlushCallback(StatusClosure callback) {
   MutexLock l_flush(flush_lock_);
   pre_flush_callback_ = std::move(callback);
@@ -626,11 +779,47 @@ boost::optional<consensus::OpId> TabletMetadata::tombstone_last_logged_opid() co
 }
 
 Status TabletMetadata::ReadSuperBlockFromDisk(TabletSuperBlockPB* superblock) const {
+  uint64_t checkpoint_size;
+  bool clean;
+  return ReadSuperBlockFromDisk(superblock, &checkpoint_size, &clean);
+}
+
+Status TabletMetadata::ReadSuperBlockFromDisk(TabletSuperBlockPB* superblock,
+                                              uint64_t* checkpoint_size,
+                                              bool* clean) const {
   string path = fs_manager_->GetTabletMetadataPath(tablet_id_);
-  RETURN_NOT_OK_PREPEND(
-      pb_util::ReadPBContainerFromPath(fs_manager_->env(), path, superblock),
-      Substitute("Could not load tablet metadata from $0", path));
-  return Status::OK();
+  const string error_prefix = Substitute("Could not load tablet metadata from $0", path);
+  unique_ptr<RandomAccessFile> file;
+  RETURN_NOT_OK_PREPEND(fs_manager_->env()->NewRandomAccessFile(path, &file), error_prefix);
+  ReadablePBContainerFile pb_file(std::move(file));
+  RETURN_NOT_OK_PREPEND(pb_file.Open(), error_prefix);
+  RETURN_NOT_OK_PREPEND(pb_file.ReadNextPB(superblock), error_prefix);
+  if (superblock->incremental()) {
+    return Status::Corruption(error_prefix, "the file doesn't start with a full superblock");
+  }
+  *checkpoint_size = pb_file.offset();
+  *clean = true;
+
+  TabletSuperBlockPB update;
+  while (true) {
+    Status s = pb_file.ReadNextPB(&update);
+    if (s.IsEndOfFile()) {
+      break;
+    }
+    if (s.IsIncomplete()) {
+      // The flush which appended this update failed: it wasn't persisted.
+      LOG_WITH_PREFIX(WARNING) << "Ignoring a partial update at offset " << pb_file.offset()
+                               << " of tablet metadata " << path << ": " << s.ToString();
+      *clean = false;
+      break;
+    }
+    RETURN_NOT_OK_PREPEND(s, error_prefix);
+    if (!update.incremental()) {
+      return Status::Corruption(error_prefix, "unexpected full superblock");
+    }
+    ApplySuperBlockUpdate(update, superblock);
+  }
+  return pb_file.Close();
 }
 
 Status TabletMetadata::ToSuperBlock(TabletSuperBlockPB* super_block) const {
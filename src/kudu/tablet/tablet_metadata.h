@@ -20,6 +20,7 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -233,7 +234,8 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
   // Return the last-logged opid of a tombstoned tablet, if known.
   boost::optional<consensus::OpId> tombstone_last_logged_opid() const;
 
-  // Loads the currently-flushed superblock from disk into the given protobuf.
+  // Loads the currently-flushed superblock from disk into the given protobuf,
+  // applying the updates appended to the tablet metadata file.
   Status ReadSuperBlockFromDisk(TabletSuperBlockPB* superblock) const;
 
   // Sets *super_block to the serialized form of the current metadata.
@@ -291,10 +293,35 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
   // Updates the cached on-disk size of the tablet superblock.
   Status UpdateOnDiskSize();
 
+  // Like ReadSuperBlockFromDisk(), also setting '*checkpoint_size' to the size
+  // of the file's full superblock and '*clean' to false if the file ends with
+  // a partial update, to which no update may be appended.
+  Status ReadSuperBlockFromDisk(TabletSuperBlockPB* superblock,
+                                uint64_t* checkpoint_size,
+                                bool* clean) const;
+
   // Fully replace superblock.
   // Requires 'flush_lock_'.
   Status ReplaceSuperBlockUnlocked(const TabletSuperBlockPB &pb);
 
+  // Persists the superblock 'pb', either appending its changes since the
+  // last flush to the tablet metadata file or rewriting the file.
+  // Requires 'flush_lock_'.
+  Status FlushSuperBlockUnlocked(const TabletSuperBlockPB& pb);
+
+  // Appends the changes of the superblock 'pb' since the last flush to the
+  // tablet metadata file.
+  // Requires 'flush_lock_'.
+  Status AppendSuperBlockUpdateUnlocked(const TabletSuperBlockPB& pb);
+
+  // Resets the state of the updates appended to the tablet metadata file
+  // after 'pb' is persisted as its full superblock, of size
+  // 'checkpoint_size'. Updates may be appended if 'clean' is true.
+  // Requires 'flush_lock_'.
+  void ResetSuperBlockUpdatesUnlocked(const TabletSuperBlockPB& pb,
+                                      uint64_t checkpoint_size,
+                                      bool clean);
+
   // Requires 'data_lock_'.
   Status UpdateUnlocked(const RowSetMetadataIds& to_remove,
                         const RowSetMetadataVector& to_add,
@@ -387,6 +414,15 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
   // call to Flush() or LoadFromDisk().
   std::atomic<int64_t> on_disk_size_;
 
+  // Whether the next flush may append an update to the tablet metadata file,
+  // the serialized rowsets persisted by the last flush, by rowset id, and the
+  // sizes of the file's full superblock and of the updates appended since.
+  // Protected by 'flush_lock_'.
+  bool can_append_updates_;
+  std::unordered_map<int64_t, std::string> flushed_rowsets_;
+  uint64_t checkpoint_size_;
+  uint64_t appended_size_;
+
   DISALLOW_COPY_AND_ASSIGN(TabletMetadata);
 };
 
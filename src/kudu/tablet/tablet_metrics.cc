@@ -104,6 +104,12 @@ METRIC_DEFINE_counter(tablet, scans_started, "Scans Started",
 METRIC_DEFINE_gauge_size(tablet, tablet_active_scanners, "Active Scanners",
                          kudu::MetricUnit::kScanners,
                          "Number of scanners that are currently active on this tablet");
+METRIC_DEFINE_counter(tablet, row_cache_hits, "Row Cache Hits",
+                      kudu::MetricUnit::kRows,
+                      "Number of point lookups by primary key served from the row cache");
+METRIC_DEFINE_counter(tablet, row_cache_misses, "Row Cache Misses",
+                      kudu::MetricUnit::kRows,
+                      "Number of point lookups by primary key which missed the row cache");
 
 METRIC_DEFINE_counter(tablet, bloom_lookups, "Bloom Filter Lookups",
                       kudu::MetricUnit::kProbes,
@@ -121,6 +127,25 @@ METRIC_DEFINE_counter(tablet, bytes_flushed, "Bytes Flushed",
                       kudu::MetricUnit::kBytes,
                       "Amount of data that has been flushed to disk by this tablet.");
 
+METRIC_DEFINE_counter(tablet, compact_rs_bytes_read, "RowSet Compaction Bytes Read",
+                      kudu::MetricUnit::kBytes,
+                      "Amount of data in the input RowSets of the RowSet compactions of "
+                      "this tablet.");
+METRIC_DEFINE_counter(tablet, compact_rs_bytes_written, "RowSet Compaction Bytes Written",
+                      kudu::MetricUnit::kBytes,
+                      "Amount of data written to disk by the RowSet compactions of this "
+                      "tablet. This is included in the bytes flushed, so the ratio of the "
+                      "bytes flushed to the bytes flushed but not compacted is the write "
+                      "amplification of the compactions.");
+METRIC_DEFINE_counter(tablet, compact_rs_rows_gced, "RowSet Compaction Rows GCed",
+                      kudu::MetricUnit::kRows,
+                      "Number of rows dropped by the RowSet compactions of this tablet "
+                      "because their history is older than the ancient history mark.");
+METRIC_DEFINE_counter(tablet, compact_rs_cpu_time, "RowSet Compaction CPU Time",
+                      kudu::MetricUnit::kMicroseconds,
+                      "Total user and system CPU time spent in the RowSet compactions of "
+                      "this tablet.");
+
 METRIC_DEFINE_counter(tablet, undo_delta_block_gc_bytes_deleted,
                       "Undo Delta Block GC Bytes Deleted",
                       kudu::MetricUnit::kBytes,
@@ -284,11 +309,17 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(scanner_bytes_scanned_from_disk),
     MINIT(scans_started),
     GINIT(tablet_active_scanners),
+    MINIT(row_cache_hits),
+    MINIT(row_cache_misses),
     MINIT(bloom_lookups),
     MINIT(key_file_lookups),
     MINIT(delta_file_lookups),
     MINIT(mrs_lookups),
     MINIT(bytes_flushed),
+    MINIT(compact_rs_bytes_read),
+    MINIT(compact_rs_bytes_written),
+    MINIT(compact_rs_rows_gced),
+    MINIT(compact_rs_cpu_time),
     MINIT(undo_delta_block_gc_bytes_deleted),
     MINIT(bloom_lookups_per_op),
     MINIT(key_file_lookups_per_op),
@@ -313,7 +344,8 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(undo_delta_block_gc_delete_duration),
     MINIT(undo_delta_block_gc_perform_duration),
     MINIT(leader_memory_pressure_rejections),
-    GINIT(average_diskrowset_height) {
+    GINIT(average_diskrowset_height),
+    io(entity) {
 }
 #undef MINIT
 #undef GINIT
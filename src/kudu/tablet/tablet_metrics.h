@@ -20,6 +20,7 @@
 #include <cstdint>
 #include <stddef.h>
 
+#include "kudu/fs/io_metrics.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/util/metrics.h"
 
@@ -60,6 +61,8 @@ struct TabletMetrics {
   scoped_refptr<Counter> scanner_bytes_scanned_from_disk;
   scoped_refptr<Counter> scans_started;
   scoped_refptr<AtomicGauge<size_t>> tablet_active_scanners;
+  scoped_refptr<Counter> row_cache_hits;
+  scoped_refptr<Counter> row_cache_misses;
 
   // Probe stats.
   scoped_refptr<Counter> bloom_lookups;
@@ -69,6 +72,10 @@ struct TabletMetrics {
 
   // Operation stats.
   scoped_refptr<Counter> bytes_flushed;
+  scoped_refptr<Counter> compact_rs_bytes_read;
+  scoped_refptr<Counter> compact_rs_bytes_written;
+  scoped_refptr<Counter> compact_rs_rows_gced;
+  scoped_refptr<Counter> compact_rs_cpu_time;
   scoped_refptr<Counter> undo_delta_block_gc_bytes_deleted;
 
   scoped_refptr<Histogram> bloom_lookups_per_op;
@@ -101,6 +108,9 @@ struct TabletMetrics {
 
   // Compaction metrics.
   scoped_refptr<AtomicGauge<double>> average_diskrowset_height;
+
+  // Block IO metrics, by the source of the IO.
+  fs::IOMetrics io;
 };
 
 } // namespace tablet
@@ -17,9 +17,12 @@
 
 #include "kudu/tablet/tablet_mm_ops.h"
 
+#include <memory>
 #include <mutex>
 #include <ostream>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
@@ -36,9 +39,10 @@
 
 DEFINE_int32(undo_delta_block_gc_init_budget_millis, 1000,
     "The maximum number of milliseconds we will spend initializing "
-    "UNDO delta blocks per invocation of UndoDeltaBlockGCOp. Existing delta "
-    "blocks must be initialized once per process startup to determine "
-    "when they can be deleted.");
+    "UNDO delta blocks per invocation of UndoDeltaBlockGCOp. Delta blocks "
+    "whose max timestamp isn't recorded in the tablet metadata, i.e. blocks "
+    "written by older versions, must be initialized once per process startup "
+    "to determine when they can be deleted.");
 TAG_FLAG(undo_delta_block_gc_init_budget_millis, evolving);
 TAG_FLAG(undo_delta_block_gc_init_budget_millis, advanced);
 
@@ -72,7 +76,9 @@ DEFINE_bool(enable_undo_delta_block_gc, true,
 TAG_FLAG(enable_undo_delta_block_gc, runtime);
 TAG_FLAG(enable_undo_delta_block_gc, unsafe);
 
+using std::shared_ptr;
 using std::string;
+using std::vector;
 using strings::Substitute;
 
 namespace kudu {
@@ -87,6 +93,17 @@ string TabletOpBase::LogPrefix() const {
   return tablet_->LogPrefix();
 }
 
+void TabletOpBase::GetDataDirs(vector<string>* dirs) const {
+  tablet_->GetDataDirs(dirs);
+}
+
+void TabletOpBase::MaybeDeferHeavyCompaction(MaintenanceOpStats* stats) const {
+  if (stats->valid() && stats->runnable() && tablet_->HeavyCompactionsDeferred()) {
+    VLOG_WITH_PREFIX(2) << name() << " is deferred by the master";
+    stats->set_runnable(false);
+  }
+}
+
 ////////////////////////////////////////////////////////////
 // CompactRowSetsOp
 ////////////////////////////////////////////////////////////
@@ -103,6 +120,7 @@ void CompactRowSetsOp::UpdateStats(MaintenanceOpStats* stats) {
     KLOG_EVERY_N_SECS(WARNING, 300)
         << "Rowset compaction is disabled (check --enable_rowset_compaction)";
     stats->set_runnable(false);
+    tablet_->set_rowset_compaction_backlog(false);
     return;
   }
 
@@ -118,6 +136,7 @@ void CompactRowSetsOp::UpdateStats(MaintenanceOpStats* stats) {
         new_num_mrs_flushed == last_num_mrs_flushed_ &&
         new_num_rs_compacted == last_num_rs_compacted_) {
       *stats = prev_stats_;
+      MaybeDeferHeavyCompaction(stats);
       return;
     } else {
       last_num_mrs_flushed_ = new_num_mrs_flushed;
@@ -126,7 +145,10 @@ void CompactRowSetsOp::UpdateStats(MaintenanceOpStats* stats) {
   }
 
   tablet_->UpdateCompactionStats(&prev_stats_);
+  tablet_->set_rowset_compaction_backlog(prev_stats_.valid() && prev_stats_.runnable() &&
+                                         prev_stats_.perf_improvement() > 0);
   *stats = prev_stats_;
+  MaybeDeferHeavyCompaction(stats);
 }
 
 bool CompactRowSetsOp::Prepare() {
@@ -203,9 +225,12 @@ void MinorDeltaCompactionOp::UpdateStats(MaintenanceOpStats* stats) {
     }
   }
 
+  shared_ptr<RowSet> rs;
   double perf_improv = tablet_->GetPerfImprovementForBestDeltaCompact(
-      RowSet::MINOR_DELTA_COMPACTION, nullptr);
+      RowSet::MINOR_DELTA_COMPACTION, &rs);
   prev_stats_.set_perf_improvement(perf_improv);
+  // A minor delta compaction rewrites the deltas of the rowset.
+  prev_stats_.set_workload_bytes(rs ? rs->OnDiskSize() - rs->OnDiskBaseDataSize() : 0);
   prev_stats_.set_runnable(perf_improv > 0);
   *stats = prev_stats_;
 }
@@ -253,6 +278,7 @@ void MajorDeltaCompactionOp::UpdateStats(MaintenanceOpStats* stats) {
     KLOG_EVERY_N_SECS(WARNING, 300)
         << "Major delta compaction is disabled (check --enable_major_delta_compaction)";
     stats->set_runnable(false);
+    tablet_->set_major_delta_compaction_backlog(false);
     return;
   }
 
@@ -276,6 +302,7 @@ void MajorDeltaCompactionOp::UpdateStats(MaintenanceOpStats* stats) {
         new_num_rs_minor_delta_compacted == last_num_rs_minor_delta_compacted_ &&
         new_num_rs_major_delta_compacted == last_num_rs_major_delta_compacted_) {
       *stats = prev_stats_;
+      MaybeDeferHeavyCompaction(stats);
       return;
     } else {
       last_num_mrs_flushed_ = new_num_mrs_flushed;
@@ -286,11 +313,15 @@ void MajorDeltaCompactionOp::UpdateStats(MaintenanceOpStats* stats) {
     }
   }
 
+  shared_ptr<RowSet> rs;
   double perf_improv = tablet_->GetPerfImprovementForBestDeltaCompact(
-      RowSet::MAJOR_DELTA_COMPACTION, nullptr);
+      RowSet::MAJOR_DELTA_COMPACTION, &rs);
   prev_stats_.set_perf_improvement(perf_improv);
+  prev_stats_.set_workload_bytes(rs ? rs->OnDiskSize() : 0);
   prev_stats_.set_runnable(perf_improv > 0);
+  tablet_->set_major_delta_compaction_backlog(perf_improv > 0);
   *stats = prev_stats_;
+  MaybeDeferHeavyCompaction(stats);
 }
 
 bool MajorDeltaCompactionOp::Prepare() {
@@ -20,6 +20,7 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
@@ -42,7 +43,13 @@ class TabletOpBase : public MaintenanceOp {
   TabletOpBase(std::string name, IOUsage io_usage, Tablet* tablet);
   std::string LogPrefix() const;
 
+  virtual void GetDataDirs(std::vector<std::string>* dirs) const OVERRIDE;
+
  protected:
+  // Make a heavy compaction with 'stats' not runnable if the master deferred
+  // the heavy compactions of the tablet.
+  void MaybeDeferHeavyCompaction(MaintenanceOpStats* stats) const;
+
   Tablet* const tablet_;
 };
 
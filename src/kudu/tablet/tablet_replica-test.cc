@@ -22,6 +22,7 @@
 #include <ostream>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <boost/optional/optional.hpp>
 #include <gflags/gflags.h>
@@ -80,6 +81,8 @@
 METRIC_DECLARE_entity(tablet);
 
 DECLARE_int32(flush_threshold_mb);
+DECLARE_int32(tablet_apply_max_batch_size);
+DECLARE_int32(tablet_apply_max_concurrent_tasks);
 
 namespace kudu {
 
@@ -105,6 +108,7 @@ using rpc::ResultTracker;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
+using std::vector;
 using tserver::AlterSchemaRequestPB;;
 using tserver::AlterSchemaResponsePB;;
 using tserver::WriteRequestPB;
@@ -766,5 +770,39 @@ TEST_F(TabletReplicaTest, Kudu2690Test) {
   NO_FATALS(RestartReplica());
 }
 
+// Test that writes submitted faster than they apply are all applied when the
+// apply queue batches them and its tasks yield the apply pool between batches.
+TEST_F(TabletReplicaTest, TestBatchedApply) {
+  FLAGS_tablet_apply_max_batch_size = 2;
+  FLAGS_tablet_apply_max_concurrent_tasks = 1;
+  ConsensusBootstrapInfo info;
+  ASSERT_OK(StartReplicaAndWaitUntilLeader(info));
+
+  const int kNumWrites = 100;
+  vector<unique_ptr<WriteRequestPB>> reqs;
+  vector<unique_ptr<WriteResponsePB>> resps;
+  CountDownLatch rpc_latch(kNumWrites);
+  for (int i = 0; i < kNumWrites; i++) {
+    reqs.emplace_back(new WriteRequestPB());
+    resps.emplace_back(new WriteResponsePB());
+    ASSERT_OK(GenerateSequentialInsertRequest(GetTestSchema(), reqs.back().get()));
+    unique_ptr<WriteTransactionState> tx_state(
+        new WriteTransactionState(tablet_replica_.get(), reqs.back().get(),
+                                  nullptr, // No RequestIdPB
+                                  resps.back().get()));
+    tx_state->set_completion_callback(gscoped_ptr<TransactionCompletionCallback>(
+        new LatchTransactionCompletionCallback<WriteResponsePB>(&rpc_latch,
+                                                                resps.back().get())));
+    ASSERT_OK(tablet_replica_->SubmitWrite(std::move(tx_state)));
+  }
+  rpc_latch.Wait();
+  for (const auto& resp : resps) {
+    ASSERT_FALSE(resp->has_error()) << SecureDebugString(*resp);
+  }
+  uint64_t num_rows;
+  ASSERT_OK(tablet()->CountRows(&num_rows));
+  ASSERT_EQ(kNumWrites, num_rows);
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -127,7 +127,7 @@ TabletReplica::TabletReplica(
       tablet_id_(meta_->tablet_id()),
       local_peer_pb_(std::move(local_peer_pb)),
       log_anchor_registry_(new LogAnchorRegistry()),
-      apply_pool_(apply_pool),
+      apply_queue_(apply_pool),
       mark_dirty_clbk_(std::move(mark_dirty_clbk)),
       state_(NOT_INITIALIZED),
       last_status_("Tablet initializing...") {
@@ -694,7 +694,7 @@ Status TabletReplica::NewLeaderTransactionDriver(gscoped_ptr<Transaction> transa
     consensus_.get(),
     log_.get(),
     prepare_pool_token_.get(),
-    apply_pool_,
+    &apply_queue_,
     &txn_order_verifier_);
   RETURN_NOT_OK(tx_driver->Init(std::move(transaction), consensus::LEADER));
   driver->swap(tx_driver);
@@ -709,7 +709,7 @@ Status TabletReplica::NewReplicaTransactionDriver(gscoped_ptr<Transaction> trans
     consensus_.get(),
     log_.get(),
     prepare_pool_token_.get(),
-    apply_pool_,
+    &apply_queue_,
     &txn_order_verifier_);
   RETURN_NOT_OK(tx_driver->Init(std::move(transaction), consensus::REPLICA));
   driver->swap(tx_driver);
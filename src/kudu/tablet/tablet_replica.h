@@ -41,6 +41,7 @@
 #include "kudu/tablet/tablet_metadata.h"
 #include "kudu/tablet/transaction_order_verifier.h"
 #include "kudu/tablet/transactions/transaction.h"
+#include "kudu/tablet/transactions/transaction_driver.h"
 #include "kudu/tablet/transactions/transaction_tracker.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
@@ -326,10 +327,11 @@ class TabletReplica : public RefCountedThreadSafe<TabletReplica>,
   const consensus::RaftPeerPB local_peer_pb_;
   scoped_refptr<log::LogAnchorRegistry> log_anchor_registry_; // Assigned in tablet_replica-test
 
-  // Pool that executes apply tasks for transactions. This is a multi-threaded
-  // pool, constructor-injected by either the Master (for system tables) or
-  // the Tablet server.
-  ThreadPool* const apply_pool_;
+  // Queue of the transactions ready to apply, which are applied in batches by
+  // the tasks of the apply pool. The apply pool is a multi-threaded pool,
+  // constructor-injected by either the Master (for system tables) or the
+  // Tablet server.
+  TransactionApplyQueue apply_queue_;
 
   // Function to mark this TabletReplica's tablet as dirty in the TSTabletManager.
   //
@@ -21,6 +21,7 @@
 #include <mutex>
 #include <ostream>
 #include <string>
+#include <vector>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
@@ -84,6 +85,8 @@ namespace kudu {
 namespace tablet {
 
 using std::map;
+using std::string;
+using std::vector;
 using strings::Substitute;
 
 // Upper bound for how long it takes to reach "full perf improvement" in time-based flushing.
@@ -147,7 +150,9 @@ void FlushMRSOp::UpdateStats(MaintenanceOpStats* stats) {
     stats->set_runnable(lock.try_lock());
   }
 
-  stats->set_ram_anchored(tablet_replica_->tablet()->MemRowSetSize());
+  const size_t mrs_size = tablet_replica_->tablet()->MemRowSetSize();
+  stats->set_ram_anchored(mrs_size);
+  stats->set_workload_bytes(mrs_size);
   stats->set_logs_retained_bytes(
       tablet_replica_->tablet()->MemRowSetLogReplaySize(replay_size_map));
 
@@ -194,6 +199,10 @@ scoped_refptr<AtomicGauge<uint32_t> > FlushMRSOp::RunningGauge() const {
   return tablet_replica_->tablet()->metrics()->flush_mrs_running;
 }
 
+void FlushMRSOp::GetDataDirs(vector<string>* dirs) const {
+  tablet_replica_->tablet()->GetDataDirs(dirs);
+}
+
 //
 // FlushDeltaMemStoresOp.
 //
@@ -218,6 +227,7 @@ void FlushDeltaMemStoresOp::UpdateStats(MaintenanceOpStats* stats) {
                                                    &dms_size, &retention_size);
 
   stats->set_ram_anchored(dms_size);
+  stats->set_workload_bytes(dms_size);
   stats->set_runnable(true);
   stats->set_logs_retained_bytes(retention_size);
 
@@ -255,6 +265,10 @@ scoped_refptr<AtomicGauge<uint32_t> > FlushDeltaMemStoresOp::RunningGauge() cons
   return tablet_replica_->tablet()->metrics()->flush_dms_running;
 }
 
+void FlushDeltaMemStoresOp::GetDataDirs(vector<string>* dirs) const {
+  tablet_replica_->tablet()->GetDataDirs(dirs);
+}
+
 //
 // LogGCOp.
 //
@@ -0,0 +1,330 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/iterator.h"
+#include "kudu/common/iterator_stats.h"
+#include "kudu/common/partial_row.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/scan_spec.h"
+#include "kudu/common/schema.h"
+#include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/tablet/local_tablet_writer.h"
+#include "kudu/tablet/rowset.h"
+#include "kudu/tablet/tablet-test-util.h"
+#include "kudu/tablet/tablet.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/random.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+#include "kudu/util/stopwatch.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+DEFINE_int32(scan_bench_num_rowsets, 4,
+             "Number of rowsets of the benchmarked tablet. The key ranges of "
+             "the rowsets overlap, so ordered scans merge all of them");
+DEFINE_int32(scan_bench_rows_per_rowset, 50000,
+             "Number of rows of every rowset of the benchmarked tablet");
+DEFINE_int32(scan_bench_num_columns, 8,
+             "Number of non-key columns of the benchmarked tablet");
+DEFINE_string(scan_bench_column_types, "int32,int64,string",
+              "Comma-separated list of the types of the non-key columns, "
+              "among 'int32', 'int64', 'double' and 'string', repeated as "
+              "needed. The first non-key column, which scan predicates are "
+              "evaluated on, is always an int32 column");
+DEFINE_double(scan_bench_update_fraction, 0.1,
+              "Fraction of the rows of every rowset which are updated after "
+              "the rowset is flushed");
+DEFINE_bool(scan_bench_flush_deltas, true,
+            "Whether the updates are flushed to delta files. Otherwise, they "
+            "remain in the delta memstores");
+DEFINE_string(scan_bench_projection_widths, "1,4,all",
+              "Comma-separated list of the numbers of non-key columns scanned, "
+              "or 'all'");
+DEFINE_string(scan_bench_selectivities, "0.01,0.5,1",
+              "Comma-separated list of the fractions of the rows selected by "
+              "the scan predicate. With 1, scans have no predicate");
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace tablet {
+
+namespace {
+
+// The values of the predicate column are uniformly distributed in
+// [0, kPredicateColumnRange).
+constexpr int32_t kPredicateColumnRange = 1000000;
+
+DataType ParseColumnType(const string& name) {
+  if (name == "int32") return INT32;
+  if (name == "int64") return INT64;
+  if (name == "double") return DOUBLE;
+  if (name == "string") return STRING;
+  LOG(FATAL) << "unknown column type: " << name;
+  return UNKNOWN_DATA;
+}
+
+Schema CreateBenchSchema() {
+  const vector<string> types = strings::Split(FLAGS_scan_bench_column_types, ",",
+                                              strings::SkipEmpty());
+  CHECK(!types.empty());
+  vector<ColumnSchema> cols = { ColumnSchema("key", INT32) };
+  for (int i = 0; i < FLAGS_scan_bench_num_columns; i++) {
+    cols.emplace_back(Substitute("c$0", i),
+                      i == 0 ? INT32 : ParseColumnType(types[i % types.size()]));
+  }
+  return Schema(cols, 1);
+}
+
+vector<int> ParseProjectionWidths() {
+  const vector<string> specs = strings::Split(FLAGS_scan_bench_projection_widths, ",",
+                                              strings::SkipEmpty());
+  vector<int> widths;
+  for (const string& w : specs) {
+    const int width = w == "all" ? FLAGS_scan_bench_num_columns : atoi(w.c_str());
+    CHECK(width > 0 && width <= FLAGS_scan_bench_num_columns) << "invalid width: " << w;
+    widths.push_back(width);
+  }
+  return widths;
+}
+
+vector<double> ParseSelectivities() {
+  const vector<string> specs = strings::Split(FLAGS_scan_bench_selectivities, ",",
+                                              strings::SkipEmpty());
+  vector<double> selectivities;
+  for (const string& s : specs) {
+    const double selectivity = atof(s.c_str());
+    CHECK(selectivity > 0 && selectivity <= 1) << "invalid selectivity: " << s;
+    selectivities.push_back(selectivity);
+  }
+  return selectivities;
+}
+
+} // anonymous namespace
+
+class TabletScanBench : public KuduTabletTest {
+ public:
+  TabletScanBench()
+      : KuduTabletTest(CreateBenchSchema()),
+        rng_(SeedRandom()) {
+  }
+
+ protected:
+  // The results of a scan.
+  struct ScanResult {
+    int64_t rows_selected = 0;
+    // Time spent creating and initializing the iterator: rowset and key range
+    // pruning, and opening the column readers.
+    MonoDelta open_time;
+    // Time spent reading, decoding and evaluating predicates on the rows.
+    MonoDelta scan_time;
+    // The stats of the key column, and of the non-key columns combined.
+    IteratorStats key_stats;
+    IteratorStats value_stats;
+  };
+
+  void SetValue(int col_idx, KuduPartialRow* row) {
+    const ColumnSchema& col = client_schema().column(col_idx);
+    if (col.name() == "c0") {
+      CHECK_OK(row->SetInt32(col_idx, rng_.Uniform(kPredicateColumnRange)));
+      return;
+    }
+    switch (col.type_info()->type()) {
+      case INT32:
+        CHECK_OK(row->SetInt32(col_idx, rng_.Next32()));
+        break;
+      case INT64:
+        CHECK_OK(row->SetInt64(col_idx, rng_.Next64()));
+        break;
+      case DOUBLE:
+        CHECK_OK(row->SetDouble(col_idx, rng_.NextDoubleFraction()));
+        break;
+      case STRING:
+        CHECK_OK(row->SetStringCopy(col_idx, StringPrintf("value-%08x", rng_.Next32())));
+        break;
+      default:
+        LOG(FATAL) << "unexpected type " << col.type_info()->name();
+    }
+  }
+
+  // Writes the rowsets of the benchmarked tablet, applying updates to each
+  // after it's flushed.
+  void BuildTablet() {
+    LocalTabletWriter writer(tablet().get(), &client_schema());
+    const int kBatchSize = 1000;
+    const int num_rowsets = FLAGS_scan_bench_num_rowsets;
+    const int num_rows = FLAGS_scan_bench_rows_per_rowset;
+    vector<KuduPartialRow> rows(kBatchSize, KuduPartialRow(&client_schema()));
+    vector<LocalTabletWriter::Op> ops;
+    const auto write_batch = [&]() {
+      CHECK_OK(writer.WriteBatch(ops));
+      ops.clear();
+    };
+
+    for (int r = 0; r < num_rowsets; r++) {
+      for (int i = 0; i < num_rows; i++) {
+        KuduPartialRow* row = &rows[ops.size()];
+        CHECK_OK(row->SetInt32(0, i * num_rowsets + r));
+        for (int c = 1; c < client_schema().num_columns(); c++) {
+          SetValue(c, row);
+        }
+        ops.emplace_back(RowOperationsPB::INSERT, row);
+        if (ops.size() == kBatchSize) {
+          write_batch();
+        }
+      }
+      if (!ops.empty()) {
+        write_batch();
+      }
+      ASSERT_OK(tablet()->Flush());
+
+      // Update the predicate column, so that deltas are applied before
+      // the predicate is evaluated.
+      const int num_updates = num_rows * FLAGS_scan_bench_update_fraction;
+      for (int i = 0; i < num_updates; i++) {
+        KuduPartialRow* row = &rows[ops.size()];
+        CHECK_OK(row->SetInt32(0, rng_.Uniform(num_rows) * num_rowsets + r));
+        SetValue(1, row);
+        ops.emplace_back(RowOperationsPB::UPDATE, row);
+        if (ops.size() == kBatchSize) {
+          write_batch();
+        }
+      }
+      if (!ops.empty()) {
+        write_batch();
+      }
+      if (FLAGS_scan_bench_flush_deltas) {
+        ASSERT_OK(tablet()->FlushAllDMS());
+      }
+    }
+  }
+
+  // Scans the key and the first 'width' non-key columns of the tablet,
+  // selecting about 'selectivity' of the rows.
+  void Scan(int width, double selectivity, OrderMode order, bool cache_blocks,
+            ScanResult* result) {
+    vector<ColumnSchema> cols;
+    for (int i = 0; i <= width; i++) {
+      cols.push_back(client_schema().column(i));
+    }
+    const Schema projection(cols, 1);
+
+    ScanSpec spec;
+    spec.set_cache_blocks(cache_blocks);
+    const int32_t upper = kPredicateColumnRange * selectivity;
+    if (selectivity < 1) {
+      spec.AddPredicate(ColumnPredicate::Range(client_schema().column(1), nullptr, &upper));
+    }
+
+    RowIteratorOptions opts;
+    opts.projection = &projection;
+    opts.order = order;
+    unique_ptr<RowwiseIterator> iter;
+    const MonoTime open_start = MonoTime::Now();
+    ASSERT_OK(tablet()->NewRowIterator(std::move(opts), &iter));
+    ASSERT_OK(iter->Init(&spec));
+    const MonoTime scan_start = MonoTime::Now();
+    result->open_time = scan_start - open_start;
+
+    Arena arena(32 * 1024);
+    RowBlock block(iter->schema(), 1024, &arena);
+    while (iter->HasNext()) {
+      arena.Reset();
+      ASSERT_OK(iter->NextBlock(&block));
+      result->rows_selected += block.selection_vector()->CountSelected();
+    }
+    result->scan_time = MonoTime::Now() - scan_start;
+
+    vector<IteratorStats> stats;
+    iter->GetIteratorStats(&stats);
+    ASSERT_EQ(width + 1, stats.size());
+    result->key_stats = stats[0];
+    for (int i = 1; i < stats.size(); i++) {
+      result->value_stats += stats[i];
+    }
+  }
+
+  Random rng_;
+};
+
+// Scans the tablet with every combination of projection width, predicate
+// selectivity, order mode and block caching. The scans which don't cache
+// blocks run first, while the block cache holds only the few blocks read
+// by the updates.
+TEST_F(TabletScanBench, ScanMatrix) {
+  LOG_TIMING(INFO, "building the tablet") {
+    NO_FATALS(BuildTablet());
+  }
+  const int64_t num_rows =
+      static_cast<int64_t>(FLAGS_scan_bench_num_rowsets) * FLAGS_scan_bench_rows_per_rowset;
+  const vector<int> widths = ParseProjectionWidths();
+  const vector<double> selectivities = ParseSelectivities();
+
+  LOG(INFO) << Substitute("$0 rowsets, $1 rows, $2 non-key columns",
+                          FLAGS_scan_bench_num_rowsets, num_rows,
+                          FLAGS_scan_bench_num_columns);
+  LOG(INFO) << StringPrintf("%-6s %5s %6s %-9s %10s %9s %9s %12s %12s %10s",
+                            "cache", "width", "select", "order", "selected", "open ms",
+                            "scan ms", "rows/s", "value MB", "blocks");
+  for (bool cache_blocks : { false, true }) {
+    for (int width : widths) {
+      if (cache_blocks) {
+        // Warm the block cache up.
+        ScanResult warmup;
+        NO_FATALS(Scan(width, 1, UNORDERED, true, &warmup));
+      }
+      for (double selectivity : selectivities) {
+        for (OrderMode order : { UNORDERED, ORDERED }) {
+          ScanResult r;
+          NO_FATALS(Scan(width, selectivity, order, cache_blocks, &r));
+          LOG(INFO) << StringPrintf(
+              "%-6s %5d %6.2f %-9s %10" PRId64 " %9.1f %9.1f %12.0f %12.1f %10" PRId64,
+              cache_blocks ? "on" : "off", width, selectivity, OrderMode_Name(order).c_str(),
+              r.rows_selected, r.open_time.ToSeconds() * 1000, r.scan_time.ToSeconds() * 1000,
+              num_rows / r.scan_time.ToSeconds(), r.value_stats.bytes_read / 1e6,
+              r.key_stats.blocks_read + r.value_stats.blocks_read);
+          VLOG(1) << "key column: " << r.key_stats.ToString()
+                  << ", non-key columns: " << r.value_stats.ToString();
+        }
+      }
+    }
+  }
+}
+
+} // namespace tablet
+} // namespace kudu
@@ -18,6 +18,7 @@
 #include "kudu/tablet/transactions/transaction.h"
 
 #include "kudu/rpc/result_tracker.h"
+#include "kudu/util/memory/memory.h"
 
 namespace kudu {
 namespace tablet {
@@ -34,7 +35,7 @@ TransactionState::TransactionState(TabletReplica* tablet_replica)
     : tablet_replica_(tablet_replica),
       completion_clbk_(new TransactionCompletionCallback()),
       timestamp_error_(0),
-      arena_(1024),
+      arena_(PoolingBufferAllocator::Get(), 1024),
       external_consistency_mode_(CLIENT_PROPAGATED) {
 }
 
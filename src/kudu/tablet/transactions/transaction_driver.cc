@@ -17,6 +17,7 @@
 
 #include "kudu/tablet/transactions/transaction_driver.h"
 
+#include <algorithm>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -24,6 +25,7 @@
 #include <type_traits>
 #include <utility>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <google/protobuf/descriptor.h>
 #include <google/protobuf/message.h>
@@ -46,12 +48,29 @@
 #include "kudu/tablet/tablet_replica.h"
 #include "kudu/tablet/transaction_order_verifier.h"
 #include "kudu/tablet/transactions/transaction_tracker.h"
+#include "kudu/util/cpu_sampler.h"
 #include "kudu/util/debug/trace_event.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/status_callback.h"
 #include "kudu/util/threadpool.h"
 #include "kudu/util/trace.h"
+#include "kudu/util/trace_ring.h"
+
+DEFINE_int32(tablet_apply_max_batch_size, 32,
+             "Maximum number of transactions of a tablet applied by a task of "
+             "the apply pool before it yields the pool to the other tablets.");
+TAG_FLAG(tablet_apply_max_batch_size, advanced);
+TAG_FLAG(tablet_apply_max_batch_size, experimental);
+
+DEFINE_int32(tablet_apply_max_concurrent_tasks, 4,
+             "Maximum number of tasks of the apply pool applying the "
+             "transactions of a tablet at once. The transactions ready to "
+             "apply while that many tasks are running are applied in batches "
+             "by those tasks.");
+TAG_FLAG(tablet_apply_max_concurrent_tasks, advanced);
+TAG_FLAG(tablet_apply_max_concurrent_tasks, experimental);
 
 namespace kudu {
 namespace tablet {
@@ -107,13 +126,13 @@ TransactionDriver::TransactionDriver(TransactionTracker *txn_tracker,
                                      RaftConsensus* consensus,
                                      Log* log,
                                      ThreadPoolToken* prepare_pool_token,
-                                     ThreadPool* apply_pool,
+                                     TransactionApplyQueue* apply_queue,
                                      TransactionOrderVerifier* order_verifier)
     : txn_tracker_(txn_tracker),
       consensus_(consensus),
       log_(log),
       prepare_pool_token_(prepare_pool_token),
-      apply_pool_(apply_pool),
+      apply_queue_(apply_queue),
       order_verifier_(order_verifier),
       trace_(new Trace()),
       start_time_(MonoTime::Now()),
@@ -240,6 +259,7 @@ Status TransactionDriver::ExecuteAsync() {
 
 void TransactionDriver::PrepareTask() {
   TRACE_EVENT_FLOW_END0("txn", "PrepareTask", this);
+  ScopedCpuSampleTablet cpu_sample_tablet(state()->tablet_replica()->tablet_id());
   Status prepare_status = Prepare();
   if (PREDICT_FALSE(!prepare_status.ok())) {
     HandleFailure(prepare_status);
@@ -282,6 +302,7 @@ Status TransactionDriver::Prepare() {
   prepare_physical_timestamp_ = GetMonoTimeMicros();
 
   RETURN_NOT_OK(transaction_->Prepare());
+  TRACE_RING("Prepared after $0us", GetMonoTimeMicros() - prepare_physical_timestamp_);
 
   // Only take the lock long enough to take a local copy of the
   // replication state and set our prepare state. This ensures that
@@ -434,6 +455,7 @@ void TransactionDriver::ReplicationFinished(const Status& status) {
   }
 
   TRACE_COUNTER_INCREMENT("replication_time_us", replication_duration.ToMicroseconds());
+  TRACE_RING("Replicated after $0us", replication_duration.ToMicroseconds());
 
   // If we have prepared and replicated, we're ready
   // to move ahead and apply this operation.
@@ -490,12 +512,13 @@ Status TransactionDriver::ApplyAsync() {
   }
 
   TRACE_EVENT_FLOW_BEGIN0("txn", "ApplyTask", this);
-  return apply_pool_->SubmitClosure(Bind(&TransactionDriver::ApplyTask, Unretained(this)));
+  return apply_queue_->Submit(this);
 }
 
 void TransactionDriver::ApplyTask() {
   TRACE_EVENT_FLOW_END0("txn", "ApplyTask", this);
   ADOPT_TRACE(trace());
+  ScopedCpuSampleTablet cpu_sample_tablet(state()->tablet_replica()->tablet_id());
   Tablet* tablet = state()->tablet_replica()->tablet();
   if (tablet->HasBeenStopped()) {
     HandleFailure(Status::IllegalState("Not Applying transaction; the tablet is stopped"));
@@ -575,6 +598,7 @@ void TransactionDriver::Finalize() {
   scoped_refptr<TransactionDriver> ref(this);
   std::lock_guard<simple_spinlock> lock(lock_);
   transaction_->Finish(Transaction::COMMITTED);
+  TRACE_RING("Finalized");
   mutable_state()->completion_callback()->TransactionCompleted();
   txn_tracker_->Release(this);
 }
@@ -636,5 +660,77 @@ std::string TransactionDriver::LogPrefix() const {
                     ts_string);
 }
 
+////////////////////////////////////////////////////////////
+// TransactionApplyQueue
+////////////////////////////////////////////////////////////
+
+TransactionApplyQueue::TransactionApplyQueue(ThreadPool* apply_pool)
+    : apply_pool_(apply_pool),
+      no_tasks_(&lock_),
+      num_tasks_(0) {
+}
+
+TransactionApplyQueue::~TransactionApplyQueue() {
+  MutexLock l(lock_);
+  while (num_tasks_ > 0) {
+    no_tasks_.Wait();
+  }
+  DCHECK(queue_.empty());
+}
+
+Status TransactionApplyQueue::Submit(scoped_refptr<TransactionDriver> driver) {
+  MutexLock l(lock_);
+  queue_.emplace_back(std::move(driver));
+  // A new task is only needed if the running ones may all be busy applying.
+  if (num_tasks_ >= std::max(1, FLAGS_tablet_apply_max_concurrent_tasks) ||
+      static_cast<size_t>(num_tasks_) >= queue_.size()) {
+    return Status::OK();
+  }
+  Status s = apply_pool_->SubmitFunc([this]() { RunTask(); });
+  if (PREDICT_FALSE(!s.ok())) {
+    queue_.pop_back();
+    return s;
+  }
+  num_tasks_++;
+  return Status::OK();
+}
+
+void TransactionApplyQueue::RunTask() {
+  const int max_batch_size = std::max(1, FLAGS_tablet_apply_max_batch_size);
+  for (int i = 0; i < max_batch_size; i++) {
+    scoped_refptr<TransactionDriver> driver;
+    {
+      MutexLock l(lock_);
+      if (queue_.empty()) {
+        if (--num_tasks_ == 0) {
+          no_tasks_.Broadcast();
+        }
+        return;
+      }
+      driver = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    driver->ApplyTask();
+  }
+
+  // Let the other tablets use the apply pool before applying the next batch.
+  MutexLock l(lock_);
+  if (!queue_.empty() && apply_pool_->SubmitFunc([this]() { RunTask(); }).ok()) {
+    return;
+  }
+  // Either nothing is left to apply, or the pool is shutting down: the rest of
+  // the queue is applied by this task.
+  while (!queue_.empty()) {
+    scoped_refptr<TransactionDriver> driver = std::move(queue_.front());
+    queue_.pop_front();
+    l.Unlock();
+    driver->ApplyTask();
+    l.Lock();
+  }
+  if (--num_tasks_ == 0) {
+    no_tasks_.Broadcast();
+  }
+}
+
 }  // namespace tablet
 }  // namespace kudu
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <deque>
 #include <string>
 
 #include <gtest/gtest_prod.h>
@@ -28,8 +29,10 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/walltime.h"
 #include "kudu/tablet/transactions/transaction.h"
+#include "kudu/util/condition_variable.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/status.h"
 #include "kudu/util/trace.h"
 
@@ -47,6 +50,7 @@ class RaftConsensus;
 }
 
 namespace tablet {
+class TransactionApplyQueue;
 class TransactionOrderVerifier;
 class TransactionTracker;
 
@@ -85,7 +89,9 @@ class TransactionTracker;
 //
 //      If Prepare() has already completed, then we trigger ApplyAsync().
 //
-//  5 - ApplyAsync() submits ApplyTask() to the apply_pool_.
+//  5 - ApplyAsync() queues the transaction on the tablet's apply_queue_, which
+//      runs ApplyTask() on the apply pool, in a batch with the other
+//      transactions of the tablet ready to apply at the same time.
 //      ApplyTask() calls transaction_->Apply().
 //
 //      When Apply() is called, changes are made to the in-memory data structures. These
@@ -108,7 +114,7 @@ class TransactionTracker;
 //
 // On the leader side, starting the mvcc transaction for writes
 // (calling tablet_->StartTransaction()) must always be done _after_ any relevant row locks are
-// acquired (using AcquireLockForOp). This ensures that, within each row, timestamps only move
+// acquired (using AcquireRowLocks). This ensures that, within each row, timestamps only move
 // forward. If we took a timestamp before getting the row lock, we could have the following
 // situation:
 //
@@ -229,7 +235,7 @@ class TransactionDriver : public RefCountedThreadSafe<TransactionDriver> {
                     consensus::RaftConsensus* consensus,
                     log::Log* log,
                     ThreadPoolToken* prepare_pool_token,
-                    ThreadPool* apply_pool,
+                    TransactionApplyQueue* apply_queue,
                     TransactionOrderVerifier* order_verifier);
 
   // Perform any non-constructor initialization. Sets the transaction
@@ -280,6 +286,7 @@ class TransactionDriver : public RefCountedThreadSafe<TransactionDriver> {
  private:
   FRIEND_TEST(TabletReplicaTest, TestShuttingDownMVCC);
   friend class RefCountedThreadSafe<TransactionDriver>;
+  friend class TransactionApplyQueue;
   enum ReplicationState {
     // The operation has not yet been sent to consensus for replication
     NOT_REPLICATING,
@@ -311,7 +318,8 @@ class TransactionDriver : public RefCountedThreadSafe<TransactionDriver> {
   // Actually prepare.
   Status Prepare();
 
-  // Submits ApplyTask to the apply pool.
+  // Queues the transaction on the apply queue, to run ApplyTask on the apply
+  // pool.
   Status ApplyAsync();
 
   // Calls Transaction::Apply() followed by RaftConsensus::Commit() with the
@@ -354,7 +362,7 @@ class TransactionDriver : public RefCountedThreadSafe<TransactionDriver> {
   consensus::RaftConsensus* const consensus_;
   log::Log* const log_;
   ThreadPoolToken* const prepare_pool_token_;
-  ThreadPool* const apply_pool_;
+  TransactionApplyQueue* const apply_queue_;
   TransactionOrderVerifier* const order_verifier_;
 
   Status transaction_status_;
@@ -393,6 +401,53 @@ class TransactionDriver : public RefCountedThreadSafe<TransactionDriver> {
   DISALLOW_COPY_AND_ASSIGN(TransactionDriver);
 };
 
+// Queue of the transactions of a tablet which are ready to apply.
+//
+// Rather than submitting one task to the apply pool per transaction, the
+// transactions queued while a task is running are applied by that task, one
+// after the other, in the order they were queued. This amortizes the
+// scheduling of the apply pool across the transactions, which dominates for
+// small write batches. Each transaction still applies and commits on its own,
+// holding its row locks and MVCC timestamp as before.
+//
+// Up to --tablet_apply_max_concurrent_tasks tasks apply the transactions of a
+// tablet at once, and a task yields the apply pool to the other tablets after
+// --tablet_apply_max_batch_size transactions.
+//
+// This class is thread safe.
+class TransactionApplyQueue {
+ public:
+  explicit TransactionApplyQueue(ThreadPool* apply_pool);
+
+  // Waits for the running tasks to exit.
+  ~TransactionApplyQueue();
+
+  // Queues 'driver' to be applied, submitting a task to the apply pool if
+  // needed.
+  Status Submit(scoped_refptr<TransactionDriver> driver) WARN_UNUSED_RESULT;
+
+ private:
+  // Applies a batch of queued transactions, then either exits if the queue is
+  // empty or submits itself again.
+  void RunTask();
+
+  ThreadPool* const apply_pool_;
+
+  // Protects the fields below.
+  Mutex lock_;
+
+  // Signaled when 'num_tasks_' drops to zero.
+  ConditionVariable no_tasks_;
+
+  // The transactions to apply, in order.
+  std::deque<scoped_refptr<TransactionDriver>> queue_;
+
+  // The number of tasks submitted to the apply pool and not yet exited.
+  int num_tasks_;
+
+  DISALLOW_COPY_AND_ASSIGN(TransactionApplyQueue);
+};
+
 }  // namespace tablet
 }  // namespace kudu
 
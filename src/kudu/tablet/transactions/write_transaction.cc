@@ -89,7 +89,20 @@ WriteTransaction::WriteTransaction(unique_ptr<WriteTransactionState> state, Driv
 void WriteTransaction::NewReplicateMsg(gscoped_ptr<ReplicateMsg>* replicate_msg) {
   replicate_msg->reset(new ReplicateMsg);
   (*replicate_msg)->set_op_type(WRITE_OP);
-  (*replicate_msg)->mutable_write_request()->CopyFrom(*state()->request());
+  WriteRequestPB* write_request = (*replicate_msg)->mutable_write_request();
+  write_request->CopyFrom(*state()->request());
+  // Replicas decode the operations from the replicated request itself, so move
+  // the data of any sidecar into it.
+  RowOperationsPB* row_operations = write_request->mutable_row_operations();
+  if (row_operations->has_rows_sidecar()) {
+    row_operations->clear_rows_sidecar();
+    row_operations->set_rows(state()->rows_data().data(), state()->rows_data().size());
+  }
+  if (row_operations->has_indirect_data_sidecar()) {
+    row_operations->clear_indirect_data_sidecar();
+    row_operations->set_indirect_data(state()->indirect_data().data(),
+                                      state()->indirect_data().size());
+  }
   if (state()->are_results_tracked()) {
     (*replicate_msg)->mutable_request_id()->CopyFrom(state()->request_id());
   }
@@ -243,6 +256,8 @@ WriteTransactionState::WriteTransactionState(TabletReplica* tablet_replica,
     mvcc_tx_(nullptr),
     schema_at_decode_time_(nullptr) {
   external_consistency_mode_ = request_->external_consistency_mode();
+  rows_data_ = Slice(request_->row_operations().rows());
+  indirect_data_ = Slice(request_->row_operations().indirect_data());
   if (!response_) {
     response_ = &owned_response_;
   }
@@ -366,10 +381,16 @@ void WriteTransactionState::UpdateMetricsForOp(const RowOp& op) {
 }
 
 void WriteTransactionState::ReleaseRowLocks() {
-  // free the row locks
+  // free the row locks, in one pass over the lock table
+  if (row_ops_.empty()) {
+    return;
+  }
+  vector<ScopedRowLock*> locks;
+  locks.reserve(row_ops_.size());
   for (RowOp* op : row_ops_) {
-    op->row_lock.Release();
+    locks.push_back(&op->row_lock);
   }
+  LockManager::ReleaseLocks(locks);
 }
 
 WriteTransactionState::~WriteTransactionState() {
@@ -388,6 +409,8 @@ void WriteTransactionState::ResetRpcFields() {
   std::lock_guard<simple_spinlock> l(txn_state_lock_);
   request_ = nullptr;
   response_ = nullptr;
+  rows_data_.clear();
+  indirect_data_.clear();
   // these are allocated from the arena, so just run the dtors.
   for (RowOp* op : row_ops_) {
     op->~RowOp();
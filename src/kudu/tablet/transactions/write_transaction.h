@@ -36,6 +36,7 @@
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
@@ -100,6 +101,18 @@ class WriteTransactionState : public TransactionState {
     return request_;
   }
 
+  // Sets the encoded row operations of the request, when they aren't in the
+  // request itself but in sidecars of its RPC. The data must remain valid
+  // until the transaction's RPC fields are reset.
+  void set_row_operations_data(Slice rows, Slice indirect_data) {
+    rows_data_ = rows;
+    indirect_data_ = indirect_data;
+  }
+
+  // The encoded row operations of the request, and their indirect data.
+  const Slice& rows_data() const { return rows_data_; }
+  const Slice& indirect_data() const { return indirect_data_; }
+
   // Returns the prepared response to the client that will be sent when this
   // transaction is completed, if this transaction was started by a client.
   tserver::WriteResponsePB *response() const OVERRIDE {
@@ -202,6 +215,11 @@ class WriteTransactionState : public TransactionState {
   const tserver::WriteRequestPB* request_;
   tserver::WriteResponsePB* response_;
 
+  // The encoded row operations, which point either into 'request_' or into
+  // the sidecars of the RPC of the request.
+  Slice rows_data_;
+  Slice indirect_data_;
+
   // The row operations which are decoded from the request during PREPARE
   // Protected by superclass's txn_state_lock_.
   std::vector<RowOp*> row_ops_;
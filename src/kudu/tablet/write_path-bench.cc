@@ -0,0 +1,236 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/common/partial_row.h"
+#include "kudu/common/row_operations.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/wire_protocol.h"
+#include "kudu/consensus/opid_util.h"
+#include "kudu/fs/io_context.h"
+#include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/tablet/row_op.h"
+#include "kudu/tablet/tablet-test-util.h"
+#include "kudu/tablet/tablet.h"
+#include "kudu/tablet/transactions/transaction.h"
+#include "kudu/tablet/transactions/write_transaction.h"
+#include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/hdr_histogram.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/random.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+DEFINE_string(write_bench_num_threads, "1,4,16",
+              "Comma-separated list of the numbers of writer threads to "
+              "benchmark. Every thread count is run against a new tablet");
+DEFINE_int32(write_bench_ops_per_thread, 100000,
+             "Number of row operations applied by every writer thread");
+DEFINE_int32(write_bench_batch_size, 100,
+             "Number of row operations per write transaction");
+DEFINE_double(write_bench_key_overlap, 0.01,
+              "Fraction of the row operations on the keys shared by all the "
+              "threads. The other operations are on keys only written by "
+              "their thread");
+DEFINE_int32(write_bench_num_shared_keys, 1000,
+             "Number of keys shared by all the threads");
+
+using std::string;
+using std::thread;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace tablet {
+
+class WritePathBench : public KuduTabletTest {
+ public:
+  WritePathBench()
+      : KuduTabletTest(Schema({ ColumnSchema("key", INT64),
+                                ColumnSchema("val", INT64),
+                                ColumnSchema("str", STRING) }, 1)) {
+  }
+
+ protected:
+  // The phases of the write path, in the order they run.
+  enum Phase {
+    // Decoding the row operations of the request.
+    DECODE,
+    // Encoding the keys and acquiring the row locks, waiting for the
+    // transactions holding them.
+    ACQUIRE_ROW_LOCKS,
+    // Assigning the timestamp and starting the MVCC transaction.
+    MVCC_START,
+    // Checking the presence of the keys in the rowsets.
+    BULK_CHECK_PRESENCE,
+    // Applying the operations to the MemRowSet.
+    MRS_APPLY,
+    // Committing the MVCC transaction and releasing the row locks.
+    MVCC_COMMIT,
+    NUM_PHASES
+  };
+
+  static const char* PhaseName(int phase) {
+    switch (phase) {
+      case DECODE: return "decode";
+      case ACQUIRE_ROW_LOCKS: return "row locks";
+      case MVCC_START: return "mvcc start";
+      case BULK_CHECK_PRESENCE: return "presence";
+      case MRS_APPLY: return "mrs apply";
+      case MVCC_COMMIT: return "mvcc commit";
+      default: LOG(FATAL) << "unknown phase " << phase;
+    }
+    return "";
+  }
+
+  // Per-batch latencies of every phase, in microseconds, across all threads.
+  struct PhaseHistograms {
+    PhaseHistograms() {
+      for (int i = 0; i < NUM_PHASES; i++) {
+        phases.emplace_back(new HdrHistogram(60 * 1000 * 1000, 2));
+      }
+    }
+    vector<unique_ptr<HdrHistogram>> phases;
+  };
+
+  // Applies a batch of UPSERT operations the way a write transaction does,
+  // timing every phase of it.
+  void ApplyBatch(const RowOperationsPB& ops, PhaseHistograms* histograms) {
+    tserver::WriteRequestPB req;
+    ASSERT_OK(SchemaToPB(client_schema(), req.mutable_schema()));
+    *req.mutable_row_operations() = ops;
+    WriteTransactionState tx_state(nullptr, &req, nullptr);
+    Tablet* t = tablet().get();
+
+    MonoTime start = MonoTime::Now();
+    const auto end_phase = [&](Phase phase) {
+      const MonoTime now = MonoTime::Now();
+      histograms->phases[phase]->Increment((now - start).ToMicroseconds());
+      start = now;
+    };
+    ASSERT_OK(t->DecodeWriteOperations(&client_schema(), &tx_state));
+    end_phase(DECODE);
+    ASSERT_OK(t->AcquireRowLocks(&tx_state));
+    end_phase(ACQUIRE_ROW_LOCKS);
+    t->AssignTimestampAndStartTransactionForTests(&tx_state);
+    tx_state.mutable_op_id()->CopyFrom(consensus::MaximumOpId());
+    end_phase(MVCC_START);
+
+    t->StartApplying(&tx_state);
+    const fs::IOContext io_context = t->MakeIOContext(fs::IOContext::SOURCE_OTHER);
+    ASSERT_OK(t->BulkCheckPresence(&io_context, &tx_state));
+    end_phase(BULK_CHECK_PRESENCE);
+    for (int i = 0; i < tx_state.row_ops().size(); i++) {
+      RowOp* row_op = tx_state.row_ops()[i];
+      if (row_op->has_result()) continue;
+      ASSERT_OK(t->ApplyRowOperation(&io_context, &tx_state, row_op,
+                                     tx_state.mutable_op_stats(i)));
+    }
+    end_phase(MRS_APPLY);
+
+    t->mvcc_manager()->AdjustSafeTime(tx_state.timestamp());
+    tx_state.CommitOrAbort(Transaction::COMMITTED);
+    end_phase(MVCC_COMMIT);
+  }
+
+  // Upserts --write_bench_ops_per_thread rows from the thread 'thread_idx'.
+  void WriterThread(int thread_idx, PhaseHistograms* histograms) {
+    Random rng(SeedRandom() + thread_idx);
+    KuduPartialRow row(&client_schema());
+    int64_t next_own_key = 0;
+    for (int done = 0; done < FLAGS_write_bench_ops_per_thread;) {
+      RowOperationsPB ops;
+      RowOperationsPBEncoder enc(&ops);
+      for (int i = 0; i < FLAGS_write_bench_batch_size && done < FLAGS_write_bench_ops_per_thread;
+           i++, done++) {
+        int64_t key;
+        if (rng.NextDoubleFraction() < FLAGS_write_bench_key_overlap) {
+          key = rng.Uniform(FLAGS_write_bench_num_shared_keys);
+        } else {
+          // Every thread writes its own keys in a range above the shared ones.
+          key = FLAGS_write_bench_num_shared_keys +
+              (static_cast<int64_t>(thread_idx) << 40) + next_own_key++;
+        }
+        CHECK_OK(row.SetInt64(0, key));
+        CHECK_OK(row.SetInt64(1, rng.Next64()));
+        CHECK_OK(row.SetStringNoCopy(2, "value"));
+        enc.Add(RowOperationsPB::UPSERT, row);
+      }
+      NO_FATALS(ApplyBatch(ops, histograms));
+    }
+  }
+};
+
+TEST_F(WritePathBench, ApplyRowOperations) {
+  const vector<string> specs = strings::Split(FLAGS_write_bench_num_threads, ",",
+                                              strings::SkipEmpty());
+  for (const string& spec : specs) {
+    const int num_threads = atoi(spec.c_str());
+    ASSERT_GT(num_threads, 0) << spec;
+    // Every thread count runs against a new tablet with an empty MemRowSet.
+    harness_.reset();
+    NO_FATALS(SetUpTestTablet(GetTestPath(Substitute("fs_root-$0", num_threads))));
+
+    PhaseHistograms histograms;
+    vector<thread> threads;
+    const MonoTime start = MonoTime::Now();
+    for (int i = 0; i < num_threads; i++) {
+      threads.emplace_back([&, i]() { this->WriterThread(i, &histograms); });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    const double elapsed_sec = (MonoTime::Now() - start).ToSeconds();
+    const int64_t num_ops = static_cast<int64_t>(num_threads) * FLAGS_write_bench_ops_per_thread;
+
+    LOG(INFO) << Substitute("$0 threads: $1 ops in $2 s, $3 ops/s (batches of $4, "
+                            "key overlap $5)",
+                            num_threads, num_ops, elapsed_sec,
+                            static_cast<int64_t>(num_ops / elapsed_sec),
+                            FLAGS_write_bench_batch_size, FLAGS_write_bench_key_overlap);
+    LOG(INFO) << StringPrintf("  %-12s %10s %10s %10s %10s %10s %10s",
+                              "phase", "ns/op", "p50 us", "p95 us", "p99 us",
+                              "p99.9 us", "max us");
+    for (int p = 0; p < NUM_PHASES; p++) {
+      const HdrHistogram& h = *histograms.phases[p];
+      LOG(INFO) << StringPrintf(
+          "  %-12s %10.0f %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64,
+          PhaseName(p), h.MeanValue() * 1000 / FLAGS_write_bench_batch_size,
+          h.ValueAtPercentile(50), h.ValueAtPercentile(95), h.ValueAtPercentile(99),
+          h.ValueAtPercentile(99.9), h.MaxValue());
+    }
+  }
+}
+
+} // namespace tablet
+} // namespace kudu
@@ -19,12 +19,14 @@
 
 #include <memory>
 #include <ostream>
+#include <sstream>
 #include <string>
 #include <vector>
 
 #include <gtest/gtest.h>
 #include <rapidjson/document.h>
 
+#include "kudu/tools/flame_graph.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 
@@ -70,7 +72,7 @@ TEST(DiagLogParserTest, TestParseLine) {
   }
 
   {
-    // The line parser recognizes "stacks" and "symbols" categories.
+    // The line parser recognizes "stacks", "symbols" and "cpu_samples" categories.
     // "metrics" isn't recognized yet.
     ParsedLine pl;
     string line = "I0220 17:38:09.950546 stacks 1519177089950546 {\"foo\" : \"bar\"}";
@@ -81,6 +83,10 @@ TEST(DiagLogParserTest, TestParseLine) {
     ASSERT_OK(pl.Parse(line));
     ASSERT_EQ(RecordType::kSymbols, pl.type());
 
+    line = "I0220 17:38:09.950546 cpu_samples 1519177089950546 {\"foo\" : \"bar\"}";
+    ASSERT_OK(pl.Parse(line));
+    ASSERT_EQ(RecordType::kCpuSamples, pl.type());
+
     line = "I0220 17:38:09.950546 metrics 1519177089950546 {\"foo\" : \"bar\"}";
     ASSERT_OK(pl.Parse(line));
     ASSERT_EQ(RecordType::kUnknown, pl.type());
@@ -122,6 +128,8 @@ class TestSymbolsLogVisitor : public LogVisitor {
 
   void VisitStacksRecord(const StacksRecord& /*sr*/) override {}
 
+  void VisitCpuSamplesRecord(const CpuSamplesRecord& /*csr*/) override {}
+
   string addr_;
   string symbol_;
 };
@@ -150,6 +158,7 @@ class NoopLogVisitor : public LogVisitor {
  public:
   void VisitSymbol(const string& /*addr*/, const string& /*symbol*/) override {}
   void VisitStacksRecord(const StacksRecord& /*sr*/) override {}
+  void VisitCpuSamplesRecord(const CpuSamplesRecord& /*csr*/) override {}
 };
 
 // For parsing stacks, we'll check for success or error only. The parse_stacks
@@ -232,5 +241,84 @@ TEST(DiagLogParserTest, TestParseStacks) {
   ASSERT_OK(lp.ParseLine(line));
 }
 
+TEST(DiagLogParserTest, TestParseCpuSamples) {
+  NoopLogVisitor lv;
+  LogParser lp(&lv);
+
+  // The "hz" field must be present.
+  string line = "I0220 17:38:09.950546 cpu_samples 1519177089950546 {\"samples\" : []}";
+  Status s = lp.ParseLine(line);
+  ASSERT_TRUE(s.IsInvalidArgument());
+  ASSERT_STR_CONTAINS(s.ToString(), "expected an integer 'hz' field in CPU samples object");
+
+  // The "samples" field must be present, and be an array.
+  line = "I0220 17:38:09.950546 cpu_samples 1519177089950546 {\"hz\" : 100}";
+  s = lp.ParseLine(line);
+  ASSERT_TRUE(s.IsInvalidArgument());
+  ASSERT_STR_CONTAINS(s.ToString(), "no 'samples' field in CPU samples object");
+
+  line = "I0220 17:38:09.950546 cpu_samples 1519177089950546 "
+         "{\"hz\" : 100, \"samples\" : \"foo\"}";
+  s = lp.ParseLine(line);
+  ASSERT_TRUE(s.IsInvalidArgument());
+  ASSERT_STR_CONTAINS(s.ToString(), "'samples' field should be an array");
+
+  // A sample must have a count and a stack.
+  line = "I0220 17:38:09.950546 cpu_samples 1519177089950546 "
+         "{\"hz\" : 100, \"samples\" : [{\"stack\" : []}]}";
+  s = lp.ParseLine(line);
+  ASSERT_TRUE(s.IsInvalidArgument());
+  ASSERT_STR_CONTAINS(s.ToString(), "expected CPU samples to have a count and frames");
+
+  line = "I0220 17:38:09.950546 cpu_samples 1519177089950546 "
+         "{\"hz\" : 100, \"samples\" : [{\"count\" : \"1\", \"stack\" : []}]}";
+  s = lp.ParseLine(line);
+  ASSERT_TRUE(s.IsInvalidArgument());
+  ASSERT_STR_CONTAINS(s.ToString(), "expected 'count' to be an integer");
+
+  line = "I0220 17:38:09.950546 cpu_samples 1519177089950546 "
+         "{\"hz\" : 100, \"samples\" : [{\"count\" : 1, \"stack\" : [5]}]}";
+  s = lp.ParseLine(line);
+  ASSERT_TRUE(s.IsInvalidArgument());
+  ASSERT_STR_CONTAINS(s.ToString(), "expected 'stack' elements to be strings");
+
+  // Happy cases with and without a tablet.
+  line = "I0220 17:38:09.950546 cpu_samples 1519177089950546 "
+         "{\"hz\" : 100, \"dropped\" : 0, \"samples\" : ["
+         "{\"thread\" : \"apply\", \"tablet\" : \"t\", \"count\" : 3, \"stack\" : [\"0x1\"]},"
+         "{\"thread\" : \"rpc\", \"count\" : 1, \"stack\" : [\"0x1\", \"0x2\"]}]}";
+  ASSERT_OK(lp.ParseLine(line));
+}
+
+TEST(DiagLogParserTest, TestCpuSamplesFlameGraphs) {
+  CpuSamplesLogVisitor lv;
+  LogParser lp(&lv);
+
+  ASSERT_OK(lp.ParseLine("I0220 17:38:09.950546 symbols 1519177089950546 "
+                         "{\"0x1\" : \"Leaf()\", \"0x2\" : \"Root()\"}"));
+  // Two records in the same minute, and one in the next minute.
+  const string kSamples =
+      "{\"hz\" : 100, \"dropped\" : 2, \"samples\" : ["
+      "{\"thread\" : \"apply\", \"tablet\" : \"t\", \"count\" : 3, "
+      "\"stack\" : [\"0x1\", \"0x2\"]},"
+      "{\"thread\" : \"rpc\", \"count\" : 1, \"stack\" : [\"0x3\", \"0x2\"]}]}";
+  ASSERT_OK(lp.ParseLine("I0220 17:38:09.950546 cpu_samples 1519177089950546 " + kSamples));
+  ASSERT_OK(lp.ParseLine("I0220 17:38:59.950546 cpu_samples 1519177139950546 " + kSamples));
+  ASSERT_OK(lp.ParseLine("I0220 17:39:59.950546 cpu_samples 1519177199950546 " + kSamples));
+
+  ASSERT_EQ(2, lv.graphs().size());
+  ASSERT_EQ(6, lv.num_dropped());
+  const auto& first = *lv.graphs().at("0220 17:38");
+  ASSERT_EQ(8, first.total_weight());
+  ASSERT_EQ(4, lv.graphs().at("0220 17:39")->total_weight());
+
+  // The stacks are rooted at their thread and tablet, and the frames without
+  // symbols are named after their address.
+  stringstream folded;
+  first.WriteFolded(&folded);
+  ASSERT_EQ("apply;tablet t;Root();Leaf() 6\n"
+            "rpc;Root();0x3 2\n", folded.str());
+}
+
 } // namespace tools
 } // namespace kudu
@@ -35,6 +35,7 @@
 #include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/stringpiece.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/tools/flame_graph.h"
 #include "kudu/util/jsonreader.h"
 #include "kudu/util/status.h"
 
@@ -43,6 +44,7 @@ using std::cout;
 using std::endl;
 using std::ifstream;
 using std::string;
+using std::vector;
 using strings::Substitute;
 
 namespace kudu {
@@ -52,6 +54,7 @@ const char* RecordTypeToString(RecordType r) {
   switch (r) {
     case RecordType::kStacks: return "stacks"; break;
     case RecordType::kSymbols: return "symbols"; break;
+    case RecordType::kCpuSamples: return "cpu_samples"; break;
     case RecordType::kUnknown: return "<unknown>"; break;
   }
   return "<unreachable>";
@@ -85,6 +88,37 @@ void StackDumpingLogVisitor::VisitStacksRecord(const StacksRecord& sr) {
   }
 }
 
+CpuSamplesLogVisitor::CpuSamplesLogVisitor() {
+}
+
+CpuSamplesLogVisitor::~CpuSamplesLogVisitor() {
+}
+
+void CpuSamplesLogVisitor::VisitSymbol(const string& addr, const string& symbol) {
+  InsertIfNotPresent(&symbols_, addr, symbol);
+}
+
+void CpuSamplesLogVisitor::VisitCpuSamplesRecord(const CpuSamplesRecord& csr) {
+  // The date and time are formatted as "MMDD HH:MM:SS.ffffff".
+  auto& graph = graphs_[csr.date_time.substr(0, 10)];
+  if (!graph) {
+    graph.reset(new FlameGraph);
+  }
+  num_dropped_ += csr.dropped;
+  vector<string> frames;
+  for (const auto& sample : csr.samples) {
+    frames.clear();
+    frames.emplace_back(sample.thread.empty() ? "<unknown thread>" : sample.thread);
+    if (!sample.tablet.empty()) {
+      frames.emplace_back("tablet " + sample.tablet);
+    }
+    for (auto it = sample.frame_addrs.rbegin(); it != sample.frame_addrs.rend(); ++it) {
+      frames.emplace_back(FindWithDefault(symbols_, *it, *it));
+    }
+    graph->AddStack(frames, sample.count);
+  }
+}
+
 Status ParsedLine::Parse(string line) {
   // Take ownership of the line to avoid copying substrings.
   line_ = std::move(line);
@@ -120,6 +154,8 @@ Status ParsedLine::Parse(string line) {
     type_ = RecordType::kSymbols;
   } else if (fields[2] == "stacks") {
     type_ = RecordType::kStacks;
+  } else if (fields[2] == "cpu_samples") {
+    type_ = RecordType::kCpuSamples;
   } else {
     type_ = RecordType::kUnknown;
   }
@@ -145,6 +181,9 @@ Status LogParser::ParseLine(string line) {
       RETURN_NOT_OK(ParseStacks(pl));
       break;
     }
+    case RecordType::kCpuSamples:
+      RETURN_NOT_OK(ParseCpuSamples(pl));
+      break;
     default:
       break;
   }
@@ -248,6 +287,87 @@ Status LogParser::ParseStacks(const ParsedLine& pl) {
   return Status::OK();
 }
 
+Status LogParser::ParseCpuSample(const rapidjson::Value& sample_json,
+                                 CpuSamplesRecord::Sample* sample) {
+  DCHECK(sample);
+  CpuSamplesRecord::Sample ret;
+  if (PREDICT_FALSE(!sample_json.IsObject())) {
+    return Status::InvalidArgument("expected CPU samples to be JSON objects");
+  }
+  if (!sample_json.HasMember("count") || !sample_json.HasMember("stack")) {
+    return Status::InvalidArgument("expected CPU samples to have a count and frames");
+  }
+  if (sample_json.HasMember("thread")) {
+    if (PREDICT_FALSE(!sample_json["thread"].IsString())) {
+      return Status::InvalidArgument("expected 'thread' to be a string");
+    }
+    ret.thread = sample_json["thread"].GetString();
+  }
+  if (sample_json.HasMember("tablet")) {
+    if (PREDICT_FALSE(!sample_json["tablet"].IsString())) {
+      return Status::InvalidArgument("expected 'tablet' to be a string");
+    }
+    ret.tablet = sample_json["tablet"].GetString();
+  }
+  const auto& count = sample_json["count"];
+  if (PREDICT_FALSE(!count.IsInt64())) {
+    return Status::InvalidArgument("expected 'count' to be an integer");
+  }
+  ret.count = count.GetInt64();
+
+  const auto& stack = sample_json["stack"];
+  if (PREDICT_FALSE(!stack.IsArray())) {
+    return Status::InvalidArgument("expected 'stack' to be an array");
+  }
+  for (const auto* frame = stack.Begin();
+       frame != stack.End();
+       ++frame) {
+    if (PREDICT_FALSE(!frame->IsString())) {
+      return Status::InvalidArgument("expected 'stack' elements to be strings");
+    }
+    ret.frame_addrs.emplace_back(frame->GetString());
+  }
+  *sample = std::move(ret);
+  return Status::OK();
+}
+
+Status LogParser::ParseCpuSamples(const ParsedLine& pl) {
+  CpuSamplesRecord csr;
+  csr.date_time = pl.date_time();
+
+  const rapidjson::Value& json = *pl.json();
+  if (!json.IsObject()) {
+    return Status::InvalidArgument("expected CPU samples data to be a JSON object");
+  }
+  if (PREDICT_FALSE(!json.HasMember("hz") || !json["hz"].IsInt())) {
+    return Status::InvalidArgument("expected an integer 'hz' field in CPU samples object");
+  }
+  csr.hz = json["hz"].GetInt();
+  csr.dropped = 0;
+  if (json.HasMember("dropped")) {
+    if (!json["dropped"].IsInt64()) {
+      return Status::InvalidArgument("expected CPU samples 'dropped' to be an integer");
+    }
+    csr.dropped = json["dropped"].GetInt64();
+  }
+
+  if (PREDICT_FALSE(!json.HasMember("samples"))) {
+    return Status::InvalidArgument("no 'samples' field in CPU samples object");
+  }
+  const auto& samples = json["samples"];
+  if (!samples.IsArray()) {
+    return Status::InvalidArgument("'samples' field should be an array");
+  }
+  for (const rapidjson::Value* sample = samples.Begin();
+       sample != samples.End();
+       ++sample) {
+    CpuSamplesRecord::Sample s;
+    RETURN_NOT_OK(ParseCpuSample(*sample, &s));
+    csr.samples.emplace_back(std::move(s));
+  }
+  visitor_->VisitCpuSamplesRecord(csr);
+  return Status::OK();
+}
+
 } // namespace tools
 } // namespace kudu
-
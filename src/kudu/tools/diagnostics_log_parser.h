@@ -17,7 +17,10 @@
 
 #pragma once
 
+#include <cstdint>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -33,11 +36,14 @@
 namespace kudu {
 namespace tools {
 
+class FlameGraph;
+
 // One of the record types from the log.
 // TODO(KUDU-2353) support metrics records.
 enum class RecordType {
   kSymbols,
   kStacks,
+  kCpuSamples,
   kUnknown
 };
 
@@ -65,12 +71,39 @@ struct StacksRecord {
   std::vector<Group> groups;
 };
 
+// The CPU samples aggregated over an interval from the log.
+struct CpuSamplesRecord {
+  // The samples of the same stack, thread pool and tablet.
+  struct Sample {
+    // The thread pool or the category of the sampled threads.
+    std::string thread;
+    // The tablet the threads were working on, or empty if unknown.
+    std::string tablet;
+    int64_t count;
+    // The non-symbolized addresses forming the stack trace, from the
+    // innermost frame to the outermost one.
+    std::vector<std::string> frame_addrs;
+  };
+
+  // The time the samples were logged, at the end of the interval.
+  std::string date_time;
+
+  // The sampling frequency, in samples per second of CPU time.
+  int hz;
+
+  // The number of samples dropped during the interval.
+  int64_t dropped;
+
+  std::vector<Sample> samples;
+};
+
 // Interface for consuming the parsed records from a diagnostics log.
 class LogVisitor {
  public:
   virtual ~LogVisitor() {}
   virtual void VisitSymbol(const std::string& addr, const std::string& symbol) = 0;
   virtual void VisitStacksRecord(const StacksRecord& sr) = 0;
+  virtual void VisitCpuSamplesRecord(const CpuSamplesRecord& csr) = 0;
 };
 
 // LogVisitor implementation which dumps the parsed stack records to cout.
@@ -80,6 +113,8 @@ class StackDumpingLogVisitor : public LogVisitor {
 
   void VisitStacksRecord(const StacksRecord& sr) override;
 
+  void VisitCpuSamplesRecord(const CpuSamplesRecord& /*csr*/) override {}
+
  private:
   // True when we have not yet output any data.
   bool first_ = true;
@@ -89,6 +124,36 @@ class StackDumpingLogVisitor : public LogVisitor {
   const std::string kUnknownSymbol = "<unknown>";
 };
 
+// LogVisitor implementation which aggregates the CPU samples into one flame
+// graph per minute.
+//
+// The stacks of the graphs are rooted at their thread pool, followed by
+// their tablet, if any.
+class CpuSamplesLogVisitor : public LogVisitor {
+ public:
+  CpuSamplesLogVisitor();
+  ~CpuSamplesLogVisitor();
+
+  void VisitSymbol(const std::string& addr, const std::string& symbol) override;
+
+  void VisitStacksRecord(const StacksRecord& /*sr*/) override {}
+
+  void VisitCpuSamplesRecord(const CpuSamplesRecord& csr) override;
+
+  // The flame graphs, keyed by minute in the "MMDD HH:MM" format of the log.
+  const std::map<std::string, std::unique_ptr<FlameGraph>>& graphs() const {
+    return graphs_;
+  }
+
+  // The total number of samples dropped by the server.
+  int64_t num_dropped() const { return num_dropped_; }
+
+ private:
+  std::unordered_map<std::string, std::string> symbols_;
+  std::map<std::string, std::unique_ptr<FlameGraph>> graphs_;
+  int64_t num_dropped_ = 0;
+};
+
 // A parsed line from the diagnostics log.
 //
 // Each line contains a timestamp, a record type, and some JSON data.
@@ -141,6 +206,11 @@ class LogParser {
 
   Status ParseStacks(const ParsedLine& lf);
 
+  static Status ParseCpuSample(const rapidjson::Value& sample_json,
+                               CpuSamplesRecord::Sample* sample);
+
+  Status ParseCpuSamples(const ParsedLine& pl);
+
   LogVisitor* visitor_;
 };
 
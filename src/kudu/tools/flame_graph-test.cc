@@ -0,0 +1,102 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tools/flame_graph.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kudu/util/test_macros.h"
+
+using std::ostringstream;
+using std::string;
+using std::vector;
+
+namespace kudu {
+namespace tools {
+
+TEST(FlameGraphTest, TestFoldedStacks) {
+  FlameGraph graph;
+  graph.AddStack({ "main", "Run", "Read" }, 3);
+  graph.AddStack({ "main", "Run" }, 1);
+  graph.AddStack({ "main", "Run", "Write" }, 2);
+  graph.AddStack({ "main", "Run", "Read" }, 4);
+  ASSERT_EQ(10, graph.total_weight());
+
+  ostringstream out;
+  graph.WriteFolded(&out);
+  ASSERT_EQ("main;Run 1\n"
+            "main;Run;Read 7\n"
+            "main;Run;Write 2\n", out.str());
+
+  // Merging another graph adds up the weights of the same stacks.
+  FlameGraph other;
+  other.AddStack({ "main", "Run", "Write" }, 5);
+  other.AddStack({ "main", "Idle" }, 1);
+  graph.Merge(other);
+  ASSERT_EQ(16, graph.total_weight());
+  out.str("");
+  graph.WriteFolded(&out);
+  ASSERT_EQ("main;Idle 1\n"
+            "main;Run 1\n"
+            "main;Run;Read 7\n"
+            "main;Run;Write 7\n", out.str());
+}
+
+TEST(FlameGraphTest, TestTopFunctions) {
+  FlameGraph graph;
+  graph.AddStack({ "main", "Recurse", "Recurse", "Leaf" }, 6);
+  graph.AddStack({ "main", "Recurse" }, 2);
+  graph.AddStack({ "main", "Other" }, 2);
+
+  ostringstream out;
+  graph.WriteTopFunctions(3, "samples", &out);
+  string report = out.str();
+  ASSERT_STR_CONTAINS(report, "Total: 10 samples");
+  ASSERT_STR_MATCHES(report, "6  60.00% +6  60.00%  Leaf");
+  ASSERT_STR_MATCHES(report, "2  20.00% +2  20.00%  Other");
+  // Recursive functions count once towards their total weight.
+  ASSERT_STR_MATCHES(report, "2  20.00% +8  80.00%  Recurse");
+
+  // Only the requested number of functions are listed, by decreasing self
+  // weight.
+  out.str("");
+  graph.WriteTopFunctions(1, "samples", &out);
+  report = out.str();
+  ASSERT_EQ(3, std::count(report.begin(), report.end(), '\n'));
+  ASSERT_STR_CONTAINS(report, "Leaf");
+}
+
+TEST(FlameGraphTest, TestSvg) {
+  FlameGraph graph;
+  graph.AddStack({ "main", "std::vector<int>::push_back" }, 1);
+
+  ostringstream out;
+  graph.WriteSvg("cpu & more", "samples", &out);
+  const string svg = out.str();
+  ASSERT_STR_CONTAINS(svg, "<svg ");
+  ASSERT_STR_CONTAINS(svg, "cpu &amp; more");
+  ASSERT_STR_CONTAINS(svg, "std::vector&lt;int&gt;::push_back (1 samples, 100.00%)");
+  ASSERT_STR_CONTAINS(svg, "</svg>");
+}
+
+} // namespace tools
+} // namespace kudu
@@ -0,0 +1,238 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tools/flame_graph.h"
+
+#include <algorithm>
+#include <functional>
+#include <unordered_set>
+#include <utility>
+
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/stringprintf.h"
+
+using std::pair;
+using std::string;
+using std::unordered_set;
+using std::vector;
+
+namespace kudu {
+namespace tools {
+
+namespace {
+
+const int kSvgWidth = 1200;
+const int kFrameHeight = 16;
+const int kSvgMargin = 10;
+const int kTitleHeight = 30;
+// The approximate width of a character of the labels, in pixels.
+const double kCharWidth = 7;
+// Frames narrower than this many pixels aren't drawn.
+const double kMinFrameWidth = 0.1;
+
+string XmlEscape(const string& s) {
+  string ret;
+  ret.reserve(s.size());
+  for (char c : s) {
+    switch (c) {
+      case '<': ret.append("&lt;"); break;
+      case '>': ret.append("&gt;"); break;
+      case '&': ret.append("&amp;"); break;
+      case '"': ret.append("&quot;"); break;
+      default: ret.push_back(c);
+    }
+  }
+  return ret;
+}
+
+// Returns a color in the warm palette of the classic flame graphs, stable
+// for a given function.
+string FrameColor(const string& name) {
+  const size_t h = std::hash<string>()(name);
+  return StringPrintf("rgb(%d,%d,%d)",
+                      205 + static_cast<int>(h % 50),
+                      static_cast<int>((h >> 8) % 230),
+                      static_cast<int>((h >> 16) % 55));
+}
+
+} // anonymous namespace
+
+FlameGraph::FlameGraph() {
+}
+
+FlameGraph::~FlameGraph() {
+}
+
+void FlameGraph::AddStack(const vector<string>& frames, int64_t weight) {
+  Node* node = &root_;
+  node->weight += weight;
+  unordered_set<string> seen;
+  for (const auto& frame : frames) {
+    auto& child = node->children[frame];
+    if (!child) {
+      child.reset(new Node);
+    }
+    node = child.get();
+    node->weight += weight;
+    // Recursive functions only count once towards their total weight.
+    if (seen.insert(frame).second) {
+      LookupOrInsert(&total_weights_, frame, 0) += weight;
+    }
+  }
+  if (!frames.empty()) {
+    LookupOrInsert(&self_weights_, frames.back(), 0) += weight;
+  }
+}
+
+void FlameGraph::MergeNode(const Node& src, Node* dst) {
+  dst->weight += src.weight;
+  for (const auto& e : src.children) {
+    auto& child = dst->children[e.first];
+    if (!child) {
+      child.reset(new Node);
+    }
+    MergeNode(*e.second, child.get());
+  }
+}
+
+void FlameGraph::Merge(const FlameGraph& other) {
+  MergeNode(other.root_, &root_);
+  for (const auto& e : other.self_weights_) {
+    LookupOrInsert(&self_weights_, e.first, 0) += e.second;
+  }
+  for (const auto& e : other.total_weights_) {
+    LookupOrInsert(&total_weights_, e.first, 0) += e.second;
+  }
+}
+
+int64_t FlameGraph::total_weight() const {
+  return root_.weight;
+}
+
+void FlameGraph::WriteFoldedNode(const Node& node, string* prefix, std::ostream* out) {
+  int64_t self_weight = node.weight;
+  for (const auto& e : node.children) {
+    self_weight -= e.second->weight;
+  }
+  if (self_weight > 0 && !prefix->empty()) {
+    *out << *prefix << " " << self_weight << "\n";
+  }
+  for (const auto& e : node.children) {
+    const size_t prefix_len = prefix->size();
+    if (!prefix->empty()) {
+      prefix->push_back(';');
+    }
+    prefix->append(e.first);
+    WriteFoldedNode(*e.second, prefix, out);
+    prefix->resize(prefix_len);
+  }
+}
+
+void FlameGraph::WriteFolded(std::ostream* out) const {
+  string prefix;
+  WriteFoldedNode(root_, &prefix, out);
+}
+
+int FlameGraph::MaxDepth(const Node& node) {
+  int depth = 0;
+  for (const auto& e : node.children) {
+    depth = std::max(depth, MaxDepth(*e.second) + 1);
+  }
+  return depth;
+}
+
+void FlameGraph::WriteSvgNode(const string& name, const Node& node, int depth, double x,
+                              double width_per_weight, int svg_height, const string& unit,
+                              std::ostream* out) const {
+  const double width = node.weight * width_per_weight;
+  if (width < kMinFrameWidth) return;
+
+  // The outermost frames are at the bottom of the graph.
+  const int y = svg_height - kSvgMargin - (depth + 1) * kFrameHeight;
+  const string escaped_name = XmlEscape(name);
+  *out << "<g><title>"
+       << StringPrintf("%s (%lld %s, %.2f%%)", escaped_name.c_str(),
+                       static_cast<long long>(node.weight), unit.c_str(),
+                       100.0 * node.weight / root_.weight)
+       << "</title>";
+  *out << StringPrintf("<rect x=\"%.1f\" y=\"%d\" width=\"%.1f\" height=\"%d\" "
+                       "fill=\"%s\" rx=\"2\" ry=\"2\"/>",
+                       x, y, width, kFrameHeight - 1, FrameColor(name).c_str());
+  const int max_chars = static_cast<int>(width / kCharWidth);
+  if (max_chars >= 3) {
+    string label = name;
+    if (label.size() > static_cast<size_t>(max_chars)) {
+      label = label.substr(0, max_chars - 2) + "..";
+    }
+    *out << StringPrintf("<text x=\"%.1f\" y=\"%d\">%s</text>",
+                         x + 3, y + kFrameHeight - 4, XmlEscape(label).c_str());
+  }
+  *out << "</g>\n";
+
+  double child_x = x;
+  for (const auto& e : node.children) {
+    WriteSvgNode(e.first, *e.second, depth + 1, child_x, width_per_weight, svg_height, unit, out);
+    child_x += e.second->weight * width_per_weight;
+  }
+}
+
+void FlameGraph::WriteSvg(const string& title, const string& unit, std::ostream* out) const {
+  const int depth = MaxDepth(root_) + 1;
+  const int height = kTitleHeight + depth * kFrameHeight + 2 * kSvgMargin;
+  *out << "<?xml version=\"1.0\" standalone=\"no\"?>\n";
+  *out << StringPrintf("<svg version=\"1.1\" width=\"%d\" height=\"%d\" "
+                       "viewBox=\"0 0 %d %d\" xmlns=\"http://www.w3.org/2000/svg\">\n",
+                       kSvgWidth, height, kSvgWidth, height);
+  *out << "<style>text { font-family: Verdana, sans-serif; font-size: 12px; "
+          "fill: rgb(0,0,0); pointer-events: none; }</style>\n";
+  *out << StringPrintf("<rect x=\"0\" y=\"0\" width=\"%d\" height=\"%d\" "
+                       "fill=\"rgb(248,248,248)\"/>\n", kSvgWidth, height);
+  *out << StringPrintf("<text x=\"%d\" y=\"%d\" style=\"font-size: 17px\">%s</text>\n",
+                       kSvgMargin, kTitleHeight - 10, XmlEscape(title).c_str());
+  if (root_.weight > 0) {
+    const double width_per_weight =
+        static_cast<double>(kSvgWidth - 2 * kSvgMargin) / root_.weight;
+    WriteSvgNode("all", root_, 0, kSvgMargin, width_per_weight, height, unit, out);
+  }
+  *out << "</svg>\n";
+}
+
+void FlameGraph::WriteTopFunctions(int num_functions, const string& unit,
+                                   std::ostream* out) const {
+  vector<pair<string, int64_t>> functions(self_weights_.begin(), self_weights_.end());
+  std::sort(functions.begin(), functions.end(),
+            [](const pair<string, int64_t>& a, const pair<string, int64_t>& b) {
+              return a.second > b.second || (a.second == b.second && a.first < b.first);
+            });
+  if (functions.size() > static_cast<size_t>(num_functions)) {
+    functions.resize(num_functions);
+  }
+
+  *out << StringPrintf("Total: %lld %s\n", static_cast<long long>(root_.weight), unit.c_str());
+  *out << StringPrintf("%14s %7s %14s %7s  %s\n", "self", "self%", "total", "total%", "function");
+  const double total = std::max<int64_t>(root_.weight, 1);
+  for (const auto& f : functions) {
+    const int64_t function_total = FindWithDefault(total_weights_, f.first, 0);
+    *out << StringPrintf("%14lld %6.2f%% %14lld %6.2f%%  %s\n",
+                         static_cast<long long>(f.second), 100.0 * f.second / total,
+                         static_cast<long long>(function_total), 100.0 * function_total / total,
+                         f.first.c_str());
+  }
+}
+
+} // namespace tools
+} // namespace kudu
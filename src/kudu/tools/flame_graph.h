@@ -0,0 +1,86 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace kudu {
+namespace tools {
+
+// Aggregates weighted stack traces into a tree of frames, which may be
+// written as "folded" stacks (the input format of flamegraph.pl and most
+// other flame graph tools), as a self-contained SVG flame graph, or as a
+// flat report of the heaviest functions.
+//
+// This class is not thread-safe.
+class FlameGraph {
+ public:
+  FlameGraph();
+  ~FlameGraph();
+
+  // Adds a stack trace with the given weight, e.g. a number of samples or
+  // of bytes. 'frames' are ordered from the outermost to the innermost one.
+  void AddStack(const std::vector<std::string>& frames, int64_t weight);
+
+  // Adds all the stacks of 'other' to this graph.
+  void Merge(const FlameGraph& other);
+
+  // Writes one line per distinct stack, with its frames separated by
+  // semicolons followed by its weight.
+  void WriteFolded(std::ostream* out) const;
+
+  // Writes an SVG rendering of the graph. 'unit' names what the weights
+  // count, e.g. "samples".
+  void WriteSvg(const std::string& title, const std::string& unit, std::ostream* out) const;
+
+  // Writes the 'num_functions' functions with the largest self weight, i.e.
+  // the weight of the stacks they are the innermost frame of, along with
+  // their total weight, i.e. the weight of the stacks they are part of.
+  void WriteTopFunctions(int num_functions, const std::string& unit,
+                         std::ostream* out) const;
+
+  int64_t total_weight() const;
+
+ private:
+  struct Node {
+    int64_t weight = 0;
+    std::map<std::string, std::unique_ptr<Node>> children;
+  };
+
+  static void WriteFoldedNode(const Node& node, std::string* prefix, std::ostream* out);
+  static void MergeNode(const Node& src, Node* dst);
+  static int MaxDepth(const Node& node);
+  void WriteSvgNode(const std::string& name, const Node& node, int depth, double x,
+                    double width_per_weight, int svg_height, const std::string& unit,
+                    std::ostream* out) const;
+
+  Node root_;
+
+  // The self and total weights of every function.
+  std::unordered_map<std::string, int64_t> self_weights_;
+  std::unordered_map<std::string, int64_t> total_weights_;
+};
+
+} // namespace tools
+} // namespace kudu
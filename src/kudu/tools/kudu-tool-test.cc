@@ -999,6 +999,7 @@ TEST_F(ToolTest, TestModeHelp) {
   }
   {
     const vector<string> kDiagnoseModeRegexes = {
+        "cpu_flame_graphs.*Render per-minute flame graphs of the CPU samples",
         "parse_stacks.*Parse sampled stack traces",
     };
     NO_FATALS(RunTestHelp("diagnose", kDiagnoseModeRegexes));
@@ -1022,7 +1023,9 @@ TEST_F(ToolTest, TestModeHelp) {
   {
     const vector<string> kPerfRegexes = {
         "loadgen.*Run load generation with optional scan afterwards",
-        "table_scan.*Show row count and scanning time cost of tablets in a table"
+        "profile.*Collect a profile from the servers of a cluster",
+        "table_scan.*Show row count and scanning time cost of tablets in a table",
+        "workload.*Run a mixed workload of reads, writes and scans"
     };
     NO_FATALS(RunTestHelp("perf", kPerfRegexes));
   }
@@ -1074,6 +1077,7 @@ TEST_F(ToolTest, TestModeHelp) {
     const vector<string> kTServerModeRegexes = {
         "dump_memtrackers.*Dump the memtrackers",
         "get_flags.*Get the gflags",
+        "hot_tablets.*List the hottest tablet replicas",
         "set_flag.*Change a gflag value",
         "status.*Get the status",
         "timestamp.*Get the current timestamp",
@@ -2061,6 +2065,40 @@ TEST_F(ToolTest, TestLoadgenDatabaseName) {
   ASSERT_STR_CONTAINS(out, "foo.loadgen_auto_");
 }
 
+// Run the workload driver with every type of operation and key distribution.
+TEST_F(ToolTest, TestPerfWorkload) {
+  NO_FATALS(StartExternalMiniCluster());
+  const string master_addr = cluster_->master()->bound_rpc_addr().ToString();
+  for (const auto& distribution : { "uniform", "zipfian", "hotspot" }) {
+    SCOPED_TRACE(distribution);
+    string out;
+    NO_FATALS(RunActionStdoutString(Substitute(
+        "perf workload $0 --num_threads=2 --workload_num_keys=1000 "
+        "--workload_duration_sec=1 --workload_key_distribution=$1 "
+        "--workload_ops=read:4,upsert:2,update:2,scan:1,full_scan:0.1",
+        master_addr, distribution), &out));
+    ASSERT_STR_CONTAINS(out, "Loaded 1000 rows");
+    for (const auto& op : { "read", "upsert", "update", "scan" }) {
+      ASSERT_STR_MATCHES(out, Substitute("\n  $0 +[1-9][0-9]* +0 ", op));
+    }
+  }
+
+  // Run an open-loop workload at a target rate.
+  string out;
+  NO_FATALS(RunActionStdoutString(Substitute(
+      "perf workload $0 --workload_num_keys=100 --workload_duration_sec=1 "
+      "--workload_target_ops_per_sec=100 --workload_ops=read:1",
+      master_addr), &out));
+  ASSERT_STR_MATCHES(out, "\n  read +[1-9][0-9]* +0 ");
+
+  // Invalid mixes of operations are rejected.
+  string err;
+  Status s = RunActionStderrString(Substitute(
+      "perf workload $0 --workload_ops=read:1,delete:1", master_addr), &err);
+  ASSERT_TRUE(s.IsRuntimeError()) << s.ToString();
+  ASSERT_STR_CONTAINS(err, "unknown operation 'delete'");
+}
+
 TEST_F(ToolTest, TestLoadgenHmsEnabled) {
   ExternalMiniClusterOptions opts;
   opts.hms_mode = HmsMode::ENABLE_HIVE_METASTORE;
@@ -4441,6 +4479,32 @@ TEST_F(ToolTest, TestParseStacks) {
                              "invalid JSON payload.*Missing a closing quotation mark in string");
 }
 
+TEST_F(ToolTest, TestCpuFlameGraphs) {
+  const string kLogPath = GetTestPath("diagnostics.log");
+  ASSERT_OK(WriteStringToFile(env_,
+      "I0314 11:54:20.737790 symbols 1521053660737790 "
+      "{\"0x1\":\"kudu::Leaf()\",\"0x2\":\"kudu::Root()\"}\n"
+      "I0314 11:54:20.737790 cpu_samples 1521053660737790 "
+      "{\"hz\":100,\"dropped\":0,\"samples\":["
+      "{\"thread\":\"apply\",\"tablet\":\"abc\",\"count\":5,\"stack\":[\"0x1\",\"0x2\"]}]}\n"
+      "I0314 11:55:20.737790 cpu_samples 1521053720737790 "
+      "{\"hz\":100,\"dropped\":0,\"samples\":["
+      "{\"thread\":\"rpc\",\"count\":2,\"stack\":[\"0x1\"]}]}\n",
+      kLogPath));
+  const string kOutputDir = GetTestPath("flame_graphs");
+  string stdout;
+  NO_FATALS(RunActionStdoutString(
+      Substitute("diagnose cpu_flame_graphs $0 -flame_graphs_output_dir=$1",
+                 kLogPath, kOutputDir),
+      &stdout));
+  ASSERT_STR_MATCHES(stdout, "0314 11:54 .* 5 .*cpu-0314-1154.svg");
+  ASSERT_STR_MATCHES(stdout, "0314 11:55 .* 2 .*cpu-0314-1155.svg");
+  string svg;
+  ASSERT_OK(ReadFileToString(env_, JoinPathSegments(kOutputDir, "cpu-0314-1154.svg"), &svg));
+  ASSERT_STR_CONTAINS(svg, "kudu::Leaf()");
+  ASSERT_STR_CONTAINS(svg, "tablet abc");
+}
+
 class Is343ReplicaUtilTest :
     public ToolTest,
     public ::testing::WithParamInterface<bool> {
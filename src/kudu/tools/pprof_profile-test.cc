@@ -0,0 +1,149 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tools/pprof_profile.h"
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kudu/tools/flame_graph.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+
+using std::ostringstream;
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+namespace kudu {
+namespace tools {
+
+namespace {
+
+// Returns a CPU profile in the binary format of gperftools made of 'words'.
+string MakeCpuProfile(const vector<uint64_t>& words) {
+  return string(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(uint64_t));
+}
+
+} // anonymous namespace
+
+TEST(PprofProfileTest, TestParseCpuProfile) {
+  const string data = MakeCpuProfile({
+      0, 3, 0, 10000, 0,       // header
+      5, 3, 0x10, 0x21, 0x31,  // 5 samples of a stack of 3 frames
+      2, 2, 0x11, 0x31,        // 2 samples of a stack of 2 frames
+      0, 1, 0 }) +             // trailer
+      "00400000-00500000 r-xp 00000000 08:01 1234 /usr/sbin/kudu-tserver\n";
+  PprofProfile profile;
+  ASSERT_OK(PprofProfile::Parse(PprofProfile::CPU, data, &profile));
+  ASSERT_EQ(2, profile.samples().size());
+  ASSERT_EQ(5, profile.samples()[0].weight);
+  // Only the return addresses are adjusted.
+  ASSERT_EQ(vector<uint64_t>({ 0x10, 0x20, 0x30 }), profile.samples()[0].addresses);
+  ASSERT_EQ(2, profile.samples()[1].weight);
+  ASSERT_EQ(vector<uint64_t>({ 0x11, 0x30 }), profile.samples()[1].addresses);
+  ASSERT_EQ(vector<uint64_t>({ 0x10, 0x11, 0x20, 0x30 }), profile.Addresses());
+
+  // Truncated and invalid profiles are detected.
+  Status s = PprofProfile::Parse(PprofProfile::CPU,
+                                 MakeCpuProfile({ 0, 3, 0, 10000, 0, 5, 3, 0x10 }), &profile);
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+  s = PprofProfile::Parse(PprofProfile::CPU, "not a profile", &profile);
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+}
+
+TEST(PprofProfileTest, TestParseTextProfiles) {
+  {
+    const string data =
+        "heap profile:    3:   3072 [     3:   3072] @ heap_v2/524288\n"
+        "     2:     2048 [     2:     2048] @ 0x11 0x21\n"
+        "     1:     1024 [     1:     1024] @ 0x31\n"
+        "\n"
+        "MAPPED_LIBRARIES:\n"
+        "00400000-00500000 r-xp 00000000 08:01 1234 /usr/sbin/kudu-tserver\n";
+    PprofProfile profile;
+    ASSERT_OK(PprofProfile::Parse(PprofProfile::HEAP, data, &profile));
+    ASSERT_EQ(2, profile.samples().size());
+    ASSERT_EQ(2048, profile.samples()[0].weight);
+    ASSERT_EQ(vector<uint64_t>({ 0x10, 0x20 }), profile.samples()[0].addresses);
+    ASSERT_EQ(1024, profile.samples()[1].weight);
+    ASSERT_EQ(vector<uint64_t>({ 0x30 }), profile.samples()[1].addresses);
+  }
+  {
+    const string data =
+        "--- contention:\n"
+        "sampling period = 1\n"
+        "cycles/second = 2400000000\n"
+        "discarded samples = 0\n"
+        "123456 7 @ 0x11 0x21 0x31\n"
+        "--- Memory map: ---\n"
+        "00400000-00500000 r-xp 00000000 08:01 1234 /usr/sbin/kudu-tserver\n";
+    PprofProfile profile;
+    ASSERT_OK(PprofProfile::Parse(PprofProfile::CONTENTION, data, &profile));
+    ASSERT_EQ(1, profile.samples().size());
+    ASSERT_EQ(123456, profile.samples()[0].weight);
+    ASSERT_EQ(vector<uint64_t>({ 0x10, 0x20, 0x30 }), profile.samples()[0].addresses);
+  }
+  {
+    PprofProfile profile;
+    Status s = PprofProfile::Parse(PprofProfile::CONTENTION, "x y @ 0x11\n", &profile);
+    ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+    s = PprofProfile::Parse(PprofProfile::HEAP,
+                            "%warn Heap profiling is not available without tcmalloc.\n",
+                            &profile);
+    ASSERT_TRUE(s.IsNotSupported()) << s.ToString();
+    ASSERT_STR_CONTAINS(s.ToString(), "Heap profiling is not available without tcmalloc.");
+  }
+}
+
+TEST(PprofProfileTest, TestSymbolize) {
+  unordered_map<uint64_t, string> symbols;
+  ASSERT_OK(ParsePprofSymbols("0x10\tkudu::Leaf()\n0x30\tmain\n", &symbols));
+  ASSERT_EQ(2, symbols.size());
+  ASSERT_TRUE(ParsePprofSymbols("garbage\n", &symbols).IsCorruption());
+
+  const string data = MakeCpuProfile({
+      0, 3, 0, 10000, 0,
+      4, 3, 0x10, 0x21, 0x31,
+      0, 1, 0 });
+  PprofProfile profile;
+  ASSERT_OK(PprofProfile::Parse(PprofProfile::CPU, data, &profile));
+  // Addresses without symbols are named after their value.
+  FlameGraph graph;
+  profile.AddToFlameGraph(symbols, "kudu-tserver", &graph);
+  ostringstream out;
+  graph.WriteFolded(&out);
+  ASSERT_EQ("kudu-tserver;main;0x20;kudu::Leaf() 4\n", out.str());
+}
+
+TEST(PprofProfileTest, TestTypes) {
+  for (const auto type : { PprofProfile::CPU, PprofProfile::HEAP, PprofProfile::CONTENTION }) {
+    PprofProfile::Type parsed;
+    ASSERT_OK(PprofProfile::TypeFromString(PprofProfile::TypeToString(type), &parsed));
+    ASSERT_EQ(type, parsed);
+  }
+  PprofProfile::Type parsed;
+  ASSERT_TRUE(PprofProfile::TypeFromString("growth", &parsed).IsInvalidArgument());
+}
+
+} // namespace tools
+} // namespace kudu
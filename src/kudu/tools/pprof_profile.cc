@@ -0,0 +1,240 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tools/pprof_profile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <set>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/strip.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/tools/flame_graph.h"
+
+using std::set;
+using std::string;
+using std::unordered_map;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace tools {
+
+namespace {
+
+// Parses a hexadecimal address, with or without a "0x" prefix.
+bool ParseAddress(StringPiece str, uint64_t* addr) {
+  string hex;
+  if (!TryStripPrefixString(str, "0x", &hex)) {
+    hex = str.ToString();
+  }
+  return !hex.empty() && safe_strtou64_base(hex, addr, 16);
+}
+
+} // anonymous namespace
+
+Status PprofProfile::TypeFromString(const string& str, Type* type) {
+  if (boost::iequals(str, "cpu")) {
+    *type = CPU;
+  } else if (boost::iequals(str, "heap")) {
+    *type = HEAP;
+  } else if (boost::iequals(str, "contention")) {
+    *type = CONTENTION;
+  } else {
+    return Status::InvalidArgument("unknown profile type", str);
+  }
+  return Status::OK();
+}
+
+const char* PprofProfile::TypeToString(Type type) {
+  switch (type) {
+    case CPU: return "cpu";
+    case HEAP: return "heap";
+    case CONTENTION: return "contention";
+  }
+  LOG(FATAL) << "unknown profile type: " << type;
+  return "";
+}
+
+const char* PprofProfile::EndpointPath(Type type) {
+  switch (type) {
+    case CPU: return "/pprof/profile";
+    case HEAP: return "/pprof/heap";
+    case CONTENTION: return "/pprof/contention";
+  }
+  LOG(FATAL) << "unknown profile type: " << type;
+  return "";
+}
+
+const char* PprofProfile::WeightUnit(Type type) {
+  switch (type) {
+    case CPU: return "samples";
+    case HEAP: return "bytes";
+    case CONTENTION: return "cycles";
+  }
+  LOG(FATAL) << "unknown profile type: " << type;
+  return "";
+}
+
+Status PprofProfile::Parse(Type type, const string& data, PprofProfile* profile) {
+  // The servers report the profiles they can't collect with a warning, e.g.
+  // when they're built without tcmalloc.
+  if (boost::starts_with(data, "%warn")) {
+    string msg = data.substr(strlen("%warn "));
+    StripTrailingNewline(&msg);
+    return Status::NotSupported(msg);
+  }
+  profile->type_ = type;
+  profile->samples_.clear();
+  if (type == CPU) {
+    return ParseCpuProfile(data, profile);
+  }
+  return ParseTextProfile(data, profile);
+}
+
+// The CPU profiles are in the legacy binary format of gperftools, a sequence
+// of native machine words:
+//
+//   header:  0, 3, 0, <sampling period in us>, 0
+//   samples: <count>, <depth>, <pc 1>, ..., <pc depth>
+//   trailer: 0, 1, 0
+//
+// followed by the text of /proc/self/maps of the profiled process.
+Status PprofProfile::ParseCpuProfile(const string& data, PprofProfile* profile) {
+  const size_t num_words = data.size() / sizeof(uint64_t);
+  const auto word = [&](size_t i) {
+    uint64_t w;
+    memcpy(&w, data.data() + i * sizeof(uint64_t), sizeof(w));
+    return w;
+  };
+  if (num_words < 5 || word(0) != 0 || word(1) != 3 || word(2) != 0) {
+    return Status::Corruption("invalid CPU profile header");
+  }
+  size_t i = 5;
+  while (true) {
+    if (i + 2 > num_words) {
+      return Status::Corruption("truncated CPU profile");
+    }
+    const uint64_t count = word(i);
+    const uint64_t depth = word(i + 1);
+    if (count == 0 && depth == 1) {
+      // The trailer.
+      break;
+    }
+    if (i + 2 + depth > num_words) {
+      return Status::Corruption(Substitute("truncated CPU profile sample at word $0", i));
+    }
+    Sample sample;
+    sample.weight = count;
+    for (uint64_t d = 0; d < depth; d++) {
+      const uint64_t pc = word(i + 2 + d);
+      // Only the first address of the stack is where the sample was taken,
+      // the others are return addresses.
+      sample.addresses.push_back(d == 0 ? pc : pc - 1);
+    }
+    profile->samples_.emplace_back(std::move(sample));
+    i += 2 + depth;
+  }
+  return Status::OK();
+}
+
+// The heap and contention profiles are text, one sample per line:
+//
+//   heap:       <objects in use>: <bytes in use> [<objects>: <bytes>] @ <pc> ...
+//   contention: <cycles> <count> @ <pc> ...
+//
+// along with header lines and a memory map.
+Status PprofProfile::ParseTextProfile(const string& data, PprofProfile* profile) {
+  for (StringPiece line : strings::Split(data, "\n", strings::SkipEmpty())) {
+    if (line.starts_with("MAPPED_LIBRARIES:") || line.starts_with("--- Memory map")) {
+      break;
+    }
+    const auto at = line.find(" @ ");
+    // The header of heap profiles also contains '@', followed by the kind of
+    // the profile rather than addresses.
+    if (at == StringPiece::npos || line.starts_with("heap profile:")) continue;
+
+    const vector<StringPiece> counts = strings::Split(
+        line.substr(0, at), strings::delimiter::AnyOf(" :[]"), strings::SkipEmpty());
+    // The weight is the number of bytes in use in heap profiles, and the
+    // number of cycles waited in contention profiles.
+    const size_t weight_idx = profile->type_ == HEAP ? 1 : 0;
+    int64_t weight;
+    if (counts.size() <= weight_idx ||
+        !safe_strto64(counts[weight_idx].data(), counts[weight_idx].size(), &weight)) {
+      return Status::Corruption("invalid profile sample", line);
+    }
+    Sample sample;
+    sample.weight = weight;
+    for (StringPiece addr_str : strings::Split(line.substr(at + 3), " ", strings::SkipEmpty())) {
+      uint64_t addr;
+      if (!ParseAddress(addr_str, &addr)) {
+        return Status::Corruption("invalid address in profile sample", line);
+      }
+      // All the addresses are return addresses.
+      sample.addresses.push_back(addr - 1);
+    }
+    profile->samples_.emplace_back(std::move(sample));
+  }
+  return Status::OK();
+}
+
+vector<uint64_t> PprofProfile::Addresses() const {
+  set<uint64_t> addresses;
+  for (const auto& sample : samples_) {
+    addresses.insert(sample.addresses.begin(), sample.addresses.end());
+  }
+  return vector<uint64_t>(addresses.begin(), addresses.end());
+}
+
+void PprofProfile::AddToFlameGraph(const unordered_map<uint64_t, string>& symbols,
+                                   const string& root_frame,
+                                   FlameGraph* graph) const {
+  vector<string> frames;
+  for (const auto& sample : samples_) {
+    frames.clear();
+    if (!root_frame.empty()) {
+      frames.push_back(root_frame);
+    }
+    for (auto it = sample.addresses.rbegin(); it != sample.addresses.rend(); ++it) {
+      const string* symbol = FindOrNull(symbols, *it);
+      frames.emplace_back(symbol ? *symbol : StringPrintf("0x%" PRIx64, *it));
+    }
+    graph->AddStack(frames, sample.weight);
+  }
+}
+
+Status ParsePprofSymbols(const string& data, unordered_map<uint64_t, string>* symbols) {
+  for (StringPiece line : strings::Split(data, "\n", strings::SkipEmpty())) {
+    const auto tab = line.find('\t');
+    uint64_t addr;
+    if (tab == StringPiece::npos || !ParseAddress(line.substr(0, tab), &addr)) {
+      return Status::Corruption("invalid symbol line", line);
+    }
+    (*symbols)[addr] = line.substr(tab + 1).ToString();
+  }
+  return Status::OK();
+}
+
+} // namespace tools
+} // namespace kudu
@@ -0,0 +1,99 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "kudu/util/status.h"
+
+namespace kudu {
+namespace tools {
+
+class FlameGraph;
+
+// A profile returned by one of the /pprof endpoints of a Kudu server.
+class PprofProfile {
+ public:
+  // The kinds of profiles the servers can collect.
+  enum Type {
+    // Where the CPU time is spent, from /pprof/profile. Weights are samples.
+    CPU,
+    // The sampled heap allocations in use, from /pprof/heap. Weights are bytes.
+    HEAP,
+    // Where the threads wait on contended locks, from /pprof/contention.
+    // Weights are CPU cycles.
+    CONTENTION,
+  };
+
+  // A stack trace and its weight.
+  struct Sample {
+    int64_t weight;
+    // The addresses to symbolize, from the innermost frame to the outermost
+    // one. Return addresses are adjusted to point into their call
+    // instruction, so that they symbolize to the calling function.
+    std::vector<uint64_t> addresses;
+  };
+
+  static Status TypeFromString(const std::string& str, Type* type);
+  static const char* TypeToString(Type type);
+
+  // The path of the server endpoint returning profiles of 'type'.
+  static const char* EndpointPath(Type type);
+
+  // What the weights of the profiles of 'type' count.
+  static const char* WeightUnit(Type type);
+
+  // Parses 'data', the response of the endpoint for 'type'.
+  static Status Parse(Type type, const std::string& data, PprofProfile* profile);
+
+  // Returns the distinct addresses of all the samples, in ascending order.
+  std::vector<uint64_t> Addresses() const;
+
+  // Adds the stacks of all the samples to 'graph', using 'symbols' to name
+  // the frames and their hexadecimal address for the missing ones. If
+  // 'root_frame' is not empty, the stacks are rooted at a frame of that name.
+  void AddToFlameGraph(const std::unordered_map<uint64_t, std::string>& symbols,
+                       const std::string& root_frame,
+                       FlameGraph* graph) const;
+
+  Type type() const {
+    return type_;
+  }
+
+  const std::vector<Sample>& samples() const {
+    return samples_;
+  }
+
+ private:
+  static Status ParseCpuProfile(const std::string& data, PprofProfile* profile);
+  static Status ParseTextProfile(const std::string& data, PprofProfile* profile);
+
+  Type type_ = CPU;
+  std::vector<Sample> samples_;
+};
+
+// Parses the response of /pprof/symbol to a request for the symbols of some
+// addresses, adding the symbols to 'symbols'.
+Status ParsePprofSymbols(const std::string& data,
+                         std::unordered_map<uint64_t, std::string>* symbols);
+
+} // namespace tools
+} // namespace kudu
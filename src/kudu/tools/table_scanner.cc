@@ -23,7 +23,6 @@
 #include <cstring>
 #include <iostream>
 #include <iterator>
-#include <map>
 #include <memory>
 #include <set>
 
@@ -35,6 +34,7 @@
 #include <glog/logging.h>
 #include <rapidjson/document.h>
 
+#include "kudu/client/callbacks.h"
 #include "kudu/client/client.h"
 #include "kudu/client/scan_batch.h"
 #include "kudu/client/scan_predicate.h"
@@ -52,10 +52,12 @@
 #include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/bitmap.h"
+#include "kudu/util/condition_variable.h"
 #include "kudu/util/jsonreader.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/string_case.h"
@@ -70,15 +72,16 @@ using kudu::client::KuduScanToken;
 using kudu::client::KuduScanTokenBuilder;
 using kudu::client::KuduSchema;
 using kudu::client::KuduSession;
+using kudu::client::KuduStatusCallback;
 using kudu::client::KuduTable;
 using kudu::client::KuduTableCreator;
 using kudu::client::KuduValue;
 using kudu::client::KuduWriteOperation;
 using std::endl;
-using std::map;
 using std::ostream;
 using std::ostringstream;
 using std::set;
+using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
 using std::vector;
@@ -111,6 +114,11 @@ DEFINE_string(predicates, "",
               "The only supported predicate operator is `AND`.");
 DEFINE_bool(show_values, false,
             "Whether to show values of scanned rows.");
+DEFINE_int64(split_size_bytes, 256 * 1024 * 1024,
+             "The target amount of data scanned by each scan token. The tablets "
+             "are split into primary key ranges of about this size, which the "
+             "threads take in turn, so that tablets of uneven sizes are scanned "
+             "with balanced load. The tablets aren't split if it's 0.");
 DECLARE_string(tablets);
 DEFINE_string(write_type, "insert",
               "How data should be copied to the destination table. Valid values are 'insert', "
@@ -433,6 +441,90 @@ Status CreateDstTableIfNeeded(const client::sp::shared_ptr<KuduTable>& src_table
   return Status::OK();
 }
 
+namespace {
+
+// The size of the mutation buffer of the sessions which copy rows, and the
+// maximum size of the scan batches being flushed by each session.
+const size_t kCopyMutationBufferBytes = 64 * 1024 * 1024;
+const int64_t kCopyMaxInflightBytes = kCopyMutationBufferBytes / 2;
+
+// Tracks the scan batches whose rows are being written by asynchronous
+// flushes, keeping them alive until the write operations pointing to their
+// rows are flushed, and bounding their total size.
+class BatchFlushTracker {
+ public:
+  explicit BatchFlushTracker(int64_t max_inflight_bytes)
+      : max_inflight_bytes_(max_inflight_bytes),
+        cond_(&lock_),
+        inflight_bytes_(0) {
+  }
+
+  // Waits until a batch of 'size' bytes may be flushed, and accounts for it.
+  // A batch is always let through if no batch is in flight.
+  void WaitForRoom(int64_t size) {
+    MutexLock l(lock_);
+    while (inflight_bytes_ > 0 && inflight_bytes_ + size > max_inflight_bytes_) {
+      cond_.Wait();
+    }
+    inflight_bytes_ += size;
+  }
+
+  // Returns the callback of the flush of 'batch', which was accounted for by
+  // WaitForRoom(size). It deletes itself once run.
+  KuduStatusCallback* NewCallback(shared_ptr<KuduScanBatch> batch, int64_t size) {
+    return new Callback(this, std::move(batch), size);
+  }
+
+  // Waits for the flushes in flight and returns the first error of a flush.
+  Status WaitAll() {
+    MutexLock l(lock_);
+    while (inflight_bytes_ > 0) {
+      cond_.Wait();
+    }
+    return first_error_;
+  }
+
+ private:
+  class Callback : public KuduStatusCallback {
+   public:
+    Callback(BatchFlushTracker* tracker, shared_ptr<KuduScanBatch> batch, int64_t size)
+        : tracker_(tracker),
+          batch_(std::move(batch)),
+          size_(size) {
+    }
+
+    void Run(const Status& s) override {
+      // The rows of the batch aren't referenced anymore.
+      batch_.reset();
+      tracker_->FlushDone(s, size_);
+      delete this;
+    }
+
+   private:
+    BatchFlushTracker* const tracker_;
+    shared_ptr<KuduScanBatch> batch_;
+    const int64_t size_;
+  };
+
+  void FlushDone(const Status& s, int64_t size) {
+    MutexLock l(lock_);
+    if (!s.ok() && first_error_.ok()) {
+      first_error_ = s;
+    }
+    inflight_bytes_ -= size;
+    cond_.Broadcast();
+  }
+
+  const int64_t max_inflight_bytes_;
+
+  Mutex lock_;
+  ConditionVariable cond_;
+  int64_t inflight_bytes_;
+  Status first_error_;
+};
+
+} // anonymous namespace
+
 void CheckPendingErrors(const client::sp::shared_ptr<KuduSession>& session) {
   vector<KuduError*> errors;
   ElementDeleter d(&errors);
@@ -463,23 +555,30 @@ Status TableScanner::AddRow(const client::sp::shared_ptr<KuduTable>& table,
   return session->Apply(write_op.release());
 }
 
-void TableScanner::ScanData(const std::vector<kudu::client::KuduScanToken*>& tokens,
-                            const std::function<void(const KuduScanBatch& batch)>& cb) {
-  for (auto token : tokens) {
+void TableScanner::ScanData(const std::function<void(const shared_ptr<KuduScanBatch>& batch)>& cb) {
+  while (true) {
+    const size_t token_idx = next_token_idx_.Increment() - 1;
+    if (token_idx >= tokens_.size()) {
+      break;
+    }
+    const KuduScanToken* token = tokens_[token_idx];
     Stopwatch sw(Stopwatch::THIS_THREAD);
     sw.start();
 
     KuduScanner* scanner_ptr;
     CHECK_OK(token->IntoKuduScanner(&scanner_ptr));
     unique_ptr<KuduScanner> scanner(scanner_ptr);
+    // Fetch the next batch while the current one is processed.
+    CHECK_OK(scanner->SetPrefetchDepth(1));
     CHECK_OK(scanner->Open());
 
     uint64_t count = 0;
     while (scanner->HasMoreRows()) {
-      KuduScanBatch batch;
-      CHECK_OK(scanner->NextBatch(&batch));
-      count += batch.NumRows();
-      total_count_.IncrementBy(batch.NumRows());
+      // A new batch each time, since 'cb' may keep it.
+      shared_ptr<KuduScanBatch> batch = std::make_shared<KuduScanBatch>();
+      CHECK_OK(scanner->NextBatch(batch.get()));
+      count += batch->NumRows();
+      total_count_.IncrementBy(batch->NumRows());
       cb(batch);
     }
 
@@ -492,37 +591,47 @@ void TableScanner::ScanData(const std::vector<kudu::client::KuduScanToken*>& tok
   }
 }
 
-void TableScanner::ScanTask(const vector<KuduScanToken *>& tokens) {
-  ScanData(tokens, [&](const KuduScanBatch& batch) {
+void TableScanner::ScanTask() {
+  ScanData([&](const shared_ptr<KuduScanBatch>& batch) {
     if (out_ && FLAGS_show_values) {
       MutexLock l(output_lock_);
-      for (const auto& row : batch) {
+      for (const auto& row : *batch) {
         *out_ << row.ToString() << endl;
       }
     }
   });
 }
 
-void TableScanner::CopyTask(const vector<KuduScanToken*>& tokens) {
+void TableScanner::CopyTask() {
   client::sp::shared_ptr<KuduTable> dst_table;
   CHECK_OK(dst_client_.get()->OpenTable(*dst_table_name_, &dst_table));
   const KuduSchema& dst_table_schema = dst_table->schema();
+  const int64_t op_overhead_bytes = 1 + BitmapSize(dst_table_schema.num_columns());
 
   // One session per thread.
   client::sp::shared_ptr<KuduSession> session(dst_client_.get()->NewSession());
-  CHECK_OK(session->SetFlushMode(KuduSession::AUTO_FLUSH_BACKGROUND));
+  CHECK_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+  CHECK_OK(session->SetMutationBufferSpace(kCopyMutationBufferBytes));
   CHECK_OK(session->SetErrorBufferSpace(1024));
   session->SetTimeoutMillis(30000);
 
-  ScanData(tokens, [&](const KuduScanBatch& batch) {
-    for (const auto& row : batch) {
+  // The write operations point to the rows of the scan batches, so each batch
+  // is flushed on its own, asynchronously, and kept until its flush is done.
+  // The next batches are scanned and applied meanwhile.
+  BatchFlushTracker tracker(kCopyMaxInflightBytes);
+  ScanData([&](const shared_ptr<KuduScanBatch>& batch) {
+    // The size of the write operations in the mutation buffer.
+    const int64_t size = batch->direct_data().size() + batch->indirect_data().size() +
+        batch->NumRows() * op_overhead_bytes;
+    tracker.WaitForRoom(size);
+    for (const auto& row : *batch) {
       CHECK_OK(AddRow(dst_table, dst_table_schema, row, session));
     }
-    CheckPendingErrors(session);
-    // Flush here to make sure all write operations have been sent,
-    // and all strings reference to batch are still valid.
-    CHECK_OK(session->Flush());
+    session->FlushAsync(tracker.NewCallback(batch, size));
   });
+  Status s = tracker.WaitAll();
+  CheckPendingErrors(session);
+  CHECK_OK(s);
 }
 
 void TableScanner::MonitorTask() {
@@ -563,6 +672,9 @@ Status TableScanner::StartWork(WorkType type) {
     RETURN_NOT_OK(builder.SetReadMode(mode_.get()));
   }
   RETURN_NOT_OK(builder.SetTimeoutMillis(30000));
+  if (FLAGS_split_size_bytes > 0) {
+    RETURN_NOT_OK(builder.SetSplitSizeBytes(FLAGS_split_size_bytes));
+  }
 
   // Set projection if needed.
   if (type == WorkType::kScan) {
@@ -577,13 +689,14 @@ Status TableScanner::StartWork(WorkType type) {
   ElementDeleter deleter(&tokens);
   RETURN_NOT_OK(builder.Build(&tokens));
 
-  // Set tablet filter.
+  // Set tablet filter. The threads take the tokens in turn, so that they're
+  // busy until all of them are scanned.
   const set<string>& tablet_id_filters = Split(FLAGS_tablets, ",", strings::SkipWhitespace());
-  map<int, vector<KuduScanToken*>> thread_tokens;
-  int i = 0;
+  tokens_.clear();
+  next_token_idx_.Store(0);
   for (auto token : tokens) {
     if (tablet_id_filters.empty() || ContainsKey(tablet_id_filters, token->tablet().id())) {
-      thread_tokens[i++ % FLAGS_num_threads].emplace_back(token);
+      tokens_.emplace_back(token);
     }
   }
 
@@ -594,19 +707,19 @@ Status TableScanner::StartWork(WorkType type) {
 
   Stopwatch sw(Stopwatch::THIS_THREAD);
   sw.start();
-  for (i = 0; i < FLAGS_num_threads; ++i) {
+  for (int i = 0; i < FLAGS_num_threads; ++i) {
     if (type == WorkType::kScan) {
-      RETURN_NOT_OK(thread_pool_->SubmitFunc(
-        boost::bind(&TableScanner::ScanTask, this, thread_tokens[i])));
+      RETURN_NOT_OK(thread_pool_->SubmitFunc(boost::bind(&TableScanner::ScanTask, this)));
     } else {
       CHECK(type == WorkType::kCopy);
-      RETURN_NOT_OK(thread_pool_->SubmitFunc(
-        boost::bind(&TableScanner::CopyTask, this, thread_tokens[i])));
+      RETURN_NOT_OK(thread_pool_->SubmitFunc(boost::bind(&TableScanner::CopyTask, this)));
     }
   }
   RETURN_NOT_OK(thread_pool_->SubmitFunc(boost::bind(&TableScanner::MonitorTask, this)));
   thread_pool_->Wait();
   thread_pool_->Shutdown();
+  // The tokens are deleted on return.
+  tokens_.clear();
 
   sw.stop();
   if (out_) {
@@ -20,6 +20,7 @@
 #include <cstdint>
 #include <functional>
 #include <iosfwd>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -52,6 +53,7 @@ class TableScanner {
                  = boost::none,
                boost::optional<std::string> dst_table_name = boost::none):
     total_count_(0),
+    next_token_idx_(0),
     client_(std::move(client)),
     table_name_(std::move(table_name)),
     dst_client_(std::move(dst_client)),
@@ -80,10 +82,13 @@ class TableScanner {
   };
 
   Status StartWork(WorkType type);
-  void ScanData(const std::vector<kudu::client::KuduScanToken*>& tokens,
-                const std::function<void(const kudu::client::KuduScanBatch& batch)>& cb);
-  void ScanTask(const std::vector<kudu::client::KuduScanToken*>& tokens);
-  void CopyTask(const std::vector<kudu::client::KuduScanToken*>& tokens);
+
+  // Scans the tokens of 'tokens_' not taken by another thread yet, calling 'cb'
+  // with each batch, until all of them are taken.
+  void ScanData(
+      const std::function<void(const std::shared_ptr<kudu::client::KuduScanBatch>& batch)>& cb);
+  void ScanTask();
+  void CopyTask();
   void MonitorTask();
 
   Status AddRow(const client::sp::shared_ptr<kudu::client::KuduTable>& table,
@@ -92,6 +97,11 @@ class TableScanner {
                 const client::sp::shared_ptr<kudu::client::KuduSession>& session);
 
   AtomicInt<uint64_t> total_count_;
+
+  // The tokens to scan, and the index of the next one to take.
+  std::vector<kudu::client::KuduScanToken*> tokens_;
+  AtomicInt<uint64_t> next_token_idx_;
+
   boost::optional<kudu::client::KuduScanner::ReadMode> mode_;
   client::sp::shared_ptr<kudu::client::KuduClient> client_;
   std::string table_name_;
@@ -18,26 +18,44 @@
 #include <algorithm>
 #include <cerrno>
 #include <fstream> // IWYU pragma: keep
+#include <iostream>
+#include <map>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <gflags/gflags_declare.h>
 
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/strings/util.h"
 #include "kudu/tools/diagnostics_log_parser.h"
+#include "kudu/tools/flame_graph.h"
 #include "kudu/tools/tool_action.h"
+#include "kudu/tools/tool_action_common.h"
+#include "kudu/util/env.h"
+#include "kudu/util/env_util.h"
 #include "kudu/util/errno.h"
+#include "kudu/util/path_util.h"
 #include "kudu/util/status.h"
 
 DECLARE_int64(timeout_ms);
 DECLARE_string(format);
 
+DEFINE_string(flame_graphs_output_dir, ".",
+              "Directory the 'cpu_flame_graphs' action writes the flame graphs to. "
+              "It is created if it doesn't exist.");
+
 namespace kudu {
 namespace tools {
 
+using std::cout;
+using std::endl;
 using std::ifstream;
+using std::ostringstream;
 using std::string;
 using std::unique_ptr;
 using std::unordered_map;
@@ -48,14 +66,13 @@ const char* kLogPathArg = "path";
 
 namespace {
 
-Status ParseStacksFromPath(const string& path) {
+Status ParseLogFromPath(const string& path, LogVisitor* visitor) {
   errno = 0;
   ifstream in(path);
   if (!in.is_open()) {
     return Status::IOError(ErrnoToString(errno));
   }
-  StackDumpingLogVisitor dlv;
-  LogParser lp(&dlv);
+  LogParser lp(visitor);
   string line;
   int line_number = 0;
   while (std::getline(in, line)) {
@@ -72,13 +89,53 @@ Status ParseStacks(const RunnerContext& context) {
   // The file names are such that lexicographic sorting reflects
   // timestamp-based sorting.
   std::sort(paths.begin(), paths.end());
+  StackDumpingLogVisitor dlv;
   for (const auto& path : paths) {
-    RETURN_NOT_OK_PREPEND(ParseStacksFromPath(path),
+    RETURN_NOT_OK_PREPEND(ParseLogFromPath(path, &dlv),
                           Substitute("failed to parse stacks from $0", path));
   }
   return Status::OK();
 }
 
+Status WriteCpuFlameGraphs(const RunnerContext& context) {
+  vector<string> paths = context.variadic_args;
+  std::sort(paths.begin(), paths.end());
+  CpuSamplesLogVisitor visitor;
+  for (const auto& path : paths) {
+    RETURN_NOT_OK_PREPEND(ParseLogFromPath(path, &visitor),
+                          Substitute("failed to parse CPU samples from $0", path));
+  }
+  if (visitor.graphs().empty()) {
+    return Status::NotFound("no CPU samples in the diagnostics logs");
+  }
+
+  Env* env = Env::Default();
+  const string& dir = FLAGS_flame_graphs_output_dir;
+  RETURN_NOT_OK_PREPEND(env_util::CreateDirsRecursively(env, dir),
+                        "unable to create the output directory");
+  DataTable table({ "minute", "samples", "flame graph" });
+  for (const auto& e : visitor.graphs()) {
+    // "MMDD HH:MM" becomes "MMDD-HHMM".
+    string basename = "cpu-" + e.first;
+    basename = StringReplace(basename, " ", "-", true);
+    basename = StringReplace(basename, ":", "", true);
+    const string svg_path = JoinPathSegments(dir, basename + ".svg");
+    ostringstream svg;
+    e.second->WriteSvg(Substitute("CPU samples at $0", e.first), "samples", &svg);
+    RETURN_NOT_OK(WriteStringToFile(env, svg.str(), svg_path));
+    ostringstream folded;
+    e.second->WriteFolded(&folded);
+    RETURN_NOT_OK(WriteStringToFile(env, folded.str(),
+                                    JoinPathSegments(dir, basename + ".folded")));
+    table.AddRow({ e.first, std::to_string(e.second->total_weight()), svg_path });
+  }
+  RETURN_NOT_OK(table.PrintTo(cout));
+  if (visitor.num_dropped() > 0) {
+    cout << endl << visitor.num_dropped() << " samples were dropped by the server" << endl;
+  }
+  return Status::OK();
+}
+
 } // anonymous namespace
 
 unique_ptr<Mode> BuildDiagnoseMode() {
@@ -88,8 +145,21 @@ unique_ptr<Mode> BuildDiagnoseMode() {
       .AddRequiredVariadicParameter({ kLogPathArg, "path to log file(s) to parse" })
       .Build();
 
+  unique_ptr<Action> cpu_flame_graphs =
+      ActionBuilder("cpu_flame_graphs", &WriteCpuFlameGraphs)
+      .Description("Render per-minute flame graphs of the CPU samples of a "
+                   "diagnostics log")
+      .ExtraDescription("The flame graphs are written as SVG files along with "
+                        "their folded stacks, one of each per minute with "
+                        "samples. The stacks are rooted at the thread pool they "
+                        "were sampled in, followed by their tablet if any.")
+      .AddRequiredVariadicParameter({ kLogPathArg, "path to log file(s) to parse" })
+      .AddOptionalParameter("flame_graphs_output_dir")
+      .Build();
+
   return ModeBuilder("diagnose")
       .Description("Diagnostic tools for Kudu servers and clusters")
+      .AddAction(std::move(cpu_flame_graphs))
       .AddAction(std::move(parse_stacks))
       .Build();
 }
@@ -799,6 +799,13 @@ Status List(const RunnerContext& /*context*/) {
         RETURN_NOT_OK(AddBlockInfoRow(&table, group, fields, &fs_manager, tablet,
                                       rowset, "adhoc-index", boost::none,
                                       rowset.adhoc_index_block()));
+        for (const auto& index_block : rowset.GetSecondaryIndexBlocksById()) {
+          RETURN_NOT_OK(AddBlockInfoRow(&table, group, fields, &fs_manager, tablet, rowset,
+                                        "secondary-index", index_block.first,
+                                        index_block.second));
+        }
+        RETURN_NOT_OK(AddBlockInfoRow(&table, group, fields, &fs_manager, tablet,
+                                      rowset, "rollup", boost::none, rowset.rollup_block()));
 
       }
     }
@@ -162,19 +162,51 @@
 //      |  | thread2 +---------+
 //      |  |         | tabletC |
 //      v  +---------+         v
+//
+// The 'workload' action runs a mix of point reads, upserts, updates,
+// short-range scans and full scans against a table whose rows are keyed by
+// 0..(N - 1), drawing the keys from a uniform, Zipfian or hotspot distribution,
+// and reports the latency percentiles of every type of operation. For
+// example, to load 1M rows into an auto-created table, and then run a
+// read-mostly workload with Zipfian-distributed keys at a target rate of
+// 5000 operations per second for a minute:
+//
+//   kudu perf workload 127.0.0.1 \
+//     --workload_num_keys=1000000 \
+//     --workload_ops=read:0.95,update:0.05 \
+//     --workload_key_distribution=zipfian \
+//     --workload_target_ops_per_sec=5000 \
+//     --workload_duration_sec=60
+//
+// The 'profile' action collects a CPU, heap or lock contention profile from
+// the masters and tablet servers of a cluster at the same time, and writes
+// the symbolized profile of every server along with a flame graph of all of
+// them merged by role. For example, to profile where the tablet servers
+// spend their CPU time during 60 seconds:
+//
+//   kudu perf profile 127.0.0.1 \
+//     --profile_type=cpu \
+//     --profile_duration_sec=60 \
+//     --profile_servers='*:8050'
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <cstdint>
 #include <cstdlib>
+#include <ctime>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <limits>
 #include <memory>
 #include <mutex>
 #include <numeric>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <boost/optional/optional.hpp>
@@ -183,43 +215,74 @@
 #include <glog/logging.h>
 
 #include "kudu/client/client.h"
+#include "kudu/client/scan_batch.h"
+#include "kudu/client/scan_predicate.h"
 #include "kudu/client/schema.h"
 #include "kudu/client/shared_ptr.h"
+#include "kudu/client/value.h"
 #include "kudu/client/write_op.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/partial_row.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
+#include "kudu/common/wire_protocol.h"
+#include "kudu/common/wire_protocol.pb.h"
 #include "kudu/gutil/map-util.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/strcat.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/master/master.pb.h"
+#include "kudu/master/master.proxy.h"
+#include "kudu/tools/flame_graph.h"
+#include "kudu/tools/pprof_profile.h"
 #include "kudu/tools/table_scanner.h"
 #include "kudu/tools/tool_action.h"
 #include "kudu/tools/tool_action_common.h"
+#include "kudu/util/curl_util.h"
 #include "kudu/util/decimal_util.h"
+#include "kudu/util/env.h"
+#include "kudu/util/env_util.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/flag_validators.h"
+#include "kudu/util/hdr_histogram.h"
 #include "kudu/util/int128.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/oid_generator.h"
+#include "kudu/util/path_util.h"
 #include "kudu/util/random.h"
+#include "kudu/util/random_util.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
 
 using kudu::ColumnSchema;
 using kudu::KuduPartialRow;
+using kudu::ServerRegistrationPB;
 using kudu::Stopwatch;
 using kudu::TypeInfo;
 using kudu::client::KuduClient;
 using kudu::client::KuduColumnSchema;
 using kudu::client::KuduError;
 using kudu::client::KuduInsert;
+using kudu::client::KuduPredicate;
+using kudu::client::KuduScanBatch;
 using kudu::client::KuduScanner;
 using kudu::client::KuduSchema;
 using kudu::client::KuduSchemaBuilder;
 using kudu::client::KuduSession;
 using kudu::client::KuduTable;
 using kudu::client::KuduTableCreator;
+using kudu::client::KuduUpdate;
+using kudu::client::KuduUpsert;
+using kudu::client::KuduValue;
 using kudu::client::sp::shared_ptr;
+using kudu::master::ListMastersRequestPB;
+using kudu::master::ListMastersResponsePB;
+using kudu::master::ListTabletServersRequestPB;
+using kudu::master::ListTabletServersResponsePB;
+using kudu::master::MasterServiceProxy;
 using std::accumulate;
 using std::cerr;
 using std::cout;
@@ -228,8 +291,10 @@ using std::lock_guard;
 using std::mutex;
 using std::numeric_limits;
 using std::ostringstream;
+using std::pair;
 using std::string;
 using std::thread;
+using std::unordered_map;
 using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
@@ -315,6 +380,72 @@ DEFINE_bool(use_random, false,
             "Whether to use random numbers instead of sequential ones. "
             "In case of using random numbers collisions are possible over "
             "the data for columns with unique constraint (e.g. primary key).");
+DEFINE_int32(workload_duration_sec, 10,
+             "Duration of the workload run by the 'workload' action, "
+             "in seconds, not counting the loading of the rows.");
+DEFINE_string(workload_key_distribution, "zipfian",
+              "Distribution of the keys of the operations run by the "
+              "'workload' action. Must be one of 'uniform', 'zipfian' (the "
+              "lowest keys are the most popular, see "
+              "'--workload_zipfian_theta') or 'hotspot' (see "
+              "'--workload_hotspot_keys_fraction' and "
+              "'--workload_hotspot_ops_fraction').");
+DEFINE_double(workload_hotspot_keys_fraction, 0.2,
+              "With the 'hotspot' key distribution, the fraction of the keys, "
+              "starting from the lowest one, which are hot.");
+DEFINE_double(workload_hotspot_ops_fraction, 0.8,
+              "With the 'hotspot' key distribution, the fraction of the "
+              "operations which access the hot keys.");
+DEFINE_bool(workload_load_rows, true,
+            "Whether the 'workload' action upserts the rows keyed by "
+            "0..(--workload_num_keys - 1) into the table before running "
+            "the workload.");
+DEFINE_uint64(workload_num_keys, 100000,
+              "Number of keys the operations of the 'workload' action are "
+              "drawn from: 0..(--workload_num_keys - 1).");
+DEFINE_string(workload_ops, "read:0.5,update:0.5",
+              "Mix of the operations run by the 'workload' action, as a "
+              "comma-separated list of 'operation:proportion' pairs. "
+              "Operations are 'read' (lookup of a row by key), 'upsert', "
+              "'update', 'scan' (scan of up to '--workload_scan_length' rows "
+              "starting from a key) and 'full_scan' (scan of the key column "
+              "of the whole table). Proportions are relative to their sum.");
+DEFINE_int32(workload_scan_length, 100,
+             "Number of consecutive keys a 'scan' operation of the "
+             "'workload' action reads.");
+DEFINE_double(workload_target_ops_per_sec, 0,
+              "Target rate of the operations of the 'workload' action, across "
+              "all threads. If positive, operations are issued on schedule "
+              "regardless of how long earlier ones took (open loop), and "
+              "their latency is measured from the time they were scheduled "
+              "at, so that it includes the time spent waiting for earlier "
+              "operations. If 0, each thread issues operations back to back.");
+DEFINE_double(workload_zipfian_theta, 0.99,
+              "Skew of the 'zipfian' key distribution, in (0, 1): the higher, "
+              "the more popular the most popular keys.");
+DEFINE_int32(profile_duration_sec, 30,
+             "Duration of the CPU and contention profiles collected by the "
+             "'profile' action, in seconds.");
+DEFINE_string(profile_output_dir, "",
+              "Directory the 'profile' action writes the profiles and reports "
+              "to. If empty, a new directory named after the type of the "
+              "profile and the current time is created in the working "
+              "directory.");
+DEFINE_string(profile_servers, "",
+              "Comma-separated list of the servers the 'profile' action "
+              "profiles, each of them given by its UUID or by the host:port "
+              "of its web server. Glob-style patterns are accepted. If empty, "
+              "all the masters and tablet servers of the cluster are "
+              "profiled.");
+DEFINE_string(profile_type, "cpu",
+              "Type of profile collected by the 'profile' action: 'cpu' for "
+              "where the CPU time is spent, 'heap' for the sampled heap "
+              "allocations in use, or 'contention' for where threads wait on "
+              "contended locks.");
+DEFINE_validator(profile_type, [](const char* /*flagname*/, const string& value) {
+  kudu::tools::PprofProfile::Type type;
+  return kudu::tools::PprofProfile::TypeFromString(value, &type).ok();
+});
 
 namespace kudu {
 namespace tools {
@@ -698,6 +829,700 @@ Status TableScan(const RunnerContext &context) {
   return scanner.StartScan();
 }
 
+// The operations of the 'workload' action.
+enum class WorkloadOp {
+  READ,
+  UPSERT,
+  UPDATE,
+  SCAN,
+  FULL_SCAN,
+};
+
+const char* WorkloadOpToString(WorkloadOp op) {
+  switch (op) {
+    case WorkloadOp::READ: return "read";
+    case WorkloadOp::UPSERT: return "upsert";
+    case WorkloadOp::UPDATE: return "update";
+    case WorkloadOp::SCAN: return "scan";
+    case WorkloadOp::FULL_SCAN: return "full_scan";
+  }
+  LOG(FATAL) << "unknown workload operation";
+  return "";
+}
+
+// Parses '--workload_ops' into the operations to run and their cumulative
+// probabilities, in increasing order.
+Status ParseWorkloadOps(const string& spec,
+                        vector<pair<WorkloadOp, double>>* ops) {
+  static const vector<WorkloadOp> kAllOps = {
+    WorkloadOp::READ, WorkloadOp::UPSERT, WorkloadOp::UPDATE,
+    WorkloadOp::SCAN, WorkloadOp::FULL_SCAN,
+  };
+  vector<pair<WorkloadOp, double>> parsed;
+  double total = 0;
+  for (const auto& entry : strings::Split(spec, ",", strings::SkipWhitespace())) {
+    vector<string> op_and_proportion = strings::Split(entry, ":");
+    double proportion;
+    if (op_and_proportion.size() != 2 ||
+        !safe_strtod(op_and_proportion[1], &proportion) || proportion < 0) {
+      return Status::InvalidArgument(
+          Substitute("invalid operation '$0': expected 'operation:proportion' "
+                     "with a non-negative proportion", entry.ToString()));
+    }
+    const auto it = std::find_if(kAllOps.begin(), kAllOps.end(), [&](WorkloadOp op) {
+      return op_and_proportion[0] == WorkloadOpToString(op);
+    });
+    if (it == kAllOps.end()) {
+      return Status::InvalidArgument(
+          Substitute("unknown operation '$0'", op_and_proportion[0]));
+    }
+    if (std::any_of(parsed.begin(), parsed.end(),
+                    [&](const pair<WorkloadOp, double>& e) { return e.first == *it; })) {
+      return Status::InvalidArgument(
+          Substitute("duplicate operation '$0'", op_and_proportion[0]));
+    }
+    if (proportion > 0) {
+      total += proportion;
+      parsed.emplace_back(*it, total);
+    }
+  }
+  if (parsed.empty()) {
+    return Status::InvalidArgument("no operation to run", spec);
+  }
+  for (auto& e : parsed) {
+    e.second /= total;
+  }
+  *ops = std::move(parsed);
+  return Status::OK();
+}
+
+// Draws the keys of the operations of the 'workload' action. Choosers are
+// shared by the threads running the workload.
+class KeyChooser {
+ public:
+  virtual ~KeyChooser() = default;
+
+  // Returns a key in [0, num_keys).
+  virtual int64_t Next(Random* rng) const = 0;
+};
+
+class UniformKeyChooser : public KeyChooser {
+ public:
+  explicit UniformKeyChooser(uint64_t num_keys)
+      : num_keys_(num_keys) {
+  }
+
+  int64_t Next(Random* rng) const override {
+    return rng->Uniform64(num_keys_);
+  }
+
+ private:
+  const uint64_t num_keys_;
+};
+
+// A fraction of the operations access a fraction of the keys, the others
+// access the rest of the keys, uniformly within each set.
+class HotspotKeyChooser : public KeyChooser {
+ public:
+  HotspotKeyChooser(uint64_t num_keys, double keys_fraction, double ops_fraction)
+      : num_keys_(num_keys),
+        num_hot_keys_(std::min<uint64_t>(
+            num_keys, std::max<uint64_t>(1, num_keys * keys_fraction))),
+        ops_fraction_(ops_fraction) {
+  }
+
+  int64_t Next(Random* rng) const override {
+    if (num_hot_keys_ == num_keys_ || rng->NextDoubleFraction() < ops_fraction_) {
+      return rng->Uniform64(num_hot_keys_);
+    }
+    return num_hot_keys_ + rng->Uniform64(num_keys_ - num_hot_keys_);
+  }
+
+ private:
+  const uint64_t num_keys_;
+  const uint64_t num_hot_keys_;
+  const double ops_fraction_;
+};
+
+// Keys are drawn from a Zipfian distribution, the lowest keys being the most
+// popular, using the algorithm of "Quickly Generating Billion-Record
+// Synthetic Databases" by Gray et al., as YCSB does.
+class ZipfianKeyChooser : public KeyChooser {
+ public:
+  ZipfianKeyChooser(uint64_t num_keys, double theta)
+      : num_keys_(num_keys),
+        theta_(theta),
+        alpha_(1.0 / (1.0 - theta)),
+        zetan_(Zeta(num_keys, theta)),
+        eta_((1 - pow(2.0 / num_keys, 1 - theta)) / (1 - Zeta(2, theta) / zetan_)) {
+  }
+
+  int64_t Next(Random* rng) const override {
+    const double u = rng->NextDoubleFraction();
+    const double uz = u * zetan_;
+    if (uz < 1.0) {
+      return 0;
+    }
+    if (uz < 1.0 + pow(0.5, theta_)) {
+      return std::min<uint64_t>(1, num_keys_ - 1);
+    }
+    return std::min<uint64_t>(num_keys_ - 1,
+                              num_keys_ * pow(eta_ * u - eta_ + 1, alpha_));
+  }
+
+ private:
+  static double Zeta(uint64_t n, double theta) {
+    double sum = 0;
+    for (uint64_t i = 1; i <= n; i++) {
+      sum += 1 / pow(i, theta);
+    }
+    return sum;
+  }
+
+  const uint64_t num_keys_;
+  const double theta_;
+  const double alpha_;
+  const double zetan_;
+  const double eta_;
+};
+
+Status NewKeyChooser(unique_ptr<KeyChooser>* chooser) {
+  const uint64_t num_keys = FLAGS_workload_num_keys;
+  if (num_keys == 0) {
+    return Status::InvalidArgument("--workload_num_keys must be positive");
+  }
+  const string& distribution = FLAGS_workload_key_distribution;
+  if (distribution == "uniform") {
+    chooser->reset(new UniformKeyChooser(num_keys));
+  } else if (distribution == "zipfian") {
+    if (FLAGS_workload_zipfian_theta <= 0 || FLAGS_workload_zipfian_theta >= 1) {
+      return Status::InvalidArgument("--workload_zipfian_theta must be in (0, 1)");
+    }
+    chooser->reset(new ZipfianKeyChooser(num_keys, FLAGS_workload_zipfian_theta));
+  } else if (distribution == "hotspot") {
+    if (FLAGS_workload_hotspot_keys_fraction <= 0 || FLAGS_workload_hotspot_keys_fraction > 1 ||
+        FLAGS_workload_hotspot_ops_fraction < 0 || FLAGS_workload_hotspot_ops_fraction > 1) {
+      return Status::InvalidArgument(
+          "--workload_hotspot_keys_fraction must be in (0, 1] and "
+          "--workload_hotspot_ops_fraction in [0, 1]");
+    }
+    chooser->reset(new HotspotKeyChooser(num_keys,
+                                         FLAGS_workload_hotspot_keys_fraction,
+                                         FLAGS_workload_hotspot_ops_fraction));
+  } else {
+    return Status::InvalidArgument("unknown key distribution", distribution);
+  }
+  return Status::OK();
+}
+
+// The latencies and errors of one type of operation of the 'workload'
+// action, shared by all the threads.
+struct WorkloadOpStats {
+  WorkloadOpStats()
+      : latency_us(60 * 1000 * 1000, 3),
+        num_errors(0) {
+  }
+
+  HdrHistogram latency_us;
+  std::atomic<int64_t> num_errors;
+};
+
+// Checks that 'table' is keyed by a single INT64 column, which the
+// 'workload' action fills with 0..(--workload_num_keys - 1).
+Status CheckWorkloadTable(const KuduTable& table) {
+  const KuduSchema& schema = table.schema();
+  vector<int> key_indexes;
+  schema.GetPrimaryKeyColumnIndexes(&key_indexes);
+  if (key_indexes.size() != 1 || key_indexes[0] != 0 ||
+      schema.Column(0).type() != KuduColumnSchema::INT64) {
+    return Status::InvalidArgument(
+        Substitute("table '$0' must have a primary key made of a single INT64 column",
+                   table.name()));
+  }
+  return Status::OK();
+}
+
+// Sets the columns of 'row' to generated values, and its key to 'key'.
+Status GenerateWorkloadRow(Generator* gen, int64_t key, KuduPartialRow* row) {
+  RETURN_NOT_OK(GenerateRowData(gen, row, FLAGS_string_fixed));
+  return row->SetInt64(0, key);
+}
+
+// Drains 'scanner', adding the number of rows read to 'num_rows'.
+Status DrainScanner(KuduScanner* scanner, int64_t* num_rows) {
+  RETURN_NOT_OK(scanner->Open());
+  KuduScanBatch batch;
+  while (scanner->HasMoreRows()) {
+    RETURN_NOT_OK(scanner->NextBatch(&batch));
+    *num_rows += batch.NumRows();
+  }
+  return Status::OK();
+}
+
+Status RunWorkloadOp(WorkloadOp op, int64_t key, const shared_ptr<KuduTable>& table,
+                     const shared_ptr<KuduSession>& session, Generator* gen) {
+  const string& key_column = table->schema().Column(0).name();
+  int64_t num_rows = 0;
+  switch (op) {
+    case WorkloadOp::READ: {
+      KuduScanner scanner(table.get());
+      RETURN_NOT_OK(scanner.AddConjunctPredicate(table->NewComparisonPredicate(
+          key_column, KuduPredicate::EQUAL, KuduValue::FromInt(key))));
+      return DrainScanner(&scanner, &num_rows);
+    }
+    case WorkloadOp::UPSERT: {
+      unique_ptr<KuduUpsert> upsert(table->NewUpsert());
+      RETURN_NOT_OK(GenerateWorkloadRow(gen, key, upsert->mutable_row()));
+      return session->Apply(upsert.release());
+    }
+    case WorkloadOp::UPDATE: {
+      unique_ptr<KuduUpdate> update(table->NewUpdate());
+      RETURN_NOT_OK(GenerateWorkloadRow(gen, key, update->mutable_row()));
+      return session->Apply(update.release());
+    }
+    case WorkloadOp::SCAN: {
+      KuduScanner scanner(table.get());
+      RETURN_NOT_OK(scanner.AddConjunctPredicate(table->NewComparisonPredicate(
+          key_column, KuduPredicate::GREATER_EQUAL, KuduValue::FromInt(key))));
+      RETURN_NOT_OK(scanner.AddConjunctPredicate(table->NewComparisonPredicate(
+          key_column, KuduPredicate::LESS, KuduValue::FromInt(key + FLAGS_workload_scan_length))));
+      return DrainScanner(&scanner, &num_rows);
+    }
+    case WorkloadOp::FULL_SCAN: {
+      KuduScanner scanner(table.get());
+      RETURN_NOT_OK(scanner.SetProjectedColumnNames({ key_column }));
+      return DrainScanner(&scanner, &num_rows);
+    }
+  }
+  return Status::OK();
+}
+
+// Upserts the rows keyed by the keys in [0, --workload_num_keys) assigned
+// to the thread 'thread_idx'.
+void WorkloadLoadThread(const shared_ptr<KuduClient>& client, const string& table_name,
+                        int thread_idx, Status* status) {
+  *status = [&]() -> Status {
+    shared_ptr<KuduTable> table;
+    RETURN_NOT_OK(client->OpenTable(table_name, &table));
+    shared_ptr<KuduSession> session(client->NewSession());
+    RETURN_NOT_OK(session->SetMutationBufferSpace(FLAGS_buffer_size_bytes));
+    RETURN_NOT_OK(session->SetFlushMode(KuduSession::AUTO_FLUSH_BACKGROUND));
+    Generator gen(Generator::MODE_RAND, thread_idx, FLAGS_string_len);
+    for (uint64_t key = thread_idx; key < FLAGS_workload_num_keys; key += FLAGS_num_threads) {
+      unique_ptr<KuduUpsert> upsert(table->NewUpsert());
+      RETURN_NOT_OK(GenerateWorkloadRow(&gen, key, upsert->mutable_row()));
+      RETURN_NOT_OK(session->Apply(upsert.release()));
+    }
+    RETURN_NOT_OK(session->Flush());
+    if (session->CountPendingErrors() != 0) {
+      vector<KuduError*> errors;
+      ElementDeleter d(&errors);
+      session->GetPendingErrors(&errors, nullptr);
+      return errors.front()->status().CloneAndPrepend("failed to load rows");
+    }
+    return Status::OK();
+  }();
+}
+
+// Runs the operations of the workload until 'deadline'.
+void WorkloadThread(const shared_ptr<KuduClient>& client, const string& table_name,
+                    const vector<pair<WorkloadOp, double>>& ops,
+                    const KeyChooser* key_chooser, int thread_idx,
+                    const MonoTime& deadline, vector<WorkloadOpStats>* stats,
+                    Status* status) {
+  *status = [&]() -> Status {
+    shared_ptr<KuduTable> table;
+    RETURN_NOT_OK(client->OpenTable(table_name, &table));
+    shared_ptr<KuduSession> session(client->NewSession());
+    RETURN_NOT_OK(session->SetFlushMode(KuduSession::AUTO_FLUSH_SYNC));
+    Random rng(GetRandomSeed32() + thread_idx);
+    Generator gen(Generator::MODE_RAND, rng.Next(), FLAGS_string_len);
+
+    // In open loop, the operations of a thread are scheduled at a fixed rate.
+    const bool open_loop = FLAGS_workload_target_ops_per_sec > 0;
+    const MonoDelta interval = open_loop ?
+        MonoDelta::FromSeconds(FLAGS_num_threads / FLAGS_workload_target_ops_per_sec) :
+        MonoDelta();
+    MonoTime scheduled = MonoTime::Now();
+    while (true) {
+      if (open_loop) {
+        const MonoTime now = MonoTime::Now();
+        if (scheduled > now) {
+          SleepFor(scheduled - now);
+        }
+      } else {
+        scheduled = MonoTime::Now();
+      }
+      if (scheduled >= deadline) {
+        break;
+      }
+      const double p = rng.NextDoubleFraction();
+      const auto it = std::find_if(ops.begin(), ops.end(),
+                                   [&](const pair<WorkloadOp, double>& e) {
+                                     return p < e.second;
+                                   });
+      const WorkloadOp op = it == ops.end() ? ops.back().first : it->first;
+      WorkloadOpStats& op_stats = (*stats)[static_cast<int>(op)];
+      Status s = RunWorkloadOp(op, key_chooser->Next(&rng), table, session, &gen);
+      op_stats.latency_us.Increment((MonoTime::Now() - scheduled).ToMicroseconds());
+      if (!s.ok()) {
+        op_stats.num_errors++;
+        if (session->CountPendingErrors() != 0) {
+          vector<KuduError*> errors;
+          ElementDeleter d(&errors);
+          session->GetPendingErrors(&errors, nullptr);
+        }
+      }
+      if (open_loop) {
+        scheduled += interval;
+      }
+    }
+    return Status::OK();
+  }();
+}
+
+Status CreateWorkloadTable(const shared_ptr<KuduClient>& client, string* table_name) {
+  ObjectIdGenerator oid_generator;
+  *table_name = Substitute("$0workload_auto_$1",
+      FLAGS_auto_database.empty() ? "" : FLAGS_auto_database + ".",
+      oid_generator.Next());
+  KuduSchema schema;
+  KuduSchemaBuilder b;
+  b.AddColumn("key")->Type(KuduColumnSchema::INT64)->NotNull()->PrimaryKey();
+  b.AddColumn("int_val")->Type(KuduColumnSchema::INT32);
+  b.AddColumn("string_val")->Type(KuduColumnSchema::STRING);
+  RETURN_NOT_OK(b.Build(&schema));
+
+  unique_ptr<KuduTableCreator> table_creator(client->NewTableCreator());
+  table_creator->table_name(*table_name)
+                .schema(&schema)
+                .add_hash_partitions({ "key" },
+                                     std::max(2, FLAGS_table_num_hash_partitions));
+  if (FLAGS_table_num_replicas > 0) {
+    table_creator->num_replicas(FLAGS_table_num_replicas);
+  }
+  return table_creator->Create();
+}
+
+Status RunWorkload(const RunnerContext& context) {
+  vector<pair<WorkloadOp, double>> ops;
+  RETURN_NOT_OK_PREPEND(ParseWorkloadOps(FLAGS_workload_ops, &ops),
+                        "invalid --workload_ops");
+  unique_ptr<KeyChooser> key_chooser;
+  RETURN_NOT_OK(NewKeyChooser(&key_chooser));
+
+  shared_ptr<KuduClient> client;
+  RETURN_NOT_OK(CreateKuduClient(context, &client));
+  string table_name = FLAGS_table_name;
+  const bool is_auto_table = table_name.empty();
+  if (is_auto_table) {
+    RETURN_NOT_OK(CreateWorkloadTable(client, &table_name));
+  }
+  cout << "Using " << (is_auto_table ? "auto-created " : "")
+       << "table '" << table_name << "'" << endl;
+  shared_ptr<KuduTable> table;
+  RETURN_NOT_OK(client->OpenTable(table_name, &table));
+  RETURN_NOT_OK(CheckWorkloadTable(*table));
+
+  const auto run_threads = [&](const std::function<void(int, Status*)>& f) {
+    vector<Status> statuses(FLAGS_num_threads);
+    vector<thread> threads;
+    for (int i = 0; i < FLAGS_num_threads; i++) {
+      threads.emplace_back(f, i, &statuses[i]);
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    for (const auto& s : statuses) {
+      RETURN_NOT_OK(s);
+    }
+    return Status::OK();
+  };
+
+  if (FLAGS_workload_load_rows) {
+    Stopwatch sw;
+    sw.start();
+    RETURN_NOT_OK(run_threads([&](int idx, Status* s) {
+      WorkloadLoadThread(client, table_name, idx, s);
+    }));
+    sw.stop();
+    cout << "Loaded " << FLAGS_workload_num_keys << " rows in "
+         << sw.elapsed().wall_millis() << " ms" << endl;
+  }
+
+  vector<WorkloadOpStats> stats(static_cast<int>(WorkloadOp::FULL_SCAN) + 1);
+  Stopwatch sw;
+  sw.start();
+  const MonoTime deadline =
+      MonoTime::Now() + MonoDelta::FromSeconds(FLAGS_workload_duration_sec);
+  RETURN_NOT_OK(run_threads([&](int idx, Status* s) {
+    WorkloadThread(client, table_name, ops, key_chooser.get(), idx, deadline, &stats, s);
+  }));
+  sw.stop();
+  const double elapsed_sec = sw.elapsed().wall_seconds();
+
+  int64_t total_errors = 0;
+  cout << endl << "Workload report" << endl
+       << "  time total: " << sw.elapsed().wall_millis() << " ms" << endl
+       << std::left << "  " << std::setw(10) << "op" << std::right
+       << std::setw(10) << "count" << std::setw(8) << "errors"
+       << std::setw(12) << "ops/sec" << std::setw(10) << "mean_us"
+       << std::setw(10) << "p50_us" << std::setw(10) << "p95_us"
+       << std::setw(10) << "p99_us" << std::setw(10) << "p99.9_us"
+       << std::setw(10) << "max_us" << endl;
+  for (const auto& e : ops) {
+    const WorkloadOpStats& op_stats = stats[static_cast<int>(e.first)];
+    const HdrHistogram& h = op_stats.latency_us;
+    total_errors += op_stats.num_errors;
+    cout << std::left << "  " << std::setw(10) << WorkloadOpToString(e.first) << std::right
+         << std::setw(10) << h.TotalCount() << std::setw(8) << op_stats.num_errors
+         << std::setw(12) << std::fixed << std::setprecision(1)
+         << (elapsed_sec > 0 ? h.TotalCount() / elapsed_sec : 0)
+         << std::setw(10) << std::setprecision(0) << h.MeanValue()
+         << std::setw(10) << h.ValueAtPercentile(50)
+         << std::setw(10) << h.ValueAtPercentile(95)
+         << std::setw(10) << h.ValueAtPercentile(99)
+         << std::setw(10) << h.ValueAtPercentile(99.9)
+         << std::setw(10) << h.MaxValue() << endl;
+  }
+
+  if (is_auto_table && !FLAGS_keep_auto_table) {
+    cout << "Dropping auto-created table '" << table_name << "'" << endl;
+    RETURN_NOT_OK(client->DeleteTable(table_name));
+  }
+  if (total_errors != 0) {
+    return Status::RuntimeError(
+        Substitute("Encountered $0 operation errors", total_errors));
+  }
+  return Status::OK();
+}
+
+// A server profiled by the 'profile' action.
+struct ProfiledServer {
+  // "master" or "tserver".
+  string role;
+  string uuid;
+  // The host:port of the server's web server.
+  string http_address;
+  // The base URL of the server's web server.
+  string url;
+
+  // The profile collected from the server and the symbols of its addresses.
+  PprofProfile profile;
+  unordered_map<uint64_t, string> symbols;
+  // The raw response of the server's profiling endpoint.
+  string raw_profile;
+  Status status;
+};
+
+// The maximum number of addresses per request to a server's /pprof/symbol.
+constexpr size_t kMaxAddressesPerSymbolRequest = 4096;
+
+// The number of functions listed in the profile reports.
+constexpr int kNumReportedFunctions = 50;
+
+// Adds the server of 'role' with the given UUID and registration to
+// 'servers', unless --profile_servers excludes it.
+void AddProfiledServer(const string& role,
+                       const string& uuid,
+                       const ServerRegistrationPB& reg,
+                       const vector<string>& patterns,
+                       vector<ProfiledServer>* servers) {
+  if (reg.http_addresses().empty()) {
+    LOG(WARNING) << Substitute("$0 $1 has no web server to profile", role, uuid);
+    return;
+  }
+  ProfiledServer server;
+  server.role = role;
+  server.uuid = uuid;
+  server.http_address = Substitute("$0:$1", reg.http_addresses(0).host(),
+                                   reg.http_addresses(0).port());
+  if (!MatchesAnyPattern(patterns, server.uuid) &&
+      !MatchesAnyPattern(patterns, server.http_address)) {
+    return;
+  }
+  server.url = Substitute("$0://$1", reg.https_enabled() ? "https" : "http",
+                          server.http_address);
+  servers->emplace_back(std::move(server));
+}
+
+// Lists the masters and the tablet servers of the cluster to profile.
+Status GetProfiledServers(const RunnerContext& context, vector<ProfiledServer>* servers) {
+  LeaderMasterProxy proxy;
+  RETURN_NOT_OK(proxy.Init(context));
+  const vector<string> patterns = strings::Split(FLAGS_profile_servers, ",",
+                                                 strings::SkipEmpty());
+  {
+    ListMastersRequestPB req;
+    ListMastersResponsePB resp;
+    RETURN_NOT_OK((proxy.SyncRpc<ListMastersRequestPB, ListMastersResponsePB>(
+        req, &resp, "ListMasters", &MasterServiceProxy::ListMastersAsync)));
+    if (resp.has_error()) {
+      return StatusFromPB(resp.error().status());
+    }
+    for (const auto& master : resp.masters()) {
+      if (master.has_error()) {
+        LOG(WARNING) << "Failed to retrieve info for master: "
+                     << StatusFromPB(master.error()).ToString();
+        continue;
+      }
+      AddProfiledServer("master", master.instance_id().permanent_uuid(),
+                        master.registration(), patterns, servers);
+    }
+  }
+  {
+    ListTabletServersRequestPB req;
+    ListTabletServersResponsePB resp;
+    RETURN_NOT_OK((proxy.SyncRpc<ListTabletServersRequestPB, ListTabletServersResponsePB>(
+        req, &resp, "ListTabletServers", &MasterServiceProxy::ListTabletServersAsync)));
+    if (resp.has_error()) {
+      return StatusFromPB(resp.error().status());
+    }
+    for (const auto& tserver : resp.servers()) {
+      AddProfiledServer("tserver", tserver.instance_id().permanent_uuid(),
+                        tserver.registration(), patterns, servers);
+    }
+  }
+  return Status::OK();
+}
+
+// Collects the profile of 'server' and symbolizes its addresses.
+Status CollectProfile(PprofProfile::Type type, ProfiledServer* server) {
+  EasyCurl curl;
+  // The certificates of the servers are signed by the cluster's CA, which
+  // the tool doesn't know about.
+  curl.set_verify_peer(false);
+  curl.set_timeout(MonoDelta::FromSeconds(FLAGS_profile_duration_sec + 60));
+
+  faststring buf;
+  RETURN_NOT_OK_PREPEND(
+      curl.FetchURL(Substitute("$0$1?seconds=$2", server->url,
+                               PprofProfile::EndpointPath(type), FLAGS_profile_duration_sec),
+                    &buf),
+      "unable to fetch the profile");
+  server->raw_profile = buf.ToString();
+  RETURN_NOT_OK_PREPEND(PprofProfile::Parse(type, server->raw_profile, &server->profile),
+                        "unable to parse the profile");
+
+  // The addresses are only meaningful in the server's process, which
+  // symbolizes them.
+  const vector<uint64_t> addresses = server->profile.Addresses();
+  for (size_t i = 0; i < addresses.size(); i += kMaxAddressesPerSymbolRequest) {
+    string req;
+    for (size_t j = i; j < std::min(addresses.size(), i + kMaxAddressesPerSymbolRequest); j++) {
+      SubstituteAndAppend(&req, "$0$1", req.empty() ? "" : "+", StringPrintf("0x%" PRIx64,
+                                                                             addresses[j]));
+    }
+    RETURN_NOT_OK_PREPEND(curl.PostToURL(server->url + "/pprof/symbol", req, &buf),
+                          "unable to symbolize the profile");
+    RETURN_NOT_OK_PREPEND(ParsePprofSymbols(buf.ToString(), &server->symbols),
+                          "unable to symbolize the profile");
+  }
+  return Status::OK();
+}
+
+// Writes the folded stacks, the flame graph and the report of 'graph' to
+// files of 'dir' named after 'basename'.
+Status WriteProfileFiles(Env* env, const string& dir, const string& basename,
+                         const string& title, const char* unit, const FlameGraph& graph) {
+  ostringstream folded;
+  graph.WriteFolded(&folded);
+  RETURN_NOT_OK(WriteStringToFile(env, folded.str(),
+                                  JoinPathSegments(dir, basename + ".folded")));
+  ostringstream svg;
+  graph.WriteSvg(title, unit, &svg);
+  RETURN_NOT_OK(WriteStringToFile(env, svg.str(), JoinPathSegments(dir, basename + ".svg")));
+  ostringstream report;
+  report << title << "\n\n";
+  graph.WriteTopFunctions(kNumReportedFunctions, unit, &report);
+  return WriteStringToFile(env, report.str(), JoinPathSegments(dir, basename + ".txt"));
+}
+
+Status ProfileCluster(const RunnerContext& context) {
+  PprofProfile::Type type;
+  RETURN_NOT_OK(PprofProfile::TypeFromString(FLAGS_profile_type, &type));
+  const char* const type_str = PprofProfile::TypeToString(type);
+  const char* const unit = PprofProfile::WeightUnit(type);
+
+  vector<ProfiledServer> servers;
+  RETURN_NOT_OK(GetProfiledServers(context, &servers));
+  if (servers.empty()) {
+    return Status::NotFound("no server to profile");
+  }
+
+  string dir = FLAGS_profile_output_dir;
+  if (dir.empty()) {
+    const time_t now = time(nullptr);
+    struct tm tm_now;
+    localtime_r(&now, &tm_now);
+    char time_str[32];
+    strftime(time_str, sizeof(time_str), "%Y%m%d-%H%M%S", &tm_now);
+    dir = Substitute("kudu-$0-profile-$1", type_str, time_str);
+  }
+  Env* env = Env::Default();
+  RETURN_NOT_OK_PREPEND(env_util::CreateDirIfMissing(env, dir),
+                        "unable to create the output directory");
+
+  cout << Substitute("Collecting $0 profiles from $1 servers", type_str, servers.size());
+  if (type != PprofProfile::HEAP) {
+    cout << Substitute(" for $0 seconds", FLAGS_profile_duration_sec);
+  }
+  cout << endl;
+
+  // The servers are all profiled at the same time.
+  vector<thread> threads;
+  for (auto& server : servers) {
+    threads.emplace_back([type, &server]() {
+      server.status = CollectProfile(type, &server);
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  // Every server gets its own files, and the stacks of all of them are
+  // merged by role into the cluster-wide ones.
+  FlameGraph cluster_graph;
+  int num_failed = 0;
+  DataTable table({ "role", "uuid", "http address", Substitute("total $0", unit), "status" });
+  for (auto& server : servers) {
+    const string basename = Substitute("$0-$1.$2", server.role, server.uuid, type_str);
+    string total;
+    if (server.status.ok()) {
+      server.status = WriteStringToFile(env, server.raw_profile,
+                                        JoinPathSegments(dir, basename + ".prof"));
+    }
+    if (server.status.ok()) {
+      FlameGraph graph;
+      server.profile.AddToFlameGraph(server.symbols, "", &graph);
+      server.status = WriteProfileFiles(
+          env, dir, basename,
+          Substitute("$0 profile of $1 $2 ($3)", type_str, server.role, server.uuid,
+                     server.http_address),
+          unit, graph);
+      server.profile.AddToFlameGraph(server.symbols, "kudu-" + server.role, &cluster_graph);
+      total = std::to_string(graph.total_weight());
+    }
+    if (!server.status.ok()) {
+      num_failed++;
+    }
+    table.AddRow({ server.role, server.uuid, server.http_address, total,
+                   server.status.ToString() });
+  }
+  RETURN_NOT_OK(WriteProfileFiles(
+      env, dir, Substitute("cluster.$0", type_str),
+      Substitute("$0 profile of $1 servers", type_str, servers.size() - num_failed),
+      unit, cluster_graph));
+
+  RETURN_NOT_OK(table.PrintTo(cout));
+  cout << "Profiles written to " << dir << endl;
+  if (num_failed > 0) {
+    return Status::RuntimeError(
+        Substitute("failed to profile $0 of $1 servers", num_failed, servers.size()));
+  }
+  return Status::OK();
+}
+
 } // anonymous namespace
 
 unique_ptr<Mode> BuildPerfMode() {
@@ -746,6 +1571,25 @@ unique_ptr<Mode> BuildPerfMode() {
       .AddOptionalParameter("use_random")
       .Build();
 
+  unique_ptr<Action> profile =
+      ActionBuilder("profile", &ProfileCluster)
+      .Description("Collect a profile from the servers of a cluster")
+      .ExtraDescription(
+          "Collect a CPU, heap or lock contention profile from all or some "
+          "of the masters and tablet servers of a cluster at the same time, "
+          "through their /pprof endpoints. The profiles are symbolized by "
+          "the servers, and written to the output directory along with a "
+          "flame graph, the folded stacks and a report of the heaviest "
+          "functions of every server, and of all the servers merged by "
+          "role. The servers must be built with tcmalloc to collect CPU "
+          "and heap profiles.")
+      .AddRequiredParameter({ kMasterAddressesArg, kMasterAddressesArgDesc })
+      .AddOptionalParameter("profile_duration_sec")
+      .AddOptionalParameter("profile_output_dir")
+      .AddOptionalParameter("profile_servers")
+      .AddOptionalParameter("profile_type")
+      .Build();
+
   unique_ptr<Action> table_scan =
       ActionBuilder("table_scan", &TableScan)
       .Description("Show row count and scanning time cost of tablets in a table")
@@ -761,10 +1605,50 @@ unique_ptr<Mode> BuildPerfMode() {
       .AddOptionalParameter("tablets")
       .Build();
 
+  unique_ptr<Action> workload =
+      ActionBuilder("workload", &RunWorkload)
+      .Description("Run a mixed workload of reads, writes and scans")
+      .ExtraDescription(
+          "Run a workload made of a mix of point reads, upserts, updates, "
+          "short-range scans and full scans of an existing or auto-created "
+          "table, with keys following a configurable distribution, and "
+          "report the latency percentiles of every type of operation. "
+          "The table's primary key must be a single INT64 column, whose "
+          "values are 0..(--workload_num_keys - 1). The rows are upserted "
+          "into the table before the workload is run, unless "
+          "--workload_load_rows=false.")
+      .AddRequiredParameter({ kMasterAddressesArg, kMasterAddressesArgDesc })
+      .AddOptionalParameter("auto_database")
+      .AddOptionalParameter("buffer_size_bytes")
+      .AddOptionalParameter("keep_auto_table")
+      .AddOptionalParameter("num_threads")
+      .AddOptionalParameter("string_fixed")
+      .AddOptionalParameter("string_len")
+      .AddOptionalParameter("table_name", boost::none, string(
+          "Name of an existing table to run the workload against. If left "
+          "empty, a table with pre-defined columnar structure and a unique "
+          "name is created, and dropped at the end of the run unless "
+          "overridden by the '--keep_auto_table' flag."))
+      .AddOptionalParameter("table_num_hash_partitions")
+      .AddOptionalParameter("table_num_replicas")
+      .AddOptionalParameter("workload_duration_sec")
+      .AddOptionalParameter("workload_hotspot_keys_fraction")
+      .AddOptionalParameter("workload_hotspot_ops_fraction")
+      .AddOptionalParameter("workload_key_distribution")
+      .AddOptionalParameter("workload_load_rows")
+      .AddOptionalParameter("workload_num_keys")
+      .AddOptionalParameter("workload_ops")
+      .AddOptionalParameter("workload_scan_length")
+      .AddOptionalParameter("workload_target_ops_per_sec")
+      .AddOptionalParameter("workload_zipfian_theta")
+      .Build();
+
   return ModeBuilder("perf")
       .Description("Measure the performance of a Kudu cluster")
       .AddAction(std::move(loadgen))
+      .AddAction(std::move(profile))
       .AddAction(std::move(table_scan))
+      .AddAction(std::move(workload))
       .Build();
 }
 
@@ -492,6 +492,7 @@ unique_ptr<Mode> BuildTableMode() {
       .AddOptionalParameter("fill_cache")
       .AddOptionalParameter("num_threads")
       .AddOptionalParameter("predicates")
+      .AddOptionalParameter("split_size_bytes")
       .AddOptionalParameter("tablets")
       .Build();
 
@@ -514,6 +515,7 @@ unique_ptr<Mode> BuildTableMode() {
       .AddOptionalParameter("dst_table")
       .AddOptionalParameter("num_threads")
       .AddOptionalParameter("predicates")
+      .AddOptionalParameter("split_size_bytes")
       .AddOptionalParameter("tablets")
       .AddOptionalParameter("write_type")
       .Build();
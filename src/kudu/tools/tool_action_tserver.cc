@@ -23,24 +23,38 @@
 #include <vector>
 
 #include <boost/algorithm/string/predicate.hpp>
+#include <gflags/gflags.h>
 #include <gflags/gflags_declare.h>
+#include <google/protobuf/repeated_field.h>
 
 #include "kudu/common/common.pb.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/gutil/map-util.h"
+#include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/stringpiece.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/master.pb.h"
 #include "kudu/master/master.proxy.h"
+#include "kudu/rpc/rpc_controller.h"
 #include "kudu/tools/tool_action.h"
 #include "kudu/tools/tool_action_common.h"
 #include "kudu/tserver/tablet_server.h"
+#include "kudu/tserver/tserver_admin.pb.h"
+#include "kudu/tserver/tserver_admin.proxy.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 
 DECLARE_string(columns);
+DECLARE_int64(timeout_ms);
+
+DEFINE_int32(max_hot_tablets, 10,
+             "The maximum number of the hottest tablet replicas to list.");
+DEFINE_int32(max_hot_keys, 3,
+             "The maximum number of hot written keys, and of hot read keys, to "
+             "list per tablet replica.");
 
 using std::cout;
 using std::string;
@@ -52,6 +66,11 @@ namespace kudu {
 using master::ListTabletServersRequestPB;
 using master::ListTabletServersResponsePB;
 using master::MasterServiceProxy;
+using rpc::RpcController;
+using tserver::GetHotTabletsRequestPB;
+using tserver::GetHotTabletsResponsePB;
+using tserver::HotTabletPB;
+using tserver::TabletServerAdminServiceProxy;
 
 namespace tools {
 namespace {
@@ -161,6 +180,44 @@ Status TserverDumpMemTrackers(const RunnerContext& context) {
   return DumpMemTrackers(address, tserver::TabletServer::kDefaultPort);
 }
 
+string HotKeysToString(const google::protobuf::RepeatedPtrField<HotTabletPB::HotKeyPB>& keys) {
+  vector<string> key_strs;
+  for (const auto& key : keys) {
+    key_strs.emplace_back(StringPrintf("%s (%.1f%%)", key.key().c_str(), key.share() * 100));
+  }
+  return JoinStrings(key_strs, ", ");
+}
+
+Status TServerHotTablets(const RunnerContext& context) {
+  const string& address = FindOrDie(context.required_args, kTServerAddressArg);
+  unique_ptr<TabletServerAdminServiceProxy> proxy;
+  RETURN_NOT_OK(BuildProxy(address, tserver::TabletServer::kDefaultPort, &proxy));
+
+  GetHotTabletsRequestPB req;
+  GetHotTabletsResponsePB resp;
+  RpcController rpc;
+  rpc.set_timeout(MonoDelta::FromMilliseconds(FLAGS_timeout_ms));
+  req.set_max_tablets(FLAGS_max_hot_tablets);
+  req.set_max_keys_per_tablet(FLAGS_max_hot_keys);
+  RETURN_NOT_OK_PREPEND(proxy->GetHotTablets(req, &resp, &rpc),
+                        "GetHotTablets() failed");
+  if (resp.has_error()) {
+    return StatusFromPB(resp.error().status());
+  }
+
+  DataTable table({ "tablet id", "table name", "rows written/s", "rows read/s",
+                    "hot written keys", "hot read keys" });
+  for (const auto& tablet : resp.tablets()) {
+    table.AddRow({ tablet.tablet_id(),
+                   tablet.table_name(),
+                   StringPrintf("%.1f", tablet.rows_written_per_sec()),
+                   StringPrintf("%.1f", tablet.rows_read_per_sec()),
+                   HotKeysToString(tablet.written_keys()),
+                   HotKeysToString(tablet.read_keys()) });
+  }
+  return table.PrintTo(cout);
+}
+
 } // anonymous namespace
 
 unique_ptr<Mode> BuildTServerMode() {
@@ -181,6 +238,22 @@ unique_ptr<Mode> BuildTServerMode() {
       .AddOptionalParameter("flag_tags")
       .Build();
 
+  unique_ptr<Action> hot_tablets =
+      ActionBuilder("hot_tablets", &TServerHotTablets)
+      .Description("List the hottest tablet replicas of a Kudu Tablet Server")
+      .ExtraDescription("The tablet replicas are listed by the sum of the rates "
+                        "of the rows written to and read from them over the "
+                        "last --hot_spots_window_sec seconds, the hottest first. "
+                        "Their hot keys are the sampled primary keys they are "
+                        "written and read at the most, with the estimated share "
+                        "of the operations on each.")
+      .AddRequiredParameter({ kTServerAddressArg, kTServerAddressDesc })
+      .AddOptionalParameter("format")
+      .AddOptionalParameter("max_hot_keys")
+      .AddOptionalParameter("max_hot_tablets")
+      .AddOptionalParameter("timeout_ms")
+      .Build();
+
   unique_ptr<Action> set_flag =
       ActionBuilder("set_flag", &TServerSetFlag)
       .Description("Change a gflag value on a Kudu Tablet Server")
@@ -219,6 +292,7 @@ unique_ptr<Mode> BuildTServerMode() {
       .Description("Operate on a Kudu Tablet Server")
       .AddAction(std::move(dump_memtrackers))
       .AddAction(std::move(get_flags))
+      .AddAction(std::move(hot_tablets))
       .AddAction(std::move(set_flag))
       .AddAction(std::move(status))
       .AddAction(std::move(timestamp))
@@ -24,6 +24,7 @@
 #include <ostream>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -31,10 +32,14 @@
 #include <gflags/gflags.h>
 #include <gflags/gflags_declare.h>
 #include <glog/logging.h>
+#include <google/protobuf/repeated_field.h>
+#include <google/protobuf/util/message_differencer.h>
 
 #include "kudu/common/wire_protocol.h"
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/consensus/replica_management.pb.h"
+#include "kudu/fs/data_dirs.h"
+#include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
@@ -42,6 +47,7 @@
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/master.pb.h"
 #include "kudu/master/master.proxy.h"
+#include "kudu/rpc/messenger.h"
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/security/cert.h"
@@ -51,17 +57,23 @@
 #include "kudu/security/token_verifier.h"
 #include "kudu/server/rpc_server.h"
 #include "kudu/server/webserver.h"
+#include "kudu/tablet/tablet.h"
+#include "kudu/tablet/tablet_replica.h"
 #include "kudu/tserver/tablet_server.h"
 #include "kudu/tserver/ts_tablet_manager.h"
 #include "kudu/util/condition_variable.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/env.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/maintenance_manager.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/mutex.h"
+#include "kudu/util/net/dns_resolver.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/pb_util.h"
+#include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/status.h"
 #include "kudu/util/thread.h"
 #include "kudu/util/trace.h"
@@ -99,18 +111,40 @@ DEFINE_uint32(heartbeat_inject_required_feature_flag, 0,
 TAG_FLAG(heartbeat_inject_required_feature_flag, runtime);
 TAG_FLAG(heartbeat_inject_required_feature_flag, unsafe);
 
+DEFINE_bool(heartbeat_coordinate_compactions, false,
+            "Whether to report the heavy compactions, i.e. the rowset and major "
+            "delta compactions, of the tablet replicas to the leader master in "
+            "the heartbeats, and to defer them when the master asks to. The "
+            "master then staggers them across the replicas of each tablet, so "
+            "that the other replicas remain available for low-latency reads.");
+TAG_FLAG(heartbeat_coordinate_compactions, experimental);
+TAG_FLAG(heartbeat_coordinate_compactions, runtime);
+
+DEFINE_bool(heartbeat_send_tablet_report_deltas, true,
+            "Whether to send the tablet reports as deltas relative to the "
+            "tablets acknowledged by the masters which keep them, omitting "
+            "the unchanged consensus states and, from the full reports sent "
+            "when a master is elected leader, the unchanged tablets.");
+TAG_FLAG(heartbeat_send_tablet_report_deltas, advanced);
+TAG_FLAG(heartbeat_send_tablet_report_deltas, runtime);
+
 DECLARE_bool(raft_prepare_replacement_before_eviction);
 
+using google::protobuf::util::MessageDifferencer;
 using kudu::consensus::ReplicaManagementInfoPB;
 using kudu::master::MasterErrorPB;
 using kudu::master::MasterFeatures;
 using kudu::master::MasterServiceProxy;
+using kudu::master::ReportedTabletPB;
 using kudu::master::TabletReportPB;
 using kudu::pb_util::SecureDebugString;
 using kudu::rpc::ErrorStatusPB;
 using kudu::rpc::RpcController;
+using kudu::tablet::Tablet;
+using kudu::tablet::TabletReplica;
 using std::shared_ptr;
 using std::string;
+using std::unordered_set;
 using std::vector;
 using strings::Substitute;
 
@@ -129,7 +163,7 @@ Status MasterServiceProxyForHostPort(const HostPort& hostport,
                                      const shared_ptr<rpc::Messenger>& messenger,
                                      gscoped_ptr<MasterServiceProxy>* proxy) {
   vector<Sockaddr> addrs;
-  RETURN_NOT_OK(hostport.ResolveAddresses(&addrs));
+  RETURN_NOT_OK(messenger->dns_resolver()->ResolveAddresses(hostport, &addrs));
   if (addrs.size() > 1) {
     LOG(WARNING) << "Master address '" << hostport.ToString() << "' "
                  << "resolves to " << addrs.size() << " different addresses. Using "
@@ -161,6 +195,27 @@ class Heartbeater::Thread {
   // tablets which have not changed since the acknowledged report.
   void MarkTabletReportAcknowledged(const TabletReportPB& report);
 
+  // Turn 'report' into a delta relative to the tablets acknowledged by the
+  // master, if it keeps them.
+  void MakeTabletReportDelta(TabletReportPB* report) const;
+
+  // Update the tablets acknowledged by the master from the response 'resp'
+  // to the heartbeat with the tablet report 'report', before it was turned
+  // into a delta.
+  void UpdateAckedTablets(const TabletReportPB& report,
+                          const master::TSHeartbeatResponsePB& resp);
+
+  // Report the tablet replicas which are running heavy compactions or have
+  // some worth running.
+  void GenerateCompactionReport(master::CompactionReportPB* report);
+
+  // Report the server's disk usage and maintenance backlog.
+  void GenerateLoadReport(master::TServerLoadPB* load);
+
+  // Defer the heavy compactions of the replicas as the leader master asks in
+  // 'resp', and allow them on the other replicas.
+  void DeferCompactions(const master::TSHeartbeatResponsePB& resp);
+
  private:
   void RunThread();
   Status ConnectToMaster();
@@ -216,6 +271,19 @@ class Heartbeater::Thread {
   // Next tablet report seqno.
   std::atomic_int next_report_seq_;
 
+  // The tablets as reported in the tablet reports acknowledged by the master,
+  // keyed by tablet ID, if it keeps the tablets reported by this server. The
+  // master may also have merged the reports of failed heartbeats, so the
+  // tablets of those are in 'unacked_tablet_ids_' until reported again.
+  //
+  // Only accessed by the heartbeater thread.
+  std::unordered_map<std::string, ReportedTabletPB> acked_tablets_;
+  std::unordered_set<std::string> unacked_tablet_ids_;
+
+  // The sequence number of the last tablet report acknowledged by the master,
+  // or -1 if it doesn't keep the tablets reported by this server.
+  int32_t acked_report_seq_;
+
   // Mutex/condition pair to trigger the heartbeater thread
   // to either heartbeat early or exit.
   Mutex mutex_;
@@ -325,6 +393,7 @@ Heartbeater::Thread::Thread(HostPort master_address, TabletServer* server)
     server_(server),
     consecutive_failed_heartbeats_(0),
     next_report_seq_(0),
+    acked_report_seq_(-1),
     cond_(&mutex_),
     should_run_(false),
     heartbeat_asap_(true),
@@ -358,6 +427,10 @@ Status Heartbeater::Thread::SetupRegistration(ServerRegistrationPB* reg) {
   RETURN_NOT_OK(CHECK_NOTNULL(server_->rpc_server())->GetAdvertisedAddresses(&addrs));
   RETURN_NOT_OK_PREPEND(AddHostPortPBs(addrs, reg->mutable_rpc_addresses()),
                         "Failed to add RPC addresses to registration");
+  const string& uds_path = server_->rpc_server()->unix_domain_socket_path();
+  if (!uds_path.empty()) {
+    reg->set_unix_domain_socket_path(uds_path);
+  }
 
   addrs.clear();
   if (server_->web_server()) {
@@ -463,28 +536,49 @@ Status Heartbeater::Thread::DoHeartbeat(MasterErrorPB* error,
   // send us knew ones if they exist.
   req.set_latest_tsk_seq_num(server_->token_verifier().GetMaxKnownKeySequenceNumber());
 
-  if (send_full_tablet_report_) {
+  // The report as generated, before it's turned into a delta.
+  TabletReportPB report;
+  if (last_hb_response_.needs_full_tablet_report()) {
+    LOG(INFO) << Substitute(
+        "Master $0 requested a full tablet report, sending...",
+        master_address_.ToString());
+    GenerateFullTabletReport(&report);
+    *req.mutable_tablet_report() = report;
+  } else if (send_full_tablet_report_) {
     LOG(INFO) << Substitute(
         "Master $0 was elected leader, sending a full tablet report...",
         master_address_.ToString());
-    GenerateFullTabletReport(req.mutable_tablet_report());
+    GenerateFullTabletReport(&report);
     // Should the heartbeat fail, we'd want the next heartbeat to resend this
     // full tablet report. As such, send_full_tablet_report_ is only reset
     // after all error checking is complete.
-  } else if (last_hb_response_.needs_full_tablet_report()) {
-    LOG(INFO) << Substitute(
-        "Master $0 requested a full tablet report, sending...",
-        master_address_.ToString());
-    GenerateFullTabletReport(req.mutable_tablet_report());
+    *req.mutable_tablet_report() = report;
+    MakeTabletReportDelta(req.mutable_tablet_report());
   } else {
     VLOG(2) << Substitute("Sending an incremental tablet report to master $0...",
                           master_address_.ToString());
-    GenerateIncrementalTabletReport(req.mutable_tablet_report());
+    GenerateIncrementalTabletReport(&report);
+    *req.mutable_tablet_report() = report;
+    MakeTabletReportDelta(req.mutable_tablet_report());
   }
   req.set_num_live_tablets(server_->tablet_manager()->GetNumLiveTablets());
+  GenerateLoadReport(req.mutable_load());
+  if (FLAGS_heartbeat_coordinate_compactions) {
+    GenerateCompactionReport(req.mutable_compaction_report());
+  }
 
   VLOG(2) << "Sending heartbeat:\n" << SecureDebugString(req);
   master::TSHeartbeatResponsePB resp;
+  // If the heartbeat fails, the master may or may not have merged the report,
+  // so the state of the tablets it lists is unknown at the master.
+  auto unacked_cleanup = MakeScopedCleanup([&]() {
+    for (const auto& tablet : req.tablet_report().updated_tablets()) {
+      unacked_tablet_ids_.insert(tablet.tablet_id());
+    }
+    for (const auto& tablet_id : req.tablet_report().removed_tablet_ids()) {
+      unacked_tablet_ids_.insert(tablet_id);
+    }
+  });
   const auto& s = proxy_->TSHeartbeat(req, &resp, &rpc);
   if (!s.ok()) {
     if (rpc.error_response()) {
@@ -496,6 +590,8 @@ Status Heartbeater::Thread::DoHeartbeat(MasterErrorPB* error,
     error->Swap(resp.mutable_error());
     return StatusFromPB(error->status());
   }
+  unacked_cleanup.cancel();
+  UpdateAckedTablets(report, resp);
 
   VLOG(2) << Substitute("Received heartbeat response from $0:\n$1",
                         master_address_.ToString(), SecureDebugString(resp));
@@ -540,10 +636,83 @@ Status Heartbeater::Thread::DoHeartbeat(MasterErrorPB* error,
         "failed to import token signing public keys from master heartbeat");
   }
 
+  // Only the leader master coordinates the compactions.
+  if (req.has_compaction_report() && last_hb_response_.leader_master()) {
+    DeferCompactions(last_hb_response_);
+  }
+
   MarkTabletReportAcknowledged(req.tablet_report());
   return Status::OK();
 }
 
+void Heartbeater::Thread::GenerateCompactionReport(master::CompactionReportPB* report) {
+  vector<scoped_refptr<TabletReplica>> replicas;
+  server_->tablet_manager()->GetTabletReplicas(&replicas);
+  for (const auto& replica : replicas) {
+    shared_ptr<Tablet> tablet = replica->shared_tablet();
+    if (!tablet) {
+      continue;
+    }
+    const bool compacting = tablet->IsHeavyCompactionRunning();
+    const bool has_backlog = tablet->HasHeavyCompactionBacklog();
+    if (compacting || has_backlog) {
+      auto* tablet_pb = report->add_tablets();
+      tablet_pb->set_tablet_id(replica->tablet_id());
+      tablet_pb->set_compacting(compacting);
+      tablet_pb->set_has_backlog(has_backlog);
+    }
+  }
+}
+
+void Heartbeater::Thread::GenerateLoadReport(master::TServerLoadPB* load) {
+  FsManager* fs_manager = server_->fs_manager();
+  int64_t capacity_bytes = 0;
+  int64_t available_bytes = 0;
+  int num_full = 0;
+  const auto& data_dirs = fs_manager->dd_manager()->data_dirs();
+  for (const auto& dd : data_dirs) {
+    if (dd->is_full()) {
+      num_full++;
+    }
+    // Data directories sharing a filesystem are counted once per directory,
+    // which leaves the used fraction of the total unchanged.
+    SpaceInfo space_info;
+    Status s = fs_manager->env()->GetSpaceInfo(dd->dir(), &space_info);
+    if (PREDICT_FALSE(!s.ok())) {
+      KLOG_EVERY_N_SECS(WARNING, 60) << Substitute(
+          "Could not get space info of data directory $0: $1",
+          dd->dir(), s.ToString());
+      continue;
+    }
+    capacity_bytes += space_info.capacity_bytes;
+    available_bytes += space_info.free_bytes;
+  }
+  load->set_num_data_dirs(data_dirs.size());
+  load->set_num_full_data_dirs(num_full);
+  load->set_data_dirs_capacity_bytes(capacity_bytes);
+  load->set_data_dirs_available_bytes(available_bytes);
+  load->set_maintenance_backlog_ops(server_->maintenance_manager()->num_backlog_ops());
+}
+
+void Heartbeater::Thread::DeferCompactions(const master::TSHeartbeatResponsePB& resp) {
+  const unordered_set<string> deferred_tablet_ids(
+      resp.compaction_deferred_tablet_ids().begin(),
+      resp.compaction_deferred_tablet_ids().end());
+  // The deferral lasts a few heartbeats, so that the compactions aren't
+  // deferred forever if the master stops responding.
+  const MonoTime deadline =
+      MonoTime::Now() + MonoDelta::FromMilliseconds(3 * FLAGS_heartbeat_interval_ms);
+  vector<scoped_refptr<TabletReplica>> replicas;
+  server_->tablet_manager()->GetTabletReplicas(&replicas);
+  for (const auto& replica : replicas) {
+    shared_ptr<Tablet> tablet = replica->shared_tablet();
+    if (tablet) {
+      tablet->DeferHeavyCompactionsUntil(
+          ContainsKey(deferred_tablet_ids, replica->tablet_id()) ? deadline : MonoTime());
+    }
+  }
+}
+
 void Heartbeater::Thread::RunThread() {
   CHECK(IsCurrentThread());
   VLOG(1) << Substitute("Heartbeat thread (master $0) starting",
@@ -694,6 +863,77 @@ void Heartbeater::Thread::MarkTabletDirty(const string& tablet_id, const string&
   }
 }
 
+void Heartbeater::Thread::MakeTabletReportDelta(TabletReportPB* report) const {
+  if (!FLAGS_heartbeat_send_tablet_report_deltas || acked_report_seq_ < 0) {
+    return;
+  }
+  report->set_base_sequence_number(acked_report_seq_);
+  const bool full = !report->is_incremental();
+  unordered_set<string> reported_tablet_ids;
+  google::protobuf::RepeatedPtrField<ReportedTabletPB> tablets;
+  tablets.Swap(report->mutable_updated_tablets());
+  for (auto& tablet : tablets) {
+    const string& tablet_id = tablet.tablet_id();
+    if (full) {
+      reported_tablet_ids.insert(tablet_id);
+    }
+    const ReportedTabletPB* acked = ContainsKey(unacked_tablet_ids_, tablet_id) ?
+        nullptr : FindOrNull(acked_tablets_, tablet_id);
+    if (acked) {
+      if (full && MessageDifferencer::Equals(tablet, *acked)) {
+        // The master knows the tablet as it is.
+        continue;
+      }
+      if (tablet.has_consensus_state() && acked->has_consensus_state() &&
+          MessageDifferencer::Equals(tablet.consensus_state(), acked->consensus_state())) {
+        tablet.clear_consensus_state();
+        tablet.set_consensus_state_unchanged(true);
+      }
+    }
+    report->add_updated_tablets()->Swap(&tablet);
+  }
+  if (full) {
+    // Report the removal of the tablets the master may know of.
+    for (const auto& e : acked_tablets_) {
+      if (!ContainsKey(reported_tablet_ids, e.first)) {
+        report->add_removed_tablet_ids(e.first);
+      }
+    }
+    for (const auto& tablet_id : unacked_tablet_ids_) {
+      if (!ContainsKey(reported_tablet_ids, tablet_id) &&
+          !ContainsKey(acked_tablets_, tablet_id)) {
+        report->add_removed_tablet_ids(tablet_id);
+      }
+    }
+  }
+}
+
+void Heartbeater::Thread::UpdateAckedTablets(const TabletReportPB& report,
+                                             const master::TSHeartbeatResponsePB& resp) {
+  if (!resp.has_acked_tablet_report_sequence_number()) {
+    // The master doesn't keep the reported tablets, e.g. because it needs a
+    // full tablet report or doesn't support deltas.
+    acked_tablets_.clear();
+    unacked_tablet_ids_.clear();
+    acked_report_seq_ = -1;
+    return;
+  }
+  DCHECK_EQ(report.sequence_number(), resp.acked_tablet_report_sequence_number());
+  if (!report.is_incremental()) {
+    acked_tablets_.clear();
+    unacked_tablet_ids_.clear();
+  }
+  for (const auto& tablet : report.updated_tablets()) {
+    acked_tablets_[tablet.tablet_id()] = tablet;
+    unacked_tablet_ids_.erase(tablet.tablet_id());
+  }
+  for (const auto& tablet_id : report.removed_tablet_ids()) {
+    acked_tablets_.erase(tablet_id);
+    unacked_tablet_ids_.erase(tablet_id);
+  }
+  acked_report_seq_ = resp.acked_tablet_report_sequence_number();
+}
+
 void Heartbeater::Thread::GenerateIncrementalTabletReport(TabletReportPB* report) {
   report->Clear();
   report->set_sequence_number(next_report_seq_.fetch_add(1));
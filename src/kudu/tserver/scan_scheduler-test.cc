@@ -0,0 +1,132 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/tserver/scan_scheduler.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kudu/util/monotime.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+using std::string;
+using std::thread;
+using std::unique_ptr;
+using std::unordered_map;
+using std::vector;
+
+namespace kudu {
+namespace tserver {
+
+class ScanSchedulerTest : public KuduTest {
+ protected:
+  static MonoTime Deadline() {
+    return MonoTime::Now() + MonoDelta::FromSeconds(30);
+  }
+};
+
+TEST_F(ScanSchedulerTest, TestBudget) {
+  ScanScheduler scheduler(2);
+  unique_ptr<ScanScheduler::Slot> s1, s2, s3;
+  ASSERT_OK(scheduler.Admit("a", Deadline(), &s1));
+  ASSERT_OK(scheduler.Admit("b", Deadline(), &s2));
+  ASSERT_EQ(2, scheduler.num_running());
+
+  // The budget is used up: the request isn't admitted in time.
+  Status s = scheduler.Admit("a", MonoTime::Now() + MonoDelta::FromMilliseconds(10), &s3);
+  ASSERT_TRUE(s.IsServiceUnavailable()) << s.ToString();
+  ASSERT_FALSE(s3);
+  ASSERT_EQ(0, scheduler.num_waiting());
+
+  // A released slot is granted to a waiter.
+  thread t([&]() {
+    CHECK_OK(scheduler.Admit("a", Deadline(), &s3));
+  });
+  ASSERT_EVENTUALLY([&]() {
+    ASSERT_EQ(1, scheduler.num_waiting());
+  });
+  s1.reset();
+  t.join();
+  ASSERT_TRUE(s3);
+  ASSERT_EQ(2, scheduler.num_running());
+  ASSERT_EQ(0, scheduler.num_waiting());
+  s2.reset();
+  s3.reset();
+  ASSERT_EQ(0, scheduler.num_running());
+}
+
+// Requests of a tenant which used little scan time are admitted ahead of the
+// requests of a tenant which used more, even if they arrived later.
+TEST_F(ScanSchedulerTest, TestFairness) {
+  ScanScheduler scheduler(1);
+  unique_ptr<ScanScheduler::Slot> slot;
+  ASSERT_OK(scheduler.Admit("big", Deadline(), &slot));
+
+  std::mutex lock;
+  vector<string> admitted;
+  vector<thread> threads;
+  const auto start_waiter = [&](const string& tenant, int num_waiting) {
+    threads.emplace_back([&, tenant]() {
+      unique_ptr<ScanScheduler::Slot> s;
+      CHECK_OK(scheduler.Admit(tenant, Deadline(), &s));
+      std::lock_guard<std::mutex> l(lock);
+      admitted.push_back(tenant);
+    });
+    ASSERT_EVENTUALLY([&]() {
+      ASSERT_EQ(num_waiting, scheduler.num_waiting());
+    });
+  };
+  NO_FATALS(start_waiter("big", 1));
+  NO_FATALS(start_waiter("big", 2));
+  NO_FATALS(start_waiter("small", 3));
+
+  SleepFor(MonoDelta::FromMilliseconds(10));
+  slot.reset();
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(vector<string>({ "small", "big", "big" }), admitted);
+}
+
+TEST_F(ScanSchedulerTest, TestParseTenantWeights) {
+  unordered_map<string, double> weights;
+  ASSERT_OK(ScanScheduler::ParseTenantWeights("", &weights));
+  ASSERT_TRUE(weights.empty());
+  ASSERT_OK(ScanScheduler::ParseTenantWeights(
+      "etl:0.5, dashboards:4,user/host@REALM:2", &weights));
+  ASSERT_EQ(3, weights.size());
+  ASSERT_EQ(0.5, weights["etl"]);
+  ASSERT_EQ(4, weights["dashboards"]);
+  ASSERT_EQ(2, weights["user/host@REALM"]);
+
+  for (const auto& spec : { "etl", "etl:", ":1", "etl:x", "etl:0", "etl:-1", "etl:1,etl:2" }) {
+    Status s = ScanScheduler::ParseTenantWeights(spec, &weights);
+    ASSERT_TRUE(s.IsInvalidArgument()) << spec << ": " << s.ToString();
+  }
+  // The weights aren't changed on failure.
+  ASSERT_EQ(3, weights.size());
+}
+
+} // namespace tserver
+} // namespace kudu
@@ -0,0 +1,286 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/tserver/scan_scheduler.h"
+
+#include <algorithm>
+#include <ostream>
+#include <utility>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/bind.h"
+#include "kudu/gutil/bind_helpers.h"
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/strip.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/sysinfo.h"
+#include "kudu/util/flag_tags.h"
+
+DEFINE_int32(scan_scheduler_max_concurrent_scans, 0,
+             "Maximum number of scan requests a tablet server serves at a "
+             "time. Further scan requests wait for a slot, and slots are "
+             "granted fairly across the tenants defined by "
+             "--scan_scheduler_fairness. If 0, the budget is the number of "
+             "CPUs plus the number of data directories. If negative, scan "
+             "requests aren't scheduled.");
+TAG_FLAG(scan_scheduler_max_concurrent_scans, experimental);
+
+DEFINE_int32(scan_scheduler_max_wait_ms, 100,
+             "Maximum time a scan request waits for a slot before it's "
+             "rejected and retried by the client. This bounds the time "
+             "service threads are kept from serving requests other than "
+             "scans.");
+TAG_FLAG(scan_scheduler_max_wait_ms, experimental);
+TAG_FLAG(scan_scheduler_max_wait_ms, runtime);
+
+DEFINE_string(scan_scheduler_fairness, "user",
+              "The tenants scan requests are fairly scheduled across. Must be "
+              "one of 'user' or 'table'.");
+TAG_FLAG(scan_scheduler_fairness, experimental);
+DEFINE_validator(scan_scheduler_fairness, [](const char* /* flag_name */,
+                                              const std::string& value) {
+    if (value == "user" || value == "table") {
+      return true;
+    }
+    LOG(ERROR) << "unknown value for 'scan_scheduler_fairness': '" << value << "'"
+               << " (expected one of 'user' or 'table')";
+    return false;
+  });
+
+DEFINE_string(scan_scheduler_tenant_weights, "",
+              "Comma-separated list of 'tenant:weight' pairs, where 'tenant' is "
+              "a user or a table ID depending on --scan_scheduler_fairness. A "
+              "tenant with weight 2 gets twice the scan time of a tenant with "
+              "weight 1 when both have scans waiting. Tenants not listed have "
+              "weight 1.");
+TAG_FLAG(scan_scheduler_tenant_weights, experimental);
+
+METRIC_DEFINE_counter(server, scans_queued,
+                      "Scans Queued",
+                      kudu::MetricUnit::kRequests,
+                      "Number of scan requests which waited for a slot of the "
+                      "scan scheduler");
+METRIC_DEFINE_counter(server, scans_rejected,
+                      "Scans Rejected",
+                      kudu::MetricUnit::kRequests,
+                      "Number of scan requests which were rejected because "
+                      "no slot of the scan scheduler became available in time");
+METRIC_DEFINE_histogram(server, scan_queue_time,
+                        "Scan Queue Time",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Time scan requests waited for a slot of the scan scheduler",
+                        60000000LU, 2, kudu::STRIPED);
+METRIC_DEFINE_gauge_int32(server, scans_running,
+                          "Scans Running",
+                          kudu::MetricUnit::kRequests,
+                          "Number of scan requests holding a slot of the scan scheduler");
+METRIC_DEFINE_gauge_int32(server, scans_waiting,
+                          "Scans Waiting",
+                          kudu::MetricUnit::kRequests,
+                          "Number of scan requests waiting for a slot of the scan scheduler");
+
+using std::string;
+using std::unique_ptr;
+using std::unordered_map;
+using strings::Substitute;
+
+namespace kudu {
+namespace tserver {
+
+ScanScheduler::Slot::Slot(ScanScheduler* scheduler, string tenant)
+    : scheduler_(scheduler),
+      tenant_(std::move(tenant)),
+      start_time_(MonoTime::Now()) {
+}
+
+ScanScheduler::Slot::~Slot() {
+  scheduler_->Release(tenant_, MonoTime::Now() - start_time_);
+}
+
+ScanScheduler::ScanScheduler(int max_concurrent_scans,
+                             const scoped_refptr<MetricEntity>& metric_entity)
+    : max_concurrent_scans_(std::max(1, max_concurrent_scans)),
+      cond_(&lock_),
+      virtual_time_us_(0),
+      num_running_(0),
+      num_waiting_(0) {
+  Status s = ParseTenantWeights(FLAGS_scan_scheduler_tenant_weights, &weights_);
+  if (!s.ok()) {
+    LOG(WARNING) << "Ignoring --scan_scheduler_tenant_weights: " << s.ToString();
+    weights_.clear();
+  }
+  if (metric_entity) {
+    scans_queued_ = METRIC_scans_queued.Instantiate(metric_entity);
+    scans_rejected_ = METRIC_scans_rejected.Instantiate(metric_entity);
+    queue_time_ = METRIC_scan_queue_time.Instantiate(metric_entity);
+    METRIC_scans_running.InstantiateFunctionGauge(
+        metric_entity, Bind(&ScanScheduler::num_running, Unretained(this)))
+      ->AutoDetach(&metric_detacher_);
+    METRIC_scans_waiting.InstantiateFunctionGauge(
+        metric_entity, Bind(&ScanScheduler::num_waiting, Unretained(this)))
+      ->AutoDetach(&metric_detacher_);
+  }
+}
+
+ScanScheduler::~ScanScheduler() {
+}
+
+int ScanScheduler::DefaultMaxConcurrentScans(int num_data_dirs) {
+  if (FLAGS_scan_scheduler_max_concurrent_scans > 0) {
+    return FLAGS_scan_scheduler_max_concurrent_scans;
+  }
+  // Scans are bound either by the CPU, when their data is cached, or by the
+  // disks otherwise: allow enough of them to use both.
+  return base::NumCPUs() + std::max(1, num_data_dirs);
+}
+
+Status ScanScheduler::ParseTenantWeights(const string& spec,
+                                         unordered_map<string, double>* weights) {
+  unordered_map<string, double> parsed;
+  for (const auto& entry : strings::Split(spec, ",", strings::SkipWhitespace())) {
+    string pair = entry.ToString();
+    StripWhiteSpace(&pair);
+    // Tenants may contain ':', e.g. Kerberos principals: split at the last one.
+    const auto pos = pair.rfind(':');
+    double weight;
+    if (pos == string::npos || pos == 0 ||
+        !safe_strtod(pair.substr(pos + 1), &weight) || weight <= 0) {
+      return Status::InvalidArgument(
+          Substitute("invalid tenant weight '$0': expected 'tenant:weight' with "
+                     "a positive weight", pair));
+    }
+    if (!InsertIfNotPresent(&parsed, pair.substr(0, pos), weight)) {
+      return Status::InvalidArgument(
+          Substitute("duplicate tenant '$0'", pair.substr(0, pos)));
+    }
+  }
+  *weights = std::move(parsed);
+  return Status::OK();
+}
+
+double ScanScheduler::WeightOf(const string& tenant) const {
+  return FindWithDefault(weights_, tenant, 1.0);
+}
+
+Status ScanScheduler::Admit(const string& tenant,
+                            const MonoTime& deadline,
+                            unique_ptr<Slot>* slot) {
+  MutexLock l(lock_);
+  Tenant* t = &tenants_[tenant];
+  if (t->num_running == 0 && t->waiters.empty()) {
+    // The tenant becomes active: it doesn't get credit for being idle.
+    t->virtual_time_us = std::max(t->virtual_time_us, virtual_time_us_);
+  }
+  if (num_running_ < max_concurrent_scans_ && num_waiting_ == 0) {
+    t->num_running++;
+    num_running_++;
+    virtual_time_us_ = std::max(virtual_time_us_, t->virtual_time_us);
+    slot->reset(new Slot(this, tenant));
+    return Status::OK();
+  }
+
+  const MonoTime start = MonoTime::Now();
+  if (scans_queued_) {
+    scans_queued_->Increment();
+  }
+  Waiter w;
+  t->waiters.push_back(&w);
+  num_waiting_++;
+  while (!w.admitted) {
+    if (!cond_.WaitUntil(deadline) && !w.admitted) {
+      // The tenant isn't removed while it has waiters.
+      auto& waiters = FindOrDie(tenants_, tenant).waiters;
+      waiters.erase(std::find(waiters.begin(), waiters.end(), &w));
+      num_waiting_--;
+      if (scans_rejected_) {
+        scans_rejected_->Increment();
+      }
+      return Status::ServiceUnavailable(
+          Substitute("no scan slot available after $0",
+                     (MonoTime::Now() - start).ToString()));
+    }
+  }
+  if (queue_time_) {
+    queue_time_->Increment((MonoTime::Now() - start).ToMicroseconds());
+  }
+  slot->reset(new Slot(this, tenant));
+  return Status::OK();
+}
+
+void ScanScheduler::Release(const string& tenant, const MonoDelta& elapsed) {
+  MutexLock l(lock_);
+  Tenant* t = FindOrNull(tenants_, tenant);
+  DCHECK(t);
+  DCHECK_GT(t->num_running, 0);
+  t->virtual_time_us += elapsed.ToMicroseconds() / WeightOf(tenant);
+  t->num_running--;
+  num_running_--;
+  AdmitWaitersUnlocked();
+}
+
+void ScanScheduler::AdmitWaitersUnlocked() {
+  bool admitted = false;
+  while (num_running_ < max_concurrent_scans_ && num_waiting_ > 0) {
+    Tenant* next = nullptr;
+    for (auto& e : tenants_) {
+      Tenant* t = &e.second;
+      if (!t->waiters.empty() &&
+          (next == nullptr || t->virtual_time_us < next->virtual_time_us)) {
+        next = t;
+      }
+    }
+    DCHECK(next);
+    next->waiters.front()->admitted = true;
+    next->waiters.pop_front();
+    next->num_running++;
+    num_waiting_--;
+    num_running_++;
+    virtual_time_us_ = std::max(virtual_time_us_, next->virtual_time_us);
+    admitted = true;
+  }
+
+  // Forget the idle tenants which wouldn't be ahead of the others if they
+  // became active again.
+  for (auto it = tenants_.begin(); it != tenants_.end();) {
+    const Tenant& t = it->second;
+    if (t.num_running == 0 && t.waiters.empty() && t.virtual_time_us <= virtual_time_us_) {
+      it = tenants_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  if (admitted) {
+    cond_.Broadcast();
+  }
+}
+
+int ScanScheduler::num_running() const {
+  MutexLock l(lock_);
+  return num_running_;
+}
+
+int ScanScheduler::num_waiting() const {
+  MutexLock l(lock_);
+  return num_waiting_;
+}
+
+} // namespace tserver
+} // namespace kudu
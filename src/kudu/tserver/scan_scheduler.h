@@ -0,0 +1,163 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <gtest/gtest_prod.h>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+namespace tserver {
+
+// Admission control for the scan requests of a tablet server.
+//
+// At most a fixed number of scan requests read rows at a time. When the
+// budget is used up, scan requests wait for a slot, and freed slots are
+// granted according to weighted fair queueing across tenants (users or
+// tables, depending on --scan_scheduler_fairness): each tenant accumulates
+// the time its scan requests held a slot, divided by its weight, and the
+// waiter of the tenant with the least accumulated time is admitted first.
+// Requests of a tenant are admitted in arrival order. A tenant which had no
+// scans in flight doesn't get credit for the time it was idle, so a user
+// issuing occasional short scans is admitted ahead of a user monopolizing
+// the budget with large scans, without then being able to starve it.
+//
+// This class is thread-safe.
+class ScanScheduler {
+ public:
+  // A slot held by an admitted scan request. The slot is released when
+  // destroyed, charging the time it was held to its tenant.
+  class Slot {
+   public:
+    ~Slot();
+
+   private:
+    friend class ScanScheduler;
+
+    Slot(ScanScheduler* scheduler, std::string tenant);
+
+    ScanScheduler* const scheduler_;
+    const std::string tenant_;
+    const MonoTime start_time_;
+
+    DISALLOW_COPY_AND_ASSIGN(Slot);
+  };
+
+  // Creates a scheduler which admits at most 'max_concurrent_scans' scan
+  // requests at a time. Tenant weights are taken from
+  // --scan_scheduler_tenant_weights.
+  explicit ScanScheduler(int max_concurrent_scans,
+                         const scoped_refptr<MetricEntity>& metric_entity =
+                             scoped_refptr<MetricEntity>());
+  ~ScanScheduler();
+
+  // Returns the default scan budget of a tablet server with 'num_data_dirs'
+  // data directories: --scan_scheduler_max_concurrent_scans if set, or else
+  // enough scans to keep every CPU and every data directory busy.
+  static int DefaultMaxConcurrentScans(int num_data_dirs);
+
+  // Waits until a scan request of 'tenant' may run, populating 'slot' on
+  // success. Returns ServiceUnavailable if the request isn't admitted by
+  // 'deadline'.
+  Status Admit(const std::string& tenant,
+               const MonoTime& deadline,
+               std::unique_ptr<Slot>* slot) WARN_UNUSED_RESULT;
+
+  int max_concurrent_scans() const { return max_concurrent_scans_; }
+
+  // Returns the number of the scan requests holding a slot.
+  int num_running() const;
+
+  // Returns the number of the scan requests waiting for a slot.
+  int num_waiting() const;
+
+ private:
+  FRIEND_TEST(ScanSchedulerTest, TestParseTenantWeights);
+
+  struct Waiter {
+    bool admitted = false;
+  };
+
+  struct Tenant {
+    // The time the tenant's scans held a slot, divided by the tenant's
+    // weight, in microseconds.
+    double virtual_time_us = 0;
+
+    // The number of the tenant's scan requests holding a slot.
+    int num_running = 0;
+
+    // The tenant's scan requests waiting for a slot, in arrival order.
+    std::deque<Waiter*> waiters;
+  };
+
+  // Parses a comma-separated list of 'tenant:weight' pairs into 'weights'.
+  static Status ParseTenantWeights(const std::string& spec,
+                                   std::unordered_map<std::string, double>* weights);
+
+  // Releases a slot of 'tenant' held for 'elapsed', admitting waiters.
+  void Release(const std::string& tenant, const MonoDelta& elapsed);
+
+  // Grants freed slots to the waiters of the tenants with the least virtual
+  // time, and removes the tenants which are no longer tracked.
+  void AdmitWaitersUnlocked();
+
+  double WeightOf(const std::string& tenant) const;
+
+  const int max_concurrent_scans_;
+
+  // The weights of the tenants, by name. Tenants not listed have weight 1.
+  std::unordered_map<std::string, double> weights_;
+
+  mutable Mutex lock_;
+
+  // Signaled when waiters are admitted.
+  ConditionVariable cond_;
+
+  // The tenants with scan requests holding or waiting for a slot, by name.
+  std::unordered_map<std::string, Tenant> tenants_;
+
+  // The virtual time of the tenant last admitted. A tenant becoming active
+  // starts at least from this time.
+  double virtual_time_us_;
+
+  int num_running_;
+  int num_waiting_;
+
+  scoped_refptr<Counter> scans_queued_;
+  scoped_refptr<Counter> scans_rejected_;
+  scoped_refptr<Histogram> queue_time_;
+
+  FunctionGaugeDetacher metric_detacher_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScanScheduler);
+};
+
+} // namespace tserver
+} // namespace kudu
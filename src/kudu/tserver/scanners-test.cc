@@ -28,16 +28,19 @@
 #include "kudu/tablet/tablet_replica.h"
 #include "kudu/tserver/scanner_metrics.h"
 #include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 
 DECLARE_int32(scanner_ttl_ms);
+DECLARE_int64(scanners_memory_limit_mb);
 
 namespace kudu {
 
 using rpc::RemoteUser;
+using std::shared_ptr;
 using std::vector;
 using tablet::TabletReplica;
 
@@ -96,5 +99,36 @@ TEST(ScannerTest, TestExpire) {
   ASSERT_EQ(s2->id(), active_scanners[0]->id());
 }
 
+TEST(ScannerTest, TestMemoryTracking) {
+  scoped_refptr<TabletReplica> null_replica(nullptr);
+  FLAGS_scanners_memory_limit_mb = 1;
+  shared_ptr<MemTracker> parent = MemTracker::CreateTracker(-1, "test");
+  ScannerManager mgr(nullptr, parent);
+  ASSERT_FALSE(mgr.MemoryLimitExceeded());
+  {
+    SharedScanner s;
+    mgr.NewScanner(null_replica, RemoteUser(), RowFormatFlags::NO_FLAGS, &s);
+
+    // Memory used by the call being served counts towards the limit until
+    // the call is over.
+    s->UpdateMemoryConsumption(2 * 1024 * 1024);
+    ASSERT_LT(2 * 1024 * 1024, s->memory_consumption());
+    ASSERT_EQ(s->memory_consumption(), mgr.mem_tracker()->consumption());
+    ASSERT_EQ(s->memory_consumption(), parent->consumption());
+    ASSERT_TRUE(mgr.MemoryLimitExceeded());
+
+    s->UpdateMemoryConsumption(0);
+    ASSERT_EQ(s->retained_memory(), s->memory_consumption());
+    ASSERT_EQ(s->memory_consumption(), mgr.mem_tracker()->consumption());
+    ASSERT_FALSE(mgr.MemoryLimitExceeded());
+
+    // The scanner's memory is released once it's gone.
+    s->UpdateMemoryConsumption(1024);
+    ASSERT_TRUE(mgr.UnregisterScanner(s->id()));
+  }
+  ASSERT_EQ(0, mgr.mem_tracker()->consumption());
+  ASSERT_EQ(0, parent->consumption());
+}
+
 } // namespace tserver
 } // namespace kudu
@@ -27,7 +27,10 @@
 #include "kudu/common/column_predicate.h"
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/iterator.h"
+#include "kudu/common/scan_aggregator.h"
+#include "kudu/common/scan_bloom_filter_builder.h"
 #include "kudu/common/scan_spec.h"
+#include "kudu/common/scan_top_k.h"
 #include "kudu/common/schema.h"
 #include "kudu/gutil/bind.h"
 #include "kudu/gutil/bind_helpers.h"
@@ -42,7 +45,9 @@
 #include "kudu/tserver/scanner_metrics.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/process_memory.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/thread.h"
@@ -60,11 +65,26 @@ DEFINE_int32(scan_history_count, 20,
              "scans will be shown on the tablet server's scans dashboard.");
 TAG_FLAG(scan_history_count, experimental);
 
+DEFINE_int64(scanners_memory_limit_mb, 0,
+             "Maximum amount of memory all the scanners of a tablet server may "
+             "use, in MiB. Once exceeded, scan requests are throttled until "
+             "scanners complete or expire. If 0, scans are only throttled once "
+             "the process' hard memory limit is exceeded.");
+TAG_FLAG(scanners_memory_limit_mb, advanced);
+
+DEFINE_int64(scanner_memory_limit_mb, 0,
+             "Maximum amount of memory a single scanner may keep across scan "
+             "requests, e.g. for the rows of a top-k scan, in MiB. Scans "
+             "exceeding it fail. If 0, there's no per-scanner limit.");
+TAG_FLAG(scanner_memory_limit_mb, advanced);
+TAG_FLAG(scanner_memory_limit_mb, runtime);
+
 METRIC_DEFINE_gauge_size(server, active_scanners,
                          "Active Scanners",
                          kudu::MetricUnit::kScanners,
                          "Number of scanners that are currently active");
 
+using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
 using std::unordered_map;
@@ -78,8 +98,12 @@ using tablet::TabletReplica;
 
 namespace tserver {
 
-ScannerManager::ScannerManager(const scoped_refptr<MetricEntity>& metric_entity)
-    : shutdown_(false),
+ScannerManager::ScannerManager(const scoped_refptr<MetricEntity>& metric_entity,
+                               shared_ptr<MemTracker> parent_mem_tracker)
+    : mem_tracker_(MemTracker::CreateTracker(
+          FLAGS_scanners_memory_limit_mb > 0 ? FLAGS_scanners_memory_limit_mb * 1024 * 1024 : -1,
+          "scanners", std::move(parent_mem_tracker))),
+      shutdown_(false),
       shutdown_cv_(&shutdown_lock_),
       completed_scans_offset_(0) {
   if (metric_entity) {
@@ -148,10 +172,11 @@ void ScannerManager::NewScanner(const scoped_refptr<TabletReplica>& tablet_repli
                                tablet_replica,
                                remote_user,
                                metrics_.get(),
-                               row_format_flags));
+                               row_format_flags,
+                               mem_tracker_));
 
     ScannerMapStripe& stripe = GetStripeByScannerId(id);
-    std::lock_guard<RWMutex> l(stripe.lock_);
+    std::lock_guard<percpu_rwlock> l(stripe.lock_);
     success = InsertIfNotPresent(&stripe.scanners_by_id_, id, *scanner);
   }
 }
@@ -162,7 +187,7 @@ Status ScannerManager::LookupScanner(const string& scanner_id,
                                      SharedScanner* scanner) {
   SharedScanner ret;
   ScannerMapStripe& stripe = GetStripeByScannerId(scanner_id);
-  shared_lock<RWMutex> l(stripe.lock_);
+  kudu::shared_lock<rw_spinlock> l(stripe.lock_.get_lock());
   bool found_scanner = FindCopy(stripe.scanners_by_id_, scanner_id, &ret);
   if (!found_scanner) {
     *error_code = TabletServerErrorPB::SCANNER_EXPIRED;
@@ -182,7 +207,7 @@ bool ScannerManager::UnregisterScanner(const string& scanner_id) {
   ScanDescriptor descriptor;
   ScannerMapStripe& stripe = GetStripeByScannerId(scanner_id);
   {
-    std::lock_guard<RWMutex> l(stripe.lock_);
+    std::lock_guard<percpu_rwlock> l(stripe.lock_);
     auto it = stripe.scanners_by_id_.find(scanner_id);
     if (it == stripe.scanners_by_id_.end()) {
       return false;
@@ -207,7 +232,7 @@ bool ScannerManager::UnregisterScanner(const string& scanner_id) {
 size_t ScannerManager::CountActiveScanners() const {
   size_t total = 0;
   for (const ScannerMapStripe* e : scanner_maps_) {
-    shared_lock<RWMutex> l(e->lock_);
+    kudu::shared_lock<rw_spinlock> l(e->lock_.get_lock());
     total += e->scanners_by_id_.size();
   }
   return total;
@@ -215,7 +240,7 @@ size_t ScannerManager::CountActiveScanners() const {
 
 void ScannerManager::ListScanners(std::vector<SharedScanner>* scanners) const {
   for (const ScannerMapStripe* stripe : scanner_maps_) {
-    shared_lock<RWMutex> l(stripe->lock_);
+    kudu::shared_lock<rw_spinlock> l(stripe->lock_.get_lock());
     for (const auto& se : stripe->scanners_by_id_) {
       scanners->push_back(se.second);
     }
@@ -225,7 +250,7 @@ void ScannerManager::ListScanners(std::vector<SharedScanner>* scanners) const {
 vector<ScanDescriptor> ScannerManager::ListScans() const {
   unordered_map<string, ScanDescriptor> scans;
   for (const ScannerMapStripe* stripe : scanner_maps_) {
-    shared_lock<RWMutex> l(stripe->lock_);
+    kudu::shared_lock<rw_spinlock> l(stripe->lock_.get_lock());
     for (const auto& se : stripe->scanners_by_id_) {
       if (se.second->IsInitialized()) {
         ScanDescriptor desc = se.second->descriptor();
@@ -263,7 +288,7 @@ void ScannerManager::RemoveExpiredScanners() {
 
   vector<ScanDescriptor> descriptors;
   for (ScannerMapStripe* stripe : scanner_maps_) {
-    std::lock_guard<RWMutex> l(stripe->lock_);
+    std::lock_guard<percpu_rwlock> l(stripe->lock_);
     for (auto it = stripe->scanners_by_id_.begin(); it != stripe->scanners_by_id_.end();) {
       const SharedScanner& scanner = it->second;
       MonoDelta idle_time = scanner->TimeSinceLastAccess(now);
@@ -298,6 +323,11 @@ void ScannerManager::RemoveExpiredScanners() {
   }
 }
 
+bool ScannerManager::MemoryLimitExceeded() const {
+  return mem_tracker_->AnyLimitExceeded() ||
+      process_memory::CurrentConsumption() > process_memory::HardLimit();
+}
+
 void ScannerManager::RecordCompletedScanUnlocked(ScanDescriptor descriptor) {
   if (completed_scans_.capacity() == 0) {
     return;
@@ -316,7 +346,8 @@ const std::string Scanner::kNullTabletId = "null tablet";
 
 Scanner::Scanner(string id, const scoped_refptr<TabletReplica>& tablet_replica,
                  RemoteUser remote_user, ScannerMetrics* metrics,
-                 uint64_t row_format_flags)
+                 uint64_t row_format_flags,
+                 shared_ptr<MemTracker> mem_tracker)
     : id_(std::move(id)),
       tablet_replica_(tablet_replica),
       remote_user_(std::move(remote_user)),
@@ -325,7 +356,10 @@ Scanner::Scanner(string id, const scoped_refptr<TabletReplica>& tablet_replica,
       metrics_(metrics),
       arena_(256),
       row_format_flags_(row_format_flags),
-      num_rows_returned_(0) {
+      num_rows_returned_(0),
+      mem_tracker_(std::move(mem_tracker)),
+      retained_memory_(0),
+      memory_consumption_(0) {
   if (tablet_replica_) {
     auto tablet = tablet_replica->shared_tablet();
     if (tablet && tablet->metrics()) {
@@ -345,6 +379,9 @@ Scanner::~Scanner() {
   if (metrics_) {
     metrics_->SubmitScannerDuration(start_time_);
   }
+  if (mem_tracker_) {
+    mem_tracker_->Release(memory_consumption_);
+  }
 }
 
 void Scanner::UpdateAccessTime() {
@@ -365,10 +402,54 @@ void Scanner::Init(unique_ptr<RowwiseIterator> iter,
   spec_.reset(spec.release());
 }
 
+void Scanner::set_aggregator(unique_ptr<ScanAggregator> aggregator) {
+  aggregator_ = std::move(aggregator);
+}
+
+void Scanner::set_top_k(unique_ptr<ScanTopK> top_k) {
+  top_k_ = std::move(top_k);
+}
+
+void Scanner::set_bloom_filter_builder(unique_ptr<ScanBloomFilterBuilder> builder) {
+  bloom_filter_builder_ = std::move(builder);
+}
+
 const ScanSpec& Scanner::spec() const {
   return *spec_;
 }
 
+void Scanner::UpdateMemoryConsumption(int64_t transient_bytes) {
+  int64_t retained = arena_.memory_footprint();
+  if (top_k_) {
+    retained += top_k_->memory_footprint();
+  }
+  int64_t delta;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    retained_memory_ = retained;
+    delta = retained + transient_bytes - memory_consumption_;
+    memory_consumption_ += delta;
+  }
+  if (!mem_tracker_) {
+    return;
+  }
+  if (delta > 0) {
+    mem_tracker_->Consume(delta);
+  } else if (delta < 0) {
+    mem_tracker_->Release(-delta);
+  }
+}
+
+int64_t Scanner::retained_memory() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return retained_memory_;
+}
+
+int64_t Scanner::memory_consumption() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return memory_consumption_;
+}
+
 void Scanner::GetIteratorStats(vector<IteratorStats>* stats) const {
   iter_->GetIteratorStats(stats);
 }
@@ -49,7 +49,11 @@
 
 namespace kudu {
 
+class MemTracker;
 class RowwiseIterator;
+class ScanAggregator;
+class ScanBloomFilterBuilder;
+class ScanTopK;
 class Schema;
 class Status;
 class Thread;
@@ -72,9 +76,15 @@ typedef std::shared_ptr<Scanner> SharedScanner;
 //
 // Since scanners keep resources on the server, the manager periodically
 // removes any scanners which have not been accessed since a configurable TTL.
+//
+// The memory used by the scanners is accounted for by a 'scanners' memory
+// tracker, a child of 'parent_mem_tracker' (or of the root tracker if null),
+// whose limit is set by --scanners_memory_limit_mb.
 class ScannerManager {
  public:
-  explicit ScannerManager(const scoped_refptr<MetricEntity>& metric_entity);
+  explicit ScannerManager(const scoped_refptr<MetricEntity>& metric_entity,
+                          std::shared_ptr<MemTracker> parent_mem_tracker =
+                              std::shared_ptr<MemTracker>());
   ~ScannerManager();
 
   // Starts the expired scanner removal thread.
@@ -117,6 +127,13 @@ class ScannerManager {
   // Iterate through scanners and remove any which are past their TTL.
   void RemoveExpiredScanners();
 
+  // Returns true if the scanners' memory limit, or the process' hard memory
+  // limit, is exceeded. Scan requests should then be throttled until
+  // scanners complete or expire.
+  bool MemoryLimitExceeded() const;
+
+  const std::shared_ptr<MemTracker>& mem_tracker() const { return mem_tracker_; }
+
  private:
   FRIEND_TEST(ScannerTest, TestExpire);
 
@@ -127,8 +144,10 @@ class ScannerManager {
   typedef std::unordered_map<std::string, SharedScanner> ScannerMap;
 
   struct ScannerMapStripe {
-    // Lock protecting the scanner map.
-    mutable RWMutex lock_;
+    // Lock protecting the scanner map. Lookups on scan continuations vastly
+    // outnumber insertions and removals, so readers only take the lock of
+    // the CPU they run on.
+    mutable percpu_rwlock lock_;
     // Map of the currently active scanners.
     ScannerMap scanners_by_id_;
   };
@@ -144,6 +163,9 @@ class ScannerManager {
   // (Optional) scanner metrics for this instance.
   gscoped_ptr<ScannerMetrics> metrics_;
 
+  // Tracks the memory used by all scanners.
+  std::shared_ptr<MemTracker> mem_tracker_;
+
   // If true, removal thread should shut itself down. Protected
   // by 'shutdown_lock_' and 'shutdown_cv_'.
   bool shutdown_;
@@ -197,7 +219,8 @@ class Scanner {
   Scanner(std::string id,
           const scoped_refptr<tablet::TabletReplica>& tablet_replica,
           rpc::RemoteUser remote_user, ScannerMetrics* metrics,
-          uint64_t row_format_flags);
+          uint64_t row_format_flags,
+          std::shared_ptr<MemTracker> mem_tracker);
   ~Scanner();
 
   // Attach an actual iterator and a ScanSpec to this Scanner.
@@ -293,6 +316,29 @@ class Scanner {
   // See the note about 'set_client_projection_schema' above.
   const Schema* client_projection_schema() const { return client_projection_schema_.get(); }
 
+  // Associate an aggregator with the Scanner, for scans which return the
+  // aggregates of the matching rows instead of the rows themselves.
+  void set_aggregator(std::unique_ptr<ScanAggregator> aggregator);
+
+  // Returns the scan's aggregator, or null if the scan returns rows.
+  ScanAggregator* aggregator() const { return aggregator_.get(); }
+
+  // Associate a top-k accumulator with the Scanner, for scans which return
+  // the first rows of the tablet in a given order.
+  void set_top_k(std::unique_ptr<ScanTopK> top_k);
+
+  // Returns the scan's top-k accumulator, or null if the scan isn't a top-k
+  // scan.
+  ScanTopK* top_k() const { return top_k_.get(); }
+
+  // Associate a bloom filter builder with the Scanner, for scans which
+  // return a bloom filter of a column of the matching rows.
+  void set_bloom_filter_builder(std::unique_ptr<ScanBloomFilterBuilder> builder);
+
+  // Returns the scan's bloom filter builder, or null if the scan doesn't
+  // build a bloom filter.
+  ScanBloomFilterBuilder* bloom_filter_builder() const { return bloom_filter_builder_.get(); }
+
   // Get per-column stats for each iterator.
   void GetIteratorStats(std::vector<IteratorStats>* stats) const;
 
@@ -325,6 +371,23 @@ class Scanner {
 
   ScanDescriptor descriptor() const;
 
+  // Recomputes the memory used on behalf of the scanner: the state it keeps
+  // across calls (e.g. the rows kept by a top-k scan), plus
+  // 'transient_bytes' used by the call currently being served. The
+  // difference with the previous value is charged to the scanners' memory
+  // tracker.
+  //
+  // Must only be called by the thread serving a call of the scanner.
+  void UpdateMemoryConsumption(int64_t transient_bytes);
+
+  // Returns the memory used by the state the scanner keeps across calls, as
+  // of the last UpdateMemoryConsumption() call.
+  int64_t retained_memory() const;
+
+  // Returns the memory used on behalf of the scanner as of the last
+  // UpdateMemoryConsumption() call.
+  int64_t memory_consumption() const;
+
  private:
   friend class ScannerManager;
 
@@ -370,6 +433,15 @@ class Scanner {
 
   std::unique_ptr<RowwiseIterator> iter_;
 
+  // The aggregates computed by the scan, if any.
+  std::unique_ptr<ScanAggregator> aggregator_;
+
+  // The rows kept by a top-k scan, if any.
+  std::unique_ptr<ScanTopK> top_k_;
+
+  // The bloom filter built by the scan, if any.
+  std::unique_ptr<ScanBloomFilterBuilder> bloom_filter_builder_;
+
   AutoReleasePool autorelease_pool_;
 
   // Arena used for allocations which must last as long as the scanner
@@ -388,6 +460,13 @@ class Scanner {
   // this scanner, in seconds.
   CpuTimes cpu_times_;
 
+  // Tracks the memory used by all scanners; 'memory_consumption_' bytes of
+  // it are charged on behalf of this scanner, 'retained_memory_' of which
+  // are kept across calls. Both are protected by 'lock_'.
+  const std::shared_ptr<MemTracker> mem_tracker_;
+  int64_t retained_memory_;
+  int64_t memory_consumption_;
+
   DISALLOW_COPY_AND_ASSIGN(Scanner);
 };
 
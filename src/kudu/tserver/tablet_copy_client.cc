@@ -17,8 +17,12 @@
 
 #include "kudu/tserver/tablet_copy_client.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <utility>
 
@@ -65,7 +69,9 @@
 #include "kudu/util/random.h"
 #include "kudu/util/random_util.h"
 #include "kudu/util/scoped_cleanup.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/trace.h"
 
 DEFINE_int32(tablet_copy_begin_session_timeout_ms, 30000,
@@ -98,7 +104,13 @@ DEFINE_double(tablet_copy_fault_crash_before_write_cmeta, 0.0,
 TAG_FLAG(tablet_copy_fault_crash_before_write_cmeta, unsafe);
 TAG_FLAG(tablet_copy_fault_crash_before_write_cmeta, runtime);
 
+DEFINE_int32(tablet_copy_download_threads_per_session, 4,
+             "Number of threads each tablet copy client uses to download "
+             "blocks and WAL segments from the tablet copy source in parallel.");
+TAG_FLAG(tablet_copy_download_threads_per_session, advanced);
+
 DECLARE_int32(tablet_copy_transfer_chunk_size_bytes);
+DECLARE_int32(tablet_copy_max_transfer_chunk_size_bytes);
 
 METRIC_DEFINE_counter(server, tablet_copy_bytes_fetched,
                       "Bytes Fetched By Tablet Copy",
@@ -159,8 +171,11 @@ TabletCopyClient::TabletCopyClient(std::string tablet_id,
       tablet_replica_(nullptr),
       session_idle_timeout_millis_(FLAGS_tablet_copy_begin_session_timeout_ms),
       start_time_micros_(0),
-      rng_(GetRandomSeed32()),
-      tablet_copy_metrics_(tablet_copy_metrics) {
+      tablet_copy_metrics_(tablet_copy_metrics),
+      rng_(GetRandomSeed32()) {
+  CHECK_OK(ThreadPoolBuilder("tablet-copy-download")
+               .set_max_threads(std::max(1, FLAGS_tablet_copy_download_threads_per_session))
+               .Build(&download_pool_));
   BlockManager* bm = fs_manager->block_manager();
   transaction_ = bm->NewCreationTransaction();
   if (tablet_copy_metrics_) {
@@ -389,7 +404,8 @@ Status TabletCopyClient::FetchAll(const scoped_refptr<TabletReplica>& tablet_rep
 
   tablet_replica_ = tablet_replica;
 
-  // Download all the files (serially, for now, but in parallel in the future).
+  // Download all the files. Blocks and WAL segments are each fetched in
+  // parallel on 'download_pool_'.
   RETURN_NOT_OK(DownloadBlocks());
   RETURN_NOT_OK(DownloadWALs());
 
@@ -536,15 +552,13 @@ Status TabletCopyClient::DownloadWALs() {
   // Download the WAL segments.
   int num_segments = wal_seqnos_.size();
   LOG_WITH_PREFIX(INFO) << "Starting download of " << num_segments << " WAL segments...";
-  uint64_t counter = 0;
-  for (uint64_t seg_seqno : wal_seqnos_) {
+  std::atomic<int> counter(0);
+  return RunInParallel(num_segments, [&](int i) {
+    uint64_t seg_seqno = wal_seqnos_[i];
     SetStatusMessage(Substitute("Downloading WAL segment with seq. number $0 ($1/$2)",
-                                seg_seqno, counter + 1, num_segments));
-    RETURN_NOT_OK(DownloadWAL(seg_seqno));
-    ++counter;
-  }
-
-  return Status::OK();
+                                seg_seqno, ++counter, num_segments));
+    return DownloadWAL(seg_seqno);
+  });
 }
 
 int TabletCopyClient::CountRemoteBlocks() const {
@@ -559,6 +573,10 @@ int TabletCopyClient::CountRemoteBlocks() const {
     if (rowset.has_adhoc_index_block()) {
       num_blocks++;
     }
+    num_blocks += rowset.secondary_indexes_size();
+    if (rowset.has_rollup()) {
+      num_blocks++;
+    }
   }
   return num_blocks;
 }
@@ -566,19 +584,54 @@ int TabletCopyClient::CountRemoteBlocks() const {
 Status TabletCopyClient::DownloadBlocks() {
   CHECK_EQ(kStarted, state_);
 
-  // Count up the total number of blocks to download.
-  int num_remote_blocks = CountRemoteBlocks();
+  // Collect the IDs of all the blocks to download, in the order in which they
+  // are referenced by the remote superblock.
+  vector<const BlockIdPB*> src_block_ids;
+  for (const RowSetDataPB& src_rowset : remote_superblock_->rowsets()) {
+    for (const ColumnDataPB& src_col : src_rowset.columns()) {
+      src_block_ids.push_back(&src_col.block());
+    }
+    for (const DeltaDataPB& src_redo : src_rowset.redo_deltas()) {
+      src_block_ids.push_back(&src_redo.block());
+    }
+    for (const DeltaDataPB& src_undo : src_rowset.undo_deltas()) {
+      src_block_ids.push_back(&src_undo.block());
+    }
+    if (src_rowset.has_bloom_block()) {
+      src_block_ids.push_back(&src_rowset.bloom_block());
+    }
+    if (src_rowset.has_adhoc_index_block()) {
+      src_block_ids.push_back(&src_rowset.adhoc_index_block());
+    }
+    for (const SecondaryIndexDataPB& src_index : src_rowset.secondary_indexes()) {
+      src_block_ids.push_back(&src_index.block());
+    }
+    if (src_rowset.has_rollup()) {
+      src_block_ids.push_back(&src_rowset.rollup().block());
+    }
+  }
+  int num_remote_blocks = src_block_ids.size();
+  DCHECK_EQ(CountRemoteBlocks(), num_remote_blocks);
 
-  // Download each block, writing the new block IDs into the new superblock
-  // as each block downloads.
-  int block_count = 0;
+  // Download the blocks in parallel. Each download writes only its own slot
+  // of 'dst_block_ids'.
+  vector<BlockIdPB> dst_block_ids(num_remote_blocks);
+  std::atomic<int> block_count(0);
   LOG_WITH_PREFIX(INFO) << "Starting download of " << num_remote_blocks << " data blocks...";
+  RETURN_NOT_OK(RunInParallel(num_remote_blocks, [&](int i) {
+    return DownloadAndRewriteBlock(*src_block_ids[i], num_remote_blocks,
+                                   &block_count, &dst_block_ids[i]);
+  }));
+
+  // Write the new block IDs into the new superblock. This is only done once
+  // every block has been downloaded, so that we never end up deleting the
+  // wrong blocks (using the ids of the remote blocks) if we fail, and so that
+  // superblock_ is never left unserializable with unset required fields.
+  int idx = 0;
   for (const RowSetDataPB& src_rowset : remote_superblock_->rowsets()) {
     // Create rowset.
     RowSetDataPB* dst_rowset = superblock_->add_rowsets();
     *dst_rowset = src_rowset;
-    // Clear the data in the rowset so that we don't end up deleting the wrong
-    // blocks (using the ids of the remote blocks) if we fail.
     // TODO(mpercy): This is pretty fragile. Consider building a class
     // structure on top of SuperBlockPB to abstract copying details.
     dst_rowset->clear_columns();
@@ -586,51 +639,78 @@ Status TabletCopyClient::DownloadBlocks() {
     dst_rowset->clear_undo_deltas();
     dst_rowset->clear_bloom_block();
     dst_rowset->clear_adhoc_index_block();
+    dst_rowset->clear_secondary_indexes();
+    dst_rowset->clear_rollup();
 
-    // We can't leave superblock_ unserializable with unset required field
-    // values in child elements, so we must download and rewrite each block
-    // before referencing it in the rowset.
     for (const ColumnDataPB& src_col : src_rowset.columns()) {
-      BlockIdPB new_block_id;
-      RETURN_NOT_OK(DownloadAndRewriteBlock(src_col.block(), num_remote_blocks,
-                                            &block_count, &new_block_id));
       ColumnDataPB* dst_col = dst_rowset->add_columns();
       *dst_col = src_col;
-      *dst_col->mutable_block() = new_block_id;
+      *dst_col->mutable_block() = dst_block_ids[idx++];
     }
     for (const DeltaDataPB& src_redo : src_rowset.redo_deltas()) {
-      BlockIdPB new_block_id;
-      RETURN_NOT_OK(DownloadAndRewriteBlock(src_redo.block(), num_remote_blocks,
-                                            &block_count, &new_block_id));
       DeltaDataPB* dst_redo = dst_rowset->add_redo_deltas();
       *dst_redo = src_redo;
-      *dst_redo->mutable_block() = new_block_id;
+      *dst_redo->mutable_block() = dst_block_ids[idx++];
     }
     for (const DeltaDataPB& src_undo : src_rowset.undo_deltas()) {
-      BlockIdPB new_block_id;
-      RETURN_NOT_OK(DownloadAndRewriteBlock(src_undo.block(), num_remote_blocks,
-                                            &block_count, &new_block_id));
       DeltaDataPB* dst_undo = dst_rowset->add_undo_deltas();
       *dst_undo = src_undo;
-      *dst_undo->mutable_block() = new_block_id;
+      *dst_undo->mutable_block() = dst_block_ids[idx++];
     }
     if (src_rowset.has_bloom_block()) {
-      BlockIdPB new_block_id;
-      RETURN_NOT_OK(DownloadAndRewriteBlock(src_rowset.bloom_block(), num_remote_blocks,
-                                            &block_count, &new_block_id));
-      *dst_rowset->mutable_bloom_block() = new_block_id;
+      *dst_rowset->mutable_bloom_block() = dst_block_ids[idx++];
     }
     if (src_rowset.has_adhoc_index_block()) {
-      BlockIdPB new_block_id;
-      RETURN_NOT_OK(DownloadAndRewriteBlock(src_rowset.adhoc_index_block(), num_remote_blocks,
-                                            &block_count, &new_block_id));
-      *dst_rowset->mutable_adhoc_index_block() = new_block_id;
+      *dst_rowset->mutable_adhoc_index_block() = dst_block_ids[idx++];
+    }
+    for (const SecondaryIndexDataPB& src_index : src_rowset.secondary_indexes()) {
+      SecondaryIndexDataPB* dst_index = dst_rowset->add_secondary_indexes();
+      *dst_index = src_index;
+      *dst_index->mutable_block() = dst_block_ids[idx++];
+    }
+    if (src_rowset.has_rollup()) {
+      RollupDataPB* dst_rollup = dst_rowset->mutable_rollup();
+      *dst_rollup = src_rowset.rollup();
+      *dst_rollup->mutable_block() = dst_block_ids[idx++];
     }
   }
+  DCHECK_EQ(num_remote_blocks, idx);
 
   return Status::OK();
 }
 
+Status TabletCopyClient::RunInParallel(int num_tasks,
+                                       const std::function<Status(int)>& task) {
+  simple_spinlock status_lock;
+  Status first_error;
+  std::atomic<bool> failed(false);
+  auto record_error = [&](const Status& s) {
+    std::lock_guard<simple_spinlock> l(status_lock);
+    if (first_error.ok()) {
+      first_error = s;
+    }
+    failed = true;
+  };
+  for (int i = 0; i < num_tasks && !failed; i++) {
+    Status s = download_pool_->SubmitFunc([&, i] {
+      if (failed) {
+        return;
+      }
+      Status s = task(i);
+      if (PREDICT_FALSE(!s.ok())) {
+        record_error(s);
+      }
+    });
+    if (PREDICT_FALSE(!s.ok())) {
+      record_error(s.CloneAndPrepend("Unable to schedule download"));
+    }
+  }
+  // The tasks reference this stack frame, so wait for all of them even if
+  // an error has already occurred.
+  download_pool_->Wait();
+  return first_error;
+}
+
 Status TabletCopyClient::DownloadWAL(uint64_t wal_segment_seqno) {
   VLOG_WITH_PREFIX(1) << "Downloading WAL segment with seqno " << wal_segment_seqno;
   RETURN_NOT_OK_PREPEND(CheckHealthyDirGroup(), "Not downloading WAL for replica");
@@ -679,12 +759,12 @@ Status TabletCopyClient::WriteConsensusMetadata() {
 
 Status TabletCopyClient::DownloadAndRewriteBlock(const BlockIdPB& src_block_id,
                                                  int num_blocks,
-                                                 int* block_count,
+                                                 std::atomic<int>* block_count,
                                                  BlockIdPB* dest_block_id) {
   BlockId old_block_id(BlockId::FromPB(src_block_id));
   SetStatusMessage(Substitute("Downloading block $0 ($1/$2)",
                               old_block_id.ToString(),
-                              *block_count + 1, num_blocks));
+                              block_count->load() + 1, num_blocks));
   BlockId new_block_id;
   RETURN_NOT_OK_PREPEND(DownloadBlock(old_block_id, &new_block_id),
       "Unable to download block with id " + old_block_id.ToString());
@@ -712,6 +792,7 @@ Status TabletCopyClient::DownloadBlock(const BlockId& old_block_id,
 
   *new_block_id = block->id();
   RETURN_NOT_OK_PREPEND(block->Finalize(), "Unable to finalize block");
+  std::lock_guard<simple_spinlock> l(lock_);
   transaction_->AddCreatedBlock(std::move(block));
   return Status::OK();
 }
@@ -719,31 +800,51 @@ Status TabletCopyClient::DownloadBlock(const BlockId& old_block_id,
 template<class Appendable>
 Status TabletCopyClient::DownloadFile(const DataIdPB& data_id,
                                       Appendable* appendable) {
+  // Chunks fetched faster than this grow the chunk size; chunks fetched
+  // slower than this shrink it.
+  static const MonoDelta kFastChunkFetchTime = MonoDelta::FromMilliseconds(500);
+  static const MonoDelta kSlowChunkFetchTime = MonoDelta::FromSeconds(5);
+  const int64_t min_chunk_size = FLAGS_tablet_copy_transfer_chunk_size_bytes;
+  const int64_t max_chunk_size = std::max<int64_t>(
+      min_chunk_size, FLAGS_tablet_copy_max_transfer_chunk_size_bytes);
+  int64_t chunk_size_limit = min_chunk_size;
+
   uint64_t offset = 0;
   rpc::RpcController controller;
   controller.set_timeout(MonoDelta::FromMilliseconds(session_idle_timeout_millis_));
   FetchDataRequestPB req;
   req.set_session_id(session_id_);
   req.mutable_data_id()->CopyFrom(data_id);
-  req.set_max_length(FLAGS_tablet_copy_transfer_chunk_size_bytes);
+  req.set_data_in_sidecar(true);
 
   bool done = false;
   while (!done) {
     req.set_offset(offset);
+    req.set_max_length(chunk_size_limit);
 
     // Request the next data chunk.
     FetchDataResponsePB resp;
+    MonoTime fetch_start = MonoTime::Now();
     RETURN_NOT_OK_PREPEND(SendRpcWithRetry(&controller, [&] {
           return proxy_->FetchData(req, &resp, &controller);
     }), "unable to fetch data from remote");
+    MonoDelta fetch_time = MonoTime::Now() - fetch_start;
+
+    // Servers that support it return the data in a sidecar, which remains
+    // valid until 'controller' is reset.
+    Slice data(resp.chunk().data());
+    if (resp.chunk().has_data_sidecar_idx()) {
+      RETURN_NOT_OK_PREPEND(controller.GetInboundSidecar(resp.chunk().data_sidecar_idx(), &data),
+                            "unable to retrieve data sidecar");
+    }
 
     // Sanity-check for corruption.
-    RETURN_NOT_OK_PREPEND(VerifyData(offset, resp.chunk()),
+    RETURN_NOT_OK_PREPEND(VerifyData(offset, resp.chunk(), data),
                           Substitute("Error validating data item $0",
                                      pb_util::SecureShortDebugString(data_id)));
 
     // Write the data.
-    RETURN_NOT_OK(appendable->Append(resp.chunk().data()));
+    RETURN_NOT_OK(appendable->Append(data));
 
     if (PREDICT_FALSE(FLAGS_tablet_copy_download_file_inject_latency_ms > 0)) {
       LOG_WITH_PREFIX(INFO) << "Injecting latency into file download: " <<
@@ -751,18 +852,27 @@ Status TabletCopyClient::DownloadFile(const DataIdPB& data_id,
       SleepFor(MonoDelta::FromMilliseconds(FLAGS_tablet_copy_download_file_inject_latency_ms));
     }
 
-    auto chunk_size = resp.chunk().data().size();
+    auto chunk_size = data.size();
     done = offset + chunk_size == resp.chunk().total_data_length();
     offset += chunk_size;
     if (tablet_copy_metrics_) {
       tablet_copy_metrics_->bytes_fetched->IncrementBy(chunk_size);
     }
+
+    // Adapt the size of the next request. Only full chunks say anything about
+    // the throughput of the link; the last chunk of a file is usually short.
+    if (chunk_size == static_cast<uint64_t>(chunk_size_limit) && fetch_time < kFastChunkFetchTime) {
+      chunk_size_limit = std::min(chunk_size_limit * 2, max_chunk_size);
+    } else if (fetch_time > kSlowChunkFetchTime) {
+      chunk_size_limit = std::max(chunk_size_limit / 2, min_chunk_size);
+    }
   }
 
   return Status::OK();
 }
 
-Status TabletCopyClient::VerifyData(uint64_t offset, const DataChunkPB& chunk) {
+Status TabletCopyClient::VerifyData(uint64_t offset, const DataChunkPB& chunk,
+                                    const Slice& data) {
   // Verify the offset is what we expected.
   if (offset != chunk.offset()) {
     return Status::InvalidArgument("Offset did not match what was asked for",
@@ -770,17 +880,17 @@ Status TabletCopyClient::VerifyData(uint64_t offset, const DataChunkPB& chunk) {
   }
 
   // Verify that the chunk does not overflow the total data length.
-  if (offset + chunk.data().length() > chunk.total_data_length()) {
+  if (offset + data.size() > chunk.total_data_length()) {
     return Status::InvalidArgument("Chunk exceeds total block data length",
-        Substitute("$0 vs $1", offset + chunk.data().length(), chunk.total_data_length()));
+        Substitute("$0 vs $1", offset + data.size(), chunk.total_data_length()));
   }
 
   // Verify the checksum.
-  uint32_t crc32 = crc::Crc32c(chunk.data().data(), chunk.data().length());
+  uint32_t crc32 = crc::Crc32c(data.data(), data.size());
   if (PREDICT_FALSE(crc32 != chunk.crc32())) {
     return Status::Corruption(
         Substitute("CRC32 does not match at offset $0 size $1: $2 vs $3",
-          offset, chunk.data().size(), crc32, chunk.crc32()));
+          offset, data.size(), crc32, chunk.crc32()));
   }
   return Status::OK();
 }
@@ -814,8 +924,13 @@ Status TabletCopyClient::SendRpcWithRetry(rpc::RpcController* controller, F f) {
       // Polynomial backoff with 50% jitter.
       double kJitterPct = 0.5;
       int32_t kBackoffBaseMs = 10;
+      double jitter;
+      {
+        std::lock_guard<simple_spinlock> l(lock_);
+        jitter = rng_.NextDoubleFraction();
+      }
       MonoDelta backoff = MonoDelta::FromMilliseconds(
-          (1 - kJitterPct + (kJitterPct * rng_.NextDoubleFraction()))
+          (1 - kJitterPct + (kJitterPct * jitter))
           * kBackoffBaseMs * attempt * attempt);
       if (MonoTime::Now() + backoff > deadline) {
         return Status::TimedOut("unable to fetch data from remote");
@@ -16,15 +16,19 @@
 // under the License.
 #pragma once
 
+#include <atomic>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include <gtest/gtest_prod.h>
 
+#include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/random.h"
 #include "kudu/util/status.h"
@@ -35,6 +39,8 @@ class BlockId;
 class BlockIdPB;
 class FsManager;
 class HostPort;
+class Slice;
+class ThreadPool;
 
 namespace consensus {
 class ConsensusMetadata;
@@ -71,11 +77,8 @@ struct TabletCopyClientMetrics {
 };
 
 // Client class for using tablet copy to copy a tablet from another host.
-// This class is not thread-safe.
-//
-// TODO:
-// * Parallelize download of blocks and WAL segments.
-//
+// This class is not thread-safe, though it internally downloads blocks and
+// WAL segments in parallel (see --tablet_copy_download_threads_per_session).
 class TabletCopyClient {
  public:
 
@@ -176,7 +179,7 @@ class TabletCopyClient {
   // End the tablet copy session.
   Status EndRemoteSession();
 
-  // Download all WAL files sequentially.
+  // Download all WAL files in parallel on 'download_pool_'.
   Status DownloadWALs();
 
   // Download a single WAL file.
@@ -191,8 +194,9 @@ class TabletCopyClient {
   // Count the number of blocks on the remote (from 'remote_superblock_').
   int CountRemoteBlocks() const;
 
-  // Download all blocks belonging to a tablet sequentially. Add all
-  // downloaded blocks to the tablet copy's transaction.
+  // Download all blocks belonging to a tablet in parallel on
+  // 'download_pool_'. Add all downloaded blocks to the tablet copy's
+  // transaction.
   //
   // Blocks are given new IDs upon creation. On success, 'superblock_'
   // is populated to reflect the new block IDs.
@@ -206,9 +210,11 @@ class TabletCopyClient {
   // On success:
   // - 'dest_block_id' is set to the new ID of the downloaded block.
   // - 'block_count' is incremented by 1.
+  //
+  // This method is thread-safe.
   Status DownloadAndRewriteBlock(const BlockIdPB& src_block_id,
                                  int num_blocks,
-                                 int* block_count,
+                                 std::atomic<int>* block_count,
                                  BlockIdPB* dest_block_id);
 
   // Download a single block.
@@ -216,6 +222,8 @@ class TabletCopyClient {
   // and added to the tablet copy's transaction.
   //
   // On success, 'new_block_id' is set to the new ID of the downloaded block.
+  //
+  // This method is thread-safe.
   Status DownloadBlock(const BlockId& old_block_id,
                        BlockId* new_block_id);
 
@@ -224,15 +232,28 @@ class TabletCopyClient {
   //
   // An Appendable is typically a WritableBlock (block) or WritableFile (WAL).
   //
+  // The chunk size starts at --tablet_copy_transfer_chunk_size_bytes and is
+  // doubled, up to --tablet_copy_max_transfer_chunk_size_bytes, while chunks
+  // are fetched quickly; it is halved again when fetches become slow.
+  //
   // Only used in one compilation unit, otherwise the implementation would
   // need to be in the header.
   template<class Appendable>
   Status DownloadFile(const DataIdPB& data_id, Appendable* appendable);
 
-  Status VerifyData(uint64_t offset, const DataChunkPB& resp);
+  // Verify that 'data', the bytes received for 'chunk' (either inline or in
+  // a sidecar), are consistent with the expected 'offset' and the checksum.
+  Status VerifyData(uint64_t offset, const DataChunkPB& chunk, const Slice& data);
+
+  // Run 'task' on each of 'num_tasks' indexes on 'download_pool_', waiting
+  // for all of them to finish. Returns the first error encountered; once an
+  // error occurs, tasks that have not yet started are skipped.
+  Status RunInParallel(int num_tasks, const std::function<Status(int)>& task);
 
   // Runs the provided functor, which must send an RPC and return the result
   // status, until it succeeds, times out, or fails with a non-retriable error.
+  //
+  // This method is thread-safe.
   template<typename F>
   Status SendRpcWithRetry(rpc::RpcController* controller, F f);
 
@@ -269,10 +290,17 @@ class TabletCopyClient {
   std::vector<uint64_t> wal_seqnos_;
   int64_t start_time_micros_;
 
-  Random rng_;
-
   TabletCopyClientMetrics* tablet_copy_metrics_;
 
+  // Pool on which blocks and WAL segments are downloaded.
+  gscoped_ptr<ThreadPool> download_pool_;
+
+  // Protects 'rng_' and 'transaction_', which are accessed concurrently by
+  // the download threads.
+  simple_spinlock lock_;
+
+  Random rng_;
+
   // Block transaction for the tablet copy.
   std::unique_ptr<fs::BlockCreationTransaction> transaction_;
 
@@ -49,6 +49,7 @@
 #include "kudu/tserver/tablet_copy.pb.h"
 #include "kudu/tserver/tablet_copy.proxy.h"
 #include "kudu/tserver/tablet_server.h"
+#include "kudu/util/crc.h"
 #include "kudu/util/env.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/monotime.h"
@@ -137,11 +138,13 @@ class TabletCopyServiceTest : public TabletCopyTest {
   Status DoFetchData(const string& session_id, const DataIdPB& data_id,
                      uint64_t* offset, int64_t* max_length,
                      FetchDataResponsePB* resp,
-                     RpcController* controller) {
+                     RpcController* controller,
+                     bool data_in_sidecar = false) {
     controller->set_timeout(MonoDelta::FromSeconds(1.0));
     FetchDataRequestPB req;
     req.set_session_id(session_id);
     req.mutable_data_id()->CopyFrom(data_id);
+    req.set_data_in_sidecar(data_in_sidecar);
     if (offset) {
       req.set_offset(*offset);
     }
@@ -419,6 +422,31 @@ TEST_F(TabletCopyServiceTest, TestFetchBlockAtOnce) {
   AssertDataEqual(local_data.data(), local_data.size(), resp.chunk());
 }
 
+// Test that the data is returned in a sidecar when the client asks for it.
+TEST_F(TabletCopyServiceTest, TestFetchBlockInSidecar) {
+  string session_id;
+  tablet::TabletSuperBlockPB superblock;
+  ASSERT_OK(DoBeginValidTabletCopySession(&session_id, &superblock));
+
+  BlockId block_id = FirstColumnBlockId(superblock);
+  Slice local_data;
+  faststring scratch;
+  ASSERT_OK(ReadLocalBlockFile(mini_server_->server()->fs_manager(), block_id,
+                               &scratch, &local_data));
+
+  FetchDataResponsePB resp;
+  RpcController controller;
+  ASSERT_OK(DoFetchData(session_id, AsDataTypeId(block_id), nullptr, nullptr, &resp, &controller,
+                        /*data_in_sidecar=*/true));
+  ASSERT_TRUE(resp.chunk().has_data_sidecar_idx());
+  ASSERT_TRUE(resp.chunk().data().empty());
+
+  Slice sidecar;
+  ASSERT_OK(controller.GetInboundSidecar(resp.chunk().data_sidecar_idx(), &sidecar));
+  ASSERT_EQ(local_data, sidecar);
+  ASSERT_EQ(crc::Crc32c(local_data.data(), local_data.size()), resp.chunk().crc32());
+}
+
 // Test that we are able to incrementally fetch blocks.
 TEST_F(TabletCopyServiceTest, TestFetchBlockIncrementally) {
   string session_id;
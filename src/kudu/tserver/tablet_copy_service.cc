@@ -17,6 +17,7 @@
 #include "kudu/tserver/tablet_copy_service.h"
 
 #include <cstdint>
+#include <memory>
 #include <ostream>
 #include <string>
 #include <utility>
@@ -35,11 +36,13 @@
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/rpc_context.h"
+#include "kudu/rpc/rpc_sidecar.h"
 #include "kudu/server/server_base.h"
 #include "kudu/tablet/metadata.pb.h"
 #include "kudu/tablet/tablet_replica.h"
 #include "kudu/tserver/tablet_replica_lookup.h"
 #include "kudu/util/crc.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
@@ -80,6 +83,7 @@ TAG_FLAG(tablet_copy_early_session_timeout_prob, runtime);
 TAG_FLAG(tablet_copy_early_session_timeout_prob, unsafe);
 
 using std::string;
+using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
 
@@ -92,6 +96,7 @@ class Message;
 namespace kudu {
 
 using crc::Crc32c;
+using rpc::RpcSidecar;
 using server::ServerBase;
 using pb_util::SecureShortDebugString;
 using tablet::TabletReplica;
@@ -287,31 +292,45 @@ void TabletCopyServiceImpl::FetchData(const FetchDataRequestPB* req,
                     error_code, "Invalid DataId", context);
 
   DataChunkPB* data_chunk = resp->mutable_chunk();
-  string* data = data_chunk->mutable_data();
+  unique_ptr<faststring> data(new faststring());
   int64_t total_data_length = 0;
   if (data_id.type() == DataIdPB::BLOCK) {
     // Fetching a data block chunk.
     const BlockId& block_id = BlockId::FromPB(data_id.block_id());
     RPC_RETURN_NOT_OK(session->GetBlockPiece(block_id, offset, client_maxlen,
-                                             data, &total_data_length, &error_code),
+                                             data.get(), &total_data_length, &error_code),
                       error_code, "Unable to get piece of data block", context);
   } else {
     // Fetching a log segment chunk.
     uint64_t segment_seqno = data_id.wal_segment_seqno();
     RPC_RETURN_NOT_OK(session->GetLogSegmentPiece(segment_seqno, offset, client_maxlen,
-                                                  data, &total_data_length, &error_code),
+                                                  data.get(), &total_data_length, &error_code),
                       error_code, "Unable to get piece of log segment", context);
   }
 
   data_chunk->set_total_data_length(total_data_length);
   data_chunk->set_offset(offset);
 
-  tablet_copy_metrics_.bytes_sent->IncrementBy(resp->chunk().data().size());
+  tablet_copy_metrics_.bytes_sent->IncrementBy(data->size());
 
   // Calculate checksum.
-  uint32_t crc32 = Crc32c(data->data(), data->length());
+  uint32_t crc32 = Crc32c(data->data(), data->size());
   data_chunk->set_crc32(crc32);
 
+  if (req->data_in_sidecar()) {
+    // Hand the buffer to the RPC layer as-is; 'data' must still be set since
+    // it is a required field.
+    data_chunk->set_data("");
+    int sidecar_idx;
+    RPC_RETURN_NOT_OK(context->AddOutboundSidecar(RpcSidecar::FromFaststring(std::move(data)),
+                                                  &sidecar_idx),
+                      TabletCopyErrorPB::UNKNOWN_ERROR, "Unable to add data sidecar", context);
+    data_chunk->set_data_sidecar_idx(sidecar_idx);
+  } else {
+    // The client predates sidecar support.
+    data_chunk->set_data(reinterpret_cast<const char*>(data->data()), data->size());
+  }
+
   context->RespondSuccess();
 }
 
@@ -36,13 +36,17 @@
 #include "kudu/fs/data_dirs.h"
 #include "kudu/fs/fs.pb.h"
 #include "kudu/fs/fs_manager.h"
+#include "kudu/fs/io_context.h"
+#include "kudu/fs/io_metrics.h"
 #include "kudu/gutil/basictypes.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/type_traits.h"
 #include "kudu/rpc/transfer.h"
+#include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet_metadata.h"
+#include "kudu/tablet/tablet_metrics.h"
 #include "kudu/tablet/tablet_replica.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/monotime.h"
@@ -56,6 +60,14 @@ DEFINE_int32(tablet_copy_transfer_chunk_size_bytes, 4 * 1024 * 1024,
              "tablet servers.");
 TAG_FLAG(tablet_copy_transfer_chunk_size_bytes, hidden);
 
+DEFINE_int32(tablet_copy_max_transfer_chunk_size_bytes, 32 * 1024 * 1024,
+             "Maximum size of the chunks tablet copy clients may request. Clients "
+             "start at --tablet_copy_transfer_chunk_size_bytes and grow their "
+             "requests up to this size while fetches complete quickly. Requests "
+             "are also bounded by --rpc_max_message_size.");
+TAG_FLAG(tablet_copy_max_transfer_chunk_size_bytes, advanced);
+TAG_FLAG(tablet_copy_max_transfer_chunk_size_bytes, runtime);
+
 METRIC_DEFINE_counter(server, tablet_copy_bytes_sent,
                       "Bytes Sent For Tablet Copy",
                       kudu::MetricUnit::kBytes,
@@ -84,6 +96,7 @@ using std::string;
 using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
+using tablet::Tablet;
 using tablet::TabletMetadata;
 using tablet::TabletReplica;
 
@@ -221,8 +234,9 @@ static int64_t DetermineReadLength(int64_t bytes_remaining, int64_t requested_le
   if (requested_len <= 0) {
     requested_len = FLAGS_tablet_copy_transfer_chunk_size_bytes;
   } else {
-    requested_len = std::min<int64_t>(requested_len,
-                                      FLAGS_tablet_copy_transfer_chunk_size_bytes);
+    requested_len = std::min<int64_t>(
+        requested_len, std::max(FLAGS_tablet_copy_transfer_chunk_size_bytes,
+                                FLAGS_tablet_copy_max_transfer_chunk_size_bytes));
   }
   requested_len = std::min<int64_t>(requested_len, FLAGS_rpc_max_message_size - kOverhead);
   CHECK_GT(requested_len, 0) << "rpc_max_message_size is too low to transfer data: "
@@ -260,7 +274,7 @@ template <class Info>
 static Status ReadFileChunkToBuf(const Info* info,
                                  uint64_t offset, int64_t client_maxlen,
                                  const string& data_name,
-                                 string* data, int64_t* file_size,
+                                 faststring* data, int64_t* file_size,
                                  TabletCopyErrorPB::Code* error_code) {
   int64_t response_data_size = 0;
   RETURN_NOT_OK_PREPEND(GetResponseDataSize(info->size, offset, client_maxlen, error_code,
@@ -270,11 +284,8 @@ static Status ReadFileChunkToBuf(const Info* info,
   Stopwatch chunk_timer(Stopwatch::THIS_THREAD);
   chunk_timer.start();
 
-  // Writing into a std::string buffer is basically guaranteed to work on C++11,
-  // however any modern compiler should be compatible with it.
-  // Violates the API contract, but avoids excessive copies.
   data->resize(response_data_size);
-  uint8_t* buf = reinterpret_cast<uint8_t*>(const_cast<char*>(data->data()));
+  uint8_t* buf = data->data();
   Slice slice(buf, response_data_size);
   Status s = info->Read(offset, slice);
   if (PREDICT_FALSE(!s.ok())) {
@@ -299,7 +310,7 @@ static Status ReadFileChunkToBuf(const Info* info,
 
 Status TabletCopySourceSession::GetBlockPiece(const BlockId& block_id,
                                              uint64_t offset, int64_t client_maxlen,
-                                             string* data, int64_t* block_file_size,
+                                             faststring* data, int64_t* block_file_size,
                                              TabletCopyErrorPB::Code* error_code) {
   DCHECK(init_once_.init_succeeded());
   RETURN_NOT_OK_PREPEND(CheckHealthyDirGroup(error_code),
@@ -307,9 +318,15 @@ Status TabletCopySourceSession::GetBlockPiece(const BlockId& block_id,
   ImmutableReadableBlockInfo* block_info;
   RETURN_NOT_OK(FindBlock(block_id, &block_info, error_code));
 
+  MonoTime start = MonoTime::Now();
   RETURN_NOT_OK(ReadFileChunkToBuf(block_info, offset, client_maxlen,
                                    Substitute("block $0", block_id.ToString()),
                                    data, block_file_size, error_code));
+  shared_ptr<Tablet> tablet = tablet_replica_->shared_tablet();
+  if (tablet && tablet->metrics()) {
+    tablet->metrics()->io.RecordRead(fs::IOContext::SOURCE_TABLET_COPY, data->size(),
+                                     MonoTime::Now() - start);
+  }
 
   // Note: We do not eagerly close the block, as doing so may delete the
   // underlying data if this was its last reader and it had been previously
@@ -321,7 +338,7 @@ Status TabletCopySourceSession::GetBlockPiece(const BlockId& block_id,
 
 Status TabletCopySourceSession::GetLogSegmentPiece(uint64_t segment_seqno,
                                                    uint64_t offset, int64_t client_maxlen,
-                                                   std::string* data, int64_t* log_file_size,
+                                                   faststring* data, int64_t* log_file_size,
                                                    TabletCopyErrorPB::Code* error_code) {
   DCHECK(init_once_.init_succeeded());
   RETURN_NOT_OK_PREPEND(CheckHealthyDirGroup(error_code),
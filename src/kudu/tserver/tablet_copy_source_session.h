@@ -36,6 +36,7 @@
 #include "kudu/tablet/metadata.pb.h"
 #include "kudu/tserver/tablet_copy.pb.h"
 #include "kudu/util/env.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/once.h"
 #include "kudu/util/slice.h"
@@ -125,15 +126,15 @@ class TabletCopySourceSession : public RefCountedThreadSafe<TabletCopySourceSess
 
   // Open block for reading, if it's not already open, and read some of it.
   // If maxlen is 0, we use a system-selected length for the data piece.
-  // *data is set to a std::string containing the data. Ownership of this object
-  // is passed to the caller. A string is used because the RPC interface is
-  // sending data serialized as protobuf and we want to minimize copying.
+  // *data is resized to the length of the piece and filled with its contents.
+  // A faststring is used so that the buffer can be handed off to the RPC
+  // layer as an outbound sidecar without further copying.
   // On error, Status is set to a non-OK value and error_code is filled in.
   //
   // This method is thread-safe.
   Status GetBlockPiece(const BlockId& block_id,
                        uint64_t offset, int64_t client_maxlen,
-                       std::string* data, int64_t* block_file_size,
+                       faststring* data, int64_t* block_file_size,
                        TabletCopyErrorPB::Code* error_code);
 
   // Get a piece of a log segment.
@@ -141,7 +142,7 @@ class TabletCopySourceSession : public RefCountedThreadSafe<TabletCopySourceSess
   // is only for sending WAL segment files.
   Status GetLogSegmentPiece(uint64_t segment_seqno,
                             uint64_t offset, int64_t client_maxlen,
-                            std::string* data, int64_t* log_file_size,
+                            faststring* data, int64_t* log_file_size,
                             TabletCopyErrorPB::Code* error_code);
 
   const tablet::TabletSuperBlockPB& tablet_superblock() const {
@@ -57,6 +57,10 @@ class TabletReplicaLookupIf {
 
   virtual const NodeInstancePB& NodeInstance() const = 0;
 
+  // Starts opening 'replica' if its opening was deferred until it's first
+  // accessed.
+  virtual void OpenTabletIfDeferred(const scoped_refptr<tablet::TabletReplica>& replica) = 0;
+
   virtual void StartTabletCopy(
       const consensus::StartTabletCopyRequestPB* req,
       std::function<void(const Status&, TabletServerErrorPB::Code)> cb) = 0;
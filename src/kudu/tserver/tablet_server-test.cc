@@ -44,6 +44,7 @@
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/partial_row.h"
 #include "kudu/common/partition.h"
+#include "kudu/common/row.h"
 #include "kudu/common/row_operations.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
@@ -70,6 +71,7 @@
 #include "kudu/rpc/messenger.h"
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/rpc/rpc_header.pb.h"
+#include "kudu/rpc/rpc_sidecar.h"
 #include "kudu/rpc/user_credentials.h"
 #include "kudu/server/rpc_server.h"
 #include "kudu/server/server_base.pb.h"
@@ -96,6 +98,7 @@
 #include "kudu/util/env.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/jsonwriter.h"
+#include "kudu/util/logging.h"
 #include "kudu/util/logging_test_util.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
@@ -121,6 +124,7 @@ using kudu::pb_util::SecureShortDebugString;
 using kudu::rpc::Messenger;
 using kudu::rpc::MessengerBuilder;
 using kudu::rpc::RpcController;
+using kudu::rpc::RpcSidecar;
 using kudu::tablet::RowSetDataPB;
 using kudu::tablet::Tablet;
 using kudu::tablet::TabletReplica;
@@ -152,6 +156,7 @@ DECLARE_double(cfile_inject_corruption);
 DECLARE_double(env_inject_eio);
 DECLARE_int32(flush_threshold_mb);
 DECLARE_int32(flush_threshold_secs);
+DECLARE_int32(hot_keys_sample_interval);
 DECLARE_int32(maintenance_manager_num_threads);
 DECLARE_int32(metrics_retirement_age_ms);
 DECLARE_int32(scanner_batch_size_rows);
@@ -916,6 +921,90 @@ TEST_F(TabletServerTest, TestExternalConsistencyModes_CommitWait) {
 }
 
 
+// Writes to two tablets in a MultiWrite RPC, one of which isn't hosted by the
+// server: only the write to the other one is applied.
+TEST_F(TabletServerTest, TestMultiWrite) {
+  MultiWriteRequestPB req;
+  for (const char* tablet_id : { kTabletId, "missing-tablet" }) {
+    WriteRequestPB* write = req.add_writes();
+    write->set_tablet_id(tablet_id);
+    ASSERT_OK(SchemaToPB(schema_, write->mutable_schema()));
+    AddTestRowToPB(RowOperationsPB::INSERT, schema_, 1, 1, "hello",
+                   write->mutable_row_operations());
+    AddTestRowToPB(RowOperationsPB::INSERT, schema_, 2, 2, "world",
+                   write->mutable_row_operations());
+  }
+  // A duplicate key is reported as a row error of its write.
+  AddTestRowToPB(RowOperationsPB::INSERT, schema_, 1, 3, "again",
+                 req.mutable_writes(0)->mutable_row_operations());
+
+  MultiWriteResponsePB resp;
+  RpcController controller;
+  controller.RequireServerFeature(TabletServerFeatures::MULTI_TABLET_WRITE);
+  SCOPED_TRACE(SecureDebugString(req));
+  ASSERT_OK(proxy_->MultiWrite(req, &resp, &controller));
+  SCOPED_TRACE(SecureDebugString(resp));
+  ASSERT_EQ(2, resp.responses_size());
+
+  const WriteResponsePB& applied = resp.responses(0);
+  ASSERT_FALSE(applied.has_error());
+  ASSERT_TRUE(applied.has_timestamp());
+  ASSERT_EQ(1, applied.per_row_errors_size());
+  ASSERT_EQ(2, applied.per_row_errors(0).row_index());
+  ASSERT_TRUE(StatusFromPB(applied.per_row_errors(0).error()).IsAlreadyPresent());
+
+  const WriteResponsePB& rejected = resp.responses(1);
+  ASSERT_TRUE(rejected.has_error());
+  ASSERT_EQ(TabletServerErrorPB::TABLET_NOT_FOUND, rejected.error().code());
+
+  VerifyRows(schema_, { KeyValue(1, 1), KeyValue(2, 2) });
+}
+
+// Writes rows whose encoded operations are sent in RPC sidecars.
+TEST_F(TabletServerTest, TestWriteWithRowOperationsSidecars) {
+  WriteRequestPB req;
+  req.set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToPB(schema_, req.mutable_schema()));
+  RowOperationsPB* data = req.mutable_row_operations();
+  AddTestRowToPB(RowOperationsPB::INSERT, schema_, 1, 1, "hello", data);
+  AddTestRowToPB(RowOperationsPB::INSERT, schema_, 2, 2, "world", data);
+  string rows;
+  string indirect_data;
+  rows.swap(*data->mutable_rows());
+  indirect_data.swap(*data->mutable_indirect_data());
+  data->clear_rows();
+  data->clear_indirect_data();
+
+  WriteResponsePB resp;
+  RpcController controller;
+  controller.RequireServerFeature(TabletServerFeatures::WRITE_ROW_OPERATIONS_SIDECARS);
+  int idx;
+  ASSERT_OK(controller.AddOutboundSidecar(RpcSidecar::FromSlice(Slice(rows)), &idx));
+  data->set_rows_sidecar(idx);
+  ASSERT_OK(controller.AddOutboundSidecar(RpcSidecar::FromSlice(Slice(indirect_data)), &idx));
+  data->set_indirect_data_sidecar(idx);
+  SCOPED_TRACE(SecureDebugString(req));
+  ASSERT_OK(proxy_->Write(req, &resp, &controller));
+  SCOPED_TRACE(SecureDebugString(resp));
+  ASSERT_FALSE(resp.has_error());
+  ASSERT_EQ(0, resp.per_row_errors_size());
+  VerifyRows(schema_, { KeyValue(1, 1), KeyValue(2, 2) });
+
+  // A request referencing a sidecar which wasn't sent is rejected.
+  controller.Reset();
+  data->set_rows_sidecar(idx + 1);
+  ASSERT_OK(proxy_->Write(req, &resp, &controller));
+  ASSERT_TRUE(resp.has_error());
+  ASSERT_EQ(TabletServerErrorPB::INVALID_MUTATION, resp.error().code());
+  ASSERT_STR_CONTAINS(StatusFromPB(resp.error().status()).ToString(),
+                      "invalid row operations sidecar");
+
+  // The data of the sidecars was replicated in the write request itself, so
+  // the rows are recovered from the WAL.
+  ASSERT_NO_FATAL_FAILURE(ShutdownAndRebuildTablet());
+  VerifyRows(schema_, { KeyValue(1, 1), KeyValue(2, 2) });
+}
+
 TEST_F(TabletServerTest, TestInsertAndMutate) {
 
   scoped_refptr<TabletReplica> tablet;
@@ -2221,6 +2310,60 @@ TEST_F(TabletServerTest, TestScanWithStringPredicates) {
   ASSERT_EQ(R"((int32 key=59, int32 int_val=118, string string_val="hello 59"))", results[9]);
 }
 
+TEST_F(TabletServerTest, TestScanProfile) {
+  InsertTestRowsDirect(0, 100);
+  ASSERT_OK(tablet_replica_->tablet()->Flush());
+
+  ScanRequestPB req;
+  ScanResponsePB resp;
+  RpcController rpc;
+
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+
+  // Only "hello 50" < string_val <= "hello 59" is returned.
+  ColumnRangePredicatePB* pred = scan->add_deprecated_range_predicates();
+  pred->mutable_column()->CopyFrom(scan->projected_columns(2));
+  pred->set_lower_bound("hello 50");
+  pred->set_inclusive_upper_bound("hello 59");
+
+  // The per-column profile is only returned when requested.
+  {
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_FALSE(resp.has_scan_profile());
+  }
+
+  req.set_include_scan_profile(true);
+  rpc.Reset();
+  {
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_FALSE(resp.has_more_results());
+  }
+
+  const ResourceMetricsPB& metrics = resp.resource_metrics();
+  ASSERT_EQ(100, metrics.rows_scanned());
+  ASSERT_EQ(10, metrics.rows_returned());
+  ASSERT_EQ(1, metrics.rowsets_read());
+  ASSERT_GT(metrics.cfile_cache_hit_blocks() + metrics.cfile_cache_miss_blocks(), 0);
+
+  ASSERT_EQ(schema_.num_columns(), resp.scan_profile().columns_size());
+  for (int i = 0; i < schema_.num_columns(); i++) {
+    const auto& column = resp.scan_profile().columns(i);
+    SCOPED_TRACE(SecureShortDebugString(column));
+    ASSERT_EQ(schema_.column(i).name(), column.column_name());
+    ASSERT_GT(column.cells_read(), 0);
+    ASSERT_GT(column.bytes_read(), 0);
+    ASSERT_GT(column.blocks_read(), 0);
+  }
+}
+
 TEST_F(TabletServerTest, TestNonPositiveLimitsShortCircuit) {
   InsertTestRowsDirect(0, 10);
   for (int limit : { -1, 0 }) {
@@ -2329,6 +2472,310 @@ TEST_F(TabletServerTest, TestScanWithPredicates) {
   ASSERT_EQ(50, results.size());
 }
 
+// Test a scan which returns the aggregates of the matching rows instead of
+// the rows themselves.
+TEST_F(TabletServerTest, TestAggregateScan) {
+  InsertTestRowsDirect(0, 1000);
+
+  ScanRequestPB req;
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  // Set up a range predicate: key >= 100.
+  ColumnPredicatePB* pred = scan->add_column_predicates();
+  pred->set_column("key");
+  int32_t lower_bound = 100;
+  pred->mutable_range()->mutable_lower()->append(reinterpret_cast<char*>(&lower_bound),
+                                                 sizeof(lower_bound));
+  const auto add_aggregate = [&](ScanAggregatePB::Type type, const string& column) {
+    ScanAggregatePB* agg = scan->add_aggregates();
+    agg->set_type(type);
+    if (!column.empty()) {
+      agg->set_column(column);
+    }
+  };
+  add_aggregate(ScanAggregatePB::COUNT, "");
+  add_aggregate(ScanAggregatePB::MIN, "int_val");
+  add_aggregate(ScanAggregatePB::MAX, "string_val");
+  add_aggregate(ScanAggregatePB::SUM, "int_val");
+  const Schema result_schema({ ColumnSchema("0:count(*)", INT64),
+                               ColumnSchema("1:min(int_val)", INT32, true),
+                               ColumnSchema("2:max(string_val)", STRING, true),
+                               ColumnSchema("3:sum(int_val)", INT64, true) },
+                             0);
+
+  // Use a small batch size to make sure the aggregates are carried across
+  // continuation requests.
+  req.set_batch_size_bytes(1);
+  vector<string> results;
+  ScanResponsePB resp;
+  RpcController rpc;
+  {
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    StringifyRowsFromResponse(result_schema, rpc, &resp, &results);
+  }
+  if (resp.has_more_results()) {
+    NO_FATALS(DrainScannerToStrings(resp.scanner_id(), result_schema, &results));
+  }
+  ASSERT_EQ(1, results.size());
+  // SUM(int_val) is 2 * (sum of [0, 1000) - sum of [0, 100)).
+  ASSERT_EQ(R"((int64 0:count(*)=900, int32 1:min(int_val)=200, )"
+            R"(string 2:max(string_val)="hello 999", int64 3:sum(int_val)=989100))",
+            results[0]);
+
+  // Aggregate scans can't project columns.
+  ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+  rpc.Reset();
+  ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+  ASSERT_TRUE(resp.has_error());
+  ASSERT_EQ(TabletServerErrorPB::INVALID_SCAN_SPEC, resp.error().code());
+  ASSERT_STR_CONTAINS(resp.error().status().message(), "Aggregate scans");
+}
+
+// Test an aggregate scan which groups the matching rows by a column.
+TEST_F(TabletServerTest, TestGroupByAggregateScan) {
+  InsertTestRowsDirect(0, 1000);
+
+  ScanRequestPB req;
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  // Set up a range predicate: key >= 995.
+  ColumnPredicatePB* pred = scan->add_column_predicates();
+  pred->set_column("key");
+  int32_t lower_bound = 995;
+  pred->mutable_range()->mutable_lower()->append(reinterpret_cast<char*>(&lower_bound),
+                                                 sizeof(lower_bound));
+  ScanAggregatePB* agg = scan->add_aggregates();
+  agg->set_type(ScanAggregatePB::SUM);
+  agg->set_column("key");
+  scan->add_group_by("string_val");
+  const Schema result_schema({ ColumnSchema("string_val", STRING, true),
+                               ColumnSchema("0:sum(key)", INT64, true) },
+                             0);
+
+  req.set_batch_size_bytes(1);
+  vector<string> results;
+  ScanResponsePB resp;
+  RpcController rpc;
+  {
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    StringifyRowsFromResponse(result_schema, rpc, &resp, &results);
+  }
+  if (resp.has_more_results()) {
+    NO_FATALS(DrainScannerToStrings(resp.scanner_id(), result_schema, &results));
+  }
+  std::sort(results.begin(), results.end());
+  ASSERT_EQ(5, results.size());
+  for (int i = 0; i < 5; i++) {
+    ASSERT_EQ(Substitute(R"((string string_val="hello $0", int64 0:sum(key)=$0))", 995 + i),
+              results[i]);
+  }
+}
+
+// Test building a bloom filter over a column of the rows matching a scan, and
+// using it as a predicate in another scan.
+TEST_F(TabletServerTest, TestBuildBloomFilterScan) {
+  InsertTestRowsDirect(0, 1000);
+
+  ScanRequestPB req;
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  // Set up a range predicate: key < 10.
+  ColumnPredicatePB* pred = scan->add_column_predicates();
+  pred->set_column("key");
+  int32_t upper_bound = 10;
+  pred->mutable_range()->mutable_upper()->append(reinterpret_cast<char*>(&upper_bound),
+                                                 sizeof(upper_bound));
+  ScanBloomFilterPB* bloom = scan->mutable_build_bloom_filter();
+  bloom->set_column("int_val");
+  bloom->set_expected_count(10);
+  const Schema result_schema({ ColumnSchema("nhash", INT32),
+                               ColumnSchema("bloom_data", BINARY) },
+                             0);
+
+  // Use a small batch size to make sure the filter is carried across
+  // continuation requests. The filter is returned in the last response.
+  req.set_batch_size_bytes(1);
+  ScanResponsePB resp;
+  RpcController rpc;
+  {
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+  }
+  int call_seq_id = 0;
+  while (resp.has_more_results()) {
+    ScanRequestPB continue_req;
+    continue_req.set_scanner_id(resp.scanner_id());
+    continue_req.set_call_seq_id(++call_seq_id);
+    rpc.Reset();
+    ASSERT_OK(proxy_->Scan(continue_req, &resp, &rpc));
+    ASSERT_FALSE(resp.has_error()) << SecureDebugString(resp);
+  }
+  RowwiseRowBlockPB* rrpb = resp.mutable_data();
+  ASSERT_EQ(1, rrpb->num_rows());
+  Slice direct;
+  Slice indirect;
+  ASSERT_OK(rpc.GetInboundSidecar(rrpb->rows_sidecar(), &direct));
+  ASSERT_OK(rpc.GetInboundSidecar(rrpb->indirect_data_sidecar(), &indirect));
+  vector<const uint8_t*> rows;
+  ASSERT_OK(ExtractRowsFromRowBlockPB(result_schema, *rrpb, indirect, &direct, &rows));
+  ASSERT_EQ(1, rows.size());
+  ConstContiguousRow row(&result_schema, rows[0]);
+  int32_t nhash = *reinterpret_cast<const int32_t*>(row.cell_ptr(0));
+  string bloom_data = reinterpret_cast<const Slice*>(row.cell_ptr(1))->ToString();
+
+  // Scan the rows whose 'int_val' is in the filter.
+  ScanRequestPB probe_req;
+  NewScanRequestPB* probe_scan = probe_req.mutable_new_scan_request();
+  probe_scan->set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToColumnPBs(schema_, probe_scan->mutable_projected_columns()));
+  ColumnPredicatePB* probe_pred = probe_scan->add_column_predicates();
+  probe_pred->set_column("int_val");
+  ColumnPredicatePB::BloomFilter* bf =
+      probe_pred->mutable_in_bloom_filter()->add_bloom_filters();
+  bf->set_nhash(nhash);
+  bf->set_bloom_data(bloom_data);
+  vector<string> results;
+  rpc.Reset();
+  {
+    SCOPED_TRACE(SecureDebugString(probe_req));
+    ASSERT_OK(proxy_->Scan(probe_req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    StringifyRowsFromResponse(schema_, rpc, &resp, &results);
+  }
+  if (resp.has_more_results()) {
+    NO_FATALS(DrainScannerToStrings(resp.scanner_id(), schema_, &results));
+  }
+  // The filter matches the rows it was built from, and few others.
+  for (int32_t key = 0; key < 10; key++) {
+    ASSERT_NE(results.end(), std::find(
+        results.begin(), results.end(),
+        Substitute(R"((int32 key=$0, int32 int_val=$1, string string_val="hello $0"))",
+                   key, key * 2)));
+  }
+  ASSERT_LT(results.size(), 100);
+
+  // Bloom filter scans can't have projected columns.
+  ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+  rpc.Reset();
+  ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+  ASSERT_TRUE(resp.has_error());
+  ASSERT_EQ(TabletServerErrorPB::INVALID_SCAN_SPEC, resp.error().code());
+  ASSERT_STR_CONTAINS(resp.error().status().message(), "Bloom filter scans");
+}
+
+// Test a scan which returns the first rows of the tablet in the order of a
+// column, rather than the first rows it finds.
+TEST_F(TabletServerTest, TestTopKScan) {
+  InsertTestRowsDirect(0, 1000);
+
+  ScanRequestPB req;
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+  scan->set_limit(5);
+  ScanOrderByPB* order_by = scan->add_order_by();
+  order_by->set_column("int_val");
+  order_by->set_descending(true);
+
+  // Use a small batch size to make sure the rows are carried across
+  // continuation requests.
+  req.set_batch_size_bytes(1);
+  vector<string> results;
+  ScanResponsePB resp;
+  RpcController rpc;
+  {
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    StringifyRowsFromResponse(schema_, rpc, &resp, &results);
+  }
+  if (resp.has_more_results()) {
+    NO_FATALS(DrainScannerToStrings(resp.scanner_id(), schema_, &results));
+  }
+  ASSERT_EQ(5, results.size());
+  for (int i = 0; i < 5; i++) {
+    int32_t key = 999 - i;
+    ASSERT_EQ(Substitute(R"((int32 key=$0, int32 int_val=$1, string string_val="hello $0"))",
+                         key, key * 2),
+              results[i]);
+  }
+
+  // Top-k scans require a limit.
+  scan->clear_limit();
+  rpc.Reset();
+  ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+  ASSERT_TRUE(resp.has_error());
+  ASSERT_EQ(TabletServerErrorPB::INVALID_SCAN_SPEC, resp.error().code());
+  ASSERT_STR_CONTAINS(resp.error().status().message(), "Top-k scans");
+}
+
+// Test paging through a tablet in decreasing primary key order.
+TEST_F(TabletServerTest, TestReverseOrderedScan) {
+  InsertTestRowsDirect(0, 100);
+
+  // Scans a page of 'page_size' rows ending before 'last_key' (if set),
+  // returning its rows and setting 'last_key' to resume from.
+  const auto scan_page = [&](int page_size, string* last_key, vector<string>* results) {
+    ScanRequestPB req;
+    NewScanRequestPB* scan = req.mutable_new_scan_request();
+    scan->set_tablet_id(kTabletId);
+    ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+    scan->set_read_mode(READ_AT_SNAPSHOT);
+    scan->set_order_mode(REVERSE_ORDERED);
+    scan->set_limit(page_size);
+    if (!last_key->empty()) {
+      scan->set_last_primary_key(*last_key);
+    }
+    ScanResponsePB resp;
+    RpcController rpc;
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    while (true) {
+      SCOPED_TRACE(SecureDebugString(resp));
+      ASSERT_FALSE(resp.has_error());
+      StringifyRowsFromResponse(schema_, rpc, &resp, results);
+      if (resp.has_last_primary_key()) {
+        *last_key = resp.last_primary_key();
+      }
+      if (!resp.has_more_results()) {
+        break;
+      }
+      ScanRequestPB continue_req;
+      continue_req.set_scanner_id(resp.scanner_id());
+      rpc.Reset();
+      ASSERT_OK(proxy_->Scan(continue_req, &resp, &rpc));
+    }
+  };
+
+  string last_key;
+  vector<string> results;
+  for (int page = 0; page < 4; page++) {
+    NO_FATALS(scan_page(30, &last_key, &results));
+  }
+  ASSERT_EQ(100, results.size());
+  for (int i = 0; i < 100; i++) {
+    int32_t key = 99 - i;
+    ASSERT_EQ(Substitute(R"((int32 key=$0, int32 int_val=$1, string string_val="hello $0"))",
+                         key, key * 2),
+              results[i]);
+  }
+
+  // The page after the last one is empty.
+  results.clear();
+  NO_FATALS(scan_page(30, &last_key, &results));
+  ASSERT_TRUE(results.empty());
+}
+
 TEST_F(TabletServerTest, TestScanWithEncodedPredicates) {
   InsertTestRowsDirect(0, 100);
 
@@ -2937,6 +3384,44 @@ TEST_F(TabletServerTest, TestDeleteTablet_TabletNotCreated) {
   }
 }
 
+TEST_F(TabletServerTest, TestGetHotTablets) {
+  // Sample every row operation, so that the counts of the keys are exact.
+  FLAGS_hot_keys_sample_interval = 1;
+  // The keys are decoded to be compared.
+  ScopedDisableRedaction no_redaction;
+
+  NO_FATALS(InsertTestRowsRemote(0, 10));
+  for (int i = 0; i < 9; i++) {
+    NO_FATALS(UpdateTestRowRemote(5, i));
+  }
+
+  GetHotTabletsRequestPB req;
+  GetHotTabletsResponsePB resp;
+  RpcController rpc;
+  req.set_max_keys_per_tablet(1);
+  {
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(admin_proxy_->GetHotTablets(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+  }
+  ASSERT_EQ(1, resp.tablets_size());
+  const HotTabletPB& tablet = resp.tablets(0);
+  ASSERT_EQ(kTabletId, tablet.tablet_id());
+  ASSERT_EQ(tablet_replica_->tablet_metadata()->table_name(), tablet.table_name());
+  ASSERT_GT(tablet.rows_written_per_sec(), 0);
+  ASSERT_EQ(1, tablet.written_keys_size());
+  ASSERT_EQ("(int32 key=5)", tablet.written_keys(0).key());
+  ASSERT_DOUBLE_EQ(10.0 / 19, tablet.written_keys(0).share());
+  ASSERT_EQ(0, tablet.read_keys_size());
+
+  // Negative limits are rejected.
+  req.set_max_tablets(-1);
+  rpc.Reset();
+  ASSERT_OK(admin_proxy_->GetHotTablets(req, &resp, &rpc));
+  ASSERT_TRUE(resp.has_error());
+}
+
 TEST_F(TabletServerTest, TestDeleteTabletBenchmark) {
   // Collect some related metrics.
   scoped_refptr<AtomicGauge<uint64_t>> block_count =
@@ -3231,6 +3716,36 @@ TEST_F(TabletServerTest, TestChecksumScan) {
   ASSERT_FALSE(resp.has_more_results());
 }
 
+// Test that checksum scans of many rows, in several rowsets and blocks, some
+// of whose rows are deleted, sum the checksums of the rows.
+TEST_F(TabletServerTest, TestChecksumScanManyRows) {
+  InsertTestRowsRemote(0, 1000);
+  ASSERT_OK(tablet_replica_->tablet()->Flush());
+  InsertTestRowsRemote(1000, 1000);
+  NO_FATALS(DeleteTestRowsRemote(500, 1000));
+
+  uint64_t expected_crc = 0;
+  for (int32_t key = 0; key < 2000; key++) {
+    if (key < 500 || key >= 1500) {
+      expected_crc += CalcTestRowChecksum(key);
+    }
+  }
+
+  ChecksumRequestPB req;
+  req.mutable_new_request()->set_tablet_id(kTabletId);
+  req.mutable_new_request()->set_read_mode(READ_LATEST);
+  req.set_call_seq_id(0);
+  ASSERT_OK(SchemaToColumnPBs(schema_, req.mutable_new_request()->mutable_projected_columns(),
+                              SCHEMA_PB_WITHOUT_IDS));
+  ChecksumResponsePB resp;
+  RpcController controller;
+  ASSERT_OK(proxy_->Checksum(req, &resp, &controller));
+  ASSERT_FALSE(resp.has_error()) << SecureDebugString(resp.error());
+  ASSERT_FALSE(resp.has_more_results());
+  ASSERT_EQ(1000, resp.rows_checksummed());
+  ASSERT_EQ(expected_crc, resp.checksum());
+}
+
 class DelayFsyncLogHook : public log::Log::LogFaultHooks {
  public:
   DelayFsyncLogHook() : log_latch1_(1), test_latch1_(1) {}
@@ -22,9 +22,13 @@
 #include <utility>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/cfile/block_cache.h"
+#include "kudu/cfile/block_cache_warmer.h"
+#include "kudu/codegen/compilation_manager.h"
+#include "kudu/fs/block_manager.h"
 #include "kudu/fs/error_manager.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/bind.h"
@@ -32,14 +36,29 @@
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/service_if.h"
 #include "kudu/tserver/heartbeater.h"
+#include "kudu/tserver/scan_scheduler.h"
 #include "kudu/tserver/scanners.h"
 #include "kudu/tserver/tablet_copy_service.h"
 #include "kudu/tserver/tablet_service.h"
 #include "kudu/tserver/ts_tablet_manager.h"
 #include "kudu/tserver/tserver_path_handlers.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/maintenance_manager.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/status.h"
+#include "kudu/util/threadpool.h"
+
+DEFINE_int32(scanner_parallel_threads, 0,
+             "The number of threads on which scans read the rowsets of a tablet "
+             "concurrently. If 0, the number of CPUs is used. See "
+             "--scanner_parallel_rowsets.");
+TAG_FLAG(scanner_parallel_threads, experimental);
+
+DECLARE_bool(block_cache_warmup);
+DECLARE_int32(scan_scheduler_max_concurrent_scans);
+
+METRIC_DECLARE_histogram(rpc_incoming_queue_time);
 
 using std::string;
 using std::vector;
@@ -70,7 +89,7 @@ TabletServer::TabletServer(const TabletServerOptions& opts)
     fail_heartbeats_for_tests_(false),
     opts_(opts),
     tablet_manager_(new TSTabletManager(this)),
-    scanner_manager_(new ScannerManager(metric_entity())),
+    scanner_manager_(new ScannerManager(metric_entity(), mem_tracker())),
     path_handlers_(new TabletServerPathHandlers(this)) {
 }
 
@@ -87,6 +106,8 @@ Status TabletServer::Init() {
   CHECK(!initted_);
 
   cfile::BlockCache::GetSingleton()->StartInstrumentation(metric_entity());
+  RETURN_NOT_OK(codegen::CompilationManager::GetSingleton()->StartInstrumentation(
+      metric_entity()));
 
   UnorderedHostPortSet master_addrs;
   for (auto addr : opts_.master_addresses) {
@@ -114,12 +135,28 @@ Status TabletServer::Init() {
 
   maintenance_manager_.reset(new MaintenanceManager(
       MaintenanceManager::kDefaultOptions, fs_manager_->uuid()));
+  // The service pools share the queue time histogram of the server.
+  maintenance_manager_->set_foreground_queue_time_histogram(
+      METRIC_rpc_incoming_queue_time.Instantiate(metric_entity()));
+  fs_manager_->block_manager()->RegisterMaintenanceOps(maintenance_manager_.get());
 
   heartbeater_.reset(new Heartbeater(std::move(master_addrs), this));
 
   RETURN_NOT_OK_PREPEND(tablet_manager_->Init(),
                         "Could not init Tablet Manager");
 
+  ThreadPoolBuilder scan_pool_builder("scan");
+  if (FLAGS_scanner_parallel_threads > 0) {
+    scan_pool_builder.set_max_threads(FLAGS_scanner_parallel_threads);
+  }
+  RETURN_NOT_OK(scan_pool_builder.Build(&scan_pool_));
+
+  if (FLAGS_scan_scheduler_max_concurrent_scans >= 0) {
+    scan_scheduler_.reset(new ScanScheduler(
+        ScanScheduler::DefaultMaxConcurrentScans(fs_manager_->GetDataRootDirs().size()),
+        metric_entity()));
+  }
+
   RETURN_NOT_OK_PREPEND(scanner_manager_->StartRemovalThread(),
                         "Could not start expired Scanner removal thread");
 
@@ -154,6 +191,15 @@ Status TabletServer::Start() {
   RETURN_NOT_OK(heartbeater_->Start());
   RETURN_NOT_OK(maintenance_manager_->Start());
 
+  if (FLAGS_block_cache_warmup) {
+    block_cache_warmer_.reset(new cfile::BlockCacheWarmer(
+        fs_manager_.get(), cfile::BlockCache::GetSingleton()));
+    TSTabletManager* tablet_manager = tablet_manager_.get();
+    RETURN_NOT_OK(block_cache_warmer_->Start([tablet_manager]() {
+      return tablet_manager->AreBootstrapsFinished();
+    }));
+  }
+
   google::FlushLogFiles(google::INFO); // Flush the startup messages.
 
   return Status::OK();
@@ -168,11 +214,15 @@ void TabletServer::Shutdown() {
     UnregisterAllServices();
 
     // 2. Shut down the tserver's subsystems.
+    if (block_cache_warmer_) {
+      block_cache_warmer_->Shutdown();
+    }
     maintenance_manager_->Shutdown();
     WARN_NOT_OK(heartbeater_->Stop(), "Failed to stop TS Heartbeat thread");
     fs_manager_->UnsetErrorNotificationCb(ErrorHandlerType::DISK_ERROR);
     fs_manager_->UnsetErrorNotificationCb(ErrorHandlerType::CFILE_CORRUPTION);
     tablet_manager_->Shutdown();
+    scan_pool_->Shutdown();
 
     // 3. Shut down generic subsystems.
     KuduServer::Shutdown();
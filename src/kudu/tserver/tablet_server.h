@@ -31,10 +31,16 @@
 namespace kudu {
 
 class MaintenanceManager;
+class ThreadPool;
+
+namespace cfile {
+class BlockCacheWarmer;
+} // namespace cfile
 
 namespace tserver {
 
 class Heartbeater;
+class ScanScheduler;
 class ScannerManager;
 class TabletServerPathHandlers;
 class TSTabletManager;
@@ -82,6 +88,13 @@ class TabletServer : public kserver::KuduServer {
     return maintenance_manager_.get();
   }
 
+  // The pool on which scans read the rowsets of a tablet concurrently.
+  ThreadPool* scan_pool() { return scan_pool_.get(); }
+
+  // The scheduler admitting scan requests, or nullptr if scan requests
+  // aren't scheduled.
+  ScanScheduler* scan_scheduler() { return scan_scheduler_.get(); }
+
  private:
   friend class TabletServerTestBase;
 
@@ -96,11 +109,18 @@ class TabletServer : public kserver::KuduServer {
   // Manager for tablets which are available on this server.
   gscoped_ptr<TSTabletManager> tablet_manager_;
 
+  // The pool on which scans read rowsets concurrently. Declared before the
+  // scanner manager so that it outlives the scanners using it.
+  gscoped_ptr<ThreadPool> scan_pool_;
+
   // Manager for open scanners from clients.
   // This is always non-NULL. It is scoped only to minimize header
   // dependencies.
   gscoped_ptr<ScannerManager> scanner_manager_;
 
+  // Admission control for scan requests.
+  std::unique_ptr<ScanScheduler> scan_scheduler_;
+
   // Thread responsible for heartbeating to the master.
   gscoped_ptr<Heartbeater> heartbeater_;
 
@@ -110,6 +130,9 @@ class TabletServer : public kserver::KuduServer {
   // The maintenance manager for this tablet server
   std::shared_ptr<MaintenanceManager> maintenance_manager_;
 
+  // Keeps the block cache warm across restarts, if enabled.
+  std::unique_ptr<cfile::BlockCacheWarmer> block_cache_warmer_;
+
   DISALLOW_COPY_AND_ASSIGN(TabletServer);
 };
 
@@ -33,9 +33,11 @@
 #include <gflags/gflags.h>
 #include <gflags/gflags_declare.h>
 #include <glog/logging.h>
+#include <google/protobuf/repeated_field.h>
 
 #include "kudu/clock/clock.h"
 #include "kudu/common/column_predicate.h"
+#include "kudu/common/columnar_serialization.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/encoded_key.h"
@@ -44,7 +46,10 @@
 #include "kudu/common/key_range.h"
 #include "kudu/common/partition.h"
 #include "kudu/common/rowblock.h"
+#include "kudu/common/scan_aggregator.h"
+#include "kudu/common/scan_bloom_filter_builder.h"
 #include "kudu/common/scan_spec.h"
+#include "kudu/common/scan_top_k.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
 #include "kudu/common/types.h"
@@ -81,6 +86,7 @@
 #include "kudu/tablet/transactions/alter_schema_transaction.h"
 #include "kudu/tablet/transactions/transaction.h"
 #include "kudu/tablet/transactions/write_transaction.h"
+#include "kudu/tserver/scan_scheduler.h"
 #include "kudu/tserver/scanners.h"
 #include "kudu/tserver/tablet_replica_lookup.h"
 #include "kudu/tserver/tablet_server.h"
@@ -88,7 +94,9 @@
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/tserver/tserver_admin.pb.h"
 #include "kudu/tserver/tserver_service.pb.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/auto_release_pool.h"
+#include "kudu/util/cpu_sampler.h"
 #include "kudu/util/crc.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/faststring.h"
@@ -96,11 +104,13 @@
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/memory/arena.h"
+#include "kudu/util/memory/memory.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/process_memory.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/status.h"
 #include "kudu/util/status_callback.h"
 #include "kudu/util/trace.h"
@@ -122,6 +132,44 @@ DEFINE_int32(scanner_batch_size_rows, 100,
 TAG_FLAG(scanner_batch_size_rows, advanced);
 TAG_FLAG(scanner_batch_size_rows, runtime);
 
+DEFINE_int32(scanner_parallel_rowsets, 1,
+             "The maximum number of rowsets of a tablet which an unordered scan "
+             "reads concurrently, on the scan thread pool of the tablet server. "
+             "If 1, the rowsets are read one after the other by the thread "
+             "handling the scan request.");
+TAG_FLAG(scanner_parallel_rowsets, experimental);
+TAG_FLAG(scanner_parallel_rowsets, runtime);
+
+DEFINE_int32(scanner_parallel_buffered_blocks, 8,
+             "The maximum number of blocks of up to 1000 rows read ahead by an "
+             "unordered scan which reads rowsets concurrently. This bounds the "
+             "memory used by each such scanner. See --scanner_parallel_rowsets.");
+TAG_FLAG(scanner_parallel_buffered_blocks, experimental);
+TAG_FLAG(scanner_parallel_buffered_blocks, runtime);
+
+DEFINE_int64(scanner_max_top_k_rows, 100000,
+             "The maximum limit of a top-k scan, i.e. of a scan which returns "
+             "the first rows of a tablet in the order of some columns. The "
+             "rows are kept in memory by the scanner until the whole tablet "
+             "was scanned.");
+TAG_FLAG(scanner_max_top_k_rows, advanced);
+TAG_FLAG(scanner_max_top_k_rows, runtime);
+
+DEFINE_int64(scanner_max_aggregate_groups, 100000,
+             "The maximum number of groups of an aggregate scan with grouping "
+             "columns. The aggregates of each group are kept in memory by the "
+             "scanner until the whole tablet was scanned.");
+TAG_FLAG(scanner_max_aggregate_groups, advanced);
+TAG_FLAG(scanner_max_aggregate_groups, runtime);
+
+DEFINE_int64(scanner_max_bloom_filter_bytes, 4 * 1024 * 1024,
+             "The maximum size in bytes of the bloom filter built by a scan "
+             "over a column of the matching rows. The filter is kept in "
+             "memory by the scanner until the whole tablet was scanned, and "
+             "is returned in a single response.");
+TAG_FLAG(scanner_max_bloom_filter_bytes, advanced);
+TAG_FLAG(scanner_max_bloom_filter_bytes, runtime);
+
 DEFINE_bool(scanner_allow_snapshot_scans_with_logical_timestamps, false,
             "If set, the server will support snapshot scans with logical timestamps.");
 TAG_FLAG(scanner_allow_snapshot_scans_with_logical_timestamps, unsafe);
@@ -133,6 +181,13 @@ DEFINE_int32(scanner_max_wait_ms, 1000,
 TAG_FLAG(scanner_max_wait_ms, advanced);
 
 // Fault injection flags.
+DEFINE_bool(scanner_request_safe_time_from_leader, true,
+            "Whether a snapshot scan on a follower which has to wait for the safe "
+            "time to advance asks the leader to send its safe time, rather than "
+            "waiting for the next heartbeat from the leader.");
+TAG_FLAG(scanner_request_safe_time_from_leader, advanced);
+TAG_FLAG(scanner_request_safe_time_from_leader, runtime);
+
 DEFINE_int32(scanner_inject_latency_on_each_batch_ms, 0,
              "If set, the scanner will pause the specified number of milliesconds "
              "before reading each batch of data on the tablet server. "
@@ -144,6 +199,15 @@ DEFINE_bool(scanner_inject_service_unavailable_on_continue_scan, false,
            "any Scan continuation RPC call. Used for tests.");
 TAG_FLAG(scanner_inject_service_unavailable_on_continue_scan, unsafe);
 
+DEFINE_int32(write_backpressure_max_delay_ms, 100,
+             "Maximum delay, in milliseconds, the tablet server asks clients to "
+             "wait before sending more writes when it's running low on memory. "
+             "The requested delay grows from 0, once the memory pressure "
+             "threshold is reached, to this value at the soft memory limit. "
+             "If 0, no delay is requested.");
+TAG_FLAG(write_backpressure_max_delay_ms, advanced);
+TAG_FLAG(write_backpressure_max_delay_ms, runtime);
+
 DEFINE_bool(tserver_enforce_access_control, false,
             "If set, the server will apply fine-grained access control rules "
             "to client RPCs.");
@@ -156,7 +220,10 @@ TAG_FLAG(tserver_inject_invalid_authz_token_ratio, hidden);
 
 DECLARE_bool(raft_prepare_replacement_before_eviction);
 DECLARE_int32(memory_limit_warn_threshold_percentage);
+DECLARE_int32(scan_scheduler_max_wait_ms);
 DECLARE_int32(tablet_history_max_age_sec);
+DECLARE_int64(scanner_memory_limit_mb);
+DECLARE_string(scan_scheduler_fairness);
 
 using google::protobuf::RepeatedPtrField;
 using kudu::consensus::BulkChangeConfigRequestPB;
@@ -170,10 +237,14 @@ using kudu::consensus::GetNodeInstanceResponsePB;
 using kudu::consensus::LeaderStepDownMode;
 using kudu::consensus::LeaderStepDownRequestPB;
 using kudu::consensus::LeaderStepDownResponsePB;
+using kudu::consensus::MultiUpdateConsensusRequestPB;
+using kudu::consensus::MultiUpdateConsensusResponsePB;
 using kudu::consensus::OpId;
 using kudu::consensus::RaftConsensus;
 using kudu::consensus::RunLeaderElectionRequestPB;
 using kudu::consensus::RunLeaderElectionResponsePB;
+using kudu::consensus::SendSafeTimeRequestPB;
+using kudu::consensus::SendSafeTimeResponsePB;
 using kudu::consensus::StartTabletCopyRequestPB;
 using kudu::consensus::StartTabletCopyResponsePB;
 using kudu::consensus::TimeManager;
@@ -217,6 +288,26 @@ namespace tserver {
 
 namespace {
 
+// Lookup the given tablet, only ensuring that it exists. If it does not,
+// returns the failure reason and sets 'error_code' accordingly.
+Status LookupTabletReplica(TabletReplicaLookupIf* tablet_manager,
+                           const string& tablet_id,
+                           scoped_refptr<TabletReplica>* replica,
+                           TabletServerErrorPB::Code* error_code) {
+  Status s = tablet_manager->GetTabletReplica(tablet_id, replica);
+  if (PREDICT_FALSE(!s.ok())) {
+    // If the tablet manager isn't initialized, the remote should check again
+    // soon.
+    *error_code = s.IsServiceUnavailable() ? TabletServerErrorPB::UNKNOWN_ERROR
+                                           : TabletServerErrorPB::TABLET_NOT_FOUND;
+    return s;
+  }
+  // The first access to a replica whose opening was deferred opens it. Until
+  // it's RUNNING, the requests fail with TABLET_NOT_RUNNING and are retried.
+  tablet_manager->OpenTabletIfDeferred(*replica);
+  return s;
+}
+
 // Lookup the given tablet, only ensuring that it exists.
 // If it does not, responds to the RPC associated with 'context' after setting
 // resp->mutable_error() to indicate the failure reason.
@@ -228,40 +319,43 @@ bool LookupTabletReplicaOrRespond(TabletReplicaLookupIf* tablet_manager,
                                   RespClass* resp,
                                   rpc::RpcContext* context,
                                   scoped_refptr<TabletReplica>* replica) {
-  Status s = tablet_manager->GetTabletReplica(tablet_id, replica);
+  TabletServerErrorPB::Code error_code;
+  Status s = LookupTabletReplica(tablet_manager, tablet_id, replica, &error_code);
   if (PREDICT_FALSE(!s.ok())) {
-    if (s.IsServiceUnavailable()) {
-      // If the tablet manager isn't initialized, the remote should check again
-      // soon.
-      SetupErrorAndRespond(resp->mutable_error(), s,
-                           TabletServerErrorPB::UNKNOWN_ERROR, context);
-    } else {
-      SetupErrorAndRespond(resp->mutable_error(), s,
-                           TabletServerErrorPB::TABLET_NOT_FOUND, context);
-    }
+    SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
     return false;
   }
   return true;
 }
 
-template<class RespClass>
-void RespondTabletNotRunning(const scoped_refptr<TabletReplica>& replica,
+// Returns the error for a replica which isn't RUNNING, setting 'error_code'
+// accordingly.
+Status TabletNotRunningError(const scoped_refptr<TabletReplica>& replica,
                              tablet::TabletStatePB tablet_state,
-                             RespClass* resp,
-                             rpc::RpcContext* context) {
+                             TabletServerErrorPB::Code* error_code) {
   Status s = Status::IllegalState("Tablet not RUNNING",
                                   tablet::TabletStatePB_Name(tablet_state));
-  auto error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
+  *error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
   if (replica->tablet_metadata()->tablet_data_state() == TABLET_DATA_TOMBSTONED ||
       replica->tablet_metadata()->tablet_data_state() == TABLET_DATA_DELETED) {
     // Treat tombstoned tablets as if they don't exist for most purposes.
     // This takes precedence over failed, since we don't reset the failed
     // status of a TabletReplica when deleting it. Only tablet copy does that.
-    error_code = TabletServerErrorPB::TABLET_NOT_FOUND;
+    *error_code = TabletServerErrorPB::TABLET_NOT_FOUND;
   } else if (tablet_state == tablet::FAILED) {
     s = s.CloneAndAppend(replica->error().ToString());
-    error_code = TabletServerErrorPB::TABLET_FAILED;
+    *error_code = TabletServerErrorPB::TABLET_FAILED;
   }
+  return s;
+}
+
+template<class RespClass>
+void RespondTabletNotRunning(const scoped_refptr<TabletReplica>& replica,
+                             tablet::TabletStatePB tablet_state,
+                             RespClass* resp,
+                             rpc::RpcContext* context) {
+  TabletServerErrorPB::Code error_code;
+  Status s = TabletNotRunningError(replica, tablet_state, &error_code);
   SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
 }
 
@@ -452,6 +546,7 @@ static bool GetScanPrivilegesOrRespond(const NewScanRequestPB& scan_pb, const Sc
   // Ordered scans and any scans that make use of the primary key require
   // privileges to scan across all primary key columns.
   if (scan_pb.order_mode() == ORDERED ||
+      scan_pb.order_mode() == REVERSE_ORDERED ||
       scan_pb.has_start_primary_key() ||
       scan_pb.has_stop_primary_key() ||
       scan_pb.has_last_primary_key()) {
@@ -467,6 +562,15 @@ static bool GetScanPrivilegesOrRespond(const NewScanRequestPB& scan_pb, const Sc
     }
     EmplaceIfNotPresent(&required_privileges, schema.column_id(col_idx));
   }
+  // A bloom filter exposes the values of the column it is built over.
+  if (scan_pb.has_build_bloom_filter()) {
+    int col_idx = schema.find_column(scan_pb.build_bloom_filter().column());
+    if (col_idx == Schema::kColumnNotFound) {
+      respond_not_authorized(scan_pb.build_bloom_filter().column());
+      return false;
+    }
+    EmplaceIfNotPresent(&required_privileges, schema.column_id(col_idx));
+  }
   // Do the same for the DEPRECATED_range_predicates field. Even though this
   // field is deprecated, it is still exposed as a part of our public API and
   // thus needs to be taken into account.
@@ -698,9 +802,159 @@ void SetLastRow(const RowBlock& row_block, faststring* last_primary_key) {
   }
 }
 
+// Pass the result rows of the aggregates computed by 'scanner' to 'collector'.
+void CollectAggregateResult(Scanner* scanner, ScanResultCollector* collector) {
+  const ScanAggregator* aggregator = DCHECK_NOTNULL(scanner->aggregator());
+  if (aggregator->num_groups() == 0) {
+    return;
+  }
+  Arena arena(1024);
+  RowBlock block(aggregator->result_schema(), aggregator->num_groups(), &arena);
+  block.selection_vector()->SetAllTrue();
+  aggregator->GetResult(&block);
+  collector->HandleRowBlock(scanner, block);
+}
+
+// Pass the rows kept by the top-k scan of 'scanner' to 'collector', in order.
+Status CollectTopKResult(Scanner* scanner, const Schema& schema,
+                         ScanResultCollector* collector) {
+  const ScanTopK* top_k = DCHECK_NOTNULL(scanner->top_k());
+  if (top_k->num_rows() == 0) {
+    return Status::OK();
+  }
+  Arena arena(32 * 1024);
+  RowBlock block(schema, top_k->num_rows(), &arena);
+  block.selection_vector()->SetAllTrue();
+  RETURN_NOT_OK(top_k->GetResult(&block));
+  collector->HandleRowBlock(scanner, block);
+  return Status::OK();
+}
+
+// Pass the result row of the bloom filter built by 'scanner' to 'collector'.
+Status CollectBloomFilterResult(Scanner* scanner, ScanResultCollector* collector) {
+  const ScanBloomFilterBuilder* builder = DCHECK_NOTNULL(scanner->bloom_filter_builder());
+  Arena arena(32 * 1024);
+  RowBlock block(builder->result_schema(), 1, &arena);
+  block.selection_vector()->SetAllTrue();
+  RETURN_NOT_OK(builder->GetResult(&block));
+  collector->HandleRowBlock(scanner, block);
+  return Status::OK();
+}
+
 }  // namespace
 
-// Copies the scan result to the given row block PB and data buffers.
+// Serializes the selected rows of scan results into a ScanResponsePB and its
+// sidecars, in one of the supported wire layouts.
+class ResultSerializer {
+ public:
+  virtual ~ResultSerializer() = default;
+
+  // Append the selected rows of 'row_block' to the serialized result.
+  virtual void AddRowBlock(const Scanner* scanner, const RowBlock& row_block) = 0;
+
+  // Returns number of bytes buffered to return.
+  virtual int64_t ResponseSize() const = 0;
+
+  // Attach the serialized data to 'resp' and the sidecars of 'context'.
+  virtual void SetupResponse(rpc::RpcContext* context, ScanResponsePB* resp) = 0;
+};
+
+// Serializes scan results in the row-wise layout of RowwiseRowBlockPB.
+class RowwiseResultSerializer : public ResultSerializer {
+ public:
+  RowwiseResultSerializer(int batch_size_bytes, uint64_t row_format_flags)
+      : rows_data_(new faststring(batch_size_bytes * 11 / 10)),
+        indirect_data_(new faststring(batch_size_bytes * 11 / 10)),
+        pad_unixtime_micros_to_16_bytes_(
+            row_format_flags & RowFormatFlags::PAD_UNIX_TIME_MICROS_TO_16_BYTES) {}
+
+  void AddRowBlock(const Scanner* scanner, const RowBlock& row_block) override {
+    SerializeRowBlock(row_block, &rowblock_pb_, scanner->client_projection_schema(),
+                      rows_data_.get(), indirect_data_.get(), pad_unixtime_micros_to_16_bytes_);
+  }
+
+  int64_t ResponseSize() const override {
+    return rows_data_->size() + indirect_data_->size();
+  }
+
+  void SetupResponse(rpc::RpcContext* context, ScanResponsePB* resp) override {
+    resp->mutable_data()->CopyFrom(rowblock_pb_);
+
+    // Add sidecar data to context and record the returned indices.
+    int rows_idx;
+    CHECK_OK(context->AddOutboundSidecar(
+        RpcSidecar::FromFaststring(std::move(rows_data_)), &rows_idx));
+    resp->mutable_data()->set_rows_sidecar(rows_idx);
+
+    // Add indirect data as a sidecar, if applicable.
+    if (indirect_data_->size() > 0) {
+      int indirect_idx;
+      CHECK_OK(context->AddOutboundSidecar(
+          RpcSidecar::FromFaststring(std::move(indirect_data_)), &indirect_idx));
+      resp->mutable_data()->set_indirect_data_sidecar(indirect_idx);
+    }
+  }
+
+ private:
+  RowwiseRowBlockPB rowblock_pb_;
+  unique_ptr<faststring> rows_data_;
+  unique_ptr<faststring> indirect_data_;
+  const bool pad_unixtime_micros_to_16_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(RowwiseResultSerializer);
+};
+
+// Serializes scan results in the columnar layout of ColumnarRowBlockPB.
+class ColumnarResultSerializer : public ResultSerializer {
+ public:
+  ColumnarResultSerializer() = default;
+
+  void AddRowBlock(const Scanner* scanner, const RowBlock& row_block) override {
+    if (!batch_) {
+      const Schema* projection = scanner->client_projection_schema();
+      batch_.reset(new ColumnarSerializedBatch(row_block.schema(),
+                                               projection ? *projection : row_block.schema()));
+    }
+    batch_->AddRowBlock(row_block);
+  }
+
+  int64_t ResponseSize() const override {
+    return batch_ ? batch_->TotalSizeBytes() : 0;
+  }
+
+  void SetupResponse(rpc::RpcContext* context, ScanResponsePB* resp) override {
+    ColumnarRowBlockPB* data = resp->mutable_columnar_data();
+    if (!batch_) {
+      data->set_num_rows(0);
+      return;
+    }
+    data->set_num_rows(batch_->num_rows());
+    for (auto& col : *batch_->mutable_columns()) {
+      ColumnarRowBlockPB::Column* col_pb = data->add_columns();
+      int sidecar_idx;
+      CHECK_OK(context->AddOutboundSidecar(
+          RpcSidecar::FromFaststring(std::move(col.data)), &sidecar_idx));
+      col_pb->set_data_sidecar(sidecar_idx);
+      if (col.varlen_data) {
+        CHECK_OK(context->AddOutboundSidecar(
+            RpcSidecar::FromFaststring(std::move(col.varlen_data)), &sidecar_idx));
+        col_pb->set_varlen_data_sidecar(sidecar_idx);
+      }
+      if (col.non_null_bitmap) {
+        CHECK_OK(context->AddOutboundSidecar(
+            RpcSidecar::FromFaststring(std::move(col.non_null_bitmap)), &sidecar_idx));
+        col_pb->set_non_null_bitmap_sidecar(sidecar_idx);
+      }
+    }
+  }
+
+ private:
+  unique_ptr<ColumnarSerializedBatch> batch_;
+
+  DISALLOW_COPY_AND_ASSIGN(ColumnarResultSerializer);
+};
+
+// Copies the scan result into the response and its sidecars.
 //
 // This implementation is used in the common case where a client is running
 // a scan and the data needs to be returned to the client.
@@ -710,14 +964,9 @@ void SetLastRow(const RowBlock& row_block, faststring* last_primary_key) {
 // server-side scan and thus never need to return the actual data.)
 class ScanResultCopier : public ScanResultCollector {
  public:
-  ScanResultCopier(RowwiseRowBlockPB* rowblock_pb,
-                   faststring* rows_data,
-                   faststring* indirect_data)
-      : rowblock_pb_(DCHECK_NOTNULL(rowblock_pb)),
-        rows_data_(DCHECK_NOTNULL(rows_data)),
-        indirect_data_(DCHECK_NOTNULL(indirect_data)),
-        num_rows_returned_(0),
-        pad_unixtime_micros_to_16_bytes_(false) {}
+  explicit ScanResultCopier(int batch_size_bytes)
+      : batch_size_bytes_(batch_size_bytes),
+        num_rows_returned_(0) {}
 
   void HandleRowBlock(Scanner* scanner, const RowBlock& row_block) override {
     int64_t num_selected = row_block.selection_vector()->CountSelected();
@@ -727,14 +976,13 @@ class ScanResultCopier : public ScanResultCollector {
 
     num_rows_returned_ += num_selected;
     scanner->add_num_rows_returned(num_selected);
-    SerializeRowBlock(row_block, rowblock_pb_, scanner->client_projection_schema(),
-                      rows_data_, indirect_data_, pad_unixtime_micros_to_16_bytes_);
+    serializer()->AddRowBlock(scanner, row_block);
     SetLastRow(row_block, &last_primary_key_);
   }
 
   // Returns number of bytes buffered to return.
   int64_t ResponseSize() const override {
-    return rows_data_->size() + indirect_data_->size();
+    return serializer_ ? serializer_->ResponseSize() : 0;
   }
 
   const faststring& last_primary_key() const override {
@@ -746,28 +994,48 @@ class ScanResultCopier : public ScanResultCollector {
   }
 
   void set_row_format_flags(uint64_t row_format_flags) override {
-    if (row_format_flags & RowFormatFlags::PAD_UNIX_TIME_MICROS_TO_16_BYTES) {
-      pad_unixtime_micros_to_16_bytes_ = true;
+    // The flags can't change over the lifetime of a scanner, so once the
+    // serializer has been created it stays valid.
+    if (serializer_) return;
+    if (row_format_flags & RowFormatFlags::COLUMNAR_LAYOUT) {
+      serializer_.reset(new ColumnarResultSerializer());
+    } else {
+      serializer_.reset(new RowwiseResultSerializer(batch_size_bytes_, row_format_flags));
     }
   }
 
+  // Attach the collected data to 'resp' and the sidecars of 'context'.
+  void SetupResponse(rpc::RpcContext* context, ScanResponsePB* resp) {
+    serializer()->SetupResponse(context, resp);
+  }
+
  private:
-  RowwiseRowBlockPB* const rowblock_pb_;
-  faststring* const rows_data_;
-  faststring* const indirect_data_;
+  ResultSerializer* serializer() {
+    if (!serializer_) {
+      set_row_format_flags(RowFormatFlags::NO_FLAGS);
+    }
+    return serializer_.get();
+  }
+
+  const int batch_size_bytes_;
+  unique_ptr<ResultSerializer> serializer_;
   int64_t num_rows_returned_;
   faststring last_primary_key_;
-  bool pad_unixtime_micros_to_16_bytes_;
 
   DISALLOW_COPY_AND_ASSIGN(ScanResultCopier);
 };
 
 // Checksums the scan result.
+//
+// The checksum of a row is the CRC32C of the concatenation of, for each column
+// of the client projection, the index of the column, a byte of whether the
+// cell is defined if the column is nullable, and the cell data, if any. The
+// checksum of the result is the sum of those of its rows, which doesn't
+// depend on the order of the rows.
 class ScanResultChecksummer : public ScanResultCollector {
  public:
   ScanResultChecksummer()
-      : crc_(crc::GetCrc32cInstance()),
-        agg_checksum_(0),
+      : agg_checksum_(0),
         rows_checksummed_(0) {
   }
 
@@ -779,13 +1047,26 @@ class ScanResultChecksummer : public ScanResultCollector {
       client_projection_schema = &row_block.schema();
     }
 
-    size_t nrows = row_block.nrows();
-    for (size_t i = 0; i < nrows; i++) {
-      if (!row_block.selection_vector()->IsRowSelected(i)) continue;
-      uint32_t row_crc = CalcRowCrc32(*client_projection_schema, row_block.row(i));
+    const SelectionVector* sel = row_block.selection_vector();
+    selected_rows_.clear();
+    for (size_t i = 0; i < row_block.nrows(); i++) {
+      if (sel->IsRowSelected(i)) {
+        selected_rows_.push_back(i);
+      }
+    }
+
+    // The CRC of a row is extended column by column, so the cells of a
+    // column are checksummed together, rather than copying each row to a
+    // buffer first.
+    row_crcs_.assign(selected_rows_.size(), 0);
+    for (size_t j = 0; j < client_projection_schema->num_columns(); j++) {
+      ChecksumColumn(j, row_block.column_block(j));
+    }
+    for (uint32_t row_crc : row_crcs_) {
       agg_checksum_ += row_crc;
-      rows_checksummed_++;
     }
+    rows_checksummed_ += selected_rows_.size();
+
     // Find the last selected row and save its encoded key.
     SetLastRow(row_block, &encoded_last_row_);
   }
@@ -808,35 +1089,56 @@ class ScanResultChecksummer : public ScanResultCollector {
   uint64_t agg_checksum() const { return agg_checksum_; }
 
  private:
-  // Calculates a CRC32C for the given row.
-  uint32_t CalcRowCrc32(const Schema& projection, const RowBlockRow& row) {
-    tmp_buf_.clear();
-
-    for (size_t j = 0; j < projection.num_columns(); j++) {
-      uint32_t col_index = static_cast<uint32_t>(j);  // For the CRC.
-      tmp_buf_.append(&col_index, sizeof(col_index));
-      ColumnBlockCell cell = row.cell(j);
-      if (cell.is_nullable()) {
-        uint8_t is_defined = cell.is_null() ? 0 : 1;
-        tmp_buf_.append(&is_defined, sizeof(is_defined));
-        if (!is_defined) continue;
+  // Extends the CRCs of the selected rows with their cells of the column at
+  // index 'col_idx' of the projection, whose data is 'block'.
+  void ChecksumColumn(size_t col_idx, const ColumnBlock& block) {
+    // The column index, the definition byte and up to 16 bytes of cell data.
+    uint8_t buf[sizeof(uint32_t) + 1 + 16];
+    const uint32_t col_index = static_cast<uint32_t>(col_idx);  // For the CRC.
+    memcpy(buf, &col_index, sizeof(col_index));
+    const bool nullable = block.is_nullable();
+    const size_t prefix_size = sizeof(col_index) + (nullable ? 1 : 0);
+    uint8_t* is_defined = buf + sizeof(col_index);
+
+    if (block.type_info()->physical_type() == BINARY) {
+      for (size_t k = 0; k < selected_rows_.size(); k++) {
+        const size_t row_idx = selected_rows_[k];
+        const bool is_null = nullable && block.is_null(row_idx);
+        if (nullable) {
+          *is_defined = is_null ? 0 : 1;
+        }
+        uint32_t crc = crc::Crc32c(buf, prefix_size, row_crcs_[k]);
+        if (!is_null) {
+          const Slice* data = reinterpret_cast<const Slice*>(block.cell_ptr(row_idx));
+          crc = crc::Crc32c(data->data(), data->size(), crc);
+        }
+        row_crcs_[k] = crc;
       }
-      if (cell.typeinfo()->physical_type() == BINARY) {
-        const Slice* data = reinterpret_cast<const Slice *>(cell.ptr());
-        tmp_buf_.append(data->data(), data->size());
+      return;
+    }
+
+    // The prefix and the data of fixed-size cells are checksummed together.
+    const size_t size = block.type_info()->size();
+    DCHECK_LE(prefix_size + size, sizeof(buf));
+    for (size_t k = 0; k < selected_rows_.size(); k++) {
+      const size_t row_idx = selected_rows_[k];
+      size_t len = prefix_size;
+      if (nullable && block.is_null(row_idx)) {
+        *is_defined = 0;
       } else {
-        tmp_buf_.append(cell.ptr(), cell.size());
+        if (nullable) {
+          *is_defined = 1;
+        }
+        memcpy(buf + prefix_size, block.cell_ptr(row_idx), size);
+        len += size;
       }
+      row_crcs_[k] = crc::Crc32c(buf, len, row_crcs_[k]);
     }
-
-    uint64_t row_crc = 0;
-    crc_->Compute(tmp_buf_.data(), tmp_buf_.size(), &row_crc, nullptr);
-    return static_cast<uint32_t>(row_crc); // CRC32 only uses the lower 32 bits.
   }
 
-
-  faststring tmp_buf_;
-  crc::Crc* const crc_;
+  // The indexes of the selected rows of the current block, and their CRCs.
+  vector<size_t> selected_rows_;
+  vector<uint32_t> row_crcs_;
   uint64_t agg_checksum_;
   int64_t rows_checksummed_;
   faststring encoded_last_row_;
@@ -1061,6 +1363,24 @@ void TabletServiceAdminImpl::DeleteTablet(const DeleteTabletRequestPB* req,
                                                response_callback);
 }
 
+void TabletServiceAdminImpl::GetHotTablets(const GetHotTabletsRequestPB* req,
+                                           GetHotTabletsResponsePB* resp,
+                                           rpc::RpcContext* context) {
+  if (req->max_tablets() < 0 || req->max_keys_per_tablet() < 0) {
+    SetupErrorAndRespond(resp->mutable_error(),
+                         Status::InvalidArgument("the limits must not be negative"),
+                         TabletServerErrorPB::UNKNOWN_ERROR, context);
+    return;
+  }
+  vector<HotTabletPB> tablets;
+  server_->tablet_manager()->GetHotTablets(req->max_tablets(), req->max_keys_per_tablet(),
+                                           &tablets);
+  for (auto& tablet : tablets) {
+    resp->add_tablets()->Swap(&tablet);
+  }
+  context->RespondSuccess();
+}
+
 void TabletServiceImpl::Write(const WriteRequestPB* req,
                               WriteResponsePB* resp,
                               rpc::RpcContext* context) {
@@ -1068,44 +1388,215 @@ void TabletServiceImpl::Write(const WriteRequestPB* req,
                "tablet_id", req->tablet_id());
   DVLOG(3) << "Received Write RPC: " << SecureDebugString(*req);
 
+  if (FLAGS_tserver_enforce_access_control && !VerifyWritePrivilegesOrRespond(*req, context)) {
+    return;
+  }
+
+  TabletServerErrorPB::Code error_code;
+  Status s = SubmitWrite(req, resp, context,
+                         context->AreResultsTracked() ? context->request_id() : nullptr,
+                         gscoped_ptr<TransactionCompletionCallback>(
+                             new RpcTransactionCompletionCallback<WriteResponsePB>(context, resp)),
+                         &error_code);
+  // Check that we could submit the write. Otherwise, the RPC will be
+  // responded to asynchronously.
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
+  }
+}
+
+namespace {
+
+// The state of a MultiWrite RPC, which is responded to once all its writes
+// have completed.
+class MultiWriteState : public RefCountedThreadSafe<MultiWriteState> {
+ public:
+  MultiWriteState(rpc::RpcContext* context, int num_writes)
+      : context_(context),
+        // Hold one more reference for the submission of the writes.
+        num_pending_(num_writes + 1) {
+  }
+
+  // Marks one of the writes, or the submission of all of them, as completed.
+  void WriteCompleted() {
+    if (num_pending_.IncrementBy(-1) == 0) {
+      context_->RespondSuccess();
+    }
+  }
+
+ private:
+  friend class RefCountedThreadSafe<MultiWriteState>;
+  ~MultiWriteState() {}
+
+  rpc::RpcContext* context_;
+  AtomicInt<int32_t> num_pending_;
+
+  DISALLOW_COPY_AND_ASSIGN(MultiWriteState);
+};
+
+// A transaction completion callback for one of the writes of a MultiWrite
+// RPC, which sets the error of the write's response if there is one to set.
+class MultiWriteCompletionCallback : public TransactionCompletionCallback {
+ public:
+  MultiWriteCompletionCallback(scoped_refptr<MultiWriteState> state,
+                               WriteResponsePB* response)
+      : state_(std::move(state)),
+        response_(response) {}
+
+  void TransactionCompleted() override {
+    if (!status_.ok()) {
+      StatusToPB(status_, response_->mutable_error()->mutable_status());
+      response_->mutable_error()->set_code(code_);
+    }
+    state_->WriteCompleted();
+  }
+
+ private:
+  scoped_refptr<MultiWriteState> state_;
+  WriteResponsePB* response_;
+};
+
+// Sets 'rows' and 'indirect_data' to the encoded row operations of a write
+// request, which are either in 'pb' itself or in sidecars of the call.
+Status GetRowOperationsData(const RowOperationsPB& pb,
+                            const rpc::RpcContext* context,
+                            Slice* rows,
+                            Slice* indirect_data) {
+  if (pb.has_rows_sidecar()) {
+    RETURN_NOT_OK_PREPEND(context->GetInboundSidecar(pb.rows_sidecar(), rows),
+                          "invalid row operations sidecar");
+  } else {
+    *rows = Slice(pb.rows());
+  }
+  if (pb.has_indirect_data_sidecar()) {
+    RETURN_NOT_OK_PREPEND(context->GetInboundSidecar(pb.indirect_data_sidecar(),
+                                                     indirect_data),
+                          "invalid indirect data sidecar");
+  } else {
+    *indirect_data = Slice(pb.indirect_data());
+  }
+  return Status::OK();
+}
+
+// Returns how long clients should wait before sending more writes, given the
+// server's memory consumption: nothing below the memory pressure threshold,
+// growing linearly up to --write_backpressure_max_delay_ms at the soft memory
+// limit.
+int32_t WriteBackpressureDelayMs() {
+  const int32_t max_delay_ms = FLAGS_write_backpressure_max_delay_ms;
+  if (max_delay_ms <= 0) {
+    return 0;
+  }
+  const int64_t consumption = process_memory::CurrentConsumption();
+  const int64_t threshold = process_memory::MemoryPressureThreshold();
+  if (consumption <= threshold) {
+    return 0;
+  }
+  const int64_t soft_limit = process_memory::SoftLimit();
+  if (consumption >= soft_limit) {
+    return max_delay_ms;
+  }
+  return static_cast<int32_t>(max_delay_ms * (consumption - threshold) /
+                              (soft_limit - threshold));
+}
+
+} // anonymous namespace
+
+void TabletServiceImpl::MultiWrite(const MultiWriteRequestPB* req,
+                                   MultiWriteResponsePB* resp,
+                                   rpc::RpcContext* context) {
+  TRACE_EVENT1("tserver", "TabletServiceImpl::MultiWrite",
+               "num_writes", req->writes_size());
+  DVLOG(3) << "Received MultiWrite RPC: " << SecureDebugString(*req);
+
+  // Authorize all the writes before submitting any, so that the RPC fails
+  // as a whole, without having applied anything.
   if (FLAGS_tserver_enforce_access_control) {
-    TokenPB token;
-    if (!VerifyAuthzTokenOrRespond(server_->token_verifier(), *req, context, &token)) {
-      return;
+    for (const WriteRequestPB& write : req->writes()) {
+      if (!VerifyWritePrivilegesOrRespond(write, context)) {
+        return;
+      }
     }
-    const auto& privilege = token.authz().table_privilege();
-    if (!privilege.insert_privilege() &&
-        !privilege.update_privilege() &&
-        !privilege.delete_privilege()) {
-      context->RespondRpcFailure(rpc::ErrorStatusPB::FATAL_UNAUTHORIZED,
-          Status::NotAuthorized("not authorized to write"));
-      return;
+  }
+
+  // Add all the responses upfront: they can't be moved once the writes are
+  // submitted.
+  for (int i = 0; i < req->writes_size(); i++) {
+    resp->add_responses();
+  }
+  scoped_refptr<MultiWriteState> state(new MultiWriteState(context, req->writes_size()));
+  for (int i = 0; i < req->writes_size(); i++) {
+    WriteResponsePB* write_resp = resp->mutable_responses(i);
+    TabletServerErrorPB::Code error_code;
+    Status s = SubmitWrite(&req->writes(i), write_resp, context, nullptr,
+                           gscoped_ptr<TransactionCompletionCallback>(
+                               new MultiWriteCompletionCallback(state, write_resp)),
+                           &error_code);
+    if (PREDICT_FALSE(!s.ok())) {
+      StatusToPB(s, write_resp->mutable_error()->mutable_status());
+      write_resp->mutable_error()->set_code(error_code);
+      state->WriteCompleted();
     }
-    // TODO(awong): check the privileges required for the contents of the write
-    // request by parsing out the op types in the request.
   }
+  state->WriteCompleted();
+}
+
+bool TabletServiceImpl::VerifyWritePrivilegesOrRespond(const WriteRequestPB& req,
+                                                       rpc::RpcContext* context) {
+  TokenPB token;
+  if (!VerifyAuthzTokenOrRespond(server_->token_verifier(), req, context, &token)) {
+    return false;
+  }
+  const auto& privilege = token.authz().table_privilege();
+  if (!privilege.insert_privilege() &&
+      !privilege.update_privilege() &&
+      !privilege.delete_privilege()) {
+    context->RespondRpcFailure(rpc::ErrorStatusPB::FATAL_UNAUTHORIZED,
+        Status::NotAuthorized("not authorized to write"));
+    return false;
+  }
+  // TODO(awong): check the privileges required for the contents of the write
+  // request by parsing out the op types in the request.
+  return true;
+}
+
+Status TabletServiceImpl::SubmitWrite(const WriteRequestPB* req,
+                                      WriteResponsePB* resp,
+                                      const rpc::RpcContext* context,
+                                      const rpc::RequestIdPB* request_id,
+                                      gscoped_ptr<TransactionCompletionCallback> callback,
+                                      TabletServerErrorPB::Code* error_code) {
   scoped_refptr<TabletReplica> replica;
-  if (!LookupRunningTabletReplicaOrRespond(server_->tablet_manager(), req->tablet_id(), resp,
-                                           context, &replica)) {
-    return;
+  RETURN_NOT_OK(LookupTabletReplica(server_->tablet_manager(), req->tablet_id(),
+                                    &replica, error_code));
+  tablet::TabletStatePB state = replica->state();
+  if (PREDICT_FALSE(state != tablet::RUNNING)) {
+    return TabletNotRunningError(replica, state, error_code);
   }
 
   shared_ptr<Tablet> tablet;
-  TabletServerErrorPB::Code error_code;
-  Status s = GetTabletRef(replica, &tablet, &error_code);
+  RETURN_NOT_OK(GetTabletRef(replica, &tablet, error_code));
+
+  // The row operations are decoded in place from the sidecars, if any, which
+  // live as long as the call and thus as the transaction.
+  Slice rows;
+  Slice indirect_data;
+  Status s = GetRowOperationsData(req->row_operations(), context, &rows, &indirect_data);
   if (PREDICT_FALSE(!s.ok())) {
-    SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
-    return;
+    *error_code = TabletServerErrorPB::INVALID_MUTATION;
+    return s;
   }
 
-  uint64_t bytes = req->row_operations().rows().size() +
-      req->row_operations().indirect_data().size();
+  // Ask the client to slow down before writes have to be rejected.
+  const int32_t backpressure_delay_ms = WriteBackpressureDelayMs();
+  if (backpressure_delay_ms > 0) {
+    resp->set_backpressure_delay_ms(backpressure_delay_ms);
+  }
+
+  uint64_t bytes = rows.size() + indirect_data.size();
   if (!tablet->ShouldThrottleAllow(bytes)) {
-    SetupErrorAndRespond(resp->mutable_error(),
-                         Status::ServiceUnavailable("Rejecting Write request: throttled"),
-                         TabletServerErrorPB::THROTTLED,
-                         context);
-    return;
+    *error_code = TabletServerErrorPB::THROTTLED;
+    return Status::ServiceUnavailable("Rejecting Write request: throttled");
   }
 
   // Check for memory pressure; don't bother doing any additional work if we've
@@ -1119,53 +1610,39 @@ void TabletServiceImpl::Write(const WriteRequestPB* req,
     } else {
       KLOG_EVERY_N_SECS(INFO, 1) << "Rejecting Write request: " << msg << THROTTLE_MSG;
     }
-    SetupErrorAndRespond(resp->mutable_error(), Status::ServiceUnavailable(msg),
-                         TabletServerErrorPB::UNKNOWN_ERROR,
-                         context);
-    return;
+    *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+    return Status::ServiceUnavailable(msg);
   }
 
   if (!server_->clock()->SupportsExternalConsistencyMode(req->external_consistency_mode())) {
-    Status s = Status::NotSupported("The configured clock does not support the"
+    *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+    return Status::NotSupported("The configured clock does not support the"
         " required consistency mode.");
-    SetupErrorAndRespond(resp->mutable_error(), s,
-                         TabletServerErrorPB::UNKNOWN_ERROR,
-                         context);
-    return;
   }
 
   unique_ptr<WriteTransactionState> tx_state(new WriteTransactionState(
-      replica.get(),
-      req,
-      context->AreResultsTracked() ? context->request_id() : nullptr,
-      resp));
+      replica.get(), req, request_id, resp));
+  tx_state->set_row_operations_data(rows, indirect_data);
 
   // If the client sent us a timestamp, decode it and update the clock so that all future
   // timestamps are greater than the passed timestamp.
   if (req->has_propagated_timestamp()) {
     Timestamp ts(req->propagated_timestamp());
     s = server_->clock()->Update(ts);
-  }
-  if (PREDICT_FALSE(!s.ok())) {
-    SetupErrorAndRespond(resp->mutable_error(), s,
-                         TabletServerErrorPB::UNKNOWN_ERROR,
-                         context);
-    return;
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+      return s;
+    }
   }
 
-  tx_state->set_completion_callback(gscoped_ptr<TransactionCompletionCallback>(
-      new RpcTransactionCompletionCallback<WriteResponsePB>(context,
-                                                            resp)));
+  tx_state->set_completion_callback(std::move(callback));
 
-  // Submit the write. The RPC will be responded to asynchronously.
+  // Submit the write. The completion callback is run asynchronously.
   s = replica->SubmitWrite(std::move(tx_state));
-
-  // Check that we could submit the write
   if (PREDICT_FALSE(!s.ok())) {
-    SetupErrorAndRespond(resp->mutable_error(), s,
-                         TabletServerErrorPB::UNKNOWN_ERROR,
-                         context);
+    *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
   }
+  return s;
 }
 
 ConsensusServiceImpl::ConsensusServiceImpl(ServerBase* server,
@@ -1215,6 +1692,55 @@ void ConsensusServiceImpl::UpdateConsensus(const ConsensusRequestPB* req,
   context->RespondSuccess();
 }
 
+void ConsensusServiceImpl::MultiUpdateConsensus(const MultiUpdateConsensusRequestPB* req,
+                                                MultiUpdateConsensusResponsePB* resp,
+                                                rpc::RpcContext* context) {
+  DVLOG(3) << "Received Consensus Multi Update RPC: " << SecureDebugString(*req);
+  const string& local_uuid = tablet_manager_->NodeInstance().permanent_uuid();
+  for (const ConsensusRequestPB& update_req : req->requests()) {
+    ConsensusResponsePB* update_resp = resp->add_responses();
+    // Unlike UpdateConsensus(), the errors are reported in the response to
+    // each request rather than by responding to the RPC.
+    TabletServerErrorPB::Code error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+    Status s;
+    if (PREDICT_FALSE(update_req.dest_uuid() != local_uuid)) {
+      s = Status::InvalidArgument(Substitute("MultiUpdateConsensus: Wrong destination UUID "
+                                             "requested. Local UUID: $0. Requested UUID: $1",
+                                             local_uuid, update_req.dest_uuid()));
+      error_code = TabletServerErrorPB::WRONG_SERVER_UUID;
+    }
+    scoped_refptr<TabletReplica> replica;
+    if (s.ok()) {
+      s = LookupTabletReplica(tablet_manager_, update_req.tablet_id(), &replica, &error_code);
+    }
+    if (s.ok()) {
+      tablet::TabletStatePB state = replica->state();
+      if (PREDICT_FALSE(state != tablet::RUNNING)) {
+        s = TabletNotRunningError(replica, state, &error_code);
+      }
+    }
+    shared_ptr<RaftConsensus> consensus;
+    if (s.ok()) {
+      consensus = replica->shared_consensus();
+      if (PREDICT_FALSE(!consensus)) {
+        s = Status::ServiceUnavailable("Raft Consensus unavailable",
+                                       "Tablet replica not initialized");
+        error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
+      }
+    }
+    if (s.ok()) {
+      s = consensus->Update(&update_req, update_resp);
+      error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+    }
+    if (PREDICT_FALSE(!s.ok())) {
+      update_resp->Clear();
+      StatusToPB(s, update_resp->mutable_error()->mutable_status());
+      update_resp->mutable_error()->set_code(error_code);
+    }
+  }
+  context->RespondSuccess();
+}
+
 void ConsensusServiceImpl::RequestConsensusVote(const VoteRequestPB* req,
                                                 VoteResponsePB* resp,
                                                 rpc::RpcContext* context) {
@@ -1472,6 +1998,31 @@ void ConsensusServiceImpl::GetLastOpId(const consensus::GetLastOpIdRequestPB *re
   context->RespondSuccess();
 }
 
+void ConsensusServiceImpl::SendSafeTime(const SendSafeTimeRequestPB* req,
+                                        SendSafeTimeResponsePB* resp,
+                                        rpc::RpcContext* context) {
+  DVLOG(3) << "Received SendSafeTime RPC: " << SecureDebugString(*req);
+  if (!CheckUuidMatchOrRespond(tablet_manager_, "SendSafeTime", req, resp, context)) {
+    return;
+  }
+  scoped_refptr<TabletReplica> replica;
+  if (!LookupRunningTabletReplicaOrRespond(tablet_manager_, req->tablet_id(), resp, context,
+                                           &replica)) {
+    return;
+  }
+
+  shared_ptr<RaftConsensus> consensus;
+  if (!GetConsensusOrRespond(replica, resp, context, &consensus)) return;
+  Status s = consensus->SendSafeTimeToPeers();
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s,
+                         TabletServerErrorPB::NOT_THE_LEADER,
+                         context);
+    return;
+  }
+  context->RespondSuccess();
+}
+
 void ConsensusServiceImpl::GetConsensusState(const consensus::GetConsensusStateRequestPB* req,
                                              consensus::GetConsensusStateResponsePB* resp,
                                              rpc::RpcContext* context) {
@@ -1562,10 +2113,24 @@ void TabletServiceImpl::ScannerKeepAlive(const ScannerKeepAliveRequestPB *req,
 
 namespace {
 void SetResourceMetrics(ResourceMetricsPB* metrics, rpc::RpcContext* context) {
+  const TraceMetrics* trace_metrics = context->trace()->metrics();
   metrics->set_cfile_cache_miss_bytes(
-    context->trace()->metrics()->GetMetric(cfile::CFILE_CACHE_MISS_BYTES_METRIC_NAME));
+    trace_metrics->GetMetric(cfile::CFILE_CACHE_MISS_BYTES_METRIC_NAME));
   metrics->set_cfile_cache_hit_bytes(
-    context->trace()->metrics()->GetMetric(cfile::CFILE_CACHE_HIT_BYTES_METRIC_NAME));
+    trace_metrics->GetMetric(cfile::CFILE_CACHE_HIT_BYTES_METRIC_NAME));
+  metrics->set_cfile_cache_hit_blocks(trace_metrics->GetMetric("cfile_cache_hit"));
+  metrics->set_cfile_cache_miss_blocks(trace_metrics->GetMetric("cfile_cache_miss"));
+  metrics->set_disk_read_time_us(trace_metrics->GetMetric("lbm_read_time_us"));
+  metrics->set_rows_scanned(trace_metrics->GetMetric("scanner_rows_scanned"));
+  metrics->set_rows_returned(trace_metrics->GetMetric("scanner_rows_returned"));
+  metrics->set_rows_skipped_by_zone_maps(
+    trace_metrics->GetMetric("cfile_zone_map_skipped_rows"));
+  metrics->set_rowsets_read(trace_metrics->GetMetric("rowset_iterators"));
+  metrics->set_delta_stores_read(trace_metrics->GetMetric("delta_iterators_relevant"));
+  metrics->set_snapshot_wait_time_us(trace_metrics->GetMetric("scanner_snapshot_wait_us"));
+  metrics->set_admission_wait_time_us(trace_metrics->GetMetric("scanner_admission_wait_us"));
+  metrics->set_iterator_time_us(trace_metrics->GetMetric("scanner_iterator_time_us"));
+  metrics->set_serialization_time_us(trace_metrics->GetMetric("scanner_serialization_time_us"));
 }
 } // anonymous namespace
 
@@ -1615,11 +2180,10 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
   }
 
   size_t batch_size_bytes = GetMaxBatchSizeBytesHint(req);
-  unique_ptr<faststring> rows_data(new faststring(batch_size_bytes * 11 / 10));
-  unique_ptr<faststring> indirect_data(new faststring(batch_size_bytes * 11 / 10));
-  RowwiseRowBlockPB data;
-  ScanResultCopier collector(&data, rows_data.get(), indirect_data.get());
+  ScanResultCopier collector(batch_size_bytes);
 
+  ScanProfilePB* scan_profile = req->include_scan_profile() ?
+      resp->mutable_scan_profile() : nullptr;
   bool has_more_results = false;
   TabletServerErrorPB::Code error_code = TabletServerErrorPB::UNKNOWN_ERROR;
   if (req->has_new_scan_request()) {
@@ -1632,8 +2196,8 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
     string scanner_id;
     Timestamp scan_timestamp;
     Status s = HandleNewScanRequest(replica.get(), req, context,
-                                    &collector, &scanner_id, &scan_timestamp, &has_more_results,
-                                    &error_code);
+                                    &collector, scan_profile, &scanner_id, &scan_timestamp,
+                                    &has_more_results, &error_code);
     if (PREDICT_FALSE(!s.ok())) {
       SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
       return;
@@ -1647,7 +2211,8 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
       resp->set_snap_timestamp(scan_timestamp.ToUint64());
     }
   } else if (req->has_scanner_id()) {
-    Status s = HandleContinueScanRequest(req, context, &collector, &has_more_results, &error_code);
+    Status s = HandleContinueScanRequest(req, context, &collector, scan_profile,
+                                         &has_more_results, &error_code);
     if (PREDICT_FALSE(!s.ok())) {
       SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
       return;
@@ -1659,21 +2224,7 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
   }
   resp->set_has_more_results(has_more_results);
 
-  resp->mutable_data()->CopyFrom(data);
-
-  // Add sidecar data to context and record the returned indices.
-  int rows_idx;
-  CHECK_OK(context->AddOutboundSidecar(
-      RpcSidecar::FromFaststring((std::move(rows_data))), &rows_idx));
-  resp->mutable_data()->set_rows_sidecar(rows_idx);
-
-  // Add indirect data as a sidecar, if applicable.
-  if (indirect_data->size() > 0) {
-    int indirect_idx;
-    CHECK_OK(context->AddOutboundSidecar(
-        RpcSidecar::FromFaststring(std::move(indirect_data)), &indirect_idx));
-    resp->mutable_data()->set_indirect_data_sidecar(indirect_idx);
-  }
+  collector.SetupResponse(context, resp);
 
   // Set the last row found by the collector.
   //
@@ -1942,7 +2493,7 @@ void TabletServiceImpl::Checksum(const ChecksumRequestPB* req,
     string scanner_id;
     Timestamp snap_timestamp;
     Status s = HandleNewScanRequest(replica.get(), &scan_req, context,
-                                    &collector, &scanner_id, &snap_timestamp, &has_more,
+                                    &collector, nullptr, &scanner_id, &snap_timestamp, &has_more,
                                     &error_code);
     if (PREDICT_FALSE(!s.ok())) {
       SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
@@ -1956,7 +2507,8 @@ void TabletServiceImpl::Checksum(const ChecksumRequestPB* req,
     const ContinueChecksumRequestPB& continue_req = req->continue_request();
     collector.set_agg_checksum(continue_req.previous_checksum());
     scan_req.set_scanner_id(continue_req.scanner_id());
-    Status s = HandleContinueScanRequest(&scan_req, context, &collector, &has_more, &error_code);
+    Status s = HandleContinueScanRequest(&scan_req, context, &collector, nullptr,
+                                         &has_more, &error_code);
     if (PREDICT_FALSE(!s.ok())) {
       SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
       return;
@@ -1978,6 +2530,13 @@ bool TabletServiceImpl::SupportsFeature(uint32_t feature) const {
   switch (feature) {
     case TabletServerFeatures::COLUMN_PREDICATES:
     case TabletServerFeatures::PAD_UNIXTIME_MICROS_TO_16_BYTES:
+    case TabletServerFeatures::COLUMNAR_LAYOUT_FEATURE:
+    case TabletServerFeatures::SCAN_AGGREGATES:
+    case TabletServerFeatures::SCAN_TOP_K:
+    case TabletServerFeatures::SCAN_GROUP_BY:
+    case TabletServerFeatures::SCAN_BUILD_BLOOM_FILTER:
+    case TabletServerFeatures::MULTI_TABLET_WRITE:
+    case TabletServerFeatures::WRITE_ROW_OPERATIONS_SIDECARS:
       return true;
     default:
       return false;
@@ -2050,6 +2609,15 @@ static Status DecodeEncodedKeyRange(const NewScanRequestPB& scan_pb,
     RETURN_NOT_OK_PREPEND(EncodedKey::IncrementEncodedKey(tablet_schema, &start, scanner->arena()),
                           "Failed to increment encoded last row key");
   }
+  if (scan_pb.order_mode() == REVERSE_ORDERED && scan_pb.has_last_primary_key()) {
+    if (stop) {
+      return Status::InvalidArgument("Cannot specify both a stop key and a last key");
+    }
+    // The stop key is exclusive, so the last row isn't returned again.
+    RETURN_NOT_OK_PREPEND(EncodedKey::DecodeEncodedString(tablet_schema, scanner->arena(),
+                                                          scan_pb.last_primary_key(), &stop),
+                          "Failed to decode last primary key");
+  }
 
   if (start) {
     spec->SetLowerBoundKey(start.get());
@@ -2131,7 +2699,8 @@ static Status SetupScanSpec(const NewScanRequestPB& scan_pb,
 
   // When doing an ordered scan, we need to include the key columns to be able to encode
   // the last row key for the scan response.
-  if (scan_pb.order_mode() == kudu::ORDERED &&
+  if ((scan_pb.order_mode() == kudu::ORDERED ||
+       scan_pb.order_mode() == kudu::REVERSE_ORDERED) &&
       projection.num_key_columns() != tablet_schema.num_key_columns()) {
     for (int i = 0; i < tablet_schema.num_key_columns(); i++) {
       const ColumnSchema &col = tablet_schema.column(i);
@@ -2174,6 +2743,16 @@ Status VerifyNotAncientHistory(Tablet* tablet, ReadMode read_mode, Timestamp tim
   }
   return Status::OK();
 }
+
+// Helper to let unordered scans read the rowsets of a tablet concurrently, if
+// enabled.
+void SetParallelScanOptions(TabletServer* server, tablet::RowIteratorOptions* opts) {
+  if (FLAGS_scanner_parallel_rowsets > 1) {
+    opts->scan_pool = server->scan_pool();
+    opts->max_parallel_rowsets = FLAGS_scanner_parallel_rowsets;
+    opts->max_buffered_blocks = std::max(FLAGS_scanner_parallel_buffered_blocks, 1);
+  }
+}
 } // anonymous namespace
 
 // Start a new scan.
@@ -2181,6 +2760,7 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
                                                const ScanRequestPB* req,
                                                const RpcContext* rpc_context,
                                                ScanResultCollector* result_collector,
+                                               ScanProfilePB* scan_profile,
                                                std::string* scanner_id,
                                                Timestamp* snap_timestamp,
                                                bool* has_more_results,
@@ -2194,6 +2774,22 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
 
   const Schema& tablet_schema = replica->tablet_metadata()->schema();
 
+  const uint64_t row_format_flags = scan_pb.row_format_flags();
+  if ((row_format_flags & RowFormatFlags::COLUMNAR_LAYOUT) &&
+      (row_format_flags & RowFormatFlags::PAD_UNIX_TIME_MICROS_TO_16_BYTES)) {
+    *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+    return Status::InvalidArgument(
+        "Columnar layout is not compatible with padding UNIXTIME_MICROS to 16 bytes");
+  }
+  // Set the row format flags here as well, so that results of scans which
+  // never reach HandleContinueScanRequest() use the requested layout.
+  result_collector->set_row_format_flags(row_format_flags);
+
+  if (PREDICT_FALSE(server_->scanner_manager()->MemoryLimitExceeded())) {
+    *error_code = TabletServerErrorPB::THROTTLED;
+    return Status::ServiceUnavailable("Rejecting Scan request: scanners memory limit exceeded");
+  }
+
   SharedScanner scanner;
   server_->scanner_manager()->NewScanner(replica,
                                          rpc_context->remote_user(),
@@ -2220,7 +2816,86 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
     return Status::InvalidArgument("User requests should not have Column IDs");
   }
 
-  if (scan_pb.order_mode() == ORDERED) {
+  unique_ptr<ScanAggregator> aggregator;
+  if (scan_pb.aggregates_size() > 0 || scan_pb.group_by_size() > 0) {
+    // The partial aggregates are only returned once the whole tablet was
+    // scanned, so aggregate scans can't be resumed or limited.
+    if (projection.num_columns() > 0 || scan_pb.has_limit() ||
+        scan_pb.order_mode() == ORDERED || scan_pb.order_mode() == REVERSE_ORDERED) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return Status::InvalidArgument(
+          "Aggregate scans must be unordered and can't have projected columns or a limit");
+    }
+    s = ScanAggregator::Create(scan_pb.aggregates(), scan_pb.group_by(),
+                               FLAGS_scanner_max_aggregate_groups, tablet_schema, &aggregator);
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return s;
+    }
+  }
+
+  // Reverse ordered scans are top-k scans by decreasing primary key, which
+  // are resumed from the last key of the previous page.
+  unique_ptr<ScanTopK> top_k;
+  const bool reverse_ordered = scan_pb.order_mode() == REVERSE_ORDERED;
+  if (scan_pb.order_by_size() > 0 || reverse_ordered) {
+    // The top rows are only known once the whole tablet was scanned, so
+    // top-k scans can't be resumed.
+    if (reverse_ordered && (!scan_pb.has_limit() || scan_pb.order_by_size() > 0)) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return Status::InvalidArgument(
+          "Reverse ordered scans must have a limit and can't have an ordering");
+    }
+    if (!scan_pb.has_limit() || scan_pb.aggregates_size() > 0 ||
+        scan_pb.group_by_size() > 0 ||
+        scan_pb.order_mode() == ORDERED) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return Status::InvalidArgument(
+          "Top-k scans must be unordered, have a limit and can't have aggregates");
+    }
+    if (scan_pb.limit() > FLAGS_scanner_max_top_k_rows) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return Status::InvalidArgument(
+          Substitute("Top-k scan limit $0 exceeds the maximum of $1 (see --scanner_max_top_k_rows)",
+                     scan_pb.limit(), FLAGS_scanner_max_top_k_rows));
+    }
+    google::protobuf::RepeatedPtrField<ScanOrderByPB> order_by = scan_pb.order_by();
+    if (reverse_ordered) {
+      for (int i = 0; i < tablet_schema.num_key_columns(); i++) {
+        ScanOrderByPB* pb = order_by.Add();
+        pb->set_column(tablet_schema.column(i).name());
+        pb->set_descending(true);
+      }
+    }
+    s = ScanTopK::Create(order_by, scan_pb.limit(), tablet_schema, &top_k);
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return s;
+    }
+  }
+
+  unique_ptr<ScanBloomFilterBuilder> bloom_filter_builder;
+  if (scan_pb.has_build_bloom_filter()) {
+    // The filter is only returned once the whole tablet was scanned, so
+    // bloom filter scans can't be resumed or limited.
+    if (projection.num_columns() > 0 || scan_pb.has_limit() ||
+        scan_pb.order_mode() == ORDERED || reverse_ordered ||
+        aggregator || top_k) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return Status::InvalidArgument(
+          "Bloom filter scans must be unordered and can't have projected columns, "
+          "a limit, aggregates or an ordering");
+    }
+    s = ScanBloomFilterBuilder::Create(scan_pb.build_bloom_filter(),
+                                       FLAGS_scanner_max_bloom_filter_bytes,
+                                       tablet_schema, &bloom_filter_builder);
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return s;
+    }
+  }
+
+  if (scan_pb.order_mode() == ORDERED || reverse_ordered) {
     // Ordered scans must be at a snapshot so that we perform a serializable read (which can be
     // resumed). Otherwise, this would be read committed isolation, which is not resumable.
     if (scan_pb.read_mode() != READ_AT_SNAPSHOT) {
@@ -2241,20 +2916,75 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
     return s;
   }
 
+  // Filter out the expired rows, which flushes and compactions drop only
+  // eventually.
+  int64_t expiration_cutoff_micros;
+  if (Tablet::GetRowExpirationCutoff(tablet_schema, server_->clock(),
+                                     &expiration_cutoff_micros)) {
+    const ColumnSchema& col = tablet_schema.column(tablet_schema.find_ttl_column());
+    if (projection.find_column(col.name()) == Schema::kColumnNotFound &&
+        std::none_of(missing_cols.begin(), missing_cols.end(),
+                     [&](const ColumnSchema& c) { return c.name() == col.name(); })) {
+      missing_cols.push_back(col);
+    }
+    const int64_t* cutoff = scanner->arena()->NewObject<int64_t>(expiration_cutoff_micros);
+    spec->AddPredicate(ColumnPredicate::Range(col, cutoff, nullptr));
+  }
+
   VLOG(3) << "Before optimizing scan spec: " << spec->ToString(tablet_schema);
   spec->OptimizeScan(tablet_schema, scanner->arena(), scanner->autorelease_pool(), true);
   VLOG(3) << "After optimizing scan spec: " << spec->ToString(tablet_schema);
 
+  // Store the original projection. Aggregate scans return their result row
+  // instead, and need the aggregated columns to be scanned as well.
+  gscoped_ptr<Schema> orig_projection;
+  if (aggregator) {
+    orig_projection.reset(new Schema(aggregator->result_schema()));
+    for (const ColumnSchema& col : aggregator->input_columns()) {
+      if (std::none_of(missing_cols.begin(), missing_cols.end(),
+                       [&](const ColumnSchema& c) { return c.name() == col.name(); })) {
+        missing_cols.push_back(col);
+      }
+    }
+    scanner->set_aggregator(std::move(aggregator));
+  } else if (bloom_filter_builder) {
+    // Bloom filter scans return the filter instead, and need its column to
+    // be scanned.
+    orig_projection.reset(new Schema(bloom_filter_builder->result_schema()));
+    const ColumnSchema& col = bloom_filter_builder->input_column();
+    if (std::none_of(missing_cols.begin(), missing_cols.end(),
+                     [&](const ColumnSchema& c) { return c.name() == col.name(); })) {
+      missing_cols.push_back(col);
+    }
+    scanner->set_bloom_filter_builder(std::move(bloom_filter_builder));
+  } else {
+    orig_projection.reset(new Schema(projection));
+  }
+  if (top_k) {
+    // Top-k scans also need the ordering columns to be scanned.
+    for (const ColumnSchema& col : top_k->input_columns()) {
+      if (projection.find_column(col.name()) == Schema::kColumnNotFound &&
+          std::none_of(missing_cols.begin(), missing_cols.end(),
+                       [&](const ColumnSchema& c) { return c.name() == col.name(); })) {
+        missing_cols.push_back(col);
+      }
+    }
+    scanner->set_top_k(std::move(top_k));
+  }
+  scanner->set_client_projection_schema(std::move(orig_projection));
+
   if (spec->CanShortCircuit()) {
     VLOG(1) << "short-circuiting without creating a server-side scanner.";
     *has_more_results = false;
+    if (scanner->aggregator()) {
+      CollectAggregateResult(scanner.get(), result_collector);
+    }
+    if (scanner->bloom_filter_builder()) {
+      RETURN_NOT_OK(CollectBloomFilterResult(scanner.get(), result_collector));
+    }
     return Status::OK();
   }
 
-  // Store the original projection.
-  gscoped_ptr<Schema> orig_projection(new Schema(projection));
-  scanner->set_client_projection_schema(std::move(orig_projection));
-
   // Build a new projection with the projection columns and the missing columns. Make
   // sure to set whether the column is a key column appropriately.
   SchemaBuilder projection_builder;
@@ -2297,14 +3027,19 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
         return s;
       }
       case READ_LATEST: {
-        s = tablet->NewRowIterator(projection, &iter);
+        tablet::RowIteratorOptions opts;
+        opts.projection = &projection;
+        opts.aggregator = scanner->aggregator();
+        SetParallelScanOptions(server_, &opts);
+        s = tablet->NewRowIterator(std::move(opts), &iter);
         break;
       }
       case READ_YOUR_WRITES: // Fallthrough intended
       case READ_AT_SNAPSHOT: {
         scoped_refptr<consensus::TimeManager> time_manager = replica->time_manager();
         s = HandleScanAtSnapshot(scan_pb, rpc_context, projection, tablet.get(),
-                                 time_manager.get(), &iter, snap_timestamp);
+                                 replica->consensus(), time_manager.get(),
+                                 scanner->aggregator(), &iter, snap_timestamp);
         // If we got a Status::ServiceUnavailable() from HandleScanAtSnapshot() it might
         // mean we're just behind so let the client try again.
         if (s.IsServiceUnavailable()) {
@@ -2384,9 +3119,18 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
   if (!*has_more_results) {
     // If there are no more rows, we can short circuit some work and respond immediately.
     VLOG(1) << "No more rows, short-circuiting out without creating a server-side scanner.";
+    if (scanner->aggregator()) {
+      CollectAggregateResult(scanner.get(), result_collector);
+    }
+    if (scanner->bloom_filter_builder()) {
+      RETURN_NOT_OK(CollectBloomFilterResult(scanner.get(), result_collector));
+    }
     return Status::OK();
   }
 
+  if (scanner->top_k()) {
+    scanner->top_k()->Init(iter->schema());
+  }
   scanner->Init(std::move(iter), std::move(orig_spec));
 
   // Stop the scanner timer because ContinueScanRequest starts its own timer.
@@ -2407,7 +3151,7 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
     ScanRequestPB continue_req(*req);
     continue_req.set_scanner_id(scanner->id());
     RETURN_NOT_OK(HandleContinueScanRequest(&continue_req, rpc_context, result_collector,
-                                            has_more_results, error_code));
+                                            scan_profile, has_more_results, error_code));
   } else {
     // Increment the scanner call sequence ID. HandleContinueScanRequest handles
     // this in the non-empty scan case.
@@ -2420,6 +3164,7 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
 Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
                                                     const RpcContext* rpc_context,
                                                     ScanResultCollector* result_collector,
+                                                    ScanProfilePB* scan_profile,
                                                     bool* has_more_results,
                                                     TabletServerErrorPB::Code* error_code) {
   DCHECK(req->has_scanner_id());
@@ -2453,12 +3198,23 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
                                       "--scanner_inject_service_unavailable_on_continue_scan");
   }
 
+  // Pause scans while the scanners use too much memory: the scanner is kept,
+  // and the client retries the same call later. Scans continued as part of a
+  // new scan request were already admitted.
+  if (PREDICT_FALSE(!req->has_new_scan_request() &&
+                    server_->scanner_manager()->MemoryLimitExceeded())) {
+    scanner->UpdateAccessTime();
+    *error_code = TabletServerErrorPB::THROTTLED;
+    return Status::ServiceUnavailable("Rejecting Scan request: scanners memory limit exceeded");
+  }
+
   // Set the row format flags on the ScanResultCollector.
   result_collector->set_row_format_flags(scanner->row_format_flags());
 
   // If we early-exit out of this function, automatically unregister the scanner.
   ScopedUnregisterScanner unreg_scanner(server_->scanner_manager(), scanner->id());
   ScopedAddScannerTiming scanner_timer(scanner.get());
+  ScopedCpuSampleTablet cpu_sample_tablet(scanner->tablet_id());
 
   VLOG(2) << "Found existing scanner " << scanner->id() << " for request: "
           << SecureShortDebugString(*req);
@@ -2473,6 +3229,35 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
     *error_code = TabletServerErrorPB::INVALID_SCAN_CALL_SEQ_ID;
     return Status::InvalidArgument("Invalid call sequence ID in scan request");
   }
+
+  // Wait for the scan scheduler to admit the request. If it isn't admitted
+  // soon enough, the scanner is kept, and the client retries the same call
+  // later; the first batch of a new scan is returned empty instead, so that
+  // the client gets the new scanner's ID.
+  unique_ptr<ScanScheduler::Slot> scan_slot;
+  if (server_->scan_scheduler()) {
+    const string tenant = FLAGS_scan_scheduler_fairness == "table" ?
+        scanner->tablet_replica()->tablet_metadata()->table_id() :
+        scanner->remote_user().username();
+    const MonoTime wait_deadline = std::min(
+        MonoTime::Now() + MonoDelta::FromMilliseconds(FLAGS_scan_scheduler_max_wait_ms),
+        rpc_context->GetClientDeadline());
+    const MonoTime admit_start = MonoTime::Now();
+    Status s = server_->scan_scheduler()->Admit(tenant, wait_deadline, &scan_slot);
+    TRACE_COUNTER_INCREMENT("scanner_admission_wait_us",
+                            (MonoTime::Now() - admit_start).ToMicroseconds());
+    if (PREDICT_FALSE(!s.ok())) {
+      unreg_scanner.Cancel();
+      scanner->UpdateAccessTime();
+      if (req->has_new_scan_request()) {
+        scanner->IncrementCallSeqId();
+        *has_more_results = true;
+        return Status::OK();
+      }
+      *error_code = TabletServerErrorPB::THROTTLED;
+      return s.CloneAndPrepend("Rejecting Scan request");
+    }
+  }
   scanner->IncrementCallSeqId();
 
   RowwiseIterator* iter = scanner->iter();
@@ -2480,22 +3265,40 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
   // TODO(todd): could size the RowBlock based on the user's requested batch size?
   // If people had really large indirect objects, we would currently overshoot
   // their requested batch size by a lot.
-  Arena arena(32 * 1024);
+  // The buffers are pooled, so that they're reused by the next calls.
+  Arena arena(PoolingBufferAllocator::Get(), 32 * 1024);
   RowBlock block(scanner->iter()->schema(),
-                 FLAGS_scanner_batch_size_rows, &arena);
+                 FLAGS_scanner_batch_size_rows, &arena, PoolingBufferAllocator::Get());
 
   // TODO(todd): in the future, use the client timeout to set a budget. For now,
   // just use a half second, which should be plenty to amortize call overhead.
   int budget_ms = 500;
   MonoTime deadline = MonoTime::Now() + MonoDelta::FromMilliseconds(budget_ms);
 
+  // The memory used for this call's rows is only charged while it's served.
+  SCOPED_CLEANUP({
+    scanner->UpdateMemoryConsumption(0);
+  });
+  const int64_t scanner_memory_limit = FLAGS_scanner_memory_limit_mb * 1024 * 1024;
+
+  // The per-column profile only accounts for the work done by this call.
+  vector<IteratorStats> prev_stats_by_col;
+  if (scan_profile) {
+    scanner->GetIteratorStats(&prev_stats_by_col);
+  }
+
   int64_t rows_scanned = 0;
+  int64_t iterator_time_ns = 0;
+  int64_t serialization_time_ns = 0;
   while (iter->HasNext() && !scanner->has_fulfilled_limit()) {
     if (PREDICT_FALSE(FLAGS_scanner_inject_latency_on_each_batch_ms > 0)) {
       SleepFor(MonoDelta::FromMilliseconds(FLAGS_scanner_inject_latency_on_each_batch_ms));
     }
 
+    const MonoTime iterator_start = MonoTime::Now();
     Status s = iter->NextBlock(&block);
+    const MonoTime serialization_start = MonoTime::Now();
+    iterator_time_ns += (serialization_start - iterator_start).ToNanoseconds();
     if (PREDICT_FALSE(!s.ok())) {
       LOG(WARNING) << "Copying rows from internal iterator for request "
                    << SecureShortDebugString(*req);
@@ -2508,15 +3311,40 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
       // The collector will separately count the number of rows actually returned to
       // the client.
       rows_scanned += block.nrows();
-      if (scanner->spec().has_limit()) {
+      if (scanner->spec().has_limit() && !scanner->top_k()) {
         int64_t rows_left = scanner->spec().limit() - scanner->num_rows_returned();
         DCHECK_GT(rows_left, 0);  // Guaranteed by has_fulfilled_limit()
         block.selection_vector()->ClearToSelectAtMost(static_cast<size_t>(rows_left));
       }
-      result_collector->HandleRowBlock(scanner.get(), block);
+      if (scanner->aggregator()) {
+        s = scanner->aggregator()->AddRowBlock(block);
+        if (PREDICT_FALSE(!s.ok())) {
+          *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+          return s;
+        }
+      } else if (scanner->top_k()) {
+        s = scanner->top_k()->AddRowBlock(block);
+        if (PREDICT_FALSE(!s.ok())) {
+          *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+          return s;
+        }
+      } else if (scanner->bloom_filter_builder()) {
+        scanner->bloom_filter_builder()->AddRowBlock(block);
+      } else {
+        result_collector->HandleRowBlock(scanner.get(), block);
+      }
     }
+    serialization_time_ns += (MonoTime::Now() - serialization_start).ToNanoseconds();
 
     int64_t response_size = result_collector->ResponseSize();
+    scanner->UpdateMemoryConsumption(arena.memory_footprint() + response_size);
+    if (PREDICT_FALSE(scanner_memory_limit > 0 &&
+                      scanner->retained_memory() > scanner_memory_limit)) {
+      *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+      return Status::RuntimeError(Substitute(
+          "scanner $0 uses $1 bytes of memory, exceeding the limit of $2 bytes",
+          scanner->id(), scanner->retained_memory(), scanner_memory_limit));
+    }
 
     if (VLOG_IS_ON(2)) {
       // This may be fairly expensive if row block size is small
@@ -2532,6 +3360,11 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
     if (response_size >= batch_size_bytes) {
       break;
     }
+
+    if (PREDICT_FALSE(server_->scanner_manager()->MemoryLimitExceeded())) {
+      TRACE("Scanners memory limit exceeded - responding early");
+      break;
+    }
   }
 
   scoped_refptr<TabletReplica> replica = scanner->tablet_replica();
@@ -2577,6 +3410,46 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
     tablet->metrics()->scanner_bytes_scanned_from_disk->IncrementBy(delta_stats.bytes_read);
   }
 
+  // And finally this call's share of the work, returned to the client.
+  TRACE_COUNTER_INCREMENT("scanner_rows_scanned", rows_scanned);
+  TRACE_COUNTER_INCREMENT("scanner_iterator_time_us", iterator_time_ns / 1000);
+  TRACE_COUNTER_INCREMENT("scanner_serialization_time_us", serialization_time_ns / 1000);
+  if (scan_profile) {
+    DCHECK_EQ(stats_by_col.size(), iter->schema().num_columns());
+    DCHECK_EQ(stats_by_col.size(), prev_stats_by_col.size());
+    for (int col_idx = 0; col_idx < stats_by_col.size(); col_idx++) {
+      const IteratorStats col_stats = stats_by_col[col_idx] - prev_stats_by_col[col_idx];
+      ScanProfilePB::ColumnProfilePB* col_profile = scan_profile->add_columns();
+      col_profile->set_column_name(iter->schema().column(col_idx).name());
+      col_profile->set_cells_read(col_stats.cells_read);
+      col_profile->set_bytes_read(col_stats.bytes_read);
+      col_profile->set_blocks_read(col_stats.blocks_read);
+    }
+  }
+
+  // Aggregate scans return their result once all rows were aggregated.
+  if (scanner->aggregator() && !iter->HasNext()) {
+    CollectAggregateResult(scanner.get(), result_collector);
+  }
+  // And so do bloom filter scans, once all rows were added to the filter.
+  if (scanner->bloom_filter_builder() && !iter->HasNext()) {
+    s = CollectBloomFilterResult(scanner.get(), result_collector);
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+      return s;
+    }
+  }
+  // And so do top-k scans, once all rows were considered.
+  if (scanner->top_k() && !iter->HasNext()) {
+    s = CollectTopKResult(scanner.get(), iter->schema(), result_collector);
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+      return s;
+    }
+  }
+
+  TRACE_COUNTER_INCREMENT("scanner_rows_returned", result_collector->NumRowsReturned());
+
   *has_more_results = !req->close_scanner() && iter->HasNext() &&
       !scanner->has_fulfilled_limit();
   if (*has_more_results) {
@@ -2605,7 +3478,9 @@ Status TabletServiceImpl::HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
                                                const RpcContext* rpc_context,
                                                const Schema& projection,
                                                Tablet* tablet,
+                                               consensus::RaftConsensus* consensus,
                                                consensus::TimeManager* time_manager,
+                                               ScanAggregator* aggregator,
                                                unique_ptr<RowwiseIterator>* iter,
                                                Timestamp* snap_timestamp) {
   switch (scan_pb.read_mode()) {
@@ -2618,7 +3493,7 @@ Status TabletServiceImpl::HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
 
   // Based on the read mode, pick a timestamp and verify it.
   Timestamp tmp_snap_timestamp;
-  RETURN_NOT_OK(PickAndVerifyTimestamp(scan_pb, tablet, &tmp_snap_timestamp));
+  RETURN_NOT_OK(PickAndVerifyTimestamp(scan_pb, tablet, consensus, &tmp_snap_timestamp));
 
   // Reduce the client's deadline by a few msecs to allow for overhead.
   MonoTime client_deadline = rpc_context->GetClientDeadline() - MonoDelta::FromMilliseconds(10);
@@ -2638,6 +3513,13 @@ Status TabletServiceImpl::HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
   // the same timestamp (repeatable reads).
   TRACE("Waiting safe time to advance");
   MonoTime before = MonoTime::Now();
+  // A follower's safe time otherwise only advances with the next request
+  // from the leader, which may be a heartbeat away.
+  if (FLAGS_scanner_request_safe_time_from_leader &&
+      time_manager->GetSafeTime() < tmp_snap_timestamp) {
+    TRACE("Requesting safe time from the leader");
+    consensus->RequestSafeTimeFromLeader();
+  }
   Status s = time_manager->WaitUntilSafe(tmp_snap_timestamp, final_deadline);
 
   tablet::MvccSnapshot snap;
@@ -2658,6 +3540,7 @@ Status TabletServiceImpl::HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
 
   uint64_t duration_usec = (MonoTime::Now() - before).ToMicroseconds();
   tablet->metrics()->snapshot_read_inflight_wait_duration->Increment(duration_usec);
+  TRACE_COUNTER_INCREMENT("scanner_snapshot_wait_us", duration_usec);
   TRACE("All operations in snapshot committed. Waited for $0 microseconds", duration_usec);
 
   if (scan_pb.order_mode() == UNKNOWN_ORDER_MODE) {
@@ -2666,7 +3549,11 @@ Status TabletServiceImpl::HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
   tablet::RowIteratorOptions opts;
   opts.projection = &projection;
   opts.snap_to_include = snap;
-  opts.order = scan_pb.order_mode();
+  // Reverse ordered scans sort the rows with a ScanTopK, so the order in
+  // which the tablet returns them doesn't matter.
+  opts.order = scan_pb.order_mode() == REVERSE_ORDERED ? UNORDERED : scan_pb.order_mode();
+  opts.aggregator = aggregator;
+  SetParallelScanOptions(server_, &opts);
   RETURN_NOT_OK(tablet->NewRowIterator(std::move(opts), iter));
 
   // Return the picked snapshot timestamp for both READ_AT_SNAPSHOT
@@ -2699,6 +3586,7 @@ Status TabletServiceImpl::ValidateTimestamp(const Timestamp& snap_timestamp) {
 
 Status TabletServiceImpl::PickAndVerifyTimestamp(const NewScanRequestPB& scan_pb,
                                                  Tablet* tablet,
+                                                 consensus::RaftConsensus* consensus,
                                                  Timestamp* snap_timestamp) {
   // If the client sent a timestamp update our clock with it.
   if (scan_pb.has_propagated_timestamp()) {
@@ -2714,8 +3602,24 @@ Status TabletServiceImpl::PickAndVerifyTimestamp(const NewScanRequestPB& scan_pb
   Timestamp tmp_snap_timestamp;
   ReadMode read_mode = scan_pb.read_mode();
   tablet::MvccManager* mvcc_manager = tablet->mvcc_manager();
-
-  if (read_mode == READ_AT_SNAPSHOT) {
+  Timestamp term_start_timestamp;
+
+  if ((read_mode == READ_YOUR_WRITES || !scan_pb.has_snap_timestamp()) &&
+      consensus->HasLeaderLease(&term_start_timestamp)) {
+    // A leader holding a lease knows of all the operations committed in the
+    // tablet, so reading right after the latest committed one (and after the
+    // operations of the previous terms) is linearizable. Unlike the current
+    // clock time, that timestamp is already safe and usually clean, so the
+    // scan doesn't have to wait for the in-flight operations.
+    uint64_t latest_committed_timestamp = std::max(
+        mvcc_manager->GetNoneCommittedAtOrAfterTimestamp().ToUint64(),
+        term_start_timestamp.ToUint64() + 1);
+    uint64_t propagated_timestamp = scan_pb.has_propagated_timestamp() ?
+                                    scan_pb.propagated_timestamp() : Timestamp::kMin.ToUint64();
+    tmp_snap_timestamp = Timestamp(std::max(propagated_timestamp + 1,
+                                            latest_committed_timestamp));
+    TRACE("Picked snapshot timestamp under the leader lease");
+  } else if (read_mode == READ_AT_SNAPSHOT) {
     // For READ_AT_SNAPSHOT mode,
     //   1) if the client provided no snapshot timestamp we take the current
     //      clock time as the snapshot timestamp.
@@ -22,6 +22,7 @@
 #include <string>
 
 #include "kudu/consensus/consensus.service.h"
+#include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/port.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/tserver/tserver_admin.service.h"
@@ -36,6 +37,7 @@ class Message;
 namespace kudu {
 
 class RowwiseIterator;
+class ScanAggregator;
 class Schema;
 class Status;
 class Timestamp;
@@ -58,8 +60,13 @@ class GetNodeInstanceRequestPB;
 class GetNodeInstanceResponsePB;
 class LeaderStepDownRequestPB;
 class LeaderStepDownResponsePB;
+class MultiUpdateConsensusRequestPB;
+class MultiUpdateConsensusResponsePB;
+class RaftConsensus;
 class RunLeaderElectionRequestPB;
 class RunLeaderElectionResponsePB;
+class SendSafeTimeRequestPB;
+class SendSafeTimeResponsePB;
 class StartTabletCopyRequestPB;
 class StartTabletCopyResponsePB;
 class TimeManager;
@@ -70,12 +77,14 @@ class VoteResponsePB;
 } // namespace consensus
 
 namespace rpc {
+class RequestIdPB;
 class RpcContext;
 } // namespace rpc
 
 namespace tablet {
 class Tablet;
 class TabletReplica;
+class TransactionCompletionCallback;
 } // namespace tablet
 
 namespace tserver {
@@ -88,6 +97,9 @@ class CreateTabletRequestPB;
 class CreateTabletResponsePB;
 class DeleteTabletRequestPB;
 class DeleteTabletResponsePB;
+class GetHotTabletsRequestPB;
+class GetHotTabletsResponsePB;
+class ScanProfilePB;
 class ScanResultCollector;
 class TabletReplicaLookupIf;
 class TabletServer;
@@ -111,6 +123,9 @@ class TabletServiceImpl : public TabletServerServiceIf {
   virtual void Write(const WriteRequestPB* req, WriteResponsePB* resp,
                    rpc::RpcContext* context) OVERRIDE;
 
+  void MultiWrite(const MultiWriteRequestPB* req, MultiWriteResponsePB* resp,
+                  rpc::RpcContext* context) override;
+
   virtual void Scan(const ScanRequestPB* req,
                     ScanResponsePB* resp,
                     rpc::RpcContext* context) OVERRIDE;
@@ -136,10 +151,27 @@ class TabletServiceImpl : public TabletServerServiceIf {
   virtual void Shutdown() OVERRIDE;
 
  private:
+  // Verifies that the authz token of 'req' grants write privileges. If not,
+  // responds to the RPC associated with 'context' and returns false.
+  bool VerifyWritePrivilegesOrRespond(const WriteRequestPB& req, rpc::RpcContext* context);
+
+  // Checks that the write 'req' can be applied to its tablet and submits it,
+  // to be completed by 'callback'. If the write can't be submitted, returns
+  // the reason and sets 'error_code', without running 'callback'.
+  // Submits the write in 'req', whose row operations may be in sidecars of
+  // the call of 'context'.
+  Status SubmitWrite(const WriteRequestPB* req,
+                     WriteResponsePB* resp,
+                     const rpc::RpcContext* context,
+                     const rpc::RequestIdPB* request_id,
+                     gscoped_ptr<tablet::TransactionCompletionCallback> callback,
+                     TabletServerErrorPB::Code* error_code);
+
   Status HandleNewScanRequest(tablet::TabletReplica* tablet_replica,
                               const ScanRequestPB* req,
                               const rpc::RpcContext* rpc_context,
                               ScanResultCollector* result_collector,
+                              ScanProfilePB* scan_profile,
                               std::string* scanner_id,
                               Timestamp* snap_timestamp,
                               bool* has_more_results,
@@ -148,6 +180,7 @@ class TabletServiceImpl : public TabletServerServiceIf {
   Status HandleContinueScanRequest(const ScanRequestPB* req,
                                    const rpc::RpcContext* rpc_context,
                                    ScanResultCollector* result_collector,
+                                   ScanProfilePB* scan_profile,
                                    bool* has_more_results,
                                    TabletServerErrorPB::Code* error_code);
 
@@ -155,7 +188,9 @@ class TabletServiceImpl : public TabletServerServiceIf {
                               const rpc::RpcContext* rpc_context,
                               const Schema& projection,
                               tablet::Tablet* tablet,
+                              consensus::RaftConsensus* consensus,
                               consensus::TimeManager* time_manager,
+                              ScanAggregator* aggregator,
                               std::unique_ptr<RowwiseIterator>* iter,
                               Timestamp* snap_timestamp);
 
@@ -165,9 +200,12 @@ class TabletServiceImpl : public TabletServerServiceIf {
   Status ValidateTimestamp(const Timestamp& snap_timestamp);
 
   // Pick a timestamp according to the scan mode, and verify that the
-  // timestamp is after the tablet's ancient history mark.
+  // timestamp is after the tablet's ancient history mark. If the scan doesn't
+  // specify a snapshot timestamp and 'consensus' holds a leader lease, picks
+  // the timestamp following the latest committed operation.
   Status PickAndVerifyTimestamp(const NewScanRequestPB& scan_pb,
                                 tablet::Tablet* tablet,
+                                consensus::RaftConsensus* consensus,
                                 Timestamp* snap_timestamp);
 
   TabletServer* server_;
@@ -193,6 +231,10 @@ class TabletServiceAdminImpl : public TabletServerAdminServiceIf {
                            AlterSchemaResponsePB* resp,
                            rpc::RpcContext* context) OVERRIDE;
 
+  virtual void GetHotTablets(const GetHotTabletsRequestPB* req,
+                             GetHotTabletsResponsePB* resp,
+                             rpc::RpcContext* context) OVERRIDE;
+
  private:
   TabletServer* server_;
 };
@@ -212,6 +254,10 @@ class ConsensusServiceImpl : public consensus::ConsensusServiceIf {
                                consensus::ConsensusResponsePB* resp,
                                rpc::RpcContext* context) OVERRIDE;
 
+  virtual void MultiUpdateConsensus(const consensus::MultiUpdateConsensusRequestPB* req,
+                                    consensus::MultiUpdateConsensusResponsePB* resp,
+                                    rpc::RpcContext* context) OVERRIDE;
+
   virtual void RequestConsensusVote(const consensus::VoteRequestPB* req,
                                     consensus::VoteResponsePB* resp,
                                     rpc::RpcContext* context) OVERRIDE;
@@ -244,6 +290,10 @@ class ConsensusServiceImpl : public consensus::ConsensusServiceIf {
                            consensus::GetLastOpIdResponsePB* resp,
                            rpc::RpcContext* context) OVERRIDE;
 
+  virtual void SendSafeTime(const consensus::SendSafeTimeRequestPB* req,
+                            consensus::SendSafeTimeResponsePB* resp,
+                            rpc::RpcContext* context) OVERRIDE;
+
   virtual void GetConsensusState(const consensus::GetConsensusStateRequestPB* req,
                                  consensus::GetConsensusStateResponsePB* resp,
                                  rpc::RpcContext* context) OVERRIDE;
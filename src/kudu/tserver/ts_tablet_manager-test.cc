@@ -23,10 +23,12 @@
 #include <utility>
 #include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
 #include "kudu/common/common.pb.h"
+#include "kudu/common/partial_row.h"
 #include "kudu/common/partition.h"
 #include "kudu/common/schema.h"
 #include "kudu/consensus/metadata.pb.h"
@@ -36,6 +38,8 @@
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/master/master.pb.h"
+#include "kudu/tablet/local_tablet_writer.h"
+#include "kudu/tablet/metadata.pb.h"
 #include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet-harness.h"
 #include "kudu/tablet/tablet_replica.h"
@@ -55,6 +59,9 @@
 #define ASSERT_MONOTONIC_REPORT_SEQNO(report_seqno, tablet_report) \
   ASSERT_NO_FATAL_FAILURE(AssertMonotonicReportSeqno(report_seqno, tablet_report))
 
+DECLARE_bool(lazily_open_tablets);
+DECLARE_bool(tablet_flush_on_shutdown);
+
 using std::string;
 using std::vector;
 
@@ -168,6 +175,69 @@ TEST_F(TsTabletManagerTest, TestCreateTablet) {
   ASSERT_EQ(kTabletId, replica->tablet()->tablet_id());
 }
 
+// Tests that the tablets found at startup are only opened on their first
+// access with --lazily_open_tablets.
+TEST_F(TsTabletManagerTest, TestLazilyOpenTablets) {
+  scoped_refptr<TabletReplica> replica;
+  ASSERT_OK(CreateNewTablet(kTabletId, schema_, &replica));
+  replica.reset();
+
+  FLAGS_lazily_open_tablets = true;
+  mini_server_->Shutdown();
+  mini_server_.reset(new MiniTabletServer(GetTestPath("TsTabletManagerTest-fsroot"),
+                                          HostPort("127.0.0.1", 0)));
+  ASSERT_OK(mini_server_->Start());
+  ASSERT_OK(mini_server_->WaitStarted());
+  tablet_manager_ = mini_server_->server()->tablet_manager();
+
+  // The tablet is registered, but not bootstrapped.
+  ASSERT_TRUE(tablet_manager_->LookupTablet(kTabletId, &replica));
+  ASSERT_EQ(tablet::INITIALIZED, replica->state());
+  ASSERT_EQ(nullptr, replica->tablet());
+
+  // Its first access opens it, once.
+  tablet_manager_->OpenTabletIfDeferred(replica);
+  tablet_manager_->OpenTabletIfDeferred(replica);
+  ASSERT_OK(replica->WaitUntilConsensusRunning(MonoDelta::FromSeconds(10)));
+  ASSERT_EQ(tablet::RUNNING, replica->state());
+  ASSERT_EQ(kTabletId, replica->tablet()->tablet_id());
+}
+
+// Tests that the in-memory stores of the tablets are flushed when the tablet
+// server shuts down with --tablet_flush_on_shutdown.
+TEST_F(TsTabletManagerTest, TestFlushTabletsOnShutdown) {
+  const int kNumRows = 100;
+  FLAGS_tablet_flush_on_shutdown = true;
+  Schema schema({ ColumnSchema("key", INT32) }, 1);
+  scoped_refptr<TabletReplica> replica;
+  ASSERT_OK(CreateNewTablet(kTabletId, schema, &replica));
+
+  // Insert the rows without going through the WAL, so that the rows are only
+  // found after the restart if the MemRowSet was flushed.
+  tablet::LocalTabletWriter writer(replica->tablet(), &schema);
+  KuduPartialRow row(&schema);
+  for (int i = 0; i < kNumRows; i++) {
+    ASSERT_OK(row.SetInt32(0, i));
+    ASSERT_OK(writer.Insert(row));
+  }
+  ASSERT_EQ(0, replica->tablet()->num_rowsets());
+  replica.reset();
+
+  mini_server_->Shutdown();
+  mini_server_.reset(new MiniTabletServer(GetTestPath("TsTabletManagerTest-fsroot"),
+                                          HostPort("127.0.0.1", 0)));
+  ASSERT_OK(mini_server_->Start());
+  ASSERT_OK(mini_server_->WaitStarted());
+  tablet_manager_ = mini_server_->server()->tablet_manager();
+
+  ASSERT_TRUE(tablet_manager_->LookupTablet(kTabletId, &replica));
+  ASSERT_OK(replica->WaitUntilConsensusRunning(MonoDelta::FromSeconds(10)));
+  ASSERT_EQ(1, replica->tablet()->num_rowsets());
+  uint64_t count;
+  ASSERT_OK(replica->tablet()->CountRows(&count));
+  ASSERT_EQ(kNumRows, count);
+}
+
 static void AssertMonotonicReportSeqno(int64_t* report_seqno,
                                        const TabletReportPB &report) {
   ASSERT_LT(*report_seqno, report.sequence_number());
@@ -17,7 +17,9 @@
 
 #include "kudu/tserver/ts_tablet_manager.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <iterator>
 #include <memory>
 #include <mutex>
 #include <ostream>
@@ -33,6 +35,8 @@
 #include <glog/logging.h>
 
 #include "kudu/clock/clock.h"
+#include "kudu/codegen/compilation_manager.h"
+#include "kudu/common/schema.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/consensus/consensus.pb.h"
@@ -54,6 +58,7 @@
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/master.pb.h"
 #include "kudu/rpc/result_tracker.h"
+#include "kudu/tablet/hot_spot_tracker.h"
 #include "kudu/tablet/metadata.pb.h"
 #include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet_bootstrap.h"
@@ -97,6 +102,22 @@ DEFINE_int32(tablet_start_warn_threshold_ms, 500,
              "a warning with a trace.");
 TAG_FLAG(tablet_start_warn_threshold_ms, hidden);
 
+DEFINE_bool(tablet_open_codegen_warm_up, true,
+            "Whether to compile the generated code commonly used by a tablet in the "
+            "background when the tablet is opened, rather than on its first writes "
+            "and scans. Until then, these use the slower interpreted code paths.");
+TAG_FLAG(tablet_open_codegen_warm_up, advanced);
+TAG_FLAG(tablet_open_codegen_warm_up, runtime);
+
+DEFINE_bool(lazily_open_tablets, false,
+            "Whether to defer the bootstrap of the tablets found at startup until "
+            "they're first accessed by a scan, a write or a Raft request. The "
+            "deferred tablets are registered with their metadata only, and report "
+            "the INITIALIZED state until then. This speeds up the startup and saves "
+            "the memory of servers with many cold tablets, at the cost of the "
+            "latency of the first access to each tablet.");
+TAG_FLAG(lazily_open_tablets, experimental);
+
 DEFINE_double(fault_crash_after_blocks_deleted, 0.0,
               "Fraction of the time when the tablet will crash immediately "
               "after deleting the data blocks during tablet deletion. "
@@ -122,6 +143,14 @@ DEFINE_double(fault_crash_after_tc_files_fetched, 0.0,
               "(For testing only!)");
 TAG_FLAG(fault_crash_after_tc_files_fetched, unsafe);
 
+DEFINE_bool(tablet_flush_on_shutdown, false,
+            "Whether to flush the in-memory stores of the running tablets and to "
+            "garbage collect their WALs when the tablet server shuts down, so that "
+            "the tablets don't replay their WALs on restart. This makes the "
+            "shutdown slower but the next startup faster.");
+TAG_FLAG(tablet_flush_on_shutdown, experimental);
+TAG_FLAG(tablet_flush_on_shutdown, runtime);
+
 DEFINE_int32(tablet_state_walk_min_period_ms, 1000,
              "Minimum amount of time in milliseconds between walks of the "
              "tablet map to update tablet state counts.");
@@ -198,6 +227,7 @@ using fs::DataDirManager;
 using log::Log;
 using master::ReportedTabletPB;
 using master::TabletReportPB;
+using tablet::HotSpotTracker;
 using tablet::Tablet;
 using tablet::TABLET_DATA_COPYING;
 using tablet::TABLET_DATA_DELETED;
@@ -356,11 +386,24 @@ Status TSTabletManager::Init() {
   LOG(INFO) << Substitute("Loaded tablet metadata ($0 total tablets, $1 live tablets)",
                           loaded_count, metas.size());
 
-  // Now submit the "Open" task for each.
+  // Now submit the "Open" task for each, or register it to be opened on its
+  // first access.
   int registered_count = 0;
+  int deferred_count = 0;
   for (const auto& meta : metas) {
     KLOG_EVERY_N_SECS(INFO, 1) << Substitute("Registering tablets ($0/$1 complete)",
                                              registered_count, metas.size());
+    if (FLAGS_lazily_open_tablets) {
+      scoped_refptr<TabletReplica> replica;
+      RETURN_NOT_OK(CreateAndRegisterTabletReplica(meta, NEW_REPLICA, &replica));
+      if (replica->state() == tablet::INITIALIZED) {
+        std::lock_guard<RWMutex> lock(lock_);
+        InsertOrDie(&deferred_replicas_, meta->tablet_id(), std::move(replica));
+        deferred_count++;
+      }
+      registered_count++;
+      continue;
+    }
     scoped_refptr<TransitionInProgressDeleter> deleter;
     {
       std::lock_guard<RWMutex> lock(lock_);
@@ -373,7 +416,8 @@ Status TSTabletManager::Init() {
                                                             this, replica, deleter)));
     registered_count++;
   }
-  LOG(INFO) << Substitute("Registered $0 tablets", registered_count);
+  LOG(INFO) << Substitute("Registered $0 tablets ($1 to be opened on first access)",
+                          registered_count, deferred_count);
 
   {
     std::lock_guard<RWMutex> lock(lock_);
@@ -383,6 +427,10 @@ Status TSTabletManager::Init() {
   return Status::OK();
 }
 
+bool TSTabletManager::AreBootstrapsFinished() {
+  return open_tablet_pool_->WaitFor(MonoDelta::FromMilliseconds(0));
+}
+
 Status TSTabletManager::WaitForAllBootstrapsToFinish() {
   CHECK_EQ(state(), MANAGER_RUNNING);
 
@@ -924,6 +972,10 @@ Status TSTabletManager::DeleteTablet(
   }
 
   replica->Stop();
+  {
+    std::lock_guard<RWMutex> lock(lock_);
+    deferred_replicas_.erase(tablet_id);
+  }
 
   boost::optional<OpId> opt_last_logged_opid;
   if (consensus) {
@@ -1033,6 +1085,13 @@ void TSTabletManager::OpenTablet(const scoped_refptr<TabletReplica>& replica,
   shared_ptr<Tablet> tablet;
   scoped_refptr<Log> log;
 
+  // Compile the code for the tablet's schema concurrently with the bootstrap,
+  // on the compilation manager's own thread.
+  if (FLAGS_tablet_open_codegen_warm_up) {
+    codegen::CompilationManager::GetSingleton()->WarmUp(
+        replica->tablet_metadata()->schema());
+  }
+
   VLOG(1) << LogPrefix(tablet_id) << "Bootstrapping tablet";
   TRACE("Bootstrapping tablet");
 
@@ -1149,6 +1208,33 @@ void TSTabletManager::Shutdown() {
   vector<scoped_refptr<TabletReplica> > replicas_to_shutdown;
   GetTabletReplicas(&replicas_to_shutdown);
 
+  // Flush the tablets before shutting them down, in parallel since each flush
+  // is bound by the disks of the tablet.
+  if (FLAGS_tablet_flush_on_shutdown) {
+    LOG(INFO) << Substitute("Flushing $0 tablets before shutting them down",
+                            replicas_to_shutdown.size());
+    int max_flush_threads = FLAGS_num_tablets_to_open_simultaneously;
+    if (max_flush_threads == 0) {
+      // Default to the number of disks.
+      max_flush_threads = fs_manager_->GetDataRootDirs().size();
+    }
+    gscoped_ptr<ThreadPool> flush_pool;
+    Status s = ThreadPoolBuilder("tablet-flush")
+        .set_max_threads(max_flush_threads)
+        .Build(&flush_pool);
+    WARN_NOT_OK(s, "Unable to create the thread pool to flush tablets");
+    if (s.ok()) {
+      for (const scoped_refptr<TabletReplica>& replica : replicas_to_shutdown) {
+        WARN_NOT_OK(flush_pool->SubmitFunc([this, replica]() {
+                      this->FlushTabletForShutdown(replica);
+                    }),
+                    LogPrefix(replica->tablet_id()) + "Unable to flush tablet");
+      }
+      flush_pool->Wait();
+      flush_pool->Shutdown();
+    }
+  }
+
   for (const scoped_refptr<TabletReplica>& replica : replicas_to_shutdown) {
     replica->Shutdown();
   }
@@ -1160,11 +1246,34 @@ void TSTabletManager::Shutdown() {
     CHECK_EQ(tablet_map_.size(), replicas_to_shutdown.size())
       << "Map contents changed during shutdown!";
     tablet_map_.clear();
+    deferred_replicas_.clear();
 
     state_ = MANAGER_SHUTDOWN;
   }
 }
 
+void TSTabletManager::FlushTabletForShutdown(const scoped_refptr<TabletReplica>& replica) {
+  if (replica->state() != tablet::RUNNING) {
+    return;
+  }
+  shared_ptr<Tablet> tablet = replica->shared_tablet();
+  if (!tablet) {
+    return;
+  }
+  LOG_TIMING_PREFIX(INFO, LogPrefix(replica->tablet_id()), "flushing tablet before shutdown") {
+    Status s = tablet->Flush();
+    if (s.ok()) {
+      s = tablet->FlushAllDMS();
+    }
+    if (s.ok()) {
+      // The flushes released the log anchors of the in-memory stores, so
+      // only the tail of the WAL is retained.
+      s = replica->RunLogGC();
+    }
+    WARN_NOT_OK(s, LogPrefix(replica->tablet_id()) + "Unable to flush tablet before shutdown");
+  }
+}
+
 void TSTabletManager::RegisterTablet(const std::string& tablet_id,
                                      const scoped_refptr<TabletReplica>& replica,
                                      RegisterTabletReplicaMode mode) {
@@ -1210,6 +1319,43 @@ const NodeInstancePB& TSTabletManager::NodeInstance() const {
   return server_->instance_pb();
 }
 
+void TSTabletManager::OpenTabletIfDeferred(const scoped_refptr<TabletReplica>& replica) {
+  // Only deferred replicas are left INITIALIZED, so that the other replicas
+  // don't take the lock.
+  if (PREDICT_TRUE(replica->state() != tablet::INITIALIZED)) {
+    return;
+  }
+  const string& tablet_id = replica->tablet_id();
+  scoped_refptr<TransitionInProgressDeleter> deleter;
+  {
+    std::lock_guard<RWMutex> lock(lock_);
+    const scoped_refptr<TabletReplica>* deferred = FindOrNull(deferred_replicas_, tablet_id);
+    if (!deferred || deferred->get() != replica.get()) {
+      // The replica is being opened already, or wasn't deferred.
+      return;
+    }
+    if (PREDICT_FALSE(!CheckRunningUnlocked(nullptr).ok())) {
+      return;
+    }
+    Status s = StartTabletStateTransitionUnlocked(tablet_id, "opening tablet", &deleter);
+    if (PREDICT_FALSE(!s.ok())) {
+      // The replica is being deleted: it's opened on a later access if it's
+      // only tombstoned.
+      VLOG(1) << LogPrefix(tablet_id) << "Not opening deferred tablet: " << s.ToString();
+      return;
+    }
+    deferred_replicas_.erase(tablet_id);
+  }
+
+  LOG(INFO) << LogPrefix(tablet_id) << "Opening tablet on its first access";
+  Status s = open_tablet_pool_->SubmitFunc(boost::bind(&TSTabletManager::OpenTablet,
+                                                       this, replica, deleter));
+  if (PREDICT_FALSE(!s.ok())) {
+    // The tablet manager is shutting down.
+    LOG(WARNING) << LogPrefix(tablet_id) << "Unable to open tablet: " << s.ToString();
+  }
+}
+
 void TSTabletManager::GetTabletReplicas(vector<scoped_refptr<TabletReplica> >* replicas) const {
   shared_lock<RWMutex> l(lock_);
   AppendValuesFromMap(tablet_map_, replicas);
@@ -1236,6 +1382,53 @@ int TSTabletManager::GetNumLiveTablets() const {
   return count;
 }
 
+void TSTabletManager::GetHotTablets(int max_tablets, int max_keys,
+                                    vector<HotTabletPB>* tablets) const {
+  vector<scoped_refptr<TabletReplica>> replicas;
+  GetTabletReplicas(&replicas);
+
+  vector<HotTabletPB> hot_tablets;
+  for (const auto& replica : replicas) {
+    if (replica->state() != tablet::RUNNING) {
+      continue;
+    }
+    shared_ptr<Tablet> tablet = replica->shared_tablet();
+    if (!tablet) {
+      continue;
+    }
+    HotTabletPB hot_tablet;
+    hot_tablet.set_tablet_id(replica->tablet_id());
+    hot_tablet.set_table_name(replica->tablet_metadata()->table_name());
+    for (auto type : { HotSpotTracker::WRITE, HotSpotTracker::READ }) {
+      HotSpotTracker::Load load;
+      tablet->hot_spots()->GetLoad(type, max_keys, &load);
+      auto* keys = type == HotSpotTracker::WRITE ? hot_tablet.mutable_written_keys()
+                                                 : hot_tablet.mutable_read_keys();
+      for (const auto& entry : load.hot_keys) {
+        auto* key = keys->Add();
+        key->set_key(tablet->schema()->DebugEncodedRowKey(entry.item, Schema::START_KEY));
+        key->set_share(static_cast<double>(entry.count) / load.total_key_count);
+      }
+      if (type == HotSpotTracker::WRITE) {
+        hot_tablet.set_rows_written_per_sec(load.rows_per_sec);
+      } else {
+        hot_tablet.set_rows_read_per_sec(load.rows_per_sec);
+      }
+    }
+    hot_tablets.emplace_back(std::move(hot_tablet));
+  }
+
+  auto rate = [](const HotTabletPB& t) {
+    return t.rows_written_per_sec() + t.rows_read_per_sec();
+  };
+  std::sort(hot_tablets.begin(), hot_tablets.end(),
+            [&](const HotTabletPB& a, const HotTabletPB& b) { return rate(a) > rate(b); });
+  if (hot_tablets.size() > max_tablets) {
+    hot_tablets.resize(max_tablets);
+  }
+  std::move(hot_tablets.begin(), hot_tablets.end(), std::back_inserter(*tablets));
+}
+
 void TSTabletManager::InitLocalRaftPeerPB() {
   DCHECK_EQ(state(), MANAGER_INITIALIZING);
   local_peer_pb_.set_permanent_uuid(fs_manager_->uuid());
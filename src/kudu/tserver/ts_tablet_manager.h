@@ -103,6 +103,9 @@ class TSTabletManager : public tserver::TabletReplicaLookupIf {
   // the first tablet whose bootstrap failed.
   Status WaitForAllBootstrapsToFinish();
 
+  // Returns true if the bootstraps of the tablets found on startup finished.
+  bool AreBootstrapsFinished();
+
   // Shut down all of the tablets, gracefully flushing before shutdown.
   void Shutdown();
 
@@ -158,6 +161,11 @@ class TSTabletManager : public tserver::TabletReplicaLookupIf {
 
   virtual const NodeInstancePB& NodeInstance() const override;
 
+  // Submits the opening of 'replica' to the open pool if it was deferred by
+  // --lazily_open_tablets and hasn't started yet.
+  virtual void OpenTabletIfDeferred(
+      const scoped_refptr<tablet::TabletReplica>& replica) override;
+
   // Initiate tablet copy of the specified tablet on the tablet_copy_pool_.
   // See the StartTabletCopy() RPC declaration in consensus.proto for details.
   // 'cb' is guaranteed to be invoked as a callback.
@@ -192,6 +200,13 @@ class TSTabletManager : public tserver::TabletReplicaLookupIf {
   // Return the number of tablets in RUNNING or BOOTSTRAPPING state.
   int GetNumLiveTablets() const;
 
+  // Adds the recent load of the at most 'max_tablets' hottest running
+  // replicas to 'tablets', by the sum of the rates of the rows written to and
+  // read from them, the hottest first. At most 'max_keys' written keys, and
+  // read keys, are returned per replica.
+  void GetHotTablets(int max_tablets, int max_keys,
+                     std::vector<HotTabletPB>* tablets) const;
+
   Status RunAllLogGC();
 
   // Delete the tablet using the specified delete_type as the final metadata
@@ -280,6 +295,11 @@ class TSTabletManager : public tserver::TabletReplicaLookupIf {
   void OpenTablet(const scoped_refptr<tablet::TabletReplica>& replica,
                   const scoped_refptr<TransitionInProgressDeleter>& deleter);
 
+  // Flushes the MemRowSet and the DeltaMemStores of 'replica' if it is
+  // running, and then garbage collects its WAL, so that the tablet is
+  // restarted without replaying most of its WAL.
+  void FlushTabletForShutdown(const scoped_refptr<tablet::TabletReplica>& replica);
+
   // Open a tablet whose metadata has already been loaded.
   void BootstrapAndInitTablet(const scoped_refptr<tablet::TabletMetadata>& meta,
                               scoped_refptr<tablet::TabletReplica>* replica);
@@ -339,7 +359,7 @@ class TSTabletManager : public tserver::TabletReplicaLookupIf {
   typedef std::unordered_map<std::string, scoped_refptr<tablet::TabletReplica> > TabletMap;
 
   // Lock protecting tablet_map_, dirty_tablets_, state_,
-  // transition_in_progress_, perm_deleted_tablet_ids_,
+  // transition_in_progress_, perm_deleted_tablet_ids_, deferred_replicas_,
   // tablet_state_counts_, and last_walked_.
   mutable RWMutex lock_;
 
@@ -355,6 +375,10 @@ class TSTabletManager : public tserver::TabletReplicaLookupIf {
   // bootstrap, creation, or deletion is in-progress
   TransitionInProgressMap transition_in_progress_;
 
+  // The replicas registered at startup whose opening is deferred until
+  // they're first accessed. See --lazily_open_tablets.
+  TabletMap deferred_replicas_;
+
   MetricRegistry* metric_registry_;
 
   TabletCopyClientMetrics tablet_copy_metrics_;
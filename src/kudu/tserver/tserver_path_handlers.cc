@@ -18,6 +18,7 @@
 #include "kudu/tserver/tserver_path_handlers.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <iosfwd>
 #include <map>
 #include <memory>
@@ -30,6 +31,7 @@
 
 #include <boost/bind.hpp> // IWYU pragma: keep
 #include <glog/logging.h>
+#include <google/protobuf/repeated_field.h>
 
 #include "kudu/common/common.pb.h"
 #include "kudu/common/iterator_stats.h"
@@ -59,6 +61,7 @@
 #include "kudu/tserver/scanners.h"
 #include "kudu/tserver/tablet_server.h"
 #include "kudu/tserver/ts_tablet_manager.h"
+#include "kudu/tserver/tserver_admin.pb.h"
 #include "kudu/util/easy_json.h"
 #include "kudu/util/maintenance_manager.h"
 #include "kudu/util/maintenance_manager.pb.h"
@@ -68,6 +71,7 @@
 #include "kudu/util/url-coding.h"
 #include "kudu/util/web_callback_registry.h"
 
+using google::protobuf::RepeatedPtrField;
 using kudu::MaintenanceManagerStatusPB;
 using kudu::consensus::ConsensusStatePB;
 using kudu::consensus::GetConsensusRole;
@@ -108,6 +112,14 @@ string TabletLink(const string& id) {
                     EscapeForHtmlToString(id));
 }
 
+string HotKeysToString(const RepeatedPtrField<HotTabletPB::HotKeyPB>& keys) {
+  vector<string> key_strs;
+  for (const auto& key : keys) {
+    key_strs.emplace_back(StringPrintf("%s (%.1f%%)", key.key().c_str(), key.share() * 100));
+  }
+  return JoinStrings(key_strs, ", ");
+}
+
 bool IsTombstoned(const scoped_refptr<TabletReplica>& replica) {
   return replica->data_state() == tablet::TABLET_DATA_TOMBSTONED;
 }
@@ -231,6 +243,10 @@ Status TabletServerPathHandlers::Register(Webserver* server) {
     "/maintenance-manager", "",
     boost::bind(&TabletServerPathHandlers::HandleMaintenanceManagerPage, this, _1, _2),
     true /* styled */, false /* is_on_nav_bar */);
+  server->RegisterPathHandler(
+    "/hot-tablets", "",
+    boost::bind(&TabletServerPathHandlers::HandleHotTabletsPage, this, _1, _2),
+    true /* styled */, false /* is_on_nav_bar */);
 
   return Status::OK();
 }
@@ -593,6 +609,9 @@ void TabletServerPathHandlers::HandleDashboardsPage(const Webserver::WebRequest&
   *output << GetDashboardLine("maintenance-manager", "Maintenance Manager",
                               "List of operations that are currently running and those "
                               "that are registered.");
+  *output << GetDashboardLine("hot-tablets", "Hot Tablets",
+                              "List of the tablets written to and read from the most, "
+                              "and of their hot keys.");
   *output << "</tbody></table>\n";
 }
 
@@ -633,6 +652,22 @@ void TabletServerPathHandlers::HandleMaintenanceManagerPage(const Webserver::Web
       HumanReadableElapsedTime::ToShortString(op_pb.duration_millis() / 1000.0);
     completed_op["time_since_start"] =
       HumanReadableElapsedTime::ToShortString(op_pb.millis_since_start() / 1000.0);
+    // Protobuf maps aren't ordered.
+    const map<string, int64_t> metrics(op_pb.metrics().begin(), op_pb.metrics().end());
+    vector<string> metric_strs;
+    for (const auto& metric : metrics) {
+      metric_strs.emplace_back(Substitute("$0=$1", metric.first, metric.second));
+    }
+    completed_op["metrics"] = JoinStrings(metric_strs, ", ");
+  }
+
+  EasyJson completed_metrics = output->Set("completed_operations_metrics", EasyJson::kArray);
+  const map<string, int64_t> metrics(pb.completed_operations_metrics().begin(),
+                                     pb.completed_operations_metrics().end());
+  for (const auto& metric : metrics) {
+    EasyJson completed_metric = completed_metrics.PushBack(EasyJson::kObject);
+    completed_metric["name"] = metric.first;
+    completed_metric["value"] = metric.second;
   }
 
   EasyJson registered_ops = output->Set("registered_operations", EasyJson::kArray);
@@ -646,5 +681,35 @@ void TabletServerPathHandlers::HandleMaintenanceManagerPage(const Webserver::Web
   }
 }
 
+void TabletServerPathHandlers::HandleHotTabletsPage(const Webserver::WebRequest& req,
+                                                    Webserver::WebResponse* resp) {
+  EasyJson* output = resp->output;
+  // The same limits as the GetHotTablets() RPC's defaults.
+  const GetHotTabletsRequestPB defaults;
+  vector<HotTabletPB> tablets;
+  tserver_->tablet_manager()->GetHotTablets(defaults.max_tablets(),
+                                            defaults.max_keys_per_tablet(),
+                                            &tablets);
+  if (ContainsKey(req.parsed_args, "raw")) {
+    GetHotTabletsResponsePB pb;
+    for (auto& tablet : tablets) {
+      pb.add_tablets()->Swap(&tablet);
+    }
+    (*output)["raw"] = SecureDebugString(pb);
+    return;
+  }
+
+  EasyJson tablets_json = output->Set("tablets", EasyJson::kArray);
+  for (const auto& tablet : tablets) {
+    EasyJson tablet_json = tablets_json.PushBack(EasyJson::kObject);
+    tablet_json["id_or_link"] = TabletLink(tablet.tablet_id());
+    tablet_json["table_name"] = tablet.table_name();
+    tablet_json["rows_written_per_sec"] = StringPrintf("%.1f", tablet.rows_written_per_sec());
+    tablet_json["rows_read_per_sec"] = StringPrintf("%.1f", tablet.rows_read_per_sec());
+    tablet_json["written_keys"] = HotKeysToString(tablet.written_keys());
+    tablet_json["read_keys"] = HotKeysToString(tablet.read_keys());
+  }
+}
+
 } // namespace tserver
 } // namespace kudu
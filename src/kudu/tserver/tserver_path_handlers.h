@@ -57,6 +57,8 @@ class TabletServerPathHandlers {
                             Webserver::PrerenderedWebResponse* resp);
   void HandleMaintenanceManagerPage(const Webserver::WebRequest& req,
                                     Webserver::WebResponse* resp);
+  void HandleHotTabletsPage(const Webserver::WebRequest& req,
+                            Webserver::WebResponse* resp);
   std::string GetDashboardLine(const std::string& link,
                                const std::string& text, const std::string& desc);
 
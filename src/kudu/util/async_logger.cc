@@ -17,19 +17,36 @@
 
 #include "kudu/util/async_logger.h"
 
+#include <algorithm>
+#include <cinttypes>
+#include <ctime>
 #include <string>
 #include <thread>
 
+#include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/walltime.h"
 #include "kudu/util/monotime.h"
 
 using std::string;
 
 namespace kudu {
 
+namespace {
+
+// The rate limit of the current thread, and its token bucket.
+__thread int tls_max_messages_per_sec = 0;
+__thread double tls_rate_limit_tokens = 0;
+__thread MicrosecondsInt64 tls_rate_limit_refill_us = 0;
+
+} // anonymous namespace
+
 AsyncLogger::AsyncLogger(google::base::Logger* wrapped,
-                         int max_buffer_bytes) :
+                         int max_buffer_bytes,
+                         OverflowPolicy policy) :
     max_buffer_bytes_(max_buffer_bytes),
+    policy_(policy),
     wrapped_(DCHECK_NOTNULL(wrapped)),
+    dropped_count_(0),
     wake_flusher_cond_(&lock_),
     free_buffer_cond_(&lock_),
     flush_complete_cond_(&lock_),
@@ -62,9 +79,18 @@ void AsyncLogger::Write(bool force_flush,
                         time_t timestamp,
                         const char* message,
                         int message_len) {
+  const bool keep = IsErrorOrFatal(message, message_len);
+  if (!keep && PREDICT_FALSE(!RateLimitAllows())) {
+    dropped_count_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
   {
     MutexLock l(lock_);
     DCHECK_EQ(state_, RUNNING);
+    if (policy_ == DROP_WHEN_FULL && !keep && BufferFull(*active_buf_)) {
+      dropped_count_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
     while (BufferFull(*active_buf_)) {
       app_threads_blocked_count_for_tests_++;
       free_buffer_cond_.Wait();
@@ -132,6 +158,20 @@ void AsyncLogger::RunThread() {
     for (const auto& msg : flushing_buf_->messages) {
       wrapped_->Write(false, msg.ts, msg.message.data(), msg.message.size());
     }
+    const int64_t dropped = dropped_count_.load(std::memory_order_relaxed);
+    if (dropped > reported_dropped_count_) {
+      // Formatted like the glog messages, so that log parsers handle it.
+      const time_t now = time(nullptr);
+      struct tm t;
+      localtime_r(&now, &t);
+      const string msg = StringPrintf(
+          "W%02d%02d %02d:%02d:%02d.000000 async_logger.cc] Dropped %" PRId64
+          " log messages: the log buffers were full or the threads were rate limited\n",
+          t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec,
+          dropped - reported_dropped_count_);
+      wrapped_->Write(false, now, msg.data(), msg.size());
+      reported_dropped_count_ = dropped;
+    }
     if (flushing_buf_->flush) {
       wrapped_->Flush();
     }
@@ -143,6 +183,33 @@ void AsyncLogger::RunThread() {
   }
 }
 
+void AsyncLogger::RateLimitCurrentThread(int max_messages_per_sec) {
+  tls_max_messages_per_sec = max_messages_per_sec;
+  tls_rate_limit_tokens = max_messages_per_sec;
+  tls_rate_limit_refill_us = GetMonoTimeMicros();
+}
+
+bool AsyncLogger::RateLimitAllows() {
+  const int rate = tls_max_messages_per_sec;
+  if (PREDICT_TRUE(rate <= 0)) {
+    return true;
+  }
+  const MicrosecondsInt64 now = GetMonoTimeMicros();
+  tls_rate_limit_tokens = std::min<double>(
+      rate, tls_rate_limit_tokens + (now - tls_rate_limit_refill_us) * rate / 1e6);
+  tls_rate_limit_refill_us = now;
+  if (tls_rate_limit_tokens < 1) {
+    return false;
+  }
+  tls_rate_limit_tokens -= 1;
+  return true;
+}
+
+bool AsyncLogger::IsErrorOrFatal(const char* message, int message_len) {
+  // As in Write(), the severity of the glog messages is their first character.
+  return message_len > 0 && (message[0] == 'E' || message[0] == 'F');
+}
+
 bool AsyncLogger::BufferFull(const Buffer& buf) const {
   // We evenly divide our total buffer space between the two buffers.
   return buf.size > (max_buffer_bytes_ / 2);
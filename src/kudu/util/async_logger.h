@@ -18,6 +18,7 @@
 
 #include "kudu/gutil/macros.h"
 
+#include <atomic>
 #include <cstdint>
 #include <ctime>
 #include <memory>
@@ -57,11 +58,28 @@ namespace kudu {
 //
 // NOTE: the logger limits the total amount of buffer space, so if the underlying
 // log blocks for too long, eventually the threads generating the log messages
-// will block as well. This prevents runaway memory usage.
+// will block as well. This prevents runaway memory usage. With the
+// DROP_WHEN_FULL policy, the messages which don't fit are dropped instead,
+// except for the ERROR and FATAL ones, and the number of dropped messages is
+// written to the log once the logger thread catches up.
+//
+// Threads for which logging must never add latency, like the reactor threads,
+// may also limit the rate of the messages they log with
+// RateLimitCurrentThread(). The messages beyond that rate are dropped and
+// counted the same way.
 class AsyncLogger : public google::base::Logger {
  public:
+  // What to do with the messages logged while the buffers are full.
+  enum OverflowPolicy {
+    // Block the logging threads until the logger thread frees a buffer.
+    BLOCK_WHEN_FULL,
+    // Drop the messages, except for the ERROR and FATAL ones, which block.
+    DROP_WHEN_FULL,
+  };
+
   AsyncLogger(google::base::Logger* wrapped,
-              int max_buffer_bytes);
+              int max_buffer_bytes,
+              OverflowPolicy policy = BLOCK_WHEN_FULL);
   ~AsyncLogger();
 
   void Start();
@@ -104,6 +122,21 @@ class AsyncLogger : public google::base::Logger {
     return app_threads_blocked_count_for_tests_;
   }
 
+  // Returns the number of messages dropped since the logger was started,
+  // either because the buffers were full or because their thread was rate
+  // limited.
+  int64_t dropped_count() const {
+    return dropped_count_.load(std::memory_order_relaxed);
+  }
+
+  // Limits the rate of the messages logged by the current thread through the
+  // async loggers to 'max_messages_per_sec', with bursts of as many messages.
+  // The ERROR and FATAL messages are never dropped. 0 removes the limit.
+  //
+  // Note that glog writes each message to the log files of its severity and
+  // of the lower ones, and each write counts towards the limit.
+  static void RateLimitCurrentThread(int max_messages_per_sec);
+
  private:
   // A buffered message.
   //
@@ -157,8 +190,17 @@ class AsyncLogger : public google::base::Logger {
   bool BufferFull(const Buffer& buf) const;
   void RunThread();
 
+  // Returns whether the current thread is allowed to log one more message
+  // by its rate limit, if any.
+  static bool RateLimitAllows();
+
+  // Returns whether 'message' is an ERROR or a FATAL message, which are
+  // never dropped.
+  static bool IsErrorOrFatal(const char* message, int message_len);
+
   // The maximum number of bytes used by the entire class.
   const int max_buffer_bytes_;
+  const OverflowPolicy policy_;
   google::base::Logger* const wrapped_;
   std::thread thread_;
 
@@ -166,6 +208,11 @@ class AsyncLogger : public google::base::Logger {
   // a full buffer.
   int app_threads_blocked_count_for_tests_ = 0;
 
+  // The number of dropped messages, and the number of them which were
+  // already reported in the log by the logger thread.
+  std::atomic<int64_t> dropped_count_;
+  int64_t reported_dropped_count_ = 0;
+
   // Count of how many times the writer thread has flushed the buffers.
   // 64 bits should be enough to never worry about overflow.
   uint64_t flush_count_ = 0;
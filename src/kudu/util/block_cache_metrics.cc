@@ -45,6 +45,21 @@ METRIC_DEFINE_counter(server, block_cache_hits_caching,
                       "Use this number instead of cache_hits when trying to determine how "
                       "efficient the cache is");
 
+METRIC_DEFINE_counter(server, block_cache_probationary_segment_hits,
+                      "Block Cache Probationary Segment Hits", kudu::MetricUnit::kBlocks,
+                      "Number of lookups that found a block in the probationary segment "
+                      "of the cache. Only used if the SLRU eviction policy is configured.");
+METRIC_DEFINE_counter(server, block_cache_protected_segment_hits,
+                      "Block Cache Protected Segment Hits", kudu::MetricUnit::kBlocks,
+                      "Number of lookups that found a block in the protected segment "
+                      "of the cache. Only used if the SLRU eviction policy is configured.");
+
+METRIC_DEFINE_counter(server, block_cache_admission_rejections,
+                      "Block Cache Admission Rejections", kudu::MetricUnit::kBlocks,
+                      "Number of blocks which were not inserted in the cache because "
+                      "they were estimated to be used less often than the blocks they "
+                      "would have evicted. Only used if the admission filter is enabled.");
+
 METRIC_DEFINE_gauge_uint64(server, block_cache_usage, "Block Cache Memory Usage",
                            kudu::MetricUnit::kBytes,
                            "Memory consumed by the block cache");
@@ -61,6 +76,9 @@ BlockCacheMetrics::BlockCacheMetrics(const scoped_refptr<MetricEntity>& entity)
   MINIT(cache_hits_caching, block_cache_hits_caching);
   MINIT(cache_misses, block_cache_misses);
   MINIT(cache_misses_caching, block_cache_misses_caching);
+  MINIT(probationary_segment_hits, block_cache_probationary_segment_hits);
+  MINIT(protected_segment_hits, block_cache_protected_segment_hits);
+  MINIT(admission_rejections, block_cache_admission_rejections);
   GINIT(cache_usage, block_cache_usage);
 }
 #undef MINIT
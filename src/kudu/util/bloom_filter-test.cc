@@ -18,12 +18,17 @@
 #include <cstdint>
 #include <cstdlib>
 #include <ostream>
+#include <vector>
 
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
 #include "kudu/util/bloom_filter.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/xor_filter.h"
 
 namespace kudu {
 
@@ -89,4 +94,106 @@ TEST(TestBloomFilter, TestInsertAndProbe) {
   ASSERT_NEAR(fp_rate, expected_fp_rate, 0.20*expected_fp_rate);
 }
 
+// Verify that the probes computed in batches are the same as the ones
+// constructed one at a time.
+TEST(TestBloomFilter, TestComputeProbes) {
+  srandom(kRandomSeed);
+  std::vector<uint64_t> keys(150);
+  std::vector<Slice> slices;
+  for (auto& key : keys) {
+    key = random();
+    // Vary the key lengths, so that the lanes of a batch don't all have the
+    // same number of words.
+    slices.emplace_back(reinterpret_cast<const uint8_t*>(&key), 1 + random() % sizeof(key));
+  }
+  for (auto algorithm : { MURMUR_HASH_2, CITY_HASH }) {
+    std::vector<BloomKeyProbe> probes(slices.size());
+    BloomKeyProbe::ComputeProbes(slices.data(), slices.size(), algorithm, probes.data());
+    for (int i = 0; i < slices.size(); i++) {
+      BloomKeyProbe probe(slices[i], algorithm);
+      ASSERT_EQ(probe.hash64(), probes[i].hash64());
+      ASSERT_EQ(probe.key(), probes[i].key());
+    }
+  }
+}
+
+TEST(TestBloomFilter, TestSplitBlockInsertAndProbe) {
+  int n_keys = 2000;
+  BloomFilterBuilder bfb(
+    BloomFilterSizing::ByCountAndFPRate(n_keys, 0.01, BloomFilterType::SPLIT_BLOCK));
+  ASSERT_EQ(0, bfb.n_bytes() % SplitBloomBlock::kBytes);
+  ASSERT_EQ(SplitBloomBlock::kHashes, bfb.n_hashes());
+
+  // The filter is the smallest one achieving the desired rate, which takes
+  // a bit more space than a classic filter.
+  double expected_fp_rate = bfb.false_positive_rate();
+  ASSERT_LE(expected_fp_rate, 0.01);
+  ASSERT_GT(SplitBloomBlock::FalsePositiveRate(bfb.n_bytes() - SplitBloomBlock::kBytes, n_keys),
+            0.01);
+  ASSERT_GE(bfb.n_bits() / n_keys, 9);
+
+  AddRandomKeys(kRandomSeed, n_keys, &bfb);
+  BloomFilter bf(bfb.slice(), bfb.n_hashes(), BloomFilterType::SPLIT_BLOCK);
+  CheckRandomKeys(kRandomSeed, n_keys, bf);
+
+  uint32_t num_queries = 100000;
+  uint32_t num_positives = 0;
+  for (int i = 0; i < num_queries; i++) {
+    uint64_t key = random();
+    Slice key_slice(reinterpret_cast<const uint8_t *>(&key), sizeof(key));
+    BloomKeyProbe probe(key_slice);
+    if (bf.MayContainKey(probe)) {
+      num_positives++;
+    }
+  }
+
+  double fp_rate = static_cast<double>(num_positives) / static_cast<double>(num_queries);
+  LOG(INFO) << "FP rate: " << fp_rate << " (" << num_positives << "/" << num_queries << ")";
+  LOG(INFO) << "Expected FP rate: " << expected_fp_rate;
+  ASSERT_NEAR(fp_rate, expected_fp_rate, 0.20*expected_fp_rate);
+}
+
+// Sizing a split-block filter by its size picks the largest number of keys
+// achieving the rate.
+TEST(TestBloomFilter, TestSplitBlockSizing) {
+  BloomFilterSizing sizing = BloomFilterSizing::BySizeAndFPRate(
+      4000, 0.01, BloomFilterType::SPLIT_BLOCK);
+  ASSERT_EQ(4000, sizing.n_bytes());
+  ASSERT_LE(SplitBloomBlock::FalsePositiveRate(sizing.n_bytes(), sizing.expected_count()), 0.01);
+  ASSERT_GT(SplitBloomBlock::FalsePositiveRate(sizing.n_bytes(), sizing.expected_count() + 1),
+            0.01);
+
+  // Sizes are rounded up to whole blocks.
+  ASSERT_EQ(4000 + SplitBloomBlock::kBytes,
+            BloomFilterSizing::BySizeAndFPRate(
+                4001, 0.01, BloomFilterType::SPLIT_BLOCK).n_bytes());
+}
+
+// Xor filters take less space than bloom filters for the same rate, and are
+// probed through BloomFilter like them.
+TEST(TestBloomFilter, TestXor) {
+  int n_keys = 2000;
+  BloomFilterSizing sizing = BloomFilterSizing::ByCountAndFPRate(
+      n_keys, 0.0001, BloomFilterType::XOR);
+  ASSERT_LT(sizing.n_bytes(),
+            BloomFilterSizing::ByCountAndFPRate(n_keys, 0.0001).n_bytes() * 0.95);
+  ASSERT_EQ(n_keys, BloomFilterSizing::BySizeAndFPRate(
+      sizing.n_bytes(), 0.0001, BloomFilterType::XOR).expected_count());
+
+  XorFilterBuilder builder(XorFilter::FingerprintBitsForSize(sizing.n_bytes(), n_keys));
+  ASSERT_EQ(14, builder.fingerprint_bits());
+  srandom(kRandomSeed);
+  for (int i = 0; i < n_keys; i++) {
+    uint64_t key = random();
+    builder.AddKey(BloomKeyProbe(Slice(reinterpret_cast<const uint8_t *>(&key),
+                                       sizeof(key))).hash64());
+  }
+  faststring data;
+  ASSERT_OK(builder.Build(&data));
+  ASSERT_EQ(sizing.n_bytes(), data.size());
+  XorFilter xor_filter;
+  ASSERT_OK(XorFilter::Parse(Slice(data), &xor_filter));
+  CheckRandomKeys(kRandomSeed, n_keys, BloomFilter(xor_filter));
+}
+
 } // namespace kudu
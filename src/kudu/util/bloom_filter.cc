@@ -17,6 +17,7 @@
 
 #include "kudu/util/bloom_filter.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <ostream>
@@ -33,35 +34,119 @@ static int ComputeOptimalHashCount(size_t n_bits, size_t elems) {
   return n_hashes;
 }
 
+constexpr size_t SplitBloomBlock::kBytes;
+constexpr size_t SplitBloomBlock::kHashes;
+
+double SplitBloomBlock::FalsePositiveRate(size_t n_bytes, size_t n_keys) {
+  // The number of keys in a block follows a Poisson distribution. Given 'j'
+  // keys in a block, a bit of each of its words is set with probability
+  // 1 - (1 - 1/32)^j, and a key is a false positive if its bits in all the
+  // words of the block are set.
+  // The terms are computed in log space, since exp(-lambda) underflows for
+  // overloaded filters.
+  if (n_keys == 0) {
+    return 0;
+  }
+  double lambda = static_cast<double>(n_keys) / (n_bytes / kBytes);
+  int min_keys = std::max(0, static_cast<int>(lambda - 10 * sqrt(lambda) - 10));
+  int max_keys = static_cast<int>(lambda + 10 * sqrt(lambda) + 10);
+  double fp_rate = 0;
+  for (int j = min_keys; j <= max_keys; j++) {
+    double p_keys = exp(j * log(lambda) - lambda - lgamma(j + 1));
+    fp_rate += p_keys * pow(1 - pow(1 - 1.0 / 32, j), kHashes);
+  }
+  return fp_rate;
+}
+
 BloomFilterSizing BloomFilterSizing::ByCountAndFPRate(
-  size_t expected_count, double fp_rate) {
+  size_t expected_count, double fp_rate, BloomFilterType type) {
   CHECK_GT(fp_rate, 0);
   CHECK_LT(fp_rate, 1);
 
+  if (type == BloomFilterType::XOR) {
+    return BloomFilterSizing(
+        XorFilter::SizeForCount(expected_count, XorFilter::FingerprintBitsForFPRate(fp_rate)),
+        expected_count, type);
+  }
+  if (type == BloomFilterType::SPLIT_BLOCK) {
+    // Find the smallest number of blocks achieving the rate.
+    size_t hi = 1;
+    while (SplitBloomBlock::FalsePositiveRate(hi * SplitBloomBlock::kBytes,
+                                              expected_count) > fp_rate) {
+      hi *= 2;
+    }
+    size_t lo = hi / 2 + 1;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (SplitBloomBlock::FalsePositiveRate(mid * SplitBloomBlock::kBytes,
+                                             expected_count) > fp_rate) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return BloomFilterSizing(hi * SplitBloomBlock::kBytes, expected_count, type);
+  }
+
   double n_bits = -static_cast<double>(expected_count) * log(fp_rate)
     / kNaturalLog2 / kNaturalLog2;
   int n_bytes = static_cast<int>(ceil(n_bits / 8));
   CHECK_GT(n_bytes, 0)
     << "expected_count: " << expected_count
     << " fp_rate: " << fp_rate;
-  return BloomFilterSizing(n_bytes, expected_count);
+  return BloomFilterSizing(n_bytes, expected_count, type);
 }
 
-BloomFilterSizing BloomFilterSizing::BySizeAndFPRate(size_t n_bytes, double fp_rate) {
+BloomFilterSizing BloomFilterSizing::BySizeAndFPRate(size_t n_bytes, double fp_rate,
+                                                     BloomFilterType type) {
+  if (type == BloomFilterType::XOR) {
+    // There's always room for a few keys, even with the shortest
+    // fingerprints.
+    size_t expected_count = XorFilter::MaxCountForSize(
+        n_bytes, XorFilter::FingerprintBitsForFPRate(fp_rate));
+    if (expected_count < 1) {
+      n_bytes = XorFilter::SizeForCount(1, 1);
+      expected_count = 1;
+    }
+    return BloomFilterSizing(n_bytes, expected_count, type);
+  }
+  if (type == BloomFilterType::SPLIT_BLOCK) {
+    // Round up to whole blocks, and find the largest number of keys
+    // achieving the rate.
+    n_bytes = std::max<size_t>(
+        (n_bytes + SplitBloomBlock::kBytes - 1) / SplitBloomBlock::kBytes, 1) *
+        SplitBloomBlock::kBytes;
+    size_t lo = 1;
+    size_t hi = n_bytes * 8;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo + 1) / 2;
+      if (SplitBloomBlock::FalsePositiveRate(n_bytes, mid) > fp_rate) {
+        hi = mid - 1;
+      } else {
+        lo = mid;
+      }
+    }
+    return BloomFilterSizing(n_bytes, lo, type);
+  }
+
   size_t n_bits = n_bytes * 8;
   double expected_elems = -static_cast<double>(n_bits) * kNaturalLog2 * kNaturalLog2 /
     log(fp_rate);
   DCHECK_GT(expected_elems, 1);
-  return BloomFilterSizing(n_bytes, (size_t)ceil(expected_elems));
+  return BloomFilterSizing(n_bytes, (size_t)ceil(expected_elems), type);
 }
 
 
 BloomFilterBuilder::BloomFilterBuilder(const BloomFilterSizing &sizing)
   : n_bits_(sizing.n_bytes() * 8),
     bitmap_(new uint8_t[sizing.n_bytes()]),
-    n_hashes_(ComputeOptimalHashCount(n_bits_, sizing.expected_count())),
+    type_(sizing.type()),
+    n_hashes_(type_ == BloomFilterType::SPLIT_BLOCK ?
+              SplitBloomBlock::kHashes :
+              ComputeOptimalHashCount(n_bits_, sizing.expected_count())),
     expected_count_(sizing.expected_count()),
     n_inserted_(0) {
+  DCHECK(type_ != BloomFilterType::XOR) << "xor filters are built with XorFilterBuilder";
   Clear();
 }
 
@@ -75,14 +160,28 @@ double BloomFilterBuilder::false_positive_rate() const {
     << "expected_count_ not initialized: can't call this function on "
     << "a BloomFilter initialized from external data";
 
+  if (type_ == BloomFilterType::SPLIT_BLOCK) {
+    return SplitBloomBlock::FalsePositiveRate(n_bytes(), expected_count_);
+  }
   return pow(1 - exp(-static_cast<double>(n_hashes_) * expected_count_ / n_bits_), n_hashes_);
 }
 
-BloomFilter::BloomFilter(const Slice &data, size_t n_hashes)
+BloomFilter::BloomFilter(const Slice &data, size_t n_hashes, BloomFilterType type)
   : n_bits_(data.size() * 8),
     bitmap_(reinterpret_cast<const uint8_t *>(data.data())),
-    n_hashes_(n_hashes)
-{}
+    n_hashes_(n_hashes),
+    type_(type) {
+  DCHECK(type_ != BloomFilterType::SPLIT_BLOCK || data.size() % SplitBloomBlock::kBytes == 0);
+  DCHECK(type_ != BloomFilterType::XOR);
+}
+
+BloomFilter::BloomFilter(const XorFilter &xor_filter)
+  : n_bits_(0),
+    bitmap_(nullptr),
+    n_hashes_(0),
+    type_(BloomFilterType::XOR),
+    xor_filter_(xor_filter) {
+}
 
 
 
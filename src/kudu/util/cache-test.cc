@@ -4,9 +4,11 @@
 
 #include "kudu/util/cache.h"
 
+#include <atomic>
 #include <cstring>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -33,11 +35,17 @@ DECLARE_bool(cache_force_single_shard);
 DECLARE_string(nvm_cache_path);
 #endif // #if defined(HAVE_LIB_VMEM)
 
+DECLARE_double(cache_high_priority_pool_ratio);
 DECLARE_double(cache_memtracker_approximation_ratio);
 
+METRIC_DECLARE_counter(block_cache_admission_rejections);
+METRIC_DECLARE_counter(block_cache_probationary_segment_hits);
+METRIC_DECLARE_counter(block_cache_protected_segment_hits);
+
 using std::make_tuple;
 using std::tuple;
 using std::shared_ptr;
+using std::string;
 using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
@@ -88,14 +96,15 @@ class CacheBaseTest : public KuduTest,
     return r;
   }
 
-  void Insert(int key, int value, int charge = 1) {
+  void Insert(int key, int value, int charge = 1,
+              Cache::Priority priority = Cache::Priority::NORMAL) {
     std::string key_str = EncodeInt(key);
     std::string val_str = EncodeInt(value);
     Cache::PendingHandle* handle = CHECK_NOTNULL(
         cache_->Allocate(key_str, val_str.size(), charge));
     memcpy(cache_->MutableValue(handle), val_str.data(), val_str.size());
 
-    cache_->Release(cache_->Insert(handle, this));
+    cache_->Release(cache_->Insert(handle, this, priority));
   }
 
   void Erase(int key) {
@@ -154,6 +163,15 @@ class CacheBaseTest : public KuduTest,
         }
         MemTracker::FindTracker("cache_test-sharded_lru_cache", &mem_tracker_);
         break;
+      case Cache::EvictionPolicy::SLRU:
+        if (mem_type != Cache::MemoryType::DRAM) {
+          FAIL() << "SLRU cache can only be of DRAM type";
+        }
+        cache_.reset(NewCache<Cache::EvictionPolicy::SLRU,
+                              Cache::MemoryType::DRAM>(cache_size(),
+                                                       "cache_test"));
+        MemTracker::FindTracker("cache_test-sharded_slru_cache", &mem_tracker_);
+        break;
       default:
         FAIL() << "unrecognized cache eviction policy";
         break;
@@ -165,9 +183,8 @@ class CacheBaseTest : public KuduTest,
       ASSERT_TRUE(mem_tracker_.get());
     }
 
-    scoped_refptr<MetricEntity> entity = METRIC_ENTITY_server.Instantiate(
-        &metric_registry_, "test");
-    unique_ptr<BlockCacheMetrics> metrics(new BlockCacheMetrics(entity));
+    metric_entity_ = METRIC_ENTITY_server.Instantiate(&metric_registry_, "test");
+    unique_ptr<BlockCacheMetrics> metrics(new BlockCacheMetrics(metric_entity_));
     cache_->SetMetrics(std::move(metrics));
   }
 
@@ -177,6 +194,7 @@ class CacheBaseTest : public KuduTest,
   shared_ptr<MemTracker> mem_tracker_;
   unique_ptr<Cache> cache_;
   MetricRegistry metric_registry_;
+  scoped_refptr<MetricEntity> metric_entity_;
 };
 
 class CacheTest :
@@ -213,6 +231,12 @@ INSTANTIATE_TEST_CASE_P(
         make_tuple(Cache::MemoryType::DRAM,
                    Cache::EvictionPolicy::LRU,
                    ShardingPolicy::SingleShard),
+        make_tuple(Cache::MemoryType::DRAM,
+                   Cache::EvictionPolicy::SLRU,
+                   ShardingPolicy::MultiShard),
+        make_tuple(Cache::MemoryType::DRAM,
+                   Cache::EvictionPolicy::SLRU,
+                   ShardingPolicy::SingleShard),
         make_tuple(Cache::MemoryType::NVM,
                    Cache::EvictionPolicy::LRU,
                    ShardingPolicy::MultiShard),
@@ -224,7 +248,8 @@ INSTANTIATE_TEST_CASE_P(
     CacheTypes, CacheTest,
     ::testing::Combine(::testing::Values(Cache::MemoryType::DRAM),
                        ::testing::Values(Cache::EvictionPolicy::FIFO,
-                                         Cache::EvictionPolicy::LRU),
+                                         Cache::EvictionPolicy::LRU,
+                                         Cache::EvictionPolicy::SLRU),
                        ::testing::Values(ShardingPolicy::MultiShard,
                                          ShardingPolicy::SingleShard)));
 #endif // #if defined(HAVE_LIB_VMEM) ... #else ...
@@ -333,6 +358,38 @@ TEST_P(CacheTest, HeavyEntries) {
   ASSERT_LE(cached_weight, cache_size() + cache_size() / 10);
 }
 
+// Lookups only take the shard lock in shared mode, so make sure they're safe
+// to run concurrently with each other and with insertions and evictions.
+TEST_P(CacheTest, ConcurrentLookupsAndInserts) {
+  static constexpr int kNumHot = 100;
+  static constexpr int kNumReaders = 4;
+  const int kWeight = cache_size() / 1000;
+  for (int i = 0; i < kNumHot; i++) {
+    Insert(i, i, kWeight);
+  }
+
+  std::atomic<bool> done(false);
+  vector<std::thread> readers;
+  for (int t = 0; t < kNumReaders; t++) {
+    readers.emplace_back([&]() {
+      while (!done) {
+        for (int i = 0; i < kNumHot; i++) {
+          int r = Lookup(i);
+          // Depending on the policy, hot entries may have been evicted.
+          CHECK(r == i || r == -1) << r;
+        }
+      }
+    });
+  }
+  for (int i = 0; i < 10000; i++) {
+    Insert(1000 + i, 1000 + i, kWeight);
+  }
+  done = true;
+  for (auto& t : readers) {
+    t.join();
+  }
+}
+
 // This class is dedicated for scenarios specific for FIFOCache.
 // The scenarios use a single-shard cache for simpler logic.
 class FIFOCacheTest : public CacheBaseTest {
@@ -449,4 +506,196 @@ TEST_P(LRUCacheTest, EvictionPolicy) {
   ASSERT_EQ(-1, Lookup(200));
 }
 
+// This class is dedicated for scenarios specific for the high-priority pool
+// of an LRU cache. The scenarios use a single-shard cache for simpler logic.
+class LRUHighPriorityCacheTest : public CacheBaseTest {
+ public:
+  LRUHighPriorityCacheTest()
+      : CacheBaseTest(10 * 1024) {
+  }
+
+  void SetUp() override {
+    FLAGS_cache_high_priority_pool_ratio = 0.1;
+    SetupWithParameters(Cache::MemoryType::DRAM,
+                        Cache::EvictionPolicy::LRU,
+                        ShardingPolicy::SingleShard);
+  }
+};
+
+// Verify that high-priority entries within the reserved fraction of the
+// capacity survive a stream of normal priority entries.
+TEST_F(LRUHighPriorityCacheTest, EvictionPolicy) {
+  static constexpr int kNumElems = 20;
+  const int size_per_elem = cache_size() / kNumElems;
+  // The number of entries fitting into the high-priority pool.
+  static constexpr int kNumHigh = 2;
+
+  for (int i = 0; i < kNumHigh; ++i) {
+    Insert(i, i, size_per_elem, Cache::Priority::HIGH);
+  }
+  for (int i = 0; i < 10 * kNumElems; ++i) {
+    Insert(1000 + i, 1000 + i, size_per_elem);
+  }
+  for (int i = 0; i < kNumHigh; ++i) {
+    SCOPED_TRACE(Substitute("high-priority element: index $0", i));
+    ASSERT_EQ(i, Lookup(i));
+  }
+  for (int k : evicted_keys_) {
+    ASSERT_GE(k, 1000);
+  }
+
+  // Once the high-priority entries exceed the reserved fraction, the oldest
+  // ones are evicted like normal priority entries.
+  for (int i = 0; i < kNumHigh; ++i) {
+    Insert(2000 + i, 2000 + i, size_per_elem, Cache::Priority::HIGH);
+  }
+  for (int i = 0; i < kNumElems; ++i) {
+    Insert(3000 + i, 3000 + i, size_per_elem);
+  }
+  for (int i = 0; i < kNumHigh; ++i) {
+    ASSERT_EQ(-1, Lookup(i));
+    ASSERT_EQ(2000 + i, Lookup(2000 + i));
+  }
+}
+
+// This class is dedicated for scenarios specific for SLRU cache.
+// The scenarios use a single-shard cache for simpler logic.
+class SLRUCacheTest : public CacheBaseTest {
+ public:
+  SLRUCacheTest()
+      : CacheBaseTest(10 * 1024) {
+  }
+
+  void SetUp() override {
+    SetupWithParameters(Cache::MemoryType::DRAM,
+                        Cache::EvictionPolicy::SLRU,
+                        ShardingPolicy::SingleShard);
+  }
+};
+
+// Verify that entries which were looked up again after being inserted survive
+// a stream of entries which are never looked up, like the blocks of a scan.
+TEST_F(SLRUCacheTest, EvictionPolicy) {
+  static constexpr int kNumElems = 20;
+  const int size_per_elem = cache_size() / kNumElems;
+
+  // A few frequently used entries, looked up once more to be protected.
+  static constexpr int kNumHot = 5;
+  for (int i = 0; i < kNumHot; ++i) {
+    Insert(i, i, size_per_elem);
+    ASSERT_EQ(i, Lookup(i));
+  }
+
+  // Scan through several times the capacity worth of entries, each inserted
+  // without being looked up again.
+  for (int i = 0; i < 10 * kNumElems; ++i) {
+    Insert(1000 + i, 1000 + i, size_per_elem);
+  }
+  for (int i = 0; i < kNumHot; ++i) {
+    SCOPED_TRACE(Substitute("hot element: index $0", i));
+    ASSERT_EQ(i, Lookup(i));
+  }
+  // Only the scanned entries were evicted.
+  for (int k : evicted_keys_) {
+    ASSERT_GE(k, 1000);
+  }
+  ASSERT_EQ(kNumHot, METRIC_block_cache_probationary_segment_hits.Instantiate(
+      metric_entity_)->value());
+  ASSERT_EQ(kNumHot, METRIC_block_cache_protected_segment_hits.Instantiate(
+      metric_entity_)->value());
+
+  // Once more entries are protected than the protected segment can hold, the
+  // oldest ones are moved back to the probationary segment and are evicted by
+  // later insertions.
+  for (int i = 0; i < kNumElems; ++i) {
+    Insert(2000 + i, 2000 + i, size_per_elem);
+    ASSERT_EQ(2000 + i, Lookup(2000 + i));
+  }
+  for (int i = 0; i < kNumHot; ++i) {
+    ASSERT_EQ(-1, Lookup(i));
+  }
+}
+
+TEST_F(SLRUCacheTest, GetHotKeys) {
+  for (int i = 0; i < 5; ++i) {
+    Insert(i, i);
+  }
+  ASSERT_EQ(1, Lookup(1));
+
+  // The protected entry comes first, then the newest probationary ones.
+  vector<string> keys;
+  cache_->GetHotKeys(3, &keys);
+  ASSERT_EQ(3, keys.size());
+  EXPECT_EQ(1, DecodeInt(keys[0]));
+  EXPECT_EQ(4, DecodeInt(keys[1]));
+  EXPECT_EQ(3, DecodeInt(keys[2]));
+
+  // Keys are appended.
+  cache_->GetHotKeys(10, &keys);
+  ASSERT_EQ(8, keys.size());
+}
+
+// This class is dedicated for scenarios specific for the admission filter.
+// The scenarios use a single-shard cache for simpler logic.
+class AdmissionFilterCacheTest : public CacheBaseTest {
+ public:
+  AdmissionFilterCacheTest()
+      : CacheBaseTest(10 * 1024) {
+  }
+
+  void SetUp() override {
+    SetupWithParameters(Cache::MemoryType::DRAM,
+                        Cache::EvictionPolicy::LRU,
+                        ShardingPolicy::SingleShard);
+    cache_->EnableAdmissionFilter();
+  }
+
+  // Looks up the key like a reader would, inserting it on a miss.
+  void LookupOrInsert(int key, int charge) {
+    if (Lookup(key) == -1) {
+      Insert(key, key, charge);
+    }
+  }
+};
+
+// Verify that entries which are looked up once don't evict entries which
+// were looked up repeatedly, but that entries looked up often enough do.
+TEST_F(AdmissionFilterCacheTest, EvictionPolicy) {
+  static constexpr int kNumElems = 20;
+  const int size_per_elem = cache_size() / kNumElems;
+
+  for (int i = 0; i < kNumElems; ++i) {
+    LookupOrInsert(i, size_per_elem);
+  }
+  for (int n = 0; n < 3; ++n) {
+    for (int i = 0; i < kNumElems; ++i) {
+      ASSERT_EQ(i, Lookup(i));
+    }
+  }
+
+  // A scan of entries which are looked up only once.
+  static constexpr int kNumScanned = 100;
+  for (int i = 0; i < kNumScanned; ++i) {
+    LookupOrInsert(1000 + i, size_per_elem);
+  }
+  for (int i = 0; i < kNumElems; ++i) {
+    SCOPED_TRACE(Substitute("frequently used element: index $0", i));
+    ASSERT_EQ(i, Lookup(i));
+  }
+  for (int i = 0; i < kNumScanned; ++i) {
+    ASSERT_EQ(-1, Lookup(1000 + i));
+  }
+  for (int k : evicted_keys_) {
+    ASSERT_GE(k, 1000);
+  }
+  ASSERT_EQ(kNumScanned, METRIC_block_cache_admission_rejections.Instantiate(
+      metric_entity_)->value());
+
+  // An entry looked up more often than the others is admitted.
+  for (int n = 0; n < 10; ++n) {
+    LookupOrInsert(2000, size_per_elem);
+  }
+  ASSERT_EQ(2000, Lookup(2000));
+}
+
 }  // namespace kudu
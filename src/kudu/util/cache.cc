@@ -4,9 +4,11 @@
 
 #include "kudu/util/cache.h"
 
+#include <algorithm>
 #include <atomic>
 #include <cstdint>
 #include <cstring>
+#include <limits>
 #include <memory>
 #include <mutex>
 #include <ostream>
@@ -28,11 +30,14 @@
 #include "kudu/util/alignment.h"
 #include "kudu/util/cache_metrics.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/frequency_sketch.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/malloc.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/os-util.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/status.h"
 #include "kudu/util/test_util_prod.h"
 
 #if !defined(__APPLE__)
@@ -49,6 +54,29 @@ DEFINE_double(cache_memtracker_approximation_ratio, 0.01,
               "this ratio to improve performance. For tests.");
 TAG_FLAG(cache_memtracker_approximation_ratio, hidden);
 
+DEFINE_double(cache_slru_protected_ratio, 0.8,
+              "The fraction of the capacity of an SLRU cache which may be "
+              "used by its protected segment, i.e. the entries which have "
+              "been looked up since being inserted.");
+TAG_FLAG(cache_slru_protected_ratio, advanced);
+
+DEFINE_double(cache_high_priority_pool_ratio, 0.1,
+              "The fraction of the capacity of an LRU cache reserved for "
+              "high-priority entries, e.g. CFile index and bloom filter blocks. "
+              "Normal priority entries may use the whole capacity, but only "
+              "evict high-priority entries once these exceed this fraction. "
+              "SLRU caches insert high-priority entries straight into their "
+              "protected segment instead.");
+TAG_FLAG(cache_high_priority_pool_ratio, advanced);
+
+DEFINE_bool(cache_numa_aware, false,
+            "Whether the shards of the DRAM caches are partitioned by NUMA "
+            "node. The entries are then inserted into the shards of the NUMA "
+            "node of the inserting thread, and looked up in them first, so "
+            "that the threads of a node mostly read memory allocated on that "
+            "node. Only has an effect on machines with several NUMA nodes.");
+TAG_FLAG(cache_numa_aware, experimental);
+
 using std::atomic;
 using std::shared_ptr;
 using std::string;
@@ -69,6 +97,12 @@ typedef simple_spinlock MutexType;
 // Recency list handle. An entry is a variable length heap-allocated structure.
 // Entries are kept in a circular doubly linked list ordered by some recency
 // criterion (e.g., access time for LRU policy, insertion time for FIFO policy).
+//
+// So that lookups of hot entries need only a shared lock, an entry is moved
+// in the list only if it isn't among the most recently moved quarter of the
+// entries, and only if the exclusive lock is uncontended. Lookups also set the
+// entry's 'referenced' bit, so that an entry which couldn't be moved is given
+// another chance when it comes up for eviction (a.k.a. the CLOCK algorithm).
 struct RLHandle {
   Cache::EvictionCallback* eviction_callback;
   RLHandle* next_hash;
@@ -79,6 +113,10 @@ struct RLHandle {
   uint32_t val_length;
   std::atomic<int32_t> refs;
   uint32_t hash;      // Hash of key(); used for fast sharding and comparisons
+  bool in_protected_segment; // In the SLRU protected segment or LRU high-priority pool.
+  uint8_t numa_node;  // Index of the NUMA node whose shards hold the entry.
+  std::atomic<bool> referenced; // Whether looked up since last considered for eviction.
+  uint64_t append_seq; // Value of the shard's 'append_seq_' when last appended.
 
   // The storage for the key/value pair itself. The data is stored as:
   //   [key bytes ...] [padding up to 8-byte boundary] [value bytes ...]
@@ -194,6 +232,8 @@ string ToString(Cache::EvictionPolicy p) {
       return "fifo";
     case Cache::EvictionPolicy::LRU:
       return "lru";
+    case Cache::EvictionPolicy::SLRU:
+      return "slru";
     default:
       LOG(FATAL) << "unexpected cache eviction policy: " << static_cast<int>(p);
       break;
@@ -211,27 +251,62 @@ class CacheShard {
   // Separate from constructor so caller can easily make an array of CacheShard
   void SetCapacity(size_t capacity) {
     capacity_ = capacity;
+    protected_capacity_ = capacity * (policy == Cache::EvictionPolicy::SLRU ?
+        FLAGS_cache_slru_protected_ratio : FLAGS_cache_high_priority_pool_ratio);
     max_deferred_consumption_ = capacity * FLAGS_cache_memtracker_approximation_ratio;
   }
 
   void SetMetrics(CacheMetrics* metrics) { metrics_ = metrics; }
 
-  Cache::Handle* Insert(RLHandle* handle, Cache::EvictionCallback* eviction_callback);
-  // Like Cache::Lookup, but with an extra "hash" parameter.
-  Cache::Handle* Lookup(const Slice& key, uint32_t hash, bool caching);
+  void EnableAdmissionFilter() {
+    std::lock_guard<rw_spinlock> l(mutex_);
+    sketch_.reset(new FrequencySketch(num_entries_));
+  }
+
+  // Like Cache::GetHotKeys.
+  void GetHotKeys(size_t max_keys, vector<string>* keys);
+
+  Cache::Handle* Insert(RLHandle* handle, Cache::EvictionCallback* eviction_callback,
+                        Cache::Priority priority);
+  // Like Cache::Lookup, but with an extra "hash" parameter. A miss is only
+  // counted in the metrics if 'count_miss' is true.
+  Cache::Handle* Lookup(const Slice& key, uint32_t hash, bool caching,
+                        bool count_miss = true);
   void Release(Cache::Handle* handle);
   void Erase(const Slice& key, uint32_t hash);
 
  private:
   void RL_Remove(RLHandle* e);
+  // Make 'e' the newest entry of the recency list or, for the SLRU policy,
+  // of its probationary segment.
   void RL_Append(RLHandle* e);
-  // Update the recency list after a lookup operation.
-  void RL_UpdateAfterLookup(RLHandle* e);
+  // Make 'e' the newest entry of the protected segment or, for the LRU
+  // policy, of the high-priority pool. Not used by the FIFO policy.
+  void RL_AppendProtected(RLHandle* e);
+  // Return the next entry to evict, or nullptr if there are no entries.
+  // Entries looked up since they were last considered are moved instead of
+  // being returned.
+  RLHandle* RL_NextToEvict();
+  // Move the oldest entries of the protected segment (or high-priority pool)
+  // back to the probationary segment (or recency list) until the protected
+  // segment fits its capacity. Not used by the FIFO policy.
+  void RL_RebalanceProtected();
+  // Update the recency information after a lookup operation. Called with
+  // 'mutex_' held in shared mode. Returns whether the entry should also be
+  // moved by RL_MoveAfterLookup().
+  bool RL_UpdateAfterLookup(RLHandle* e);
+  // Move the entry after a lookup operation. Called with 'mutex_' held in
+  // exclusive mode.
+  void RL_MoveAfterLookup(RLHandle* e);
   // Just reduce the reference count by 1.
   // Return true if last reference
   bool Unref(RLHandle* e);
   // Call the user's eviction callback, if it exists, and free the entry.
   void FreeEntry(RLHandle* e);
+  // Return whether the admission filter admits the new entry 'e', whose
+  // insertion may require evicting others. Called with 'mutex_' held in
+  // exclusive mode.
+  bool Admit(RLHandle* e, Cache::Priority priority);
 
 
   // Update the memtracker's consumption by the given amount.
@@ -259,17 +334,38 @@ class CacheShard {
 
   // Initialized before use.
   size_t capacity_;
+  size_t protected_capacity_;
 
-  // mutex_ protects the following state.
-  MutexType mutex_;
+  // mutex_ protects the following state. Lookups take it in shared mode, and
+  // anything modifying the recency lists or the table in exclusive mode.
+  rw_spinlock mutex_;
   size_t usage_;
 
-  // Dummy head of recency list.
+  // Dummy head of recency list. For the SLRU policy, this is the list of
+  // the probationary segment.
   // rl.prev is newest entry, rl.next is oldest entry.
   RLHandle rl_;
 
+  // Dummy head of the recency list of the protected segment, and the
+  // combined charge of its entries. For the LRU policy, this is the list of
+  // the high-priority pool, whose entries are evicted only once the
+  // recency list above is empty. Not used by the FIFO policy.
+  RLHandle protected_rl_;
+  size_t protected_usage_;
+
+  // The number of entries in the recency lists, and the number of times an
+  // entry has been appended to them.
+  size_t num_entries_;
+  uint64_t append_seq_;
+
   HandleTable table_;
 
+  // The lookup frequencies of the keys, if the admission filter is enabled.
+  // Lookups update it with 'mutex_' held in shared mode, and it's replaced
+  // by a larger one with 'mutex_' held in exclusive mode once there are more
+  // entries than it was sized for.
+  unique_ptr<FrequencySketch> sketch_;
+
   MemTracker* mem_tracker_;
   atomic<int64_t> deferred_consumption_ { 0 };
 
@@ -283,23 +379,30 @@ class CacheShard {
 template<Cache::EvictionPolicy policy>
 CacheShard<policy>::CacheShard(MemTracker* tracker)
     : usage_(0),
+      protected_usage_(0),
+      num_entries_(0),
+      append_seq_(0),
       mem_tracker_(tracker),
       metrics_(nullptr) {
-  // Make empty circular linked list.
+  // Make empty circular linked lists.
   rl_.next = &rl_;
   rl_.prev = &rl_;
+  protected_rl_.next = &protected_rl_;
+  protected_rl_.prev = &protected_rl_;
 }
 
 template<Cache::EvictionPolicy policy>
 CacheShard<policy>::~CacheShard() {
-  for (RLHandle* e = rl_.next; e != &rl_; ) {
-    RLHandle* next = e->next;
-    DCHECK_EQ(e->refs.load(std::memory_order_relaxed), 1)
-        << "caller has an unreleased handle";
-    if (Unref(e)) {
-      FreeEntry(e);
+  for (RLHandle* head : { &rl_, &protected_rl_ }) {
+    for (RLHandle* e = head->next; e != head; ) {
+      RLHandle* next = e->next;
+      DCHECK_EQ(e->refs.load(std::memory_order_relaxed), 1)
+          << "caller has an unreleased handle";
+      if (Unref(e)) {
+        FreeEntry(e);
+      }
+      e = next;
     }
-    e = next;
   }
   mem_tracker_->Consume(deferred_consumption_);
 }
@@ -361,6 +464,10 @@ void CacheShard<policy>::RL_Remove(RLHandle* e) {
   e->next->prev = e->prev;
   e->prev->next = e->next;
   usage_ -= e->charge;
+  num_entries_--;
+  if (e->in_protected_segment) {
+    protected_usage_ -= e->charge;
+  }
 }
 
 template<Cache::EvictionPolicy policy>
@@ -370,35 +477,170 @@ void CacheShard<policy>::RL_Append(RLHandle* e) {
   e->prev = rl_.prev;
   e->prev->next = e;
   e->next->prev = e;
+  e->in_protected_segment = false;
+  e->append_seq = ++append_seq_;
+  usage_ += e->charge;
+  num_entries_++;
+}
+
+template<Cache::EvictionPolicy policy>
+void CacheShard<policy>::RL_AppendProtected(RLHandle* e) {
+  e->next = &protected_rl_;
+  e->prev = protected_rl_.prev;
+  e->prev->next = e;
+  e->next->prev = e;
+  e->in_protected_segment = true;
+  e->append_seq = ++append_seq_;
   usage_ += e->charge;
+  protected_usage_ += e->charge;
+  num_entries_++;
+}
+
+template<>
+bool CacheShard<Cache::EvictionPolicy::FIFO>::RL_UpdateAfterLookup(RLHandle* /* e */) {
+  return false;
+}
+
+template<>
+bool CacheShard<Cache::EvictionPolicy::LRU>::RL_UpdateAfterLookup(RLHandle* e) {
+  // Avoid dirtying the cache line if the entry is already marked.
+  if (!e->referenced.load(std::memory_order_relaxed)) {
+    e->referenced.store(true, std::memory_order_relaxed);
+  }
+  return append_seq_ - e->append_seq > num_entries_ / 4;
+}
+
+template<>
+bool CacheShard<Cache::EvictionPolicy::SLRU>::RL_UpdateAfterLookup(RLHandle* e) {
+  if (!e->referenced.load(std::memory_order_relaxed)) {
+    e->referenced.store(true, std::memory_order_relaxed);
+  }
+  return !e->in_protected_segment || append_seq_ - e->append_seq > num_entries_ / 4;
 }
 
 template<>
-void CacheShard<Cache::EvictionPolicy::FIFO>::RL_UpdateAfterLookup(RLHandle* /* e */) {
+void CacheShard<Cache::EvictionPolicy::FIFO>::RL_MoveAfterLookup(RLHandle* /* e */) {
 }
 
 template<>
-void CacheShard<Cache::EvictionPolicy::LRU>::RL_UpdateAfterLookup(RLHandle* e) {
+void CacheShard<Cache::EvictionPolicy::LRU>::RL_MoveAfterLookup(RLHandle* e) {
+  e->referenced.store(false, std::memory_order_relaxed);
   RL_Remove(e);
-  RL_Append(e);
+  if (e->in_protected_segment) {
+    RL_AppendProtected(e);
+  } else {
+    RL_Append(e);
+  }
+}
+
+template<>
+void CacheShard<Cache::EvictionPolicy::SLRU>::RL_MoveAfterLookup(RLHandle* e) {
+  e->referenced.store(false, std::memory_order_relaxed);
+  RL_Remove(e);
+  RL_AppendProtected(e);
+  RL_RebalanceProtected();
+}
+
+template<>
+RLHandle* CacheShard<Cache::EvictionPolicy::FIFO>::RL_NextToEvict() {
+  return rl_.next != &rl_ ? rl_.next : nullptr;
+}
+
+template<>
+RLHandle* CacheShard<Cache::EvictionPolicy::LRU>::RL_NextToEvict() {
+  // Each entry is moved at most once since its bit is cleared, and no lookups
+  // may set bits concurrently since 'mutex_' is held exclusively.
+  while (rl_.next != &rl_) {
+    RLHandle* e = rl_.next;
+    if (!e->referenced.load(std::memory_order_relaxed)) {
+      return e;
+    }
+    e->referenced.store(false, std::memory_order_relaxed);
+    RL_Remove(e);
+    RL_Append(e);
+  }
+  // Only high-priority entries are left.
+  return protected_rl_.next != &protected_rl_ ? protected_rl_.next : nullptr;
+}
+
+template<Cache::EvictionPolicy policy>
+void CacheShard<policy>::RL_RebalanceProtected() {
+  DCHECK_NE(Cache::EvictionPolicy::FIFO, policy);
+  while (protected_usage_ > protected_capacity_) {
+    RLHandle* old = protected_rl_.next;
+    RL_Remove(old);
+    if (old->referenced.load(std::memory_order_relaxed)) {
+      old->referenced.store(false, std::memory_order_relaxed);
+      RL_AppendProtected(old);
+    } else {
+      // The entry gets another chance to be looked up in the probationary
+      // segment before being evicted.
+      RL_Append(old);
+    }
+  }
+}
+
+template<>
+RLHandle* CacheShard<Cache::EvictionPolicy::SLRU>::RL_NextToEvict() {
+  // Probationary entries which were looked up are promoted to the protected
+  // segment rather than evicted. This terminates since every iteration clears
+  // one bit, and rebalancing only moves unmarked entries to the probationary
+  // segment.
+  while (rl_.next != &rl_) {
+    RLHandle* e = rl_.next;
+    if (!e->referenced.load(std::memory_order_relaxed)) {
+      return e;
+    }
+    e->referenced.store(false, std::memory_order_relaxed);
+    RL_Remove(e);
+    RL_AppendProtected(e);
+    RL_RebalanceProtected();
+  }
+  return protected_rl_.next != &protected_rl_ ? protected_rl_.next : nullptr;
 }
 
 template<Cache::EvictionPolicy policy>
 Cache::Handle* CacheShard<policy>::Lookup(const Slice& key,
                                           uint32_t hash,
-                                          bool caching) {
+                                          bool caching,
+                                          bool count_miss) {
   RLHandle* e;
+  bool hit_protected_segment = false;
+  bool move = false;
   {
-    std::lock_guard<MutexType> l(mutex_);
+    shared_lock<rw_spinlock> l(mutex_);
+    if (sketch_ && caching) {
+      sketch_->Increment(hash);
+    }
     e = table_.Lookup(key, hash);
     if (e != nullptr) {
       e->refs.fetch_add(1, std::memory_order_relaxed);
-      RL_UpdateAfterLookup(e);
+      hit_protected_segment = e->in_protected_segment;
+      move = RL_UpdateAfterLookup(e);
+    }
+  }
+  if (move) {
+    // Don't wait for the exclusive lock: if it's contended, the 'referenced'
+    // bit set above stands in for the move. The entry may have been removed
+    // from the cache while unlocked, in which case it's no longer in the
+    // recency list.
+    std::unique_lock<rw_spinlock> l(mutex_, std::try_to_lock);
+    if (l.owns_lock() && table_.Lookup(key, hash) == e) {
+      RL_MoveAfterLookup(e);
     }
   }
 
   // Do the metrics outside of the lock.
-  UpdateMetricsLookup(e != nullptr, caching);
+  if (e != nullptr || count_miss) {
+    UpdateMetricsLookup(e != nullptr, caching);
+  }
+  if (policy == Cache::EvictionPolicy::SLRU && e != nullptr && PREDICT_TRUE(metrics_)) {
+    const auto& segment_hits = hit_protected_segment ?
+        metrics_->protected_segment_hits : metrics_->probationary_segment_hits;
+    if (segment_hits) {
+      segment_hits->Increment();
+    }
+  }
 
   return reinterpret_cast<Cache::Handle*>(e);
 }
@@ -412,15 +654,33 @@ void CacheShard<policy>::Release(Cache::Handle* handle) {
   }
 }
 
+template<Cache::EvictionPolicy policy>
+bool CacheShard<policy>::Admit(RLHandle* e, Cache::Priority priority) {
+  if (PREDICT_FALSE(num_entries_ > sketch_->width())) {
+    sketch_.reset(new FrequencySketch(2 * num_entries_));
+  }
+  if (priority == Cache::Priority::HIGH ||
+      usage_ + e->charge <= capacity_ ||
+      table_.Lookup(e->key(), e->hash) != nullptr) {
+    return true;
+  }
+  // Like TinyLFU, only compare with the first victim: if the new entry
+  // doesn't fit without further evictions, it's still admitted.
+  RLHandle* victim = RL_NextToEvict();
+  return victim == nullptr || sketch_->Estimate(e->hash) > sketch_->Estimate(victim->hash);
+}
+
 template<Cache::EvictionPolicy policy>
 Cache::Handle* CacheShard<policy>::Insert(
     RLHandle* handle,
-    Cache::EvictionCallback* eviction_callback) {
+    Cache::EvictionCallback* eviction_callback,
+    Cache::Priority priority) {
   // Set the remaining RLHandle members which were not already allocated during
   // Allocate().
   handle->eviction_callback = eviction_callback;
   // Two refs for the handle: one from CacheShard, one for the returned handle.
   handle->refs.store(2, std::memory_order_relaxed);
+  handle->referenced.store(false, std::memory_order_relaxed);
   UpdateMemTracker(handle->charge);
   if (PREDICT_TRUE(metrics_)) {
     metrics_->cache_usage->IncrementBy(handle->charge);
@@ -428,30 +688,56 @@ Cache::Handle* CacheShard<policy>::Insert(
   }
 
   RLHandle* to_remove_head = nullptr;
+  bool admitted = true;
   {
-    std::lock_guard<MutexType> l(mutex_);
+    std::lock_guard<rw_spinlock> l(mutex_);
+    if (sketch_ && !Admit(handle, priority)) {
+      // The handle is returned to the caller, but isn't kept in the cache.
+      CHECK(!Unref(handle));
+      admitted = false;
+    } else {
+      RLHandle* old = table_.Insert(handle);
+      if (old != nullptr) {
+        RL_Remove(old);
+        if (Unref(old)) {
+          old->next = to_remove_head;
+          to_remove_head = old;
+        }
+      }
 
-    RL_Append(handle);
+      // Make room before appending the new entry, so that it isn't itself
+      // chosen for eviction while older entries are given another chance.
+      while (usage_ + handle->charge > capacity_) {
+        RLHandle* old = RL_NextToEvict();
+        if (old == nullptr) {
+          break;
+        }
+        RL_Remove(old);
+        table_.Remove(old->key(), old->hash);
+        if (Unref(old)) {
+          old->next = to_remove_head;
+          to_remove_head = old;
+        }
+      }
 
-    RLHandle* old = table_.Insert(handle);
-    if (old != nullptr) {
-      RL_Remove(old);
-      if (Unref(old)) {
-        old->next = to_remove_head;
-        to_remove_head = old;
+      if (policy != Cache::EvictionPolicy::FIFO && priority == Cache::Priority::HIGH) {
+        RL_AppendProtected(handle);
+        RL_RebalanceProtected();
+      } else {
+        RL_Append(handle);
       }
-    }
 
-    while (usage_ > capacity_ && rl_.next != &rl_) {
-      RLHandle* old = rl_.next;
-      RL_Remove(old);
-      table_.Remove(old->key(), old->hash);
-      if (Unref(old)) {
-        old->next = to_remove_head;
-        to_remove_head = old;
+      // An entry larger than the whole capacity isn't kept.
+      if (PREDICT_FALSE(usage_ > capacity_)) {
+        RL_Remove(handle);
+        table_.Remove(handle->key(), handle->hash);
+        CHECK(!Unref(handle));
       }
     }
   }
+  if (!admitted && PREDICT_TRUE(metrics_) && metrics_->admission_rejections) {
+    metrics_->admission_rejections->Increment();
+  }
 
   // we free the entries here outside of mutex for
   // performance reasons
@@ -464,12 +750,24 @@ Cache::Handle* CacheShard<policy>::Insert(
   return reinterpret_cast<Cache::Handle*>(handle);
 }
 
+template<Cache::EvictionPolicy policy>
+void CacheShard<policy>::GetHotKeys(size_t max_keys, vector<string>* keys) {
+  shared_lock<rw_spinlock> l(mutex_);
+  // The entries of the protected segment (or high-priority pool) first, then
+  // those of the recency list, each from the newest one.
+  for (RLHandle* head : { &protected_rl_, &rl_ }) {
+    for (RLHandle* e = head->prev; e != head && max_keys > 0; e = e->prev, max_keys--) {
+      keys->emplace_back(e->key().ToString());
+    }
+  }
+}
+
 template<Cache::EvictionPolicy policy>
 void CacheShard<policy>::Erase(const Slice& key, uint32_t hash) {
   RLHandle* e;
   bool last_reference = false;
   {
-    std::lock_guard<MutexType> l(mutex_);
+    std::lock_guard<rw_spinlock> l(mutex_);
     e = table_.Remove(key, hash);
     if (e != nullptr) {
       RL_Remove(e);
@@ -484,22 +782,65 @@ void CacheShard<policy>::Erase(const Slice& key, uint32_t hash) {
 }
 
 // Determine the number of bits of the hash that should be used to determine
-// the cache shard. This, in turn, determines the number of shards.
-int DetermineShardBits() {
+// the cache shard among the ones of a NUMA node. This, in turn, determines
+// the number of shards.
+int DetermineShardBits(int num_nodes) {
   int bits = PREDICT_FALSE(FLAGS_cache_force_single_shard) ?
-      0 : Bits::Log2Ceiling(base::NumCPUs());
-  VLOG(1) << "Will use " << (1 << bits) << " shards for recency list cache.";
+      0 : std::max(0, Bits::Log2Ceiling(base::NumCPUs()) - Bits::Log2Floor(num_nodes));
+  VLOG(1) << "Will use " << (1 << bits) << " shards per NUMA node for recency list cache.";
   return bits;
 }
 
+// Sets 'cpu_nodes' to the index of the NUMA node of each CPU, if the caches
+// are partitioned by NUMA node and the machine has several ones. Returns the
+// number of nodes the caches are partitioned into.
+int DetermineNumaNodes(vector<uint8_t>* cpu_nodes) {
+  cpu_nodes->clear();
+  if (!FLAGS_cache_numa_aware || FLAGS_cache_force_single_shard) {
+    return 1;
+  }
+  vector<vector<int>> node_cpus;
+  Status s = GetNumaNodeCpus(&node_cpus);
+  if (!s.ok()) {
+    LOG(WARNING) << "Could not get the NUMA nodes of the machine, the caches "
+                 << "won't be partitioned by node: " << s.ToString();
+    return 1;
+  }
+  if (node_cpus.size() < 2) {
+    return 1;
+  }
+  // The node index must fit in RLHandle::numa_node.
+  const int num_nodes = std::min<int>(node_cpus.size(), std::numeric_limits<uint8_t>::max());
+  for (int node = 0; node < node_cpus.size(); node++) {
+    for (int cpu : node_cpus[node]) {
+      if (cpu >= cpu_nodes->size()) {
+        cpu_nodes->resize(cpu + 1);
+      }
+      (*cpu_nodes)[cpu] = node % num_nodes;
+    }
+  }
+  return num_nodes;
+}
+
 template<Cache::EvictionPolicy policy>
 class ShardedCache : public Cache {
  private:
   shared_ptr<MemTracker> mem_tracker_;
   unique_ptr<CacheMetrics> metrics_;
+
+  // The shards of each NUMA node, one node after the other.
   vector<CacheShard<policy>*> shards_;
 
-  // Number of bits of hash used to determine the shard.
+  // The NUMA node of each CPU, and the number of nodes. With a single node,
+  // 'cpu_nodes_' is empty.
+  vector<uint8_t> cpu_nodes_;
+  const int num_nodes_;
+
+  // The MemTrackers of the shards of each NUMA node, children of
+  // 'mem_tracker_'. Empty with a single node.
+  vector<shared_ptr<MemTracker>> node_mem_trackers_;
+
+  // Number of bits of hash used to determine the shard of a NUMA node.
   const int shard_bits_;
 
   // Protects 'metrics_'. Used only when metrics are set, to ensure
@@ -511,26 +852,47 @@ class ShardedCache : public Cache {
       reinterpret_cast<const char *>(s.data()), s.size());
   }
 
-  uint32_t Shard(uint32_t hash) {
+  CacheShard<policy>* Shard(int node, uint32_t hash) {
     // Widen to uint64 before shifting, or else on a single CPU,
     // we would try to shift a uint32_t by 32 bits, which is undefined.
-    return static_cast<uint64_t>(hash) >> (32 - shard_bits_);
+    return shards_[(node << shard_bits_) + (static_cast<uint64_t>(hash) >> (32 - shard_bits_))];
+  }
+
+  // Returns the index of the NUMA node of the calling thread.
+  int CurrentNode() const {
+    if (num_nodes_ == 1) {
+      return 0;
+    }
+    const int cpu = GetCurrentCpu();
+    return PREDICT_TRUE(cpu >= 0 && cpu < cpu_nodes_.size()) ? cpu_nodes_[cpu] : 0;
   }
 
  public:
   explicit ShardedCache(size_t capacity, const string& id)
-        : shard_bits_(DetermineShardBits()) {
+        : num_nodes_(DetermineNumaNodes(&cpu_nodes_)),
+          shard_bits_(DetermineShardBits(num_nodes_)) {
     // A cache is often a singleton, so:
     // 1. We reuse its MemTracker if one already exists, and
     // 2. It is directly parented to the root MemTracker.
     mem_tracker_ = MemTracker::FindOrCreateGlobalTracker(
         -1, strings::Substitute("$0-sharded_$1_cache", id, ToString(policy)));
+    if (num_nodes_ > 1) {
+      for (int node = 0; node < num_nodes_; node++) {
+        const string node_id = strings::Substitute("numa_node_$0", node);
+        shared_ptr<MemTracker> tracker;
+        if (!MemTracker::FindTracker(node_id, &tracker, mem_tracker_)) {
+          tracker = MemTracker::CreateTracker(-1, node_id, mem_tracker_);
+        }
+        node_mem_trackers_.emplace_back(std::move(tracker));
+      }
+    }
 
-    int num_shards = 1 << shard_bits_;
+    int num_shards = num_nodes_ << shard_bits_;
     const size_t per_shard = (capacity + (num_shards - 1)) / num_shards;
     for (int s = 0; s < num_shards; s++) {
-      unique_ptr<CacheShard<policy>> shard(
-          new CacheShard<policy>(mem_tracker_.get()));
+      MemTracker* tracker = num_nodes_ > 1 ?
+          node_mem_trackers_[s >> shard_bits_].get() : mem_tracker_.get();
+      unique_ptr<CacheShard<policy>> shard(new CacheShard<policy>(tracker));
       shard->SetCapacity(per_shard);
       shards_.push_back(shard.release());
     }
@@ -541,21 +903,43 @@ class ShardedCache : public Cache {
   }
 
   Handle* Insert(PendingHandle* handle,
-                 Cache::EvictionCallback* eviction_callback) override {
+                 Cache::EvictionCallback* eviction_callback,
+                 Priority priority) override {
     RLHandle* h = reinterpret_cast<RLHandle*>(DCHECK_NOTNULL(handle));
-    return shards_[Shard(h->hash)]->Insert(h, eviction_callback);
+    h->numa_node = CurrentNode();
+    // The entry replaces the one of the same key, whatever its node.
+    for (int node = 0; node < num_nodes_; node++) {
+      if (node != h->numa_node) {
+        Shard(node, h->hash)->Erase(h->key(), h->hash);
+      }
+    }
+    return Shard(h->numa_node, h->hash)->Insert(h, eviction_callback, priority);
   }
   Handle* Lookup(const Slice& key, CacheBehavior caching) override {
     const uint32_t hash = HashSlice(key);
-    return shards_[Shard(hash)]->Lookup(key, hash, caching == EXPECT_IN_CACHE);
+    // Look up the shards of the local node first, then the ones of the other
+    // nodes. The entry isn't moved: a block is usually scanned by the node
+    // which read it.
+    const int local_node = CurrentNode();
+    for (int i = 0; i < num_nodes_; i++) {
+      const int node = (local_node + i) % num_nodes_;
+      Handle* h = Shard(node, hash)->Lookup(key, hash, caching == EXPECT_IN_CACHE,
+                                            /*count_miss=*/i == num_nodes_ - 1);
+      if (h != nullptr) {
+        return h;
+      }
+    }
+    return nullptr;
   }
   void Release(Handle* handle) override {
     RLHandle* h = reinterpret_cast<RLHandle*>(handle);
-    shards_[Shard(h->hash)]->Release(handle);
+    Shard(h->numa_node, h->hash)->Release(handle);
   }
   void Erase(const Slice& key) override {
     const uint32_t hash = HashSlice(key);
-    shards_[Shard(hash)]->Erase(key, hash);
+    for (int node = 0; node < num_nodes_; node++) {
+      Shard(node, hash)->Erase(key, hash);
+    }
   }
   Slice Value(Handle* handle) override {
     return reinterpret_cast<RLHandle*>(handle)->value();
@@ -576,6 +960,20 @@ class ShardedCache : public Cache {
     }
   }
 
+  void EnableAdmissionFilter() override {
+    for (auto* shard : shards_) {
+      shard->EnableAdmissionFilter();
+    }
+  }
+
+  void GetHotKeys(size_t max_keys, vector<string>* keys) override {
+    const size_t max_keys_per_shard = (max_keys + shards_.size() - 1) / shards_.size();
+    const size_t end_size = keys->size() + max_keys;
+    for (auto* shard : shards_) {
+      shard->GetHotKeys(std::min(max_keys_per_shard, end_size - keys->size()), keys);
+    }
+  }
+
   PendingHandle* Allocate(Slice key, int val_len, int charge) override {
     int key_len = key.size();
     DCHECK_GE(key_len, 0);
@@ -590,6 +988,7 @@ class ShardedCache : public Cache {
     handle->val_length = val_len;
     handle->charge = (charge == kAutomaticCharge) ? kudu_malloc_usable_size(buf) : charge;
     handle->hash = HashSlice(key);
+    handle->numa_node = 0;
     memcpy(handle->kv_data, key.data(), key_len);
 
     return reinterpret_cast<PendingHandle*>(handle);
@@ -619,6 +1018,12 @@ Cache* NewCache<Cache::EvictionPolicy::LRU,
   return new ShardedCache<Cache::EvictionPolicy::LRU>(capacity, id);
 }
 
+template<>
+Cache* NewCache<Cache::EvictionPolicy::SLRU,
+                Cache::MemoryType::DRAM>(size_t capacity, const std::string& id) {
+  return new ShardedCache<Cache::EvictionPolicy::SLRU>(capacity, id);
+}
+
 #if defined(HAVE_LIB_VMEM)
 template<>
 Cache* NewCache<Cache::EvictionPolicy::LRU,
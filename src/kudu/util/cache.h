@@ -22,6 +22,7 @@
 #include <iosfwd>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "kudu/gutil/macros.h"
 #include "kudu/util/slice.h"
@@ -48,6 +49,25 @@ class Cache {
 
     // The least-recently-used items are evicted.
     LRU,
+
+    // Segmented LRU: new items enter a probationary segment, and are moved
+    // to a protected segment when looked up again. The least-recently-used
+    // items of the probationary segment are evicted first, so that items
+    // used only once (e.g. by a large scan) don't evict frequently used ones.
+    SLRU,
+  };
+
+  // Priority of an entry, given when it's inserted. Caches which don't
+  // support priorities treat all entries alike.
+  enum class Priority {
+    // Entries which are evicted according to the eviction policy.
+    NORMAL,
+
+    // Entries which should outlive normal priority entries, e.g. the index
+    // blocks of a file which are needed to locate its other blocks. Up to a
+    // configurable fraction of the capacity is reserved for them, so that
+    // normal priority entries only evict them when within that fraction.
+    HIGH,
   };
 
   // Callback interface which is called when an entry is evicted from the
@@ -139,6 +159,23 @@ class Cache {
   // Set the cache metrics to update corresponding counters accordingly.
   virtual void SetMetrics(std::unique_ptr<CacheMetrics> metrics) = 0;
 
+  // Enable the TinyLFU admission filter: the cache tracks how often keys are
+  // looked up with EXPECT_IN_CACHE, and once it is full, only admits a new entry if its key was
+  // looked up more often than the key of the entry which would be evicted to
+  // make room for it. This keeps entries which are read only once, e.g. by a
+  // large scan, from evicting frequently used ones. Replacements of existing
+  // entries and high-priority entries are always admitted.
+  //
+  // Caches which don't support admission filtering ignore this. Must be
+  // called before the cache is used.
+  virtual void EnableAdmissionFilter() = 0;
+
+  // Append to 'keys' the keys of up to 'max_keys' of the entries most likely
+  // to be used again, e.g. the most recently used ones for the LRU policy,
+  // so that they may be persisted to warm up a new cache. Caches which don't
+  // support this append nothing.
+  virtual void GetHotKeys(size_t max_keys, std::vector<std::string>* keys) = 0;
+
   // ------------------------------------------------------------
   // Insertion path
   // ------------------------------------------------------------
@@ -202,14 +239,24 @@ class Cache {
   // Returns a handle that corresponds to the mapping.  The caller
   // must call this->Release(handle) when the returned mapping is no
   // longer needed. This method always succeeds and returns a non-null
-  // entry, since the space was reserved above.
+  // entry, since the space was reserved above. However, if the admission
+  // filter rejects the entry, it is only kept until the handle is released.
   //
   // The 'pending' entry passed here should have been allocated using
   // Cache::Allocate() above.
   //
   // If 'eviction_callback' is non-NULL, then it will be called when the
   // entry is later evicted or when the cache shuts down.
-  virtual Handle* Insert(PendingHandle* pending, EvictionCallback* eviction_callback) = 0;
+  //
+  // The entry is inserted with the given 'priority'; see Priority above.
+  virtual Handle* Insert(PendingHandle* pending, EvictionCallback* eviction_callback,
+                         Priority priority) = 0;
+
+  // Default 'priority' should be Priority::NORMAL.
+  // (default arguments on virtual functions are prohibited)
+  Handle* Insert(PendingHandle* pending, EvictionCallback* eviction_callback) {
+    return Insert(pending, eviction_callback, Priority::NORMAL);
+  }
 
   // Free 'ptr', which must have been previously allocated using 'Allocate'.
   virtual void Free(PendingHandle* ptr) = 0;
@@ -238,6 +285,13 @@ template<>
 Cache* NewCache<Cache::EvictionPolicy::LRU,
                 Cache::MemoryType::DRAM>(size_t capacity, const std::string& id);
 
+// Create a new SLRU cache with a fixed size capacity. This implementation
+// of Cache uses the segmented least-recently-used eviction policy and stored
+// in DRAM.
+template<>
+Cache* NewCache<Cache::EvictionPolicy::SLRU,
+                Cache::MemoryType::DRAM>(size_t capacity, const std::string& id);
+
 #if defined(HAVE_LIB_VMEM)
 // Create a new LRU cache with a fixed size capacity. This implementation
 // of Cache uses the least-recently-used eviction policy and stored in NVM.
@@ -35,6 +35,15 @@ struct CacheMetrics {
   scoped_refptr<Counter> cache_misses;
   scoped_refptr<Counter> cache_misses_caching;
 
+  // Hits in each segment of a segmented cache. Unset for caches of other
+  // eviction policies.
+  scoped_refptr<Counter> probationary_segment_hits;
+  scoped_refptr<Counter> protected_segment_hits;
+
+  // Entries which were not admitted by the admission filter. Unset for caches
+  // which don't support admission filtering.
+  scoped_refptr<Counter> admission_rejections;
+
   scoped_refptr<AtomicGauge<uint64_t>> cache_usage;
 };
 
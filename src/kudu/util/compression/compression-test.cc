@@ -18,27 +18,33 @@
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include <gtest/gtest.h>
 
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/compression/compression.pb.h"
 #include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
 namespace kudu {
 
+using std::string;
+using std::unique_ptr;
 using std::vector;
+using strings::Substitute;
 
 class TestCompression : public KuduTest {};
 
-static void TestCompressionCodec(CompressionType compression) {
+static void TestCodec(const CompressionCodec* codec) {
   const int kInputSize = 64;
 
-  const CompressionCodec* codec;
   uint8_t ibuffer[kInputSize];
   uint8_t ubuffer[kInputSize];
   size_t compressed;
@@ -46,9 +52,6 @@ static void TestCompressionCodec(CompressionType compression) {
   // Fill the test input buffer
   memset(ibuffer, 'Z', kInputSize);
 
-  // Get the specified compression codec
-  ASSERT_OK(GetCompressionCodec(compression, &codec));
-
   // Allocate the compression buffer
   size_t max_compressed = codec->MaxCompressedLength(kInputSize);
   ASSERT_LT(max_compressed, (kInputSize * 2));
@@ -69,6 +72,13 @@ static void TestCompressionCodec(CompressionType compression) {
   ASSERT_EQ(0, memcmp(ibuffer, ubuffer, kInputSize));
 }
 
+static void TestCompressionCodec(CompressionType compression) {
+  // Get the specified compression codec
+  const CompressionCodec* codec;
+  ASSERT_OK(GetCompressionCodec(compression, &codec));
+  NO_FATALS(TestCodec(codec));
+}
+
 TEST_F(TestCompression, TestNoCompressionCodec) {
   const CompressionCodec* codec;
   ASSERT_OK(GetCompressionCodec(NO_COMPRESSION, &codec));
@@ -87,4 +97,77 @@ TEST_F(TestCompression, TestZlibCompressionCodec) {
   TestCompressionCodec(ZLIB);
 }
 
+TEST_F(TestCompression, TestZstdCompressionCodec) {
+  TestCompressionCodec(ZSTD);
+}
+
+TEST_F(TestCompression, TestCompressionLevels) {
+  CompressionCodecOptions opts;
+  unique_ptr<CompressionCodec> codec;
+  for (int level : { 1, 9 }) {
+    opts.level = level;
+    ASSERT_OK(NewCompressionCodec(ZLIB, opts, &codec));
+    NO_FATALS(TestCodec(codec.get()));
+  }
+  for (int level : { 1, 19 }) {
+    opts.level = level;
+    ASSERT_OK(NewCompressionCodec(ZSTD, opts, &codec));
+    NO_FATALS(TestCodec(codec.get()));
+  }
+
+  opts.level = 10;
+  Status s = NewCompressionCodec(ZLIB, opts, &codec);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  opts.level = 1;
+  s = NewCompressionCodec(LZ4, opts, &codec);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "doesn't support levels");
+}
+
+TEST_F(TestCompression, TestZstdDictionary) {
+  // Small, similar JSON documents, which barely compress on their own.
+  vector<string> docs;
+  for (int i = 0; i < 1000; i++) {
+    docs.emplace_back(Substitute(
+        R"({"host":"web-$0.example.com","path":"/api/v1/items/$1","status":$2})",
+        i % 13, i * 7, i % 2 == 0 ? 200 : 404));
+  }
+  vector<Slice> samples(docs.begin(), docs.end());
+  string dict;
+  ASSERT_OK(TrainCompressionDictionary(samples, 4096, &dict));
+  ASSERT_FALSE(dict.empty());
+  ASSERT_LE(dict.size(), 4096);
+
+  CompressionCodecOptions opts;
+  opts.dictionary = dict;
+  unique_ptr<CompressionCodec> dict_codec;
+  ASSERT_OK(NewCompressionCodec(ZSTD, opts, &dict_codec));
+  NO_FATALS(TestCodec(dict_codec.get()));
+  const CompressionCodec* codec;
+  ASSERT_OK(GetCompressionCodec(ZSTD, &codec));
+
+  const Slice doc(docs[500]);
+  gscoped_array<uint8_t> cbuffer(new uint8_t[codec->MaxCompressedLength(doc.size())]);
+  size_t compressed;
+  ASSERT_OK(codec->Compress(doc, cbuffer.get(), &compressed));
+  const size_t compressed_without_dict = compressed;
+  ASSERT_OK(dict_codec->Compress(doc, cbuffer.get(), &compressed));
+  ASSERT_LT(compressed, compressed_without_dict / 2);
+
+  // The data can only be uncompressed with the dictionary.
+  string uncompressed(doc.size(), '\0');
+  uint8_t* ubuffer = reinterpret_cast<uint8_t*>(&uncompressed[0]);
+  ASSERT_OK(dict_codec->Uncompress(Slice(cbuffer.get(), compressed), ubuffer, doc.size()));
+  ASSERT_EQ(doc, Slice(uncompressed));
+  Status s = codec->Uncompress(Slice(cbuffer.get(), compressed), ubuffer, doc.size());
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+
+  // Other codecs don't support dictionaries, and dictionaries can't be
+  // trained without samples.
+  s = NewCompressionCodec(LZ4, opts, &dict_codec);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  s = TrainCompressionDictionary({}, 4096, &dict);
+  ASSERT_TRUE(s.IsRuntimeError()) << s.ToString();
+}
+
 } // namespace kudu
@@ -26,18 +26,25 @@
 #include <lz4.h>
 #include <snappy-sinksource.h>
 #include <snappy.h>
+#include <zdict.h>
 #include <zlib.h>
+#include <zstd.h>
 
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/singleton.h"
 #include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/string_case.h"
+#include "kudu/util/threadlocal.h"
 
 namespace kudu {
 
+using std::string;
+using std::unique_ptr;
 using std::vector;
+using strings::Substitute;
 
 CompressionCodec::CompressionCodec() {
 }
@@ -178,9 +185,12 @@ class Lz4Codec : public CompressionCodec {
   Status Uncompress(const Slice& compressed,
                     uint8_t *uncompressed,
                     size_t uncompressed_length) const OVERRIDE {
-    int n = LZ4_decompress_fast(reinterpret_cast<const char *>(compressed.data()),
-                                reinterpret_cast<char *>(uncompressed), uncompressed_length);
-    if (n != compressed.size()) {
+    // The safe variant never reads past the end of 'compressed', which may
+    // come from the network.
+    int n = LZ4_decompress_safe(reinterpret_cast<const char *>(compressed.data()),
+                                reinterpret_cast<char *>(uncompressed),
+                                compressed.size(), uncompressed_length);
+    if (n != uncompressed_length) {
       return Status::Corruption(
         StringPrintf("unable to uncompress the buffer. error near %d, buffer", -n),
                      KUDU_REDACT(compressed.ToDebugString(100)));
@@ -207,10 +217,18 @@ class ZlibCodec : public CompressionCodec {
     return Singleton<ZlibCodec>::get();
   }
 
+  ZlibCodec()
+      : level_(Z_DEFAULT_COMPRESSION) {
+  }
+
+  explicit ZlibCodec(int level)
+      : level_(level) {
+  }
+
   Status Compress(const Slice& input,
                   uint8_t *compressed, size_t *compressed_length) const OVERRIDE {
     *compressed_length = MaxCompressedLength(input.size());
-    int err = ::compress(compressed, compressed_length, input.data(), input.size());
+    int err = ::compress2(compressed, compressed_length, input.data(), input.size(), level_);
     return err == Z_OK ? Status::OK() : Status::IOError("unable to compress the buffer");
   }
 
@@ -242,6 +260,142 @@ class ZlibCodec : public CompressionCodec {
   CompressionType type() const override {
     return ZLIB;
   }
+
+ private:
+  const int level_;
+};
+
+// The ZSTD contexts of a thread. Contexts are costly to create, so each
+// thread reuses its own, but they may only be used by one thread at a time.
+class ZstdContexts {
+ public:
+  ZstdContexts()
+      : cctx_(nullptr),
+        dctx_(nullptr) {
+  }
+
+  ~ZstdContexts() {
+    ZSTD_freeCCtx(cctx_);
+    ZSTD_freeDCtx(dctx_);
+  }
+
+  static ZstdContexts* Get() {
+    BLOCK_STATIC_THREAD_LOCAL(ZstdContexts, contexts);
+    return contexts;
+  }
+
+  ZSTD_CCtx* cctx() {
+    if (PREDICT_FALSE(cctx_ == nullptr)) {
+      cctx_ = CHECK_NOTNULL(ZSTD_createCCtx());
+    }
+    return cctx_;
+  }
+
+  ZSTD_DCtx* dctx() {
+    if (PREDICT_FALSE(dctx_ == nullptr)) {
+      dctx_ = CHECK_NOTNULL(ZSTD_createDCtx());
+    }
+    return dctx_;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ZstdContexts);
+
+  ZSTD_CCtx* cctx_;
+  ZSTD_DCtx* dctx_;
+};
+
+class ZstdCodec : public CompressionCodec {
+ public:
+  static ZstdCodec *GetSingleton() {
+    return Singleton<ZstdCodec>::get();
+  }
+
+  ZstdCodec()
+      : ZstdCodec(ZSTD_CLEVEL_DEFAULT, Slice()) {
+  }
+
+  // The dictionary, if any, is digested for both compression and
+  // decompression, and isn't referenced afterwards.
+  ZstdCodec(int level, const Slice& dictionary)
+      : level_(level),
+        cdict_(nullptr),
+        ddict_(nullptr) {
+    if (!dictionary.empty()) {
+      cdict_ = CHECK_NOTNULL(ZSTD_createCDict(dictionary.data(), dictionary.size(), level_));
+      ddict_ = CHECK_NOTNULL(ZSTD_createDDict(dictionary.data(), dictionary.size()));
+    }
+  }
+
+  ~ZstdCodec() {
+    ZSTD_freeCDict(cdict_);
+    ZSTD_freeDDict(ddict_);
+  }
+
+  Status Compress(const Slice& input,
+                  uint8_t *compressed, size_t *compressed_length) const OVERRIDE {
+    ZSTD_CCtx* cctx = ZstdContexts::Get()->cctx();
+    const size_t capacity = MaxCompressedLength(input.size());
+    size_t n;
+    if (cdict_ != nullptr) {
+      n = ZSTD_compress_usingCDict(cctx, compressed, capacity,
+                                   input.data(), input.size(), cdict_);
+    } else {
+      n = ZSTD_compressCCtx(cctx, compressed, capacity, input.data(), input.size(), level_);
+    }
+    if (PREDICT_FALSE(ZSTD_isError(n))) {
+      return Status::IOError("unable to compress the buffer", ZSTD_getErrorName(n));
+    }
+    *compressed_length = n;
+    return Status::OK();
+  }
+
+  Status Compress(const vector<Slice>& input_slices,
+                  uint8_t *compressed, size_t *compressed_length) const OVERRIDE {
+    if (input_slices.size() == 1) {
+      return Compress(input_slices[0], compressed, compressed_length);
+    }
+
+    SlicesSource source(input_slices);
+    faststring buffer;
+    source.Dump(&buffer);
+    return Compress(Slice(buffer.data(), buffer.size()), compressed, compressed_length);
+  }
+
+  Status Uncompress(const Slice& compressed,
+                    uint8_t *uncompressed, size_t uncompressed_length) const OVERRIDE {
+    ZSTD_DCtx* dctx = ZstdContexts::Get()->dctx();
+    size_t n;
+    if (ddict_ != nullptr) {
+      n = ZSTD_decompress_usingDDict(dctx, uncompressed, uncompressed_length,
+                                     compressed.data(), compressed.size(), ddict_);
+    } else {
+      n = ZSTD_decompressDCtx(dctx, uncompressed, uncompressed_length,
+                              compressed.data(), compressed.size());
+    }
+    if (PREDICT_FALSE(ZSTD_isError(n))) {
+      return Status::Corruption("unable to uncompress the buffer", ZSTD_getErrorName(n));
+    }
+    if (PREDICT_FALSE(n != uncompressed_length)) {
+      return Status::Corruption(Substitute(
+          "unable to uncompress the buffer: got $0 bytes instead of $1",
+          n, uncompressed_length));
+    }
+    return Status::OK();
+  }
+
+  size_t MaxCompressedLength(size_t source_bytes) const OVERRIDE {
+    return ZSTD_compressBound(source_bytes);
+  }
+
+  CompressionType type() const override {
+    return ZSTD;
+  }
+
+ private:
+  const int level_;
+  ZSTD_CDict* cdict_;
+  ZSTD_DDict* ddict_;
 };
 
 Status GetCompressionCodec(CompressionType compression,
@@ -259,12 +413,81 @@ Status GetCompressionCodec(CompressionType compression,
     case ZLIB:
       *codec = ZlibCodec::GetSingleton();
       break;
+    case ZSTD:
+      *codec = ZstdCodec::GetSingleton();
+      break;
+    default:
+      return Status::NotFound("bad compression type");
+  }
+  return Status::OK();
+}
+
+Status NewCompressionCodec(CompressionType compression,
+                           const CompressionCodecOptions& options,
+                           unique_ptr<CompressionCodec>* codec) {
+  if (!options.dictionary.empty() && compression != ZSTD) {
+    return Status::InvalidArgument(Substitute("$0 compression doesn't support dictionaries",
+                                              CompressionType_Name(compression)));
+  }
+  const auto check_level = [&](int max_level) {
+    if (options.level == 0) {
+      return Status::OK();
+    }
+    if (max_level == 0) {
+      return Status::InvalidArgument(Substitute("$0 compression doesn't support levels",
+                                                CompressionType_Name(compression)));
+    }
+    if (options.level < 1 || options.level > max_level) {
+      return Status::InvalidArgument(Substitute(
+          "invalid $0 compression level $1: must be between 1 and $2",
+          CompressionType_Name(compression), options.level, max_level));
+    }
+    return Status::OK();
+  };
+  switch (compression) {
+    case SNAPPY:
+    case LZ4:
+      RETURN_NOT_OK(check_level(0));
+      codec->reset(compression == SNAPPY ? static_cast<CompressionCodec*>(new SnappyCodec()) :
+                                           new Lz4Codec());
+      break;
+    case ZLIB:
+      RETURN_NOT_OK(check_level(Z_BEST_COMPRESSION));
+      codec->reset(new ZlibCodec(options.level == 0 ? Z_DEFAULT_COMPRESSION : options.level));
+      break;
+    case ZSTD:
+      RETURN_NOT_OK(check_level(ZSTD_maxCLevel()));
+      codec->reset(new ZstdCodec(options.level == 0 ? ZSTD_CLEVEL_DEFAULT : options.level,
+                                 options.dictionary));
+      break;
     default:
       return Status::NotFound("bad compression type");
   }
   return Status::OK();
 }
 
+Status TrainCompressionDictionary(const vector<Slice>& samples,
+                                  size_t max_size,
+                                  string* dictionary) {
+  faststring buffer;
+  vector<size_t> sample_sizes;
+  sample_sizes.reserve(samples.size());
+  for (const Slice& sample : samples) {
+    buffer.append(sample.data(), sample.size());
+    sample_sizes.push_back(sample.size());
+  }
+  dictionary->resize(max_size);
+  size_t n = ZDICT_trainFromBuffer(&(*dictionary)[0], max_size,
+                                   buffer.data(), sample_sizes.data(), sample_sizes.size());
+  if (ZDICT_isError(n)) {
+    dictionary->clear();
+    return Status::RuntimeError("unable to train a compression dictionary",
+                                ZDICT_getErrorName(n));
+  }
+  dictionary->resize(n);
+  return Status::OK();
+}
+
 CompressionType GetCompressionCodecType(const std::string& name) {
   std::string uname;
   ToUpperCase(name, &uname);
@@ -275,6 +498,8 @@ CompressionType GetCompressionCodecType(const std::string& name) {
     return LZ4;
   if (uname == "ZLIB")
     return ZLIB;
+  if (uname == "ZSTD")
+    return ZSTD;
   if (uname == "NONE")
     return NO_COMPRESSION;
 
@@ -19,6 +19,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -71,6 +72,35 @@ class CompressionCodec {
 Status GetCompressionCodec(CompressionType compression,
                            const CompressionCodec** codec);
 
+// Options of the codecs created by NewCompressionCodec().
+struct CompressionCodecOptions {
+  // The compression level, or 0 for the default level of the codec. Only
+  // ZLIB (1 to 9) and ZSTD (1 to 22) support levels.
+  int level = 0;
+
+  // The dictionary compressed data is primed with, e.g. as trained by
+  // TrainCompressionDictionary(), or empty for none. Data compressed with a
+  // dictionary must be uncompressed with the same dictionary. Only ZSTD
+  // supports dictionaries.
+  Slice dictionary;
+};
+
+// Creates a compression codec of the specified type configured by 'options',
+// which isn't referenced once this returns.
+//
+// Returns InvalidArgument if the codec doesn't support the options.
+Status NewCompressionCodec(CompressionType compression,
+                           const CompressionCodecOptions& options,
+                           std::unique_ptr<CompressionCodec>* codec);
+
+// Trains a ZSTD dictionary of at most 'max_size' bytes on 'samples', which
+// should be pieces of data resembling the data to compress.
+//
+// Returns RuntimeError if there isn't enough sample data.
+Status TrainCompressionDictionary(const std::vector<Slice>& samples,
+                                  size_t max_size,
+                                  std::string* dictionary);
+
 // Returns the compression codec type given the name
 CompressionType GetCompressionCodecType(const std::string& name);
 
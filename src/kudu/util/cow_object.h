@@ -389,6 +389,31 @@ class CowGroupLock {
     mode_ = LockMode::RELEASED;
   }
 
+  // Unlocks the CowObject tracked under 'key' (aborting any in-progress
+  // mutation if locked for WRITE) and stops tracking it. Does nothing if no
+  // CowObject was added with that key.
+  //
+  // Useful to release objects which turned out not to need mutating before
+  // doing something slow with the rest still locked.
+  void UnlockObject(const Key& key) {
+    auto it = cows_.find(key);
+    if (it == cows_.end()) {
+      return;
+    }
+    switch (mode_) {
+      case LockMode::READ:
+        it->second->ReadUnlock();
+        break;
+      case LockMode::WRITE:
+        it->second->AbortMutation();
+        break;
+      default:
+        DCHECK_EQ(LockMode::RELEASED, mode_);
+        break;
+    }
+    cows_.erase(it);
+  }
+
   // Adds a new CowObject to be tracked by the lock guard. Does nothing if a
   // CowObject with the same key was already added.
   //
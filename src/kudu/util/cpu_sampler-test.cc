@@ -0,0 +1,132 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/cpu_sampler.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+#include "kudu/util/thread.h"
+#include "kudu/util/threadpool.h"
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+
+class CpuSamplerTest : public KuduTest {
+};
+
+namespace {
+
+// Burns CPU for 'duration', as measured on the wall clock.
+ATTRIBUTE_NOINLINE void BurnCpu(MonoDelta duration) {
+  const MonoTime deadline = MonoTime::Now() + duration;
+  volatile int64_t x = 0;
+  while (MonoTime::Now() < deadline) {
+    for (int i = 0; i < 10000; i++) {
+      x = x + i;
+    }
+  }
+}
+
+void BurnCpuForTablet(const string& tablet_id) {
+  ScopedCpuSampleTablet t(tablet_id);
+  BurnCpu(MonoDelta::FromMilliseconds(500));
+}
+
+int64_t CountSamples(const vector<CpuSampler::Sample>& samples,
+                     const string& thread, const string& tablet) {
+  int64_t count = 0;
+  for (const auto& s : samples) {
+    if (s.thread == thread && s.tablet == tablet) {
+      count += s.count;
+    }
+  }
+  return count;
+}
+
+} // anonymous namespace
+
+TEST_F(CpuSamplerTest, TestAttribution) {
+  CpuSampler sampler;
+  ASSERT_OK(sampler.Start(1000));
+  ASSERT_EQ(1000, sampler.hz());
+
+  // Only one sampler may run at a time.
+  {
+    CpuSampler other;
+    Status s = other.Start(100);
+    ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+  }
+
+  const string kTabletA = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
+  const string kTabletB = "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb";
+  scoped_refptr<Thread> thread;
+  ASSERT_OK(Thread::Create("test", "burner", &BurnCpuForTablet, kTabletA, &thread));
+  gscoped_ptr<ThreadPool> pool;
+  ASSERT_OK(ThreadPoolBuilder("burners").set_max_threads(1).Build(&pool));
+  ASSERT_OK(pool->SubmitFunc([&]() { BurnCpuForTablet(kTabletB); }));
+  thread->Join();
+  pool->Wait();
+  sampler.Stop();
+  ASSERT_EQ(0, sampler.hz());
+
+  vector<CpuSampler::Sample> samples;
+  int64_t num_dropped;
+  sampler.TakeSamples(&samples, &num_dropped);
+  ASSERT_EQ(0, num_dropped);
+  ASSERT_FALSE(samples.empty());
+
+  // Each thread burned about 500 samples worth of CPU time.
+  ASSERT_GT(CountSamples(samples, "test", kTabletA), 100);
+  ASSERT_GT(CountSamples(samples, "burners", kTabletB), 100);
+
+  // The function burning the CPU is on the stack of the samples.
+  bool found = false;
+  for (const auto& s : samples) {
+    if (s.tablet == kTabletA && s.stack.Symbolize().find("BurnCpu") != string::npos) {
+      found = true;
+      break;
+    }
+  }
+  ASSERT_TRUE(found);
+
+  // The samples were moved out of the sampler.
+  sampler.TakeSamples(&samples, &num_dropped);
+  ASSERT_TRUE(samples.empty());
+
+  // The sampler may be restarted.
+  ASSERT_OK(sampler.Start(100));
+  BurnCpu(MonoDelta::FromMilliseconds(200));
+  sampler.Stop();
+  sampler.TakeSamples(&samples, &num_dropped);
+  ASSERT_GT(CountSamples(samples, "", ""), 0);
+}
+
+} // namespace kudu
@@ -0,0 +1,319 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/cpu_sampler.h"
+
+#include <sched.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <ostream>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/gutil/strings/strip.h"
+#include "kudu/util/errno.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/scoped_cleanup.h"
+#include "kudu/util/thread.h"
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+
+namespace {
+
+// The signal sent by the sampling timer.
+const int kSamplingSignal = SIGVTALRM;
+
+// The number of samples which may be recorded between two aggregations.
+const int kNumSlots = 2048;
+
+// How often the recorded samples are aggregated.
+const MonoDelta kAggregationPeriod = MonoDelta::FromMilliseconds(100);
+
+// The sampler the signal handler records samples into, if any.
+std::atomic<CpuSampler*> g_sampler(nullptr);
+
+// The number of signal handlers currently recording into 'g_sampler'.
+std::atomic<int> g_num_handlers_running(0);
+
+// Protects the installation of the signal handler.
+std::mutex g_signal_handler_lock;
+bool g_signal_handler_installed = false;
+
+// The tablet the samples of the current thread are attributed to, if any.
+__thread const string* tls_tablet_id = nullptr;
+
+// Copies the nul-terminated prefix of 'src' fitting in 'dst'. Async-signal-safe.
+template<size_t N>
+void CopyLabel(const string& src, char (&dst)[N]) {
+  const size_t len = std::min(src.size(), N - 1);
+  memcpy(dst, src.data(), len);
+  dst[len] = '\0';
+}
+
+} // anonymous namespace
+
+struct CpuSampler::Slot {
+  enum State {
+    kFree,
+    kWriting,
+    kReady
+  };
+  std::atomic<int> state { kFree };
+  int64_t weight;
+  char thread[32];
+  // Tablet IDs are 32 hexadecimal characters.
+  char tablet[33];
+  StackTrace stack;
+};
+
+bool CpuSampler::SampleKey::operator<(const SampleKey& other) const {
+  int cmp = thread.compare(other.thread);
+  if (cmp != 0) return cmp < 0;
+  cmp = tablet.compare(other.tablet);
+  if (cmp != 0) return cmp < 0;
+  return stack.LessThan(other.stack);
+}
+
+CpuSampler::CpuSampler()
+    : slots_(new Slot[kNumSlots]),
+      next_slot_(0),
+      num_dropped_(0),
+      hz_(0),
+      stop_latch_(1) {
+}
+
+CpuSampler::~CpuSampler() {
+  Stop();
+}
+
+Status CpuSampler::Start(int hz) {
+  CHECK_GT(hz, 0);
+  CHECK_EQ(0, hz_.load()) << "CPU sampler already started";
+#ifndef __linux__
+  return Status::NotSupported("CPU sampling is only supported on Linux");
+#else
+  {
+    std::lock_guard<std::mutex> l(g_signal_handler_lock);
+    if (!g_signal_handler_installed) {
+      // The handler is never uninstalled once installed, since the default
+      // action of the signal is to terminate the process and a signal may
+      // still be pending after the timer is deleted.
+      struct sigaction act;
+      memset(&act, 0, sizeof(act));
+      act.sa_sigaction = &CpuSampler::HandleSignal;
+      act.sa_flags = SA_SIGINFO | SA_RESTART;
+      struct sigaction old_act;
+      if (sigaction(kSamplingSignal, nullptr, &old_act) != 0) {
+        return Status::RuntimeError("unable to get signal handler", ErrnoToString(errno));
+      }
+      if (old_act.sa_handler != SIG_DFL && old_act.sa_handler != SIG_IGN) {
+        return Status::IllegalState("CPU sampling signal is already in use");
+      }
+      if (sigaction(kSamplingSignal, &act, nullptr) != 0) {
+        return Status::RuntimeError("unable to install signal handler", ErrnoToString(errno));
+      }
+      g_signal_handler_installed = true;
+    }
+  }
+
+  CpuSampler* expected = nullptr;
+  if (!g_sampler.compare_exchange_strong(expected, this)) {
+    return Status::IllegalState("another CPU sampler is already running in the process");
+  }
+  auto unregister = MakeScopedCleanup([&]() {
+    g_sampler = nullptr;
+  });
+
+  // The first unwinding of a stack initializes libunwind, which isn't safe
+  // to do in a signal handler.
+  StackTrace prime;
+  prime.Collect();
+
+  stop_latch_.Reset(1);
+  RETURN_NOT_OK(Thread::Create("profiler", "cpu-sampler",
+                               &CpuSampler::RunAggregatorThread, this, &thread_));
+  auto stop_thread = MakeScopedCleanup([&]() {
+    stop_latch_.CountDown();
+    thread_->Join();
+    thread_.reset();
+  });
+
+  struct sigevent sev;
+  memset(&sev, 0, sizeof(sev));
+  sev.sigev_notify = SIGEV_SIGNAL;
+  sev.sigev_signo = kSamplingSignal;
+  if (timer_create(CLOCK_PROCESS_CPUTIME_ID, &sev, &timer_) != 0) {
+    return Status::RuntimeError("unable to create CPU sampling timer", ErrnoToString(errno));
+  }
+  struct itimerspec its;
+  its.it_interval.tv_sec = 0;
+  its.it_interval.tv_nsec = 1000000000L / hz;
+  its.it_value = its.it_interval;
+  if (timer_settime(timer_, 0, &its, nullptr) != 0) {
+    const int err = errno;
+    timer_delete(timer_);
+    return Status::RuntimeError("unable to start CPU sampling timer", ErrnoToString(err));
+  }
+
+  unregister.cancel();
+  stop_thread.cancel();
+  hz_ = hz;
+  return Status::OK();
+#endif
+}
+
+void CpuSampler::Stop() {
+  if (hz_.load() == 0) return;
+  timer_delete(timer_);
+  g_sampler = nullptr;
+  // Wait for the handlers which may have seen this sampler to be done with it.
+  while (g_num_handlers_running.load() > 0) {
+    sched_yield();
+  }
+  stop_latch_.CountDown();
+  thread_->Join();
+  thread_.reset();
+  AggregateSamples();
+  hz_ = 0;
+}
+
+int CpuSampler::hz() const {
+  return hz_.load();
+}
+
+void CpuSampler::HandleSignal(int /*signum*/, siginfo_t* info, void* /*ucontext*/) {
+  // Signal handlers may be invoked at any point, so it's important to preserve
+  // errno.
+  int save_errno = errno;
+  SCOPED_CLEANUP({
+      errno = save_errno;
+    });
+  // Ignore the signals not sent by the sampling timer.
+  if (info->si_code != SI_TIMER) return;
+
+  g_num_handlers_running++;
+  SCOPED_CLEANUP({
+      g_num_handlers_running--;
+    });
+  CpuSampler* sampler = g_sampler.load();
+  if (!sampler) return;
+
+  // Skip the frames of this handler and of the signal trampoline, so that the
+  // innermost frame is where the thread was interrupted.
+  StackTrace stack;
+  stack.Collect(/*skip_frames=*/2);
+  // The expirations of the timer while the signal was pending are reported as
+  // overruns: they are attributed to the same stack.
+  sampler->RecordSample(stack, 1 + info->si_overrun);
+}
+
+void CpuSampler::RecordSample(const StackTrace& stack, int64_t weight) {
+  const int idx = next_slot_.fetch_add(1, std::memory_order_relaxed);
+  int expected = Slot::kFree;
+  if (idx >= kNumSlots ||
+      !slots_[idx].state.compare_exchange_strong(expected, Slot::kWriting,
+                                                 std::memory_order_acquire)) {
+    num_dropped_.fetch_add(weight, std::memory_order_relaxed);
+    return;
+  }
+  Slot* slot = &slots_[idx];
+  slot->weight = weight;
+
+  // Thread pools have threads of the same "thread pool" category, which are
+  // named after their pool.
+  const Thread* thread = Thread::current_thread();
+  if (!thread) {
+    slot->thread[0] = '\0';
+  } else if (thread->category() == "thread pool") {
+    CopyLabel(thread->name(), slot->thread);
+  } else {
+    CopyLabel(thread->category(), slot->thread);
+  }
+  const string* tablet_id = tls_tablet_id;
+  if (tablet_id) {
+    CopyLabel(*tablet_id, slot->tablet);
+  } else {
+    slot->tablet[0] = '\0';
+  }
+  slot->stack.CopyFrom(stack);
+  slot->state.store(Slot::kReady, std::memory_order_release);
+}
+
+void CpuSampler::RunAggregatorThread() {
+  while (!stop_latch_.WaitFor(kAggregationPeriod)) {
+    AggregateSamples();
+  }
+}
+
+void CpuSampler::AggregateSamples() {
+  next_slot_.store(0, std::memory_order_relaxed);
+  // All the slots are scanned rather than only the ones allocated since the
+  // last aggregation: a handler may still have been writing into one of them
+  // then.
+  MutexLock l(lock_);
+  for (int i = 0; i < kNumSlots; i++) {
+    Slot* slot = &slots_[i];
+    if (slot->state.load(std::memory_order_acquire) != Slot::kReady) continue;
+    SampleKey key;
+    key.thread = slot->thread;
+    // The names of the threads of a pool are suffixed with their role.
+    TryStripSuffixString(key.thread, " [worker]", &key.thread);
+    key.tablet = slot->tablet;
+    key.stack.CopyFrom(slot->stack);
+    aggregated_[std::move(key)] += slot->weight;
+    slot->state.store(Slot::kFree, std::memory_order_release);
+  }
+}
+
+void CpuSampler::TakeSamples(vector<Sample>* samples, int64_t* num_dropped) {
+  samples->clear();
+  {
+    MutexLock l(lock_);
+    samples->reserve(aggregated_.size());
+    for (auto& e : aggregated_) {
+      Sample s;
+      s.thread = e.first.thread;
+      s.tablet = e.first.tablet;
+      s.stack.CopyFrom(e.first.stack);
+      s.count = e.second;
+      samples->emplace_back(std::move(s));
+    }
+    aggregated_.clear();
+  }
+  *num_dropped = num_dropped_.exchange(0);
+}
+
+ScopedCpuSampleTablet::ScopedCpuSampleTablet(const string& tablet_id)
+    : prev_tablet_id_(tls_tablet_id) {
+  tls_tablet_id = &tablet_id;
+  // The tablet ID is read by the signal handler interrupting this thread.
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+ScopedCpuSampleTablet::~ScopedCpuSampleTablet() {
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+  tls_tablet_id = prev_tablet_id_;
+}
+
+} // namespace kudu
@@ -0,0 +1,144 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/debug-util.h"
+#include "kudu/util/mutex.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class Thread;
+
+// A low-overhead sampling profiler of the CPU time of the whole process.
+//
+// Once started, a timer on the CPU time consumed by the process interrupts
+// the running thread with a signal about 'hz' times per second of CPU time,
+// and the signal handler records the stack of that thread, along with the
+// thread pool (or thread category) it belongs to and the tablet it's working
+// on, if any (see ScopedCpuSampleTablet). A background thread aggregates the
+// samples, which may be collected at any time with TakeSamples().
+//
+// The timer and the signal handler are process-wide, so only one sampler may
+// be running in a process at a time. The sampler uses SIGVTALRM, which must
+// not be used by anything else in the process.
+//
+// This class is thread-safe.
+class CpuSampler {
+ public:
+  // The samples of the same stack, thread pool and tablet.
+  struct Sample {
+    // The thread pool the samples were taken in, or the category of the
+    // thread if it doesn't belong to a pool. Empty if the thread wasn't
+    // started by kudu::Thread.
+    std::string thread;
+    // The tablet the thread was working on, or empty if unknown.
+    std::string tablet;
+    // The innermost frames of the stack.
+    StackTrace stack;
+    // The number of samples with this stack, thread and tablet.
+    int64_t count;
+  };
+
+  CpuSampler();
+  ~CpuSampler();
+
+  // Starts sampling at about 'hz' samples per second of CPU time.
+  //
+  // Returns IllegalState if another sampler is running in the process, or
+  // if the sampling signal is already in use.
+  Status Start(int hz);
+
+  // Stops sampling. The samples taken so far may still be collected.
+  void Stop();
+
+  // The sampling frequency if running, or 0 if stopped.
+  int hz() const;
+
+  // Moves the samples aggregated since the last call into 'samples', and
+  // sets 'num_dropped' to the number of samples which were dropped in the
+  // meantime because the sampler couldn't keep up.
+  void TakeSamples(std::vector<Sample>* samples, int64_t* num_dropped);
+
+ private:
+  struct Slot;
+
+  struct SampleKey {
+    std::string thread;
+    std::string tablet;
+    StackTrace stack;
+    bool operator<(const SampleKey& other) const;
+  };
+
+  static void HandleSignal(int signum, siginfo_t* info, void* ucontext);
+
+  // Records a sample with the given weight of the stack 'stack' of the
+  // calling thread. Async-signal-safe.
+  void RecordSample(const StackTrace& stack, int64_t weight);
+
+  // Aggregates the recorded samples until Stop() is called.
+  void RunAggregatorThread();
+
+  // Moves the recorded samples into 'aggregated_'.
+  void AggregateSamples();
+
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<int> next_slot_;
+  std::atomic<int64_t> num_dropped_;
+
+  timer_t timer_;
+  std::atomic<int> hz_;
+
+  scoped_refptr<Thread> thread_;
+  CountDownLatch stop_latch_;
+
+  // Protects 'aggregated_'.
+  Mutex lock_;
+  std::map<SampleKey, int64_t> aggregated_;
+
+  DISALLOW_COPY_AND_ASSIGN(CpuSampler);
+};
+
+// Attributes the CPU samples taken in the current thread during the lifetime
+// of this object to a tablet. 'tablet_id' must stay valid and unmodified
+// during that time.
+//
+// These may be nested, in which case the innermost one wins.
+class ScopedCpuSampleTablet {
+ public:
+  explicit ScopedCpuSampleTablet(const std::string& tablet_id);
+  ~ScopedCpuSampleTablet();
+
+ private:
+  const std::string* prev_tablet_id_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedCpuSampleTablet);
+};
+
+} // namespace kudu
@@ -79,6 +79,31 @@ TEST_F(CrcTest, TestCRC32C) {
   ASSERT_EQ(kExpectedCrc, data_crc3);
 }
 
+// Test that the fused copy+checksum matches a plain copy and checksum,
+// including for buffers spanning several internal chunks.
+TEST_F(CrcTest, TestCRC32CCopy) {
+  gscoped_ptr<const uint8_t[]> data;
+  const uint8_t* buf;
+  size_t buflen;
+  GenerateBenchmarkData(&buf, &buflen);
+  data.reset(buf);
+
+  for (size_t len : { static_cast<size_t>(0), static_cast<size_t>(7),
+                      static_cast<size_t>(16 * 1024), static_cast<size_t>(16 * 1024 + 1),
+                      buflen }) {
+    SCOPED_TRACE(len);
+    gscoped_ptr<uint8_t[]> dst(new uint8_t[buflen]);
+    uint32_t copied_crc = Crc32cCopy(dst.get(), buf, len, 0);
+    ASSERT_EQ(Crc32c(buf, len), copied_crc);
+    ASSERT_EQ(0, memcmp(buf, dst.get(), len));
+
+    // Extending a previous checksum.
+    uint32_t prefix_crc = Crc32c(buf, len / 2);
+    copied_crc = Crc32cCopy(dst.get(), buf + len / 2, len - len / 2, prefix_crc);
+    ASSERT_EQ(Crc32c(buf, len), copied_crc);
+  }
+}
+
 // Simple benchmark of CRC32C throughput.
 // We should expect about 8 bytes per cycle in throughput on a single core.
 TEST_F(CrcTest, BenchmarkCRC32C) {
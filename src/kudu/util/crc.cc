@@ -16,6 +16,9 @@
 // under the License.
 #include "kudu/util/crc.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include <crcutil/interface.h>
 
 #include "kudu/gutil/once.h"
@@ -52,5 +55,23 @@ uint32_t Crc32c(const void* data, size_t length, uint32_t prev_crc32) {
   return static_cast<uint32_t>(crc_tmp); // Only uses lower 32 bits.
 }
 
+uint32_t Crc32cCopy(void* dst, const void* src, size_t length, uint32_t prev_crc32) {
+  // Small enough that a chunk is still in L1 when it's checksummed.
+  static const size_t kChunkSize = 16 * 1024;
+  Crc* crc32c = GetCrc32cInstance();
+  uint64_t crc_tmp = static_cast<uint64_t>(prev_crc32);
+  uint8_t* d = static_cast<uint8_t*>(dst);
+  const uint8_t* s = static_cast<const uint8_t*>(src);
+  while (length > 0) {
+    size_t n = std::min(length, kChunkSize);
+    memcpy(d, s, n);
+    crc32c->Compute(d, n, &crc_tmp);
+    d += n;
+    s += n;
+    length -= n;
+  }
+  return static_cast<uint32_t>(crc_tmp); // Only uses lower 32 bits.
+}
+
 } // namespace crc
 } // namespace kudu
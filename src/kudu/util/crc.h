@@ -37,6 +37,12 @@ uint32_t Crc32c(const void* data, size_t length);
 // extends it to new chunk and returns the result.
 uint32_t Crc32c(const void* data, size_t length, uint32_t prev_crc32);
 
+// Copies 'length' bytes from 'src' to 'dst' and returns the CRC32C of the
+// copied bytes, extending 'prev_crc32'. The copy and the checksum are done
+// together in cache-sized chunks, so the data is pulled through the memory
+// hierarchy once rather than twice. 'src' and 'dst' must not overlap.
+uint32_t Crc32cCopy(void* dst, const void* src, size_t length, uint32_t prev_crc32);
+
 } // namespace crc
 } // namespace kudu
 
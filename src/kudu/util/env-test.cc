@@ -538,6 +538,82 @@ TEST_F(TestEnv, TestReadVFully) {
   ASSERT_STR_CONTAINS(status.ToString(), "EOF");
 }
 
+TEST_F(TestEnv, TestReadahead) {
+  const string kTestPath = GetTestPath("foo");
+  const string kTestData(64 * 1024, 'x');
+  unique_ptr<RWFile> rw_file;
+  ASSERT_OK(env_->NewRWFile(kTestPath, &rw_file));
+  ASSERT_OK(rw_file->Write(0, kTestData));
+
+  // Read-ahead is only a hint, so reading ahead within the file, past its
+  // end, or of nothing at all should succeed.
+  ASSERT_OK(rw_file->Readahead(0, kTestData.size()));
+  ASSERT_OK(rw_file->Readahead(kTestData.size() / 2, kTestData.size()));
+  ASSERT_OK(rw_file->Readahead(kTestData.size() * 2, 4096));
+  ASSERT_OK(rw_file->Readahead(0, 0));
+
+  unique_ptr<RandomAccessFile> ra_file;
+  ASSERT_OK(env_->NewRandomAccessFile(kTestPath, &ra_file));
+  ASSERT_OK(ra_file->Readahead(0, kTestData.size()));
+
+  // The data reads back the same afterwards.
+  faststring scratch;
+  scratch.resize(kTestData.size());
+  Slice result(scratch.data(), scratch.size());
+  ASSERT_OK(ra_file->Read(0, result));
+  ASSERT_EQ(kTestData, result.ToString());
+}
+
+TEST_F(TestEnv, TestDropCache) {
+  const string kTestPath = GetTestPath("foo");
+  const string kTestData(64 * 1024, 'x');
+  unique_ptr<RWFile> rw_file;
+  ASSERT_OK(env_->NewRWFile(kTestPath, &rw_file));
+  ASSERT_OK(rw_file->Write(0, kTestData));
+
+  // Dropping is only a hint too, whether the pages are dirty or clean.
+  ASSERT_OK(rw_file->DropCache(0, kTestData.size()));
+  ASSERT_OK(rw_file->Sync());
+  ASSERT_OK(rw_file->DropCache(0, kTestData.size()));
+  ASSERT_OK(rw_file->DropCache(kTestData.size() * 2, 4096));
+  ASSERT_OK(rw_file->DropCache(0, 0));
+
+  // No data is lost.
+  faststring scratch;
+  scratch.resize(kTestData.size());
+  Slice result(scratch.data(), scratch.size());
+  ASSERT_OK(rw_file->Read(0, result));
+  ASSERT_EQ(kTestData, result.ToString());
+}
+
+TEST_F(TestEnv, TestMapForRead) {
+  const string kTestPath = GetTestPath("foo");
+  string test_data;
+  for (int i = 0; i < 64 * 1024; i++) {
+    test_data.push_back('a' + i % 26);
+  }
+  unique_ptr<RWFile> rw_file;
+  ASSERT_OK(env_->NewRWFile(kTestPath, &rw_file));
+  ASSERT_OK(rw_file->Write(0, test_data));
+
+  // Ranges which don't start at a page boundary are mapped too.
+  unique_ptr<MappedRegion> region;
+  ASSERT_OK(rw_file->MapForRead(1000, 10000, &region));
+  ASSERT_EQ(test_data.substr(1000, 10000), region->data().ToString());
+  ASSERT_OK(region->Prefetch(0, 10000));
+  ASSERT_OK(region->Prefetch(5000, 100000));
+  ASSERT_OK(region->Prefetch(20000, 1));
+
+  // The mapping of a file remains valid after it's closed and deleted.
+  unique_ptr<RandomAccessFile> ra_file;
+  ASSERT_OK(env_->NewRandomAccessFile(kTestPath, &ra_file));
+  ASSERT_OK(ra_file->MapForRead(0, test_data.size(), &region));
+  ASSERT_OK(rw_file->Close());
+  ra_file.reset();
+  ASSERT_OK(env_->DeleteFile(kTestPath));
+  ASSERT_EQ(test_data, region->data().ToString());
+}
+
 TEST_F(TestEnv, TestIOVMax) {
   Env* env = Env::Default();
   const string kTestPath = GetTestPath("test");
@@ -1049,6 +1125,26 @@ TEST_F(TestEnv, TestChangeDir) {
   ASSERT_EQ(orig_dir, cwd);
 }
 
+TEST_F(TestEnv, TestSyncFilesystem) {
+  FLAGS_never_fsync = false;
+  const string kTestPath = GetTestPath("test");
+  unique_ptr<WritableFile> file;
+  ASSERT_OK(env_->NewWritableFile(kTestPath, &file));
+  ASSERT_OK(file->Append("data"));
+  Status s = env_->SyncFilesystem(test_dir_);
+#if defined(__linux__)
+  ASSERT_OK(s);
+#else
+  ASSERT_TRUE(s.IsNotSupported()) << s.ToString();
+#endif
+  ASSERT_OK(file->Close());
+
+  s = env_->SyncFilesystem(GetTestPath("missing"));
+#if defined(__linux__)
+  ASSERT_TRUE(s.IsNotFound()) << s.ToString();
+#endif
+}
+
 TEST_F(TestEnv, TestGetExtentMap) {
   // In order to force filesystems that use delayed allocation to write out the
   // extents, we must Sync() after the file is done growing, and that should
@@ -21,6 +21,9 @@ Env::~Env() {
 SequentialFile::~SequentialFile() {
 }
 
+MappedRegion::~MappedRegion() {
+}
+
 RandomAccessFile::~RandomAccessFile() {
 }
 
@@ -29,6 +29,7 @@ namespace kudu {
 
 class faststring;
 class FileLock;
+class MappedRegion;
 class RandomAccessFile;
 class RWFile;
 class SequentialFile;
@@ -173,6 +174,12 @@ class Env {
   // Synchronize the entry for a specific directory.
   virtual Status SyncDir(const std::string& dirname) = 0;
 
+  // Synchronize all the data and metadata of the filesystem containing
+  // 'path', making durable the writes of all its files at once.
+  //
+  // Returns NotSupported on platforms which can't sync a single filesystem.
+  virtual Status SyncFilesystem(const std::string& path) = 0;
+
   // Recursively delete the specified directory.
   // This should operate safely, not following any symlinks, etc.
   virtual Status DeleteRecursively(const std::string &dirname) = 0;
@@ -399,6 +406,26 @@ class SequentialFile {
   virtual const std::string& filename() const = 0;
 };
 
+// A read-only memory mapping of a range of a file, created by
+// RandomAccessFile::MapForRead() or RWFile::MapForRead(). It's unmapped when
+// destroyed.
+class MappedRegion {
+ public:
+  MappedRegion() { }
+  virtual ~MappedRegion();
+
+  // Returns the mapped bytes of the file.
+  virtual Slice data() const = 0;
+
+  // Hints that the 'length' bytes starting at 'offset' in the region will be
+  // accessed soon, so that the OS may start reading them into its page cache
+  // in the background. The range is clamped to the end of the region.
+  virtual Status Prefetch(size_t offset, size_t length) const = 0;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(MappedRegion);
+};
+
 // A file abstraction for randomly reading the contents of a file.
 //
 // Note: this abstraction is safe to use in FileCache, which means all
@@ -435,6 +462,24 @@ class RandomAccessFile {
   // Safe for concurrent use by multiple threads.
   virtual Status ReadV(uint64_t offset, ArrayView<Slice> results) const = 0;
 
+  // Hints that the 'length' bytes starting at 'offset' will be read soon,
+  // so that the OS may start reading them into its page cache in the
+  // background. Doesn't wait for the data to be read.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual Status Readahead(uint64_t offset, size_t length) const = 0;
+
+  // Maps the 'length' bytes starting at 'offset' into memory for reading,
+  // setting 'region' to the mapping. 'length' must be positive.
+  //
+  // The mapping remains valid after the file is closed or deleted. Reading
+  // bytes of holes punched in the file afterwards yields zeros, and reading
+  // bytes beyond the end of the file after it was truncated raises SIGBUS.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual Status MapForRead(uint64_t offset, size_t length,
+                            std::unique_ptr<MappedRegion>* region) const = 0;
+
   // Returns the size of the file
   virtual Status Size(uint64_t *size) const = 0;
 
@@ -581,6 +626,32 @@ class RWFile {
   // Safe for concurrent use by multiple threads.
   virtual Status ReadV(uint64_t offset, ArrayView<Slice> results) const = 0;
 
+  // Hints that the 'length' bytes starting at 'offset' will be read soon,
+  // so that the OS may start reading them into its page cache in the
+  // background. Doesn't wait for the data to be read.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual Status Readahead(uint64_t offset, size_t length) const = 0;
+
+  // Hints that the 'length' bytes starting at 'offset' won't be accessed
+  // again soon, so that the OS may drop them from its page cache. Dirty
+  // pages can't be dropped until they are written back; the hint starts
+  // their writeback but doesn't wait for it.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual Status DropCache(uint64_t offset, size_t length) const = 0;
+
+  // Maps the 'length' bytes starting at 'offset' into memory for reading,
+  // setting 'region' to the mapping. 'length' must be positive.
+  //
+  // The mapping remains valid after the file is closed or deleted. Reading
+  // bytes of holes punched in the file afterwards yields zeros, and reading
+  // bytes beyond the end of the file after it was truncated raises SIGBUS.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual Status MapForRead(uint64_t offset, size_t length,
+                            std::unique_ptr<MappedRegion>* region) const = 0;
+
   // Writes 'data' to the file position given by 'offset'.
   virtual Status Write(uint64_t offset, const Slice& data) = 0;
 
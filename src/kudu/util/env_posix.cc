@@ -8,6 +8,7 @@
 #include <fts.h>
 #include <glob.h>
 #include <pthread.h>
+#include <sys/mman.h>
 #include <sys/resource.h>
 #include <sys/stat.h>
 #include <sys/statvfs.h>
@@ -432,6 +433,109 @@ Status DoReadV(int fd, const string& filename, uint64_t offset,
   return Status::OK();
 }
 
+Status DoReadahead(int fd, const string& filename, uint64_t offset, size_t length) {
+  MAYBE_RETURN_EIO(filename, IOError(Env::kInjectedFailureStatusMsg, EIO));
+  ThreadRestrictions::AssertIOAllowed();
+#if defined(__APPLE__)
+  struct radvisory ra;
+  ra.ra_offset = offset;
+  ra.ra_count = length;
+  if (fcntl(fd, F_RDADVISE, &ra) == -1) {
+    return IOError(filename, errno);
+  }
+#else
+  int err = posix_fadvise(fd, offset, length, POSIX_FADV_WILLNEED);
+  if (PREDICT_FALSE(err != 0)) {
+    return IOError(filename, err);
+  }
+#endif
+  return Status::OK();
+}
+
+Status DoDropCache(int fd, const string& filename, uint64_t offset, size_t length) {
+  MAYBE_RETURN_EIO(filename, IOError(Env::kInjectedFailureStatusMsg, EIO));
+  ThreadRestrictions::AssertIOAllowed();
+#if !defined(__APPLE__)
+  // macOS has no equivalent for a range of a file. A zero length would
+  // cover the whole file for posix_fadvise().
+  if (length == 0) {
+    return Status::OK();
+  }
+  int err = posix_fadvise(fd, offset, length, POSIX_FADV_DONTNEED);
+  if (PREDICT_FALSE(err != 0)) {
+    return IOError(filename, err);
+  }
+#endif
+  return Status::OK();
+}
+
+// A memory mapping of a range of a file, which starts at a page boundary.
+class PosixMappedRegion : public MappedRegion {
+ public:
+  PosixMappedRegion(string filename, void* base, size_t mapped_length, Slice data)
+      : filename_(std::move(filename)),
+        base_(base),
+        mapped_length_(mapped_length),
+        data_(data) {
+  }
+
+  virtual ~PosixMappedRegion() {
+    if (PREDICT_FALSE(munmap(base_, mapped_length_) != 0)) {
+      PLOG(WARNING) << "Failed to unmap " << filename_;
+    }
+  }
+
+  virtual Slice data() const OVERRIDE { return data_; }
+
+  virtual Status Prefetch(size_t offset, size_t length) const OVERRIDE {
+    if (offset >= data_.size()) {
+      return Status::OK();
+    }
+    length = std::min(length, data_.size() - offset);
+    // madvise() requires a page-aligned address.
+    const uint8_t* start = data_.data() + offset;
+    const size_t page_offset = (start - static_cast<const uint8_t*>(base_)) %
+        sysconf(_SC_PAGESIZE);
+    if (PREDICT_FALSE(madvise(const_cast<uint8_t*>(start - page_offset), length + page_offset,
+                              MADV_WILLNEED) != 0)) {
+      return IOError(filename_, errno);
+    }
+    return Status::OK();
+  }
+
+ private:
+  const string filename_;
+  void* const base_;
+  const size_t mapped_length_;
+  const Slice data_;
+};
+
+Status DoMapForRead(int fd, const string& filename, uint64_t offset, size_t length,
+                    unique_ptr<MappedRegion>* region) {
+  MAYBE_RETURN_EIO(filename, IOError(Env::kInjectedFailureStatusMsg, EIO));
+  TRACE_EVENT1("io", "DoMapForRead", "path", filename);
+  DCHECK_GT(length, 0);
+  // mmap() requires a page-aligned offset.
+  const size_t page_offset = offset % sysconf(_SC_PAGESIZE);
+  const size_t mapped_length = length + page_offset;
+  void* base = mmap(nullptr, mapped_length, PROT_READ, MAP_SHARED, fd, offset - page_offset);
+  if (PREDICT_FALSE(base == MAP_FAILED)) {
+    return IOError(filename, errno);
+  }
+  // The readers of the mapping prefetch the ranges they're about to access
+  // with Prefetch(), so the kernel's readahead around each page fault would
+  // mostly read bytes of other, possibly cold, ranges.
+  if (PREDICT_FALSE(madvise(base, mapped_length, MADV_RANDOM) != 0)) {
+    int err = errno;
+    munmap(base, mapped_length);
+    return IOError(filename, err);
+  }
+  region->reset(new PosixMappedRegion(
+      filename, base, mapped_length,
+      Slice(static_cast<const uint8_t*>(base) + page_offset, length)));
+  return Status::OK();
+}
+
 Status DoWriteV(int fd, const string& filename, uint64_t offset, ArrayView<const Slice> data) {
   MAYBE_RETURN_EIO(filename, IOError(Env::kInjectedFailureStatusMsg, EIO));
   ThreadRestrictions::AssertIOAllowed();
@@ -615,6 +719,15 @@ class PosixRandomAccessFile: public RandomAccessFile {
     return DoReadV(fd_, filename_, offset, results);
   }
 
+  virtual Status Readahead(uint64_t offset, size_t length) const OVERRIDE {
+    return DoReadahead(fd_, filename_, offset, length);
+  }
+
+  virtual Status MapForRead(uint64_t offset, size_t length,
+                            unique_ptr<MappedRegion>* region) const OVERRIDE {
+    return DoMapForRead(fd_, filename_, offset, length, region);
+  }
+
   virtual Status Size(uint64_t *size) const OVERRIDE {
     MAYBE_RETURN_EIO(filename_, IOError(Env::kInjectedFailureStatusMsg, EIO));
     TRACE_EVENT1("io", "PosixRandomAccessFile::Size", "path", filename_);
@@ -805,6 +918,19 @@ class PosixRWFile : public RWFile {
     return DoReadV(fd_, filename_, offset, results);
   }
 
+  virtual Status Readahead(uint64_t offset, size_t length) const OVERRIDE {
+    return DoReadahead(fd_, filename_, offset, length);
+  }
+
+  virtual Status DropCache(uint64_t offset, size_t length) const OVERRIDE {
+    return DoDropCache(fd_, filename_, offset, length);
+  }
+
+  virtual Status MapForRead(uint64_t offset, size_t length,
+                            unique_ptr<MappedRegion>* region) const OVERRIDE {
+    return DoMapForRead(fd_, filename_, offset, length, region);
+  }
+
   virtual Status Write(uint64_t offset, const Slice& data) OVERRIDE {
     return WriteV(offset, ArrayView<const Slice>(&data, 1));
   }
@@ -1256,6 +1382,27 @@ class PosixEnv : public Env {
     return Status::OK();
   }
 
+  virtual Status SyncFilesystem(const string& path) OVERRIDE {
+    TRACE_EVENT1("io", "SyncFilesystem", "path", path);
+    MAYBE_RETURN_EIO(path, IOError(Env::kInjectedFailureStatusMsg, EIO));
+    ThreadRestrictions::AssertIOAllowed();
+#if defined(__linux__)
+    if (FLAGS_never_fsync) return Status::OK();
+    int fd;
+    RETRY_ON_EINTR(fd, open(path.c_str(), O_RDONLY));
+    if (fd < 0) {
+      return IOError(path, errno);
+    }
+    ScopedFdCloser fd_closer(fd);
+    if (syncfs(fd) != 0) {
+      return IOError(path, errno);
+    }
+    return Status::OK();
+#else
+    return Status::NotSupported("syncing a single filesystem is not supported", path);
+#endif
+  }
+
   virtual Status DeleteRecursively(const string &name) OVERRIDE {
     return Walk(name, POST_ORDER, Bind(&PosixEnv::DeleteRecursivelyCb,
                                        Unretained(this)));
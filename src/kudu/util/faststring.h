@@ -34,7 +34,8 @@ namespace kudu {
 class faststring {
  public:
   enum {
-    kInitialCapacity = 32
+    // Large enough for the typical encoded composite keys.
+    kInitialCapacity = 64
   };
 
   faststring() :
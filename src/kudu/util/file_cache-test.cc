@@ -45,6 +45,11 @@
 DECLARE_bool(cache_force_single_shard);
 DECLARE_int32(file_cache_expiry_period_ms);
 
+METRIC_DECLARE_entity(server);
+METRIC_DECLARE_histogram(file_cache_hit_latency);
+METRIC_DECLARE_histogram(file_cache_open_latency);
+METRIC_DECLARE_histogram(file_cache_evict_latency);
+
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
@@ -84,11 +89,12 @@ class FileCacheTest : public KuduTest {
   }
 
  protected:
-  Status ReinitCache(int max_open_files) {
+  Status ReinitCache(int max_open_files,
+                     const scoped_refptr<MetricEntity>& entity = nullptr) {
     cache_.reset(new FileCache<FileType>("test",
                                          env_,
                                          max_open_files,
-                                         nullptr));
+                                         entity));
     return cache_->Init();
   }
 
@@ -277,6 +283,47 @@ TYPED_TEST(FileCacheTest, TestInvalidation) {
   ASSERT_EQ(kData2.size(), size);
 }
 
+TYPED_TEST(FileCacheTest, TestBatchedOpen) {
+  const int kNumFiles = 20;
+  ASSERT_OK(this->ReinitCache(kNumFiles));
+
+  vector<string> filenames;
+  for (int i = 0; i < kNumFiles; i++) {
+    filenames.emplace_back(this->GetTestPath(Substitute("$0", i)));
+    ASSERT_OK(this->WriteTestFile(filenames.back(), filenames.back()));
+  }
+
+  // Open half the files individually, then all of them in a batch, including
+  // one of them twice. The existing descriptors should be reused.
+  vector<shared_ptr<TypeParam>> opened_files;
+  for (int i = 0; i < kNumFiles / 2; i++) {
+    shared_ptr<TypeParam> f;
+    ASSERT_OK(this->cache_->OpenExistingFile(filenames[i], &f));
+    opened_files.emplace_back(std::move(f));
+  }
+  vector<string> batch = filenames;
+  batch.emplace_back(filenames[kNumFiles - 1]);
+  vector<shared_ptr<TypeParam>> files;
+  ASSERT_OK(this->cache_->OpenExistingFiles(batch, &files));
+  ASSERT_EQ(batch.size(), files.size());
+  NO_FATALS(this->AssertFdsAndDescriptors(kNumFiles, kNumFiles));
+  for (int i = 0; i < kNumFiles / 2; i++) {
+    ASSERT_EQ(opened_files[i], files[i]);
+  }
+  ASSERT_EQ(files[kNumFiles - 1], files.back());
+  for (int i = 0; i < batch.size(); i++) {
+    ASSERT_EQ(batch[i], files[i]->filename());
+    uint64_t size;
+    ASSERT_OK(files[i]->Size(&size));
+    ASSERT_EQ(batch[i].size(), size);
+  }
+
+  // A batch with a missing file fails as a whole.
+  vector<shared_ptr<TypeParam>> files2;
+  ASSERT_TRUE(this->cache_->OpenExistingFiles(
+      { filenames[0], "/does/not/exist" }, &files2).IsNotFound());
+  ASSERT_TRUE(files2.empty());
+}
 
 TYPED_TEST(FileCacheTest, TestHeavyReads) {
   const int kNumFiles = 20;
@@ -358,4 +405,29 @@ TEST_F(RandomAccessFileCacheTest, TestMemoryFootprintDoesNotCrash) {
   LOG(INFO) << f->memory_footprint();
 }
 
+TEST_F(RandomAccessFileCacheTest, TestLatencyMetrics) {
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity = METRIC_ENTITY_server.Instantiate(&registry, "test");
+  ASSERT_OK(ReinitCache(1, entity));
+  const string kFile1 = GetTestPath("foo");
+  const string kFile2 = GetTestPath("bar");
+  ASSERT_OK(WriteTestFile(kFile1, "test data"));
+  ASSERT_OK(WriteTestFile(kFile2, "test data"));
+
+  shared_ptr<RandomAccessFile> f1;
+  ASSERT_OK(cache_->OpenExistingFile(kFile1, &f1));
+  uint64_t size;
+  ASSERT_OK(f1->Size(&size));
+  // Opening the second file evicts the first.
+  shared_ptr<RandomAccessFile> f2;
+  ASSERT_OK(cache_->OpenExistingFile(kFile2, &f2));
+
+  const auto total_count = [&](const HistogramPrototype& proto) {
+    return entity->FindOrCreateHistogram(&proto)->TotalCount();
+  };
+  ASSERT_EQ(1, total_count(METRIC_file_cache_hit_latency));
+  ASSERT_EQ(2, total_count(METRIC_file_cache_open_latency));
+  ASSERT_EQ(1, total_count(METRIC_file_cache_evict_latency));
+}
+
 } // namespace kudu
@@ -20,6 +20,7 @@
 #include <atomic>
 #include <cstdint>
 #include <cstring>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <ostream>
@@ -42,6 +43,7 @@
 #include "kudu/util/file_cache_metrics.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/once.h"
 #include "kudu/util/slice.h"
@@ -71,14 +73,20 @@ FileType* CacheValueToFileType(Slice s) {
 template <class FileType>
 class EvictionCallback : public Cache::EvictionCallback {
  public:
-  EvictionCallback() {}
+  // 'evict_latency' may be null.
+  explicit EvictionCallback(scoped_refptr<Histogram> evict_latency)
+      : evict_latency_(std::move(evict_latency)) {
+  }
 
   void EvictedEntry(Slice key, Slice value) override {
     VLOG(2) << "Evicted fd belonging to " << key.ToString();
+    ScopedLatencyMetric latency(evict_latency_.get());
     delete CacheValueToFileType<FileType>(value);
   }
 
  private:
+  const scoped_refptr<Histogram> evict_latency_;
+
   DISALLOW_COPY_AND_ASSIGN(EvictionCallback);
 };
 
@@ -101,9 +109,9 @@ class BaseDescriptor {
   ~BaseDescriptor() {
     VLOG(2) << "Out of scope descriptor with file name: " << filename();
 
-    // The (now expired) weak_ptr remains in 'descriptors_', to be removed by
+    // The (now expired) weak_ptr remains in the descriptor map, to be removed by
     // the next call to RunDescriptorExpiry(). Removing it here would risk a
-    // deadlock on recursive acquisition of 'lock_'.
+    // deadlock on recursive acquisition of the lock of its shard.
 
     if (deleted()) {
       cache()->Erase(filename());
@@ -138,9 +146,18 @@ class BaseDescriptor {
   // Returns a handle to the looked up entry. The handle may or may not contain
   // an open file, depending on whether the cache hit or missed.
   ScopedOpenedDescriptor<FileType> LookupFromCache() const {
-    return ScopedOpenedDescriptor<FileType>(this, Cache::UniqueHandle(
+    Histogram* hit_latency = file_cache_->hit_latency_.get();
+    MonoTime start;
+    if (hit_latency) {
+      start = MonoTime::Now();
+    }
+    ScopedOpenedDescriptor<FileType> found(this, Cache::UniqueHandle(
         cache()->Lookup(filename(), Cache::EXPECT_IN_CACHE),
         Cache::HandleDeleter(cache())));
+    if (hit_latency && found.opened()) {
+      hit_latency->Increment((MonoTime::Now() - start).ToMicroseconds());
+    }
+    return found;
   }
 
   // Mark this descriptor as to-be-deleted later.
@@ -164,6 +181,9 @@ class BaseDescriptor {
 
   Cache* cache() const { return file_cache_->cache_.get(); }
 
+  // May be null.
+  Histogram* open_latency() const { return file_cache_->open_latency_.get(); }
+
   Env* env() const { return file_cache_->env_; }
 
   const string& filename() const { return file_name_; }
@@ -246,6 +266,25 @@ class Descriptor<RWFile> : public RWFile {
     return opened.file()->ReadV(offset, results);
   }
 
+  Status Readahead(uint64_t offset, size_t length) const override {
+    ScopedOpenedDescriptor<RWFile> opened(&base_);
+    RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
+    return opened.file()->Readahead(offset, length);
+  }
+
+  Status DropCache(uint64_t offset, size_t length) const override {
+    ScopedOpenedDescriptor<RWFile> opened(&base_);
+    RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
+    return opened.file()->DropCache(offset, length);
+  }
+
+  Status MapForRead(uint64_t offset, size_t length,
+                    unique_ptr<MappedRegion>* region) const override {
+    ScopedOpenedDescriptor<RWFile> opened(&base_);
+    RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
+    return opened.file()->MapForRead(offset, length, region);
+  }
+
   Status Write(uint64_t offset, const Slice& data) override {
     ScopedOpenedDescriptor<RWFile> opened(&base_);
     RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
@@ -335,7 +374,10 @@ class Descriptor<RWFile> : public RWFile {
     RWFileOptions opts;
     opts.mode = Env::OPEN_EXISTING;
     unique_ptr<RWFile> f;
-    RETURN_NOT_OK(base_.env()->NewRWFile(opts, base_.filename(), &f));
+    {
+      ScopedLatencyMetric latency(base_.open_latency());
+      RETURN_NOT_OK(base_.env()->NewRWFile(opts, base_.filename(), &f));
+    }
 
     // The cache will take ownership of the newly opened file.
     ScopedOpenedDescriptor<RWFile> opened(base_.InsertIntoCache(f.release()));
@@ -373,6 +415,19 @@ class Descriptor<RandomAccessFile> : public RandomAccessFile {
     return opened.file()->ReadV(offset, results);
   }
 
+  Status Readahead(uint64_t offset, size_t length) const override {
+    ScopedOpenedDescriptor<RandomAccessFile> opened(&base_);
+    RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
+    return opened.file()->Readahead(offset, length);
+  }
+
+  Status MapForRead(uint64_t offset, size_t length,
+                    unique_ptr<MappedRegion>* region) const override {
+    ScopedOpenedDescriptor<RandomAccessFile> opened(&base_);
+    RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
+    return opened.file()->MapForRead(offset, length, region);
+  }
+
   Status Size(uint64_t *size) const override {
     ScopedOpenedDescriptor<RandomAccessFile> opened(&base_);
     RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
@@ -432,7 +487,10 @@ class Descriptor<RandomAccessFile> : public RandomAccessFile {
 
     // The file was evicted, reopen it.
     unique_ptr<RandomAccessFile> f;
-    RETURN_NOT_OK(base_.env()->NewRandomAccessFile(base_.filename(), &f));
+    {
+      ScopedLatencyMetric latency(base_.open_latency());
+      RETURN_NOT_OK(base_.env()->NewRandomAccessFile(base_.filename(), &f));
+    }
 
     // The cache will take ownership of the newly opened file.
     ScopedOpenedDescriptor<RandomAccessFile> opened(
@@ -458,13 +516,17 @@ FileCache<FileType>::FileCache(const string& cache_name,
                                const scoped_refptr<MetricEntity>& entity)
     : env_(env),
       cache_name_(cache_name),
-      eviction_cb_(new EvictionCallback<FileType>()),
       cache_(NewCache(max_open_files, cache_name)),
       running_(1) {
+  scoped_refptr<Histogram> evict_latency;
   if (entity) {
     unique_ptr<FileCacheMetrics> metrics(new FileCacheMetrics(entity));
+    hit_latency_ = metrics->hit_latency;
+    open_latency_ = metrics->open_latency;
+    evict_latency = metrics->evict_latency;
     cache_->SetMetrics(std::move(metrics));
   }
+  eviction_cb_.reset(new EvictionCallback<FileType>(std::move(evict_latency)));
   LOG(INFO) << Substitute("Constructed file cache $0 with capacity $1",
                           cache_name, max_open_files);
 }
@@ -487,18 +549,19 @@ Status FileCache<FileType>::Init() {
 template <class FileType>
 Status FileCache<FileType>::OpenExistingFile(const string& file_name,
                                              shared_ptr<FileType>* file) {
+  DescriptorShard* shard = GetShard(file_name);
   shared_ptr<internal::Descriptor<FileType>> desc;
   {
-    // Find an existing descriptor, or create one if none exists.
-    std::lock_guard<simple_spinlock> l(lock_);
-    RETURN_NOT_OK(FindDescriptorUnlocked(file_name, &desc));
-    if (desc) {
-      VLOG(2) << "Found existing descriptor: " << desc->filename();
-    } else {
-      desc = std::make_shared<internal::Descriptor<FileType>>(this, file_name);
-      InsertOrDie(&descriptors_, file_name, desc);
-      VLOG(2) << "Created new descriptor: " << desc->filename();
-    }
+    // Look for an existing descriptor, without excluding concurrent lookups.
+    shared_lock<rw_spinlock> l(shard->lock);
+    RETURN_NOT_OK(LookupDescriptorUnlocked(*shard, file_name, &desc));
+  }
+  if (desc) {
+    VLOG(2) << "Found existing descriptor: " << desc->filename();
+  } else {
+    // Create one if none exists.
+    std::lock_guard<rw_spinlock> l(shard->lock);
+    RETURN_NOT_OK(FindOrCreateDescriptorUnlocked(shard, file_name, &desc));
   }
 
   // Check that the underlying file can be opened (no-op for found
@@ -508,12 +571,56 @@ Status FileCache<FileType>::OpenExistingFile(const string& file_name,
   return Status::OK();
 }
 
+template <class FileType>
+Status FileCache<FileType>::OpenExistingFiles(const vector<string>& file_names,
+                                              vector<shared_ptr<FileType>>* files) {
+  // Group the files by shard.
+  vector<vector<size_t>> indexes_by_shard(kNumDescriptorShards);
+  for (size_t i = 0; i < file_names.size(); i++) {
+    indexes_by_shard[GetShard(file_names[i]) - descriptor_shards_].push_back(i);
+  }
+
+  vector<shared_ptr<internal::Descriptor<FileType>>> descs(file_names.size());
+  vector<size_t> missing;
+  for (int s = 0; s < kNumDescriptorShards; s++) {
+    const vector<size_t>& indexes = indexes_by_shard[s];
+    if (indexes.empty()) {
+      continue;
+    }
+    DescriptorShard* shard = &descriptor_shards_[s];
+    missing.clear();
+    {
+      shared_lock<rw_spinlock> l(shard->lock);
+      for (size_t i : indexes) {
+        RETURN_NOT_OK(LookupDescriptorUnlocked(*shard, file_names[i], &descs[i]));
+        if (!descs[i]) {
+          missing.push_back(i);
+        }
+      }
+    }
+    if (!missing.empty()) {
+      std::lock_guard<rw_spinlock> l(shard->lock);
+      for (size_t i : missing) {
+        RETURN_NOT_OK(FindOrCreateDescriptorUnlocked(shard, file_names[i], &descs[i]));
+      }
+    }
+  }
+
+  // Check that the underlying files can be opened. Done outside the locks.
+  for (const auto& desc : descs) {
+    RETURN_NOT_OK(desc->Init());
+  }
+  files->assign(descs.begin(), descs.end());
+  return Status::OK();
+}
+
 template <class FileType>
 Status FileCache<FileType>::DeleteFile(const string& file_name) {
   {
-    std::lock_guard<simple_spinlock> l(lock_);
+    DescriptorShard* shard = GetShard(file_name);
+    std::lock_guard<rw_spinlock> l(shard->lock);
     shared_ptr<internal::Descriptor<FileType>> desc;
-    RETURN_NOT_OK(FindDescriptorUnlocked(file_name, &desc));
+    RETURN_NOT_OK(FindDescriptorUnlocked(shard, file_name, &desc));
 
     if (desc) {
       VLOG(2) << "Marking file for deletion: " << file_name;
@@ -536,17 +643,18 @@ void FileCache<FileType>::Invalidate(const string& file_name) {
   //
   // This ensures that any concurrent OpenExistingFile() during this method wil
   // see the invalidation and issue a CHECK failure.
+  DescriptorShard* shard = GetShard(file_name);
   shared_ptr<internal::Descriptor<FileType>> desc;
   {
     // Find an existing descriptor, or create one if none exists.
-    std::lock_guard<simple_spinlock> l(lock_);
-    auto it = descriptors_.find(file_name);
-    if (it != descriptors_.end()) {
+    std::lock_guard<rw_spinlock> l(shard->lock);
+    auto it = shard->descriptors.find(file_name);
+    if (it != shard->descriptors.end()) {
       desc = it->second.lock();
     }
     if (!desc) {
       desc = std::make_shared<internal::Descriptor<FileType>>(this, file_name);
-      descriptors_.emplace(file_name, desc);
+      shard->descriptors[file_name] = desc;
     }
 
     desc->base_.MarkInvalidated();
@@ -561,55 +669,91 @@ void FileCache<FileType>::Invalidate(const string& file_name) {
   // the duration of this method, and no other methods erase strong
   // references from the map.
   {
-    std::lock_guard<simple_spinlock> l(lock_);
-    CHECK_EQ(1, descriptors_.erase(file_name));
+    std::lock_guard<rw_spinlock> l(shard->lock);
+    CHECK_EQ(1, shard->descriptors.erase(file_name));
   }
 }
 
 template <class FileType>
 int FileCache<FileType>::NumDescriptorsForTests() const {
-  std::lock_guard<simple_spinlock> l(lock_);
-  return descriptors_.size();
+  int num_descriptors = 0;
+  for (const auto& shard : descriptor_shards_) {
+    shared_lock<rw_spinlock> l(shard.lock);
+    num_descriptors += shard.descriptors.size();
+  }
+  return num_descriptors;
 }
 
 template <class FileType>
 string FileCache<FileType>::ToDebugString() const {
-  std::lock_guard<simple_spinlock> l(lock_);
   string ret;
-  for (const auto& e : descriptors_) {
-    bool strong = false;
-    bool deleted = false;
-    bool opened = false;
-    shared_ptr<internal::Descriptor<FileType>> desc = e.second.lock();
-    if (desc) {
-      strong = true;
-      if (desc->base_.deleted()) {
-        deleted = true;
+  for (const auto& shard : descriptor_shards_) {
+    shared_lock<rw_spinlock> l(shard.lock);
+    for (const auto& e : shard.descriptors) {
+      bool strong = false;
+      bool deleted = false;
+      bool opened = false;
+      shared_ptr<internal::Descriptor<FileType>> desc = e.second.lock();
+      if (desc) {
+        strong = true;
+        if (desc->base_.deleted()) {
+          deleted = true;
+        }
+        internal::ScopedOpenedDescriptor<FileType> o(
+            desc->base_.LookupFromCache());
+        if (o.opened()) {
+          opened = true;
+        }
       }
-      internal::ScopedOpenedDescriptor<FileType> o(
-          desc->base_.LookupFromCache());
-      if (o.opened()) {
-        opened = true;
+      if (strong) {
+        ret += Substitute("$0 (S$1$2)\n", e.first,
+                          deleted ? "D" : "", opened ? "O" : "");
+      } else {
+        ret += Substitute("$0\n", e.first);
       }
     }
-    if (strong) {
-      ret += Substitute("$0 (S$1$2)\n", e.first,
-                        deleted ? "D" : "", opened ? "O" : "");
-    } else {
-      ret += Substitute("$0\n", e.first);
-    }
   }
   return ret;
 }
 
+template <class FileType>
+typename FileCache<FileType>::DescriptorShard* FileCache<FileType>::GetShard(
+    const string& file_name) {
+  return &descriptor_shards_[std::hash<string>()(file_name) % kNumDescriptorShards];
+}
+
+template <class FileType>
+Status FileCache<FileType>::LookupDescriptorUnlocked(
+    const DescriptorShard& shard,
+    const string& file_name,
+    shared_ptr<internal::Descriptor<FileType>>* file) {
+  DCHECK(shard.lock.is_locked());
+
+  const auto* weak_desc = FindOrNull(shard.descriptors, file_name);
+  if (weak_desc) {
+    shared_ptr<internal::Descriptor<FileType>> desc = weak_desc->lock();
+    if (desc) {
+      CHECK(!desc->base_.invalidated());
+      if (desc->base_.deleted()) {
+        return Status::NotFound("File already marked for deletion", file_name);
+      }
+
+      // Descriptor is still valid, return it.
+      *file = std::move(desc);
+    }
+  }
+  return Status::OK();
+}
+
 template <class FileType>
 Status FileCache<FileType>::FindDescriptorUnlocked(
+    DescriptorShard* shard,
     const string& file_name,
     shared_ptr<internal::Descriptor<FileType>>* file) {
-  DCHECK(lock_.is_locked());
+  DCHECK(shard->lock.is_write_locked());
 
-  auto it = descriptors_.find(file_name);
-  if (it != descriptors_.end()) {
+  auto it = shard->descriptors.find(file_name);
+  if (it != shard->descriptors.end()) {
     // Found the descriptor. Has it expired?
     shared_ptr<internal::Descriptor<FileType>> desc = it->second.lock();
     if (desc) {
@@ -625,7 +769,23 @@ Status FileCache<FileType>::FindDescriptorUnlocked(
       return Status::OK();
     }
     // Descriptor has expired; erase it and pretend we found nothing.
-    descriptors_.erase(it);
+    shard->descriptors.erase(it);
+  }
+  return Status::OK();
+}
+
+template <class FileType>
+Status FileCache<FileType>::FindOrCreateDescriptorUnlocked(
+    DescriptorShard* shard,
+    const string& file_name,
+    shared_ptr<internal::Descriptor<FileType>>* file) {
+  RETURN_NOT_OK(FindDescriptorUnlocked(shard, file_name, file));
+  if (*file) {
+    VLOG(2) << "Found existing descriptor: " << (*file)->filename();
+  } else {
+    *file = std::make_shared<internal::Descriptor<FileType>>(this, file_name);
+    InsertOrDie(&shard->descriptors, file_name, *file);
+    VLOG(2) << "Created new descriptor: " << (*file)->filename();
   }
   return Status::OK();
 }
@@ -634,12 +794,14 @@ template <class FileType>
 void FileCache<FileType>::RunDescriptorExpiry() {
   while (!running_.WaitFor(MonoDelta::FromMilliseconds(
       FLAGS_file_cache_expiry_period_ms))) {
-    std::lock_guard<simple_spinlock> l(lock_);
-    for (auto it = descriptors_.begin(); it != descriptors_.end();) {
-      if (it->second.expired()) {
-        it = descriptors_.erase(it);
-      } else {
-        it++;
+    for (auto& shard : descriptor_shards_) {
+      std::lock_guard<rw_spinlock> l(shard.lock);
+      for (auto it = shard.descriptors.begin(); it != shard.descriptors.end();) {
+        if (it->second.expired()) {
+          it = shard.descriptors.erase(it);
+        } else {
+          it++;
+        }
       }
     }
   }
@@ -20,6 +20,7 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <gtest/gtest_prod.h>
 
@@ -44,6 +45,7 @@ class Descriptor;
 
 } // namespace internal
 
+class Histogram;
 class MetricEntity;
 class Thread;
 
@@ -91,6 +93,11 @@ class Thread;
 // descriptor are dropped is the file actually deleted. If there is no open
 // descriptor, the file is deleted immediately.
 //
+// The descriptor map is sharded by file name. Opening a file whose descriptor
+// is still alive, by far the most common case, only takes the lock of its
+// shard in shared mode, so concurrent opens never wait on each other unless
+// descriptors are being created or removed in the same shard.
+//
 // Every public method in the file cache is thread safe.
 template <class FileType>
 class FileCache {
@@ -123,6 +130,15 @@ class FileCache {
   Status OpenExistingFile(const std::string& file_name,
                           std::shared_ptr<FileType>* file);
 
+  // Opens several existing files by name through the cache, as if calling
+  // OpenExistingFile() on each of them, but locking each shard of the
+  // descriptor map at most twice for the whole batch.
+  //
+  // On success, 'files' holds the descriptors in the order of 'file_names'.
+  // On failure, 'files' is left unmodified.
+  Status OpenExistingFiles(const std::vector<std::string>& file_names,
+                           std::vector<std::shared_ptr<FileType>>* files);
+
   // Deletes a file by name through the cache.
   //
   // If there is an outstanding descriptor for the file, the deletion will be
@@ -167,10 +183,44 @@ class FileCache {
   template<class FileType2>
   FRIEND_TEST(FileCacheTest, TestBasicOperations);
 
-  // Looks up a descriptor by file name.
+  typedef std::unordered_map<std::string,
+                             std::weak_ptr<internal::Descriptor<FileType>>> DescriptorMap;
+
+  // A shard of the descriptor map.
+  struct DescriptorShard {
+    // Protects 'descriptors'. Held in shared mode to look up descriptors, and
+    // exclusively to add or remove them.
+    mutable rw_spinlock lock;
+
+    // Maps filenames to descriptors.
+    DescriptorMap descriptors;
+  };
+
+  static constexpr int kNumDescriptorShards = 16;
+
+  DescriptorShard* GetShard(const std::string& file_name);
+
+  // Looks up a live descriptor by file name, leaving 'file' unset if there is
+  // none.
   //
-  // Must be called with 'lock_' held.
-  Status FindDescriptorUnlocked(
+  // Must be called with the shard's lock held in either mode.
+  static Status LookupDescriptorUnlocked(
+      const DescriptorShard& shard,
+      const std::string& file_name,
+      std::shared_ptr<internal::Descriptor<FileType>>* file);
+
+  // Looks up a descriptor by file name, removing it from the shard if it
+  // expired.
+  //
+  // Must be called with the shard's lock held exclusively.
+  static Status FindDescriptorUnlocked(
+      DescriptorShard* shard,
+      const std::string& file_name,
+      std::shared_ptr<internal::Descriptor<FileType>>* file);
+
+  // Like FindDescriptorUnlocked(), but creates a descriptor if none exists.
+  Status FindOrCreateDescriptorUnlocked(
+      DescriptorShard* shard,
       const std::string& file_name,
       std::shared_ptr<internal::Descriptor<FileType>>* file);
 
@@ -190,12 +240,13 @@ class FileCache {
   // Underlying cache instance. Caches opened files.
   std::unique_ptr<Cache> cache_;
 
-  // Protects the descriptor map.
-  mutable simple_spinlock lock_;
+  // Latencies of the lookups of open files, and of the opening of files which
+  // weren't. May be null if the cache has no metrics.
+  scoped_refptr<Histogram> hit_latency_;
+  scoped_refptr<Histogram> open_latency_;
 
-  // Maps filenames to descriptors.
-  std::unordered_map<std::string,
-                     std::weak_ptr<internal::Descriptor<FileType>>> descriptors_;
+  // The descriptor map, sharded by file name.
+  DescriptorShard descriptor_shards_[kNumDescriptorShards];
 
   // Calls RunDescriptorExpiry() in a loop until 'running_' isn't set.
   scoped_refptr<Thread> descriptor_expiry_thread_;
@@ -46,6 +46,19 @@ METRIC_DEFINE_counter(server, file_cache_hits_caching,
                       "that found one. Use this number instead of cache_hits "
                       "when trying to determine how efficient the cache is");
 
+METRIC_DEFINE_histogram(server, file_cache_hit_latency, "File Cache Hit Latency",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Time spent looking up file descriptors that were found in the cache",
+                        60000000LU, 2);
+METRIC_DEFINE_histogram(server, file_cache_open_latency, "File Cache Open Latency",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Time spent opening files whose descriptors weren't in the cache",
+                        60000000LU, 2);
+METRIC_DEFINE_histogram(server, file_cache_evict_latency, "File Cache Eviction Latency",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Time spent closing file descriptors evicted from the cache",
+                        60000000LU, 2);
+
 METRIC_DEFINE_gauge_uint64(server, file_cache_usage, "File Cache Usage",
                            kudu::MetricUnit::kEntries,
                            "Number of entries in the file cache");
@@ -63,6 +76,9 @@ FileCacheMetrics::FileCacheMetrics(const scoped_refptr<MetricEntity>& entity) {
   MINIT(cache_misses, file_cache_misses);
   MINIT(cache_misses_caching, file_cache_misses_caching);
   GINIT(cache_usage, file_cache_usage);
+  MINIT(hit_latency, file_cache_hit_latency);
+  MINIT(open_latency, file_cache_open_latency);
+  MINIT(evict_latency, file_cache_evict_latency);
 }
 #undef MINIT
 #undef GINIT
@@ -26,6 +26,10 @@ class MetricEntity;
 
 struct FileCacheMetrics : public CacheMetrics {
   explicit FileCacheMetrics(const scoped_refptr<MetricEntity>& entity);
+
+  scoped_refptr<Histogram> hit_latency;
+  scoped_refptr<Histogram> open_latency;
+  scoped_refptr<Histogram> evict_latency;
 };
 
 } // namespace kudu
@@ -0,0 +1,76 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/frequency_sketch.h"
+
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+#include "kudu/util/random.h"
+#include "kudu/util/test_util.h"
+
+namespace kudu {
+
+class FrequencySketchTest : public KuduTest {};
+
+TEST_F(FrequencySketchTest, TestEstimates) {
+  FrequencySketch sketch(1024);
+  ASSERT_EQ(1024, sketch.width());
+  ASSERT_EQ(0, sketch.Estimate(1));
+
+  for (int i = 0; i < 5; i++) {
+    sketch.Increment(1);
+  }
+  ASSERT_EQ(5, sketch.Estimate(1));
+  ASSERT_EQ(0, sketch.Estimate(2));
+
+  // The counters saturate.
+  for (int i = 0; i < 2 * FrequencySketch::kMaxCount; i++) {
+    sketch.Increment(1);
+  }
+  ASSERT_EQ(FrequencySketch::kMaxCount, sketch.Estimate(1));
+}
+
+// Verify that the estimates of frequent items stand out among many
+// infrequent ones, and that they decay once the items are no longer seen.
+TEST_F(FrequencySketchTest, TestAging) {
+  constexpr int kWidth = 1024;
+  FrequencySketch sketch(kWidth);
+  Random r(SeedRandom());
+
+  constexpr uint32_t kHot = 12345;
+  for (int i = 0; i < kWidth; i++) {
+    sketch.Increment(r.Next());
+    if (i % 64 == 0) {
+      sketch.Increment(kHot);
+    }
+  }
+  ASSERT_EQ(FrequencySketch::kMaxCount, sketch.Estimate(kHot));
+  for (int i = 0; i < 100; i++) {
+    ASSERT_LT(sketch.Estimate(r.Next()), FrequencySketch::kMaxCount);
+  }
+
+  // Once the number of increments reaches ten times the width, the counters
+  // are halved.
+  for (int i = kWidth + kWidth / 64; i < 10 * kWidth; i++) {
+    sketch.Increment(r.Next());
+  }
+  ASSERT_LE(sketch.Estimate(kHot), FrequencySketch::kMaxCount / 2);
+}
+
+} // namespace kudu
@@ -0,0 +1,88 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/frequency_sketch.h"
+
+#include <algorithm>
+
+#include "kudu/gutil/bits.h"
+
+namespace kudu {
+
+namespace {
+
+// Odd multipliers deriving an independent index for each row from the
+// item's hash.
+constexpr uint64_t kSeeds[] = {
+  0xc3a5c85c97cb3127ULL,
+  0xb492b66fbe98f273ULL,
+  0x9ae16a3b2f90404fULL,
+  0xcbf29ce484222325ULL,
+};
+
+} // anonymous namespace
+
+FrequencySketch::FrequencySketch(size_t num_items)
+    : width_bits_(Bits::Log2Ceiling64(std::max<size_t>(num_items, 16))),
+      width_(1ULL << width_bits_),
+      counters_(new std::atomic<uint8_t>[kDepth * width_]),
+      num_increments_(0) {
+  static_assert(arraysize(kSeeds) == kDepth, "one seed per row");
+  for (size_t i = 0; i < kDepth * width_; i++) {
+    counters_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+size_t FrequencySketch::Index(int row, uint32_t hash) const {
+  // The high bits of the product depend on all bits of the hash. That
+  // matters since the bits used to pick the cache shard are the same for all
+  // the items of a shard's sketch.
+  const uint64_t h = (static_cast<uint64_t>(hash) + 1) * kSeeds[row];
+  return row * width_ + (h >> (64 - width_bits_));
+}
+
+void FrequencySketch::Increment(uint32_t hash) {
+  for (int row = 0; row < kDepth; row++) {
+    std::atomic<uint8_t>& counter = counters_[Index(row, hash)];
+    const uint8_t count = counter.load(std::memory_order_relaxed);
+    if (count < kMaxCount) {
+      counter.store(count + 1, std::memory_order_relaxed);
+    }
+  }
+  if (num_increments_.fetch_add(1, std::memory_order_relaxed) + 1 == 10 * width_) {
+    Age();
+  }
+}
+
+int FrequencySketch::Estimate(uint32_t hash) const {
+  int estimate = kMaxCount;
+  for (int row = 0; row < kDepth; row++) {
+    estimate = std::min<int>(estimate,
+                             counters_[Index(row, hash)].load(std::memory_order_relaxed));
+  }
+  return estimate;
+}
+
+void FrequencySketch::Age() {
+  for (size_t i = 0; i < kDepth * width_; i++) {
+    counters_[i].store(counters_[i].load(std::memory_order_relaxed) / 2,
+                       std::memory_order_relaxed);
+  }
+  num_increments_.store(0, std::memory_order_relaxed);
+}
+
+} // namespace kudu
@@ -0,0 +1,80 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "kudu/gutil/macros.h"
+
+namespace kudu {
+
+// A count-min sketch estimating how often items were seen recently, as used
+// by the TinyLFU cache admission policy.
+//
+// Items are identified by a 32-bit hash. Each item maps to one small
+// saturating counter in each of several rows, and the estimate of its
+// frequency is the minimum of its counters. So that the estimates reflect
+// recent history, all counters are halved once the number of increments
+// reaches ten times the width of the sketch.
+//
+// Increment() and Estimate() may be called concurrently. Concurrent
+// increments of the same counter may be lost, which only makes the
+// estimates slightly less accurate.
+class FrequencySketch {
+ public:
+  // The maximum value of a counter.
+  static constexpr int kMaxCount = 15;
+
+  // Creates a sketch meant to tell apart the frequencies of about
+  // 'num_items' distinct items.
+  explicit FrequencySketch(size_t num_items);
+
+  // Records an occurrence of the item with the given hash.
+  void Increment(uint32_t hash);
+
+  // Returns the estimated number of recent occurrences of the item with the
+  // given hash, at most kMaxCount.
+  int Estimate(uint32_t hash) const;
+
+  // The number of counters in each row.
+  size_t width() const {
+    return width_;
+  }
+
+ private:
+  static constexpr int kDepth = 4;
+
+  // Returns the index of the counter of the given row for 'hash'.
+  size_t Index(int row, uint32_t hash) const;
+
+  // Halves all counters.
+  void Age();
+
+  const int width_bits_;
+  const size_t width_;
+  const std::unique_ptr<std::atomic<uint8_t>[]> counters_;
+
+  // The number of increments since the counters were last halved.
+  std::atomic<size_t> num_increments_;
+
+  DISALLOW_COPY_AND_ASSIGN(FrequencySketch);
+};
+
+} // namespace kudu
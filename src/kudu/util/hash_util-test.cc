@@ -16,10 +16,18 @@
 // under the License.
 
 #include <cstdint>
+#include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include "kudu/util/hash_util.h"
+#include "kudu/util/random.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/test_util.h"
+
+using std::string;
+using std::vector;
 
 namespace kudu {
 
@@ -39,4 +47,30 @@ TEST(HashUtilTest, TestMurmur2Hash64) {
   ASSERT_EQ(3575930248840144026, hash);
 }
 
+// Verify that the batched hashes are the same as the ones computed one at a
+// time, whatever the lengths of the inputs of a batch.
+TEST(HashUtilTest, TestMurmur2Hash64Batch) {
+  Random r(SeedRandom());
+  for (int n = 0; n < 20; n++) {
+    vector<string> inputs;
+    vector<Slice> slices;
+    for (int i = 0; i < n; i++) {
+      string input;
+      const int len = r.Uniform(40);
+      for (int j = 0; j < len; j++) {
+        input.push_back(static_cast<char>(r.Uniform(256)));
+      }
+      inputs.emplace_back(std::move(input));
+    }
+    for (const string& input : inputs) {
+      slices.emplace_back(input);
+    }
+    vector<uint64_t> hashes(n);
+    HashUtil::MurmurHash2_64Batch(slices.data(), n, 42, hashes.data());
+    for (int i = 0; i < n; i++) {
+      ASSERT_EQ(HashUtil::MurmurHash2_64(inputs[i].data(), inputs[i].size(), 42), hashes[i]);
+    }
+  }
+}
+
 } // namespace kudu
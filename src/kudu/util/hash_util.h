@@ -20,7 +20,11 @@
 
 #include <stdint.h>
 
+#include <algorithm>
+#include <cstddef>
+
 #include "kudu/gutil/port.h"
+#include "kudu/util/slice.h"
 
 namespace kudu {
 
@@ -35,28 +39,79 @@ class HashUtil {
   ATTRIBUTE_NO_SANITIZE_INTEGER
   static uint64_t MurmurHash2_64(const void* input, int len, uint64_t seed) {
     uint64_t h = seed ^ (len * MURMUR_PRIME);
+    return MurmurHash2_64Finish(h, reinterpret_cast<const uint8_t*>(input), len);
+  }
+
+  /// Computes the Murmur2 hashes of a batch of inputs: sets hashes[i] to
+  /// MurmurHash2_64(inputs[i].data(), inputs[i].size(), seed) for each of
+  /// the 'n' inputs.
+  ///
+  /// The inputs are hashed kMurmurLanes at a time, with the independent
+  /// multiplication chains of their common words interleaved so that they
+  /// overlap in the pipeline instead of each one waiting on the previous one.
+  /// This is faster than hashing the inputs one after the other, for the
+  /// encoded keys of a batch of rows for example.
+  ATTRIBUTE_NO_SANITIZE_INTEGER
+  static void MurmurHash2_64Batch(const Slice* inputs, int n, uint64_t seed,
+                                  uint64_t* hashes) {
+    int i = 0;
+    for (; i + kMurmurLanes <= n; i += kMurmurLanes) {
+      uint64_t h[kMurmurLanes];
+      const uint8_t* data[kMurmurLanes];
+      size_t common_words = inputs[i].size() / sizeof(uint64_t);
+      for (int l = 0; l < kMurmurLanes; l++) {
+        const Slice& input = inputs[i + l];
+        h[l] = seed ^ (input.size() * MURMUR_PRIME);
+        data[l] = input.data();
+        common_words = std::min(common_words, input.size() / sizeof(uint64_t));
+      }
+      for (size_t w = 0; w < common_words; w++) {
+        for (int l = 0; l < kMurmurLanes; l++) {
+          h[l] = MurmurHash2_64Mix(h[l], UNALIGNED_LOAD64(data[l] + w * sizeof(uint64_t)));
+        }
+      }
+      const size_t done = common_words * sizeof(uint64_t);
+      for (int l = 0; l < kMurmurLanes; l++) {
+        hashes[i + l] = MurmurHash2_64Finish(h[l], data[l] + done, inputs[i + l].size() - done);
+      }
+    }
+    for (; i < n; i++) {
+      hashes[i] = MurmurHash2_64(inputs[i].data(), inputs[i].size(), seed);
+    }
+  }
 
-    const uint64_t* data = reinterpret_cast<const uint64_t*>(input);
-    const uint64_t* end = data + (len / sizeof(uint64_t));
+ private:
+  static constexpr int kMurmurLanes = 4;
 
+  // Mixes the word 'k' of the input into the hash 'h'.
+  ATTRIBUTE_NO_SANITIZE_INTEGER
+  static uint64_t MurmurHash2_64Mix(uint64_t h, uint64_t k) {
+    k *= MURMUR_PRIME;
+    k ^= k >> MURMUR_R;
+    k *= MURMUR_PRIME;
+    h ^= k;
+    h *= MURMUR_PRIME;
+    return h;
+  }
+
+  // Mixes the remaining 'len' bytes of the input at 'data' into the hash 'h',
+  // and returns the final hash.
+  ATTRIBUTE_NO_SANITIZE_INTEGER
+  static uint64_t MurmurHash2_64Finish(uint64_t h, const uint8_t* data, size_t len) {
+    const uint8_t* end = data + (len & ~static_cast<size_t>(7));
     while (data != end) {
-      uint64_t k = *data++;
-      k *= MURMUR_PRIME;
-      k ^= k >> MURMUR_R;
-      k *= MURMUR_PRIME;
-      h ^= k;
-      h *= MURMUR_PRIME;
+      h = MurmurHash2_64Mix(h, UNALIGNED_LOAD64(data));
+      data += sizeof(uint64_t);
     }
 
-    const uint8_t* data2 = reinterpret_cast<const uint8_t*>(data);
     switch (len & 7) {
-      case 7: h ^= static_cast<uint64_t>(data2[6]) << 48;
-      case 6: h ^= static_cast<uint64_t>(data2[5]) << 40;
-      case 5: h ^= static_cast<uint64_t>(data2[4]) << 32;
-      case 4: h ^= static_cast<uint64_t>(data2[3]) << 24;
-      case 3: h ^= static_cast<uint64_t>(data2[2]) << 16;
-      case 2: h ^= static_cast<uint64_t>(data2[1]) << 8;
-      case 1: h ^= static_cast<uint64_t>(data2[0]);
+      case 7: h ^= static_cast<uint64_t>(data[6]) << 48;
+      case 6: h ^= static_cast<uint64_t>(data[5]) << 40;
+      case 5: h ^= static_cast<uint64_t>(data[4]) << 32;
+      case 4: h ^= static_cast<uint64_t>(data[3]) << 24;
+      case 3: h ^= static_cast<uint64_t>(data[2]) << 16;
+      case 2: h ^= static_cast<uint64_t>(data[1]) << 8;
+      case 1: h ^= static_cast<uint64_t>(data[0]);
               h *= MURMUR_PRIME;
     }
 
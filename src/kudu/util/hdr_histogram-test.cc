@@ -113,4 +113,27 @@ TEST_F(HdrHistogramTest, PercentileAndCopyTest) {
   ASSERT_EQ(hist.TotalSum(), copy.TotalSum());
 }
 
+TEST_F(HdrHistogramTest, MergeTest) {
+  uint64_t specified_max = 10000;
+  HdrHistogram hist(specified_max, kSigDigits);
+  hist.IncrementBy(10, 80);
+  hist.IncrementBy(1000, 5);
+  hist.IncrementBy(100000, 1);
+
+  // The values are split between the two histograms, the min in the merged
+  // one and the max in the empty one the other is merged into.
+  HdrHistogram other(specified_max, kSigDigits);
+  other.IncrementBy(100, 10);
+  other.IncrementBy(10000, 3);
+  other.IncrementBy(1000000, 1);
+  HdrHistogram merged(specified_max, kSigDigits);
+  merged.MergeFrom(other);
+  merged.MergeFrom(hist);
+  NO_FATALS(validate_percentiles(&merged, specified_max));
+
+  // Merging an empty histogram changes nothing.
+  merged.MergeFrom(HdrHistogram(specified_max, kSigDigits));
+  NO_FATALS(validate_percentiles(&merged, specified_max));
+}
+
 } // namespace kudu
@@ -97,6 +97,43 @@ HdrHistogram::HdrHistogram(const HdrHistogram& other)
   NoBarrier_Store(&total_count_, total_copied_count);
 }
 
+void HdrHistogram::MergeFrom(const HdrHistogram& other) {
+  DCHECK_EQ(highest_trackable_value_, other.highest_trackable_value_);
+  DCHECK_EQ(num_significant_digits_, other.num_significant_digits_);
+
+  // Same order as the copy constructor: the sum and min, the counts in order
+  // of ascending magnitude, and the max observed value last. The raw min and
+  // max are compared, since MinValue() and MaxValue() return 0 while the
+  // total count is.
+  NoBarrier_AtomicIncrement(&total_sum_, NoBarrier_Load(&other.total_sum_));
+  {
+    Atomic64 value = NoBarrier_Load(&other.min_value_);
+    Atomic64 min_val;
+    while (value < (min_val = NoBarrier_Load(&min_value_))) {
+      Atomic64 old_val = NoBarrier_CompareAndSwap(&min_value_, min_val, value);
+      if (old_val == min_val) break; // CAS success.
+    }
+  }
+  uint64_t total_merged_count = 0;
+  for (int i = 0; i < counts_array_length_; i++) {
+    uint64_t count = NoBarrier_Load(&other.counts_[i]);
+    if (count > 0) {
+      NoBarrier_AtomicIncrement(&counts_[i], count);
+      total_merged_count += count;
+    }
+  }
+  {
+    Atomic64 value = NoBarrier_Load(&other.max_value_);
+    Atomic64 max_val;
+    while (value > (max_val = NoBarrier_Load(&max_value_))) {
+      Atomic64 old_val = NoBarrier_CompareAndSwap(&max_value_, max_val, value);
+      if (old_val == max_val) break; // CAS success.
+    }
+  }
+  // The total must be consistent with the merged counts.
+  NoBarrier_AtomicIncrement(&total_count_, total_merged_count);
+}
+
 bool HdrHistogram::IsValidHighestTrackableValue(uint64_t highest_trackable_value) {
   return highest_trackable_value >= kMinHighestTrackableValue;
 }
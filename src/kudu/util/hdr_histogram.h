@@ -89,6 +89,12 @@ class HdrHistogram {
   void Increment(int64_t value);
   void IncrementBy(int64_t value, int64_t count);
 
+  // Add the data recorded in 'other', which must have the same highest
+  // trackable value and number of significant digits. Like the copy
+  // constructor, this is not a consistent snapshot of 'other' if it's
+  // concurrently updated.
+  void MergeFrom(const HdrHistogram& other);
+
   // Record new data, correcting for "coordinated omission".
   //
   // See https://groups.google.com/d/msg/mechanical-sympathy/icNZJejUHfE/BfDekfBEs_sJ
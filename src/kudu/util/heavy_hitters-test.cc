@@ -0,0 +1,104 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/heavy_hitters.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kudu/util/random.h"
+#include "kudu/util/test_util.h"
+
+using std::string;
+using std::to_string;
+using std::vector;
+
+namespace kudu {
+
+class HeavyHittersTest : public KuduTest {};
+
+TEST_F(HeavyHittersTest, TestExactCounts) {
+  HeavyHitters hh(4);
+  ASSERT_TRUE(hh.TopK(10).empty());
+
+  hh.Add("a", 3);
+  hh.Add("b");
+  hh.Add("a");
+  hh.Add("c", 2);
+  ASSERT_EQ(7, hh.total());
+
+  // While there are fewer items than counters, the counts are exact.
+  vector<HeavyHitters::Entry> top = hh.TopK(10);
+  ASSERT_EQ(3, top.size());
+  ASSERT_EQ("a", top[0].item);
+  ASSERT_EQ(4, top[0].count);
+  ASSERT_EQ(0, top[0].error);
+  ASSERT_EQ("c", top[1].item);
+  ASSERT_EQ(2, top[1].count);
+  ASSERT_EQ("b", top[2].item);
+  ASSERT_EQ(1, top[2].count);
+
+  top = hh.TopK(1);
+  ASSERT_EQ(1, top.size());
+  ASSERT_EQ("a", top[0].item);
+
+  // Halving the counts drops the items left with none.
+  hh.Decay();
+  ASSERT_EQ(3, hh.total());
+  top = hh.TopK(10);
+  ASSERT_EQ(2, top.size());
+  ASSERT_EQ(2, top[0].count);
+  ASSERT_EQ(1, top[1].count);
+}
+
+// Verify that the heavy items of a stream of many distinct items are found,
+// and that their counts are bounded.
+TEST_F(HeavyHittersTest, TestHeavyItems) {
+  constexpr int kCapacity = 64;
+  HeavyHitters hh(kCapacity);
+  Random r(SeedRandom());
+
+  constexpr int kNumAdds = 100000;
+  int64_t hot_counts[2] = { 0, 0 };
+  for (int i = 0; i < kNumAdds; i++) {
+    if (i % 10 == 0) {
+      hh.Add("hot0");
+      hot_counts[0]++;
+    } else if (i % 20 == 1) {
+      hh.Add("hot1");
+      hot_counts[1]++;
+    } else {
+      hh.Add(to_string(r.Next()));
+    }
+  }
+  ASSERT_EQ(kNumAdds, hh.total());
+
+  vector<HeavyHitters::Entry> top = hh.TopK(2);
+  ASSERT_EQ(2, top.size());
+  for (int i = 0; i < 2; i++) {
+    SCOPED_TRACE(i);
+    ASSERT_EQ("hot" + to_string(i), top[i].item);
+    ASSERT_GE(top[i].count, hot_counts[i]);
+    ASSERT_LE(top[i].count - top[i].error, hot_counts[i]);
+    ASSERT_LE(top[i].error, kNumAdds / kCapacity);
+  }
+}
+
+} // namespace kudu
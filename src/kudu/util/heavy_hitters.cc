@@ -0,0 +1,86 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/heavy_hitters.h"
+
+#include <glog/logging.h>
+
+#include "kudu/gutil/map-util.h"
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+
+HeavyHitters::HeavyHitters(int capacity)
+    : capacity_(capacity),
+      total_(0) {
+  CHECK_GT(capacity, 0);
+}
+
+void HeavyHitters::Add(const Slice& item, int64_t weight) {
+  DCHECK_GT(weight, 0);
+  total_ += weight;
+  string key = item.ToString();
+  Counter* counter = FindOrNull(counters_, key);
+  if (counter) {
+    by_count_.erase({ counter->count, key });
+    counter->count += weight;
+  } else if (counters_.size() < capacity_) {
+    counter = &counters_[key];
+    counter->count = weight;
+    counter->error = 0;
+  } else {
+    // Replace the lightest item, which may have been seen as many times as
+    // its count before it was replaced.
+    auto lightest = by_count_.begin();
+    const int64_t min_count = lightest->first;
+    counters_.erase(lightest->second);
+    by_count_.erase(lightest);
+    counter = &counters_[key];
+    counter->count = min_count + weight;
+    counter->error = min_count;
+  }
+  by_count_.emplace(counter->count, std::move(key));
+}
+
+void HeavyHitters::Decay() {
+  total_ /= 2;
+  by_count_.clear();
+  for (auto it = counters_.begin(); it != counters_.end();) {
+    Counter* counter = &it->second;
+    counter->count /= 2;
+    counter->error /= 2;
+    if (counter->count == 0) {
+      it = counters_.erase(it);
+      continue;
+    }
+    by_count_.emplace(counter->count, it->first);
+    ++it;
+  }
+}
+
+vector<HeavyHitters::Entry> HeavyHitters::TopK(int k) const {
+  vector<Entry> entries;
+  for (auto it = by_count_.rbegin(); it != by_count_.rend() && entries.size() < k; ++it) {
+    const Counter& counter = FindOrDie(counters_, it->second);
+    entries.push_back({ it->second, counter.count, counter.error });
+  }
+  return entries;
+}
+
+} // namespace kudu
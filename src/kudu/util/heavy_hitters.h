@@ -0,0 +1,91 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/slice.h"
+
+namespace kudu {
+
+// Finds the most frequent items of a stream with bounded memory, using the
+// Space-Saving algorithm (Metwally et al., "Efficient Computation of Frequent
+// and Top-k Elements in Data Streams", 2005).
+//
+// Up to 'capacity' items are counted. An item which isn't counted replaces
+// the item with the smallest count, and inherits that count as the bound of
+// the overestimation of its own count. Any item making up more than
+// 1/capacity of the total weight of the stream is guaranteed to be counted.
+//
+// This class is not thread-safe.
+class HeavyHitters {
+ public:
+  // An item and the estimate of its weight.
+  struct Entry {
+    std::string item;
+    // The estimated weight of the item, which is at most 'error' more than
+    // its actual weight.
+    int64_t count;
+    int64_t error;
+  };
+
+  explicit HeavyHitters(int capacity);
+
+  // Records an occurrence of 'item' with the given weight.
+  void Add(const Slice& item, int64_t weight = 1);
+
+  // Halves the counts of all the items and the total weight, so that the
+  // estimates favor the recent items.
+  void Decay();
+
+  // Returns up to 'k' of the counted items with their estimated weights,
+  // from the heaviest to the lightest.
+  std::vector<Entry> TopK(int k) const;
+
+  // The total weight of the items added, decayed along with the counts.
+  int64_t total() const {
+    return total_;
+  }
+
+  int capacity() const {
+    return capacity_;
+  }
+
+ private:
+  struct Counter {
+    int64_t count;
+    int64_t error;
+  };
+
+  // Orders the items by count, the lightest first.
+  typedef std::set<std::pair<int64_t, std::string>> CountIndex;
+
+  const int capacity_;
+  std::unordered_map<std::string, Counter> counters_;
+  CountIndex by_count_;
+  int64_t total_;
+
+  DISALLOW_COPY_AND_ASSIGN(HeavyHitters);
+};
+
+} // namespace kudu
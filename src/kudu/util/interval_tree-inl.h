@@ -100,14 +100,17 @@ void IntervalTree<Traits>::Partition(const IntervalVector &in,
   CHECK(!in.empty());
 
   // Pick a split point which is the median of all of the interval boundaries.
+  // Only the median is needed, so a selection is enough rather than a sort:
+  // this keeps building the tree O(n log n) instead of O(n log^2 n).
   std::vector<point_type> endpoints;
   endpoints.reserve(in.size() * 2);
   for (const interval_type &interval : in) {
     endpoints.push_back(Traits::get_left(interval));
     endpoints.push_back(Traits::get_right(interval));
   }
-  std::sort(endpoints.begin(), endpoints.end(), LessThan<Traits>);
-  *split_point = endpoints[endpoints.size() / 2];
+  auto median = endpoints.begin() + endpoints.size() / 2;
+  std::nth_element(endpoints.begin(), median, endpoints.end(), LessThan<Traits>);
+  *split_point = *median;
 
   // Partition into the groups based on the determined split point.
   for (const interval_type &interval : in) {
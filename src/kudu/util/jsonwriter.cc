@@ -47,20 +47,22 @@ using std::vector;
 
 namespace kudu {
 
-// Adapter to allow RapidJSON to write directly to a stringstream.
-// Since Squeasel exposes a stringstream as its interface, this is needed to avoid overcopying.
+// Adapter to allow RapidJSON to write directly to an ostream. The output is
+// buffered until it's flushed or until kFlushSize bytes are pending.
 class UTF8StringStreamBuffer {
  public:
   typedef typename rapidjson::UTF8<>::Ch Ch;
-  explicit UTF8StringStreamBuffer(std::ostringstream* out);
+  explicit UTF8StringStreamBuffer(std::ostream* out);
   ~UTF8StringStreamBuffer();
 
   void Put(Ch c);
   void Flush();
 
  private:
+  static constexpr size_t kFlushSize = 16 * 1024;
+
   faststring buf_;
-  std::ostringstream* out_;
+  std::ostream* out_;
 };
 
 // rapidjson doesn't provide any common interface between the PrettyWriter and
@@ -93,7 +95,7 @@ class JsonWriterIf {
 template<class T>
 class JsonWriterImpl : public JsonWriterIf {
  public:
-  explicit JsonWriterImpl(ostringstream* out);
+  explicit JsonWriterImpl(std::ostream* out);
 
   virtual void Null() OVERRIDE;
   virtual void Bool(bool b) OVERRIDE;
@@ -124,7 +126,7 @@ class JsonWriterImpl : public JsonWriterIf {
 typedef rapidjson::PrettyWriter<UTF8StringStreamBuffer> PrettyWriterClass;
 typedef rapidjson::Writer<UTF8StringStreamBuffer> CompactWriterClass;
 
-JsonWriter::JsonWriter(ostringstream* out, Mode m) {
+JsonWriter::JsonWriter(std::ostream* out, Mode m) {
   switch (m) {
     case PRETTY:
       impl_.reset(new JsonWriterImpl<PrettyWriterClass>(DCHECK_NOTNULL(out)));
@@ -292,7 +294,7 @@ string JsonWriter::ToJson(const Message& pb, Mode mode) {
 // UTF8StringStreamBuffer
 //
 
-UTF8StringStreamBuffer::UTF8StringStreamBuffer(std::ostringstream* out)
+UTF8StringStreamBuffer::UTF8StringStreamBuffer(std::ostream* out)
   : out_(DCHECK_NOTNULL(out)) {
 }
 UTF8StringStreamBuffer::~UTF8StringStreamBuffer() {
@@ -301,6 +303,9 @@ UTF8StringStreamBuffer::~UTF8StringStreamBuffer() {
 
 void UTF8StringStreamBuffer::Put(Ch c) {
   buf_.push_back(c);
+  if (PREDICT_FALSE(buf_.size() >= kFlushSize)) {
+    Flush();
+  }
 }
 
 void UTF8StringStreamBuffer::Flush() {
@@ -313,7 +318,7 @@ void UTF8StringStreamBuffer::Flush() {
 //
 
 template<class T>
-JsonWriterImpl<T>::JsonWriterImpl(ostringstream* out)
+JsonWriterImpl<T>::JsonWriterImpl(std::ostream* out)
   : stream_(DCHECK_NOTNULL(out)),
     writer_(stream_) {
 }
@@ -43,8 +43,9 @@ class JsonWriterIf;
 // This class implements all the methods of rapidjson::JsonWriter, plus an
 // additional convenience method for String(std::string).
 //
-// We take an instance of std::stringstream in the constructor because Mongoose / Squeasel
-// uses std::stringstream for output buffering.
+// The output is written to the std::ostream given to the constructor as it's
+// generated: at the end of each object or array, or whenever a few KB are
+// pending, so that it may be streamed.
 class JsonWriter {
  public:
   enum Mode {
@@ -54,7 +55,7 @@ class JsonWriter {
     COMPACT
   };
 
-  JsonWriter(std::ostringstream* out, Mode mode);
+  JsonWriter(std::ostream* out, Mode mode);
   ~JsonWriter();
 
   void Null();
@@ -15,9 +15,12 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <ctime>
+#include <mutex>
 #include <ostream>
 #include <string>
 #include <thread>
@@ -40,6 +43,7 @@
 
 using std::string;
 using std::vector;
+using strings::Substitute;
 
 namespace kudu {
 
@@ -190,6 +194,111 @@ TEST(LoggingTest, TestAsyncLoggerAutoFlush) {
   async.Stop();
 }
 
+// Test Logger implementation whose writes block until it is released, like
+// the logger of a stuck disk.
+class BlockingLogger : public google::base::Logger {
+ public:
+  void Write(bool /*force_flush*/,
+             time_t /*timestamp*/,
+             const char* message,
+             int message_len) override {
+    std::unique_lock<std::mutex> l(lock_);
+    released_cond_.wait(l, [&]() { return released_; });
+    messages_.emplace_back(message, message_len);
+  }
+
+  void Flush() override {}
+
+  uint32_t LogSize() override {
+    return 0;
+  }
+
+  void Release() {
+    std::lock_guard<std::mutex> l(lock_);
+    released_ = true;
+    released_cond_.notify_all();
+  }
+
+  vector<string> messages() {
+    std::lock_guard<std::mutex> l(lock_);
+    return messages_;
+  }
+
+ private:
+  std::mutex lock_;
+  std::condition_variable released_cond_;
+  bool released_ = false;
+  vector<string> messages_;
+};
+
+// Verify that with the DROP_WHEN_FULL policy, the messages logged while the
+// buffers are full are dropped and counted rather than blocking, except for
+// the ERROR ones.
+TEST(LoggingTest, TestAsyncLoggerDropWhenFull) {
+  const int kBuffer = 1000;
+  BlockingLogger base;
+  AsyncLogger async(&base, kBuffer, AsyncLogger::DROP_WHEN_FULL);
+  async.Start();
+
+  const string info_msg = "I" + string(99, 'x');
+  for (int i = 0; i < 100; i++) {
+    async.Write(false, i, info_msg.data(), info_msg.size());
+  }
+  ASSERT_GT(async.dropped_count(), 0);
+  ASSERT_EQ(0, async.app_threads_blocked_count_for_tests());
+
+  // An ERROR message waits for the buffers to be written.
+  std::thread error_thread([&]() {
+    async.Write(false, 0, "Eerror", 6);
+  });
+  base.Release();
+  error_thread.join();
+  async.Flush();
+  async.Stop();
+
+  // The messages which were kept, the ERROR one, and the report of the
+  // dropped ones.
+  const vector<string> messages = base.messages();
+  ASSERT_EQ(100 - async.dropped_count() + 2, messages.size());
+  ASSERT_EQ(1, std::count(messages.begin(), messages.end(), "Eerror"));
+  const string report = Substitute("Dropped $0 log messages", async.dropped_count());
+  ASSERT_EQ(1, std::count_if(messages.begin(), messages.end(), [&](const string& m) {
+    return m.find(report) != string::npos;
+  }));
+}
+
+// Verify that the messages logged by a rate-limited thread beyond its rate
+// are dropped, except for the ERROR ones.
+TEST(LoggingTest, TestAsyncLoggerRateLimit) {
+  const int kBuffer = 100000;
+  CountingLogger base;
+  AsyncLogger async(&base, kBuffer);
+  async.Start();
+
+  std::thread t([&]() {
+    AsyncLogger::RateLimitCurrentThread(10);
+    for (int i = 0; i < 100; i++) {
+      async.Write(false, i, "Ix", 2);
+    }
+    for (int i = 0; i < 10; i++) {
+      async.Write(false, i, "Ex", 2);
+    }
+  });
+  t.join();
+  // Other threads aren't limited.
+  for (int i = 0; i < 100; i++) {
+    async.Write(false, i, "Ix", 2);
+  }
+  async.Flush();
+  async.Stop();
+
+  // A burst of up to 10 messages, plus what was refilled while logging.
+  ASSERT_GE(async.dropped_count(), 80);
+  ASSERT_LE(async.dropped_count(), 90);
+  // The messages which were kept, and the report of the dropped ones.
+  ASSERT_EQ(210 - async.dropped_count() + 1, base.message_count_);
+}
+
 // Basic test that the redaction utilities work as expected.
 TEST(LoggingTest, TestRedactionBasic) {
   ASSERT_STREQ("<redacted>", KUDU_REDACT("hello"));
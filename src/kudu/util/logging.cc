@@ -62,6 +62,14 @@ DEFINE_int32(log_async_buffer_bytes_per_level, 2 * 1024 * 1024,
              "level. Only relevant when --log_async is enabled.");
 TAG_FLAG(log_async_buffer_bytes_per_level, hidden);
 
+DEFINE_bool(log_async_drop_when_full, false,
+            "Whether the messages logged while the asynchronous log buffers "
+            "are full are dropped, rather than blocking the logging threads "
+            "until the buffers are written. The ERROR and FATAL messages are "
+            "never dropped. The number of dropped messages is logged. Only "
+            "relevant when --log_async is enabled.");
+TAG_FLAG(log_async_drop_when_full, advanced);
+
 DEFINE_int32(max_log_files, 10,
     "Maximum number of log files to retain per severity level. The most recent "
     "log files are retained. If set to 0, all log files are retained.");
@@ -143,7 +151,10 @@ void EnableAsyncLogging() {
   // to ensure that we get the fatal log message written before exiting.
   for (auto level : { google::INFO, google::WARNING, google::ERROR }) {
     auto* orig = google::base::GetLogger(level);
-    auto* async = new AsyncLogger(orig, FLAGS_log_async_buffer_bytes_per_level);
+    auto* async = new AsyncLogger(orig, FLAGS_log_async_buffer_bytes_per_level,
+                                  FLAGS_log_async_drop_when_full ?
+                                      AsyncLogger::DROP_WHEN_FULL :
+                                      AsyncLogger::BLOCK_WHEN_FULL);
     async->Start();
     google::base::SetLogger(level, async);
   }
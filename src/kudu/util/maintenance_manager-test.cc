@@ -37,10 +37,12 @@
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/mutex.h"
+#include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 #include "kudu/util/thread.h"
+#include "kudu/util/trace.h"
 
 using std::shared_ptr;
 using std::string;
@@ -55,7 +57,13 @@ METRIC_DEFINE_gauge_uint32(test, maintenance_ops_running,
 METRIC_DEFINE_histogram(test, maintenance_op_duration,
                         "Maintenance Operation Duration",
                         kudu::MetricUnit::kSeconds, "", 60000000LU, 2);
+METRIC_DEFINE_histogram(test, test_queue_time,
+                        "Test Queue Time",
+                        kudu::MetricUnit::kMicroseconds, "", 60000000LU, 2);
 
+DECLARE_bool(maintenance_manager_cost_based_scheduling);
+DECLARE_int32(maintenance_manager_max_num_threads);
+DECLARE_int32(maintenance_manager_max_ops_per_data_dir);
 DECLARE_int64(log_target_replay_size_mb);
 
 namespace kudu {
@@ -66,8 +74,20 @@ static const char kFakeUuid[] = "12345";
 class MaintenanceManagerTest : public KuduTest {
  public:
   void SetUp() override {
+    NO_FATALS(StartManager(2));
+  }
+
+  void TearDown() override {
+    manager_->Shutdown();
+  }
+
+ protected:
+  void StartManager(int32_t num_threads) {
+    if (manager_) {
+      manager_->Shutdown();
+    }
     MaintenanceManager::Options options;
-    options.num_threads = 2;
+    options.num_threads = num_threads;
     options.polling_interval_ms = 1;
     options.history_size = kHistorySize;
     manager_.reset(new MaintenanceManager(options, kFakeUuid));
@@ -78,11 +98,6 @@ class MaintenanceManagerTest : public KuduTest {
     ASSERT_OK(manager_->Start());
   }
 
-  void TearDown() override {
-    manager_->Shutdown();
-  }
-
- protected:
   shared_ptr<MaintenanceManager> manager_;
   std::atomic<bool> indicate_memory_pressure_ { false };
 };
@@ -100,6 +115,7 @@ class TestMaintenanceOp : public MaintenanceOp {
       ram_anchored_(500),
       logs_retained_bytes_(0),
       perf_improvement_(0),
+      workload_bytes_(0),
       metric_entity_(METRIC_ENTITY_test.Instantiate(&metric_registry_, "test")),
       maintenance_op_duration_(METRIC_maintenance_op_duration.Instantiate(metric_entity_)),
       maintenance_ops_running_(METRIC_maintenance_ops_running.Instantiate(metric_entity_, 0)),
@@ -133,6 +149,7 @@ class TestMaintenanceOp : public MaintenanceOp {
     }
 
     SleepFor(sleep_time_);
+    TRACE_COUNTER_INCREMENT("test_op_performed", 1);
   }
 
   virtual void UpdateStats(MaintenanceOpStats* stats) OVERRIDE {
@@ -141,6 +158,7 @@ class TestMaintenanceOp : public MaintenanceOp {
     stats->set_ram_anchored(ram_anchored_);
     stats->set_logs_retained_bytes(logs_retained_bytes_);
     stats->set_perf_improvement(perf_improvement_);
+    stats->set_workload_bytes(workload_bytes_);
   }
 
   void set_remaining_runs(int runs) {
@@ -168,6 +186,21 @@ class TestMaintenanceOp : public MaintenanceOp {
     perf_improvement_ = perf_improvement;
   }
 
+  void set_workload_bytes(int64_t workload_bytes) {
+    std::lock_guard<Mutex> guard(lock_);
+    workload_bytes_ = workload_bytes;
+  }
+
+  void set_data_dirs(vector<string> data_dirs) {
+    std::lock_guard<Mutex> guard(lock_);
+    data_dirs_ = std::move(data_dirs);
+  }
+
+  virtual void GetDataDirs(vector<string>* dirs) const OVERRIDE {
+    std::lock_guard<Mutex> guard(lock_);
+    *dirs = data_dirs_;
+  }
+
   virtual scoped_refptr<Histogram> DurationHistogram() const OVERRIDE {
     return maintenance_op_duration_;
   }
@@ -177,11 +210,12 @@ class TestMaintenanceOp : public MaintenanceOp {
   }
 
  private:
-  Mutex lock_;
+  mutable Mutex lock_;
 
   uint64_t ram_anchored_;
   uint64_t logs_retained_bytes_;
   uint64_t perf_improvement_;
+  int64_t workload_bytes_;
   MetricRegistry metric_registry_;
   scoped_refptr<MetricEntity> metric_entity_;
   scoped_refptr<Histogram> maintenance_op_duration_;
@@ -195,6 +229,9 @@ class TestMaintenanceOp : public MaintenanceOp {
 
   // The amount of time each op invocation will sleep.
   MonoDelta sleep_time_;
+
+  // The data directories of the op.
+  vector<string> data_dirs_;
 };
 
 // Create an op and wait for it to start running.  Unregister it while it is
@@ -313,6 +350,225 @@ TEST_F(MaintenanceManagerTest, TestLogRetentionPrioritization) {
   manager_->UnregisterOp(&op2);
 }
 
+// Test that the throughput of the ops is measured per op type and data
+// directory, and that their duration is predicted from it.
+TEST_F(MaintenanceManagerTest, TestOpThroughput) {
+  const int64_t kMB = 1024 * 1024;
+  manager_->Shutdown();
+
+  TestMaintenanceOp op1("op(1)", MaintenanceOp::HIGH_IO_USAGE);
+  op1.set_data_dirs({ "/data/1", "/data/2" });
+  MaintenanceOpStats stats;
+  stats.set_workload_bytes(100 * kMB);
+  MonoDelta duration;
+  ASSERT_FALSE(manager_->PredictDurationUnlocked(&op1, stats, &duration));
+  manager_->RecordOpThroughputUnlocked(&op1, stats, MonoDelta::FromSeconds(10));
+  ASSERT_TRUE(manager_->PredictDurationUnlocked(&op1, stats, &duration));
+  ASSERT_EQ(10000, duration.ToMilliseconds());
+
+  // The ops of the same type share their throughput, which is averaged, and
+  // an op is as slow as its slowest data directory.
+  TestMaintenanceOp op2("op(2)", MaintenanceOp::HIGH_IO_USAGE);
+  op2.set_data_dirs({ "/data/2" });
+  MaintenanceOpStats stats2;
+  stats2.set_workload_bytes(50 * kMB);
+  ASSERT_TRUE(manager_->PredictDurationUnlocked(&op2, stats2, &duration));
+  ASSERT_EQ(5000, duration.ToMilliseconds());
+  manager_->RecordOpThroughputUnlocked(&op2, stats2, MonoDelta::FromSeconds(10));
+  ASSERT_TRUE(manager_->PredictDurationUnlocked(&op1, stats, &duration));
+  ASSERT_NEAR(13.333, duration.ToSeconds(), 0.01);
+
+  // The ops of other types aren't predicted.
+  TestMaintenanceOp op3("other(1)", MaintenanceOp::HIGH_IO_USAGE);
+  op3.set_data_dirs({ "/data/1" });
+  ASSERT_FALSE(manager_->PredictDurationUnlocked(&op3, stats, &duration));
+
+  // Neither are the ops with no workload.
+  ASSERT_FALSE(manager_->PredictDurationUnlocked(&op1, MaintenanceOpStats(), &duration));
+
+  // The rows are measured too.
+  MaintenanceOpStats row_stats;
+  row_stats.set_workload_rows(1000);
+  manager_->RecordOpThroughputUnlocked(&op3, row_stats, MonoDelta::FromSeconds(1));
+  row_stats.set_workload_rows(5000);
+  ASSERT_TRUE(manager_->PredictDurationUnlocked(&op3, row_stats, &duration));
+  ASSERT_EQ(5000, duration.ToMilliseconds());
+}
+
+// Test that the ops are picked by their perf improvement per predicted second,
+// and that the ops which would run past the time the server is under memory
+// pressure aren't started.
+TEST_F(MaintenanceManagerTest, TestCostBasedScheduling) {
+  const int64_t kMB = 1024 * 1024;
+  manager_->Shutdown();
+  manager_->set_memory_pressure_func_for_tests(
+      [](double* capacity_pct) {
+        *capacity_pct = 50;
+        return false;
+      });
+
+  TestMaintenanceOp slow_op("slow(1)", MaintenanceOp::HIGH_IO_USAGE);
+  slow_op.set_perf_improvement(10);
+  slow_op.set_ram_anchored(0);
+  slow_op.set_workload_bytes(100 * kMB);
+  TestMaintenanceOp fast_op("fast(1)", MaintenanceOp::HIGH_IO_USAGE);
+  fast_op.set_perf_improvement(5);
+  fast_op.set_ram_anchored(0);
+  fast_op.set_workload_bytes(kMB);
+  MaintenanceOpStats stats;
+  stats.set_workload_bytes(kMB);
+  for (auto* op : { &slow_op, &fast_op }) {
+    manager_->RegisterOp(op);
+    manager_->RecordOpThroughputUnlocked(op, stats, MonoDelta::FromSeconds(1));
+  }
+
+  // By default, the op with the best improvement is picked.
+  auto op_and_why = manager_->FindBestOp();
+  ASSERT_EQ(&slow_op, op_and_why.first);
+
+  // The fast op improves the performance more per second. The memory
+  // consumption grows by 5% of the limit per second, so the server would be
+  // under memory pressure in a few seconds.
+  const MonoTime now = MonoTime::Now();
+  manager_->UpdateMemoryGrowthUnlocked(40, now - MonoDelta::FromSeconds(2));
+  manager_->UpdateMemoryGrowthUnlocked(45, now - MonoDelta::FromSeconds(1));
+  FLAGS_maintenance_manager_cost_based_scheduling = true;
+  op_and_why = manager_->FindBestOp();
+  ASSERT_EQ(&fast_op, op_and_why.first);
+  ASSERT_STR_CONTAINS(op_and_why.second, "predicted duration=1.000s");
+
+  // The slow op would complete after that, so it isn't started.
+  manager_->UnregisterOp(&fast_op);
+  op_and_why = manager_->FindBestOp();
+  ASSERT_EQ(nullptr, op_and_why.first);
+  ASSERT_STR_CONTAINS(op_and_why.second, "would run past the time");
+
+  // Unless it frees memory.
+  slow_op.set_ram_anchored(100);
+  op_and_why = manager_->FindBestOp();
+  ASSERT_EQ(&slow_op, op_and_why.first);
+  manager_->UnregisterOp(&slow_op);
+}
+
+// Test that the ops running on each data directory are limited, so that the
+// threads are spread across the data directories.
+TEST_F(MaintenanceManagerTest, TestMaxOpsPerDataDir) {
+  FLAGS_maintenance_manager_max_ops_per_data_dir = 1;
+  TestMaintenanceOp op1("op1", MaintenanceOp::HIGH_IO_USAGE);
+  TestMaintenanceOp op2("op2", MaintenanceOp::HIGH_IO_USAGE);
+  TestMaintenanceOp op3("op3", MaintenanceOp::HIGH_IO_USAGE);
+  op1.set_perf_improvement(30);
+  op2.set_perf_improvement(20);
+  op3.set_perf_improvement(10);
+  op1.set_data_dirs({ "/data/1" });
+  op2.set_data_dirs({ "/data/1", "/data/2" });
+  op3.set_data_dirs({ "/data/2" });
+  for (auto* op : { &op1, &op2, &op3 }) {
+    op->set_sleep_time(MonoDelta::FromMilliseconds(500));
+    manager_->RegisterOp(op);
+  }
+
+  // op2 shares a data directory with each of the others, so it waits for
+  // them to complete, although there's a free thread.
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_EQ(1, op1.RunningGauge()->value());
+      ASSERT_EQ(1, op3.RunningGauge()->value());
+    });
+  ASSERT_EQ(0, op2.RunningGauge()->value());
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_EQ(1, op2.DurationHistogram()->TotalCount());
+    });
+  ASSERT_EQ(1, op1.DurationHistogram()->TotalCount());
+  ASSERT_EQ(1, op3.DurationHistogram()->TotalCount());
+  for (auto* op : { &op1, &op2, &op3 }) {
+    manager_->UnregisterOp(op);
+  }
+}
+
+// Test that the number of threads grows with the backlog of ops, and backs off
+// when foreground requests wait in queue, unless the ops are urgent.
+TEST_F(MaintenanceManagerTest, TestAdaptiveNumThreads) {
+  FLAGS_maintenance_manager_max_num_threads = 4;
+  NO_FATALS(StartManager(1));
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity = METRIC_ENTITY_test.Instantiate(&registry, "queue");
+  scoped_refptr<Histogram> queue_time = METRIC_test_queue_time.Instantiate(entity);
+  manager_->set_foreground_queue_time_histogram(queue_time);
+
+  std::atomic<bool> delay_requests(false);
+  std::atomic<bool> done(false);
+  scoped_refptr<Thread> thread;
+  ASSERT_OK(Thread::Create("test", "requests", [&]() {
+      while (!done) {
+        queue_time->Increment(delay_requests ? 1000000 : 10);
+        SleepFor(MonoDelta::FromMilliseconds(1));
+      }
+    }, &thread));
+  SCOPED_CLEANUP({
+      done = true;
+      thread->Join();
+    });
+
+  const int kNumOps = 4;
+  vector<std::unique_ptr<TestMaintenanceOp>> ops;
+  for (int i = 0; i < kNumOps; i++) {
+    ops.emplace_back(new TestMaintenanceOp(Substitute("op$0", i),
+                                           MaintenanceOp::HIGH_IO_USAGE));
+    ops.back()->set_perf_improvement(10);
+    ops.back()->set_remaining_runs(0);
+    ops.back()->set_sleep_time(MonoDelta::FromMilliseconds(200));
+    manager_->RegisterOp(ops.back().get());
+  }
+  const auto num_running = [&]() {
+    uint32_t n = 0;
+    for (const auto& op : ops) {
+      n += op->RunningGauge()->value();
+    }
+    return n;
+  };
+  const auto run_ops_once = [&]() {
+    for (const auto& op : ops) {
+      op->set_remaining_runs(1);
+    }
+  };
+  const auto wait_for_ops = [&](int num_runs) {
+    ASSERT_EVENTUALLY([&]() {
+        for (const auto& op : ops) {
+          ASSERT_EQ(num_runs, op->DurationHistogram()->TotalCount());
+        }
+      });
+  };
+
+  // The backlog grows the number of threads.
+  run_ops_once();
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_EQ(kNumOps, num_running());
+    });
+  NO_FATALS(wait_for_ops(1));
+
+  // Delayed foreground requests make it back off.
+  delay_requests = true;
+  SleepFor(MonoDelta::FromMilliseconds(250));
+  run_ops_once();
+  MonoTime deadline = MonoTime::Now() + MonoDelta::FromMilliseconds(500);
+  while (MonoTime::Now() < deadline) {
+    ASSERT_LE(num_running(), 1);
+    SleepFor(MonoDelta::FromMilliseconds(1));
+  }
+  NO_FATALS(wait_for_ops(2));
+
+  // Unless the server is under memory pressure.
+  indicate_memory_pressure_ = true;
+  run_ops_once();
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_EQ(kNumOps, num_running());
+    });
+  NO_FATALS(wait_for_ops(3));
+  for (const auto& op : ops) {
+    manager_->UnregisterOp(op.get());
+  }
+}
+
 // Test retrieving a list of an op's running instances
 TEST_F(MaintenanceManagerTest, TestRunningInstances) {
   TestMaintenanceOp op("op", MaintenanceOp::HIGH_IO_USAGE);
@@ -366,4 +622,25 @@ TEST_F(MaintenanceManagerTest, TestCompletedOpsHistory) {
   }
 }
 
+// Test that the trace metrics of the completed ops are reported, both per
+// instance and summed over all the instances.
+TEST_F(MaintenanceManagerTest, TestCompletedOpsMetrics) {
+  TestMaintenanceOp op("op", MaintenanceOp::HIGH_IO_USAGE);
+  op.set_perf_improvement(1);
+  op.set_remaining_runs(2);
+  manager_->RegisterOp(&op);
+  ASSERT_EVENTUALLY([&]() {
+      ASSERT_EQ(2, op.DurationHistogram()->TotalCount());
+    });
+  manager_->UnregisterOp(&op);
+
+  MaintenanceManagerStatusPB status_pb;
+  manager_->GetMaintenanceManagerStatusDump(&status_pb);
+  ASSERT_EQ(2, status_pb.completed_operations_size());
+  for (const auto& op_pb : status_pb.completed_operations()) {
+    ASSERT_EQ(1, op_pb.metrics().at("test_op_performed"));
+  }
+  ASSERT_EQ(2, status_pb.completed_operations_metrics().at("test_op_performed"));
+}
+
 } // namespace kudu
@@ -17,6 +17,7 @@
 
 #include "kudu/util/maintenance_manager.h"
 
+#include <algorithm>
 #include <cinttypes>
 #include <cstddef>
 #include <cstdint>
@@ -37,6 +38,7 @@
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/debug/trace_logging.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/hdr_histogram.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/maintenance_manager.pb.h"
 #include "kudu/util/metrics.h"
@@ -50,6 +52,7 @@
 
 using std::pair;
 using std::string;
+using std::vector;
 using strings::Substitute;
 
 DEFINE_int32(maintenance_manager_num_threads, 1,
@@ -58,6 +61,50 @@ DEFINE_int32(maintenance_manager_num_threads, 1,
              "not be above the number of devices.");
 TAG_FLAG(maintenance_manager_num_threads, stable);
 
+DEFINE_int32(maintenance_manager_max_num_threads, 0,
+             "If greater than --maintenance_manager_num_threads, the maximum "
+             "size of the maintenance manager thread pool. The number of "
+             "threads running operations then adapts to the workload: all of "
+             "them are used when the server is under memory pressure or "
+             "retains too many logs, none beyond "
+             "--maintenance_manager_num_threads when foreground requests queue "
+             "up, and otherwise as many as there are operations worth running.");
+TAG_FLAG(maintenance_manager_max_num_threads, experimental);
+
+DEFINE_double(maintenance_manager_adaptive_perf_improvement_threshold, 1.0,
+              "The minimum perf improvement score of an operation for it to "
+              "count towards the backlog which grows the number of threads, "
+              "when --maintenance_manager_max_num_threads is set.");
+TAG_FLAG(maintenance_manager_adaptive_perf_improvement_threshold, experimental);
+TAG_FLAG(maintenance_manager_adaptive_perf_improvement_threshold, runtime);
+
+DEFINE_int32(maintenance_manager_adaptive_max_queue_time_ms, 20,
+             "The mean time that foreground requests may wait in queue before "
+             "the maintenance manager backs off to "
+             "--maintenance_manager_num_threads threads, when "
+             "--maintenance_manager_max_num_threads is set.");
+TAG_FLAG(maintenance_manager_adaptive_max_queue_time_ms, experimental);
+TAG_FLAG(maintenance_manager_adaptive_max_queue_time_ms, runtime);
+
+DEFINE_int32(maintenance_manager_max_ops_per_data_dir, 0,
+             "Maximum number of high IO maintenance operations, such as "
+             "flushes and compactions, which may run concurrently on each "
+             "data directory. Use it to spread the operations across disks "
+             "when there are several maintenance manager threads. If 0, "
+             "there is no limit.");
+TAG_FLAG(maintenance_manager_max_ops_per_data_dir, experimental);
+TAG_FLAG(maintenance_manager_max_ops_per_data_dir, runtime);
+
+DEFINE_bool(maintenance_manager_cost_based_scheduling, false,
+            "Whether the maintenance manager picks the performance improvement "
+            "op with the best improvement per predicted second, rather than the "
+            "best improvement. The duration of the ops is predicted from the "
+            "throughput measured for each op type and data directory. Ops which "
+            "are predicted to run past the time the server would be under "
+            "memory pressure, and which don't free memory, are not started.");
+TAG_FLAG(maintenance_manager_cost_based_scheduling, experimental);
+TAG_FLAG(maintenance_manager_cost_based_scheduling, runtime);
+
 DEFINE_int32(maintenance_manager_polling_interval_ms, 250,
        "Polling interval for the maintenance manager scheduler, "
        "in milliseconds.");
@@ -91,8 +138,22 @@ DEFINE_double(data_gc_prioritization_prob, 0.5,
              "such as delta compaction.");
 TAG_FLAG(data_gc_prioritization_prob, experimental);
 
+DECLARE_int32(memory_pressure_percentage);
+
 namespace kudu {
 
+// The weight of the latest sample in the moving averages of the throughput
+// of the ops and of the memory growth rate.
+static const double kSampleWeight = 0.5;
+
+// The minimum time between two samples of the memory consumption.
+static const MonoDelta kMemorySamplePeriod = MonoDelta::FromSeconds(1);
+
+// When scoring ops by their perf improvement per predicted second, the ops
+// with no prediction, or which are predicted to take less than this, are
+// scored as if they took this long.
+static const double kMinPredictedSecs = 1.0;
+
 MaintenanceOpStats::MaintenanceOpStats() {
   Clear();
 }
@@ -104,6 +165,8 @@ void MaintenanceOpStats::Clear() {
   logs_retained_bytes_ = 0;
   data_retained_bytes_ = 0;
   perf_improvement_ = 0;
+  workload_bytes_ = 0;
+  workload_rows_ = 0;
   last_modified_ = MonoTime();
 }
 
@@ -133,6 +196,7 @@ MaintenanceManagerStatusPB_OpInstancePB OpInstance::DumpToPB() const {
   }
   MonoDelta delta(MonoTime::Now() - start_mono_time);
   pb.set_millis_since_start(delta.ToMilliseconds());
+  pb.mutable_metrics()->insert(metrics.begin(), metrics.end());
   return pb;
 }
 
@@ -147,18 +211,26 @@ MaintenanceManager::MaintenanceManager(const Options& options,
   : server_uuid_(std::move(server_uuid)),
     num_threads_(options.num_threads <= 0 ?
                  FLAGS_maintenance_manager_num_threads : options.num_threads),
+    max_num_threads_(std::max(num_threads_, FLAGS_maintenance_manager_max_num_threads)),
+    num_active_threads_(num_threads_),
     cond_(&lock_),
     shutdown_(false),
     polling_interval_ms_(options.polling_interval_ms <= 0 ?
           FLAGS_maintenance_manager_polling_interval_ms :
           options.polling_interval_ms),
     running_ops_(0),
+    num_backlog_ops_(0),
+    foreground_delayed_(false),
+    last_queue_time_count_(0),
+    last_queue_time_sum_(0),
     completed_ops_count_(0),
+    last_memory_capacity_pct_(0),
+    memory_growth_pct_per_sec_(0),
     rand_(GetRandomSeed32()),
     memory_pressure_func_(&process_memory::UnderMemoryPressure) {
   CHECK_OK(ThreadPoolBuilder("MaintenanceMgr")
                .set_min_threads(num_threads_)
-               .set_max_threads(num_threads_)
+               .set_max_threads(max_num_threads_)
                .Build(&thread_pool_));
   uint32_t history_size = options.history_size == 0 ?
                           FLAGS_maintenance_manager_history_size :
@@ -264,7 +336,8 @@ void MaintenanceManager::RunSchedulerThread() {
     //    1) there are no free threads available to perform a maintenance op.
     // or 2) we just tried to schedule an op but found nothing to run.
     // However, if it's time to shut down, we want to do so immediately.
-    while ((running_ops_ >= num_threads_ || prev_iter_found_no_work || disabled_for_tests()) &&
+    while ((running_ops_ >= max_num_threads_ || prev_iter_found_no_work ||
+            disabled_for_tests()) &&
            !shutdown_) {
       cond_.WaitFor(polling_interval);
       prev_iter_found_no_work = false;
@@ -289,8 +362,11 @@ void MaintenanceManager::RunSchedulerThread() {
     }
 
     // Prepare the maintenance operation.
+    vector<string> data_dirs = GetLimitedDataDirs(op);
+    const MaintenanceOpStats stats = FindOrDie(ops_, op);
     op->running_++;
     running_ops_++;
+    UpdateRunningOpsByDataDirUnlocked(data_dirs, 1);
     guard.unlock();
     bool ready = op->Prepare();
     guard.lock();
@@ -299,6 +375,7 @@ void MaintenanceManager::RunSchedulerThread() {
                             << ". Re-running scheduler.";
       op->running_--;
       running_ops_--;
+      UpdateRunningOpsByDataDirUnlocked(data_dirs, -1);
       op->cond_->Signal();
       continue;
     }
@@ -307,7 +384,7 @@ void MaintenanceManager::RunSchedulerThread() {
         << Substitute("Scheduling $0: $1", op->name(), note);
     // Run the maintenance operation.
     Status s = thread_pool_->SubmitFunc(boost::bind(
-        &MaintenanceManager::LaunchOp, this, op));
+        &MaintenanceManager::LaunchOp, this, op, std::move(data_dirs), stats));
     CHECK(s.ok());
   }
 }
@@ -320,7 +397,9 @@ void MaintenanceManager::RunSchedulerThread() {
 //   the highest retention (and if many qualify, then we run the one that also frees up the
 //   most RAM).
 // - Finally, if there's nothing else that we really need to do, we run the Op that will improve
-//   performance the most.
+//   performance the most. With --maintenance_manager_cost_based_scheduling, that's the Op with
+//   the best improvement per predicted second, among those predicted to complete before the
+//   server is under memory pressure, unless they free memory.
 //
 // The reason it's done this way is that we want to prioritize limiting the amount of resources we
 // hold on to. Low IO Ops go first since we can quickly run them, then we can look at memory usage.
@@ -335,8 +414,10 @@ void MaintenanceManager::RunSchedulerThread() {
 pair<MaintenanceOp*, string> MaintenanceManager::FindBestOp() {
   TRACE_EVENT0("maintenance", "MaintenanceManager::FindBestOp");
 
-  size_t free_threads = num_threads_ - running_ops_;
-  if (free_threads == 0) {
+  // In adaptive mode, the stats of the ops are needed to size the pool, even
+  // if there are no free threads.
+  const bool adaptive = max_num_threads_ > num_threads_;
+  if (!adaptive && running_ops_ >= num_threads_) {
     return {nullptr, "no free threads"};
   }
 
@@ -354,7 +435,24 @@ pair<MaintenanceOp*, string> MaintenanceManager::FindBestOp() {
   MaintenanceOp* most_data_retained_bytes_op = nullptr;
 
   double best_perf_improvement = 0;
+  double best_perf_score = 0;
+  MonoDelta best_perf_improvement_duration;
   MaintenanceOp* best_perf_improvement_op = nullptr;
+  int num_ops_too_long = 0;
+
+  double capacity_pct;
+  const bool under_memory_pressure = memory_pressure_func_(&capacity_pct);
+  const bool cost_based = FLAGS_maintenance_manager_cost_based_scheduling;
+  MonoDelta time_until_memory_pressure;
+  if (cost_based) {
+    UpdateMemoryGrowthUnlocked(capacity_pct, MonoTime::Now());
+    time_until_memory_pressure = TimeUntilMemoryPressureUnlocked(capacity_pct);
+  }
+
+  // The number of ops worth running another thread for.
+  int num_backlog_ops = 0;
+  const double backlog_threshold =
+      FLAGS_maintenance_manager_adaptive_perf_improvement_threshold;
   for (auto& val : ops_) {
     MaintenanceOp* op(val.first);
     MaintenanceOpStats& stats(val.second);
@@ -365,6 +463,11 @@ pair<MaintenanceOp*, string> MaintenanceManager::FindBestOp() {
     if (op->cancelled() || !stats.valid() || !stats.runnable()) {
       continue;
     }
+    if (PREDICT_FALSE(DataDirsAtCapacityUnlocked(GetLimitedDataDirs(op)))) {
+      VLOG_WITH_PREFIX(3) << "Skipping MM op " << op->name()
+                          << ": its data directories are busy";
+      continue;
+    }
 
     const auto logs_retained_bytes = stats.logs_retained_bytes();
     if (logs_retained_bytes > low_io_most_logs_retained_bytes &&
@@ -402,10 +505,42 @@ pair<MaintenanceOp*, string> MaintenanceManager::FindBestOp() {
     }
 
     const auto perf_improvement = stats.perf_improvement();
+    if (perf_improvement >= backlog_threshold) {
+      num_backlog_ops++;
+    }
+    double perf_score = perf_improvement;
+    MonoDelta duration;
+    if (cost_based && perf_improvement > 0 &&
+        PredictDurationUnlocked(op, stats, &duration)) {
+      if (time_until_memory_pressure.Initialized() &&
+          duration > time_until_memory_pressure && ram_anchored == 0) {
+        VLOG_AND_TRACE_WITH_PREFIX("maintenance", 2)
+            << Substitute("Op $0 is predicted to take $1, past the time the server "
+                          "would be under memory pressure", op->name(), duration.ToString());
+        num_ops_too_long++;
+        continue;
+      }
+      perf_score = perf_improvement / std::max(duration.ToSeconds(), kMinPredictedSecs);
+    } else if (cost_based) {
+      perf_score = perf_improvement / kMinPredictedSecs;
+    }
     if ((!best_perf_improvement_op) ||
-        (perf_improvement > best_perf_improvement)) {
+        (perf_score > best_perf_score)) {
       best_perf_improvement_op = op;
       best_perf_improvement = perf_improvement;
+      best_perf_score = perf_score;
+      best_perf_improvement_duration = duration;
+    }
+  }
+
+  const bool logs_over_target = most_logs_retained_bytes_op &&
+      most_logs_retained_bytes / 1024 / 1024 >= FLAGS_log_target_replay_size_mb;
+  num_backlog_ops_.Store(num_backlog_ops);
+  if (adaptive) {
+    UpdateNumActiveThreadsUnlocked(under_memory_pressure || logs_over_target,
+                                   num_backlog_ops);
+    if (running_ops_ >= num_active_threads_) {
+      return {nullptr, "no free threads"};
     }
   }
 
@@ -417,8 +552,7 @@ pair<MaintenanceOp*, string> MaintenanceManager::FindBestOp() {
 
   // Look at free memory. If it is dangerously low, we must select something
   // that frees memory-- the op with the most anchored memory.
-  double capacity_pct;
-  if (memory_pressure_func_(&capacity_pct)) {
+  if (under_memory_pressure) {
     if (!most_ram_anchored_op) {
       std::string msg = StringPrintf("System under memory pressure "
           "(%.2f%% of limit used). However, there are no ops currently "
@@ -432,8 +566,7 @@ pair<MaintenanceOp*, string> MaintenanceManager::FindBestOp() {
     return {most_ram_anchored_op, std::move(note)};
   }
 
-  if (most_logs_retained_bytes_op &&
-      most_logs_retained_bytes / 1024 / 1024 >= FLAGS_log_target_replay_size_mb) {
+  if (logs_over_target) {
     string note = Substitute("$0 bytes log retention", most_logs_retained_bytes);
     return {most_logs_retained_bytes_op, std::move(note)};
   }
@@ -451,12 +584,205 @@ pair<MaintenanceOp*, string> MaintenanceManager::FindBestOp() {
 
   if (best_perf_improvement_op && best_perf_improvement > 0) {
     string note = StringPrintf("perf score=%.6f", best_perf_improvement);
+    if (best_perf_improvement_duration.Initialized()) {
+      note += Substitute(", predicted duration=$0",
+                         best_perf_improvement_duration.ToString());
+    }
     return {best_perf_improvement_op, std::move(note)};
   }
+  if (num_ops_too_long > 0) {
+    return {nullptr, Substitute("$0 ops would run past the time the server is under "
+                                "memory pressure (in $1)", num_ops_too_long,
+                                time_until_memory_pressure.ToString())};
+  }
   return {nullptr, "no ops with positive improvement"};
 }
 
-void MaintenanceManager::LaunchOp(MaintenanceOp* op) {
+void MaintenanceManager::UpdateNumActiveThreadsUnlocked(bool urgent, int num_backlog_ops) {
+  int32_t num_threads;
+  if (urgent) {
+    num_threads = max_num_threads_;
+  } else if (ForegroundRequestsDelayedUnlocked()) {
+    num_threads = num_threads_;
+  } else {
+    // The running ops count towards the demand: the ops which are running
+    // don't necessarily report they are worth running again.
+    num_threads = std::min<int64_t>(
+        max_num_threads_,
+        std::max<int64_t>(num_threads_, running_ops_ + num_backlog_ops));
+  }
+  if (num_threads != num_active_threads_) {
+    LOG_WITH_PREFIX(INFO) << Substitute(
+        "Using $0 of $1 maintenance threads (urgent: $2, foreground delayed: $3, "
+        "backlog: $4 ops)", num_threads, max_num_threads_, urgent,
+        foreground_delayed_, num_backlog_ops);
+    num_active_threads_ = num_threads;
+  }
+}
+
+bool MaintenanceManager::ForegroundRequestsDelayedUnlocked() {
+  if (!foreground_queue_time_) {
+    return false;
+  }
+  // Sample the queue time at most once per polling interval, and no more
+  // often than every 100ms, so that the mean is taken over enough requests.
+  const MonoTime now = MonoTime::Now();
+  const MonoDelta sample_period =
+      MonoDelta::FromMilliseconds(std::max(polling_interval_ms_, 100));
+  if (last_queue_time_sample_.Initialized() &&
+      now - last_queue_time_sample_ < sample_period) {
+    return foreground_delayed_;
+  }
+  const HdrHistogram* hist = foreground_queue_time_->histogram();
+  const uint64_t count = hist->TotalCount();
+  const uint64_t sum = hist->TotalSum();
+  if (count > last_queue_time_count_) {
+    const uint64_t mean_us = (sum - last_queue_time_sum_) / (count - last_queue_time_count_);
+    foreground_delayed_ =
+        mean_us > FLAGS_maintenance_manager_adaptive_max_queue_time_ms * 1000LL;
+  } else {
+    // No requests were handled since the last sample.
+    foreground_delayed_ = false;
+  }
+  last_queue_time_sample_ = now;
+  last_queue_time_count_ = count;
+  last_queue_time_sum_ = sum;
+  return foreground_delayed_;
+}
+
+void MaintenanceManager::set_foreground_queue_time_histogram(scoped_refptr<Histogram> hist) {
+  std::lock_guard<Mutex> guard(lock_);
+  foreground_queue_time_ = std::move(hist);
+  if (foreground_queue_time_) {
+    last_queue_time_count_ = foreground_queue_time_->histogram()->TotalCount();
+    last_queue_time_sum_ = foreground_queue_time_->histogram()->TotalSum();
+  }
+  last_queue_time_sample_ = MonoTime();
+  foreground_delayed_ = false;
+}
+
+vector<string> MaintenanceManager::GetLimitedDataDirs(const MaintenanceOp* op) const {
+  vector<string> data_dirs;
+  if (FLAGS_maintenance_manager_max_ops_per_data_dir > 0 &&
+      op->io_usage() == MaintenanceOp::HIGH_IO_USAGE) {
+    op->GetDataDirs(&data_dirs);
+  }
+  return data_dirs;
+}
+
+bool MaintenanceManager::DataDirsAtCapacityUnlocked(const vector<string>& data_dirs) const {
+  const int max_ops = FLAGS_maintenance_manager_max_ops_per_data_dir;
+  for (const auto& dir : data_dirs) {
+    if (max_ops > 0 && FindWithDefault(running_ops_by_data_dir_, dir, 0) >= max_ops) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void MaintenanceManager::UpdateRunningOpsByDataDirUnlocked(const vector<string>& data_dirs,
+                                                           int delta) {
+  for (const auto& dir : data_dirs) {
+    int& count = running_ops_by_data_dir_[dir];
+    count += delta;
+    DCHECK_GE(count, 0);
+    if (count == 0) {
+      running_ops_by_data_dir_.erase(dir);
+    }
+  }
+}
+
+string MaintenanceManager::OpType(const string& op_name) {
+  return op_name.substr(0, op_name.find('('));
+}
+
+void MaintenanceManager::RecordOpThroughputUnlocked(const MaintenanceOp* op,
+                                                    const MaintenanceOpStats& stats,
+                                                    const MonoDelta& duration) {
+  if (!stats.valid() || (stats.workload_bytes() <= 0 && stats.workload_rows() <= 0)) {
+    return;
+  }
+  const double secs = std::max(duration.ToSeconds(), 0.001);
+  const auto update = [](double sample, double* avg) {
+    *avg = *avg == 0 ? sample : kSampleWeight * sample + (1 - kSampleWeight) * *avg;
+  };
+  vector<string> data_dirs;
+  op->GetDataDirs(&data_dirs);
+  if (data_dirs.empty()) {
+    data_dirs.emplace_back("");
+  }
+  const string type = OpType(op->name());
+  for (const auto& dir : data_dirs) {
+    OpThroughput& throughput = op_throughput_[{ type, dir }];
+    if (stats.workload_bytes() > 0) {
+      update(stats.workload_bytes() / secs, &throughput.bytes_per_sec);
+    }
+    if (stats.workload_rows() > 0) {
+      update(stats.workload_rows() / secs, &throughput.rows_per_sec);
+    }
+    VLOG_WITH_PREFIX(2) << Substitute("Throughput of $0 on '$1': $2 bytes/s, $3 rows/s",
+                                      type, dir, throughput.bytes_per_sec,
+                                      throughput.rows_per_sec);
+  }
+}
+
+bool MaintenanceManager::PredictDurationUnlocked(const MaintenanceOp* op,
+                                                 const MaintenanceOpStats& stats,
+                                                 MonoDelta* duration) const {
+  if (!stats.valid()) {
+    return false;
+  }
+  vector<string> data_dirs;
+  op->GetDataDirs(&data_dirs);
+  if (data_dirs.empty()) {
+    data_dirs.emplace_back("");
+  }
+  const string type = OpType(op->name());
+  // The op is as slow as its slowest data directory.
+  double secs = -1;
+  for (const auto& dir : data_dirs) {
+    const OpThroughput* throughput = FindOrNull(op_throughput_, { type, dir });
+    if (!throughput) {
+      continue;
+    }
+    if (stats.workload_bytes() > 0 && throughput->bytes_per_sec > 0) {
+      secs = std::max(secs, stats.workload_bytes() / throughput->bytes_per_sec);
+    }
+    if (stats.workload_rows() > 0 && throughput->rows_per_sec > 0) {
+      secs = std::max(secs, stats.workload_rows() / throughput->rows_per_sec);
+    }
+  }
+  if (secs < 0) {
+    return false;
+  }
+  *duration = MonoDelta::FromSeconds(secs);
+  return true;
+}
+
+void MaintenanceManager::UpdateMemoryGrowthUnlocked(double capacity_pct, const MonoTime& now) {
+  if (last_memory_sample_.Initialized()) {
+    const MonoDelta elapsed = now - last_memory_sample_;
+    if (elapsed < kMemorySamplePeriod) {
+      return;
+    }
+    const double growth = (capacity_pct - last_memory_capacity_pct_) / elapsed.ToSeconds();
+    memory_growth_pct_per_sec_ =
+        kSampleWeight * growth + (1 - kSampleWeight) * memory_growth_pct_per_sec_;
+  }
+  last_memory_sample_ = now;
+  last_memory_capacity_pct_ = capacity_pct;
+}
+
+MonoDelta MaintenanceManager::TimeUntilMemoryPressureUnlocked(double capacity_pct) const {
+  const double headroom_pct = FLAGS_memory_pressure_percentage - capacity_pct;
+  if (memory_growth_pct_per_sec_ <= 0 || headroom_pct <= 0) {
+    return MonoDelta();
+  }
+  return MonoDelta::FromSeconds(headroom_pct / memory_growth_pct_per_sec_);
+}
+
+void MaintenanceManager::LaunchOp(MaintenanceOp* op, const vector<string>& data_dirs,
+                                  const MaintenanceOpStats& stats) {
   int64_t thread_id = Thread::CurrentThreadId();
   OpInstance op_instance;
   op_instance.thread_id = thread_id;
@@ -477,12 +803,17 @@ void MaintenanceManager::LaunchOp(MaintenanceOp* op) {
       running_instances_.erase(thread_id);
     }
     op_instance.duration = MonoTime::Now() - op_instance.start_mono_time;
+    for (const auto& metric : op_instance.metrics) {
+      completed_ops_metrics_[metric.first] += metric.second;
+    }
     completed_ops_[completed_ops_count_ % completed_ops_.size()] = op_instance;
     completed_ops_count_++;
 
     op->DurationHistogram()->Increment(op_instance.duration.ToMilliseconds());
+    RecordOpThroughputUnlocked(op, stats, op_instance.duration);
 
     running_ops_--;
+    UpdateRunningOpsByDataDirUnlocked(data_dirs, -1);
     op->running_--;
     op->cond_->Signal();
     cond_.Signal(); // Wake up scheduler.
@@ -498,6 +829,9 @@ void MaintenanceManager::LaunchOp(MaintenanceOp* op) {
     op->Perform();
     sw.stop();
   }
+  for (const auto& metric : trace->metrics()->Get()) {
+    op_instance.metrics.emplace(metric.first, metric.second);
+  }
   LOG_WITH_PREFIX(INFO) << Substitute("$0 complete. Timing: $1 Metrics: $2",
                                       op->name(),
                                       sw.elapsed().ToString(),
@@ -521,6 +855,10 @@ void MaintenanceManager::GetMaintenanceManagerStatusDump(MaintenanceManagerStatu
       op_pb->set_ram_anchored_bytes(stats.ram_anchored());
       op_pb->set_logs_retained_bytes(stats.logs_retained_bytes());
       op_pb->set_perf_improvement(stats.perf_improvement());
+      MonoDelta duration;
+      if (PredictDurationUnlocked(op, stats, &duration)) {
+        op_pb->set_predicted_duration_millis(duration.ToMilliseconds());
+      }
     } else {
       op_pb->set_runnable(false);
       op_pb->set_ram_anchored_bytes(0);
@@ -549,6 +887,8 @@ void MaintenanceManager::GetMaintenanceManagerStatusDump(MaintenanceManagerStatu
       *out_pb->add_completed_operations() = completed_op.DumpToPB();
     }
   }
+  out_pb->mutable_completed_operations_metrics()->insert(completed_ops_metrics_.begin(),
+                                                          completed_ops_metrics_.end());
 }
 
 std::string MaintenanceManager::LogPrefix() const {
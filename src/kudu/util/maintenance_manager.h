@@ -108,6 +108,26 @@ class MaintenanceOpStats {
     perf_improvement_ = perf_improvement;
   }
 
+  int64_t workload_bytes() const {
+    DCHECK(valid_);
+    return workload_bytes_;
+  }
+
+  void set_workload_bytes(int64_t workload_bytes) {
+    UpdateLastModified();
+    workload_bytes_ = workload_bytes;
+  }
+
+  int64_t workload_rows() const {
+    DCHECK(valid_);
+    return workload_rows_;
+  }
+
+  void set_workload_rows(int64_t workload_rows) {
+    UpdateLastModified();
+    workload_rows_ = workload_rows;
+  }
+
   const MonoTime& last_modified() const {
     DCHECK(valid_);
     return last_modified_;
@@ -148,6 +168,13 @@ class MaintenanceOpStats {
   // absolute scale (yet TBD).
   double perf_improvement_;
 
+  // The approximate amount of data, in bytes and in rows, which this
+  // operation would process if it ran. The maintenance manager measures the
+  // throughput of the ops from these to predict how long they take. May be 0
+  // if unknown.
+  int64_t workload_bytes_;
+  int64_t workload_rows_;
+
   // The last time that the stats were modified.
   MonoTime last_modified_;
 };
@@ -162,6 +189,8 @@ struct OpInstance {
   MonoDelta duration;
   // The time at which the operation was launched.
   MonoTime start_mono_time;
+  // The trace metrics of the operation. Empty if the instance is still running.
+  std::map<std::string, int64_t> metrics;
 
   MaintenanceManagerStatusPB_OpInstancePB DumpToPB() const;
 };
@@ -210,6 +239,13 @@ class MaintenanceOp {
   // Returns the gauge for this op that tracks when this op is running. Cannot be NULL.
   virtual scoped_refptr<AtomicGauge<uint32_t>> RunningGauge() const = 0;
 
+  // Fill 'dirs' with the data directories which the op reads from and writes
+  // to, if it's known. The maintenance manager limits the number of high IO
+  // ops running concurrently on each data directory, with
+  // --maintenance_manager_max_ops_per_data_dir. This will be run under the
+  // MaintenanceManager lock, so it should not be too expensive.
+  virtual void GetDataDirs(std::vector<std::string>* /*dirs*/) const {}
+
   uint32_t running() { return running_; }
 
   const std::string& name() const { return name_; }
@@ -298,13 +334,35 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
     memory_pressure_func_ = std::move(f);
   }
 
+  // Set the histogram of the time foreground requests wait in queue before
+  // being handled, in microseconds. When the number of threads adapts to the
+  // workload (see --maintenance_manager_max_num_threads), the manager backs
+  // off while requests wait too long.
+  void set_foreground_queue_time_histogram(scoped_refptr<Histogram> hist);
+
+  // Returns the number of registered ops whose perf improvement was at least
+  // --maintenance_manager_adaptive_perf_improvement_threshold as of the last
+  // scheduling pass, i.e. how much worthwhile work is waiting to run.
+  int32_t num_backlog_ops() const { return num_backlog_ops_.Load(); }
+
   static const Options kDefaultOptions;
 
  private:
   FRIEND_TEST(MaintenanceManagerTest, TestLogRetentionPrioritization);
+  FRIEND_TEST(MaintenanceManagerTest, TestCostBasedScheduling);
+  FRIEND_TEST(MaintenanceManagerTest, TestOpThroughput);
   typedef std::map<MaintenanceOp*, MaintenanceOpStats,
           MaintenanceOpComparator> OpMapTy;
 
+  // The moving averages of the throughput of a type of op on a data
+  // directory. 0 if unknown.
+  struct OpThroughput {
+    double bytes_per_sec = 0;
+    double rows_per_sec = 0;
+  };
+  // Keyed by op type and data directory.
+  typedef std::map<std::pair<std::string, std::string>, OpThroughput> OpThroughputMap;
+
   // Return true if tests have currently disabled the maintenance
   // manager by way of changing the gflags at runtime.
   bool disabled_for_tests() const;
@@ -317,12 +375,67 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
   // suitable for logging.
   std::pair<MaintenanceOp*, std::string> FindBestOp();
 
-  void LaunchOp(MaintenanceOp* op);
+  // Set the number of threads which may run ops, in adaptive mode. 'urgent'
+  // is whether the server is under memory pressure or retains too many logs,
+  // and 'num_backlog_ops' is the number of runnable ops whose perf
+  // improvement is at least the adaptive threshold.
+  void UpdateNumActiveThreadsUnlocked(bool urgent, int num_backlog_ops);
+
+  // Return true if foreground requests recently waited in queue longer than
+  // --maintenance_manager_adaptive_max_queue_time_ms on average.
+  bool ForegroundRequestsDelayedUnlocked();
+
+  // Run an instance of 'op', which was counted as running on 'data_dirs',
+  // and was scheduled with 'stats'.
+  void LaunchOp(MaintenanceOp* op, const std::vector<std::string>& data_dirs,
+                const MaintenanceOpStats& stats);
+
+  // Return the type of the op named 'op_name': its name up to the first
+  // parenthesis, e.g. "CompactRowSetsOp" for "CompactRowSetsOp(<tablet id>)".
+  static std::string OpType(const std::string& op_name);
+
+  // Record that an instance of 'op', scheduled with 'stats', took 'duration'.
+  void RecordOpThroughputUnlocked(const MaintenanceOp* op,
+                                  const MaintenanceOpStats& stats,
+                                  const MonoDelta& duration);
+
+  // Predict how long an instance of 'op' with 'stats' would take, from the
+  // throughput of the op type on the op's data directories. Returns false if
+  // there is no prediction.
+  bool PredictDurationUnlocked(const MaintenanceOp* op,
+                               const MaintenanceOpStats& stats,
+                               MonoDelta* duration) const;
+
+  // Sample the memory consumption, as a percentage of the limit, to track
+  // how fast it grows.
+  void UpdateMemoryGrowthUnlocked(double capacity_pct, const MonoTime& now);
+
+  // Return the time until the server is under memory pressure at the current
+  // growth rate of the memory consumption, or an uninitialized MonoDelta if
+  // the consumption isn't growing.
+  MonoDelta TimeUntilMemoryPressureUnlocked(double capacity_pct) const;
+
+  // Returns the data directories on which an instance of 'op' is counted as
+  // running: none unless ops are limited per data directory.
+  std::vector<std::string> GetLimitedDataDirs(const MaintenanceOp* op) const;
+
+  // Return true if any of 'data_dirs' already runs the maximum number of ops.
+  bool DataDirsAtCapacityUnlocked(const std::vector<std::string>& data_dirs) const;
+
+  // Add 'delta' to the number of ops running on each of 'data_dirs'.
+  void UpdateRunningOpsByDataDirUnlocked(const std::vector<std::string>& data_dirs,
+                                         int delta);
 
   std::string LogPrefix() const;
 
   const std::string server_uuid_;
+  // The number of threads which always may run ops.
   const int32_t num_threads_;
+  // The size of the thread pool. If greater than num_threads_, the number of
+  // threads which may run ops adapts to the workload between the two.
+  const int32_t max_num_threads_;
+  // The number of threads which currently may run ops. Protected by lock_.
+  int32_t num_active_threads_;
   OpMapTy ops_; // Registered operations.
   Mutex lock_;
   scoped_refptr<kudu::Thread> monitor_thread_;
@@ -331,10 +444,31 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
   bool shutdown_;
   int32_t polling_interval_ms_;
   uint64_t running_ops_;
+  // See num_backlog_ops().
+  AtomicInt<int32_t> num_backlog_ops_;
+  // The number of ops running on each data directory, when ops are limited
+  // per data directory. Protected by lock_.
+  std::unordered_map<std::string, int> running_ops_by_data_dir_;
+  // The queue time of foreground requests, and its state at the last sample.
+  // Protected by lock_.
+  scoped_refptr<Histogram> foreground_queue_time_;
+  MonoTime last_queue_time_sample_;
+  bool foreground_delayed_;
+  uint64_t last_queue_time_count_;
+  uint64_t last_queue_time_sum_;
   // Vector used as a circular buffer for recently completed ops. Elements need to be added at
   // the completed_ops_count_ % the vector's size and then the count needs to be incremented.
   std::vector<OpInstance> completed_ops_;
   int64_t completed_ops_count_;
+  // The sums of the trace metrics of all the completed ops.
+  std::map<std::string, int64_t> completed_ops_metrics_;
+  // The throughput of the completed ops, and the growth rate of the memory
+  // consumption in percents of the limit per second, with its last sample.
+  // Protected by lock_.
+  OpThroughputMap op_throughput_;
+  MonoTime last_memory_sample_;
+  double last_memory_capacity_pct_;
+  double memory_growth_pct_per_sec_;
   Random rand_;
 
   // Function which should return true if the server is under global memory pressure.
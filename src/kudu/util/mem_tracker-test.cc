@@ -27,6 +27,8 @@
 #include <utility>
 #include <vector>
 
+#include <gflags/gflags.h>
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
@@ -37,6 +39,8 @@
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_int64(mem_tracker_consumption_batch_bytes);
+
 namespace kudu {
 
 using std::equal_to;
@@ -346,6 +350,57 @@ TEST(MemTrackerTest, ScopedTrackedConsumption) {
   ASSERT_EQ(0, m->consumption());
 }
 
+// Verify that the changes of consumption of each thread are buffered up to
+// --mem_tracker_consumption_batch_bytes, and exact in the thread itself.
+TEST(MemTrackerTest, BufferedConsumption) {
+  google::FlagSaver saver;
+  FLAGS_mem_tracker_consumption_batch_bytes = 100;
+  shared_ptr<MemTracker> p = MemTracker::CreateTracker(-1, "parent");
+  shared_ptr<MemTracker> c = MemTracker::CreateTracker(-1, "child", p);
+
+  // Returns the consumption of 't' as seen by another thread.
+  const auto consumption_elsewhere = [](const shared_ptr<MemTracker>& t) {
+    int64_t consumption;
+    std::thread thread([&]() { consumption = t->consumption(); });
+    thread.join();
+    return consumption;
+  };
+
+  c->Consume(60);
+  ASSERT_EQ(0, consumption_elsewhere(c));
+  ASSERT_EQ(0, consumption_elsewhere(p));
+  c->Consume(60);
+  ASSERT_EQ(120, consumption_elsewhere(c));
+  ASSERT_EQ(120, consumption_elsewhere(p));
+  c->Release(50);
+  ASSERT_EQ(120, consumption_elsewhere(p));
+  // The calling thread's changes are applied when it checks the consumption.
+  ASSERT_EQ(70, c->consumption());
+  ASSERT_EQ(70, consumption_elsewhere(p));
+
+  // Changing the consumption of more trackers than the buffer holds applies
+  // the changes of the least recent ones.
+  vector<shared_ptr<MemTracker>> others;
+  for (int i = 0; i < 10; i++) {
+    others.emplace_back(MemTracker::CreateTracker(-1, Substitute("other $0", i), p));
+  }
+  c->Consume(10);
+  for (const auto& t : others) {
+    t->Consume(1);
+  }
+  ASSERT_EQ(10 + 70, consumption_elsewhere(c));
+
+  // The buffer of a thread is applied when it exits.
+  std::thread thread([&]() { c->Release(80); });
+  thread.join();
+  ASSERT_EQ(0, consumption_elsewhere(c));
+
+  for (const auto& t : others) {
+    t->Release(1);
+  }
+  ASSERT_EQ(0, p->consumption());
+}
+
 TEST(MemTrackerTest, CollisionDetection) {
   shared_ptr<MemTracker> p = MemTracker::CreateTracker(-1, "parent");
   shared_ptr<MemTracker> c = MemTracker::CreateTracker(-1, "child", p);
@@ -18,7 +18,9 @@
 #include "kudu/util/mem_tracker.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
+#include <cstdlib>
 #include <deque>
 #include <limits>
 #include <list>
@@ -27,13 +29,26 @@
 #include <stack>
 #include <type_traits>
 
+#include <gflags/gflags.h>
+
 #include "kudu/gutil/once.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/mem_tracker.pb.h"
 #include "kudu/util/mutex.h"
 #include "kudu/util/process_memory.h"
 
+DEFINE_int64(mem_tracker_consumption_batch_bytes, 64 * 1024,
+             "The number of bytes of changes of the consumption of a memory "
+             "tracker each thread buffers before applying them to the tracker "
+             "and its ancestors. Higher values make the threads contend less on "
+             "the trackers, at the cost of the accuracy of their consumption. "
+             "0 disables the buffering.");
+TAG_FLAG(mem_tracker_consumption_batch_bytes, advanced);
+DEFINE_validator(mem_tracker_consumption_batch_bytes,
+                 [](const char* /*flagname*/, int64_t value) { return value >= 0; });
+
 namespace kudu {
 
 // NOTE: this class has been adapted from Impala, so the code style varies
@@ -53,6 +68,80 @@ using strings::Substitute;
 static shared_ptr<MemTracker> root_tracker;
 static GoogleOnceType root_tracker_once = GOOGLE_ONCE_INIT;
 
+// The serial number of the next tracker.
+static std::atomic<int64_t> next_tracker_serial(0);
+
+// The changes of consumption a thread buffers for the few trackers it last
+// changed the consumption of. They are applied at the latest when the thread
+// exits.
+class MemTracker::ThreadBuffer {
+ public:
+  struct Entry {
+    // The tracker the changes are for. It's only compared with, since it may
+    // have been destroyed since: the changes are applied through 'ref'.
+    const MemTracker* tracker = nullptr;
+    int64_t serial = -1;
+    weak_ptr<MemTracker> ref;
+    int64_t bytes = 0;
+  };
+
+  ~ThreadBuffer() {
+    // Should applying the changes destroy a tracker, the changes of the
+    // consumption of its parent go to a new buffer, destroyed in turn.
+    tls_buffer_ = nullptr;
+    Flush();
+  }
+
+  // Applies the changes buffered in all the entries.
+  void Flush() {
+    // The trackers are released only once all the entries are applied, since
+    // destroying a tracker changes the consumption of its parent.
+    shared_ptr<MemTracker> trackers[kNumEntries];
+    for (int i = 0; i < kNumEntries; i++) {
+      auto& entry = entries_[i];
+      if (entry.bytes == 0) {
+        continue;
+      }
+      trackers[i] = entry.ref.lock();
+      if (trackers[i]) {
+        trackers[i]->UpdateConsumption(entry.bytes);
+      }
+      entry.bytes = 0;
+    }
+  }
+
+  // Returns an entry to buffer the changes of another tracker in, applying
+  // and clearing the changes buffered in it if all the entries are in use.
+  //
+  // The tracker of the evicted entry is returned in 'evicted': it must be
+  // released only once the entry is reused, since destroying a tracker changes
+  // the consumption of its parent, and thus the buffer.
+  Entry* EvictEntry(shared_ptr<MemTracker>* evicted) {
+    for (auto& entry : entries_) {
+      if (!entry.tracker) {
+        return &entry;
+      }
+    }
+    Entry* entry = &entries_[next_evicted_];
+    next_evicted_ = (next_evicted_ + 1) % kNumEntries;
+    *evicted = entry->ref.lock();
+    if (*evicted && entry->bytes != 0) {
+      (*evicted)->UpdateConsumption(entry->bytes);
+    }
+    *entry = Entry();
+    return entry;
+  }
+
+  static const int kNumEntries = 4;
+  Entry entries_[kNumEntries];
+
+ private:
+  // The entry to evict next if all of them are in use.
+  int next_evicted_ = 0;
+};
+
+DEFINE_STATIC_THREAD_LOCAL(MemTracker::ThreadBuffer, MemTracker, tls_buffer_);
+
 void MemTracker::CreateRootTracker() {
   root_tracker.reset(new MemTracker(-1, "root", shared_ptr<MemTracker>()));
   root_tracker->Init();
@@ -79,14 +168,28 @@ MemTracker::MemTracker(int64_t byte_limit, const string& id, shared_ptr<MemTrack
       id_(id),
       descr_(Substitute("memory consumption for $0", id)),
       parent_(std::move(parent)),
-      consumption_(0) {
+      consumption_(0),
+      serial_(next_tracker_serial++) {
   VLOG(1) << "Creating tracker " << ToString();
 }
 
 MemTracker::~MemTracker() {
   VLOG(1) << "Destroying tracker " << ToString();
+  // The changes the calling thread buffered for this tracker can't be applied
+  // through the reference of the buffer anymore. Those buffered by other
+  // threads are dropped: they weren't applied to the ancestors either.
+  if (tls_buffer_) {
+    for (auto& entry : tls_buffer_->entries_) {
+      if (entry.tracker == this && entry.serial == serial_) {
+        const int64_t bytes = entry.bytes;
+        entry = ThreadBuffer::Entry();
+        UpdateConsumption(bytes);
+      }
+    }
+  }
   if (parent_) {
-    DCHECK(consumption() == 0) << "Memory tracker " << ToString()
+    DCHECK(consumption() == 0 || FLAGS_mem_tracker_consumption_batch_bytes > 0)
+        << "Memory tracker " << ToString()
         << " has unreleased consumption " << consumption();
     parent_->Release(consumption());
 
@@ -230,8 +333,10 @@ void MemTracker::Consume(int64_t bytes) {
   if (bytes == 0) {
     return;
   }
-  for (auto& tracker : all_trackers_) {
-    tracker->consumption_.IncrementBy(bytes);
+  if (FLAGS_mem_tracker_consumption_batch_bytes > 0) {
+    BufferConsumption(bytes);
+  } else {
+    UpdateConsumption(bytes);
   }
 }
 
@@ -240,7 +345,13 @@ bool MemTracker::TryConsume(int64_t bytes) {
     Release(-bytes);
     return true;
   }
+  if (limit_trackers_.empty()) {
+    Consume(bytes);
+    return true;
+  }
 
+  // The limits are checked against the exact consumption of this thread.
+  FlushThreadConsumption();
   int i = 0;
   // Walk the tracker tree top-down, consuming memory from each in turn.
   for (i = all_trackers_.size() - 1; i >= 0; --i) {
@@ -278,11 +389,50 @@ void MemTracker::Release(int64_t bytes) {
   if (bytes == 0) {
     return;
   }
+  if (FLAGS_mem_tracker_consumption_batch_bytes > 0) {
+    BufferConsumption(-bytes);
+  } else {
+    UpdateConsumption(-bytes);
+  }
+}
 
+void MemTracker::UpdateConsumption(int64_t bytes) {
   for (auto& tracker : all_trackers_) {
-    tracker->consumption_.IncrementBy(-bytes);
+    tracker->consumption_.IncrementBy(bytes);
+  }
+  if (bytes < 0) {
+    process_memory::MaybeGCAfterRelease(-bytes);
+  }
+}
+
+void MemTracker::BufferConsumption(int64_t bytes) {
+  INIT_STATIC_THREAD_LOCAL(ThreadBuffer, tls_buffer_);
+  ThreadBuffer::Entry* entry = nullptr;
+  for (auto& e : tls_buffer_->entries_) {
+    if (e.tracker == this && e.serial == serial_) {
+      entry = &e;
+      break;
+    }
+  }
+  shared_ptr<MemTracker> evicted;
+  if (PREDICT_FALSE(!entry)) {
+    entry = tls_buffer_->EvictEntry(&evicted);
+    entry->tracker = this;
+    entry->serial = serial_;
+    entry->ref = shared_from_this();
+  }
+  entry->bytes += bytes;
+  if (std::abs(entry->bytes) >= FLAGS_mem_tracker_consumption_batch_bytes) {
+    const int64_t to_apply = entry->bytes;
+    entry->bytes = 0;
+    UpdateConsumption(to_apply);
+  }
+}
+
+void MemTracker::FlushThreadConsumption() {
+  if (tls_buffer_) {
+    tls_buffer_->Flush();
   }
-  process_memory::MaybeGCAfterRelease(bytes);
 }
 
 bool MemTracker::AnyLimitExceeded() {
@@ -28,6 +28,7 @@
 
 #include "kudu/util/high_water_mark.h"
 #include "kudu/util/mutex.h"
+#include "kudu/util/threadlocal.h"
 
 namespace kudu {
 
@@ -56,6 +57,15 @@ class MemTrackerPB;
 // Memory consumption is tracked via calls to Consume()/Release(), either to
 // the tracker itself or to one of its descendants.
 //
+// To keep threads which allocate often from contending on the consumption of
+// the shared ancestors, the changes of consumption of each thread are
+// buffered per tracker until they reach --mem_tracker_consumption_batch_bytes,
+// and then applied to the tracker and its ancestors at once. The consumption
+// of a tracker may thus be off by that many bytes for each thread (and each of
+// its few buffers) which changed the consumption of the tracker or of its
+// descendants. The changes buffered by the calling thread are applied before
+// the consumption or the limits are checked.
+//
 // This class is thread-safe.
 class MemTracker : public std::enable_shared_from_this<MemTracker> {
  public:
@@ -104,6 +114,10 @@ class MemTracker : public std::enable_shared_from_this<MemTracker> {
   // Gets a shared_ptr to the "root" tracker, creating it if necessary.
   static std::shared_ptr<MemTracker> GetRootTracker();
 
+  // Applies the changes of consumption buffered by the calling thread to their
+  // trackers and their ancestors.
+  static void FlushThreadConsumption();
+
   // Increases consumption of this tracker and its ancestors by 'bytes'.
   void Consume(int64_t bytes);
 
@@ -142,6 +156,7 @@ class MemTracker : public std::enable_shared_from_this<MemTracker> {
 
   // Returns the memory consumed in bytes.
   int64_t consumption() const {
+    FlushThreadConsumption();
     return consumption_.current_value();
   }
 
@@ -174,6 +189,18 @@ class MemTracker : public std::enable_shared_from_this<MemTracker> {
   // Creates the root tracker.
   static void CreateRootTracker();
 
+  // Changes the consumption of this tracker and its ancestors by 'bytes',
+  // which may be negative, without buffering it.
+  void UpdateConsumption(int64_t bytes);
+
+  // Buffers a change of the consumption of this tracker by 'bytes' in the
+  // calling thread's buffer, applying it if the buffer entry is full.
+  void BufferConsumption(int64_t bytes);
+
+  // The changes of consumption buffered by a thread. Defined in the .cc file.
+  class ThreadBuffer;
+  DECLARE_STATIC_THREAD_LOCAL(ThreadBuffer, tls_buffer_);
+
   int64_t limit_;
   const std::string id_;
   const std::string descr_;
@@ -181,6 +208,10 @@ class MemTracker : public std::enable_shared_from_this<MemTracker> {
 
   HighWaterMark consumption_;
 
+  // A number unique to this tracker in the process, to tell apart from it the
+  // trackers later allocated at the same address in the threads' buffers.
+  const int64_t serial_;
+
   // this tracker plus all of its ancestors
   std::vector<MemTracker*> all_trackers_;
   // all_trackers_ with valid limits
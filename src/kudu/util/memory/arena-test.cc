@@ -40,6 +40,7 @@ namespace kudu {
 using std::shared_ptr;
 using std::string;
 using std::thread;
+using std::unique_ptr;
 using std::vector;
 
 template<class ArenaType>
@@ -189,6 +190,99 @@ TEST(TestArena, TestMemoryTrackingEnforced) {
   ASSERT_EQ(256, mem_tracker->consumption());
 }
 
+// Test that the arena may grow to components backed by huge pages, and that
+// their memory is tracked.
+TEST(TestArena, TestHugePageAllocator) {
+  const size_t kHugePageSize = HugePageBufferAllocator::kHugePageSize;
+  HugePageBufferAllocator hugepage_allocator(HugePageBufferAllocator::TRANSPARENT);
+  shared_ptr<MemTracker> mem_tracker = MemTracker::CreateTracker(-1, "arena-test-tracker");
+  shared_ptr<MemoryTrackingBufferAllocator> allocator(
+      new MemoryTrackingBufferAllocator(&hugepage_allocator, mem_tracker));
+  {
+    MemoryTrackingArena arena(256, allocator);
+    arena.SetMaxBufferSize(4 * kHugePageSize);
+    size_t total = 0;
+    while (total < 8 * kHugePageSize) {
+      uint8_t* allocated = static_cast<uint8_t*>(arena.AllocateBytes(4096));
+      ASSERT_TRUE(allocated);
+      memset(allocated, 0xff, 4096);
+      total += 4096;
+    }
+    ASSERT_GE(arena.memory_footprint(), total);
+    ASSERT_EQ(arena.memory_footprint(), mem_tracker->consumption());
+
+    // Allocations larger than the components are served too.
+    void* allocated = arena.AllocateBytes(5 * kHugePageSize + 1);
+    ASSERT_TRUE(allocated);
+    memset(allocated, 0xff, 5 * kHugePageSize + 1);
+    ASSERT_EQ(arena.memory_footprint(), mem_tracker->consumption());
+  }
+  ASSERT_EQ(0, mem_tracker->consumption());
+
+  // Buffers may be reallocated across the size threshold, keeping their
+  // contents.
+  unique_ptr<Buffer> buffer(hugepage_allocator.Allocate(16));
+  ASSERT_TRUE(buffer);
+  memset(buffer->data(), 0xab, 16);
+  ASSERT_TRUE(hugepage_allocator.Reallocate(kHugePageSize + 1, buffer.get()));
+  ASSERT_EQ(kHugePageSize + 1, buffer->size());
+  ASSERT_EQ(0xab, static_cast<uint8_t*>(buffer->data())[15]);
+  memset(buffer->data(), 0xcd, kHugePageSize + 1);
+  ASSERT_TRUE(hugepage_allocator.Reallocate(32, buffer.get()));
+  ASSERT_EQ(32, buffer->size());
+  ASSERT_EQ(0xcd, static_cast<uint8_t*>(buffer->data())[31]);
+}
+
+TEST(TestArena, TestPoolingBufferAllocator) {
+  PoolingBufferAllocator* pool = PoolingBufferAllocator::Get();
+  pool->ReleaseCachedBuffers();
+  ASSERT_EQ(0, pool->cached_bytes());
+
+  // The requests are rounded up to their size class, and the freed buffers
+  // are reused by the requests of the same class.
+  unique_ptr<Buffer> buffer(pool->Allocate(1000));
+  ASSERT_TRUE(buffer);
+  ASSERT_EQ(1024, buffer->size());
+  void* data = buffer->data();
+  buffer.reset();
+  ASSERT_EQ(1024, pool->cached_bytes());
+  buffer.reset(pool->Allocate(513));
+  ASSERT_EQ(data, buffer->data());
+  ASSERT_EQ(0, pool->cached_bytes());
+
+  // So are the buffers freed by other threads.
+  thread t([&]() { buffer.reset(); });
+  t.join();
+  ASSERT_EQ(1024, pool->cached_bytes());
+  buffer.reset(pool->Allocate(1024));
+  ASSERT_EQ(data, buffer->data());
+  buffer.reset();
+
+  // The larger buffers aren't pooled.
+  const size_t kLargeSize = PoolingBufferAllocator::kMaxClassSize + 1;
+  buffer.reset(pool->Allocate(kLargeSize));
+  ASSERT_EQ(kLargeSize, buffer->size());
+  buffer.reset();
+  ASSERT_EQ(1024, pool->cached_bytes());
+
+  // The components of the arenas are pooled once they're destructed.
+  size_t footprint;
+  {
+    Arena arena(pool, 32 * 1024);
+    for (int i = 0; i < 100; i++) {
+      ASSERT_TRUE(arena.AllocateBytes(4096));
+    }
+    footprint = arena.memory_footprint();
+  }
+  ASSERT_EQ(1024 + footprint, pool->cached_bytes());
+  {
+    Arena arena(pool, 32 * 1024);
+    ASSERT_LT(pool->cached_bytes(), 1024 + footprint);
+  }
+  pool->ReleaseCachedBuffers();
+  ASSERT_EQ(0, pool->cached_bytes());
+}
+
 TEST(TestArena, TestSTLAllocator) {
   Arena a(256);
   typedef vector<int, ArenaAllocator<int, false> > ArenaVector;
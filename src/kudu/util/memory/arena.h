@@ -99,7 +99,9 @@ class ArenaBase {
   explicit ArenaBase(size_t initial_buffer_size);
 
   // Set the maximum buffer size allocated for this arena.
-  // The maximum buffer size allowed is slightly less than ~1MB (8192 * 127 bytes).
+  // The maximum buffer size allowed is slightly less than ~1MB (8192 * 127 bytes),
+  // unless the buffers are allocated by a HugePageBufferAllocator, since
+  // larger heap allocations don't take the fast path of tcmalloc.
   //
   // Consider the following pros/cons of large buffer sizes:
   //
@@ -295,6 +297,10 @@ class Arena : public ArenaBase<false> {
   explicit Arena(size_t initial_buffer_size) :
     ArenaBase<false>(initial_buffer_size)
   {}
+
+  Arena(BufferAllocator* buffer_allocator, size_t initial_buffer_size) :
+    ArenaBase<false>(buffer_allocator, initial_buffer_size)
+  {}
 };
 
 class ThreadSafeArena : public ArenaBase<true> {
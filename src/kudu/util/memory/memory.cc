@@ -21,19 +21,32 @@
 #include "kudu/util/memory/memory.h"
 
 #include <mm_malloc.h>
+#include <strings.h>
+#include <sys/mman.h>
 
 #include <algorithm>
+#include <cerrno>
 #include <cstdlib>
 #include <cstring>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <gflags/gflags.h>
 
+#include "kudu/gutil/bits.h"
 #include "kudu/util/alignment.h"
+#include "kudu/util/errno.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/logging.h"
 #include "kudu/util/memory/overwrite.h"
 #include "kudu/util/mem_tracker.h"
+#include "kudu/util/os-util.h"
+#include "kudu/util/status.h"
 
 using std::copy;
+using std::lock_guard;
 using std::min;
 
 // TODO(onufry) - test whether the code still tests OK if we set this to true,
@@ -44,6 +57,43 @@ DEFINE_bool(allocator_aligned_mode, false,
             "unless explicitly specified otherwise - to boost SIMD");
 TAG_FLAG(allocator_aligned_mode, hidden);
 
+DEFINE_string(memory_hugepages, "none",
+              "Whether to back large memory buffers, such as the larger "
+              "components of the MemRowSet arenas, with 2MB huge pages to "
+              "reduce TLB misses. One of 'none', 'transparent' (transparent "
+              "huge pages, which must be enabled in 'madvise' or 'always' "
+              "mode) or 'explicit' (huge pages reserved through "
+              "/proc/sys/vm/nr_hugepages).");
+TAG_FLAG(memory_hugepages, experimental);
+
+static bool ValidateMemoryHugepages(const char* /*flagname*/, const std::string& value) {
+  if (strcasecmp(value.c_str(), "none") == 0 ||
+      strcasecmp(value.c_str(), "transparent") == 0 ||
+      strcasecmp(value.c_str(), "explicit") == 0) {
+    return true;
+  }
+  LOG(ERROR) << "Invalid value for --memory_hugepages: " << value
+             << ". Available values are 'none', 'transparent' and 'explicit'.";
+  return false;
+}
+DEFINE_validator(memory_hugepages, &ValidateMemoryHugepages);
+
+DEFINE_bool(memory_hugepages_numa_local, false,
+            "Whether the memory buffers backed by huge pages (see "
+            "--memory_hugepages) are allocated on the NUMA node of the thread "
+            "which allocates them, whatever the memory policy of the process. "
+            "The MemRowSet arenas then grow on the node of the threads which "
+            "apply the writes to them.");
+TAG_FLAG(memory_hugepages_numa_local, experimental);
+
+DEFINE_int64(buffer_pool_capacity_mb, 128,
+             "The maximum memory of the freed buffers kept to be reused by the "
+             "arenas and the row blocks of the scan and write requests, in "
+             "megabytes. 0 disables the pooling of these buffers.");
+TAG_FLAG(buffer_pool_capacity_mb, advanced);
+DEFINE_validator(buffer_pool_capacity_mb,
+                 [](const char* /*flagname*/, int64_t value) { return value >= 0; });
+
 namespace kudu {
 
 namespace {
@@ -168,6 +218,280 @@ void* HeapBufferAllocator::Realloc(void* previous_data, size_t previous_size,
   }
 }
 
+HugePageBufferAllocator::HugePageBufferAllocator()
+    : mode_(strcasecmp(FLAGS_memory_hugepages.c_str(), "transparent") == 0 ? TRANSPARENT :
+            strcasecmp(FLAGS_memory_hugepages.c_str(), "explicit") == 0 ? EXPLICIT : NONE) {
+}
+
+void* HugePageBufferAllocator::Map(size_t size) {
+  const size_t length = KUDU_ALIGN_UP(size, kHugePageSize);
+  void* data;
+#if defined(MAP_HUGETLB)
+  if (mode_ == EXPLICIT) {
+    data = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data != MAP_FAILED) {
+      BindToLocalNode(data, length);
+      return data;
+    }
+    KLOG_EVERY_N_SECS(WARNING, 60) << "Could not map " << length << " bytes of reserved "
+                                   << "huge pages, using transparent huge pages instead: "
+                                   << ErrnoToString(errno);
+  }
+#endif
+  data = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (data == MAP_FAILED) {
+    return nullptr;
+  }
+#if defined(MADV_HUGEPAGE)
+  // Failing is harmless: the memory is just backed by regular pages.
+  madvise(data, length, MADV_HUGEPAGE);
+#endif
+  BindToLocalNode(data, length);
+  return data;
+}
+
+void HugePageBufferAllocator::BindToLocalNode(void* data, size_t length) {
+  if (!FLAGS_memory_hugepages_numa_local) {
+    return;
+  }
+  // The pages aren't touched yet, so they're all allocated on the node.
+  Status s = BindMemoryToCurrentNumaNode(data, length);
+  if (PREDICT_FALSE(!s.ok())) {
+    KLOG_EVERY_N_SECS(WARNING, 60) << "Could not allocate huge pages on the local NUMA node: "
+                                   << s.ToString();
+  }
+}
+
+void HugePageBufferAllocator::Unmap(void* data, size_t size) {
+  PCHECK(munmap(data, KUDU_ALIGN_UP(size, kHugePageSize)) == 0);
+}
+
+Buffer* HugePageBufferAllocator::AllocateInternal(size_t requested,
+                                                  size_t minimal,
+                                                  BufferAllocator* originator) {
+  DCHECK_LE(minimal, requested);
+  if (!IsMapped(requested)) {
+    return DelegateAllocate(HeapBufferAllocator::Get(), requested, minimal, originator);
+  }
+  // Buffers of at least kHugePageSize bytes are always mapped, so that
+  // FreeInternal() can tell them apart by their size.
+  void* data = Map(requested);
+  if (data == nullptr) {
+    return nullptr;
+  }
+  return CreateBuffer(data, requested, originator);
+}
+
+bool HugePageBufferAllocator::ReallocateInternal(size_t requested,
+                                                 size_t minimal,
+                                                 Buffer* buffer,
+                                                 BufferAllocator* originator) {
+  DCHECK_LE(minimal, requested);
+  if (!IsMapped(buffer->size()) && !IsMapped(requested)) {
+    return DelegateReallocate(HeapBufferAllocator::Get(), requested, minimal, buffer,
+                              originator);
+  }
+  // Allocate-copy-free, keeping the buffer on the same side of the size
+  // threshold as its data.
+  void* data;
+  if (IsMapped(requested)) {
+    data = Map(requested);
+  } else {
+    data = (requested == 0) ? &dummy_buffer[0] : malloc(requested);
+  }
+  if (data == nullptr) {
+    return false;
+  }
+  memcpy(data, buffer->data(), min(buffer->size(), requested));
+  FreeInternal(buffer);
+  UpdateBuffer(data, requested, buffer);
+  return true;
+}
+
+void HugePageBufferAllocator::FreeInternal(Buffer* buffer) {
+  if (IsMapped(buffer->size())) {
+    Unmap(buffer->data(), buffer->size());
+  } else {
+    DelegateFree(HeapBufferAllocator::Get(), buffer);
+  }
+}
+
+// The buffers cached by a thread, at most kDepth of each class.
+class PoolingBufferAllocator::ThreadCache {
+ public:
+  static constexpr int kDepth = 8;
+
+  explicit ThreadCache(PoolingBufferAllocator* pool)
+      : pool_(pool) {
+    for (int i = 0; i < kNumClasses; i++) {
+      counts_[i] = 0;
+    }
+  }
+
+  // The buffers stay cached, and charged to the pool's MemTracker, once the
+  // thread exits: they're handed over to the shared cache.
+  ~ThreadCache() {
+    for (int i = 0; i < kNumClasses; i++) {
+      SharedCache* shared = &pool_->shared_[i];
+      lock_guard<simple_spinlock> l(shared->lock);
+      shared->buffers.insert(shared->buffers.end(), buffers_[i], buffers_[i] + counts_[i]);
+    }
+  }
+
+  void* Pop(int size_class) {
+    int* count = &counts_[size_class];
+    return *count > 0 ? buffers_[size_class][--*count] : nullptr;
+  }
+
+  bool Push(int size_class, void* data) {
+    int* count = &counts_[size_class];
+    if (*count == kDepth) {
+      return false;
+    }
+    buffers_[size_class][(*count)++] = data;
+    return true;
+  }
+
+  // Moves the cached buffers to 'buffers'.
+  void Clear(std::vector<std::pair<int, void*>>* buffers) {
+    for (int i = 0; i < kNumClasses; i++) {
+      for (int j = 0; j < counts_[i]; j++) {
+        buffers->emplace_back(i, buffers_[i][j]);
+      }
+      counts_[i] = 0;
+    }
+  }
+
+ private:
+  PoolingBufferAllocator* const pool_;
+  int counts_[kNumClasses];
+  void* buffers_[kNumClasses][kDepth];
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadCache);
+};
+
+DEFINE_STATIC_THREAD_LOCAL(PoolingBufferAllocator::ThreadCache, PoolingBufferAllocator,
+                           tls_cache_);
+
+PoolingBufferAllocator::PoolingBufferAllocator()
+    : enabled_(FLAGS_buffer_pool_capacity_mb > 0),
+      mem_tracker_(MemTracker::FindOrCreateGlobalTracker(
+          FLAGS_buffer_pool_capacity_mb * 1024 * 1024, "buffer_pool")) {
+  static_assert(kMinClassSize << (kNumClasses - 1) == kMaxClassSize,
+                "kNumClasses doesn't match the class sizes");
+}
+
+PoolingBufferAllocator::~PoolingBufferAllocator() {
+  ReleaseCachedBuffers();
+}
+
+int PoolingBufferAllocator::RequestClass(size_t size) {
+  if (size > kMaxClassSize) {
+    return -1;
+  }
+  if (size <= kMinClassSize) {
+    return 0;
+  }
+  // The index of the smallest power of two which is at least 'size'.
+  return Bits::Log2Ceiling64(size) - Bits::Log2Floor64(kMinClassSize);
+}
+
+int PoolingBufferAllocator::BufferClass(size_t size) {
+  if (size < kMinClassSize || size > kMaxClassSize || (size & (size - 1)) != 0) {
+    return -1;
+  }
+  return Bits::Log2Floor64(size) - Bits::Log2Floor64(kMinClassSize);
+}
+
+int64_t PoolingBufferAllocator::cached_bytes() const {
+  return mem_tracker_->consumption();
+}
+
+void* PoolingBufferAllocator::Pop(int size_class) {
+  void* data = tls_cache_ ? tls_cache_->Pop(size_class) : nullptr;
+  if (!data) {
+    SharedCache* shared = &shared_[size_class];
+    lock_guard<simple_spinlock> l(shared->lock);
+    if (shared->buffers.empty()) {
+      return nullptr;
+    }
+    data = shared->buffers.back();
+    shared->buffers.pop_back();
+  }
+  mem_tracker_->Release(ClassSize(size_class));
+  return data;
+}
+
+void PoolingBufferAllocator::Push(int size_class, void* data) {
+  if (!mem_tracker_->TryConsume(ClassSize(size_class))) {
+    free(data);
+    return;
+  }
+  // The threads which free without ever allocating, e.g. those releasing the
+  // write transactions, don't need a cache of their own.
+  if (tls_cache_ && tls_cache_->Push(size_class, data)) {
+    return;
+  }
+  SharedCache* shared = &shared_[size_class];
+  lock_guard<simple_spinlock> l(shared->lock);
+  shared->buffers.push_back(data);
+}
+
+void PoolingBufferAllocator::ReleaseCachedBuffers() {
+  std::vector<std::pair<int, void*>> buffers;
+  if (tls_cache_) {
+    tls_cache_->Clear(&buffers);
+  }
+  for (int i = 0; i < kNumClasses; i++) {
+    SharedCache* shared = &shared_[i];
+    lock_guard<simple_spinlock> l(shared->lock);
+    for (void* data : shared->buffers) {
+      buffers.emplace_back(i, data);
+    }
+    shared->buffers.clear();
+  }
+  for (const auto& buffer : buffers) {
+    free(buffer.second);
+    mem_tracker_->Release(ClassSize(buffer.first));
+  }
+}
+
+Buffer* PoolingBufferAllocator::AllocateInternal(size_t requested,
+                                                 size_t minimal,
+                                                 BufferAllocator* originator) {
+  DCHECK_LE(minimal, requested);
+  const int size_class = enabled_ ? RequestClass(requested) : -1;
+  if (size_class < 0) {
+    return DelegateAllocate(HeapBufferAllocator::Get(), requested, minimal, originator);
+  }
+  INIT_STATIC_THREAD_LOCAL(ThreadCache, tls_cache_, this);
+  const size_t size = ClassSize(size_class);
+  void* data = Pop(size_class);
+  if (data) {
+    return CreateBuffer(data, size, originator);
+  }
+  return DelegateAllocate(HeapBufferAllocator::Get(), size, size, originator);
+}
+
+bool PoolingBufferAllocator::ReallocateInternal(size_t requested,
+                                                size_t minimal,
+                                                Buffer* buffer,
+                                                BufferAllocator* originator) {
+  // The pooled buffers come from the heap too: they're freed by size.
+  return DelegateReallocate(HeapBufferAllocator::Get(), requested, minimal, buffer,
+                            originator);
+}
+
+void PoolingBufferAllocator::FreeInternal(Buffer* buffer) {
+  const int size_class = BufferClass(buffer->size());
+  if (size_class < 0) {
+    DelegateFree(HeapBufferAllocator::Get(), buffer);
+    return;
+  }
+  Push(size_class, buffer->data());
+}
+
 Buffer* ClearingBufferAllocator::AllocateInternal(size_t requested,
                                                   size_t minimal,
                                                   BufferAllocator* originator) {
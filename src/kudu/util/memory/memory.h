@@ -43,8 +43,10 @@
 #include <glog/logging.h>
 
 #include "kudu/util/boost_mutex_utils.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/memory/overwrite.h"
 #include "kudu/util/mutex.h"
+#include "kudu/util/threadlocal.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
@@ -285,6 +287,171 @@ class HeapBufferAllocator : public BufferAllocator {
   DISALLOW_COPY_AND_ASSIGN(HeapBufferAllocator);
 };
 
+// Allocates large buffers from memory mapped with 2MB huge pages, so that
+// scanning them incurs fewer TLB misses, and delegates the allocation of the
+// others to HeapBufferAllocator.
+//
+// Only buffers of at least kHugePageSize bytes are mapped: their mappings are
+// rounded up to a multiple of kHugePageSize. With TRANSPARENT, the mappings
+// are advised to be backed by transparent huge pages. With EXPLICIT, they
+// come from the pool of huge pages reserved by the administrator (see
+// /proc/sys/vm/nr_hugepages), falling back to transparent huge pages if the
+// pool is exhausted. With --memory_hugepages_numa_local, the mappings are
+// allocated on the NUMA node of the thread which maps them.
+class HugePageBufferAllocator : public BufferAllocator {
+ public:
+  enum Mode {
+    // Don't use huge pages: all buffers are allocated from the heap.
+    NONE,
+    TRANSPARENT,
+    EXPLICIT
+  };
+
+  static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+  explicit HugePageBufferAllocator(Mode mode)
+      : mode_(mode) {
+  }
+
+  virtual ~HugePageBufferAllocator() {}
+
+  // Returns a singleton instance of the allocator, using huge pages as
+  // configured by --memory_hugepages.
+  static HugePageBufferAllocator* Get() {
+    return Singleton<HugePageBufferAllocator>::get();
+  }
+
+  Mode mode() const { return mode_; }
+
+  virtual size_t Available() const OVERRIDE {
+    return std::numeric_limits<size_t>::max();
+  }
+
+ private:
+  friend class Singleton<HugePageBufferAllocator>;
+
+  HugePageBufferAllocator();
+
+  // Whether a buffer of the given size is, or should be, mapped.
+  bool IsMapped(size_t size) const {
+    return mode_ != NONE && size >= kHugePageSize;
+  }
+
+  // Maps 'size' bytes, rounded up to a multiple of kHugePageSize. Returns
+  // NULL on failure.
+  void* Map(size_t size);
+  static void Unmap(void* data, size_t size);
+
+  // Binds the mapping of 'length' bytes at 'data' to the NUMA node of the
+  // calling thread, if --memory_hugepages_numa_local is set.
+  static void BindToLocalNode(void* data, size_t length);
+
+  virtual Buffer* AllocateInternal(size_t requested,
+                                   size_t minimal,
+                                   BufferAllocator* originator) OVERRIDE;
+
+  virtual bool ReallocateInternal(size_t requested,
+                                  size_t minimal,
+                                  Buffer* buffer,
+                                  BufferAllocator* originator) OVERRIDE;
+
+  virtual void FreeInternal(Buffer* buffer) OVERRIDE;
+
+  const Mode mode_;
+
+  DISALLOW_COPY_AND_ASSIGN(HugePageBufferAllocator);
+};
+
+// Keeps the buffers freed by its users to hand them out again, so that the
+// arenas and row blocks set up and torn down for each scan or write request
+// reuse warm memory rather than going through the heap and faulting in new
+// pages. The buffers come from HeapBufferAllocator.
+//
+// The requests are rounded up to size classes, the powers of two from
+// kMinClassSize to kMaxClassSize bytes. The larger ones aren't pooled. Each
+// thread keeps a few freed buffers of each class, in front of a cache shared
+// by all the threads, since the buffers are often freed by other threads than
+// the ones which allocated them. The memory of the cached buffers is charged
+// to the "buffer_pool" MemTracker, limited by --buffer_pool_capacity_mb: the
+// buffers freed beyond that limit are returned to the heap.
+//
+// This class is thread-safe.
+class PoolingBufferAllocator : public BufferAllocator {
+ public:
+  static constexpr size_t kMinClassSize = 256;
+  static constexpr size_t kMaxClassSize = 1024 * 1024;
+
+  virtual ~PoolingBufferAllocator();
+
+  // Returns a singleton instance of the allocator.
+  static PoolingBufferAllocator* Get() {
+    return Singleton<PoolingBufferAllocator>::get();
+  }
+
+  virtual size_t Available() const OVERRIDE {
+    return std::numeric_limits<size_t>::max();
+  }
+
+  // Returns the number of bytes of the buffers cached by all the threads.
+  int64_t cached_bytes() const;
+
+  // Returns the buffers cached by the current thread and by the shared cache
+  // to the heap.
+  void ReleaseCachedBuffers();
+
+ private:
+  friend class Singleton<PoolingBufferAllocator>;
+  class ThreadCache;
+
+  static constexpr int kNumClasses = 13;
+
+  // The buffers of a size class cached by all the threads.
+  struct SharedCache {
+    simple_spinlock lock;
+    std::vector<void*> buffers;
+  };
+
+  PoolingBufferAllocator();
+
+  // Returns the size class of the requests of 'size' bytes, or -1 if they
+  // aren't pooled.
+  static int RequestClass(size_t size);
+
+  // Returns the size class of a buffer of exactly 'size' bytes, or -1 if it
+  // isn't pooled.
+  static int BufferClass(size_t size);
+
+  static size_t ClassSize(int size_class) {
+    return kMinClassSize << size_class;
+  }
+
+  // Returns a cached buffer of the given class, or nullptr if there's none.
+  void* Pop(int size_class);
+
+  // Caches a buffer of the given class, or frees it if the pool is full.
+  void Push(int size_class, void* data);
+
+  virtual Buffer* AllocateInternal(size_t requested,
+                                   size_t minimal,
+                                   BufferAllocator* originator) OVERRIDE;
+
+  virtual bool ReallocateInternal(size_t requested,
+                                  size_t minimal,
+                                  Buffer* buffer,
+                                  BufferAllocator* originator) OVERRIDE;
+
+  virtual void FreeInternal(Buffer* buffer) OVERRIDE;
+
+  // Whether the buffers are pooled at all, see --buffer_pool_capacity_mb.
+  const bool enabled_;
+  const std::shared_ptr<MemTracker> mem_tracker_;
+  SharedCache shared_[kNumClasses];
+
+  DECLARE_STATIC_THREAD_LOCAL(ThreadCache, tls_cache_);
+
+  DISALLOW_COPY_AND_ASSIGN(PoolingBufferAllocator);
+};
+
 // Wrapper around the delegate allocator, that clears all newly allocated
 // (and reallocated) memory.
 class ClearingBufferAllocator : public BufferAllocator {
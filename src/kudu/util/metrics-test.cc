@@ -16,8 +16,10 @@
 // under the License.
 
 #include <cstdint>
+#include <memory>
 #include <ostream>
 #include <string>
+#include <thread>
 #include <unordered_set>
 #include <vector>
 
@@ -32,6 +34,7 @@
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/util/hdr_histogram.h"
+#include "kudu/util/histogram.pb.h"
 #include "kudu/util/jsonreader.h"
 #include "kudu/util/jsonwriter.h"
 #include "kudu/util/metrics.h"
@@ -41,6 +44,8 @@
 #include "kudu/util/test_util.h"
 
 using std::string;
+using std::thread;
+using std::unique_ptr;
 using std::unordered_set;
 using std::vector;
 
@@ -176,6 +181,40 @@ TEST_F(MetricsTest, SimpleHistogramTest) {
   // TODO: Test coverage needs to be improved a lot.
 }
 
+METRIC_DEFINE_histogram(test_entity, test_striped_hist, "Test Striped Histogram",
+                        MetricUnit::kMilliseconds, "foo", 1000000, 3,
+                        kudu::STRIPED);
+
+TEST_F(MetricsTest, StripedHistogramTest) {
+  scoped_refptr<Histogram> hist = METRIC_test_striped_hist.Instantiate(entity_);
+  const int kNumThreads = 8;
+  const int kNumIncrements = 10000;
+  vector<thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&hist, i]() {
+      for (int j = 0; j < kNumIncrements; j++) {
+        hist->Increment(i + 1);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  // The values of all the stripes are merged when read.
+  ASSERT_EQ(kNumThreads * kNumIncrements, hist->TotalCount());
+  ASSERT_EQ(1, hist->MinValueForTests());
+  ASSERT_EQ(kNumThreads, hist->MaxValueForTests());
+  ASSERT_EQ(kNumIncrements, hist->CountInBucketForValueForTests(kNumThreads));
+  unique_ptr<HdrHistogram> merged = hist->MergedHistogram();
+  ASSERT_EQ(kNumIncrements * kNumThreads * (kNumThreads + 1) / 2, merged->TotalSum());
+
+  HistogramSnapshotPB snapshot;
+  ASSERT_OK(hist->GetHistogramSnapshotPB(&snapshot, MetricJsonOptions()));
+  ASSERT_EQ(kNumThreads * kNumIncrements, snapshot.total_count());
+  ASSERT_EQ(kNumThreads, snapshot.max());
+}
+
 TEST_F(MetricsTest, JsonPrintTest) {
   scoped_refptr<Counter> test_counter = METRIC_test_counter.Instantiate(entity_);
   test_counter->Increment();
@@ -222,6 +261,67 @@ TEST_F(MetricsTest, JsonPrintTest) {
   ASSERT_STR_CONTAINS(METRIC_test_counter.name(), out.str());
 }
 
+METRIC_DEFINE_gauge_string(test_entity, test_string_gauge, "Test String Gauge",
+                           MetricUnit::kState, "Description of string gauge");
+
+static string MyStringFunction() {
+  return "foo";
+}
+
+TEST_F(MetricsTest, PrometheusPrintTest) {
+  scoped_refptr<Counter> counter = METRIC_test_counter.Instantiate(entity_);
+  counter->IncrementBy(3);
+  scoped_refptr<Histogram> hist = METRIC_test_hist.Instantiate(entity_);
+  hist->Increment(10);
+  scoped_refptr<FunctionGauge<string>> string_gauge =
+      METRIC_test_string_gauge.InstantiateFunctionGauge(entity_, Bind(&MyStringFunction));
+  entity_->SetAttribute("table_name", "my \"table\"");
+
+  scoped_refptr<MetricEntity> other_entity =
+      METRIC_ENTITY_test_entity.Instantiate(&registry_, "other-test");
+  other_entity->SetAttribute("table_name", "my \"table\"");
+  scoped_refptr<Counter> other_counter = METRIC_test_counter.Instantiate(other_entity);
+  other_counter->IncrementBy(4);
+  scoped_refptr<Histogram> other_hist = METRIC_test_hist.Instantiate(other_entity);
+  other_hist->Increment(20);
+
+  std::ostringstream out;
+  ASSERT_OK(registry_.WriteAsPrometheus(&out, { "*" }, MetricPrometheusOptions()));
+  string output = out.str();
+  ASSERT_STR_CONTAINS(output, "# HELP kudu_test_entity_test_counter Description of test counter\n"
+                              "# TYPE kudu_test_entity_test_counter counter\n");
+  ASSERT_STR_CONTAINS(output,
+      "kudu_test_entity_test_counter{id=\"my-test\",table_name=\"my \\\"table\\\"\"} 3\n");
+  ASSERT_STR_CONTAINS(output,
+      "kudu_test_entity_test_counter{id=\"other-test\",table_name=\"my \\\"table\\\"\"} 4\n");
+  ASSERT_STR_CONTAINS(output, "# TYPE kudu_test_entity_test_hist summary\n");
+  ASSERT_STR_CONTAINS(output, "kudu_test_entity_test_hist_count{id=\"my-test\"");
+  // Each family is only described once, and string gauges aren't written.
+  ASSERT_EQ(output.find("# TYPE kudu_test_entity_test_counter"),
+            output.rfind("# TYPE kudu_test_entity_test_counter"));
+  ASSERT_STR_NOT_CONTAINS(output, "test_string_gauge");
+
+  // The metrics may be summed by table.
+  MetricPrometheusOptions opts;
+  opts.merge_by_attribute = "table_name";
+  out.str("");
+  ASSERT_OK(registry_.WriteAsPrometheus(&out, { "test_counter", "test_hist" }, opts));
+  output = out.str();
+  ASSERT_STR_CONTAINS(output,
+      "kudu_test_entity_test_counter{table_name=\"my \\\"table\\\"\"} 7\n");
+  ASSERT_STR_CONTAINS(output,
+      "kudu_test_entity_test_hist_sum{table_name=\"my \\\"table\\\"\"} 30\n");
+  ASSERT_STR_CONTAINS(output,
+      "kudu_test_entity_test_hist_count{table_name=\"my \\\"table\\\"\"} 2\n");
+  ASSERT_STR_NOT_CONTAINS(output, "id=");
+
+  // Entities of other types are filtered out.
+  opts.entity_types = { "server" };
+  out.str("");
+  ASSERT_OK(registry_.WriteAsPrometheus(&out, { "*" }, opts));
+  ASSERT_EQ("", out.str());
+}
+
 // Test that metrics are retired when they are no longer referenced.
 TEST_F(MetricsTest, RetirementTest) {
   FLAGS_metrics_retirement_age_ms = 100;
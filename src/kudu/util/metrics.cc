@@ -16,8 +16,13 @@
 // under the License.
 #include "kudu/util/metrics.h"
 
+#include <sched.h>
+
+#include <algorithm>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <sstream>
 #include <utility>
 
 #include <gflags/gflags.h>
@@ -25,7 +30,9 @@
 
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/singleton.h"
+#include "kudu/gutil/strings/numbers.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/sysinfo.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/hdr_histogram.h"
 #include "kudu/util/histogram.pb.h"
@@ -45,6 +52,7 @@ METRIC_DEFINE_entity(server);
 namespace kudu {
 
 using std::string;
+using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
 
@@ -203,6 +211,58 @@ bool MatchMetricInList(const string& metric_name,
   return false;
 }
 
+// Writes 'str' to 'out', escaping the backslashes and the line feeds, and the
+// double quotes too if 'escape_quotes' is true, as in the Prometheus format.
+void WritePrometheusEscaped(const string& str, bool escape_quotes, std::ostream* out) {
+  for (char c : str) {
+    if (c == '\\') {
+      *out << "\\\\";
+    } else if (c == '\n') {
+      *out << "\\n";
+    } else if (c == '"' && escape_quotes) {
+      *out << "\\\"";
+    } else {
+      *out << c;
+    }
+  }
+}
+
+// Writes the label 'name' with the value 'value', preceded by a comma unless
+// it's the first label of the sample.
+void WritePrometheusLabel(const string& name, const string& value,
+                          bool first, std::ostream* out) {
+  if (!first) {
+    *out << ',';
+  }
+  *out << name << "=\"";
+  WritePrometheusEscaped(value, true, out);
+  *out << '"';
+}
+
+// The samples of a Prometheus metric family.
+struct PrometheusFamily {
+  const MetricPrototype* prototype = nullptr;
+
+  // Map from the labels of the samples to their values. Ordered so that the
+  // output is deterministic.
+  std::map<string, PrometheusValue> samples;
+};
+
+// Writes the quantiles, sum and count of the summary 'name' for the values of
+// 'hist', which may be null if no value was recorded.
+void WritePrometheusSummary(const string& name, const string& labels,
+                            const HdrHistogram* hist, std::ostream* out) {
+  static const char* const kQuantiles[] = { "0.75", "0.95", "0.99", "0.999", "0.9999" };
+  static const double kPercentiles[] = { 75, 95, 99, 99.9, 99.99 };
+  const bool empty = hist == nullptr || hist->TotalCount() == 0;
+  for (size_t i = 0; i < arraysize(kQuantiles); i++) {
+    *out << name << '{' << labels << ",quantile=\"" << kQuantiles[i] << "\"} "
+         << (empty ? 0 : hist->ValueAtPercentile(kPercentiles[i])) << '\n';
+  }
+  *out << name << "_sum{" << labels << "} " << (empty ? 0 : hist->TotalSum()) << '\n';
+  *out << name << "_count{" << labels << "} " << (empty ? 0 : hist->TotalCount()) << '\n';
+}
+
 } // anonymous namespace
 
 
@@ -368,6 +428,105 @@ Status MetricRegistry::WriteAsJson(JsonWriter* writer,
   return Status::OK();
 }
 
+Status MetricRegistry::WriteAsPrometheus(std::ostream* out,
+                                         const vector<string>& requested_metrics,
+                                         const MetricPrometheusOptions& opts) const {
+  EntityMap entities;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    entities = entities_;
+  }
+
+  // Unlike the JSON output, which is written entity by entity, the samples
+  // are grouped by metric so that each family is written once.
+  std::map<string, PrometheusFamily> families;
+  for (const auto& e : entities) {
+    const MetricEntity& entity = *e.second;
+    if (!opts.entity_types.empty() &&
+        std::find(opts.entity_types.begin(), opts.entity_types.end(),
+                  entity.prototype_->name()) == opts.entity_types.end()) {
+      continue;
+    }
+    bool select_all = MatchMetricInList(entity.id(), requested_metrics);
+
+    // Snapshot the metrics of the entity, as in MetricEntity::WriteAsJson().
+    vector<scoped_refptr<Metric>> metrics;
+    MetricEntity::AttributeMap attrs;
+    {
+      std::lock_guard<simple_spinlock> l(entity.lock_);
+      attrs = entity.attributes_;
+      for (const auto& val : entity.metric_map_) {
+        if (select_all || MatchMetricInList(val.first->name(), requested_metrics)) {
+          metrics.push_back(val.second);
+        }
+      }
+    }
+    if (metrics.empty()) {
+      continue;
+    }
+
+    std::ostringstream labels;
+    const string* merge_value = opts.merge_by_attribute.empty() ?
+        nullptr : FindOrNull(attrs, opts.merge_by_attribute);
+    if (merge_value) {
+      WritePrometheusLabel(opts.merge_by_attribute, *merge_value, true, &labels);
+    } else {
+      WritePrometheusLabel("id", entity.id(), true, &labels);
+      std::map<string, string> sorted_attrs(attrs.begin(), attrs.end());
+      for (const auto& attr : sorted_attrs) {
+        WritePrometheusLabel(attr.first, attr.second, false, &labels);
+      }
+    }
+    const string labels_str = labels.str();
+
+    for (const auto& m : metrics) {
+      if (!opts.include_untouched_metrics && m->IsUntouched()) {
+        continue;
+      }
+      const MetricPrototype* prototype = m->prototype();
+      PrometheusFamily* family = &families[Substitute("kudu_$0_$1",
+                                                      prototype->entity_type(),
+                                                      prototype->name())];
+      family->prototype = prototype;
+      PrometheusValue* value = FindOrNull(family->samples, labels_str);
+      if (value) {
+        m->MergePrometheusValue(value);
+        continue;
+      }
+      PrometheusValue new_value;
+      if (m->MergePrometheusValue(&new_value)) {
+        family->samples.emplace(labels_str, std::move(new_value));
+      }
+    }
+  }
+
+  for (const auto& f : families) {
+    const string& name = f.first;
+    const PrometheusFamily& family = f.second;
+    if (family.samples.empty()) {
+      continue;
+    }
+    const MetricType::Type type = family.prototype->type();
+    *out << "# HELP " << name << ' ';
+    WritePrometheusEscaped(family.prototype->description(), false, out);
+    *out << "\n# TYPE " << name << ' '
+         << (type == MetricType::kHistogram ? "summary" : MetricType::Name(type)) << '\n';
+    for (const auto& sample : family.samples) {
+      if (type == MetricType::kHistogram) {
+        WritePrometheusSummary(name, sample.first, sample.second.histogram.get(), out);
+      } else {
+        *out << name << '{' << sample.first << "} " << SimpleDtoa(sample.second.sum) << '\n';
+      }
+    }
+  }
+
+  // See WriteAsJson().
+  families.clear();
+  entities.clear();
+  const_cast<MetricRegistry*>(this)->RetireOldMetrics();
+  return Status::OK();
+}
+
 void MetricRegistry::RetireOldMetrics() {
   std::lock_guard<simple_spinlock> l(lock_);
   for (auto it = entities_.begin(); it != entities_.end();) {
@@ -608,6 +767,11 @@ Status Counter::WriteAsJson(JsonWriter* writer,
   return Status::OK();
 }
 
+bool Counter::MergePrometheusValue(PrometheusValue* value) const {
+  value->sum += static_cast<double>(this->value());
+  return true;
+}
+
 /////////////////////////////////////////////////
 // HistogramPrototype
 /////////////////////////////////////////////////
@@ -635,19 +799,88 @@ scoped_refptr<Histogram> HistogramPrototype::Instantiate(
 // Histogram
 /////////////////////////////////////////////////
 
+namespace {
+
+int NumHistogramStripes(const HistogramPrototype* proto, int max_stripes) {
+#if defined(__APPLE__) || defined(THREAD_SANITIZER)
+  // sched_getcpu() isn't available, see percpu_rwlock.
+  return 1;
+#else
+  if (!(proto->flags() & STRIPED)) {
+    return 1;
+  }
+  return std::min(base::MaxCPUIndex() + 1, max_stripes);
+#endif
+}
+
+} // anonymous namespace
+
 Histogram::Histogram(const HistogramPrototype* proto)
   : Metric(proto),
-    histogram_(new HdrHistogram(proto->max_trackable_value(), proto->num_sig_digits())) {
+    histogram_(new HdrHistogram(proto->max_trackable_value(), proto->num_sig_digits())),
+    num_stripes_(NumHistogramStripes(proto, kMaxStripes)),
+    stripes_(new std::atomic<HdrHistogram*>[num_stripes_]) {
+  stripes_[0] = histogram_.get();
+  for (int i = 1; i < num_stripes_; i++) {
+    stripes_[i] = nullptr;
+  }
+}
+
+Histogram::~Histogram() {
+  for (int i = 1; i < num_stripes_; i++) {
+    delete stripes_[i].load();
+  }
+}
+
+HdrHistogram* Histogram::GetStripe() {
+  if (num_stripes_ == 1) {
+    return histogram_.get();
+  }
+#if defined(__APPLE__) || defined(THREAD_SANITIZER)
+  int cpu = 0;
+#else
+  int cpu = sched_getcpu();
+#endif
+  std::atomic<HdrHistogram*>* stripe = &stripes_[std::max(cpu, 0) % num_stripes_];
+  HdrHistogram* hist = stripe->load(std::memory_order_acquire);
+  if (PREDICT_TRUE(hist)) {
+    return hist;
+  }
+  // Another thread may be allocating the same stripe: the loser of the race
+  // frees its own.
+  std::unique_ptr<HdrHistogram> new_hist(
+      new HdrHistogram(histogram_->highest_trackable_value(),
+                       histogram_->num_significant_digits()));
+  if (stripe->compare_exchange_strong(hist, new_hist.get())) {
+    hist = new_hist.release();
+  }
+  return hist;
 }
 
 void Histogram::Increment(int64_t value) {
   UpdateModificationEpoch();
-  histogram_->Increment(value);
+  GetStripe()->Increment(value);
 }
 
 void Histogram::IncrementBy(int64_t value, int64_t amount) {
   UpdateModificationEpoch();
-  histogram_->IncrementBy(value, amount);
+  GetStripe()->IncrementBy(value, amount);
+}
+
+const HdrHistogram* Histogram::histogram() const {
+  DCHECK_EQ(1, num_stripes_);
+  return histogram_.get();
+}
+
+unique_ptr<HdrHistogram> Histogram::MergedHistogram() const {
+  unique_ptr<HdrHistogram> merged(new HdrHistogram(*histogram_));
+  for (int i = 1; i < num_stripes_; i++) {
+    const HdrHistogram* hist = stripes_[i].load(std::memory_order_acquire);
+    if (hist) {
+      merged->MergeFrom(*hist);
+    }
+  }
+  return merged;
 }
 
 Status Histogram::WriteAsJson(JsonWriter* writer,
@@ -673,7 +906,7 @@ Status Histogram::GetHistogramSnapshotPB(HistogramSnapshotPB* snapshot_pb,
   // Fast-path for a reasonably common case of an empty histogram. This occurs
   // when a histogram is tracking some information about a feature not in
   // use, for example.
-  if (histogram_->TotalCount() == 0) {
+  if (TotalCount() == 0) {
     snapshot_pb->set_total_count(0);
     snapshot_pb->set_total_sum(0);
     snapshot_pb->set_min(0);
@@ -685,7 +918,8 @@ Status Histogram::GetHistogramSnapshotPB(HistogramSnapshotPB* snapshot_pb,
     snapshot_pb->set_percentile_99_99(0);
     snapshot_pb->set_max(0);
   } else {
-    HdrHistogram snapshot(*histogram_);
+    unique_ptr<HdrHistogram> merged = MergedHistogram();
+    const HdrHistogram& snapshot = *merged;
     snapshot_pb->set_total_count(snapshot.TotalCount());
     snapshot_pb->set_total_sum(snapshot.TotalSum());
     snapshot_pb->set_min(snapshot.MinValue());
@@ -710,23 +944,40 @@ Status Histogram::GetHistogramSnapshotPB(HistogramSnapshotPB* snapshot_pb,
   return Status::OK();
 }
 
+bool Histogram::MergePrometheusValue(PrometheusValue* value) const {
+  unique_ptr<HdrHistogram> merged = MergedHistogram();
+  if (value->histogram) {
+    value->histogram->MergeFrom(*merged);
+  } else {
+    value->histogram = std::move(merged);
+  }
+  return true;
+}
+
 uint64_t Histogram::CountInBucketForValueForTests(uint64_t value) const {
-  return histogram_->CountInBucketForValue(value);
+  return MergedHistogram()->CountInBucketForValue(value);
 }
 
 uint64_t Histogram::TotalCount() const {
-  return histogram_->TotalCount();
+  uint64_t total = 0;
+  for (int i = 0; i < num_stripes_; i++) {
+    const HdrHistogram* hist = stripes_[i].load(std::memory_order_acquire);
+    if (hist) {
+      total += hist->TotalCount();
+    }
+  }
+  return total;
 }
 
 uint64_t Histogram::MinValueForTests() const {
-  return histogram_->MinValue();
+  return MergedHistogram()->MinValue();
 }
 
 uint64_t Histogram::MaxValueForTests() const {
-  return histogram_->MaxValue();
+  return MergedHistogram()->MaxValue();
 }
 double Histogram::MeanValueForTests() const {
-  return histogram_->MeanValue();
+  return MergedHistogram()->MeanValue();
 }
 
 ScopedLatencyMetric::ScopedLatencyMetric(Histogram* latency_hist)
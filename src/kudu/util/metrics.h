@@ -221,12 +221,29 @@
 //      ...
 // ]
 //
+// =================
+// Prometheus output
+// =================
+//
+// The metrics may also be written in the Prometheus text exposition format.
+// The metric families are named after the entity type and the metric name,
+// and each entity's samples are labeled with its ID and its attributes:
+//
+// # HELP kudu_tablet_rows_inserted Number of rows inserted into this tablet since service start
+// # TYPE kudu_tablet_rows_inserted counter
+// kudu_tablet_rows_inserted{id="e95e57ba8d4d48458e7c7d35020d4a46",table_name="my_table"} 42
+//
+// Histograms are written as summaries. The metrics of the entities which share
+// the value of an attribute may be summed together: see MetricPrometheusOptions.
+//
 /////////////////////////////////////////////////////
 
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <iosfwd>
 #include <limits>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_map>
@@ -285,9 +302,9 @@
   ::kudu::GaugePrototype<double> METRIC_##name(                      \
       ::kudu::MetricPrototype::CtorArgs(#entity, #name, label, unit, desc, ## __VA_ARGS__))
 
-#define METRIC_DEFINE_histogram(entity, name, label, unit, desc, max_val, num_sig_digits) \
+#define METRIC_DEFINE_histogram(entity, name, label, unit, desc, max_val, num_sig_digits, ...) \
   ::kudu::HistogramPrototype METRIC_##name(                                       \
-      ::kudu::MetricPrototype::CtorArgs(#entity, #name, label, unit, desc), \
+      ::kudu::MetricPrototype::CtorArgs(#entity, #name, label, unit, desc, ## __VA_ARGS__), \
     max_val, num_sig_digits)
 
 // The following macros act as forward declarations for entity types and metric prototypes.
@@ -440,6 +457,30 @@ struct MetricJsonOptions {
   bool include_entity_attributes = true;
 };
 
+struct MetricPrometheusOptions {
+  // The entity types to include. If empty, the metrics of all the entities
+  // are written.
+  std::vector<std::string> entity_types;
+
+  // If set, the metrics of the entities which have the same value for this
+  // attribute (e.g. "table_name") are summed together, and labeled only by
+  // that value. The entities which don't have the attribute aren't merged.
+  std::string merge_by_attribute;
+
+  // See MetricJsonOptions::include_untouched_metrics.
+  bool include_untouched_metrics = true;
+};
+
+// The value of a sample in the Prometheus output, possibly summed from the
+// metrics of several entities.
+struct PrometheusValue {
+  // The sum of the values of the counters or gauges.
+  double sum = 0;
+
+  // The merged values of the histograms.
+  std::unique_ptr<HdrHistogram> histogram;
+};
+
 class MetricEntityPrototype {
  public:
   explicit MetricEntityPrototype(const char* name);
@@ -576,6 +617,11 @@ class Metric : public RefCountedThreadSafe<Metric> {
   // Return true if this metric has never been touched.
   virtual bool IsUntouched() const = 0;
 
+  // Adds the current value of this metric to 'value'. Returns false if the
+  // metric has no numeric value, in which case it's left out of the
+  // Prometheus output.
+  virtual bool MergePrometheusValue(PrometheusValue* value) const = 0;
+
   // Return true if this metric has changed in or after the given metrics epoch.
   bool ModifiedInOrAfterEpoch(int64_t epoch) {
     return m_epoch_ >= epoch;
@@ -659,6 +705,14 @@ class MetricRegistry {
                      const std::vector<std::string>& requested_metrics,
                      const MetricJsonOptions& opts) const;
 
+  // Writes metrics in this registry to 'out' in the Prometheus text format.
+  //
+  // 'requested_metrics' is matched as in WriteAsJson(). See the
+  // MetricPrometheusOptions struct definition above for the other options.
+  Status WriteAsPrometheus(std::ostream* out,
+                           const std::vector<std::string>& requested_metrics,
+                           const MetricPrometheusOptions& opts) const;
+
   // For each registered entity, retires orphaned metrics. If an entity has no more
   // metrics and there are no external references, entities are removed as well.
   //
@@ -722,7 +776,13 @@ class MetricPrototypeRegistry {
 enum PrototypeFlags {
   // Flag which causes a Gauge prototype to expose itself as if it
   // were a counter.
-  EXPOSE_AS_COUNTER = 1 << 0
+  EXPOSE_AS_COUNTER = 1 << 0,
+
+  // Flag which causes a Histogram to record its values into per-CPU stripes,
+  // merged when it's read. This is meant for the server-wide histograms
+  // updated by many threads at once, at high rates: each stripe that's used
+  // costs as much memory as an unstriped histogram.
+  STRIPED = 1 << 1
 };
 
 class MetricPrototype {
@@ -757,6 +817,7 @@ class MetricPrototype {
   const char* label() const { return args_.label_; }
   MetricUnit::Type unit() const { return args_.unit_; }
   const char* description() const { return args_.description_; }
+  uint32_t flags() const { return args_.flags_; }
   virtual MetricType::Type type() const = 0;
 
   // Writes the fields of this prototype to the given JSON writer.
@@ -834,6 +895,9 @@ class StringGauge : public Gauge {
   virtual bool IsUntouched() const override {
     return false;
   }
+  virtual bool MergePrometheusValue(PrometheusValue* /*value*/) const override {
+    return false;
+  }
 
  protected:
   virtual void WriteValue(JsonWriter* writer) const OVERRIDE;
@@ -843,6 +907,17 @@ class StringGauge : public Gauge {
   DISALLOW_COPY_AND_ASSIGN(StringGauge);
 };
 
+// Converts the value of a gauge to the value of its Prometheus samples.
+// Returns false if the value isn't numeric.
+template <typename T>
+inline bool ToPrometheusValue(const T& v, double* out) {
+  *out = static_cast<double>(v);
+  return true;
+}
+inline bool ToPrometheusValue(const std::string& /*v*/, double* /*out*/) {
+  return false;
+}
+
 // Lock-free implementation for types that are convertible to/from int64_t.
 template <typename T>
 class AtomicGauge : public Gauge {
@@ -874,6 +949,14 @@ class AtomicGauge : public Gauge {
   virtual bool IsUntouched() const override {
     return false;
   }
+  virtual bool MergePrometheusValue(PrometheusValue* value) const override {
+    double v;
+    if (!ToPrometheusValue(this->value(), &v)) {
+      return false;
+    }
+    value->sum += v;
+    return true;
+  }
  protected:
   virtual void WriteValue(JsonWriter* writer) const OVERRIDE {
     writer->Value(value());
@@ -993,6 +1076,15 @@ class FunctionGauge : public Gauge {
     return false;
   }
 
+  virtual bool MergePrometheusValue(PrometheusValue* value) const override {
+    double v;
+    if (!ToPrometheusValue(this->value(), &v)) {
+      return false;
+    }
+    value->sum += v;
+    return true;
+  }
+
  private:
   friend class MetricEntity;
 
@@ -1044,6 +1136,8 @@ class Counter : public Metric {
     return value() == 0;
   }
 
+  virtual bool MergePrometheusValue(PrometheusValue* value) const override;
+
  private:
   FRIEND_TEST(MetricsTest, SimpleCounterTest);
   FRIEND_TEST(MultiThreadedMetricsTest, CounterIncrementTest);
@@ -1093,8 +1187,13 @@ class Histogram : public Metric {
                                 const MetricJsonOptions& opts) const;
 
   // Returns a pointer to the underlying histogram. The implementation of HdrHistogram
-  // is thread safe.
-  const HdrHistogram* histogram() const { return histogram_.get(); }
+  // is thread safe. Only valid for the histograms which aren't striped: see
+  // MergedHistogram() for those.
+  const HdrHistogram* histogram() const;
+
+  // Returns a (non-consistent) snapshot of all the values recorded so far,
+  // including those of every stripe if the histogram is striped.
+  std::unique_ptr<HdrHistogram> MergedHistogram() const;
 
   uint64_t CountInBucketForValueForTests(uint64_t value) const;
   uint64_t MinValueForTests() const;
@@ -1105,12 +1204,33 @@ class Histogram : public Metric {
     return TotalCount() == 0;
   }
 
+  virtual bool MergePrometheusValue(PrometheusValue* value) const override;
+
  private:
   FRIEND_TEST(MetricsTest, SimpleHistogramTest);
   friend class MetricEntity;
   explicit Histogram(const HistogramPrototype* proto);
+  ~Histogram();
+
+  // Returns the histogram to record the values of the current CPU into,
+  // allocating its stripe on first use.
+  HdrHistogram* GetStripe();
+
+  // The most stripes of a striped histogram. The CPUs share the stripes
+  // beyond that number, which bounds the memory of the histograms on the
+  // servers with many cores.
+  static constexpr int kMaxStripes = 16;
 
   const gscoped_ptr<HdrHistogram> histogram_;
+
+  // The number of stripes, 1 if the histogram isn't striped.
+  const int num_stripes_;
+
+  // The stripes of a striped histogram, indexed by CPU modulo 'num_stripes_'.
+  // The first one is 'histogram_', and the others are allocated on first use
+  // and owned by this object.
+  std::unique_ptr<std::atomic<HdrHistogram*>[]> stripes_;
+
   DISALLOW_COPY_AND_ASSIGN(Histogram);
 };
 
@@ -21,11 +21,13 @@
 #include <string>
 #include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
 #include "kudu/gutil/strings/util.h"
 #include "kudu/util/async_util.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/test_macros.h"
@@ -33,6 +35,10 @@
 
 using std::vector;
 
+DECLARE_bool(fail_dns_resolution);
+DECLARE_int32(dns_resolver_cache_ttl_ms);
+DECLARE_int32(dns_resolver_negative_cache_ttl_ms);
+
 namespace kudu {
 
 class DnsResolverTest : public KuduTest {
@@ -56,4 +62,42 @@ TEST_F(DnsResolverTest, TestResolution) {
   }
 }
 
+TEST_F(DnsResolverTest, TestCaching) {
+  FLAGS_dns_resolver_cache_ttl_ms = 1000;
+  FLAGS_dns_resolver_negative_cache_ttl_ms = 500;
+  DnsResolver resolver;
+  vector<Sockaddr> addrs;
+  ASSERT_OK(resolver.ResolveAddresses(HostPort("localhost", 12345), &addrs));
+  ASSERT_FALSE(addrs.empty());
+
+  // The addresses are cached, with the port of each lookup.
+  FLAGS_fail_dns_resolution = true;
+  vector<Sockaddr> cached_addrs;
+  ASSERT_OK(resolver.ResolveAddresses(HostPort("localhost", 54321), &cached_addrs));
+  ASSERT_EQ(addrs.size(), cached_addrs.size());
+  for (const Sockaddr& addr : cached_addrs) {
+    EXPECT_EQ(54321, addr.port());
+  }
+  Synchronizer s;
+  cached_addrs.clear();
+  resolver.ResolveAddresses(HostPort("localhost", 12345), &cached_addrs, s.AsStatusCallback());
+  ASSERT_OK(s.Wait());
+  ASSERT_EQ(addrs.size(), cached_addrs.size());
+
+  // Past half of the TTL, the lookups trigger a refresh. Its failure doesn't
+  // evict the cached addresses.
+  SleepFor(MonoDelta::FromMilliseconds(600));
+  ASSERT_OK(resolver.ResolveAddresses(HostPort("localhost", 12345), nullptr));
+  SleepFor(MonoDelta::FromMilliseconds(100));
+  ASSERT_OK(resolver.ResolveAddresses(HostPort("localhost", 12345), nullptr));
+
+  // Once the addresses expire, the failures are cached too.
+  SleepFor(MonoDelta::FromMilliseconds(400));
+  ASSERT_FALSE(resolver.ResolveAddresses(HostPort("localhost", 12345), nullptr).ok());
+  FLAGS_fail_dns_resolution = false;
+  ASSERT_FALSE(resolver.ResolveAddresses(HostPort("localhost", 12345), nullptr).ok());
+  SleepFor(MonoDelta::FromMilliseconds(600));
+  ASSERT_OK(resolver.ResolveAddresses(HostPort("localhost", 12345), nullptr));
+}
+
 } // namespace kudu
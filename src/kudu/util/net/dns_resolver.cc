@@ -17,13 +17,16 @@
 
 #include "kudu/util/net/dns_resolver.h"
 
+#include <mutex>
+#include <string>
+#include <utility>
 #include <vector>
 
-#include <boost/bind.hpp> // IWYU pragma: keep
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/gutil/callback.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/threadpool.h"
 #include "kudu/util/net/net_util.h"
@@ -32,10 +35,44 @@
 DEFINE_int32(dns_num_resolver_threads, 1, "The number of threads to use for DNS resolution");
 TAG_FLAG(dns_num_resolver_threads, advanced);
 
+DEFINE_int32(dns_resolver_cache_ttl_ms, 15 * 1000,
+             "The number of milliseconds for which the addresses of a host are "
+             "cached by the DNS resolvers. Once half of that time has passed, "
+             "the next lookup of the host refreshes them in the background. "
+             "If 0, the addresses aren't cached.");
+TAG_FLAG(dns_resolver_cache_ttl_ms, advanced);
+TAG_FLAG(dns_resolver_cache_ttl_ms, runtime);
+
+DEFINE_int32(dns_resolver_negative_cache_ttl_ms, 1000,
+             "The number of milliseconds for which the failure to resolve a "
+             "host is cached by the DNS resolvers. If 0, failures aren't cached.");
+TAG_FLAG(dns_resolver_negative_cache_ttl_ms, advanced);
+TAG_FLAG(dns_resolver_negative_cache_ttl_ms, runtime);
+
+using std::string;
 using std::vector;
 
 namespace kudu {
 
+namespace {
+
+// The number of cached hosts beyond which the expired entries are evicted.
+const size_t kMaxCachedHosts = 1024;
+
+// Appends the cached 'cached_addresses' to 'addresses', with the port 'port'.
+void AppendAddresses(const vector<Sockaddr>& cached_addresses, int port,
+                     vector<Sockaddr>* addresses) {
+  if (!addresses) {
+    return;
+  }
+  for (Sockaddr addr : cached_addresses) {
+    addr.set_port(port);
+    addresses->push_back(addr);
+  }
+}
+
+} // anonymous namespace
+
 DnsResolver::DnsResolver() {
   CHECK_OK(ThreadPoolBuilder("dns-resolver")
            .set_max_threads(FLAGS_dns_num_resolver_threads)
@@ -46,20 +83,116 @@ DnsResolver::~DnsResolver() {
   pool_->Shutdown();
 }
 
-namespace {
-void DoResolution(const HostPort &hostport, vector<Sockaddr>* addresses,
-                  const StatusCallback& cb) {
-  cb.Run(hostport.ResolveAddresses(addresses));
+Status DnsResolver::ResolveAddresses(const HostPort& hostport,
+                                     vector<Sockaddr>* addresses) {
+  Status s;
+  if (GetCachedAddresses(hostport, addresses, &s)) {
+    return s;
+  }
+  return DoResolution(hostport, addresses);
 }
-} // anonymous namespace
 
 void DnsResolver::ResolveAddresses(const HostPort& hostport,
                                    vector<Sockaddr>* addresses,
                                    const StatusCallback& cb) {
-  Status s = pool_->SubmitFunc(boost::bind(&DoResolution, hostport, addresses, cb));
+  Status s;
+  if (GetCachedAddresses(hostport, addresses, &s)) {
+    cb.Run(s);
+    return;
+  }
+  s = pool_->SubmitFunc([this, hostport, addresses, cb]() {
+    cb.Run(this->DoResolution(hostport, addresses));
+  });
   if (!s.ok()) {
     cb.Run(s);
   }
 }
 
+bool DnsResolver::GetCachedAddresses(const HostPort& hostport,
+                                     vector<Sockaddr>* addresses,
+                                     Status* status) {
+  const MonoTime now = MonoTime::Now();
+  bool refresh = false;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    CacheEntry* entry = FindOrNull(cache_, hostport.host());
+    if (!entry || now >= entry->expiration_time) {
+      return false;
+    }
+    // Only the successful resolutions are refreshed: the failed ones are
+    // retried when they expire.
+    if (entry->status.ok() && now >= entry->refresh_time && !entry->refreshing) {
+      entry->refreshing = true;
+      refresh = true;
+    }
+    *status = entry->status;
+    AppendAddresses(entry->addresses, hostport.port(), addresses);
+  }
+  if (refresh) {
+    const string host = hostport.host();
+    Status s = pool_->SubmitFunc([this, host]() { this->RefreshAddresses(host); });
+    if (!s.ok()) {
+      std::lock_guard<simple_spinlock> l(lock_);
+      CacheEntry* entry = FindOrNull(cache_, host);
+      if (entry) {
+        entry->refreshing = false;
+      }
+    }
+  }
+  return true;
+}
+
+Status DnsResolver::DoResolution(const HostPort& hostport, vector<Sockaddr>* addresses) {
+  vector<Sockaddr> resolved;
+  Status s = HostPort(hostport.host(), 0).ResolveAddresses(&resolved);
+  AppendAddresses(resolved, hostport.port(), addresses);
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    PutUnlocked(hostport.host(), s, std::move(resolved));
+  }
+  return s;
+}
+
+void DnsResolver::RefreshAddresses(const string& host) {
+  vector<Sockaddr> resolved;
+  Status s = HostPort(host, 0).ResolveAddresses(&resolved);
+  std::lock_guard<simple_spinlock> l(lock_);
+  if (s.ok()) {
+    PutUnlocked(host, s, std::move(resolved));
+    return;
+  }
+  VLOG(1) << "Could not refresh the addresses of " << host << ": " << s.ToString();
+  CacheEntry* entry = FindOrNull(cache_, host);
+  if (entry) {
+    entry->refreshing = false;
+  }
+}
+
+void DnsResolver::PutUnlocked(const string& host, const Status& status,
+                              vector<Sockaddr> addresses) {
+  DCHECK(lock_.is_locked());
+  const int32_t ttl_ms = status.ok() ?
+      FLAGS_dns_resolver_cache_ttl_ms : FLAGS_dns_resolver_negative_cache_ttl_ms;
+  if (ttl_ms <= 0) {
+    cache_.erase(host);
+    return;
+  }
+  const MonoTime now = MonoTime::Now();
+  if (cache_.size() >= kMaxCachedHosts) {
+    for (auto it = cache_.begin(); it != cache_.end();) {
+      if (now >= it->second.expiration_time) {
+        it = cache_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  CacheEntry& entry = cache_[host];
+  entry.status = status;
+  entry.addresses = std::move(addresses);
+  entry.refresh_time = now + MonoDelta::FromMilliseconds(ttl_ms / 2);
+  entry.expiration_time = now + MonoDelta::FromMilliseconds(ttl_ms);
+  entry.refreshing = false;
+}
+
 } // namespace kudu
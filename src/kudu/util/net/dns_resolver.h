@@ -17,44 +17,100 @@
 #ifndef KUDU_UTIL_NET_DNS_RESOLVER_H
 #define KUDU_UTIL_NET_DNS_RESOLVER_H
 
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/net/sockaddr.h"
+#include "kudu/util/status.h"
 #include "kudu/util/status_callback.h"
 
 namespace kudu {
 
 class HostPort;
-class Sockaddr;
 class ThreadPool;
 
 // DNS Resolver which supports async address resolution.
+//
+// The addresses of the hosts are cached for --dns_resolver_cache_ttl_ms, and
+// resolution failures for --dns_resolver_negative_cache_ttl_ms. Once a cached
+// entry has lived half of its TTL, the next lookup of the host refreshes it in
+// the background, while it goes on serving the cached addresses: the hosts
+// which are looked up regularly thus never wait for the DNS server.
 class DnsResolver {
  public:
   DnsResolver();
   ~DnsResolver();
 
-  // Resolve any addresses corresponding to this host:port pair.
-  // Note that a host may resolve to more than one IP address.
+  // Resolve any addresses corresponding to this host:port pair, appending
+  // them to 'addresses'. Note that a host may resolve to more than one IP
+  // address.
   //
   // 'addresses' may be NULL, in which case this function simply checks that
   // the host/port pair can be resolved, without returning anything.
+  Status ResolveAddresses(const HostPort& hostport,
+                          std::vector<Sockaddr>* addresses);
+
+  // Same as above, but asynchronous.
   //
   // When the result is available, or an error occurred, 'cb' is called
   // with the result Status.
   //
   // NOTE: the callback should be fast since it is called by the DNS
   // resolution thread.
-  // NOTE: in some rare cases, the callback may also be called inline
-  // from this function call, on the caller's thread.
+  // NOTE: if the result is cached, or in some rare cases, the callback may
+  // also be called inline from this function call, on the caller's thread.
   void ResolveAddresses(const HostPort& hostport,
                         std::vector<Sockaddr>* addresses,
                         const StatusCallback& cb);
 
  private:
+  struct CacheEntry {
+    // The result of the resolution: a failed resolution is cached too.
+    Status status;
+    std::vector<Sockaddr> addresses;
+
+    // The time after which the entry is refreshed in the background.
+    MonoTime refresh_time;
+
+    // The time after which the entry may no longer be used.
+    MonoTime expiration_time;
+
+    // Whether a background refresh is in progress.
+    bool refreshing = false;
+  };
+
+  // Looks up 'hostport' in the cache, triggering a refresh of its entry if
+  // it's due. Returns false if it isn't cached. Otherwise, sets 'status' to
+  // the cached status and appends the cached addresses to 'addresses'.
+  bool GetCachedAddresses(const HostPort& hostport,
+                          std::vector<Sockaddr>* addresses,
+                          Status* status);
+
+  // Resolves 'hostport' and caches the result.
+  Status DoResolution(const HostPort& hostport, std::vector<Sockaddr>* addresses);
+
+  // Resolves 'host' in the background, replacing its cache entry if the
+  // resolution succeeds. Otherwise, the entry is used until it expires.
+  void RefreshAddresses(const std::string& host);
+
+  // Caches the result of the resolution of 'host'. Requires 'lock_'.
+  void PutUnlocked(const std::string& host, const Status& status,
+                   std::vector<Sockaddr> addresses);
+
   gscoped_ptr<ThreadPool> pool_;
 
+  // Protects 'cache_'.
+  simple_spinlock lock_;
+
+  // The cached resolutions, by host name. The addresses of the entries have a
+  // port of 0: the port of the looked up host/port pair is set on the copies.
+  std::unordered_map<std::string, CacheEntry> cache_;
+
   DISALLOW_COPY_AND_ASSIGN(DnsResolver);
 };
 
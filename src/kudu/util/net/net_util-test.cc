@@ -63,6 +63,32 @@ TEST(SockaddrTest, Test) {
   ASSERT_EQ("1.1.1.1", addr.host());
 }
 
+TEST(SockaddrTest, TestUnixDomainPaths) {
+  Sockaddr addr;
+  ASSERT_OK(addr.ParseUnixDomainPath("/tmp/kudu.sock"));
+  ASSERT_TRUE(addr.is_unix());
+  ASSERT_FALSE(addr.is_ip());
+  ASSERT_EQ("/tmp/kudu.sock", addr.UnixDomainPath());
+  ASSERT_EQ("unix:/tmp/kudu.sock", addr.ToString());
+  ASSERT_EQ(0, addr.port());
+
+  Sockaddr abstract_addr;
+  ASSERT_OK(abstract_addr.ParseUnixDomainPath("@kudu"));
+  ASSERT_EQ("@kudu", abstract_addr.UnixDomainPath());
+  ASSERT_FALSE(abstract_addr == addr);
+
+  Sockaddr copy = addr;
+  ASSERT_TRUE(copy == addr);
+  ASSERT_EQ(copy.HashCode(), addr.HashCode());
+
+  Sockaddr ip_addr;
+  ASSERT_OK(ip_addr.ParseString("1.1.1.1:12345", 0));
+  ASSERT_FALSE(ip_addr == addr);
+
+  ASSERT_TRUE(addr.ParseUnixDomainPath("").IsInvalidArgument());
+  ASSERT_TRUE(addr.ParseUnixDomainPath(string(200, 'x')).IsInvalidArgument());
+}
+
 TEST_F(NetUtilTest, TestParseAddresses) {
   string ret;
   ASSERT_OK(DoParseBindAddresses("0.0.0.0:12345", &ret));
@@ -22,10 +22,14 @@
 #include <sys/socket.h>
 
 #include <cerrno>
+#include <cstddef>
 #include <cstring>
 #include <string>
 
+#include <glog/logging.h>
+
 #include "kudu/gutil/hash/builtin_type_hash.h"
+#include "kudu/gutil/hash/string_hash.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/net/net_util.h"
@@ -40,81 +44,156 @@ namespace kudu {
 /// Sockaddr
 ///
 Sockaddr::Sockaddr() {
-  memset(&addr_, 0, sizeof(addr_));
-  addr_.sin_family = AF_INET;
-  addr_.sin_addr.s_addr = INADDR_ANY;
+  memset(&storage_, 0, sizeof(storage_));
+  storage_.in.sin_family = AF_INET;
+  storage_.in.sin_addr.s_addr = INADDR_ANY;
+  len_ = sizeof(struct sockaddr_in);
 }
 
 Sockaddr::Sockaddr(const struct sockaddr_in& addr) {
-  memcpy(&addr_, &addr, sizeof(struct sockaddr_in));
+  *this = addr;
+}
+
+Sockaddr::Sockaddr(const struct sockaddr* addr, socklen_t len) {
+  CHECK(addr->sa_family == AF_INET || addr->sa_family == AF_UNIX) << addr->sa_family;
+  CHECK_LE(len, sizeof(storage_));
+  memset(&storage_, 0, sizeof(storage_));
+  memcpy(&storage_, addr, len);
+  len_ = len;
 }
 
 Status Sockaddr::ParseString(const std::string& s, uint16_t default_port) {
   HostPort hp;
   RETURN_NOT_OK(hp.ParseString(s, default_port));
 
-  if (inet_pton(AF_INET, hp.host().c_str(), &addr_.sin_addr) != 1) {
+  struct in_addr in_addr;
+  if (inet_pton(AF_INET, hp.host().c_str(), &in_addr) != 1) {
     return Status::InvalidArgument("Invalid IP address", hp.host());
   }
+  *this = Sockaddr();
+  storage_.in.sin_addr = in_addr;
   set_port(hp.port());
   return Status::OK();
 }
 
+Status Sockaddr::ParseUnixDomainPath(const std::string& path) {
+  const size_t kMaxPathSize = sizeof(storage_.un.sun_path) - 1;
+  if (path.empty() || path == "@") {
+    return Status::InvalidArgument("empty UNIX domain socket path");
+  }
+  if (path.size() > kMaxPathSize) {
+    return Status::InvalidArgument(
+        Substitute("UNIX domain socket path longer than $0 bytes", kMaxPathSize), path);
+  }
+  memset(&storage_, 0, sizeof(storage_));
+  storage_.un.sun_family = AF_UNIX;
+  memcpy(storage_.un.sun_path, path.data(), path.size());
+  len_ = offsetof(struct sockaddr_un, sun_path) + path.size();
+  if (path[0] == '@') {
+    // The name of an abstract socket starts with a NUL byte, and is made of
+    // all the bytes of the address.
+    storage_.un.sun_path[0] = '\0';
+  } else {
+    len_++;
+  }
+  return Status::OK();
+}
+
 Sockaddr& Sockaddr::operator=(const struct sockaddr_in &addr) {
-  memcpy(&addr_, &addr, sizeof(struct sockaddr_in));
+  memset(&storage_, 0, sizeof(storage_));
+  memcpy(&storage_.in, &addr, sizeof(struct sockaddr_in));
+  len_ = sizeof(struct sockaddr_in);
   return *this;
 }
 
 bool Sockaddr::operator==(const Sockaddr& other) const {
-  return memcmp(&other.addr_, &addr_, sizeof(addr_)) == 0;
+  return len_ == other.len_ && memcmp(&other.storage_, &storage_, len_) == 0;
 }
 
 bool Sockaddr::operator<(const Sockaddr &rhs) const {
-  return addr_.sin_addr.s_addr < rhs.addr_.sin_addr.s_addr;
+  if (family() != rhs.family()) {
+    return family() < rhs.family();
+  }
+  if (is_unix()) {
+    return UnixDomainPath() < rhs.UnixDomainPath();
+  }
+  return storage_.in.sin_addr.s_addr < rhs.storage_.in.sin_addr.s_addr;
 }
 
 uint32_t Sockaddr::HashCode() const {
-  uint32_t hash = Hash32NumWithSeed(addr_.sin_addr.s_addr, 0);
-  hash = Hash32NumWithSeed(addr_.sin_port, hash);
+  if (is_unix()) {
+    return HashStringThoroughly(reinterpret_cast<const char*>(&storage_), len_);
+  }
+  uint32_t hash = Hash32NumWithSeed(storage_.in.sin_addr.s_addr, 0);
+  hash = Hash32NumWithSeed(storage_.in.sin_port, hash);
   return hash;
 }
 
 void Sockaddr::set_port(int port) {
-  addr_.sin_port = htons(port);
+  DCHECK(is_ip());
+  storage_.in.sin_port = htons(port);
 }
 
 int Sockaddr::port() const {
-  return ntohs(addr_.sin_port);
+  if (!is_ip()) {
+    return 0;
+  }
+  return ntohs(storage_.in.sin_port);
 }
 
 std::string Sockaddr::host() const {
-  return HostPort::AddrToString(addr_.sin_addr.s_addr);
+  if (!is_ip()) {
+    return ToString();
+  }
+  return HostPort::AddrToString(storage_.in.sin_addr.s_addr);
 }
 
 const struct sockaddr_in& Sockaddr::addr() const {
-  return addr_;
+  DCHECK(is_ip());
+  return storage_.in;
+}
+
+std::string Sockaddr::UnixDomainPath() const {
+  DCHECK(is_unix());
+  const size_t offset = offsetof(struct sockaddr_un, sun_path);
+  if (len_ <= offset) {
+    return "";
+  }
+  const char* path = storage_.un.sun_path;
+  const size_t path_len = len_ - offset;
+  if (path[0] == '\0') {
+    return "@" + string(path + 1, path_len - 1);
+  }
+  return string(path, strnlen(path, path_len));
 }
 
 std::string Sockaddr::ToString() const {
+  if (is_unix()) {
+    return "unix:" + UnixDomainPath();
+  }
   return Substitute("$0:$1", host(), port());
 }
 
 bool Sockaddr::IsWildcard() const {
-  return addr_.sin_addr.s_addr == 0;
+  return is_ip() && storage_.in.sin_addr.s_addr == 0;
 }
 
 bool Sockaddr::IsAnyLocalAddress() const {
-  return HostPort::IsLoopback(addr_.sin_addr.s_addr);
+  return is_ip() && HostPort::IsLoopback(storage_.in.sin_addr.s_addr);
 }
 
 Status Sockaddr::LookupHostname(string* hostname) const {
   char host[NI_MAXHOST];
   int flags = 0;
 
+  if (!is_ip()) {
+    return Status::NotSupported("cannot look up the hostname of a non-IP address",
+                                ToString());
+  }
   int rc = 0;
   LOG_SLOW_EXECUTION(WARNING, 200,
                      Substitute("DNS reverse-lookup for $0", ToString())) {
-    rc = getnameinfo((struct sockaddr *) &addr_, sizeof(sockaddr_in),
+    rc = getnameinfo(raw_addr(), addrlen(),
                      host, NI_MAXHOST,
                      nullptr, 0, flags);
   }
@@ -18,6 +18,8 @@
 #define KUDU_UTIL_NET_SOCKADDR_H
 
 #include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include <cstdint>
 #include <functional>
@@ -30,15 +32,18 @@ namespace kudu {
 ///
 /// Represents a sockaddr.
 ///
-/// Currently only IPv4 is implemented.  When IPv6 and UNIX domain are
-/// implemented, this should become an abstract base class and those should be
-/// multiple implementations.
+/// Either an IPv4 address or a UNIX domain socket address. IPv6 is not
+/// implemented.
 ///
 class Sockaddr {
  public:
   Sockaddr();
   explicit Sockaddr(const struct sockaddr_in &addr);
 
+  // Copies the address of 'len' bytes at 'addr', which must be of the
+  // AF_INET or AF_UNIX family.
+  Sockaddr(const struct sockaddr* addr, socklen_t len);
+
   // Parse a string IP address of the form "A.B.C.D:port", storing the result
   // in this Sockaddr object. If no ':port' is specified, uses 'default_port'.
   // Note that this function will not handle resolving hostnames.
@@ -46,6 +51,13 @@ class Sockaddr {
   // Returns a bad Status if the input is malformed.
   Status ParseString(const std::string& s, uint16_t default_port);
 
+  // Sets this Sockaddr to the UNIX domain socket address at 'path'. A path
+  // starting with '@' is in the Linux abstract namespace, and so doesn't
+  // reference a file.
+  //
+  // Returns InvalidArgument if the path is empty or too long.
+  Status ParseUnixDomainPath(const std::string& path);
+
   Sockaddr& operator=(const struct sockaddr_in &addr);
 
   bool operator==(const Sockaddr& other) const;
@@ -56,14 +68,32 @@ class Sockaddr {
 
   uint32_t HashCode() const;
 
-  // Returns the dotted-decimal string '1.2.3.4' of the host component of this address.
+  int family() const { return storage_.generic.sa_family; }
+  bool is_ip() const { return family() == AF_INET; }
+  bool is_unix() const { return family() == AF_UNIX; }
+
+  // Returns the dotted-decimal string '1.2.3.4' of the host component of this
+  // address. For a UNIX domain socket address, returns the same as ToString().
   std::string host() const;
 
+  // Only valid for IP addresses. The port of a UNIX domain socket address
+  // is 0.
   void set_port(int port);
   int port() const;
+
+  // Only valid for IP addresses.
   const struct sockaddr_in& addr() const;
 
-  // Returns the stringified address in '1.2.3.4:<port>' format.
+  // The address as passed to the socket system calls, and its length.
+  const struct sockaddr* raw_addr() const { return &storage_.generic; }
+  socklen_t addrlen() const { return len_; }
+
+  // The path of a UNIX domain socket address, with a leading '@' for the
+  // abstract namespace. Empty for the unnamed addresses of connecting sockets.
+  std::string UnixDomainPath() const;
+
+  // Returns the stringified address in '1.2.3.4:<port>' format, or in
+  // 'unix:<path>' format for a UNIX domain socket address.
   std::string ToString() const;
 
   // Returns true if the address is 0.0.0.0
@@ -77,7 +107,13 @@ class Sockaddr {
 
   // the default auto-generated copy constructor is fine here
  private:
-  struct sockaddr_in addr_;
+  union {
+    struct sockaddr generic;
+    struct sockaddr_in in;
+    struct sockaddr_un un;
+  } storage_;
+  // The number of bytes of 'storage_' which are part of the address.
+  socklen_t len_;
 };
 
 } // namespace kudu
@@ -86,4 +86,37 @@ TEST_F(SocketTest, TestRecvReset) {
 TEST_F(SocketTest, TestRecvEOF) {
   DoTest(true, "recv got EOF from 127.0.0.1:[0-9]+");
 }
+
+TEST_F(SocketTest, TestUnixDomainSocket) {
+  Sockaddr address;
+  ASSERT_OK(address.ParseUnixDomainPath(GetTestPath("test.sock")));
+  Socket listener;
+  ASSERT_OK(listener.Init(AF_UNIX, 0));
+  ASSERT_OK(listener.BindAndListen(address, 1));
+  Sockaddr listen_address;
+  ASSERT_OK(listener.GetSocketAddress(&listen_address));
+  ASSERT_EQ(address.ToString(), listen_address.ToString());
+
+  std::thread t([&]{
+    Sockaddr remote;
+    Socket sock;
+    CHECK_OK(listener.Accept(&sock, &remote, 0));
+    CHECK(remote.is_unix());
+    CHECK(sock.IsLoopbackConnection());
+    int32_t nwritten;
+    CHECK_OK(sock.Write(reinterpret_cast<const uint8_t*>("hello"), 5, &nwritten));
+    CHECK_EQ(5, nwritten);
+  });
+
+  Socket client;
+  ASSERT_OK(client.Init(AF_UNIX, 0));
+  ASSERT_OK(client.SetNoDelay(true));
+  ASSERT_OK(client.Connect(listen_address));
+  uint8_t buf[5];
+  size_t nread;
+  ASSERT_OK(client.BlockingRecv(buf, sizeof(buf), &nread,
+                                MonoTime::Now() + MonoDelta::FromSeconds(10)));
+  ASSERT_EQ("hello", Slice(buf, nread).ToString());
+  t.join();
+}
 } // namespace kudu
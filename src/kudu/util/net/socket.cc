@@ -128,11 +128,15 @@ bool Socket::IsTemporarySocketError(int err) {
   return ((err == EAGAIN) || (err == EWOULDBLOCK) || (err == EINTR));
 }
 
+Status Socket::Init(int flags) {
+  return Init(AF_INET, flags);
+}
+
 #if defined(__linux__)
 
-Status Socket::Init(int flags) {
+Status Socket::Init(int family, int flags) {
   int nonblocking_flag = (flags & FLAG_NONBLOCKING) ? SOCK_NONBLOCK : 0;
-  Reset(::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC | nonblocking_flag, 0));
+  Reset(::socket(family, SOCK_STREAM | SOCK_CLOEXEC | nonblocking_flag, 0));
   if (fd_ < 0) {
     int err = errno;
     return Status::NetworkError("error opening socket", ErrnoToString(err), err);
@@ -143,8 +147,8 @@ Status Socket::Init(int flags) {
 
 #else
 
-Status Socket::Init(int flags) {
-  Reset(::socket(AF_INET, SOCK_STREAM, 0));
+Status Socket::Init(int family, int flags) {
+  Reset(::socket(family, SOCK_STREAM, 0));
   if (fd_ < 0) {
     int err = errno;
     return Status::NetworkError("error opening socket", ErrnoToString(err), err);
@@ -162,6 +166,10 @@ Status Socket::Init(int flags) {
 #endif // defined(__linux__)
 
 Status Socket::SetNoDelay(bool enabled) {
+  Sockaddr addr;
+  if (GetSocketAddress(&addr).ok() && addr.is_unix()) {
+    return Status::OK();
+  }
   int flag = enabled ? 1 : 0;
   RETURN_NOT_OK_PREPEND(SetSockOpt(IPPROTO_TCP, TCP_NODELAY, flag),
                         "failed to set TCP_NODELAY");
@@ -272,32 +280,33 @@ Status Socket::Listen(int listen_queue_size) {
 }
 
 Status Socket::GetSocketAddress(Sockaddr *cur_addr) const {
-  struct sockaddr_in sin;
-  socklen_t len = sizeof(sin);
+  struct sockaddr_storage ss;
+  socklen_t len = sizeof(ss);
   DCHECK_GE(fd_, 0);
-  if (::getsockname(fd_, reinterpret_cast<struct sockaddr*>(&sin), &len) == -1) {
+  if (::getsockname(fd_, reinterpret_cast<struct sockaddr*>(&ss), &len) == -1) {
     int err = errno;
     return Status::NetworkError("getsockname error", ErrnoToString(err), err);
   }
-  *cur_addr = sin;
+  *cur_addr = Sockaddr(reinterpret_cast<struct sockaddr*>(&ss), len);
   return Status::OK();
 }
 
 Status Socket::GetPeerAddress(Sockaddr *cur_addr) const {
-  struct sockaddr_in sin;
-  socklen_t len = sizeof(sin);
+  struct sockaddr_storage ss;
+  socklen_t len = sizeof(ss);
   DCHECK_GE(fd_, 0);
-  if (::getpeername(fd_, reinterpret_cast<struct sockaddr*>(&sin), &len) == -1) {
+  if (::getpeername(fd_, reinterpret_cast<struct sockaddr*>(&ss), &len) == -1) {
     int err = errno;
     return Status::NetworkError("getpeername error", ErrnoToString(err), err);
   }
-  *cur_addr = sin;
+  *cur_addr = Sockaddr(reinterpret_cast<struct sockaddr*>(&ss), len);
   return Status::OK();
 }
 
 bool Socket::IsLoopbackConnection() const {
   Sockaddr local, remote;
   if (!GetSocketAddress(&local).ok()) return false;
+  if (local.is_unix()) return true;
   if (!GetPeerAddress(&remote).ok()) return false;
   // Check if remote address is in 127.0.0.0/8 subnet.
   if (remote.IsAnyLocalAddress()) {
@@ -310,10 +319,8 @@ bool Socket::IsLoopbackConnection() const {
 }
 
 Status Socket::Bind(const Sockaddr& bind_addr) {
-  struct sockaddr_in addr = bind_addr.addr();
-
   DCHECK_GE(fd_, 0);
-  if (PREDICT_FALSE(::bind(fd_, (struct sockaddr*) &addr, sizeof(addr)))) {
+  if (PREDICT_FALSE(::bind(fd_, bind_addr.raw_addr(), bind_addr.addrlen()))) {
     int err = errno;
     Status s = Status::NetworkError(
         strings::Substitute("error binding socket to $0: $1",
@@ -331,7 +338,7 @@ Status Socket::Bind(const Sockaddr& bind_addr) {
 
 Status Socket::Accept(Socket *new_conn, Sockaddr *remote, int flags) {
   TRACE_EVENT0("net", "Socket::Accept");
-  struct sockaddr_in addr;
+  struct sockaddr_storage addr;
   socklen_t olen = sizeof(addr);
   DCHECK_GE(fd_, 0);
 #if defined(__linux__)
@@ -360,7 +367,7 @@ Status Socket::Accept(Socket *new_conn, Sockaddr *remote, int flags) {
   RETURN_NOT_OK(new_conn->SetCloseOnExec());
 #endif // defined(__linux__)
 
-  *remote = addr;
+  *remote = Sockaddr(reinterpret_cast<struct sockaddr*>(&addr), olen);
   TRACE_EVENT_INSTANT1("net", "Accepted", TRACE_EVENT_SCOPE_THREAD,
                        "remote", remote->ToString());
   return Status::OK();
@@ -380,16 +387,13 @@ Status Socket::BindForOutgoingConnection() {
 Status Socket::Connect(const Sockaddr &remote) {
   TRACE_EVENT1("net", "Socket::Connect",
                "remote", remote.ToString());
-  if (PREDICT_FALSE(!FLAGS_local_ip_for_outbound_sockets.empty())) {
+  if (PREDICT_FALSE(!FLAGS_local_ip_for_outbound_sockets.empty() && remote.is_ip())) {
     RETURN_NOT_OK(BindForOutgoingConnection());
   }
 
-  struct sockaddr_in addr;
-  memcpy(&addr, &remote.addr(), sizeof(sockaddr_in));
   DCHECK_GE(fd_, 0);
   int ret;
-  RETRY_ON_EINTR(ret, ::connect(
-      fd_, reinterpret_cast<const struct sockaddr*>(&addr), sizeof(addr)));
+  RETRY_ON_EINTR(ret, ::connect(fd_, remote.raw_addr(), remote.addrlen()));
   if (ret < 0) {
     int err = errno;
     return Status::NetworkError("connect(2) error", ErrnoToString(err), err);
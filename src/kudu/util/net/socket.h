@@ -64,9 +64,13 @@ class Socket {
   // the socket.
   static bool IsTemporarySocketError(int err);
 
+  // Opens an IPv4 stream socket.
   Status Init(int flags); // See FLAG_NONBLOCKING
 
-  // Set or clear TCP_NODELAY
+  // Opens a stream socket of the given address family, i.e. AF_INET or AF_UNIX.
+  Status Init(int family, int flags);
+
+  // Set or clear TCP_NODELAY. A no-op for UNIX domain sockets.
   Status SetNoDelay(bool enabled);
 
   // Set or clear TCP_CORK
@@ -106,7 +110,8 @@ class Socket {
   virtual Status GetPeerAddress(Sockaddr *cur_addr) const;
 
   // Return true if this socket is determined to be a loopback connection
-  // (i.e. the local and remote peer share an IP address).
+  // (i.e. the local and remote peer share an IP address, or the socket is a
+  // UNIX domain socket).
   //
   // If any error occurs while determining this, returns false.
   bool IsLoopbackConnection() const;
@@ -494,8 +494,10 @@ class ShardedLRUCache : public Cache {
     vmem_delete(vmp_);
   }
 
+  // The NVM cache doesn't support priorities.
   virtual Handle* Insert(PendingHandle* handle,
-                         Cache::EvictionCallback* eviction_callback) OVERRIDE {
+                         Cache::EvictionCallback* eviction_callback,
+                         Priority /* priority */) OVERRIDE {
     LRUHandle* h = reinterpret_cast<LRUHandle*>(DCHECK_NOTNULL(handle));
     return shards_[Shard(h->hash)]->Insert(h, eviction_callback);
   }
@@ -518,6 +520,14 @@ class ShardedLRUCache : public Cache {
     return reinterpret_cast<LRUHandle*>(handle)->val_ptr();
   }
 
+  // The NVM cache doesn't support admission filtering.
+  virtual void EnableAdmissionFilter() OVERRIDE {
+  }
+
+  // The NVM cache doesn't support persisting its keys.
+  virtual void GetHotKeys(size_t /* max_keys */, vector<string>* /* keys */) OVERRIDE {
+  }
+
   virtual void SetMetrics(unique_ptr<CacheMetrics> metrics) OVERRIDE {
     metrics_ = std::move(metrics);
     for (NvmLRUCache* cache : shards_) {
@@ -17,16 +17,24 @@
 
 #include "kudu/util/os-util.h"
 
+#include <sys/mman.h>
 #include <unistd.h>
 
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/scoped_cleanup.h"
+#include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
+#include "kudu/util/thread.h"
 
 using std::string;
+using std::vector;
 
 namespace kudu {
 
@@ -59,4 +67,56 @@ TEST(OsUtilTest, TestSelfNameWithParens) {
   RunTest("a(b(c((d))e)", 111, 222, 333);
 }
 
+TEST(OsUtilTest, TestParseCpuList) {
+  vector<int> cpus;
+  ASSERT_OK(ParseCpuList("0-3,8,10-11\n", &cpus));
+  ASSERT_EQ(vector<int>({ 0, 1, 2, 3, 8, 10, 11 }), cpus);
+  ASSERT_OK(ParseCpuList("5", &cpus));
+  ASSERT_EQ(vector<int>({ 5 }), cpus);
+  ASSERT_OK(ParseCpuList("\n", &cpus));
+  ASSERT_TRUE(cpus.empty());
+
+  for (const char* list : { "a", "1-", "3-1", "-1", "1,,2" }) {
+    SCOPED_TRACE(list);
+    Status s = ParseCpuList(list, &cpus);
+    ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  }
+}
+
+#if defined(__linux__)
+TEST(OsUtilTest, TestNumaNodeCpuAffinity) {
+  vector<vector<int>> node_cpus;
+  ASSERT_OK(GetNumaNodeCpus(&node_cpus));
+  ASSERT_FALSE(node_cpus.empty());
+  vector<int> all_cpus;
+  for (const auto& cpus : node_cpus) {
+    ASSERT_FALSE(cpus.empty());
+    all_cpus.insert(all_cpus.end(), cpus.begin(), cpus.end());
+  }
+
+  const int64_t tid = Thread::CurrentThreadId();
+  ASSERT_OK(SetThreadCpuAffinity(tid, node_cpus.back()));
+  ASSERT_OK(SetThreadCpuAffinity(tid, all_cpus));
+
+  Status s = SetThreadCpuAffinity(tid, { -1 });
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
+TEST(OsUtilTest, TestBindMemoryToCurrentNumaNode) {
+  ASSERT_GE(GetCurrentCpu(), 0);
+
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  const size_t len = 16 * page_size;
+  void* data = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  ASSERT_NE(MAP_FAILED, data);
+  SCOPED_CLEANUP({ munmap(data, len); });
+  ASSERT_OK(BindMemoryToCurrentNumaNode(data, len));
+  memset(data, 0xff, len);
+  // The ranges which don't span a whole page are left alone.
+  uint8_t* start = static_cast<uint8_t*>(data) + 1;
+  ASSERT_OK(BindMemoryToCurrentNumaNode(start, page_size));
+  ASSERT_OK(BindMemoryToCurrentNumaNode(start, len - 1));
+}
+#endif // defined(__linux__)
+
 } // namespace kudu
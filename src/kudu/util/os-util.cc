@@ -25,10 +25,18 @@
 #include "kudu/util/os-util.h"
 
 #include <fcntl.h>
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
 #include <sys/resource.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <cerrno>
 #include <cstddef>
+#include <cstring>
 #include <ostream>
 #include <string>
 #include <utility>
@@ -40,9 +48,12 @@
 #include "kudu/gutil/strings/numbers.h"
 #include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/stringpiece.h"
+#include "kudu/gutil/strings/strip.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/strings/util.h"
+#include "kudu/util/alignment.h"
 #include "kudu/util/env.h"
+#include "kudu/util/errno.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/status.h"
@@ -173,4 +184,131 @@ bool IsBeingDebugged() {
 #endif // __linux__
 }
 
+Status ParseCpuList(const string& list, vector<int>* cpus) {
+  cpus->clear();
+  StringPiece trimmed(list);
+  StripWhiteSpace(&trimmed);
+  if (trimmed.empty()) {
+    return Status::OK();
+  }
+  for (StringPiece range : Split(trimmed, ",")) {
+    std::pair<StringPiece, StringPiece> bounds = Split(range, "-");
+    int32_t first;
+    int32_t last;
+    if (!safe_strto32(bounds.first.data(), bounds.first.size(), &first) || first < 0) {
+      return Status::InvalidArgument("invalid CPU list", list);
+    }
+    last = first;
+    if (range.find('-') != StringPiece::npos &&
+        (!safe_strto32(bounds.second.data(), bounds.second.size(), &last) || last < first)) {
+      return Status::InvalidArgument("invalid CPU list", list);
+    }
+    for (int cpu = first; cpu <= last; cpu++) {
+      cpus->push_back(cpu);
+    }
+  }
+  return Status::OK();
+}
+
+Status GetNumaNodeCpus(vector<vector<int>>* node_cpus) {
+  static const char* const kNodesDir = "/sys/devices/system/node";
+  Env* env = Env::Default();
+  node_cpus->clear();
+  vector<string> children;
+  if (env->GetChildren(kNodesDir, &children).ok()) {
+    vector<int> nodes;
+    for (const string& child : children) {
+      int32_t node;
+      if (HasPrefixString(child, "node") &&
+          safe_strto32(child.substr(strlen("node")), &node)) {
+        nodes.push_back(node);
+      }
+    }
+    std::sort(nodes.begin(), nodes.end());
+    for (int node : nodes) {
+      faststring buf;
+      RETURN_NOT_OK(ReadFileToString(
+          env, Substitute("$0/node$1/cpulist", kNodesDir, node), &buf));
+      vector<int> cpus;
+      RETURN_NOT_OK(ParseCpuList(buf.ToString(), &cpus));
+      // Nodes with only memory have no CPUs.
+      if (!cpus.empty()) {
+        node_cpus->emplace_back(std::move(cpus));
+      }
+    }
+  }
+  if (node_cpus->empty()) {
+    faststring buf;
+    RETURN_NOT_OK(ReadFileToString(env, "/sys/devices/system/cpu/online", &buf));
+    vector<int> cpus;
+    RETURN_NOT_OK(ParseCpuList(buf.ToString(), &cpus));
+    if (cpus.empty()) {
+      return Status::NotFound("no online CPU");
+    }
+    node_cpus->emplace_back(std::move(cpus));
+  }
+  return Status::OK();
+}
+
+int GetCurrentCpu() {
+#if defined(__linux__)
+  return sched_getcpu();
+#else
+  return -1;
+#endif // defined(__linux__)
+}
+
+Status BindMemoryToCurrentNumaNode(void* addr, size_t len) {
+#if defined(__linux__)
+  const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+  const uintptr_t start = KUDU_ALIGN_UP(reinterpret_cast<uintptr_t>(addr), page_size);
+  const uintptr_t end = KUDU_ALIGN_DOWN(reinterpret_cast<uintptr_t>(addr) + len, page_size);
+  if (start >= end) {
+    return Status::OK();
+  }
+  unsigned cpu;
+  unsigned node;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+    int err = errno;
+    return Status::RuntimeError("could not get the NUMA node of the current CPU",
+                                ErrnoToString(err), err);
+  }
+  constexpr int kBitsPerWord = 8 * sizeof(unsigned long); // NOLINT(runtime/int)
+  vector<unsigned long> node_mask(node / kBitsPerWord + 1); // NOLINT(runtime/int)
+  node_mask[node / kBitsPerWord] |= 1UL << (node % kBitsPerWord);
+  // The kernel ignores the last bit of the mask.
+  if (syscall(SYS_mbind, start, end - start, MPOL_PREFERRED, node_mask.data(),
+              node_mask.size() * kBitsPerWord + 1, 0) != 0) {
+    int err = errno;
+    return Status::RuntimeError(Substitute("could not bind memory to NUMA node $0", node),
+                                ErrnoToString(err), err);
+  }
+  return Status::OK();
+#else
+  return Status::NotSupported("binding memory to NUMA nodes is not supported");
+#endif // defined(__linux__)
+}
+
+Status SetThreadCpuAffinity(int64_t tid, const vector<int>& cpus) {
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+      return Status::InvalidArgument(Substitute("invalid CPU $0", cpu));
+    }
+    CPU_SET(cpu, &set);
+  }
+  if (sched_setaffinity(tid, sizeof(set), &set) != 0) {
+    int err = errno;
+    return Status::RuntimeError(Substitute("could not set the CPU affinity of thread $0",
+                                           tid),
+                                ErrnoToString(err), err);
+  }
+  return Status::OK();
+#else
+  return Status::NotSupported("setting the CPU affinity of threads is not supported");
+#endif // defined(__linux__)
+}
+
 } // namespace kudu
@@ -23,9 +23,11 @@
 #ifndef KUDU_UTIL_OS_UTIL_H
 #define KUDU_UTIL_OS_UTIL_H
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <type_traits> // IWYU pragma: keep
+#include <vector>
 
 #include "kudu/util/status.h"
 
@@ -67,6 +69,31 @@ void DisableCoreDumps();
 // This may return false on unsupported (non-Linux) platforms.
 bool IsBeingDebugged();
 
+// Parses a list of CPUs in the format of the Linux sysfs 'cpulist' files,
+// e.g. "0-3,8,10-11", into 'cpus'.
+Status ParseCpuList(const std::string& list, std::vector<int>* cpus);
+
+// Sets 'node_cpus' to the CPUs of each NUMA node of the machine which has
+// CPUs, in the order of the nodes. If the machine doesn't expose its NUMA
+// topology, all the online CPUs are considered to be on a single node.
+Status GetNumaNodeCpus(std::vector<std::vector<int>>* node_cpus);
+
+// Returns the CPU the calling thread is running on, or -1 if unknown.
+int GetCurrentCpu();
+
+// Sets the memory policy of the pages of ['addr', 'addr' + 'len') so that
+// they are preferably allocated on the NUMA node of the CPU the calling
+// thread is running on when first touched. Only the pages wholly in the
+// range are affected, and the pages already allocated aren't moved.
+//
+// Returns NotSupported on platforms other than Linux.
+Status BindMemoryToCurrentNumaNode(void* addr, size_t len);
+
+// Restricts the thread with the given ID to run on the CPUs 'cpus'.
+//
+// Returns NotSupported on platforms other than Linux.
+Status SetThreadCpuAffinity(int64_t tid, const std::vector<int>& cpus);
+
 } // namespace kudu
 
 #endif /* KUDU_UTIL_OS_UTIL_H */
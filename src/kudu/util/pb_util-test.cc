@@ -25,9 +25,11 @@
 #include <gflags/gflags.h>
 #include <google/protobuf/descriptor.h>
 #include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/message.h>
 #include <gtest/gtest.h>
 
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
 #include "kudu/util/faststring.h"
@@ -52,6 +54,7 @@ using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
 using std::vector;
+using strings::Substitute;
 
 static const char* kTestFileName = "pb_container.meta";
 static const char* kTestKeyvalName = "my-key";
@@ -523,6 +526,42 @@ TEST_P(TestPBContainerVersions, TestInterleavedReadWrite) {
   ASSERT_OK(pb_reader.Close());
 }
 
+TEST_P(TestPBContainerVersions, TestAppendMany) {
+  const int kNumMessages = 10;
+  vector<ProtoContainerTestPB> pbs(kNumMessages);
+  vector<const google::protobuf::Message*> msgs;
+  for (int i = 0; i < kNumMessages; i++) {
+    pbs[i].set_name(Substitute("foo-$0", i));
+    pbs[i].set_value(i);
+    msgs.push_back(&pbs[i]);
+  }
+
+  unique_ptr<WritablePBContainerFile> pb_writer;
+  ASSERT_OK(NewPBCWriter(version_, RWFileOptions(), &pb_writer));
+  ASSERT_OK(pb_writer->CreateNew(pbs[0]));
+  ASSERT_OK(pb_writer->Append(pbs[0]));
+  ASSERT_OK(pb_writer->AppendMany(msgs));
+  ASSERT_OK(pb_writer->AppendMany({}));
+  ASSERT_OK(pb_writer->Close());
+
+  // The messages read back as if each was appended on its own.
+  unique_ptr<RandomAccessFile> reader;
+  ASSERT_OK(env_->NewRandomAccessFile(path_, &reader));
+  ReadablePBContainerFile pb_reader(std::move(reader));
+  ASSERT_OK(pb_reader.Open());
+  ProtoContainerTestPB read_pb;
+  ASSERT_OK(pb_reader.ReadNextPB(&read_pb));
+  ASSERT_EQ(0, read_pb.value());
+  for (int i = 0; i < kNumMessages; i++) {
+    SCOPED_TRACE(i);
+    ASSERT_OK(pb_reader.ReadNextPB(&read_pb));
+    ASSERT_EQ(pbs[i].name(), read_pb.name());
+    ASSERT_EQ(i, read_pb.value());
+  }
+  ASSERT_TRUE(pb_reader.ReadNextPB(nullptr).IsEndOfFile());
+  ASSERT_OK(pb_reader.Close());
+}
+
 TEST_F(TestPBUtil, TestPopulateDescriptorSet) {
   {
     // No dependencies --> just one proto.
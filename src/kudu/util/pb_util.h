@@ -25,6 +25,7 @@
 #include <iosfwd>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <boost/optional/optional.hpp>
 #include <google/protobuf/message.h>
@@ -302,6 +303,11 @@ class WritablePBContainerFile {
   // must be called prior to calling Append(), i.e. the file must be open.
   Status Append(const google::protobuf::Message& msg);
 
+  // Writes several protobuf messages to the container, as Append() would
+  // one after the other, but with a single write. If the write fails, any
+  // prefix of the records may have been written, the last one partially.
+  Status AppendMany(const std::vector<const google::protobuf::Message*>& msgs);
+
   // Asynchronously flushes all dirty container data to the filesystem.
   // The file must be open.
   Status Flush();
@@ -0,0 +1,72 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/rate_limiter.h"
+
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+#include "kudu/util/monotime.h"
+#include "kudu/util/test_util.h"
+
+namespace kudu {
+
+class RateLimiterTest : public KuduTest {
+};
+
+TEST_F(RateLimiterTest, TestRate) {
+  RateLimiter limiter(1000 * 1000, MonoDelta::FromMilliseconds(100));
+  MonoTime now = MonoTime::Now();
+  // The burst is taken without waiting.
+  ASSERT_EQ(0, limiter.Reserve(now, 100 * 1000).ToNanoseconds());
+  // Then each megabyte costs a second, even when taken at once.
+  ASSERT_EQ(1000, limiter.Reserve(now, 1000 * 1000).ToMilliseconds());
+  ASSERT_EQ(1010, limiter.Reserve(now, 10 * 1000).ToMilliseconds());
+  // Time pays for the tokens taken so far.
+  now += MonoDelta::FromMilliseconds(1010);
+  ASSERT_EQ(10, limiter.Reserve(now, 10 * 1000).ToMilliseconds());
+  // Idle time only accumulates up to the burst.
+  now += MonoDelta::FromSeconds(10);
+  ASSERT_EQ(0, limiter.Reserve(now, 100 * 1000).ToNanoseconds());
+  ASSERT_EQ(1, limiter.Reserve(now, 1000).ToMilliseconds());
+}
+
+TEST_F(RateLimiterTest, TestSetRate) {
+  RateLimiter limiter(0, MonoDelta::FromMilliseconds(100));
+  MonoTime now = MonoTime::Now();
+  // A rate of 0 doesn't limit anything.
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ(0, limiter.Reserve(now, 1L << 40).ToNanoseconds());
+  }
+
+  limiter.set_rate(1000);
+  ASSERT_EQ(1000, limiter.rate());
+  ASSERT_EQ(0, limiter.Reserve(now, 100).ToNanoseconds());
+  ASSERT_EQ(2000, limiter.Reserve(now, 2000).ToMilliseconds());
+}
+
+TEST_F(RateLimiterTest, TestAcquire) {
+  RateLimiter limiter(1000 * 1000, MonoDelta::FromMilliseconds(10));
+  MonoTime start = MonoTime::Now();
+  ASSERT_EQ(0, limiter.Acquire(10 * 1000).ToNanoseconds());
+  MonoDelta slept = limiter.Acquire(100 * 1000);
+  ASSERT_GE(MonoTime::Now() - start, slept);
+  ASSERT_GT(slept.ToMilliseconds(), 50);
+}
+
+} // namespace kudu
@@ -0,0 +1,64 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/rate_limiter.h"
+
+#include <mutex>
+
+namespace kudu {
+
+RateLimiter::RateLimiter(uint64_t rate_per_sec, MonoDelta burst)
+    : burst_(burst),
+      rate_per_sec_(rate_per_sec) {
+}
+
+void RateLimiter::set_rate(uint64_t rate_per_sec) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  rate_per_sec_ = rate_per_sec;
+}
+
+uint64_t RateLimiter::rate() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return rate_per_sec_;
+}
+
+MonoDelta RateLimiter::Acquire(uint64_t amount) {
+  MonoDelta wait = Reserve(MonoTime::Now(), amount);
+  if (wait.ToNanoseconds() > 0) {
+    SleepFor(wait);
+    return wait;
+  }
+  return MonoDelta::FromNanoseconds(0);
+}
+
+MonoDelta RateLimiter::Reserve(MonoTime now, uint64_t amount) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  if (rate_per_sec_ == 0) {
+    return MonoDelta::FromNanoseconds(0);
+  }
+  // The tokens which weren't taken while idle accumulate up to the burst.
+  const MonoTime earliest = now - burst_;
+  if (!next_free_.Initialized() || next_free_ < earliest) {
+    next_free_ = earliest;
+  }
+  next_free_ += MonoDelta::FromNanoseconds(
+      static_cast<int64_t>(static_cast<double>(amount) * MonoTime::kNanosecondsPerSecond /
+                           rate_per_sec_));
+  return next_free_ > now ? next_free_ - now : MonoDelta::FromNanoseconds(0);
+}
+
+} // namespace kudu
@@ -0,0 +1,66 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstdint>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
+
+namespace kudu {
+
+// A token bucket limiting the rate at which a resource, e.g. the bytes
+// written to a disk, is used.
+//
+// Unlike Throttler, which rejects the requests exceeding the tokens at hand,
+// any number of tokens may be taken at once: the caller is made to wait until
+// the rate pays for them. A burst of up to 'burst' worth of tokens may be
+// taken without waiting after the limiter has been idle.
+//
+// This class is thread-safe.
+class RateLimiter {
+ public:
+  // A rate of 0 disables the limiting.
+  RateLimiter(uint64_t rate_per_sec, MonoDelta burst);
+
+  // Change the rate of the limiter, taking effect for the tokens taken from
+  // now on.
+  void set_rate(uint64_t rate_per_sec);
+
+  uint64_t rate() const;
+
+  // Take 'amount' tokens, sleeping until the rate allows it. Returns the time
+  // spent sleeping.
+  MonoDelta Acquire(uint64_t amount);
+
+  // Take 'amount' tokens at time 'now', returning the time the caller must
+  // wait for before using them.
+  MonoDelta Reserve(MonoTime now, uint64_t amount);
+
+ private:
+  const MonoDelta burst_;
+
+  mutable simple_spinlock lock_;
+  uint64_t rate_per_sec_;
+  // The time at which the tokens taken so far are paid for.
+  MonoTime next_free_;
+
+  DISALLOW_COPY_AND_ASSIGN(RateLimiter);
+};
+
+} // namespace kudu
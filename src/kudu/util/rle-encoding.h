@@ -325,10 +325,12 @@ inline size_t RleDecoder<T>::GetNextRun(T* val, size_t max_run) {
         rem--;
       }
 
-      while (literal_count_ > 0) {
+      // Don't read past the requested values: beyond them may be the end of
+      // the data.
+      while (literal_count_ > 0 && rem > 0) {
         bool result = bit_reader_.GetValue(bit_width_, &current_value_);
         DCHECK(result);
-        if (current_value_ != *val || rem == 0) {
+        if (current_value_ != *val) {
           bit_reader_.Rewind(bit_width_);
           return ret;
         }
@@ -336,6 +338,9 @@ inline size_t RleDecoder<T>::GetNextRun(T* val, size_t max_run) {
         rem--;
         literal_count_--;
       }
+      if (rem == 0) {
+        return ret;
+      }
     }
   }
   return ret;
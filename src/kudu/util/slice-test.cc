@@ -17,16 +17,26 @@
 
 #include "kudu/util/slice.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <map>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include <glog/logging.h>
 #include <gtest/gtest.h>
 
 #include "kudu/gutil/map-util.h"
+#include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/fastmem.h"
+#include "kudu/util/random.h"
+#include "kudu/util/stopwatch.h"
+#include "kudu/util/test_util.h"
 
 using std::string;
+using std::vector;
 
 namespace kudu {
 
@@ -58,4 +68,65 @@ TEST(SliceTest, TestSliceMap) {
   }
 }
 
+static int Sign(int r) {
+  return r < 0 ? -1 : (r > 0 ? 1 : 0);
+}
+
+// Verify that the word-at-a-time comparison and prefix length agree with
+// memcmp() for every length and position of the first differing byte.
+TEST(SliceTest, TestFastCompareAndPrefixLength) {
+  Random r(SeedRandom());
+  uint8_t a[100];
+  uint8_t b[100];
+  for (int n = 0; n <= 80; n++) {
+    for (int diff_pos = 0; diff_pos <= n; diff_pos++) {
+      for (int i = 0; i < n; i++) {
+        a[i] = b[i] = r.Uniform(256);
+      }
+      if (diff_pos < n) {
+        // Differ in either direction, and sometimes only by the top bit.
+        b[diff_pos] = r.OneIn(2) ? a[diff_pos] ^ 0x80 : r.Uniform(256);
+      }
+      SCOPED_TRACE(n);
+      SCOPED_TRACE(diff_pos);
+      ASSERT_EQ(Sign(memcmp(a, b, n)), Sign(strings::fastmemcmp_inlined(a, b, n)));
+      ASSERT_EQ(Sign(memcmp(b, a, n)), Sign(strings::fastmemcmp_inlined(b, a, n)));
+      const size_t expected_prefix = std::mismatch(a, a + n, b).first - a;
+      ASSERT_EQ(expected_prefix, strings::common_prefix_length(a, b, n));
+    }
+  }
+}
+
+// Compares the inlined comparison with memcmp() on keys sharing long
+// prefixes, like the encoded composite keys of a tablet.
+TEST(SliceTest, TestCompareKeysBenchmark) {
+  constexpr int kNumKeys = 1000;
+  const int num_rounds = AllowSlowTests() ? 10000 : 100;
+  vector<string> keys;
+  for (int i = 0; i < kNumKeys; i++) {
+    keys.emplace_back(StringPrintf("host-%04d.example.com", i % 10) + string("\0\0", 2) +
+                      StringPrintf("metric-%08d", i));
+  }
+  std::sort(keys.begin(), keys.end());
+  vector<Slice> slices(keys.begin(), keys.end());
+
+  int64_t total = 0;
+  LOG_TIMING(INFO, "memcmp") {
+    for (int round = 0; round < num_rounds; round++) {
+      for (int i = 1; i < kNumKeys; i++) {
+        total += Sign(memcmp(slices[i - 1].data(), slices[i].data(), slices[i].size()));
+      }
+    }
+  }
+  LOG_TIMING(INFO, "fastmemcmp_inlined") {
+    for (int round = 0; round < num_rounds; round++) {
+      for (int i = 1; i < kNumKeys; i++) {
+        total += Sign(strings::fastmemcmp_inlined(slices[i - 1].data(), slices[i].data(),
+                                                  slices[i].size()));
+      }
+    }
+  }
+  ASSERT_EQ(-2 * num_rounds * (kNumKeys - 1), total);
+}
+
 } // namespace kudu
@@ -108,6 +108,9 @@ KuduTest::KuduTest()
     {"ipki_server_key_size", "1024"},
     {"ipki_ca_key_size", "1024"},
     {"tsk_num_rsa_bits", "512"},
+    // Tests expect the consumption of the memory trackers to be exact, whichever
+    // thread changed it.
+    {"mem_tracker_consumption_batch_bytes", "0"},
   };
   for (const auto& e : flags_for_tests) {
     // We don't check for errors here, because we have some default flags that
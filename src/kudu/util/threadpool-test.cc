@@ -938,4 +938,107 @@ TEST_F(ThreadPoolTest, TestLIFOThreadWakeUps) {
   NO_PENDING_FATALS();
 }
 
+TEST_F(ThreadPoolTest, TestWorkStealing) {
+  const int kNumThreads = 4;
+  const int kNumTasks = 100;
+  ASSERT_OK(RebuildPoolWithBuilder(ThreadPoolBuilder(kDefaultPoolName)
+                                   .set_min_threads(1)
+                                   .set_max_threads(kNumThreads)
+                                   .set_work_stealing(true)));
+  // The work-stealing pools run all their threads at all times.
+  ASSERT_EQ(kNumThreads, pool_->num_threads());
+
+  // The tasks submitted by a worker are queued for itself: as it stays busy
+  // until they've all run, the other threads must steal them.
+  CountDownLatch latch(kNumTasks);
+  ASSERT_OK(pool_->SubmitFunc([&]() {
+    for (int i = 0; i < kNumTasks; i++) {
+      CHECK_OK(pool_->SubmitFunc([&]() { latch.CountDown(); }));
+    }
+    latch.Wait();
+  }));
+  pool_->Wait();
+  ASSERT_EQ(0, latch.count());
+
+  // The tasks submitted from outside of the pool are spread over the threads.
+  Atomic32 counter(0);
+  for (int i = 0; i < kNumTasks; i++) {
+    ASSERT_OK(pool_->SubmitFunc(boost::bind(&SimpleTaskMethod, 10, &counter)));
+  }
+  pool_->Wait();
+  ASSERT_EQ(kNumTasks * 10, base::subtle::NoBarrier_Load(&counter));
+}
+
+TEST_F(ThreadPoolTest, TestWorkStealingWithTokens) {
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity = METRIC_ENTITY_test_entity.Instantiate(
+      &registry, "test");
+  ThreadPoolMetrics metrics{
+    METRIC_queue_length.Instantiate(entity),
+    METRIC_queue_time.Instantiate(entity),
+    METRIC_run_time.Instantiate(entity)
+  };
+  ASSERT_OK(RebuildPoolWithBuilder(ThreadPoolBuilder(kDefaultPoolName)
+                                   .set_max_threads(4)
+                                   .set_metrics(metrics)
+                                   .set_work_stealing(true)));
+
+  // The tasks of a serial token still run one at a time, in order, among the
+  // tokenless ones.
+  const int kNumTasks = 50;
+  unique_ptr<ThreadPoolToken> t = pool_->NewToken(ThreadPool::ExecutionMode::SERIAL);
+  vector<int> order;
+  Atomic32 counter(0);
+  for (int i = 0; i < kNumTasks; i++) {
+    ASSERT_OK(t->SubmitFunc([&order, i]() { order.push_back(i); }));
+    ASSERT_OK(pool_->SubmitFunc(boost::bind(&SimpleTaskMethod, 10, &counter)));
+  }
+  t->Wait();
+  pool_->Wait();
+  ASSERT_EQ(kNumTasks, order.size());
+  for (int i = 0; i < kNumTasks; i++) {
+    ASSERT_EQ(i, order[i]);
+  }
+  ASSERT_EQ(kNumTasks * 10, base::subtle::NoBarrier_Load(&counter));
+
+  // All the tasks are accounted for in the metrics.
+  ASSERT_EQ(2 * kNumTasks, metrics.queue_length_histogram->TotalCount());
+  ASSERT_EQ(2 * kNumTasks, metrics.queue_time_us_histogram->TotalCount());
+  ASSERT_EQ(2 * kNumTasks, metrics.run_time_us_histogram->TotalCount());
+}
+
+TEST_F(ThreadPoolTest, TestWorkStealingShutdown) {
+  ASSERT_OK(RebuildPoolWithBuilder(ThreadPoolBuilder(kDefaultPoolName)
+                                   .set_max_threads(1)
+                                   .set_max_queue_size(10)
+                                   .set_work_stealing(true)));
+
+  // Block the only thread, so that the tasks below stay queued.
+  CountDownLatch started(1);
+  CountDownLatch latch(1);
+  ASSERT_OK(pool_->SubmitFunc([&]() {
+    started.CountDown();
+    latch.Wait();
+  }));
+  started.Wait();
+  Atomic32 counter(0);
+  for (int i = 0; i < 10; i++) {
+    ASSERT_OK(pool_->SubmitFunc(boost::bind(&SimpleTaskMethod, 1, &counter)));
+  }
+  Status s = pool_->SubmitFunc(boost::bind(&SimpleTaskMethod, 1, &counter));
+  ASSERT_TRUE(s.IsServiceUnavailable()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "Thread pool is at capacity");
+
+  // Shutting down drops the queued tasks.
+  thread unblocker([&]() {
+    SleepFor(MonoDelta::FromMilliseconds(500));
+    latch.CountDown();
+  });
+  pool_->Shutdown();
+  unblocker.join();
+  ASSERT_EQ(0, base::subtle::NoBarrier_Load(&counter));
+  s = pool_->SubmitFunc(boost::bind(&SimpleTaskMethod, 1, &counter));
+  ASSERT_TRUE(s.IsServiceUnavailable()) << s.ToString();
+}
+
 } // namespace kudu
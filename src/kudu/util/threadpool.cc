@@ -21,6 +21,7 @@
 #include <deque>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <string>
 #include <utility>
@@ -48,6 +49,19 @@ using std::string;
 using std::unique_ptr;
 using strings::Substitute;
 
+namespace {
+
+// The pool with work stealing the current thread is a worker of, if any, and
+// the index of its queue.
+__thread ThreadPool* tls_worker_pool = nullptr;
+__thread int tls_worker_index = 0;
+
+// The queue the current thread submits its next task to a pool with work
+// stealing in, if it's not a worker of the pool.
+__thread uint32_t tls_next_worker_queue = 0;
+
+} // anonymous namespace
+
 ////////////////////////////////////////////////////////
 // FunctionRunnable
 ////////////////////////////////////////////////////////
@@ -89,7 +103,8 @@ ThreadPoolBuilder::ThreadPoolBuilder(string name)
       min_threads_(0),
       max_threads_(base::NumCPUs()),
       max_queue_size_(std::numeric_limits<int>::max()),
-      idle_timeout_(MonoDelta::FromMilliseconds(500)) {}
+      idle_timeout_(MonoDelta::FromMilliseconds(500)),
+      work_stealing_(false) {}
 
 ThreadPoolBuilder& ThreadPoolBuilder::set_trace_metric_prefix(const string& prefix) {
   trace_metric_prefix_ = prefix;
@@ -123,6 +138,11 @@ ThreadPoolBuilder& ThreadPoolBuilder::set_metrics(ThreadPoolMetrics metrics) {
   return *this;
 }
 
+ThreadPoolBuilder& ThreadPoolBuilder::set_work_stealing(bool work_stealing) {
+  work_stealing_ = work_stealing;
+  return *this;
+}
+
 Status ThreadPoolBuilder::Build(gscoped_ptr<ThreadPool>* pool) const {
   pool->reset(new ThreadPool(*this));
   RETURN_NOT_OK((*pool)->Init());
@@ -194,6 +214,7 @@ void ThreadPoolToken::Shutdown() {
           it++;
         }
       }
+      pool_->queue_size_ = pool_->queue_.size();
 
       if (active_threads_ == 0) {
         Transition(State::QUIESCED);
@@ -309,7 +330,7 @@ const char* ThreadPoolToken::StateToString(State s) {
 
 ThreadPool::ThreadPool(const ThreadPoolBuilder& builder)
   : name_(builder.name_),
-    min_threads_(builder.min_threads_),
+    min_threads_(builder.work_stealing_ ? builder.max_threads_ : builder.min_threads_),
     max_threads_(builder.max_threads_),
     max_queue_size_(builder.max_queue_size_),
     idle_timeout_(builder.idle_timeout_),
@@ -320,8 +341,17 @@ ThreadPool::ThreadPool(const ThreadPoolBuilder& builder)
     num_threads_pending_start_(0),
     active_threads_(0),
     total_queued_tasks_(0),
+    work_stealing_(builder.work_stealing_),
+    worker_queued_tasks_(0),
+    worker_active_tasks_(0),
+    num_idle_threads_(0),
+    queue_size_(0),
+    shutting_down_(false),
     tokenless_(NewToken(ExecutionMode::CONCURRENT)),
     metrics_(builder.metrics_) {
+  if (work_stealing_) {
+    worker_queues_.reset(new WorkerQueue[max_threads_]);
+  }
   string prefix = !builder.trace_metric_prefix_.empty() ?
       builder.trace_metric_prefix_ : builder.name_;
 
@@ -366,13 +396,24 @@ void ThreadPool::Shutdown() {
   // concern though because shutting down a pool typically requires clients to
   // be quiesced first, so there's no danger of a client getting confused.
   pool_status_ = Status::ServiceUnavailable("The pool has been shut down.");
+  shutting_down_ = true;
 
   // Clear the various queues under the lock, but defer the releasing
   // of the tasks outside the lock, in case there are concurrent threads
   // wanting to access the ThreadPool. The task's destructors may acquire
   // locks, etc, so this also prevents lock inversions.
   queue_.clear();
+  queue_size_ = 0;
   std::deque<std::deque<Task>> to_release;
+  if (work_stealing_) {
+    for (int i = 0; i < max_threads_; i++) {
+      WorkerQueue* queue = &worker_queues_[i];
+      std::lock_guard<simple_spinlock> l(queue->lock);
+      worker_queued_tasks_ -= queue->tasks.size();
+      to_release.emplace_back(std::move(queue->tasks));
+      queue->tasks.clear();
+    }
+  }
   for (auto* t : tokens_) {
     if (!t->entries_.empty()) {
       to_release.emplace_back(std::move(t->entries_));
@@ -460,6 +501,9 @@ Status ThreadPool::Submit(shared_ptr<Runnable> r) {
 
 Status ThreadPool::DoSubmit(shared_ptr<Runnable> r, ThreadPoolToken* token) {
   DCHECK(token);
+  if (work_stealing_ && token == tokenless_.get()) {
+    return SubmitToWorkerQueue(std::move(r));
+  }
   MonoTime submit_time = MonoTime::Now();
 
   MutexLock guard(lock_);
@@ -527,6 +571,7 @@ Status ThreadPool::DoSubmit(shared_ptr<Runnable> r, ThreadPoolToken* token) {
   if (state == ThreadPoolToken::State::IDLE ||
       token->mode() == ExecutionMode::CONCURRENT) {
     queue_.emplace_back(token);
+    queue_size_ = queue_.size();
     if (state == ThreadPoolToken::State::IDLE) {
       token->Transition(ThreadPoolToken::State::RUNNING);
     }
@@ -575,7 +620,8 @@ Status ThreadPool::DoSubmit(shared_ptr<Runnable> r, ThreadPoolToken* token) {
 void ThreadPool::Wait() {
   MutexLock unique_lock(lock_);
   CheckNotPoolThreadUnlocked();
-  while (total_queued_tasks_ > 0 || active_threads_ > 0) {
+  while (total_queued_tasks_ > 0 || active_threads_ > 0 ||
+         worker_queued_tasks_ > 0 || worker_active_tasks_ > 0) {
     idle_cond_.Wait();
   }
 }
@@ -583,7 +629,8 @@ void ThreadPool::Wait() {
 bool ThreadPool::WaitUntil(const MonoTime& until) {
   MutexLock unique_lock(lock_);
   CheckNotPoolThreadUnlocked();
-  while (total_queued_tasks_ > 0 || active_threads_ > 0) {
+  while (total_queued_tasks_ > 0 || active_threads_ > 0 ||
+         worker_queued_tasks_ > 0 || worker_active_tasks_ > 0) {
     if (!idle_cond_.WaitUntil(until)) {
       return false;
     }
@@ -648,106 +695,259 @@ void ThreadPool::DispatchThread() {
       continue;
     }
 
-    // Get the next token and task to execute.
-    ThreadPoolToken* token = queue_.front();
-    queue_.pop_front();
-    DCHECK_EQ(ThreadPoolToken::State::RUNNING, token->state());
-    DCHECK(!token->entries_.empty());
-    Task task = std::move(token->entries_.front());
-    token->entries_.pop_front();
-    token->active_threads_++;
-    --total_queued_tasks_;
-    ++active_threads_;
-
-    unique_lock.Unlock();
-
-    // Release the reference which was held by the queued item.
-    ADOPT_TRACE(task.trace);
-    if (task.trace) {
-      task.trace->Release();
-    }
+    RunTokenTask(&unique_lock);
+  }
 
-    // Update metrics
-    MonoTime now(MonoTime::Now());
-    int64_t queue_time_us = (now - task.submit_time).ToMicroseconds();
-    TRACE_COUNTER_INCREMENT(queue_time_trace_metric_name_, queue_time_us);
-    if (metrics_.queue_time_us_histogram) {
-      metrics_.queue_time_us_histogram->Increment(queue_time_us);
-    }
-    if (token->metrics_.queue_time_us_histogram) {
-      token->metrics_.queue_time_us_histogram->Increment(queue_time_us);
-    }
+  // It's important that we hold the lock between exiting the loop and dropping
+  // num_threads_. Otherwise it's possible someone else could come along here
+  // and add a new task just as the last running thread is about to exit.
+  CHECK(unique_lock.OwnsLock());
 
-    // Execute the task
-    {
-      MicrosecondsInt64 start_wall_us = GetMonoTimeMicros();
-      MicrosecondsInt64 start_cpu_us = GetThreadCpuTimeMicros();
+  CHECK_EQ(threads_.erase(Thread::current_thread()), 1);
+  num_threads_--;
+  if (num_threads_ + num_threads_pending_start_ == 0) {
+    no_threads_cond_.Broadcast();
 
-      task.runnable->Run();
+    // Sanity check: if we're the last thread exiting, the queue ought to be
+    // empty. Otherwise it will never get processed.
+    CHECK(queue_.empty());
+    DCHECK_EQ(0, total_queued_tasks_);
+  }
+}
 
-      int64_t wall_us = GetMonoTimeMicros() - start_wall_us;
-      int64_t cpu_us = GetThreadCpuTimeMicros() - start_cpu_us;
+void ThreadPool::DispatchWorkStealingThread() {
+  MutexLock unique_lock(lock_);
+  InsertOrDie(&threads_, Thread::current_thread());
+  DCHECK_GT(num_threads_pending_start_, 0);
+  num_threads_++;
+  num_threads_pending_start_--;
+  // The threads only exit once the pool is shut down, so their indexes are
+  // unique.
+  const int index = num_threads_ - 1;
+  DCHECK_LT(index, max_threads_);
+  tls_worker_pool = this;
+  tls_worker_index = index;
 
-      if (metrics_.run_time_us_histogram) {
-        metrics_.run_time_us_histogram->Increment(wall_us);
-      }
-      if (token->metrics_.run_time_us_histogram) {
-        token->metrics_.run_time_us_histogram->Increment(wall_us);
+  // Owned by this worker thread and added/removed from idle_threads_ as needed.
+  IdleThread me(&lock_);
+  unique_lock.Unlock();
+
+  while (true) {
+    if (shutting_down_) {
+      VLOG(2) << "DispatchWorkStealingThread exiting: the pool has been shut down";
+      break;
+    }
+
+    // The tasks of the tokens first, so that they're not starved by the
+    // tokenless ones.
+    if (queue_size_ > 0) {
+      unique_lock.Lock();
+      if (!queue_.empty() && pool_status_.ok()) {
+        RunTokenTask(&unique_lock);
       }
-      TRACE_COUNTER_INCREMENT(run_wall_time_trace_metric_name_, wall_us);
-      TRACE_COUNTER_INCREMENT(run_cpu_time_trace_metric_name_, cpu_us);
+      unique_lock.Unlock();
+      continue;
     }
-    // Destruct the task while we do not hold the lock.
-    //
-    // The task's destructor may be expensive if it has a lot of bound
-    // objects, and we don't want to block submission of the threadpool.
-    // In the worst case, the destructor might even try to do something
-    // with this threadpool, and produce a deadlock.
-    task.runnable.reset();
-    unique_lock.Lock();
 
-    // Possible states:
-    // 1. The token was shut down while we ran its task. Transition to QUIESCED.
-    // 2. The token has no more queued tasks. Transition back to IDLE.
-    // 3. The token has more tasks. Requeue it and transition back to RUNNABLE.
-    ThreadPoolToken::State state = token->state();
-    DCHECK(state == ThreadPoolToken::State::RUNNING ||
-           state == ThreadPoolToken::State::QUIESCING);
-    if (--token->active_threads_ == 0) {
-      if (state == ThreadPoolToken::State::QUIESCING) {
-        DCHECK(token->entries_.empty());
-        token->Transition(ThreadPoolToken::State::QUIESCED);
-      } else if (token->entries_.empty()) {
-        token->Transition(ThreadPoolToken::State::IDLE);
-      } else if (token->mode() == ExecutionMode::SERIAL) {
-        queue_.emplace_back(token);
+    Task task;
+    if (PopWorkerTask(index, &task)) {
+      RunTask(&task, nullptr);
+      if (--worker_active_tasks_ == 0 && worker_queued_tasks_ == 0) {
+        MutexLock l(lock_);
+        idle_cond_.Broadcast();
       }
+      continue;
     }
-    if (--active_threads_ == 0) {
-      idle_cond_.Broadcast();
+
+    // There's no work to do, let's go idle, unless a task was submitted since
+    // the queues were checked: the submitters check 'num_idle_threads_' after
+    // queueing their task.
+    unique_lock.Lock();
+    num_idle_threads_++;
+    SCOPED_CLEANUP({
+      num_idle_threads_--;
+      unique_lock.Unlock();
+    });
+    if (!pool_status_.ok() || !queue_.empty() || worker_queued_tasks_ > 0) {
+      continue;
+    }
+    idle_threads_.push_front(me);
+    me.not_empty.Wait();
+    if (me.is_linked()) {
+      idle_threads_.erase(idle_threads_.iterator_to(me));
     }
   }
 
   // It's important that we hold the lock between exiting the loop and dropping
   // num_threads_. Otherwise it's possible someone else could come along here
   // and add a new task just as the last running thread is about to exit.
-  CHECK(unique_lock.OwnsLock());
-
+  unique_lock.Lock();
+  tls_worker_pool = nullptr;
   CHECK_EQ(threads_.erase(Thread::current_thread()), 1);
   num_threads_--;
   if (num_threads_ + num_threads_pending_start_ == 0) {
     no_threads_cond_.Broadcast();
-
-    // Sanity check: if we're the last thread exiting, the queue ought to be
-    // empty. Otherwise it will never get processed.
     CHECK(queue_.empty());
     DCHECK_EQ(0, total_queued_tasks_);
   }
 }
 
+void ThreadPool::RunTokenTask(MutexLock* unique_lock) {
+  DCHECK(unique_lock->OwnsLock());
+  // Get the next token and task to execute.
+  ThreadPoolToken* token = queue_.front();
+  queue_.pop_front();
+  queue_size_ = queue_.size();
+  DCHECK_EQ(ThreadPoolToken::State::RUNNING, token->state());
+  DCHECK(!token->entries_.empty());
+  Task task = std::move(token->entries_.front());
+  token->entries_.pop_front();
+  token->active_threads_++;
+  --total_queued_tasks_;
+  ++active_threads_;
+
+  unique_lock->Unlock();
+  RunTask(&task, &token->metrics_);
+  unique_lock->Lock();
+
+  // Possible states:
+  // 1. The token was shut down while we ran its task. Transition to QUIESCED.
+  // 2. The token has no more queued tasks. Transition back to IDLE.
+  // 3. The token has more tasks. Requeue it and transition back to RUNNABLE.
+  ThreadPoolToken::State state = token->state();
+  DCHECK(state == ThreadPoolToken::State::RUNNING ||
+         state == ThreadPoolToken::State::QUIESCING);
+  if (--token->active_threads_ == 0) {
+    if (state == ThreadPoolToken::State::QUIESCING) {
+      DCHECK(token->entries_.empty());
+      token->Transition(ThreadPoolToken::State::QUIESCED);
+    } else if (token->entries_.empty()) {
+      token->Transition(ThreadPoolToken::State::IDLE);
+    } else if (token->mode() == ExecutionMode::SERIAL) {
+      queue_.emplace_back(token);
+      queue_size_ = queue_.size();
+    }
+  }
+  if (--active_threads_ == 0) {
+    idle_cond_.Broadcast();
+  }
+}
+
+void ThreadPool::RunTask(Task* task, const ThreadPoolMetrics* token_metrics) {
+  // Release the reference which was held by the queued item.
+  ADOPT_TRACE(task->trace);
+  if (task->trace) {
+    task->trace->Release();
+  }
+
+  // Update metrics
+  MonoTime now(MonoTime::Now());
+  int64_t queue_time_us = (now - task->submit_time).ToMicroseconds();
+  TRACE_COUNTER_INCREMENT(queue_time_trace_metric_name_, queue_time_us);
+  if (metrics_.queue_time_us_histogram) {
+    metrics_.queue_time_us_histogram->Increment(queue_time_us);
+  }
+  if (token_metrics && token_metrics->queue_time_us_histogram) {
+    token_metrics->queue_time_us_histogram->Increment(queue_time_us);
+  }
+
+  // Execute the task
+  {
+    MicrosecondsInt64 start_wall_us = GetMonoTimeMicros();
+    MicrosecondsInt64 start_cpu_us = GetThreadCpuTimeMicros();
+
+    task->runnable->Run();
+
+    int64_t wall_us = GetMonoTimeMicros() - start_wall_us;
+    int64_t cpu_us = GetThreadCpuTimeMicros() - start_cpu_us;
+
+    if (metrics_.run_time_us_histogram) {
+      metrics_.run_time_us_histogram->Increment(wall_us);
+    }
+    if (token_metrics && token_metrics->run_time_us_histogram) {
+      token_metrics->run_time_us_histogram->Increment(wall_us);
+    }
+    TRACE_COUNTER_INCREMENT(run_wall_time_trace_metric_name_, wall_us);
+    TRACE_COUNTER_INCREMENT(run_cpu_time_trace_metric_name_, cpu_us);
+  }
+  // Destruct the task while we do not hold the lock.
+  //
+  // The task's destructor may be expensive if it has a lot of bound
+  // objects, and we don't want to block submission of the threadpool.
+  // In the worst case, the destructor might even try to do something
+  // with this threadpool, and produce a deadlock.
+  task->runnable.reset();
+}
+
+Status ThreadPool::SubmitToWorkerQueue(shared_ptr<Runnable> r) {
+  MonoTime submit_time = MonoTime::Now();
+  if (PREDICT_FALSE(shutting_down_)) {
+    return Status::ServiceUnavailable("The pool has been shut down.");
+  }
+  // Size limit check.
+  if (worker_queued_tasks_ >= max_queue_size_) {
+    return Status::ServiceUnavailable(
+        Substitute("Thread pool is at capacity ($0/$1 tasks queued)",
+                   worker_queued_tasks_.load(), max_queue_size_));
+  }
+
+  Task task;
+  task.runnable = std::move(r);
+  task.trace = Trace::CurrentTrace();
+  // Need to AddRef, since the thread which submitted the task may go away,
+  // and we don't want the trace to be destructed while waiting in the queue.
+  if (task.trace) {
+    task.trace->AddRef();
+  }
+  task.submit_time = submit_time;
+
+  // The task is accounted for before it's queued, so that the threads going
+  // idle see it, and so that the count never goes negative.
+  int64_t length_at_submit = worker_queued_tasks_++;
+  const int index = tls_worker_pool == this ?
+      tls_worker_index : tls_next_worker_queue++ % max_threads_;
+  WorkerQueue* queue = &worker_queues_[index];
+  {
+    std::lock_guard<simple_spinlock> l(queue->lock);
+    queue->tasks.emplace_back(std::move(task));
+  }
+
+  // Wake up an idle thread for this task, if any.
+  if (num_idle_threads_ > 0) {
+    MutexLock guard(lock_);
+    if (!idle_threads_.empty()) {
+      idle_threads_.front().not_empty.Signal();
+      idle_threads_.pop_front();
+    }
+  }
+
+  if (metrics_.queue_length_histogram) {
+    metrics_.queue_length_histogram->Increment(length_at_submit);
+  }
+  return Status::OK();
+}
+
+bool ThreadPool::PopWorkerTask(int index, Task* task) {
+  for (int i = 0; i < max_threads_; i++) {
+    WorkerQueue* queue = &worker_queues_[(index + i) % max_threads_];
+    std::lock_guard<simple_spinlock> l(queue->lock);
+    if (!queue->tasks.empty()) {
+      *task = std::move(queue->tasks.front());
+      queue->tasks.pop_front();
+      // Active before dequeued, so that Wait() never sees neither.
+      worker_active_tasks_++;
+      worker_queued_tasks_--;
+      return true;
+    }
+  }
+  return false;
+}
+
 Status ThreadPool::CreateThread() {
   return kudu::Thread::Create("thread pool", strings::Substitute("$0 [worker]", name_),
-                              &ThreadPool::DispatchThread, this, nullptr);
+                              work_stealing_ ? &ThreadPool::DispatchWorkStealingThread
+                                             : &ThreadPool::DispatchThread,
+                              this, nullptr);
 }
 
 void ThreadPool::CheckNotPoolThreadUnlocked() {
@@ -17,6 +17,7 @@
 #ifndef KUDU_UTIL_THREAD_POOL_H
 #define KUDU_UTIL_THREAD_POOL_H
 
+#include <atomic>
 #include <deque>
 #include <iosfwd>
 #include <memory>
@@ -33,6 +34,7 @@
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/util/condition_variable.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/mutex.h"
@@ -114,6 +116,15 @@ struct ThreadPoolMetrics {
 // metrics: Histograms, counters, etc. to update on various threadpool events.
 //    Default: not set.
 //
+// work_stealing: Whether the tasks submitted without a token are queued per
+//    worker thread rather than in the queue shared by all the threads, idle
+//    threads stealing the tasks queued for the others. This keeps the threads
+//    submitting and running many small tasks from contending on the lock of
+//    the pool. A pool with work stealing has a fixed number of threads: all
+//    'max_threads' are started with the pool and 'min_threads' and
+//    'idle_timeout' are ignored.
+//    Default: false.
+//
 class ThreadPoolBuilder {
  public:
   explicit ThreadPoolBuilder(std::string name);
@@ -126,6 +137,7 @@ class ThreadPoolBuilder {
   ThreadPoolBuilder& set_max_queue_size(int max_queue_size);
   ThreadPoolBuilder& set_idle_timeout(const MonoDelta& idle_timeout);
   ThreadPoolBuilder& set_metrics(ThreadPoolMetrics metrics);
+  ThreadPoolBuilder& set_work_stealing(bool work_stealing);
 
   // Instantiate a new ThreadPool with the existing builder arguments.
   Status Build(gscoped_ptr<ThreadPool>* pool) const;
@@ -139,6 +151,7 @@ class ThreadPoolBuilder {
   int max_queue_size_;
   MonoDelta idle_timeout_;
   ThreadPoolMetrics metrics_;
+  bool work_stealing_;
 
   DISALLOW_COPY_AND_ASSIGN(ThreadPoolBuilder);
 };
@@ -164,6 +177,12 @@ class ThreadPoolBuilder {
 // from starving one another. However, tokenless (and CONCURRENT token-based)
 // tasks can starve SERIAL token-based tasks.
 //
+// With work stealing, the tasks submitted without a token are queued in the
+// queue of the submitting worker thread, or of one of the threads in turn if
+// submitted from outside the pool, and each thread runs the tasks of its queue
+// in FIFO order before stealing those of the others. The tasks of the tokens
+// are still queued in the shared queue, and run before the tokenless ones.
+//
 // Usage Example:
 //    static void Func(int n) { ... }
 //    class Task : public Runnable { ... }
@@ -258,9 +277,41 @@ class ThreadPool {
   // Initializes the thread pool by starting the minimum number of threads.
   Status Init();
 
+  // A queue of the tasks submitted without a token to a pool with work
+  // stealing, one per worker thread.
+  struct WorkerQueue {
+    simple_spinlock lock;
+    std::deque<Task> tasks;
+    // The queues of the threads are on their own cache lines.
+    char padding[CACHELINE_SIZE];
+  };
+
   // Dispatcher responsible for dequeueing and executing the tasks
   void DispatchThread();
 
+  // Dispatcher of the pools with work stealing: runs the tasks of the tokens,
+  // then those of the thread's own queue, then those stolen from the queues
+  // of the other threads.
+  void DispatchWorkStealingThread();
+
+  // Runs the next task of the token at the front of 'queue_', unlocking
+  // 'unique_lock' while the task runs.
+  //
+  // REQUIRES: 'unique_lock' is locked and 'queue_' isn't empty.
+  void RunTokenTask(MutexLock* unique_lock);
+
+  // Runs 'task' and updates the metrics, including the ones of 'token_metrics'
+  // if non-null.
+  void RunTask(Task* task, const ThreadPoolMetrics* token_metrics);
+
+  // Submits a task without a token to a pool with work stealing.
+  Status SubmitToWorkerQueue(std::shared_ptr<Runnable> r);
+
+  // Pops the next task of the queue of the worker thread 'index', or else of
+  // the queue of another thread, into 'task', accounting for it as active.
+  // Returns false if all the queues are empty.
+  bool PopWorkerTask(int index, Task* task);
+
   // Create new thread.
   //
   // REQUIRES: caller has incremented 'num_threads_pending_start_' ahead of this call.
@@ -322,6 +373,32 @@ class ThreadPool {
   // Protected by lock_.
   int total_queued_tasks_;
 
+  // Whether the tasks submitted without a token are queued per worker thread.
+  const bool work_stealing_;
+
+  // The queues of the worker threads, if 'work_stealing_'.
+  std::unique_ptr<WorkerQueue[]> worker_queues_;
+
+  // The number of tasks queued in 'worker_queues_', and of those running.
+  // Changing either of them to 0 while the other is 0 requires lock_ to
+  // notify idle_cond_.
+  std::atomic<int64_t> worker_queued_tasks_;
+  std::atomic<int64_t> worker_active_tasks_;
+
+  // The number of threads looking for tasks before going idle, or idle: the
+  // submitters of the tasks to 'worker_queues_' only take lock_ to wake one
+  // up when it's positive.
+  std::atomic<int> num_idle_threads_;
+
+  // The size of 'queue_', for the worker threads to check it without lock_.
+  //
+  // Written with lock_ held.
+  std::atomic<int> queue_size_;
+
+  // Set when the pool with work stealing is shut down, for the threads and
+  // submitters to check it without lock_.
+  std::atomic<bool> shutting_down_;
+
   // All allocated tokens.
   //
   // Protected by lock_.
@@ -17,6 +17,7 @@
 
 #include "kudu/util/trace.h"
 
+#include <atomic>
 #include <cstdint>
 #include <cstring>
 #include <iomanip>
@@ -44,8 +45,13 @@ namespace kudu {
 
 __thread Trace* Trace::threadlocal_trace_;
 
+namespace {
+std::atomic<uint64_t> next_trace_id(1);
+} // anonymous namespace
+
 Trace::Trace()
-    : arena_(new ThreadSafeArena(1024)),
+    : id_(next_trace_id.fetch_add(1, std::memory_order_relaxed)),
+      arena_(new ThreadSafeArena(1024)),
       entries_head_(nullptr),
       entries_tail_(nullptr) {
   // We expect small allocations from our Arena so no need to have
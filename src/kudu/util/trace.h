@@ -17,6 +17,7 @@
 #ifndef KUDU_UTIL_TRACE_H
 #define KUDU_UTIL_TRACE_H
 
+#include <cstdint>
 #include <iosfwd>
 #include <string>
 #include <utility>
@@ -205,6 +206,12 @@ class Trace : public RefCountedThreadSafe<Trace> {
     return metrics_;
   }
 
+  // Returns the ID of this trace, unique within the process, which its
+  // events in the trace rings are tagged with. See trace_ring.h.
+  uint64_t id() const {
+    return id_;
+  }
+
  private:
   friend class ScopedAdoptTrace;
   friend class RefCountedThreadSafe<Trace>;
@@ -224,6 +231,8 @@ class Trace : public RefCountedThreadSafe<Trace> {
 
   void MetricsToJSON(JsonWriter* jw) const;
 
+  const uint64_t id_;
+
   gscoped_ptr<ThreadSafeArena> arena_;
 
   // Lock protecting the entries linked list.
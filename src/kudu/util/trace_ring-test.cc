@@ -0,0 +1,133 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/trace_ring.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gflags/gflags_declare.h>
+#include <gtest/gtest.h>
+
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+#include "kudu/util/trace.h"
+
+DECLARE_int32(trace_ring_events_per_thread);
+
+using std::string;
+using std::thread;
+using std::vector;
+
+namespace kudu {
+
+class TraceRingTest : public KuduTest {};
+
+TEST_F(TraceRingTest, TestCollectEvents) {
+  scoped_refptr<Trace> trace(new Trace);
+  scoped_refptr<Trace> child(new Trace);
+  scoped_refptr<Trace> other(new Trace);
+  trace->AddChildTrace("child", child.get());
+  ASSERT_NE(trace->id(), child->id());
+
+  // Nothing is recorded without a trace.
+  TRACE_RING("No trace");
+  {
+    ADOPT_TRACE(trace.get());
+    TRACE_RING("Started");
+    TRACE_RING("Got $0 rows and $1 bytes", 10, 2048);
+  }
+  {
+    ADOPT_TRACE(other.get());
+    TRACE_RING("Other trace");
+  }
+  // The child trace is recorded on another thread.
+  thread t([&]() {
+    ADOPT_TRACE(child.get());
+    TRACE_RING("Child event $0", 1);
+  });
+  t.join();
+
+  vector<TraceRing::Event> events;
+  TraceRing::CollectEvents(*trace.get(), &events);
+  ASSERT_EQ(3, events.size());
+  ASSERT_STR_CONTAINS(events[0].ToString(), "trace_ring-test.cc");
+  ASSERT_STR_CONTAINS(events[0].ToString(), "] Started");
+  ASSERT_STR_CONTAINS(events[1].ToString(), "] Got 10 rows and 2048 bytes");
+  ASSERT_STR_CONTAINS(events[2].ToString(), "] Child event 1");
+  ASSERT_EQ(child->id(), events[2].trace_id);
+  for (int i = 1; i < events.size(); i++) {
+    ASSERT_LE(events[i - 1].time_us, events[i].time_us);
+  }
+  const string s = TraceRing::EventsToString(events);
+  ASSERT_STR_CONTAINS(s, "(+0us)");
+  ASSERT_STR_NOT_CONTAINS(s, "Other trace");
+}
+
+// Verify that only the most recent events of a thread are kept.
+TEST_F(TraceRingTest, TestWrapAround) {
+  FLAGS_trace_ring_events_per_thread = 16;
+  scoped_refptr<Trace> trace(new Trace);
+  // A new thread, so that its ring has the new size.
+  thread t([&]() {
+    ADOPT_TRACE(trace.get());
+    for (int i = 0; i < 100; i++) {
+      TRACE_RING("Event $0", i);
+    }
+  });
+  t.join();
+
+  vector<TraceRing::Event> events;
+  TraceRing::CollectEvents(*trace.get(), &events);
+  ASSERT_EQ(16, events.size());
+  for (int i = 0; i < events.size(); i++) {
+    ASSERT_EQ(84 + i, events[i].args[0]);
+  }
+}
+
+// Verify that the rings can be read while they are written.
+TEST_F(TraceRingTest, TestConcurrentCollect) {
+  scoped_refptr<Trace> trace(new Trace);
+  std::atomic<bool> done(false);
+  vector<thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&]() {
+      ADOPT_TRACE(trace.get());
+      for (int64_t n = 0; !done; n++) {
+        TRACE_RING("Event $0 $1", n, n * 2);
+      }
+    });
+  }
+  for (int i = 0; i < 100; i++) {
+    vector<TraceRing::Event> events;
+    TraceRing::CollectEvents(*trace.get(), &events);
+    for (const auto& event : events) {
+      ASSERT_EQ(trace->id(), event.trace_id);
+      ASSERT_EQ(event.args[0] * 2, event.args[1]);
+    }
+  }
+  done = true;
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
+} // namespace kudu
@@ -0,0 +1,204 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/trace_ring.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <utility>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/stringpiece.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/locks.h"
+
+DEFINE_int32(trace_ring_events_per_thread, 1024,
+             "The number of the most recent trace events of each thread kept "
+             "in its trace ring, to reconstruct the operations found to be "
+             "slow. Changing it only affects the rings of the new threads. "
+             "0 disables the trace rings.");
+TAG_FLAG(trace_ring_events_per_thread, advanced);
+TAG_FLAG(trace_ring_events_per_thread, runtime);
+DEFINE_validator(trace_ring_events_per_thread,
+                 [](const char* /*flagname*/, int32_t value) { return value >= 0; });
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+
+namespace {
+
+// The rings of all the threads, and the ones of the exited threads which are
+// free to be reused. Leaked, so that the rings outlive the threads.
+simple_spinlock rings_lock;
+vector<TraceRing*>* all_rings = nullptr;
+vector<TraceRing*>* free_rings = nullptr;
+
+// Same as in trace.cc.
+const char* const_basename(const char* filepath) {
+  const char* base = strrchr(filepath, '/');
+  return base ? (base + 1) : filepath;
+}
+
+} // anonymous namespace
+
+DEFINE_STATIC_THREAD_LOCAL(TraceRing::ThreadLease, TraceRing, tls_lease_);
+
+TraceRing::TraceRing(size_t capacity)
+    : capacity_(capacity),
+      slots_(new Slot[capacity]),
+      next_(0) {
+  for (size_t i = 0; i < capacity_; i++) {
+    slots_[i].seq.store(0, std::memory_order_relaxed);
+  }
+}
+
+TraceRing::ThreadLease::~ThreadLease() {
+  std::lock_guard<simple_spinlock> l(rings_lock);
+  free_rings->push_back(ring_);
+}
+
+TraceRing* TraceRing::AcquireRing() {
+  const size_t capacity = FLAGS_trace_ring_events_per_thread;
+  {
+    std::lock_guard<simple_spinlock> l(rings_lock);
+    if (all_rings == nullptr) {
+      all_rings = new vector<TraceRing*>();
+      free_rings = new vector<TraceRing*>();
+    }
+    // Only reuse the rings of the current size.
+    for (auto it = free_rings->begin(); it != free_rings->end(); ++it) {
+      if ((*it)->capacity_ == capacity) {
+        TraceRing* ring = *it;
+        free_rings->erase(it);
+        return ring;
+      }
+    }
+  }
+  TraceRing* ring = new TraceRing(capacity);
+  std::lock_guard<simple_spinlock> l(rings_lock);
+  all_rings->push_back(ring);
+  return ring;
+}
+
+void TraceRing::Record(const TraceRingEventType* type,
+                       uint64_t trace_id,
+                       int64_t arg0,
+                       int64_t arg1) {
+  if (PREDICT_FALSE(FLAGS_trace_ring_events_per_thread == 0)) {
+    return;
+  }
+  INIT_STATIC_THREAD_LOCAL(ThreadLease, tls_lease_, AcquireRing());
+  TraceRing* ring = tls_lease_->ring();
+  if (PREDICT_FALSE(ring->capacity_ == 0)) {
+    return;
+  }
+
+  const uint64_t index = ring->next_++;
+  Slot* slot = &ring->slots_[index % ring->capacity_];
+  slot->seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot->trace_id.store(trace_id, std::memory_order_relaxed);
+  slot->type.store(type, std::memory_order_relaxed);
+  slot->time_us.store(GetCurrentTimeMicros(), std::memory_order_relaxed);
+  slot->args[0].store(arg0, std::memory_order_relaxed);
+  slot->args[1].store(arg1, std::memory_order_relaxed);
+  slot->seq.store(index + 1, std::memory_order_release);
+}
+
+void TraceRing::CollectEvents(const vector<uint64_t>& trace_ids,
+                              vector<Event>* events) const {
+  for (size_t i = 0; i < capacity_; i++) {
+    const Slot& slot = slots_[i];
+    const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq == 0) {
+      continue;
+    }
+    Event event;
+    event.index = seq - 1;
+    event.trace_id = slot.trace_id.load(std::memory_order_relaxed);
+    event.type = slot.type.load(std::memory_order_relaxed);
+    event.time_us = slot.time_us.load(std::memory_order_relaxed);
+    event.args[0] = slot.args[0].load(std::memory_order_relaxed);
+    event.args[1] = slot.args[1].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // Skip the slot if it was overwritten while being read.
+    if (slot.seq.load(std::memory_order_relaxed) != seq) {
+      continue;
+    }
+    if (std::find(trace_ids.begin(), trace_ids.end(), event.trace_id) != trace_ids.end()) {
+      events->push_back(event);
+    }
+  }
+}
+
+void TraceRing::CollectEvents(const Trace& trace, vector<Event>* events) {
+  vector<uint64_t> trace_ids;
+  vector<scoped_refptr<Trace>> to_visit;
+  trace_ids.push_back(trace.id());
+  for (const auto& child : trace.ChildTraces()) {
+    to_visit.push_back(child.second);
+  }
+  while (!to_visit.empty()) {
+    scoped_refptr<Trace> t = std::move(to_visit.back());
+    to_visit.pop_back();
+    trace_ids.push_back(t->id());
+    for (const auto& child : t->ChildTraces()) {
+      to_visit.push_back(child.second);
+    }
+  }
+
+  const size_t first = events->size();
+  {
+    std::lock_guard<simple_spinlock> l(rings_lock);
+    if (all_rings != nullptr) {
+      for (const TraceRing* ring : *all_rings) {
+        ring->CollectEvents(trace_ids, events);
+      }
+    }
+  }
+  // The events of a thread may have the same time, so they're also ordered
+  // by their index in their ring.
+  std::sort(events->begin() + first, events->end(),
+            [](const Event& a, const Event& b) {
+              return a.time_us != b.time_us ? a.time_us < b.time_us : a.index < b.index;
+            });
+}
+
+string TraceRing::Event::ToString() const {
+  return strings::Substitute("$0:$1] $2",
+                             const_basename(type->file_path), type->line_number,
+                             strings::Substitute(type->format, args[0], args[1]));
+}
+
+string TraceRing::EventsToString(const vector<Event>& events) {
+  string s;
+  for (const Event& event : events) {
+    strings::SubstituteAndAppend(&s, "(+$0us) $1\n",
+                                 event.time_us - events.front().time_us,
+                                 event.ToString());
+  }
+  return s;
+}
+
+} // namespace kudu
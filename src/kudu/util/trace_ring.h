@@ -0,0 +1,144 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/walltime.h"
+#include "kudu/util/threadlocal.h"
+#include "kudu/util/trace.h"
+
+// Records an event of the current trace into the trace ring of the current
+// thread, if a trace is adopted by the thread. Unlike TRACE(...), nothing is
+// formatted or allocated: the event only stores a pointer to a static
+// description of the call site and up to two integer arguments, which are
+// substituted into 'format' as $0 and $1 only when the event is formatted.
+//
+// 'format' must be a string constant.
+// Example:
+//  TRACE_RING("Prepared $0 row operations", num_ops);
+#define TRACE_RING(format, args...) \
+  do { \
+    kudu::Trace* _trace = kudu::Trace::CurrentTrace(); \
+    if (_trace) { \
+      static const kudu::TraceRingEventType _trace_ring_event_type = \
+          { __FILE__, __LINE__, (format) }; \
+      kudu::TraceRing::Record(&_trace_ring_event_type, _trace->id(), ##args); \
+    } \
+  } while (0)
+
+namespace kudu {
+
+// The static description of a TRACE_RING(...) call site.
+struct TraceRingEventType {
+  const char* file_path;
+  int line_number;
+  const char* format;
+};
+
+// A ring buffer of binary trace events, one per thread.
+//
+// Recording an event into the ring of the current thread takes no lock and
+// allocates nothing, so that the events of all the RPCs can be recorded even
+// though very few of them are ever looked at: once an operation is known to
+// have been slow, the events of its traces still in the rings are collected
+// and formatted. Older events are overwritten once a ring is full, so only
+// the recent operations can be reconstructed.
+//
+// The rings of the exited threads are reused by the new ones, and are never
+// freed. The size of the rings is set by --trace_ring_events_per_thread.
+class TraceRing {
+ public:
+  // An event collected from the rings.
+  struct Event {
+    uint64_t trace_id;
+    const TraceRingEventType* type;
+    MicrosecondsInt64 time_us;
+    int64_t args[2];
+    // The index of the event among the ones of its ring.
+    uint64_t index;
+
+    // Returns the formatted event, with the file and line of its call site.
+    std::string ToString() const;
+  };
+
+  // Records an event of the trace with the given ID into the ring of the
+  // current thread. Use TRACE_RING(...) instead.
+  static void Record(const TraceRingEventType* type,
+                     uint64_t trace_id,
+                     int64_t arg0 = 0,
+                     int64_t arg1 = 0);
+
+  // Appends the events of 'trace' and of its child traces still in the
+  // rings to 'events', ordered by time.
+  static void CollectEvents(const Trace& trace, std::vector<Event>* events);
+
+  // Returns the given events formatted one per line, with the time elapsed
+  // since the first one.
+  static std::string EventsToString(const std::vector<Event>& events);
+
+ private:
+  // A slot of a ring. Each slot is guarded by its own sequence number so
+  // that it can be read while its thread overwrites it: 'seq' is zero while
+  // the slot is being written, and the logical index of the event plus one
+  // afterwards.
+  struct Slot {
+    std::atomic<uint64_t> seq;
+    std::atomic<uint64_t> trace_id;
+    std::atomic<const TraceRingEventType*> type;
+    std::atomic<int64_t> time_us;
+    std::atomic<int64_t> args[2];
+  };
+
+  // Returns a ring to the free ones when its thread exits.
+  class ThreadLease {
+   public:
+    explicit ThreadLease(TraceRing* ring) : ring_(ring) {}
+    ~ThreadLease();
+    TraceRing* ring() const { return ring_; }
+   private:
+    TraceRing* const ring_;
+    DISALLOW_COPY_AND_ASSIGN(ThreadLease);
+  };
+
+  explicit TraceRing(size_t capacity);
+
+  // Returns a free ring, or a new one.
+  static TraceRing* AcquireRing();
+
+  // Appends the events of the traces with the given IDs to 'events'.
+  void CollectEvents(const std::vector<uint64_t>& trace_ids,
+                     std::vector<Event>* events) const;
+
+  const size_t capacity_;
+  std::unique_ptr<Slot[]> slots_;
+
+  // The logical index of the next event. Only accessed by the thread which
+  // holds the ring.
+  uint64_t next_;
+
+  DECLARE_STATIC_THREAD_LOCAL(ThreadLease, tls_lease_);
+
+  DISALLOW_COPY_AND_ASSIGN(TraceRing);
+};
+
+} // namespace kudu
@@ -99,6 +99,12 @@ class WebCallbackRegistry {
   typedef boost::function<void (const WebRequest& args, PrerenderedWebResponse* resp)>
       PrerenderedPathHandlerCallback;
 
+  // A function that handles an HTTP request by writing the response body to
+  // 'output' as it's generated, so that it's sent to the client as it goes
+  // rather than buffered in full.
+  typedef boost::function<void (const WebRequest& args, std::ostream* output)>
+      StreamingPathHandlerCallback;
+
   virtual ~WebCallbackRegistry() {}
 
   // Register a callback for a URL path. Path should not include the
@@ -122,6 +128,14 @@ class WebCallbackRegistry {
                                               const PrerenderedPathHandlerCallback& callback,
                                               bool is_styled,
                                               bool is_on_nav_bar) = 0;
+
+  // Same as RegisterPrerenderedPathHandler(), except that the response body,
+  // of type 'content_type', is streamed to the client while the callback
+  // writes it. Such pages are never styled.
+  virtual void RegisterStreamingPathHandler(const std::string& path, const std::string& alias,
+                                            const StreamingPathHandlerCallback& callback,
+                                            const std::string& content_type,
+                                            bool is_on_nav_bar) = 0;
 };
 
 } // namespace kudu
@@ -0,0 +1,110 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/xor_filter.h"
+
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kudu/util/faststring.h"
+#include "kudu/util/random.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+
+namespace kudu {
+
+class XorFilterTest : public ::testing::TestWithParam<int> {};
+
+INSTANTIATE_TEST_CASE_P(FingerprintBits, XorFilterTest, ::testing::Values(1, 7, 8, 14, 32));
+
+TEST_P(XorFilterTest, TestInsertAndProbe) {
+  const int kNumKeys = 5000;
+  const int kBits = GetParam();
+  Random rng(0xdeadbeef);
+  XorFilterBuilder builder(kBits);
+  for (int i = 0; i < kNumKeys; i++) {
+    builder.AddKey(rng.Next64());
+  }
+  // Duplicates are allowed.
+  builder.AddKey(0);
+  builder.AddKey(0);
+
+  faststring data;
+  ASSERT_OK(builder.Build(&data));
+  ASSERT_EQ(XorFilter::SizeForCount(kNumKeys + 1, kBits), data.size());
+  XorFilter filter;
+  ASSERT_OK(XorFilter::Parse(Slice(data), &filter));
+  ASSERT_EQ(kBits, filter.fingerprint_bits());
+
+  // No false negatives.
+  Random check_rng(0xdeadbeef);
+  for (int i = 0; i < kNumKeys; i++) {
+    ASSERT_TRUE(filter.MayContain(check_rng.Next64()));
+  }
+  ASSERT_TRUE(filter.MayContain(0));
+
+  // The false positive rate is 2^-bits.
+  const int kNumQueries = 200000;
+  int num_positives = 0;
+  for (int i = 0; i < kNumQueries; i++) {
+    num_positives += filter.MayContain(rng.Next64());
+  }
+  double fp_rate = static_cast<double>(num_positives) / kNumQueries;
+  double expected_fp_rate = pow(2, -kBits);
+  LOG(INFO) << "FP rate: " << fp_rate << ", expected: " << expected_fp_rate;
+  ASSERT_LE(fp_rate, expected_fp_rate * 1.2 + 1e-4);
+}
+
+TEST(XorFilterSizingTest, TestSizing) {
+  ASSERT_EQ(14, XorFilter::FingerprintBitsForFPRate(0.0001));
+  ASSERT_EQ(7, XorFilter::FingerprintBitsForFPRate(0.01));
+
+  size_t n_keys = XorFilter::MaxCountForSize(4096, 14);
+  ASSERT_LE(XorFilter::SizeForCount(n_keys, 14), 4096);
+  ASSERT_GT(XorFilter::SizeForCount(n_keys + 1, 14), 4096);
+  ASSERT_EQ(14, XorFilter::FingerprintBitsForSize(4096, n_keys));
+
+  // A bloom filter needs about 1.44 * log2(1 / 0.0001) = 19.1 bits per key.
+  ASSERT_LT(4096 * 8 / n_keys, 18);
+}
+
+TEST(XorFilterSizingTest, TestEmpty) {
+  XorFilterBuilder builder(8);
+  faststring data;
+  ASSERT_OK(builder.Build(&data));
+  XorFilter filter;
+  ASSERT_OK(XorFilter::Parse(Slice(data), &filter));
+}
+
+TEST(XorFilterSizingTest, TestCorruption) {
+  XorFilterBuilder builder(8);
+  builder.AddKey(1);
+  faststring data;
+  ASSERT_OK(builder.Build(&data));
+  XorFilter filter;
+  Status s = XorFilter::Parse(Slice(data.data(), data.size() - 1), &filter);
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+  s = XorFilter::Parse(Slice(data.data(), 4), &filter);
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+}
+
+} // namespace kudu
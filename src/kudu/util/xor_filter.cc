@@ -0,0 +1,210 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/xor_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/gutil/strings/substitute.h"
+
+using std::pair;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+// The number of seeds to try before giving up building a filter. Each
+// attempt only fails with a small probability.
+static const int kMaxBuildAttempts = 100;
+
+constexpr int XorFilter::kMaxFingerprintBits;
+constexpr size_t XorFilter::kHeaderSize;
+constexpr size_t XorFilter::kPaddingSize;
+
+uint32_t XorFilter::SegmentLength(size_t n_keys) {
+  // The filter may be built with high probability with 1.23 slots per key,
+  // plus a constant for small sets.
+  size_t n_slots = static_cast<size_t>(ceil(1.23 * n_keys)) + 32;
+  return static_cast<uint32_t>((n_slots + 2) / 3);
+}
+
+size_t XorFilter::SizeForSegmentLength(uint32_t segment_length, int fingerprint_bits) {
+  uint64_t n_bits = static_cast<uint64_t>(segment_length) * 3 * fingerprint_bits;
+  return kHeaderSize + (n_bits + 7) / 8 + kPaddingSize;
+}
+
+size_t XorFilter::SizeForCount(size_t n_keys, int fingerprint_bits) {
+  return SizeForSegmentLength(SegmentLength(n_keys), fingerprint_bits);
+}
+
+size_t XorFilter::MaxCountForSize(size_t n_bytes, int fingerprint_bits) {
+  if (SizeForCount(0, fingerprint_bits) > n_bytes) {
+    return 0;
+  }
+  size_t lo = 0;
+  size_t hi = n_bytes * 8 / fingerprint_bits;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo + 1) / 2;
+    if (SizeForCount(mid, fingerprint_bits) > n_bytes) {
+      hi = mid - 1;
+    } else {
+      lo = mid;
+    }
+  }
+  return lo;
+}
+
+int XorFilter::FingerprintBitsForFPRate(double fp_rate) {
+  CHECK_GT(fp_rate, 0);
+  CHECK_LT(fp_rate, 1);
+  int bits = static_cast<int>(ceil(-log2(fp_rate)));
+  return std::max(1, std::min(bits, kMaxFingerprintBits));
+}
+
+int XorFilter::FingerprintBitsForSize(size_t n_bytes, size_t n_keys) {
+  int bits = kMaxFingerprintBits;
+  while (bits > 1 && SizeForCount(n_keys, bits) > n_bytes) {
+    bits--;
+  }
+  return bits;
+}
+
+Status XorFilter::Parse(const Slice& data, XorFilter* filter) {
+  if (PREDICT_FALSE(data.size() < kHeaderSize)) {
+    return Status::Corruption(
+        Substitute("xor filter of $0 bytes is too short", data.size()));
+  }
+  uint64_t seed = LittleEndian::Load64(data.data());
+  uint32_t segment_length = LittleEndian::Load32(data.data() + 8);
+  int fingerprint_bits = data[12];
+  if (PREDICT_FALSE(fingerprint_bits < 1 || fingerprint_bits > kMaxFingerprintBits ||
+                    segment_length == 0 ||
+                    SizeForSegmentLength(segment_length, fingerprint_bits) > data.size())) {
+    return Status::Corruption(
+        Substitute("invalid xor filter: $0 bytes, segment length $1, $2-bit fingerprints",
+                   data.size(), segment_length, fingerprint_bits));
+  }
+  filter->slots_ = data.data() + kHeaderSize;
+  filter->seed_ = seed;
+  filter->segment_length_ = segment_length;
+  filter->fingerprint_bits_ = fingerprint_bits;
+  return Status::OK();
+}
+
+XorFilterBuilder::XorFilterBuilder(int fingerprint_bits)
+    : fingerprint_bits_(fingerprint_bits) {
+  CHECK_GE(fingerprint_bits_, 1);
+  CHECK_LE(fingerprint_bits_, XorFilter::kMaxFingerprintBits);
+}
+
+Status XorFilterBuilder::Build(faststring* dst) {
+  // Duplicate keys can't be peeled.
+  std::sort(hashes_.begin(), hashes_.end());
+  hashes_.erase(std::unique(hashes_.begin(), hashes_.end()), hashes_.end());
+
+  const size_t n_keys = hashes_.size();
+  const uint32_t segment_length = XorFilter::SegmentLength(n_keys);
+  const uint32_t n_slots = segment_length * 3;
+
+  // For each slot, the number of keys mapped to it and the xor of their
+  // mixed hashes. Once a slot has a single key, that key is known: it's
+  // removed from its other slots, and pushed to 'stack'.
+  vector<uint32_t> counts(n_slots);
+  vector<uint64_t> xors(n_slots);
+  vector<uint32_t> queue;
+  vector<pair<uint64_t, uint32_t>> stack;
+  stack.reserve(n_keys);
+
+  uint64_t seed = 0;
+  int attempt = 0;
+  for (;; attempt++) {
+    if (attempt == kMaxBuildAttempts) {
+      return Status::RuntimeError(
+          Substitute("unable to build a xor filter of $0 keys", n_keys));
+    }
+    seed = XorFilter::Mix(attempt, 0x9e3779b97f4a7c15ULL);
+    std::fill(counts.begin(), counts.end(), 0);
+    std::fill(xors.begin(), xors.end(), 0);
+    queue.clear();
+    stack.clear();
+
+    for (uint64_t hash : hashes_) {
+      uint64_t h = XorFilter::Mix(hash, seed);
+      for (int i = 0; i < 3; i++) {
+        uint32_t slot = XorFilter::Slot(h, i, segment_length);
+        counts[slot]++;
+        xors[slot] ^= h;
+      }
+    }
+    for (uint32_t slot = 0; slot < n_slots; slot++) {
+      if (counts[slot] == 1) {
+        queue.push_back(slot);
+      }
+    }
+    while (!queue.empty()) {
+      uint32_t slot = queue.back();
+      queue.pop_back();
+      if (counts[slot] != 1) {
+        continue;
+      }
+      uint64_t h = xors[slot];
+      stack.emplace_back(h, slot);
+      for (int i = 0; i < 3; i++) {
+        uint32_t other = XorFilter::Slot(h, i, segment_length);
+        counts[other]--;
+        xors[other] ^= h;
+        if (counts[other] == 1) {
+          queue.push_back(other);
+        }
+      }
+    }
+    if (stack.size() == n_keys) {
+      break;
+    }
+  }
+  VLOG(2) << Substitute("built a xor filter of $0 keys after $1 attempts",
+                        n_keys, attempt + 1);
+
+  // Assign the slots in the reverse order of peeling, so that the slot of
+  // each key is the last of its slots to be assigned.
+  const size_t size = XorFilter::SizeForSegmentLength(segment_length, fingerprint_bits_);
+  dst->resize(size);
+  uint8_t* data = dst->data();
+  memset(data, 0, size);
+  LittleEndian::Store64(data, seed);
+  LittleEndian::Store32(data + 8, segment_length);
+  data[12] = static_cast<uint8_t>(fingerprint_bits_);
+  uint8_t* slots = data + XorFilter::kHeaderSize;
+  for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+    uint64_t h = it->first;
+    uint64_t f = XorFilter::Fingerprint(h, fingerprint_bits_);
+    for (int i = 0; i < 3; i++) {
+      f ^= XorFilter::Load(slots, XorFilter::Slot(h, i, segment_length), fingerprint_bits_);
+    }
+    uint64_t bit = static_cast<uint64_t>(it->second) * fingerprint_bits_;
+    uint8_t* p = slots + (bit >> 3);
+    LittleEndian::Store64(p, LittleEndian::Load64(p) | (f << (bit & 7)));
+  }
+  return Status::OK();
+}
+
+} // namespace kudu
@@ -0,0 +1,182 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "kudu/gutil/endian.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/port.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+// A xor filter: an approximate set membership filter over 64-bit key
+// hashes, whose set of keys is fixed when it's built. See:
+//   "Xor Filters: Faster and Smaller Than Bloom and Cuckoo Filters"
+//   Graf and Lemire, ACM JEA 2020
+//
+// The filter is an array of k-bit fingerprints in three segments. A key maps
+// to one slot of each segment, and is reported present if the xor of the
+// three slots is its fingerprint. That gives a false positive rate of 2^-k
+// with about 1.23 * k bits per key, where a bloom filter needs about
+// 1.44 * log2(1 / rate) bits per key.
+//
+// The serialized filter is a fixed-size header followed by the packed
+// fingerprints. This class is a read-only view over it.
+class XorFilter {
+ public:
+  static constexpr int kMaxFingerprintBits = 32;
+
+  XorFilter()
+      : slots_(nullptr),
+        seed_(0),
+        segment_length_(0),
+        fingerprint_bits_(0) {
+  }
+
+  // Initializes 'filter' to read the serialized filter in 'data', which
+  // must remain valid for the lifetime of the filter.
+  static Status Parse(const Slice& data, XorFilter* filter);
+
+  // Return true if the key whose hash is 'hash' may be in the set.
+  bool MayContain(uint64_t hash) const;
+
+  // Prefetch the slots of the key whose hash is 'hash'.
+  void Prefetch(uint64_t hash) const;
+
+  int fingerprint_bits() const { return fingerprint_bits_; }
+
+  // Return the smallest fingerprint width achieving 'fp_rate'.
+  static int FingerprintBitsForFPRate(double fp_rate);
+
+  // Return the size of a serialized filter of 'n_keys' keys.
+  static size_t SizeForCount(size_t n_keys, int fingerprint_bits);
+
+  // Return the largest number of keys whose filter fits in 'n_bytes'.
+  static size_t MaxCountForSize(size_t n_bytes, int fingerprint_bits);
+
+  // Return the largest fingerprint width with which a filter of 'n_keys'
+  // keys fits in 'n_bytes', or 1 if none does.
+  static int FingerprintBitsForSize(size_t n_bytes, size_t n_keys);
+
+ private:
+  friend class XorFilterBuilder;
+
+  // The seed, segment length and fingerprint width.
+  static constexpr size_t kHeaderSize = 16;
+
+  // The padding after the slots, so that each of them may be read with a
+  // single 64-bit load.
+  static constexpr size_t kPaddingSize = 8;
+
+  static uint32_t SegmentLength(size_t n_keys);
+  static size_t SizeForSegmentLength(uint32_t segment_length, int fingerprint_bits);
+
+  // Mix the seed into a key hash.
+  static uint64_t Mix(uint64_t hash, uint64_t seed) {
+    hash += seed;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+  }
+
+  // The slot of the given mixed hash in segment 'i'.
+  static uint32_t Slot(uint64_t h, int i, uint32_t segment_length) {
+    uint32_t r = static_cast<uint32_t>(i == 0 ? h : (h << (21 * i)) | (h >> (64 - 21 * i)));
+    return static_cast<uint32_t>((static_cast<uint64_t>(r) * segment_length) >> 32) +
+        i * segment_length;
+  }
+
+  static uint64_t Mask(int fingerprint_bits) {
+    return (static_cast<uint64_t>(1) << fingerprint_bits) - 1;
+  }
+
+  static uint64_t Fingerprint(uint64_t h, int fingerprint_bits) {
+    return (h ^ (h >> 32)) & Mask(fingerprint_bits);
+  }
+
+  static uint64_t Load(const uint8_t* slots, uint32_t slot, int fingerprint_bits) {
+    uint64_t bit = static_cast<uint64_t>(slot) * fingerprint_bits;
+    return (LittleEndian::Load64(slots + (bit >> 3)) >> (bit & 7)) & Mask(fingerprint_bits);
+  }
+
+  const uint8_t* slots_;
+  uint64_t seed_;
+  uint32_t segment_length_;
+  int fingerprint_bits_;
+};
+
+// Builds a serialized XorFilter out of a set of key hashes.
+class XorFilterBuilder {
+ public:
+  explicit XorFilterBuilder(int fingerprint_bits);
+
+  // Add the key whose hash is 'hash'. Adding a key more than once is
+  // allowed.
+  void AddKey(uint64_t hash) {
+    hashes_.push_back(hash);
+  }
+
+  // Return the number of keys added since the last call to Clear().
+  size_t count() const { return hashes_.size(); }
+
+  int fingerprint_bits() const { return fingerprint_bits_; }
+
+  // Remove all the keys.
+  void Clear() { hashes_.clear(); }
+
+  // Build the filter of the keys added since the last call to Clear(),
+  // replacing the contents of 'dst'.
+  Status Build(faststring* dst);
+
+ private:
+  const int fingerprint_bits_;
+  std::vector<uint64_t> hashes_;
+
+  DISALLOW_COPY_AND_ASSIGN(XorFilterBuilder);
+};
+
+////////////////////////////////////////////////////////////
+// Inline implementations
+////////////////////////////////////////////////////////////
+
+inline bool XorFilter::MayContain(uint64_t hash) const {
+  uint64_t h = Mix(hash, seed_);
+  uint64_t f = Fingerprint(h, fingerprint_bits_);
+  for (int i = 0; i < 3; i++) {
+    f ^= Load(slots_, Slot(h, i, segment_length_), fingerprint_bits_);
+  }
+  return f == 0;
+}
+
+inline void XorFilter::Prefetch(uint64_t hash) const {
+  uint64_t h = Mix(hash, seed_);
+  for (int i = 0; i < 3; i++) {
+    uint64_t bit = static_cast<uint64_t>(Slot(h, i, segment_length_)) * fingerprint_bits_;
+    prefetch(reinterpret_cast<const char *>(slots_ + (bit >> 3)), PREFETCH_HINT_T0);
+  }
+}
+
+} // namespace kudu
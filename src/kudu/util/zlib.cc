@@ -20,6 +20,8 @@
 #include <zconf.h>
 #include <zlib.h>
 
+#include <glog/logging.h>
+
 #include <cstdint>
 #include <cstring>
 #include <string>
@@ -123,5 +125,72 @@ Status Uncompress(Slice compressed, std::ostream* out) {
   return Status::OK();
 }
 
+namespace {
+const int kStreamingChunkSize = 16 * 1024;
+} // anonymous namespace
+
+StreamingCompressor::StreamingCompressor()
+    : zs_(new z_stream),
+      chunk_(new unsigned char[kStreamingChunkSize]),
+      initialized_(false) {
+  memset(zs_.get(), 0, sizeof(*zs_));
+}
+
+StreamingCompressor::~StreamingCompressor() {
+  if (initialized_) {
+    deflateEnd(zs_.get());
+  }
+}
+
+Status StreamingCompressor::Init() {
+  DCHECK(!initialized_);
+  ZRETURN_NOT_OK(deflateInit2(zs_.get(), Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                              15 + 16 /* 15 window bits, enable gzip */,
+                              8 /* memory level, max is 9 */,
+                              Z_DEFAULT_STRATEGY));
+  initialized_ = true;
+  return Status::OK();
+}
+
+Status StreamingCompressor::Compress(Slice input, ostream* out) {
+  DCHECK(initialized_);
+  if (input.empty()) {
+    // deflate() can't make progress without input.
+    return Status::OK();
+  }
+  zs_->avail_in = input.size();
+  zs_->next_in = const_cast<uint8_t*>(input.data());
+  return Deflate(Z_NO_FLUSH, out);
+}
+
+Status StreamingCompressor::Finish(ostream* out) {
+  DCHECK(initialized_);
+  zs_->avail_in = 0;
+  zs_->next_in = nullptr;
+  RETURN_NOT_OK(Deflate(Z_FINISH, out));
+  initialized_ = false;
+  return ZlibResultToStatus(deflateEnd(zs_.get()));
+}
+
+Status StreamingCompressor::Deflate(int flush, ostream* out) {
+  // Deflate until there's room left in the output chunk: all the input has
+  // then been consumed and, when finishing, the stream has ended.
+  do {
+    zs_->avail_out = kStreamingChunkSize;
+    zs_->next_out = chunk_.get();
+    int rc = deflate(zs_.get(), flush);
+    // Z_BUF_ERROR only means that no progress was possible, when the output
+    // exactly filled the previous chunk.
+    if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) {
+      return ZlibResultToStatus(rc);
+    }
+    int out_size = zs_->next_out - chunk_.get();
+    if (out_size > 0) {
+      out->write(reinterpret_cast<char *>(chunk_.get()), out_size);
+    }
+  } while (zs_->avail_out == 0);
+  return Status::OK();
+}
+
 } // namespace zlib
 } // namespace kudu
@@ -17,10 +17,14 @@
 #pragma once
 
 #include <iosfwd>
+#include <memory>
 
+#include "kudu/gutil/macros.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
+struct z_stream_s;
+
 namespace kudu {
 namespace zlib {
 
@@ -35,5 +39,34 @@ Status Compress(Slice input, std::ostream* out);
 // In case of an error, some data may still be appended to 'out'.
 Status Uncompress(Slice compressed, std::ostream* out);
 
+// Incrementally gzip-compresses data whose size isn't known up front, in the
+// same format as Compress().
+class StreamingCompressor {
+ public:
+  StreamingCompressor();
+  ~StreamingCompressor();
+
+  Status Init();
+
+  // Compresses 'input', appending the compressed data produced so far to
+  // 'out'. Some of it may only be appended by the next calls.
+  Status Compress(Slice input, std::ostream* out);
+
+  // Appends the rest of the compressed data to 'out'. Nothing may be
+  // compressed afterwards.
+  Status Finish(std::ostream* out);
+
+ private:
+  // Deflates the pending input with the zlib flush mode 'flush', appending the
+  // output to 'out'.
+  Status Deflate(int flush, std::ostream* out);
+
+  std::unique_ptr<z_stream_s> zs_;
+  std::unique_ptr<unsigned char[]> chunk_;
+  bool initialized_;
+
+  DISALLOW_COPY_AND_ASSIGN(StreamingCompressor);
+};
+
 } // namespace zlib
 } // namespace kudu
@@ -553,6 +553,22 @@ build_lz4() {
   popd
 }
 
+build_zstd() {
+  ZSTD_BDIR=$TP_BUILD_DIR/$ZSTD_NAME$MODE_SUFFIX
+  mkdir -p $ZSTD_BDIR
+  pushd $ZSTD_BDIR
+
+  # It doesn't appear possible to isolate source and build directories, so just
+  # prepopulate the latter using the former.
+  rsync -av --delete $ZSTD_SOURCE/ .
+
+  # Only the static library is needed.
+  CFLAGS="$EXTRA_CFLAGS -fPIC" \
+    make -C lib -j$PARALLEL $EXTRA_MAKEFLAGS libzstd.a
+  make -C lib PREFIX=$PREFIX install-static install-includes
+  popd
+}
+
 build_bitshuffle() {
   BITSHUFFLE_BDIR=$TP_BUILD_DIR/$BITSHUFFLE_NAME$MODE_SUFFIX
   mkdir -p $BITSHUFFLE_BDIR